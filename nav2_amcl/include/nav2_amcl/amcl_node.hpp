@@ -22,15 +22,23 @@
 #define NAV2_AMCL__AMCL_NODE_HPP_
 
 #include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <list>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
 #include "geometry_msgs/msg/pose_array.hpp"
 #include "geometry_msgs/msg/pose_stamped.hpp"
+#include "map_msgs/msg/occupancy_grid_update.hpp"
 #include "message_filters/subscriber.h"
+#include "nav2_msgs/msg/distance_field.hpp"
 #include "nav2_util/lifecycle_node.hpp"
 #include "nav2_amcl/motion_model/motion_model.hpp"
 #include "nav2_amcl/sensors/laser/laser.hpp"
@@ -54,7 +62,7 @@ namespace nav2_amcl
 class AmclNode : public nav2_util::LifecycleNode
 {
 public:
-  AmclNode();
+  explicit AmclNode(const rclcpp::NodeOptions & options = rclcpp::NodeOptions());
   ~AmclNode();
 
 protected:
@@ -81,18 +89,38 @@ protected:
   // Map-related
   void mapReceived(const nav_msgs::msg::OccupancyGrid::SharedPtr msg);
   void handleMapMessage(const nav_msgs::msg::OccupancyGrid & msg);
-  void createFreeSpaceVector();
+  // Applies an edit of a region of the map, recomputing only what depends on it
+  void mapUpdateReceived(const map_msgs::msg::OccupancyGridUpdate::SharedPtr msg);
+  // Keeps the distance field the map server computed, for the map it was computed for
+  void mapDistanceReceived(const nav2_msgs::msg::DistanceField::SharedPtr msg);
+  // Fills in the cspace distances of map_ from the map server's distance field,
+  // if there is one for this map that reaches far enough
+  bool useMapDistance();
+  // Fills in the cspace distances of map_ from the cache, or computes and caches them
+  void loadLikelihoodField(const nav_msgs::msg::OccupancyGrid & msg);
+  // Fills in the range table of map_ from the cache, or builds and caches it
+  void loadRangeTable(const nav_msgs::msg::OccupancyGrid & msg);
+  // Indexes the free cells of map_ for uniformPoseGenerator
+  void createFreeSpaceIndex();
+  // Keeps map_ in map_cache_ if it's cached, frees it otherwise
   void freeMapDependentMemory();
+  // Takes the map of a message out of map_cache_, NULL if it isn't there
+  map_t * takeCachedMap(const nav_msgs::msg::OccupancyGrid & msg, uint64_t hash);
   map_t * map_{nullptr};
+  // The hash of the message of map_, 0 if it isn't to be cached
+  uint64_t map_hash_{0};
+  // The last maps replaced, with their hashes, the most recently used last
+  std::list<std::pair<uint64_t, map_t *>> map_cache_;
   map_t * convertMap(const nav_msgs::msg::OccupancyGrid & map_msg);
   bool first_map_only_{true};
   std::atomic<bool> first_map_received_{false};
   amcl_hyp_t * initial_pose_hyp_;
   std::recursive_mutex configuration_mutex_;
   rclcpp::Subscription<nav_msgs::msg::OccupancyGrid>::ConstSharedPtr map_sub_;
-#if NEW_UNIFORM_SAMPLING
-  static std::vector<std::pair<int, int>> free_space_indices;
-#endif
+  rclcpp::Subscription<map_msgs::msg::OccupancyGridUpdate>::ConstSharedPtr map_update_sub_;
+  rclcpp::Subscription<nav2_msgs::msg::DistanceField>::ConstSharedPtr map_distance_sub_;
+  nav2_msgs::msg::DistanceField::SharedPtr map_distance_;
+  nav_msgs::msg::MapMetaData map_info_;
 
   // Transforms
   void initTransforms();
@@ -120,6 +148,70 @@ protected:
   void initialPoseReceived(geometry_msgs::msg::PoseWithCovarianceStamped::SharedPtr msg);
   void laserReceived(sensor_msgs::msg::LaserScan::ConstSharedPtr laser_scan);
 
+  // Apply changes to the filter's parameters in place: the particle set is resized
+  // keeping its particles, and only the motion model is rebuilt for the odometry noise
+  rclcpp::AsyncParametersClient::SharedPtr parameters_client_;
+  rclcpp::Subscription<rcl_interfaces::msg::ParameterEvent>::SharedPtr parameter_event_sub_;
+  void on_parameter_event_callback(const rcl_interfaces::msg::ParameterEvent::SharedPtr event);
+
+  // A scan made ready for the filter: the odometry pose it was taken at, and
+  // its ranges and bearings in the base frame
+  struct PreparedScan
+  {
+    sensor_msgs::msg::LaserScan::ConstSharedPtr laser_scan;
+    pf_vector_t pose;
+    nav2_amcl::LaserData ldata;
+  };
+  // A scan to prepare, recycled from scan_pool_ once nothing else holds it
+  std::shared_ptr<PreparedScan> acquireScan();
+  std::vector<std::shared_ptr<PreparedScan>> scan_pool_;
+  std::mutex scan_pool_mutex_;
+  bool prepareScan(
+    const sensor_msgs::msg::LaserScan::ConstSharedPtr & laser_scan, PreparedScan & prepared);
+  // Runs the filter on a prepared scan and publishes the results
+  void processScan(std::shared_ptr<PreparedScan> prepared);
+  // Gathers the scans of each laser until every laser has one within
+  // laser_fusion_window_, then returns them as one scan whose beams each
+  // carry the position of their laser, or nullptr while the set is incomplete
+  std::shared_ptr<PreparedScan> fuseScans(
+    int laser_index, const std::shared_ptr<PreparedScan> & prepared);
+  double laser_fusion_window_;
+  std::vector<std::shared_ptr<PreparedScan>> fusion_scans_;
+
+  // Pipelined scan processing: the subscription only prepares each scan and
+  // leaves it in a single slot, from which the filter thread takes the newest
+  // one, and the results are published from the output thread
+  void startPipeline();
+  void stopPipeline();
+  void runFilterThread();
+  void runOutputThread();
+  // Publishes on the output thread while the pipeline runs, or right away
+  void publishOutput(std::function<void()> publish);
+  bool pipelined_scan_processing_;
+  bool pipeline_running_{false};
+  std::mutex pipeline_mutex_;
+  std::condition_variable scan_ready_;
+  std::condition_variable output_ready_;
+  std::shared_ptr<PreparedScan> pending_scan_;
+  std::deque<std::function<void()>> pending_output_;
+  std::thread filter_thread_;
+  std::thread output_thread_;
+
+  // Publishing the transform from a thread of its own: sendMapToOdomTransform() only
+  // leaves the latest correction, which the thread sends right away and then at
+  // tf_publish_rate, post-dated from the time it is sent, so it never waits for the filter
+  void startTfThread();
+  void stopTfThread();
+  void runTfThread();
+  double tf_publish_rate_;
+  bool tf_thread_running_{false};
+  std::mutex tf_mutex_;
+  std::condition_variable tf_changed_;
+  bool tf_correction_known_{false};
+  bool tf_correction_changed_{false};
+  geometry_msgs::msg::TransformStamped tf_correction_;
+  std::thread tf_thread_;
+
   // Services and service callbacks
   void initServices();
   rclcpp::Service<std_srvs::srv::Empty>::SharedPtr global_loc_srv_;
@@ -156,6 +248,21 @@ protected:
   void initParticleFilter();
   // Pose-generating function used to uniformly distribute particles over the map
   static pf_vector_t uniformPoseGenerator(void * arg);
+  // Pose-generating function used to spread particles around the poses
+  // found by a global localization search
+  struct SearchHypotheses
+  {
+    std::vector<map_pose_score_t> poses;
+    double position_sigma;
+    double angle_sigma;
+  };
+  static pf_vector_t hypothesisPoseGenerator(void * arg);
+  // Searches the map for the poses that best fit the scan and starts the
+  // particles around them
+  bool searchGlobalPose(int laser_index, const nav2_amcl::LaserData & ldata);
+  bool global_localization_search_;
+  int global_localization_hypotheses_;
+  bool global_search_pending_{false};
   pf_t * pf_{nullptr};
   bool pf_init_;
   pf_vector_t pf_odom_pose_;
@@ -168,6 +275,7 @@ protected:
   int scan_error_count_{0};
   std::vector<nav2_amcl::Laser *> lasers_;
   std::vector<bool> lasers_update_;
+  std::shared_ptr<nav2_util::ThreadPool> sensor_pool_;
   std::map<std::string, int> frame_to_laser_;
   rclcpp::Time last_laser_received_ts_;
   void checkLaserReceived();
@@ -183,9 +291,23 @@ protected:
     geometry_msgs::msg::PoseStamped & laser_pose);
   bool shouldUpdateFilter(const pf_vector_t pose, pf_vector_t & delta);
   bool updateFilter(
-    const int & laser_index,
-    const sensor_msgs::msg::LaserScan::ConstSharedPtr & laser_scan,
+    const int & laser_index, nav2_amcl::LaserData & ldata,
     const pf_vector_t & pose);
+  // Adapts the particle limit, the beam count and how many updates are
+  // skipped to how long the last update took against update_latency_target_
+  void adjustBudget(double update_time);
+  double update_latency_target_;
+  double budget_scale_{1.0};  // the share of max_particles * max_beams to use
+  int budget_skip_{0};
+  int budget_skipped_{0};
+  // Drops the beams of the scan that end well short of the map, as seen from
+  // the last pose published moved by the odometry since, and returns how many
+  int pruneOutlierBeams(nav2_amcl::LaserData & ldata, int laser_index, const pf_vector_t & pose);
+  std::vector<bool> beam_outliers_;  // scratch of pruneOutlierBeams()
+  // The last pose published and the odometry pose it was computed for
+  pf_vector_t best_hyp_pose_;
+  pf_vector_t best_hyp_odom_pose_;
+  // Publishes up to max_particlecloud_poses_ of the samples, if anyone listens
   void publishParticleCloud(const pf_sample_set_t * set);
   bool getMaxWeightHyp(
     std::vector<amcl_hyp_t> & hyps, amcl_hyp_t & max_weight_hyps,
@@ -219,15 +341,21 @@ protected:
   double beam_skip_distance_;
   double beam_skip_error_threshold_;
   double beam_skip_threshold_;
+  int beam_range_table_angles_;
+  bool beam_outlier_pruning_;
+  double beam_outlier_distance_;
   bool do_beamskip_;
   std::string global_frame_id_;
   double lambda_short_;
   double laser_likelihood_max_dist_;
+  std::string likelihood_field_cache_dir_;
   double laser_max_range_;
   double laser_min_range_;
   std::string sensor_model_type_;
+  int map_cache_size_{0};
   int max_beams_;
   int max_particles_;
+  int max_particlecloud_poses_;
   int min_particles_;
   std::string odom_frame_id_;
   double pf_err_;
@@ -235,8 +363,11 @@ protected:
   double alpha_fast_;
   double alpha_slow_;
   int resample_interval_;
+  std::string resample_method_;
   std::string robot_model_type_;
   tf2::Duration save_pose_period_;
+  int scan_match_iterations_;
+  int sensor_update_threads_;
   double sigma_hit_;
   bool tf_broadcast_;
   tf2::Duration transform_tolerance_;
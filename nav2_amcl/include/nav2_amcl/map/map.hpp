@@ -28,6 +28,7 @@
 #ifndef NAV2_AMCL__MAP__MAP_HPP_
 #define NAV2_AMCL__MAP__MAP_HPP_
 
+#include <stddef.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
@@ -42,18 +43,73 @@ struct _rtk_fig_t;
 #define MAP_WIFI_MAX_LEVELS 8
 
 
-// Description for a single map cell.
+// The distance to the nearest occupied cell is stored in steps of
+// max_occ_dist / MAP_OCC_DIST_MAX, so MAP_OCC_DIST_MAX is max_occ_dist or more
+#define MAP_OCC_DIST_MAX 255
+
+
+// occ_dist is laid out in square tiles of MAP_TILE_SIZE cells a side, one
+// page of memory each, so the cells around a particle sit on a few pages and
+// a likelihood field mapped from a file is only read in around the particles
+#define MAP_TILE_SHIFT 6
+#define MAP_TILE_SIZE (1 << MAP_TILE_SHIFT)
+
+
+// Precomputed ranges along discretized bearings, as a compressed
+// directional distance transform: for each bearing the map is cut into lanes
+// one cell wide along it, and each lane only holds the positions along the
+// bearing of the obstacle cells next to free space that overlap it. A range
+// is then the gap to the next obstacle in the lane of the start cell.
 typedef struct
 {
-  // Occupancy state (-1 = free, 0 = unknown, +1 = occ)
-  int occ_state;
+  // Number of bearings over half a turn, each one is also used in reverse
+  int angle_count;
+
+  // For each bearing, the number of its lowest lane and the index of that
+  // lane in lane_offsets
+  int32_t * lane_min;
+  int32_t * lane_start;
+
+  // For each lane, the index of its first obstacle in obstacles, followed by
+  // the total number of obstacles
+  int32_t * lane_offsets;
 
-  // Distance to the nearest occupied cell
-  double occ_dist;
+  // Positions of the obstacles along the bearing, in cells and sorted in
+  // each lane
+  float * obstacles;
+
+  // The cosine and sine of each bearing
+  double * directions;
+
+  // The block holding the arrays, either allocated or a read only mapping of
+  // a cache file when mapping_size is not zero
+  void * data;
+  size_t mapping_size;
+} map_range_table_t;
+
+
+// The free cells of a map as runs along its rows, so that a free cell can be
+// drawn uniformly at random without a list of all of them
+typedef struct
+{
+  int64_t run_count;
 
-  // Wifi levels
-  // int wifi_levels[MAP_WIFI_MAX_LEVELS];
-} map_cell_t;
+  // For each run, its first cell
+  int32_t * run_x;
+  int32_t * run_y;
+
+  // For each run, the number of free cells in the runs before it, followed
+  // by the total number of free cells
+  int64_t * cells_before;
+} map_free_runs_t;
+
+
+// A pose found by map_search_poses, in world coords, and its score
+typedef struct
+{
+  double x, y, a;
+  double score;
+} map_pose_score_t;
 
 
 // Description for a map
@@ -68,12 +124,33 @@ typedef struct
   // Map dimensions (number of cells)
   int size_x, size_y;
 
-  // The map data, stored as a grid
-  map_cell_t * cells;
+  // Number of occ_dist tiles across the map
+  int tiles_x, tiles_y;
+
+  // The map data, stored as a grid, one array per field so the sensor
+  // models only pull the distances they read into the cache
+
+  // Occupancy state (-1 = free, 0 = unknown, +1 = occ)
+  int8_t * occ_state;
+
+  // Distance to the nearest occupied cell, see MAP_OCC_DIST_MAX, indexed
+  // by MAP_DIST_INDEX
+  uint8_t * occ_dist;
+
+  // The read only mapping of the cache file occ_dist is in, or NULL when
+  // occ_dist is allocated
+  void * occ_dist_mapping;
+  size_t occ_dist_mapping_size;
 
   // Max distance at which we care about obstacles, for constructing
-  // likelihood field
+  // likelihood field, negative until the cspace distances are computed
   double max_occ_dist;
+
+  // Ranges for map_calc_range, or NULL to ray trace them
+  map_range_table_t * range_table;
+
+  // The free cells for map_sample_free_cell, or NULL until they are indexed
+  map_free_runs_t * free_runs;
 } map_t;
 
 
@@ -87,8 +164,26 @@ map_t * map_alloc(void);
 // Destroy a map
 void map_free(map_t * map);
 
-// Get the cell at the given point
-map_cell_t * map_get_cell(map_t * map, double ox, double oy, double oa);
+// Allocate the cells for the size of the map, all unknown and at max_occ_dist
+void map_alloc_cells(map_t * map);
+
+// Free occ_dist, or unmap it when it was mapped from a cache file
+void map_free_occ_dist(map_t * map);
+
+// Allocate a cell array, such as occ_state or occ_dist, backed by huge pages
+// when large so that lookups all over the map miss the TLB less. Returns NULL
+// on failure.
+void * map_alloc_buffer(size_t size);
+
+// Free a cell array from map_alloc_buffer, or nothing for NULL
+void map_free_buffer(void * buffer);
+
+// Copy occ_dist out of the cache file it is mapped from, so it can be changed.
+// Returns 0 on success.
+int map_copy_occ_dist(map_t * map);
+
+// Get the index of the cell at the given point, or -1 if it is off the map
+int map_get_cell(map_t * map, double ox, double oy, double oa);
 
 // Load an occupancy map
 int map_load_occ(map_t * map, const char * filename, double scale, int negate);
@@ -99,15 +194,83 @@ int map_load_occ(map_t * map, const char * filename, double scale, int negate);
 // Update the cspace distances
 void map_update_cspace(map_t * map, double max_occ_dist);
 
+// Update the cspace distances around the cells in [min_x, max_x) x [min_y, max_y)
+// after their occupancy state changed, if the distances have been computed
+void map_update_cspace_region(map_t * map, int min_x, int min_y, int max_x, int max_y);
+
+// Set the cspace distances for max_occ_dist from distances to the nearest
+// occupied cell computed elsewhere, one per cell row by row, in steps of
+// distance_max / MAP_OCC_DIST_MAX and at MAP_OCC_DIST_MAX from distance_max
+// on. distance_max must be at least max_occ_dist.
+void map_update_cspace_from_distances(
+  map_t * map, const uint8_t * distances, double distance_max, double max_occ_dist);
+
+// Map the cspace distances for max_occ_dist from a file written by
+// map_save_cspace for a map of the same size and scale, so they are paged in
+// from the file as they are read. Returns 0 on success.
+int map_load_cspace(map_t * map, const char * filename, double max_occ_dist);
+
+// Save the cspace distances to a file. Returns 0 on success.
+int map_save_cspace(map_t * map, const char * filename);
+
+// Build the range table for angle_count bearings over half a turn
+void map_update_range_table(map_t * map, int angle_count);
+
+// Map the range table for angle_count bearings from a file written by
+// map_save_range_table for a map of the same size and scale. Returns 0 on success.
+int map_load_range_table(map_t * map, const char * filename, int angle_count);
+
+// Save the range table to a file. Returns 0 on success.
+int map_save_range_table(map_t * map, const char * filename);
+
+// Free the range table, so ranges are ray traced again
+void map_free_range_table(map_t * map);
+
+// Create a range table around a block of its arrays, laid out as lane_min,
+// lane_start, lane_offsets and obstacles, of which lane_min and lane_start
+// must already be filled in. arrays is inside data, see map_range_table_t.
+map_range_table_t * map_range_table_wrap(
+  void * data, size_t mapping_size, const void * arrays, int angle_count);
+
+
+// Index the free cells of the map by runs along its rows
+void map_update_free_runs(map_t * map);
+
+// Free the free cell index
+void map_clear_free_runs(map_t * map);
+
+// Get the free cell at r in [0, 1) of the way through all free cells, so a
+// uniform r draws a uniform free cell. Returns 0 on success, or -1 when the
+// map has no free cells or they are not indexed.
+int map_sample_free_cell(const map_t * map, double r, int * i, int * j);
+
 
 /**************************************************************************
  * Range functions
  **************************************************************************/
 
-// Extract a single range reading from the map
+// Extract a single range reading from the map, from the range table when
+// there is one
 double map_calc_range(map_t * map, double ox, double oy, double oa, double max_range);
 
 
+/**************************************************************************
+ * Search functions
+ **************************************************************************/
+
+// Find up to count of the best poses on free cells of the map for a scan of
+// point_count end points, given as x, y pairs in meters in the robot frame,
+// by branch and bound over a pyramid of the cspace distances. A pose scores
+// the sum over its points of dist_score[occ_dist] of the cell they end in,
+// and dist_score must not increase with the distance. Headings are tried
+// every angular_step, and a pose within separation meters and an eighth of a
+// turn of a better one is dropped. The poses are written to poses best first,
+// and the number written is returned.
+int map_search_poses(
+  map_t * map, const double * points, int point_count, const double * dist_score,
+  double angular_step, double separation, map_pose_score_t * poses, int count);
+
+
 /**************************************************************************
  * GUI/diagnostic functions
  **************************************************************************/
@@ -140,6 +303,22 @@ void map_draw_wifi(map_t * map, struct _rtk_fig_t * fig, int index);
 // Compute the cell index for the given map coords.
 #define MAP_INDEX(map, i, j) ((i) + (j) * map->size_x)
 
+// Compute the index in occ_dist for the given map coords, which must be valid
+#define MAP_DIST_INDEX(map, i, j) \
+  ((((size_t) ((j) >> MAP_TILE_SHIFT) * map->tiles_x + ((i) >> MAP_TILE_SHIFT)) << \
+  (2 * MAP_TILE_SHIFT)) + \
+  (((j) & (MAP_TILE_SIZE - 1)) << MAP_TILE_SHIFT) + ((i) & (MAP_TILE_SIZE - 1)))
+
+// The number of cells in occ_dist, the map rounded up to whole tiles
+#define MAP_DIST_SIZE(map) \
+  ((size_t) map->tiles_x * map->tiles_y * MAP_TILE_SIZE * MAP_TILE_SIZE)
+
+// Convert between a distance in meters and its stored value in occ_dist
+#define MAP_OCC_DIST(map, index) (map->occ_dist[index] * map->max_occ_dist / MAP_OCC_DIST_MAX)
+#define MAP_OCC_DIST_QUANTIZE(map, d) \
+  ((uint8_t) ((d) >= map->max_occ_dist ? MAP_OCC_DIST_MAX : \
+  (d) * MAP_OCC_DIST_MAX / map->max_occ_dist + 0.5))
+
 #ifdef __cplusplus
 }
 #endif
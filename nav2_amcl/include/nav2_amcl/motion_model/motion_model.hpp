@@ -17,9 +17,13 @@
 #ifndef NAV2_AMCL__MOTION_MODEL__MOTION_MODEL_HPP_
 #define NAV2_AMCL__MOTION_MODEL__MOTION_MODEL_HPP_
 
+#include <stdint.h>
+#include <functional>
+#include <memory>
 #include <string>
 #include "nav2_amcl/pf/pf.hpp"
 #include "nav2_amcl/pf/pf_pdf.hpp"
+#include "nav2_util/thread_pool.hpp"
 
 namespace nav2_amcl
 {
@@ -27,12 +31,34 @@ namespace nav2_amcl
 class MotionModel
 {
 public:
+  MotionModel();
   virtual ~MotionModel() = default;
   virtual void odometryUpdate(pf_t * pf, const pf_vector_t & pose, const pf_vector_t & delta) = 0;
 
+  // Moves the samples in parallel on the given pool, or on the calling thread when it is null
+  void setThreadPool(std::shared_ptr<nav2_util::ThreadPool> pool);
+
   static MotionModel * createMotionModel(
     std::string & type, double alpha1, double alpha2,
     double alpha3, double alpha4, double alpha5);
+
+protected:
+  // The samples are moved in chunks of this many consecutive samples
+  static const int sample_chunk_size = 256;
+
+  // Calls move(begin, end, noise) for every chunk of [0, sample_count), in
+  // parallel when there is a thread pool. noise holds noise_count rows of
+  // (end - begin) zero mean, unit variance gaussian draws, row k for sample i
+  // being noise[k * (end - begin) + (i - begin)]. Each chunk has its own random
+  // stream, so the draws don't depend on the number of threads.
+  void moveSamples(
+    int sample_count, int noise_count,
+    const std::function<void(int begin, int end, const double * noise)> & move);
+
+private:
+  std::shared_ptr<nav2_util::ThreadPool> pool_;
+  uint64_t seed_;
+  uint64_t update_count_;
 };
 
 class OmniMotionModel : public MotionModel
@@ -28,6 +28,8 @@
 #ifndef NAV2_AMCL__PF__PF_HPP_
 #define NAV2_AMCL__PF__PF_HPP_
 
+#include <math.h>
+
 #include "nav2_amcl/pf/pf_vector.hpp"
 #include "nav2_amcl/pf/pf_kdtree.hpp"
 
@@ -35,6 +37,17 @@
 extern "C" {
 #endif
 
+// The type the sample poses are stored and the sensor models work in. With
+// PF_SINGLE_PRECISION it is float, which halves the memory the motion and
+// sensor models stream through per sample and doubles their SIMD width. The
+// weights, which may span many orders of magnitude, and the statistics stay
+// double either way.
+#ifdef PF_SINGLE_PRECISION
+typedef float pf_real_t;
+#else
+typedef double pf_real_t;
+#endif
+
 // Forward declarations
 struct _pf_t;
 struct _rtk_fig_t;
@@ -50,6 +63,12 @@ typedef void (* pf_action_model_fn_t) (
   void * action_data,
   struct _pf_sample_set_t * set);
 
+// Function prototype for running task(task_data, i) for every i in
+// [0, count), possibly in parallel, returning once all of them are done
+typedef void (* pf_parallel_for_fn_t) (
+  void * parallel_data, int count,
+  void (* task)(void * task_data, int index), void * task_data);
+
 // Function prototype for the sensor model; determines the probability
 // for the given set of sample poses.
 typedef double (* pf_sensor_model_fn_t) (
@@ -57,15 +76,16 @@ typedef double (* pf_sensor_model_fn_t) (
   struct _pf_sample_set_t * set);
 
 
-// Information for a single sample
-typedef struct
+// How pf_update_resample picks the samples to copy
+typedef enum
 {
-  // Pose represented by this sample
-  pf_vector_t pose;
-
-  // Weight for this pose
-  double weight;
-} pf_sample_t;
+  // An independent draw for every sample, found by binary search
+  PF_RESAMPLE_MULTINOMIAL,
+  // The low-variance sampler of Probabilistic Robotics p110 over max_samples
+  // evenly spaced draws, taken in random order so that wherever the KLD limit
+  // stops the resampling the samples taken are spread over all of them
+  PF_RESAMPLE_SYSTEMATIC
+} pf_resample_method_t;
 
 
 // Information for a cluster of samples
@@ -89,9 +109,16 @@ typedef struct
 // Information for a set of samples
 typedef struct _pf_sample_set_t
 {
-  // The samples
+  // The samples, stored as one array per field so that each stage only
+  // streams through the fields it uses: the poses in the motion and sensor
+  // models, the weights in the normalization and the resampling. Sample i
+  // has the pose (x[i], y[i], theta[i]) and weight[i]. The arrays share one
+  // block, each starting on a cache line.
   int sample_count;
-  pf_sample_t * samples;
+  pf_real_t * x;
+  pf_real_t * y;
+  pf_real_t * theta;
+  double * weight;
 
   // A kdtree encoding the histogram
   pf_kdtree_t * kdtree;
@@ -104,9 +131,42 @@ typedef struct _pf_sample_set_t
   pf_vector_t mean;
   pf_matrix_t cov;
   int converged;
+
+  // Set when the samples changed since the cluster and filter statistics
+  // were computed, which only happens once they are asked for
+  int stats_stale;
 } pf_sample_set_t;
 
 
+// The pose of sample i of a set
+static inline pf_vector_t pf_get_sample_pose(const pf_sample_set_t * set, int i)
+{
+  pf_vector_t pose;
+  pose.v[0] = set->x[i];
+  pose.v[1] = set->y[i];
+  pose.v[2] = set->theta[i];
+  return pose;
+}
+
+// The heading to store for a sample, wrapped into [-pi, pi] in single
+// precision, where a heading growing turn after turn would lose precision
+static inline pf_real_t pf_sample_angle(double a)
+{
+#ifdef PF_SINGLE_PRECISION
+  return (pf_real_t) atan2(sin(a), cos(a));
+#else
+  return a;
+#endif
+}
+
+static inline void pf_set_sample_pose(pf_sample_set_t * set, int i, pf_vector_t pose)
+{
+  set->x[i] = pose.v[0];
+  set->y[i] = pose.v[1];
+  set->theta[i] = pose.v[2];
+}
+
+
 // Information for an entire filter
 typedef struct _pf_t
 {
@@ -134,6 +194,23 @@ typedef struct _pf_t
   double dist_threshold;  // distance threshold in each axis over which the pf is considered to not
                           // be converged
   int converged;
+
+  // How to resample, PF_RESAMPLE_MULTINOMIAL unless set otherwise
+  pf_resample_method_t resample_method;
+
+  // Scratch space for resampling, allocated with the sample sets
+  double * resample_cumulative;  // max_samples + 1 cumulative weights
+  int * resample_indices;  // max_samples indices of the systematic draws
+
+  // Runs the chunks of the cluster statistics, on the calling thread when NULL
+  pf_parallel_for_fn_t parallel_for;
+  void * parallel_data;
+
+  // Scratch space for the cluster statistics: the cluster of every sample,
+  // and the sums of each chunk of samples per cluster, grown as needed
+  int * cluster_labels;
+  pf_cluster_t * cluster_sums;
+  int cluster_sums_size;
 } pf_t;
 
 
@@ -146,6 +223,11 @@ pf_t * pf_alloc(
 // Free an existing filter
 void pf_free(pf_t * pf);
 
+// Change the min and max number of samples of an existing filter without reinitializing
+// it: particles are kept as they are when they fit, and resampled into the new size
+// with systematic draws when there are more of them
+void pf_resize(pf_t * pf, int min_samples, int max_samples);
+
 // Initialize the filter using a guassian
 void pf_init(pf_t * pf, pf_vector_t mean, pf_matrix_t cov);
 
@@ -173,6 +255,14 @@ int pf_get_cluster_stats(
 // Re-compute the cluster statistics for a sample set
 void pf_cluster_stats(pf_t * pf, pf_sample_set_t * set);
 
+// Re-compute the cluster statistics of the current set if its samples
+// changed since, before reading its clusters, mean or cov directly
+void pf_update_cluster_stats(pf_t * pf);
+
+// Run the cluster statistics through parallel_for(parallel_data, ...), or
+// on the calling thread when parallel_for is NULL
+void pf_set_parallel_for(pf_t * pf, pf_parallel_for_fn_t parallel_for, void * parallel_data);
+
 
 // Display the sample set
 void pf_draw_samples(pf_t * pf, struct _rtk_fig_t * fig, int max_samples);
@@ -33,45 +33,46 @@
 #endif
 
 
-// Info for a node in the tree
+// Info for a bin of the histogram
 typedef struct pf_kdtree_node
 {
-  // Depth in the tree
-  int leaf, depth;
-
-  // Pivot dimension and value
-  int pivot_dim;
-  double pivot_value;
-
   // The key for this node
   int key[3];
 
   // The value for this node
   double value;
 
-  // The cluster label (leaf nodes)
+  // The cluster label
   int cluster;
 
-  // Child nodes
-  struct pf_kdtree_node * children[2];
+  // The slot of the hash table holding this node
+  int slot;
 } pf_kdtree_node_t;
 
 
-// A kd tree
+// The histogram of the samples over (x, y, theta) bins. Despite the name it
+// is an open addressing hash table of the bins rather than a kd tree, so an
+// insert or lookup is a hash and a few probes of a flat array that is reused
+// from one resampling to the next.
 typedef struct
 {
   // Cell size
   double size[3];
 
-  // The root node of the tree
-  pf_kdtree_node_t * root;
+  // The hash table, with the index of the node in each slot or -1 when empty.
+  // The size is a power of two at least twice the node_max_count.
+  int table_size;
+  int * table;
 
   // The number of nodes in the tree
   int node_count, node_max_count;
   pf_kdtree_node_t * nodes;
 
-  // The number of leaf nodes in the tree
+  // The number of leaf nodes in the tree, which is every node
   int leaf_count;
+
+  // Union-find parents of the nodes, used while clustering
+  int * parents;
 } pf_kdtree_t;
 
 
@@ -18,10 +18,14 @@
 #ifndef NAV2_AMCL__SENSORS__LASER__LASER_HPP_
 #define NAV2_AMCL__SENSORS__LASER__LASER_HPP_
 
+#include <functional>
+#include <memory>
 #include <string>
+#include <vector>
 #include "nav2_amcl/pf/pf.hpp"
 #include "nav2_amcl/pf/pf_pdf.hpp"
 #include "nav2_amcl/map/map.hpp"
+#include "nav2_util/thread_pool.hpp"
 
 namespace nav2_amcl
 {
@@ -36,32 +40,121 @@ public:
   virtual ~Laser();
   virtual bool sensorUpdate(pf_t * pf, LaserData * data) = 0;
   void SetLaserPose(pf_vector_t & laser_pose);
+  const pf_vector_t & getLaserPose() const {return laser_pose_;}
+  void setMaxBeams(int max_beams) {max_beams_ = max_beams;}
+
+  // Weighs the samples in parallel on the given pool, or on the calling thread when it is null
+  void setThreadPool(std::shared_ptr<nav2_util::ThreadPool> pool);
+
+  // Sizes the per beam scratch of beam skipping for max_samples samples of up
+  // to the max beams, so updates with no more than those never allocate it
+  void reserveTempData(int max_samples) {reallocTempData(max_samples, max_beams_);}
+
+  // Refines pose, the robot pose in the map the scan was taken at, with up to
+  // iterations Gauss-Newton steps pulling the beam end points onto the
+  // obstacles of the likelihood field. Returns false and leaves pose alone
+  // when the map has no likelihood field or the match moved further than the
+  // field reaches, where it can't be told from a wrong match.
+  bool refinePose(LaserData * data, pf_vector_t & pose, int iterations);
 
 protected:
+  // The samples are weighed in chunks of this many consecutive samples
+  static const int sample_chunk_size = 64;
+
+  // Calls weigh(chunk, begin, end) for every chunk of [0, sample_count), in
+  // parallel when there is a thread pool, and returns the sum of the weights
+  // they return, always added in chunk order so the result doesn't depend on
+  // the number of threads
+  double weighSamples(
+    int sample_count,
+    const std::function<double(int chunk, int begin, int end)> & weigh);
+
+  static int sampleChunks(int sample_count)
+  {
+    return (sample_count + sample_chunk_size - 1) / sample_chunk_size;
+  }
+
+  // Fills the beam_* arrays with every step-th beam of the scan that is below
+  // the max range, as the beam end point in map cells in the base frame, so
+  // weighing a particle only takes a rotation per beam instead of a cos and sin
+  void prepareBeams(LaserData * data, int step);
+
+  // The sum over the beams of the squared distance from their end point to
+  // the nearest obstacle, capped at max_occ_dist, for the robot at pose.
+  // With hessian and gradient, also adds up the Gauss-Newton normal equations
+  // of the beams that end within max_occ_dist of an obstacle.
+  double matchCost(const pf_vector_t & pose, double hessian[3][3], double gradient[3]) const;
+
+  // Fills hit_prob_ from the current map, z_hit_ and sigma_hit_
+  void buildHitProbTable();
+
+  // z_hit * exp(-(z * z) / (2 * sigma_hit * sigma_hit)) for the distance z
+  // to the nearest obstacle of a cell, looked up by its stored occ_dist
+  inline double hitProb(uint8_t occ_dist) const
+  {
+    return hit_prob_[occ_dist];
+  }
+
+
   double z_hit_;
   double z_rand_;
   double sigma_hit_;
 
+  // Grows temp_obs_ to at least max_samples rows of max_obs observations
   void reallocTempData(int max_samples, int max_obs);
+  inline double & tempObs(int sample, int beam) {return temp_obs_[sample * max_obs_ + beam];}
+
   map_t * map_;
   pf_vector_t laser_pose_;
   int max_beams_;
   int max_samples_;
   int max_obs_;
-  double ** temp_obs_;
+  std::vector<double> temp_obs_;
+  std::shared_ptr<nav2_util::ThreadPool> pool_;
+  std::vector<double> chunk_weights_;  // scratch of weighSamples()
+
+  std::vector<pf_real_t> beam_x_;
+  std::vector<pf_real_t> beam_y_;
+  std::vector<int> beam_index_;  // the beam's position among the step-th beams
+  double hit_prob_[MAP_OCC_DIST_MAX + 1];
+  double max_hit_prob_;
 };
 
 class LaserData
 {
 public:
   Laser * laser;
-  LaserData() {ranges = NULL;}
-  virtual ~LaserData() {delete[] ranges;}
+  LaserData() {ranges = NULL; origins = NULL; capacity_ = 0; origins_storage_ = NULL;}
+  virtual ~LaserData() {delete[] ranges; delete[] origins_storage_;}
+  LaserData(const LaserData &) = delete;
+  LaserData & operator=(const LaserData &) = delete;
+
+  // Sets range_count and makes room for as many ranges, and origins when
+  // with_origins is set, only allocating when the data never had that many
+  void resize(int count, bool with_origins)
+  {
+    if (count > capacity_) {
+      delete[] ranges;
+      delete[] origins_storage_;
+      capacity_ = count;
+      ranges = new double[capacity_][2];
+      origins_storage_ = new double[capacity_][2];
+    }
+    range_count = count;
+    origins = with_origins ? origins_storage_ : NULL;
+  }
 
 public:
   int range_count;
   double range_max;
   double(*ranges)[2];
+  // The position in the base frame of the sensor each beam came from, for
+  // scans fused from several lasers, or NULL when they all came from laser
+  double(*origins)[2];
+
+private:
+  int capacity_;
+  double(*origins_storage_)[2];
 };
 
 
@@ -109,6 +202,11 @@ private:
   double beam_skip_distance_;
   double beam_skip_threshold_;
   double beam_skip_error_threshold_;
+
+  // Scratch of sensorFunction(), kept to not allocate it per update
+  std::vector<int> chunk_obs_count_;
+  std::vector<int> obs_count_;
+  std::vector<char> obs_mask_;
 };
 
 }  // namespace nav2_amcl
@@ -23,6 +23,9 @@
 #include "nav2_amcl/amcl_node.hpp"
 
 #include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
 #include <memory>
 #include <string>
 #include <utility>
@@ -31,8 +34,10 @@
 #include "message_filters/subscriber.h"
 #include "nav2_amcl/angleutils.hpp"
 #include "nav2_util/geometry_utils.hpp"
+#include "nav2_util/node_utils.hpp"
 #include "nav2_amcl/pf/pf.hpp"
 #include "nav2_util/string_utils.hpp"
+#include "nav2_util/trace.hpp"
 #include "nav2_amcl/sensors/laser/laser.hpp"
 #include "tf2/convert.h"
 #include "tf2_geometry_msgs/tf2_geometry_msgs.h"
@@ -55,8 +60,10 @@ namespace nav2_amcl
 {
 using nav2_util::geometry_utils::orientationAroundZAxis;
 
-AmclNode::AmclNode()
-: nav2_util::LifecycleNode("amcl", "", true)
+// The laser scans, which update the filter, arrive on the local rclcpp node, so it's spun on
+// a thread of its own rather than holding up the helper nodes sharing the executor pool
+AmclNode::AmclNode(const rclcpp::NodeOptions & options)
+: nav2_util::LifecycleNode("amcl", "", true, options, true)
 {
   RCLCPP_INFO(get_logger(), "Creating");
 
@@ -87,20 +94,58 @@ AmclNode::AmclNode()
   add_parameter("beam_skip_distance", rclcpp::ParameterValue(0.5));
   add_parameter("beam_skip_error_threshold", rclcpp::ParameterValue(0.9));
   add_parameter("beam_skip_threshold", rclcpp::ParameterValue(0.3));
+
+  add_parameter(
+    "beam_range_table_angles", rclcpp::ParameterValue(0),
+    "Number of bearings over half a turn of the range table the beam model looks ranges up "
+    "in, instead of ray tracing them. The table is cached with the likelihood fields.",
+    "0 disables the table");
+
+  add_parameter(
+    "beam_outlier_pruning", rclcpp::ParameterValue(false),
+    "Whether to drop the beams of a converged filter that end well short of the map from the "
+    "last pose, as dynamic obstacles, before the remaining ones are subsampled");
+
+  add_parameter(
+    "beam_outlier_distance", rclcpp::ParameterValue(0.5),
+    "How much shorter than the map a beam must be to be dropped by beam_outlier_pruning");
+
   add_parameter("do_beamskip", rclcpp::ParameterValue(false));
 
   add_parameter(
     "global_frame_id", rclcpp::ParameterValue(std::string("map")),
     "The name of the coordinate frame published by the localization system");
 
+  add_parameter(
+    "global_localization_hypotheses", rclcpp::ParameterValue(8),
+    "How many of the best poses found by a global localization search to start the "
+    "particles around");
+
+  add_parameter(
+    "global_localization_search", rclcpp::ParameterValue(false),
+    "Whether global localization searches the map with the next scan for the poses that best "
+    "fit it, instead of only spreading the particles uniformly over the free space");
+
   add_parameter(
     "lambda_short", rclcpp::ParameterValue(0.1),
     "Exponential decay parameter for z_short part of model");
 
+  add_parameter(
+    "laser_fusion_window", rclcpp::ParameterValue(0.0),
+    "Scans of different lasers taken within this many seconds of each other are fused "
+    "into a single sensor update",
+    "0.0 weighs the particles with each scan on its own");
+
   add_parameter(
     "laser_likelihood_max_dist", rclcpp::ParameterValue(2.0),
     "Maximum distance to do obstacle inflation on map, for use in likelihood_field model");
 
+  add_parameter(
+    "likelihood_field_cache_dir", rclcpp::ParameterValue(std::string("")),
+    "Directory in which the likelihood field of each map is cached, so it is only computed "
+    "once per map and only the tiles of it around the particles are kept in memory",
+    "An empty string disables the cache");
+
   add_parameter(
     "laser_max_range", rclcpp::ParameterValue(100.0),
     "Maximum scan range to be considered",
@@ -137,6 +182,12 @@ AmclNode::AmclNode()
     "initial_pose.yaw", rclcpp::ParameterValue(0.0),
     "Yaw of the initial robot pose in the map frame");
 
+  add_parameter(
+    "map_cache_size", rclcpp::ParameterValue(0),
+    "Maps kept besides the current one, with their likelihood fields, range tables and free "
+    "space indices, so switching back to one, e.g. between the floors of a map set, is instant",
+    "0 frees each map as the next one comes in");
+
   add_parameter(
     "max_beams", rclcpp::ParameterValue(60),
     "How many evenly-spaced beams in each scan to be used when updating the filter");
@@ -145,6 +196,11 @@ AmclNode::AmclNode()
     "max_particles", rclcpp::ParameterValue(2000),
     "Minimum allowed number of particles");
 
+  add_parameter(
+    "max_particlecloud_poses", rclcpp::ParameterValue(0),
+    "How many of the particles, the most likely first, to publish on the particlecloud topic",
+    "0 publishes all of them");
+
   add_parameter(
     "min_particles", rclcpp::ParameterValue(500),
     "Maximum allowed number of particles");
@@ -156,6 +212,11 @@ AmclNode::AmclNode()
   add_parameter("pf_err", rclcpp::ParameterValue(0.05));
   add_parameter("pf_z", rclcpp::ParameterValue(0.99));
 
+  add_parameter(
+    "pipelined_scan_processing", rclcpp::ParameterValue(false),
+    "Whether to run the filter on a thread of its own, always on the newest scan, while the "
+    "next scan is prepared and the results are published on another thread");
+
   add_parameter(
     "recovery_alpha_fast", rclcpp::ParameterValue(0.0),
     "Exponential decay rate for the fast average weight filter, used in deciding when to recover "
@@ -172,6 +233,11 @@ AmclNode::AmclNode()
     "resample_interval", rclcpp::ParameterValue(1),
     "Number of filter updates required before resampling");
 
+  add_parameter(
+    "resample_method", rclcpp::ParameterValue(std::string("multinomial")),
+    "How to draw the resampled particles, either multinomial or systematic",
+    "systematic is the low-variance sampler");
+
   add_parameter("robot_model_type", rclcpp::ParameterValue(std::string("differential")));
 
   add_parameter(
@@ -181,6 +247,18 @@ AmclNode::AmclNode()
     "on subsequent runs to initialize the filter",
     "-1.0 to disable");
 
+  add_parameter(
+    "scan_match_iterations", rclcpp::ParameterValue(0),
+    "Gauss-Newton steps matching each scan to the likelihood field, from the mean of the best "
+    "cluster, to refine the pose that is published and broadcast. This keeps the pose steady "
+    "with fewer particles",
+    "0 publishes the cluster mean as it is");
+
+  add_parameter(
+    "sensor_update_threads", rclcpp::ParameterValue(1),
+    "Number of threads moving and weighing the particles for each scan",
+    "0 will use one thread per core");
+
   add_parameter("sigma_hit", rclcpp::ParameterValue(0.2));
 
   add_parameter(
@@ -188,11 +266,23 @@ AmclNode::AmclNode()
     "Set this to false to prevent amcl from publishing the transform between the global frame and "
     "the odometry frame");
 
+  add_parameter(
+    "tf_publish_rate", rclcpp::ParameterValue(0.0),
+    "Rate in Hz at which a thread of its own publishes the latest transform between the global "
+    "frame and the odometry frame, post-dated by transform_tolerance from when it is sent",
+    "0.0 only publishes it as each scan is processed");
+
   add_parameter(
     "transform_tolerance", rclcpp::ParameterValue(1.0),
     "Time with which to post-date the transform that is published, to indicate that this transform "
     "is valid into the future");
 
+  add_parameter(
+    "update_latency_target", rclcpp::ParameterValue(0.0),
+    "Wall time in seconds a filter update should take. Particles, beams and then updates are "
+    "dropped until it does",
+    "0.0 always uses up to max_particles particles and max_beams beams");
+
   add_parameter(
     "update_min_a", rclcpp::ParameterValue(0.2),
     "Rotational movement required before performing a filter update");
@@ -216,6 +306,8 @@ AmclNode::AmclNode()
 AmclNode::~AmclNode()
 {
   RCLCPP_INFO(get_logger(), "Destroying");
+  stopPipeline();
+  stopTfThread();
 }
 
 nav2_util::CallbackReturn
@@ -269,6 +361,13 @@ AmclNode::on_activate(const rclcpp_lifecycle::State & /*state*/)
 
   first_pose_sent_ = false;
 
+  if (pipelined_scan_processing_) {
+    startPipeline();
+  }
+  if (tf_broadcast_ && tf_publish_rate_ > 0.0) {
+    startTfThread();
+  }
+
   // Keep track of whether we're in the active state. We won't
   // process incoming callbacks until we are
   active_ = true;
@@ -297,6 +396,8 @@ AmclNode::on_deactivate(const rclcpp_lifecycle::State & /*state*/)
   RCLCPP_INFO(get_logger(), "Deactivating");
 
   active_ = false;
+  stopPipeline();
+  stopTfThread();
 
   // Lifecycle publishers must be explicitly deactivated
   pose_pub_->on_deactivate();
@@ -322,8 +423,11 @@ AmclNode::on_cleanup(const rclcpp_lifecycle::State & /*state*/)
   // Map
   map_free(map_);
   map_ = nullptr;
+  for (auto & cached : map_cache_) {
+    map_free(cached.second);
+  }
+  map_cache_.clear();
   first_map_received_ = false;
-  free_space_indices.resize(0);
 
   // Transforms
   tf_broadcaster_.reset();
@@ -331,6 +435,8 @@ AmclNode::on_cleanup(const rclcpp_lifecycle::State & /*state*/)
   tf_buffer_.reset();
 
   // PubSub
+  parameter_event_sub_.reset();
+  parameters_client_.reset();
   pose_pub_.reset();
   particlecloud_pub_.reset();
 
@@ -345,6 +451,7 @@ AmclNode::on_cleanup(const rclcpp_lifecycle::State & /*state*/)
   lasers_.clear();
   lasers_update_.clear();
   frame_to_laser_.clear();
+  sensor_pool_.reset();
   force_update_ = true;
 
   if (set_initial_pose_) {
@@ -413,10 +520,6 @@ AmclNode::checkElapsedTime(std::chrono::seconds check_interval, rclcpp::Time las
   return false;
 }
 
-#if NEW_UNIFORM_SAMPLING
-std::vector<std::pair<int, int>> AmclNode::free_space_indices;
-#endif
-
 bool
 AmclNode::getOdomPose(
   geometry_msgs::msg::PoseStamped & odom_pose,
@@ -455,11 +558,13 @@ AmclNode::uniformPoseGenerator(void * arg)
   map_t * map = reinterpret_cast<map_t *>(arg);
 
 #if NEW_UNIFORM_SAMPLING
-  unsigned int rand_index = drand48() * free_space_indices.size();
-  std::pair<int, int> free_point = free_space_indices[rand_index];
+  // A map without free cells leaves nowhere better than its middle
+  int i = map->size_x / 2;
+  int j = map->size_y / 2;
+  map_sample_free_cell(map, drand48(), &i, &j);
   pf_vector_t p;
-  p.v[0] = MAP_WXGX(map, free_point.first);
-  p.v[1] = MAP_WYGY(map, free_point.second);
+  p.v[0] = MAP_WXGX(map, i);
+  p.v[1] = MAP_WYGY(map, j);
   p.v[2] = drand48() * 2 * M_PI - M_PI;
 #else
   double min_x, max_x, min_y, max_y;
@@ -480,7 +585,7 @@ AmclNode::uniformPoseGenerator(void * arg)
     int i, j;
     i = MAP_GXWX(map, p.v[0]);
     j = MAP_GYWY(map, p.v[1]);
-    if (MAP_VALID(map, i, j) && (map->cells[MAP_INDEX(map, i, j)].occ_state == -1)) {
+    if (MAP_VALID(map, i, j) && (map->occ_state[MAP_INDEX(map, i, j)] == -1)) {
       break;
     }
   }
@@ -494,6 +599,8 @@ AmclNode::globalLocalizationCallback(
   const std::shared_ptr<std_srvs::srv::Empty::Request>/*req*/,
   std::shared_ptr<std_srvs::srv::Empty::Response>/*res*/)
 {
+  std::lock_guard<std::recursive_mutex> cfl(configuration_mutex_);
+
   RCLCPP_INFO(get_logger(), "Initializing with uniform distribution");
 
   pf_init_model(
@@ -502,6 +609,95 @@ AmclNode::globalLocalizationCallback(
   RCLCPP_INFO(get_logger(), "Global initialisation done!");
   initial_pose_is_known_ = true;
   pf_init_ = false;
+
+  // The uniform particles stand in until the next scan has been searched with
+  if (global_localization_search_) {
+    global_search_pending_ = true;
+  }
+}
+
+pf_vector_t
+AmclNode::hypothesisPoseGenerator(void * arg)
+{
+  const SearchHypotheses * hypotheses = reinterpret_cast<const SearchHypotheses *>(arg);
+  const map_pose_score_t & pose =
+    hypotheses->poses[static_cast<int>(drand48() * hypotheses->poses.size())];
+
+  pf_vector_t p;
+  p.v[0] = pose.x + pf_ran_gaussian(hypotheses->position_sigma);
+  p.v[1] = pose.y + pf_ran_gaussian(hypotheses->position_sigma);
+  p.v[2] = angleutils::normalize(pose.a + pf_ran_gaussian(hypotheses->angle_sigma));
+  return p;
+}
+
+bool
+AmclNode::searchGlobalPose(int laser_index, const nav2_amcl::LaserData & ldata)
+{
+  // Hypotheses closer than this are taken to be the same place
+  const double separation = 1.0;
+
+  if (map_->max_occ_dist < 0) {
+    map_update_cspace(map_, laser_likelihood_max_dist_);
+  }
+
+  // The end points of up to max_beams_ evenly spaced beams, in the base frame
+  std::vector<double> points;
+  double max_distance = 0.0;
+  int step = std::max(1, ldata.range_count / std::max(1, max_beams_));
+  for (int i = 0; i < ldata.range_count; i += step) {
+    double range = ldata.ranges[i][0];
+    if (!(range < ldata.range_max)) {
+      continue;
+    }
+    pf_vector_t origin = lasers_[laser_index]->getLaserPose();
+    if (ldata.origins) {
+      origin.v[0] = ldata.origins[i][0];
+      origin.v[1] = ldata.origins[i][1];
+    }
+    double x = origin.v[0] + range * cos(ldata.ranges[i][1]);
+    double y = origin.v[1] + range * sin(ldata.ranges[i][1]);
+    points.push_back(x);
+    points.push_back(y);
+    max_distance = std::max(max_distance, hypot(x, y));
+  }
+  if (points.empty()) {
+    RCLCPP_WARN(get_logger(), "No beams to search for the global pose with");
+    return false;
+  }
+
+  // The hit part of the likelihood field model, falling with the distance
+  double dist_score[MAP_OCC_DIST_MAX + 1];
+  for (int k = 0; k <= MAP_OCC_DIST_MAX; k++) {
+    double z = k * map_->max_occ_dist / MAP_OCC_DIST_MAX;
+    dist_score[k] = exp(-(z * z) / (2 * sigma_hit_ * sigma_hit_));
+  }
+
+  // Fine enough that turning moves the farthest point by about a cell
+  double angular_step = std::max(0.01, std::min(0.1, map_->scale / max_distance));
+
+  SearchHypotheses hypotheses;
+  hypotheses.poses.resize(std::max(1, global_localization_hypotheses_));
+  int found = map_search_poses(
+    map_, points.data(), static_cast<int>(points.size() / 2), dist_score, angular_step,
+    separation, hypotheses.poses.data(), static_cast<int>(hypotheses.poses.size()));
+  if (found == 0) {
+    RCLCPP_WARN(get_logger(), "The global localization search found no pose");
+    return false;
+  }
+  hypotheses.poses.resize(found);
+  hypotheses.position_sigma = map_->scale;
+  hypotheses.angle_sigma = angular_step;
+
+  RCLCPP_INFO(
+    get_logger(), "Best of %d global pose hypotheses: %.3f %.3f %.3f, %.0f%% of the beams",
+    found, hypotheses.poses[0].x, hypotheses.poses[0].y, hypotheses.poses[0].a,
+    100.0 * hypotheses.poses[0].score / (points.size() / 2));
+
+  pf_init_model(
+    pf_, (pf_init_model_fn_t)AmclNode::hypothesisPoseGenerator,
+    reinterpret_cast<void *>(&hypotheses));
+  pf_init_ = false;
+  return true;
 }
 
 // force nomotion updates (amcl updating without requiring motion)
@@ -551,6 +747,8 @@ AmclNode::initialPoseReceived(geometry_msgs::msg::PoseWithCovarianceStamped::Sha
 void
 AmclNode::handleInitialPose(geometry_msgs::msg::PoseWithCovarianceStamped & msg)
 {
+  std::lock_guard<std::recursive_mutex> cfl(configuration_mutex_);
+
   // In case the client sent us a pose estimate in the past, integrate the
   // intervening odometric change.
   geometry_msgs::msg::TransformStamped tx_odom;
@@ -626,8 +824,130 @@ AmclNode::laserReceived(sensor_msgs::msg::LaserScan::ConstSharedPtr laser_scan)
     return;
   }
 
-  std::string laser_scan_frame_id = nav2_util::strip_leading_slash(laser_scan->header.frame_id);
   last_laser_received_ts_ = now();
+
+  std::shared_ptr<PreparedScan> prepared = acquireScan();
+  if (!prepareScan(laser_scan, *prepared)) {
+    return;
+  }
+
+  if (!pipelined_scan_processing_) {
+    processScan(prepared);
+    return;
+  }
+
+  // The filter only ever wants the newest scan, so one it hasn't started on
+  // yet is replaced
+  {
+    std::lock_guard<std::mutex> lock(pipeline_mutex_);
+    if (pending_scan_) {
+      RCLCPP_DEBUG(get_logger(), "Dropping a scan the filter didn't get to");
+    }
+    pending_scan_ = prepared;
+  }
+  scan_ready_.notify_one();
+}
+
+std::shared_ptr<AmclNode::PreparedScan>
+AmclNode::acquireScan()
+{
+  // Scans only stay referenced from the pipeline and the fusion slots, so a
+  // handful of them gets recycled with their range storage
+  std::lock_guard<std::mutex> lock(scan_pool_mutex_);
+  for (const auto & scan : scan_pool_) {
+    if (scan.use_count() == 1) {
+      scan->laser_scan.reset();
+      return scan;
+    }
+  }
+  scan_pool_.push_back(std::make_shared<PreparedScan>());
+  return scan_pool_.back();
+}
+
+bool
+AmclNode::prepareScan(
+  const sensor_msgs::msg::LaserScan::ConstSharedPtr & laser_scan, PreparedScan & prepared)
+{
+  prepared.laser_scan = laser_scan;
+
+  // Where was the robot when this scan was taken?
+  if (!getOdomPose(
+      latest_odom_pose_, prepared.pose.v[0], prepared.pose.v[1], prepared.pose.v[2],
+      laser_scan->header.stamp, base_frame_id_))
+  {
+    RCLCPP_ERROR(get_logger(), "Couldn't determine robot's pose associated with laser scan");
+    return false;
+  }
+
+  nav2_amcl::LaserData & ldata = prepared.ldata;
+  ldata.resize(laser_scan->ranges.size(), false);
+  // To account for lasers that are mounted upside-down, we determine the
+  // min, max, and increment angles of the laser in the base frame.
+  //
+  // Construct min and max angles of laser, in the base_link frame.
+  // Here we set the roll pich yaw of the lasers.  We assume roll and pich are zero.
+  geometry_msgs::msg::QuaternionStamped min_q, inc_q;
+  min_q.header.stamp = laser_scan->header.stamp;
+  min_q.header.frame_id = nav2_util::strip_leading_slash(laser_scan->header.frame_id);
+  min_q.quaternion = orientationAroundZAxis(laser_scan->angle_min);
+
+  inc_q.header = min_q.header;
+  inc_q.quaternion = orientationAroundZAxis(laser_scan->angle_min + laser_scan->angle_increment);
+  try {
+    tf_buffer_->transform(min_q, min_q, base_frame_id_);
+    tf_buffer_->transform(inc_q, inc_q, base_frame_id_);
+  } catch (tf2::TransformException & e) {
+    RCLCPP_WARN(
+      get_logger(), "Unable to transform min/max laser angles into base frame: %s",
+      e.what());
+    return false;
+  }
+  double angle_min = tf2::getYaw(min_q.quaternion);
+  double angle_increment = tf2::getYaw(inc_q.quaternion) - angle_min;
+
+  // wrapping angle to [-pi .. pi]
+  angle_increment = fmod(angle_increment + 5 * M_PI, 2 * M_PI) - M_PI;
+
+  RCLCPP_DEBUG(
+    get_logger(), "Laser %s angles in base frame: min: %.3f inc: %.3f",
+    min_q.header.frame_id.c_str(), angle_min, angle_increment);
+
+  // Apply range min/max thresholds, if the user supplied them
+  if (laser_max_range_ > 0.0) {
+    ldata.range_max = std::min(laser_scan->range_max, static_cast<float>(laser_max_range_));
+  } else {
+    ldata.range_max = laser_scan->range_max;
+  }
+  double range_min;
+  if (laser_min_range_ > 0.0) {
+    range_min = std::max(laser_scan->range_min, static_cast<float>(laser_min_range_));
+  } else {
+    range_min = laser_scan->range_min;
+  }
+
+  for (int i = 0; i < ldata.range_count; i++) {
+    // amcl doesn't (yet) have a concept of min range.  So we'll map short
+    // readings to max range.
+    if (laser_scan->ranges[i] <= range_min) {
+      ldata.ranges[i][0] = ldata.range_max;
+    } else {
+      ldata.ranges[i][0] = laser_scan->ranges[i];
+    }
+    // Compute bearing
+    ldata.ranges[i][1] = angle_min +
+      (i * angle_increment);
+  }
+  return true;
+}
+
+void
+AmclNode::processScan(std::shared_ptr<PreparedScan> prepared)
+{
+  // The filter thread and the other callbacks take turns on the filter and the map
+  std::lock_guard<std::recursive_mutex> cfl(configuration_mutex_);
+
+  sensor_msgs::msg::LaserScan::ConstSharedPtr laser_scan = prepared->laser_scan;
+  std::string laser_scan_frame_id = nav2_util::strip_leading_slash(laser_scan->header.frame_id);
   int laser_index = -1;
   geometry_msgs::msg::PoseStamped laser_pose;
 
@@ -641,14 +961,22 @@ AmclNode::laserReceived(sensor_msgs::msg::LaserScan::ConstSharedPtr laser_scan)
     laser_index = frame_to_laser_[laser_scan->header.frame_id];
   }
 
-  // Where was the robot when this scan was taken?
-  pf_vector_t pose;
-  if (!getOdomPose(
-      latest_odom_pose_, pose.v[0], pose.v[1], pose.v[2],
-      laser_scan->header.stamp, base_frame_id_))
-  {
-    RCLCPP_ERROR(get_logger(), "Couldn't determine robot's pose associated with laser scan");
-    return;
+  // With several lasers, their scans are gathered and weighed as one
+  bool fused = laser_fusion_window_ > 0.0 && lasers_.size() > 1;
+  if (fused) {
+    prepared = fuseScans(laser_index, prepared);
+    if (!prepared) {
+      return;  // waiting for the other lasers
+    }
+    laser_index = 0;
+    laser_scan = prepared->laser_scan;
+  }
+  const pf_vector_t & pose = prepared->pose;
+
+  // A global localization waits for a scan to search the map with
+  if (global_search_pending_) {
+    global_search_pending_ = false;
+    searchGlobalPose(laser_index, prepared->ldata);
   }
 
   pf_vector_t delta = pf_vector_zero();
@@ -671,7 +999,13 @@ AmclNode::laserReceived(sensor_msgs::msg::LaserScan::ConstSharedPtr laser_scan)
         lasers_update_[i] = true;
       }
     }
+    // Short of compute, the filter sits some of its updates out
+    if (lasers_update_[laser_index] && budget_skipped_ < budget_skip_) {
+      budget_skipped_++;
+      lasers_update_[laser_index] = false;
+    }
     if (lasers_update_[laser_index]) {
+      NAV2_TRACE_SCOPE("amcl_update_action");
       motion_model_->odometryUpdate(pf_, pose, delta);
     }
     force_update_ = false;
@@ -681,14 +1015,28 @@ AmclNode::laserReceived(sensor_msgs::msg::LaserScan::ConstSharedPtr laser_scan)
 
   // If the robot has moved, update the filter
   if (lasers_update_[laser_index]) {
-    updateFilter(laser_index, laser_scan, pose);
+    auto update_start = std::chrono::steady_clock::now();
+    {
+      NAV2_TRACE_SCOPE("amcl_update_sensor");
+      updateFilter(laser_index, prepared->ldata, pose);
+    }
+    if (fused) {
+      std::fill(lasers_update_.begin(), lasers_update_.end(), false);
+    }
 
     // Resample the particles
     if (!(++resample_count_ % resample_interval_)) {
+      NAV2_TRACE_SCOPE("amcl_update_resample");
       pf_update_resample(pf_);
       resampled = true;
     }
 
+    if (update_latency_target_ > 0.0) {
+      budget_skipped_ = 0;
+      adjustBudget(
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - update_start).count());
+    }
+
     pf_sample_set_t * set = pf_->sets + pf_->current_set;
     RCLCPP_DEBUG(get_logger(), "Num samples: %d\n", set->sample_count);
 
@@ -701,6 +1049,13 @@ AmclNode::laserReceived(sensor_msgs::msg::LaserScan::ConstSharedPtr laser_scan)
     std::vector<amcl_hyp_t> hyps;
     int max_weight_hyp = -1;
     if (getMaxWeightHyp(hyps, max_weight_hyps, max_weight_hyp)) {
+      if (scan_match_iterations_ > 0) {
+        NAV2_TRACE_SCOPE("amcl_scan_match");
+        lasers_[laser_index]->refinePose(
+          &prepared->ldata, hyps[max_weight_hyp].pf_pose_mean, scan_match_iterations_);
+      }
+      best_hyp_pose_ = hyps[max_weight_hyp].pf_pose_mean;
+      best_hyp_odom_pose_ = pose;
       publishAmclPose(laser_scan, hyps, max_weight_hyp);
       calculateMaptoOdomTransform(laser_scan, hyps, max_weight_hyp);
 
@@ -726,6 +1081,213 @@ AmclNode::laserReceived(sensor_msgs::msg::LaserScan::ConstSharedPtr laser_scan)
   }
 }
 
+std::shared_ptr<AmclNode::PreparedScan>
+AmclNode::fuseScans(int laser_index, const std::shared_ptr<PreparedScan> & prepared)
+{
+  fusion_scans_.resize(lasers_.size());
+
+  // Scans too old to go with this one are dropped
+  rclcpp::Time stamp(prepared->laser_scan->header.stamp);
+  for (auto & scan : fusion_scans_) {
+    if (scan && (stamp - rclcpp::Time(scan->laser_scan->header.stamp)).seconds() >
+      laser_fusion_window_)
+    {
+      scan.reset();
+    }
+  }
+
+  // A laser that comes round again before the others have all reported ends
+  // the set, so a laser that stops publishing doesn't hold up the rest
+  std::shared_ptr<PreparedScan> next;
+  if (fusion_scans_[laser_index]) {
+    next = prepared;
+  } else {
+    fusion_scans_[laser_index] = prepared;
+    for (const auto & scan : fusion_scans_) {
+      if (!scan) {
+        return nullptr;
+      }
+    }
+  }
+
+  // The fused scan takes the header and odometry pose of the newest scan
+  std::shared_ptr<PreparedScan> fused = acquireScan();
+  nav2_amcl::LaserData & ldata = fused->ldata;
+  ldata.range_count = 0;
+  ldata.range_max = 0.0;
+  for (const auto & scan : fusion_scans_) {
+    if (!scan) {
+      continue;
+    }
+    if (!fused->laser_scan || rclcpp::Time(scan->laser_scan->header.stamp) >
+      rclcpp::Time(fused->laser_scan->header.stamp))
+    {
+      fused->laser_scan = scan->laser_scan;
+      fused->pose = scan->pose;
+    }
+    ldata.range_count += scan->ldata.range_count;
+    ldata.range_max = std::max(ldata.range_max, scan->ldata.range_max);
+  }
+
+  ldata.resize(ldata.range_count, true);
+  int i = 0;
+  for (size_t k = 0; k < fusion_scans_.size(); k++) {
+    if (!fusion_scans_[k]) {
+      continue;
+    }
+    const nav2_amcl::LaserData & scan = fusion_scans_[k]->ldata;
+    pf_vector_t origin = lasers_[k]->getLaserPose();
+    for (int j = 0; j < scan.range_count; j++, i++) {
+      // Max range readings of each laser stay max range readings of the fused scan
+      ldata.ranges[i][0] = scan.ranges[j][0] >= scan.range_max ? ldata.range_max :
+        scan.ranges[j][0];
+      ldata.ranges[i][1] = scan.ranges[j][1];
+      ldata.origins[i][0] = origin.v[0];
+      ldata.origins[i][1] = origin.v[1];
+    }
+  }
+
+  std::fill(fusion_scans_.begin(), fusion_scans_.end(), nullptr);
+  if (next) {
+    fusion_scans_[laser_index] = next;
+  }
+  return fused;
+}
+
+void
+AmclNode::startPipeline()
+{
+  pipeline_running_ = true;
+  filter_thread_ = std::thread(&AmclNode::runFilterThread, this);
+  output_thread_ = std::thread(&AmclNode::runOutputThread, this);
+}
+
+void
+AmclNode::stopPipeline()
+{
+  {
+    std::lock_guard<std::mutex> lock(pipeline_mutex_);
+    if (!pipeline_running_) {
+      return;
+    }
+    pipeline_running_ = false;
+  }
+  scan_ready_.notify_one();
+  output_ready_.notify_one();
+  filter_thread_.join();
+  output_thread_.join();
+
+  // A scan that was still waiting is dropped, its results would be stale by now
+  std::lock_guard<std::mutex> lock(pipeline_mutex_);
+  pending_scan_.reset();
+  pending_output_.clear();
+}
+
+void
+AmclNode::startTfThread()
+{
+  std::lock_guard<std::mutex> lock(tf_mutex_);
+  tf_thread_running_ = true;
+  tf_correction_known_ = false;
+  tf_correction_changed_ = false;
+  tf_thread_ = std::thread(&AmclNode::runTfThread, this);
+}
+
+void
+AmclNode::stopTfThread()
+{
+  {
+    std::lock_guard<std::mutex> lock(tf_mutex_);
+    if (!tf_thread_running_) {
+      return;
+    }
+    tf_thread_running_ = false;
+  }
+  tf_changed_.notify_one();
+  tf_thread_.join();
+}
+
+void
+AmclNode::runTfThread()
+{
+  using std::chrono::steady_clock;
+  const auto period = std::chrono::duration_cast<steady_clock::duration>(
+    std::chrono::duration<double>(1.0 / tf_publish_rate_));
+  auto next = steady_clock::now() + period;
+
+  std::unique_lock<std::mutex> lock(tf_mutex_);
+  while (true) {
+    tf_changed_.wait_until(
+      lock, next, [this] {return tf_correction_changed_ || !tf_thread_running_;});
+    if (!tf_thread_running_) {
+      return;
+    }
+    const auto current = steady_clock::now();
+    if (current >= next) {
+      // a period that was missed is skipped rather than caught up on
+      next = std::max(next + period, current);
+    }
+    tf_correction_changed_ = false;
+    if (!tf_correction_known_) {
+      continue;
+    }
+
+    geometry_msgs::msg::TransformStamped correction = tf_correction_;
+    lock.unlock();
+    correction.header.stamp = tf2_ros::toMsg(
+      tf2::TimePoint(std::chrono::nanoseconds(now().nanoseconds())) + transform_tolerance_);
+    tf_broadcaster_->sendTransform(correction);
+    lock.lock();
+  }
+}
+
+void
+AmclNode::runFilterThread()
+{
+  std::unique_lock<std::mutex> lock(pipeline_mutex_);
+  while (true) {
+    scan_ready_.wait(lock, [this] {return pending_scan_ || !pipeline_running_;});
+    if (!pipeline_running_) {
+      return;
+    }
+    std::shared_ptr<PreparedScan> prepared = std::move(pending_scan_);
+    lock.unlock();
+    processScan(prepared);
+    lock.lock();
+  }
+}
+
+void
+AmclNode::runOutputThread()
+{
+  std::unique_lock<std::mutex> lock(pipeline_mutex_);
+  while (true) {
+    output_ready_.wait(lock, [this] {return !pending_output_.empty() || !pipeline_running_;});
+    if (!pipeline_running_) {
+      return;
+    }
+    std::function<void()> publish = std::move(pending_output_.front());
+    pending_output_.pop_front();
+    lock.unlock();
+    publish();
+    lock.lock();
+  }
+}
+
+void
+AmclNode::publishOutput(std::function<void()> publish)
+{
+  std::unique_lock<std::mutex> lock(pipeline_mutex_);
+  if (!pipeline_running_) {
+    lock.unlock();
+    publish();
+    return;
+  }
+  pending_output_.push_back(std::move(publish));
+  lock.unlock();
+  output_ready_.notify_one();
+}
+
 bool AmclNode::addNewScanner(
   int & laser_index,
   const sensor_msgs::msg::LaserScan::ConstSharedPtr & laser_scan,
@@ -775,76 +1337,120 @@ bool AmclNode::shouldUpdateFilter(const pf_vector_t pose, pf_vector_t & delta)
   return update;
 }
 
+void
+AmclNode::adjustBudget(double update_time)
+{
+  // An update costs about its particles times its beams, so the budget moves
+  // towards the share of that which would have met the target, only half way
+  // each time to ride out the odd slow update
+  double ratio = update_latency_target_ / std::max(update_time, 1e-6);
+  ratio = std::max(0.5, std::min(2.0, ratio));
+  double scale = budget_scale_ * (1.0 + ratio) / 2.0;
+
+  // Particles and beams give way in step, down to min_particles and a
+  // quarter of max_beams
+  double min_particle_scale = static_cast<double>(min_particles_) / max_particles_;
+  double min_beam_scale = 0.25;
+  double min_scale = std::max(min_particle_scale, min_beam_scale);
+  min_scale *= min_scale;
+  budget_scale_ = std::max(min_scale, std::min(1.0, scale));
+
+  pf_->max_samples = std::max(
+    min_particles_, static_cast<int>(max_particles_ * sqrt(budget_scale_)));
+  int beams = std::max(2, static_cast<int>(max_beams_ * sqrt(budget_scale_)));
+  for (auto & laser : lasers_) {
+    laser->setMaxBeams(beams);
+  }
+
+  // Past that only skipping updates is left, as many as it takes for the
+  // time spent per scan to come down to the target
+  if (scale < min_scale) {
+    budget_skip_ = static_cast<int>(ceil(update_time / update_latency_target_)) - 1;
+  } else {
+    budget_skip_ = 0;
+  }
+
+  RCLCPP_DEBUG(
+    get_logger(), "Update took %.1f ms, budget %d particles, %d beams, skipping %d updates",
+    update_time * 1e3, pf_->max_samples, beams, budget_skip_);
+}
+
 bool AmclNode::updateFilter(
-  const int & laser_index,
-  const sensor_msgs::msg::LaserScan::ConstSharedPtr & laser_scan,
+  const int & laser_index, nav2_amcl::LaserData & ldata,
   const pf_vector_t & pose)
 {
-  nav2_amcl::LaserData ldata;
   ldata.laser = lasers_[laser_index];
-  ldata.range_count = laser_scan->ranges.size();
-  // To account for lasers that are mounted upside-down, we determine the
-  // min, max, and increment angles of the laser in the base frame.
-  //
-  // Construct min and max angles of laser, in the base_link frame.
-  // Here we set the roll pich yaw of the lasers.  We assume roll and pich are zero.
-  geometry_msgs::msg::QuaternionStamped min_q, inc_q;
-  min_q.header.stamp = laser_scan->header.stamp;
-  min_q.header.frame_id = nav2_util::strip_leading_slash(laser_scan->header.frame_id);
-  min_q.quaternion = orientationAroundZAxis(laser_scan->angle_min);
 
-  inc_q.header = min_q.header;
-  inc_q.quaternion = orientationAroundZAxis(laser_scan->angle_min + laser_scan->angle_increment);
-  try {
-    tf_buffer_->transform(min_q, min_q, base_frame_id_);
-    tf_buffer_->transform(inc_q, inc_q, base_frame_id_);
-  } catch (tf2::TransformException & e) {
-    RCLCPP_WARN(
-      get_logger(), "Unable to transform min/max laser angles into base frame: %s",
-      e.what());
-    return false;
+  // pf_->converged is only set by a resampling, which also updates best_hyp_pose_
+  if (beam_outlier_pruning_ && pf_->converged) {
+    int pruned = pruneOutlierBeams(ldata, laser_index, pose);
+    RCLCPP_DEBUG(get_logger(), "Dropped %d of the beams as outliers", pruned);
   }
-  double angle_min = tf2::getYaw(min_q.quaternion);
-  double angle_increment = tf2::getYaw(inc_q.quaternion) - angle_min;
 
-  // wrapping angle to [-pi .. pi]
-  angle_increment = fmod(angle_increment + 5 * M_PI, 2 * M_PI) - M_PI;
+  lasers_[laser_index]->sensorUpdate(pf_, reinterpret_cast<nav2_amcl::LaserData *>(&ldata));
+  lasers_update_[laser_index] = false;
+  pf_odom_pose_ = pose;
+  return true;
+}
 
-  RCLCPP_DEBUG(
-    get_logger(), "Laser %d angles in base frame: min: %.3f inc: %.3f", laser_index, angle_min,
-    angle_increment);
+int
+AmclNode::pruneOutlierBeams(
+  nav2_amcl::LaserData & ldata, int laser_index, const pf_vector_t & pose)
+{
+  // Where the laser is now, by the last estimate and the odometry since
+  pf_vector_t robot_pose = pf_vector_coord_add(
+    pf_vector_coord_sub(pose, best_hyp_odom_pose_), best_hyp_pose_);
+  pf_vector_t laser_pose = pf_vector_coord_add(
+    lasers_[laser_index]->getLaserPose(), robot_pose);
+
+  std::vector<bool> & outlier = beam_outliers_;
+  outlier.assign(ldata.range_count, false);
+  int outlier_count = 0;
+  int valid_count = 0;
+  for (int i = 0; i < ldata.range_count; i++) {
+    double obs_range = ldata.ranges[i][0];
+    if (!(obs_range < ldata.range_max)) {
+      continue;
+    }
+    valid_count++;
+
+    // Beams fused from several lasers each start at their own sensor
+    if (ldata.origins) {
+      pf_vector_t origin = pf_vector_zero();
+      origin.v[0] = ldata.origins[i][0];
+      origin.v[1] = ldata.origins[i][1];
+      laser_pose = pf_vector_coord_add(origin, robot_pose);
+    }
 
-  // Apply range min/max thresholds, if the user supplied them
-  if (laser_max_range_ > 0.0) {
-    ldata.range_max = std::min(laser_scan->range_max, static_cast<float>(laser_max_range_));
-  } else {
-    ldata.range_max = laser_scan->range_max;
+    double map_range = map_calc_range(
+      map_, laser_pose.v[0], laser_pose.v[1], laser_pose.v[2] + ldata.ranges[i][1],
+      ldata.range_max);
+    if (obs_range < map_range - beam_outlier_distance_) {
+      outlier[i] = true;
+      outlier_count++;
+    }
   }
-  double range_min;
-  if (laser_min_range_ > 0.0) {
-    range_min = std::max(laser_scan->range_min, static_cast<float>(laser_min_range_));
-  } else {
-    range_min = laser_scan->range_min;
+
+  // When most of the scan disagrees with the map, the estimate is more likely
+  // to be wrong than the world, so the scan is left for the filter to judge
+  if (2 * outlier_count > valid_count) {
+    return 0;
   }
 
-  // The LaserData destructor will free this memory
-  ldata.ranges = new double[ldata.range_count][2];
+  int kept = 0;
   for (int i = 0; i < ldata.range_count; i++) {
-    // amcl doesn't (yet) have a concept of min range.  So we'll map short
-    // readings to max range.
-    if (laser_scan->ranges[i] <= range_min) {
-      ldata.ranges[i][0] = ldata.range_max;
-    } else {
-      ldata.ranges[i][0] = laser_scan->ranges[i];
+    if (!outlier[i]) {
+      ldata.ranges[kept][0] = ldata.ranges[i][0];
+      ldata.ranges[kept][1] = ldata.ranges[i][1];
+      if (ldata.origins) {
+        ldata.origins[kept][0] = ldata.origins[i][0];
+        ldata.origins[kept][1] = ldata.origins[i][1];
+      }
+      kept++;
     }
-    // Compute bearing
-    ldata.ranges[i][1] = angle_min +
-      (i * angle_increment);
   }
-  lasers_[laser_index]->sensorUpdate(pf_, reinterpret_cast<nav2_amcl::LaserData *>(&ldata));
-  lasers_update_[laser_index] = false;
-  pf_odom_pose_ = pose;
-  return true;
+  ldata.range_count = kept;
+  return outlier_count;
 }
 
 void
@@ -852,17 +1458,50 @@ AmclNode::publishParticleCloud(const pf_sample_set_t * set)
 {
   // If initial pose is not known, AMCL does not know the current pose
   if (!initial_pose_is_known_) {return;}
-  geometry_msgs::msg::PoseArray cloud_msg;
-  cloud_msg.header.stamp = this->now();
-  cloud_msg.header.frame_id = global_frame_id_;
-  cloud_msg.poses.resize(set->sample_count);
+  // Nobody to build the cloud for
+  if (particlecloud_pub_->get_subscription_count() +
+    particlecloud_pub_->get_intra_process_subscription_count() == 0)
+  {
+    return;
+  }
+
+  // Pick the most likely samples. After a resampling the weights are all the
+  // same, and the ties are broken by taking every stride-th sample first, as
+  // neighbouring samples tend to have been drawn from the same particle.
+  std::vector<int> selected(set->sample_count);
   for (int i = 0; i < set->sample_count; i++) {
-    cloud_msg.poses[i].position.x = set->samples[i].pose.v[0];
-    cloud_msg.poses[i].position.y = set->samples[i].pose.v[1];
-    cloud_msg.poses[i].position.z = 0;
-    cloud_msg.poses[i].orientation = orientationAroundZAxis(set->samples[i].pose.v[2]);
+    selected[i] = i;
   }
-  particlecloud_pub_->publish(cloud_msg);
+  if (max_particlecloud_poses_ > 0 && max_particlecloud_poses_ < set->sample_count) {
+    int count = max_particlecloud_poses_;
+    int stride = (set->sample_count + count - 1) / count;
+    auto rank = [stride, count](int i) {return (i % stride) * count + i / stride;};
+    std::nth_element(
+      selected.begin(), selected.begin() + count, selected.end(),
+      [set, &rank](int a, int b) {
+        double weight_a = set->weight[a];
+        double weight_b = set->weight[b];
+        return weight_a > weight_b || (weight_a == weight_b && rank(a) < rank(b));
+      });
+    selected.resize(count);
+  }
+
+  auto cloud_msg = std::make_unique<geometry_msgs::msg::PoseArray>();
+  cloud_msg->header.stamp = this->now();
+  cloud_msg->header.frame_id = global_frame_id_;
+  cloud_msg->poses.resize(selected.size());
+  for (size_t i = 0; i < selected.size(); i++) {
+    int j = selected[i];
+    cloud_msg->poses[i].position.x = set->x[j];
+    cloud_msg->poses[i].position.y = set->y[j];
+    cloud_msg->poses[i].position.z = 0;
+    cloud_msg->poses[i].orientation = orientationAroundZAxis(set->theta[j]);
+  }
+
+  // Handing over the message lets intra-process subscribers take it without a copy
+  auto cloud = std::make_shared<std::unique_ptr<geometry_msgs::msg::PoseArray>>(
+    std::move(cloud_msg));
+  publishOutput([this, cloud]() {particlecloud_pub_->publish(std::move(*cloud));});
 }
 
 bool
@@ -871,6 +1510,7 @@ AmclNode::getMaxWeightHyp(
   int & max_weight_hyp)
 {
   // Read out the current hypotheses
+  pf_update_cluster_stats(pf_);
   double max_weight = 0.0;
   hyps.resize(pf_->sets[pf_->current_set].cluster_count);
   for (int hyp_count = 0;
@@ -949,7 +1589,7 @@ AmclNode::publishAmclPose(
   temp += p.pose.pose.position.x + p.pose.pose.position.y;
   if (!std::isnan(temp)) {
     RCLCPP_DEBUG(get_logger(), "Publishing pose");
-    pose_pub_->publish(p);
+    publishOutput([this, p]() {pose_pub_->publish(p);});
     first_pose_sent_ = true;
     last_published_pose_ = p;
   } else {
@@ -1005,7 +1645,20 @@ AmclNode::sendMapToOdomTransform(const tf2::TimePoint & transform_expiration)
   tmp_tf_stamped.header.stamp = tf2_ros::toMsg(transform_expiration);
   tmp_tf_stamped.child_frame_id = odom_frame_id_;
   tf2::impl::Converter<false, true>::convert(latest_tf_.inverse(), tmp_tf_stamped.transform);
-  tf_broadcaster_->sendTransform(tmp_tf_stamped);
+
+  std::unique_lock<std::mutex> lock(tf_mutex_);
+  if (tf_thread_running_) {
+    // Sent from the thread, post-dated from then on, which a transform stamped from the scan
+    // sent in between would go back in time from
+    tf_correction_ = tmp_tf_stamped;
+    tf_correction_known_ = true;
+    tf_correction_changed_ = true;
+    lock.unlock();
+    tf_changed_.notify_one();
+    return;
+  }
+  lock.unlock();
+  publishOutput([this, tmp_tf_stamped]() {tf_broadcaster_->sendTransform(tmp_tf_stamped);});
 }
 
 nav2_amcl::Laser *
@@ -1013,22 +1666,27 @@ AmclNode::createLaserObject()
 {
   RCLCPP_INFO(get_logger(), "createLaserObject");
 
+  nav2_amcl::Laser * laser;
   if (sensor_model_type_ == "beam") {
-    return new nav2_amcl::BeamModel(
+    laser = new nav2_amcl::BeamModel(
       z_hit_, z_short_, z_max_, z_rand_, sigma_hit_, lambda_short_,
       0.0, max_beams_, map_);
-  }
-
-  if (sensor_model_type_ == "likelihood_field_prob") {
-    return new nav2_amcl::LikelihoodFieldModelProb(
+  } else if (sensor_model_type_ == "likelihood_field_prob") {
+    laser = new nav2_amcl::LikelihoodFieldModelProb(
       z_hit_, z_rand_, sigma_hit_,
       laser_likelihood_max_dist_, do_beamskip_, beam_skip_distance_, beam_skip_threshold_,
       beam_skip_error_threshold_, max_beams_, map_);
+    if (do_beamskip_) {
+      laser->reserveTempData(max_particles_);
+    }
+  } else {
+    laser = new nav2_amcl::LikelihoodFieldModel(
+      z_hit_, z_rand_, sigma_hit_,
+      laser_likelihood_max_dist_, max_beams_, map_);
   }
 
-  return new nav2_amcl::LikelihoodFieldModel(
-    z_hit_, z_rand_, sigma_hit_,
-    laser_likelihood_max_dist_, max_beams_, map_);
+  laser->setThreadPool(sensor_pool_);
+  return laser;
 }
 
 void
@@ -1046,10 +1704,17 @@ AmclNode::initParameters()
   get_parameter("beam_skip_distance", beam_skip_distance_);
   get_parameter("beam_skip_error_threshold", beam_skip_error_threshold_);
   get_parameter("beam_skip_threshold", beam_skip_threshold_);
+  get_parameter("beam_range_table_angles", beam_range_table_angles_);
+  get_parameter("beam_outlier_pruning", beam_outlier_pruning_);
+  get_parameter("beam_outlier_distance", beam_outlier_distance_);
   get_parameter("do_beamskip", do_beamskip_);
   get_parameter("global_frame_id", global_frame_id_);
+  get_parameter("global_localization_hypotheses", global_localization_hypotheses_);
+  get_parameter("global_localization_search", global_localization_search_);
   get_parameter("lambda_short", lambda_short_);
   get_parameter("laser_likelihood_max_dist", laser_likelihood_max_dist_);
+  get_parameter("likelihood_field_cache_dir", likelihood_field_cache_dir_);
+  get_parameter("laser_fusion_window", laser_fusion_window_);
   get_parameter("laser_max_range", laser_max_range_);
   get_parameter("laser_min_range", laser_min_range_);
   get_parameter("laser_model_type", sensor_model_type_);
@@ -1058,20 +1723,28 @@ AmclNode::initParameters()
   get_parameter("initial_pose.y", initial_pose_y_);
   get_parameter("initial_pose.z", initial_pose_z_);
   get_parameter("initial_pose.yaw", initial_pose_yaw_);
+  get_parameter("map_cache_size", map_cache_size_);
   get_parameter("max_beams", max_beams_);
   get_parameter("max_particles", max_particles_);
+  get_parameter("max_particlecloud_poses", max_particlecloud_poses_);
   get_parameter("min_particles", min_particles_);
   get_parameter("odom_frame_id", odom_frame_id_);
   get_parameter("pf_err", pf_err_);
   get_parameter("pf_z", pf_z_);
+  get_parameter("pipelined_scan_processing", pipelined_scan_processing_);
   get_parameter("recovery_alpha_fast", alpha_fast_);
   get_parameter("recovery_alpha_slow", alpha_slow_);
   get_parameter("resample_interval", resample_interval_);
+  get_parameter("resample_method", resample_method_);
   get_parameter("robot_model_type", robot_model_type_);
   get_parameter("save_pose_rate", save_pose_rate);
+  get_parameter("scan_match_iterations", scan_match_iterations_);
+  get_parameter("sensor_update_threads", sensor_update_threads_);
   get_parameter("sigma_hit", sigma_hit_);
   get_parameter("tf_broadcast", tf_broadcast_);
+  get_parameter("tf_publish_rate", tf_publish_rate_);
   get_parameter("transform_tolerance", tmp_tol);
+  get_parameter("update_latency_target", update_latency_target_);
   get_parameter("update_min_a", a_thresh_);
   get_parameter("update_min_d", d_thresh_);
   get_parameter("z_hit", z_hit_);
@@ -1115,6 +1788,27 @@ AmclNode::mapReceived(const nav_msgs::msg::OccupancyGrid::SharedPtr msg)
   first_map_received_ = true;
 }
 
+// FNV-1a, over everything in the map message the likelihood field and the
+// range table depend on, and the parameter they are built for
+static uint64_t
+hashMap(const nav_msgs::msg::OccupancyGrid & msg, double parameter)
+{
+  uint64_t hash = 14695981039346656037ULL;
+  auto add = [&hash](const void * data, size_t size) {
+      const unsigned char * bytes = static_cast<const unsigned char *>(data);
+      for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 1099511628211ULL;
+      }
+    };
+
+  add(&msg.info.width, sizeof(msg.info.width));
+  add(&msg.info.height, sizeof(msg.info.height));
+  add(&msg.info.resolution, sizeof(msg.info.resolution));
+  add(&parameter, sizeof(parameter));
+  add(msg.data.data(), msg.data.size());
+  return hash;
+}
+
 void
 AmclNode::handleMapMessage(const nav_msgs::msg::OccupancyGrid & msg)
 {
@@ -1132,32 +1826,208 @@ AmclNode::handleMapMessage(const nav_msgs::msg::OccupancyGrid & msg)
       msg.header.frame_id.c_str(),
       global_frame_id_.c_str());
   }
+  const uint64_t map_hash = map_cache_size_ > 0 ? hashMap(msg, laser_likelihood_max_dist_) : 0;
   freeMapDependentMemory();
+  map_info_ = msg.info;
+  map_hash_ = map_hash;
+
+  // A map seen before comes with everything derived from it
+  map_ = takeCachedMap(msg, map_hash);
+  if (map_ != NULL) {
+    RCLCPP_INFO(get_logger(), "Switched back to a cached map");
+    return;
+  }
   map_ = convertMap(msg);
 
+  if (!useMapDistance() && sensor_model_type_ != "beam" && !likelihood_field_cache_dir_.empty()) {
+    loadLikelihoodField(msg);
+  }
+  if (sensor_model_type_ == "beam" && beam_range_table_angles_ > 0) {
+    loadRangeTable(msg);
+  }
+
 #if NEW_UNIFORM_SAMPLING
-  createFreeSpaceVector();
+  createFreeSpaceIndex();
 #endif
 }
 
 void
-AmclNode::createFreeSpaceVector()
-{
-  // Index of free space
-  free_space_indices.resize(0);
-  for (int i = 0; i < map_->size_x; i++) {
-    for (int j = 0; j < map_->size_y; j++) {
-      if (map_->cells[MAP_INDEX(map_, i, j)].occ_state == -1) {
-        free_space_indices.push_back(std::make_pair(i, j));
-      }
+AmclNode::mapDistanceReceived(const nav2_msgs::msg::DistanceField::SharedPtr msg)
+{
+  std::lock_guard<std::recursive_mutex> cfl(configuration_mutex_);
+  map_distance_ = msg;
+
+  // Once the distances have been computed here they are kept up to date with
+  // the map updates, so only a field that comes before that is any use
+  if (map_ != NULL && map_->max_occ_dist < 0) {
+    useMapDistance();
+  }
+}
+
+bool
+AmclNode::useMapDistance()
+{
+  if (!map_distance_ || map_ == NULL) {
+    return false;
+  }
+  const auto & info = map_distance_->info;
+  if (info.width != map_info_.width || info.height != map_info_.height ||
+    info.resolution != map_info_.resolution ||
+    info.map_load_time.sec != map_info_.map_load_time.sec ||
+    info.map_load_time.nanosec != map_info_.map_load_time.nanosec ||
+    map_distance_->data.size() != static_cast<size_t>(info.width) * info.height)
+  {
+    // A field for an earlier or a later map
+    return false;
+  }
+  if (map_distance_->max_distance < laser_likelihood_max_dist_) {
+    RCLCPP_WARN_ONCE(
+      get_logger(), "The map server's distance field only reaches %.2f m, "
+      "laser_likelihood_max_dist is %.2f m, computing the likelihood field here",
+      map_distance_->max_distance, laser_likelihood_max_dist_);
+    return false;
+  }
+
+  map_update_cspace_from_distances(
+    map_, map_distance_->data.data(), map_distance_->max_distance, laser_likelihood_max_dist_);
+  RCLCPP_INFO(get_logger(), "Took the likelihood field from the map server's distance field");
+  return true;
+}
+
+void
+AmclNode::mapUpdateReceived(const map_msgs::msg::OccupancyGridUpdate::SharedPtr msg)
+{
+  std::lock_guard<std::recursive_mutex> cfl(configuration_mutex_);
+
+  if (map_ == NULL) {
+    RCLCPP_WARN(get_logger(), "Map update ignored, no map has been received yet");
+    return;
+  }
+  if (msg->x < 0 || msg->y < 0 ||
+    msg->x + static_cast<int64_t>(msg->width) > map_->size_x ||
+    msg->y + static_cast<int64_t>(msg->height) > map_->size_y ||
+    msg->data.size() != static_cast<size_t>(msg->width) * msg->height)
+  {
+    RCLCPP_WARN(
+      get_logger(), "Map update of %d X %d cells at (%d, %d) ignored, it isn't on the %d X %d map",
+      msg->width, msg->height, msg->x, msg->y, map_->size_x, map_->size_y);
+    return;
+  }
+  RCLCPP_DEBUG(
+    get_logger(), "Updating %d X %d cells of the map at (%d, %d)",
+    msg->width, msg->height, msg->x, msg->y);
+
+  size_t index = 0;
+  for (unsigned int j = 0; j < msg->height; j++) {
+    int8_t * occ_state = &map_->occ_state[MAP_INDEX(map_, msg->x, msg->y + j)];
+    for (unsigned int i = 0; i < msg->width; i++) {
+      int8_t value = msg->data[index++];
+      occ_state[i] = value == 0 ? -1 : value == 100 ? +1 : 0;
+    }
+  }
+
+  // No longer the map of the message, not to be found again by its hash
+  map_hash_ = 0;
+
+  // The likelihood field only changes near the edit, but the range table
+  // holds whole lanes across the map and is built again
+  map_update_cspace_region(map_, msg->x, msg->y, msg->x + msg->width, msg->y + msg->height);
+  if (map_->range_table != NULL) {
+    map_update_range_table(map_, beam_range_table_angles_);
+  }
+
+#if NEW_UNIFORM_SAMPLING
+  createFreeSpaceIndex();
+#endif
+}
+
+void
+AmclNode::loadLikelihoodField(const nav_msgs::msg::OccupancyGrid & msg)
+{
+  char name[64];
+  snprintf(
+    name, sizeof(name), "/likelihood_field_%016llx.bin",
+    static_cast<unsigned long long>(hashMap(msg, laser_likelihood_max_dist_)));
+  std::string filename = likelihood_field_cache_dir_ + name;
+
+  if (map_load_cspace(map_, filename.c_str(), laser_likelihood_max_dist_) == 0) {
+    RCLCPP_INFO(get_logger(), "Mapped the likelihood field from %s", filename.c_str());
+    return;
+  }
+
+  map_update_cspace(map_, laser_likelihood_max_dist_);
+  if (map_save_cspace(map_, filename.c_str()) == 0) {
+    RCLCPP_INFO(get_logger(), "Saved the likelihood field to %s", filename.c_str());
+    // From now on only the tiles in use need to be in memory
+    map_load_cspace(map_, filename.c_str(), laser_likelihood_max_dist_);
+  } else {
+    RCLCPP_WARN(get_logger(), "Failed to save the likelihood field to %s", filename.c_str());
+  }
+}
+
+void
+AmclNode::loadRangeTable(const nav_msgs::msg::OccupancyGrid & msg)
+{
+  std::string filename;
+  if (!likelihood_field_cache_dir_.empty()) {
+    char name[64];
+    snprintf(
+      name, sizeof(name), "/range_table_%016llx.bin",
+      static_cast<unsigned long long>(hashMap(msg, beam_range_table_angles_)));
+    filename = likelihood_field_cache_dir_ + name;
+
+    if (map_load_range_table(map_, filename.c_str(), beam_range_table_angles_) == 0) {
+      RCLCPP_INFO(get_logger(), "Mapped the range table from %s", filename.c_str());
+      return;
+    }
+  }
+
+  map_update_range_table(map_, beam_range_table_angles_);
+  if (filename.empty()) {
+    return;
+  }
+  if (map_save_range_table(map_, filename.c_str()) == 0) {
+    RCLCPP_INFO(get_logger(), "Saved the range table to %s", filename.c_str());
+  } else {
+    RCLCPP_WARN(get_logger(), "Failed to save the range table to %s", filename.c_str());
+  }
+}
+
+void
+AmclNode::createFreeSpaceIndex()
+{
+  map_update_free_runs(map_);
+}
+
+map_t *
+AmclNode::takeCachedMap(const nav_msgs::msg::OccupancyGrid & msg, uint64_t hash)
+{
+  for (auto cached = map_cache_.begin(); cached != map_cache_.end(); ++cached) {
+    map_t * map = cached->second;
+    if (cached->first == hash && map->size_x == static_cast<int>(msg.info.width) &&
+      map->size_y == static_cast<int>(msg.info.height) &&
+      map->origin_x == msg.info.origin.position.x + (map->size_x / 2) * map->scale &&
+      map->origin_y == msg.info.origin.position.y + (map->size_y / 2) * map->scale)
+    {
+      map_cache_.erase(cached);
+      return map;
     }
   }
+  return NULL;
 }
 
 void
 AmclNode::freeMapDependentMemory()
 {
-  if (map_ != NULL) {
+  if (map_ != NULL && map_hash_ != 0) {
+    // the least recently used map goes when there are too many
+    map_cache_.emplace_back(map_hash_, map_);
+    if (map_cache_.size() > static_cast<size_t>(map_cache_size_)) {
+      map_free(map_cache_.front().second);
+      map_cache_.pop_front();
+    }
+    map_ = NULL;
+  } else if (map_ != NULL) {
     map_free(map_);
     map_ = NULL;
   }
@@ -1182,17 +2052,16 @@ AmclNode::convertMap(const nav_msgs::msg::OccupancyGrid & map_msg)
   map->origin_x = map_msg.info.origin.position.x + (map->size_x / 2) * map->scale;
   map->origin_y = map_msg.info.origin.position.y + (map->size_y / 2) * map->scale;
 
-  map->cells =
-    reinterpret_cast<map_cell_t *>(malloc(sizeof(map_cell_t) * map->size_x * map->size_y));
+  map_alloc_cells(map);
 
   // Convert to player format
   for (int i = 0; i < map->size_x * map->size_y; i++) {
     if (map_msg.data[i] == 0) {
-      map->cells[i].occ_state = -1;
+      map->occ_state[i] = -1;
     } else if (map_msg.data[i] == 100) {
-      map->cells[i].occ_state = +1;
+      map->occ_state[i] = +1;
     } else {
-      map->cells[i].occ_state = 0;
+      map->occ_state[i] = 0;
     }
   }
 
@@ -1244,17 +2113,129 @@ AmclNode::initPubSub()
 
   pose_pub_ = create_publisher<geometry_msgs::msg::PoseWithCovarianceStamped>(
     "amcl_pose",
-    rclcpp::QoS(rclcpp::KeepLast(1)).transient_local().reliable());
+    rclcpp::QoS(rclcpp::KeepLast(1)).transient_local().reliable(),
+    nav2_util::get_inter_process_publisher_options());
 
   initial_pose_sub_ = create_subscription<geometry_msgs::msg::PoseWithCovarianceStamped>(
     "initialpose", rclcpp::SystemDefaultsQoS(),
-    std::bind(&AmclNode::initialPoseReceived, this, std::placeholders::_1));
+    std::bind(&AmclNode::initialPoseReceived, this, std::placeholders::_1),
+    nav2_util::get_inter_process_subscription_options());
 
   map_sub_ = create_subscription<nav_msgs::msg::OccupancyGrid>(
     "map", rclcpp::QoS(rclcpp::KeepLast(1)).transient_local().reliable(),
-    std::bind(&AmclNode::mapReceived, this, std::placeholders::_1));
+    std::bind(&AmclNode::mapReceived, this, std::placeholders::_1),
+    nav2_util::get_inter_process_subscription_options());
+
+  map_update_sub_ = create_subscription<map_msgs::msg::OccupancyGridUpdate>(
+    "map_updates", rclcpp::QoS(rclcpp::KeepLast(10)).reliable(),
+    std::bind(&AmclNode::mapUpdateReceived, this, std::placeholders::_1));
+
+  map_distance_sub_ = create_subscription<nav2_msgs::msg::DistanceField>(
+    "map_distance", rclcpp::QoS(rclcpp::KeepLast(1)).transient_local().reliable(),
+    std::bind(&AmclNode::mapDistanceReceived, this, std::placeholders::_1),
+    nav2_util::get_inter_process_subscription_options());
 
   RCLCPP_INFO(get_logger(), "Subscribed to map topic.");
+
+  parameters_client_ = std::make_shared<rclcpp::AsyncParametersClient>(
+    get_node_base_interface(),
+    get_node_topics_interface(),
+    get_node_graph_interface(),
+    get_node_services_interface());
+
+  parameter_event_sub_ = parameters_client_->on_parameter_event(
+    std::bind(&AmclNode::on_parameter_event_callback, this, std::placeholders::_1));
+}
+
+void
+AmclNode::on_parameter_event_callback(
+  const rcl_interfaces::msg::ParameterEvent::SharedPtr event)
+{
+  if (event->node != get_fully_qualified_name()) {
+    return;
+  }
+
+  std::lock_guard<std::recursive_mutex> cfl(configuration_mutex_);
+  bool resize_filter = false;
+  bool rebuild_motion_model = false;
+  for (auto & changed_parameter : event->changed_parameters) {
+    const auto & type = changed_parameter.value.type;
+    const auto & name = changed_parameter.name;
+    const auto & value = changed_parameter.value;
+
+    if (type == rcl_interfaces::msg::ParameterType::PARAMETER_INTEGER) {
+      if (name == "max_particles") {
+        max_particles_ = value.integer_value;
+        resize_filter = true;
+      } else if (name == "min_particles") {
+        min_particles_ = value.integer_value;
+        resize_filter = true;
+      } else if (name == "resample_interval") {
+        resample_interval_ = std::max(1, static_cast<int>(value.integer_value));
+      }
+    } else if (type == rcl_interfaces::msg::ParameterType::PARAMETER_DOUBLE) {
+      if (name == "alpha1") {
+        alpha1_ = value.double_value;
+        rebuild_motion_model = true;
+      } else if (name == "alpha2") {
+        alpha2_ = value.double_value;
+        rebuild_motion_model = true;
+      } else if (name == "alpha3") {
+        alpha3_ = value.double_value;
+        rebuild_motion_model = true;
+      } else if (name == "alpha4") {
+        alpha4_ = value.double_value;
+        rebuild_motion_model = true;
+      } else if (name == "alpha5") {
+        alpha5_ = value.double_value;
+        rebuild_motion_model = true;
+      } else if (name == "pf_err") {
+        pf_err_ = value.double_value;
+      } else if (name == "pf_z") {
+        pf_z_ = value.double_value;
+      } else if (name == "recovery_alpha_fast") {
+        alpha_fast_ = value.double_value;
+      } else if (name == "recovery_alpha_slow") {
+        alpha_slow_ = value.double_value;
+      } else if (name == "update_min_a") {
+        a_thresh_ = value.double_value;
+      } else if (name == "update_min_d") {
+        d_thresh_ = value.double_value;
+      }
+    }
+  }
+
+  if (!pf_) {
+    return;
+  }
+  pf_->pop_err = pf_err_;
+  pf_->pop_z = pf_z_;
+  pf_->alpha_fast = alpha_fast_;
+  pf_->alpha_slow = alpha_slow_;
+
+  if (resize_filter) {
+    if (min_particles_ > max_particles_) {
+      RCLCPP_WARN(
+        get_logger(), "You've set min_particles to be greater than max particles,"
+        " this isn't allowed so max_particles will be set to min_particles.");
+      max_particles_ = min_particles_;
+    }
+    pf_resize(pf_, min_particles_, max_particles_);
+    if (do_beamskip_) {
+      for (auto & laser : lasers_) {
+        laser->reserveTempData(max_particles_);
+      }
+    }
+    RCLCPP_INFO(
+      get_logger(), "Resized the particle filter to %d to %d particles",
+      min_particles_, max_particles_);
+  }
+
+  if (rebuild_motion_model) {
+    motion_model_ = std::unique_ptr<nav2_amcl::MotionModel>(
+      nav2_amcl::MotionModel::createMotionModel(
+        robot_model_type_, alpha1_, alpha2_, alpha3_, alpha4_, alpha5_));
+  }
 }
 
 void
@@ -1307,6 +2288,8 @@ AmclNode::initParticleFilter()
     reinterpret_cast<void *>(map_));
   pf_->pop_err = pf_err_;
   pf_->pop_z = pf_z_;
+  pf_->resample_method =
+    resample_method_ == "systematic" ? PF_RESAMPLE_SYSTEMATIC : PF_RESAMPLE_MULTINOMIAL;
 
   // Initialize the filter
   pf_vector_t pf_init_pose_mean = pf_vector_zero();
@@ -1326,11 +2309,40 @@ AmclNode::initParticleFilter()
   memset(&pf_odom_pose_, 0, sizeof(pf_odom_pose_));
 }
 
+// Lets the particle filter split its cluster statistics over the sensor pool
+static void
+poolParallelFor(
+  void * parallel_data, int count, void (* task)(void * task_data, int index), void * task_data)
+{
+  static_cast<nav2_util::ThreadPool *>(parallel_data)->parallel_for(
+    count, [task, task_data](size_t index) {task(task_data, static_cast<int>(index));});
+}
+
 void
 AmclNode::initLaserScan()
 {
   scan_error_count_ = 0;
   last_laser_received_ts_ = rclcpp::Time(0);
+
+  // The lasers and the motion model share one pool, as scans are handled one at a time
+  if (sensor_update_threads_ != 1) {
+    sensor_pool_ = std::make_shared<nav2_util::ThreadPool>(std::max(0, sensor_update_threads_));
+    RCLCPP_INFO(
+      get_logger(), "Updating particles on %u threads", sensor_pool_->size());
+  }
+  if (motion_model_) {
+    motion_model_->setThreadPool(sensor_pool_);
+  }
+  if (pf_) {
+    pf_set_parallel_for(pf_, sensor_pool_ ? poolParallelFor : NULL, sensor_pool_.get());
+  }
 }
 
 }  // namespace nav2_amcl
+
+#include "rclcpp_components/register_node_macro.hpp"
+
+// Register the component with class_loader.
+// This acts as a sort of entry point, allowing the component to be discoverable when its library
+// is being loaded into a running process.
+RCLCPP_COMPONENTS_REGISTER_NODE(nav2_amcl::AmclNode)
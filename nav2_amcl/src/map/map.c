@@ -48,10 +48,19 @@ map_t * map_alloc(void)
   // Make the size odd
   map->size_x = 0;
   map->size_y = 0;
+  map->tiles_x = 0;
+  map->tiles_y = 0;
   map->scale = 0;
 
+  map->max_occ_dist = -1;
+  map->range_table = NULL;
+  map->free_runs = NULL;
+
   // Allocate storage for main map
-  map->cells = (map_cell_t *) NULL;
+  map->occ_state = (int8_t *) NULL;
+  map->occ_dist = (uint8_t *) NULL;
+  map->occ_dist_mapping = NULL;
+  map->occ_dist_mapping_size = 0;
 
   return map;
 }
@@ -60,25 +69,46 @@ map_t * map_alloc(void)
 // Destroy a map
 void map_free(map_t * map)
 {
-  free(map->cells);
+  map_free_range_table(map);
+  map_clear_free_runs(map);
+  map_free_occ_dist(map);
+  map_free_buffer(map->occ_state);
   free(map);
 }
 
 
+// Allocate the cells for the size of the map
+void map_alloc_cells(map_t * map)
+{
+  size_t size = (size_t) map->size_x * map->size_y;
+  size_t dist_size;
+
+  map->tiles_x = (map->size_x + MAP_TILE_SIZE - 1) >> MAP_TILE_SHIFT;
+  map->tiles_y = (map->size_y + MAP_TILE_SIZE - 1) >> MAP_TILE_SHIFT;
+  dist_size = MAP_DIST_SIZE(map);
+
+  map_free_buffer(map->occ_state);
+  map_free_occ_dist(map);
+  map_clear_free_runs(map);
+  map->occ_state = (int8_t *) map_alloc_buffer(size * sizeof(map->occ_state[0]));
+  map->occ_dist = (uint8_t *) map_alloc_buffer(dist_size * sizeof(map->occ_dist[0]));
+  memset(map->occ_state, 0, size * sizeof(map->occ_state[0]));
+  memset(map->occ_dist, MAP_OCC_DIST_MAX, dist_size * sizeof(map->occ_dist[0]));
+}
+
+
 // Get the cell at the given point
-map_cell_t * map_get_cell(map_t * map, double ox, double oy, double oa)
+int map_get_cell(map_t * map, double ox, double oy, double oa)
 {
   (void)oa;
   int i, j;
-  map_cell_t * cell;
 
   i = MAP_GXWX(map, ox);
   j = MAP_GYWY(map, oy);
 
   if (!MAP_VALID(map, i, j)) {
-    return NULL;
+    return -1;
   }
 
-  cell = map->cells + MAP_INDEX(map, i, j);
-  return cell;
+  return MAP_INDEX(map, i, j);
 }
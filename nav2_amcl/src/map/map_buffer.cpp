@@ -0,0 +1,34 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#include <new>
+
+#include "nav2_amcl/map/map.hpp"
+#include "nav2_util/large_buffer.hpp"
+
+void * map_alloc_buffer(size_t size)
+{
+  try {
+    return nav2_util::allocate_large_buffer(size);
+  } catch (const std::bad_alloc &) {
+    return NULL;
+  }
+}
+
+void map_free_buffer(void * buffer)
+{
+  nav2_util::free_large_buffer(buffer);
+}
@@ -20,164 +20,108 @@
  */
 
 #include <math.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
-#include <queue>
-#include "nav2_amcl/map/map.hpp"
 
-class CellData
-{
-public:
-  map_t * map_;
-  unsigned int i_, j_;
-  unsigned int src_i_, src_j_;
-};
+#include <algorithm>
+#include <vector>
 
-class CachedDistanceMap
+#include "nav2_amcl/map/map.hpp"
+#include "nav2_util/distance_transform.hpp"
+#include "nav2_util/thread_pool.hpp"
+
+// Compute the distances of the cells in the window [min_x, max_x) x [min_y, max_y)
+// from the obstacles in it, and store those of the cells in
+// [out_min_x, out_max_x) x [out_min_y, out_max_y). The distances are cut off at
+// a whole number of cells.
+static void update_distances(
+  map_t * map, int min_x, int min_y, int max_x, int max_y,
+  int out_min_x, int out_min_y, int out_max_x, int out_max_y)
 {
-public:
-  CachedDistanceMap(double scale, double max_dist)
-  : distances_(NULL), scale_(scale), max_dist_(max_dist)
-  {
-    cell_radius_ = max_dist / scale;
-    distances_ = new double *[cell_radius_ + 2];
-    for (int i = 0; i <= cell_radius_ + 1; i++) {
-      distances_[i] = new double[cell_radius_ + 2];
-      for (int j = 0; j <= cell_radius_ + 1; j++) {
-        distances_[i][j] = sqrt(i * i + j * j);
-      }
+  int size_x = max_x - min_x;
+  int size_y = max_y - min_y;
+  std::vector<int64_t> distances(static_cast<size_t>(size_x) * size_y);
+
+  for (int j = 0; j < size_y; j++) {
+    const int8_t * occ_state = &map->occ_state[MAP_INDEX(map, min_x, min_y + j)];
+    int64_t * row = &distances[static_cast<size_t>(j) * size_x];
+    for (int i = 0; i < size_x; i++) {
+      row[i] = occ_state[i] == +1 ? 0 : nav2_util::NO_SEED;
     }
   }
-  ~CachedDistanceMap()
-  {
-    if (distances_) {
-      for (int i = 0; i <= cell_radius_ + 1; i++) {
-        delete[] distances_[i];
+
+  nav2_util::ThreadPool pool;
+  nav2_util::squaredDistanceTransform(distances.data(), size_x, size_y, pool);
+
+  int64_t cell_radius = static_cast<int64_t>(map->max_occ_dist / map->scale);
+  for (int j = out_min_y; j < out_max_y; j++) {
+    for (int i = out_min_x; i < out_max_x; i++) {
+      int64_t distance = distances[static_cast<size_t>(j - min_y) * size_x + (i - min_x)];
+      uint8_t * occ_dist = &map->occ_dist[MAP_DIST_INDEX(map, i, j)];
+      if (distance > cell_radius * cell_radius) {
+        *occ_dist = MAP_OCC_DIST_MAX;
+      } else {
+        *occ_dist = MAP_OCC_DIST_QUANTIZE(map, sqrt(static_cast<double>(distance)) * map->scale);
       }
-      delete[] distances_;
     }
   }
-  double ** distances_;
-  double scale_;
-  double max_dist_;
-  int cell_radius_;
-};
-
-
-bool operator<(const CellData & a, const CellData & b)
-{
-  return a.map_->cells[MAP_INDEX(
-             a.map_, a.i_,
-             a.j_)].occ_dist > a.map_->cells[MAP_INDEX(b.map_, b.i_, b.j_)].occ_dist;
 }
 
-CachedDistanceMap *
-get_distance_map(double scale, double max_dist)
+// Update the cspace distance values
+void map_update_cspace(map_t * map, double max_occ_dist)
 {
-  static CachedDistanceMap * cdm = NULL;
-
-  if (!cdm || (cdm->scale_ != scale) || (cdm->max_dist_ != max_dist)) {
-    if (cdm) {
-      delete cdm;
-    }
-    cdm = new CachedDistanceMap(scale, max_dist);
-  }
-
-  return cdm;
+  map->max_occ_dist = max_occ_dist;
+  update_distances(
+    map, 0, 0, map->size_x, map->size_y, 0, 0, map->size_x, map->size_y);
 }
 
-void enqueue(
-  map_t * map, int i, int j,
-  int src_i, int src_j,
-  std::priority_queue<CellData> & Q,
-  CachedDistanceMap * cdm,
-  unsigned char * marked)
+// Only the cells within the cut off distance of the changed ones can have a
+// new distance, and only the obstacles within that distance of those cells
+// can be the nearest to them
+void map_update_cspace_region(map_t * map, int min_x, int min_y, int max_x, int max_y)
 {
-  if (marked[MAP_INDEX(map, i, j)]) {
+  if (map->max_occ_dist < 0 || min_x >= max_x || min_y >= max_y) {
     return;
   }
-
-  int di = abs(i - src_i);
-  int dj = abs(j - src_j);
-  double distance = cdm->distances_[di][dj];
-
-  if (distance > cdm->cell_radius_) {
+  if (map->occ_dist_mapping != NULL && map_copy_occ_dist(map) != 0) {
     return;
   }
 
-  map->cells[MAP_INDEX(map, i, j)].occ_dist = distance * map->scale;
-
-  CellData cell;
-  cell.map_ = map;
-  cell.i_ = i;
-  cell.j_ = j;
-  cell.src_i_ = src_i;
-  cell.src_j_ = src_j;
-
-  Q.push(cell);
-
-  marked[MAP_INDEX(map, i, j)] = 1;
+  int cell_radius = static_cast<int>(map->max_occ_dist / map->scale) + 1;
+  int out_min_x = std::max(min_x - cell_radius, 0);
+  int out_min_y = std::max(min_y - cell_radius, 0);
+  int out_max_x = std::min(max_x + cell_radius, map->size_x);
+  int out_max_y = std::min(max_y + cell_radius, map->size_y);
+  update_distances(
+    map,
+    std::max(min_x - 2 * cell_radius, 0), std::max(min_y - 2 * cell_radius, 0),
+    std::min(max_x + 2 * cell_radius, map->size_x),
+    std::min(max_y + 2 * cell_radius, map->size_y),
+    out_min_x, out_min_y, out_max_x, out_max_y);
 }
 
-// Update the cspace distance values
-void map_update_cspace(map_t * map, double max_occ_dist)
+// The distances are stored in steps of distance_max / MAP_OCC_DIST_MAX
+void map_update_cspace_from_distances(
+  map_t * map, const uint8_t * distances, double distance_max, double max_occ_dist)
 {
-  unsigned char * marked;
-  std::priority_queue<CellData> Q;
-
-  marked = new unsigned char[map->size_x * map->size_y];
-  memset(marked, 0, sizeof(unsigned char) * map->size_x * map->size_y);
-
+  // The stored value of each of the steps, looked up rather than computed per cell
+  uint8_t values[MAP_OCC_DIST_MAX + 1];
   map->max_occ_dist = max_occ_dist;
-
-  CachedDistanceMap * cdm = get_distance_map(map->scale, map->max_occ_dist);
-
-  // Enqueue all the obstacle cells
-  CellData cell;
-  cell.map_ = map;
-  for (int i = 0; i < map->size_x; i++) {
-    cell.src_i_ = cell.i_ = i;
-    for (int j = 0; j < map->size_y; j++) {
-      if (map->cells[MAP_INDEX(map, i, j)].occ_state == +1) {
-        map->cells[MAP_INDEX(map, i, j)].occ_dist = 0.0;
-        cell.src_j_ = cell.j_ = j;
-        marked[MAP_INDEX(map, i, j)] = 1;
-        Q.push(cell);
-      } else {
-        map->cells[MAP_INDEX(map, i, j)].occ_dist = max_occ_dist;
-      }
-    }
+  for (int step = 0; step <= MAP_OCC_DIST_MAX; step++) {
+    double distance = step == MAP_OCC_DIST_MAX ?
+      distance_max : step * distance_max / MAP_OCC_DIST_MAX;
+    values[step] = MAP_OCC_DIST_QUANTIZE(map, distance);
   }
 
-  while (!Q.empty()) {
-    CellData current_cell = Q.top();
-    if (current_cell.i_ > 0) {
-      enqueue(
-        map, current_cell.i_ - 1, current_cell.j_,
-        current_cell.src_i_, current_cell.src_j_,
-        Q, cdm, marked);
-    }
-    if (current_cell.j_ > 0) {
-      enqueue(
-        map, current_cell.i_, current_cell.j_ - 1,
-        current_cell.src_i_, current_cell.src_j_,
-        Q, cdm, marked);
+  map_free_occ_dist(map);
+  map->occ_dist = static_cast<uint8_t *>(
+    map_alloc_buffer(MAP_DIST_SIZE(map) * sizeof(map->occ_dist[0])));
+  memset(map->occ_dist, MAP_OCC_DIST_MAX, MAP_DIST_SIZE(map) * sizeof(map->occ_dist[0]));
+  for (int j = 0; j < map->size_y; j++) {
+    const uint8_t * row = distances + static_cast<size_t>(j) * map->size_x;
+    for (int i = 0; i < map->size_x; i++) {
+      map->occ_dist[MAP_DIST_INDEX(map, i, j)] = values[row[i]];
     }
-    if (static_cast<int>(current_cell.i_) < map->size_x - 1) {
-      enqueue(
-        map, current_cell.i_ + 1, current_cell.j_,
-        current_cell.src_i_, current_cell.src_j_,
-        Q, cdm, marked);
-    }
-    if (static_cast<int>(current_cell.j_) < map->size_y - 1) {
-      enqueue(
-        map, current_cell.i_, current_cell.j_ + 1,
-        current_cell.src_i_, current_cell.src_j_,
-        Q, cdm, marked);
-    }
-
-    Q.pop();
   }
-
-  delete[] marked;
 }
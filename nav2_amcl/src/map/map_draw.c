@@ -43,7 +43,6 @@ void map_draw_occ(map_t * map, rtk_fig_t * fig)
 {
   int i, j;
   int col;
-  map_cell_t * cell;
   uint16_t * image;
   uint16_t * pixel;
 
@@ -52,10 +51,9 @@ void map_draw_occ(map_t * map, rtk_fig_t * fig)
   // Draw occupancy
   for (j = 0; j < map->size_y; j++) {
     for (i = 0; i < map->size_x; i++) {
-      cell = map->cells + MAP_INDEX(map, i, j);
       pixel = image + (j * map->size_x + i);
 
-      col = 127 - 127 * cell->occ_state;
+      col = 127 - 127 * map->occ_state[MAP_INDEX(map, i, j)];
       *pixel = RTK_RGB16(col, col, col);
     }
   }
@@ -75,7 +73,6 @@ void map_draw_cspace(map_t * map, rtk_fig_t * fig)
 {
   int i, j;
   int col;
-  map_cell_t * cell;
   uint16_t * image;
   uint16_t * pixel;
 
@@ -84,10 +81,9 @@ void map_draw_cspace(map_t * map, rtk_fig_t * fig)
   // Draw occupancy
   for (j = 0; j < map->size_y; j++) {
     for (i = 0; i < map->size_x; i++) {
-      cell = map->cells + MAP_INDEX(map, i, j);
       pixel = image + (j * map->size_x + i);
 
-      col = 255 * cell->occ_dist / map->max_occ_dist;
+      col = 255 * map->occ_dist[MAP_DIST_INDEX(map, i, j)] / MAP_OCC_DIST_MAX;
 
       *pixel = RTK_RGB16(col, col, col);
     }
@@ -0,0 +1,134 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "nav2_amcl/map/map.hpp"
+#include "nav2_util/thread_pool.hpp"
+
+namespace
+{
+
+// Rows per task, enough for the tasks to outweigh handing them out
+const int kRowsPerTask = 64;
+
+// Counts the runs of free cells of row j, adding their cells to cells, and
+// when given the index writes the runs to it from run on
+int64_t scanRow(const map_t * map, int j, map_free_runs_t * runs, int64_t run, int64_t & cells)
+{
+  const int8_t * row = map->occ_state + (size_t) j * map->size_x;
+  int64_t row_runs = 0;
+  int i = 0;
+  while (i < map->size_x) {
+    while (i < map->size_x && row[i] != -1) {
+      i++;
+    }
+    if (i == map->size_x) {
+      break;
+    }
+    int start = i;
+    while (i < map->size_x && row[i] == -1) {
+      i++;
+    }
+    if (runs) {
+      runs->run_x[run + row_runs] = start;
+      runs->run_y[run + row_runs] = j;
+      runs->cells_before[run + row_runs] = cells;
+    }
+    cells += i - start;
+    row_runs++;
+  }
+  return row_runs;
+}
+
+}  // namespace
+
+// Count the runs of each block of rows, then write each block from where the
+// blocks before it end
+void map_update_free_runs(map_t * map)
+{
+  map_clear_free_runs(map);
+
+  int tasks = (map->size_y + kRowsPerTask - 1) / kRowsPerTask;
+  std::vector<int64_t> task_runs(tasks + 1, 0);
+  std::vector<int64_t> task_cells(tasks + 1, 0);
+  nav2_util::ThreadPool pool;
+  pool.parallel_for(
+    tasks, [&](size_t task) {
+      int end = std::min<int>(map->size_y, (task + 1) * kRowsPerTask);
+      for (int j = task * kRowsPerTask; j < end; j++) {
+        task_runs[task + 1] += scanRow(map, j, NULL, 0, task_cells[task + 1]);
+      }
+    });
+  for (int task = 0; task < tasks; task++) {
+    task_runs[task + 1] += task_runs[task];
+    task_cells[task + 1] += task_cells[task];
+  }
+
+  map_free_runs_t * runs = static_cast<map_free_runs_t *>(malloc(sizeof(map_free_runs_t)));
+  runs->run_count = task_runs[tasks];
+  runs->cells_before =
+    static_cast<int64_t *>(malloc((runs->run_count + 1) * sizeof(runs->cells_before[0])));
+  runs->run_x = static_cast<int32_t *>(malloc(runs->run_count * sizeof(runs->run_x[0])));
+  runs->run_y = static_cast<int32_t *>(malloc(runs->run_count * sizeof(runs->run_y[0])));
+  runs->cells_before[runs->run_count] = task_cells[tasks];
+
+  pool.parallel_for(
+    tasks, [&](size_t task) {
+      int end = std::min<int>(map->size_y, (task + 1) * kRowsPerTask);
+      int64_t run = task_runs[task];
+      int64_t cells = task_cells[task];
+      for (int j = task * kRowsPerTask; j < end; j++) {
+        run += scanRow(map, j, runs, run, cells);
+      }
+    });
+
+  map->free_runs = runs;
+}
+
+void map_clear_free_runs(map_t * map)
+{
+  if (map->free_runs == NULL) {
+    return;
+  }
+  free(map->free_runs->cells_before);
+  free(map->free_runs->run_x);
+  free(map->free_runs->run_y);
+  free(map->free_runs);
+  map->free_runs = NULL;
+}
+
+// Find the run the r-th share of the free cells falls in by binary search
+int map_sample_free_cell(const map_t * map, double r, int * i, int * j)
+{
+  const map_free_runs_t * runs = map->free_runs;
+  if (runs == NULL || runs->cells_before[runs->run_count] == 0) {
+    return -1;
+  }
+
+  int64_t total = runs->cells_before[runs->run_count];
+  int64_t cell = std::min<int64_t>(total - 1, static_cast<int64_t>(r * total));
+  const int64_t * next = std::upper_bound(
+    runs->cells_before, runs->cells_before + runs->run_count, cell);
+  int64_t run = next - runs->cells_before - 1;
+  *i = runs->run_x[run] + static_cast<int>(cell - runs->cells_before[run]);
+  *j = runs->run_y[run];
+  return 0;
+}
@@ -32,6 +32,99 @@
 
 #include "nav2_amcl/map/map.hpp"
 
+// Create a range table around a block of its arrays
+map_range_table_t * map_range_table_wrap(
+  void * data, size_t mapping_size, const void * arrays, int angle_count)
+{
+  map_range_table_t * table;
+  int angle;
+
+  table = (map_range_table_t *) malloc(sizeof(map_range_table_t));
+  table->angle_count = angle_count;
+  table->lane_min = (int32_t *) arrays;
+  table->lane_start = table->lane_min + angle_count;
+  table->lane_offsets = table->lane_start + angle_count + 1;
+  table->obstacles = (float *) (table->lane_offsets + table->lane_start[angle_count] + 1);
+  table->data = data;
+  table->mapping_size = mapping_size;
+
+  table->directions = (double *) malloc(2 * angle_count * sizeof(double));
+  for (angle = 0; angle < angle_count; angle++) {
+    table->directions[2 * angle] = cos(angle * M_PI / angle_count);
+    table->directions[2 * angle + 1] = sin(angle * M_PI / angle_count);
+  }
+
+  return table;
+}
+
+
+// Look a range up in the range table
+static double map_lookup_range(
+  map_t * map, map_range_table_t * table, double ox, double oy, double oa,
+  double max_range)
+{
+  int i, j;
+  int angle, lane;
+  int reverse;
+  double u, v;
+  const float * lane_first, * first, * last, * hit;
+  int32_t offset;
+
+  i = MAP_GXWX(map, ox);
+  j = MAP_GYWY(map, oy);
+  if (!MAP_VALID(map, i, j) || map->occ_state[MAP_INDEX(map, i, j)] > -1) {
+    return 0.0;
+  }
+
+  // Nearest of the 2 * angle_count bearings, those in the second half turn
+  // being the first ones in reverse
+  angle = (int) floor(oa * table->angle_count / M_PI + 0.5) % (2 * table->angle_count);
+  if (angle < 0) {
+    angle += 2 * table->angle_count;
+  }
+  reverse = angle >= table->angle_count;
+  if (reverse) {
+    angle -= table->angle_count;
+  }
+
+  u = i * table->directions[2 * angle] + j * table->directions[2 * angle + 1];
+  v = j * table->directions[2 * angle] - i * table->directions[2 * angle + 1];
+  lane = (int) floor(v + 0.5) - table->lane_min[angle];
+  offset = table->lane_start[angle] + lane;
+  lane_first = table->obstacles + table->lane_offsets[offset];
+  first = lane_first;
+  last = table->obstacles + table->lane_offsets[offset + 1];
+
+  // Binary search for the first obstacle past the start cell
+  while (first < last) {
+    hit = first + (last - first) / 2;
+    if (*hit <= u) {
+      first = hit + 1;
+    } else {
+      last = hit;
+    }
+  }
+
+  // Leaving the map counts as a hit, so there should be one either way
+  if (reverse) {
+    hit = first - 1;
+    while (hit >= lane_first && *hit >= u) {
+      hit--;
+    }
+    if (hit < lane_first) {
+      return max_range;
+    }
+    v = (u - *hit) * map->scale;
+  } else {
+    if (first == table->obstacles + table->lane_offsets[offset + 1]) {
+      return max_range;
+    }
+    v = (*first - u) * map->scale;
+  }
+  return v < max_range ? v : max_range;
+}
+
+
 // Extract a single range reading from the map.  Unknown cells and/or
 // out-of-bound cells are treated as occupied, which makes it easy to
 // use Stage bitmap files.
@@ -45,6 +138,10 @@ double map_calc_range(map_t * map, double ox, double oy, double oa, double max_r
   int tmp;
   int deltax, deltay, error, deltaerr;
 
+  if (map->range_table != NULL) {
+    return map_lookup_range(map, map->range_table, ox, oy, oa, max_range);
+  }
+
   x0 = MAP_GXWX(map, ox);
   y0 = MAP_GYWY(map, oy);
 
@@ -87,11 +184,11 @@ double map_calc_range(map_t * map, double ox, double oy, double oa, double max_r
   }
 
   if (steep) {
-    if (!MAP_VALID(map, y, x) || map->cells[MAP_INDEX(map, y, x)].occ_state > -1) {
+    if (!MAP_VALID(map, y, x) || map->occ_state[MAP_INDEX(map, y, x)] > -1) {
       return sqrt((x - x0) * (x - x0) + (y - y0) * (y - y0)) * map->scale;
     }
   } else {
-    if (!MAP_VALID(map, x, y) || map->cells[MAP_INDEX(map, x, y)].occ_state > -1) {
+    if (!MAP_VALID(map, x, y) || map->occ_state[MAP_INDEX(map, x, y)] > -1) {
       return sqrt((x - x0) * (x - x0) + (y - y0) * (y - y0)) * map->scale;
     }
   }
@@ -105,11 +202,11 @@ double map_calc_range(map_t * map, double ox, double oy, double oa, double max_r
     }
 
     if (steep) {
-      if (!MAP_VALID(map, y, x) || map->cells[MAP_INDEX(map, y, x)].occ_state > -1) {
+      if (!MAP_VALID(map, y, x) || map->occ_state[MAP_INDEX(map, y, x)] > -1) {
         return sqrt((x - x0) * (x - x0) + (y - y0) * (y - y0)) * map->scale;
       }
     } else {
-      if (!MAP_VALID(map, x, y) || map->cells[MAP_INDEX(map, x, y)].occ_state > -1) {
+      if (!MAP_VALID(map, x, y) || map->occ_state[MAP_INDEX(map, x, y)] > -1) {
         return sqrt((x - x0) * (x - x0) + (y - y0) * (y - y0)) * map->scale;
       }
     }
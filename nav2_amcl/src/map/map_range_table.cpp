@@ -0,0 +1,183 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "nav2_amcl/map/map.hpp"
+#include "nav2_util/thread_pool.hpp"
+
+namespace
+{
+
+// The obstacles of one bearing, before they are packed into the table
+struct Bearing
+{
+  int lane_min;
+  std::vector<int32_t> lane_offsets;
+  std::vector<float> obstacles;
+};
+
+// Whether a ray leaving a free cell can stop in cell (i, j): cells off the
+// map and cells that are not free count as obstacles
+bool isObstacle(map_t * map, int i, int j)
+{
+  return !MAP_VALID(map, i, j) || map->occ_state[MAP_INDEX(map, i, j)] > -1;
+}
+
+bool isFree(map_t * map, int i, int j)
+{
+  return !isObstacle(map, i, j);
+}
+
+// The obstacle cells, including the ring of cells just off the map, that a
+// ray from a free cell can reach. A ray passes through 8-connected cells, so
+// the first obstacle it meets always touches a free cell.
+std::vector<std::pair<int, int>> reachableObstacles(map_t * map)
+{
+  std::vector<std::pair<int, int>> cells;
+  for (int j = -1; j <= map->size_y; j++) {
+    for (int i = -1; i <= map->size_x; i++) {
+      if (!isObstacle(map, i, j)) {
+        continue;
+      }
+      bool reachable = false;
+      for (int dj = -1; dj <= 1 && !reachable; dj++) {
+        for (int di = -1; di <= 1 && !reachable; di++) {
+          reachable = isFree(map, i + di, j + dj);
+        }
+      }
+      if (reachable) {
+        cells.emplace_back(i, j);
+      }
+    }
+  }
+  return cells;
+}
+
+// Sorts the obstacles into the lanes of one bearing. Lane k holds every cell
+// whose footprint across the bearing covers k, so a ray from any point of the
+// lane is taken to hit the cells a ray along the middle of the lane would.
+void buildBearing(
+  map_t * map, const std::vector<std::pair<int, int>> & cells, double theta,
+  Bearing & bearing)
+{
+  double c = cos(theta);
+  double s = sin(theta);
+  double half_width = (fabs(c) + fabs(s)) / 2;
+
+  // The lanes covering the map and the ring around it
+  double v_min = std::min(
+    std::min(-s * -1 + c * -1, -s * map->size_x + c * -1),
+    std::min(-s * -1 + c * map->size_y, -s * map->size_x + c * map->size_y));
+  double v_max = std::max(
+    std::max(-s * -1 + c * -1, -s * map->size_x + c * -1),
+    std::max(-s * -1 + c * map->size_y, -s * map->size_x + c * map->size_y));
+  bearing.lane_min = static_cast<int>(floor(v_min - half_width + 0.5));
+  int lane_count = static_cast<int>(floor(v_max + half_width + 0.5)) - bearing.lane_min + 1;
+
+  // Counting sort of the obstacles by lane
+  bearing.lane_offsets.assign(lane_count + 1, 0);
+  auto lanes = [&](const std::pair<int, int> & cell, int & first, int & last) {
+      double v = cell.second * c - cell.first * s;
+      first = static_cast<int>(ceil(v - half_width)) - bearing.lane_min;
+      last = static_cast<int>(floor(v + half_width)) - bearing.lane_min;
+    };
+  int first, last;
+  for (const auto & cell : cells) {
+    lanes(cell, first, last);
+    for (int lane = first; lane <= last; lane++) {
+      bearing.lane_offsets[lane + 1]++;
+    }
+  }
+  for (int lane = 0; lane < lane_count; lane++) {
+    bearing.lane_offsets[lane + 1] += bearing.lane_offsets[lane];
+  }
+
+  std::vector<int32_t> next(bearing.lane_offsets.begin(), bearing.lane_offsets.end() - 1);
+  bearing.obstacles.resize(bearing.lane_offsets[lane_count]);
+  for (const auto & cell : cells) {
+    float u = static_cast<float>(cell.first * c + cell.second * s);
+    lanes(cell, first, last);
+    for (int lane = first; lane <= last; lane++) {
+      bearing.obstacles[next[lane]++] = u;
+    }
+  }
+  for (int lane = 0; lane < lane_count; lane++) {
+    std::sort(
+      bearing.obstacles.begin() + bearing.lane_offsets[lane],
+      bearing.obstacles.begin() + bearing.lane_offsets[lane + 1]);
+  }
+}
+
+}  // namespace
+
+// Build the range table, one bearing per task
+void map_update_range_table(map_t * map, int angle_count)
+{
+  map_free_range_table(map);
+
+  std::vector<std::pair<int, int>> cells = reachableObstacles(map);
+  std::vector<Bearing> bearings(angle_count);
+  nav2_util::ThreadPool pool;
+  pool.parallel_for(
+    angle_count, [&](size_t angle) {
+      buildBearing(map, cells, angle * M_PI / angle_count, bearings[angle]);
+    });
+
+  // Pack the bearings into one block, laid out as in a cache file
+  size_t lane_count = 0;
+  size_t obstacle_count = 0;
+  for (const Bearing & bearing : bearings) {
+    lane_count += bearing.lane_offsets.size() - 1;
+    obstacle_count += bearing.obstacles.size();
+  }
+  size_t size = (2 * angle_count + 1 + lane_count + 1) * sizeof(int32_t) +
+    obstacle_count * sizeof(float);
+  int32_t * data = static_cast<int32_t *>(malloc(size));
+
+  int32_t * lane_min = data;
+  int32_t * lane_start = lane_min + angle_count;
+  lane_start[0] = 0;
+  for (int angle = 0; angle < angle_count; angle++) {
+    lane_min[angle] = bearings[angle].lane_min;
+    lane_start[angle + 1] =
+      lane_start[angle] + static_cast<int32_t>(bearings[angle].lane_offsets.size() - 1);
+  }
+
+  map_range_table_t * table = map_range_table_wrap(data, 0, data, angle_count);
+  int32_t obstacle_offset = 0;
+  for (int angle = 0; angle < angle_count; angle++) {
+    const Bearing & bearing = bearings[angle];
+    int32_t * lane_offsets = table->lane_offsets + lane_start[angle];
+    for (size_t lane = 0; lane + 1 < bearing.lane_offsets.size(); lane++) {
+      lane_offsets[lane] = obstacle_offset + bearing.lane_offsets[lane];
+    }
+    std::copy(
+      bearing.obstacles.begin(), bearing.obstacles.end(),
+      table->obstacles + obstacle_offset);
+    obstacle_offset += static_cast<int32_t>(bearing.obstacles.size());
+  }
+  table->lane_offsets[lane_count] = obstacle_offset;
+
+  map->range_table = table;
+}
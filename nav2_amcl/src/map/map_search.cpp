@@ -0,0 +1,233 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#include <math.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "nav2_amcl/map/map.hpp"
+#include "nav2_util/thread_pool.hpp"
+
+namespace
+{
+
+// The coarsest level of the pyramid has blocks of 2^(LEVELS - 1) cells a side
+const int LEVELS = 7;
+
+// For each level k, the smallest occ_dist over the block of 2^k by 2^k cells
+// with its lowest corner at each cell. Corners lie as far below the map as a
+// block can start and still overlap it, everything else is off the map.
+struct Pyramid
+{
+  int pad;
+  int width, height;
+  std::vector<std::vector<uint8_t>> levels;
+
+  uint8_t at(int level, int i, int j) const
+  {
+    i += pad;
+    j += pad;
+    if (i < 0 || j < 0 || i >= width || j >= height) {
+      return MAP_OCC_DIST_MAX;
+    }
+    return levels[level][i + static_cast<size_t>(j) * width];
+  }
+};
+
+void buildPyramid(map_t * map, Pyramid & pyramid)
+{
+  pyramid.pad = (1 << (LEVELS - 1)) - 1;
+  pyramid.width = map->size_x + pyramid.pad;
+  pyramid.height = map->size_y + pyramid.pad;
+  pyramid.levels.assign(
+    LEVELS, std::vector<uint8_t>(static_cast<size_t>(pyramid.width) * pyramid.height));
+
+  for (int j = -pyramid.pad; j < map->size_y; j++) {
+    for (int i = -pyramid.pad; i < map->size_x; i++) {
+      pyramid.levels[0][(i + pyramid.pad) + static_cast<size_t>(j + pyramid.pad) * pyramid.width] =
+        MAP_VALID(map, i, j) ? map->occ_dist[MAP_DIST_INDEX(map, i, j)] : MAP_OCC_DIST_MAX;
+    }
+  }
+
+  for (int level = 1; level < LEVELS; level++) {
+    int half = 1 << (level - 1);
+    std::vector<uint8_t> & cells = pyramid.levels[level];
+    for (int j = -pyramid.pad; j < map->size_y; j++) {
+      for (int i = -pyramid.pad; i < map->size_x; i++) {
+        cells[(i + pyramid.pad) + static_cast<size_t>(j + pyramid.pad) * pyramid.width] = std::min(
+          std::min(pyramid.at(level - 1, i, j), pyramid.at(level - 1, i + half, j)),
+          std::min(pyramid.at(level - 1, i, j + half), pyramid.at(level - 1, i + half, j + half)));
+      }
+    }
+  }
+}
+
+// A block of candidate positions at one heading, and the most its poses can score
+struct Candidate
+{
+  int x, y;
+  int level;
+  double bound;
+};
+
+// Keeps the count best poses, best first, dropping any pose that is close to
+// a better one so the poses found are different places or headings
+void insertPose(
+  std::vector<map_pose_score_t> & poses, const map_pose_score_t & pose,
+  double separation, int count)
+{
+  auto near = [separation](const map_pose_score_t & a, const map_pose_score_t & b) {
+      double da = fabs(remainder(a.a - b.a, 2 * M_PI));
+      return hypot(a.x - b.x, a.y - b.y) < separation && da < M_PI / 4;
+    };
+
+  for (const map_pose_score_t & other : poses) {
+    if (other.score >= pose.score && near(other, pose)) {
+      return;
+    }
+  }
+  poses.erase(
+    std::remove_if(
+      poses.begin(), poses.end(),
+      [&](const map_pose_score_t & other) {return near(other, pose);}),
+    poses.end());
+  poses.insert(
+    std::upper_bound(
+      poses.begin(), poses.end(), pose,
+      [](const map_pose_score_t & a, const map_pose_score_t & b) {return a.score > b.score;}),
+    pose);
+  if (static_cast<int>(poses.size()) > count) {
+    poses.resize(count);
+  }
+}
+
+// Branch and bound over the positions at one heading. A block scores at most
+// what its points would if each of them ended in the cell closest to an
+// obstacle among those it can end in from anywhere in the block.
+void searchHeading(
+  map_t * map, const Pyramid & pyramid, const double * points, int point_count,
+  const double * dist_score, double theta, double separation, int count,
+  std::vector<map_pose_score_t> & poses)
+{
+  double c = cos(theta);
+  double s = sin(theta);
+  std::vector<std::pair<int, int>> offsets(point_count);
+  for (int k = 0; k < point_count; k++) {
+    double x = points[2 * k];
+    double y = points[2 * k + 1];
+    offsets[k].first = static_cast<int>(floor((c * x - s * y) / map->scale + 0.5));
+    offsets[k].second = static_cast<int>(floor((s * x + c * y) / map->scale + 0.5));
+  }
+
+  auto bound = [&](int level, int x, int y) {
+      double score = 0.0;
+      for (const auto & offset : offsets) {
+        score += dist_score[pyramid.at(level, x + offset.first, y + offset.second)];
+      }
+      return score;
+    };
+  auto by_bound = [](const Candidate & a, const Candidate & b) {return a.bound < b.bound;};
+
+  // Best block last, so it is the next off the stack
+  std::vector<Candidate> stack;
+  int top = LEVELS - 1;
+  for (int y = 0; y < map->size_y; y += 1 << top) {
+    for (int x = 0; x < map->size_x; x += 1 << top) {
+      stack.push_back({x, y, top, bound(top, x, y)});
+    }
+  }
+  std::sort(stack.begin(), stack.end(), by_bound);
+
+  Candidate children[4];
+  while (!stack.empty()) {
+    Candidate candidate = stack.back();
+    stack.pop_back();
+    if (static_cast<int>(poses.size()) == count && candidate.bound <= poses.back().score) {
+      continue;
+    }
+
+    if (candidate.level == 0) {
+      if (MAP_VALID(map, candidate.x, candidate.y) &&
+        map->occ_state[MAP_INDEX(map, candidate.x, candidate.y)] == -1)
+      {
+        map_pose_score_t pose;
+        pose.x = MAP_WXGX(map, candidate.x);
+        pose.y = MAP_WYGY(map, candidate.y);
+        pose.a = theta;
+        pose.score = candidate.bound;
+        insertPose(poses, pose, separation, count);
+      }
+      continue;
+    }
+
+    int level = candidate.level - 1;
+    int half = 1 << level;
+    int child_count = 0;
+    for (int dy = 0; dy <= half; dy += half) {
+      for (int dx = 0; dx <= half; dx += half) {
+        int x = candidate.x + dx;
+        int y = candidate.y + dy;
+        if (x < map->size_x && y < map->size_y) {
+          // insertion sort of the four children at most, worst first
+          Candidate child = {x, y, level, bound(level, x, y)};
+          int k = child_count++;
+          for (; k > 0 && by_bound(child, children[k - 1]); k--) {
+            children[k] = children[k - 1];
+          }
+          children[k] = child;
+        }
+      }
+    }
+    stack.insert(stack.end(), children, children + child_count);
+  }
+}
+
+}  // namespace
+
+// Search every heading on its own task, then merge what they found
+int map_search_poses(
+  map_t * map, const double * points, int point_count, const double * dist_score,
+  double angular_step, double separation, map_pose_score_t * poses, int count)
+{
+  if (count <= 0 || map->size_x <= 0 || map->size_y <= 0) {
+    return 0;
+  }
+
+  Pyramid pyramid;
+  buildPyramid(map, pyramid);
+
+  int heading_count = std::max(1, static_cast<int>(ceil(2 * M_PI / angular_step)));
+  std::vector<std::vector<map_pose_score_t>> found(heading_count);
+  nav2_util::ThreadPool pool;
+  pool.parallel_for(
+    heading_count, [&](size_t heading) {
+      searchHeading(
+        map, pyramid, points, point_count, dist_score, heading * 2 * M_PI / heading_count,
+        separation, count, found[heading]);
+    });
+
+  std::vector<map_pose_score_t> best;
+  for (const auto & heading : found) {
+    for (const map_pose_score_t & pose : heading) {
+      insertPose(best, pose, separation, count);
+    }
+  }
+  std::copy(best.begin(), best.end(), poses);
+  return static_cast<int>(best.size());
+}
@@ -26,10 +26,14 @@
 **************************************************************************/
 
 #include <errno.h>
+#include <fcntl.h>
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "nav2_amcl/map/map.hpp"
 
@@ -43,7 +47,6 @@ int map_load_occ(map_t * map, const char * filename, double scale, int negate)
   int i, j;
   int ch, occ;
   int width, height, depth;
-  map_cell_t * cell;
 
   // Open file
   file = fopen(filename, "r");
@@ -73,11 +76,11 @@ int map_load_occ(map_t * map, const char * filename, double scale, int negate)
   }
 
   // Allocate space in the map
-  if (map->cells == NULL) {
+  if (map->occ_state == NULL) {
     map->scale = scale;
     map->size_x = width;
     map->size_y = height;
-    map->cells = calloc(width * height, sizeof(map->cells[0]));
+    map_alloc_cells(map);
   } else {
     if (width != map->size_x || height != map->size_y) {
       // PLAYER_ERROR("map dimensions are inconsistent with prior map dimensions");
@@ -113,8 +116,7 @@ int map_load_occ(map_t * map, const char * filename, double scale, int negate)
       if (!MAP_VALID(map, i, j)) {
         continue;
       }
-      cell = map->cells + MAP_INDEX(map, i, j);
-      cell->occ_state = occ;
+      map->occ_state[MAP_INDEX(map, i, j)] = occ;
     }
   }
 
@@ -201,3 +203,278 @@ int map_load_wifi(map_t *map, const char *filename, int index)
   return 0;
 }
 */
+
+
+////////////////////////////////////////////////////////////////////////////
+// Likelihood field cache files: a header padded to a page, followed by the
+// tiles of occ_dist, which are mapped rather than read so only the pages of
+// the tiles the particles are on are loaded, and can be dropped again by the
+// kernel when memory is short
+
+#define MAP_CSPACE_MAGIC "AMCLCSP2"
+#define MAP_CSPACE_HEADER_SIZE 4096
+
+typedef struct
+{
+  char magic[8];
+  int32_t size_x, size_y;
+  double scale;
+  double max_occ_dist;
+} map_cspace_header_t;
+
+
+// Map the cspace distances of the map from a cache file
+int map_load_cspace(map_t * map, const char * filename, double max_occ_dist)
+{
+  int fd;
+  struct stat st;
+  void * data;
+  const map_cspace_header_t * header;
+
+  fd = open(filename, O_RDONLY);
+  if (fd < 0) {
+    return -1;
+  }
+
+  if (fstat(fd, &st) != 0 || (size_t) st.st_size != MAP_CSPACE_HEADER_SIZE + MAP_DIST_SIZE(map)) {
+    close(fd);
+    return -1;
+  }
+
+  data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    return -1;
+  }
+
+  header = (const map_cspace_header_t *) data;
+  if (memcmp(header->magic, MAP_CSPACE_MAGIC, sizeof(header->magic)) != 0 ||
+    header->size_x != map->size_x || header->size_y != map->size_y ||
+    header->scale != map->scale || header->max_occ_dist != max_occ_dist)
+  {
+    munmap(data, st.st_size);
+    return -1;
+  }
+
+  // The particles read scattered cells, reading ahead would only load tiles
+  // nobody asked for
+  madvise(data, st.st_size, MADV_RANDOM);
+
+  map_free_occ_dist(map);
+  map->occ_dist = (uint8_t *) data + MAP_CSPACE_HEADER_SIZE;
+  map->occ_dist_mapping = data;
+  map->occ_dist_mapping_size = st.st_size;
+  map->max_occ_dist = max_occ_dist;
+  return 0;
+}
+
+
+// Save the cspace distances of the map to a cache file
+int map_save_cspace(map_t * map, const char * filename)
+{
+  FILE * file;
+  char * tmp_filename;
+  char header[MAP_CSPACE_HEADER_SIZE];
+  map_cspace_header_t * fields = (map_cspace_header_t *) header;
+  size_t size;
+  int ok;
+
+  // Written next to the final file and renamed, so a reader never sees half of it
+  tmp_filename = malloc(strlen(filename) + 5);
+  sprintf(tmp_filename, "%s.tmp", filename);
+
+  file = fopen(tmp_filename, "wb");
+  if (file == NULL) {
+    fprintf(stderr, "%s: %s\n", strerror(errno), tmp_filename);
+    free(tmp_filename);
+    return -1;
+  }
+
+  memset(header, 0, sizeof(header));
+  memcpy(fields->magic, MAP_CSPACE_MAGIC, sizeof(fields->magic));
+  fields->size_x = map->size_x;
+  fields->size_y = map->size_y;
+  fields->scale = map->scale;
+  fields->max_occ_dist = map->max_occ_dist;
+
+  size = MAP_DIST_SIZE(map);
+  ok = fwrite(header, sizeof(header), 1, file) == 1 &&
+    fwrite(map->occ_dist, 1, size, file) == size;
+  ok = fclose(file) == 0 && ok;
+
+  if (!ok || rename(tmp_filename, filename) != 0) {
+    fprintf(stderr, "%s: %s\n", strerror(errno), filename);
+    remove(tmp_filename);
+    free(tmp_filename);
+    return -1;
+  }
+
+  free(tmp_filename);
+  return 0;
+}
+
+
+// Free the cspace distances of the map
+void map_free_occ_dist(map_t * map)
+{
+  if (map->occ_dist_mapping != NULL) {
+    munmap(map->occ_dist_mapping, map->occ_dist_mapping_size);
+  } else {
+    map_free_buffer(map->occ_dist);
+  }
+  map->occ_dist = NULL;
+  map->occ_dist_mapping = NULL;
+  map->occ_dist_mapping_size = 0;
+}
+
+
+// Copy occ_dist out of the cache file it is mapped from
+int map_copy_occ_dist(map_t * map)
+{
+  size_t dist_size = MAP_DIST_SIZE(map);
+  uint8_t * occ_dist;
+
+  if (map->occ_dist_mapping == NULL) {
+    return 0;
+  }
+  occ_dist = (uint8_t *) map_alloc_buffer(dist_size * sizeof(occ_dist[0]));
+  if (occ_dist == NULL) {
+    return -1;
+  }
+  memcpy(occ_dist, map->occ_dist, dist_size * sizeof(occ_dist[0]));
+  munmap(map->occ_dist_mapping, map->occ_dist_mapping_size);
+  map->occ_dist = occ_dist;
+  map->occ_dist_mapping = NULL;
+  map->occ_dist_mapping_size = 0;
+  return 0;
+}
+
+
+////////////////////////////////////////////////////////////////////////////
+// Range table cache files: a header followed by the block of arrays of the
+// table, which is mapped rather than read so only the pages used are loaded
+
+#define MAP_RANGE_TABLE_MAGIC "AMCLRNG1"
+
+typedef struct
+{
+  char magic[8];
+  int32_t size_x, size_y;
+  double scale;
+  int32_t angle_count;
+  int32_t lane_count;
+  int64_t obstacle_count;
+} map_range_table_header_t;
+
+
+// Map the range table of the map from a cache file
+int map_load_range_table(map_t * map, const char * filename, int angle_count)
+{
+  int fd;
+  struct stat st;
+  void * data;
+  const map_range_table_header_t * header;
+  size_t size;
+
+  fd = open(filename, O_RDONLY);
+  if (fd < 0) {
+    return -1;
+  }
+
+  if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(map_range_table_header_t)) {
+    close(fd);
+    return -1;
+  }
+
+  data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    return -1;
+  }
+
+  header = (const map_range_table_header_t *) data;
+  size = sizeof(map_range_table_header_t) +
+    (2 * (size_t) header->angle_count + 1 + (size_t) header->lane_count + 1) * sizeof(int32_t) +
+    (size_t) header->obstacle_count * sizeof(float);
+  if (memcmp(header->magic, MAP_RANGE_TABLE_MAGIC, sizeof(header->magic)) != 0 ||
+    header->size_x != map->size_x || header->size_y != map->size_y ||
+    header->scale != map->scale || header->angle_count != angle_count ||
+    header->lane_count < 0 || header->obstacle_count < 0 || (size_t) st.st_size != size)
+  {
+    munmap(data, st.st_size);
+    return -1;
+  }
+
+  map_free_range_table(map);
+  map->range_table = map_range_table_wrap(data, st.st_size, header + 1, angle_count);
+  return 0;
+}
+
+
+// Save the range table of the map to a cache file
+int map_save_range_table(map_t * map, const char * filename)
+{
+  FILE * file;
+  char * tmp_filename;
+  map_range_table_header_t header;
+  map_range_table_t * table = map->range_table;
+  size_t size;
+  int ok;
+
+  if (table == NULL) {
+    return -1;
+  }
+
+  // Written next to the final file and renamed, so a reader never sees half of it
+  tmp_filename = malloc(strlen(filename) + 5);
+  sprintf(tmp_filename, "%s.tmp", filename);
+
+  file = fopen(tmp_filename, "wb");
+  if (file == NULL) {
+    fprintf(stderr, "%s: %s\n", strerror(errno), tmp_filename);
+    free(tmp_filename);
+    return -1;
+  }
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, MAP_RANGE_TABLE_MAGIC, sizeof(header.magic));
+  header.size_x = map->size_x;
+  header.size_y = map->size_y;
+  header.scale = map->scale;
+  header.angle_count = table->angle_count;
+  header.lane_count = table->lane_start[table->angle_count];
+  header.obstacle_count = table->lane_offsets[header.lane_count];
+
+  size = (char *) (table->obstacles + header.obstacle_count) - (char *) table->lane_min;
+  ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+    fwrite(table->lane_min, 1, size, file) == size;
+  ok = fclose(file) == 0 && ok;
+
+  if (!ok || rename(tmp_filename, filename) != 0) {
+    fprintf(stderr, "%s: %s\n", strerror(errno), filename);
+    remove(tmp_filename);
+    free(tmp_filename);
+    return -1;
+  }
+
+  free(tmp_filename);
+  return 0;
+}
+
+
+// Free the range table of the map
+void map_free_range_table(map_t * map)
+{
+  if (map->range_table == NULL) {
+    return;
+  }
+
+  if (map->range_table->mapping_size != 0) {
+    munmap(map->range_table->data, map->range_table->mapping_size);
+  } else {
+    free(map->range_table->data);
+  }
+  free(map->range_table->directions);
+  free(map->range_table);
+  map->range_table = NULL;
+}
@@ -53,7 +53,6 @@ DifferentialMotionModel::odometryUpdate(
 
   // Implement sample_motion_odometry (Prob Rob p 136)
   double delta_rot1, delta_trans, delta_rot2;
-  double delta_rot1_hat, delta_trans_hat, delta_rot2_hat;
   double delta_rot1_noise, delta_rot2_noise;
 
   // Avoid computing a bearing from two poses that are extremely near each
@@ -83,36 +82,39 @@ DifferentialMotionModel::odometryUpdate(
     fabs(angleutils::angle_diff(delta_rot2, 0.0)),
     fabs(angleutils::angle_diff(delta_rot2, M_PI)));
 
-  for (int i = 0; i < set->sample_count; i++) {
-    pf_sample_t * sample = set->samples + i;
-
-    // Sample pose differences
-    delta_rot1_hat = angleutils::angle_diff(
-      delta_rot1,
-      pf_ran_gaussian(
-        sqrt(
-          alpha1_ * delta_rot1_noise * delta_rot1_noise +
-          alpha2_ * delta_trans * delta_trans)));
-    delta_trans_hat = delta_trans -
-      pf_ran_gaussian(
-      sqrt(
-        alpha3_ * delta_trans * delta_trans +
-        alpha4_ * delta_rot1_noise * delta_rot1_noise +
-        alpha4_ * delta_rot2_noise * delta_rot2_noise));
-    delta_rot2_hat = angleutils::angle_diff(
-      delta_rot2,
-      pf_ran_gaussian(
-        sqrt(
-          alpha1_ * delta_rot2_noise * delta_rot2_noise +
-          alpha2_ * delta_trans * delta_trans)));
-
-    // Apply sampled update to particle pose
-    sample->pose.v[0] += delta_trans_hat *
-      cos(sample->pose.v[2] + delta_rot1_hat);
-    sample->pose.v[1] += delta_trans_hat *
-      sin(sample->pose.v[2] + delta_rot1_hat);
-    sample->pose.v[2] += delta_rot1_hat + delta_rot2_hat;
-  }
+  double rot1_stddev = sqrt(
+    alpha1_ * delta_rot1_noise * delta_rot1_noise +
+    alpha2_ * delta_trans * delta_trans);
+  double trans_stddev = sqrt(
+    alpha3_ * delta_trans * delta_trans +
+    alpha4_ * delta_rot1_noise * delta_rot1_noise +
+    alpha4_ * delta_rot2_noise * delta_rot2_noise);
+  double rot2_stddev = sqrt(
+    alpha1_ * delta_rot2_noise * delta_rot2_noise +
+    alpha2_ * delta_trans * delta_trans);
+
+  moveSamples(
+    set->sample_count, 3, [&](int begin, int end, const double * noise) {
+      const double * rot1_noise = noise;
+      const double * trans_noise = noise + (end - begin);
+      const double * rot2_noise = noise + 2 * (end - begin);
+
+      for (int i = begin; i < end; i++) {
+        int n = i - begin;
+
+        // Sample pose differences
+        double delta_rot1_hat = angleutils::angle_diff(
+          delta_rot1, rot1_stddev * rot1_noise[n]);
+        double delta_trans_hat = delta_trans - trans_stddev * trans_noise[n];
+        double delta_rot2_hat = angleutils::angle_diff(
+          delta_rot2, rot2_stddev * rot2_noise[n]);
+
+        // Apply sampled update to particle pose
+        set->x[i] += delta_trans_hat * cos(set->theta[i] + delta_rot1_hat);
+        set->y[i] += delta_trans_hat * sin(set->theta[i] + delta_rot1_hat);
+        set->theta[i] = pf_sample_angle(set->theta[i] + delta_rot1_hat + delta_rot2_hat);
+      }
+    });
 }
 
 }  // namespace nav2_amcl
@@ -16,11 +16,118 @@
 
 #include "nav2_amcl/motion_model/motion_model.hpp"
 
+#include <math.h>
+#include <algorithm>
+#include <random>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace nav2_amcl
 {
 
+namespace
+{
+
+// SplitMix64, only used to seed the generators below from a single counter
+uint64_t splitMix64(uint64_t & x)
+{
+  uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+// xoshiro256+, which is much faster than drand48 and good enough for doubles
+class Xoshiro256Plus
+{
+public:
+  explicit Xoshiro256Plus(uint64_t seed)
+  {
+    for (uint64_t & word : s_) {
+      word = splitMix64(seed);
+    }
+  }
+
+  // Uniform in (0, 1], so its log is always finite
+  inline double uniform()
+  {
+    const uint64_t result = s_[0] + s_[3];
+    const uint64_t t = s_[1] << 17;
+    s_[2] ^= s_[0];
+    s_[3] ^= s_[1];
+    s_[1] ^= s_[2];
+    s_[0] ^= s_[3];
+    s_[2] ^= t;
+    s_[3] = (s_[3] << 45) | (s_[3] >> 19);
+    return static_cast<double>((result >> 11) + 1) * (1.0 / 9007199254740992.0);
+  }
+
+private:
+  uint64_t s_[4];
+};
+
+// Fills out[0, 2 * pairs) with standard gaussian draws, by the basic
+// Box-Muller transform. Unlike the polar form in pf_ran_gaussian it has no
+// rejection loop, so after the uniforms are drawn it is straight loops over
+// the arrays.
+void fillGaussian(Xoshiro256Plus & rng, int pairs, double * out)
+{
+  for (int i = 0; i < 2 * pairs; i++) {
+    out[i] = rng.uniform();
+  }
+  for (int i = 0; i < pairs; i++) {
+    double r = sqrt(-2.0 * log(out[i]));
+    double a = 2.0 * M_PI * out[pairs + i];
+    out[i] = r * cos(a);
+    out[pairs + i] = r * sin(a);
+  }
+}
+
+}  // namespace
+
+MotionModel::MotionModel()
+: seed_(std::random_device{}()), update_count_(0)
+{
+  seed_ = (seed_ << 32) ^ std::random_device{}();
+}
+
+void
+MotionModel::setThreadPool(std::shared_ptr<nav2_util::ThreadPool> pool)
+{
+  pool_ = std::move(pool);
+}
+
+void
+MotionModel::moveSamples(
+  int sample_count, int noise_count,
+  const std::function<void(int begin, int end, const double * noise)> & move)
+{
+  int chunks = (sample_count + sample_chunk_size - 1) / sample_chunk_size;
+  uint64_t stream = seed_ + update_count_++ * 0x100000000ULL;
+
+  auto move_chunk = [&](std::size_t chunk) {
+      int begin = static_cast<int>(chunk) * sample_chunk_size;
+      int end = std::min(begin + sample_chunk_size, sample_count);
+      uint64_t chunk_stream = stream + chunk;
+      Xoshiro256Plus rng(splitMix64(chunk_stream));
+
+      static thread_local std::vector<double> noise;
+      int pairs = (noise_count * (end - begin) + 1) / 2;
+      noise.resize(2 * pairs);
+      fillGaussian(rng, pairs, noise.data());
+      move(begin, end, noise.data());
+    };
+
+  if (!pool_ || pool_->size() < 2 || chunks < 2) {
+    for (int chunk = 0; chunk < chunks; chunk++) {
+      move_chunk(chunk);
+    }
+    return;
+  }
+  pool_->parallel_for(chunks, move_chunk);
+}
+
 MotionModel *
 MotionModel::createMotionModel(
   std::string & type, double alpha1, double alpha2,
@@ -49,8 +49,7 @@ OmniMotionModel::odometryUpdate(pf_t * pf, const pf_vector_t & pose, const pf_ve
   set = pf->sets + pf->current_set;
   pf_vector_t old_pose = pf_vector_sub(pose, delta);
 
-  double delta_trans, delta_rot, delta_bearing;
-  double delta_trans_hat, delta_rot_hat, delta_strafe_hat;
+  double delta_trans, delta_rot;
 
   delta_trans = sqrt(
     delta.v[0] * delta.v[0] +
@@ -68,26 +67,35 @@ OmniMotionModel::odometryUpdate(pf_t * pf, const pf_vector_t & pose, const pf_ve
     alpha4_ * (delta_rot * delta_rot) +
     alpha5_ * (delta_trans * delta_trans) );
 
-  for (int i = 0; i < set->sample_count; i++) {
-    pf_sample_t * sample = set->samples + i;
+  // The bearing of the motion relative to the heading of each sample
+  double delta_bearing = angleutils::angle_diff(
+    atan2(delta.v[1], delta.v[0]),
+    old_pose.v[2]);
 
-    delta_bearing = angleutils::angle_diff(
-      atan2(delta.v[1], delta.v[0]),
-      old_pose.v[2]) + sample->pose.v[2];
-    double cs_bearing = cos(delta_bearing);
-    double sn_bearing = sin(delta_bearing);
+  moveSamples(
+    set->sample_count, 3, [&](int begin, int end, const double * noise) {
+      const double * trans_noise = noise;
+      const double * rot_noise = noise + (end - begin);
+      const double * strafe_noise = noise + 2 * (end - begin);
 
-    // Sample pose differences
-    delta_trans_hat = delta_trans + pf_ran_gaussian(trans_hat_stddev);
-    delta_rot_hat = delta_rot + pf_ran_gaussian(rot_hat_stddev);
-    delta_strafe_hat = 0 + pf_ran_gaussian(strafe_hat_stddev);
-    // Apply sampled update to particle pose
-    sample->pose.v[0] += (delta_trans_hat * cs_bearing +
-      delta_strafe_hat * sn_bearing);
-    sample->pose.v[1] += (delta_trans_hat * sn_bearing -
-      delta_strafe_hat * cs_bearing);
-    sample->pose.v[2] += delta_rot_hat;
-  }
+      for (int i = begin; i < end; i++) {
+        int n = i - begin;
+
+        double cs_bearing = cos(delta_bearing + set->theta[i]);
+        double sn_bearing = sin(delta_bearing + set->theta[i]);
+
+        // Sample pose differences
+        double delta_trans_hat = delta_trans + trans_hat_stddev * trans_noise[n];
+        double delta_rot_hat = delta_rot + rot_hat_stddev * rot_noise[n];
+        double delta_strafe_hat = 0 + strafe_hat_stddev * strafe_noise[n];
+        // Apply sampled update to particle pose
+        set->x[i] += (delta_trans_hat * cs_bearing +
+          delta_strafe_hat * sn_bearing);
+        set->y[i] += (delta_trans_hat * sn_bearing -
+          delta_strafe_hat * cs_bearing);
+        set->theta[i] = pf_sample_angle(set->theta[i] + delta_rot_hat);
+      }
+    });
 }
 
 }  // namespace nav2_amcl
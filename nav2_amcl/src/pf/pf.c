@@ -29,6 +29,7 @@
 #include <assert.h>
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 #include "nav2_amcl/pf/pf.hpp"
@@ -40,6 +41,9 @@
 // with samples in them.
 static int pf_resample_limit(pf_t * pf, int k);
 
+// Draw max_samples samples evenly spaced through the cumulative weights c
+static void pf_systematic_draws(pf_t * pf, const double * c, int count, int * indices);
+
 
 // Create a new filter
 pf_t * pf_alloc(
@@ -48,9 +52,9 @@ pf_t * pf_alloc(
   pf_init_model_fn_t random_pose_fn, void * random_pose_data)
 {
   int i, j;
+  size_t stride;
   pf_t * pf;
   pf_sample_set_t * set;
-  pf_sample_t * sample;
 
   srand48(time(NULL));
 
@@ -76,14 +80,20 @@ pf_t * pf_alloc(
     set = pf->sets + j;
 
     set->sample_count = max_samples;
-    set->samples = calloc(max_samples, sizeof(pf_sample_t));
+
+    // Each field rounded up to a whole number of 64 byte cache lines, in
+    // single as well as double precision
+    stride = ((size_t) max_samples + 15) & ~(size_t) 15;
+    set->x = aligned_alloc(64, stride * (3 * sizeof(pf_real_t) + sizeof(double)));
+    set->y = set->x + stride;
+    set->theta = set->y + stride;
+    set->weight = (double *) (set->theta + stride);
 
     for (i = 0; i < set->sample_count; i++) {
-      sample = set->samples + i;
-      sample->pose.v[0] = 0.0;
-      sample->pose.v[1] = 0.0;
-      sample->pose.v[2] = 0.0;
-      sample->weight = 1.0 / max_samples;
+      set->x[i] = 0.0;
+      set->y[i] = 0.0;
+      set->theta[i] = 0.0;
+      set->weight[i] = 1.0 / max_samples;
     }
 
     // HACK: is 3 times max_samples enough?
@@ -103,6 +113,11 @@ pf_t * pf_alloc(
   pf->alpha_slow = alpha_slow;
   pf->alpha_fast = alpha_fast;
 
+  pf->resample_method = PF_RESAMPLE_MULTINOMIAL;
+  pf->resample_cumulative = calloc(max_samples + 1, sizeof(double));
+  pf->resample_indices = calloc(max_samples, sizeof(int));
+  pf->cluster_labels = calloc(max_samples, sizeof(int));
+
   // set converged to 0
   pf_init_converged(pf);
 
@@ -117,17 +132,111 @@ void pf_free(pf_t * pf)
   for (i = 0; i < 2; i++) {
     free(pf->sets[i].clusters);
     pf_kdtree_free(pf->sets[i].kdtree);
-    free(pf->sets[i].samples);
+    free(pf->sets[i].x);
   }
+  free(pf->resample_cumulative);
+  free(pf->resample_indices);
+  free(pf->cluster_labels);
+  free(pf->cluster_sums);
   free(pf);
 }
 
+// Change the number of samples of an existing filter, keeping its particles
+void pf_resize(pf_t * pf, int min_samples, int max_samples)
+{
+  int i, j, count;
+  size_t stride;
+  double total;
+  double * c;
+  int * indices;
+  pf_real_t * fields;
+  pf_sample_set_t * set;
+
+  pf->min_samples = min_samples;
+  if (max_samples == pf->max_samples) {
+    return;
+  }
+  pf->max_samples = max_samples;
+
+  stride = ((size_t) max_samples + 15) & ~(size_t) 15;
+  for (j = 0; j < 2; j++) {
+    set = pf->sets + j;
+    fields = aligned_alloc(64, stride * (3 * sizeof(pf_real_t) + sizeof(double)));
+
+    if (set->sample_count > max_samples) {
+      // Too many samples for the new size: resample them into it with systematic draws,
+      // which keeps the distribution rather than dropping the last samples. The scratch
+      // buffers are still sized for the old set.
+      c = pf->resample_cumulative;
+      indices = pf->resample_indices;
+      c[0] = 0.0;
+      for (i = 0; i < set->sample_count; i++) {
+        c[i + 1] = c[i] + set->weight[i];
+      }
+      if (c[set->sample_count] <= 0.0) {
+        for (i = 0; i < set->sample_count; i++) {
+          c[i + 1] = i + 1;
+        }
+      }
+      pf_systematic_draws(pf, c, set->sample_count, indices);
+      count = max_samples;
+      for (i = 0; i < count; i++) {
+        fields[i] = set->x[indices[i]];
+        fields[stride + i] = set->y[indices[i]];
+        fields[2 * stride + i] = set->theta[indices[i]];
+        ((double *) (fields + 3 * stride))[i] = 1.0;
+      }
+    } else {
+      // All the samples fit into fields of the new size
+      count = set->sample_count;
+      memcpy(fields, set->x, count * sizeof(pf_real_t));
+      memcpy(fields + stride, set->y, count * sizeof(pf_real_t));
+      memcpy(fields + 2 * stride, set->theta, count * sizeof(pf_real_t));
+      memcpy(fields + 3 * stride, set->weight, count * sizeof(double));
+    }
+    free(set->x);
+    set->x = fields;
+    set->y = set->x + stride;
+    set->theta = set->y + stride;
+    set->weight = (double *) (set->theta + stride);
+    set->sample_count = count;
+
+    total = 0.0;
+    for (i = 0; i < count; i++) {
+      total += set->weight[i];
+    }
+    for (i = 0; i < count; i++) {
+      set->weight[i] = total > 0.0 ? set->weight[i] / total : 1.0 / count;
+    }
+
+    // The histogram is sized by max_samples too
+    pf_kdtree_free(set->kdtree);
+    set->kdtree = pf_kdtree_alloc(3 * max_samples);
+    for (i = 0; i < count; i++) {
+      pf_kdtree_insert(set->kdtree, pf_get_sample_pose(set, i), set->weight[i]);
+    }
+
+    free(set->clusters);
+    set->cluster_count = 0;
+    set->cluster_max_count = max_samples;
+    set->clusters = calloc(set->cluster_max_count, sizeof(pf_cluster_t));
+    set->stats_stale = 1;
+  }
+
+  free(pf->resample_cumulative);
+  free(pf->resample_indices);
+  free(pf->cluster_labels);
+  pf->resample_cumulative = calloc(max_samples + 1, sizeof(double));
+  pf->resample_indices = calloc(max_samples, sizeof(int));
+  pf->cluster_labels = calloc(max_samples, sizeof(int));
+}
+
 // Initialize the filter using a guassian
 void pf_init(pf_t * pf, pf_vector_t mean, pf_matrix_t cov)
 {
   int i;
   pf_sample_set_t * set;
-  pf_sample_t * sample;
+  pf_vector_t pose;
   pf_pdf_gaussian_t * pdf;
 
   set = pf->sets + pf->current_set;
@@ -141,20 +250,20 @@ void pf_init(pf_t * pf, pf_vector_t mean, pf_matrix_t cov)
 
   // Compute the new sample poses
   for (i = 0; i < set->sample_count; i++) {
-    sample = set->samples + i;
-    sample->weight = 1.0 / pf->max_samples;
-    sample->pose = pf_pdf_gaussian_sample(pdf);
+    set->weight[i] = 1.0 / pf->max_samples;
+    pose = pf_pdf_gaussian_sample(pdf);
+    pf_set_sample_pose(set, i, pose);
 
-    // Add sample to histogram
-    pf_kdtree_insert(set->kdtree, sample->pose, sample->weight);
+    // Add sample to histogram, as stored, so that looking it up finds the same leaf
+    pf_kdtree_insert(set->kdtree, pf_get_sample_pose(set, i), set->weight[i]);
   }
 
   pf->w_slow = pf->w_fast = 0.0;
 
   pf_pdf_gaussian_free(pdf);
 
-  // Re-compute cluster statistics
-  pf_cluster_stats(pf, set);
+  // Re-compute cluster statistics once they are needed
+  set->stats_stale = 1;
 
   // set converged to 0
   pf_init_converged(pf);
@@ -166,7 +275,7 @@ void pf_init_model(pf_t * pf, pf_init_model_fn_t init_fn, void * init_data)
 {
   int i;
   pf_sample_set_t * set;
-  pf_sample_t * sample;
+  pf_vector_t pose;
 
   set = pf->sets + pf->current_set;
 
@@ -177,18 +286,18 @@ void pf_init_model(pf_t * pf, pf_init_model_fn_t init_fn, void * init_data)
 
   // Compute the new sample poses
   for (i = 0; i < set->sample_count; i++) {
-    sample = set->samples + i;
-    sample->weight = 1.0 / pf->max_samples;
-    sample->pose = (*init_fn)(init_data);
+    set->weight[i] = 1.0 / pf->max_samples;
+    pose = (*init_fn)(init_data);
+    pf_set_sample_pose(set, i, pose);
 
-    // Add sample to histogram
-    pf_kdtree_insert(set->kdtree, sample->pose, sample->weight);
+    // Add sample to histogram, as stored, so that looking it up finds the same leaf
+    pf_kdtree_insert(set->kdtree, pf_get_sample_pose(set, i), set->weight[i]);
   }
 
   pf->w_slow = pf->w_fast = 0.0;
 
-  // Re-compute cluster statistics
-  pf_cluster_stats(pf, set);
+  // Re-compute cluster statistics once they are needed
+  set->stats_stale = 1;
 
   // set converged to 0
   pf_init_converged(pf);
@@ -206,24 +315,20 @@ int pf_update_converged(pf_t * pf)
 {
   int i;
   pf_sample_set_t * set;
-  pf_sample_t * sample;
 
   set = pf->sets + pf->current_set;
   double mean_x = 0, mean_y = 0;
 
   for (i = 0; i < set->sample_count; i++) {
-    sample = set->samples + i;
-
-    mean_x += sample->pose.v[0];
-    mean_y += sample->pose.v[1];
+    mean_x += set->x[i];
+    mean_y += set->y[i];
   }
   mean_x /= set->sample_count;
   mean_y /= set->sample_count;
 
   for (i = 0; i < set->sample_count; i++) {
-    sample = set->samples + i;
-    if (fabs(sample->pose.v[0] - mean_x) > pf->dist_threshold ||
-      fabs(sample->pose.v[1] - mean_y) > pf->dist_threshold)
+    if (fabs(set->x[i] - mean_x) > pf->dist_threshold ||
+      fabs(set->y[i] - mean_y) > pf->dist_threshold)
     {
       set->converged = 0;
       pf->converged = 0;
@@ -240,6 +345,8 @@ void pf_update_action(pf_t * pf, pf_action_model_fn_t action_fn, void * action_d
 {
   pf_sample_set_t * set;
 
+  // The statistics are of the samples before they move
+  pf_update_cluster_stats(pf);
   set = pf->sets + pf->current_set;
 
   (*action_fn)(action_data, set);
@@ -250,9 +357,10 @@ void pf_update_sensor(pf_t * pf, pf_sensor_model_fn_t sensor_fn, void * sensor_d
 {
   int i;
   pf_sample_set_t * set;
-  pf_sample_t * sample;
   double total;
 
+  // The statistics are of the weights before they change
+  pf_update_cluster_stats(pf);
   set = pf->sets + pf->current_set;
 
   // Compute the sample weights
@@ -262,9 +370,8 @@ void pf_update_sensor(pf_t * pf, pf_sensor_model_fn_t sensor_fn, void * sensor_d
     // Normalize weights
     double w_avg = 0.0;
     for (i = 0; i < set->sample_count; i++) {
-      sample = set->samples + i;
-      w_avg += sample->weight;
-      sample->weight /= total;
+      w_avg += set->weight[i];
+      set->weight[i] /= total;
     }
     // Update running averages of likelihood of samples (Prob Rob p258)
     w_avg /= set->sample_count;
@@ -281,9 +388,44 @@ void pf_update_sensor(pf_t * pf, pf_sensor_model_fn_t sensor_fn, void * sensor_d
   } else {
     // Handle zero total
     for (i = 0; i < set->sample_count; i++) {
-      sample = set->samples + i;
-      sample->weight = 1.0 / set->sample_count;
+      set->weight[i] = 1.0 / set->sample_count;
+    }
+  }
+}
+
+
+// Find the sample whose part of the cumulative weights c holds r, c[0] <= r < c[count]
+static int pf_find_sample(const double * c, int count, double r)
+{
+  int lo = 0, hi = count;
+
+  // c[lo] <= r < c[hi]
+  while (hi - lo > 1) {
+    int mid = lo + (hi - lo) / 2;
+    if (c[mid] <= r) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+// Fill indices with the samples picked by max_samples evenly spaced draws
+// through the cumulative weights c
+static void pf_systematic_draws(pf_t * pf, const double * c, int count, int * indices)
+{
+  int i, m;
+  double step, u;
+
+  step = c[count] / pf->max_samples;
+  u = drand48() * step;
+  i = 0;
+  for (m = 0; m < pf->max_samples; m++, u += step) {
+    while (i < count - 1 && c[i + 1] <= u) {
+      i++;
     }
+    indices[m] = i;
   }
 }
 
@@ -294,12 +436,12 @@ void pf_update_resample(pf_t * pf)
   int i;
   double total;
   pf_sample_set_t * set_a, * set_b;
-  pf_sample_t * sample_a, * sample_b;
+  pf_vector_t pose;
+  int b;
 
-  // double r,c,U;
-  // int m;
-  // double count_inv;
   double * c;
+  int * indices;
+  int draws;
 
   double w_diff;
 
@@ -307,12 +449,16 @@ void pf_update_resample(pf_t * pf)
   set_b = pf->sets + (pf->current_set + 1) % 2;
 
   // Build up cumulative probability table for resampling.
-  // TODO(?): Replace this with a more efficient procedure
-  // (e.g., http://www.network-theory.co.uk/docs/gslref/GeneralDiscreteDistributions.html)
-  c = (double *)malloc(sizeof(double) * (set_a->sample_count + 1));
+  c = pf->resample_cumulative;
   c[0] = 0.0;
   for (i = 0; i < set_a->sample_count; i++) {
-    c[i + 1] = c[i] + set_a->samples[i].weight;
+    c[i + 1] = c[i] + set_a->weight[i];
+  }
+
+  indices = pf->resample_indices;
+  draws = 0;
+  if (pf->resample_method == PF_RESAMPLE_SYSTEMATIC) {
+    pf_systematic_draws(pf, c, set_a->sample_count, indices);
   }
 
   // Create the kd tree for adaptive sampling
@@ -328,69 +474,37 @@ void pf_update_resample(pf_t * pf)
   }
   // printf("w_diff: %9.6f\n", w_diff);
 
-  // Can't (easily) combine low-variance sampler with KLD adaptive
-  // sampling, so we'll take the more traditional route.
-  /*
-  // Low-variance resampler, taken from Probabilistic Robotics, p110
-  count_inv = 1.0/set_a->sample_count;
-  r = drand48() * count_inv;
-  c = set_a->samples[0].weight;
-  i = 0;
-  m = 0;
-  */
   while (set_b->sample_count < pf->max_samples) {
-    sample_b = set_b->samples + set_b->sample_count++;
+    b = set_b->sample_count++;
 
     if (drand48() < w_diff) {
-      sample_b->pose = (pf->random_pose_fn)(pf->random_pose_data);
+      pose = (pf->random_pose_fn)(pf->random_pose_data);
     } else {
-      // Can't (easily) combine low-variance sampler with KLD adaptive
-      // sampling, so we'll take the more traditional route.
-      /*
-      // Low-variance resampler, taken from Probabilistic Robotics, p110
-      U = r + m * count_inv;
-      while(U>c)
-      {
-        i++;
-        // Handle wrap-around by resetting counters and picking a new random
-        // number
-        if(i >= set_a->sample_count)
-        {
-          r = drand48() * count_inv;
-          c = set_a->samples[0].weight;
-          i = 0;
-          m = 0;
-          U = r + m * count_inv;
-          continue;
-        }
-        c += set_a->samples[i].weight;
-      }
-      m++;
-      */
-
-      // Naive discrete event sampler
-      double r;
-      r = drand48();
-      for (i = 0; i < set_a->sample_count; i++) {
-        if ((c[i] <= r) && (r < c[i + 1])) {
-          break;
-        }
+      if (pf->resample_method == PF_RESAMPLE_SYSTEMATIC) {
+        // Take one of the remaining draws at random (a partial Fisher-Yates
+        // shuffle), so that any number of them is spread like all of them
+        int j = draws + (int) (drand48() * (pf->max_samples - draws));
+        int swap = indices[j];
+        indices[j] = indices[draws];
+        indices[draws] = swap;
+        i = indices[draws++];
+      } else {
+        i = pf_find_sample(c, set_a->sample_count, drand48() * c[set_a->sample_count]);
       }
       assert(i < set_a->sample_count);
 
-      sample_a = set_a->samples + i;
-
-      assert(sample_a->weight > 0);
+      assert(set_a->weight[i] > 0);
 
       // Add sample to list
-      sample_b->pose = sample_a->pose;
+      pose = pf_get_sample_pose(set_a, i);
     }
 
-    sample_b->weight = 1.0;
-    total += sample_b->weight;
+    pf_set_sample_pose(set_b, b, pose);
+    set_b->weight[b] = 1.0;
+    total += set_b->weight[b];
 
-    // Add sample to histogram
-    pf_kdtree_insert(set_b->kdtree, sample_b->pose, sample_b->weight);
+    // Add sample to histogram, as stored, so that looking it up finds the same leaf
+    pf_kdtree_insert(set_b->kdtree, pf_get_sample_pose(set_b, b), set_b->weight[b]);
 
     // See if we have enough samples yet
     if (set_b->sample_count > pf_resample_limit(pf, set_b->kdtree->leaf_count)) {
@@ -407,19 +521,17 @@ void pf_update_resample(pf_t * pf)
 
   // Normalize weights
   for (i = 0; i < set_b->sample_count; i++) {
-    sample_b = set_b->samples + i;
-    sample_b->weight /= total;
+    set_b->weight[i] /= total;
   }
 
-  // Re-compute cluster statistics
-  pf_cluster_stats(pf, set_b);
+  // Re-compute cluster statistics once they are needed, which the next
+  // resample may make unnecessary
+  set_b->stats_stale = 1;
 
   // Use the newly created sample set
   pf->current_set = (pf->current_set + 1) % 2;
 
   pf_update_converged(pf);
-
-  free(c);
 }
 
 
@@ -452,99 +564,202 @@ int pf_resample_limit(pf_t * pf, int k)
 }
 
 
-// Re-compute the cluster statistics for a sample set
-void pf_cluster_stats(pf_t * pf, pf_sample_set_t * set)
-{
-  (void)pf;
-  int i, j, k, cidx;
-  pf_sample_t * sample;
-  pf_cluster_t * cluster;
+// Samples per chunk of the cluster statistics. The chunks are summed up in
+// order, so the statistics don't depend on how many threads there are.
+#define PF_STATS_CHUNK 256
 
-  // Workspace
-  double m[4], c[2][2];
-  size_t count;
-  double weight;
-
-  // Cluster the samples
-  pf_kdtree_cluster(set->kdtree);
+// Beyond this many clusters, the sums of every chunk would take more memory
+// than the parallel summing saves time, so they are summed in a single chunk
+#define PF_STATS_MAX_CHUNKED_CLUSTERS 64
 
-  // Initialize cluster stats
-  set->cluster_count = 0;
+typedef struct
+{
+  pf_t * pf;
+  pf_sample_set_t * set;
+  int cluster_count;  // the sums of each chunk are cluster_count + 1 long
+  int chunk_size;
+} pf_stats_task_t;
 
-  for (i = 0; i < set->cluster_max_count; i++) {
-    cluster = set->clusters + i;
-    cluster->count = 0;
-    cluster->weight = 0;
-    cluster->mean = pf_vector_zero();
-    cluster->cov = pf_matrix_zero();
+static void pf_cluster_zero(pf_cluster_t * cluster)
+{
+  int j, k;
 
-    for (j = 0; j < 4; j++) {
-      cluster->m[j] = 0.0;
-    }
-    for (j = 0; j < 2; j++) {
-      for (k = 0; k < 2; k++) {
-        cluster->c[j][k] = 0.0;
-      }
+  cluster->count = 0;
+  cluster->weight = 0;
+  cluster->mean = pf_vector_zero();
+  cluster->cov = pf_matrix_zero();
+  for (j = 0; j < 4; j++) {
+    cluster->m[j] = 0.0;
+  }
+  for (j = 0; j < 2; j++) {
+    for (k = 0; k < 2; k++) {
+      cluster->c[j][k] = 0.0;
     }
   }
+}
 
-  // Initialize overall filter stats
-  count = 0;
-  weight = 0.0;
-  set->mean = pf_vector_zero();
-  set->cov = pf_matrix_zero();
+static void pf_cluster_add(pf_cluster_t * sum, const pf_cluster_t * part)
+{
+  int j, k;
+
+  sum->count += part->count;
+  sum->weight += part->weight;
   for (j = 0; j < 4; j++) {
-    m[j] = 0.0;
+    sum->m[j] += part->m[j];
   }
   for (j = 0; j < 2; j++) {
     for (k = 0; k < 2; k++) {
-      c[j][k] = 0.0;
+      sum->c[j][k] += part->c[j][k];
     }
   }
+}
 
-  // Compute cluster stats
-  for (i = 0; i < set->sample_count; i++) {
-    sample = set->samples + i;
+// Label the samples of a chunk with their cluster
+static void pf_label_chunk(void * data, int chunk)
+{
+  pf_stats_task_t * task = data;
+  pf_sample_set_t * set = task->set;
+  int i;
+  int begin = chunk * task->chunk_size;
+  int end = begin + task->chunk_size;
+
+  if (end > set->sample_count) {
+    end = set->sample_count;
+  }
+  for (i = begin; i < end; i++) {
+    task->pf->cluster_labels[i] = pf_kdtree_get_cluster(set->kdtree, pf_get_sample_pose(set, i));
+  }
+}
 
-    // printf("%d %f %f %f\n", i, sample->pose.v[0], sample->pose.v[1], sample->pose.v[2]);
+// Sum up the samples of a chunk per cluster, and for the whole filter after
+// the clusters
+static void pf_sum_chunk(void * data, int chunk)
+{
+  pf_stats_task_t * task = data;
+  pf_sample_set_t * set = task->set;
+  pf_cluster_t * sums = task->pf->cluster_sums + chunk * (task->cluster_count + 1);
+  pf_cluster_t * cluster;
+  pf_cluster_t * total = sums + task->cluster_count;
+  double w, x, y, wx, wy, wc, ws;
+  int i, cidx;
+  int begin = chunk * task->chunk_size;
+  int end = begin + task->chunk_size;
+
+  if (end > set->sample_count) {
+    end = set->sample_count;
+  }
+  for (i = 0; i <= task->cluster_count; i++) {
+    pf_cluster_zero(sums + i);
+  }
 
-    // Get the cluster label for this sample
-    cidx = pf_kdtree_get_cluster(set->kdtree, sample->pose);
-    assert(cidx >= 0);
-    if (cidx >= set->cluster_max_count) {
+  for (i = begin; i < end; i++) {
+    cidx = task->pf->cluster_labels[i];
+    if (cidx < 0 || cidx >= task->cluster_count) {
       continue;
     }
-    if (cidx + 1 > set->cluster_count) {
-      set->cluster_count = cidx + 1;
-    }
+    cluster = sums + cidx;
 
-    cluster = set->clusters + cidx;
+    w = set->weight[i];
+    x = set->x[i];
+    y = set->y[i];
+    wx = w * x;
+    wy = w * y;
+    wc = w * cos(set->theta[i]);
+    ws = w * sin(set->theta[i]);
 
     cluster->count += 1;
-    cluster->weight += sample->weight;
+    cluster->weight += w;
+    cluster->m[0] += wx;
+    cluster->m[1] += wy;
+    cluster->m[2] += wc;
+    cluster->m[3] += ws;
+    cluster->c[0][0] += wx * x;
+    cluster->c[0][1] += wx * y;
+    cluster->c[1][0] += wy * x;
+    cluster->c[1][1] += wy * y;
+
+    total->count += 1;
+    total->weight += w;
+    total->m[0] += wx;
+    total->m[1] += wy;
+    total->m[2] += wc;
+    total->m[3] += ws;
+    total->c[0][0] += wx * x;
+    total->c[0][1] += wx * y;
+    total->c[1][0] += wy * x;
+    total->c[1][1] += wy * y;
+  }
+}
 
-    count += 1;
-    weight += sample->weight;
+// Run task for every chunk, through the parallel hook if there is one
+static void pf_run_chunks(pf_t * pf, int chunks, void (* task)(void *, int), void * data)
+{
+  int chunk;
 
-    // Compute mean
-    cluster->m[0] += sample->weight * sample->pose.v[0];
-    cluster->m[1] += sample->weight * sample->pose.v[1];
-    cluster->m[2] += sample->weight * cos(sample->pose.v[2]);
-    cluster->m[3] += sample->weight * sin(sample->pose.v[2]);
+  if (pf->parallel_for && chunks > 1) {
+    (*pf->parallel_for)(pf->parallel_data, chunks, task, data);
+    return;
+  }
+  for (chunk = 0; chunk < chunks; chunk++) {
+    (*task)(data, chunk);
+  }
+}
 
-    m[0] += sample->weight * sample->pose.v[0];
-    m[1] += sample->weight * sample->pose.v[1];
-    m[2] += sample->weight * cos(sample->pose.v[2]);
-    m[3] += sample->weight * sin(sample->pose.v[2]);
+// Re-compute the cluster statistics for a sample set
+void pf_cluster_stats(pf_t * pf, pf_sample_set_t * set)
+{
+  int i, j, k, chunk, chunks;
+  pf_cluster_t * cluster;
+  pf_cluster_t total;
+  pf_stats_task_t task;
 
-    // Compute covariance in linear components
-    for (j = 0; j < 2; j++) {
-      for (k = 0; k < 2; k++) {
-        cluster->c[j][k] += sample->weight * sample->pose.v[j] * sample->pose.v[k];
-        c[j][k] += sample->weight * sample->pose.v[j] * sample->pose.v[k];
-      }
+  // Cluster the samples
+  pf_kdtree_cluster(set->kdtree);
+
+  task.pf = pf;
+  task.set = set;
+  task.chunk_size = PF_STATS_CHUNK;
+  chunks = (set->sample_count + PF_STATS_CHUNK - 1) / PF_STATS_CHUNK;
+
+  // Get the cluster label of every sample, which takes a hash table lookup each
+  pf_run_chunks(pf, chunks, pf_label_chunk, &task);
+
+  set->cluster_count = 0;
+  for (i = 0; i < set->sample_count; i++) {
+    if (pf->cluster_labels[i] + 1 > set->cluster_count) {
+      set->cluster_count = pf->cluster_labels[i] + 1;
     }
   }
+  if (set->cluster_count > set->cluster_max_count) {
+    set->cluster_count = set->cluster_max_count;
+  }
+
+  // Sum up each chunk per cluster, then add up the chunks in order
+  task.cluster_count = set->cluster_count;
+  if (set->cluster_count > PF_STATS_MAX_CHUNKED_CLUSTERS) {
+    task.chunk_size = set->sample_count > 0 ? set->sample_count : 1;
+    chunks = 1;
+  }
+  if (chunks * (set->cluster_count + 1) > pf->cluster_sums_size) {
+    pf->cluster_sums_size = chunks * (set->cluster_count + 1);
+    free(pf->cluster_sums);
+    pf->cluster_sums = malloc(pf->cluster_sums_size * sizeof(pf_cluster_t));
+  }
+  if (chunks > 0) {
+    pf_run_chunks(pf, chunks, pf_sum_chunk, &task);
+  }
+
+  for (i = 0; i < set->cluster_max_count; i++) {
+    pf_cluster_zero(set->clusters + i);
+  }
+  pf_cluster_zero(&total);
+  for (chunk = 0; chunk < chunks; chunk++) {
+    pf_cluster_t * sums = pf->cluster_sums + chunk * (set->cluster_count + 1);
+    for (i = 0; i < set->cluster_count; i++) {
+      pf_cluster_add(set->clusters + i, sums + i);
+    }
+    pf_cluster_add(&total, sums + set->cluster_count);
+  }
 
   // Normalize
   for (i = 0; i < set->cluster_count; i++) {
@@ -570,27 +785,44 @@ void pf_cluster_stats(pf_t * pf, pf_sample_set_t * set)
       sqrt(
         cluster->m[2] * cluster->m[2] +
         cluster->m[3] * cluster->m[3]));
-
-    // printf("cluster %d %d %f (%f %f %f)\n", i, cluster->count, cluster->weight,
-    // cluster->mean.v[0], cluster->mean.v[1], cluster->mean.v[2]);
-    // pf_matrix_fprintf(cluster->cov, stdout, "%e");
   }
 
   // Compute overall filter stats
-  set->mean.v[0] = m[0] / weight;
-  set->mean.v[1] = m[1] / weight;
-  set->mean.v[2] = atan2(m[3], m[2]);
+  set->mean = pf_vector_zero();
+  set->cov = pf_matrix_zero();
+  set->mean.v[0] = total.m[0] / total.weight;
+  set->mean.v[1] = total.m[1] / total.weight;
+  set->mean.v[2] = atan2(total.m[3], total.m[2]);
 
   // Covariance in linear components
   for (j = 0; j < 2; j++) {
     for (k = 0; k < 2; k++) {
-      set->cov.m[j][k] = c[j][k] / weight - set->mean.v[j] * set->mean.v[k];
+      set->cov.m[j][k] = total.c[j][k] / total.weight - set->mean.v[j] * set->mean.v[k];
     }
   }
 
   // Covariance in angular components; I think this is the correct
   // formula for circular statistics.
-  set->cov.m[2][2] = -2 * log(sqrt(m[2] * m[2] + m[3] * m[3]));
+  set->cov.m[2][2] = -2 * log(sqrt(total.m[2] * total.m[2] + total.m[3] * total.m[3]));
+
+  set->stats_stale = 0;
+}
+
+
+void pf_update_cluster_stats(pf_t * pf)
+{
+  pf_sample_set_t * set = pf->sets + pf->current_set;
+
+  if (set->stats_stale) {
+    pf_cluster_stats(pf, set);
+  }
+}
+
+
+void pf_set_parallel_for(pf_t * pf, pf_parallel_for_fn_t parallel_for, void * parallel_data)
+{
+  pf->parallel_for = parallel_for;
+  pf->parallel_data = parallel_data;
 }
 
 
@@ -600,7 +832,6 @@ void pf_get_cep_stats(pf_t * pf, pf_vector_t * mean, double * var)
   int i;
   double mn, mx, my, mrr;
   pf_sample_set_t * set;
-  pf_sample_t * sample;
 
   set = pf->sets + pf->current_set;
 
@@ -610,13 +841,11 @@ void pf_get_cep_stats(pf_t * pf, pf_vector_t * mean, double * var)
   mrr = 0.0;
 
   for (i = 0; i < set->sample_count; i++) {
-    sample = set->samples + i;
-
-    mn += sample->weight;
-    mx += sample->weight * sample->pose.v[0];
-    my += sample->weight * sample->pose.v[1];
-    mrr += sample->weight * sample->pose.v[0] * sample->pose.v[0];
-    mrr += sample->weight * sample->pose.v[1] * sample->pose.v[1];
+    mn += set->weight[i];
+    mx += set->weight[i] * set->x[i];
+    my += set->weight[i] * set->y[i];
+    mrr += set->weight[i] * set->x[i] * set->x[i];
+    mrr += set->weight[i] * set->y[i] * set->y[i];
   }
 
   mean->v[0] = mx / mn;
@@ -635,6 +864,7 @@ int pf_get_cluster_stats(
   pf_sample_set_t * set;
   pf_cluster_t * cluster;
 
+  pf_update_cluster_stats(pf);
   set = pf->sets + pf->current_set;
 
   if (clabel >= set->cluster_count) {
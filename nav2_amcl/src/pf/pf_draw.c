@@ -49,17 +49,14 @@ void pf_draw_samples(pf_t * pf, rtk_fig_t * fig, int max_samples)
   int i;
   double px, py, pa;
   pf_sample_set_t * set;
-  pf_sample_t * sample;
 
   set = pf->sets + pf->current_set;
   max_samples = MIN(max_samples, set->sample_count);
 
   for (i = 0; i < max_samples; i++) {
-    sample = set->samples + i;
-
-    px = sample->pose.v[0];
-    py = sample->pose.v[1];
-    pa = sample->pose.v[2];
+    px = set->x[i];
+    py = set->y[i];
+    pa = set->theta[i];
 
     // printf("%f %f\n", px, py);
 
@@ -106,6 +103,7 @@ void pf_draw_cluster_stats(pf_t * pf, rtk_fig_t * fig)
   pf_matrix_t r, d;
   double weight, o, d1, d2;
 
+  pf_update_cluster_stats(pf);
   set = pf->sets + pf->current_set;
 
   for (i = 0; i < set->cluster_count; i++) {
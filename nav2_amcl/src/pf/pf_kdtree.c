@@ -35,32 +35,18 @@
 #include "nav2_amcl/pf/pf_kdtree.hpp"
 
 
-// Compare keys to see if they are equal
-static int pf_kdtree_equal(pf_kdtree_t * self, int key_a[], int key_b[]);
+// Compute the key of the bin for a pose
+static void pf_kdtree_key(pf_kdtree_t * self, pf_vector_t pose, int key[]);
 
-// Insert a node into the tree
-static pf_kdtree_node_t * pf_kdtree_insert_node(
-  pf_kdtree_t * self, pf_kdtree_node_t * parent,
-  pf_kdtree_node_t * node, int key[], double value);
+// Find the slot of the hash table holding the key, or the empty slot it
+// would go in
+static int pf_kdtree_find_slot(pf_kdtree_t * self, int key[]);
 
-// Recursive node search
-static pf_kdtree_node_t * pf_kdtree_find_node(
-  pf_kdtree_t * self, pf_kdtree_node_t * node,
-  int key[]);
+// Find the node with the key, or NULL
+static pf_kdtree_node_t * pf_kdtree_find_node(pf_kdtree_t * self, int key[]);
 
-// Recursively label nodes in this cluster
-static void pf_kdtree_cluster_node(pf_kdtree_t * self, pf_kdtree_node_t * node, int depth);
-
-// Recursive node printing
-// static void pf_kdtree_print_node(pf_kdtree_t *self, pf_kdtree_node_t *node);
-
-
-#ifdef INCLUDE_RTKGUI
-
-// Recursively draw nodes
-static void pf_kdtree_draw_node(pf_kdtree_t * self, pf_kdtree_node_t * node, rtk_fig_t * fig);
-
-#endif
+// Find the root of a node in the union-find forest
+static int pf_kdtree_find_root(pf_kdtree_t * self, int i);
 
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -75,11 +61,18 @@ pf_kdtree_t * pf_kdtree_alloc(int max_size)
   self->size[1] = 0.50;
   self->size[2] = (10 * M_PI / 180);
 
-  self->root = NULL;
-
   self->node_count = 0;
   self->node_max_count = max_size;
   self->nodes = calloc(self->node_max_count, sizeof(pf_kdtree_node_t));
+  self->parents = calloc(self->node_max_count, sizeof(int));
+
+  // At most half full, so the probe sequences stay short
+  self->table_size = 1;
+  while (self->table_size < 2 * max_size) {
+    self->table_size *= 2;
+  }
+  self->table = malloc(self->table_size * sizeof(int));
+  memset(self->table, -1, self->table_size * sizeof(int));
 
   self->leaf_count = 0;
 
@@ -91,6 +84,8 @@ pf_kdtree_t * pf_kdtree_alloc(int max_size)
 // Destroy a tree
 void pf_kdtree_free(pf_kdtree_t * self)
 {
+  free(self->table);
+  free(self->parents);
   free(self->nodes);
   free(self);
 }
@@ -100,7 +95,12 @@ void pf_kdtree_free(pf_kdtree_t * self)
 // Clear all entries from the tree
 void pf_kdtree_clear(pf_kdtree_t * self)
 {
-  self->root = NULL;
+  int i;
+
+  // Only the used slots need emptying
+  for (i = 0; i < self->node_count; i++) {
+    self->table[self->nodes[i].slot] = -1;
+  }
   self->leaf_count = 0;
   self->node_count = 0;
 }
@@ -111,33 +111,27 @@ void pf_kdtree_clear(pf_kdtree_t * self)
 void pf_kdtree_insert(pf_kdtree_t * self, pf_vector_t pose, double value)
 {
   int key[3];
+  int slot;
+  pf_kdtree_node_t * node;
 
-  key[0] = floor(pose.v[0] / self->size[0]);
-  key[1] = floor(pose.v[1] / self->size[1]);
-  key[2] = floor(pose.v[2] / self->size[2]);
-
-  self->root = pf_kdtree_insert_node(self, NULL, self->root, key, value);
-
-  // Test code
-  /*
-  printf("find %d %d %d\n", key[0], key[1], key[2]);
-  assert(pf_kdtree_find_node(self, self->root, key) != NULL);
-
-  pf_kdtree_print_node(self, self->root);
-
-  printf("\n");
+  pf_kdtree_key(self, pose, key);
 
-  for (i = 0; i < self->node_count; i++)
-  {
-    node = self->nodes + i;
-    if (node->leaf)
-    {
-      printf("find %d %d %d\n", node->key[0], node->key[1], node->key[2]);
-      assert(pf_kdtree_find_node(self, self->root, node->key) == node);
-    }
+  slot = pf_kdtree_find_slot(self, key);
+  if (self->table[slot] >= 0) {
+    self->nodes[self->table[slot]].value += value;
+    return;
   }
-  printf("\n\n");
-  */
+
+  assert(self->node_count < self->node_max_count);
+  node = self->nodes + self->node_count;
+  node->key[0] = key[0];
+  node->key[1] = key[1];
+  node->key[2] = key[2];
+  node->value = value;
+  node->cluster = -1;
+  node->slot = slot;
+  self->table[slot] = self->node_count++;
+  self->leaf_count += 1;
 }
 
 
@@ -149,11 +143,9 @@ double pf_kdtree_get_prob(pf_kdtree_t * self, pf_vector_t pose)
   int key[3];
   pf_kdtree_node_t * node;
 
-  key[0] = floor(pose.v[0] / self->size[0]);
-  key[1] = floor(pose.v[1] / self->size[1]);
-  key[2] = floor(pose.v[2] / self->size[2]);
+  pf_kdtree_key(self, pose, key);
 
-  node = pf_kdtree_find_node(self, self->root, key);
+  node = pf_kdtree_find_node(self, key);
   if (node == NULL) {
     return 0.0;
   }
@@ -168,11 +160,9 @@ int pf_kdtree_get_cluster(pf_kdtree_t * self, pf_vector_t pose)
   int key[3];
   pf_kdtree_node_t * node;
 
-  key[0] = floor(pose.v[0] / self->size[0]);
-  key[1] = floor(pose.v[1] / self->size[1]);
-  key[2] = floor(pose.v[2] / self->size[2]);
+  pf_kdtree_key(self, pose, key);
 
-  node = pf_kdtree_find_node(self, self->root, key);
+  node = pf_kdtree_find_node(self, key);
   if (node == NULL) {
     return -1;
   }
@@ -181,242 +171,110 @@ int pf_kdtree_get_cluster(pf_kdtree_t * self, pf_vector_t pose)
 
 
 ////////////////////////////////////////////////////////////////////////////////
-// Compare keys to see if they are equal
-int pf_kdtree_equal(pf_kdtree_t * self, int key_a[], int key_b[])
+// Compute the key of the bin for a pose
+void pf_kdtree_key(pf_kdtree_t * self, pf_vector_t pose, int key[])
 {
-  (void)self;
-  // double a, b;
-
-  if (key_a[0] != key_b[0]) {
-    return 0;
-  }
-  if (key_a[1] != key_b[1]) {
-    return 0;
-  }
-
-  if (key_a[2] != key_b[2]) {
-    return 0;
-  }
-
-  /* TODO: make this work (pivot selection needs fixing, too)
-  // Normalize angles
-  a = key_a[2] * self->size[2];
-  a = atan2(sin(a), cos(a)) / self->size[2];
-  b = key_b[2] * self->size[2];
-  b = atan2(sin(b), cos(b)) / self->size[2];
-
- if ((int) a != (int) b)
-    return 0;
-  */
-
-  return 1;
+  key[0] = floor(pose.v[0] / self->size[0]);
+  key[1] = floor(pose.v[1] / self->size[1]);
+  key[2] = floor(pose.v[2] / self->size[2]);
 }
 
 
 ////////////////////////////////////////////////////////////////////////////////
-// Insert a node into the tree
-pf_kdtree_node_t * pf_kdtree_insert_node(
-  pf_kdtree_t * self, pf_kdtree_node_t * parent,
-  pf_kdtree_node_t * node, int key[], double value)
+// Find the slot of the hash table for the key, with linear probing
+int pf_kdtree_find_slot(pf_kdtree_t * self, int key[])
 {
-  int i;
-  int split, max_split;
-
-  // If the node doesnt exist yet...
-  if (node == NULL) {
-    assert(self->node_count < self->node_max_count);
-    node = self->nodes + self->node_count++;
-    memset(node, 0, sizeof(pf_kdtree_node_t));
+  unsigned int hash;
+  int mask, slot, index;
 
-    node->leaf = 1;
-
-    if (parent == NULL) {
-      node->depth = 0;
-    } else {
-      node->depth = parent->depth + 1;
-    }
+  hash = (unsigned int) key[0] * 73856093u ^ (unsigned int) key[1] * 19349663u ^
+    (unsigned int) key[2] * 83492791u;
+  mask = self->table_size - 1;
 
-    for (i = 0; i < 3; i++) {
-      node->key[i] = key[i];
+  for (slot = hash & mask; ; slot = (slot + 1) & mask) {
+    index = self->table[slot];
+    if (index < 0) {
+      return slot;
     }
-
-    node->value = value;
-    self->leaf_count += 1;
-  } else if (node->leaf) {  // If the node exists, and it is a leaf node...
-    // If the keys are equal, increment the value
-    if (pf_kdtree_equal(self, key, node->key)) {
-      node->value += value;
-    } else {  // The keys are not equal, so split this node
-      // Find the dimension with the largest variance and do a mean
-      // split
-      max_split = 0;
-      node->pivot_dim = -1;
-      for (i = 0; i < 3; i++) {
-        split = abs(key[i] - node->key[i]);
-        if (split > max_split) {
-          max_split = split;
-          node->pivot_dim = i;
-        }
-      }
-      assert(node->pivot_dim >= 0);
-
-      node->pivot_value = (key[node->pivot_dim] + node->key[node->pivot_dim]) / 2.0;
-
-      if (key[node->pivot_dim] < node->pivot_value) {
-        node->children[0] = pf_kdtree_insert_node(self, node, NULL, key, value);
-        node->children[1] = pf_kdtree_insert_node(self, node, NULL, node->key, node->value);
-      } else {
-        node->children[0] = pf_kdtree_insert_node(self, node, NULL, node->key, node->value);
-        node->children[1] = pf_kdtree_insert_node(self, node, NULL, key, value);
-      }
-
-      node->leaf = 0;
-      self->leaf_count -= 1;
-    }
-  } else {  // If the node exists, and it has children...
-    assert(node->children[0] != NULL);
-    assert(node->children[1] != NULL);
-
-    if (key[node->pivot_dim] < node->pivot_value) {
-      pf_kdtree_insert_node(self, node, node->children[0], key, value);
-    } else {
-      pf_kdtree_insert_node(self, node, node->children[1], key, value);
+    if (self->nodes[index].key[0] == key[0] && self->nodes[index].key[1] == key[1] &&
+      self->nodes[index].key[2] == key[2])
+    {
+      return slot;
     }
   }
-
-  return node;
 }
 
 
 ////////////////////////////////////////////////////////////////////////////////
-// Recursive node search
-pf_kdtree_node_t * pf_kdtree_find_node(pf_kdtree_t * self, pf_kdtree_node_t * node, int key[])
+// Find the node with the key
+pf_kdtree_node_t * pf_kdtree_find_node(pf_kdtree_t * self, int key[])
 {
-  if (node->leaf) {
-    // printf("find  : leaf %p %d %d %d\n", node, node->key[0], node->key[1], node->key[2]);
-
-    // If the keys are the same...
-    if (pf_kdtree_equal(self, key, node->key)) {
-      return node;
-    } else {
-      return NULL;
-    }
-  } else {
-    // printf("find  : brch %p %d %f\n", node, node->pivot_dim, node->pivot_value);
-
-    assert(node->children[0] != NULL);
-    assert(node->children[1] != NULL);
-
-    // If the keys are different...
-    if (key[node->pivot_dim] < node->pivot_value) {
-      return pf_kdtree_find_node(self, node->children[0], key);
-    } else {
-      return pf_kdtree_find_node(self, node->children[1], key);
-    }
+  int index = self->table[pf_kdtree_find_slot(self, key)];
+  if (index < 0) {
+    return NULL;
   }
-
-  return NULL;
+  return self->nodes + index;
 }
 
 
 ////////////////////////////////////////////////////////////////////////////////
-// Recursive node printing
-/*
-void pf_kdtree_print_node(pf_kdtree_t *self, pf_kdtree_node_t *node)
+// Find the root of a node in the union-find forest, halving the path on the way
+int pf_kdtree_find_root(pf_kdtree_t * self, int i)
 {
-  if (node->leaf)
-  {
-    printf("(%+02d %+02d %+02d)\n", node->key[0], node->key[1], node->key[2]);
-    printf("%*s", node->depth * 11, "");
+  while (self->parents[i] != i) {
+    self->parents[i] = self->parents[self->parents[i]];
+    i = self->parents[i];
   }
-  else
-  {
-    printf("(%+02d %+02d %+02d) ", node->key[0], node->key[1], node->key[2]);
-    pf_kdtree_print_node(self, node->children[0]);
-    pf_kdtree_print_node(self, node->children[1]);
-  }
-  return;
+  return i;
 }
-*/
 
 
 ////////////////////////////////////////////////////////////////////////////////
-// Cluster the leaves in the tree
+// Cluster the leaves in the tree: the connected components of the bins that
+// touch, including on the diagonals
 void pf_kdtree_cluster(pf_kdtree_t * self)
 {
-  int i;
-  int queue_count, cluster_count;
-  pf_kdtree_node_t ** queue, * node;
+  int i, j;
+  int nkey[3];
+  int a, b;
+  int cluster_count;
+  pf_kdtree_node_t * node, * nnode;
 
-  queue_count = 0;
-  queue = calloc(self->node_count, sizeof(queue[0]));
+  for (i = 0; i < self->node_count; i++) {
+    self->parents[i] = i;
+  }
 
-  // Put all the leaves in a queue
+  // Join each node with its neighbours. Each pair of neighbours is seen from
+  // both sides, so only the 13 neighbours after the node need looking at.
   for (i = 0; i < self->node_count; i++) {
     node = self->nodes + i;
-    if (node->leaf) {
-      node->cluster = -1;
-      assert(queue_count < self->node_count);
-      queue[queue_count++] = node;
+    for (j = 3 * 3 * 3 / 2 + 1; j < 3 * 3 * 3; j++) {
+      nkey[0] = node->key[0] + (j / 9) - 1;
+      nkey[1] = node->key[1] + ((j % 9) / 3) - 1;
+      nkey[2] = node->key[2] + ((j % 9) % 3) - 1;
+
+      nnode = pf_kdtree_find_node(self, nkey);
+      if (nnode == NULL) {
+        continue;
+      }
 
-      // TESTING; remove
-      assert(node == pf_kdtree_find_node(self, self->root, node->key));
+      a = pf_kdtree_find_root(self, i);
+      b = pf_kdtree_find_root(self, nnode - self->nodes);
+      if (a != b) {
+        self->parents[a > b ? a : b] = a > b ? b : a;
+      }
     }
   }
 
+  // Number the clusters in the order of their first node
   cluster_count = 0;
-
-  // Do connected components for each node
-  while (queue_count > 0) {
-    node = queue[--queue_count];
-
-    // If this node has already been labelled, skip it
-    if (node->cluster >= 0) {
-      continue;
-    }
-
-    // Assign a label to this cluster
-    node->cluster = cluster_count++;
-
-    // Recursively label nodes in this cluster
-    pf_kdtree_cluster_node(self, node, 0);
-  }
-
-  free(queue);
-}
-
-
-////////////////////////////////////////////////////////////////////////////////
-// Recursively label nodes in this cluster
-void pf_kdtree_cluster_node(pf_kdtree_t * self, pf_kdtree_node_t * node, int depth)
-{
-  int i;
-  int nkey[3];
-  pf_kdtree_node_t * nnode;
-
-  for (i = 0; i < 3 * 3 * 3; i++) {
-    nkey[0] = node->key[0] + (i / 9) - 1;
-    nkey[1] = node->key[1] + ((i % 9) / 3) - 1;
-    nkey[2] = node->key[2] + ((i % 9) % 3) - 1;
-
-    nnode = pf_kdtree_find_node(self, self->root, nkey);
-    if (nnode == NULL) {
-      continue;
-    }
-
-    assert(nnode->leaf);
-
-    // This node already has a label; skip it.  The label should be
-    // consistent, however.
-    if (nnode->cluster >= 0) {
-      assert(nnode->cluster == node->cluster);
-      continue;
+  for (i = 0; i < self->node_count; i++) {
+    a = pf_kdtree_find_root(self, i);
+    if (a == i) {
+      self->nodes[i].cluster = cluster_count++;
+    } else {
+      self->nodes[i].cluster = self->nodes[a].cluster;
     }
-
-    // Label this node and recurse
-    nnode->cluster = node->cluster;
-
-    pf_kdtree_cluster_node(self, nnode, depth + 1);
   }
 }
 
@@ -427,20 +285,13 @@ void pf_kdtree_cluster_node(pf_kdtree_t * self, pf_kdtree_node_t * node, int dep
 // Draw the tree
 void pf_kdtree_draw(pf_kdtree_t * self, rtk_fig_t * fig)
 {
-  if (self->root != NULL) {
-    pf_kdtree_draw_node(self, self->root, fig);
-  }
-}
-
-
-////////////////////////////////////////////////////////////////////////////////
-// Recursively draw nodes
-void pf_kdtree_draw_node(pf_kdtree_t * self, pf_kdtree_node_t * node, rtk_fig_t * fig)
-{
+  int i;
   double ox, oy;
   char text[64];
+  pf_kdtree_node_t * node;
 
-  if (node->leaf) {
+  for (i = 0; i < self->node_count; i++) {
+    node = self->nodes + i;
     ox = (node->key[0] + 0.5) * self->size[0];
     oy = (node->key[1] + 0.5) * self->size[1];
 
@@ -451,11 +302,6 @@ void pf_kdtree_draw_node(pf_kdtree_t * self, pf_kdtree_node_t * node, rtk_fig_t
 
     snprintf(text, sizeof(text), "%d", node->cluster);
     rtk_fig_text(fig, ox, oy, 0.0, text);
-  } else {
-    assert(node->children[0] != NULL);
-    assert(node->children[1] != NULL);
-    pf_kdtree_draw_node(self, node->children[0], fig);
-    pf_kdtree_draw_node(self, node->children[1], fig);
   }
 }
 
@@ -25,13 +25,18 @@
 #include <assert.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include <vector>
+
 #include "nav2_amcl/sensors/laser/laser.hpp"
 
 namespace nav2_amcl
 {
 
 Laser::Laser(size_t max_beams, map_t * map)
-: max_samples_(0), max_obs_(0), temp_obs_(NULL)
+: max_samples_(0), max_obs_(0), max_hit_prob_(0.0)
 {
   max_beams_ = max_beams;
   map_ = map;
@@ -39,36 +44,237 @@ Laser::Laser(size_t max_beams, map_t * map)
 
 Laser::~Laser()
 {
-  if (temp_obs_) {
-    for (int k = 0; k < max_samples_; k++) {
-      delete[] temp_obs_[k];
-    }
-    delete[] temp_obs_;
-  }
 }
 
 void
 Laser::reallocTempData(int new_max_samples, int new_max_obs)
 {
-  if (temp_obs_) {
-    for (int k = 0; k < max_samples_; k++) {
-      delete[] temp_obs_[k];
+  max_obs_ = std::max(max_obs_, new_max_obs);
+  max_samples_ = std::max(max_samples_, new_max_samples);
+  temp_obs_.resize(static_cast<size_t>(max_samples_) * max_obs_);
+}
+
+void
+Laser::SetLaserPose(pf_vector_t & laser_pose)
+{
+  laser_pose_ = laser_pose;
+}
+
+void
+Laser::setThreadPool(std::shared_ptr<nav2_util::ThreadPool> pool)
+{
+  pool_ = std::move(pool);
+}
+
+double
+Laser::weighSamples(
+  int sample_count,
+  const std::function<double(int chunk, int begin, int end)> & weigh)
+{
+  int chunks = sampleChunks(sample_count);
+  if (!pool_ || pool_->size() < 2 || chunks < 2) {
+    return weigh(0, 0, sample_count);
+  }
+
+  chunk_weights_.assign(chunks, 0.0);
+  pool_->parallel_for(
+    chunks, [&](std::size_t chunk) {
+      int begin = static_cast<int>(chunk) * sample_chunk_size;
+      int end = std::min(begin + sample_chunk_size, sample_count);
+      chunk_weights_[chunk] = weigh(static_cast<int>(chunk), begin, end);
+    });
+
+  double total_weight = 0.0;
+  for (double weight : chunk_weights_) {
+    total_weight += weight;
+  }
+  return total_weight;
+}
+
+void
+Laser::prepareBeams(LaserData * data, int step)
+{
+  beam_x_.clear();
+  beam_y_.clear();
+  beam_index_.clear();
+
+  int beam_ind = 0;
+  for (int i = 0; i < data->range_count; i += step, beam_ind++) {
+    double obs_range = data->ranges[i][0];
+    double obs_bearing = data->ranges[i][1];
+
+    // Max range readings are ignored, and so is NaN
+    if (!(obs_range < data->range_max)) {
+      continue;
+    }
+
+    // The bearings are in the base frame, while the sensor is either this
+    // laser or the one the beam was fused from
+    double origin_x, origin_y;
+    if (data->origins) {
+      origin_x = data->origins[i][0];
+      origin_y = data->origins[i][1];
+    } else {
+      origin_x = laser_pose_.v[0];
+      origin_y = laser_pose_.v[1];
+      obs_bearing += laser_pose_.v[2];
+    }
+
+    beam_x_.push_back((origin_x + obs_range * cos(obs_bearing)) / map_->scale);
+    beam_y_.push_back((origin_y + obs_range * sin(obs_bearing)) / map_->scale);
+    beam_index_.push_back(beam_ind);
+  }
+}
+
+// The distance in meters to the nearest obstacle at (u, v) in cells, bilinear
+// between the cell centers, and its derivatives along u and v
+static double
+interpolateDistance(const map_t * map, double u, double v, double & du, double & dv)
+{
+  int i = static_cast<int>(floor(u));
+  int j = static_cast<int>(floor(v));
+  double fx = u - i;
+  double fy = v - j;
+
+  double d[2][2];
+  for (int dj = 0; dj < 2; dj++) {
+    for (int di = 0; di < 2; di++) {
+      d[dj][di] = MAP_VALID(map, i + di, j + dj) ?
+        MAP_OCC_DIST(map, MAP_DIST_INDEX(map, i + di, j + dj)) : map->max_occ_dist;
+    }
+  }
+
+  du = (1 - fy) * (d[0][1] - d[0][0]) + fy * (d[1][1] - d[1][0]);
+  dv = (1 - fx) * (d[1][0] - d[0][0]) + fx * (d[1][1] - d[0][1]);
+  return (1 - fy) * ((1 - fx) * d[0][0] + fx * d[0][1]) +
+         fy * ((1 - fx) * d[1][0] + fx * d[1][1]);
+}
+
+double
+Laser::matchCost(const pf_vector_t & pose, double hessian[3][3], double gradient[3]) const
+{
+  const map_t * map = map_;
+  const double max_dist = map->max_occ_dist;
+  double cos_a = cos(pose.v[2]);
+  double sin_a = sin(pose.v[2]);
+  // Cell i of the map is centered on u = i, as in the sensor models
+  double gx = (pose.v[0] - map->origin_x) / map->scale + map->size_x / 2;
+  double gy = (pose.v[1] - map->origin_y) / map->scale + map->size_y / 2;
+
+  double cost = 0.0;
+  for (size_t k = 0; k < beam_x_.size(); k++) {
+    double u = gx + cos_a * beam_x_[k] - sin_a * beam_y_[k];
+    double v = gy + sin_a * beam_x_[k] + cos_a * beam_y_[k];
+    double du, dv;
+    double dist = interpolateDistance(map, u, v, du, dv);
+    if (dist >= max_dist) {
+      // Too far from any obstacle for the field to point anywhere
+      cost += max_dist * max_dist;
+      continue;
+    }
+    cost += dist * dist;
+    if (!hessian) {
+      continue;
+    }
+
+    // The derivatives of the distance by x, y and the heading
+    double jacobian[3] = {
+      du / map->scale,
+      dv / map->scale,
+      du * (-sin_a * beam_x_[k] - cos_a * beam_y_[k]) +
+      dv * (cos_a * beam_x_[k] - sin_a * beam_y_[k])};
+    for (int r = 0; r < 3; r++) {
+      for (int c = 0; c < 3; c++) {
+        hessian[r][c] += jacobian[r] * jacobian[c];
+      }
+      gradient[r] += jacobian[r] * dist;
+    }
+  }
+  return cost;
+}
+
+bool
+Laser::refinePose(LaserData * data, pf_vector_t & pose, int iterations)
+{
+  if (map_->max_occ_dist <= 0.0 || !map_->occ_dist || max_beams_ < 2) {
+    return false;
+  }
+
+  // The same beams the likelihood field models weigh the particles with
+  int step = std::max(1, (data->range_count - 1) / (max_beams_ - 1));
+  prepareBeams(data, step);
+  if (beam_x_.size() < 3) {
+    return false;
+  }
+
+  pf_vector_t current = pose;
+  double damping = 1e-3;
+  double hessian[3][3], gradient[3];
+  for (int iteration = 0; iteration < iterations; iteration++) {
+    for (int r = 0; r < 3; r++) {
+      gradient[r] = 0.0;
+      for (int c = 0; c < 3; c++) {
+        hessian[r][c] = 0.0;
+      }
+    }
+    double cost = matchCost(current, hessian, gradient);
+
+    // Solve (H + damping * diag(H)) delta = g by Cramer's rule, damped as in
+    // Levenberg-Marquardt so a step that doesn't pay off is retried shorter
+    for (int r = 0; r < 3; r++) {
+      hessian[r][r] += damping * hessian[r][r] + 1e-9;
+    }
+    double det =
+      hessian[0][0] * (hessian[1][1] * hessian[2][2] - hessian[1][2] * hessian[2][1]) -
+      hessian[0][1] * (hessian[1][0] * hessian[2][2] - hessian[1][2] * hessian[2][0]) +
+      hessian[0][2] * (hessian[1][0] * hessian[2][1] - hessian[1][1] * hessian[2][0]);
+    if (fabs(det) < 1e-12) {
+      break;  // the scan doesn't constrain the pose
+    }
+    pf_vector_t delta;
+    for (int col = 0; col < 3; col++) {
+      double m[3][3];
+      for (int r = 0; r < 3; r++) {
+        for (int c = 0; c < 3; c++) {
+          m[r][c] = c == col ? gradient[r] : hessian[r][c];
+        }
+      }
+      delta.v[col] = (m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) -
+        m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) +
+        m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0])) / det;
+    }
+
+    pf_vector_t candidate = pf_vector_sub(current, delta);
+    if (matchCost(candidate, nullptr, nullptr) < cost) {
+      current = candidate;
+      damping = std::max(1e-6, damping * 0.1);
+      // Converged to well below a cell
+      if (hypot(delta.v[0], delta.v[1]) < 1e-3 * map_->scale && fabs(delta.v[2]) < 1e-4) {
+        break;
+      }
+    } else {
+      damping *= 10.0;
     }
-    delete[] temp_obs_;
   }
-  max_obs_ = new_max_obs;
-  max_samples_ = fmax(max_samples_, new_max_samples);
 
-  temp_obs_ = new double *[max_samples_]();
-  for (int k = 0; k < max_samples_; k++) {
-    temp_obs_[k] = new double[max_obs_]();
+  if (hypot(current.v[0] - pose.v[0], current.v[1] - pose.v[1]) > map_->max_occ_dist) {
+    return false;
   }
+  current.v[2] = atan2(sin(current.v[2]), cos(current.v[2]));
+  pose = current;
+  return true;
 }
 
 void
-Laser::SetLaserPose(pf_vector_t & laser_pose)
+Laser::buildHitProbTable()
 {
-  laser_pose_ = laser_pose;
+  double z_hit_denom = 2 * sigma_hit_ * sigma_hit_;
+
+  for (int i = 0; i <= MAP_OCC_DIST_MAX; i++) {
+    double z = i * map_->max_occ_dist / MAP_OCC_DIST_MAX;
+    hit_prob_[i] = z_hit_ * exp(-(z * z) / z_hit_denom);
+  }
+  max_hit_prob_ = hit_prob_[MAP_OCC_DIST_MAX];
 }
 
 }  // namespace nav2_amcl
@@ -35,103 +35,96 @@ LikelihoodFieldModel::LikelihoodFieldModel(
   z_hit_ = z_hit;
   z_rand_ = z_rand;
   sigma_hit_ = sigma_hit;
-  map_update_cspace(map, max_occ_dist);
+  // The distances may already be there for this map, e.g. from another laser
+  if (map->max_occ_dist != max_occ_dist) {
+    map_update_cspace(map, max_occ_dist);
+  }
+  buildHitProbTable();
 }
 
 double
 LikelihoodFieldModel::sensorFunction(LaserData * data, pf_sample_set_t * set)
 {
   LikelihoodFieldModel * self;
-  int i, j, step;
-  double z, pz;
-  double p;
-  double obs_range, obs_bearing;
-  double total_weight;
-  pf_sample_t * sample;
-  pf_vector_t pose;
-  pf_vector_t hit;
+  int step;
 
   self = reinterpret_cast<LikelihoodFieldModel *>(data->laser);
 
-  total_weight = 0.0;
-
-  // Compute the sample weights
-  for (j = 0; j < set->sample_count; j++) {
-    sample = set->samples + j;
-    pose = sample->pose;
-
-    // Take account of the laser pose relative to the robot
-    pose = pf_vector_coord_add(self->laser_pose_, pose);
-
-    p = 1.0;
-
-    // Pre-compute a couple of things
-    double z_hit_denom = 2 * self->sigma_hit_ * self->sigma_hit_;
-    double z_rand_mult = 1.0 / data->range_max;
-
-    step = (data->range_count - 1) / (self->max_beams_ - 1);
-
-    // Step size must be at least 1
-    if (step < 1) {
-      step = 1;
-    }
-
-    for (i = 0; i < data->range_count; i += step) {
-      obs_range = data->ranges[i][0];
-      obs_bearing = data->ranges[i][1];
-
-      // This model ignores max range readings
-      if (obs_range >= data->range_max) {
-        continue;
-      }
-
-      // Check for NaN
-      if (obs_range != obs_range) {
-        continue;
-      }
+  step = (data->range_count - 1) / (self->max_beams_ - 1);
 
-      pz = 0.0;
+  // Step size must be at least 1
+  if (step < 1) {
+    step = 1;
+  }
 
-      // Compute the endpoint of the beam
-      hit.v[0] = pose.v[0] + obs_range * cos(pose.v[2] + obs_bearing);
-      hit.v[1] = pose.v[1] + obs_range * sin(pose.v[2] + obs_bearing);
+  // The beams are the same for every particle, so they are only looked at once
+  self->prepareBeams(data, step);
 
-      // Convert to map grid coords.
-      int mi, mj;
-      mi = MAP_GXWX(self->map_, hit.v[0]);
-      mj = MAP_GYWY(self->map_, hit.v[1]);
+  // Compute the sample weights
+  return self->weighSamples(
+    set->sample_count, [self, data, set](int, int begin, int end) {
+      const map_t * map = self->map_;
+      const pf_real_t * beam_x = self->beam_x_.data();
+      const pf_real_t * beam_y = self->beam_y_.data();
+      const int beam_count = static_cast<int>(self->beam_x_.size());
+      double pz;
+      double p;
+      double total_weight;
+      pf_vector_t pose;
 
-      // Part 1: Get distance from the hit to closest obstacle.
-      // Off-map penalized as max distance
-      if (!MAP_VALID(self->map_, mi, mj)) {
-        z = self->map_->max_occ_dist;
-      } else {
-        z = self->map_->cells[MAP_INDEX(self->map_, mi, mj)].occ_dist;
-      }
-      // Gaussian model
-      // NOTE: this should have a normalization of 1/(sqrt(2pi)*sigma)
-      pz += self->z_hit_ * exp(-(z * z) / z_hit_denom);
       // Part 2: random measurements
-      pz += self->z_rand_ * z_rand_mult;
-
-      // TODO(?): outlier rejection for short readings
-
-      assert(pz <= 1.0);
-      assert(pz >= 0.0);
-      //      p *= pz;
-      // here we have an ad-hoc weighting scheme for combining beam probs
-      // works well, though...
-      p += pz * pz * pz;
-    }
-
-    sample->weight *= p;
-    total_weight += sample->weight;
-  }
+      double z_rand = self->z_rand_ * (1.0 / data->range_max);
+
+      total_weight = 0.0;
+
+      for (int j = begin; j < end; j++) {
+        // The beams already take account of the laser pose relative to the robot
+        pose = pf_get_sample_pose(set, j);
+
+        p = 1.0;
+
+        // The grid coords of a beam end point are MAP_GXWX and MAP_GYWY of
+        // the robot position plus the rotated beam, worked out in cells
+        pf_real_t cos_a = cos(pose.v[2]);
+        pf_real_t sin_a = sin(pose.v[2]);
+        pf_real_t gx = (pose.v[0] - map->origin_x) / map->scale + 0.5;
+        pf_real_t gy = (pose.v[1] - map->origin_y) / map->scale + 0.5;
+
+        for (int k = 0; k < beam_count; k++) {
+          int mi = static_cast<int>(floor(gx + cos_a * beam_x[k] - sin_a * beam_y[k])) +
+            map->size_x / 2;
+          int mj = static_cast<int>(floor(gy + sin_a * beam_x[k] + cos_a * beam_y[k])) +
+            map->size_y / 2;
+
+          // Part 1: Get distance from the hit to closest obstacle.
+          // Off-map penalized as max distance
+          // Gaussian model
+          // NOTE: this should have a normalization of 1/(sqrt(2pi)*sigma)
+          if (!MAP_VALID(map, mi, mj)) {
+            pz = self->max_hit_prob_;
+          } else {
+            pz = self->hitProb(map->occ_dist[MAP_DIST_INDEX(map, mi, mj)]);
+          }
+          pz += z_rand;
+
+          // TODO(?): outlier rejection for short readings
+
+          assert(pz <= 1.0);
+          assert(pz >= 0.0);
+          //      p *= pz;
+          // here we have an ad-hoc weighting scheme for combining beam probs
+          // works well, though...
+          p += pz * pz * pz;
+        }
+
+        set->weight[j] *= p;
+        total_weight += set->weight[j];
+      }
 
-  return total_weight;
+      return total_weight;
+    });
 }
 
-
 bool
 LikelihoodFieldModel::sensorUpdate(pf_t * pf, LaserData * data)
 {
@@ -23,6 +23,9 @@
 #include <math.h>
 #include <assert.h>
 
+#include <algorithm>
+#include <vector>
+
 #include "nav2_amcl/sensors/laser/laser.hpp"
 
 namespace nav2_amcl
@@ -44,7 +47,11 @@ LikelihoodFieldModelProb::LikelihoodFieldModelProb(
   beam_skip_distance_ = beam_skip_distance;
   beam_skip_threshold_ = beam_skip_threshold;
   beam_skip_error_threshold_ = beam_skip_error_threshold;
-  map_update_cspace(map, max_occ_dist);
+  // The distances may already be there for this map, e.g. from another laser
+  if (map->max_occ_dist != max_occ_dist) {
+    map_update_cspace(map, max_occ_dist);
+  }
+  buildHitProbTable();
 }
 
 // Determine the probability for the given pose
@@ -52,14 +59,8 @@ double
 LikelihoodFieldModelProb::sensorFunction(LaserData * data, pf_sample_set_t * set)
 {
   LikelihoodFieldModelProb * self;
-  int i, j, step;
-  double z, pz;
-  double log_p;
-  double obs_range, obs_bearing;
+  int step;
   double total_weight;
-  pf_sample_t * sample;
-  pf_vector_t pose;
-  pf_vector_t hit;
 
   self = reinterpret_cast<LikelihoodFieldModelProb *>(data->laser);
 
@@ -73,17 +74,19 @@ LikelihoodFieldModelProb::sensorFunction(LaserData * data, pf_sample_set_t * set
   }
 
   // Pre-compute a couple of things
-  double z_hit_denom = 2 * self->sigma_hit_ * self->sigma_hit_;
   double z_rand_mult = 1.0 / data->range_max;
 
-  double max_dist_prob = exp(-(self->map_->max_occ_dist * self->map_->max_occ_dist) / z_hit_denom);
+  // The beams are the same for every particle, so they are only looked at once
+  self->prepareBeams(data, step);
 
   // Beam skipping - ignores beams for which a majoirty of particles do not agree with the map
   // prevents correct particles from getting down weighted because of unexpected obstacles
   // such as humans
 
   bool do_beamskip = self->do_beamskip_;
-  double beam_skip_distance = self->beam_skip_distance_;
+  // the beam skip distance in the units of the stored occ_dist
+  double beam_skip_occ_dist =
+    self->beam_skip_distance_ * MAP_OCC_DIST_MAX / self->map_->max_occ_dist;
   double beam_skip_threshold = self->beam_skip_threshold_;
 
   // we only do beam skipping if the filter has converged
@@ -91,12 +94,18 @@ LikelihoodFieldModelProb::sensorFunction(LaserData * data, pf_sample_set_t * set
     do_beamskip = false;
   }
 
-  // we need a count the no of particles for which the beam agreed with the map
-  int * obs_count = new int[self->max_beams_]();
+  // we need a count the no of particles for which the beam agreed with the map,
+  // kept per chunk of samples so they can be weighed in parallel
+  int chunks = std::max(sampleChunks(set->sample_count), 1);
+  std::vector<int> & chunk_obs_count = self->chunk_obs_count_;
+  std::vector<int> & obs_count = self->obs_count_;
+  chunk_obs_count.assign(chunks * self->max_beams_, 0);
+  obs_count.assign(self->max_beams_, 0);
 
   // we also need a mask of which observations to integrate (to decide which beams to integrate to
   // all particles)
-  bool * obs_mask = new bool[self->max_beams_]();
+  std::vector<char> & obs_mask = self->obs_mask_;
+  obs_mask.assign(self->max_beams_, false);
 
   int beam_ind = 0;
 
@@ -119,79 +128,86 @@ LikelihoodFieldModelProb::sensorFunction(LaserData * data, pf_sample_set_t * set
   }
 
   // Compute the sample weights
-  for (j = 0; j < set->sample_count; j++) {
-    sample = set->samples + j;
-    pose = sample->pose;
-
-    // Take account of the laser pose relative to the robot
-    pose = pf_vector_coord_add(self->laser_pose_, pose);
-
-    log_p = 0;
-
-    beam_ind = 0;
-
-    for (i = 0; i < data->range_count; i += step, beam_ind++) {
-      obs_range = data->ranges[i][0];
-      obs_bearing = data->ranges[i][1];
-
-      // This model ignores max range readings
-      if (obs_range >= data->range_max) {
-        continue;
-      }
-
-      // Check for NaN
-      if (obs_range != obs_range) {
-        continue;
-      }
-
-      pz = 0.0;
-
-      // Compute the endpoint of the beam
-      hit.v[0] = pose.v[0] + obs_range * cos(pose.v[2] + obs_bearing);
-      hit.v[1] = pose.v[1] + obs_range * sin(pose.v[2] + obs_bearing);
-
-      // Convert to map grid coords.
-      int mi, mj;
-      mi = MAP_GXWX(self->map_, hit.v[0]);
-      mj = MAP_GYWY(self->map_, hit.v[1]);
-
-      // Part 1: Get distance from the hit to closest obstacle.
-      // Off-map penalized as max distance
-
-      if (!MAP_VALID(self->map_, mi, mj)) {
-        pz += self->z_hit_ * max_dist_prob;
-      } else {
-        z = self->map_->cells[MAP_INDEX(self->map_, mi, mj)].occ_dist;
-        if (z < beam_skip_distance) {
-          obs_count[beam_ind] += 1;
+  total_weight = self->weighSamples(
+    set->sample_count, [&](int chunk, int begin, int end) {
+      const map_t * map = self->map_;
+      const pf_real_t * beam_x = self->beam_x_.data();
+      const pf_real_t * beam_y = self->beam_y_.data();
+      const int beam_count = static_cast<int>(self->beam_x_.size());
+      uint8_t z;
+      double pz;
+      double log_p;
+      double chunk_weight = 0.0;
+      pf_vector_t pose;
+      int * obs_count = &chunk_obs_count[chunk * self->max_beams_];
+
+      for (int j = begin; j < end; j++) {
+        // The beams already take account of the laser pose relative to the robot
+        pose = pf_get_sample_pose(set, j);
+
+        log_p = 0;
+
+        // The grid coords of a beam end point are MAP_GXWX and MAP_GYWY of
+        // the robot position plus the rotated beam, worked out in cells
+        pf_real_t cos_a = cos(pose.v[2]);
+        pf_real_t sin_a = sin(pose.v[2]);
+        pf_real_t gx = (pose.v[0] - map->origin_x) / map->scale + 0.5;
+        pf_real_t gy = (pose.v[1] - map->origin_y) / map->scale + 0.5;
+
+        for (int k = 0; k < beam_count; k++) {
+          int beam_ind = self->beam_index_[k];
+          int mi = static_cast<int>(floor(gx + cos_a * beam_x[k] - sin_a * beam_y[k])) +
+            map->size_x / 2;
+          int mj = static_cast<int>(floor(gy + sin_a * beam_x[k] + cos_a * beam_y[k])) +
+            map->size_y / 2;
+
+          pz = 0.0;
+
+          // Part 1: Get distance from the hit to closest obstacle.
+          // Off-map penalized as max distance
+
+          if (!MAP_VALID(map, mi, mj)) {
+            pz += self->max_hit_prob_;
+          } else {
+            z = map->occ_dist[MAP_DIST_INDEX(map, mi, mj)];
+            if (z < beam_skip_occ_dist) {
+              obs_count[beam_ind] += 1;
+            }
+            pz += self->hitProb(z);
+          }
+
+          // Gaussian model
+          // NOTE: this should have a normalization of 1/(sqrt(2pi)*sigma)
+
+          // Part 2: random measurements
+          pz += self->z_rand_ * z_rand_mult;
+
+          assert(pz <= 1.0);
+          assert(pz >= 0.0);
+
+          // TODO(?): outlier rejection for short readings
+
+          if (!do_beamskip) {
+            log_p += log(pz);
+          } else {
+            self->tempObs(j, beam_ind) = pz;
+          }
+        }
+        if (!do_beamskip) {
+          set->weight[j] *= exp(log_p);
+          chunk_weight += set->weight[j];
         }
-        pz += self->z_hit_ * exp(-(z * z) / z_hit_denom);
       }
+      return chunk_weight;
+    });
 
-      // Gaussian model
-      // NOTE: this should have a normalization of 1/(sqrt(2pi)*sigma)
-
-      // Part 2: random measurements
-      pz += self->z_rand_ * z_rand_mult;
-
-      assert(pz <= 1.0);
-      assert(pz >= 0.0);
-
-      // TODO(?): outlier rejection for short readings
-
-      if (!do_beamskip) {
-        log_p += log(pz);
-      } else {
-        self->temp_obs_[j][beam_ind] = pz;
+  if (do_beamskip) {
+    for (int chunk = 0; chunk < chunks; chunk++) {
+      for (beam_ind = 0; beam_ind < self->max_beams_; beam_ind++) {
+        obs_count[beam_ind] += chunk_obs_count[chunk * self->max_beams_ + beam_ind];
       }
     }
-    if (!do_beamskip) {
-      sample->weight *= exp(log_p);
-      total_weight += sample->weight;
-    }
-  }
 
-  if (do_beamskip) {
     int skipped_beam_count = 0;
     for (beam_ind = 0; beam_ind < self->max_beams_; beam_ind++) {
       if ((obs_count[beam_ind] / static_cast<double>(set->sample_count)) > beam_skip_threshold) {
@@ -217,26 +233,28 @@ LikelihoodFieldModelProb::sensorFunction(LaserData * data, pf_sample_set_t * set
       error = true;
     }
 
-    for (j = 0; j < set->sample_count; j++) {
-      sample = set->samples + j;
-      pose = sample->pose;
+    total_weight = self->weighSamples(
+      set->sample_count, [&](int, int begin, int end) {
+        double log_p;
+        double chunk_weight = 0.0;
 
-      log_p = 0;
+        for (int j = begin; j < end; j++) {
+          log_p = 0;
 
-      for (beam_ind = 0; beam_ind < self->max_beams_; beam_ind++) {
-        if (error || obs_mask[beam_ind]) {
-          log_p += log(self->temp_obs_[j][beam_ind]);
-        }
-      }
+          for (int beam_ind = 0; beam_ind < self->max_beams_; beam_ind++) {
+            if (error || obs_mask[beam_ind]) {
+              log_p += log(self->tempObs(j, beam_ind));
+            }
+          }
 
-      sample->weight *= exp(log_p);
+          set->weight[j] *= exp(log_p);
 
-      total_weight += sample->weight;
-    }
+          chunk_weight += set->weight[j];
+        }
+        return chunk_weight;
+      });
   }
 
-  delete[] obs_count;
-  delete[] obs_mask;
   return total_weight;
 }
 
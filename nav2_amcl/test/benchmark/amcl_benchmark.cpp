@@ -0,0 +1,264 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures the time spent in each stage of the particle filter, the motion
+// update, the sensor update of each laser model, the resampling and the
+// cluster statistics, over a run of scans and for a range of particle counts.
+//
+// Usage: amcl_benchmark [-t threads] [map.pgm resolution [scans.txt]]
+//
+// Without a map a set of rooms is made up, and without scans a run through
+// the map is simulated. A scan file holds one scan per line, in the base frame
+// of a robot with its laser at the origin:
+//
+//   odom_x odom_y odom_yaw angle_min angle_increment range_max count range...
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "nav2_amcl/angleutils.hpp"
+#include "nav2_amcl/map/map.hpp"
+#include "nav2_amcl/motion_model/motion_model.hpp"
+#include "nav2_amcl/pf/pf.hpp"
+#include "nav2_amcl/sensors/laser/laser.hpp"
+#include "nav2_util/thread_pool.hpp"
+
+struct Scan
+{
+  pf_vector_t odom;
+  double angle_min;
+  double angle_increment;
+  double range_max;
+  std::vector<double> ranges;
+};
+
+// Rooms along a corridor, 20 m on a side
+static map_t * makeMap()
+{
+  map_t * map = map_alloc();
+  map->scale = 0.05;
+  map->size_x = 400;
+  map->size_y = 400;
+  map_alloc_cells(map);
+  for (int j = 0; j < map->size_y; j++) {
+    for (int i = 0; i < map->size_x; i++) {
+      bool wall = i < 2 || j < 2 || i >= map->size_x - 2 || j >= map->size_y - 2 ||
+        (j == 180 && i % 100 > 20) || (j == 220 && i % 100 < 80) ||
+        (i % 100 == 0 && (j < 180 || j > 220)) || (i % 37 == 0 && j % 53 < 3);
+      map->occ_state[MAP_INDEX(map, i, j)] = wall ? +1 : -1;
+    }
+  }
+  return map;
+}
+
+// Drives along, turning away from whatever is ahead, scanning every 10 cm
+static std::vector<Scan> simulateScans(map_t * map, int count)
+{
+  std::vector<Scan> scans;
+  pf_vector_t pose = pf_vector_zero();
+  for (int k = 0; k < count; k++) {
+    while (map_calc_range(map, pose.v[0], pose.v[1], pose.v[2], 1.0) < 1.0) {
+      pose.v[2] = nav2_amcl::angleutils::normalize(pose.v[2] + 0.3);
+    }
+    pose.v[0] += 0.1 * cos(pose.v[2]);
+    pose.v[1] += 0.1 * sin(pose.v[2]);
+    pose.v[2] = nav2_amcl::angleutils::normalize(pose.v[2] + 0.02);
+
+    Scan scan;
+    scan.odom = pose;
+    scan.angle_min = -M_PI;
+    scan.angle_increment = 2 * M_PI / 360;
+    scan.range_max = 12.0;
+    for (int i = 0; i < 360; i++) {
+      scan.ranges.push_back(
+        map_calc_range(
+          map, pose.v[0], pose.v[1], pose.v[2] + scan.angle_min + i * scan.angle_increment,
+          scan.range_max));
+    }
+    scans.push_back(scan);
+  }
+  return scans;
+}
+
+static bool loadScans(const char * filename, std::vector<Scan> & scans)
+{
+  std::ifstream file(filename);
+  std::string line;
+  while (std::getline(file, line)) {
+    std::istringstream fields(line);
+    Scan scan;
+    int count;
+    if (!(fields >> scan.odom.v[0] >> scan.odom.v[1] >> scan.odom.v[2] >> scan.angle_min >>
+      scan.angle_increment >> scan.range_max >> count))
+    {
+      continue;
+    }
+    scan.ranges.resize(count);
+    for (double & range : scan.ranges) {
+      fields >> range;
+    }
+    if (fields) {
+      scans.push_back(scan);
+    }
+  }
+  return !scans.empty();
+}
+
+static pf_vector_t originPose(void *)
+{
+  return pf_vector_zero();
+}
+
+template<typename Function>
+static double timeOf(Function function)
+{
+  auto start = std::chrono::steady_clock::now();
+  function();
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+static void printTimes(const char * stage, int particles, std::vector<double> & times)
+{
+  std::sort(times.begin(), times.end());
+  double median = times[times.size() / 2];
+  double p90 = times[std::min(times.size() - 1, times.size() * 9 / 10)];
+  printf(
+    "%-22s %10d %12.3f %12.3f %12.3f %14.3f\n", stage, particles, median, p90, times.back(),
+    1e6 * median / particles);
+}
+
+int main(int argc, char ** argv)
+{
+  int threads = 1;
+  int arg = 1;
+  if (arg + 1 < argc && strcmp(argv[arg], "-t") == 0) {
+    threads = atoi(argv[arg + 1]);
+    arg += 2;
+  }
+
+  map_t * map;
+  if (arg + 1 < argc) {
+    map = map_alloc();
+    if (map_load_occ(map, argv[arg], atof(argv[arg + 1]), 0) != 0) {
+      return 1;
+    }
+    arg += 2;
+  } else {
+    map = makeMap();
+  }
+  map_update_cspace(map, 2.0);
+
+  std::vector<Scan> scans;
+  if (arg < argc) {
+    if (!loadScans(argv[arg], scans)) {
+      fprintf(stderr, "No scans in %s\n", argv[arg]);
+      return 1;
+    }
+  } else {
+    scans = simulateScans(map, 200);
+  }
+
+  std::shared_ptr<nav2_util::ThreadPool> pool;
+  if (threads != 1) {
+    pool = std::make_shared<nav2_util::ThreadPool>(std::max(0, threads));
+  }
+
+  std::string motion_type = "differential";
+  std::unique_ptr<nav2_amcl::MotionModel> motion_model(
+    nav2_amcl::MotionModel::createMotionModel(motion_type, 0.2, 0.2, 0.2, 0.2, 0.2));
+  motion_model->setThreadPool(pool);
+
+  const char * laser_names[] = {"sensor beam", "sensor lf", "sensor lf_prob"};
+  std::unique_ptr<nav2_amcl::Laser> lasers[] = {
+    std::unique_ptr<nav2_amcl::Laser>(
+      new nav2_amcl::BeamModel(0.5, 0.05, 0.05, 0.5, 0.2, 0.1, 0.0, 60, map)),
+    std::unique_ptr<nav2_amcl::Laser>(
+      new nav2_amcl::LikelihoodFieldModel(0.5, 0.5, 0.2, 2.0, 60, map)),
+    std::unique_ptr<nav2_amcl::Laser>(
+      new nav2_amcl::LikelihoodFieldModelProb(
+        0.5, 0.5, 0.2, 2.0, false, 0.5, 0.3, 0.9, 60, map)),
+  };
+  pf_vector_t laser_pose = pf_vector_zero();
+  for (auto & laser : lasers) {
+    laser->SetLaserPose(laser_pose);
+    laser->setThreadPool(pool);
+  }
+
+  printf(
+    "%zu scans, %d x %d map, %d threads\n\n", scans.size(), map->size_x, map->size_y,
+    pool ? static_cast<int>(pool->size()) : 1);
+  printf(
+    "%-22s %10s %12s %12s %12s %14s\n", "stage", "particles", "median [ms]", "p90 [ms]",
+    "max [ms]", "per 1M [ms]");
+
+  for (int particles : {500, 1000, 2000, 5000, 10000}) {
+    // The number of particles is held fixed, so every update does the same work
+    pf_t * pf = pf_alloc(particles, particles, 0.0, 0.0, originPose, NULL);
+    pf_matrix_t cov = pf_matrix_zero();
+    cov.m[0][0] = 0.1;
+    cov.m[1][1] = 0.1;
+    cov.m[2][2] = 0.05;
+    pf_init(pf, scans[0].odom, cov);
+
+    std::vector<double> action_times, resample_times, cluster_times;
+    std::vector<double> sensor_times[3];
+    for (size_t k = 1; k < scans.size(); k++) {
+      const Scan & scan = scans[k];
+      pf_vector_t delta;
+      delta.v[0] = scan.odom.v[0] - scans[k - 1].odom.v[0];
+      delta.v[1] = scan.odom.v[1] - scans[k - 1].odom.v[1];
+      delta.v[2] = nav2_amcl::angleutils::angle_diff(scan.odom.v[2], scans[k - 1].odom.v[2]);
+      action_times.push_back(
+        timeOf([&]() {motion_model->odometryUpdate(pf, scan.odom, delta);}));
+
+      nav2_amcl::LaserData ldata;
+      ldata.resize(static_cast<int>(scan.ranges.size()), false);
+      ldata.range_max = scan.range_max;
+      for (int i = 0; i < ldata.range_count; i++) {
+        ldata.ranges[i][0] = scan.ranges[i];
+        ldata.ranges[i][1] = scan.angle_min + i * scan.angle_increment;
+      }
+      for (int l = 0; l < 3; l++) {
+        ldata.laser = lasers[l].get();
+        sensor_times[l].push_back(timeOf([&]() {lasers[l]->sensorUpdate(pf, &ldata);}));
+      }
+
+      resample_times.push_back(timeOf([&]() {pf_update_resample(pf);}));
+      cluster_times.push_back(
+        timeOf([&]() {pf_cluster_stats(pf, pf->sets + pf->current_set);}));
+    }
+
+    printTimes("action", particles, action_times);
+    for (int l = 0; l < 3; l++) {
+      printTimes(laser_names[l], particles, sensor_times[l]);
+    }
+    printTimes("resample", particles, resample_times);
+    printTimes("cluster stats", particles, cluster_times);
+    printf("\n");
+    pf_free(pf);
+  }
+
+  map_free(map);
+  return 0;
+}
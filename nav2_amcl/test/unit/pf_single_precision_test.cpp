@@ -0,0 +1,127 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// The filter core built with PF_SINGLE_PRECISION, whatever AMCL_SINGLE_PRECISION says,
+// where the poses stored are rounded from the ones drawn
+
+#include <cmath>
+#include <cstdlib>
+
+#include "gtest/gtest.h"
+#include "nav2_amcl/pf/pf.hpp"
+
+static_assert(sizeof(pf_real_t) == sizeof(float), "The test is built in single precision");
+
+namespace
+{
+
+const double kTargetX = 1.234567;
+const double kTargetY = -2.345678;
+
+// A coordinate just below a multiple of the histogram's 0.5 m cells, which a float
+// rounds up into the next cell, or anywhere else at random
+double nearCellBorder(double value)
+{
+  if (drand48() < 0.5) {
+    return std::round(value / 0.5) * 0.5 - 1e-9;
+  }
+  return value;
+}
+
+// Poses spread over a few meters, many of them a rounding away from another cell
+pf_vector_t randomPose(void *)
+{
+  pf_vector_t pose;
+  pose.v[0] = nearCellBorder(kTargetX + (drand48() - 0.5) * 6.0);
+  pose.v[1] = nearCellBorder(kTargetY + (drand48() - 0.5) * 6.0);
+  pose.v[2] = (drand48() - 0.5) * 2 * M_PI;
+  return pose;
+}
+
+// Weigh the samples by their distance to the target, scaled so the average
+// likelihood can drop and the resampling draws random poses too
+double sensorModel(void * data, pf_sample_set_t * set)
+{
+  double scale = *static_cast<double *>(data);
+  double total = 0.0;
+  for (int i = 0; i < set->sample_count; ++i) {
+    double dx = set->x[i] - kTargetX;
+    double dy = set->y[i] - kTargetY;
+    set->weight[i] *= scale * std::exp(-(dx * dx + dy * dy) / 0.5);
+    total += set->weight[i];
+  }
+  return total;
+}
+
+// Every sample of the current set has to be in a cluster
+void expectLabeled(pf_t * pf)
+{
+  pf_sample_set_t * set = pf->sets + pf->current_set;
+  pf_cluster_stats(pf, set);
+  ASSERT_GT(set->cluster_count, 0);
+  for (int i = 0; i < set->sample_count; ++i) {
+    ASSERT_GE(pf->cluster_labels[i], 0) << "sample " << i;
+  }
+}
+
+void runFilter(pf_t * pf)
+{
+  double scales[] = {1.0, 1.0, 1e-3, 1e-3, 1.0};
+  for (double scale : scales) {
+    pf_update_sensor(pf, sensorModel, &scale);
+    pf_update_resample(pf);
+    expectLabeled(pf);
+  }
+
+  double weight;
+  pf_vector_t mean;
+  pf_matrix_t cov;
+  ASSERT_TRUE(pf_get_cluster_stats(pf, 0, &weight, &mean, &cov));
+  EXPECT_GT(weight, 0.0);
+  EXPECT_TRUE(std::isfinite(mean.v[0]) && std::isfinite(mean.v[1]));
+}
+
+}  // namespace
+
+TEST(pf_single_precision, clusters_every_sample_from_a_gaussian)
+{
+  srand48(33);
+  pf_t * pf = pf_alloc(500, 5000, 0.001, 0.1, randomPose, nullptr);
+
+  pf_vector_t mean = pf_vector_zero();
+  mean.v[0] = kTargetX;
+  mean.v[1] = kTargetY;
+  mean.v[2] = 0.3;
+  pf_matrix_t cov = pf_matrix_zero();
+  cov.m[0][0] = 1.0;
+  cov.m[1][1] = 1.0;
+  cov.m[2][2] = 0.5;
+  pf_init(pf, mean, cov);
+  expectLabeled(pf);
+
+  runFilter(pf);
+  pf_free(pf);
+}
+
+TEST(pf_single_precision, clusters_every_sample_from_a_model)
+{
+  srand48(90);
+  pf_t * pf = pf_alloc(500, 5000, 0.001, 0.1, randomPose, nullptr);
+
+  pf_init_model(pf, randomPose, nullptr);
+  expectLabeled(pf);
+
+  runFilter(pf);
+  pf_free(pf);
+}
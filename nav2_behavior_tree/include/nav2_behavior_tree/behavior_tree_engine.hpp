@@ -15,6 +15,7 @@
 #ifndef NAV2_BEHAVIOR_TREE__BEHAVIOR_TREE_ENGINE_HPP_
 #define NAV2_BEHAVIOR_TREE__BEHAVIOR_TREE_ENGINE_HPP_
 
+#include <chrono>
 #include <memory>
 #include <string>
 #include <vector>
@@ -22,6 +23,9 @@
 #include "behaviortree_cpp_v3/behavior_tree.h"
 #include "behaviortree_cpp_v3/bt_factory.h"
 #include "behaviortree_cpp_v3/xml_parsing.h"
+#include "nav2_behavior_tree/bt_profiler.hpp"
+#include "nav2_behavior_tree/client_registry.hpp"
+#include "nav2_behavior_tree/tick_notifier.hpp"
 
 namespace nav2_behavior_tree
 {
@@ -34,12 +38,25 @@ public:
   explicit BehaviorTreeEngine(const std::vector<std::string> & plugin_libraries);
   virtual ~BehaviorTreeEngine() {}
 
+  // How long registering the nodes of each plugin library took, in the order given.
+  // The libraries are registered one by one, as the factory isn't thread safe
+  const std::vector<std::chrono::nanoseconds> & getPluginLoadTimes() const
+  {
+    return plugin_load_times_;
+  }
+
+  // Tick the tree every loopTimeout, or with a notifier whenever one of its nodes
+  // asks for it and at least every loopTimeout, until it completes or is canceled
   BtStatus run(
     BT::Tree * tree,
     std::function<void()> onLoop,
     std::function<bool()> cancelRequested,
-    std::chrono::milliseconds loopTimeout = std::chrono::milliseconds(10));
+    std::chrono::milliseconds loopTimeout = std::chrono::milliseconds(10),
+    std::shared_ptr<TickNotifier> notifier = nullptr);
 
+  // Build a tree, and wait for the servers of its nodes if they're kept in a
+  // ClientRegistry on the blackboard. With a BtProfiler on the blackboard, the
+  // tree's nodes are profiled
   BT::Tree buildTreeFromText(
     const std::string & xml_string,
     BT::Blackboard::Ptr blackboard);
@@ -47,7 +64,7 @@ public:
   void haltAllActions(BT::TreeNode * root_node)
   {
     auto visitor = [](BT::TreeNode * node) {
-        if (auto action = dynamic_cast<BT::CoroActionNode *>(node)) {
+        if (auto action = dynamic_cast<BT::ActionNodeBase *>(node)) {
           action->halt();
         }
       };
@@ -66,6 +83,8 @@ public:
 protected:
   // The factory that will be used to dynamically construct the behavior tree
   BT::BehaviorTreeFactory factory_;
+
+  std::vector<std::chrono::nanoseconds> plugin_load_times_;
 };
 
 }  // namespace nav2_behavior_tree
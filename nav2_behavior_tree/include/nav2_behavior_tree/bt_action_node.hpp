@@ -19,6 +19,8 @@
 #include <string>
 
 #include "behaviortree_cpp_v3/action_node.h"
+#include "nav2_behavior_tree/client_registry.hpp"
+#include "nav2_behavior_tree/tick_notifier.hpp"
 #include "nav2_util/node_utils.hpp"
 #include "rclcpp_action/rclcpp_action.hpp"
 
@@ -26,14 +28,14 @@ namespace nav2_behavior_tree
 {
 
 template<class ActionT>
-class BtActionNode : public BT::CoroActionNode
+class BtActionNode : public BT::ActionNodeBase
 {
 public:
   BtActionNode(
     const std::string & xml_tag_name,
     const std::string & action_name,
     const BT::NodeConfiguration & conf)
-  : BT::CoroActionNode(xml_tag_name, conf), action_name_(action_name)
+  : BT::ActionNodeBase(xml_tag_name, conf), action_name_(action_name)
   {
     node_ = config().blackboard->get<rclcpp::Node::SharedPtr>("node");
 
@@ -46,6 +48,9 @@ public:
       config().blackboard->get<std::chrono::milliseconds>("server_timeout");
     getInput<std::chrono::milliseconds>("server_timeout", server_timeout_);
 
+    // Only there if the tree is ticked on events
+    config().blackboard->get<std::shared_ptr<TickNotifier>>("tick_notifier", tick_notifier_);
+
     createActionClient(action_name_);
 
     // Give the derive class a chance to do any initialization
@@ -61,6 +66,16 @@ public:
   // Create instance of an action server
   void createActionClient(const std::string & action_name)
   {
+    // Share the client with the other trees built with this blackboard, the
+    // engine waits for its server along with all the others
+    std::shared_ptr<ClientRegistry> client_registry;
+    if (config().blackboard->get<std::shared_ptr<ClientRegistry>>(
+        "client_registry", client_registry) && client_registry)
+    {
+      action_client_ = client_registry->getActionClient<ActionT>(action_name);
+      return;
+    }
+
     // Now that we have the ROS node to use, create the action client for this BT action
     action_client_ = rclcpp_action::create_client<ActionT>(node_, action_name);
 
@@ -87,77 +102,95 @@ public:
   }
 
   // Derived classes can override any of the following methods to hook into the
-  // processing for the action: on_tick, on_server_timeout, and on_success
+  // processing for the action: on_tick, on_server_timeout, on_feedback and on_success
 
   // Could do dynamic checks, such as getting updates to values on the blackboard
   virtual void on_tick()
   {
   }
 
-  // There can be many loop iterations per tick. Any opportunity to do something after
-  // a timeout waiting for a result that hasn't been received yet
+  // Called on every tick that finds the result hasn't been received yet. Any
+  // opportunity to do something while waiting, such as updating the goal
   virtual void on_server_timeout()
   {
   }
 
+  // Called on a tick with feedback received since the last one. Returning true ends the
+  // node with SUCCESS ahead of the result, for example on a usable interim result; the goal
+  // is left running, and the next tick waits for its result instead of sending a new
+  // one, unless on_tick changes the goal
+  virtual bool on_feedback(const typename ActionT::Feedback & /*feedback*/)
+  {
+    return false;
+  }
+
   // Called upon successful completion of the action. A derived class can override this
   // method to put a value on the blackboard, for example
   virtual void on_success()
   {
   }
 
-  // The main override required by a BT action
+  // The main override required by a BT action. The goal is sent on the first
+  // tick and the node returns RUNNING right away; the responses are collected
+  // by callbacks and checked on the following ticks, so the tree isn't blocked
+  // and other branches keep being ticked while the action runs
   BT::NodeStatus tick() override
   {
-    on_tick();
-
-new_goal_received:
-    auto future_goal_handle = action_client_->async_send_goal(goal_);
-    if (rclcpp::spin_until_future_complete(node_, future_goal_handle) !=
-      rclcpp::executor::FutureReturnCode::SUCCESS)
-    {
-      throw std::runtime_error("send_goal failed");
+    if (status() == BT::NodeStatus::IDLE) {
+      setStatus(BT::NodeStatus::RUNNING);
+      auto goal = goal_;
+      on_tick();
+      if (!goal_resumable_ || !(goal == goal_)) {
+        send_new_goal();
+      }
+      goal_resumable_ = false;
     }
 
-    goal_handle_ = future_goal_handle.get();
-    if (!goal_handle_) {
+    // Take in any responses that came in since the last tick
+    rclcpp::spin_some(node_);
+
+    if (goal_rejected_) {
+      goal_rejected_ = false;
+      setStatus(BT::NodeStatus::IDLE);
       throw std::runtime_error("Goal was rejected by the action server");
     }
 
-    auto future_result = action_client_->async_get_result(goal_handle_);
-    rclcpp::executor::FutureReturnCode rc;
-    do {
-      rc = rclcpp::spin_until_future_complete(node_, future_result, server_timeout_);
-      if (rc == rclcpp::executor::FutureReturnCode::TIMEOUT) {
-        on_server_timeout();
+    if (!goal_result_available_) {
+      if (feedback_) {
+        auto feedback = std::move(feedback_);
+        if (on_feedback(*feedback)) {
+          goal_resumable_ = true;
+          setStatus(BT::NodeStatus::IDLE);
+          return BT::NodeStatus::SUCCESS;
+        }
+      }
+
+      on_server_timeout();
 
-        // We can handle a new goal if we're still executing
+      // We can handle a new goal if we're still executing
+      if (goal_updated_ && goal_handle_) {
         auto status = goal_handle_->get_status();
-        if (goal_updated_ && (status == action_msgs::msg::GoalStatus::STATUS_EXECUTING ||
-          status == action_msgs::msg::GoalStatus::STATUS_ACCEPTED ))
+        if (status == action_msgs::msg::GoalStatus::STATUS_EXECUTING ||
+          status == action_msgs::msg::GoalStatus::STATUS_ACCEPTED)
         {
           goal_updated_ = false;
-          goto new_goal_received;
+          send_new_goal();
         }
-
-        // Yield to any other CoroActionNodes (coroutines)
-        setStatusRunningAndYield();
       }
-    } while (rc != rclcpp::executor::FutureReturnCode::SUCCESS);
+      return BT::NodeStatus::RUNNING;
+    }
 
-    result_ = future_result.get();
+    goal_result_available_ = false;
+    setStatus(BT::NodeStatus::IDLE);
     switch (result_.code) {
       case rclcpp_action::ResultCode::SUCCEEDED:
         on_success();
-        setStatus(BT::NodeStatus::IDLE);
         return BT::NodeStatus::SUCCESS;
 
       case rclcpp_action::ResultCode::ABORTED:
-        setStatus(BT::NodeStatus::IDLE);
         return BT::NodeStatus::FAILURE;
 
       case rclcpp_action::ResultCode::CANCELED:
-        setStatus(BT::NodeStatus::IDLE);
         return BT::NodeStatus::SUCCESS;
 
       default:
@@ -180,19 +213,91 @@ new_goal_received:
       }
     }
 
+    // drop any response still to come for the goal
+    ++goal_sequence_;
+    goal_handle_.reset();
+    feedback_.reset();
+    goal_result_available_ = false;
+    goal_rejected_ = false;
+    goal_resumable_ = false;
     setStatus(BT::NodeStatus::IDLE);
-    CoroActionNode::halt();
   }
 
 protected:
+  // Send goal_, replacing any goal sent before. Its responses are handled by
+  // the callbacks as the node is spun, here or between ticks
+  void send_new_goal()
+  {
+    goal_result_available_ = false;
+    goal_rejected_ = false;
+    goal_handle_.reset();
+    feedback_.reset();
+
+    // responses to goals replaced since are dropped, the server aborts or cancels those
+    unsigned int goal_sequence = ++goal_sequence_;
+
+    // a shared client outlives the node, so its callbacks may come after it's gone
+    std::weak_ptr<void> alive = alive_;
+
+    auto send_goal_options = typename rclcpp_action::Client<ActionT>::SendGoalOptions();
+    send_goal_options.goal_response_callback =
+      [this, alive, goal_sequence](
+      std::shared_future<typename rclcpp_action::ClientGoalHandle<ActionT>::SharedPtr> future) {
+        if (alive.expired() || goal_sequence != goal_sequence_) {
+          return;
+        }
+        goal_handle_ = future.get();
+        goal_rejected_ = !goal_handle_;
+        notify_tick();
+      };
+    send_goal_options.result_callback =
+      [this, alive, goal_sequence](
+      const typename rclcpp_action::ClientGoalHandle<ActionT>::WrappedResult & result) {
+        if (alive.expired() || goal_sequence != goal_sequence_) {
+          return;
+        }
+        result_ = result;
+        goal_result_available_ = true;
+        notify_tick();
+      };
+    send_goal_options.feedback_callback =
+      [this, alive, goal_sequence](
+      typename rclcpp_action::ClientGoalHandle<ActionT>::SharedPtr,
+      const std::shared_ptr<const typename ActionT::Feedback> feedback) {
+        if (alive.expired() || goal_sequence != goal_sequence_) {
+          return;
+        }
+        feedback_ = feedback;
+        notify_tick();
+      };
+
+    future_goal_handle_ = action_client_->async_send_goal(goal_, send_goal_options);
+  }
+
+  // Wake the tree, if it's ticked on events
+  void notify_tick()
+  {
+    if (tick_notifier_) {
+      tick_notifier_->notify();
+    }
+  }
+
   bool should_cancel_goal()
   {
-    // Shut the node down if it is currently running
-    if (status() != BT::NodeStatus::RUNNING) {
+    // Shut the node down if it is currently running, or left its goal running
+    if (status() != BT::NodeStatus::RUNNING && !goal_resumable_) {
       return false;
     }
 
+    // The goal may not have been accepted yet
+    if (!goal_handle_ && future_goal_handle_.valid()) {
+      rclcpp::spin_until_future_complete(node_, future_goal_handle_, server_timeout_);
+    }
     rclcpp::spin_some(node_);
+    if (!goal_handle_) {
+      return false;
+    }
+
     auto status = goal_handle_->get_status();
 
     // Check if the goal is still executing
@@ -214,12 +319,31 @@ protected:
   typename rclcpp_action::ClientGoalHandle<ActionT>::SharedPtr goal_handle_;
   typename rclcpp_action::ClientGoalHandle<ActionT>::WrappedResult result_;
 
+  // The state of the goal sent last, as set by the callbacks
+  std::shared_future<typename rclcpp_action::ClientGoalHandle<ActionT>::SharedPtr>
+  future_goal_handle_;
+  unsigned int goal_sequence_{0};
+  bool goal_result_available_{false};
+  bool goal_rejected_{false};
+
+  // The latest feedback not yet handed to on_feedback
+  std::shared_ptr<const typename ActionT::Feedback> feedback_;
+
+  // Whether on_feedback ended the node with the goal still running
+  bool goal_resumable_{false};
+
+  // Expires with the node, for the callbacks to tell
+  std::shared_ptr<void> alive_{std::make_shared<bool>(true)};
+
   // The node that will be used for any ROS operations
   rclcpp::Node::SharedPtr node_;
 
   // The timeout value while to use in the tick loop while waiting for
   // a result from the server
   std::chrono::milliseconds server_timeout_;
+
+  // Wakes the tree on results and feedback, if it's ticked on events
+  std::shared_ptr<TickNotifier> tick_notifier_;
 };
 
 }  // namespace nav2_behavior_tree
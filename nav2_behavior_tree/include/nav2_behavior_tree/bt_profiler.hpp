@@ -0,0 +1,111 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_BEHAVIOR_TREE__BT_PROFILER_HPP_
+#define NAV2_BEHAVIOR_TREE__BT_PROFILER_HPP_
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "behaviortree_cpp_v3/behavior_tree.h"
+#include "behaviortree_cpp_v3/bt_factory.h"
+#include "nav2_msgs/msg/behavior_tree_profile.hpp"
+#include "rclcpp/rclcpp.hpp"
+
+namespace nav2_behavior_tree
+{
+
+/**
+ * @class ProfileNode
+ * @brief Decorator the BtProfiler puts above every node of a tree, timing the
+ * node's ticks and passing its status through
+ */
+class ProfileNode : public BT::DecoratorNode
+{
+public:
+  typedef std::chrono::steady_clock Clock;
+
+  explicit ProfileNode(BT::TreeNode * child);
+
+  void halt() override;
+
+  // The node being profiled
+  const BT::TreeNode * child() const {return child_node_;}
+
+  uint64_t ticks{0};
+  Clock::duration total_tick_time{0};
+  Clock::duration max_tick_time{0};
+  Clock::duration running_time{0};
+
+protected:
+  BT::NodeStatus tick() override;
+
+  // Set while the child is RUNNING, to when it started to
+  Clock::time_point running_since_;
+  bool running_{false};
+};
+
+/**
+ * @class BtProfiler
+ * @brief Records the tick count and times of every node of the trees it
+ * instruments, and publishes them on behavior_tree_profile. The
+ * BehaviorTreeEngine instruments the trees it builds when it finds the
+ * profiler on the blackboard under "bt_profiler".
+ */
+class BtProfiler
+{
+public:
+  /**
+   * @param node The node to publish with
+   * @param period The time between two profiles
+   */
+  BtProfiler(rclcpp::Node::SharedPtr node, std::chrono::milliseconds period);
+
+  /**
+   * @brief Put a ProfileNode above every node of a tree, including its root
+   */
+  void instrument(BT::Tree & tree);
+
+  /**
+   * @brief Publish the profile of the instrumented trees, if a period has
+   * passed since the last one
+   */
+  void publish();
+
+protected:
+  // Wrap the children of a node and their descendants
+  void instrumentChildren(BT::Tree & tree, BT::TreeNode * node);
+
+  // Wrap a node and keep the wrapper with the tree
+  BT::TreeNode * wrap(BT::Tree & tree, BT::TreeNode * node);
+
+  rclcpp::Node::SharedPtr node_;
+  rclcpp::Publisher<nav2_msgs::msg::BehaviorTreeProfile>::SharedPtr profile_pub_;
+
+  std::chrono::milliseconds period_;
+  ProfileNode::Clock::time_point last_publish_;
+  uint64_t last_root_ticks_{0};
+
+  // The wrappers of the trees' roots and of all their nodes, owned by the trees
+  std::mutex mutex_;
+  std::vector<std::weak_ptr<ProfileNode>> roots_;
+  std::vector<std::weak_ptr<ProfileNode>> nodes_;
+};
+
+}  // namespace nav2_behavior_tree
+
+#endif  // NAV2_BEHAVIOR_TREE__BT_PROFILER_HPP_
@@ -19,6 +19,7 @@
 #include <memory>
 
 #include "behaviortree_cpp_v3/action_node.h"
+#include "nav2_behavior_tree/client_registry.hpp"
 #include "nav2_util/node_utils.hpp"
 #include "rclcpp/rclcpp.hpp"
 
@@ -43,13 +44,23 @@ public:
 
     // Now that we have node_ to use, create the service client for this BT service
     getInput("service_name", service_name_);
-    service_client_ = node_->create_client<ServiceT>(service_name_);
 
-    // Make sure the server is actually there before continuing
-    RCLCPP_INFO(
-      node_->get_logger(), "Waiting for \"%s\" service",
-      service_name_.c_str());
-    service_client_->wait_for_service();
+    // Share the client with the other trees built with this blackboard, the
+    // engine waits for its server along with all the others
+    std::shared_ptr<ClientRegistry> client_registry;
+    if (config().blackboard->get<std::shared_ptr<ClientRegistry>>(
+        "client_registry", client_registry) && client_registry)
+    {
+      service_client_ = client_registry->getServiceClient<ServiceT>(service_name_);
+    } else {
+      service_client_ = node_->create_client<ServiceT>(service_name_);
+
+      // Make sure the server is actually there before continuing
+      RCLCPP_INFO(
+        node_->get_logger(), "Waiting for \"%s\" service",
+        service_name_.c_str());
+      service_client_->wait_for_service();
+    }
 
     RCLCPP_INFO(
       node_->get_logger(), "\"%s\" BtServiceNode initialized",
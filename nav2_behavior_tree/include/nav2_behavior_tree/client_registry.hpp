@@ -0,0 +1,154 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_BEHAVIOR_TREE__CLIENT_REGISTRY_HPP_
+#define NAV2_BEHAVIOR_TREE__CLIENT_REGISTRY_HPP_
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <typeindex>
+#include <utility>
+
+#include "rclcpp/rclcpp.hpp"
+#include "rclcpp_action/rclcpp_action.hpp"
+
+namespace nav2_behavior_tree
+{
+
+/**
+ * @class ClientRegistry
+ * @brief Keeps the action and service clients of the tree's nodes, one per type
+ * and name, so trees built again from the same XML reuse them rather than
+ * creating new ones and waiting for their servers again. The nodes of a tree
+ * don't wait for their servers when they find the registry on the blackboard
+ * under "client_registry"; the BehaviorTreeEngine waits for all of them at
+ * once after building the tree.
+ */
+class ClientRegistry
+{
+public:
+  explicit ClientRegistry(rclcpp::Node::SharedPtr node)
+  : node_(node)
+  {
+  }
+
+  /**
+   * @brief Get the client for an action, creating it on first use
+   */
+  template<class ActionT>
+  typename rclcpp_action::Client<ActionT>::SharedPtr getActionClient(
+    const std::string & action_name)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Entry & entry = clients_[std::make_pair(std::type_index(typeid(ActionT)), action_name)];
+    if (!entry.client) {
+      auto client = rclcpp_action::create_client<ActionT>(node_, action_name);
+      entry.client = client;
+      entry.server_name = action_name;
+      entry.is_ready = [client]() {return client->action_server_is_ready();};
+    }
+    return std::static_pointer_cast<rclcpp_action::Client<ActionT>>(entry.client);
+  }
+
+  /**
+   * @brief Get the client for a service, creating it on first use
+   */
+  template<class ServiceT>
+  typename rclcpp::Client<ServiceT>::SharedPtr getServiceClient(
+    const std::string & service_name)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Entry & entry = clients_[std::make_pair(std::type_index(typeid(ServiceT)), service_name)];
+    if (!entry.client) {
+      auto client = node_->create_client<ServiceT>(service_name);
+      entry.client = client;
+      entry.server_name = service_name;
+      entry.is_ready = [client]() {return client->service_is_ready();};
+    }
+    return std::static_pointer_cast<rclcpp::Client<ServiceT>>(entry.client);
+  }
+
+  /**
+   * @brief Wait until the servers of all the clients are available. They're
+   * all checked on every change to the ROS graph, so the wait is as long as
+   * the slowest server takes to come up rather than the sum of them all.
+   * @param timeout The longest to wait for, negative to wait as long as it takes
+   * @return True if all the servers are available
+   */
+  bool waitForServers(std::chrono::nanoseconds timeout = std::chrono::nanoseconds(-1))
+  {
+    auto start = std::chrono::steady_clock::now();
+    auto event = node_->get_graph_event();
+    bool logged = false;
+
+    while (rclcpp::ok()) {
+      std::string missing;
+      size_t num_missing = 0;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto & client : clients_) {
+          if (!client.second.is_ready()) {
+            missing = client.second.server_name;
+            ++num_missing;
+          }
+        }
+      }
+      if (num_missing == 0) {
+        return true;
+      }
+
+      if (!logged) {
+        RCLCPP_INFO(
+          node_->get_logger(), "Waiting for %zu servers, such as \"%s\"",
+          num_missing, missing.c_str());
+        logged = true;
+      }
+
+      // Wake up on graph changes, and now and then in case one was missed
+      std::chrono::nanoseconds wait = std::chrono::milliseconds(100);
+      if (timeout >= std::chrono::nanoseconds(0)) {
+        auto remaining = timeout - (std::chrono::steady_clock::now() - start);
+        if (remaining <= std::chrono::nanoseconds(0)) {
+          return false;
+        }
+        wait = std::min(wait, std::chrono::duration_cast<std::chrono::nanoseconds>(remaining));
+      }
+      node_->wait_for_graph_change(event, wait);
+      event->check_and_clear();
+    }
+    return false;
+  }
+
+protected:
+  struct Entry
+  {
+    std::shared_ptr<void> client;
+    std::string server_name;
+    std::function<bool()> is_ready;
+  };
+
+  rclcpp::Node::SharedPtr node_;
+
+  std::mutex mutex_;
+  std::map<std::pair<std::type_index, std::string>, Entry> clients_;
+};
+
+}  // namespace nav2_behavior_tree
+
+#endif  // NAV2_BEHAVIOR_TREE__CLIENT_REGISTRY_HPP_
@@ -0,0 +1,80 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_BEHAVIOR_TREE__PORT_CACHE_HPP_
+#define NAV2_BEHAVIOR_TREE__PORT_CACHE_HPP_
+
+#include <string>
+
+#include "behaviortree_cpp_v3/tree_node.h"
+
+namespace nav2_behavior_tree
+{
+
+/**
+ * @brief An input port of a node, read once if it's given as a literal in the XML
+ *
+ * BT::TreeNode::getInput() converts a literal value from its string on every call, which
+ * for a point means splitting and parsing it each time. The cache converts a literal once,
+ * when the node is created, and keeps the typed value. A port remapped to the blackboard,
+ * whose value may change between ticks, is still read on each call.
+ */
+template<typename T>
+class CachedInput
+{
+public:
+  /**
+   * @brief Read the port, if it's a literal
+   * @param node The node the port is of, which must outlive the cache
+   * @param key The name of the port
+   */
+  CachedInput(const BT::TreeNode & node, const std::string & key)
+  : node_(node), key_(key)
+  {
+    auto it = node.config().input_ports.find(key);
+    remapped_ = it != node.config().input_ports.end() &&
+      BT::TreeNode::isBlackboardPointer(it->second);
+    if (!remapped_) {
+      // a literal that fails to convert fails on every read alike
+      found_ = static_cast<bool>(node_.getInput(key_, value_));
+    }
+  }
+
+  /**
+   * @brief Get the value of the port
+   * @param value Set to the value, if there is one
+   * @return True if the port has a value
+   */
+  bool get(T & value) const
+  {
+    if (remapped_) {
+      return static_cast<bool>(node_.getInput(key_, value));
+    }
+    if (found_) {
+      value = value_;
+    }
+    return found_;
+  }
+
+protected:
+  const BT::TreeNode & node_;
+  std::string key_;
+  bool remapped_;
+  bool found_{false};
+  T value_{};
+};
+
+}  // namespace nav2_behavior_tree
+
+#endif  // NAV2_BEHAVIOR_TREE__PORT_CACHE_HPP_
@@ -0,0 +1,123 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_BEHAVIOR_TREE__TICK_NOTIFIER_HPP_
+#define NAV2_BEHAVIOR_TREE__TICK_NOTIFIER_HPP_
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+
+#include "rclcpp/rclcpp.hpp"
+
+namespace nav2_behavior_tree
+{
+
+/**
+ * @class TickNotifier
+ * @brief Lets the nodes of a tree wake the BehaviorTreeEngine when there's
+ * something new to tick for, instead of it ticking at a fixed rate. While the
+ * engine waits, it processes the callbacks of the tree's ROS node, so action
+ * results and feedback arrive and can notify it. Nodes find the notifier on
+ * the blackboard under "tick_notifier".
+ */
+class TickNotifier
+{
+public:
+  typedef std::chrono::steady_clock Clock;
+
+  explicit TickNotifier(rclcpp::Node::SharedPtr node)
+  : node_(node), deadline_(Clock::time_point::max())
+  {
+  }
+
+  /**
+   * @brief Ask for a tick as soon as possible, may be called from any thread
+   */
+  void notify()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      notified_ = true;
+    }
+
+    // Wake the executor waiting on the node, if there's one
+    auto node_base = node_->get_node_base_interface();
+    auto guard_lock = node_base->acquire_notify_guard_condition_lock();
+    rcl_ret_t ret = rcl_trigger_guard_condition(node_base->get_notify_guard_condition());
+    if (ret != RCL_RET_OK) {
+      rclcpp::exceptions::throw_from_rcl_error(ret, "failed to wake the behavior tree");
+    }
+  }
+
+  /**
+   * @brief Ask for a tick no later than a point in time, for nodes that wait on the clock
+   */
+  void notifyAt(Clock::time_point deadline)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    deadline_ = std::min(deadline_, deadline);
+  }
+
+  /**
+   * @brief Process the node's callbacks until notified, until a time asked for
+   * with notifyAt() or for at most the timeout
+   * @param timeout The longest to wait for
+   * @return True if notified
+   */
+  bool wait(std::chrono::milliseconds timeout)
+  {
+    Clock::time_point deadline = Clock::now() + timeout;
+    bool notified = false;
+
+    // The tree's nodes spin the node themselves while ticking, so it's only
+    // added to the executor for the wait
+    executor_.add_node(node_);
+    while (true) {
+      Clock::time_point wake_up;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (notified_) {
+          notified = true;
+          break;
+        }
+        wake_up = std::min(deadline, deadline_);
+      }
+      Clock::time_point now = Clock::now();
+      if (now >= wake_up) {
+        break;
+      }
+      executor_.spin_once(wake_up - now);
+    }
+    executor_.remove_node(node_);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    notified_ = false;
+    deadline_ = Clock::time_point::max();
+    return notified;
+  }
+
+protected:
+  rclcpp::Node::SharedPtr node_;
+  rclcpp::executors::SingleThreadedExecutor executor_;
+
+  std::mutex mutex_;
+  bool notified_{false};
+  Clock::time_point deadline_;
+};
+
+}  // namespace nav2_behavior_tree
+
+#endif  // NAV2_BEHAVIOR_TREE__TICK_NOTIFIER_HPP_
@@ -21,6 +21,7 @@
 #include "nav2_msgs/action/compute_path_to_pose.hpp"
 #include "nav_msgs/msg/path.h"
 #include "nav2_behavior_tree/bt_action_node.hpp"
+#include "nav2_behavior_tree/port_cache.hpp"
 
 namespace nav2_behavior_tree
 {
@@ -32,7 +33,9 @@ public:
     const std::string & xml_tag_name,
     const std::string & action_name,
     const BT::NodeConfiguration & conf)
-  : BtActionNode<nav2_msgs::action::ComputePathToPose>(xml_tag_name, action_name, conf)
+  : BtActionNode<nav2_msgs::action::ComputePathToPose>(xml_tag_name, action_name, conf),
+    planner_id_(*this, "planner_id"),
+    accept_interim_(*this, "accept_interim")
   {
     std::string remapped_action_name;
     if (getInput("server_name", remapped_action_name)) {
@@ -44,18 +47,24 @@ public:
   void on_tick() override
   {
     getInput("goal", goal_.pose);
-    getInput("planner_id", goal_.planner_id);
+    planner_id_.get(goal_.planner_id);
   }
 
-  void on_success() override
+  // Hand the interim path over right away, the final one follows on a later tick
+  bool on_feedback(const nav2_msgs::action::ComputePathToPose::Feedback & feedback) override
   {
-    setOutput("path", result_.result->path);
-
-    if (first_time_) {
-      first_time_ = false;
-    } else {
-      config().blackboard->set("path_updated", true);
+    bool accept_interim = false;
+    accept_interim_.get(accept_interim);
+    if (!accept_interim || feedback.path.poses.empty()) {
+      return false;
     }
+    setPath(feedback.path);
+    return true;
+  }
+
+  void on_success() override
+  {
+    setPath(result_.result->path);
   }
 
   static BT::PortsList providedPorts()
@@ -65,11 +74,28 @@ public:
         BT::OutputPort<nav_msgs::msg::Path>("path", "Path created by ComputePathToPose node"),
         BT::InputPort<geometry_msgs::msg::PoseStamped>("goal", "Destination to plan to"),
         BT::InputPort<std::string>("planner_id", ""),
-        BT::InputPort<std::string>("server_name", "")
+        BT::InputPort<std::string>("server_name", ""),
+        BT::InputPort<bool>(
+          "accept_interim", false,
+          "Succeed with the planner's interim path, then its final path on a later tick")
       });
   }
 
 private:
+  CachedInput<std::string> planner_id_;
+  CachedInput<bool> accept_interim_;
+
+  void setPath(const nav_msgs::msg::Path & path)
+  {
+    setOutput("path", path);
+
+    if (first_time_) {
+      first_time_ = false;
+    } else {
+      config().blackboard->set("path_updated", true);
+    }
+  }
+
   bool first_time_{true};
 };
 
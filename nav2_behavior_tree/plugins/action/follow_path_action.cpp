@@ -20,6 +20,7 @@
 
 #include "nav2_msgs/action/follow_path.hpp"
 #include "nav2_behavior_tree/bt_action_node.hpp"
+#include "nav2_behavior_tree/port_cache.hpp"
 
 namespace nav2_behavior_tree
 {
@@ -31,7 +32,8 @@ public:
     const std::string & xml_tag_name,
     const std::string & action_name,
     const BT::NodeConfiguration & conf)
-  : BtActionNode<nav2_msgs::action::FollowPath>(xml_tag_name, action_name, conf)
+  : BtActionNode<nav2_msgs::action::FollowPath>(xml_tag_name, action_name, conf),
+    controller_id_(*this, "controller_id")
   {
     std::string remapped_action_name;
     if (getInput("server_name", remapped_action_name)) {
@@ -44,7 +46,7 @@ public:
   void on_tick() override
   {
     getInput("path", goal_.path);
-    getInput("controller_id", goal_.controller_id);
+    controller_id_.get(goal_.controller_id);
   }
 
   void on_server_timeout() override
@@ -70,6 +72,9 @@ public:
         BT::InputPort<std::string>("server_name", "")
       });
   }
+
+private:
+  CachedInput<std::string> controller_id_;
 };
 
 }  // namespace nav2_behavior_tree
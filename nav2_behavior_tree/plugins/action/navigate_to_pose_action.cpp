@@ -23,6 +23,7 @@
 #include "nav2_msgs/action/navigate_to_pose.hpp"
 #include "nav2_behavior_tree/bt_action_node.hpp"
 #include "nav2_behavior_tree/bt_conversions.hpp"
+#include "nav2_behavior_tree/port_cache.hpp"
 
 namespace nav2_behavior_tree
 {
@@ -34,7 +35,9 @@ public:
     const std::string & xml_tag_name,
     const std::string & action_name,
     const BT::NodeConfiguration & conf)
-  : BtActionNode<nav2_msgs::action::NavigateToPose>(xml_tag_name, action_name, conf)
+  : BtActionNode<nav2_msgs::action::NavigateToPose>(xml_tag_name, action_name, conf),
+    position_(*this, "position"),
+    orientation_(*this, "orientation")
   {
   }
 
@@ -44,7 +47,7 @@ public:
     geometry_msgs::msg::Point position;
     geometry_msgs::msg::Quaternion orientation;
 
-    if (!getInput("position", position) || !getInput("orientation", orientation)) {
+    if (!position_.get(position) || !orientation_.get(orientation)) {
       RCLCPP_ERROR(
         node_->get_logger(),
         "NavigateToPoseAction: position or orientation not provided");
@@ -64,6 +67,10 @@ public:
         BT::InputPort<geometry_msgs::msg::Quaternion>("orientation", "Orientation")
       });
   }
+
+private:
+  CachedInput<geometry_msgs::msg::Point> position_;
+  CachedInput<geometry_msgs::msg::Quaternion> orientation_;
 };
 
 }  // namespace nav2_behavior_tree
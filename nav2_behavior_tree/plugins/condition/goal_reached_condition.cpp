@@ -70,7 +70,17 @@ public:
   {
     geometry_msgs::msg::PoseStamped current_pose;
 
-    if (!nav2_util::getCurrentPose(current_pose, *tf_)) {
+    // Use the pose looked up for this tick if there's one, or look it up
+    bool pose_available;
+    if (config().blackboard->get<bool>("robot_pose_available", pose_available)) {
+      if (pose_available) {
+        current_pose = config().blackboard->get<geometry_msgs::msg::PoseStamped>("robot_pose");
+      }
+    } else {
+      pose_available = nav2_util::getCurrentPose(current_pose, *tf_);
+    }
+
+    if (!pose_available) {
       RCLCPP_DEBUG(node_->get_logger(), "Current robot pose is not available.");
       return false;
     }
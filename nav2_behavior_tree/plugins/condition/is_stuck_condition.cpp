@@ -16,11 +16,11 @@
 #define NAV2_BEHAVIOR_TREE__IS_STUCK_CONDITION_HPP_
 
 #include <string>
+#include <array>
 #include <chrono>
 #include <cmath>
 #include <atomic>
 #include <memory>
-#include <deque>
 
 #include "rclcpp/rclcpp.hpp"
 #include "behaviortree_cpp_v3/condition_node.h"
@@ -39,7 +39,6 @@ public:
     const BT::NodeConfiguration & conf)
   : BT::ConditionNode(condition_name, conf),
     is_stuck_(false),
-    odom_history_size_(10),
     current_accel_(0.0),
     brake_accel_limit_(-10.0)
   {
@@ -66,11 +65,12 @@ public:
   {
     RCLCPP_INFO_ONCE(node_->get_logger(), "Got odometry");
 
-    while (odom_history_.size() >= odom_history_size_) {
-      odom_history_.pop_front();
-    }
-
-    odom_history_.push_back(*msg);
+    // Keep only what the states are computed from, overwriting the oldest sample
+    OdomSample & sample = odom_history_[odom_count_ % odom_history_.size()];
+    sample.time = static_cast<double>(msg->header.stamp.sec) +
+      static_cast<double>(msg->header.stamp.nanosec) * 1e-9;
+    sample.linear_x = msg->twist.twist.linear.x;
+    ++odom_count_;
 
     // TODO(orduno) #383 Move the state calculation and is stuck to robot class
     updateStates();
@@ -82,43 +82,37 @@ public:
     //              this becomes
     // if (robot_state_.isStuck()) {
 
-    if (is_stuck_) {
-      logStuck("Robot got stuck!");
+    // The states are kept up to date as odometry comes in, so this only reads them
+    bool is_stuck = is_stuck_;
+    logStuck(is_stuck);
+
+    if (is_stuck) {
       return BT::NodeStatus::SUCCESS;  // Successfully detected a stuck condition
     }
-
-    logStuck("Robot is free");
     return BT::NodeStatus::FAILURE;  // Failed to detected a stuck condition
   }
 
-  void logStuck(const std::string & msg) const
+  void logStuck(bool is_stuck)
   {
-    static std::string prev_msg;
-
-    if (msg == prev_msg) {
+    if (logged_ && is_stuck == logged_stuck_) {
       return;
     }
 
-    RCLCPP_INFO(node_->get_logger(), msg);
-    prev_msg = msg;
+    RCLCPP_INFO(node_->get_logger(), is_stuck ? "Robot got stuck!" : "Robot is free");
+    logged_ = true;
+    logged_stuck_ = is_stuck;
   }
 
   void updateStates()
   {
     // Approximate acceleration
     // TODO(orduno) #400 Smooth out velocity history for better accel approx.
-    if (odom_history_.size() > 2) {
-      auto curr_odom = odom_history_.end()[-1];
-      double curr_time = static_cast<double>(curr_odom.header.stamp.sec);
-      curr_time += (static_cast<double>(curr_odom.header.stamp.nanosec)) * 1e-9;
-
-      auto prev_odom = odom_history_.end()[-2];
-      double prev_time = static_cast<double>(prev_odom.header.stamp.sec);
-      prev_time += (static_cast<double>(prev_odom.header.stamp.nanosec)) * 1e-9;
-
-      double dt = curr_time - prev_time;
-      double vel_diff = static_cast<double>(
-        curr_odom.twist.twist.linear.x - prev_odom.twist.twist.linear.x);
+    if (odom_count_ > 2) {
+      const OdomSample & curr_odom = odom_history_[(odom_count_ - 1) % odom_history_.size()];
+      const OdomSample & prev_odom = odom_history_[(odom_count_ - 2) % odom_history_.size()];
+
+      double dt = curr_odom.time - prev_odom.time;
+      double vel_diff = curr_odom.linear_x - prev_odom.linear_x;
       current_accel_ = vel_diff / dt;
     }
 
@@ -153,11 +147,22 @@ private:
 
   std::atomic<bool> is_stuck_;
 
+  // The last state logged
+  bool logged_{false};
+  bool logged_stuck_{false};
+
+  // The parts of an odometry measurement the states are computed from
+  struct OdomSample
+  {
+    double time;
+    double linear_x;
+  };
+
   // Listen to odometry
   rclcpp::Subscription<nav_msgs::msg::Odometry>::SharedPtr odom_sub_;
-  // Store history of odometry measurements
-  std::deque<nav_msgs::msg::Odometry> odom_history_;
-  std::deque<nav_msgs::msg::Odometry>::size_type odom_history_size_;
+  // Store history of odometry measurements, as a ring of the last ones
+  std::array<OdomSample, 10> odom_history_;
+  size_t odom_count_{0};
 
   // Calculated states
   double current_accel_;
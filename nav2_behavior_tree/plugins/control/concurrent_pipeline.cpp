@@ -0,0 +1,170 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "behaviortree_cpp_v3/control_node.h"
+#include "behaviortree_cpp_v3/bt_factory.h"
+#include "nav2_behavior_tree/tick_notifier.hpp"
+
+namespace nav2_behavior_tree
+{
+
+/** @brief A pipeline whose children run side by side, each restarted at its own rate
+ *
+ * Like PipelineSequence, a child is first ticked once every child before it has succeeded,
+ * the node fails as soon as a child fails, and succeeds when the last child does. But once
+ * started, each child is handled on its own: a RUNNING child is ticked on every tick, and a
+ * child that succeeded is ticked again, restarting it, only once its period has passed
+ * since. The periods are given per child by child_rates, in Hz, where 0 or a missing rate
+ * restarts the child on every tick. This takes the place of a RateController around the
+ * replanning child, and a slow child no longer holds back the restarts of the others.
+ *
+ * When the tree is ticked on events, the node asks for a tick when the next child is due.
+ *
+ * Usage in XML:
+ * <ConcurrentPipeline child_rates="1.0;0">
+ *   <ComputePathToPose goal="{goal}" path="{path}"/>
+ *   <FollowPath path="{path}"/>
+ * </ConcurrentPipeline>
+ */
+class ConcurrentPipeline : public BT::ControlNode
+{
+public:
+  ConcurrentPipeline(const std::string & name, const BT::NodeConfiguration & config)
+  : BT::ControlNode(name, config)
+  {
+    std::string rates;
+    if (getInput("child_rates", rates)) {
+      for (const auto & rate : BT::splitString(rates, ';')) {
+        rates_.push_back(BT::convertFromString<double>(rate));
+      }
+    }
+
+    // Only there if the tree is ticked on events
+    config().blackboard->get<std::shared_ptr<TickNotifier>>("tick_notifier", tick_notifier_);
+  }
+
+  void halt() override
+  {
+    BT::ControlNode::halt();
+    reset();
+  }
+
+  static BT::PortsList providedPorts()
+  {
+    return {
+      BT::InputPort<std::string>(
+        "child_rates", "", "Restart rate of each child in Hz, ';' separated, 0 for every tick")
+    };
+  }
+
+protected:
+  BT::NodeStatus tick() override;
+
+  // Forget the children started and their restart times
+  void reset();
+
+  std::vector<double> rates_;
+  std::vector<TickNotifier::Clock::duration> periods_;
+  std::vector<TickNotifier::Clock::time_point> next_due_;
+
+  // The last child allowed to run, all those before it having succeeded once
+  std::size_t started_{0};
+
+  std::shared_ptr<TickNotifier> tick_notifier_;
+};
+
+void ConcurrentPipeline::reset()
+{
+  started_ = 0;
+  periods_.assign(children_nodes_.size(), TickNotifier::Clock::duration::zero());
+  for (std::size_t i = 0; i < rates_.size() && i < periods_.size(); ++i) {
+    if (rates_[i] > 0.0) {
+      periods_[i] = std::chrono::duration_cast<TickNotifier::Clock::duration>(
+        std::chrono::duration<double>(1.0 / rates_[i]));
+    }
+  }
+  next_due_.assign(children_nodes_.size(), TickNotifier::Clock::time_point::min());
+}
+
+BT::NodeStatus ConcurrentPipeline::tick()
+{
+  if (status() == BT::NodeStatus::IDLE) {
+    reset();
+  }
+  setStatus(BT::NodeStatus::RUNNING);
+
+  const auto now = TickNotifier::Clock::now();
+  auto wake_up = TickNotifier::Clock::time_point::max();
+
+  for (std::size_t i = 0; i < children_nodes_.size() && i <= started_; ++i) {
+    auto child = children_nodes_[i];
+    if (child->status() != BT::NodeStatus::RUNNING && now < next_due_[i]) {
+      // succeeded, and not due to restart yet
+      wake_up = std::min(wake_up, next_due_[i]);
+      continue;
+    }
+
+    auto status = child->executeTick();
+    switch (status) {
+      case BT::NodeStatus::FAILURE:
+        haltChildren(0);
+        reset();
+        return status;
+
+      case BT::NodeStatus::SUCCESS:
+        if (i + 1 == children_nodes_.size()) {
+          haltChildren(0);
+          reset();
+          return status;
+        }
+        // restarted from IDLE once due
+        child->setStatus(BT::NodeStatus::IDLE);
+        started_ = std::max(started_, i + 1);
+        next_due_[i] = now + periods_[i];
+        if (periods_[i] > TickNotifier::Clock::duration::zero()) {
+          wake_up = std::min(wake_up, next_due_[i]);
+        }
+        break;
+
+      case BT::NodeStatus::RUNNING:
+        break;
+
+      default:
+        std::stringstream error_msg;
+        error_msg << "Invalid node status. Received status " << status <<
+          "from child " << child->name();
+        throw std::runtime_error(error_msg.str());
+    }
+  }
+
+  if (tick_notifier_ && wake_up != TickNotifier::Clock::time_point::max()) {
+    tick_notifier_->notifyAt(wake_up);
+  }
+  return BT::NodeStatus::RUNNING;
+}
+
+}  // namespace nav2_behavior_tree
+
+BT_REGISTER_NODES(factory)
+{
+  factory.registerNodeType<nav2_behavior_tree::ConcurrentPipeline>("ConcurrentPipeline");
+}
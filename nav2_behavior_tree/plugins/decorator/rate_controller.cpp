@@ -19,6 +19,7 @@
 #include <string>
 
 #include "behaviortree_cpp_v3/decorator_node.h"
+#include "nav2_behavior_tree/tick_notifier.hpp"
 
 namespace nav2_behavior_tree
 {
@@ -34,6 +35,9 @@ public:
     double hz = 1.0;
     getInput("hz", hz);
     period_ = 1.0 / hz;
+
+    // Only there if the tree is ticked on events
+    config().blackboard->get<std::shared_ptr<TickNotifier>>("tick_notifier", tick_notifier_);
   }
 
   // Any BT node that accepts parameters must provide a requiredNodeParameters method
@@ -49,6 +53,7 @@ private:
 
   std::chrono::time_point<std::chrono::high_resolution_clock> start_;
   double period_;
+  std::shared_ptr<TickNotifier> tick_notifier_;
 };
 
 static bool first_time{false};
@@ -97,6 +102,13 @@ inline BT::NodeStatus RateController::tick()
     }
   }
 
+  // Have the tree ticked again when the period expires
+  if (tick_notifier_) {
+    auto remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::duration<double>(period_) - elapsed);
+    tick_notifier_->notifyAt(TickNotifier::Clock::now() + remaining);
+  }
+
   return status();
 }
 
@@ -14,12 +14,14 @@
 
 #include "nav2_behavior_tree/behavior_tree_engine.hpp"
 
+#include <chrono>
 #include <memory>
 #include <string>
 #include <vector>
 
 #include "rclcpp/rclcpp.hpp"
 #include "behaviortree_cpp_v3/utils/shared_library.h"
+#include "nav2_util/trace.hpp"
 
 using namespace std::chrono_literals;
 
@@ -30,7 +32,9 @@ BehaviorTreeEngine::BehaviorTreeEngine(const std::vector<std::string> & plugin_l
 {
   BT::SharedLibrary loader;
   for (const auto & p : plugin_libraries) {
+    auto start = std::chrono::steady_clock::now();
     factory_.registerFromPlugin(loader.getOSName(p));
+    plugin_load_times_.push_back(std::chrono::steady_clock::now() - start);
   }
 }
 
@@ -39,7 +43,8 @@ BehaviorTreeEngine::run(
   BT::Tree * tree,
   std::function<void()> onLoop,
   std::function<bool()> cancelRequested,
-  std::chrono::milliseconds loopTimeout)
+  std::chrono::milliseconds loopTimeout,
+  std::shared_ptr<TickNotifier> notifier)
 {
   rclcpp::WallRate loopRate(loopTimeout);
   BT::NodeStatus result = BT::NodeStatus::RUNNING;
@@ -51,11 +56,18 @@ BehaviorTreeEngine::run(
       return BtStatus::CANCELED;
     }
 
-    result = tree->root_node->executeTick();
+    {
+      NAV2_TRACE_SCOPE("bt_tick");
+      result = tree->root_node->executeTick();
+    }
 
     onLoop();
 
-    loopRate.sleep();
+    if (notifier) {
+      notifier->wait(loopTimeout);
+    } else {
+      loopRate.sleep();
+    }
   }
 
   return (result == BT::NodeStatus::SUCCESS) ? BtStatus::SUCCEEDED : BtStatus::FAILED;
@@ -68,7 +80,24 @@ BehaviorTreeEngine::buildTreeFromText(
 {
   BT::XMLParser p(factory_);
   p.loadFromText(xml_string);
-  return p.instantiateTree(blackboard);
+  BT::Tree tree = p.instantiateTree(blackboard);
+
+  // Time the ticks of every node, if asked to
+  std::shared_ptr<BtProfiler> profiler;
+  if (blackboard->get<std::shared_ptr<BtProfiler>>("bt_profiler", profiler) && profiler) {
+    profiler->instrument(tree);
+  }
+
+  // The nodes left waiting for their servers to the registry, so they're
+  // all waited for together
+  std::shared_ptr<ClientRegistry> client_registry;
+  if (blackboard->get<std::shared_ptr<ClientRegistry>>("client_registry", client_registry) &&
+    client_registry)
+  {
+    client_registry->waitForServers();
+  }
+
+  return tree;
 }
 
 }  // namespace nav2_behavior_tree
@@ -0,0 +1,185 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_behavior_tree/bt_profiler.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+namespace nav2_behavior_tree
+{
+
+namespace
+{
+
+// The children of control and decorator nodes can only be added through their
+// interfaces, these give access to replace them with their ProfileNode
+struct ControlNodeAccess : public BT::ControlNode
+{
+  static std::vector<BT::TreeNode *> & children(BT::ControlNode * node)
+  {
+    return node->*(&ControlNodeAccess::children_nodes_);
+  }
+};
+
+struct DecoratorNodeAccess : public BT::DecoratorNode
+{
+  static BT::TreeNode * & child(BT::DecoratorNode * node)
+  {
+    return node->*(&DecoratorNodeAccess::child_node_);
+  }
+};
+
+double toSeconds(ProfileNode::Clock::duration duration)
+{
+  return std::chrono::duration<double>(duration).count();
+}
+
+}  // namespace
+
+ProfileNode::ProfileNode(BT::TreeNode * child)
+: BT::DecoratorNode(child->name(), BT::NodeConfiguration())
+{
+  setChild(child);
+}
+
+BT::NodeStatus ProfileNode::tick()
+{
+  // A parent resetting this node means to reset the node below it, which a
+  // parent might do without halting it once it's done
+  if (status() == BT::NodeStatus::IDLE &&
+    (child_node_->status() == BT::NodeStatus::SUCCESS ||
+    child_node_->status() == BT::NodeStatus::FAILURE))
+  {
+    child_node_->setStatus(BT::NodeStatus::IDLE);
+  }
+
+  Clock::time_point start = Clock::now();
+  BT::NodeStatus child_status = child_node_->executeTick();
+  Clock::time_point end = Clock::now();
+
+  ++ticks;
+  total_tick_time += end - start;
+  max_tick_time = std::max(max_tick_time, end - start);
+
+  if (child_status == BT::NodeStatus::RUNNING) {
+    if (!running_) {
+      running_ = true;
+      running_since_ = start;
+    }
+  } else if (running_) {
+    running_ = false;
+    running_time += end - running_since_;
+  }
+
+  return child_status;
+}
+
+void ProfileNode::halt()
+{
+  if (running_) {
+    running_ = false;
+    running_time += Clock::now() - running_since_;
+  }
+  BT::DecoratorNode::halt();
+}
+
+BtProfiler::BtProfiler(rclcpp::Node::SharedPtr node, std::chrono::milliseconds period)
+: node_(node), period_(period), last_publish_(ProfileNode::Clock::now())
+{
+  profile_pub_ = node_->create_publisher<nav2_msgs::msg::BehaviorTreeProfile>(
+    "behavior_tree_profile", rclcpp::QoS(10));
+}
+
+void BtProfiler::instrument(BT::Tree & tree)
+{
+  if (!tree.root_node) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  instrumentChildren(tree, tree.root_node);
+  tree.root_node = wrap(tree, tree.root_node);
+  roots_.push_back(std::static_pointer_cast<ProfileNode>(tree.nodes.back()));
+}
+
+void BtProfiler::instrumentChildren(BT::Tree & tree, BT::TreeNode * node)
+{
+  if (auto control = dynamic_cast<BT::ControlNode *>(node)) {
+    for (auto & child : ControlNodeAccess::children(control)) {
+      instrumentChildren(tree, child);
+      child = wrap(tree, child);
+    }
+  } else if (auto decorator = dynamic_cast<BT::DecoratorNode *>(node)) {
+    BT::TreeNode * & child = DecoratorNodeAccess::child(decorator);
+    if (child) {
+      instrumentChildren(tree, child);
+      child = wrap(tree, child);
+    }
+  }
+}
+
+BT::TreeNode * BtProfiler::wrap(BT::Tree & tree, BT::TreeNode * node)
+{
+  auto profile_node = std::make_shared<ProfileNode>(node);
+  tree.nodes.push_back(profile_node);
+  nodes_.push_back(profile_node);
+  return profile_node.get();
+}
+
+void BtProfiler::publish()
+{
+  auto now = ProfileNode::Clock::now();
+  if (now - last_publish_ < period_) {
+    return;
+  }
+
+  nav2_msgs::msg::BehaviorTreeProfile profile;
+  profile.timestamp = node_->now();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  // Forget the nodes of the trees destroyed since
+  auto expired = [](const std::weak_ptr<ProfileNode> & node) {return node.expired();};
+  roots_.erase(std::remove_if(roots_.begin(), roots_.end(), expired), roots_.end());
+  nodes_.erase(std::remove_if(nodes_.begin(), nodes_.end(), expired), nodes_.end());
+
+  uint64_t root_ticks = 0;
+  for (const auto & root : roots_) {
+    root_ticks += root.lock()->ticks;
+  }
+  if (root_ticks >= last_root_ticks_) {
+    profile.tick_rate = (root_ticks - last_root_ticks_) / toSeconds(now - last_publish_);
+  }
+  last_root_ticks_ = root_ticks;
+  last_publish_ = now;
+
+  profile.nodes.reserve(nodes_.size());
+  for (const auto & weak_node : nodes_) {
+    auto node = weak_node.lock();
+    nav2_msgs::msg::BehaviorTreeNodeProfile node_profile;
+    node_profile.node_name = node->child()->name();
+    node_profile.node_type = node->child()->registrationName();
+    node_profile.ticks = node->ticks;
+    node_profile.total_tick_time = toSeconds(node->total_tick_time);
+    node_profile.max_tick_time = toSeconds(node->max_tick_time);
+    node_profile.running_time = toSeconds(node->running_time);
+    profile.nodes.push_back(std::move(node_profile));
+  }
+
+  profile_pub_->publish(profile);
+}
+
+}  // namespace nav2_behavior_tree
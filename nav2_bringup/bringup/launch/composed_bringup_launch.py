@@ -0,0 +1,165 @@
+# Copyright (c) 2020 Samsung Research America
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import os
+
+from ament_index_python.packages import get_package_share_directory
+
+from launch import LaunchDescription
+from launch.actions import DeclareLaunchArgument, SetEnvironmentVariable
+from launch.substitutions import LaunchConfiguration
+from launch_ros.actions import ComposableNodeContainer, Node
+from launch_ros.descriptions import ComposableNode
+from nav2_common.launch import RewrittenYaml
+
+
+def generate_launch_description():
+    # Get the launch directory
+    bringup_dir = get_package_share_directory('nav2_bringup')
+
+    namespace = LaunchConfiguration('namespace')
+    map_yaml_file = LaunchConfiguration('map')
+    use_sim_time = LaunchConfiguration('use_sim_time')
+    autostart = LaunchConfiguration('autostart')
+    params_file = LaunchConfiguration('params_file')
+    bt_xml_file = LaunchConfiguration('bt_xml_file')
+    use_intra_process_comms = LaunchConfiguration('use_intra_process_comms')
+
+    localization_nodes = ['map_server', 'amcl']
+    navigation_nodes = ['controller_server',
+                        'planner_server',
+                        'recoveries_server',
+                        'bt_navigator',
+                        'waypoint_follower']
+
+    # Map fully qualified names to relative ones so the node's namespace can be prepended.
+    # In case of the transforms (tf), currently, there doesn't seem to be a better alternative
+    # https://github.com/ros/geometry2/issues/32
+    # https://github.com/ros/robot_state_publisher/pull/30
+    # TODO(orduno) Substitute with `PushNodeRemapping`
+    #              https://github.com/ros2/launch_ros/issues/56
+    remappings = [('/tf', 'tf'),
+                  ('/tf_static', 'tf_static')]
+
+    # Create our own temporary YAML files that include substitutions
+    param_substitutions = {
+        'use_sim_time': use_sim_time,
+        'yaml_filename': map_yaml_file,
+        'bt_xml_filename': bt_xml_file,
+        'autostart': autostart,
+        'map_subscribe_transient_local': 'true'}
+
+    configured_params = RewrittenYaml(
+            source_file=params_file,
+            root_key=namespace,
+            param_rewrites=param_substitutions,
+            convert_types=True)
+
+    intra_process = [{'use_intra_process_comms': use_intra_process_comms}]
+
+    # The bt_navigator and the waypoint_follower give their own lifecycle node to a TF
+    # listener, whose latched tf_static subscription can't be intra-process, so they
+    # always communicate through the middleware
+    def server(package, plugin, name, parameters, use_intra_process=True):
+        return ComposableNode(
+            package=package,
+            node_plugin=plugin,
+            node_name=name,
+            node_namespace=namespace,
+            parameters=parameters,
+            remappings=remappings,
+            extra_arguments=intra_process if use_intra_process else [])
+
+    return LaunchDescription([
+        # Set env var to print messages to stdout immediately
+        SetEnvironmentVariable('RCUTILS_CONSOLE_STDOUT_LINE_BUFFERED', '1'),
+
+        DeclareLaunchArgument(
+            'namespace', default_value='',
+            description='Top-level namespace'),
+
+        DeclareLaunchArgument(
+            'map',
+            default_value=os.path.join(bringup_dir, 'maps', 'turtlebot3_world.yaml'),
+            description='Full path to map yaml file to load'),
+
+        DeclareLaunchArgument(
+            'use_sim_time', default_value='false',
+            description='Use simulation (Gazebo) clock if true'),
+
+        DeclareLaunchArgument(
+            'autostart', default_value='true',
+            description='Automatically startup the nav2 stack'),
+
+        DeclareLaunchArgument(
+            'params_file',
+            default_value=os.path.join(bringup_dir, 'params', 'nav2_params.yaml'),
+            description='Full path to the ROS2 parameters file to use'),
+
+        DeclareLaunchArgument(
+            'bt_xml_file',
+            default_value=os.path.join(
+                get_package_share_directory('nav2_bt_navigator'),
+                'behavior_trees', 'navigate_w_replanning_and_recovery.xml'),
+            description='Full path to the behavior tree xml file to use'),
+
+        DeclareLaunchArgument(
+            'use_intra_process_comms', default_value='true',
+            description='Pass messages between the servers without serializing them'),
+
+        # All of the servers in one process, sharing a multithreaded executor
+        ComposableNodeContainer(
+            node_name='nav2_container',
+            node_namespace=namespace,
+            package='rclcpp_components',
+            node_executable='component_container_mt',
+            output='screen',
+            composable_node_descriptions=[
+                server('nav2_map_server', 'nav2_map_server::MapServer', 'map_server',
+                       [configured_params]),
+                server('nav2_amcl', 'nav2_amcl::AmclNode', 'amcl', [configured_params]),
+                server('nav2_controller', 'nav2_controller::ControllerServer',
+                       'controller_server', [configured_params]),
+                server('nav2_planner', 'nav2_planner::PlannerServer', 'planner_server',
+                       [configured_params]),
+                server('nav2_recoveries', 'recovery_server::RecoveryServer',
+                       'recoveries_server', [{'use_sim_time': use_sim_time}]),
+                server('nav2_bt_navigator', 'nav2_bt_navigator::BtNavigator', 'bt_navigator',
+                       [configured_params], use_intra_process=False),
+                server('nav2_waypoint_follower', 'nav2_waypoint_follower::WaypointFollower',
+                       'waypoint_follower', [configured_params], use_intra_process=False),
+            ]),
+
+        # The lifecycle managers block while they bring the servers up, so they run in
+        # their own processes rather than in the container
+        Node(
+            package='nav2_lifecycle_manager',
+            node_executable='lifecycle_manager',
+            node_name='lifecycle_manager_localization',
+            node_namespace=namespace,
+            output='screen',
+            parameters=[{'use_sim_time': use_sim_time},
+                        {'autostart': autostart},
+                        {'node_names': localization_nodes}]),
+
+        Node(
+            package='nav2_lifecycle_manager',
+            node_executable='lifecycle_manager',
+            node_name='lifecycle_manager_navigation',
+            node_namespace=namespace,
+            output='screen',
+            parameters=[{'use_sim_time': use_sim_time},
+                        {'autostart': autostart},
+                        {'node_names': navigation_nodes}]),
+    ])
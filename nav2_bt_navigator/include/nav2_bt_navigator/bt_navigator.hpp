@@ -15,7 +15,9 @@
 #ifndef NAV2_BT_NAVIGATOR__BT_NAVIGATOR_HPP_
 #define NAV2_BT_NAVIGATOR__BT_NAVIGATOR_HPP_
 
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -41,8 +43,9 @@ class BtNavigator : public nav2_util::LifecycleNode
 public:
   /**
    * @brief A constructor for nav2_bt_navigator::BtNavigator class
+   * @param options Additional options to control creation of the node.
    */
-  BtNavigator();
+  explicit BtNavigator(const rclcpp::NodeOptions & options = rclcpp::NodeOptions());
   /**
    * @brief A destructor for nav2_bt_navigator::BtNavigator class
    */
@@ -103,22 +106,85 @@ protected:
    */
   void initializeGoalPose();
 
+  /**
+   * @brief Look up the robot's pose and put it on the blackboard for the nodes
+   * of the tree, as "robot_pose" if "robot_pose_available" is set
+   */
+  void updateRobotPose();
+
+  /**
+   * @brief Read the XML of a behavior tree from a file
+   * @param bt_id The name goals choose the tree by
+   * @param filename The file to read
+   * @return True if the file was read
+   */
+  bool loadBehaviorTree(const std::string & bt_id, const std::string & filename);
+
+  /**
+   * @brief The name of the tree read from a file, the file name without its
+   * directory or extension
+   */
+  static std::string getBehaviorTreeId(const std::string & filename);
+
+  /**
+   * @brief Get a behavior tree, building it the first time it's asked for
+   * @param bt_id The name of the tree, empty for the one in bt_xml_filename
+   * @return The tree, or nullptr if there's none of that name
+   */
+  BT::Tree * getBehaviorTree(const std::string & bt_id);
+
   /**
    * @brief A subscription and callback to handle the topic-based goal published
-   * from rviz
+   * from rviz. While navigating, the pose replaces the goal of the running tree
+   * directly; otherwise it's sent as a goal to our own action server.
    */
   void onGoalPoseReceived(const geometry_msgs::msg::PoseStamped::SharedPtr pose);
   rclcpp::Subscription<geometry_msgs::msg::PoseStamped>::SharedPtr goal_sub_;
 
+  /**
+   * @brief Put the goal pose received on the topic while navigating, if any, on
+   * the blackboard
+   */
+  void updateTopicGoal();
+
+  // The last goal pose received on the topic while navigating and not yet on the
+  // blackboard, and whether a goal is being navigated to
+  std::mutex topic_goal_mutex_;
+  geometry_msgs::msg::PoseStamped::SharedPtr topic_goal_;
+  bool navigating_{false};
+
   // The blackboard shared by all of the nodes in the tree
   BT::Blackboard::Ptr blackboard_;
 
-  // The XML string that defines the Behavior Tree to create
-  std::string xml_string_;
+  // The XML strings that define the Behavior Trees to create, by name
+  std::map<std::string, std::string> xml_strings_;
+
+  // The trees built so far, by name, reused from goal to goal
+  std::map<std::string, BT::Tree> trees_;
 
   // The wrapper class for the BT functionality
   std::unique_ptr<nav2_behavior_tree::BehaviorTreeEngine> bt_;
 
+  // The longest time between ticks of the tree, in milliseconds
+  int bt_loop_duration_;
+
+  // Whether the tree's status changes are logged in compact batches, how often
+  // the batches are published, how many changes they keep and the file they're
+  // appended to, if any
+  bool compact_bt_log_;
+  double bt_log_publish_rate_;
+  int bt_log_buffer_size_;
+  std::string bt_log_file_;
+
+  // Wakes the tree when one of its nodes asks for a tick, if it's ticked on events
+  std::shared_ptr<nav2_behavior_tree::TickNotifier> tick_notifier_;
+
+  // The action and service clients of the tree's nodes, kept between goals
+  std::shared_ptr<nav2_behavior_tree::ClientRegistry> client_registry_;
+
+  // Times the ticks of the trees' nodes, if they're profiled
+  std::shared_ptr<nav2_behavior_tree::BtProfiler> bt_profiler_;
+
   // Libraries to pull plugins (BT Nodes) from
   std::vector<std::string> plugin_lib_names_;
 
@@ -0,0 +1,109 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_BT_NAVIGATOR__COMPACT_TOPIC_LOGGER_HPP_
+#define NAV2_BT_NAVIGATOR__COMPACT_TOPIC_LOGGER_HPP_
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "behaviortree_cpp_v3/loggers/abstract_logger.h"
+#include "rclcpp/rclcpp.hpp"
+#include "nav2_msgs/msg/behavior_tree_node_names.hpp"
+#include "nav2_msgs/msg/compact_behavior_tree_log.hpp"
+
+namespace nav2_bt_navigator
+{
+
+/**
+ * @class CompactTopicLogger
+ * @brief Logs the status changes of a tree as node ids and status codes. They're
+ * kept in a ring buffer and published in batches on behavior_tree_log_compact,
+ * with the names of the node ids published once on behavior_tree_node_names.
+ * The batches can also be appended to a binary file.
+ */
+class CompactTopicLogger : public BT::StatusChangeLogger
+{
+public:
+  /**
+   * @brief Start logging a tree
+   * @param ros_node The node to publish with
+   * @param tree The tree to log
+   * @param publish_rate How often flush() publishes the changes, in Hz
+   * @param buffer_size The most changes kept between two batches, the oldest
+   * ones are dropped when it's full
+   * @param filename The file to append the changes to, empty for none
+   */
+  CompactTopicLogger(
+    const rclcpp::Node::SharedPtr & ros_node, const BT::Tree & tree,
+    double publish_rate, size_t buffer_size, const std::string & filename = "");
+
+  // Publishes the changes left in the buffer
+  ~CompactTopicLogger();
+
+  void callback(
+    BT::Duration timestamp,
+    const BT::TreeNode & node,
+    BT::NodeStatus prev_status,
+    BT::NodeStatus status) override;
+
+  // Publish the buffered changes, if a period has passed since the last batch
+  void flush() override;
+
+protected:
+  struct Event
+  {
+    int64_t stamp;
+    uint16_t node_id;
+    uint8_t previous_status;
+    uint8_t current_status;
+  };
+
+  // Publish the buffered changes now, and write them to the file
+  void publish();
+
+  // Write the name table to the file
+  void writeNames();
+
+  // Write the buffered changes to the file
+  void writeEvents();
+
+  rclcpp::Node::SharedPtr ros_node_;
+  rclcpp::Publisher<nav2_msgs::msg::CompactBehaviorTreeLog>::SharedPtr log_pub_;
+  rclcpp::Publisher<nav2_msgs::msg::BehaviorTreeNodeNames>::SharedPtr names_pub_;
+
+  // The interned names of the tree's nodes
+  uint32_t tree_id_;
+  std::unordered_map<const BT::TreeNode *, uint16_t> node_ids_;
+  std::vector<std::string> node_names_;
+
+  // The ring buffer of changes since the last batch
+  std::vector<Event> events_;
+  size_t head_{0};
+  size_t size_{0};
+  uint32_t dropped_{0};
+
+  std::chrono::nanoseconds publish_period_;
+  std::chrono::steady_clock::time_point next_publish_;
+
+  std::ofstream file_;
+};
+
+}   // namespace nav2_bt_navigator
+
+#endif   // NAV2_BT_NAVIGATOR__COMPACT_TOPIC_LOGGER_HPP_
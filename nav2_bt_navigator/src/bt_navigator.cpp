@@ -14,21 +14,26 @@
 
 #include "nav2_bt_navigator/bt_navigator.hpp"
 
+#include <algorithm>
+#include <chrono>
 #include <fstream>
 #include <memory>
+#include <mutex>
 #include <streambuf>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "nav2_behavior_tree/bt_conversions.hpp"
+#include "nav2_bt_navigator/compact_topic_logger.hpp"
 #include "nav2_bt_navigator/ros_topic_logger.hpp"
+#include "nav2_util/robot_utils.hpp"
 
 namespace nav2_bt_navigator
 {
 
-BtNavigator::BtNavigator()
-: nav2_util::LifecycleNode("bt_navigator", "", true)
+BtNavigator::BtNavigator(const rclcpp::NodeOptions & options)
+: nav2_util::LifecycleNode("bt_navigator", "", true, options)
 {
   RCLCPP_INFO(get_logger(), "Creating");
 
@@ -47,12 +52,22 @@ BtNavigator::BtNavigator()
     "nav2_recovery_node_bt_node",
     "nav2_pipeline_sequence_bt_node",
     "nav2_round_robin_node_bt_node",
+    "nav2_concurrent_pipeline_bt_node",
     "nav2_transform_available_condition_bt_node"
   };
 
   // Declare this node's parameters
   declare_parameter("bt_xml_filename");
+  declare_parameter("bt_xml_filenames", std::vector<std::string>());
   declare_parameter("plugin_lib_names", plugin_libs);
+  declare_parameter("tick_on_events", false);
+  declare_parameter("bt_loop_duration", 10);
+  declare_parameter("compact_bt_log", false);
+  declare_parameter("bt_log_publish_rate", 5.0);
+  declare_parameter("bt_log_buffer_size", 1024);
+  declare_parameter("bt_log_file", std::string(""));
+  declare_parameter("profile_bt", false);
+  declare_parameter("bt_profile_period", 1000);
 }
 
 BtNavigator::~BtNavigator()
@@ -99,6 +114,11 @@ BtNavigator::on_configure(const rclcpp_lifecycle::State & /*state*/)
 
   // Create the class that registers our custom nodes and executes the BT
   bt_ = std::make_unique<nav2_behavior_tree::BehaviorTreeEngine>(plugin_lib_names_);
+  for (unsigned int i = 0; i < plugin_lib_names_.size(); ++i) {
+    RCLCPP_DEBUG(
+      get_logger(), "Registered the nodes of %s in %.1f ms", plugin_lib_names_[i].c_str(),
+      std::chrono::duration<double, std::milli>(bt_->getPluginLoadTimes()[i]).count());
+  }
 
   // Create the blackboard that will be shared by all of the nodes in the tree
   blackboard_ = BT::Blackboard::create();
@@ -110,24 +130,58 @@ BtNavigator::on_configure(const rclcpp_lifecycle::State & /*state*/)
   blackboard_->set<bool>("path_updated", false);  // NOLINT
   blackboard_->set<bool>("initial_pose_received", false);  // NOLINT
 
-  // Get the BT filename to use from the node parameter
-  std::string bt_xml_filename;
-  get_parameter("bt_xml_filename", bt_xml_filename);
+  // Share the clients of the tree's nodes between the trees, rather than
+  // creating them and waiting for their servers for each tree
+  client_registry_ = std::make_shared<nav2_behavior_tree::ClientRegistry>(client_node_);
+  blackboard_->set<std::shared_ptr<nav2_behavior_tree::ClientRegistry>>(  // NOLINT
+    "client_registry", client_registry_);
+
+  // Tick the tree when its nodes ask for it rather than at a fixed rate, with
+  // bt_loop_duration becoming the longest interval between ticks
+  get_parameter("bt_loop_duration", bt_loop_duration_);
+  bool tick_on_events;
+  get_parameter("tick_on_events", tick_on_events);
+  if (tick_on_events) {
+    tick_notifier_ = std::make_shared<nav2_behavior_tree::TickNotifier>(client_node_);
+    blackboard_->set<std::shared_ptr<nav2_behavior_tree::TickNotifier>>(  // NOLINT
+      "tick_notifier", tick_notifier_);
+  }
 
-  // Read the input BT XML from the specified file into a string
-  std::ifstream xml_file(bt_xml_filename);
+  // Time the ticks of every node of the trees, publishing the times every
+  // bt_profile_period
+  bool profile_bt;
+  get_parameter("profile_bt", profile_bt);
+  if (profile_bt) {
+    int bt_profile_period;
+    get_parameter("bt_profile_period", bt_profile_period);
+    bt_profiler_ = std::make_shared<nav2_behavior_tree::BtProfiler>(
+      client_node_, std::chrono::milliseconds(bt_profile_period));
+    blackboard_->set<std::shared_ptr<nav2_behavior_tree::BtProfiler>>(  // NOLINT
+      "bt_profiler", bt_profiler_);
+  }
 
-  if (!xml_file.good()) {
-    RCLCPP_ERROR(get_logger(), "Couldn't open input XML file: %s", bt_xml_filename.c_str());
+  // How the status changes of the tree are logged
+  get_parameter("compact_bt_log", compact_bt_log_);
+  get_parameter("bt_log_publish_rate", bt_log_publish_rate_);
+  get_parameter("bt_log_buffer_size", bt_log_buffer_size_);
+  get_parameter("bt_log_file", bt_log_file_);
+
+  // Get the BT filename to use from the node parameter, it's the tree used
+  // for goals that don't name one
+  std::string bt_xml_filename;
+  get_parameter("bt_xml_filename", bt_xml_filename);
+  if (!loadBehaviorTree("", bt_xml_filename)) {
     return nav2_util::CallbackReturn::FAILURE;
   }
 
-  xml_string_ = std::string(
-    std::istreambuf_iterator<char>(xml_file),
-    std::istreambuf_iterator<char>());
-
-  RCLCPP_DEBUG(get_logger(), "Behavior Tree file: '%s'", bt_xml_filename.c_str());
-  RCLCPP_DEBUG(get_logger(), "Behavior Tree XML: %s", xml_string_.c_str());
+  // The other trees goals can choose from, named after their files
+  std::vector<std::string> bt_xml_filenames;
+  get_parameter("bt_xml_filenames", bt_xml_filenames);
+  for (const auto & filename : bt_xml_filenames) {
+    if (!loadBehaviorTree(getBehaviorTreeId(filename), filename)) {
+      return nav2_util::CallbackReturn::FAILURE;
+    }
+  }
 
   return nav2_util::CallbackReturn::SUCCESS;
 }
@@ -170,8 +224,12 @@ BtNavigator::on_cleanup(const rclcpp_lifecycle::State & /*state*/)
 
   action_server_.reset();
   plugin_lib_names_.clear();
-  xml_string_.clear();
+  trees_.clear();
+  xml_strings_.clear();
   blackboard_.reset();
+  tick_notifier_.reset();
+  client_registry_.reset();
+  bt_profiler_.reset();
   bt_.reset();
 
   RCLCPP_INFO(get_logger(), "Completed Cleaning up");
@@ -197,6 +255,15 @@ BtNavigator::navigateToPose()
 {
   initializeGoalPose();
 
+  // The tree the goal asks for, built the first time and kept for the next goals
+  std::string bt_id = action_server_->get_current_goal()->behavior_tree;
+  BT::Tree * tree = getBehaviorTree(bt_id);
+  if (!tree) {
+    RCLCPP_ERROR(get_logger(), "No behavior tree named \"%s\"", bt_id.c_str());
+    action_server_->terminate_current();
+    return;
+  }
+
   auto is_canceling = [this]() {
       if (action_server_ == nullptr) {
         RCLCPP_DEBUG(get_logger(), "Action server unavailable. Canceling.");
@@ -211,23 +278,45 @@ BtNavigator::navigateToPose()
       return action_server_->is_cancel_requested();
     };
 
+  std::unique_ptr<BT::StatusChangeLogger> topic_logger;
+  if (compact_bt_log_) {
+    topic_logger = std::make_unique<CompactTopicLogger>(
+      client_node_, *tree, bt_log_publish_rate_,
+      static_cast<size_t>(std::max(bt_log_buffer_size_, 1)), bt_log_file_);
+  } else {
+    topic_logger = std::make_unique<RosTopicLogger>(client_node_, *tree);
+  }
 
-  // Create the Behavior Tree from the XML input
-  BT::Tree tree = bt_->buildTreeFromText(xml_string_, blackboard_);
+  updateRobotPose();
 
-  RosTopicLogger topic_logger(client_node_, tree);
+  {
+    std::lock_guard<std::mutex> lock(topic_goal_mutex_);
+    navigating_ = true;
+    topic_goal_.reset();
+  }
 
   auto on_loop = [&]() {
       if (action_server_->is_preempt_requested()) {
         RCLCPP_INFO(get_logger(), "Received goal preemption request");
         action_server_->accept_pending_goal();
         initializeGoalPose();
+        if (action_server_->get_current_goal()->behavior_tree != bt_id) {
+          RCLCPP_WARN(
+            get_logger(), "A preempting goal can't change the behavior tree, keeping \"%s\"",
+            bt_id.c_str());
+        }
+      }
+      updateTopicGoal();
+      topic_logger->flush();
+      updateRobotPose();
+      if (bt_profiler_) {
+        bt_profiler_->publish();
       }
-      topic_logger.flush();
     };
 
   // Execute the BT that was previously created in the configure step
-  nav2_behavior_tree::BtStatus rc = bt_->run(&tree, on_loop, is_canceling);
+  nav2_behavior_tree::BtStatus rc = bt_->run(
+    tree, on_loop, is_canceling, std::chrono::milliseconds(bt_loop_duration_), tick_notifier_);
 
   switch (rc) {
     case nav2_behavior_tree::BtStatus::SUCCEEDED:
@@ -248,6 +337,104 @@ BtNavigator::navigateToPose()
     default:
       throw std::logic_error("Invalid status return from BT");
   }
+
+  // Leave the tree ready for the next goal
+  bt_->haltAllActions(tree->root_node);
+  bt_->resetTree(tree->root_node);
+
+  // A pose that came in as the tree finished starts a new goal
+  geometry_msgs::msg::PoseStamped::SharedPtr topic_goal;
+  {
+    std::lock_guard<std::mutex> lock(topic_goal_mutex_);
+    navigating_ = false;
+    topic_goal.swap(topic_goal_);
+  }
+  if (topic_goal) {
+    onGoalPoseReceived(topic_goal);
+  }
+}
+
+void
+BtNavigator::updateTopicGoal()
+{
+  geometry_msgs::msg::PoseStamped::SharedPtr topic_goal;
+  {
+    std::lock_guard<std::mutex> lock(topic_goal_mutex_);
+    topic_goal.swap(topic_goal_);
+  }
+  if (!topic_goal) {
+    return;
+  }
+
+  RCLCPP_INFO(
+    get_logger(), "Goal pose updated to (%.2f, %.2f)",
+    topic_goal->pose.position.x, topic_goal->pose.position.y);
+  blackboard_->set("goal", *topic_goal);
+}
+
+void
+BtNavigator::updateRobotPose()
+{
+  // Looked up once here for the next tick, rather than by each of the tree's
+  // nodes that needs it
+  geometry_msgs::msg::PoseStamped current_pose;
+  bool available = nav2_util::getCurrentPose(current_pose, *tf_);
+  blackboard_->set<bool>("robot_pose_available", available);  // NOLINT
+  if (available) {
+    blackboard_->set<geometry_msgs::msg::PoseStamped>("robot_pose", current_pose);  // NOLINT
+  }
+}
+
+bool
+BtNavigator::loadBehaviorTree(const std::string & bt_id, const std::string & filename)
+{
+  // Read the input BT XML from the specified file into a string
+  std::ifstream xml_file(filename);
+
+  if (!xml_file.good()) {
+    RCLCPP_ERROR(get_logger(), "Couldn't open input XML file: %s", filename.c_str());
+    return false;
+  }
+
+  std::string & xml_string = xml_strings_[bt_id];
+  xml_string = std::string(
+    std::istreambuf_iterator<char>(xml_file),
+    std::istreambuf_iterator<char>());
+
+  RCLCPP_DEBUG(get_logger(), "Behavior Tree file: '%s'", filename.c_str());
+  RCLCPP_DEBUG(get_logger(), "Behavior Tree XML: %s", xml_string.c_str());
+  return true;
+}
+
+std::string
+BtNavigator::getBehaviorTreeId(const std::string & filename)
+{
+  // The file name without its directory or extension
+  size_t begin = filename.find_last_of('/');
+  begin = (begin == std::string::npos) ? 0 : begin + 1;
+  size_t end = filename.find_last_of('.');
+  if (end == std::string::npos || end < begin) {
+    end = filename.size();
+  }
+  return filename.substr(begin, end - begin);
+}
+
+BT::Tree *
+BtNavigator::getBehaviorTree(const std::string & bt_id)
+{
+  auto tree = trees_.find(bt_id);
+  if (tree != trees_.end()) {
+    return &tree->second;
+  }
+
+  auto xml_string = xml_strings_.find(bt_id);
+  if (xml_string == xml_strings_.end()) {
+    return nullptr;
+  }
+
+  // Create the Behavior Tree from the XML input
+  auto built = trees_.emplace(bt_id, bt_->buildTreeFromText(xml_string->second, blackboard_));
+  return &built.first->second;
 }
 
 void
@@ -266,9 +453,29 @@ BtNavigator::initializeGoalPose()
 void
 BtNavigator::onGoalPoseReceived(const geometry_msgs::msg::PoseStamped::SharedPtr pose)
 {
+  {
+    // While navigating, the pose is handed to the running tree, which picks it
+    // up on its next tick, rather than going out and back in as a new goal
+    std::lock_guard<std::mutex> lock(topic_goal_mutex_);
+    if (navigating_) {
+      topic_goal_ = pose;
+      if (tick_notifier_) {
+        tick_notifier_->notify();
+      }
+      return;
+    }
+  }
+
   nav2_msgs::action::NavigateToPose::Goal goal;
   goal.pose = *pose;
   self_client_->async_send_goal(goal);
 }
 
 }  // namespace nav2_bt_navigator
+
+#include "rclcpp_components/register_node_macro.hpp"
+
+// Register the component with class_loader.
+// This acts as a sort of entry point, allowing the component to be discoverable when its library
+// is being loaded into a running process.
+RCLCPP_COMPONENTS_REGISTER_NODE(nav2_bt_navigator::BtNavigator)
@@ -0,0 +1,189 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_bt_navigator/compact_topic_logger.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <string>
+
+namespace nav2_bt_navigator
+{
+
+namespace
+{
+
+// Tells the trees logged apart, in the messages and in the file
+std::atomic<uint32_t> next_tree_id(0);
+
+template<typename T>
+void write(std::ofstream & file, T value)
+{
+  file.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+}  // namespace
+
+CompactTopicLogger::CompactTopicLogger(
+  const rclcpp::Node::SharedPtr & ros_node, const BT::Tree & tree,
+  double publish_rate, size_t buffer_size, const std::string & filename)
+: StatusChangeLogger(tree.root_node), ros_node_(ros_node), tree_id_(next_tree_id++),
+  events_(std::max<size_t>(buffer_size, 1)),
+  publish_period_(std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::duration<double>(1.0 / std::max(publish_rate, 1e-3)))),
+  next_publish_(std::chrono::steady_clock::now() + publish_period_)
+{
+  // Intern the node names, the ids being their order in the tree
+  BT::applyRecursiveVisitor(
+    static_cast<const BT::TreeNode *>(tree.root_node),
+    [this](const BT::TreeNode * node) {
+      if (node_names_.size() < std::numeric_limits<uint16_t>::max()) {
+        node_ids_[node] = static_cast<uint16_t>(node_names_.size());
+        node_names_.push_back(node->name());
+      }
+    });
+
+  log_pub_ = ros_node_->create_publisher<nav2_msgs::msg::CompactBehaviorTreeLog>(
+    "behavior_tree_log_compact",
+    rclcpp::QoS(10));
+
+  // Latched, so subscribers that come later still get the names
+  names_pub_ = ros_node_->create_publisher<nav2_msgs::msg::BehaviorTreeNodeNames>(
+    "behavior_tree_node_names",
+    rclcpp::QoS(1).transient_local());
+  nav2_msgs::msg::BehaviorTreeNodeNames names_msg;
+  names_msg.tree_id = tree_id_;
+  names_msg.node_names = node_names_;
+  names_pub_->publish(names_msg);
+
+  if (!filename.empty()) {
+    file_.open(filename, std::ios::binary | std::ios::app);
+    if (file_.is_open()) {
+      writeNames();
+    } else {
+      RCLCPP_WARN(
+        ros_node_->get_logger(), "Couldn't open the behavior tree log file %s",
+        filename.c_str());
+    }
+  }
+}
+
+CompactTopicLogger::~CompactTopicLogger()
+{
+  publish();
+}
+
+void CompactTopicLogger::callback(
+  BT::Duration timestamp,
+  const BT::TreeNode & node,
+  BT::NodeStatus prev_status,
+  BT::NodeStatus status)
+{
+  auto node_id = node_ids_.find(&node);
+  if (node_id == node_ids_.end()) {
+    return;
+  }
+
+  // Overwrite the oldest change when the buffer is full
+  size_t index = (head_ + size_) % events_.size();
+  if (size_ == events_.size()) {
+    head_ = (head_ + 1) % events_.size();
+    ++dropped_;
+  } else {
+    ++size_;
+  }
+
+  Event & event = events_[index];
+  event.stamp = std::chrono::duration_cast<std::chrono::nanoseconds>(timestamp).count();
+  event.node_id = node_id->second;
+  event.previous_status = static_cast<uint8_t>(prev_status);
+  event.current_status = static_cast<uint8_t>(status);
+}
+
+void CompactTopicLogger::flush()
+{
+  auto now = std::chrono::steady_clock::now();
+  if (now < next_publish_) {
+    return;
+  }
+  next_publish_ = now + publish_period_;
+  publish();
+}
+
+void CompactTopicLogger::publish()
+{
+  if (size_ == 0 && dropped_ == 0) {
+    return;
+  }
+
+  if (file_.is_open()) {
+    writeEvents();
+  }
+
+  nav2_msgs::msg::CompactBehaviorTreeLog log_msg;
+  log_msg.timestamp = ros_node_->now();
+  log_msg.tree_id = tree_id_;
+  log_msg.dropped = dropped_;
+  log_msg.stamps.reserve(size_);
+  log_msg.node_ids.reserve(size_);
+  log_msg.previous_status.reserve(size_);
+  log_msg.current_status.reserve(size_);
+  for (size_t i = 0; i < size_; ++i) {
+    const Event & event = events_[(head_ + i) % events_.size()];
+    log_msg.stamps.push_back(event.stamp);
+    log_msg.node_ids.push_back(event.node_id);
+    log_msg.previous_status.push_back(event.previous_status);
+    log_msg.current_status.push_back(event.current_status);
+  }
+  log_pub_->publish(log_msg);
+
+  head_ = 0;
+  size_ = 0;
+  dropped_ = 0;
+}
+
+void CompactTopicLogger::writeNames()
+{
+  // 'N', tree id, name count, then each name as its length and characters
+  write<char>(file_, 'N');
+  write<uint32_t>(file_, tree_id_);
+  write<uint32_t>(file_, static_cast<uint32_t>(node_names_.size()));
+  for (const auto & name : node_names_) {
+    uint16_t length = static_cast<uint16_t>(
+      std::min<size_t>(name.size(), std::numeric_limits<uint16_t>::max()));
+    write<uint16_t>(file_, length);
+    file_.write(name.data(), length);
+  }
+}
+
+void CompactTopicLogger::writeEvents()
+{
+  // 'E', tree id, dropped count, change count, then each change as its
+  // timestamp, node id, previous and current status
+  write<char>(file_, 'E');
+  write<uint32_t>(file_, tree_id_);
+  write<uint32_t>(file_, dropped_);
+  write<uint32_t>(file_, static_cast<uint32_t>(size_));
+  for (size_t i = 0; i < size_; ++i) {
+    const Event & event = events_[(head_ + i) % events_.size()];
+    write<int64_t>(file_, event.stamp);
+    write<uint16_t>(file_, event.node_id);
+    write<uint8_t>(file_, event.previous_status);
+    write<uint8_t>(file_, event.current_status);
+  }
+  file_.flush();
+}
+
+}   // namespace nav2_bt_navigator
@@ -15,6 +15,7 @@
 #ifndef NAV2_CONTROLLER__NAV2_CONTROLLER_HPP_
 #define NAV2_CONTROLLER__NAV2_CONTROLLER_HPP_
 
+#include <chrono>
 #include <memory>
 #include <string>
 #include <thread>
@@ -23,12 +24,16 @@
 
 #include "nav2_core/controller.hpp"
 #include "nav2_costmap_2d/costmap_2d_ros.hpp"
+#include "nav2_costmap_2d/update_statistics.hpp"
 #include "tf2_ros/transform_listener.h"
 #include "nav2_msgs/action/follow_path.hpp"
+#include "nav2_msgs/msg/control_loop_statistics.hpp"
 #include "nav_2d_utils/odom_subscriber.hpp"
 #include "nav2_util/lifecycle_node.hpp"
 #include "nav2_util/simple_action_server.hpp"
 #include "nav2_util/robot_utils.hpp"
+#include "nav2_util/realtime.hpp"
+#include "nav2_util/thread_pool.hpp"
 #include "pluginlib/class_loader.hpp"
 #include "pluginlib/class_list_macros.hpp"
 
@@ -36,6 +41,7 @@ namespace nav2_controller
 {
 
 class ProgressChecker;
+class PosePredictor;
 /**
  * @class nav2_controller::ControllerServer
  * @brief This class hosts variety of plugins of different algorithms to
@@ -48,8 +54,9 @@ public:
 
   /**
    * @brief Constructor for nav2_controller::ControllerServer
+   * @param options Additional options to control creation of the node.
    */
-  ControllerServer();
+  explicit ControllerServer(const rclcpp::NodeOptions & options = rclcpp::NodeOptions());
   /**
    * @brief Destructor for nav2_controller::ControllerServer
    */
@@ -134,11 +141,18 @@ protected:
 
   /**
    * @brief Assigns path to controller
+   *
+   * A controller that was given the last path and shares poses with the new one from the
+   * start only gets the poses after those, through splicePlan.
    * @param path Path received from action server
    */
   void setPlannerPath(const nav_msgs::msg::Path & path);
   /**
    * @brief Calculates velocity and publishes to "cmd_vel" topic
+   *
+   * With prepare_all_controllers, every controller computes a command on the controller pool,
+   * so the others are ready to take over. The command of the current one is published, or
+   * with pick_controller_by_cost, the one of lowest cost among those that succeeded.
    */
   void computeAndPublishVelocity();
   /**
@@ -167,6 +181,32 @@ protected:
    */
   bool getRobotPose(geometry_msgs::msg::PoseStamped & pose);
 
+  /**
+   * @brief Obtain the pose the controller computes the command for
+   *
+   * With predict_pose, the pose the robot will be at when the command takes effect,
+   * predicted from the latest transform and the odometry without waiting on TF.
+   * Otherwise the current pose, as from getRobotPose.
+   * @param pose To store the pose
+   * @return true if able to obtain the pose, else false
+   */
+  bool getCommandPose(geometry_msgs::msg::PoseStamped & pose);
+
+  /**
+   * @brief The phases of a cycle of the control loop, as named in ControlLoopStatistics
+   */
+  enum Phase {CYCLE, UPDATE_PATH, ROBOT_POSE, CONTROLLER, PUBLISH, GOAL_CHECK, NUM_PHASES};
+
+  /**
+   * @brief Record the time of a phase, from its start until now, if statistics are recorded
+   */
+  void addPhaseTime(Phase phase, const std::chrono::steady_clock::time_point & start);
+
+  /**
+   * @brief Publish the statistics of the control loop, if they are due
+   */
+  void publishStatistics();
+
   /**
    * @brief get the thresholded velocity
    * @param velocity The current velocity from odometry
@@ -199,6 +239,8 @@ protected:
   // Publishers and subscribers
   std::unique_ptr<nav_2d_utils::OdomSubscriber> odom_sub_;
   rclcpp_lifecycle::LifecyclePublisher<geometry_msgs::msg::Twist>::SharedPtr vel_publisher_;
+  rclcpp_lifecycle::LifecyclePublisher<nav2_msgs::msg::ControlLoopStatistics>::SharedPtr
+    statistics_pub_;
 
   // Controller Plugins
   pluginlib::ClassLoader<nav2_core::Controller> lp_loader_;
@@ -206,12 +248,32 @@ protected:
   std::vector<std::string> controller_ids_, controller_types_;
   std::string controller_ids_concat_, current_controller_;
 
+  // The path last given to the controllers, to the current one only unless controller_pool_
+  nav_msgs::msg::Path last_path_;
+  std::string last_path_controller_;
+
   std::unique_ptr<ProgressChecker> progress_checker_;
+  std::unique_ptr<PosePredictor> pose_predictor_;  ///< Null unless predict_pose is set
+
+  // Keeping every controller on the path, see computeAndPublishVelocity
+  bool prepare_all_controllers_;
+  bool pick_controller_by_cost_;
+  std::unique_ptr<nav2_util::ThreadPool> controller_pool_;
 
   double controller_frequency_;
   double min_x_velocity_threshold_;
   double min_y_velocity_threshold_;
   double min_theta_velocity_threshold_;
+  double controller_time_budget_;
+  nav2_util::RealtimeSettings control_thread_settings_;
+
+  // Timings of the control loop by phase, empty unless statistics_publish_frequency is set
+  std::vector<nav2_costmap_2d::RollingStatistics> phase_times_;
+  unsigned int missed_cycles_{0};
+  double statistics_publish_frequency_;
+  int statistics_window_;
+  rclcpp::Time last_statistics_publish_{0, 0, RCL_ROS_TIME};
+  rclcpp::Duration statistics_cycle_{1, 0};
 
   // Whether we've published the single controller warning yet
   bool single_controller_warning_given_{false};
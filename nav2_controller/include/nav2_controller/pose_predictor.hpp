@@ -0,0 +1,73 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_CONTROLLER__POSE_PREDICTOR_HPP_
+#define NAV2_CONTROLLER__POSE_PREDICTOR_HPP_
+
+#include <memory>
+#include <string>
+
+#include "rclcpp/rclcpp.hpp"
+#include "rclcpp_lifecycle/lifecycle_node.hpp"
+#include "geometry_msgs/msg/pose_stamped.hpp"
+#include "geometry_msgs/msg/transform_stamped.hpp"
+#include "nav_2d_msgs/msg/twist2_d.hpp"
+#include "tf2_ros/buffer.h"
+
+namespace nav2_controller
+{
+/**
+ * @class nav2_controller::PosePredictor
+ * @brief Predicts the pose of the robot at the time a command takes effect,
+ * from the latest transform available and the odometry twist, without waiting on TF.
+ */
+class PosePredictor
+{
+public:
+  /**
+   * @brief Constructor of PosePredictor
+   * @param node Node pointer
+   * @param tf_buffer The buffer to take the latest transform from
+   * @param global_frame The frame of the predicted pose
+   * @param robot_frame The frame of the robot
+   */
+  PosePredictor(
+    const rclcpp_lifecycle::LifecycleNode::SharedPtr & node,
+    const std::shared_ptr<tf2_ros::Buffer> & tf_buffer,
+    const std::string & global_frame, const std::string & robot_frame);
+
+  /**
+   * @brief Predict the pose at now plus the actuator delay
+   *
+   * The robot is moved from the latest transform along the twist, held constant. The pose
+   * keeps the stamp of the transform, so transforms at its stamp are still available.
+   *
+   * @param twist The velocity of the robot, in its own frame
+   * @param pose Set to the predicted pose
+   * @return false when no transform is available or the latest one is older than max_pose_age
+   */
+  bool predict(const nav_2d_msgs::msg::Twist2D & twist, geometry_msgs::msg::PoseStamped & pose);
+
+protected:
+  rclcpp_lifecycle::LifecycleNode::SharedPtr nh_;
+  std::shared_ptr<tf2_ros::Buffer> tf_buffer_;
+  std::string global_frame_;
+  std::string robot_frame_;
+
+  double actuator_delay_;
+  double max_pose_age_;
+};
+}  // namespace nav2_controller
+
+#endif  // NAV2_CONTROLLER__POSE_PREDICTOR_HPP_
@@ -12,7 +12,9 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
 #include <chrono>
+#include <exception>
 #include <vector>
 #include <memory>
 #include <string>
@@ -20,6 +22,8 @@
 #include "nav2_core/exceptions.hpp"
 #include "nav_2d_utils/conversions.hpp"
 #include "nav2_util/node_utils.hpp"
+#include "nav2_util/trace.hpp"
+#include "nav2_controller/pose_predictor.hpp"
 #include "nav2_controller/progress_checker.hpp"
 #include "nav2_controller/nav2_controller.hpp"
 
@@ -28,8 +32,8 @@ using namespace std::chrono_literals;
 namespace nav2_controller
 {
 
-ControllerServer::ControllerServer()
-: LifecycleNode("controller_server", "", true),
+ControllerServer::ControllerServer(const rclcpp::NodeOptions & options)
+: LifecycleNode("controller_server", "", true, options),
   lp_loader_("nav2_core", "nav2_core::Controller")
 {
   RCLCPP_INFO(get_logger(), "Creating controller server");
@@ -44,6 +48,15 @@ ControllerServer::ControllerServer()
   declare_parameter("min_x_velocity_threshold", rclcpp::ParameterValue(0.0001));
   declare_parameter("min_y_velocity_threshold", rclcpp::ParameterValue(0.0001));
   declare_parameter("min_theta_velocity_threshold", rclcpp::ParameterValue(0.0001));
+  declare_parameter("prepare_all_controllers", rclcpp::ParameterValue(false));
+  declare_parameter("pick_controller_by_cost", rclcpp::ParameterValue(false));
+  declare_parameter("controller_time_budget", rclcpp::ParameterValue(0.0));
+  declare_parameter("predict_pose", rclcpp::ParameterValue(false));
+  declare_parameter("statistics_publish_frequency", rclcpp::ParameterValue(0.0));
+  declare_parameter("statistics_window", rclcpp::ParameterValue(100));
+  declare_parameter("realtime_priority", rclcpp::ParameterValue(0));
+  declare_parameter("cpu_affinity", rclcpp::ParameterValue(std::vector<int64_t>()));
+  declare_parameter("lock_memory", rclcpp::ParameterValue(false));
 
   // The costmap node is used in the implementation of the controller
   costmap_ros_ = std::make_shared<nav2_costmap_2d::Costmap2DROS>(
@@ -70,6 +83,22 @@ ControllerServer::on_configure(const rclcpp_lifecycle::State & state)
   get_parameter("min_x_velocity_threshold", min_x_velocity_threshold_);
   get_parameter("min_y_velocity_threshold", min_y_velocity_threshold_);
   get_parameter("min_theta_velocity_threshold", min_theta_velocity_threshold_);
+  get_parameter("prepare_all_controllers", prepare_all_controllers_);
+  get_parameter("pick_controller_by_cost", pick_controller_by_cost_);
+  get_parameter("controller_time_budget", controller_time_budget_);
+  get_parameter("statistics_publish_frequency", statistics_publish_frequency_);
+  get_parameter("statistics_window", statistics_window_);
+  get_parameter("realtime_priority", control_thread_settings_.priority);
+  std::vector<int64_t> cpu_affinity;
+  get_parameter("cpu_affinity", cpu_affinity);
+  control_thread_settings_.cpu_affinity.assign(cpu_affinity.begin(), cpu_affinity.end());
+  get_parameter("lock_memory", control_thread_settings_.lock_memory);
+  if (pick_controller_by_cost_ && !prepare_all_controllers_) {
+    RCLCPP_WARN(
+      get_logger(), "pick_controller_by_cost needs prepare_all_controllers, "
+      "using only the requested controller.");
+    pick_controller_by_cost_ = false;
+  }
   RCLCPP_INFO(get_logger(), "Controller frequency set to %.4fHz", controller_frequency_);
 
   costmap_ros_->on_configure(state);
@@ -78,6 +107,14 @@ ControllerServer::on_configure(const rclcpp_lifecycle::State & state)
 
   progress_checker_ = std::make_unique<ProgressChecker>(node);
 
+  bool predict_pose;
+  get_parameter("predict_pose", predict_pose);
+  if (predict_pose) {
+    pose_predictor_ = std::make_unique<PosePredictor>(
+      node, costmap_ros_->getTfBuffer(),
+      costmap_ros_->getGlobalFrameID(), costmap_ros_->getBaseFrameID());
+  }
+
   if (controller_types_.size() != controller_ids_.size()) {
     RCLCPP_FATAL(
       get_logger(), "Size of controller names (%i) and "
@@ -97,6 +134,7 @@ ControllerServer::on_configure(const rclcpp_lifecycle::State & state)
       controller->configure(
         node, controller_ids_[i],
         costmap_ros_->getTfBuffer(), costmap_ros_);
+      controller->setTimeBudget(controller_time_budget_);
       controllers_.insert({controller_ids_[i], controller});
     } catch (const pluginlib::PluginlibException & ex) {
       RCLCPP_FATAL(get_logger(), "Failed to create controller. Exception: %s", ex.what());
@@ -108,13 +146,30 @@ ControllerServer::on_configure(const rclcpp_lifecycle::State & state)
     controller_ids_concat_ += controller_ids_[i] + std::string(" ");
   }
 
+  // One thread per controller, the calling one computes the first
+  if (prepare_all_controllers_ && controllers_.size() > 1) {
+    controller_pool_ = std::make_unique<nav2_util::ThreadPool>(controllers_.size());
+  }
+
   odom_sub_ = std::make_unique<nav_2d_utils::OdomSubscriber>(node);
   vel_publisher_ = create_publisher<geometry_msgs::msg::Twist>("cmd_vel", 1);
 
+  missed_cycles_ = 0;
+  phase_times_.clear();
+  if (statistics_publish_frequency_ > 0) {
+    phase_times_.assign(
+      NUM_PHASES, nav2_costmap_2d::RollingStatistics(std::max(1, statistics_window_)));
+    statistics_cycle_ = rclcpp::Duration::from_seconds(1 / statistics_publish_frequency_);
+    statistics_pub_ = create_publisher<nav2_msgs::msg::ControlLoopStatistics>(
+      "control_loop_statistics", rclcpp::SystemDefaultsQoS(),
+      nav2_util::get_inter_process_publisher_options());
+  }
+
   // Create the action server that we implement with our followPath method
   action_server_ = std::make_unique<ActionServer>(
     rclcpp_node_, "follow_path",
-    std::bind(&ControllerServer::computeControl, this));
+    std::bind(&ControllerServer::computeControl, this),
+    true, std::chrono::milliseconds(500), true, true);
 
   return nav2_util::CallbackReturn::SUCCESS;
 }
@@ -130,6 +185,9 @@ ControllerServer::on_activate(const rclcpp_lifecycle::State & state)
     it->second->activate();
   }
   vel_publisher_->on_activate();
+  if (statistics_pub_) {
+    statistics_pub_->on_activate();
+  }
   action_server_->activate();
 
   return nav2_util::CallbackReturn::SUCCESS;
@@ -149,6 +207,9 @@ ControllerServer::on_deactivate(const rclcpp_lifecycle::State & state)
 
   publishZeroVelocity();
   vel_publisher_->on_deactivate();
+  if (statistics_pub_) {
+    statistics_pub_->on_deactivate();
+  }
 
   return nav2_util::CallbackReturn::SUCCESS;
 }
@@ -164,6 +225,7 @@ ControllerServer::on_cleanup(const rclcpp_lifecycle::State & state)
     it->second->cleanup();
   }
   controllers_.clear();
+  controller_pool_.reset();
   costmap_ros_->on_cleanup(state);
 
   // Release any allocated resources
@@ -172,8 +234,10 @@ ControllerServer::on_cleanup(const rclcpp_lifecycle::State & state)
     it->second.reset();
   }
   odom_sub_.reset();
+  pose_predictor_.reset();
 
   vel_publisher_.reset();
+  statistics_pub_.reset();
   action_server_.reset();
 
   return nav2_util::CallbackReturn::SUCCESS;
@@ -225,6 +289,16 @@ void ControllerServer::computeControl()
 {
   RCLCPP_INFO(get_logger(), "Received a goal, begin computing control effort.");
 
+  // the action server may run each goal on a thread of its own
+  if (!control_thread_settings_.empty()) {
+    std::string error;
+    if (!nav2_util::apply_realtime_settings(control_thread_settings_, error)) {
+      RCLCPP_WARN(
+        get_logger(), "Control loop runs without all its scheduling settings: %s",
+        error.c_str());
+    }
+  }
+
   try {
     std::string c_name = action_server_->get_current_goal()->controller_id;
     std::string current_controller;
@@ -235,6 +309,8 @@ void ControllerServer::computeControl()
       return;
     }
 
+    // a new goal starts the controllers over
+    last_path_.poses.clear();
     setPlannerPath(action_server_->get_current_goal()->path);
     progress_checker_->reset();
 
@@ -257,23 +333,33 @@ void ControllerServer::computeControl()
         return;
       }
 
+      auto cycle_start = std::chrono::steady_clock::now();
       updateGlobalPath();
+      addPhaseTime(UPDATE_PATH, cycle_start);
 
       computeAndPublishVelocity();
 
-      if (isGoalReached()) {
+      auto goal_check_start = std::chrono::steady_clock::now();
+      bool goal_reached = isGoalReached();
+      addPhaseTime(GOAL_CHECK, goal_check_start);
+      addPhaseTime(CYCLE, cycle_start);
+
+      if (goal_reached) {
         RCLCPP_INFO(get_logger(), "Reached the goal!");
         break;
       }
 
       if (!loop_rate.sleep()) {
+        missed_cycles_++;
         RCLCPP_WARN(
           get_logger(), "Control loop missed its desired rate of %.4fHz",
           controller_frequency_);
       }
+      publishStatistics();
     }
   } catch (nav2_core::PlannerException & e) {
     RCLCPP_ERROR(this->get_logger(), e.what());
+    costmap_ros_->saveFlightRecording();
     publishZeroVelocity();
     action_server_->terminate_current();
     return;
@@ -295,7 +381,32 @@ void ControllerServer::setPlannerPath(const nav_msgs::msg::Path & path)
   if (path.poses.empty()) {
     throw nav2_core::PlannerException("Invalid path, Path is empty.");
   }
-  controllers_[current_controller_]->setPlan(path);
+
+  // the poses the path shares with the last one from its start
+  size_t shared = 0;
+  if (path.header.frame_id == last_path_.header.frame_id &&
+    (controller_pool_ || last_path_controller_ == current_controller_))
+  {
+    size_t size = std::min(path.poses.size(), last_path_.poses.size());
+    while (shared < size && path.poses[shared].pose == last_path_.poses[shared].pose) {
+      shared++;
+    }
+  }
+  auto provide = [&](const nav2_core::Controller::Ptr & controller) {
+      if (shared == 0 || !controller->splicePlan(path, shared)) {
+        controller->setPlan(path);
+      }
+    };
+  if (controller_pool_) {
+    // all of them follow the path, so switching to another one is instant
+    for (const std::string & id : controller_ids_) {
+      provide(controllers_[id]);
+    }
+  } else {
+    provide(controllers_[current_controller_]);
+  }
+  last_path_ = path;
+  last_path_controller_ = current_controller_;
 
   auto end_pose = *(path.poses.end() - 1);
 
@@ -306,23 +417,115 @@ void ControllerServer::setPlannerPath(const nav_msgs::msg::Path & path)
 
 void ControllerServer::computeAndPublishVelocity()
 {
+  NAV2_TRACE_SCOPE("compute_velocity");
   geometry_msgs::msg::PoseStamped pose;
 
-  if (!getRobotPose(pose)) {
+  auto phase_start = std::chrono::steady_clock::now();
+  if (!getCommandPose(pose)) {
     throw nav2_core::PlannerException("Failed to obtain robot pose");
   }
+  addPhaseTime(ROBOT_POSE, phase_start);
 
   progress_checker_->check(pose);
 
   nav_2d_msgs::msg::Twist2D twist = getThresholdedTwist(odom_sub_->getTwist());
 
-  auto cmd_vel_2d =
-    controllers_[current_controller_]->computeVelocityCommands(
-    pose,
-    nav_2d_utils::twist2Dto3D(twist));
+  phase_start = std::chrono::steady_clock::now();
+  if (!controller_pool_) {
+    auto cmd_vel_2d =
+      controllers_[current_controller_]->computeVelocityCommands(
+      pose,
+      nav_2d_utils::twist2Dto3D(twist));
+    addPhaseTime(CONTROLLER, phase_start);
+
+    phase_start = std::chrono::steady_clock::now();
+    RCLCPP_DEBUG(get_logger(), "Publishing velocity at time %.2f", now().seconds());
+    publishVelocity(cmd_vel_2d);
+    addPhaseTime(PUBLISH, phase_start);
+    return;
+  }
+
+  std::vector<geometry_msgs::msg::TwistStamped> commands(controller_ids_.size());
+  std::vector<std::exception_ptr> errors(controller_ids_.size());
+  controller_pool_->parallel_for(
+    controller_ids_.size(), [&](size_t i) {
+      try {
+        commands[i] = controllers_[controller_ids_[i]]->computeVelocityCommands(
+          pose, nav_2d_utils::twist2Dto3D(twist));
+      } catch (...) {
+        errors[i] = std::current_exception();
+      }
+    });
+
+  size_t current = 0;
+  while (controller_ids_[current] != current_controller_) {
+    current++;
+  }
+  size_t chosen = current;
+  if (pick_controller_by_cost_) {
+    // the current one wins ties and is kept when no other one measures its cost
+    double best_cost =
+      errors[current] ? -1.0 : controllers_[current_controller_]->getLastCommandCost();
+    for (size_t i = 0; i < controller_ids_.size(); i++) {
+      double cost = controllers_[controller_ids_[i]]->getLastCommandCost();
+      if (errors[i] || cost < 0.0) {
+        continue;
+      }
+      if (errors[chosen] || best_cost < 0.0 || cost < best_cost) {
+        chosen = i;
+        best_cost = cost;
+      }
+    }
+  }
+  if (errors[chosen]) {
+    std::rethrow_exception(errors[chosen]);
+  }
+  if (chosen != current) {
+    RCLCPP_DEBUG(
+      get_logger(), "Using the command of controller %s", controller_ids_[chosen].c_str());
+  }
+  auto cmd_vel_2d = commands[chosen];
+  addPhaseTime(CONTROLLER, phase_start);
 
+  phase_start = std::chrono::steady_clock::now();
   RCLCPP_DEBUG(get_logger(), "Publishing velocity at time %.2f", now().seconds());
   publishVelocity(cmd_vel_2d);
+  addPhaseTime(PUBLISH, phase_start);
+}
+
+void ControllerServer::addPhaseTime(
+  Phase phase, const std::chrono::steady_clock::time_point & start)
+{
+  if (phase_times_.empty()) {
+    return;
+  }
+  phase_times_[phase].add(
+    std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+}
+
+void ControllerServer::publishStatistics()
+{
+  if (!statistics_pub_) {
+    return;
+  }
+  auto current_time = now();
+  if (!(last_statistics_publish_ + statistics_cycle_ < current_time ||
+    current_time < last_statistics_publish_))
+  {
+    return;
+  }
+  static const char * const phase_names[NUM_PHASES] = {
+    "cycle", "update_path", "robot_pose", "controller", "publish", "goal_check"};
+  nav2_msgs::msg::ControlLoopStatistics msg;
+  msg.header.frame_id = costmap_ros_->getGlobalFrameID();
+  msg.header.stamp = current_time;
+  msg.missed_cycles = missed_cycles_;
+  msg.statistics.resize(NUM_PHASES);
+  for (int phase = 0; phase < NUM_PHASES; phase++) {
+    phase_times_[phase].toMsg(phase_names[phase], msg.statistics[phase]);
+  }
+  statistics_pub_->publish(msg);
+  last_statistics_publish_ = current_time;
 }
 
 void ControllerServer::updateGlobalPath()
@@ -386,4 +589,19 @@ bool ControllerServer::getRobotPose(geometry_msgs::msg::PoseStamped & pose)
   return true;
 }
 
+bool ControllerServer::getCommandPose(geometry_msgs::msg::PoseStamped & pose)
+{
+  if (!pose_predictor_) {
+    return getRobotPose(pose);
+  }
+  return pose_predictor_->predict(odom_sub_->getTwist(), pose);
+}
+
 }  // namespace nav2_controller
+
+#include "rclcpp_components/register_node_macro.hpp"
+
+// Register the component with class_loader.
+// This acts as a sort of entry point, allowing the component to be discoverable when its library
+// is being loaded into a running process.
+RCLCPP_COMPONENTS_REGISTER_NODE(nav2_controller::ControllerServer)
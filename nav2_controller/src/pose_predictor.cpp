@@ -0,0 +1,87 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_controller/pose_predictor.hpp"
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <string>
+#include "nav2_util/node_utils.hpp"
+#include "tf2/utils.h"
+#include "tf2_geometry_msgs/tf2_geometry_msgs.h"
+
+namespace nav2_controller
+{
+
+PosePredictor::PosePredictor(
+  const rclcpp_lifecycle::LifecycleNode::SharedPtr & node,
+  const std::shared_ptr<tf2_ros::Buffer> & tf_buffer,
+  const std::string & global_frame, const std::string & robot_frame)
+: nh_(node), tf_buffer_(tf_buffer), global_frame_(global_frame), robot_frame_(robot_frame)
+{
+  nav2_util::declare_parameter_if_not_declared(
+    nh_, "actuator_delay", rclcpp::ParameterValue(0.0));
+  nav2_util::declare_parameter_if_not_declared(
+    nh_, "max_pose_age", rclcpp::ParameterValue(0.5));
+  nh_->get_parameter("actuator_delay", actuator_delay_);
+  nh_->get_parameter("max_pose_age", max_pose_age_);
+}
+
+bool PosePredictor::predict(
+  const nav_2d_msgs::msg::Twist2D & twist,
+  geometry_msgs::msg::PoseStamped & pose)
+{
+  geometry_msgs::msg::TransformStamped transform;
+  try {
+    // the latest transform there is, without waiting for a newer one
+    transform = tf_buffer_->lookupTransform(global_frame_, robot_frame_, tf2::TimePointZero);
+  } catch (tf2::TransformException & ex) {
+    RCLCPP_ERROR(nh_->get_logger(), "Could not look up the robot pose: %s", ex.what());
+    return false;
+  }
+
+  rclcpp::Time stamp(transform.header.stamp, nh_->now().get_clock_type());
+  double age = (nh_->now() - stamp).seconds();
+  if (age > max_pose_age_) {
+    RCLCPP_ERROR(
+      nh_->get_logger(), "The latest robot pose is %.3f seconds old, more than max_pose_age", age);
+    return false;
+  }
+  double dt = std::max(0.0, age + actuator_delay_);
+
+  // the twist, held constant over dt, moves the robot along an arc
+  double theta0 = tf2::getYaw(transform.transform.rotation);
+  double theta1 = theta0 + twist.theta * dt;
+  double along_cos, along_sin;
+  if (std::fabs(twist.theta * dt) < 1e-6) {
+    along_cos = std::cos(theta0) * dt;
+    along_sin = std::sin(theta0) * dt;
+  } else {
+    along_cos = (std::sin(theta1) - std::sin(theta0)) / twist.theta;
+    along_sin = (std::cos(theta0) - std::cos(theta1)) / twist.theta;
+  }
+
+  pose.header = transform.header;
+  pose.pose.position.x =
+    transform.transform.translation.x + twist.x * along_cos - twist.y * along_sin;
+  pose.pose.position.y =
+    transform.transform.translation.y + twist.x * along_sin + twist.y * along_cos;
+  pose.pose.position.z = transform.transform.translation.z;
+  tf2::Quaternion orientation;
+  orientation.setRPY(0.0, 0.0, theta1);
+  pose.pose.orientation = tf2::toMsg(orientation);
+  return true;
+}
+
+}  // namespace nav2_controller
@@ -97,6 +97,19 @@ public:
    */
   virtual void setPlan(const nav_msgs::msg::Path & path) = 0;
 
+  /**
+   * @brief Continue the current plan with a new path sharing its first poses
+   *
+   * The poses before index are the same as in the plan last set or spliced, so only those
+   * from index on are taken, and what the controller learned while following the plan is
+   * kept, unlike with setPlan. An index of the size of the current plan appends to it.
+   *
+   * @param path The new plan
+   * @param index The number of poses the new plan shares with the current one
+   * @return false if the controller can't splice its plan, then setPlan is to be used
+   */
+  virtual bool splicePlan(const nav_msgs::msg::Path &, size_t) {return false;}
+
   /**
    * @brief Controller computeVelocityCommands - calculates the best command given the current pose and velocity
    *
@@ -126,6 +139,25 @@ public:
   virtual bool isGoalReached(
     const geometry_msgs::msg::PoseStamped & pose,
     const geometry_msgs::msg::Twist & velocity) = 0;
+
+  /**
+   * @brief The cost of the command computeVelocityCommands last returned, lower is better
+   *
+   * Lets a server running several controllers pick among their commands.
+   *
+   * @return The cost, negative if the controller doesn't measure one
+   */
+  virtual double getLastCommandCost() const {return -1.0;}
+
+  /**
+   * @brief Bound the time computeVelocityCommands takes
+   *
+   * Controllers that search for the best command can stop the search once the budget is
+   * spent and return the best one found so far. Others ignore it.
+   *
+   * @param seconds The time budget of a call, 0 for none
+   */
+  virtual void setTimeBudget(double) {}
 };
 
 }  // namespace nav2_core
@@ -15,8 +15,10 @@
 #ifndef NAV2_CORE__GLOBAL_PLANNER_HPP_
 #define NAV2_CORE__GLOBAL_PLANNER_HPP_
 
+#include <cmath>
 #include <memory>
 #include <string>
+#include <vector>
 #include "rclcpp/rclcpp.hpp"
 #include "nav2_costmap_2d/costmap_2d_ros.hpp"
 #include "tf2_ros/buffer.h"
@@ -76,6 +78,37 @@ public:
   virtual nav_msgs::msg::Path createPlan(
     const geometry_msgs::msg::PoseStamped & start,
     const geometry_msgs::msg::PoseStamped & goal) = 0;
+
+  /**
+   * @brief Method to create plans from one start to several goals, e.g. to pick
+   * the cheapest of them. By default this plans to each goal in turn, planners
+   * that can share the work between goals should override it.
+   * @param start The starting pose of the robot
+   * @param goals The goal poses
+   * @param costs Filled with the cost of each path, or -1 if there is none. The
+   * default cost is the path's length.
+   * @return      The path to each goal, empty if there is none
+   */
+  virtual std::vector<nav_msgs::msg::Path> createPlans(
+    const geometry_msgs::msg::PoseStamped & start,
+    const std::vector<geometry_msgs::msg::PoseStamped> & goals,
+    std::vector<double> & costs)
+  {
+    std::vector<nav_msgs::msg::Path> paths;
+    costs.clear();
+    for (const auto & goal : goals) {
+      paths.push_back(createPlan(start, goal));
+      const auto & poses = paths.back().poses;
+      double length = poses.empty() ? -1.0 : 0.0;
+      for (size_t i = 1; i < poses.size(); ++i) {
+        length += std::hypot(
+          poses[i].pose.position.x - poses[i - 1].pose.position.x,
+          poses[i].pose.position.y - poses[i - 1].pose.position.y);
+      }
+      costs.push_back(length);
+    }
+    return paths;
+  }
 };
 
 }  // namespace nav2_core
@@ -15,8 +15,10 @@
 #ifndef NAV2_COSTMAP_2D__CLEAR_COSTMAP_SERVICE_HPP_
 #define NAV2_COSTMAP_2D__CLEAR_COSTMAP_SERVICE_HPP_
 
+#include <chrono>
 #include <vector>
 #include <string>
+#include <future>
 #include <memory>
 
 #include "rclcpp/rclcpp.hpp"
@@ -38,14 +40,20 @@ public:
 
   ClearCostmapService() = delete;
 
+  // The clears below are queued on the layered costmap and run at the start of its next
+  // update, so the caller never waits for an update to finish. The future they return is
+  // ready once the costmap has been updated with the clear, and invalid if nothing was
+  // queued. The services only reply when it is ready, so a recovery clearing the costmap
+  // can replan on the cleared one right away.
+
   // Clears the region outside of a user-specified area reverting to the static map
-  void clearExceptRegion(double reset_distance = 3.0);
+  std::shared_future<void> clearExceptRegion(double reset_distance = 3.0);
 
   // Clears within a window around the robot
-  void clearAroundRobot(double window_size_x, double window_size_y);
+  std::shared_future<void> clearAroundRobot(double window_size_x, double window_size_y);
 
   // Clears all layers
-  void clearEntirely();
+  std::shared_future<void> clearEntirely();
 
 private:
   // The ROS node to use for getting parameters, creating the service and logging
@@ -56,6 +64,8 @@ private:
 
   // Clearing parameters
   unsigned char reset_value_;
+  // How long a service waits for its clear to be applied, a few update cycles
+  std::chrono::duration<double> clear_timeout_;
   std::vector<std::string> clearable_layers_;
 
   // Server for clearing the costmap
@@ -77,6 +87,9 @@ private:
     const std::shared_ptr<nav2_msgs::srv::ClearEntireCostmap::Request> request,
     const std::shared_ptr<nav2_msgs::srv::ClearEntireCostmap::Response> response);
 
+  // Wait for a queued clear to be applied before the service replies
+  void waitForClear(const std::shared_future<void> & cleared) const;
+
   void clearLayerExceptRegion(
     std::shared_ptr<CostmapLayer> & costmap, double pose_x, double pose_y, double reset_distance);
 
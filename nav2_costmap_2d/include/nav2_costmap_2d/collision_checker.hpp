@@ -23,8 +23,10 @@
 #include "rclcpp/rclcpp.hpp"
 #include "geometry_msgs/msg/pose_stamped.hpp"
 #include "geometry_msgs/msg/pose2_d.hpp"
+#include "geometry_msgs/msg/polygon_stamped.hpp"
 #include "nav2_costmap_2d/costmap_2d.hpp"
 #include "nav2_costmap_2d/costmap_subscriber.hpp"
+#include "nav2_costmap_2d/footprint.hpp"
 #include "nav2_costmap_2d/footprint_subscriber.hpp"
 #include "nav2_util/robot_utils.hpp"
 #pragma GCC diagnostic push
@@ -52,15 +54,37 @@ public:
   double scorePose(const geometry_msgs::msg::Pose2D & pose);
   bool isCollisionFree(const geometry_msgs::msg::Pose2D & pose);
 
+  // Returns the highest obstacle footprint score along a sequence of poses, such as a
+  // simulated recovery motion. The costmap, footprint and robot pose are looked up once
+  // for the whole sequence, and the footprint is laid down with a FootprintMask, so the
+  // outline at each pose can be off by a cell from the one scorePose checks.
+  double scorePath(const std::vector<geometry_msgs::msg::Pose2D> & poses);
+  bool isPathCollisionFree(const std::vector<geometry_msgs::msg::Pose2D> & poses);
+
+  // Returns the highest obstacle footprint score over the area the footprint sweeps
+  // turning in place by angle from pose, checked at once with FootprintMask. The area is
+  // padded, so a collision found here may not happen turning, but a free sweep is free.
+  double scoreSweep(const geometry_msgs::msg::Pose2D & pose, double angle);
+  bool isSweepCollisionFree(const geometry_msgs::msg::Pose2D & pose, double angle);
+
 protected:
   double lineCost(int x0, int x1, int y0, int y1) const;
   double pointCost(int x, int y) const;
   void unorientFootprint(const Footprint & oriented_footprint, Footprint & reset_footprint);
   void worldToMap(double wx, double wy, unsigned int & mx, unsigned int & my);
   Footprint getFootprint(const geometry_msgs::msg::Pose2D & pose);
+  const Footprint & getFootprintSpec();
   double footprintCost(const Footprint footprint);
 
-  std::shared_ptr<Costmap2D> costmap_;
+  std::shared_ptr<const Costmap2D> costmap_;
+
+  // The unoriented footprint, and the footprint message it was found from. It is only
+  // unoriented again, with a robot pose lookup, when a new footprint is received.
+  geometry_msgs::msg::PolygonStamped::ConstSharedPtr footprint_msg_;
+  Footprint footprint_spec_;
+
+  // The footprint rasterized at every heading, for scorePath
+  FootprintMask footprint_mask_;
 
   // Name used for logging
   std::string name_;
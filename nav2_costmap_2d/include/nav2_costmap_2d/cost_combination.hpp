@@ -0,0 +1,80 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_COSTMAP_2D__COST_COMBINATION_HPP_
+#define NAV2_COSTMAP_2D__COST_COMBINATION_HPP_
+
+#include <cstddef>
+
+#include "nav2_costmap_2d/cost_values.hpp"
+
+namespace nav2_costmap_2d
+{
+
+/**
+ * @brief Combine a layer cost into a master cost by taking the larger one
+ *
+ * A layer cost of NO_INFORMATION leaves the master cost alone, a master cost of
+ * NO_INFORMATION is replaced by any known layer cost.
+ */
+inline unsigned char combineMax(unsigned char master, unsigned char layer)
+{
+  if (layer == NO_INFORMATION) {
+    return master;
+  }
+  return (master == NO_INFORMATION || master < layer) ? layer : master;
+}
+
+/**
+ * @brief Combine a layer cost into a master cost by replacing it, unless the layer
+ * cost is NO_INFORMATION
+ */
+inline unsigned char combineOverwrite(unsigned char master, unsigned char layer)
+{
+  return layer == NO_INFORMATION ? master : layer;
+}
+
+/**
+ * @brief Combine a layer cost into a master cost by adding them up to just below
+ * INSCRIBED_INFLATED_OBSTACLE, with NO_INFORMATION handled as in combineMax()
+ */
+inline unsigned char combineAddition(unsigned char master, unsigned char layer)
+{
+  if (layer == NO_INFORMATION) {
+    return master;
+  }
+  if (master == NO_INFORMATION) {
+    return layer;
+  }
+  const int sum = master + layer;
+  return sum >= INSCRIBED_INFLATED_OBSTACLE ? INSCRIBED_INFLATED_OBSTACLE - 1 : sum;
+}
+
+/**
+ * @brief Combine size layer costs into as many master costs, see combineMax()
+ *
+ * This and the other row functions use SSE2 or NEON kernels when available at
+ * compile time, which produce the same result as the scalar combination.
+ */
+void combineMax(const unsigned char * layer, std::size_t size, unsigned char * master);
+
+/** @brief Combine size layer costs into as many master costs, see combineOverwrite() */
+void combineOverwrite(const unsigned char * layer, std::size_t size, unsigned char * master);
+
+/** @brief Combine size layer costs into as many master costs, see combineAddition() */
+void combineAddition(const unsigned char * layer, std::size_t size, unsigned char * master);
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__COST_COMBINATION_HPP_
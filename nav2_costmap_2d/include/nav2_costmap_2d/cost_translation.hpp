@@ -0,0 +1,56 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_COSTMAP_2D__COST_TRANSLATION_HPP_
+#define NAV2_COSTMAP_2D__COST_TRANSLATION_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace nav2_costmap_2d
+{
+
+/**
+ * @brief Translate a 0-255 costmap value to the -1 to 100 range of an OccupancyGrid
+ *
+ * NO_INFORMATION maps to -1, LETHAL_OBSTACLE to 100, INSCRIBED_INFLATED_OBSTACLE
+ * to 99 and the regular costs 1 to 252 are scaled to fit into 1 to 98.
+ */
+inline int8_t translateCost(unsigned char cost)
+{
+  switch (cost) {
+    case 0:
+      return 0;
+    case 253:
+      return 99;
+    case 254:
+      return 100;
+    case 255:
+      return -1;
+    default:
+      return static_cast<int8_t>(1 + (97 * (cost - 1)) / 251);
+  }
+}
+
+/**
+ * @brief Translate size costmap values to OccupancyGrid values, see translateCost()
+ *
+ * Uses SSE2 or NEON kernels when available at compile time, which produce the
+ * same result as the scalar translation.
+ */
+void translateCosts(const unsigned char * costs, std::size_t size, int8_t * occupancy);
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__COST_TRANSLATION_HPP_
@@ -0,0 +1,110 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_COSTMAP_2D__COST_VIEW_HPP_
+#define NAV2_COSTMAP_2D__COST_VIEW_HPP_
+
+#include <utility>
+#include <vector>
+
+#include "geometry_msgs/msg/point.hpp"
+#include "nav2_costmap_2d/costmap_2d.hpp"
+#include "nav2_util/grid_geometry.hpp"
+
+namespace nav2_costmap_2d
+{
+
+/**
+ * @brief A read-only view of the costs of a Costmap2D, for reading many of them in a row
+ *
+ * The view keeps the cost array, its stride and the geometry of the costmap, so its
+ * accessors are inlined and getCost() skips the bounds check, for callers that already
+ * know their cells are on the grid. It finds the same cells as Costmap2D::worldToMap().
+ *
+ * The view takes no lock and stays valid until the costmap is resized or destroyed, it is
+ * meant to be taken from a costmap nobody writes meanwhile, such as the snapshot DWB copies
+ * at the start of each cycle. Taken from a costmap that is being updated, reads are as
+ * consistent as those of the costmap itself.
+ */
+class CostView
+{
+public:
+  CostView() = default;
+
+  explicit CostView(const Costmap2D & costmap)
+  : costs_(costmap.getCharMap()),
+    size_x_(costmap.getSizeInCellsX()),
+    size_y_(costmap.getSizeInCellsY()),
+    origin_x_(costmap.getOriginX()),
+    origin_y_(costmap.getOriginY()),
+    resolution_(costmap.getResolution())
+  {
+  }
+
+  /** @brief Whether the view was taken from a costmap */
+  bool valid() const {return costs_ != nullptr;}
+
+  unsigned int getSizeInCellsX() const {return size_x_;}
+  unsigned int getSizeInCellsY() const {return size_y_;}
+
+  /**
+   * @brief Convert world coordinates to the cell of the costmap, as Costmap2D::worldToMap()
+   * @return Whether the cell is on the grid, mx and my only being meaningful then
+   */
+  inline bool worldToMap(double wx, double wy, unsigned int & mx, unsigned int & my) const
+  {
+    if (wx < origin_x_ || wy < origin_y_) {
+      return false;
+    }
+    mx = static_cast<int>((wx - origin_x_) / resolution_);
+    my = static_cast<int>((wy - origin_y_) / resolution_);
+    return mx < size_x_ && my < size_y_;
+  }
+
+  /**
+   * @brief Convert many points to cells at once, as Costmap2D::worldToMap() does
+   * @return Whether every point is on the grid
+   */
+  inline bool worldToMap(
+    const std::vector<geometry_msgs::msg::Point> & points,
+    std::vector<std::pair<int, int>> & cells) const
+  {
+    return nav2_util::worldToMap(
+      points, origin_x_, origin_y_, resolution_, size_x_, size_y_, cells);
+  }
+
+  /** @brief The cost of a cell, which has to be on the grid */
+  inline unsigned char getCost(unsigned int mx, unsigned int my) const
+  {
+    return costs_[my * size_x_ + mx];
+  }
+
+  /** @brief The costs of a row of cells, which has to be on the grid */
+  inline const unsigned char * row(unsigned int my) const
+  {
+    return costs_ + my * size_x_;
+  }
+
+private:
+  const unsigned char * costs_{nullptr};
+  unsigned int size_x_{0};
+  unsigned int size_y_{0};
+  double origin_x_{0.0};
+  double origin_y_{0.0};
+  double resolution_{0.0};
+};
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__COST_VIEW_HPP_
@@ -41,13 +41,17 @@
 #include <string.h>
 #include <stdio.h>
 #include <limits.h>
+#include <stdint.h>
 #include <algorithm>
 #include <cmath>
 #include <string>
+#include <utility>
 #include <vector>
 #include <queue>
 #include <mutex>
 #include "geometry_msgs/msg/point.hpp"
+#include "nav2_util/grid_geometry.hpp"
+#include "nav2_util/trace.hpp"
 
 namespace nav2_costmap_2d
 {
@@ -107,6 +111,16 @@ public:
     double win_size_x,
     double win_size_y);
 
+  /**
+   * @brief  Take on the size, resolution and origin of a costmap passed in, and copy the
+   * cells in [x0, xn) x [y0, yn) of it. The grid is only reallocated when the size changed,
+   * the other cells are left as they were, so they are only meaningful if the origin didn't
+   * move. The caller holds the lock of map.
+   */
+  void copyWindowFrom(
+    const Costmap2D & map, unsigned int x0, unsigned int y0, unsigned int xn,
+    unsigned int yn);
+
   /**
    * @brief  Default constructor
    */
@@ -152,6 +166,21 @@ public:
    */
   bool worldToMap(double wx, double wy, unsigned int & mx, unsigned int & my) const;
 
+  /**
+   * @brief  Convert many points from world coordinates to map coordinates at once,
+   * finding the cells worldToMap() does for each of them
+   * @param  points The world points, such as the corners of a footprint
+   * @param  cells Will be set to the map coordinates of each point
+   * @return True if every point is in the map, false otherwise
+   */
+  bool worldToMap(
+    const std::vector<geometry_msgs::msg::Point> & points,
+    std::vector<std::pair<int, int>> & cells) const
+  {
+    return nav2_util::worldToMap(
+      points, origin_x_, origin_y_, resolution_, size_x_, size_y_, cells);
+  }
+
   /**
    * @brief  Convert from world coordinates to map coordinates without checking for legal bounds
    * @param  wx The x world coordinate
@@ -303,6 +332,13 @@ public:
   void resetMapToValue(
     unsigned int x0, unsigned int y0, unsigned int xn, unsigned int yn, unsigned char value);
 
+  /**
+   * @brief  Reset every cell outside of [x0, xn) x [y0, yn) to value. The window is
+   * clamped to the map, so it may reach past the map or be empty. The rows above and
+   * below the window are contiguous and take one memset each, the rows beside it two.
+   */
+  void resetMapOutside(int x0, int y0, int xn, int yn, unsigned char value);
+
   /**
    * @brief  Given distance in the world... convert it to cells
    * @param  world_dist The world distance
@@ -310,14 +346,92 @@ public:
    */
   unsigned int cellDistance(double world_dist);
 
-  // Provide a typedef to ease future code maintenance
-  typedef std::recursive_mutex mutex_t;
+  /**
+   * @brief  Record that the cells in [x0, xn) x [y0, yn) changed. resetMap() and
+   * resetMapToValue() record their region themselves; whoever writes cells directly
+   * through setCost() or getCharMap() has to call this for consumers to see it
+   */
+  void markChanged(unsigned int x0, unsigned int y0, unsigned int xn, unsigned int yn);
+
+  /**
+   * @brief  Record that every cell may have changed, e.g. after a resize or a shift
+   */
+  void markAllChanged();
+
+  /**
+   * @brief  Get a counter that is incremented on every recorded change
+   * @return The number of changes recorded so far
+   */
+  uint64_t getChangeCount() const;
+
+  /**
+   * @brief  Get the bounds of the cells changed since the change counter was at since
+   * @param since A value previously returned by getChangeCount()
+   * @param x0 Will be set to the lower x bound, inclusive
+   * @param y0 Will be set to the lower y bound, inclusive
+   * @param xn Will be set to the upper x bound, exclusive
+   * @param yn Will be set to the upper y bound, exclusive
+   * @return False if the whole map has to be treated as changed, either because it was
+   * or because the changes are older than the history kept
+   */
+  bool getChangedBounds(
+    uint64_t since, unsigned int & x0, unsigned int & y0,
+    unsigned int & xn, unsigned int & yn) const;
+
+  /**
+   * @brief  Side in cells of the square tiles changes are also recorded for. Tile (tx, ty)
+   * covers the cells [tx * size, (tx + 1) * size) x [ty * size, (ty + 1) * size) on the map.
+   */
+  unsigned int getChangeTileSize() const
+  {
+    return CHANGE_TILE_SIZE;
+  }
+
+  /**
+   * @brief  Get the number of change tiles along x, the stride of the tile indices
+   */
+  unsigned int getNumChangeTilesX() const
+  {
+    return (size_x_ + CHANGE_TILE_SIZE - 1) / CHANGE_TILE_SIZE;
+  }
+
+  /**
+   * @brief  Get the number of change tiles along y
+   */
+  unsigned int getNumChangeTilesY() const
+  {
+    return (size_y_ + CHANGE_TILE_SIZE - 1) / CHANGE_TILE_SIZE;
+  }
+
+  /**
+   * @brief  Get the tiles changed since the change counter was at since. Unlike
+   * getChangedBounds() this has no history limit: each tile keeps the counter of its
+   * last change.
+   * @param since A value previously returned by getChangeCount()
+   * @param tiles Will be set to the indices ty * getNumChangeTilesX() + tx of the
+   * changed tiles, in increasing order
+   */
+  void getChangedTiles(uint64_t since, std::vector<unsigned int> & tiles) const;
+
+  // Provide a typedef to ease future code maintenance. The waits for the lock are
+  // traced when NAV2_TRACE_FILE is set.
+  typedef nav2_util::trace::TracedMutex<std::recursive_mutex> mutex_t;
   mutex_t * getMutex()
   {
     return access_;
   }
 
 protected:
+  /**
+   * @brief  Rasterize a convex polygon into the first and last cell of each row it covers
+   * @param polygon The polygon in map coordinates to rasterize, of at least 3 cells
+   * @return The row of fill_spans_[0], the spans of the following rows come after it
+   *
+   * Each row spans the cells its outline crosses, as traced by raytraceLine(), and
+   * all the cells in between. fill_spans_ is reused to not allocate per call.
+   */
+  unsigned int convexFillSpans(const std::vector<MapLocation> & polygon);
+
   /**
    * @brief  Copy a region of a source map into a destination map
    * @param  source_map The source map
@@ -351,6 +465,50 @@ protected:
     }
   }
 
+  /**
+   * @brief  Shift the contents of a map in place, so that cell (x, y) takes the
+   *         value that was in cell (x + shift_x, y + shift_y). Only the cells
+   *         with nothing to take are set to the fill value.
+   * @param  map The map to shift
+   * @param size_x The x size of the map
+   * @param size_y The y size of the map
+   * @param shift_x The number of cells to shift by in x
+   * @param shift_y The number of cells to shift by in y
+   * @param fill_value The value for the cells that come into the map
+   */
+  template<typename data_type>
+  void shiftMap(
+    data_type * map, unsigned int size_x, unsigned int size_y, int shift_x, int shift_y,
+    data_type fill_value)
+  {
+    int width = size_x;
+    int height = size_y;
+    if (std::abs(shift_x) >= width || std::abs(shift_y) >= height) {
+      std::fill(map, map + size_x * size_y, fill_value);
+      return;
+    }
+
+    // the columns kept in each row, and the ones that come into it
+    int kept = width - std::abs(shift_x);
+    int dest_x = shift_x < 0 ? -shift_x : 0;
+    int source_x = shift_x > 0 ? shift_x : 0;
+    int fill_x = shift_x > 0 ? kept : 0;
+
+    // walk the rows so that each source row is read before it is written over
+    int step = shift_y > 0 ? 1 : -1;
+    int y = shift_y > 0 ? 0 : height - 1;
+    for (int i = 0; i < height; ++i, y += step) {
+      data_type * row = map + y * width;
+      int source_y = y + shift_y;
+      if (source_y < 0 || source_y >= height) {
+        std::fill(row, row + width, fill_value);
+        continue;
+      }
+      memmove(row + dest_x, map + source_y * width + source_x, kept * sizeof(data_type));
+      std::fill(row + fill_x, row + fill_x + width - kept, fill_value);
+    }
+  }
+
   /**
    * @brief  Deletes the costmap, static_map, and markers data structures
    */
@@ -402,7 +560,7 @@ protected:
     // if x is dominant
     if (abs_dx >= abs_dy) {
       int error_y = abs_dx / 2;
-      bresenham2D(
+      nav2_util::bresenham2D(
         at, abs_dx, abs_dy, error_y, offset_dx, offset_dy, offset,
         (unsigned int)(scale * abs_dx));
       return;
@@ -410,35 +568,12 @@ protected:
 
     // otherwise y is dominant
     int error_x = abs_dy / 2;
-    bresenham2D(
+    nav2_util::bresenham2D(
       at, abs_dy, abs_dx, error_x, offset_dy, offset_dx, offset,
       (unsigned int)(scale * abs_dy));
   }
 
 private:
-  /**
-   * @brief  A 2D implementation of Bresenham's raytracing algorithm... applies an action at each step
-   */
-  template<class ActionType>
-  inline void bresenham2D(
-    ActionType at, unsigned int abs_da, unsigned int abs_db, int error_b,
-    int offset_a,
-    int offset_b, unsigned int offset,
-    unsigned int max_length)
-  {
-    unsigned int end = std::min(max_length, abs_da);
-    for (unsigned int i = 0; i < end; ++i) {
-      at(offset);
-      offset += offset_a;
-      error_b += abs_db;
-      if ((unsigned int)error_b >= abs_da) {
-        offset += offset_b;
-        error_b -= abs_da;
-      }
-    }
-    at(offset);
-  }
-
   inline int sign(int x)
   {
     return x > 0 ? 1.0 : -1.0;
@@ -455,6 +590,24 @@ protected:
   unsigned char * costmap_;
   unsigned char default_value_;
 
+  // bounds of the most recent changes, indexed by change count
+  static const unsigned int CHANGE_HISTORY_SIZE = 16;
+  struct ChangedBounds
+  {
+    unsigned int x0, y0, xn, yn;
+  };
+  ChangedBounds change_history_[CHANGE_HISTORY_SIZE];
+  uint64_t change_count_{0};
+  uint64_t full_change_count_{0};  // change count of the last whole-map change
+
+  // change count of the last change of each tile, row-major
+  static const unsigned int CHANGE_TILE_SIZE = 32;
+  std::vector<uint64_t> tile_change_counts_;
+
+  // scratch of setConvexPolygonCost() and convexFillCells(), the first and last x per row
+  std::vector<MapLocation> fill_polygon_;
+  std::vector<std::pair<unsigned int, unsigned int>> fill_spans_;
+
   // *INDENT-OFF* Uncrustify doesn't handle indented public/private labels
   class MarkCell
   {
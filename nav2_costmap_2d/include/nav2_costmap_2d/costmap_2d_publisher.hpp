@@ -42,12 +42,14 @@
 #include <algorithm>
 #include <string>
 #include <memory>
+#include <vector>
 
 #include "rclcpp_lifecycle/lifecycle_node.hpp"
 #include "nav2_costmap_2d/costmap_2d.hpp"
 #include "nav_msgs/msg/occupancy_grid.hpp"
 #include "map_msgs/msg/occupancy_grid_update.hpp"
 #include "nav2_msgs/msg/costmap.hpp"
+#include "nav2_msgs/msg/costmap_update.hpp"
 #include "nav2_msgs/srv/get_costmap.hpp"
 #include "tf2/transform_datatypes.h"
 #include "nav2_util/lifecycle_node.hpp"
@@ -65,13 +67,23 @@ class Costmap2DPublisher
 public:
   /**
    * @brief  Constructor for the Costmap2DPublisher
+   * @param delta_publishing Publish only the changed region of the raw costmap on
+   * topic_name + "_raw_updates" between full costmaps
+   * @param keyframe_interval With delta publishing, number of publish cycles after
+   * which a full costmap is sent regardless, 0 only sends one on geometry changes
+   * and when the subscribers change
+   * @param raw_encoding Encoding of the raw costmap and its updates, one of the
+   * nav2_msgs::msg::Costmap::ENCODING_* values
    */
   Costmap2DPublisher(
     nav2_util::LifecycleNode::SharedPtr ros_node,
     Costmap2D * costmap,
     std::string global_frame,
     std::string topic_name,
-    bool always_send_full_costmap = false);
+    bool always_send_full_costmap = false,
+    bool delta_publishing = false,
+    unsigned int keyframe_interval = 0,
+    uint8_t raw_encoding = nav2_msgs::msg::Costmap::ENCODING_RAW);
 
   /**
    * @brief  Destructor
@@ -84,12 +96,14 @@ public:
     costmap_pub_->on_activate();
     costmap_update_pub_->on_activate();
     costmap_raw_pub_->on_activate();
+    costmap_raw_update_pub_->on_activate();
   }
   void on_deactivate()
   {
     costmap_pub_->on_deactivate();
     costmap_update_pub_->on_deactivate();
     costmap_raw_pub_->on_deactivate();
+    costmap_raw_update_pub_->on_deactivate();
   }
   void on_cleanup() {}
 
@@ -120,6 +134,10 @@ private:
   /** @brief Prepare grid_ message for publication. */
   void prepareGrid();
   void prepareCostmap();
+  /** @brief Prepare costmap_raw_update_ message with the changed-rectangle. */
+  void prepareCostmapUpdate();
+  /** @brief Whether the costmap geometry differs from the last full raw costmap. */
+  bool rawGeometryChanged();
 
   /** @brief Publish the latest full costmap to the new subscriber. */
   // void onNewSubscription(const ros::SingleSubscriberPublisher& pub);
@@ -137,8 +155,17 @@ private:
   unsigned int x0_, xn_, y0_, yn_;
   double saved_origin_x_;
   double saved_origin_y_;
+  double saved_raw_origin_x_;
+  double saved_raw_origin_y_;
   bool active_;
   bool always_send_full_costmap_;
+  bool delta_publishing_;
+  unsigned int keyframe_interval_;
+  uint8_t raw_encoding_;
+  unsigned int publishes_since_keyframe_;
+  size_t raw_subscribers_;  ///< Subscribers to the raw costmap and its updates last cycle
+  uint32_t keyframe_sequence_;  ///< Sequence of the last full raw costmap published
+  uint32_t update_sequence_;  ///< Updates published since that costmap
 
   // Publisher for translated costmap values as msg::OccupancyGrid used in visualization
   rclcpp_lifecycle::LifecyclePublisher<nav_msgs::msg::OccupancyGrid>::SharedPtr costmap_pub_;
@@ -147,14 +174,16 @@ private:
 
   // Publisher for raw costmap values as msg::Costmap from layered costmap
   rclcpp_lifecycle::LifecyclePublisher<nav2_msgs::msg::Costmap>::SharedPtr costmap_raw_pub_;
+  rclcpp_lifecycle::LifecyclePublisher<nav2_msgs::msg::CostmapUpdate>::SharedPtr
+    costmap_raw_update_pub_;
 
   // Service for getting the costmaps
   rclcpp::Service<nav2_msgs::srv::GetCostmap>::SharedPtr costmap_service_;
 
   nav_msgs::msg::OccupancyGrid grid_;
   nav2_msgs::msg::Costmap costmap_raw_;
-  // Translate from 0-255 values in costmap to -1 to 100 values in message.
-  static char * cost_translation_table_;
+  nav2_msgs::msg::CostmapUpdate costmap_raw_update_;
+  std::vector<uint8_t> encoding_buffer_;
 };
 
 }  // namespace nav2_costmap_2d
@@ -38,7 +38,11 @@
 #ifndef NAV2_COSTMAP_2D__COSTMAP_2D_ROS_HPP_
 #define NAV2_COSTMAP_2D__COSTMAP_2D_ROS_HPP_
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -47,9 +51,14 @@
 #include "nav2_costmap_2d/costmap_2d_publisher.hpp"
 #include "nav2_costmap_2d/footprint.hpp"
 #include "nav2_costmap_2d/clear_costmap_service.hpp"
+#include "nav2_costmap_2d/costmap_recorder.hpp"
 #include "nav2_costmap_2d/layered_costmap.hpp"
 #include "nav2_costmap_2d/layer.hpp"
+#include "nav2_msgs/msg/costmap_update_statistics.hpp"
+#include "nav2_msgs/srv/save_costmap_recording.hpp"
 #include "nav2_util/lifecycle_node.hpp"
+#include "nav2_util/realtime.hpp"
+#include "nav2_util/seqlock.hpp"
 #include "pluginlib/class_loader.hpp"
 #include "tf2/convert.h"
 #include "tf2/LinearMath/Transform.h"
@@ -141,6 +150,16 @@ public:
    */
   bool getRobotPose(geometry_msgs::msg::PoseStamped & global_pose);
 
+  /**
+   * @brief Get the pose of the robot the costmap was last updated at, saving a transform
+   *        lookup when it is recent enough
+   * @param global_pose Will be set to the pose of the robot in the global frame of the costmap
+   * @param max_age How old the pose of the last update may be in seconds, before the
+   *        current pose is looked up as with getRobotPose() instead
+   * @return True if the pose was set successfully, false otherwise
+   */
+  bool getUpdatePose(geometry_msgs::msg::PoseStamped & global_pose, double max_age);
+
   /** @brief Returns costmap name */
   std::string getName() const
   {
@@ -163,6 +182,18 @@ public:
     return layered_costmap_->getCostmap();
   }
 
+  /**
+   * @brief Return an immutable copy of the master costmap as of the last update.
+   *
+   * Snapshots are only produced when the use_snapshots parameter is set, otherwise
+   * this returns nullptr and readers must lock getCostmap() instead. The returned
+   * copy stays valid and unchanged for as long as the caller holds it.
+   */
+  std::shared_ptr<const Costmap2D> getCostmapSnapshot() const
+  {
+    return std::atomic_load(&snapshot_);
+  }
+
   /**
    * @brief  Returns the global frame of the costmap
    * @return The global frame of the costmap
@@ -220,6 +251,9 @@ public:
   /**
    * @brief  Build the oriented footprint of the robot at the robot's current pose
    * @param  oriented_footprint Will be filled with the points in the oriented footprint of the robot
+   *
+   * The pose of the last update is used while it is within transform_tolerance, and
+   * oriented_footprint keeps its storage, so callers reusing it don't allocate.
    */
   void getOrientedFootprint(std::vector<geometry_msgs::msg::Point> & oriented_footprint);
 
@@ -249,6 +283,25 @@ public:
 
   std::shared_ptr<tf2_ros::Buffer> getTfBuffer() {return tf_buffer_;}
 
+  /**
+   * @brief Ask for the costmap to be kept up to date at the full update rate for the next
+   * demand_timeout seconds, in on_demand mode
+   *
+   * If the map update loop was idling at the keepalive rate, it's woken and the call waits
+   * for the update that brings the costmap up to date. Otherwise it returns right away.
+   * @param timeout The longest to wait for that update
+   * @return Whether the costmap is up to date: false if the update didn't finish in time
+   */
+  bool demandUpdates(std::chrono::milliseconds timeout = std::chrono::milliseconds(1000));
+
+  /**
+   * @brief Save the updates of the last flight_recorder_duration seconds, e.g. when a plan
+   * fails, to replay them with costmap_flight_replay
+   * @param filename The file to write, "" for flight_recorder_prefix, the time and ".bin"
+   * @return The file written, "" if the recorder is disabled or the file couldn't be written
+   */
+  std::string saveFlightRecording(const std::string & filename = "");
+
 protected:
   rclcpp::Node::SharedPtr client_node_;
 
@@ -256,6 +309,8 @@ protected:
   rclcpp_lifecycle::LifecyclePublisher<geometry_msgs::msg::PolygonStamped>::SharedPtr
     footprint_pub_;
   Costmap2DPublisher * costmap_publisher_{nullptr};
+  rclcpp_lifecycle::LifecyclePublisher<nav2_msgs::msg::CostmapUpdateStatistics>::SharedPtr
+    statistics_pub_;
 
   rclcpp::Subscription<geometry_msgs::msg::Polygon>::SharedPtr footprint_sub_;
   rclcpp::Subscription<rcl_interfaces::msg::ParameterEvent>::SharedPtr parameter_sub_;
@@ -268,35 +323,140 @@ protected:
   std::string name_;
   std::string parent_namespace_;
   void mapUpdateLoop(double frequency);
+  void publishSnapshot();
+
+  /**
+   * @brief Wake the map update loop for a layer with new data, see update_on_data_
+   */
+  void onUpdateRequest();
+
+  /**
+   * @brief Wake the map update loop idling in on_demand_ mode for a queued clear, which the
+   * clear services wait on
+   */
+  void onClearRequest();
+
+  /**
+   * @brief Wait for the next update of the map in update_on_data_ mode: at least
+   * min_update_interval_ after the last one, then until a layer has new data, the robot
+   * moved far enough from where it was last updated or a cycle at frequency is up
+   */
+  void waitForUpdateRequest(std::chrono::steady_clock::time_point last_update, double frequency);
+
+  /**
+   * @brief Idle at idle_update_frequency_ in on_demand_ mode, unless updates were demanded
+   * in the last demand_timeout_ seconds, until the keepalive is due, demandUpdates() is called
+   * or a clear is queued
+   * @return Whether it idled, the next update then being due right away
+   */
+  bool waitForDemand(std::chrono::steady_clock::time_point last_update);
+
+  /**
+   * @brief Whether the robot moved more than the update thresholds since the last update
+   */
+  bool robotMovedSinceUpdate();
+
+  /**
+   * @brief Save the master costmap and the grids of its layers to checkpoint_file_
+   */
+  void writeCheckpoint();
+
+  /**
+   * @brief Restore the costmaps saved to checkpoint_file_ by an earlier run, if any
+   *
+   * The costmap of a static window first takes the size and origin it had then, so the cells
+   * saved stay where they were once the same map comes in again.
+   */
+  void restoreCheckpoint();
+
+  /**
+   * @brief Record the update of the master costmap just made, if the recorder is enabled
+   */
+  void recordUpdate();
+
+  std::shared_ptr<Costmap2D> snapshot_;  ///< Latest snapshot, only accessed atomically
+  std::vector<std::shared_ptr<Costmap2D>> snapshot_pool_;  ///< Buffers recycled for snapshots
   bool map_update_thread_shutdown_{false};
   bool stop_updates_{false};
   bool initialized_{false};
   bool stopped_{true};
   std::thread * map_update_thread_{nullptr};  ///< @brief A thread for updating the map
   rclcpp::Time last_publish_{0, 0, RCL_ROS_TIME};
+  rclcpp::Time last_statistics_publish_{0, 0, RCL_ROS_TIME};
+  rclcpp::Time last_checkpoint_{0, 0, RCL_ROS_TIME};
+  unsigned int missed_cycles_{0};
+  std::mutex update_request_mutex_;
+  std::condition_variable update_request_cv_;
+  bool update_requested_{false};  ///< Guarded by update_request_mutex_
+  std::condition_variable update_done_cv_;  ///< Notified after each update, for demandUpdates()
+  // Also guarded by update_request_mutex_
+  std::chrono::steady_clock::time_point demand_until_;  ///< When the last demand runs out
+  bool demand_requested_{false};  ///< Whether demandUpdates() woke the idle loop
+  bool clear_requested_{false};   ///< Whether a queued clear woke the idle loop
+  bool idle_{false};              ///< Whether the loop is idling at the keepalive rate
+  uint64_t updates_completed_{0};
+
+  /// @brief The robot pose of an update, trivially copyable for the SeqLock
+  struct UpdatePose
+  {
+    int64_t stamp;  ///< In nanoseconds, 0 before the first update
+    double x, y, yaw;
+  };
+  nav2_util::SeqLock<UpdatePose> update_pose_;
+
+  // Reused by updateMap(), which publishes it when subscribed to or after a change
+  geometry_msgs::msg::PolygonStamped footprint_msg_;
+  std::atomic<bool> footprint_changed_{true};
+  rclcpp::Duration statistics_cycle_{1, 0};
   rclcpp::Duration publish_cycle_{1, 0};
+  rclcpp::Duration checkpoint_cycle_{1, 0};
   pluginlib::ClassLoader<Layer> plugin_loader_{"nav2_costmap_2d", "nav2_costmap_2d::Layer"};
 
   // Parameters
   void getParameters();
   bool always_send_full_costmap_{false};
+  std::string checkpoint_file_;    ///< Where the costmaps are saved for a restart, "" disables
+  double checkpoint_period_{0};    ///< Seconds between checkpoints
+  bool delta_publishing_{false};   ///< Publish only the changed region of the raw costmap
+  double demand_timeout_{5.0};     ///< Seconds updates run at full rate after a demand
+  double flight_recorder_duration_{0};  ///< Seconds of updates recorded, 0 disables
+  int flight_recorder_keyframe_interval_{50};  ///< Recorded updates between full costmaps
+  std::string flight_recorder_prefix_;  ///< Start of the name of the recordings saved
+  bool fine_costs_{false};         ///< Keep a 16 bit copy of the costmap too
   std::string footprint_;
   float footprint_padding_{0};
   std::string global_frame_;       ///< The global frame for the costmap
+  double idle_update_frequency_{0.2};  ///< Keepalive rate without demand, 0 for none
+  int keyframe_interval_{10};      ///< Publish cycles between full costmaps in delta mode
   int map_height_meters_{0};
   double map_publish_frequency_{0};
   double map_update_frequency_{0};
   int map_width_meters_{0};
+  double min_update_interval_{0};  ///< Seconds updates are at least apart in update_on_data_ mode
+  bool on_demand_{false};          ///< Update at full rate only while demanded, see demandUpdates()
   double origin_x_{0};
   double origin_y_{0};
   std::vector<std::string> plugin_names_;
   std::vector<std::string> plugin_types_;
+  int plugin_configure_threads_{1};  ///< Threads initializing the plugins, 0 uses one per core
+  std::vector<std::vector<std::size_t>> plugin_configure_after_;  ///< Plugins each follows
+  int pyramid_levels_{0};          ///< Max-pooled coarse levels kept of the costmap, 0 disables
+  uint8_t raw_costmap_encoding_{0};  ///< One of the nav2_msgs::msg::Costmap::ENCODING_* values
   double resolution_{0};
   std::string robot_base_frame_;   ///< The frame_id of the robot base
   double robot_radius_;
   bool rolling_window_{false};     ///< Whether to use a rolling window version of the costmap
+  double statistics_publish_frequency_{0};  ///< Rate of the update statistics, 0 disables them
+  int statistics_window_{100};     ///< Number of updates the statistics are over
   bool track_unknown_space_{false};
   double transform_tolerance_{0};  ///< The timeout before transform errors
+  int update_tile_size_{0};        ///< Side in cells of the tiles of a tiled update, 0 disables
+  int update_threads_{0};          ///< Threads of a tiled update, 0 uses one per core
+  bool update_on_data_{false};     ///< Update as data comes in, update_frequency as a fallback
+  double update_distance_threshold_{0};  ///< Robot motion in meters that triggers an update
+  double update_angle_threshold_{0};     ///< Robot rotation in radians that triggers an update
+  bool use_snapshots_{false};      ///< Whether to publish a snapshot after each update
+  nav2_util::RealtimeSettings update_thread_settings_;  ///< Scheduling of the map update thread
 
   // Derived parameters
   bool use_radius_{false};
@@ -304,6 +464,9 @@ protected:
   std::vector<geometry_msgs::msg::Point> padded_footprint_;
 
   std::unique_ptr<ClearCostmapService> clear_costmap_service_;
+
+  std::unique_ptr<CostmapRecorder> flight_recorder_;
+  rclcpp::Service<nav2_msgs::srv::SaveCostmapRecording>::SharedPtr save_recording_service_;
 };
 
 }  // namespace nav2_costmap_2d
@@ -0,0 +1,92 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_COSTMAP_2D__COSTMAP_CHECKPOINT_HPP_
+#define NAV2_COSTMAP_2D__COSTMAP_CHECKPOINT_HPP_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "nav2_costmap_2d/costmap_2d.hpp"
+
+namespace nav2_costmap_2d
+{
+
+/**
+ * @class CostmapCheckpoint
+ * @brief Named costmaps saved together to a file, such as a master costmap and its layers,
+ * for a restarted costmap to start from where the last one was. The costs are run length
+ * encoded, so mostly free or unknown grids take little room.
+ */
+class CostmapCheckpoint
+{
+public:
+  /// @brief A costmap as saved
+  struct Grid
+  {
+    std::string name;
+    unsigned int size_x, size_y;
+    double resolution, origin_x, origin_y;
+    std::vector<uint8_t> runs;  ///< The costs, as encodeRunLength() leaves them
+  };
+
+  /**
+   * @brief Add a costmap, whose lock the caller holds
+   */
+  void add(const std::string & name, const Costmap2D & costmap);
+
+  /** @brief The costmap saved under a name, or nullptr */
+  const Grid * find(const std::string & name) const;
+
+  const std::vector<Grid> & grids() const
+  {
+    return grids_;
+  }
+
+  void clear()
+  {
+    grids_.clear();
+  }
+
+  /**
+   * @brief Write the costmaps to a file, replacing it in one step so readers never see
+   * half of it
+   * @return False if the file can't be written
+   */
+  bool write(const std::string & filename) const;
+
+  /**
+   * @brief Replace the costmaps with those of a file written by write()
+   * @return False if the file can't be read or isn't a checkpoint, leaving the costmaps empty
+   */
+  bool read(const std::string & filename);
+
+  /**
+   * @brief Set the cells of a costmap to those saved under a name
+   *
+   * The costmap keeps its origin: the saved cells are moved to where they are in the world,
+   * to the nearest cell, and those it has beyond them get its default value. The caller holds
+   * the lock of the costmap.
+   * @return False if nothing is saved under the name, or with another size or resolution
+   */
+  bool restore(const std::string & name, Costmap2D & costmap) const;
+
+private:
+  std::vector<Grid> grids_;
+};
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__COSTMAP_CHECKPOINT_HPP_
@@ -0,0 +1,46 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_COSTMAP_2D__COSTMAP_ENCODING_HPP_
+#define NAV2_COSTMAP_2D__COSTMAP_ENCODING_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace nav2_costmap_2d
+{
+
+/**
+ * @brief Run length encode costs as in nav2_msgs::msg::Costmap::ENCODING_RLE
+ * @param costs The costs to encode
+ * @param size The number of costs
+ * @param encoded Will be filled with the runs
+ */
+void encodeRunLength(
+  const unsigned char * costs, std::size_t size, std::vector<uint8_t> & encoded);
+
+/**
+ * @brief Decode runs produced by encodeRunLength()
+ * @param encoded The runs to decode
+ * @param size The number of costs the runs must add up to
+ * @param costs Will be filled with size costs
+ * @return False if the runs are malformed or do not add up to size
+ */
+bool decodeRunLength(
+  const std::vector<uint8_t> & encoded, std::size_t size, unsigned char * costs);
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__COSTMAP_ENCODING_HPP_
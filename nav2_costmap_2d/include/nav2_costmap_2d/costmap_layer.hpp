@@ -62,6 +62,13 @@ public:
 
   virtual void clearArea(int start_x, int start_y, int end_x, int end_y);
 
+  /**
+   * Resets every cell outside of [x0, xn) x [y0, yn) to value, along with
+   * whatever the layer keeps behind those cells, and has the next update
+   * recompute the whole layer. The window may reach past the map.
+   */
+  virtual void resetOutside(int x0, int y0, int xn, int yn, unsigned char value);
+
   /**
    * If an external source changes values in the costmap,
    * it should call this method with the area that it changed
@@ -0,0 +1,94 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_COSTMAP_2D__COSTMAP_PYRAMID_HPP_
+#define NAV2_COSTMAP_2D__COSTMAP_PYRAMID_HPP_
+
+#include <memory>
+#include <vector>
+
+#include "nav2_costmap_2d/costmap_2d.hpp"
+
+namespace nav2_costmap_2d
+{
+
+/**
+ * @class CostmapPyramid
+ * @brief Coarser copies of a costmap, each half the resolution of the one
+ * before it. A cell of a level holds the highest cost of the four cells it
+ * covers in the level below, so a level never looks cheaper than the map it
+ * was built from, and unknown space stays unknown.
+ */
+class CostmapPyramid
+{
+public:
+  /**
+   * @brief Constructor for a pyramid
+   * @param num_levels Number of coarse levels, the first one has half the
+   *        resolution of the costmap it is built from
+   */
+  explicit CostmapPyramid(unsigned int num_levels);
+
+  /**
+   * @brief Bring the levels up to date with an area of a costmap that changed.
+   * Everything is rebuilt when the size, resolution or origin of the costmap
+   * changed since the last update.
+   * @param costmap The costmap the pyramid is built from
+   * @param x0 The first column of the area
+   * @param y0 The first row of the area
+   * @param xn One past the last column of the area
+   * @param yn One past the last row of the area
+   */
+  void update(const Costmap2D & costmap, int x0, int y0, int xn, int yn);
+
+  unsigned int getNumLevels() const {return static_cast<unsigned int>(levels_.size());}
+
+  /**
+   * @brief A coarse level, from 1 for half the resolution of the costmap, up to getNumLevels()
+   */
+  const Costmap2D & getLevel(unsigned int level) const {return *levels_[level - 1];}
+
+private:
+  // Recompute the cells of a level that cover an area of the level below
+  static void poolArea(
+    const Costmap2D & fine, Costmap2D & coarse, int x0, int y0, int xn, int yn);
+
+  std::vector<std::unique_ptr<Costmap2D>> levels_;
+  bool initialized_;
+  unsigned int size_x_, size_y_;
+  double resolution_, origin_x_, origin_y_;
+};
+
+/**
+ * @brief Copy an area of a costmap at a coarser resolution. A cell of the copy
+ * holds the highest cost of the factor by factor cells it covers, those past
+ * the edge of the area being left out.
+ * @param costmap The costmap to copy from
+ * @param x0 The first column of the area
+ * @param y0 The first row of the area
+ * @param xn One past the last column of the area
+ * @param yn One past the last row of the area
+ * @param factor The number of cells along each side pooled into one, at least 1
+ * @param costs Will be filled with the costs of the copy, in row-major order
+ * @param size_x Set to the number of columns of the copy
+ * @param size_y Set to the number of rows of the copy
+ */
+void poolRegion(
+  const Costmap2D & costmap, unsigned int x0, unsigned int y0, unsigned int xn,
+  unsigned int yn, unsigned int factor, std::vector<unsigned char> & costs,
+  unsigned int & size_x, unsigned int & size_y);
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__COSTMAP_PYRAMID_HPP_
@@ -0,0 +1,111 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_COSTMAP_2D__COSTMAP_RECORDER_HPP_
+#define NAV2_COSTMAP_2D__COSTMAP_RECORDER_HPP_
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "nav2_costmap_2d/costmap_2d.hpp"
+
+namespace nav2_costmap_2d
+{
+
+/**
+ * @class CostmapRecorder
+ * @brief Flight recorder of a costmap: keeps the changes of the last seconds in memory, to
+ * be saved when something goes wrong and replayed afterwards
+ *
+ * Each recorded update keeps only the change tiles of the costmap changed since the one
+ * before, run length encoded, with a whole keyframe every few updates and whenever the
+ * costmap is resized or moved. Frames older than the recorded duration are dropped a
+ * keyframe at a time, so the oldest one kept can always be rebuilt.
+ */
+class CostmapRecorder
+{
+public:
+  /// @brief An update of the costmap as recorded
+  struct Frame
+  {
+    int64_t stamp;  ///< In nanoseconds
+    bool keyframe;
+    unsigned int size_x, size_y;
+    double resolution, origin_x, origin_y;
+    unsigned int tile_size;
+    std::vector<uint32_t> tiles;  ///< The change tiles of a delta, empty for a keyframe
+    std::vector<uint8_t> runs;  ///< The costs of the tiles one after the other, or the map
+  };
+
+  /**
+   * @param duration Seconds of updates to keep
+   * @param keyframe_interval Updates between keyframes
+   */
+  CostmapRecorder(double duration, unsigned int keyframe_interval);
+
+  /**
+   * @brief Record the changes to a costmap since the last call, whose lock the caller holds
+   * @param stamp The time of the update, in nanoseconds
+   */
+  void record(const Costmap2D & costmap, int64_t stamp);
+
+  /** @brief Get a copy of the frames kept, oldest first */
+  std::vector<Frame> frames() const;
+
+  /** @brief The memory taken by the encoded costs of the frames kept */
+  std::size_t bytes() const;
+
+  /**
+   * @brief Write the frames kept to a file, replacing it in one step
+   * @return False if the file can't be written
+   */
+  bool write(const std::string & filename) const;
+
+  /**
+   * @brief Read the frames of a file written by write()
+   * @return False if the file can't be read or isn't a recording
+   */
+  static bool read(const std::string & filename, std::vector<Frame> & frames);
+
+  /**
+   * @brief Apply a frame to a costmap rebuilt from the frames before it, starting from a
+   * keyframe, which resizes the costmap to its own size and origin
+   * @return False for a delta that doesn't fit the costmap or malformed costs
+   */
+  static bool apply(const Frame & frame, Costmap2D & costmap);
+
+private:
+  /** @brief Drop the frames no longer needed to rebuild the last duration */
+  void trim();
+
+  const int64_t duration_;
+  const unsigned int keyframe_interval_;
+
+  mutable std::mutex mutex_;
+  std::deque<Frame> frames_;  ///< Under mutex_, starting with a keyframe
+  std::size_t bytes_{0};      ///< Under mutex_
+
+  // only used by record()
+  uint64_t change_count_{0};
+  unsigned int updates_since_keyframe_{0};
+  std::vector<unsigned int> tiles_;
+  std::vector<unsigned char> costs_;
+};
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__COSTMAP_RECORDER_HPP_
@@ -0,0 +1,61 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_COSTMAP_2D__COSTMAP_SNAPSHOT_REGISTRY_HPP_
+#define NAV2_COSTMAP_2D__COSTMAP_SNAPSHOT_REGISTRY_HPP_
+
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "nav2_costmap_2d/costmap_2d.hpp"
+
+namespace nav2_costmap_2d
+{
+
+/**
+ * @class CostmapSnapshotRegistry
+ * @brief Process wide table of costmap producers, keyed by their raw costmap topic
+ *
+ * A Costmap2DROS producing snapshots registers itself here, so that consumers in
+ * the same process can read its snapshots directly instead of converting the
+ * messages it publishes.
+ */
+class CostmapSnapshotRegistry
+{
+public:
+  typedef std::function<std::shared_ptr<const Costmap2D>()> Source;
+
+  /** @brief Register the snapshot source of a fully qualified topic */
+  static void add(const std::string & topic, Source source);
+
+  /** @brief Remove the snapshot source of a fully qualified topic */
+  static void remove(const std::string & topic);
+
+  /**
+   * @brief Get the latest snapshot of a fully qualified topic
+   * @return nullptr if nobody in this process produces the topic or has produced
+   * a snapshot yet
+   */
+  static std::shared_ptr<const Costmap2D> get(const std::string & topic);
+
+  /**
+   * @brief Qualify a topic name with a node namespace, remappings are not applied
+   */
+  static std::string qualify(const std::string & node_namespace, const std::string & topic);
+};
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__COSTMAP_SNAPSHOT_REGISTRY_HPP_
@@ -17,10 +17,13 @@
 
 #include <string>
 #include <memory>
+#include <mutex>
+#include <vector>
 
 #include "rclcpp/rclcpp.hpp"
 #include "nav2_costmap_2d/costmap_2d.hpp"
 #include "nav2_msgs/msg/costmap.hpp"
+#include "nav2_msgs/msg/costmap_update.hpp"
 #include "nav2_util/lifecycle_node.hpp"
 
 namespace nav2_costmap_2d
@@ -45,8 +48,23 @@ public:
 
   ~CostmapSubscriber() {}
 
+  /**
+   * @brief Get the last received costmap
+   *
+   * The costmap is only converted again when a newer message was received, so it
+   * must not be modified by the caller.
+   */
   std::shared_ptr<Costmap2D> getCostmap();
 
+  /**
+   * @brief Get a read only view of the latest costmap
+   *
+   * If the producer of the topic runs in this process and publishes snapshots,
+   * its latest snapshot is returned without any copy. Otherwise this is the same
+   * as getCostmap().
+   */
+  std::shared_ptr<const Costmap2D> getCostmapView();
+
 protected:
   // Interfaces used for logging and creating publishers and subscribers
   rclcpp::node_interfaces::NodeBaseInterface::SharedPtr node_base_;
@@ -55,12 +73,23 @@ protected:
 
   void toCostmap2D();
   void costmapCallback(const nav2_msgs::msg::Costmap::SharedPtr msg);
+  void costmapUpdateCallback(const nav2_msgs::msg::CostmapUpdate::SharedPtr msg);
+  // Patch costmap_msg_ with an update if it is the next one for it, with the lock held
+  void applyUpdate(const nav2_msgs::msg::CostmapUpdate & msg);
 
   std::shared_ptr<Costmap2D> costmap_;
   nav2_msgs::msg::Costmap::SharedPtr costmap_msg_;
+  nav2_msgs::msg::Costmap::SharedPtr converted_msg_;  ///< Message costmap_ holds
+  bool costmap_msg_patched_{false};  ///< Whether updates were applied since conversion
+  uint32_t update_sequence_{0};  ///< Sequence of the last update applied to costmap_msg_
+  /// Updates to a newer costmap than costmap_msg_, received before it
+  std::vector<nav2_msgs::msg::CostmapUpdate::SharedPtr> early_updates_;
   std::string topic_name_;
+  std::string qualified_topic_name_;
   bool costmap_received_{false};
+  std::mutex costmap_msg_mutex_;
   rclcpp::Subscription<nav2_msgs::msg::Costmap>::SharedPtr costmap_sub_;
+  rclcpp::Subscription<nav2_msgs::msg::CostmapUpdate>::SharedPtr costmap_update_sub_;
 };
 
 }  // namespace nav2_costmap_2d
@@ -0,0 +1,105 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_COSTMAP_2D__DECAYING_OBSTACLE_LAYER_HPP_
+#define NAV2_COSTMAP_2D__DECAYING_OBSTACLE_LAYER_HPP_
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "nav2_costmap_2d/obstacle_layer.hpp"
+
+namespace nav2_costmap_2d
+{
+
+/**
+ * @class DecayingObstacleLayer
+ * @brief An obstacle layer that clears by time instead of by raytracing. Every marked cell
+ * keeps when it was last seen and is cleared once it hasn't been for decay_time, so an update
+ * costs in the points observed and the cells marked rather than in the cells crossed by rays.
+ *
+ * With frustum_clearing set, the clearing observations also give the view of each sensor: the
+ * farthest point it saw at every bearing from its origin. Marked cells in front of that,
+ * which the sensor would have seen were they still occupied, are cleared after the shorter
+ * frustum_decay_time. Cells hidden behind closer points keep the full decay_time.
+ */
+class DecayingObstacleLayer : public ObstacleLayer
+{
+public:
+  DecayingObstacleLayer()
+  {
+    costmap_ = NULL;  // this is the unsigned char* member of parent class's parent class Costmap2D
+  }
+
+  virtual void onInitialize();
+  virtual void updateBounds(
+    double robot_x, double robot_y, double robot_yaw, double * min_x,
+    double * min_y,
+    double * max_x,
+    double * max_y);
+  virtual void reset();
+  virtual void matchSize();
+  void updateOrigin(double new_origin_x, double new_origin_y);
+
+protected:
+  /// @brief A marked cell, in cells from where the grid was when sized, to survive its moves
+  struct Mark
+  {
+    int64_t x, y;
+    double last_seen;
+  };
+
+  /// @brief The farthest distance seen by a clearing observation around its origin
+  struct View
+  {
+    double ox, oy;
+    std::vector<double> ranges;  ///< @brief Per bearing bin, 0 where nothing was seen
+  };
+
+  /**
+   * @brief  Refresh the cells hit by the points of a marking observation
+   */
+  void markObservation(
+    const nav2_costmap_2d::Observation & obs, double now,
+    double * min_x, double * min_y, double * max_x, double * max_y);
+
+  /**
+   * @brief  Build the view of a clearing observation
+   */
+  void buildView(const nav2_costmap_2d::Observation & obs, View & view) const;
+
+  /**
+   * @return True if a sensor should have seen the cell at (wx, wy) in one of the views
+   */
+  bool isVisible(double wx, double wy) const;
+
+  static uint64_t key(int64_t x, int64_t y)
+  {
+    return (static_cast<uint64_t>(x & 0xffffffff) << 32) | static_cast<uint64_t>(y & 0xffffffff);
+  }
+
+  double decay_time_;
+  bool frustum_clearing_;
+  double frustum_decay_time_;
+
+  /// @brief The cells the grid moved by since it was sized
+  int64_t cell_origin_x_{0}, cell_origin_y_{0};
+  std::unordered_map<uint64_t, Mark> marks_;
+  std::vector<View> views_;
+};
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__DECAYING_OBSTACLE_LAYER_HPP_
@@ -0,0 +1,94 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_COSTMAP_2D__DISTANCE_FIELD_HPP_
+#define NAV2_COSTMAP_2D__DISTANCE_FIELD_HPP_
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "nav2_costmap_2d/costmap_2d.hpp"
+#include "nav2_util/thread_pool.hpp"
+
+namespace nav2_costmap_2d
+{
+
+/**
+ * @class DistanceField
+ * @brief The exact Euclidean distance from every cell of a costmap to the
+ * nearest lethal cell, computed with the separable transform of Felzenszwalb
+ * and Huttenlocher: a pass along the columns followed by one along the rows,
+ * each split across a pool of threads.
+ */
+class DistanceField
+{
+public:
+  /**
+   * @brief Constructor for a distance field
+   * @param num_threads Threads the passes are split across, 0 uses one per core
+   */
+  explicit DistanceField(unsigned int num_threads = 1);
+
+  /**
+   * @brief Recompute the field from the lethal cells of a costmap, resizing it to match
+   */
+  void update(const Costmap2D & costmap);
+
+  /**
+   * @brief Distance in meters from the center of a cell to the center of the
+   * nearest lethal cell, infinity when there is none
+   */
+  inline double getDistance(unsigned int mx, unsigned int my) const
+  {
+    uint32_t squared = squared_distances_[my * size_x_ + mx];
+    if (squared == NO_OBSTACLE) {
+      return std::numeric_limits<double>::infinity();
+    }
+    return std::sqrt(static_cast<double>(squared)) * resolution_;
+  }
+
+  /**
+   * @brief Squared distance in cells to the nearest lethal cell, NO_OBSTACLE when there is none
+   */
+  inline uint32_t getSquaredCellDistance(unsigned int mx, unsigned int my) const
+  {
+    return squared_distances_[my * size_x_ + mx];
+  }
+
+  unsigned int getSizeInCellsX() const {return size_x_;}
+  unsigned int getSizeInCellsY() const {return size_y_;}
+  double getResolution() const {return resolution_;}
+
+  static constexpr uint32_t NO_OBSTACLE = std::numeric_limits<uint32_t>::max();
+
+protected:
+  /**
+   * @brief One dimensional squared distance transform of the n samples of f
+   * that are stride apart, written over them in place
+   */
+  static void transform(uint32_t * f, unsigned int n, unsigned int stride);
+
+  unsigned int size_x_;
+  unsigned int size_y_;
+  double resolution_;
+  std::vector<uint32_t> squared_distances_;
+  std::unique_ptr<nav2_util::ThreadPool> pool_;
+};
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__DISTANCE_FIELD_HPP_
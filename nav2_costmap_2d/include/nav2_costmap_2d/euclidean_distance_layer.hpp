@@ -0,0 +1,66 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_COSTMAP_2D__EUCLIDEAN_DISTANCE_LAYER_HPP_
+#define NAV2_COSTMAP_2D__EUCLIDEAN_DISTANCE_LAYER_HPP_
+
+#include <memory>
+
+#include "rclcpp/rclcpp.hpp"
+#include "nav2_costmap_2d/distance_field.hpp"
+#include "nav2_costmap_2d/layer.hpp"
+#include "nav2_costmap_2d/layered_costmap.hpp"
+
+namespace nav2_costmap_2d
+{
+
+/**
+ * @class EuclideanDistanceLayer
+ * @brief Keeps the exact distance from every cell of the master grid to the
+ * nearest lethal cell, available through LayeredCostmap::getDistanceField()
+ * and LayeredCostmap::getObstacleDistance(). It doesn't change any costs.
+ *
+ * The field is recomputed by the LayeredCostmap once all the layers are
+ * combined, so it doesn't matter where in the list of plugins this one is.
+ */
+class EuclideanDistanceLayer : public Layer
+{
+public:
+  EuclideanDistanceLayer();
+  virtual ~EuclideanDistanceLayer();
+
+  virtual void onInitialize();
+  virtual void activate();
+  virtual void deactivate();
+  virtual void reset() {}
+
+  virtual void updateBounds(
+    double robot_x, double robot_y, double robot_yaw, double * min_x,
+    double * min_y, double * max_x, double * max_y);
+  virtual void updateCosts(
+    nav2_costmap_2d::Costmap2D & master_grid,
+    int min_i, int min_j, int max_i, int max_j);
+
+  std::shared_ptr<const DistanceField> getDistanceField() const
+  {
+    return distance_field_;
+  }
+
+private:
+  std::shared_ptr<DistanceField> distance_field_;
+};
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__EUCLIDEAN_DISTANCE_LAYER_HPP_
@@ -0,0 +1,102 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_COSTMAP_2D__FINE_COSTMAP_HPP_
+#define NAV2_COSTMAP_2D__FINE_COSTMAP_HPP_
+
+#include <cstdint>
+#include <vector>
+
+#include "nav2_costmap_2d/costmap_2d.hpp"
+#include "nav2_costmap_2d/distance_field.hpp"
+
+namespace nav2_costmap_2d
+{
+
+/**
+ * @class FineCostmap
+ * @brief A 16 bit copy of a costmap, for consumers that want smoother cost
+ * gradients than the 8 bit grid quantizes the inflation decay into.
+ *
+ * Every 8 bit cost c is scaled to c * FINE_COST_SCALE, so the special values
+ * keep their meaning and toCost() gives the 8 bit cost back. Cells within the
+ * inflation radius of a lethal cell get the inflation decay evaluated exactly
+ * from the distance field instead, wherever that is higher.
+ */
+class FineCostmap
+{
+public:
+  static constexpr uint16_t FINE_COST_SCALE = 257;
+
+  /** @brief The 16 bit cost an 8 bit cost is scaled to */
+  static inline uint16_t toFineCost(unsigned char cost)
+  {
+    return static_cast<uint16_t>(cost * FINE_COST_SCALE);
+  }
+
+  /** @brief The 8 bit cost of a 16 bit cost, as the 8 bit grid quantizes it */
+  static inline unsigned char toCost(uint16_t fine_cost)
+  {
+    return static_cast<unsigned char>(fine_cost / FINE_COST_SCALE);
+  }
+
+  FineCostmap();
+
+  /**
+   * @brief Set the decay of the inflation layer, see InflationLayer::computeCost()
+   * @param inscribed_radius The inscribed radius of the footprint, in meters
+   * @param cost_scaling_factor The exponential rate the cost falls off at
+   * @param inflation_radius How far from lethal cells costs are inflated, in meters,
+   *        0 leaves the scaled 8 bit costs alone
+   */
+  void setInflation(double inscribed_radius, double cost_scaling_factor, double inflation_radius);
+
+  /**
+   * @brief Bring an area up to date with a costmap. Everything is recomputed when
+   * the size, resolution or origin of the costmap, or the inflation, changed since
+   * the last update.
+   * @param costmap The costmap to copy
+   * @param distances The distances to the lethal cells of the costmap, or null to
+   *        only scale the 8 bit costs
+   * @param x0 The first column of the area
+   * @param y0 The first row of the area
+   * @param xn One past the last column of the area
+   * @param yn One past the last row of the area
+   */
+  void update(
+    const Costmap2D & costmap, const DistanceField * distances,
+    int x0, int y0, int xn, int yn);
+
+  inline uint16_t getCost(unsigned int mx, unsigned int my) const
+  {
+    return costs_[my * size_x_ + mx];
+  }
+
+  /** @brief The costs, row-major like Costmap2D::getCharMap() */
+  const uint16_t * getCosts() const {return costs_.data();}
+
+  unsigned int getSizeInCellsX() const {return size_x_;}
+  unsigned int getSizeInCellsY() const {return size_y_;}
+
+private:
+  bool dirty_;
+  unsigned int size_x_, size_y_;
+  double resolution_, origin_x_, origin_y_;
+  double inscribed_radius_, cost_scaling_factor_, inflation_radius_;
+  std::vector<uint16_t> costs_;
+};
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__FINE_COSTMAP_HPP_
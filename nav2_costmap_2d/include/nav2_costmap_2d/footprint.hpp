@@ -38,6 +38,7 @@
 #ifndef NAV2_COSTMAP_2D__FOOTPRINT_HPP_
 #define NAV2_COSTMAP_2D__FOOTPRINT_HPP_
 
+#include <list>
 #include <string>
 #include <vector>
 
@@ -46,6 +47,9 @@
 #include "geometry_msgs/msg/polygon_stamped.hpp"
 #include "geometry_msgs/msg/point.hpp"
 #include "geometry_msgs/msg/point32.hpp"
+#include "geometry_msgs/msg/pose2_d.hpp"
+#include "nav2_costmap_2d/costmap_2d.hpp"
+#include "nav2_costmap_2d/cost_values.hpp"
 #include "nav2_util/lifecycle_node.hpp"
 
 namespace nav2_costmap_2d
@@ -129,6 +133,128 @@ bool makeFootprintFromString(
   const std::string & footprint_string,
   std::vector<geometry_msgs::msg::Point> & footprint);
 
+/**
+ * @class FootprintMask
+ * @brief The cells under the outline of a footprint, rasterized once for a
+ * number of evenly spaced headings. Checking a pose then only walks rows of
+ * cells offset from the cell the pose is in, instead of transforming and
+ * rasterizing the polygon again.
+ *
+ * The pose is snapped to the center of its cell and to the nearest heading,
+ * so the outline can be off by a cell from the one found by rasterizing the
+ * oriented footprint directly.
+ */
+class FootprintMask
+{
+public:
+  /**
+   * @brief Constructor for the mask
+   * @param num_headings Number of headings the outline is rasterized for
+   */
+  explicit FootprintMask(unsigned int num_headings = 72, unsigned int cached_footprints = 4);
+
+  /**
+   * @brief Rasterize the footprint if it, or the resolution, changed since the last call
+   *
+   * The last few footprints rasterized are kept, so switching back to one of them, as a
+   * robot does between a few configurations, costs no more than a lookup.
+   *
+   * @param footprint_spec Basic shape of the footprint
+   * @param resolution Resolution of the costmaps checked against
+   */
+  void setFootprint(
+    const std::vector<geometry_msgs::msg::Point> & footprint_spec,
+    double resolution);
+
+  bool empty() const {return headings_.empty();}
+
+  unsigned int getNumHeadings() const {return num_headings_;}
+
+  /**
+   * @brief Highest cost under the outline of the footprint at a pose
+   * @param costmap The costmap to check, at the resolution the mask was built for
+   * @param x The x position of the robot
+   * @param y The y position of the robot
+   * @param theta The orientation of the robot
+   * @return The highest cost, or -1.0 if part of the footprint is off the grid
+   */
+  double footprintCostAtPose(const Costmap2D & costmap, double x, double y, double theta) const;
+
+  /**
+   * @brief Highest cost under the outlines of the footprint at every pose of a trajectory
+   *
+   * Poses that fall in the same cell at the same heading as the one before them lay down the
+   * same outline, so it is only checked once.
+   *
+   * @param costmap The costmap to check, at the resolution the mask was built for
+   * @param poses The poses of the robot
+   * @param stop_cost Stop at the first row of cells with a cost at least this high, and
+   * return that cost, when only whether the trajectory is legal matters
+   * @return The highest cost, or -1.0 if part of a footprint is off the grid
+   */
+  double trajectoryFootprintCost(
+    const Costmap2D & costmap,
+    const std::vector<geometry_msgs::msg::Pose2D> & poses,
+    unsigned char stop_cost = NO_INFORMATION) const;
+
+  /**
+   * @brief Highest cost under the outline of the footprint as it turns in place
+   *
+   * The cells swept are those of the annulus sector the outline turns through, found from
+   * the footprint in polar coordinates, so the whole turn is checked at once rather than
+   * heading by heading. The sector is padded by a cell and a half, so the cost is at least
+   * that of the outline at any heading of the turn, and is only higher near obstacles.
+   * Cells no costlier than the highest found so far are skipped unexamined, which makes the
+   * check in free space little more than a read of the cells.
+   *
+   * @param costmap The costmap to check, at the resolution the mask was built for
+   * @param x The x position of the robot
+   * @param y The y position of the robot
+   * @param theta The orientation of the robot at the start of the turn
+   * @param angle The angle turned, positive counterclockwise, a whole turn at most
+   * @param stop_cost Stop at the first cell with a cost at least this high, and return it
+   * @return The highest cost, or -1.0 if part of the sector is off the grid
+   */
+  double sweptFootprintCost(
+    const Costmap2D & costmap, double x, double y, double theta, double angle,
+    unsigned char stop_cost = NO_INFORMATION) const;
+
+private:
+  // a run of cells [dx0, dx1] in row dy, relative to the cell of the pose
+  struct Span
+  {
+    int dy, dx0, dx1;
+  };
+
+  struct Heading
+  {
+    std::vector<Span> spans;
+    int min_dx, max_dx, min_dy, max_dy;
+  };
+
+  // the headings of a footprint rasterized before
+  struct Rasterization
+  {
+    std::vector<geometry_msgs::msg::Point> footprint_spec;
+    double resolution;
+    std::vector<Heading> headings;
+  };
+
+  /**
+   * @brief The heading of the mask for a pose, and its cell, if the whole footprint is on the grid
+   */
+  const Heading * headingAtPose(
+    const Costmap2D & costmap, double x, double y, double theta, int & mx, int & my) const;
+
+  unsigned int num_headings_;
+  std::vector<geometry_msgs::msg::Point> footprint_spec_;
+  double resolution_;
+  std::vector<Heading> headings_;
+  // most recently used first
+  unsigned int cached_footprints_;
+  std::list<Rasterization> rasterizations_;
+};
+
 }  // end namespace nav2_costmap_2d
 
 #endif  // NAV2_COSTMAP_2D__FOOTPRINT_HPP_
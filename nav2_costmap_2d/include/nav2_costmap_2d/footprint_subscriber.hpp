@@ -60,6 +60,10 @@ public:
     std::vector<geometry_msgs::msg::Point> & footprint,
     rclcpp::Time & stamp, rclcpp::Duration valid_footprint_timeout);
 
+  // Returns the latest footprint message, if it is within the footprint timeout.
+  // The message is shared, not copied, so users can tell a new footprint by its pointer.
+  bool getFootprintMsg(geometry_msgs::msg::PolygonStamped::ConstSharedPtr & footprint);
+
 protected:
   // Interfaces used for logging and creating publishers and subscribers
   rclcpp::node_interfaces::NodeBaseInterface::SharedPtr node_base_;
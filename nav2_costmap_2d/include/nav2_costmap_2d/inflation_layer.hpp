@@ -38,12 +38,19 @@
 #ifndef NAV2_COSTMAP_2D__INFLATION_LAYER_HPP_
 #define NAV2_COSTMAP_2D__INFLATION_LAYER_HPP_
 
+#include <algorithm>
+#include <limits>
+#include <list>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <string>
 #include <vector>
 
 #include "rclcpp/rclcpp.hpp"
 #include "nav2_costmap_2d/layer.hpp"
 #include "nav2_costmap_2d/layered_costmap.hpp"
+#include "nav2_util/thread_pool.hpp"
 
 namespace nav2_costmap_2d
 {
@@ -75,11 +82,12 @@ public:
 class InflationLayer : public Layer
 {
 public:
+  enum class InflationEngine {Map, Bucket, Incremental};
+
   InflationLayer();
 
   virtual ~InflationLayer()
   {
-    deleteKernels();
   }
 
   virtual void onInitialize();
@@ -95,6 +103,28 @@ public:
   {
     return true;
   }
+
+  // The incremental engine keeps state across the whole grid, which tiles cannot share
+  virtual bool supportsTiling()
+  {
+    return enabled_ && cell_inflation_radius_ != 0 && engine_ != InflationEngine::Incremental;
+  }
+
+  /**
+   * @brief Snapshot the lethal cells of the bounds plus a halo of the inflation
+   *        radius, so tiles can seed from their neighbours while those are written
+   */
+  virtual void prepareTiledUpdate(
+    nav2_costmap_2d::Costmap2D & master_grid,
+    int min_i, int min_j, int max_i, int max_j);
+
+  /**
+   * @brief Inflate the obstacles within the inflation radius of a tile,
+   *        only writing cells inside the tile
+   */
+  virtual void updateCostsTile(
+    nav2_costmap_2d::Costmap2D & master_grid,
+    int min_i, int min_j, int max_i, int max_j);
   virtual void matchSize();
 
   virtual void reset()
@@ -126,39 +156,136 @@ protected:
 
 private:
   /**
-   * @brief  Lookup pre-computed distances
+   * @brief  The entry of the flat kernels for the offset of a cell from its source
    * @param mx The x coordinate of the current cell
    * @param my The y coordinate of the current cell
    * @param src_x The x coordinate of the source cell
    * @param src_y The y coordinate of the source cell
-   * @return
+   * @return Index into kernel_costs_ and cached_buckets_
    */
-  inline double distanceLookup(int mx, int my, int src_x, int src_y)
+  inline unsigned int kernelIndex(int mx, int my, int src_x, int src_y) const
   {
     unsigned int dx = abs(mx - src_x);
     unsigned int dy = abs(my - src_y);
-    return cached_distances_[dx][dy];
+    return dx * (cached_cell_inflation_radius_ + 2) + dy;
+  }
+
+  /**
+   * @brief  The squared distance in cells of a cell from its source, which orders cells
+   * exactly as their distance does
+   */
+  static inline unsigned int sqDistance(int mx, int my, int src_x, int src_y)
+  {
+    return (mx - src_x) * (mx - src_x) + (my - src_y) * (my - src_y);
   }
 
   /**
    * @brief  Lookup pre-computed costs
-   * @param mx The x coordinate of the current cell
-   * @param my The y coordinate of the current cell
-   * @param src_x The x coordinate of the source cell
-   * @param src_y The y coordinate of the source cell
-   * @return
    */
-  inline unsigned char costLookup(int mx, int my, int src_x, int src_y)
+  inline unsigned char costLookup(int mx, int my, int src_x, int src_y) const
   {
-    unsigned int dx = abs(mx - src_x);
-    unsigned int dy = abs(my - src_y);
-    return cached_costs_[dx][dy];
+    return kernel_costs_[kernelIndex(mx, my, src_x, src_y)];
+  }
+
+  /**
+   * @brief  Lookup the distance bucket of a pre-computed distance
+   * @return Index into inflation_buckets_, ordered by increasing distance, or OUT_OF_RADIUS
+   * for a cell beyond the inflation radius of the source
+   */
+  inline unsigned int bucketLookup(int mx, int my, int src_x, int src_y) const
+  {
+    return cached_buckets_[kernelIndex(mx, my, src_x, src_y)];
   }
 
   void computeCaches();
-  void deleteKernels();
+  void computeBuckets();
+
+  /**
+   * @brief  Store the changes to this layer's parameters, for the update thread to apply
+   */
+  void on_parameter_event_callback(const rcl_interfaces::msg::ParameterEvent::SharedPtr event);
+
+  /**
+   * @brief  Apply the parameters changed since the last update, recomputing only the
+   *         kernel if the radius or the scaling changed, and reinflating the whole map
+   */
+  void applyParameterChanges();
+
   void inflate_area(int min_i, int min_j, int max_i, int max_j, unsigned char * master_grid);
 
+  /**
+   * @brief  Inflate the given bounds using the distance-keyed map of cell lists
+   */
+  void inflateWithPriorityMap(
+    unsigned char * master_array, unsigned int size_x, unsigned int size_y,
+    int min_i, int min_j, int max_i, int max_j);
+
+  /**
+   * @brief  Inflate the given bounds using the fixed array of distance buckets
+   */
+  void inflateWithBuckets(
+    unsigned char * master_array, unsigned int size_x, unsigned int size_y,
+    int min_i, int min_j, int max_i, int max_j);
+
+  /**
+   * @brief  Offer the four neighbours of a cell to the buckets, checking that they are on
+   * the grid only if CheckBounds, for cells on its border
+   */
+  template<bool CheckBounds>
+  inline void enqueueNeighbours(
+    unsigned int index, unsigned int mx, unsigned int my,
+    unsigned int src_x, unsigned int src_y, unsigned int size_x, unsigned int size_y)
+  {
+    if (!CheckBounds || mx > 0) {
+      enqueueBucket(index - 1, mx - 1, my, src_x, src_y);
+    }
+    if (!CheckBounds || my > 0) {
+      enqueueBucket(index - size_x, mx, my - 1, src_x, src_y);
+    }
+    if (!CheckBounds || mx < size_x - 1) {
+      enqueueBucket(index + 1, mx + 1, my, src_x, src_y);
+    }
+    if (!CheckBounds || my < size_y - 1) {
+      enqueueBucket(index + size_x, mx, my + 1, src_x, src_y);
+    }
+  }
+
+  /**
+   * @brief  Inflate the given bounds in horizontal stripes on inflation_pool_, each
+   *         seeded from a halo of the inflation radius and only writing its own rows
+   */
+  void inflateInStripes(
+    nav2_costmap_2d::Costmap2D & master_grid,
+    int min_i, int min_j, int max_i, int max_j);
+
+  /**
+   * @brief  Update the inflation of the given bounds from the persistent
+   *         nearest-obstacle field, only searching again around obstacle changes
+   */
+  void inflateIncrementally(
+    nav2_costmap_2d::Costmap2D & master_grid,
+    int min_i, int min_j, int max_i, int max_j);
+
+  /**
+   * @brief  Write an inflated cost into the master grid, respecting inflate_unknown_
+   */
+  inline void applyCost(unsigned char * master_array, unsigned int index, unsigned char cost)
+  {
+    unsigned char old_cost = master_array[index];
+    if (old_cost == NO_INFORMATION &&
+      (inflate_unknown_ ? (cost > FREE_SPACE) : (cost >= INSCRIBED_INFLATED_OBSTACLE)))
+    {
+      master_array[index] = cost;
+    } else {
+      master_array[index] = std::max(old_cost, cost);
+    }
+  }
+
+  /**
+   * @brief  Resize the visited-cell bookkeeping used by the selected engine
+   */
+  void resetSeen(unsigned int size);
+
   unsigned int cellDistance(double world_dist)
   {
     return layered_costmap_->getCostmap()->cellDistance(world_dist);
@@ -168,22 +295,83 @@ private:
     unsigned int index, unsigned int mx, unsigned int my,
     unsigned int src_x, unsigned int src_y);
 
+  inline void enqueueBucket(
+    unsigned int index, unsigned int mx, unsigned int my,
+    unsigned int src_x, unsigned int src_y);
+
   double inflation_radius_, inscribed_radius_, cost_scaling_factor_;
   bool inflate_unknown_;
   unsigned int cell_inflation_radius_;
   unsigned int cached_cell_inflation_radius_;
-  std::map<double, std::vector<CellData>> inflation_cells_;
+  std::map<unsigned int, std::vector<CellData>> inflation_cells_;  ///< Keyed by sqDistance()
+
+  // Inflation engine: "bucket" (default), "map" (original distance-keyed map)
+  // or "incremental" (persistent nearest-obstacle field)
+  std::string inflation_engine_;
+  InflationEngine engine_;
+
+  // Threads of the stripes inflateInStripes() runs, null for a single thread
+  std::unique_ptr<nav2_util::ThreadPool> inflation_pool_;
 
   double resolution_;
 
   std::vector<bool> seen_;
 
-  unsigned char ** cached_costs_;
-  double ** cached_distances_;
+  // Generation-stamped visited array used by the bucket engine; a cell is
+  // visited in the current cycle iff seen_generation_[index] == generation_
+  std::vector<unsigned int> seen_generation_;
+  unsigned int generation_;
+
+  // One cell list per distinct cell distance within the inflation radius,
+  // ordered by increasing distance
+  std::vector<std::vector<CellData>> inflation_buckets_;
+
+  // State kept between cycles by the incremental engine: the index of the
+  // nearest obstacle of each cell (or NO_SOURCE), and which cells were lethal
+  static constexpr unsigned int NO_SOURCE = std::numeric_limits<unsigned int>::max();
+  std::vector<unsigned int> nearest_source_;
+  std::vector<unsigned char> obstacle_cells_;
+  bool incremental_valid_;
+  double last_origin_x_, last_origin_y_;
+
+  // Lethal cells of the expanded bounds of a tiled update, read by every tile
+  std::vector<unsigned char> tile_seeds_;
+  int tile_seed_min_i_, tile_seed_min_j_, tile_seed_max_i_, tile_seed_max_j_;
+
+  // The costs of the current kernel, row-major with stride cached_cell_inflation_radius_ + 2
+  const unsigned char * kernel_costs_;
+
+  // The costs of a kernel depend only on these, so the kernels of the few footprints
+  // a robot switches between are kept rather than recomputed, most recently used first
+  struct CostKernel
+  {
+    double inscribed_radius, cost_scaling_factor, resolution;
+    unsigned int cell_inflation_radius;
+    std::vector<unsigned char> costs;  // row-major, stride cell_inflation_radius + 2
+  };
+  static constexpr std::size_t MAX_COST_KERNELS = 4;
+  std::list<CostKernel> cost_kernels_;
+
+  // Bucket index per (dx, dy), stored row-major with stride cached_cell_inflation_radius_ + 2
+  static constexpr unsigned int OUT_OF_RADIUS = std::numeric_limits<unsigned int>::max();
+  std::vector<unsigned int> cached_buckets_;
   double last_min_x_, last_min_y_, last_max_x_, last_max_y_;
 
   // Indicates that the entire costmap should be reinflated next time around.
   bool need_reinflation_;
+
+  // The parameters that can change at runtime, as last set, and whether they changed
+  // since the update thread applied them
+  struct Parameters
+  {
+    bool enabled, inflate_unknown;
+    double inflation_radius, cost_scaling_factor;
+  };
+  std::mutex parameters_mutex_;
+  Parameters parameters_;
+  bool parameters_changed_;
+  rclcpp::AsyncParametersClient::SharedPtr parameters_client_;
+  rclcpp::Subscription<rcl_interfaces::msg::ParameterEvent>::SharedPtr parameter_event_sub_;
 };
 
 }  // namespace nav2_costmap_2d
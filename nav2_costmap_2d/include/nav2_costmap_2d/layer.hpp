@@ -91,6 +91,44 @@ public:
     Costmap2D & master_grid,
     int min_i, int min_j, int max_i, int max_j) = 0;
 
+  /**
+   * @brief Whether updateCostsTile() may be called concurrently on disjoint
+   *        tiles of the update bounds, instead of a single updateCosts() call.
+   *
+   * A layer returning true must only write master_grid cells inside the tile
+   * it is given, and must not modify its own state from updateCostsTile().
+   */
+  virtual bool supportsTiling() {return false;}
+
+  /**
+   * @brief Called once, before the tiles of a tiled update are dispatched,
+   *        with the full bounds that updateCosts() would have received.
+   *        Work that must not be repeated per tile goes here.
+   */
+  virtual void prepareTiledUpdate(
+    Costmap2D & /*master_grid*/,
+    int /*min_i*/, int /*min_j*/, int /*max_i*/, int /*max_j*/) {}
+
+  /**
+   * @brief Update one tile of the bounds during a tiled update. Only called
+   *        if supportsTiling() returns true; defaults to updateCosts().
+   */
+  virtual void updateCostsTile(
+    Costmap2D & master_grid,
+    int min_i, int min_j, int max_i, int max_j)
+  {
+    updateCosts(master_grid, min_i, min_j, max_i, max_j);
+  }
+
+  /**
+   * @brief Whether the next updateCosts() call will write every cell of its bounds
+   *        without reading what master_grid held there.
+   *
+   * When the first layer returns true, the bounds aren't reset to the default
+   * value before the layers run, as that layer replaces them anyway.
+   */
+  virtual bool overwritesBounds() {return false;}
+
   /** @brief Implement this to make this layer match the size of the parent costmap. */
   virtual void matchSize() {}
 
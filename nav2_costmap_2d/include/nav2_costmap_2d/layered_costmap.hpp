@@ -38,13 +38,21 @@
 #ifndef NAV2_COSTMAP_2D__LAYERED_COSTMAP_HPP_
 #define NAV2_COSTMAP_2D__LAYERED_COSTMAP_HPP_
 
+#include <functional>
+#include <future>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
 #include "nav2_costmap_2d/cost_values.hpp"
 #include "nav2_costmap_2d/layer.hpp"
 #include "nav2_costmap_2d/costmap_2d.hpp"
+#include "nav2_costmap_2d/costmap_pyramid.hpp"
+#include "nav2_costmap_2d/distance_field.hpp"
+#include "nav2_costmap_2d/fine_costmap.hpp"
+#include "nav2_costmap_2d/update_statistics.hpp"
+#include "nav2_util/thread_pool.hpp"
 
 namespace nav2_costmap_2d
 {
@@ -131,6 +139,24 @@ public:
     *yn = byn_;
   }
 
+  /**
+   * @brief The change counter of the master grid. Every updateMap() advances it by the
+   * areas it reset and updated, see Costmap2D::getChangedBounds()
+   */
+  uint64_t getChangeCount() const
+  {
+    return costmap_.getChangeCount();
+  }
+
+  /**
+   * @brief The tiles of the master grid changed since getChangeCount() returned since,
+   * see Costmap2D::getChangedTiles()
+   */
+  void getChangedTiles(uint64_t since, std::vector<unsigned int> & tiles) const
+  {
+    costmap_.getChangedTiles(since, tiles);
+  }
+
   bool isInitialized()
   {
     return initialized_;
@@ -138,7 +164,7 @@ public:
 
   /** @brief Updates the stored footprint, updates the circumscribed
    * and inscribed radii, and calls onFootprintChanged() in all
-   * layers. */
+   * layers. Setting the footprint already stored does nothing. */
   void setFootprint(const std::vector<geometry_msgs::msg::Point> & footprint_spec);
 
   /** @brief Returns the latest footprint stored with setFootprint(). */
@@ -162,7 +188,135 @@ public:
   * of poorly configured setups. */
   bool isOutofBounds(double robot_x, double robot_y);
 
+  /**
+   * @brief Split the updateCosts() pass of layers that support it into square
+   * tiles, updated concurrently on a pool of threads.
+   * @param tile_size Side of a tile in cells, 0 disables tiling
+   * @param num_threads Number of threads, 0 uses one per core
+   */
+  void setTiledUpdate(unsigned int tile_size, unsigned int num_threads);
+
+  /**
+   * @brief Keep a distance field up to date with the master grid, it is
+   * recomputed at the end of every updateMap() that changed the grid
+   * @param distance_field The field to update, null to stop updating one
+   */
+  void setDistanceField(std::shared_ptr<DistanceField> distance_field)
+  {
+    std::unique_lock<Costmap2D::mutex_t> lock(*(costmap_.getMutex()));
+    distance_field_ = distance_field;
+  }
+
+  /**
+   * @brief The distance field set with setDistanceField(), read it while
+   * holding the costmap's mutex
+   */
+  std::shared_ptr<const DistanceField> getDistanceField() const
+  {
+    return distance_field_;
+  }
+
+  /**
+   * @brief Distance in meters from a point to the nearest lethal cell of the master grid
+   * @return False if there is no distance field or the point is off the grid
+   */
+  bool getObstacleDistance(double wx, double wy, double & distance);
+
+  /**
+   * @brief Keep max-pooled coarser copies of the master grid, updated from
+   * the area that changed in every updateMap()
+   * @param num_levels Number of coarse levels, 0 disables the pyramid
+   */
+  void setPyramidLevels(unsigned int num_levels);
+
+  /**
+   * @brief The pyramid set up with setPyramidLevels() or null, read it while
+   * holding the costmap's mutex
+   */
+  const CostmapPyramid * getPyramid() const
+  {
+    return pyramid_.get();
+  }
+
+  /**
+   * @brief Keep a 16 bit copy of the master grid with the inflation decay evaluated
+   * exactly, updated from the area that changed in every updateMap(). Sets up a
+   * distance field too if there is none.
+   * @param enable False drops the copy, the 8 bit master grid is always kept
+   */
+  void setFineCosts(bool enable);
+
+  /**
+   * @brief The copy set up with setFineCosts() or null, read it while holding the
+   * costmap's mutex
+   */
+  const FineCostmap * getFineCostmap() const
+  {
+    return fine_costmap_.get();
+  }
+
+  /**
+   * @brief Set the inflation decay of the fine copy, if there is one, see
+   * FineCostmap::setInflation(). Called by the inflation layer.
+   */
+  void setFineCostInflation(
+    double inscribed_radius, double cost_scaling_factor, double inflation_radius);
+
+  /**
+   * @brief Measure the time spent in every layer, and waiting for the lock, during updateMap()
+   * @param window Number of updates the statistics are kept over, 0 disables them
+   */
+  void enableStatistics(std::size_t window);
+
+  /**
+   * @brief The statistics enabled with enableStatistics() or null, only to be
+   * used from the thread calling updateMap()
+   */
+  UpdateStatistics * getStatistics()
+  {
+    return statistics_.get();
+  }
+
+  /**
+   * @brief Queue a clear of the layers to be run by the next updateMap(), before the
+   * layers update their bounds. Clears run in the order they were requested, on the
+   * thread calling updateMap() and with the costmap's mutex held, so requesting one
+   * never waits for an update to finish.
+   * @return A future that becomes ready when the updateMap() that ran the clear is done,
+   * the master grid then having the cleared layers combined into it
+   */
+  std::shared_future<void> requestClear(std::function<void()> clear);
+
+  /**
+   * @brief Tell whoever runs updateMap() that a layer has new data, from any thread. Layers
+   * call this as their sensor data or maps come in; it does nothing without a callback set.
+   */
+  void requestUpdate();
+
+  /**
+   * @brief Set the function requestUpdate() calls, before any plugin is added
+   */
+  void setUpdateRequestCallback(std::function<void()> callback);
+
+  /**
+   * @brief Set the function requestClear() calls once the clear is queued, for whoever runs
+   * updateMap() to run it soon even when it otherwise waits for more than new data
+   */
+  void setClearRequestCallback(std::function<void()> callback);
+
 private:
+  /**
+   * @brief Run the clears queued with requestClear()
+   * @param done Set to the promises of the clears run, for once the update is done
+   */
+  void runClearRequests(std::vector<std::promise<void>> & done);
+
+  /** @brief Reset the master grid over the area and combine every plugin into it */
+  void updateArea(int x0, int y0, int xn, int yn);
+
+  /** @brief Run updateCosts() of every plugin over the bounds, tile by tile where supported */
+  void updateCostsTiled(int x0, int y0, int xn, int yn);
+
   Costmap2D costmap_;
   std::string global_frame_;
 
@@ -176,8 +330,22 @@ private:
 
   bool initialized_;
   bool size_locked_;
+  bool window_valid_;  ///< @brief Whether the rolling window holds a composite to shift
   double circumscribed_radius_, inscribed_radius_;
   std::vector<geometry_msgs::msg::Point> footprint_;
+
+  unsigned int tile_size_;
+  std::unique_ptr<nav2_util::ThreadPool> tile_pool_;
+
+  std::shared_ptr<DistanceField> distance_field_;
+  std::unique_ptr<CostmapPyramid> pyramid_;
+  std::unique_ptr<FineCostmap> fine_costmap_;
+  std::unique_ptr<UpdateStatistics> statistics_;
+
+  std::mutex clear_requests_mutex_;
+  std::vector<std::pair<std::function<void()>, std::promise<void>>> clear_requests_;
+  std::function<void()> update_request_callback_;
+  std::function<void()> clear_request_callback_;
 };
 
 }  // namespace nav2_costmap_2d
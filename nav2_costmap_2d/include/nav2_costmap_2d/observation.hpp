@@ -32,6 +32,8 @@
 #ifndef NAV2_COSTMAP_2D__OBSERVATION_HPP_
 #define NAV2_COSTMAP_2D__OBSERVATION_HPP_
 
+#include <memory>
+
 #include <geometry_msgs/msg/point.hpp>
 #include <sensor_msgs/msg/point_cloud2.hpp>
 
@@ -50,13 +52,13 @@ public:
    * @brief  Creates an empty observation
    */
   Observation()
-  : cloud_(new sensor_msgs::msg::PointCloud2()), obstacle_range_(0.0), raytrace_range_(0.0)
+  : cloud_(std::make_shared<sensor_msgs::msg::PointCloud2>()), obstacle_range_(0.0),
+    raytrace_range_(0.0)
   {
   }
 
   virtual ~Observation()
   {
-    delete cloud_;
   }
 
   /**
@@ -69,17 +71,17 @@ public:
   Observation(
     geometry_msgs::msg::Point & origin, const sensor_msgs::msg::PointCloud2 & cloud,
     double obstacle_range, double raytrace_range)
-  : origin_(origin), cloud_(new sensor_msgs::msg::PointCloud2(cloud)),
+  : origin_(origin), cloud_(std::make_shared<sensor_msgs::msg::PointCloud2>(cloud)),
     obstacle_range_(obstacle_range), raytrace_range_(raytrace_range)
   {
   }
 
   /**
-   * @brief  Copy constructor
+   * @brief  Copy constructor, the copy shares the cloud of the observation
    * @param obs The observation to copy
    */
   Observation(const Observation & obs)
-  : origin_(obs.origin_), cloud_(new sensor_msgs::msg::PointCloud2(*(obs.cloud_))),
+  : origin_(obs.origin_), cloud_(obs.cloud_),
     obstacle_range_(obs.obstacle_range_), raytrace_range_(obs.raytrace_range_)
   {
   }
@@ -90,13 +92,15 @@ public:
    * @param obstacle_range The range out to which an observation should be able to insert obstacles
    */
   Observation(const sensor_msgs::msg::PointCloud2 & cloud, double obstacle_range)
-  : cloud_(new sensor_msgs::msg::PointCloud2(cloud)), obstacle_range_(obstacle_range),
+  : cloud_(std::make_shared<sensor_msgs::msg::PointCloud2>(cloud)),
+    obstacle_range_(obstacle_range),
     raytrace_range_(0.0)
   {
   }
 
   geometry_msgs::msg::Point origin_;
-  sensor_msgs::msg::PointCloud2 * cloud_;
+  /// Shared between copies, so it isn't modified once the observation is buffered
+  std::shared_ptr<sensor_msgs::msg::PointCloud2> cloud_;
   double obstacle_range_, raytrace_range_;
 };
 
@@ -37,14 +37,21 @@
 #ifndef NAV2_COSTMAP_2D__OBSERVATION_BUFFER_HPP_
 #define NAV2_COSTMAP_2D__OBSERVATION_BUFFER_HPP_
 
+#include <atomic>
 #include <vector>
+#include <functional>
+#include <limits>
 #include <list>
+#include <map>
+#include <memory>
 #include <string>
+#include <unordered_map>
 
 #include "tf2_geometry_msgs/tf2_geometry_msgs.h"
 #include "rclcpp/time.hpp"
 #include "tf2_ros/buffer.h"
 #include "tf2_sensor_msgs/tf2_sensor_msgs.h"
+#include "sensor_msgs/msg/laser_scan.hpp"
 #include "sensor_msgs/msg/point_cloud2.hpp"
 #include "nav2_costmap_2d/observation.hpp"
 #include "nav2_util/lifecycle_node.hpp"
@@ -96,6 +103,32 @@ public:
    */
   bool setGlobalFrame(const std::string new_global_frame);
 
+  /**
+   * @brief  Deduplicate the points of buffered clouds per cell, keeping the closest to the sensor
+   * @param  resolution The size of the cells, 0 disables deduplication
+   * @param  origin_x The x coordinate of a cell corner, to align the cells with a costmap
+   * @param  origin_y The y coordinate of a cell corner, to align the cells with a costmap
+   * @param  z_resolution The height of the cells to deduplicate on voxels, 0 deduplicates on 2D cells
+   * @param  origin_z The z coordinate of a cell corner
+   * @param  split_height Points above and below this height are deduplicated separately
+   */
+  void setDownsampling(
+    double resolution, double origin_x, double origin_y,
+    double z_resolution = 0.0, double origin_z = 0.0,
+    double split_height = std::numeric_limits<double>::max());
+
+  /**
+   * @brief  Drop or shorten the points that are out of range for how the observations are used
+   * @param  marking Whether the observations are used for marking
+   * @param  clearing Whether the observations are used for clearing
+   */
+  void setRangeGating(bool marking, bool clearing);
+
+  /**
+   * @brief  Get the number of points received and stored after filtering, since construction
+   */
+  void getReductionStatistics(uint64_t & received_points, uint64_t & stored_points) const;
+
   /**
    * @brief  Transforms a PointCloud to the global frame and buffers it
    * <b>Note: The burden is on the user to make sure the transform is available... ie they should use a MessageNotifier</b>
@@ -104,13 +137,55 @@ public:
   void bufferCloud(const sensor_msgs::msg::PointCloud2 & cloud);
 
   /**
-   * @brief  Pushes copies of all current observations onto the end of the vector passed in
+   * @brief  Projects a LaserScan straight into the global frame and buffers it, the same as
+   * bufferCloud() would its projection but without building an intermediate cloud. The scan is
+   * taken from a single sensor pose, at its stamp
+   * @param  scan The scan to be buffered
+   * @param  inf_is_valid Whether an infinite range is a beam that hit nothing before range_max
+   */
+  void bufferScan(const sensor_msgs::msg::LaserScan & scan, bool inf_is_valid);
+
+  /**
+   * @brief  Buffers an observation of another buffer of the same source, see addListener().
+   * In the same global frame and without downsampling its cloud is shared as is, otherwise
+   * the cloud and its origin are transformed to the global frame and stored like bufferCloud()
+   * @param  observation The observation, whose cloud is in the frame of its header
+   */
+  void bufferObservation(const Observation & observation);
+
+  /// Called with each observation a buffer stores, under the buffer's lock
+  typedef std::function<void(const Observation &)> Listener;
+
+  /**
+   * @brief  Add a listener to the observations this buffer stores, needs no lock
+   * @return An identifier for removeListener()
+   */
+  int addListener(Listener listener);
+
+  /**
+   * @brief  Remove a listener added by addListener(), needs no lock
+   */
+  void removeListener(int id);
+
+  /**
+   * @brief  Pushes copies of all current observations onto the end of the vector passed in,
+   * sharing their clouds with the buffer, see getObservationView()
    * @param  observations The vector to be filled
    */
   void getObservations(std::vector<Observation> & observations);
 
   /**
-   * @brief  Check if the observation buffer is being update at its expected rate
+   * @brief  The current observations, as of the last change to the buffer. Needs no lock:
+   * the buffer publishes a new view on every change and never modifies a published one or
+   * the clouds in it, which stay valid for as long as the view is held.
+   */
+  std::shared_ptr<const std::vector<Observation>> getObservationView() const
+  {
+    return std::atomic_load(&view_);
+  }
+
+  /**
+   * @brief  Check if the observation buffer is being update at its expected rate, needs no lock
    * @return True if it is being updated at the expected rate, false otherwise
    */
   bool isCurrent() const;
@@ -142,19 +217,91 @@ private:
    */
   void purgeStaleObservations();
 
+  /**
+   * @brief  Publish the observations in the list as the view returned by getObservationView()
+   */
+  void publishView();
+
+  /**
+   * @brief  Set when the buffer was last updated, for purgeStaleObservations() and isCurrent()
+   */
+  void setLastUpdated(const rclcpp::Time & time);
+
+  /**
+   * @brief  Puts a new observation at the front of the list for a message, with the origin of
+   * the sensor and the transform of the message to the global frame
+   * @param  origin The origin of the sensor in the frame of the message, if not the origin
+   * of the sensor frame
+   * @return False, leaving no observation behind, if a transform isn't available
+   */
+  bool beginObservation(
+    const std_msgs::msg::Header & header, tf2::Transform & transform,
+    const geometry_msgs::msg::Point * origin = nullptr);
+
+  /**
+   * @brief  Transforms and filters the points of a cloud into the observation at the front of
+   * the list, begun with the transform of the cloud, and keeps it
+   */
+  void storeCloud(const sensor_msgs::msg::PointCloud2 & cloud, const tf2::Transform & transform);
+
+  /**
+   * @brief  Returns the observation at the front of the list to the pool
+   */
+  void discardObservation();
+
+  /**
+   * @brief  Downsamples the point_count points stored of the observation at the front of the
+   * list, and stamps and keeps it
+   */
+  void endObservation(
+    unsigned int received, unsigned int point_count,
+    int x_offset, int y_offset, int z_offset, const builtin_interfaces::msg::Time & stamp);
+
+  /**
+   * @brief  Applies the height bounds and the range gates to a point in the global frame
+   * @return False if the point isn't kept
+   */
+  bool filterPoint(float & x, float & y, float & z, double ox, double oy, double oz) const;
+
+  /**
+   * @brief  Deduplicates the first point_count points of a cloud in place
+   * @return The number of points kept
+   */
+  unsigned int downsample(
+    sensor_msgs::msg::PointCloud2 & cloud, unsigned int point_count,
+    double ox, double oy, double oz, int x_offset, int y_offset, int z_offset);
+
   tf2_ros::Buffer & tf2_buffer_;
   const rclcpp::Duration observation_keep_time_;
   const rclcpp::Duration expected_update_rate_;
   nav2_util::LifecycleNode::SharedPtr nh_;
   rclcpp::Time last_updated_;
+  std::atomic<int64_t> last_updated_ns_;  ///< @brief last_updated_, for isCurrent() without lock
   std::string global_frame_;
   std::string sensor_frame_;
   std::list<Observation> observation_list_;
+  std::list<Observation> observation_pool_;  ///< @brief Purged observations kept for reuse
+  std::shared_ptr<const std::vector<Observation>> view_;  ///< @brief Only accessed atomically
   std::string topic_name_;
   double min_obstacle_height_, max_obstacle_height_;
   std::recursive_mutex lock_;  ///< @brief A lock for accessing data in callbacks safely
+  std::map<int, Listener> listeners_;  ///< @brief Under lock_, see addListener()
+  int next_listener_{0};
   double obstacle_range_, raytrace_range_;
   double tf_tolerance_;
+
+  double downsample_resolution_{0.0};
+  double downsample_origin_x_{0.0}, downsample_origin_y_{0.0};
+  double downsample_z_resolution_{0.0}, downsample_origin_z_{0.0};
+  double downsample_split_height_{std::numeric_limits<double>::max()};
+  std::unordered_map<uint64_t, unsigned int> downsample_cells_;
+  std::vector<double> downsample_sq_dists_;
+  bool gate_obstacle_range_{false}, gate_raytrace_range_{false};
+  uint64_t received_points_{0}, stored_points_{0};
+
+  // the directions of the beams of the last scan buffered, for its configuration
+  std::vector<double> beam_cos_, beam_sin_;
+  float beam_angle_min_{0.0f}, beam_angle_increment_{0.0f};
 };
 }  // namespace nav2_costmap_2d
 #endif  // NAV2_COSTMAP_2D__OBSERVATION_BUFFER_HPP_
@@ -0,0 +1,51 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_COSTMAP_2D__OBSERVATION_SOURCE_REGISTRY_HPP_
+#define NAV2_COSTMAP_2D__OBSERVATION_SOURCE_REGISTRY_HPP_
+
+#include <memory>
+#include <string>
+
+namespace nav2_costmap_2d
+{
+
+class ObservationBuffer;
+
+/**
+ * @class ObservationSourceRegistry
+ * @brief Process wide table of the observation buffers fed by a sensor subscription, keyed
+ * by the topic and the configuration of the source
+ *
+ * An obstacle layer sharing a source registers its buffer here. Another layer in the same
+ * process with a source configured the same way, in the other costmap typically, then takes
+ * its observations from that buffer instead of subscribing, transforming and filtering the
+ * sensor messages all over again.
+ */
+class ObservationSourceRegistry
+{
+public:
+  /** @brief Register the buffer of a source, kept as long as it lives elsewhere */
+  static void add(const std::string & key, const std::shared_ptr<ObservationBuffer> & buffer);
+
+  /**
+   * @brief Get the buffer registered for a source
+   * @return nullptr if nobody in this process has a live buffer for it
+   */
+  static std::shared_ptr<ObservationBuffer> get(const std::string & key);
+};
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__OBSERVATION_SOURCE_REGISTRY_HPP_
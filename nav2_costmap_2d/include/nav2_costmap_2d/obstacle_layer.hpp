@@ -38,8 +38,12 @@
 #ifndef NAV2_COSTMAP_2D__OBSTACLE_LAYER_HPP_
 #define NAV2_COSTMAP_2D__OBSTACLE_LAYER_HPP_
 
+#include <functional>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "rclcpp/rclcpp.hpp"
@@ -57,6 +61,7 @@
 #include "nav2_costmap_2d/layered_costmap.hpp"
 #include "nav2_costmap_2d/observation_buffer.hpp"
 #include "nav2_costmap_2d/footprint.hpp"
+#include "nav2_util/thread_pool.hpp"
 
 namespace nav2_costmap_2d
 {
@@ -80,9 +85,18 @@ public:
     nav2_costmap_2d::Costmap2D & master_grid,
     int min_i, int min_j, int max_i, int max_j);
 
+  virtual bool supportsTiling() {return true;}
+  virtual void prepareTiledUpdate(
+    nav2_costmap_2d::Costmap2D & master_grid,
+    int min_i, int min_j, int max_i, int max_j);
+  virtual void updateCostsTile(
+    nav2_costmap_2d::Costmap2D & master_grid,
+    int min_i, int min_j, int max_i, int max_j);
+
   virtual void activate();
   virtual void deactivate();
   virtual void reset();
+  virtual void matchSize();
   /**
    * @brief triggers the update of observations buffer
    */
@@ -106,6 +120,18 @@ public:
     sensor_msgs::msg::LaserScan::ConstSharedPtr message,
     const std::shared_ptr<nav2_costmap_2d::ObservationBuffer> & buffer);
 
+  /**
+   * @brief  A callback to buffer LaserScan messages straight into the global frame, without
+   * projecting them into a point cloud first
+   * @param message The message returned from a message notifier
+   * @param buffer A pointer to the observation buffer to update
+   * @param inf_is_valid Whether Inf values are to be turned into range_max
+   */
+  void laserScanDirectCallback(
+    sensor_msgs::msg::LaserScan::ConstSharedPtr message,
+    const std::shared_ptr<nav2_costmap_2d::ObservationBuffer> & buffer,
+    bool inf_is_valid);
+
   /**
    * @brief  A callback to handle buffering PointCloud2 messages
    * @param message The message returned from a message notifier
@@ -115,6 +141,25 @@ public:
     sensor_msgs::msg::PointCloud2::ConstSharedPtr message,
     const std::shared_ptr<nav2_costmap_2d::ObservationBuffer> & buffer);
 
+  /**
+   * @brief  Buffer a scan as if it had been received on the topic of one of the observation
+   * sources, without it going through the middleware, to replay sensor data offline.
+   * The transforms it needs must be in the TF buffer.
+   * @param topic The topic of the observation source
+   * @param message The scan
+   * @return False if none of the LaserScan sources is on the topic
+   */
+  bool replayObservation(
+    const std::string & topic, sensor_msgs::msg::LaserScan::ConstSharedPtr message);
+
+  /**
+   * @brief  Buffer a cloud as if it had been received on the topic of one of the observation
+   * sources, see the LaserScan overload
+   * @return False if none of the PointCloud2 sources is on the topic
+   */
+  bool replayObservation(
+    const std::string & topic, sensor_msgs::msg::PointCloud2::ConstSharedPtr message);
+
   // for testing purposes
   void addStaticObservation(nav2_costmap_2d::Observation & obs, bool marking, bool clearing);
   void clearStaticObservations(bool marking, bool clearing);
@@ -150,6 +195,32 @@ protected:
     double * max_x,
     double * max_y);
 
+  /**
+   * @brief  Clear freespace based on several observations, tracing them concurrently
+   * on clearing_pool_ and then applying the cells they clear
+   */
+  void raytraceFreespaceParallel(
+    const std::vector<nav2_costmap_2d::Observation> & clearing_observations,
+    double * min_x, double * min_y,
+    double * max_x,
+    double * max_y);
+
+  /**
+   * @brief  Get the cells the rays of a clearing observation end in, clipped to the map
+   * @param clearing_observation The observation used to raytrace
+   * @param x0 Will be set to the x cell of the origin of the observation
+   * @param y0 Will be set to the y cell of the origin of the observation
+   * @param endpoints Will be filled with the indices of the end cells, once each
+   * if deduplicate_rays_ is set
+   * @return False if the origin of the observation is off the map
+   */
+  bool getClearingEndpoints(
+    const nav2_costmap_2d::Observation & clearing_observation,
+    unsigned int & x0, unsigned int & y0, std::vector<unsigned int> & endpoints,
+    double * min_x, double * min_y,
+    double * max_x,
+    double * max_y);
+
   void updateRaytraceBounds(
     double ox, double oy, double wx, double wy, double range,
     double * min_x, double * min_y,
@@ -164,6 +235,29 @@ protected:
     double * max_x,
     double * max_y);
 
+  /**
+   * @brief  Combine this layer's costs into the master grid using combination_method_
+   */
+  void combineCosts(
+    nav2_costmap_2d::Costmap2D & master_grid,
+    int min_i, int min_j, int max_i, int max_j);
+
+  /**
+   * @brief  Align the cells of the downsampled observation buffers with this layer
+   */
+  virtual void updateDownsampling();
+
+  /**
+   * @brief  Store the changes to this layer's parameters, for the update thread to apply
+   */
+  void on_parameter_event_callback(const rcl_interfaces::msg::ParameterEvent::SharedPtr event);
+
+  /**
+   * @brief  Apply the parameters changed since the last update, growing the bounds
+   *         to the whole layer if what it puts in the master grid changed
+   */
+  void applyParameterChanges(double * min_x, double * min_y, double * max_x, double * max_y);
+
   std::string global_frame_;  ///< @brief The global frame for the costmap
   double max_obstacle_height_;  ///< @brief Max Obstacle Height
 
@@ -179,6 +273,15 @@ protected:
   std::vector<std::shared_ptr<nav2_costmap_2d::ObservationBuffer>> marking_buffers_;
   /// @brief Used to store observation buffers used for clearing obstacles
   std::vector<std::shared_ptr<nav2_costmap_2d::ObservationBuffer>> clearing_buffers_;
+  /// @brief Used to store observation buffers that deduplicate their points per cell
+  std::vector<std::shared_ptr<nav2_costmap_2d::ObservationBuffer>> downsampled_buffers_;
+  /// @brief The buffers of other layers fed to ours, and our listener on each
+  std::vector<std::pair<std::weak_ptr<nav2_costmap_2d::ObservationBuffer>, int>> shared_sources_;
+  /// @brief The callbacks of the sources by topic, for replaying observations
+  std::multimap<std::string,
+    std::function<void(sensor_msgs::msg::LaserScan::ConstSharedPtr)>> scan_replays_;
+  std::multimap<std::string,
+    std::function<void(sensor_msgs::msg::PointCloud2::ConstSharedPtr)>> cloud_replays_;
 
   // Used only for testing purposes
   std::vector<nav2_costmap_2d::Observation> static_clearing_observations_;
@@ -186,6 +289,23 @@ protected:
 
   bool rolling_window_;
   int combination_method_;
+
+  bool deduplicate_rays_{false};  ///< @brief Trace the rays ending in the same cell once
+  std::unique_ptr<nav2_util::ThreadPool> clearing_pool_;  ///< @brief Traces clearing in parallel
+  std::vector<unsigned int> clearing_endpoints_;
+
+  /// @brief The parameters that can change at runtime, as last set
+  struct Parameters
+  {
+    bool enabled, footprint_clearing_enabled;
+    double max_obstacle_height;
+    int combination_method;
+  };
+  std::mutex parameters_mutex_;
+  Parameters parameters_;
+  bool parameters_changed_{false};
+  rclcpp::AsyncParametersClient::SharedPtr parameters_client_;
+  rclcpp::Subscription<rcl_interfaces::msg::ParameterEvent>::SharedPtr parameter_event_sub_;
 };
 
 }  // namespace nav2_costmap_2d
@@ -0,0 +1,84 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_COSTMAP_2D__SHARED_COSTMAP_LAYER_HPP_
+#define NAV2_COSTMAP_2D__SHARED_COSTMAP_LAYER_HPP_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rclcpp/rclcpp.hpp"
+#include "nav2_costmap_2d/costmap_subscriber.hpp"
+#include "nav2_costmap_2d/layer.hpp"
+#include "nav2_costmap_2d/layered_costmap.hpp"
+
+namespace nav2_costmap_2d
+{
+
+/**
+ * @class SharedCostmapLayer
+ * @brief Copies in the costmap of another Costmap2DROS, such as one computing the static
+ * and inflation layers of a map once for a whole fleet, so each robot only adds its own
+ * obstacles on top. It keeps no grid of its own.
+ *
+ * A server in the same process with use_snapshots set is read without any copy, others
+ * through their raw costmap topic. The shared costmap must be in the global frame of this
+ * one. Only the rows that changed since the last update are copied again.
+ *
+ * A static window takes on the size, resolution and origin of the shared costmap, so this
+ * goes first among the plugins, in place of a static layer.
+ */
+class SharedCostmapLayer : public Layer
+{
+public:
+  SharedCostmapLayer();
+  virtual ~SharedCostmapLayer();
+
+  virtual void onInitialize();
+  virtual void activate() {}
+  virtual void deactivate() {}
+  virtual void reset();
+
+  virtual void updateBounds(
+    double robot_x, double robot_y, double robot_yaw, double * min_x,
+    double * min_y, double * max_x, double * max_y);
+  virtual void updateCosts(
+    nav2_costmap_2d::Costmap2D & master_grid,
+    int min_i, int min_j, int max_i, int max_j);
+
+  // Only the copy onto the same grid is purely cell-local
+  virtual bool supportsTiling() {return shared_ != nullptr && same_grid_;}
+  virtual bool overwritesBounds() {return enabled_ && supportsTiling() && !use_maximum_;}
+
+private:
+  /**
+   * @brief Find the rows of the shared costmap that changed since the last call
+   * @return False if none did
+   */
+  bool findChangedRows(const Costmap2D & shared, unsigned int & y0, unsigned int & yn);
+
+  std::string topic_;
+  bool use_maximum_;
+  std::unique_ptr<CostmapSubscriber> subscriber_;
+
+  std::shared_ptr<const Costmap2D> shared_;  ///< The costmap copied in by updateCosts()
+  bool same_grid_{false};  ///< Whether shared_ has the size, resolution and origin of the master
+  std::vector<uint64_t> row_hashes_;  ///< Of the rows of the last costmap copied in
+};
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__SHARED_COSTMAP_LAYER_HPP_
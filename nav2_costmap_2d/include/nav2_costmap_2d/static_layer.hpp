@@ -47,6 +47,7 @@
 #include "nav2_costmap_2d/layered_costmap.hpp"
 #include "nav_msgs/msg/occupancy_grid.hpp"
 #include "rclcpp/rclcpp.hpp"
+#include "tf2/LinearMath/Transform.h"
 
 namespace nav2_costmap_2d
 {
@@ -70,6 +71,10 @@ public:
     nav2_costmap_2d::Costmap2D & master_grid,
     int min_i, int min_j, int max_i, int max_j);
 
+  // Only the non-rolling copy is purely cell-local
+  virtual bool supportsTiling() {return map_received_ && !layered_costmap_->isRolling();}
+  virtual bool overwritesBounds() {return enabled_ && supportsTiling() && !use_maximum_;}
+
   virtual void matchSize();
 
 private:
@@ -92,6 +97,11 @@ private:
 
   bool has_updated_data_{false};
 
+  // Transform from the global frame into the map frame for rolling windows,
+  // kept from updateBounds() to tell when the map moved in the window
+  tf2::Transform global_to_map_;
+  bool has_transform_{false};
+
   unsigned int x_{0};
   unsigned int y_{0};
   unsigned int width_{0};
@@ -110,6 +120,9 @@ private:
   unsigned char unknown_cost_value_;
   bool trinary_costmap_;
   bool map_received_{false};
+
+  // interpretValue() of every value, looked up instead of computed per cell
+  unsigned char value_to_cost_[256];
 };
 
 }  // namespace nav2_costmap_2d
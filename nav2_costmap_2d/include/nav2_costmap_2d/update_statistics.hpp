@@ -0,0 +1,132 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_COSTMAP_2D__UPDATE_STATISTICS_HPP_
+#define NAV2_COSTMAP_2D__UPDATE_STATISTICS_HPP_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "nav2_msgs/msg/costmap_update_statistics.hpp"
+#include "nav2_msgs/msg/rolling_statistics.hpp"
+
+namespace nav2_costmap_2d
+{
+
+/**
+ * @class RollingStatistics
+ * @brief Keeps the last samples of a measurement to summarize them
+ */
+class RollingStatistics
+{
+public:
+  /**
+   * @brief Constructor
+   * @param window Number of samples kept, older ones are dropped
+   */
+  explicit RollingStatistics(std::size_t window = 100);
+
+  void add(double value);
+
+  std::size_t size() const {return samples_.size();}
+
+  /**
+   * @brief Summarize the samples kept
+   * @param name What is measured
+   * @param msg Filled with the count, mean, median, 95th percentile and maximum
+   */
+  void toMsg(const std::string & name, nav2_msgs::msg::RollingStatistics & msg) const;
+
+private:
+  std::size_t window_;
+  std::size_t next_;
+  std::vector<double> samples_;
+};
+
+/**
+ * @class UpdateStatistics
+ * @brief Timings of the updates of a LayeredCostmap, overall and by layer.
+ * Only used from the thread updating the costmap.
+ */
+class UpdateStatistics
+{
+public:
+  /**
+   * @brief Constructor
+   * @param window Number of updates the statistics are over
+   */
+  explicit UpdateStatistics(std::size_t window = 100);
+
+  /**
+   * @brief Set the names of the layers in the order they run, resetting their statistics
+   */
+  void setLayers(const std::vector<std::string> & layer_names);
+
+  /**
+   * @brief Start measuring an update
+   */
+  void beginUpdate();
+
+  void addLockWait(double seconds) {lock_wait_.add(seconds);}
+  void addUpdatedCells(double cells) {pending_cells_ += cells;}
+  void addBoundsTime(std::size_t layer, double seconds) {layers_[layer].pending_bounds += seconds;}
+  void addCostsTime(std::size_t layer, double seconds) {layers_[layer].pending_costs += seconds;}
+
+  /**
+   * @brief Finish measuring an update, the times of each layer are summed over the update
+   */
+  void endUpdate();
+
+  /**
+   * @brief Record the duration of a whole update, as seen by the update loop
+   */
+  void addUpdateTime(double seconds) {update_time_.add(seconds);}
+
+  /**
+   * @brief Record an update that took longer than the update period
+   */
+  void addMissedCycle() {++missed_cycles_;}
+
+  unsigned int getMissedCycles() const {return missed_cycles_;}
+
+  const std::vector<std::string> & getLayerNames() const {return layer_names_;}
+
+  void toMsg(nav2_msgs::msg::CostmapUpdateStatistics & msg) const;
+
+private:
+  struct LayerTimes
+  {
+    explicit LayerTimes(std::size_t window)
+    : bounds(window), costs(window), pending_bounds(0.0), pending_costs(0.0) {}
+
+    RollingStatistics bounds;
+    RollingStatistics costs;
+    double pending_bounds;
+    double pending_costs;
+  };
+
+  std::size_t window_;
+  RollingStatistics update_time_;
+  RollingStatistics lock_wait_;
+  RollingStatistics updated_cells_;
+  double pending_cells_;
+  unsigned int missed_cycles_;
+  std::vector<std::string> layer_names_;
+  std::vector<LayerTimes> layers_;
+};
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__UPDATE_STATISTICS_HPP_
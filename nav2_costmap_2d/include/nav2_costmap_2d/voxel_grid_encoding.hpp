@@ -0,0 +1,117 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_COSTMAP_2D__VOXEL_GRID_ENCODING_HPP_
+#define NAV2_COSTMAP_2D__VOXEL_GRID_ENCODING_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "nav2_msgs/msg/voxel_grid.hpp"
+
+namespace nav2_costmap_2d
+{
+
+/**
+ * @class VoxelGridEncoder
+ * @brief Fills the data of successive nav2_msgs::msg::VoxelGrid messages with only the
+ * columns that changed since the previous one. The whole grid is sent instead every
+ * keyframe_interval messages, and whenever it is smaller than the changes.
+ */
+class VoxelGridEncoder
+{
+public:
+  /**
+   * @param keyframe_interval Number of deltas between whole grids, 0 always sends whole grids
+   */
+  explicit VoxelGridEncoder(unsigned int keyframe_interval = 0);
+
+  /**
+   * @brief Encode the columns of a grid into a message
+   * @param words The columns, column_words words each
+   * @param num_columns The number of columns, size_x * size_y of the message
+   * @param column_words The number of words in each column
+   * @param msg Gets its data, column_words, encoding and sequence filled
+   */
+  void encode(
+    const uint32_t * words, std::size_t num_columns, unsigned int column_words,
+    nav2_msgs::msg::VoxelGrid & msg);
+
+  /** @brief Send the whole grid in the next message */
+  void forceKeyframe()
+  {
+    previous_.clear();
+  }
+
+private:
+  unsigned int keyframe_interval_;
+  unsigned int deltas_;
+  uint32_t sequence_;
+  unsigned int column_words_;
+  std::vector<uint32_t> previous_;
+};
+
+/**
+ * @class VoxelGridDecoder
+ * @brief Rebuilds the grid sent by a VoxelGridEncoder, message by message, keeping
+ * track of the columns each message changed
+ */
+class VoxelGridDecoder
+{
+public:
+  VoxelGridDecoder();
+
+  /**
+   * @brief Apply a message to the grid
+   * @return False if the grid can't be rebuilt from it: a delta that doesn't follow the
+   * last message applied, or malformed data. Deltas are then ignored until a whole grid.
+   */
+  bool decode(const nav2_msgs::msg::VoxelGrid & msg);
+
+  /** @brief The columns of the grid, columnWords() words each */
+  const uint32_t * words() const
+  {
+    return words_.data();
+  }
+
+  unsigned int columnWords() const
+  {
+    return column_words_;
+  }
+
+  /** @brief Whether the last decode() replaced the whole grid */
+  bool replacedGrid() const
+  {
+    return replaced_;
+  }
+
+  /** @brief The indices of the columns the last decode() changed, if it didn't replace the grid */
+  const std::vector<uint32_t> & changedColumns() const
+  {
+    return changed_;
+  }
+
+private:
+  bool valid_;
+  bool replaced_;
+  uint32_t sequence_;
+  unsigned int column_words_;
+  std::vector<uint32_t> words_;
+  std::vector<uint32_t> changed_;
+};
+
+}  // namespace nav2_costmap_2d
+
+#endif  // NAV2_COSTMAP_2D__VOXEL_GRID_ENCODING_HPP_
@@ -50,7 +50,9 @@
 #include <sensor_msgs/msg/point_cloud2.hpp>
 #include <message_filters/subscriber.h>
 #include <nav2_costmap_2d/obstacle_layer.hpp>
+#include <nav2_costmap_2d/voxel_grid_encoding.hpp>
 #include <nav2_voxel_grid/voxel_grid.hpp>
+#include <nav2_voxel_grid/sparse_voxel_grid.hpp>
 
 namespace nav2_costmap_2d
 {
@@ -59,7 +61,8 @@ class VoxelLayer : public ObstacleLayer
 {
 public:
   VoxelLayer()
-  : voxel_grid_(0, 0, 0)
+  : voxel_grid_(0, 0, 0), voxel_grid_64_(0, 0, 0), voxel_grid_128_(0, 0, 0),
+    sparse_voxel_grid_(0, 0, 0), sparse_voxel_grid_64_(0, 0, 0), sparse_voxel_grid_128_(0, 0, 0)
   {
     costmap_ = NULL;  // this is the unsigned char* member of parent class's parent class Costmap2D
   }
@@ -81,8 +84,15 @@ public:
   virtual void matchSize();
   virtual void reset();
 
+  /**
+   * @brief  Resets the cells outside of the window like CostmapLayer::resetOutside,
+   *         and forgets the marks in their voxel columns
+   */
+  virtual void resetOutside(int x0, int y0, int xn, int yn, unsigned char value);
+
 protected:
   virtual void resetMaps();
+  virtual void updateDownsampling();
 
 private:
   void reconfigureCB();
@@ -93,13 +103,63 @@ private:
     double * max_x,
     double * max_y);
 
+  // Calls the visitor with the voxel grid whose column type fits z_voxels,
+  // dense or sparse as configured, the other grids are left empty
+  template<typename VisitorT>
+  void visitVoxelGrid(VisitorT && visitor)
+  {
+    bool tall = static_cast<unsigned int>(size_z_) > nav2_voxel_grid::VoxelGrid64::max_size_z;
+    bool wide = static_cast<unsigned int>(size_z_) > nav2_voxel_grid::VoxelGrid::max_size_z;
+    if (use_sparse_voxel_grid_) {
+      if (tall) {
+        visitor(sparse_voxel_grid_128_);
+      } else if (wide) {
+        visitor(sparse_voxel_grid_64_);
+      } else {
+        visitor(sparse_voxel_grid_);
+      }
+    } else if (tall) {
+      visitor(voxel_grid_128_);
+    } else if (wide) {
+      visitor(voxel_grid_64_);
+    } else {
+      visitor(voxel_grid_);
+    }
+  }
+
+  template<typename VoxelGridT>
+  void markObservations(
+    VoxelGridT & voxel_grid, const std::vector<Observation> & observations,
+    double * min_x, double * min_y, double * max_x, double * max_y);
+  template<typename VoxelGridT>
+  void publishVoxelGrid(VoxelGridT & voxel_grid);
+  template<typename ColumnT>
+  void shiftVoxelGrid(
+    nav2_voxel_grid::BasicVoxelGrid<ColumnT> & voxel_grid, int cell_ox, int cell_oy);
+  template<typename ColumnT>
+  void shiftVoxelGrid(
+    nav2_voxel_grid::SparseVoxelGrid<ColumnT> & voxel_grid, int cell_ox, int cell_oy);
+  template<typename VoxelGridT>
+  void forgetMarksOutside(VoxelGridT & voxel_grid, int x0, int y0, int xn, int yn);
+
   bool publish_voxel_;
   rclcpp_lifecycle::LifecyclePublisher<nav2_msgs::msg::VoxelGrid>::SharedPtr voxel_pub_;
+  VoxelGridEncoder voxel_encoder_;
+  std::vector<uint32_t> voxel_words_;  ///< @brief The columns of the grid being published
   nav2_voxel_grid::VoxelGrid voxel_grid_;
+  nav2_voxel_grid::VoxelGrid64 voxel_grid_64_;
+  nav2_voxel_grid::VoxelGrid128 voxel_grid_128_;
+  nav2_voxel_grid::SparseVoxelGrid32 sparse_voxel_grid_;
+  nav2_voxel_grid::SparseVoxelGrid64 sparse_voxel_grid_64_;
+  nav2_voxel_grid::SparseVoxelGrid128 sparse_voxel_grid_128_;
+  bool use_sparse_voxel_grid_;
   double z_resolution_, origin_z_;
   int unknown_threshold_, mark_threshold_, size_z_;
   rclcpp::Publisher<sensor_msgs::msg::PointCloud>::SharedPtr clearing_endpoints_pub_;
   sensor_msgs::msg::PointCloud clearing_endpoints_;
+  std::vector<double> clearing_ends_;
+  // the cells whose cost clearing changed, which alone bound the update
+  std::vector<unsigned int> cleared_cells_;
 
   inline bool worldToMap3DFloat(
     double wx, double wy, double wz, double & mx, double & my,
@@ -0,0 +1,197 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_costmap_2d/decaying_obstacle_layer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "pluginlib/class_list_macros.hpp"
+#include "sensor_msgs/point_cloud2_iterator.hpp"
+
+PLUGINLIB_EXPORT_CLASS(nav2_costmap_2d::DecayingObstacleLayer, nav2_costmap_2d::Layer)
+
+namespace nav2_costmap_2d
+{
+
+// half a degree per bin of the view of a sensor
+static constexpr unsigned int kViewBins = 720;
+
+static unsigned int viewBin(double dx, double dy)
+{
+  const double bearing = std::atan2(dy, dx) + M_PI;
+  return std::min(kViewBins - 1, static_cast<unsigned int>(bearing * kViewBins / (2 * M_PI)));
+}
+
+void DecayingObstacleLayer::onInitialize()
+{
+  ObstacleLayer::onInitialize();
+
+  declareParameter("decay_time", rclcpp::ParameterValue(5.0));
+  declareParameter("frustum_clearing", rclcpp::ParameterValue(false));
+  declareParameter("frustum_decay_time", rclcpp::ParameterValue(0.5));
+
+  node_->get_parameter(name_ + "." + "decay_time", decay_time_);
+  node_->get_parameter(name_ + "." + "frustum_clearing", frustum_clearing_);
+  node_->get_parameter(name_ + "." + "frustum_decay_time", frustum_decay_time_);
+}
+
+void DecayingObstacleLayer::reset()
+{
+  ObstacleLayer::reset();
+  marks_.clear();
+}
+
+void DecayingObstacleLayer::matchSize()
+{
+  ObstacleLayer::matchSize();
+  marks_.clear();
+  cell_origin_x_ = 0;
+  cell_origin_y_ = 0;
+}
+
+void DecayingObstacleLayer::updateOrigin(double new_origin_x, double new_origin_y)
+{
+  // the whole cells Costmap2D::updateOrigin moves the grid by
+  cell_origin_x_ += static_cast<int>((new_origin_x - origin_x_) / resolution_);
+  cell_origin_y_ += static_cast<int>((new_origin_y - origin_y_) / resolution_);
+  ObstacleLayer::updateOrigin(new_origin_x, new_origin_y);
+}
+
+void DecayingObstacleLayer::updateBounds(
+  double robot_x, double robot_y, double robot_yaw, double * min_x,
+  double * min_y, double * max_x, double * max_y)
+{
+  if (rolling_window_) {
+    updateOrigin(robot_x - getSizeInMetersX() / 2, robot_y - getSizeInMetersY() / 2);
+  }
+  if (!enabled_) {
+    return;
+  }
+  useExtraBounds(min_x, min_y, max_x, max_y);
+
+  bool current = true;
+  std::vector<Observation> observations, clearing_observations;
+  current = current && getMarkingObservations(observations);
+  current = current && getClearingObservations(clearing_observations);
+  current_ = current;
+
+  const double now = node_->now().seconds();
+  for (const auto & obs : observations) {
+    markObservation(obs, now, min_x, min_y, max_x, max_y);
+  }
+
+  views_.resize(frustum_clearing_ ? clearing_observations.size() : 0);
+  for (unsigned int i = 0; i < views_.size(); ++i) {
+    buildView(clearing_observations[i], views_[i]);
+  }
+
+  // expire the marks not seen for long enough, visiting only the marked cells
+  for (auto it = marks_.begin(); it != marks_.end(); ) {
+    const Mark & mark = it->second;
+    const int64_t mx = mark.x - cell_origin_x_;
+    const int64_t my = mark.y - cell_origin_y_;
+    if (mx < 0 || my < 0 || mx >= size_x_ || my >= size_y_) {
+      // the window moved off the cell, dropping it already
+      it = marks_.erase(it);
+      continue;
+    }
+
+    const double age = now - mark.last_seen;
+    const double wx = origin_x_ + (mx + 0.5) * resolution_;
+    const double wy = origin_y_ + (my + 0.5) * resolution_;
+    const bool expired = age > decay_time_ ||
+      (frustum_clearing_ && age > frustum_decay_time_ && isVisible(wx, wy));
+    if (!expired) {
+      ++it;
+      continue;
+    }
+    costmap_[getIndex(mx, my)] = FREE_SPACE;
+    touch(wx, wy, min_x, min_y, max_x, max_y);
+    it = marks_.erase(it);
+  }
+
+  updateFootprint(robot_x, robot_y, robot_yaw, min_x, min_y, max_x, max_y);
+}
+
+void DecayingObstacleLayer::markObservation(
+  const Observation & obs, double now,
+  double * min_x, double * min_y, double * max_x, double * max_y)
+{
+  const sensor_msgs::msg::PointCloud2 & cloud = *(obs.cloud_);
+  const double sq_obstacle_range = obs.obstacle_range_ * obs.obstacle_range_;
+
+  sensor_msgs::PointCloud2ConstIterator<float> iter_x(cloud, "x");
+  sensor_msgs::PointCloud2ConstIterator<float> iter_y(cloud, "y");
+  sensor_msgs::PointCloud2ConstIterator<float> iter_z(cloud, "z");
+
+  for (; iter_x != iter_x.end(); ++iter_x, ++iter_y, ++iter_z) {
+    const double px = *iter_x, py = *iter_y, pz = *iter_z;
+    if (pz > max_obstacle_height_) {
+      continue;
+    }
+    const double sq_dist = (px - obs.origin_.x) * (px - obs.origin_.x) +
+      (py - obs.origin_.y) * (py - obs.origin_.y) + (pz - obs.origin_.z) * (pz - obs.origin_.z);
+    if (sq_dist >= sq_obstacle_range) {
+      continue;
+    }
+
+    unsigned int mx, my;
+    if (!worldToMap(px, py, mx, my)) {
+      continue;
+    }
+    const int64_t x = cell_origin_x_ + mx;
+    const int64_t y = cell_origin_y_ + my;
+    Mark & mark = marks_[key(x, y)];
+    mark.x = x;
+    mark.y = y;
+    mark.last_seen = now;
+    costmap_[getIndex(mx, my)] = LETHAL_OBSTACLE;
+    touch(px, py, min_x, min_y, max_x, max_y);
+  }
+}
+
+void DecayingObstacleLayer::buildView(const Observation & obs, View & view) const
+{
+  view.ox = obs.origin_.x;
+  view.oy = obs.origin_.y;
+  view.ranges.assign(kViewBins, 0.0);
+
+  const sensor_msgs::msg::PointCloud2 & cloud = *(obs.cloud_);
+  sensor_msgs::PointCloud2ConstIterator<float> iter_x(cloud, "x");
+  sensor_msgs::PointCloud2ConstIterator<float> iter_y(cloud, "y");
+  for (; iter_x != iter_x.end(); ++iter_x, ++iter_y) {
+    const double dx = *iter_x - view.ox;
+    const double dy = *iter_y - view.oy;
+    const double range = std::min(std::hypot(dx, dy), obs.raytrace_range_);
+    double & seen = view.ranges[viewBin(dx, dy)];
+    seen = std::max(seen, range);
+  }
+}
+
+bool DecayingObstacleLayer::isVisible(double wx, double wy) const
+{
+  for (const auto & view : views_) {
+    const double dx = wx - view.ox;
+    const double dy = wy - view.oy;
+    // a cell the sensor saw past, not the one its farthest point is in
+    if (std::hypot(dx, dy) + resolution_ < view.ranges[viewBin(dx, dy)]) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace nav2_costmap_2d
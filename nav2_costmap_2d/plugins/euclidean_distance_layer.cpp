@@ -0,0 +1,81 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_costmap_2d/euclidean_distance_layer.hpp"
+
+#include <algorithm>
+#include <memory>
+
+#include "pluginlib/class_list_macros.hpp"
+
+PLUGINLIB_EXPORT_CLASS(nav2_costmap_2d::EuclideanDistanceLayer, nav2_costmap_2d::Layer)
+
+namespace nav2_costmap_2d
+{
+
+EuclideanDistanceLayer::EuclideanDistanceLayer()
+{
+}
+
+EuclideanDistanceLayer::~EuclideanDistanceLayer()
+{
+}
+
+void
+EuclideanDistanceLayer::onInitialize()
+{
+  int num_threads = 0;
+  declareParameter("enabled", rclcpp::ParameterValue(true));
+  declareParameter("num_threads", rclcpp::ParameterValue(0));
+
+  node_->get_parameter(name_ + "." + "enabled", enabled_);
+  node_->get_parameter(name_ + "." + "num_threads", num_threads);
+
+  distance_field_ = std::make_shared<DistanceField>(std::max(0, num_threads));
+  if (enabled_) {
+    layered_costmap_->setDistanceField(distance_field_);
+  }
+  current_ = true;
+}
+
+void
+EuclideanDistanceLayer::activate()
+{
+  if (enabled_) {
+    layered_costmap_->setDistanceField(distance_field_);
+  }
+}
+
+void
+EuclideanDistanceLayer::deactivate()
+{
+  layered_costmap_->setDistanceField(nullptr);
+}
+
+void
+EuclideanDistanceLayer::updateBounds(
+  double /*robot_x*/, double /*robot_y*/, double /*robot_yaw*/, double * /*min_x*/,
+  double * /*min_y*/, double * /*max_x*/, double * /*max_y*/)
+{
+}
+
+void
+EuclideanDistanceLayer::updateCosts(
+  nav2_costmap_2d::Costmap2D & /*master_grid*/,
+  int /*min_i*/, int /*min_j*/, int /*max_i*/, int /*max_j*/)
+{
+  // Nothing to combine, the field is measured from the finished master grid
+}
+
+}  // namespace nav2_costmap_2d
@@ -39,7 +39,9 @@
 
 #include <algorithm>
 #include <limits>
+#include <list>
 #include <map>
+#include <string>
 #include <vector>
 
 #include "nav2_costmap_2d/costmap_math.hpp"
@@ -52,10 +54,15 @@ PLUGINLIB_EXPORT_CLASS(nav2_costmap_2d::InflationLayer, nav2_costmap_2d::Layer)
 using nav2_costmap_2d::LETHAL_OBSTACLE;
 using nav2_costmap_2d::INSCRIBED_INFLATED_OBSTACLE;
 using nav2_costmap_2d::NO_INFORMATION;
+using rcl_interfaces::msg::ParameterType;
+using std::placeholders::_1;
 
 namespace nav2_costmap_2d
 {
 
+constexpr unsigned int InflationLayer::NO_SOURCE;
+constexpr unsigned int InflationLayer::OUT_OF_RADIUS;
+
 InflationLayer::InflationLayer()
 : inflation_radius_(0),
   inscribed_radius_(0),
@@ -63,12 +70,21 @@ InflationLayer::InflationLayer()
   inflate_unknown_(false),
   cell_inflation_radius_(0),
   cached_cell_inflation_radius_(0),
-  cached_costs_(nullptr),
-  cached_distances_(nullptr),
+  engine_(InflationEngine::Bucket),
+  generation_(0),
+  incremental_valid_(false),
+  last_origin_x_(0.0),
+  last_origin_y_(0.0),
+  tile_seed_min_i_(0),
+  tile_seed_min_j_(0),
+  tile_seed_max_i_(0),
+  tile_seed_max_j_(0),
+  kernel_costs_(nullptr),
   last_min_x_(-std::numeric_limits<float>::max()),
   last_min_y_(-std::numeric_limits<float>::max()),
   last_max_x_(std::numeric_limits<float>::max()),
-  last_max_y_(std::numeric_limits<float>::max())
+  last_max_y_(std::numeric_limits<float>::max()),
+  parameters_changed_(false)
 {
 }
 
@@ -79,17 +95,126 @@ InflationLayer::onInitialize()
   declareParameter("inflation_radius", rclcpp::ParameterValue(0.55));
   declareParameter("cost_scaling_factor", rclcpp::ParameterValue(10.0));
   declareParameter("inflate_unknown", rclcpp::ParameterValue(false));
+  declareParameter("inflation_engine", rclcpp::ParameterValue(std::string("bucket")));
+  declareParameter("inflation_threads", rclcpp::ParameterValue(1));
 
   node_->get_parameter(name_ + "." + "enabled", enabled_);
   node_->get_parameter(name_ + "." + "inflation_radius", inflation_radius_);
   node_->get_parameter(name_ + "." + "cost_scaling_factor", cost_scaling_factor_);
   node_->get_parameter(name_ + "." + "inflate_unknown", inflate_unknown_);
+  node_->get_parameter(name_ + "." + "inflation_engine", inflation_engine_);
+  int inflation_threads;
+  node_->get_parameter(name_ + "." + "inflation_threads", inflation_threads);
+
+  if (inflation_engine_ == "map") {
+    engine_ = InflationEngine::Map;
+  } else if (inflation_engine_ == "incremental") {
+    engine_ = InflationEngine::Incremental;
+  } else {
+    if (inflation_engine_ != "bucket") {
+      RCLCPP_WARN(
+        node_->get_logger(),
+        "InflationLayer: unknown inflation_engine '%s', using 'bucket'",
+        inflation_engine_.c_str());
+    }
+    engine_ = InflationEngine::Bucket;
+  }
+
+  // the incremental engine keeps state across the whole grid, which stripes cannot share
+  inflation_pool_.reset();
+  if (inflation_threads != 1 && engine_ != InflationEngine::Incremental) {
+    // 0 uses one thread per core
+    inflation_pool_ = std::make_unique<nav2_util::ThreadPool>(std::max(0, inflation_threads));
+  }
 
   current_ = true;
   seen_.clear();
+  seen_generation_.clear();
   need_reinflation_ = false;
   cell_inflation_radius_ = cellDistance(inflation_radius_);
   matchSize();
+
+  // Setup callback for changes to parameters.
+  parameters_ = {enabled_, inflate_unknown_, inflation_radius_, cost_scaling_factor_};
+  parameters_changed_ = false;
+  parameters_client_ = std::make_shared<rclcpp::AsyncParametersClient>(
+    node_->get_node_base_interface(),
+    node_->get_node_topics_interface(),
+    node_->get_node_graph_interface(),
+    node_->get_node_services_interface());
+
+  parameter_event_sub_ = parameters_client_->on_parameter_event(
+    std::bind(&InflationLayer::on_parameter_event_callback, this, _1));
+}
+
+void
+InflationLayer::on_parameter_event_callback(
+  const rcl_interfaces::msg::ParameterEvent::SharedPtr event)
+{
+  // every costmap of the process may have a layer of this name
+  if (event->node != node_->get_fully_qualified_name()) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(parameters_mutex_);
+  for (auto & changed_parameter : event->changed_parameters) {
+    const auto & type = changed_parameter.value.type;
+    const auto & name = changed_parameter.name;
+    const auto & value = changed_parameter.value;
+
+    if (type == ParameterType::PARAMETER_DOUBLE) {
+      if (name == name_ + ".inflation_radius") {
+        parameters_.inflation_radius = value.double_value;
+      } else if (name == name_ + ".cost_scaling_factor") {
+        parameters_.cost_scaling_factor = value.double_value;
+      } else {
+        continue;
+      }
+    } else if (type == ParameterType::PARAMETER_BOOL) {
+      if (name == name_ + ".enabled") {
+        parameters_.enabled = value.bool_value;
+      } else if (name == name_ + ".inflate_unknown") {
+        parameters_.inflate_unknown = value.bool_value;
+      } else {
+        continue;
+      }
+    } else {
+      continue;
+    }
+    parameters_changed_ = true;
+  }
+}
+
+void
+InflationLayer::applyParameterChanges()
+{
+  std::lock_guard<std::mutex> lock(parameters_mutex_);
+  if (!parameters_changed_) {
+    return;
+  }
+  parameters_changed_ = false;
+
+  if (parameters_.inflation_radius != inflation_radius_ ||
+    parameters_.cost_scaling_factor != cost_scaling_factor_)
+  {
+    inflation_radius_ = parameters_.inflation_radius;
+    cost_scaling_factor_ = parameters_.cost_scaling_factor;
+    cell_inflation_radius_ = cellDistance(inflation_radius_);
+    computeCaches();
+  } else if (parameters_.enabled == enabled_ && parameters_.inflate_unknown == inflate_unknown_) {
+    return;
+  }
+  enabled_ = parameters_.enabled;
+  inflate_unknown_ = parameters_.inflate_unknown;
+
+  // every inflated cell may have changed, so the incremental field is stale too
+  need_reinflation_ = true;
+  incremental_valid_ = false;
+
+  RCLCPP_INFO(
+    node_->get_logger(), "InflationLayer: %s now enabled: %d, inflation_radius: %.3f,"
+    " cost_scaling_factor: %.3f, inflate_unknown: %d", name_.c_str(), enabled_,
+    inflation_radius_, cost_scaling_factor_, inflate_unknown_);
 }
 
 void
@@ -99,7 +224,23 @@ InflationLayer::matchSize()
   resolution_ = costmap->getResolution();
   cell_inflation_radius_ = cellDistance(inflation_radius_);
   computeCaches();
-  seen_ = std::vector<bool>(costmap->getSizeInCellsX() * costmap->getSizeInCellsY(), false);
+  resetSeen(costmap->getSizeInCellsX() * costmap->getSizeInCellsY());
+}
+
+void
+InflationLayer::resetSeen(unsigned int size)
+{
+  // Only the engine in use keeps a per-cell visited array
+  seen_.clear();
+  seen_generation_.clear();
+  if (engine_ == InflationEngine::Bucket) {
+    seen_generation_ = std::vector<unsigned int>(size, 0);
+    generation_ = 0;
+  } else if (engine_ == InflationEngine::Map) {
+    seen_ = std::vector<bool>(size, false);
+  }
+  // the incremental engine sizes its state on the next full rebuild
+  incremental_valid_ = false;
 }
 
 void
@@ -107,6 +248,8 @@ InflationLayer::updateBounds(
   double /*robot_x*/, double /*robot_y*/, double /*robot_yaw*/, double * min_x,
   double * min_y, double * max_x, double * max_y)
 {
+  applyParameterChanges();
+
   if (need_reinflation_) {
     last_min_x_ = *min_x;
     last_min_y_ = *min_y;
@@ -139,8 +282,16 @@ InflationLayer::updateBounds(
 void
 InflationLayer::onFootprintChanged()
 {
-  inscribed_radius_ = layered_costmap_->getInscribedRadius();
-  cell_inflation_radius_ = cellDistance(inflation_radius_);
+  double inscribed_radius = layered_costmap_->getInscribedRadius();
+  unsigned int cell_inflation_radius = cellDistance(inflation_radius_);
+  if (kernel_costs_ != nullptr && inscribed_radius == inscribed_radius_ &&
+    cell_inflation_radius == cell_inflation_radius_)
+  {
+    // a footprint of the same inscribed radius inflates exactly the same
+    return;
+  }
+  inscribed_radius_ = inscribed_radius;
+  cell_inflation_radius_ = cell_inflation_radius;
   computeCaches();
   need_reinflation_ = true;
 
@@ -158,26 +309,19 @@ InflationLayer::updateCosts(
   int max_j)
 {
   if (!enabled_ || (cell_inflation_radius_ == 0)) {
+    // changes made while disabled are not tracked by the incremental engine
+    incremental_valid_ = false;
     return;
   }
 
-  // make sure the inflation list is empty at the beginning of the cycle (should always be true)
-  RCLCPP_FATAL_EXPRESSION(
-    rclcpp::get_logger("nav2_costmap_2d"),
-    !inflation_cells_.empty(), "The inflation list must be empty at the beginning of inflation");
+  if (inflation_pool_) {
+    inflateInStripes(master_grid, min_i, min_j, max_i, max_j);
+    return;
+  }
 
   unsigned char * master_array = master_grid.getCharMap();
   unsigned int size_x = master_grid.getSizeInCellsX(), size_y = master_grid.getSizeInCellsY();
 
-  if (seen_.size() != size_x * size_y) {
-    RCLCPP_WARN(
-      rclcpp::get_logger(
-        "nav2_costmap_2d"), "InflationLayer::updateCosts(): seen_ vector size is wrong");
-    seen_ = std::vector<bool>(size_x * size_y, false);
-  }
-
-  std::fill(begin(seen_), end(seen_), false);
-
   // We need to include in the inflation cells outside the bounding
   // box min_i...max_j, by the amount cell_inflation_radius_.  Cells
   // up to that distance outside the box can still influence the costs
@@ -192,16 +336,197 @@ InflationLayer::updateCosts(
   max_i = std::min(static_cast<int>(size_x), max_i);
   max_j = std::min(static_cast<int>(size_y), max_j);
 
+  switch (engine_) {
+    case InflationEngine::Map:
+      inflateWithPriorityMap(master_array, size_x, size_y, min_i, min_j, max_i, max_j);
+      break;
+    case InflationEngine::Incremental:
+      inflateIncrementally(master_grid, min_i, min_j, max_i, max_j);
+      break;
+    default:
+      inflateWithBuckets(master_array, size_x, size_y, min_i, min_j, max_i, max_j);
+      break;
+  }
+}
+
+void
+InflationLayer::prepareTiledUpdate(
+  nav2_costmap_2d::Costmap2D & master_grid, int min_i, int min_j,
+  int max_i,
+  int max_j)
+{
+  unsigned char * master_array = master_grid.getCharMap();
+  int size_x = master_grid.getSizeInCellsX(), size_y = master_grid.getSizeInCellsY();
+
+  // Same halo as updateCosts(): obstacles up to cell_inflation_radius_
+  // outside the bounds still influence the costs inside them
+  tile_seed_min_i_ = std::max(0, min_i - static_cast<int>(cell_inflation_radius_));
+  tile_seed_min_j_ = std::max(0, min_j - static_cast<int>(cell_inflation_radius_));
+  tile_seed_max_i_ = std::min(size_x, max_i + static_cast<int>(cell_inflation_radius_));
+  tile_seed_max_j_ = std::min(size_y, max_j + static_cast<int>(cell_inflation_radius_));
+
+  int width = tile_seed_max_i_ - tile_seed_min_i_;
+  tile_seeds_.assign(width * (tile_seed_max_j_ - tile_seed_min_j_), 0);
+  for (int j = tile_seed_min_j_; j < tile_seed_max_j_; j++) {
+    const unsigned char * row = master_array + j * size_x;
+    unsigned char * seed_row = tile_seeds_.data() + (j - tile_seed_min_j_) * width;
+    for (int i = tile_seed_min_i_; i < tile_seed_max_i_; i++) {
+      seed_row[i - tile_seed_min_i_] = row[i] == LETHAL_OBSTACLE;
+    }
+  }
+}
+
+void
+InflationLayer::updateCostsTile(
+  nav2_costmap_2d::Costmap2D & master_grid, int min_i, int min_j,
+  int max_i,
+  int max_j)
+{
+  unsigned char * master_array = master_grid.getCharMap();
+  int size_x = master_grid.getSizeInCellsX(), size_y = master_grid.getSizeInCellsY();
+  const int radius = static_cast<int>(cell_inflation_radius_);
+
+  // Obstacles within the inflation radius of the tile seed it...
+  int seed_min_i = std::max(tile_seed_min_i_, min_i - radius);
+  int seed_min_j = std::max(tile_seed_min_j_, min_j - radius);
+  int seed_max_i = std::min(tile_seed_max_i_, max_i + radius);
+  int seed_max_j = std::min(tile_seed_max_j_, max_j + radius);
+
+  // ...and their inflation may pass through cells up to twice that far away.
+  // Visited cells are tracked in a local window, so tiles share no state.
+  int win_min_i = std::max(0, min_i - 2 * radius - 1);
+  int win_min_j = std::max(0, min_j - 2 * radius - 1);
+  int win_max_i = std::min(size_x, max_i + 2 * radius + 1);
+  int win_max_j = std::min(size_y, max_j + 2 * radius + 1);
+  int win_width = win_max_i - win_min_i;
+
+  thread_local std::vector<unsigned char> visited;
+  thread_local std::vector<std::vector<CellData>> buckets;
+  visited.assign(win_width * (win_max_j - win_min_j), 0);
+  buckets.resize(inflation_buckets_.size());
+
+  int seed_width = tile_seed_max_i_ - tile_seed_min_i_;
+  for (int j = seed_min_j; j < seed_max_j; j++) {
+    const unsigned char * seed_row = tile_seeds_.data() + (j - tile_seed_min_j_) * seed_width;
+    for (int i = seed_min_i; i < seed_max_i; i++) {
+      if (seed_row[i - tile_seed_min_i_]) {
+        buckets[0].push_back(CellData(j * size_x + i, i, j, i, j));
+      }
+    }
+  }
+
+  auto enqueue_local = [&](
+    unsigned int index, int mx, int my, unsigned int src_x, unsigned int src_y) {
+      if (visited[(my - win_min_j) * win_width + (mx - win_min_i)]) {
+        return;
+      }
+      unsigned int bucket = bucketLookup(mx, my, src_x, src_y);
+      if (bucket == OUT_OF_RADIUS) {
+        return;
+      }
+      buckets[bucket].push_back(CellData(index, mx, my, src_x, src_y));
+    };
+
+  for (unsigned int b = 0; b < buckets.size(); ++b) {
+    for (unsigned int n = 0; n < buckets[b].size(); ++n) {
+      const CellData cell = buckets[b][n];
+      int mx = cell.x_;
+      int my = cell.y_;
+      unsigned char & seen = visited[(my - win_min_j) * win_width + (mx - win_min_i)];
+      if (seen) {
+        continue;
+      }
+      seen = 1;
+
+      unsigned int index = cell.index_;
+      unsigned int sx = cell.src_x_;
+      unsigned int sy = cell.src_y_;
+
+      // neighbouring tiles own the cells outside of this one
+      if (mx >= min_i && mx < max_i && my >= min_j && my < max_j) {
+        applyCost(master_array, index, costLookup(mx, my, sx, sy));
+      }
+
+      if (mx > win_min_i) {
+        enqueue_local(index - 1, mx - 1, my, sx, sy);
+      }
+      if (my > win_min_j) {
+        enqueue_local(index - size_x, mx, my - 1, sx, sy);
+      }
+      if (mx < win_max_i - 1) {
+        enqueue_local(index + 1, mx + 1, my, sx, sy);
+      }
+      if (my < win_max_j - 1) {
+        enqueue_local(index + size_x, mx, my + 1, sx, sy);
+      }
+    }
+  }
+
+  for (auto & bucket : buckets) {
+    bucket.clear();
+  }
+}
+
+void
+InflationLayer::inflateInStripes(
+  nav2_costmap_2d::Costmap2D & master_grid,
+  int min_i, int min_j, int max_i, int max_j)
+{
+  min_i = std::max(0, min_i);
+  min_j = std::max(0, min_j);
+  max_i = std::min(static_cast<int>(master_grid.getSizeInCellsX()), max_i);
+  max_j = std::min(static_cast<int>(master_grid.getSizeInCellsY()), max_j);
+  const int height = max_j - min_j;
+  if (max_i <= min_i || height <= 0) {
+    return;
+  }
+
+  // The stripes are the tiles of a tiled update spanning the whole width: they share
+  // the snapshot of the lethal cells and write disjoint rows, raising the costs there
+  // as any other inflation does. Stripes thinner than twice the radius would mostly
+  // inflate their halos, and two per thread even out stripes with more obstacles.
+  prepareTiledUpdate(master_grid, min_i, min_j, max_i, max_j);
+  const int min_height = std::max(1, 2 * static_cast<int>(cell_inflation_radius_));
+  const int stripes = std::max(
+    1, std::min(static_cast<int>(2 * inflation_pool_->size()), height / min_height));
+  const int stripe_height = (height + stripes - 1) / stripes;
+
+  inflation_pool_->parallel_for(
+    stripes, [&](std::size_t stripe) {
+      int y0 = min_j + static_cast<int>(stripe) * stripe_height;
+      updateCostsTile(master_grid, min_i, y0, max_i, std::min(y0 + stripe_height, max_j));
+    });
+}
+
+void
+InflationLayer::inflateWithPriorityMap(
+  unsigned char * master_array, unsigned int size_x, unsigned int size_y,
+  int min_i, int min_j, int max_i, int max_j)
+{
+  // make sure the inflation list is empty at the beginning of the cycle (should always be true)
+  RCLCPP_FATAL_EXPRESSION(
+    rclcpp::get_logger("nav2_costmap_2d"),
+    !inflation_cells_.empty(), "The inflation list must be empty at the beginning of inflation");
+
+  if (seen_.size() != size_x * size_y) {
+    RCLCPP_WARN(
+      rclcpp::get_logger(
+        "nav2_costmap_2d"), "InflationLayer::updateCosts(): seen_ vector size is wrong");
+    seen_ = std::vector<bool>(size_x * size_y, false);
+  }
+
+  std::fill(begin(seen_), end(seen_), false);
+
   // Inflation list; we append cells to visit in a list associated with
   // its distance to the nearest obstacle
   // We use a map<distance, list> to emulate the priority queue used before,
   // with a notable performance boost
 
-  // Start with lethal obstacles: by definition distance is 0.0
-  std::vector<CellData> & obs_bin = inflation_cells_[0.0];
+  // Start with lethal obstacles: by definition distance is 0
+  std::vector<CellData> & obs_bin = inflation_cells_[0];
   for (int j = min_j; j < max_j; j++) {
     for (int i = min_i; i < max_i; i++) {
-      int index = master_grid.getIndex(i, j);
+      int index = j * size_x + i;
       unsigned char cost = master_array[index];
       if (cost == LETHAL_OBSTACLE) {
         obs_bin.push_back(CellData(index, i, j, i, j));
@@ -212,7 +537,7 @@ InflationLayer::updateCosts(
   // Process cells by increasing distance; new cells are appended to the
   // corresponding distance bin, so they
   // can overtake previously inserted but farther away cells
-  std::map<double, std::vector<CellData>>::iterator bin;
+  std::map<unsigned int, std::vector<CellData>>::iterator bin;
   for (bin = inflation_cells_.begin(); bin != inflation_cells_.end(); ++bin) {
     for (unsigned int i = 0; i < bin->second.size(); ++i) {
       // process all cells at distance dist_bin.first
@@ -233,15 +558,7 @@ InflationLayer::updateCosts(
       unsigned int sy = cell.src_y_;
 
       // assign the cost associated with the distance from an obstacle to the cell
-      unsigned char cost = costLookup(mx, my, sx, sy);
-      unsigned char old_cost = master_array[index];
-      if (old_cost == NO_INFORMATION &&
-        (inflate_unknown_ ? (cost > FREE_SPACE) : (cost >= INSCRIBED_INFLATED_OBSTACLE)))
-      {
-        master_array[index] = cost;
-      } else {
-        master_array[index] = std::max(old_cost, cost);
-      }
+      applyCost(master_array, index, costLookup(mx, my, sx, sy));
 
       // attempt to put the neighbors of the current cell onto the inflation list
       if (mx > 0) {
@@ -262,6 +579,198 @@ InflationLayer::updateCosts(
   inflation_cells_.clear();
 }
 
+void
+InflationLayer::inflateWithBuckets(
+  unsigned char * master_array, unsigned int size_x, unsigned int size_y,
+  int min_i, int min_j, int max_i, int max_j)
+{
+  if (seen_generation_.size() != size_x * size_y) {
+    RCLCPP_WARN(
+      rclcpp::get_logger(
+        "nav2_costmap_2d"), "InflationLayer::updateCosts(): seen_ vector size is wrong");
+    seen_generation_ = std::vector<unsigned int>(size_x * size_y, 0);
+    generation_ = 0;
+  }
+
+  // Advancing the generation invalidates every visited mark at once; the
+  // array only has to be cleared when the counter wraps around
+  if (++generation_ == 0) {
+    std::fill(seen_generation_.begin(), seen_generation_.end(), 0);
+    generation_ = 1;
+  }
+
+  // Start with lethal obstacles: by definition they are in bucket 0
+  std::vector<CellData> & obs_bin = inflation_buckets_[0];
+  for (int j = min_j; j < max_j; j++) {
+    for (int i = min_i; i < max_i; i++) {
+      int index = j * size_x + i;
+      if (master_array[index] == LETHAL_OBSTACLE) {
+        obs_bin.push_back(CellData(index, i, j, i, j));
+      }
+    }
+  }
+
+  // Process buckets by increasing distance; new cells are appended to the
+  // bucket of their distance, so they can overtake previously inserted but
+  // farther away cells. As with the map engine, a cell appended to a bucket
+  // that was already processed is dropped.
+  for (unsigned int b = 0; b < inflation_buckets_.size(); ++b) {
+    std::vector<CellData> & bucket = inflation_buckets_[b];
+    for (unsigned int i = 0; i < bucket.size(); ++i) {
+      // copy out, the bucket may grow (and reallocate) while enqueueing
+      const CellData cell = bucket[i];
+      unsigned int index = cell.index_;
+
+      // ignore if already visited
+      if (seen_generation_[index] == generation_) {
+        continue;
+      }
+
+      seen_generation_[index] = generation_;
+
+      unsigned int mx = cell.x_;
+      unsigned int my = cell.y_;
+      unsigned int sx = cell.src_x_;
+      unsigned int sy = cell.src_y_;
+
+      // assign the cost associated with the distance from an obstacle to the cell
+      applyCost(master_array, index, costLookup(mx, my, sx, sy));
+
+      // attempt to put the neighbors of the current cell onto the inflation list,
+      // which are all on the grid unless the cell is on its border
+      if (mx - 1 < size_x - 2 && my - 1 < size_y - 2) {
+        enqueueNeighbours<false>(index, mx, my, sx, sy, size_x, size_y);
+      } else {
+        enqueueNeighbours<true>(index, mx, my, sx, sy, size_x, size_y);
+      }
+    }
+  }
+
+  // clear() keeps the capacity, so steady-state cycles do not allocate
+  for (auto & bucket : inflation_buckets_) {
+    bucket.clear();
+  }
+}
+
+void
+InflationLayer::inflateIncrementally(
+  nav2_costmap_2d::Costmap2D & master_grid,
+  int min_i, int min_j, int max_i, int max_j)
+{
+  unsigned char * master_array = master_grid.getCharMap();
+  int size_x = master_grid.getSizeInCellsX(), size_y = master_grid.getSizeInCellsY();
+
+  // Obstacles are only compared against the previous cycle within the
+  // (expanded) bounds; outside of them the master grid is untouched. After a
+  // resize, a change of inflation radius or a moved rolling window the field
+  // is rebuilt from every lethal cell of the master grid.
+  int diff_min_i = min_i, diff_min_j = min_j, diff_max_i = max_i, diff_max_j = max_j;
+  if (!incremental_valid_ || nearest_source_.size() != static_cast<size_t>(size_x * size_y) ||
+    master_grid.getOriginX() != last_origin_x_ || master_grid.getOriginY() != last_origin_y_)
+  {
+    nearest_source_.assign(size_x * size_y, NO_SOURCE);
+    obstacle_cells_.assign(size_x * size_y, 0);
+    diff_min_i = 0;
+    diff_min_j = 0;
+    diff_max_i = size_x;
+    diff_max_j = size_y;
+    last_origin_x_ = master_grid.getOriginX();
+    last_origin_y_ = master_grid.getOriginY();
+    incremental_valid_ = true;
+  }
+
+  // Box of the obstacles added or removed since the previous cycle
+  int changed_min_i = size_x, changed_min_j = size_y, changed_max_i = -1, changed_max_j = -1;
+  for (int j = diff_min_j; j < diff_max_j; j++) {
+    for (int i = diff_min_i; i < diff_max_i; i++) {
+      unsigned int index = j * size_x + i;
+      unsigned char lethal = master_array[index] == LETHAL_OBSTACLE;
+      if (lethal != obstacle_cells_[index]) {
+        obstacle_cells_[index] = lethal;
+        changed_min_i = std::min(changed_min_i, i);
+        changed_min_j = std::min(changed_min_j, j);
+        changed_max_i = std::max(changed_max_i, i);
+        changed_max_j = std::max(changed_max_j, j);
+      }
+    }
+  }
+
+  // A cell only depends on the obstacles within the inflation radius of it, so
+  // the nearest obstacles of the changed box grown by that radius are found again,
+  // with the same propagation as a full inflation seeded from one more radius around
+  if (changed_max_i >= 0) {
+    const int radius = cell_inflation_radius_;
+    const int dirty_min_i = std::max(0, changed_min_i - radius);
+    const int dirty_min_j = std::max(0, changed_min_j - radius);
+    const int dirty_max_i = std::min(size_x, changed_max_i + 1 + radius);
+    const int dirty_max_j = std::min(size_y, changed_max_j + 1 + radius);
+    for (int j = dirty_min_j; j < dirty_max_j; j++) {
+      std::fill(
+        nearest_source_.begin() + j * size_x + dirty_min_i,
+        nearest_source_.begin() + j * size_x + dirty_max_i, NO_SOURCE);
+    }
+
+    if (seen_generation_.size() != static_cast<size_t>(size_x * size_y)) {
+      seen_generation_ = std::vector<unsigned int>(size_x * size_y, 0);
+      generation_ = 0;
+    }
+    if (++generation_ == 0) {
+      std::fill(seen_generation_.begin(), seen_generation_.end(), 0);
+      generation_ = 1;
+    }
+
+    std::vector<CellData> & obs_bin = inflation_buckets_[0];
+    for (int j = std::max(0, dirty_min_j - radius); j < std::min(size_y, dirty_max_j + radius);
+      j++)
+    {
+      for (int i = std::max(0, dirty_min_i - radius); i < std::min(size_x, dirty_max_i + radius);
+        i++)
+      {
+        if (obstacle_cells_[j * size_x + i]) {
+          obs_bin.push_back(CellData(j * size_x + i, i, j, i, j));
+        }
+      }
+    }
+
+    // As in inflateWithBuckets(), the first source to reach a cell is its nearest one
+    for (unsigned int b = 0; b < inflation_buckets_.size(); ++b) {
+      std::vector<CellData> & bucket = inflation_buckets_[b];
+      for (unsigned int i = 0; i < bucket.size(); ++i) {
+        const CellData cell = bucket[i];
+        unsigned int index = cell.index_;
+        if (seen_generation_[index] == generation_) {
+          continue;
+        }
+        seen_generation_[index] = generation_;
+
+        int mx = cell.x_;
+        int my = cell.y_;
+        if (mx >= dirty_min_i && mx < dirty_max_i && my >= dirty_min_j && my < dirty_max_j) {
+          nearest_source_[index] = cell.src_y_ * size_x + cell.src_x_;
+        }
+        enqueueNeighbours<true>(index, mx, my, cell.src_x_, cell.src_y_, size_x, size_y);
+      }
+    }
+
+    for (auto & bucket : inflation_buckets_) {
+      bucket.clear();
+    }
+  }
+
+  // The layers below have rewritten the bounds, so the costs are written back
+  // from the distance field there; this pass has no queue and is cheap
+  for (int j = min_j; j < max_j; j++) {
+    for (int i = min_i; i < max_i; i++) {
+      unsigned int index = j * size_x + i;
+      unsigned int src = nearest_source_[index];
+      if (src == NO_SOURCE) {
+        continue;
+      }
+      applyCost(master_array, index, costLookup(i, j, src % size_x, src / size_x));
+    }
+  }
+}
+
 /**
  * @brief  Given an index of a cell in the costmap, place it into a list pending for obstacle inflation
  * @param  grid The costmap
@@ -277,77 +786,121 @@ InflationLayer::enqueue(
   unsigned int src_x, unsigned int src_y)
 {
   if (!seen_[index]) {
-    // we compute our distance table one cell further than the
-    // inflation radius dictates so we can make the check below
-    double distance = distanceLookup(mx, my, src_x, src_y);
+    unsigned int sq_distance = sqDistance(mx, my, src_x, src_y);
 
     // we only want to put the cell in the list if it is within
     // the inflation radius of the obstacle point
-    if (distance > cell_inflation_radius_) {
+    if (sq_distance > cell_inflation_radius_ * cell_inflation_radius_) {
       return;
     }
 
     // push the cell data onto the inflation list and mark
-    inflation_cells_[distance].push_back(CellData(index, mx, my, src_x, src_y));
+    inflation_cells_[sq_distance].push_back(CellData(index, mx, my, src_x, src_y));
+  }
+}
+
+/**
+ * @brief  Same as enqueue(), but places the cell into the bucket of its
+ *         squared cell distance instead of the distance-keyed map
+ */
+void
+InflationLayer::enqueueBucket(
+  unsigned int index, unsigned int mx, unsigned int my,
+  unsigned int src_x, unsigned int src_y)
+{
+  if (seen_generation_[index] != generation_) {
+    // the kernel is one cell larger than the inflation radius, so a single
+    // step past the radius is still a valid lookup
+    unsigned int bucket = bucketLookup(mx, my, src_x, src_y);
+    if (bucket == OUT_OF_RADIUS) {
+      return;
+    }
+
+    inflation_buckets_[bucket].push_back(CellData(index, mx, my, src_x, src_y));
   }
 }
 
 void
 InflationLayer::computeCaches()
 {
+  layered_costmap_->setFineCostInflation(
+    inscribed_radius_, cost_scaling_factor_, cell_inflation_radius_ == 0 ? 0.0 : inflation_radius_);
+
   if (cell_inflation_radius_ == 0) {
     return;
   }
 
-  // based on the inflation radius... compute distance and cost caches
-  if (cell_inflation_radius_ != cached_cell_inflation_radius_) {
-    deleteKernels();
-
-    cached_costs_ = new unsigned char *[cell_inflation_radius_ + 2];
-    cached_distances_ = new double *[cell_inflation_radius_ + 2];
-
-    for (unsigned int i = 0; i <= cell_inflation_radius_ + 1; ++i) {
-      cached_costs_[i] = new unsigned char[cell_inflation_radius_ + 2];
-      cached_distances_[i] = new double[cell_inflation_radius_ + 2];
-      for (unsigned int j = 0; j <= cell_inflation_radius_ + 1; ++j) {
-        cached_distances_[i][j] = hypot(i, j);
+  // based on the inflation radius... compute the flat cost kernel and bucket table,
+  // one cell larger than the radius so the neighbours of the cells inside it can be looked up
+  cached_cell_inflation_radius_ = cell_inflation_radius_;
+  const unsigned int stride = cell_inflation_radius_ + 2;
+  auto kernel = std::find_if(
+    cost_kernels_.begin(), cost_kernels_.end(), [this](const CostKernel & k) {
+      return k.inscribed_radius == inscribed_radius_ &&
+      k.cost_scaling_factor == cost_scaling_factor_ && k.resolution == resolution_ &&
+      k.cell_inflation_radius == cell_inflation_radius_;
+    });
+  if (kernel != cost_kernels_.end()) {
+    cost_kernels_.splice(cost_kernels_.begin(), cost_kernels_, kernel);
+  } else {
+    CostKernel k{inscribed_radius_, cost_scaling_factor_, resolution_, cell_inflation_radius_,
+      std::vector<unsigned char>(stride * stride)};
+    for (unsigned int i = 0; i < stride; ++i) {
+      for (unsigned int j = 0; j < stride; ++j) {
+        k.costs[i * stride + j] = computeCost(hypot(i, j));
       }
     }
-
-    cached_cell_inflation_radius_ = cell_inflation_radius_;
-  }
-
-  for (unsigned int i = 0; i <= cell_inflation_radius_ + 1; ++i) {
-    for (unsigned int j = 0; j <= cell_inflation_radius_ + 1; ++j) {
-      cached_costs_[i][j] = computeCost(cached_distances_[i][j]);
+    cost_kernels_.push_front(std::move(k));
+    if (cost_kernels_.size() > MAX_COST_KERNELS) {
+      cost_kernels_.pop_back();
     }
   }
+  // list nodes stay put, so the kernel in use is read in place
+  kernel_costs_ = cost_kernels_.front().costs.data();
+
+  computeBuckets();
 }
 
 void
-InflationLayer::deleteKernels()
+InflationLayer::computeBuckets()
 {
-  if (cached_distances_ != NULL) {
-    for (unsigned int i = 0; i <= cached_cell_inflation_radius_ + 1; ++i) {
-      if (cached_distances_[i]) {
-        delete[] cached_distances_[i];
+  // Cell distances are ordered exactly like the integer squared distances
+  // dx * dx + dy * dy, so each distinct squared distance within the
+  // inflation radius gets its own bucket, numbered in increasing order
+  const unsigned int stride = cell_inflation_radius_ + 2;
+  const unsigned int max_sq_dist = cell_inflation_radius_ * cell_inflation_radius_;
+  std::vector<unsigned int> sq_to_bucket(max_sq_dist + 1, 0);
+  for (unsigned int i = 0; i < stride; ++i) {
+    for (unsigned int j = 0; j < stride; ++j) {
+      unsigned int sq_dist = i * i + j * j;
+      if (sq_dist <= max_sq_dist) {
+        sq_to_bucket[sq_dist] = 1;
       }
     }
-    if (cached_distances_) {
-      delete[] cached_distances_;
+  }
+
+  unsigned int num_buckets = 0;
+  for (unsigned int d = 0; d <= max_sq_dist; ++d) {
+    if (sq_to_bucket[d]) {
+      sq_to_bucket[d] = num_buckets++;
     }
-    cached_distances_ = NULL;
   }
 
-  if (cached_costs_ != NULL) {
-    for (unsigned int i = 0; i <= cached_cell_inflation_radius_ + 1; ++i) {
-      if (cached_costs_[i]) {
-        delete[] cached_costs_[i];
+  // Cells beyond the radius are never enqueued, their entry says so
+  cached_buckets_.assign(stride * stride, OUT_OF_RADIUS);
+  for (unsigned int i = 0; i < stride; ++i) {
+    for (unsigned int j = 0; j < stride; ++j) {
+      unsigned int sq_dist = i * i + j * j;
+      if (sq_dist <= max_sq_dist) {
+        cached_buckets_[i * stride + j] = sq_to_bucket[sq_dist];
       }
     }
-    delete[] cached_costs_;
-    cached_costs_ = NULL;
   }
+
+  inflation_buckets_.resize(num_buckets);
+
+  // the nearest-obstacle field depends on the radius the sources were assigned within
+  incremental_valid_ = false;
 }
 
 }  // namespace nav2_costmap_2d
@@ -39,13 +39,17 @@
 #include "nav2_costmap_2d/obstacle_layer.hpp"
 
 #include <algorithm>
+#include <array>
 #include <memory>
+#include <sstream>
 #include <string>
+#include <typeinfo>
 #include <vector>
 
 #include "pluginlib/class_list_macros.hpp"
 #include "sensor_msgs/point_cloud2_iterator.hpp"
 #include "nav2_costmap_2d/costmap_math.hpp"
+#include "nav2_costmap_2d/costmap_snapshot_registry.hpp"
 
 PLUGINLIB_EXPORT_CLASS(nav2_costmap_2d::ObstacleLayer, nav2_costmap_2d::Layer)
 
@@ -55,6 +59,7 @@ using nav2_costmap_2d::FREE_SPACE;
 
 using nav2_costmap_2d::ObservationBuffer;
 using nav2_costmap_2d::Observation;
+using rcl_interfaces::msg::ParameterType;
 
 namespace nav2_costmap_2d
 {
@@ -64,6 +69,11 @@ ObstacleLayer::~ObstacleLayer()
   for (auto & notifier : observation_notifiers_) {
     notifier.reset();
   }
+  for (auto & shared : shared_sources_) {
+    if (auto buffer = shared.first.lock()) {
+      buffer->removeListener(shared.second);
+    }
+  }
 }
 
 void ObstacleLayer::onInitialize()
@@ -74,7 +84,7 @@ void ObstacleLayer::onInitialize()
   // The topics that we'll subscribe to from the parameter server
   std::string topics_string;
 
-  // TODO(mjeronimo): these four are candidates for dynamic update
+  // these four can be changed at runtime
   declareParameter("enabled", rclcpp::ParameterValue(true));
   declareParameter(
     "footprint_clearing_enabled",
@@ -82,6 +92,8 @@ void ObstacleLayer::onInitialize()
   declareParameter("max_obstacle_height", rclcpp::ParameterValue(2.0));
   declareParameter("combination_method", rclcpp::ParameterValue(1));
   declareParameter("observation_sources", rclcpp::ParameterValue(std::string("")));
+  declareParameter("deduplicate_rays", rclcpp::ParameterValue(false));
+  declareParameter("clearing_threads", rclcpp::ParameterValue(1));
 
   node_->get_parameter(name_ + "." + "enabled", enabled_);
   node_->get_parameter(name_ + "." + "footprint_clearing_enabled", footprint_clearing_enabled_);
@@ -90,6 +102,13 @@ void ObstacleLayer::onInitialize()
   node_->get_parameter("track_unknown_space", track_unknown_space);
   node_->get_parameter("transform_tolerance", transform_tolerance);
   node_->get_parameter(name_ + "." + "observation_sources", topics_string);
+  node_->get_parameter(name_ + "." + "deduplicate_rays", deduplicate_rays_);
+  int clearing_threads;
+  node_->get_parameter(name_ + "." + "clearing_threads", clearing_threads);
+  if (clearing_threads != 1) {
+    // 0 uses one thread per core
+    clearing_pool_ = std::make_unique<nav2_util::ThreadPool>(std::max(0, clearing_threads));
+  }
 
   RCLCPP_INFO(node_->get_logger(), "Subscribed to Topics: %s", topics_string.c_str());
 
@@ -104,6 +123,18 @@ void ObstacleLayer::onInitialize()
   ObstacleLayer::matchSize();
   current_ = true;
 
+  // Setup callback for changes to parameters.
+  parameters_ = {enabled_, footprint_clearing_enabled_, max_obstacle_height_, combination_method_};
+  parameters_changed_ = false;
+  parameters_client_ = std::make_shared<rclcpp::AsyncParametersClient>(
+    node_->get_node_base_interface(),
+    node_->get_node_topics_interface(),
+    node_->get_node_graph_interface(),
+    node_->get_node_services_interface());
+
+  parameter_event_sub_ = parameters_client_->on_parameter_event(
+    std::bind(&ObstacleLayer::on_parameter_event_callback, this, std::placeholders::_1));
+
   global_frame_ = layered_costmap_->getGlobalFrameID();
 
   // now we need to split the topics based on whitespace which we can use a stringstream for
@@ -114,7 +145,7 @@ void ObstacleLayer::onInitialize()
     // get the parameters for the specific topic
     double observation_keep_time, expected_update_rate, min_obstacle_height, max_obstacle_height;
     std::string topic, sensor_frame, data_type;
-    bool inf_is_valid, clearing, marking;
+    bool inf_is_valid, clearing, marking, downsample, direct_scan, shared;
 
     declareParameter(source + "." + "topic", rclcpp::ParameterValue(source));
     declareParameter(source + "." + "sensor_frame", rclcpp::ParameterValue(std::string("")));
@@ -128,6 +159,9 @@ void ObstacleLayer::onInitialize()
     declareParameter(source + "." + "clearing", rclcpp::ParameterValue(false));
     declareParameter(source + "." + "obstacle_range", rclcpp::ParameterValue(2.5));
     declareParameter(source + "." + "raytrace_range", rclcpp::ParameterValue(3.0));
+    declareParameter(source + "." + "downsample", rclcpp::ParameterValue(false));
+    declareParameter(source + "." + "direct_scan", rclcpp::ParameterValue(false));
+    declareParameter(source + "." + "shared", rclcpp::ParameterValue(false));
 
     node_->get_parameter(name_ + "." + source + "." + "topic", topic);
     node_->get_parameter(name_ + "." + source + "." + "sensor_frame", sensor_frame);
@@ -143,6 +177,9 @@ void ObstacleLayer::onInitialize()
     node_->get_parameter(name_ + "." + source + "." + "inf_is_valid", inf_is_valid);
     node_->get_parameter(name_ + "." + source + "." + "marking", marking);
     node_->get_parameter(name_ + "." + source + "." + "clearing", clearing);
+    node_->get_parameter(name_ + "." + source + "." + "downsample", downsample);
+    node_->get_parameter(name_ + "." + source + "." + "direct_scan", direct_scan);
+    node_->get_parameter(name_ + "." + source + "." + "shared", shared);
 
     if (!(data_type == "PointCloud2" || data_type == "LaserScan")) {
       RCLCPP_FATAL(
@@ -186,6 +223,13 @@ void ObstacleLayer::onInitialize()
       clearing_buffers_.push_back(observation_buffers_.back());
     }
 
+    // deduplicate the points per cell and drop the ones out of range before they
+    // are stored, so marking and raytracing scale with the cells hit
+    if (downsample) {
+      observation_buffers_.back()->setRangeGating(marking, clearing);
+      downsampled_buffers_.push_back(observation_buffers_.back());
+    }
+
     RCLCPP_DEBUG(
       node_->get_logger(),
       "Created an observation buffer for source %s, topic %s, global frame: %s, "
@@ -193,6 +237,36 @@ void ObstacleLayer::onInitialize()
       source.c_str(), topic.c_str(),
       global_frame_.c_str(), expected_update_rate, observation_keep_time);
 
+    if (shared) {
+      // the global frame may differ, the other buffer's observations are transformed to ours,
+      // but the layers must downsample the same way
+      std::ostringstream key;
+      key << typeid(*this).name() << " " <<
+        CostmapSnapshotRegistry::qualify(node_->get_namespace(), topic) << " " <<
+        data_type << " " << sensor_frame << " " << observation_keep_time << " " <<
+        min_obstacle_height << " " << max_obstacle_height << " " << obstacle_range << " " <<
+        raytrace_range << " " << inf_is_valid << marking << clearing << downsample << direct_scan;
+      std::shared_ptr<ObservationBuffer> other = ObservationSourceRegistry::get(key.str());
+      if (other) {
+        RCLCPP_INFO(
+          node_->get_logger(), "Sharing the observations of %s with another costmap",
+          topic.c_str());
+        std::weak_ptr<ObservationBuffer> buffer = observation_buffers_.back();
+        int listener = other->addListener(
+          [this, buffer](const Observation & observation) {
+            if (auto ours = buffer.lock()) {
+              ours->lock();
+              ours->bufferObservation(observation);
+              ours->unlock();
+              layered_costmap_->requestUpdate();
+            }
+          });
+        shared_sources_.emplace_back(other, listener);
+        continue;
+      }
+      ObservationSourceRegistry::add(key.str(), observation_buffers_.back());
+    }
+
     rmw_qos_profile_t custom_qos_profile = rmw_qos_profile_sensor_data;
     custom_qos_profile.depth = 50;
 
@@ -207,18 +281,23 @@ void ObstacleLayer::onInitialize()
         new tf2_ros::MessageFilter<sensor_msgs::msg::LaserScan>(
           *sub, *tf_, global_frame_, 50, rclcpp_node_));
 
-      if (inf_is_valid) {
-        filter->registerCallback(
-          std::bind(
-            &ObstacleLayer::laserScanValidInfCallback, this, std::placeholders::_1,
-            observation_buffers_.back()));
-
+      std::function<void(sensor_msgs::msg::LaserScan::ConstSharedPtr)> callback;
+      if (direct_scan) {
+        // a scan taken from one pose skips the high fidelity projection and its cloud
+        callback = std::bind(
+          &ObstacleLayer::laserScanDirectCallback, this, std::placeholders::_1,
+          observation_buffers_.back(), inf_is_valid);
+      } else if (inf_is_valid) {
+        callback = std::bind(
+          &ObstacleLayer::laserScanValidInfCallback, this, std::placeholders::_1,
+          observation_buffers_.back());
       } else {
-        filter->registerCallback(
-          std::bind(
-            &ObstacleLayer::laserScanCallback, this, std::placeholders::_1,
-            observation_buffers_.back()));
+        callback = std::bind(
+          &ObstacleLayer::laserScanCallback, this, std::placeholders::_1,
+          observation_buffers_.back());
       }
+      filter->registerCallback(callback);
+      scan_replays_.emplace(topic, callback);
 
       observation_subscribers_.push_back(sub);
 
@@ -241,10 +320,12 @@ void ObstacleLayer::onInitialize()
         new tf2_ros::MessageFilter<sensor_msgs::msg::PointCloud2>(
           *sub, *tf_, global_frame_, 50, rclcpp_node_));
 
-      filter->registerCallback(
+      std::function<void(sensor_msgs::msg::PointCloud2::ConstSharedPtr)> callback =
         std::bind(
-          &ObstacleLayer::pointCloud2Callback, this, std::placeholders::_1,
-          observation_buffers_.back()));
+        &ObstacleLayer::pointCloud2Callback, this, std::placeholders::_1,
+        observation_buffers_.back());
+      filter->registerCallback(callback);
+      cloud_replays_.emplace(topic, callback);
 
       observation_subscribers_.push_back(sub);
       observation_notifiers_.push_back(filter);
@@ -257,6 +338,26 @@ void ObstacleLayer::onInitialize()
       observation_notifiers_.back()->setTargetFrames(target_frames);
     }
   }
+
+  // derived layers refine the cells once they are configured
+  ObstacleLayer::updateDownsampling();
+}
+
+void
+ObstacleLayer::matchSize()
+{
+  CostmapLayer::matchSize();
+  updateDownsampling();
+}
+
+void
+ObstacleLayer::updateDownsampling()
+{
+  for (auto & buffer : downsampled_buffers_) {
+    buffer->lock();
+    buffer->setDownsampling(resolution_, origin_x_, origin_y_, 0.0, 0.0, max_obstacle_height_);
+    buffer->unlock();
+  }
 }
 
 void
@@ -284,6 +385,7 @@ ObstacleLayer::laserScanCallback(
   buffer->lock();
   buffer->bufferCloud(cloud);
   buffer->unlock();
+  layered_costmap_->requestUpdate();
 }
 
 void
@@ -320,6 +422,19 @@ ObstacleLayer::laserScanValidInfCallback(
   buffer->lock();
   buffer->bufferCloud(cloud);
   buffer->unlock();
+  layered_costmap_->requestUpdate();
+}
+
+void
+ObstacleLayer::laserScanDirectCallback(
+  sensor_msgs::msg::LaserScan::ConstSharedPtr message,
+  const std::shared_ptr<nav2_costmap_2d::ObservationBuffer> & buffer,
+  bool inf_is_valid)
+{
+  buffer->lock();
+  buffer->bufferScan(*message, inf_is_valid);
+  buffer->unlock();
+  layered_costmap_->requestUpdate();
 }
 
 void
@@ -331,6 +446,97 @@ ObstacleLayer::pointCloud2Callback(
   buffer->lock();
   buffer->bufferCloud(*message);
   buffer->unlock();
+  layered_costmap_->requestUpdate();
+}
+
+bool
+ObstacleLayer::replayObservation(
+  const std::string & topic, sensor_msgs::msg::LaserScan::ConstSharedPtr message)
+{
+  auto range = scan_replays_.equal_range(topic);
+  for (auto it = range.first; it != range.second; ++it) {
+    it->second(message);
+  }
+  return range.first != range.second;
+}
+
+bool
+ObstacleLayer::replayObservation(
+  const std::string & topic, sensor_msgs::msg::PointCloud2::ConstSharedPtr message)
+{
+  auto range = cloud_replays_.equal_range(topic);
+  for (auto it = range.first; it != range.second; ++it) {
+    it->second(message);
+  }
+  return range.first != range.second;
+}
+
+void
+ObstacleLayer::on_parameter_event_callback(
+  const rcl_interfaces::msg::ParameterEvent::SharedPtr event)
+{
+  // every costmap of the process may have a layer of this name
+  if (event->node != node_->get_fully_qualified_name()) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(parameters_mutex_);
+  for (auto & changed_parameter : event->changed_parameters) {
+    const auto & type = changed_parameter.value.type;
+    const auto & name = changed_parameter.name;
+    const auto & value = changed_parameter.value;
+
+    if (type == ParameterType::PARAMETER_BOOL) {
+      if (name == name_ + ".enabled") {
+        parameters_.enabled = value.bool_value;
+      } else if (name == name_ + ".footprint_clearing_enabled") {
+        parameters_.footprint_clearing_enabled = value.bool_value;
+      } else {
+        continue;
+      }
+    } else if (type == ParameterType::PARAMETER_DOUBLE) {
+      if (name == name_ + ".max_obstacle_height") {
+        parameters_.max_obstacle_height = value.double_value;
+      } else {
+        continue;
+      }
+    } else if (type == ParameterType::PARAMETER_INTEGER) {
+      if (name == name_ + ".combination_method") {
+        parameters_.combination_method = value.integer_value;
+      } else {
+        continue;
+      }
+    } else {
+      continue;
+    }
+    parameters_changed_ = true;
+  }
+}
+
+void
+ObstacleLayer::applyParameterChanges(
+  double * min_x, double * min_y, double * max_x, double * max_y)
+{
+  std::lock_guard<std::mutex> lock(parameters_mutex_);
+  if (!parameters_changed_) {
+    return;
+  }
+  parameters_changed_ = false;
+
+  if (parameters_.enabled != enabled_ || parameters_.combination_method != combination_method_) {
+    // the cells this layer put in the master grid are no longer what it would put there
+    *min_x = std::min(*min_x, getOriginX());
+    *min_y = std::min(*min_y, getOriginY());
+    *max_x = std::max(*max_x, getOriginX() + getSizeInMetersX());
+    *max_y = std::max(*max_y, getOriginY() + getSizeInMetersY());
+  }
+  enabled_ = parameters_.enabled;
+  footprint_clearing_enabled_ = parameters_.footprint_clearing_enabled;
+  combination_method_ = parameters_.combination_method;
+  if (parameters_.max_obstacle_height != max_obstacle_height_) {
+    max_obstacle_height_ = parameters_.max_obstacle_height;
+    updateDownsampling();
+  }
 }
 
 void
@@ -341,6 +547,7 @@ ObstacleLayer::updateBounds(
   if (rolling_window_) {
     updateOrigin(robot_x - getSizeInMetersX() / 2, robot_y - getSizeInMetersY() / 2);
   }
+  applyParameterChanges(min_x, min_y, max_x, max_y);
   if (!enabled_) {
     return;
   }
@@ -359,8 +566,12 @@ ObstacleLayer::updateBounds(
   current_ = current;
 
   // raytrace freespace
-  for (unsigned int i = 0; i < clearing_observations.size(); ++i) {
-    raytraceFreespace(clearing_observations[i], min_x, min_y, max_x, max_y);
+  if (clearing_pool_ && clearing_observations.size() > 1) {
+    raytraceFreespaceParallel(clearing_observations, min_x, min_y, max_x, max_y);
+  } else {
+    for (unsigned int i = 0; i < clearing_observations.size(); ++i) {
+      raytraceFreespace(clearing_observations[i], min_x, min_y, max_x, max_y);
+    }
   }
 
   // place the new obstacles into a priority queue... each with a priority of zero to begin with
@@ -443,6 +654,39 @@ ObstacleLayer::updateCosts(
     setConvexPolygonCost(transformed_footprint_, nav2_costmap_2d::FREE_SPACE);
   }
 
+  combineCosts(master_grid, min_i, min_j, max_i, max_j);
+}
+
+void
+ObstacleLayer::prepareTiledUpdate(
+  nav2_costmap_2d::Costmap2D & /*master_grid*/, int /*min_i*/, int /*min_j*/,
+  int /*max_i*/, int /*max_j*/)
+{
+  // Clearing the footprint modifies this layer, so it is done once up front
+  if (enabled_ && footprint_clearing_enabled_) {
+    setConvexPolygonCost(transformed_footprint_, nav2_costmap_2d::FREE_SPACE);
+  }
+}
+
+void
+ObstacleLayer::updateCostsTile(
+  nav2_costmap_2d::Costmap2D & master_grid, int min_i, int min_j,
+  int max_i,
+  int max_j)
+{
+  if (!enabled_) {
+    return;
+  }
+
+  combineCosts(master_grid, min_i, min_j, max_i, max_j);
+}
+
+void
+ObstacleLayer::combineCosts(
+  nav2_costmap_2d::Costmap2D & master_grid, int min_i, int min_j,
+  int max_i,
+  int max_j)
+{
   switch (combination_method_) {
     case 0:  // Overwrite
       updateWithOverwrite(master_grid, min_i, min_j, max_i, max_j);
@@ -485,10 +729,8 @@ ObstacleLayer::getMarkingObservations(std::vector<Observation> & marking_observa
   bool current = true;
   // get the marking observations
   for (unsigned int i = 0; i < marking_buffers_.size(); ++i) {
-    marking_buffers_[i]->lock();
     marking_buffers_[i]->getObservations(marking_observations);
     current = marking_buffers_[i]->isCurrent() && current;
-    marking_buffers_[i]->unlock();
   }
   marking_observations.insert(
     marking_observations.end(),
@@ -502,10 +744,8 @@ ObstacleLayer::getClearingObservations(std::vector<Observation> & clearing_obser
   bool current = true;
   // get the clearing observations
   for (unsigned int i = 0; i < clearing_buffers_.size(); ++i) {
-    clearing_buffers_[i]->lock();
     clearing_buffers_[i]->getObservations(clearing_observations);
     current = clearing_buffers_[i]->isCurrent() && current;
-    clearing_buffers_[i]->unlock();
   }
   clearing_observations.insert(
     clearing_observations.end(),
@@ -519,19 +759,109 @@ ObstacleLayer::raytraceFreespace(
   double * min_y,
   double * max_x,
   double * max_y)
+{
+  unsigned int x0, y0;
+  if (!getClearingEndpoints(
+      clearing_observation, x0, y0, clearing_endpoints_, min_x, min_y, max_x, max_y))
+  {
+    return;
+  }
+
+  unsigned int cell_raytrace_range = cellDistance(clearing_observation.raytrace_range_);
+  MarkCell marker(costmap_, FREE_SPACE);
+  for (unsigned int endpoint : clearing_endpoints_) {
+    // and finally... we can execute our trace to clear obstacles along that line
+    raytraceLine(marker, x0, y0, endpoint % size_x_, endpoint / size_x_, cell_raytrace_range);
+  }
+}
+
+namespace
+{
+
+/**
+ * @brief Collects the cells a ray traverses instead of modifying them
+ */
+class CollectCell
+{
+public:
+  explicit CollectCell(std::vector<unsigned int> & cells)
+  : cells_(cells)
+  {
+  }
+  inline void operator()(unsigned int offset)
+  {
+    cells_.push_back(offset);
+  }
+
+private:
+  std::vector<unsigned int> & cells_;
+};
+
+}  // namespace
+
+void
+ObstacleLayer::raytraceFreespaceParallel(
+  const std::vector<Observation> & clearing_observations,
+  double * min_x, double * min_y,
+  double * max_x,
+  double * max_y)
+{
+  // Each observation is traced into its own list of cells and bounds, so the
+  // tasks share nothing but read access to the map geometry
+  const std::size_t count = clearing_observations.size();
+  std::vector<std::vector<unsigned int>> cleared(count);
+  std::vector<std::array<double, 4>> bounds(count, {{*min_x, *min_y, *max_x, *max_y}});
+
+  clearing_pool_->parallel_for(
+    count, [&](std::size_t i) {
+      const Observation & clearing_observation = clearing_observations[i];
+      std::vector<unsigned int> endpoints;
+      unsigned int x0, y0;
+      if (!getClearingEndpoints(
+          clearing_observation, x0, y0, endpoints,
+          &bounds[i][0], &bounds[i][1], &bounds[i][2], &bounds[i][3]))
+      {
+        return;
+      }
+
+      unsigned int cell_raytrace_range = cellDistance(clearing_observation.raytrace_range_);
+      CollectCell collector(cleared[i]);
+      for (unsigned int endpoint : endpoints) {
+        raytraceLine(
+          collector, x0, y0, endpoint % size_x_, endpoint / size_x_, cell_raytrace_range);
+      }
+    });
+
+  // Every trace clears to the same value, so the order of merging does not matter
+  for (std::size_t i = 0; i < count; ++i) {
+    for (unsigned int index : cleared[i]) {
+      costmap_[index] = FREE_SPACE;
+    }
+    touch(bounds[i][0], bounds[i][1], min_x, min_y, max_x, max_y);
+    touch(bounds[i][2], bounds[i][3], min_x, min_y, max_x, max_y);
+  }
+}
+
+bool
+ObstacleLayer::getClearingEndpoints(
+  const Observation & clearing_observation,
+  unsigned int & x0, unsigned int & y0, std::vector<unsigned int> & endpoints,
+  double * min_x, double * min_y,
+  double * max_x,
+  double * max_y)
 {
   double ox = clearing_observation.origin_.x;
   double oy = clearing_observation.origin_.y;
   const sensor_msgs::msg::PointCloud2 & cloud = *(clearing_observation.cloud_);
+  endpoints.clear();
 
   // get the map coordinates of the origin of the sensor
-  unsigned int x0, y0;
   if (!worldToMap(ox, oy, x0, y0)) {
     RCLCPP_WARN(
       node_->get_logger(),
       "Sensor origin at (%.2f, %.2f) is out of map bounds. The costmap cannot raytrace for it.",
       ox, oy);
-    return;
+    return false;
   }
 
   // we can pre-compute the enpoints of the map outside of the inner loop... we'll need these later
@@ -588,15 +918,19 @@ ObstacleLayer::raytraceFreespace(
       continue;
     }
 
-    unsigned int cell_raytrace_range = cellDistance(clearing_observation.raytrace_range_);
-    MarkCell marker(costmap_, FREE_SPACE);
-    // and finally... we can execute our trace to clear obstacles along that line
-    raytraceLine(marker, x0, y0, x1, y1, cell_raytrace_range);
+    endpoints.push_back(getIndex(x1, y1));
 
     updateRaytraceBounds(
       ox, oy, wx, wy, clearing_observation.raytrace_range_, min_x, min_y, max_x,
       max_y);
   }
+
+  // rays from the same origin to the same cell traverse the same cells
+  if (deduplicate_rays_) {
+    std::sort(endpoints.begin(), endpoints.end());
+    endpoints.erase(std::unique(endpoints.begin(), endpoints.end()), endpoints.end());
+  }
+  return true;
 }
 
 void
@@ -0,0 +1,204 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_costmap_2d/shared_costmap_layer.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "pluginlib/class_list_macros.hpp"
+
+PLUGINLIB_EXPORT_CLASS(nav2_costmap_2d::SharedCostmapLayer, nav2_costmap_2d::Layer)
+
+namespace nav2_costmap_2d
+{
+
+namespace
+{
+
+// FNV-1a, enough to tell a row that changed from one that didn't
+uint64_t hashRow(const unsigned char * row, unsigned int size)
+{
+  uint64_t hash = 14695981039346656037ULL;
+  for (unsigned int i = 0; i < size; ++i) {
+    hash = (hash ^ row[i]) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+}  // namespace
+
+SharedCostmapLayer::SharedCostmapLayer()
+{
+}
+
+SharedCostmapLayer::~SharedCostmapLayer()
+{
+}
+
+void
+SharedCostmapLayer::onInitialize()
+{
+  declareParameter("enabled", rclcpp::ParameterValue(true));
+  declareParameter("topic", rclcpp::ParameterValue(std::string("/shared_costmap/costmap_raw")));
+  declareParameter("use_maximum", rclcpp::ParameterValue(false));
+
+  node_->get_parameter(name_ + "." + "enabled", enabled_);
+  node_->get_parameter(name_ + "." + "topic", topic_);
+  node_->get_parameter(name_ + "." + "use_maximum", use_maximum_);
+
+  RCLCPP_INFO(node_->get_logger(), "SharedCostmapLayer: Sharing the costmap %s", topic_.c_str());
+  subscriber_ = std::make_unique<CostmapSubscriber>(node_, topic_);
+  current_ = true;
+}
+
+void
+SharedCostmapLayer::reset()
+{
+  // copy it all in again on the next update
+  row_hashes_.clear();
+}
+
+bool
+SharedCostmapLayer::findChangedRows(
+  const Costmap2D & shared, unsigned int & y0, unsigned int & yn)
+{
+  const unsigned int size_x = shared.getSizeInCellsX();
+  const unsigned int size_y = shared.getSizeInCellsY();
+  const unsigned char * costs = shared.getCharMap();
+  const bool all = row_hashes_.size() != size_y;
+  row_hashes_.resize(size_y);
+
+  y0 = size_y;
+  yn = 0;
+  for (unsigned int y = 0; y < size_y; ++y) {
+    const uint64_t hash = hashRow(costs + static_cast<size_t>(y) * size_x, size_x);
+    if (all || hash != row_hashes_[y]) {
+      row_hashes_[y] = hash;
+      y0 = std::min(y0, y);
+      yn = y + 1;
+    }
+  }
+  return y0 < yn;
+}
+
+void
+SharedCostmapLayer::updateBounds(
+  double /*robot_x*/, double /*robot_y*/, double /*robot_yaw*/, double * min_x,
+  double * min_y, double * max_x, double * max_y)
+{
+  if (!enabled_) {
+    return;
+  }
+  std::shared_ptr<const Costmap2D> shared;
+  try {
+    shared = subscriber_->getCostmapView();
+  } catch (const std::runtime_error &) {
+    static int count = 0;
+    // throttle warning down to only 1/10 message rate
+    if (++count == 10) {
+      RCLCPP_WARN(
+        node_->get_logger(), "SharedCostmapLayer: No costmap received on %s", topic_.c_str());
+      count = 0;
+    }
+    return;
+  }
+
+  // a static window takes on the size of the shared costmap, as for a static map
+  Costmap2D * master = layered_costmap_->getCostmap();
+  bool same_grid = master->getSizeInCellsX() == shared->getSizeInCellsX() &&
+    master->getSizeInCellsY() == shared->getSizeInCellsY() &&
+    master->getResolution() == shared->getResolution() &&
+    master->getOriginX() == shared->getOriginX() &&
+    master->getOriginY() == shared->getOriginY();
+  if (!layered_costmap_->isRolling() && (!same_grid || !layered_costmap_->isSizeLocked())) {
+    RCLCPP_INFO(
+      node_->get_logger(), "SharedCostmapLayer: Resizing costmap to %d X %d at %f m/pix",
+      shared->getSizeInCellsX(), shared->getSizeInCellsY(), shared->getResolution());
+    layered_costmap_->resizeMap(
+      shared->getSizeInCellsX(), shared->getSizeInCellsY(), shared->getResolution(),
+      shared->getOriginX(), shared->getOriginY(), true);
+    same_grid = true;
+    row_hashes_.clear();
+  }
+  if (same_grid != same_grid_ ||
+    (shared_ && (shared_->getOriginX() != shared->getOriginX() ||
+    shared_->getOriginY() != shared->getOriginY() ||
+    shared_->getResolution() != shared->getResolution())))
+  {
+    row_hashes_.clear();
+  }
+  same_grid_ = same_grid;
+  shared_ = shared;
+
+  unsigned int y0, yn;
+  if (!findChangedRows(*shared, y0, yn)) {
+    return;
+  }
+  double wx0, wy0, wxn, wyn;
+  shared->mapToWorld(0, y0, wx0, wy0);
+  shared->mapToWorld(shared->getSizeInCellsX(), yn, wxn, wyn);
+  // mapToWorld gives the centers of the cells
+  const double half_cell = 0.5 * shared->getResolution();
+  *min_x = std::min(wx0 - half_cell, *min_x);
+  *min_y = std::min(wy0 - half_cell, *min_y);
+  *max_x = std::max(wxn - half_cell, *max_x);
+  *max_y = std::max(wyn - half_cell, *max_y);
+}
+
+void
+SharedCostmapLayer::updateCosts(
+  nav2_costmap_2d::Costmap2D & master_grid,
+  int min_i, int min_j, int max_i, int max_j)
+{
+  if (!enabled_ || !shared_) {
+    return;
+  }
+  const unsigned char * shared_costs = shared_->getCharMap();
+  unsigned char * master_costs = master_grid.getCharMap();
+  const unsigned int size_x = master_grid.getSizeInCellsX();
+
+  if (same_grid_) {
+    for (int j = min_j; j < max_j; ++j) {
+      const size_t row = static_cast<size_t>(j) * size_x;
+      if (!use_maximum_) {
+        std::copy(
+          shared_costs + row + min_i, shared_costs + row + max_i, master_costs + row + min_i);
+      } else {
+        for (size_t index = row + min_i; index < row + max_i; ++index) {
+          master_costs[index] = std::max(master_costs[index], shared_costs[index]);
+        }
+      }
+    }
+    return;
+  }
+
+  // A rolling window, or another grid: each cell takes the shared cell it lies in
+  unsigned int mx, my;
+  double wx, wy;
+  for (int j = min_j; j < max_j; ++j) {
+    for (int i = min_i; i < max_i; ++i) {
+      master_grid.mapToWorld(i, j, wx, wy);
+      if (shared_->worldToMap(wx, wy, mx, my)) {
+        const unsigned char cost = shared_->getCost(mx, my);
+        const size_t index = static_cast<size_t>(j) * size_x + i;
+        master_costs[index] = use_maximum_ ? std::max(master_costs[index], cost) : cost;
+      }
+    }
+  }
+}
+
+}  // namespace nav2_costmap_2d
@@ -137,6 +137,11 @@ StaticLayer::getParameters()
   // Enforce bounds
   lethal_threshold_ = std::max(std::min(temp_lethal_threshold, 100), 0);
   map_received_ = false;
+
+  // The cost of each of the values a map cell can take, for these parameters
+  for (unsigned int value = 0; value < 256; ++value) {
+    value_to_cost_[value] = interpretValue(static_cast<unsigned char>(value));
+  }
 }
 
 void
@@ -186,15 +191,11 @@ StaticLayer::processMap(const nav_msgs::msg::OccupancyGrid & new_map)
       new_map.info.origin.position.x, new_map.info.origin.position.y);
   }
 
-  unsigned int index = 0;
-
   // initialize the costmap with static data
-  for (unsigned int i = 0; i < size_y; ++i) {
-    for (unsigned int j = 0; j < size_x; ++j) {
-      unsigned char value = new_map.data[index];
-      costmap_[index] = interpretValue(value);
-      ++index;
-    }
+  const unsigned char * values = reinterpret_cast<const unsigned char *>(new_map.data.data());
+  const size_t num_cells = static_cast<size_t>(size_x) * size_y;
+  for (size_t index = 0; index < num_cells; ++index) {
+    costmap_[index] = value_to_cost_[values[index]];
   }
 
   map_frame_ = new_map.header.frame_id;
@@ -243,28 +244,35 @@ StaticLayer::interpretValue(unsigned char value)
 void
 StaticLayer::incomingMap(const nav_msgs::msg::OccupancyGrid::SharedPtr new_map)
 {
-  std::lock_guard<Costmap2D::mutex_t> guard(*getMutex());
-  processMap(*new_map);
-  if (!map_received_) {
-    map_received_ = true;
+  {
+    std::lock_guard<Costmap2D::mutex_t> guard(*getMutex());
+    processMap(*new_map);
+    if (!map_received_) {
+      map_received_ = true;
+    }
   }
+  layered_costmap_->requestUpdate();
 }
 
 void
 StaticLayer::incomingUpdate(map_msgs::msg::OccupancyGridUpdate::ConstSharedPtr update)
 {
   std::lock_guard<Costmap2D::mutex_t> guard(*getMutex());
-  if (update->y < static_cast<int32_t>(y_) ||
-    y_ + height_ < update->y + update->height ||
-    update->x < static_cast<int32_t>(x_) ||
-    x_ + width_ < update->x + update->width)
+  if (!map_received_) {
+    RCLCPP_WARN(node_->get_logger(), "StaticLayer: Map update ignored. No map received yet.");
+    return;
+  }
+  if (update->y < 0 ||
+    size_y_ < update->y + update->height ||
+    update->x < 0 ||
+    size_x_ < update->x + update->width)
   {
     RCLCPP_WARN(
       node_->get_logger(),
       "StaticLayer: Map update ignored. Exceeds bounds of static layer.\n"
-      "Static layer origin: %d, %d   bounds: %d X %d\n"
+      "Static layer bounds: %d X %d\n"
       "Update origin: %d, %d   bounds: %d X %d",
-      x_, y_, width_, height_, update->x, update->y, update->width,
+      size_x_, size_y_, update->x, update->y, update->width,
       update->height);
     return;
   }
@@ -282,15 +290,27 @@ StaticLayer::incomingUpdate(map_msgs::msg::OccupancyGridUpdate::ConstSharedPtr u
     unsigned int index_base = (update->y + y) * size_x_;
     for (unsigned int x = 0; x < update->width; x++) {
       unsigned int index = index_base + x + update->x;
-      costmap_[index] = interpretValue(update->data[di++]);
+      costmap_[index] = value_to_cost_[static_cast<unsigned char>(update->data[di++])];
     }
   }
 
-  x_ = update->x;
-  y_ = update->y;
-  width_ = update->width;
-  height_ = update->height;
+  // Only the updated cells are combined into the master grid again, together
+  // with any not yet taken up by updateBounds()
+  if (has_updated_data_) {
+    unsigned int max_x = std::max(x_ + width_, update->x + update->width);
+    unsigned int max_y = std::max(y_ + height_, update->y + update->height);
+    x_ = std::min(x_, static_cast<unsigned int>(update->x));
+    y_ = std::min(y_, static_cast<unsigned int>(update->y));
+    width_ = max_x - x_;
+    height_ = max_y - y_;
+  } else {
+    x_ = update->x;
+    y_ = update->y;
+    width_ = update->width;
+    height_ = update->height;
+  }
   has_updated_data_ = true;
+  layered_costmap_->requestUpdate();
 }
 
 
@@ -310,6 +330,37 @@ StaticLayer::updateBounds(
     if (!(has_updated_data_ || has_extra_bounds_)) {
       return;
     }
+  } else {
+    // The rolling window keeps what was combined into it, so the static map
+    // only needs to be copied again when it, or where it lies in the window,
+    // has changed
+    geometry_msgs::msg::TransformStamped transform;
+    try {
+      transform = tf_->lookupTransform(map_frame_, global_frame_, tf2::TimePointZero);
+    } catch (tf2::TransformException & ex) {
+      RCLCPP_ERROR(node_->get_logger(), "StaticLayer: %s", ex.what());
+      has_transform_ = false;
+      return;
+    }
+    tf2::Transform tf2_transform;
+    tf2::fromMsg(transform.transform, tf2_transform);
+    bool moved = !has_transform_ || !(tf2_transform == global_to_map_);
+    global_to_map_ = tf2_transform;
+    has_transform_ = true;
+    if (!(has_updated_data_ || has_extra_bounds_ || moved)) {
+      return;
+    }
+
+    useExtraBounds(min_x, min_y, max_x, max_y);
+
+    Costmap2D * master = layered_costmap_->getCostmap();
+    *min_x = std::min(master->getOriginX(), *min_x);
+    *min_y = std::min(master->getOriginY(), *min_y);
+    *max_x = std::max(master->getOriginX() + master->getSizeInMetersX(), *max_x);
+    *max_y = std::max(master->getOriginY() + master->getSizeInMetersY(), *max_y);
+
+    has_updated_data_ = false;
+    return;
   }
 
   useExtraBounds(min_x, min_y, max_x, max_y);
@@ -356,17 +407,12 @@ StaticLayer::updateCosts(
     // If rolling window, the master_grid is unlikely to have same coordinates as this layer
     unsigned int mx, my;
     double wx, wy;
-    // Might even be in a different frame
-    geometry_msgs::msg::TransformStamped transform;
-    try {
-      transform = tf_->lookupTransform(map_frame_, global_frame_, tf2::TimePointZero);
-    } catch (tf2::TransformException & ex) {
-      RCLCPP_ERROR(node_->get_logger(), "StaticLayer: %s", ex.what());
+    // Might even be in a different frame, looked up in updateBounds()
+    if (!has_transform_) {
       return;
     }
     // Copy map data given proper transformations
-    tf2::Transform tf2_transform;
-    tf2::fromMsg(transform.transform, tf2_transform);
+    const tf2::Transform & tf2_transform = global_to_map_;
 
     for (int i = min_i; i < max_i; ++i) {
       for (int j = min_j; j < max_j; ++j) {
@@ -45,7 +45,6 @@
 #include "pluginlib/class_list_macros.hpp"
 #include "sensor_msgs/point_cloud2_iterator.hpp"
 
-#define VOXEL_BITS 16
 PLUGINLIB_EXPORT_CLASS(nav2_costmap_2d::VoxelLayer, nav2_costmap_2d::Layer)
 
 using nav2_costmap_2d::NO_INFORMATION;
@@ -55,6 +54,25 @@ using nav2_costmap_2d::FREE_SPACE;
 namespace nav2_costmap_2d
 {
 
+namespace
+{
+
+template<typename ColumnT>
+void copyVoxelData(nav2_voxel_grid::BasicVoxelGrid<ColumnT> & voxel_grid, uint32_t * words)
+{
+  memcpy(words, voxel_grid.getData(), voxel_grid.sizeX() * voxel_grid.sizeY() * sizeof(ColumnT));
+}
+
+template<typename ColumnT>
+void copyVoxelData(nav2_voxel_grid::SparseVoxelGrid<ColumnT> & voxel_grid, uint32_t * words)
+{
+  std::vector<ColumnT> columns(voxel_grid.sizeX() * voxel_grid.sizeY());
+  voxel_grid.copyData(columns.data());
+  memcpy(words, columns.data(), columns.size() * sizeof(ColumnT));
+}
+
+}  // namespace
+
 void VoxelLayer::onInitialize()
 {
   ObstacleLayer::onInitialize();
@@ -69,6 +87,8 @@ void VoxelLayer::onInitialize()
   declareParameter("mark_threshold", rclcpp::ParameterValue(0));
   declareParameter("combination_method", rclcpp::ParameterValue(1));
   declareParameter("publish_voxel_map", rclcpp::ParameterValue(false));
+  declareParameter("voxel_map_keyframe_interval", rclcpp::ParameterValue(0));
+  declareParameter("sparse_voxel_grid", rclcpp::ParameterValue(false));
 
   node_->get_parameter(name_ + "." + "enabled", enabled_);
   node_->get_parameter(name_ + "." + "footprint_clearing_enabled", footprint_clearing_enabled_);
@@ -80,20 +100,36 @@ void VoxelLayer::onInitialize()
   node_->get_parameter(name_ + "." + "mark_threshold", mark_threshold_);
   node_->get_parameter(name_ + "." + "combination_method", combination_method_);
   node_->get_parameter(name_ + "." + "publish_voxel_map", publish_voxel_);
+  int keyframe_interval;
+  node_->get_parameter(name_ + "." + "voxel_map_keyframe_interval", keyframe_interval);
+  node_->get_parameter(name_ + "." + "sparse_voxel_grid", use_sparse_voxel_grid_);
 
   auto custom_qos = rclcpp::QoS(rclcpp::KeepLast(1)).transient_local().reliable();
 
   if (publish_voxel_) {
     voxel_pub_ = node_->create_publisher<nav2_msgs::msg::VoxelGrid>(
       "voxel_grid", custom_qos);
+    voxel_pub_->on_activate();
+    voxel_encoder_ = VoxelGridEncoder(std::max(keyframe_interval, 0));
   }
 
-  voxel_pub_->on_activate();
-
   clearing_endpoints_pub_ = node_->create_publisher<sensor_msgs::msg::PointCloud>(
     "clearing_endpoints", custom_qos);
 
-  unknown_threshold_ += (VOXEL_BITS - size_z_);
+  if (size_z_ > static_cast<int>(nav2_voxel_grid::VoxelGrid128::max_size_z)) {
+    RCLCPP_WARN(
+      node_->get_logger(),
+      "z_voxels of %d is more than the %u supported, using %u",
+      size_z_, nav2_voxel_grid::VoxelGrid128::max_size_z,
+      nav2_voxel_grid::VoxelGrid128::max_size_z);
+    size_z_ = nav2_voxel_grid::VoxelGrid128::max_size_z;
+  }
+
+  // the levels above z_voxels stay unknown, so they don't count against the threshold
+  visitVoxelGrid(
+    [this](auto & voxel_grid) {
+      unknown_threshold_ += static_cast<int>(voxel_grid.max_size_z) - size_z_;
+    });
   matchSize();
 }
 
@@ -101,11 +137,24 @@ VoxelLayer::~VoxelLayer()
 {
 }
 
+void VoxelLayer::updateDownsampling()
+{
+  for (auto & buffer : downsampled_buffers_) {
+    buffer->lock();
+    buffer->setDownsampling(
+      resolution_, origin_x_, origin_y_, z_resolution_, origin_z_, max_obstacle_height_);
+    buffer->unlock();
+  }
+}
+
 void VoxelLayer::matchSize()
 {
   ObstacleLayer::matchSize();
-  voxel_grid_.resize(size_x_, size_y_, size_z_);
-  assert(voxel_grid_.sizeX() == size_x_ && voxel_grid_.sizeY() == size_y_);
+  visitVoxelGrid(
+    [this](auto & voxel_grid) {
+      voxel_grid.resize(size_x_, size_y_, size_z_);
+      assert(voxel_grid.sizeX() == size_x_ && voxel_grid.sizeY() == size_y_);
+    });
 }
 
 void VoxelLayer::reset()
@@ -122,7 +171,13 @@ void VoxelLayer::resetMaps()
   // resetMaps so this goes to the next layer down Costmap2DLayer which also
   // doesn't implement this, so it actually goes all the way to Costmap2D
   ObstacleLayer::resetMaps();
-  voxel_grid_.reset();
+  visitVoxelGrid([](auto & voxel_grid) {voxel_grid.reset();});
+}
+
+void VoxelLayer::resetOutside(int x0, int y0, int xn, int yn, unsigned char value)
+{
+  ObstacleLayer::resetOutside(x0, y0, xn, yn, value);
+  visitVoxelGrid([&](auto & voxel_grid) {forgetMarksOutside(voxel_grid, x0, y0, xn, yn);});
 }
 
 void VoxelLayer::updateBounds(
@@ -132,6 +187,7 @@ void VoxelLayer::updateBounds(
   if (rolling_window_) {
     updateOrigin(robot_x - getSizeInMetersX() / 2, robot_y - getSizeInMetersY() / 2);
   }
+  applyParameterChanges(min_x, min_y, max_x, max_y);
   if (!enabled_) {
     return;
   }
@@ -154,6 +210,22 @@ void VoxelLayer::updateBounds(
     raytraceFreespace(clearing_observations[i], min_x, min_y, max_x, max_y);
   }
 
+  visitVoxelGrid(
+    [&](auto & voxel_grid) {
+      markObservations(voxel_grid, observations, min_x, min_y, max_x, max_y);
+      if (publish_voxel_) {
+        publishVoxelGrid(voxel_grid);
+      }
+    });
+
+  updateFootprint(robot_x, robot_y, robot_yaw, min_x, min_y, max_x, max_y);
+}
+
+template<typename VoxelGridT>
+void VoxelLayer::markObservations(
+  VoxelGridT & voxel_grid, const std::vector<Observation> & observations,
+  double * min_x, double * min_y, double * max_x, double * max_y)
+{
   // place the new obstacles into a priority queue... each with a priority of zero to begin with
   for (std::vector<Observation>::const_iterator it = observations.begin(); it != observations.end();
     ++it)
@@ -194,10 +266,12 @@ void VoxelLayer::updateBounds(
         continue;
       }
 
-      // mark the cell in the voxel grid and check if we should also mark it in the costmap
-      if (voxel_grid_.markVoxelInMap(mx, my, mz, mark_threshold_)) {
-        unsigned int index = getIndex(mx, my);
-
+      // mark the cell in the voxel grid and check if we should also mark it in the costmap,
+      // the update only needing to cover the cells that weren't marked already
+      unsigned int index = getIndex(mx, my);
+      if (voxel_grid.markVoxelInMap(mx, my, mz, mark_threshold_) &&
+        costmap_[index] != LETHAL_OBSTACLE)
+      {
         costmap_[index] = LETHAL_OBSTACLE;
         touch(
           static_cast<double>(*iter_x), static_cast<double>(*iter_y),
@@ -205,29 +279,33 @@ void VoxelLayer::updateBounds(
       }
     }
   }
+}
 
-  if (publish_voxel_) {
-    nav2_msgs::msg::VoxelGrid grid_msg;
-    unsigned int size = voxel_grid_.sizeX() * voxel_grid_.sizeY();
-    grid_msg.size_x = voxel_grid_.sizeX();
-    grid_msg.size_y = voxel_grid_.sizeY();
-    grid_msg.size_z = voxel_grid_.sizeZ();
-    grid_msg.data.resize(size);
-    memcpy(&grid_msg.data[0], voxel_grid_.getData(), size * sizeof(unsigned int));
-
-    grid_msg.origin.x = origin_x_;
-    grid_msg.origin.y = origin_y_;
-    grid_msg.origin.z = origin_z_;
-
-    grid_msg.resolutions.x = resolution_;
-    grid_msg.resolutions.y = resolution_;
-    grid_msg.resolutions.z = z_resolution_;
-    grid_msg.header.frame_id = global_frame_;
-    grid_msg.header.stamp = node_->now();
-    voxel_pub_->publish(grid_msg);
-  }
-
-  updateFootprint(robot_x, robot_y, robot_yaw, min_x, min_y, max_x, max_y);
+template<typename VoxelGridT>
+void VoxelLayer::publishVoxelGrid(VoxelGridT & voxel_grid)
+{
+  nav2_msgs::msg::VoxelGrid grid_msg;
+  unsigned int size = voxel_grid.sizeX() * voxel_grid.sizeY();
+  grid_msg.size_x = voxel_grid.sizeX();
+  grid_msg.size_y = voxel_grid.sizeY();
+  grid_msg.size_z = voxel_grid.sizeZ();
+  // wider columns go out as several consecutive words per cell, and only the
+  // columns that changed since the last grid when it's smaller
+  unsigned int column_words = sizeof(typename VoxelGridT::Column) / sizeof(uint32_t);
+  voxel_words_.resize(size * column_words);
+  copyVoxelData(voxel_grid, voxel_words_.data());
+  voxel_encoder_.encode(voxel_words_.data(), size, column_words, grid_msg);
+
+  grid_msg.origin.x = origin_x_;
+  grid_msg.origin.y = origin_y_;
+  grid_msg.origin.z = origin_z_;
+
+  grid_msg.resolutions.x = resolution_;
+  grid_msg.resolutions.y = resolution_;
+  grid_msg.resolutions.z = z_resolution_;
+  grid_msg.header.frame_id = global_frame_;
+  grid_msg.header.stamp = node_->now();
+  voxel_pub_->publish(grid_msg);
 }
 
 void VoxelLayer::clearNonLethal(
@@ -272,7 +350,7 @@ void VoxelLayer::clearNonLethal(
       if (*current != LETHAL_OBSTACLE) {
         if (clear_no_info || *current != NO_INFORMATION) {
           *current = FREE_SPACE;
-          voxel_grid_.clearVoxelColumn(index);
+          visitVoxelGrid([index](auto & voxel_grid) {voxel_grid.clearVoxelColumn(index);});
         }
       }
       current++;
@@ -314,6 +392,11 @@ void VoxelLayer::raytraceFreespace(
     clearing_endpoints_.points.reserve(clearing_observation_cloud_size);
   }
 
+  // gather the map-frame endpoints first so the grid can clear them in one batch
+  clearing_ends_.clear();
+  clearing_ends_.reserve(3 * clearing_observation_cloud_size);
+  unsigned int cell_raytrace_range = cellDistance(clearing_observation.raytrace_range_);
+
   // we can pre-compute the enpoints of the map outside of the inner loop... we'll need these later
   double map_end_x = origin_x_ + getSizeInMetersX();
   double map_end_y = origin_y_ + getSizeInMetersY();
@@ -372,19 +455,9 @@ void VoxelLayer::raytraceFreespace(
 
     double point_x, point_y, point_z;
     if (worldToMap3DFloat(wpx, wpy, wpz, point_x, point_y, point_z)) {
-      unsigned int cell_raytrace_range = cellDistance(clearing_observation.raytrace_range_);
-
-      // voxel_grid_.markVoxelLine(sensor_x, sensor_y, sensor_z, point_x, point_y, point_z);
-      voxel_grid_.clearVoxelLineInMap(
-        sensor_x, sensor_y, sensor_z, point_x, point_y, point_z,
-        costmap_,
-        unknown_threshold_, mark_threshold_, FREE_SPACE, NO_INFORMATION,
-        cell_raytrace_range);
-
-      updateRaytraceBounds(
-        ox, oy, wpx, wpy, clearing_observation.raytrace_range_, min_x, min_y,
-        max_x,
-        max_y);
+      clearing_ends_.push_back(point_x);
+      clearing_ends_.push_back(point_y);
+      clearing_ends_.push_back(point_z);
 
       if (publish_clearing_points) {
         geometry_msgs::msg::Point32 point;
@@ -396,6 +469,34 @@ void VoxelLayer::raytraceFreespace(
     }
   }
 
+  cleared_cells_.clear();
+  visitVoxelGrid(
+    [&](auto & voxel_grid) {
+      voxel_grid.clearVoxelLinesInMap(
+        sensor_x, sensor_y, sensor_z, clearing_ends_.data(), clearing_ends_.size() / 3,
+        costmap_,
+        unknown_threshold_, mark_threshold_, FREE_SPACE, NO_INFORMATION,
+        cell_raytrace_range, &cleared_cells_);
+    });
+
+  // the update covers the cells whose cost changed, rather than every ray
+  if (!cleared_cells_.empty()) {
+    unsigned int cell_min_x = size_x_, cell_min_y = size_y_, cell_max_x = 0, cell_max_y = 0;
+    for (unsigned int index : cleared_cells_) {
+      unsigned int mx, my;
+      indexToCells(index, mx, my);
+      cell_min_x = std::min(cell_min_x, mx);
+      cell_min_y = std::min(cell_min_y, my);
+      cell_max_x = std::max(cell_max_x, mx);
+      cell_max_y = std::max(cell_max_y, my);
+    }
+    double wx, wy;
+    mapToWorld(cell_min_x, cell_min_y, wx, wy);
+    touch(wx, wy, min_x, min_y, max_x, max_y);
+    mapToWorld(cell_max_x, cell_max_y, wx, wy);
+    touch(wx, wy, min_x, min_y, max_x, max_y);
+  }
+
   if (publish_clearing_points) {
     clearing_endpoints_.header.frame_id = global_frame_;
     clearing_endpoints_.header.stamp = clearing_observation.cloud_->header.stamp;
@@ -411,64 +512,45 @@ void VoxelLayer::updateOrigin(double new_origin_x, double new_origin_y)
   cell_ox = static_cast<int>((new_origin_x - origin_x_) / resolution_);
   cell_oy = static_cast<int>((new_origin_y - origin_y_) / resolution_);
 
-  // compute the associated world coordinates for the origin cell
-  // beacuase we want to keep things grid-aligned
-  double new_grid_ox, new_grid_oy;
-  new_grid_ox = origin_x_ + cell_ox * resolution_;
-  new_grid_oy = origin_y_ + cell_oy * resolution_;
-
-  // To save casting from unsigned int to int a bunch of times
-  int size_x = size_x_;
-  int size_y = size_y_;
-
-  // we need to compute the overlap of the new and existing windows
-  int lower_left_x, lower_left_y, upper_right_x, upper_right_y;
-  lower_left_x = std::min(std::max(cell_ox, 0), size_x);
-  lower_left_y = std::min(std::max(cell_oy, 0), size_y);
-  upper_right_x = std::min(std::max(cell_ox + size_x, 0), size_x);
-  upper_right_y = std::min(std::max(cell_oy + size_y, 0), size_y);
-
-  unsigned int cell_size_x = upper_right_x - lower_left_x;
-  unsigned int cell_size_y = upper_right_y - lower_left_y;
-
-  // we need a map to store the obstacles in the window temporarily
-  unsigned char * local_map = new unsigned char[cell_size_x * cell_size_y];
-  unsigned int * local_voxel_map = new unsigned int[cell_size_x * cell_size_y];
-  unsigned int * voxel_map = voxel_grid_.getData();
-
-  // copy the local window in the costmap to the local map
-  copyMapRegion(
-    costmap_, lower_left_x, lower_left_y, size_x_, local_map, 0, 0, cell_size_x,
-    cell_size_x,
-    cell_size_y);
-  copyMapRegion(
-    voxel_map, lower_left_x, lower_left_y, size_x_, local_voxel_map, 0, 0, cell_size_x,
-    cell_size_x,
-    cell_size_y);
-
-  // we'll reset our maps to unknown space if appropriate
-  resetMaps();
+  // the voxel grid moves with the costmap, which moves itself and the origin
+  visitVoxelGrid([&](auto & voxel_grid) {shiftVoxelGrid(voxel_grid, cell_ox, cell_oy);});
+  ObstacleLayer::updateOrigin(new_origin_x, new_origin_y);
+}
 
-  // update the origin with the appropriate world coordinates
-  origin_x_ = new_grid_ox;
-  origin_y_ = new_grid_oy;
-
-  // compute the starting cell location for copying data back in
-  int start_x = lower_left_x - cell_ox;
-  int start_y = lower_left_y - cell_oy;
-
-  // now we want to copy the overlapping information back into the map, but in its new location
-  copyMapRegion(
-    local_map, 0, 0, cell_size_x, costmap_, start_x, start_y, size_x_, cell_size_x,
-    cell_size_y);
-  copyMapRegion(
-    local_voxel_map, 0, 0, cell_size_x, voxel_map, start_x, start_y, size_x_,
-    cell_size_x,
-    cell_size_y);
-
-  // make sure to clean up
-  delete[] local_map;
-  delete[] local_voxel_map;
+template<typename ColumnT>
+void VoxelLayer::shiftVoxelGrid(
+  nav2_voxel_grid::BasicVoxelGrid<ColumnT> & voxel_grid, int cell_ox, int cell_oy)
+{
+  shiftMap(
+    voxel_grid.getData(), size_x_, size_y_, cell_ox, cell_oy,
+    nav2_voxel_grid::VoxelColumn<ColumnT>::unknown());
+}
+
+template<typename ColumnT>
+void VoxelLayer::shiftVoxelGrid(
+  nav2_voxel_grid::SparseVoxelGrid<ColumnT> & voxel_grid, int cell_ox, int cell_oy)
+{
+  // the chunks don't move, only the part of them the grid covers
+  voxel_grid.shift(cell_ox, cell_oy);
+}
+
+template<typename VoxelGridT>
+void VoxelLayer::forgetMarksOutside(VoxelGridT & voxel_grid, int x0, int y0, int xn, int yn)
+{
+  // the marked voxels become unknown, so stale obstacles neither come back
+  // nor keep the raytracing from clearing the cells again
+  const typename VoxelGridT::Column forget =
+    nav2_voxel_grid::VoxelColumn<typename VoxelGridT::Column>::unknown();
+  int size_x = static_cast<int>(size_x_), size_y = static_cast<int>(size_y_);
+  unsigned int sx = std::min(std::max(x0, 0), size_x);
+  unsigned int ex = std::min(std::max(xn, static_cast<int>(sx)), size_x);
+  unsigned int sy = std::min(std::max(y0, 0), size_y);
+  unsigned int ey = std::min(std::max(yn, static_cast<int>(sy)), size_y);
+
+  voxel_grid.maskColumns(0, 0, size_x_, sy, forget);
+  voxel_grid.maskColumns(0, sy, sx, ey, forget);
+  voxel_grid.maskColumns(ex, sy, size_x_, ey, forget);
+  voxel_grid.maskColumns(0, ey, size_x_, size_y_, forget);
 }
 
 }  // namespace nav2_costmap_2d
@@ -15,6 +15,8 @@
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <chrono>
+#include <future>
 #include <memory>
 
 #include "nav2_costmap_2d/clear_costmap_service.hpp"
@@ -40,6 +42,11 @@ ClearCostmapService::ClearCostmapService(
 
   node_->get_parameter("clearable_layers", clearable_layers_);
 
+  double update_frequency = 0.0;
+  node_->get_parameter("update_frequency", update_frequency);
+  clear_timeout_ = std::chrono::duration<double>(
+    update_frequency > 0.0 ? std::max(1.0, 5.0 / update_frequency) : 1.0);
+
   clear_except_service_ = node_->create_service<ClearExceptRegion>(
     "clear_except_" + costmap_.getName(),
     std::bind(
@@ -68,7 +75,7 @@ void ClearCostmapService::clearExceptRegionCallback(
     node_->get_logger(),
     "Received request to clear except a region the " + costmap_.getName());
 
-  clearExceptRegion(request->reset_distance);
+  waitForClear(clearExceptRegion(request->reset_distance));
 }
 
 void ClearCostmapService::clearAroundRobotCallback(
@@ -81,11 +88,11 @@ void ClearCostmapService::clearAroundRobotCallback(
     "Received request to clear around robot the " + costmap_.getName());
 
   if ((request->window_size_x == 0) || (request->window_size_y == 0)) {
-    clearEntirely();
+    waitForClear(clearEntirely());
     return;
   }
 
-  clearAroundRobot(request->window_size_x, request->window_size_y);
+  waitForClear(clearAroundRobot(request->window_size_x, request->window_size_y));
 }
 
 void ClearCostmapService::clearEntireCallback(
@@ -95,63 +102,75 @@ void ClearCostmapService::clearEntireCallback(
 {
   RCLCPP_INFO(node_->get_logger(), "Received request to clear entirely the " + costmap_.getName());
 
-  clearEntirely();
+  waitForClear(clearEntirely());
+}
+
+void ClearCostmapService::waitForClear(const std::shared_future<void> & cleared) const
+{
+  if (cleared.valid() && cleared.wait_for(clear_timeout_) != std::future_status::ready) {
+    RCLCPP_WARN(
+      node_->get_logger(),
+      "The " + costmap_.getName() + " was not updated in time, it will be cleared on its "
+      "next update");
+  }
 }
 
-void ClearCostmapService::clearExceptRegion(const double reset_distance)
+std::shared_future<void> ClearCostmapService::clearExceptRegion(const double reset_distance)
 {
   double x, y;
 
   if (!getPosition(x, y)) {
     RCLCPP_ERROR(node_->get_logger(), "Cannot clear map because robot pose cannot be retrieved.");
-    return;
+    return std::shared_future<void>();
   }
 
-  auto layers = costmap_.getLayeredCostmap()->getPlugins();
-
-  for (auto & layer : *layers) {
-    if (isClearable(getLayerName(*layer))) {
-      auto costmap_layer = std::static_pointer_cast<CostmapLayer>(layer);
-      clearLayerExceptRegion(costmap_layer, x, y, reset_distance);
-    }
-  }
+  return costmap_.getLayeredCostmap()->requestClear(
+    [this, x, y, reset_distance]() {
+      auto layers = costmap_.getLayeredCostmap()->getPlugins();
+
+      for (auto & layer : *layers) {
+        if (isClearable(getLayerName(*layer))) {
+          auto costmap_layer = std::static_pointer_cast<CostmapLayer>(layer);
+          clearLayerExceptRegion(costmap_layer, x, y, reset_distance);
+        }
+      }
+    });
 }
 
-void ClearCostmapService::clearAroundRobot(double window_size_x, double window_size_y)
+std::shared_future<void>
+ClearCostmapService::clearAroundRobot(double window_size_x, double window_size_y)
 {
   double pose_x, pose_y;
 
   if (!getPosition(pose_x, pose_y)) {
     RCLCPP_ERROR(node_->get_logger(), "Cannot clear map because robot pose cannot be retrieved.");
-    return;
+    return std::shared_future<void>();
   }
 
-  std::vector<geometry_msgs::msg::Point> clear_poly;
-  geometry_msgs::msg::Point pt;
-
-  pt.x = pose_x - window_size_x / 2;
-  pt.y = pose_y - window_size_y / 2;
-  clear_poly.push_back(pt);
-
-  pt.x = pose_x + window_size_x / 2;
-  pt.y = pose_y - window_size_y / 2;
-  clear_poly.push_back(pt);
-
-  pt.x = pose_x + window_size_x / 2;
-  pt.y = pose_y + window_size_y / 2;
-  clear_poly.push_back(pt);
-
-  pt.x = pose_x - window_size_x / 2;
-  pt.y = pose_y + window_size_y / 2;
-  clear_poly.push_back(pt);
-
-  costmap_.getCostmap()->setConvexPolygonCost(clear_poly, reset_value_);
+  return costmap_.getLayeredCostmap()->requestClear(
+    [this, pose_x, pose_y, window_size_x, window_size_y]() {
+      Costmap2D * costmap = costmap_.getCostmap();
+
+      int start_x, start_y, end_x, end_y;
+      costmap->worldToMapNoBounds(
+        pose_x - window_size_x / 2, pose_y - window_size_y / 2, start_x, start_y);
+      costmap->worldToMapNoBounds(
+        pose_x + window_size_x / 2, pose_y + window_size_y / 2, end_x, end_y);
+
+      // The window is axis aligned, so it's cleared a row at a time, up to the edges of the map
+      start_x = std::max(start_x, 0);
+      start_y = std::max(start_y, 0);
+      end_x = std::min(end_x + 1, static_cast<int>(costmap->getSizeInCellsX()));
+      end_y = std::min(end_y + 1, static_cast<int>(costmap->getSizeInCellsY()));
+      if (start_x < end_x && start_y < end_y) {
+        costmap->resetMapToValue(start_x, start_y, end_x, end_y, reset_value_);
+      }
+    });
 }
 
-void ClearCostmapService::clearEntirely()
+std::shared_future<void> ClearCostmapService::clearEntirely()
 {
-  std::unique_lock<Costmap2D::mutex_t> lock(*(costmap_.getCostmap()->getMutex()));
-  costmap_.resetLayers();
+  return costmap_.getLayeredCostmap()->requestClear([this]() {costmap_.resetLayers();});
 }
 
 bool ClearCostmapService::isClearable(const string & layer_name) const
@@ -162,8 +181,6 @@ bool ClearCostmapService::isClearable(const string & layer_name) const
 void ClearCostmapService::clearLayerExceptRegion(
   shared_ptr<CostmapLayer> & costmap, double pose_x, double pose_y, double reset_distance)
 {
-  std::unique_lock<Costmap2D::mutex_t> lock(*(costmap->getMutex()));
-
   double start_point_x = pose_x - reset_distance / 2;
   double start_point_y = pose_y - reset_distance / 2;
   double end_point_x = start_point_x + reset_distance;
@@ -173,22 +190,8 @@ void ClearCostmapService::clearLayerExceptRegion(
   costmap->worldToMapNoBounds(start_point_x, start_point_y, start_x, start_y);
   costmap->worldToMapNoBounds(end_point_x, end_point_y, end_x, end_y);
 
-  unsigned int size_x = costmap->getSizeInCellsX();
-  unsigned int size_y = costmap->getSizeInCellsY();
-
-  // Clearing the four rectangular regions around the one we want to keep
-  // top region
-  costmap->resetMapToValue(0, 0, size_x, start_y, reset_value_);
-  // left region
-  costmap->resetMapToValue(0, start_y, start_x, end_y, reset_value_);
-  // right region
-  costmap->resetMapToValue(end_x, start_y, size_x, end_y, reset_value_);
-  // bottom region
-  costmap->resetMapToValue(0, end_y, size_x, size_y, reset_value_);
-
-  double ox = costmap->getOriginX(), oy = costmap->getOriginY();
-  double width = costmap->getSizeInMetersX(), height = costmap->getSizeInMetersY();
-  costmap->addExtraBounds(ox, oy, ox + width, oy + height);
+  // Clearing everything around the region we want to keep, which may reach past the map
+  costmap->resetOutside(start_x, start_y, end_x, end_y, reset_value_);
 }
 
 bool ClearCostmapService::getPosition(double & x, double & y) const
@@ -16,13 +16,14 @@
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <utility>
 
 #include "nav2_costmap_2d/collision_checker.hpp"
 
 #include "nav2_costmap_2d/cost_values.hpp"
 #include "nav2_costmap_2d/exceptions.hpp"
 #include "nav2_costmap_2d/footprint.hpp"
-#include "nav2_util/line_iterator.hpp"
+#include "nav2_util/grid_geometry.hpp"
 
 using namespace std::chrono_literals;
 
@@ -67,11 +68,101 @@ bool CollisionChecker::isCollisionFree(
   }
 }
 
+bool CollisionChecker::isPathCollisionFree(
+  const std::vector<geometry_msgs::msg::Pose2D> & poses)
+{
+  try {
+    scorePath(poses);
+    return true;
+  } catch (const IllegalPoseException & e) {
+    RCLCPP_ERROR(rclcpp::get_logger(name_), "%s", e.what());
+    return false;
+  } catch (const CollisionCheckerException & e) {
+    RCLCPP_ERROR(rclcpp::get_logger(name_), "%s", e.what());
+    return false;
+  } catch (...) {
+    RCLCPP_ERROR(rclcpp::get_logger(name_), "Failed to check path score!");
+    return false;
+  }
+}
+
+double CollisionChecker::scorePath(
+  const std::vector<geometry_msgs::msg::Pose2D> & poses)
+{
+  if (poses.empty()) {
+    return 0.0;
+  }
+
+  try {
+    costmap_ = costmap_sub_.getCostmapView();
+  } catch (const std::runtime_error & e) {
+    throw CollisionCheckerException(e.what());
+  }
+
+  // only rasterized again when the footprint or the resolution changed
+  footprint_mask_.setFootprint(getFootprintSpec(), costmap_->getResolution());
+
+  // stop at the first pose that collides, the rest of the path doesn't matter then
+  double path_cost = footprint_mask_.trajectoryFootprintCost(
+    *costmap_, poses, LETHAL_OBSTACLE);
+  if (path_cost < 0.0) {
+    throw IllegalPoseException(name_, "Footprint Goes Off Grid.");
+  } else if (path_cost == LETHAL_OBSTACLE) {
+    throw IllegalPoseException(name_, "Footprint Hits Obstacle.");
+  } else if (path_cost == NO_INFORMATION) {
+    throw IllegalPoseException(name_, "Footprint Hits Unknown Region.");
+  }
+
+  return path_cost;
+}
+
+bool CollisionChecker::isSweepCollisionFree(
+  const geometry_msgs::msg::Pose2D & pose, double angle)
+{
+  try {
+    scoreSweep(pose, angle);
+    return true;
+  } catch (const IllegalPoseException & e) {
+    RCLCPP_DEBUG(rclcpp::get_logger(name_), "%s", e.what());
+    return false;
+  } catch (const CollisionCheckerException & e) {
+    RCLCPP_ERROR(rclcpp::get_logger(name_), "%s", e.what());
+    return false;
+  } catch (...) {
+    RCLCPP_ERROR(rclcpp::get_logger(name_), "Failed to check sweep score!");
+    return false;
+  }
+}
+
+double CollisionChecker::scoreSweep(
+  const geometry_msgs::msg::Pose2D & pose, double angle)
+{
+  try {
+    costmap_ = costmap_sub_.getCostmapView();
+  } catch (const std::runtime_error & e) {
+    throw CollisionCheckerException(e.what());
+  }
+
+  footprint_mask_.setFootprint(getFootprintSpec(), costmap_->getResolution());
+
+  double sweep_cost = footprint_mask_.sweptFootprintCost(
+    *costmap_, pose.x, pose.y, pose.theta, angle, LETHAL_OBSTACLE);
+  if (sweep_cost < 0.0) {
+    throw IllegalPoseException(name_, "Swept Footprint Goes Off Grid.");
+  } else if (sweep_cost == LETHAL_OBSTACLE) {
+    throw IllegalPoseException(name_, "Swept Footprint Hits Obstacle.");
+  } else if (sweep_cost == NO_INFORMATION) {
+    throw IllegalPoseException(name_, "Swept Footprint Hits Unknown Region.");
+  }
+
+  return sweep_cost;
+}
+
 double CollisionChecker::scorePose(
   const geometry_msgs::msg::Pose2D & pose)
 {
   try {
-    costmap_ = costmap_sub_.getCostmap();
+    costmap_ = costmap_sub_.getCostmapView();
   } catch (const std::runtime_error & e) {
     throw CollisionCheckerException(e.what());
   }
@@ -96,42 +187,45 @@ void CollisionChecker::worldToMap(double wx, double wy, unsigned int & mx, unsig
 Footprint CollisionChecker::getFootprint(const geometry_msgs::msg::Pose2D & pose)
 {
   Footprint footprint;
-  if (!footprint_sub_.getFootprint(footprint)) {
-    throw CollisionCheckerException("Current footprint not available.");
-  }
-
-  Footprint footprint_spec;
-  unorientFootprint(footprint, footprint_spec);
-  transformFootprint(pose.x, pose.y, pose.theta, footprint_spec, footprint);
+  transformFootprint(pose.x, pose.y, pose.theta, getFootprintSpec(), footprint);
 
   return footprint;
 }
 
-double CollisionChecker::footprintCost(const Footprint footprint)
+const Footprint & CollisionChecker::getFootprintSpec()
 {
-  // now we really have to lay down the footprint in the costmap_ grid
-  unsigned int x0, x1, y0, y1;
-  double footprint_cost = 0.0;
-
-  // we need to rasterize each line in the footprint
-  for (unsigned int i = 0; i < footprint.size() - 1; ++i) {
-    // get the cell coord of the first point
-    worldToMap(footprint[i].x, footprint[i].y, x0, y0);
-
-    // get the cell coord of the second point
-    worldToMap(footprint[i + 1].x, footprint[i + 1].y, x1, y1);
+  geometry_msgs::msg::PolygonStamped::ConstSharedPtr footprint_msg;
+  if (!footprint_sub_.getFootprintMsg(footprint_msg)) {
+    throw CollisionCheckerException("Current footprint not available.");
+  }
 
-    footprint_cost = std::max(lineCost(x0, x1, y0, y1), footprint_cost);
+  if (footprint_msg != footprint_msg_) {
+    Footprint footprint = toPointVector(
+      std::make_shared<geometry_msgs::msg::Polygon>(footprint_msg->polygon));
+    unorientFootprint(footprint, footprint_spec_);
+    footprint_msg_ = footprint_msg;
   }
 
-  // we also need to connect the first point in the footprint to the last point
-  // get the cell coord of the last point
-  worldToMap(footprint.back().x, footprint.back().y, x0, y0);
+  return footprint_spec_;
+}
 
-  // get the cell coord of the first point
-  worldToMap(footprint.front().x, footprint.front().y, x1, y1);
+double CollisionChecker::footprintCost(const Footprint footprint)
+{
+  // now we really have to lay down the footprint in the costmap_ grid, finding the cells
+  // of all its points at once
+  std::vector<std::pair<int, int>> cells;
+  if (!costmap_->worldToMap(footprint, cells)) {
+    throw IllegalPoseException(name_, "Footprint Goes Off Grid.");
+  }
 
-  footprint_cost = std::max(lineCost(x0, x1, y0, y1), footprint_cost);
+  // we need to rasterize each line in the footprint, and connect the last point to the first
+  double footprint_cost = 0.0;
+  for (unsigned int i = 0; i < cells.size(); ++i) {
+    const std::pair<int, int> & start = cells[i];
+    const std::pair<int, int> & end = cells[(i + 1) % cells.size()];
+    footprint_cost = std::max(
+      lineCost(start.first, end.first, start.second, end.second), footprint_cost);
+  }
 
   // if all line costs are legal... then we can return that the footprint is legal
   return footprint_cost;
@@ -139,16 +233,26 @@ double CollisionChecker::footprintCost(const Footprint footprint)
 
 double CollisionChecker::lineCost(int x0, int x1, int y0, int y1) const
 {
-  double line_cost = 0.0;
-  double point_cost = -1.0;
-
-  for (nav2_util::LineIterator line(x0, y0, x1, y1); line.isValid(); line.advance()) {
-    point_cost = pointCost(line.getX(), line.getY());   // Score the current point
-
-    if (line_cost < point_cost) {
-      line_cost = point_cost;
-    }
-  }
+  const unsigned char * grid = costmap_->getCharMap();
+  const unsigned int size_x = costmap_->getSizeInCellsX();
+  unsigned char line_cost = 0;
+
+  nav2_util::traceLineSpans(
+    x0, y0, x1, y1, [&](int y, int x_min, int x_max) {
+      // a plain max reduction over the run, which the compiler vectorizes
+      const unsigned char * row = grid + y * size_x;
+      unsigned char span_cost = 0;
+      for (int x = x_min; x <= x_max; ++x) {
+        span_cost = std::max(span_cost, row[x]);
+      }
+      if (span_cost >= LETHAL_OBSTACLE) {
+        // find the cell that makes the line illegal
+        for (int x = x_min; x <= x_max; ++x) {
+          pointCost(x, y);
+        }
+      }
+      line_cost = std::max(line_cost, span_cost);
+    });
 
   return line_cost;
 }
@@ -0,0 +1,157 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_costmap_2d/cost_combination.hpp"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace nav2_costmap_2d
+{
+
+#if defined(__SSE2__)
+
+// The kernels compute the combined cost of 16 cells as if both were known, then
+// select the master cost where the layer has no information and, for max and
+// addition, the layer cost where the master has none.
+
+static inline __m128i blend(__m128i mask, __m128i a, __m128i b)
+{
+  return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+template<typename Combine>
+static inline void combineRow(
+  const unsigned char * layer, std::size_t size, unsigned char * master,
+  bool unknown_master, Combine combine, unsigned char (* scalar)(unsigned char, unsigned char))
+{
+  const __m128i unknown = _mm_set1_epi8(static_cast<char>(NO_INFORMATION));
+  std::size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    __m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i *>(layer + i));
+    __m128i m = _mm_loadu_si128(reinterpret_cast<const __m128i *>(master + i));
+    __m128i out = combine(m, l);
+    if (unknown_master) {
+      out = blend(_mm_cmpeq_epi8(m, unknown), l, out);
+    }
+    out = blend(_mm_cmpeq_epi8(l, unknown), m, out);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(master + i), out);
+  }
+  for (; i < size; ++i) {
+    master[i] = scalar(master[i], layer[i]);
+  }
+}
+
+void combineMax(const unsigned char * layer, std::size_t size, unsigned char * master)
+{
+  combineRow(
+    layer, size, master, true,
+    [](__m128i m, __m128i l) {return _mm_max_epu8(m, l);}, combineMax);
+}
+
+void combineOverwrite(const unsigned char * layer, std::size_t size, unsigned char * master)
+{
+  combineRow(
+    layer, size, master, false,
+    [](__m128i, __m128i l) {return l;}, combineOverwrite);
+}
+
+void combineAddition(const unsigned char * layer, std::size_t size, unsigned char * master)
+{
+  // a saturated sum of 255 still clamps to the same 252
+  const __m128i limit = _mm_set1_epi8(static_cast<char>(INSCRIBED_INFLATED_OBSTACLE - 1));
+  combineRow(
+    layer, size, master, true,
+    [limit](__m128i m, __m128i l) {return _mm_min_epu8(_mm_adds_epu8(m, l), limit);},
+    combineAddition);
+}
+
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+
+// The same kernels as with SSE2, see above
+
+template<typename Combine>
+static inline void combineRow(
+  const unsigned char * layer, std::size_t size, unsigned char * master,
+  bool unknown_master, Combine combine, unsigned char (* scalar)(unsigned char, unsigned char))
+{
+  const uint8x16_t unknown = vdupq_n_u8(NO_INFORMATION);
+  std::size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    uint8x16_t l = vld1q_u8(layer + i);
+    uint8x16_t m = vld1q_u8(master + i);
+    uint8x16_t out = combine(m, l);
+    if (unknown_master) {
+      out = vbslq_u8(vceqq_u8(m, unknown), l, out);
+    }
+    out = vbslq_u8(vceqq_u8(l, unknown), m, out);
+    vst1q_u8(master + i, out);
+  }
+  for (; i < size; ++i) {
+    master[i] = scalar(master[i], layer[i]);
+  }
+}
+
+void combineMax(const unsigned char * layer, std::size_t size, unsigned char * master)
+{
+  combineRow(
+    layer, size, master, true,
+    [](uint8x16_t m, uint8x16_t l) {return vmaxq_u8(m, l);}, combineMax);
+}
+
+void combineOverwrite(const unsigned char * layer, std::size_t size, unsigned char * master)
+{
+  combineRow(
+    layer, size, master, false,
+    [](uint8x16_t, uint8x16_t l) {return l;}, combineOverwrite);
+}
+
+void combineAddition(const unsigned char * layer, std::size_t size, unsigned char * master)
+{
+  const uint8x16_t limit = vdupq_n_u8(INSCRIBED_INFLATED_OBSTACLE - 1);
+  combineRow(
+    layer, size, master, true,
+    [limit](uint8x16_t m, uint8x16_t l) {return vminq_u8(vqaddq_u8(m, l), limit);},
+    combineAddition);
+}
+
+#else
+
+void combineMax(const unsigned char * layer, std::size_t size, unsigned char * master)
+{
+  for (std::size_t i = 0; i < size; ++i) {
+    master[i] = combineMax(master[i], layer[i]);
+  }
+}
+
+void combineOverwrite(const unsigned char * layer, std::size_t size, unsigned char * master)
+{
+  for (std::size_t i = 0; i < size; ++i) {
+    master[i] = combineOverwrite(master[i], layer[i]);
+  }
+}
+
+void combineAddition(const unsigned char * layer, std::size_t size, unsigned char * master)
+{
+  for (std::size_t i = 0; i < size; ++i) {
+    master[i] = combineAddition(master[i], layer[i]);
+  }
+}
+
+#endif
+
+}  // namespace nav2_costmap_2d
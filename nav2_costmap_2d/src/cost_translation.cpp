@@ -0,0 +1,111 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_costmap_2d/cost_translation.hpp"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace nav2_costmap_2d
+{
+
+#if defined(__SSE2__)
+
+// Scales eight 16 bit costs of 1 to 252 into 1 to 98. The division by 251 is
+// done as a multiplication by 2^22 / 251 rounded up, which is exact for all
+// dividends up to 97 * 251.
+static inline __m128i scaleCosts(__m128i costs)
+{
+  const __m128i one = _mm_set1_epi16(1);
+  __m128i scaled = _mm_mullo_epi16(_mm_sub_epi16(costs, one), _mm_set1_epi16(97));
+  scaled = _mm_srli_epi16(_mm_mulhi_epu16(scaled, _mm_set1_epi16(16711)), 6);
+  return _mm_add_epi16(scaled, one);
+}
+
+static inline __m128i selectSpecial(
+  __m128i costs, __m128i translated, unsigned char cost, char value)
+{
+  __m128i mask = _mm_cmpeq_epi8(costs, _mm_set1_epi8(static_cast<char>(cost)));
+  return _mm_or_si128(
+    _mm_andnot_si128(mask, translated), _mm_and_si128(mask, _mm_set1_epi8(value)));
+}
+
+void translateCosts(const unsigned char * costs, std::size_t size, int8_t * occupancy)
+{
+  const __m128i zero = _mm_setzero_si128();
+  std::size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i *>(costs + i));
+    __m128i out = _mm_packus_epi16(
+      scaleCosts(_mm_unpacklo_epi8(in, zero)), scaleCosts(_mm_unpackhi_epi8(in, zero)));
+    out = selectSpecial(in, out, 0, 0);
+    out = selectSpecial(in, out, 253, 99);
+    out = selectSpecial(in, out, 254, 100);
+    out = selectSpecial(in, out, 255, -1);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(occupancy + i), out);
+  }
+  for (; i < size; ++i) {
+    occupancy[i] = translateCost(costs[i]);
+  }
+}
+
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+
+// Keeps the whole 256 entry table in 16 registers and translates 16 costs with
+// four 64 byte table lookups. Each lookup yields 0 outside of its quarter of the
+// table, so the quarters are combined with a plain or.
+void translateCosts(const unsigned char * costs, std::size_t size, int8_t * occupancy)
+{
+  uint8_t table[256];
+  for (unsigned int c = 0; c < 256; ++c) {
+    table[c] = static_cast<uint8_t>(translateCost(static_cast<unsigned char>(c)));
+  }
+  const uint8x16x4_t quarter0 = vld1q_u8_x4(table);
+  const uint8x16x4_t quarter1 = vld1q_u8_x4(table + 64);
+  const uint8x16x4_t quarter2 = vld1q_u8_x4(table + 128);
+  const uint8x16x4_t quarter3 = vld1q_u8_x4(table + 192);
+  const uint8x16_t offset = vdupq_n_u8(64);
+
+  std::size_t i = 0;
+  for (; i + 16 <= size; i += 16) {
+    uint8x16_t index = vld1q_u8(costs + i);
+    uint8x16_t out = vqtbl4q_u8(quarter0, index);
+    index = vsubq_u8(index, offset);
+    out = vorrq_u8(out, vqtbl4q_u8(quarter1, index));
+    index = vsubq_u8(index, offset);
+    out = vorrq_u8(out, vqtbl4q_u8(quarter2, index));
+    index = vsubq_u8(index, offset);
+    out = vorrq_u8(out, vqtbl4q_u8(quarter3, index));
+    vst1q_u8(reinterpret_cast<uint8_t *>(occupancy + i), out);
+  }
+  for (; i < size; ++i) {
+    occupancy[i] = translateCost(costs[i]);
+  }
+}
+
+#else
+
+void translateCosts(const unsigned char * costs, std::size_t size, int8_t * occupancy)
+{
+  for (std::size_t i = 0; i < size; ++i) {
+    occupancy[i] = translateCost(costs[i]);
+  }
+}
+
+#endif
+
+}  // namespace nav2_costmap_2d
@@ -42,6 +42,8 @@
 #include <string>
 #include <vector>
 
+#include "nav2_util/large_buffer.hpp"
+
 namespace nav2_costmap_2d
 {
 Costmap2D::Costmap2D(
@@ -50,7 +52,7 @@ Costmap2D::Costmap2D(
 : size_x_(cells_size_x), size_y_(cells_size_y), resolution_(resolution), origin_x_(origin_x),
   origin_y_(origin_y), costmap_(NULL), default_value_(default_value)
 {
-  access_ = new mutex_t();
+  access_ = new mutex_t("costmap");
 
   // create the costmap
   initMaps(size_x_, size_y_);
@@ -61,28 +63,35 @@ void Costmap2D::deleteMaps()
 {
   // clean up data
   std::unique_lock<mutex_t> lock(*access_);
-  delete[] costmap_;
+  nav2_util::free_large_buffer(costmap_);
   costmap_ = NULL;
 }
 
 void Costmap2D::initMaps(unsigned int size_x, unsigned int size_y)
 {
   std::unique_lock<mutex_t> lock(*access_);
-  delete[] costmap_;
-  costmap_ = new unsigned char[size_x * size_y];
+  // backed by huge pages for the random reads of inflation and planning, and kept
+  // when a resize still fits in it
+  costmap_ = static_cast<unsigned char *>(
+    nav2_util::reallocate_large_buffer(costmap_, size_x * size_y));
 }
 
 void Costmap2D::resizeMap(
   unsigned int size_x, unsigned int size_y, double resolution,
   double origin_x, double origin_y)
 {
+  // reuse the existing grid when the dimensions match, otherwise reallocate
+  bool reallocate = costmap_ == NULL || size_x_ != size_x || size_y_ != size_y;
+
   size_x_ = size_x;
   size_y_ = size_y;
   resolution_ = resolution;
   origin_x_ = origin_x;
   origin_y_ = origin_y;
 
-  initMaps(size_x, size_y);
+  if (reallocate) {
+    initMaps(size_x, size_y);
+  }
 
   // reset our maps to have no information
   resetMaps();
@@ -92,6 +101,7 @@ void Costmap2D::resetMaps()
 {
   std::unique_lock<mutex_t> lock(*access_);
   memset(costmap_, default_value_, size_x_ * size_y_ * sizeof(unsigned char));
+  markAllChanged();
 }
 
 void Costmap2D::resetMap(unsigned int x0, unsigned int y0, unsigned int xn, unsigned int yn)
@@ -107,6 +117,27 @@ void Costmap2D::resetMapToValue(
   for (unsigned int y = y0 * size_x_ + x0; y < yn * size_x_ + x0; y += size_x_) {
     memset(costmap_ + y, value, len * sizeof(unsigned char));
   }
+  markChanged(x0, y0, xn, yn);
+}
+
+void Costmap2D::resetMapOutside(int x0, int y0, int xn, int yn, unsigned char value)
+{
+  std::unique_lock<mutex_t> lock(*(access_));
+  int size_x = static_cast<int>(size_x_);
+  int size_y = static_cast<int>(size_y_);
+  x0 = std::min(std::max(x0, 0), size_x);
+  xn = std::min(std::max(xn, x0), size_x);
+  y0 = std::min(std::max(y0, 0), size_y);
+  yn = std::min(std::max(yn, y0), size_y);
+
+  memset(costmap_, value, y0 * size_x_ * sizeof(unsigned char));
+  for (int y = y0; y < yn; ++y) {
+    unsigned char * row = costmap_ + y * size_x_;
+    memset(row, value, x0 * sizeof(unsigned char));
+    memset(row + xn, value, (size_x - xn) * sizeof(unsigned char));
+  }
+  memset(costmap_ + yn * size_x_, value, (size_y - yn) * size_x_ * sizeof(unsigned char));
+  markChanged(0, 0, size_x_, size_y_);
 }
 
 bool Costmap2D::copyCostmapWindow(
@@ -148,9 +179,37 @@ bool Costmap2D::copyCostmapWindow(
     map.costmap_, lower_left_x, lower_left_y, map.size_x_, costmap_, 0, 0, size_x_,
     size_x_,
     size_y_);
+  markAllChanged();
   return true;
 }
 
+void Costmap2D::copyWindowFrom(
+  const Costmap2D & map, unsigned int x0, unsigned int y0, unsigned int xn, unsigned int yn)
+{
+  if (this == &map) {
+    return;
+  }
+
+  std::unique_lock<mutex_t> lock(*access_);
+  if (costmap_ == NULL || size_x_ != map.size_x_ || size_y_ != map.size_y_) {
+    size_x_ = map.size_x_;
+    size_y_ = map.size_y_;
+    default_value_ = map.default_value_;
+    initMaps(size_x_, size_y_);
+    resetMaps();
+  }
+  resolution_ = map.resolution_;
+  origin_x_ = map.origin_x_;
+  origin_y_ = map.origin_y_;
+
+  xn = std::min(xn, size_x_);
+  yn = std::min(yn, size_y_);
+  if (x0 < xn && y0 < yn) {
+    copyMapRegion(
+      map.costmap_, x0, y0, map.size_x_, costmap_, x0, y0, size_x_, xn - x0, yn - y0);
+  }
+}
+
 Costmap2D & Costmap2D::operator=(const Costmap2D & map)
 {
   // check for self assignement
@@ -158,20 +217,25 @@ Costmap2D & Costmap2D::operator=(const Costmap2D & map)
     return *this;
   }
 
-  // clean up old data
-  deleteMaps();
+  // reuse the existing grid when the dimensions match, otherwise reallocate
+  if (costmap_ == NULL || size_x_ != map.size_x_ || size_y_ != map.size_y_) {
+    // clean up old data
+    deleteMaps();
+
+    size_x_ = map.size_x_;
+    size_y_ = map.size_y_;
+
+    // initialize our various maps
+    initMaps(size_x_, size_y_);
+  }
 
-  size_x_ = map.size_x_;
-  size_y_ = map.size_y_;
   resolution_ = map.resolution_;
   origin_x_ = map.origin_x_;
   origin_y_ = map.origin_y_;
 
-  // initialize our various maps
-  initMaps(size_x_, size_y_);
-
   // copy the cost map
   memcpy(costmap_, map.costmap_, size_x_ * size_y_ * sizeof(unsigned char));
+  markAllChanged();
 
   return *this;
 }
@@ -179,7 +243,7 @@ Costmap2D & Costmap2D::operator=(const Costmap2D & map)
 Costmap2D::Costmap2D(const Costmap2D & map)
 : costmap_(NULL)
 {
-  access_ = new mutex_t();
+  access_ = new mutex_t("costmap");
   *this = map;
 }
 
@@ -187,7 +251,7 @@ Costmap2D::Costmap2D(const Costmap2D & map)
 Costmap2D::Costmap2D()
 : size_x_(0), size_y_(0), resolution_(0.0), origin_x_(0.0), origin_y_(0.0), costmap_(NULL)
 {
-  access_ = new mutex_t();
+  access_ = new mutex_t("costmap");
 }
 
 Costmap2D::~Costmap2D()
@@ -202,6 +266,77 @@ unsigned int Costmap2D::cellDistance(double world_dist)
   return (unsigned int)cells_dist;
 }
 
+void Costmap2D::markChanged(unsigned int x0, unsigned int y0, unsigned int xn, unsigned int yn)
+{
+  std::unique_lock<mutex_t> lock(*access_);
+  const unsigned int num_tiles_x = getNumChangeTilesX();
+  if (tile_change_counts_.size() != num_tiles_x * getNumChangeTilesY()) {
+    markAllChanged();
+    return;
+  }
+  ++change_count_;
+  change_history_[change_count_ % CHANGE_HISTORY_SIZE] = ChangedBounds{x0, y0, xn, yn};
+
+  xn = std::min(xn, size_x_);
+  yn = std::min(yn, size_y_);
+  if (x0 >= xn || y0 >= yn) {
+    return;
+  }
+  for (unsigned int ty = y0 / CHANGE_TILE_SIZE; ty <= (yn - 1) / CHANGE_TILE_SIZE; ++ty) {
+    uint64_t * row = &tile_change_counts_[ty * num_tiles_x];
+    std::fill(row + x0 / CHANGE_TILE_SIZE, row + (xn - 1) / CHANGE_TILE_SIZE + 1, change_count_);
+  }
+}
+
+void Costmap2D::markAllChanged()
+{
+  std::unique_lock<mutex_t> lock(*access_);
+  full_change_count_ = ++change_count_;
+  tile_change_counts_.assign(getNumChangeTilesX() * getNumChangeTilesY(), change_count_);
+}
+
+uint64_t Costmap2D::getChangeCount() const
+{
+  std::unique_lock<mutex_t> lock(*access_);
+  return change_count_;
+}
+
+bool Costmap2D::getChangedBounds(
+  uint64_t since, unsigned int & x0, unsigned int & y0,
+  unsigned int & xn, unsigned int & yn) const
+{
+  std::unique_lock<mutex_t> lock(*access_);
+  if (since > change_count_ || since < full_change_count_ ||
+    change_count_ - since > CHANGE_HISTORY_SIZE)
+  {
+    return false;
+  }
+
+  x0 = size_x_;
+  y0 = size_y_;
+  xn = yn = 0;
+  for (uint64_t i = since + 1; i <= change_count_; ++i) {
+    const ChangedBounds & bounds = change_history_[i % CHANGE_HISTORY_SIZE];
+    x0 = std::min(x0, bounds.x0);
+    y0 = std::min(y0, bounds.y0);
+    xn = std::max(xn, std::min(bounds.xn, size_x_));
+    yn = std::max(yn, std::min(bounds.yn, size_y_));
+  }
+  return true;
+}
+
+void Costmap2D::getChangedTiles(uint64_t since, std::vector<unsigned int> & tiles) const
+{
+  std::unique_lock<mutex_t> lock(*access_);
+  tiles.clear();
+  for (unsigned int i = 0; i < tile_change_counts_.size(); ++i) {
+    // a counter from the future can only come from another map, everything changed for it
+    if (tile_change_counts_[i] > since || since > change_count_) {
+      tiles.push_back(i);
+    }
+  }
+}
+
 unsigned char * Costmap2D::getCharMap() const
 {
   return costmap_;
@@ -280,47 +415,19 @@ void Costmap2D::updateOrigin(double new_origin_x, double new_origin_y)
   new_grid_ox = origin_x_ + cell_ox * resolution_;
   new_grid_oy = origin_y_ + cell_oy * resolution_;
 
-  // To save casting from unsigned int to int a bunch of times
-  int size_x = size_x_;
-  int size_y = size_y_;
-
-  // we need to compute the overlap of the new and existing windows
-  int lower_left_x, lower_left_y, upper_right_x, upper_right_y;
-  lower_left_x = std::min(std::max(cell_ox, 0), size_x);
-  lower_left_y = std::min(std::max(cell_oy, 0), size_y);
-  upper_right_x = std::min(std::max(cell_ox + size_x, 0), size_x);
-  upper_right_y = std::min(std::max(cell_oy + size_y, 0), size_y);
-
-  unsigned int cell_size_x = upper_right_x - lower_left_x;
-  unsigned int cell_size_y = upper_right_y - lower_left_y;
-
-  // we need a map to store the obstacles in the window temporarily
-  unsigned char * local_map = new unsigned char[cell_size_x * cell_size_y];
-
-  // copy the local window in the costmap to the local map
-  copyMapRegion(
-    costmap_, lower_left_x, lower_left_y, size_x_, local_map, 0, 0, cell_size_x,
-    cell_size_x,
-    cell_size_y);
-
-  // now we'll set the costmap to be completely unknown if we track unknown space
-  resetMaps();
+  // move the overlap of the old and new windows into its new place, and
+  // set the cells that come into the window to be unknown if we track unknown space
+  {
+    std::unique_lock<mutex_t> lock(*access_);
+    shiftMap(costmap_, size_x_, size_y_, cell_ox, cell_oy, default_value_);
+    if (cell_ox != 0 || cell_oy != 0) {
+      markAllChanged();
+    }
+  }
 
   // update the origin with the appropriate world coordinates
   origin_x_ = new_grid_ox;
   origin_y_ = new_grid_oy;
-
-  // compute the starting cell location for copying data back in
-  int start_x = lower_left_x - cell_ox;
-  int start_y = lower_left_y - cell_oy;
-
-  // now we want to copy the overlapping information back into the map, but in its new location
-  copyMapRegion(
-    local_map, 0, 0, cell_size_x, costmap_, start_x, start_y, size_x_, cell_size_x,
-    cell_size_y);
-
-  // make sure to clean up
-  delete[] local_map;
 }
 
 bool Costmap2D::setConvexPolygonCost(
@@ -329,25 +436,23 @@ bool Costmap2D::setConvexPolygonCost(
 {
   // we assume the polygon is given in the global_frame...
   // we need to transform it to map coordinates
-  std::vector<MapLocation> map_polygon;
+  fill_polygon_.resize(polygon.size());
   for (unsigned int i = 0; i < polygon.size(); ++i) {
-    MapLocation loc;
+    MapLocation & loc = fill_polygon_[i];
     if (!worldToMap(polygon[i].x, polygon[i].y, loc.x, loc.y)) {
       // ("Polygon lies outside map bounds, so we can't fill it");
       return false;
     }
-    map_polygon.push_back(loc);
+  }
+  if (fill_polygon_.size() < 3) {
+    return true;
   }
 
-  std::vector<MapLocation> polygon_cells;
-
-  // get the cells that fill the polygon
-  convexFillCells(map_polygon, polygon_cells);
-
-  // set the cost of those cells
-  for (unsigned int i = 0; i < polygon_cells.size(); ++i) {
-    unsigned int index = getIndex(polygon_cells[i].x, polygon_cells[i].y);
-    costmap_[index] = cost_value;
+  // set the cost of the cells that fill the polygon, a row at a time
+  unsigned int y = convexFillSpans(fill_polygon_);
+  for (const auto & span : fill_spans_) {
+    memset(costmap_ + getIndex(span.first, y), cost_value, span.second - span.first + 1);
+    ++y;
   }
   return true;
 }
@@ -378,64 +483,39 @@ void Costmap2D::convexFillCells(
     return;
   }
 
-  // first get the cells that make up the outline of the polygon
-  polygonOutlineCells(polygon, polygon_cells);
-
-  // quick bubble sort to sort points by x
-  MapLocation swap;
-  unsigned int i = 0;
-  while (i < polygon_cells.size() - 1) {
-    if (polygon_cells[i].x > polygon_cells[i + 1].x) {
-      swap = polygon_cells[i];
-      polygon_cells[i] = polygon_cells[i + 1];
-      polygon_cells[i + 1] = swap;
-
-      if (i > 0) {
-        --i;
-      }
-    } else {
-      ++i;
+  MapLocation pt;
+  pt.y = convexFillSpans(polygon);
+  for (const auto & span : fill_spans_) {
+    for (pt.x = span.first; pt.x <= span.second; ++pt.x) {
+      polygon_cells.push_back(pt);
     }
+    ++pt.y;
   }
+}
 
-  i = 0;
-  MapLocation min_pt;
-  MapLocation max_pt;
-  unsigned int min_x = polygon_cells[0].x;
-  unsigned int max_x = polygon_cells[polygon_cells.size() - 1].x;
-
-  // walk through each column and mark cells inside the polygon
-  for (unsigned int x = min_x; x <= max_x; ++x) {
-    if (i >= polygon_cells.size() - 1) {
-      break;
-    }
-
-    if (polygon_cells[i].y < polygon_cells[i + 1].y) {
-      min_pt = polygon_cells[i];
-      max_pt = polygon_cells[i + 1];
-    } else {
-      min_pt = polygon_cells[i + 1];
-      max_pt = polygon_cells[i];
-    }
-
-    i += 2;
-    while (i < polygon_cells.size() && polygon_cells[i].x == x) {
-      if (polygon_cells[i].y < min_pt.y) {
-        min_pt = polygon_cells[i];
-      } else if (polygon_cells[i].y > max_pt.y) {
-        max_pt = polygon_cells[i];
-      }
-      ++i;
-    }
-
-    MapLocation pt;
-    // loop though cells in the column
-    for (unsigned int y = min_pt.y; y < max_pt.y; ++y) {
-      pt.x = x;
-      pt.y = y;
-      polygon_cells.push_back(pt);
-    }
+unsigned int Costmap2D::convexFillSpans(const std::vector<MapLocation> & polygon)
+{
+  unsigned int min_y = polygon[0].y, max_y = polygon[0].y;
+  for (const MapLocation & vertex : polygon) {
+    min_y = std::min(min_y, vertex.y);
+    max_y = std::max(max_y, vertex.y);
+  }
+  fill_spans_.assign(max_y - min_y + 1, std::make_pair(UINT_MAX, 0u));
+
+  // widen the span of each row to the outline cells in it
+  auto widen = [this, min_y](unsigned int offset) {
+      unsigned int x, y;
+      indexToCells(offset, x, y);
+      std::pair<unsigned int, unsigned int> & span = fill_spans_[y - min_y];
+      span.first = std::min(span.first, x);
+      span.second = std::max(span.second, x);
+    };
+  for (unsigned int i = 0; i < polygon.size(); ++i) {
+    const MapLocation & start = polygon[i];
+    const MapLocation & end = polygon[(i + 1) % polygon.size()];
+    raytraceLine(widen, start.x, start.y, end.x, end.y);
   }
+  return min_y;
 }
 
 unsigned int Costmap2D::getSizeInCellsX() const
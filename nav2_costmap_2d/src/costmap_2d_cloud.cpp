@@ -33,6 +33,7 @@
 #include "sensor_msgs/msg/channel_float32.hpp"
 #include "nav2_voxel_grid/voxel_grid.hpp"
 #include "nav2_msgs/msg/voxel_grid.hpp"
+#include "nav2_costmap_2d/voxel_grid_encoding.hpp"
 #include "nav2_util/execution_timer.hpp"
 
 static inline void mapToWorld3D(
@@ -49,32 +50,99 @@ static inline void mapToWorld3D(
   wz = origin_z + (mz + 0.5) * z_resolution;
 }
 
-struct Cell
-{
-  double x;
-  double y;
-  double z;
-  nav2_voxel_grid::VoxelStatus status;
-};
-typedef std::vector<Cell> V_Cell;
-
 float g_colors_r[] = {0.0f, 0.0f, 1.0f};
 float g_colors_g[] = {0.0f, 0.0f, 0.0f};
 float g_colors_b[] = {0.0f, 1.0f, 0.0f};
 float g_colors_a[] = {0.0f, 0.5f, 1.0f};
 
-V_Cell g_marked;
-V_Cell g_unknown;
+// The grid rebuilt from the messages, and the marked and unknown voxels of each of its
+// columns, which are only looked up again for the columns a message changes
+nav2_costmap_2d::VoxelGridDecoder g_decoder;
+std::vector<std::vector<uint8_t>> g_marked;
+std::vector<std::vector<uint8_t>> g_unknown;
+uint32_t g_num_marked = 0;
+uint32_t g_num_unknown = 0;
+uint32_t g_size_z = 0;
 
 rclcpp::Node::SharedPtr g_node;
 
 rclcpp::Publisher<sensor_msgs::msg::PointCloud>::SharedPtr pub_marked;
 rclcpp::Publisher<sensor_msgs::msg::PointCloud>::SharedPtr pub_unknown;
 
+void updateColumn(uint32_t index)
+{
+  std::vector<uint8_t> & marked = g_marked[index];
+  std::vector<uint8_t> & unknown = g_unknown[index];
+  g_num_marked -= marked.size();
+  g_num_unknown -= unknown.size();
+  marked.clear();
+  unknown.clear();
+
+  const unsigned int column_words = g_decoder.columnWords();
+  const uint32_t * column = g_decoder.words() + index * column_words;
+  for (uint32_t z_grid = 0; z_grid < g_size_z; ++z_grid) {
+    nav2_voxel_grid::VoxelStatus status =
+      nav2_voxel_grid::getPackedVoxel(0, 0, z_grid, 1, 1, g_size_z, column, column_words);
+    if (status == nav2_voxel_grid::UNKNOWN) {
+      unknown.push_back(z_grid);
+    } else if (status == nav2_voxel_grid::MARKED) {
+      marked.push_back(z_grid);
+    }
+  }
+  g_num_marked += marked.size();
+  g_num_unknown += unknown.size();
+}
+
+void publishCloud(
+  const rclcpp::Publisher<sensor_msgs::msg::PointCloud>::SharedPtr & pub,
+  const std::vector<std::vector<uint8_t>> & columns, uint32_t num_points,
+  nav2_voxel_grid::VoxelStatus status, const nav2_msgs::msg::VoxelGrid & grid)
+{
+  sensor_msgs::msg::PointCloud cloud;
+  cloud.points.resize(num_points);
+  cloud.channels.resize(1);
+  cloud.channels[0].values.resize(num_points);
+  cloud.channels[0].name = "rgb";
+  cloud.header.frame_id = grid.header.frame_id;
+  cloud.header.stamp = grid.header.stamp;
+
+  uint32_t r = g_colors_r[status] * 255.0;
+  uint32_t g = g_colors_g[status] * 255.0;
+  uint32_t b = g_colors_b[status] * 255.0;
+  // uint32_t a = g_colors_a[status] * 255.0;
+  uint32_t col = (r << 16) | (g << 8) | b;
+
+  sensor_msgs::msg::ChannelFloat32 & chan = cloud.channels[0];
+  uint32_t i = 0;
+  for (uint32_t y_grid = 0; y_grid < grid.size_y; ++y_grid) {
+    for (uint32_t x_grid = 0; x_grid < grid.size_x; ++x_grid) {
+      for (uint8_t z_grid : columns[y_grid * grid.size_x + x_grid]) {
+        double x, y, z;
+        mapToWorld3D(
+          x_grid, y_grid, z_grid, grid.origin.x, grid.origin.y, grid.origin.z,
+          grid.resolutions.x, grid.resolutions.y, grid.resolutions.z, x, y, z);
+
+        geometry_msgs::msg::Point32 & p = cloud.points[i];
+        p.x = x;
+        p.y = y;
+        p.z = z;
+        memcpy(&chan.values[i], &col, sizeof col);
+        ++i;
+      }
+    }
+  }
+
+  pub->publish(cloud);
+}
+
 void voxelCallback(const nav2_msgs::msg::VoxelGrid::ConstSharedPtr grid)
 {
-  if (grid->data.empty()) {
-    RCLCPP_ERROR(g_node->get_logger(), "Received empty voxel grid");
+  if (!g_decoder.decode(*grid)) {
+    if (grid->encoding == nav2_msgs::msg::VoxelGrid::ENCODING_RAW) {
+      RCLCPP_ERROR(g_node->get_logger(), "Received malformed voxel grid");
+    } else {
+      RCLCPP_DEBUG(g_node->get_logger(), "Waiting for a whole voxel grid to apply changes to");
+    }
     return;
   }
 
@@ -82,121 +150,30 @@ void voxelCallback(const nav2_msgs::msg::VoxelGrid::ConstSharedPtr grid)
   timer.start();
 
   RCLCPP_DEBUG(g_node->get_logger(), "Received voxel grid");
-  const std::string frame_id = grid->header.frame_id;
-  const rclcpp::Time stamp = grid->header.stamp;
-  const uint32_t * data = &grid->data.front();
-  const double x_origin = grid->origin.x;
-  const double y_origin = grid->origin.y;
-  const double z_origin = grid->origin.z;
-  const double x_res = grid->resolutions.x;
-  const double y_res = grid->resolutions.y;
-  const double z_res = grid->resolutions.z;
-  const uint32_t x_size = grid->size_x;
-  const uint32_t y_size = grid->size_y;
-  const uint32_t z_size = grid->size_z;
-
-  g_marked.clear();
-  g_unknown.clear();
-  uint32_t num_marked = 0;
-  uint32_t num_unknown = 0;
-  for (uint32_t y_grid = 0; y_grid < y_size; ++y_grid) {
-    for (uint32_t x_grid = 0; x_grid < x_size; ++x_grid) {
-      for (uint32_t z_grid = 0; z_grid < z_size; ++z_grid) {
-        nav2_voxel_grid::VoxelStatus status =
-          nav2_voxel_grid::VoxelGrid::getVoxel(
-          x_grid, y_grid,
-          z_grid, x_size, y_size, z_size, data);
-        if (status == nav2_voxel_grid::UNKNOWN) {
-          Cell c;
-          c.status = status;
-          mapToWorld3D(
-            x_grid, y_grid, z_grid, x_origin, y_origin,
-            z_origin, x_res, y_res, z_res, c.x, c.y, c.z);
-
-          g_unknown.push_back(c);
-
-          ++num_unknown;
-        } else if (status == nav2_voxel_grid::MARKED) {
-          Cell c;
-          c.status = status;
-          mapToWorld3D(
-            x_grid, y_grid, z_grid, x_origin, y_origin,
-            z_origin, x_res, y_res, z_res, c.x, c.y, c.z);
-
-          g_marked.push_back(c);
-
-          ++num_marked;
-        }
-      }
+  const uint32_t num_columns = grid->size_x * grid->size_y;
+
+  if (g_decoder.replacedGrid() || g_size_z != grid->size_z || g_marked.size() != num_columns) {
+    g_size_z = grid->size_z;
+    g_marked.assign(num_columns, std::vector<uint8_t>());
+    g_unknown.assign(num_columns, std::vector<uint8_t>());
+    g_num_marked = 0;
+    g_num_unknown = 0;
+    for (uint32_t index = 0; index < num_columns; ++index) {
+      updateColumn(index);
     }
-  }
-
-  {
-    sensor_msgs::msg::PointCloud cloud;
-    cloud.points.resize(num_marked);
-    cloud.channels.resize(1);
-    cloud.channels[0].values.resize(num_marked);
-    cloud.channels[0].name = "rgb";
-    cloud.header.frame_id = frame_id;
-    cloud.header.stamp = stamp;
-
-    sensor_msgs::msg::ChannelFloat32 & chan = cloud.channels[0];
-    for (uint32_t i = 0; i < num_marked; ++i) {
-      geometry_msgs::msg::Point32 & p = cloud.points[i];
-      float & cval = chan.values[i];
-      Cell & c = g_marked[i];
-
-      p.x = c.x;
-      p.y = c.y;
-      p.z = c.z;
-
-      uint32_t r = g_colors_r[c.status] * 255.0;
-      uint32_t g = g_colors_g[c.status] * 255.0;
-      uint32_t b = g_colors_b[c.status] * 255.0;
-      // uint32_t a = g_colors_a[c.status] * 255.0;
-
-      uint32_t col = (r << 16) | (g << 8) | b;
-      memcpy(&cval, &col, sizeof col);
+  } else {
+    for (uint32_t index : g_decoder.changedColumns()) {
+      updateColumn(index);
     }
-
-    pub_marked->publish(cloud);
   }
 
-  {
-    sensor_msgs::msg::PointCloud cloud;
-    cloud.points.resize(num_unknown);
-    cloud.channels.resize(1);
-    cloud.channels[0].values.resize(num_unknown);
-    cloud.channels[0].name = "rgb";
-    cloud.header.frame_id = frame_id;
-    cloud.header.stamp = stamp;
-
-    sensor_msgs::msg::ChannelFloat32 & chan = cloud.channels[0];
-    for (uint32_t i = 0; i < num_unknown; ++i) {
-      geometry_msgs::msg::Point32 & p = cloud.points[i];
-      float & cval = chan.values[i];
-      Cell & c = g_unknown[i];
-
-      p.x = c.x;
-      p.y = c.y;
-      p.z = c.z;
-
-      uint32_t r = g_colors_r[c.status] * 255.0;
-      uint32_t g = g_colors_g[c.status] * 255.0;
-      uint32_t b = g_colors_b[c.status] * 255.0;
-      // uint32_t a = g_colors_a[c.status] * 255.0;
-
-      uint32_t col = (r << 16) | (g << 8) | b;
-      memcpy(&cval, &col, sizeof col);
-    }
-
-    pub_unknown->publish(cloud);
-  }
+  publishCloud(pub_marked, g_marked, g_num_marked, nav2_voxel_grid::MARKED, *grid);
+  publishCloud(pub_unknown, g_unknown, g_num_unknown, nav2_voxel_grid::UNKNOWN, *grid);
 
   timer.end();
   RCLCPP_DEBUG(
     g_node->get_logger(), "Published %d points in %f seconds",
-    num_marked + num_unknown, timer.elapsed_time_in_seconds());
+    g_num_marked + g_num_unknown, timer.elapsed_time_in_seconds());
 }
 
 int main(int argc, char ** argv)
@@ -42,31 +42,51 @@
 #include "rclcpp/rclcpp.hpp"
 #include "visualization_msgs/msg/marker.hpp"
 #include "nav2_msgs/msg/voxel_grid.hpp"
+#include "nav2_costmap_2d/voxel_grid_encoding.hpp"
 #include "nav2_voxel_grid/voxel_grid.hpp"
 #include "nav2_util/execution_timer.hpp"
 
-struct Cell
-{
-  double x;
-  double y;
-  double z;
-  nav2_voxel_grid::VoxelStatus status;
-};
-typedef std::vector<Cell> V_Cell;
-
 float g_colors_r[] = {0.0f, 0.0f, 1.0f};
 float g_colors_g[] = {0.0f, 0.0f, 0.0f};
 float g_colors_b[] = {0.0f, 1.0f, 0.0f};
 float g_colors_a[] = {0.0f, 0.5f, 1.0f};
 
-V_Cell g_cells;
+// The grid rebuilt from the messages, and the marked voxels of each of its columns,
+// which are only looked up again for the columns a message changes
+nav2_costmap_2d::VoxelGridDecoder g_decoder;
+std::vector<std::vector<uint8_t>> g_marked;
+uint32_t g_num_marked = 0;
+uint32_t g_size_z = 0;
+
 rclcpp::Node::SharedPtr g_node;
 rclcpp::Publisher<visualization_msgs::msg::Marker>::SharedPtr pub;
 
+void updateColumn(uint32_t index)
+{
+  std::vector<uint8_t> & marked = g_marked[index];
+  g_num_marked -= marked.size();
+  marked.clear();
+
+  const unsigned int column_words = g_decoder.columnWords();
+  const uint32_t * column = g_decoder.words() + index * column_words;
+  for (uint32_t z_grid = 0; z_grid < g_size_z; ++z_grid) {
+    if (nav2_voxel_grid::getPackedVoxel(0, 0, z_grid, 1, 1, g_size_z, column, column_words) ==
+      nav2_voxel_grid::MARKED)
+    {
+      marked.push_back(z_grid);
+    }
+  }
+  g_num_marked += marked.size();
+}
+
 void voxelCallback(const nav2_msgs::msg::VoxelGrid::ConstSharedPtr grid)
 {
-  if (grid->data.empty()) {
-    RCLCPP_ERROR(g_node->get_logger(), "Received voxel grid");
+  if (!g_decoder.decode(*grid)) {
+    if (grid->encoding == nav2_msgs::msg::VoxelGrid::ENCODING_RAW) {
+      RCLCPP_ERROR(g_node->get_logger(), "Received malformed voxel grid");
+    } else {
+      RCLCPP_DEBUG(g_node->get_logger(), "Waiting for a whole voxel grid to apply changes to");
+    }
     return;
   }
 
@@ -77,7 +97,6 @@ void voxelCallback(const nav2_msgs::msg::VoxelGrid::ConstSharedPtr grid)
 
   const std::string frame_id = grid->header.frame_id;
   const rclcpp::Time stamp = grid->header.stamp;
-  const uint32_t * data = &grid->data.front();
   const double x_origin = grid->origin.x;
   const double y_origin = grid->origin.y;
   const double z_origin = grid->origin.z;
@@ -86,28 +105,19 @@ void voxelCallback(const nav2_msgs::msg::VoxelGrid::ConstSharedPtr grid)
   const double z_res = grid->resolutions.z;
   const uint32_t x_size = grid->size_x;
   const uint32_t y_size = grid->size_y;
-  const uint32_t z_size = grid->size_z;
 
-  g_cells.clear();
-  uint32_t num_markers = 0;
-  for (uint32_t y_grid = 0; y_grid < y_size; ++y_grid) {
-    for (uint32_t x_grid = 0; x_grid < x_size; ++x_grid) {
-      for (uint32_t z_grid = 0; z_grid < z_size; ++z_grid) {
-        nav2_voxel_grid::VoxelStatus status =
-          nav2_voxel_grid::VoxelGrid::getVoxel(
-          x_grid, y_grid,
-          z_grid, x_size, y_size, z_size, data);
-        if (status == nav2_voxel_grid::MARKED) {
-          Cell c;
-          c.status = status;
-          c.x = x_origin + (x_grid + 0.5) * x_res;
-          c.y = y_origin + (y_grid + 0.5) * y_res;
-          c.z = z_origin + (z_grid + 0.5) * z_res;
-          g_cells.push_back(c);
-
-          ++num_markers;
-        }
-      }
+  if (g_decoder.replacedGrid() || g_size_z != grid->size_z ||
+    g_marked.size() != x_size * y_size)
+  {
+    g_size_z = grid->size_z;
+    g_marked.assign(x_size * y_size, std::vector<uint8_t>());
+    g_num_marked = 0;
+    for (uint32_t index = 0; index < x_size * y_size; ++index) {
+      updateColumn(index);
+    }
+  } else {
+    for (uint32_t index : g_decoder.changedColumns()) {
+      updateColumn(index);
     }
   }
 
@@ -126,13 +136,17 @@ void voxelCallback(const nav2_msgs::msg::VoxelGrid::ConstSharedPtr grid)
   m.color.g = g_colors_g[nav2_voxel_grid::MARKED];
   m.color.b = g_colors_b[nav2_voxel_grid::MARKED];
   m.color.a = g_colors_a[nav2_voxel_grid::MARKED];
-  m.points.resize(num_markers);
-  for (uint32_t i = 0; i < num_markers; ++i) {
-    Cell & c = g_cells[i];
-    geometry_msgs::msg::Point & p = m.points[i];
-    p.x = c.x;
-    p.y = c.y;
-    p.z = c.z;
+  m.points.reserve(g_num_marked);
+  for (uint32_t y_grid = 0; y_grid < y_size; ++y_grid) {
+    for (uint32_t x_grid = 0; x_grid < x_size; ++x_grid) {
+      for (uint8_t z_grid : g_marked[y_grid * x_size + x_grid]) {
+        geometry_msgs::msg::Point p;
+        p.x = x_origin + (x_grid + 0.5) * x_res;
+        p.y = y_origin + (y_grid + 0.5) * y_res;
+        p.z = z_origin + (z_grid + 0.5) * z_res;
+        m.points.push_back(p);
+      }
+    }
   }
 
   pub->publish(m);
@@ -140,7 +154,7 @@ void voxelCallback(const nav2_msgs::msg::VoxelGrid::ConstSharedPtr grid)
   timer.end();
   RCLCPP_INFO(
     g_node->get_logger(), "Published %d markers in %f seconds",
-    num_markers, timer.elapsed_time_in_seconds());
+    g_num_marked, timer.elapsed_time_in_seconds());
 }
 
 int main(int argc, char ** argv)
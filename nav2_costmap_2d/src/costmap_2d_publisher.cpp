@@ -38,23 +38,32 @@
  *********************************************************************/
 #include "nav2_costmap_2d/costmap_2d_publisher.hpp"
 
+#include <algorithm>
+#include <cmath>
 #include <string>
 #include <memory>
 
+#include "nav2_costmap_2d/cost_translation.hpp"
+#include "nav2_costmap_2d/costmap_encoding.hpp"
+#include "nav2_costmap_2d/costmap_pyramid.hpp"
 #include "nav2_costmap_2d/cost_values.hpp"
 
 namespace nav2_costmap_2d
 {
 
-char * Costmap2DPublisher::cost_translation_table_ = NULL;
-
 Costmap2DPublisher::Costmap2DPublisher(
   nav2_util::LifecycleNode::SharedPtr ros_node, Costmap2D * costmap,
   std::string global_frame,
   std::string topic_name,
-  bool always_send_full_costmap)
+  bool always_send_full_costmap,
+  bool delta_publishing,
+  unsigned int keyframe_interval,
+  uint8_t raw_encoding)
 : node_(ros_node), costmap_(costmap), global_frame_(global_frame), topic_name_(topic_name),
-  active_(false), always_send_full_costmap_(always_send_full_costmap)
+  active_(false), always_send_full_costmap_(always_send_full_costmap),
+  delta_publishing_(delta_publishing), keyframe_interval_(keyframe_interval),
+  raw_encoding_(raw_encoding),
+  publishes_since_keyframe_(0), raw_subscribers_(0), keyframe_sequence_(0), update_sequence_(0)
 {
   auto custom_qos = rclcpp::QoS(rclcpp::KeepLast(1)).transient_local().reliable();
 
@@ -67,6 +76,10 @@ Costmap2DPublisher::Costmap2DPublisher(
     custom_qos);
   costmap_update_pub_ = node_->create_publisher<map_msgs::msg::OccupancyGridUpdate>(
     topic_name + "_updates", custom_qos);
+  // Updates only make sense on top of the last full costmap, so keep a few of them
+  // queued instead of the latest one only
+  costmap_raw_update_pub_ = node_->create_publisher<nav2_msgs::msg::CostmapUpdate>(
+    topic_name + "_raw_updates", rclcpp::QoS(rclcpp::KeepLast(10)).reliable());
 
   // Create a service that will use the callback function to handle requests.
   costmap_service_ = node_->create_service<nav2_msgs::srv::GetCostmap>(
@@ -75,22 +88,6 @@ Costmap2DPublisher::Costmap2DPublisher(
       this, std::placeholders::_1, std::placeholders::_2,
       std::placeholders::_3));
 
-  if (cost_translation_table_ == NULL) {
-    cost_translation_table_ = new char[256];
-
-    // special values:
-    cost_translation_table_[0] = 0;  // NO obstacle
-    cost_translation_table_[253] = 99;  // INSCRIBED obstacle
-    cost_translation_table_[254] = 100;  // LETHAL obstacle
-    cost_translation_table_[255] = -1;  // UNKNOWN
-
-    // regular cost values scale the range 1 to 252 (inclusive) to fit
-    // into 1 to 98 (inclusive).
-    for (int i = 1; i < 253; i++) {
-      cost_translation_table_[i] = static_cast<char>(1 + (97 * (i - 1)) / 251);
-    }
-  }
-
   xn_ = yn_ = 0;
   x0_ = costmap_->getSizeInCellsX();
   y0_ = costmap_->getSizeInCellsY();
@@ -131,10 +128,7 @@ void Costmap2DPublisher::prepareGrid()
 
   grid_.data.resize(grid_.info.width * grid_.info.height);
 
-  unsigned char * data = costmap_->getCharMap();
-  for (unsigned int i = 0; i < grid_.data.size(); i++) {
-    grid_.data[i] = cost_translation_table_[data[i]];
-  }
+  translateCosts(costmap_->getCharMap(), grid_.data.size(), grid_.data.data());
 }
 
 void Costmap2DPublisher::prepareCostmap()
@@ -158,23 +152,98 @@ void Costmap2DPublisher::prepareCostmap()
   costmap_raw_.metadata.origin.position.z = 0.0;
   costmap_raw_.metadata.origin.orientation.w = 1.0;
 
-  costmap_raw_.data.resize(costmap_raw_.metadata.size_x * costmap_raw_.metadata.size_y);
+  saved_raw_origin_x_ = costmap_->getOriginX();
+  saved_raw_origin_y_ = costmap_->getOriginY();
+
+  const unsigned char * data = costmap_->getCharMap();
+  const unsigned int size = costmap_raw_.metadata.size_x * costmap_raw_.metadata.size_y;
+  costmap_raw_.encoding = raw_encoding_;
+  if (raw_encoding_ == nav2_msgs::msg::Costmap::ENCODING_RLE) {
+    encodeRunLength(data, size, costmap_raw_.data);
+  } else {
+    costmap_raw_.data.resize(size);
+    std::copy(data, data + size, costmap_raw_.data.begin());
+  }
+}
+
+void Costmap2DPublisher::prepareCostmapUpdate()
+{
+  std::unique_lock<Costmap2D::mutex_t> lock(*(costmap_->getMutex()));
+
+  costmap_raw_update_.header.frame_id = global_frame_;
+  costmap_raw_update_.header.stamp = node_->now();
+
+  costmap_raw_update_.x = x0_;
+  costmap_raw_update_.y = y0_;
+  costmap_raw_update_.size_x = xn_ - x0_;
+  costmap_raw_update_.size_y = yn_ - y0_;
+
+  costmap_raw_update_.data.resize(costmap_raw_update_.size_x * costmap_raw_update_.size_y);
+
+  unsigned int size_x = costmap_->getSizeInCellsX();
+  const unsigned char * data = costmap_->getCharMap();
+  auto out = costmap_raw_update_.data.begin();
+  for (unsigned int y = y0_; y < yn_; y++) {
+    out = std::copy(data + y * size_x + x0_, data + y * size_x + xn_, out);
+  }
 
-  unsigned char * data = costmap_->getCharMap();
-  for (unsigned int i = 0; i < costmap_raw_.data.size(); i++) {
-    costmap_raw_.data[i] = data[i];
+  costmap_raw_update_.encoding = raw_encoding_;
+  if (raw_encoding_ == nav2_msgs::msg::CostmapUpdate::ENCODING_RLE) {
+    encodeRunLength(
+      costmap_raw_update_.data.data(), costmap_raw_update_.data.size(), encoding_buffer_);
+    costmap_raw_update_.data.swap(encoding_buffer_);
   }
 }
 
+bool Costmap2DPublisher::rawGeometryChanged()
+{
+  return costmap_raw_.metadata.resolution != static_cast<float>(costmap_->getResolution()) ||
+         costmap_raw_.metadata.size_x != costmap_->getSizeInCellsX() ||
+         costmap_raw_.metadata.size_y != costmap_->getSizeInCellsY() ||
+         saved_raw_origin_x_ != costmap_->getOriginX() ||
+         saved_raw_origin_y_ != costmap_->getOriginY();
+}
+
 void Costmap2DPublisher::publishCostmap()
 {
-  if (node_->count_subscribers(costmap_raw_pub_->get_topic_name()) > 0) {
-    prepareCostmap();
-    costmap_raw_pub_->publish(costmap_raw_);
+  // Periodically send full costmaps in delta mode, so that subscribers recover
+  // from lost updates
+  bool keyframe = false;
+  if (delta_publishing_ && keyframe_interval_ > 0 &&
+    ++publishes_since_keyframe_ >= keyframe_interval_)
+  {
+    keyframe = true;
+    publishes_since_keyframe_ = 0;
   }
+
+  size_t raw_subscribers = node_->count_subscribers(costmap_raw_pub_->get_topic_name());
+  size_t raw_update_subscribers =
+    node_->count_subscribers(costmap_raw_update_pub_->get_topic_name());
+  if (raw_subscribers > 0) {
+    // New subscribers need a full costmap to apply the updates to. The last one is
+    // latched, but they miss the updates sent since, so send a newer one. Counts
+    // are compared rather than grown, as one may leave while another joins.
+    if (!delta_publishing_ || keyframe ||
+      raw_subscribers + raw_update_subscribers != raw_subscribers_ ||
+      rawGeometryChanged())
+    {
+      prepareCostmap();
+      costmap_raw_.sequence = ++keyframe_sequence_;
+      update_sequence_ = 0;
+      costmap_raw_pub_->publish(costmap_raw_);
+      publishes_since_keyframe_ = 0;
+    } else if (x0_ < xn_ && raw_update_subscribers > 0) {
+      prepareCostmapUpdate();
+      costmap_raw_update_.base_sequence = keyframe_sequence_;
+      costmap_raw_update_.sequence = ++update_sequence_;
+      costmap_raw_update_pub_->publish(costmap_raw_update_);
+    }
+  }
+  raw_subscribers_ = raw_subscribers + raw_update_subscribers;
+
   float resolution = costmap_->getResolution();
 
-  if (always_send_full_costmap_ || grid_.info.resolution != resolution ||
+  if (always_send_full_costmap_ || keyframe || grid_.info.resolution != resolution ||
     grid_.info.width != costmap_->getSizeInCellsX() ||
     grid_.info.height != costmap_->getSizeInCellsY() ||
     saved_origin_x_ != costmap_->getOriginX() ||
@@ -196,12 +265,12 @@ void Costmap2DPublisher::publishCostmap()
       update.width = xn_ - x0_;
       update.height = yn_ - y0_;
       update.data.resize(update.width * update.height);
-      unsigned int i = 0;
+      const unsigned char * data = costmap_->getCharMap();
+      unsigned int size_x = costmap_->getSizeInCellsX();
       for (unsigned int y = y0_; y < yn_; y++) {
-        for (unsigned int x = x0_; x < xn_; x++) {
-          unsigned char cost = costmap_->getCost(x, y);
-          update.data[i++] = cost_translation_table_[cost];
-        }
+        translateCosts(
+          data + y * size_x + x0_, update.width,
+          update.data.data() + (y - y0_) * update.width);
       }
       costmap_update_pub_->publish(update);
     }
@@ -215,7 +284,7 @@ void Costmap2DPublisher::publishCostmap()
 void
 Costmap2DPublisher::costmap_service_callback(
   const std::shared_ptr<rmw_request_id_t>/*request_header*/,
-  const std::shared_ptr<nav2_msgs::srv::GetCostmap::Request>/*request*/,
+  const std::shared_ptr<nav2_msgs::srv::GetCostmap::Request> request,
   const std::shared_ptr<nav2_msgs::srv::GetCostmap::Response> response)
 {
   RCLCPP_DEBUG(node_->get_logger(), "Received costmap service request");
@@ -224,26 +293,52 @@ Costmap2DPublisher::costmap_service_callback(
   tf2::Quaternion quaternion;
   quaternion.setRPY(0.0, 0.0, 0.0);
 
+  std::unique_lock<Costmap2D::mutex_t> lock(*(costmap_->getMutex()));
   auto size_x = costmap_->getSizeInCellsX();
   auto size_y = costmap_->getSizeInCellsY();
-  auto data_length = size_x * size_y;
-  unsigned char * data = costmap_->getCharMap();
-  auto current_time = node_->now();
+  double resolution = costmap_->getResolution();
+  double origin_x = costmap_->getOriginX();
+  double origin_y = costmap_->getOriginY();
+
+  // The cells covering the requested window, clipped to the costmap
+  unsigned int x0 = 0, y0 = 0, xn = size_x, yn = size_y;
+  if (request->min_x != 0.0 || request->min_y != 0.0 ||
+    request->max_x != 0.0 || request->max_y != 0.0)
+  {
+    auto clip = [](double cell, unsigned int size) {
+        return static_cast<unsigned int>(std::min(std::max(cell, 0.0), static_cast<double>(size)));
+      };
+    x0 = clip(std::floor((request->min_x - origin_x) / resolution), size_x);
+    y0 = clip(std::floor((request->min_y - origin_y) / resolution), size_y);
+    xn = clip(std::ceil((request->max_x - origin_x) / resolution), size_x);
+    yn = clip(std::ceil((request->max_y - origin_y) / resolution), size_y);
+  }
+  unsigned int factor = std::max(request->downsample, 1u);
+
+  unsigned int region_x, region_y;
+  if (factor == 1 && x0 == 0 && y0 == 0 && xn == size_x && yn == size_y) {
+    const unsigned char * data = costmap_->getCharMap();
+    response->map.data.assign(data, data + size_x * size_y);
+    region_x = size_x;
+    region_y = size_y;
+  } else {
+    poolRegion(*costmap_, x0, y0, xn, yn, factor, response->map.data, region_x, region_y);
+  }
+  lock.unlock();
 
+  auto current_time = node_->now();
   response->map.header.stamp = current_time;
   response->map.header.frame_id = global_frame_;
-  response->map.metadata.size_x = size_x;
-  response->map.metadata.size_y = size_y;
-  response->map.metadata.resolution = costmap_->getResolution();
+  response->map.metadata.size_x = region_x;
+  response->map.metadata.size_y = region_y;
+  response->map.metadata.resolution = resolution * factor;
   response->map.metadata.layer = "master";
   response->map.metadata.map_load_time = current_time;
   response->map.metadata.update_time = current_time;
-  response->map.metadata.origin.position.x = costmap_->getOriginX();
-  response->map.metadata.origin.position.y = costmap_->getOriginY();
+  response->map.metadata.origin.position.x = origin_x + x0 * resolution;
+  response->map.metadata.origin.position.y = origin_y + y0 * resolution;
   response->map.metadata.origin.position.z = 0.0;
   response->map.metadata.origin.orientation = tf2::toMsg(quaternion);
-  response->map.data.resize(data_length);
-  response->map.data.assign(data, data + data_length);
 }
 
 }  // end namespace nav2_costmap_2d
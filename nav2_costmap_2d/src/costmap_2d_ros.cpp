@@ -38,13 +38,21 @@
 
 #include "nav2_costmap_2d/costmap_2d_ros.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
 
+#include "nav2_costmap_2d/costmap_checkpoint.hpp"
+#include "nav2_costmap_2d/costmap_layer.hpp"
+#include "nav2_costmap_2d/costmap_snapshot_registry.hpp"
 #include "nav2_costmap_2d/layered_costmap.hpp"
 #include "nav2_util/execution_timer.hpp"
 #include "nav2_util/node_utils.hpp"
+#include "nav2_util/thread_pool.hpp"
+#include "nav2_util/trace.hpp"
 #include "tf2_geometry_msgs/tf2_geometry_msgs.h"
 #include "tf2_ros/create_timer_ros.h"
 #include "nav2_util/robot_utils.hpp"
@@ -83,31 +91,57 @@ Costmap2DROS::Costmap2DROS(
   std::vector<std::string> clearable_layers{"obstacle_layer"};
 
   declare_parameter("always_send_full_costmap", rclcpp::ParameterValue(false));
+  declare_parameter("checkpoint_file", rclcpp::ParameterValue(std::string("")));
+  declare_parameter("checkpoint_period", rclcpp::ParameterValue(5.0));
+  declare_parameter("cpu_affinity", rclcpp::ParameterValue(std::vector<int64_t>()));
+  declare_parameter("delta_publishing", rclcpp::ParameterValue(false));
+  declare_parameter("demand_timeout", rclcpp::ParameterValue(5.0));
+  declare_parameter("fine_costs", rclcpp::ParameterValue(false));
+  declare_parameter("flight_recorder_duration", rclcpp::ParameterValue(0.0));
+  declare_parameter("flight_recorder_keyframe_interval", rclcpp::ParameterValue(50));
+  declare_parameter("flight_recorder_prefix", rclcpp::ParameterValue(std::string("")));
   declare_parameter("footprint_padding", rclcpp::ParameterValue(0.01f));
   declare_parameter("footprint", rclcpp::ParameterValue(std::string("[]")));
   declare_parameter("global_frame", rclcpp::ParameterValue(std::string("map")));
   declare_parameter("height", rclcpp::ParameterValue(5));
+  declare_parameter("idle_update_frequency", rclcpp::ParameterValue(0.2));
+  declare_parameter("keyframe_interval", rclcpp::ParameterValue(10));
   declare_parameter("width", rclcpp::ParameterValue(5));
   declare_parameter("lethal_cost_threshold", rclcpp::ParameterValue(100));
+  declare_parameter("lock_memory", rclcpp::ParameterValue(false));
   declare_parameter(
     "map_topic", rclcpp::ParameterValue(
       (parent_namespace_ == "/" ? "/" : parent_namespace_ + "/") + std::string("map")));
+  declare_parameter("min_update_interval", rclcpp::ParameterValue(0.05));
   declare_parameter("observation_sources", rclcpp::ParameterValue(std::string("")));
+  declare_parameter("on_demand", rclcpp::ParameterValue(false));
   declare_parameter("origin_x", rclcpp::ParameterValue(0.0));
   declare_parameter("origin_y", rclcpp::ParameterValue(0.0));
+  declare_parameter("plugin_configure_threads", rclcpp::ParameterValue(1));
   declare_parameter("plugin_names", rclcpp::ParameterValue(plugin_names));
   declare_parameter("plugin_types", rclcpp::ParameterValue(plugin_types));
   declare_parameter("publish_frequency", rclcpp::ParameterValue(1.0));
+  declare_parameter("pyramid_levels", rclcpp::ParameterValue(0));
+  declare_parameter("raw_costmap_encoding", rclcpp::ParameterValue(std::string("raw")));
+  declare_parameter("realtime_priority", rclcpp::ParameterValue(0));
   declare_parameter("resolution", rclcpp::ParameterValue(0.1));
   declare_parameter("robot_base_frame", rclcpp::ParameterValue(std::string("base_link")));
   declare_parameter("robot_radius", rclcpp::ParameterValue(0.1));
   declare_parameter("rolling_window", rclcpp::ParameterValue(false));
+  declare_parameter("statistics_publish_frequency", rclcpp::ParameterValue(0.0));
+  declare_parameter("statistics_window", rclcpp::ParameterValue(100));
   declare_parameter("track_unknown_space", rclcpp::ParameterValue(false));
   declare_parameter("transform_tolerance", rclcpp::ParameterValue(0.3));
   declare_parameter("trinary_costmap", rclcpp::ParameterValue(true));
   declare_parameter("unknown_cost_value", rclcpp::ParameterValue(static_cast<unsigned char>(0xff)));
+  declare_parameter("update_angle_threshold", rclcpp::ParameterValue(0.1));
+  declare_parameter("update_distance_threshold", rclcpp::ParameterValue(0.05));
   declare_parameter("update_frequency", rclcpp::ParameterValue(5.0));
+  declare_parameter("update_on_data", rclcpp::ParameterValue(false));
+  declare_parameter("update_threads", rclcpp::ParameterValue(0));
+  declare_parameter("update_tile_size", rclcpp::ParameterValue(0));
   declare_parameter("use_maximum", rclcpp::ParameterValue(false));
+  declare_parameter("use_snapshots", rclcpp::ParameterValue(false));
   declare_parameter("clearable_layers", rclcpp::ParameterValue(clearable_layers));
 }
 
@@ -124,6 +158,28 @@ Costmap2DROS::on_configure(const rclcpp_lifecycle::State & /*state*/)
 
   // Create the costmap itself
   layered_costmap_ = new LayeredCostmap(global_frame_, rolling_window_, track_unknown_space_);
+  if (update_on_data_) {
+    layered_costmap_->setUpdateRequestCallback(
+      std::bind(&Costmap2DROS::onUpdateRequest, this));
+  }
+  if (on_demand_) {
+    layered_costmap_->setClearRequestCallback(std::bind(&Costmap2DROS::onClearRequest, this));
+  }
+
+  if (update_tile_size_ > 0) {
+    layered_costmap_->setTiledUpdate(update_tile_size_, std::max(0, update_threads_));
+  }
+  if (pyramid_levels_ > 0) {
+    layered_costmap_->setPyramidLevels(pyramid_levels_);
+  }
+  if (fine_costs_) {
+    // before the plugins, for the inflation layer to find it
+    layered_costmap_->setFineCosts(true);
+  }
+  if (statistics_publish_frequency_ > 0) {
+    layered_costmap_->enableStatistics(std::max(1, statistics_window_));
+    statistics_cycle_ = rclcpp::Duration::from_seconds(1 / statistics_publish_frequency_);
+  }
 
   if (!layered_costmap_->isSizeLocked()) {
     layered_costmap_->resizeMap(
@@ -140,6 +196,8 @@ Costmap2DROS::on_configure(const rclcpp_lifecycle::State & /*state*/)
   tf_listener_ = std::make_shared<tf2_ros::TransformListener>(*tf_buffer_);
 
   // Then load and add the plug-ins to the costmap
+  std::vector<std::function<void()>> initializations;
+  auto node = shared_from_this();
   for (unsigned int i = 0; i < plugin_names_.size(); ++i) {
     RCLCPP_INFO(get_logger(), "Using plugin \"%s\"", plugin_names_[i].c_str());
 
@@ -147,11 +205,26 @@ Costmap2DROS::on_configure(const rclcpp_lifecycle::State & /*state*/)
     layered_costmap_->addPlugin(plugin);
 
     // TODO(mjeronimo): instead of get(), use a shared ptr
-    plugin->initialize(
-      layered_costmap_, plugin_names_[i], tf_buffer_.get(),
-      shared_from_this(), client_node_, rclcpp_node_);
+    initializations.push_back(
+      [this, plugin, node, i]() {
+        plugin->initialize(
+          layered_costmap_, plugin_names_[i], tf_buffer_.get(), node, client_node_,
+          rclcpp_node_);
+      });
+  }
 
-    RCLCPP_INFO(get_logger(), "Initialized plugin \"%s\"", plugin_names_[i].c_str());
+  // and initialize them, side by side if allowed, each after those it's configured after
+  std::unique_ptr<nav2_util::ThreadPool> configure_pool;
+  if (plugin_configure_threads_ != 1 && plugin_names_.size() > 1) {
+    configure_pool = std::make_unique<nav2_util::ThreadPool>(
+      std::max(0, plugin_configure_threads_));
+  }
+  auto durations = nav2_util::run_staged_tasks(
+    configure_pool.get(), initializations, plugin_configure_after_);
+  for (unsigned int i = 0; i < plugin_names_.size(); ++i) {
+    RCLCPP_INFO(
+      get_logger(), "Initialized plugin \"%s\" in %.1f ms", plugin_names_[i].c_str(),
+      std::chrono::duration<double, std::milli>(durations[i]).count());
   }
 
   // Create the publishers and subscribers
@@ -163,10 +236,16 @@ Costmap2DROS::on_configure(const rclcpp_lifecycle::State & /*state*/)
   footprint_pub_ = create_publisher<geometry_msgs::msg::PolygonStamped>(
     "published_footprint", rclcpp::SystemDefaultsQoS());
 
+  if (statistics_publish_frequency_ > 0) {
+    statistics_pub_ = create_publisher<nav2_msgs::msg::CostmapUpdateStatistics>(
+      "update_statistics", rclcpp::SystemDefaultsQoS());
+  }
+
   costmap_publisher_ = new Costmap2DPublisher(
     shared_from_this(),
     layered_costmap_->getCostmap(), global_frame_,
-    "costmap", always_send_full_costmap_);
+    "costmap", always_send_full_costmap_, delta_publishing_,
+    static_cast<unsigned int>(std::max(0, keyframe_interval_)), raw_costmap_encoding_);
 
   // Set the footprint
   if (use_radius_) {
@@ -180,6 +259,27 @@ Costmap2DROS::on_configure(const rclcpp_lifecycle::State & /*state*/)
   // Add cleaning service
   clear_costmap_service_ = std::make_unique<ClearCostmapService>(shared_from_this(), *this);
 
+  // Keep the last updates in memory, saved when something goes wrong
+  if (flight_recorder_duration_ > 0.0) {
+    flight_recorder_ = std::make_unique<CostmapRecorder>(
+      flight_recorder_duration_,
+      static_cast<unsigned int>(std::max(1, flight_recorder_keyframe_interval_)));
+    save_recording_service_ = create_service<nav2_msgs::srv::SaveCostmapRecording>(
+      "save_flight_recording",
+      [this](
+        const std::shared_ptr<rmw_request_id_t>/*header*/,
+        const std::shared_ptr<nav2_msgs::srv::SaveCostmapRecording::Request> request,
+        std::shared_ptr<nav2_msgs::srv::SaveCostmapRecording::Response> response) {
+        response->filename = saveFlightRecording(request->filename);
+        response->frames = response->filename.empty() ? 0 : flight_recorder_->frames().size();
+      });
+  }
+
+  // Start from the costmaps of the last run rather than from nothing
+  if (!checkpoint_file_.empty()) {
+    restoreCheckpoint();
+  }
+
   return nav2_util::CallbackReturn::SUCCESS;
 }
 
@@ -190,6 +290,17 @@ Costmap2DROS::on_activate(const rclcpp_lifecycle::State & /*state*/)
 
   costmap_publisher_->on_activate();
   footprint_pub_->on_activate();
+  footprint_changed_ = true;
+  if (statistics_pub_) {
+    statistics_pub_->on_activate();
+  }
+
+  // Let consumers in this process read the snapshots instead of the raw costmap topic
+  if (use_snapshots_) {
+    CostmapSnapshotRegistry::add(
+      CostmapSnapshotRegistry::qualify(get_namespace(), "costmap_raw"),
+      [this]() {return getCostmapSnapshot();});
+  }
 
   // First, make sure that the transform between the robot base frame
   // and the global frame is available
@@ -213,6 +324,11 @@ Costmap2DROS::on_activate(const rclcpp_lifecycle::State & /*state*/)
     r.sleep();
   }
 
+  if (!checkpoint_file_.empty()) {
+    checkpoint_cycle_ = rclcpp::Duration::from_seconds(checkpoint_period_);
+    last_checkpoint_ = now();
+  }
+
   // Create a thread to handle updating the map
   stopped_ = true;  // to active plugins
   stop_updates_ = false;
@@ -232,14 +348,27 @@ Costmap2DROS::on_deactivate(const rclcpp_lifecycle::State & /*state*/)
 {
   RCLCPP_INFO(get_logger(), "Deactivating");
 
+  if (use_snapshots_) {
+    CostmapSnapshotRegistry::remove(
+      CostmapSnapshotRegistry::qualify(get_namespace(), "costmap_raw"));
+  }
+
   costmap_publisher_->on_deactivate();
   footprint_pub_->on_deactivate();
+  if (statistics_pub_) {
+    statistics_pub_->on_deactivate();
+  }
 
   stop();
 
   // Map thread stuff
   // TODO(mjeronimo): unique_ptr
-  map_update_thread_shutdown_ = true;
+  {
+    std::lock_guard<std::mutex> lock(update_request_mutex_);
+    map_update_thread_shutdown_ = true;
+  }
+  update_request_cv_.notify_all();
+  update_done_cv_.notify_all();
   map_update_thread_->join();
   delete map_update_thread_;
   map_update_thread_ = nullptr;
@@ -252,6 +381,9 @@ Costmap2DROS::on_cleanup(const rclcpp_lifecycle::State & /*state*/)
 {
   RCLCPP_INFO(get_logger(), "Cleaning up");
 
+  std::atomic_store(&snapshot_, std::shared_ptr<Costmap2D>());
+  snapshot_pool_.clear();
+
   delete layered_costmap_;
   layered_costmap_ = nullptr;
 
@@ -260,6 +392,7 @@ Costmap2DROS::on_cleanup(const rclcpp_lifecycle::State & /*state*/)
 
   footprint_sub_.reset();
   footprint_pub_.reset();
+  statistics_pub_.reset();
 
   if (costmap_publisher_ != nullptr) {
     delete costmap_publisher_;
@@ -267,6 +400,8 @@ Costmap2DROS::on_cleanup(const rclcpp_lifecycle::State & /*state*/)
   }
 
   clear_costmap_service_.reset();
+  save_recording_service_.reset();
+  flight_recorder_.reset();
 
   return nav2_util::CallbackReturn::SUCCESS;
 }
@@ -292,22 +427,54 @@ Costmap2DROS::getParameters()
 
   // Get all of the required parameters
   get_parameter("always_send_full_costmap", always_send_full_costmap_);
+  get_parameter("checkpoint_file", checkpoint_file_);
+  get_parameter("checkpoint_period", checkpoint_period_);
+  std::vector<int64_t> cpu_affinity;
+  get_parameter("cpu_affinity", cpu_affinity);
+  update_thread_settings_.cpu_affinity.assign(cpu_affinity.begin(), cpu_affinity.end());
+  get_parameter("delta_publishing", delta_publishing_);
+  get_parameter("demand_timeout", demand_timeout_);
+  get_parameter("fine_costs", fine_costs_);
+  get_parameter("flight_recorder_duration", flight_recorder_duration_);
+  get_parameter("flight_recorder_keyframe_interval", flight_recorder_keyframe_interval_);
+  get_parameter("flight_recorder_prefix", flight_recorder_prefix_);
+  if (flight_recorder_prefix_.empty()) {
+    flight_recorder_prefix_ = "/tmp/" + name_ + "_flight_";
+  }
   get_parameter("footprint", footprint_);
   get_parameter("footprint_padding", footprint_padding_);
   get_parameter("global_frame", global_frame_);
+  get_parameter("idle_update_frequency", idle_update_frequency_);
+  get_parameter("keyframe_interval", keyframe_interval_);
+  get_parameter("lock_memory", update_thread_settings_.lock_memory);
   get_parameter("height", map_height_meters_);
+  get_parameter("on_demand", on_demand_);
   get_parameter("origin_x", origin_x_);
   get_parameter("origin_y", origin_y_);
+  get_parameter("plugin_configure_threads", plugin_configure_threads_);
   get_parameter("plugin_names", plugin_names_);
   get_parameter("plugin_types", plugin_types_);
   get_parameter("publish_frequency", map_publish_frequency_);
+  get_parameter("pyramid_levels", pyramid_levels_);
+  std::string raw_costmap_encoding;
+  get_parameter("raw_costmap_encoding", raw_costmap_encoding);
+  get_parameter("realtime_priority", update_thread_settings_.priority);
   get_parameter("resolution", resolution_);
   get_parameter("robot_base_frame", robot_base_frame_);
   get_parameter("robot_radius", robot_radius_);
   get_parameter("rolling_window", rolling_window_);
+  get_parameter("statistics_publish_frequency", statistics_publish_frequency_);
+  get_parameter("statistics_window", statistics_window_);
   get_parameter("track_unknown_space", track_unknown_space_);
   get_parameter("transform_tolerance", transform_tolerance_);
+  get_parameter("min_update_interval", min_update_interval_);
+  get_parameter("update_angle_threshold", update_angle_threshold_);
+  get_parameter("update_distance_threshold", update_distance_threshold_);
   get_parameter("update_frequency", map_update_frequency_);
+  get_parameter("update_on_data", update_on_data_);
+  get_parameter("update_threads", update_threads_);
+  get_parameter("update_tile_size", update_tile_size_);
+  get_parameter("use_snapshots", use_snapshots_);
   get_parameter("width", map_width_meters_);
 
   // Semantic checks...
@@ -319,14 +486,44 @@ Costmap2DROS::getParameters()
     throw std::runtime_error(plugin_error);
   }
 
-  // 2. The map publish frequency cannot be 0 (to avoid a divde-by-zero)
+  // 2. The plugins a plugin is configured after must be among them
+  plugin_configure_after_.assign(plugin_names_.size(), {});
+  for (unsigned int i = 0; i < plugin_names_.size(); ++i) {
+    std::vector<std::string> configure_after;
+    nav2_util::declare_parameter_if_not_declared(
+      this, plugin_names_[i] + ".configure_after",
+      rclcpp::ParameterValue(std::vector<std::string>()));
+    get_parameter(plugin_names_[i] + ".configure_after", configure_after);
+    for (const std::string & name : configure_after) {
+      auto previous = std::find(plugin_names_.begin(), plugin_names_.end(), name);
+      if (previous == plugin_names_.end()) {
+        std::string plugin_error = "Plugin \"" + plugin_names_[i] +
+          "\" is configured after an unknown plugin \"" + name + "\"";
+        RCLCPP_ERROR(get_logger(), plugin_error);
+        throw std::runtime_error(plugin_error);
+      }
+      plugin_configure_after_[i].push_back(previous - plugin_names_.begin());
+    }
+  }
+
+  // 3. The map publish frequency cannot be 0 (to avoid a divde-by-zero)
   if (map_publish_frequency_ > 0) {
     publish_cycle_ = rclcpp::Duration::from_seconds(1 / map_publish_frequency_);
   } else {
     publish_cycle_ = rclcpp::Duration(-1);
   }
 
-  // 3. If the footprint has been specified, it must be in the correct format
+  // 4. The raw costmap encoding must be a known one
+  raw_costmap_encoding_ = nav2_msgs::msg::Costmap::ENCODING_RAW;
+  if (raw_costmap_encoding == "rle") {
+    raw_costmap_encoding_ = nav2_msgs::msg::Costmap::ENCODING_RLE;
+  } else if (raw_costmap_encoding != "raw") {
+    RCLCPP_ERROR(
+      get_logger(), "The raw_costmap_encoding parameter is invalid: \"%s\", using raw instead",
+      raw_costmap_encoding.c_str());
+  }
+
+  // 5. If the footprint has been specified, it must be in the correct format
   use_radius_ = true;
 
   if (footprint_ != "" && footprint_ != "[]") {
@@ -351,6 +548,7 @@ Costmap2DROS::setRobotFootprint(const std::vector<geometry_msgs::msg::Point> & p
   padded_footprint_ = points;
   padFootprint(padded_footprint_, footprint_padding_);
   layered_costmap_->setFootprint(padded_footprint_);
+  footprint_changed_ = true;
 }
 
 void
@@ -364,7 +562,7 @@ void
 Costmap2DROS::getOrientedFootprint(std::vector<geometry_msgs::msg::Point> & oriented_footprint)
 {
   geometry_msgs::msg::PoseStamped global_pose;
-  if (!getRobotPose(global_pose)) {
+  if (!getUpdatePose(global_pose, transform_tolerance_)) {
     return;
   }
 
@@ -384,12 +582,22 @@ Costmap2DROS::mapUpdateLoop(double frequency)
     return;
   }
 
+  if (!update_thread_settings_.empty()) {
+    std::string error;
+    if (!nav2_util::apply_realtime_settings(update_thread_settings_, error)) {
+      RCLCPP_WARN(
+        get_logger(), "Map update loop runs without all its scheduling settings: %s",
+        error.c_str());
+    }
+  }
+
   RCLCPP_DEBUG(get_logger(), "Entering loop");
 
   rclcpp::Rate r(frequency);    // 200ms by default
 
   while (rclcpp::ok() && !map_update_thread_shutdown_) {
     nav2_util::ExecutionTimer timer;
+    const auto update_start = std::chrono::steady_clock::now();
 
     // Measure the execution time of the updateMap method
     timer.start();
@@ -412,24 +620,186 @@ Costmap2DROS::mapUpdateLoop(double frequency)
       }
     }
 
-    // Make sure to sleep for the remainder of our cycle time
-    r.sleep();
+    if (!checkpoint_file_.empty() && layered_costmap_->isInitialized()) {
+      auto current_time = now();
+      if (last_checkpoint_ + checkpoint_cycle_ < current_time ||
+        current_time < last_checkpoint_)
+      {
+        writeCheckpoint();
+        last_checkpoint_ = current_time;
+      }
+    }
 
-#if 0
-    // TODO(bpwilcox): find ROS2 equivalent or port for r.cycletime()
-    if (r.period() > tf2::durationFromSec(1 / frequency)) {
-      RCLCPP_WARN(
-        get_logger(),
-        "Costmap2DROS: Map update loop missed its desired rate of %.4fHz... "
-        "the loop actually took %.4f seconds", frequency, r.period());
+    UpdateStatistics * statistics = layered_costmap_->getStatistics();
+    if (timer.elapsed_time_in_seconds() > 1 / frequency) {
+      // throttle warning down to one every 10 missed cycles
+      if (missed_cycles_++ % 10 == 0) {
+        RCLCPP_WARN(
+          get_logger(),
+          "Costmap2DROS: Map update loop missed its desired rate of %.4fHz... "
+          "the update actually took %.4f seconds", frequency, timer.elapsed_time_in_seconds());
+      }
+      if (statistics) {
+        statistics->addMissedCycle();
+      }
+    }
+
+    if (statistics) {
+      statistics->addUpdateTime(timer.elapsed_time_in_seconds());
+      auto current_time = now();
+      if (last_statistics_publish_ + statistics_cycle_ < current_time ||
+        current_time < last_statistics_publish_)
+      {
+        nav2_msgs::msg::CostmapUpdateStatistics msg;
+        msg.header.frame_id = global_frame_;
+        msg.header.stamp = current_time;
+        statistics->toMsg(msg);
+        statistics_pub_->publish(msg);
+        last_statistics_publish_ = current_time;
+      }
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(update_request_mutex_);
+      ++updates_completed_;
+    }
+    update_done_cv_.notify_all();
+
+    if (on_demand_ && waitForDemand(update_start)) {
+      continue;  // woken by a planner, a queued clear or the keepalive
     }
-#endif
+
+    if (update_on_data_) {
+      waitForUpdateRequest(update_start, frequency);
+    } else {
+      // Make sure to sleep for the remainder of our cycle time
+      r.sleep();
+    }
+  }
+}
+
+void
+Costmap2DROS::onUpdateRequest()
+{
+  {
+    std::lock_guard<std::mutex> lock(update_request_mutex_);
+    update_requested_ = true;
   }
+  update_request_cv_.notify_one();
+}
+
+void
+Costmap2DROS::onClearRequest()
+{
+  {
+    std::lock_guard<std::mutex> lock(update_request_mutex_);
+    clear_requested_ = true;
+  }
+  update_request_cv_.notify_all();
+}
+
+void
+Costmap2DROS::waitForUpdateRequest(
+  std::chrono::steady_clock::time_point last_update, double frequency)
+{
+  using std::chrono::duration_cast;
+  using std::chrono::steady_clock;
+  const auto min_interval = duration_cast<steady_clock::duration>(
+    std::chrono::duration<double>(min_update_interval_));
+  const auto fallback = last_update + duration_cast<steady_clock::duration>(
+    std::chrono::duration<double>(1 / frequency));
+
+  // data coming in meanwhile is taken up together by the next update
+  std::this_thread::sleep_until(last_update + min_interval);
+
+  std::unique_lock<std::mutex> lock(update_request_mutex_);
+  while (!update_requested_ && !map_update_thread_shutdown_ && rclcpp::ok()) {
+    const auto current = steady_clock::now();
+    if (current >= fallback) {
+      break;
+    }
+    // only the pose of the robot is polled, no more often than updates may run
+    lock.unlock();
+    const bool moved = robotMovedSinceUpdate();
+    lock.lock();
+    if (moved) {
+      break;
+    }
+    update_request_cv_.wait_until(lock, std::min(fallback, current + min_interval));
+  }
+  update_requested_ = false;
+}
+
+bool
+Costmap2DROS::waitForDemand(std::chrono::steady_clock::time_point last_update)
+{
+  using std::chrono::duration_cast;
+  using std::chrono::steady_clock;
+
+  std::unique_lock<std::mutex> lock(update_request_mutex_);
+  if (steady_clock::now() < demand_until_) {
+    clear_requested_ = false;  // the next update, at the full rate, runs the clears
+    return false;
+  }
+
+  auto woken = [this]() {
+      return demand_requested_ || clear_requested_ || map_update_thread_shutdown_ ||
+             !rclcpp::ok();
+    };
+  idle_ = true;
+  if (idle_update_frequency_ > 0) {
+    const auto keepalive = last_update + duration_cast<steady_clock::duration>(
+      std::chrono::duration<double>(1 / idle_update_frequency_));
+    update_request_cv_.wait_until(lock, keepalive, woken);
+  } else {
+    update_request_cv_.wait(lock, woken);
+  }
+  idle_ = false;
+  demand_requested_ = false;
+  clear_requested_ = false;
+  return true;
+}
+
+bool
+Costmap2DROS::demandUpdates(std::chrono::milliseconds timeout)
+{
+  std::unique_lock<std::mutex> lock(update_request_mutex_);
+  demand_until_ = std::chrono::steady_clock::now() +
+    std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+    std::chrono::duration<double>(demand_timeout_));
+  if (!on_demand_ || !idle_) {
+    return true;
+  }
+
+  // wake the idle loop and wait for the update bringing the costmap up to date
+  const uint64_t completed = updates_completed_;
+  demand_requested_ = true;
+  update_request_cv_.notify_all();
+  return update_done_cv_.wait_for(
+    lock, timeout, [this, completed]() {
+      return updates_completed_ > completed || map_update_thread_shutdown_;
+    }) && updates_completed_ > completed;
+}
+
+bool
+Costmap2DROS::robotMovedSinceUpdate()
+{
+  geometry_msgs::msg::PoseStamped pose;
+  if (!initialized_ || !getRobotPose(pose)) {
+    return false;
+  }
+  const UpdatePose last = update_pose_.load();
+  const double dx = pose.pose.position.x - last.x;
+  const double dy = pose.pose.position.y - last.y;
+  const double dyaw = std::remainder(tf2::getYaw(pose.pose.orientation) - last.yaw, 2 * M_PI);
+  return std::hypot(dx, dy) > update_distance_threshold_ ||
+         std::fabs(dyaw) > update_angle_threshold_;
 }
 
 void
 Costmap2DROS::updateMap()
 {
+  NAV2_TRACE_SCOPE("costmap_update");
   RCLCPP_DEBUG(get_logger(), "Updating map...");
 
   if (!stop_updates_) {
@@ -440,19 +810,150 @@ Costmap2DROS::updateMap()
       const double & y = pose.pose.position.y;
       const double yaw = tf2::getYaw(pose.pose.orientation);
       layered_costmap_->updateMap(x, y, yaw);
+      recordUpdate();
+      update_pose_.store(UpdatePose{rclcpp::Time(pose.header.stamp).nanoseconds(), x, y, yaw});
+      if (use_snapshots_) {
+        publishSnapshot();
+      }
 
-      geometry_msgs::msg::PolygonStamped footprint;
-      footprint.header.frame_id = global_frame_;
-      footprint.header.stamp = now();
-      transformFootprint(x, y, yaw, padded_footprint_, footprint);
+      if (footprint_changed_.exchange(false) || footprint_pub_->get_subscription_count() > 0) {
+        footprint_msg_.header.frame_id = global_frame_;
+        footprint_msg_.header.stamp = now();
+        transformFootprint(x, y, yaw, padded_footprint_, footprint_msg_);
 
-      RCLCPP_DEBUG(get_logger(), "Publishing footprint");
-      footprint_pub_->publish(footprint);
+        RCLCPP_DEBUG(get_logger(), "Publishing footprint");
+        footprint_pub_->publish(footprint_msg_);
+      }
       initialized_ = true;
     }
   }
 }
 
+void
+Costmap2DROS::publishSnapshot()
+{
+  // Triple buffering: one snapshot is current, one may still be held by a reader
+  // and the third is free to be overwritten. Readers holding on to snapshots for
+  // longer only make the pool grow, they never see a buffer change underneath them.
+  std::shared_ptr<Costmap2D> current = std::atomic_load(&snapshot_);
+  std::shared_ptr<Costmap2D> buffer;
+  for (auto & candidate : snapshot_pool_) {
+    if (candidate != current && candidate.use_count() == 1) {
+      buffer = candidate;
+      break;
+    }
+  }
+  if (!buffer) {
+    buffer = std::make_shared<Costmap2D>();
+    snapshot_pool_.push_back(buffer);
+  }
+
+  Costmap2D * master = layered_costmap_->getCostmap();
+  {
+    std::unique_lock<Costmap2D::mutex_t> lock(*(master->getMutex()));
+    *buffer = *master;
+  }
+  std::atomic_store(&snapshot_, buffer);
+}
+
+void
+Costmap2DROS::writeCheckpoint()
+{
+  // the master costmap is saved without a name, the layers under theirs
+  CostmapCheckpoint checkpoint;
+  Costmap2D * master = layered_costmap_->getCostmap();
+  {
+    std::unique_lock<Costmap2D::mutex_t> lock(*(master->getMutex()));
+    checkpoint.add("", *master);
+  }
+  for (auto & plugin : *layered_costmap_->getPlugins()) {
+    auto layer = std::dynamic_pointer_cast<CostmapLayer>(plugin);
+    if (layer) {
+      std::unique_lock<Costmap2D::mutex_t> lock(*(layer->getMutex()));
+      checkpoint.add(layer->getName(), *layer);
+    }
+  }
+  if (!checkpoint.write(checkpoint_file_)) {
+    RCLCPP_WARN(get_logger(), "Could not write the checkpoint %s", checkpoint_file_.c_str());
+  }
+}
+
+void
+Costmap2DROS::recordUpdate()
+{
+  if (!flight_recorder_ || !layered_costmap_->isInitialized()) {
+    return;
+  }
+  Costmap2D * master = layered_costmap_->getCostmap();
+  std::unique_lock<Costmap2D::mutex_t> lock(*(master->getMutex()));
+  flight_recorder_->record(*master, now().nanoseconds());
+}
+
+std::string
+Costmap2DROS::saveFlightRecording(const std::string & filename)
+{
+  if (!flight_recorder_) {
+    return "";
+  }
+  std::string file = filename;
+  if (file.empty()) {
+    file = flight_recorder_prefix_ + std::to_string(now().nanoseconds()) + ".bin";
+  }
+  if (!flight_recorder_->write(file)) {
+    RCLCPP_WARN(get_logger(), "Could not write the flight recording %s", file.c_str());
+    return "";
+  }
+  RCLCPP_INFO(
+    get_logger(), "Saved the last %.1f s of costmap updates to %s (%zu bytes of costs)",
+    flight_recorder_duration_, file.c_str(), flight_recorder_->bytes());
+  return file;
+}
+
+void
+Costmap2DROS::restoreCheckpoint()
+{
+  CostmapCheckpoint checkpoint;
+  if (!checkpoint.read(checkpoint_file_)) {
+    RCLCPP_INFO(
+      get_logger(), "No checkpoint to restore from %s, starting empty",
+      checkpoint_file_.c_str());
+    return;
+  }
+  const CostmapCheckpoint::Grid * saved_master = checkpoint.find("");
+  if (!saved_master) {
+    return;
+  }
+
+  Costmap2D * master = layered_costmap_->getCostmap();
+  if (!rolling_window_ &&
+    (saved_master->size_x != master->getSizeInCellsX() ||
+    saved_master->size_y != master->getSizeInCellsY() ||
+    saved_master->resolution != master->getResolution() ||
+    saved_master->origin_x != master->getOriginX() ||
+    saved_master->origin_y != master->getOriginY()))
+  {
+    layered_costmap_->resizeMap(
+      saved_master->size_x, saved_master->size_y, saved_master->resolution,
+      saved_master->origin_x, saved_master->origin_y, layered_costmap_->isSizeLocked());
+  }
+
+  size_t restored = 0;
+  {
+    std::unique_lock<Costmap2D::mutex_t> lock(*(master->getMutex()));
+    restored += checkpoint.restore("", *master);
+  }
+  for (auto & plugin : *layered_costmap_->getPlugins()) {
+    auto layer = std::dynamic_pointer_cast<CostmapLayer>(plugin);
+    if (layer) {
+      std::unique_lock<Costmap2D::mutex_t> lock(*(layer->getMutex()));
+      restored += checkpoint.restore(layer->getName(), *layer);
+    }
+  }
+  RCLCPP_INFO(
+    get_logger(), "Restored %zu of the %zu costmaps of the checkpoint %s",
+    restored, checkpoint.grids().size(), checkpoint_file_.c_str());
+}
+
 void
 Costmap2DROS::start()
 {
@@ -537,4 +1038,25 @@ Costmap2DROS::getRobotPose(geometry_msgs::msg::PoseStamped & global_pose)
     global_frame_, robot_base_frame_, transform_tolerance_);
 }
 
+bool
+Costmap2DROS::getUpdatePose(geometry_msgs::msg::PoseStamped & global_pose, double max_age)
+{
+  const UpdatePose last = update_pose_.load();
+  const rclcpp::Time current = now();
+  const rclcpp::Time stamp(last.stamp, current.get_clock_type());
+  if (!initialized_ || last.stamp == 0 || (current - stamp).seconds() > max_age) {
+    return getRobotPose(global_pose);
+  }
+
+  global_pose.header.frame_id = global_frame_;
+  global_pose.header.stamp = stamp;
+  global_pose.pose.position.x = last.x;
+  global_pose.pose.position.y = last.y;
+  global_pose.pose.position.z = 0.0;
+  tf2::Quaternion orientation;
+  orientation.setRPY(0.0, 0.0, last.yaw);
+  global_pose.pose.orientation = tf2::toMsg(orientation);
+  return true;
+}
+
 }  // namespace nav2_costmap_2d
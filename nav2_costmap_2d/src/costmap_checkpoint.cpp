@@ -0,0 +1,185 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_costmap_2d/costmap_checkpoint.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "nav2_costmap_2d/costmap_encoding.hpp"
+
+namespace nav2_costmap_2d
+{
+
+namespace
+{
+
+const char CHECKPOINT_MAGIC[4] = {'N', 'C', 'C', 'K'};
+const uint32_t CHECKPOINT_VERSION = 1;
+
+template<typename T>
+void writeValue(std::ofstream & out, T value)
+{
+  out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template<typename T>
+bool readValue(std::ifstream & in, T & value)
+{
+  return static_cast<bool>(in.read(reinterpret_cast<char *>(&value), sizeof(value)));
+}
+
+}  // namespace
+
+void CostmapCheckpoint::add(const std::string & name, const Costmap2D & costmap)
+{
+  Grid grid;
+  grid.name = name;
+  grid.size_x = costmap.getSizeInCellsX();
+  grid.size_y = costmap.getSizeInCellsY();
+  grid.resolution = costmap.getResolution();
+  grid.origin_x = costmap.getOriginX();
+  grid.origin_y = costmap.getOriginY();
+  encodeRunLength(
+    costmap.getCharMap(), static_cast<std::size_t>(grid.size_x) * grid.size_y, grid.runs);
+  grids_.push_back(std::move(grid));
+}
+
+const CostmapCheckpoint::Grid * CostmapCheckpoint::find(const std::string & name) const
+{
+  for (const Grid & grid : grids_) {
+    if (grid.name == name) {
+      return &grid;
+    }
+  }
+  return nullptr;
+}
+
+bool CostmapCheckpoint::write(const std::string & filename) const
+{
+  // renamed over the file once complete, so a crash while writing leaves the last one
+  const std::string partial = filename + ".partial";
+  {
+    std::ofstream out(partial, std::ios::binary | std::ios::trunc);
+    if (!out) {
+      return false;
+    }
+    out.write(CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+    writeValue(out, CHECKPOINT_VERSION);
+    writeValue(out, static_cast<uint32_t>(grids_.size()));
+    for (const Grid & grid : grids_) {
+      writeValue(out, static_cast<uint32_t>(grid.name.size()));
+      out.write(grid.name.data(), grid.name.size());
+      writeValue(out, static_cast<uint32_t>(grid.size_x));
+      writeValue(out, static_cast<uint32_t>(grid.size_y));
+      writeValue(out, grid.resolution);
+      writeValue(out, grid.origin_x);
+      writeValue(out, grid.origin_y);
+      writeValue(out, static_cast<uint64_t>(grid.runs.size()));
+      out.write(reinterpret_cast<const char *>(grid.runs.data()), grid.runs.size());
+    }
+    if (!out.flush()) {
+      return false;
+    }
+  }
+  return std::rename(partial.c_str(), filename.c_str()) == 0;
+}
+
+bool CostmapCheckpoint::read(const std::string & filename)
+{
+  grids_.clear();
+  std::ifstream in(filename, std::ios::binary);
+  char magic[sizeof(CHECKPOINT_MAGIC)];
+  uint32_t version, count;
+  if (!in.read(magic, sizeof(magic)) ||
+    memcmp(magic, CHECKPOINT_MAGIC, sizeof(magic)) != 0 ||
+    !readValue(in, version) || version != CHECKPOINT_VERSION || !readValue(in, count))
+  {
+    return false;
+  }
+
+  std::vector<Grid> grids;
+  for (uint32_t i = 0; i < count; i++) {
+    Grid grid;
+    uint32_t name_size, size_x, size_y;
+    uint64_t runs_size;
+    if (!readValue(in, name_size)) {
+      return false;
+    }
+    grid.name.resize(name_size);
+    if (!in.read(&grid.name[0], name_size) ||
+      !readValue(in, size_x) || !readValue(in, size_y) ||
+      !readValue(in, grid.resolution) ||
+      !readValue(in, grid.origin_x) || !readValue(in, grid.origin_y) ||
+      !readValue(in, runs_size))
+    {
+      return false;
+    }
+    // a run takes two bytes at most for each cell
+    if (runs_size > 2 * static_cast<uint64_t>(size_x) * size_y) {
+      return false;
+    }
+    grid.size_x = size_x;
+    grid.size_y = size_y;
+    grid.runs.resize(runs_size);
+    if (!in.read(reinterpret_cast<char *>(grid.runs.data()), runs_size)) {
+      return false;
+    }
+    grids.push_back(std::move(grid));
+  }
+  grids_ = std::move(grids);
+  return true;
+}
+
+bool CostmapCheckpoint::restore(const std::string & name, Costmap2D & costmap) const
+{
+  const Grid * grid = find(name);
+  if (!grid || grid->size_x != costmap.getSizeInCellsX() ||
+    grid->size_y != costmap.getSizeInCellsY() || grid->resolution != costmap.getResolution())
+  {
+    return false;
+  }
+  std::vector<unsigned char> costs(static_cast<std::size_t>(grid->size_x) * grid->size_y);
+  if (!decodeRunLength(grid->runs, costs.size(), costs.data())) {
+    return false;
+  }
+
+  // the saved cell (x, y) is the cell (x + dx, y + dy) of the costmap
+  const int dx = static_cast<int>(
+    std::lround((grid->origin_x - costmap.getOriginX()) / grid->resolution));
+  const int dy = static_cast<int>(
+    std::lround((grid->origin_y - costmap.getOriginY()) / grid->resolution));
+  const int size_x = static_cast<int>(grid->size_x);
+  const int size_y = static_cast<int>(grid->size_y);
+  unsigned char * cells = costmap.getCharMap();
+  std::fill(cells, cells + costs.size(), costmap.getDefaultValue());
+
+  const int x0 = std::max(0, -dx), xn = std::min(size_x, size_x - dx);
+  const int y0 = std::max(0, -dy), yn = std::min(size_y, size_y - dy);
+  for (int y = y0; y < yn && x0 < xn; y++) {
+    std::copy(
+      costs.begin() + y * size_x + x0, costs.begin() + y * size_x + xn,
+      cells + (y + dy) * size_x + x0 + dx);
+  }
+  costmap.markAllChanged();
+  return true;
+}
+
+}  // namespace nav2_costmap_2d
@@ -0,0 +1,76 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_costmap_2d/costmap_encoding.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace nav2_costmap_2d
+{
+
+void encodeRunLength(
+  const unsigned char * costs, std::size_t size, std::vector<uint8_t> & encoded)
+{
+  encoded.clear();
+  std::size_t i = 0;
+  while (i < size) {
+    const unsigned char cost = costs[i];
+    const std::size_t end = std::find_if(
+      costs + i, costs + size,
+      [cost](unsigned char c) {return c != cost;}) - costs;
+    std::size_t length = end - i;
+
+    encoded.push_back(cost);
+    while (length >= 0x80) {
+      encoded.push_back(static_cast<uint8_t>(length | 0x80));
+      length >>= 7;
+    }
+    encoded.push_back(static_cast<uint8_t>(length));
+    i = end;
+  }
+}
+
+bool decodeRunLength(
+  const std::vector<uint8_t> & encoded, std::size_t size, unsigned char * costs)
+{
+  std::size_t written = 0;
+  std::size_t i = 0;
+  while (i < encoded.size()) {
+    const unsigned char cost = encoded[i++];
+
+    std::size_t length = 0;
+    unsigned int shift = 0;
+    while (true) {
+      if (i == encoded.size() || shift >= 8 * sizeof(std::size_t)) {
+        return false;
+      }
+      const uint8_t byte = encoded[i++];
+      length |= static_cast<std::size_t>(byte & 0x7f) << shift;
+      shift += 7;
+      if (!(byte & 0x80)) {
+        break;
+      }
+    }
+
+    if (length > size - written) {
+      return false;
+    }
+    std::fill(costs + written, costs + written + length, cost);
+    written += length;
+  }
+  return written == size;
+}
+
+}  // namespace nav2_costmap_2d
@@ -0,0 +1,65 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "nav2_costmap_2d/costmap_recorder.hpp"
+
+using std::cerr;
+
+void usage()
+{
+  cerr << "Invalid command line.\n\n";
+  cerr << "This command replays a costmap flight recording, saving the costmap after\n";
+  cerr << "each recorded update as <output prefix><frame>.pgm\n\n";
+  cerr << "Usage:\n";
+  cerr << " > costmap_flight_replay <recording> <output prefix>\n";
+  std::exit(1);
+}
+
+int main(int argc, char * argv[])
+{
+  if (argc != 3) {
+    usage();
+  }
+
+  std::vector<nav2_costmap_2d::CostmapRecorder::Frame> frames;
+  if (!nav2_costmap_2d::CostmapRecorder::read(argv[1], frames)) {
+    cerr << "Could not read the flight recording " << argv[1] << "\n";
+    return 1;
+  }
+
+  nav2_costmap_2d::Costmap2D costmap;
+  for (std::size_t i = 0; i < frames.size(); ++i) {
+    const auto & frame = frames[i];
+    if (!nav2_costmap_2d::CostmapRecorder::apply(frame, costmap)) {
+      cerr << "Frame " << i << " of the recording is malformed\n";
+      return 1;
+    }
+    char index[32];
+    std::snprintf(index, sizeof(index), "%06zu", i);
+    const std::string file = std::string(argv[2]) + index + ".pgm";
+    if (!costmap.saveMap(file)) {
+      cerr << "Could not write " << file << "\n";
+      return 1;
+    }
+    std::cout << file << ": " << frame.stamp * 1e-9 << " s, " <<
+      (frame.keyframe ? "keyframe" : std::to_string(frame.tiles.size()) + " tiles") << "\n";
+  }
+  return 0;
+}
@@ -37,6 +37,8 @@
  *********************************************************************/
 
 #include <nav2_costmap_2d/costmap_layer.hpp>
+#include <nav2_costmap_2d/cost_combination.hpp>
+#include <cstring>
 #include <stdexcept>
 #include <algorithm>
 
@@ -63,20 +65,16 @@ void CostmapLayer::matchSize()
 
 void CostmapLayer::clearArea(int start_x, int start_y, int end_x, int end_y)
 {
-  unsigned char * grid = getCharMap();
-  for (int x = 0; x < static_cast<int>(getSizeInCellsX()); x++) {
-    bool xrange = x > start_x && x < end_x;
-
-    for (int y = 0; y < static_cast<int>(getSizeInCellsY()); y++) {
-      if (xrange && y > start_y && y < end_y) {
-        continue;
-      }
-      int index = getIndex(x, y);
-      if (grid[index] != NO_INFORMATION) {
-        grid[index] = NO_INFORMATION;
-      }
-    }
-  }
+  // the bounds of the area kept are exclusive
+  resetMapOutside(start_x + 1, start_y + 1, end_x, end_y, NO_INFORMATION);
+}
+
+void CostmapLayer::resetOutside(int x0, int y0, int xn, int yn, unsigned char value)
+{
+  resetMapOutside(x0, y0, xn, yn, value);
+
+  double ox = getOriginX(), oy = getOriginY();
+  addExtraBounds(ox, oy, ox + getSizeInMetersX(), oy + getSizeInMetersY());
 }
 
 void CostmapLayer::addExtraBounds(double mx0, double my0, double mx1, double my1)
@@ -117,20 +115,13 @@ void CostmapLayer::updateWithMax(
   unsigned char * master_array = master_grid.getCharMap();
   unsigned int span = master_grid.getSizeInCellsX();
 
+  if (max_i <= min_i) {
+    return;
+  }
+
   for (int j = min_j; j < max_j; j++) {
     unsigned int it = j * span + min_i;
-    for (int i = min_i; i < max_i; i++) {
-      if (costmap_[it] == NO_INFORMATION) {
-        it++;
-        continue;
-      }
-
-      unsigned char old_cost = master_array[it];
-      if (old_cost == NO_INFORMATION || old_cost < costmap_[it]) {
-        master_array[it] = costmap_[it];
-      }
-      it++;
-    }
+    combineMax(costmap_ + it, max_i - min_i, master_array + it);
   }
 }
 
@@ -151,12 +142,13 @@ void CostmapLayer::updateWithTrueOverwrite(
   unsigned char * master = master_grid.getCharMap();
   unsigned int span = master_grid.getSizeInCellsX();
 
+  if (max_i <= min_i) {
+    return;
+  }
+
   for (int j = min_j; j < max_j; j++) {
     unsigned int it = span * j + min_i;
-    for (int i = min_i; i < max_i; i++) {
-      master[it] = costmap_[it];
-      it++;
-    }
+    std::memcpy(master + it, costmap_ + it, max_i - min_i);
   }
 }
 
@@ -170,14 +162,13 @@ void CostmapLayer::updateWithOverwrite(
   unsigned char * master = master_grid.getCharMap();
   unsigned int span = master_grid.getSizeInCellsX();
 
+  if (max_i <= min_i) {
+    return;
+  }
+
   for (int j = min_j; j < max_j; j++) {
     unsigned int it = span * j + min_i;
-    for (int i = min_i; i < max_i; i++) {
-      if (costmap_[it] != NO_INFORMATION) {
-        master[it] = costmap_[it];
-      }
-      it++;
-    }
+    combineOverwrite(costmap_ + it, max_i - min_i, master + it);
   }
 }
 
@@ -191,27 +182,13 @@ void CostmapLayer::updateWithAddition(
   unsigned char * master_array = master_grid.getCharMap();
   unsigned int span = master_grid.getSizeInCellsX();
 
+  if (max_i <= min_i) {
+    return;
+  }
+
   for (int j = min_j; j < max_j; j++) {
     unsigned int it = j * span + min_i;
-    for (int i = min_i; i < max_i; i++) {
-      if (costmap_[it] == NO_INFORMATION) {
-        it++;
-        continue;
-      }
-
-      unsigned char old_cost = master_array[it];
-      if (old_cost == NO_INFORMATION) {
-        master_array[it] = costmap_[it];
-      } else {
-        int sum = old_cost + costmap_[it];
-        if (sum >= nav2_costmap_2d::INSCRIBED_INFLATED_OBSTACLE) {
-          master_array[it] = nav2_costmap_2d::INSCRIBED_INFLATED_OBSTACLE - 1;
-        } else {
-          master_array[it] = sum;
-        }
-      }
-      it++;
-    }
+    combineAddition(costmap_ + it, max_i - min_i, master_array + it);
   }
 }
 }  // namespace nav2_costmap_2d
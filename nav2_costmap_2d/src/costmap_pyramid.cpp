@@ -0,0 +1,123 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_costmap_2d/costmap_pyramid.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+namespace nav2_costmap_2d
+{
+
+CostmapPyramid::CostmapPyramid(unsigned int num_levels)
+: initialized_(false), size_x_(0), size_y_(0), resolution_(0.0), origin_x_(0.0), origin_y_(0.0)
+{
+  for (unsigned int i = 0; i < num_levels; ++i) {
+    levels_.push_back(std::make_unique<Costmap2D>());
+  }
+}
+
+void CostmapPyramid::update(const Costmap2D & costmap, int x0, int y0, int xn, int yn)
+{
+  if (levels_.empty()) {
+    return;
+  }
+
+  if (!initialized_ || costmap.getSizeInCellsX() != size_x_ ||
+    costmap.getSizeInCellsY() != size_y_ || costmap.getResolution() != resolution_ ||
+    costmap.getOriginX() != origin_x_ || costmap.getOriginY() != origin_y_)
+  {
+    size_x_ = costmap.getSizeInCellsX();
+    size_y_ = costmap.getSizeInCellsY();
+    resolution_ = costmap.getResolution();
+    origin_x_ = costmap.getOriginX();
+    origin_y_ = costmap.getOriginY();
+    initialized_ = true;
+
+    unsigned int size_x = size_x_, size_y = size_y_;
+    double resolution = resolution_;
+    for (auto & level : levels_) {
+      size_x = (size_x + 1) / 2;
+      size_y = (size_y + 1) / 2;
+      resolution *= 2.0;
+      level->resizeMap(size_x, size_y, resolution, origin_x_, origin_y_);
+    }
+    x0 = 0;
+    y0 = 0;
+    xn = size_x_;
+    yn = size_y_;
+  }
+
+  const Costmap2D * fine = &costmap;
+  for (auto & level : levels_) {
+    if (xn <= x0 || yn <= y0) {
+      return;
+    }
+    // the coarse cells covering the area
+    x0 /= 2;
+    y0 /= 2;
+    xn = (xn + 1) / 2;
+    yn = (yn + 1) / 2;
+    poolArea(*fine, *level, x0, y0, xn, yn);
+    fine = level.get();
+  }
+}
+
+void CostmapPyramid::poolArea(
+  const Costmap2D & fine, Costmap2D & coarse, int x0, int y0, int xn, int yn)
+{
+  const unsigned char * fine_costs = fine.getCharMap();
+  unsigned char * coarse_costs = coarse.getCharMap();
+  const unsigned int fine_x = fine.getSizeInCellsX();
+  const unsigned int fine_y = fine.getSizeInCellsY();
+  const unsigned int coarse_x = coarse.getSizeInCellsX();
+
+  for (int y = y0; y < yn; ++y) {
+    const unsigned char * row = fine_costs + 2 * y * fine_x;
+    // the last row and column of an odd sized level only cover one cell
+    const unsigned char * next_row = 2 * y + 1 < static_cast<int>(fine_y) ? row + fine_x : row;
+    unsigned char * out = coarse_costs + y * coarse_x;
+    for (int x = x0; x < xn; ++x) {
+      const unsigned int i = 2 * x;
+      const unsigned int j = i + 1 < fine_x ? i + 1 : i;
+      out[x] = std::max(std::max(row[i], row[j]), std::max(next_row[i], next_row[j]));
+    }
+  }
+}
+
+void poolRegion(
+  const Costmap2D & costmap, unsigned int x0, unsigned int y0, unsigned int xn,
+  unsigned int yn, unsigned int factor, std::vector<unsigned char> & costs,
+  unsigned int & size_x, unsigned int & size_y)
+{
+  factor = std::max(factor, 1u);
+  size_x = xn > x0 ? (xn - x0 + factor - 1) / factor : 0;
+  size_y = yn > y0 ? (yn - y0 + factor - 1) / factor : 0;
+  costs.assign(size_x * size_y, 0);
+
+  const unsigned char * map = costmap.getCharMap();
+  const unsigned int map_x = costmap.getSizeInCellsX();
+  for (unsigned int y = y0; y < yn; ++y) {
+    // each row of the area is folded into the row of the copy covering it
+    const unsigned char * row = map + y * map_x;
+    unsigned char * out = costs.data() + (y - y0) / factor * size_x;
+    for (unsigned int x = x0, i = 0; x < xn; x += factor, ++i) {
+      const unsigned int end = std::min(x + factor, xn);
+      out[i] = std::max(out[i], *std::max_element(row + x, row + end));
+    }
+  }
+}
+
+}  // namespace nav2_costmap_2d
@@ -0,0 +1,295 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_costmap_2d/costmap_recorder.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "nav2_costmap_2d/costmap_encoding.hpp"
+
+namespace nav2_costmap_2d
+{
+
+namespace
+{
+
+const char RECORDING_MAGIC[4] = {'N', 'C', 'F', 'R'};
+const uint32_t RECORDING_VERSION = 1;
+
+template<typename T>
+void writeValue(std::ofstream & out, T value)
+{
+  out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template<typename T>
+bool readValue(std::ifstream & in, T & value)
+{
+  return static_cast<bool>(in.read(reinterpret_cast<char *>(&value), sizeof(value)));
+}
+
+// The cells of a change tile, clipped to the map: [x0, xn) x [y0, yn)
+void tileBounds(
+  unsigned int tile, unsigned int tile_size, unsigned int size_x, unsigned int size_y,
+  unsigned int & x0, unsigned int & y0, unsigned int & xn, unsigned int & yn)
+{
+  const unsigned int num_tiles_x = (size_x + tile_size - 1) / tile_size;
+  x0 = tile % num_tiles_x * tile_size;
+  y0 = tile / num_tiles_x * tile_size;
+  xn = std::min(x0 + tile_size, size_x);
+  yn = std::min(y0 + tile_size, size_y);
+}
+
+}  // namespace
+
+CostmapRecorder::CostmapRecorder(double duration, unsigned int keyframe_interval)
+: duration_(static_cast<int64_t>(duration * 1e9)),
+  keyframe_interval_(std::max(1u, keyframe_interval))
+{
+}
+
+void CostmapRecorder::record(const Costmap2D & costmap, int64_t stamp)
+{
+  Frame frame;
+  frame.stamp = stamp;
+  frame.size_x = costmap.getSizeInCellsX();
+  frame.size_y = costmap.getSizeInCellsY();
+  frame.resolution = costmap.getResolution();
+  frame.origin_x = costmap.getOriginX();
+  frame.origin_y = costmap.getOriginY();
+  frame.tile_size = costmap.getChangeTileSize();
+
+  bool moved;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const Frame * last = frames_.empty() ? nullptr : &frames_.back();
+    moved = !last || last->size_x != frame.size_x || last->size_y != frame.size_y ||
+      last->resolution != frame.resolution ||
+      last->origin_x != frame.origin_x || last->origin_y != frame.origin_y;
+  }
+
+  if (!moved) {
+    costmap.getChangedTiles(change_count_, tiles_);
+    if (tiles_.empty()) {
+      return;
+    }
+  }
+  // a resized or moved map changes all over, a keyframe is as small as a delta then
+  frame.keyframe = moved || updates_since_keyframe_ + 1 >= keyframe_interval_;
+
+  const unsigned char * cells = costmap.getCharMap();
+  if (frame.keyframe) {
+    encodeRunLength(
+      cells, static_cast<std::size_t>(frame.size_x) * frame.size_y, frame.runs);
+    updates_since_keyframe_ = 0;
+  } else {
+    costs_.clear();
+    for (unsigned int tile : tiles_) {
+      unsigned int x0, y0, xn, yn;
+      tileBounds(tile, frame.tile_size, frame.size_x, frame.size_y, x0, y0, xn, yn);
+      for (unsigned int y = y0; y < yn; ++y) {
+        const unsigned char * row = cells + static_cast<std::size_t>(y) * frame.size_x;
+        costs_.insert(costs_.end(), row + x0, row + xn);
+      }
+    }
+    frame.tiles.assign(tiles_.begin(), tiles_.end());
+    encodeRunLength(costs_.data(), costs_.size(), frame.runs);
+    ++updates_since_keyframe_;
+  }
+  change_count_ = costmap.getChangeCount();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  bytes_ += frame.runs.size() + frame.tiles.size() * sizeof(uint32_t);
+  frames_.push_back(std::move(frame));
+  trim();
+}
+
+void CostmapRecorder::trim()
+{
+  // the frames before the newest keyframe old enough to start the duration can go
+  const int64_t start = frames_.back().stamp - duration_;
+  auto keep = frames_.begin();
+  for (auto it = frames_.begin(); it != frames_.end() && it->stamp <= start; ++it) {
+    if (it->keyframe) {
+      keep = it;
+    }
+  }
+  for (auto it = frames_.begin(); it != keep; ++it) {
+    bytes_ -= it->runs.size() + it->tiles.size() * sizeof(uint32_t);
+  }
+  frames_.erase(frames_.begin(), keep);
+}
+
+std::vector<CostmapRecorder::Frame> CostmapRecorder::frames() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return std::vector<Frame>(frames_.begin(), frames_.end());
+}
+
+std::size_t CostmapRecorder::bytes() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return bytes_;
+}
+
+bool CostmapRecorder::write(const std::string & filename) const
+{
+  const std::vector<Frame> frames = this->frames();
+
+  // renamed over the file once complete, so a crash while writing leaves the last one
+  const std::string partial = filename + ".partial";
+  {
+    std::ofstream out(partial, std::ios::binary | std::ios::trunc);
+    if (!out) {
+      return false;
+    }
+    out.write(RECORDING_MAGIC, sizeof(RECORDING_MAGIC));
+    writeValue(out, RECORDING_VERSION);
+    writeValue(out, static_cast<uint32_t>(frames.size()));
+    for (const Frame & frame : frames) {
+      writeValue(out, frame.stamp);
+      writeValue(out, static_cast<uint8_t>(frame.keyframe));
+      writeValue(out, static_cast<uint32_t>(frame.size_x));
+      writeValue(out, static_cast<uint32_t>(frame.size_y));
+      writeValue(out, frame.resolution);
+      writeValue(out, frame.origin_x);
+      writeValue(out, frame.origin_y);
+      writeValue(out, static_cast<uint32_t>(frame.tile_size));
+      writeValue(out, static_cast<uint32_t>(frame.tiles.size()));
+      out.write(
+        reinterpret_cast<const char *>(frame.tiles.data()),
+        frame.tiles.size() * sizeof(uint32_t));
+      writeValue(out, static_cast<uint64_t>(frame.runs.size()));
+      out.write(reinterpret_cast<const char *>(frame.runs.data()), frame.runs.size());
+    }
+    if (!out.flush()) {
+      return false;
+    }
+  }
+  return std::rename(partial.c_str(), filename.c_str()) == 0;
+}
+
+bool CostmapRecorder::read(const std::string & filename, std::vector<Frame> & frames)
+{
+  frames.clear();
+  std::ifstream in(filename, std::ios::binary);
+  char magic[sizeof(RECORDING_MAGIC)];
+  uint32_t version, count;
+  if (!in.read(magic, sizeof(magic)) ||
+    memcmp(magic, RECORDING_MAGIC, sizeof(magic)) != 0 ||
+    !readValue(in, version) || version != RECORDING_VERSION || !readValue(in, count))
+  {
+    return false;
+  }
+
+  std::vector<Frame> read_frames;
+  for (uint32_t i = 0; i < count; i++) {
+    Frame frame;
+    uint8_t keyframe;
+    uint32_t size_x, size_y, tile_size, num_tiles;
+    uint64_t runs_size;
+    if (!readValue(in, frame.stamp) || !readValue(in, keyframe) ||
+      !readValue(in, size_x) || !readValue(in, size_y) ||
+      !readValue(in, frame.resolution) ||
+      !readValue(in, frame.origin_x) || !readValue(in, frame.origin_y) ||
+      !readValue(in, tile_size) || !readValue(in, num_tiles) || tile_size == 0)
+    {
+      return false;
+    }
+    const uint64_t cells = static_cast<uint64_t>(size_x) * size_y;
+    if (num_tiles > cells) {
+      return false;
+    }
+    frame.tiles.resize(num_tiles);
+    if (!in.read(
+        reinterpret_cast<char *>(frame.tiles.data()), num_tiles * sizeof(uint32_t)) ||
+      !readValue(in, runs_size))
+    {
+      return false;
+    }
+    // a run takes two bytes at most for each cell
+    if (runs_size > 2 * cells) {
+      return false;
+    }
+    frame.keyframe = keyframe != 0;
+    frame.size_x = size_x;
+    frame.size_y = size_y;
+    frame.tile_size = tile_size;
+    frame.runs.resize(runs_size);
+    if (!in.read(reinterpret_cast<char *>(frame.runs.data()), runs_size)) {
+      return false;
+    }
+    read_frames.push_back(std::move(frame));
+  }
+  frames = std::move(read_frames);
+  return true;
+}
+
+bool CostmapRecorder::apply(const Frame & frame, Costmap2D & costmap)
+{
+  if (frame.keyframe) {
+    std::vector<unsigned char> costs(static_cast<std::size_t>(frame.size_x) * frame.size_y);
+    if (!decodeRunLength(frame.runs, costs.size(), costs.data())) {
+      return false;
+    }
+    costmap.resizeMap(
+      frame.size_x, frame.size_y, frame.resolution, frame.origin_x, frame.origin_y);
+    std::copy(costs.begin(), costs.end(), costmap.getCharMap());
+    costmap.markAllChanged();
+    return true;
+  }
+
+  if (frame.size_x != costmap.getSizeInCellsX() ||
+    frame.size_y != costmap.getSizeInCellsY())
+  {
+    return false;
+  }
+  const unsigned int num_tiles_x = (frame.size_x + frame.tile_size - 1) / frame.tile_size;
+  const unsigned int num_tiles_y = (frame.size_y + frame.tile_size - 1) / frame.tile_size;
+  std::size_t size = 0;
+  for (uint32_t tile : frame.tiles) {
+    if (tile >= num_tiles_x * num_tiles_y) {
+      return false;
+    }
+    unsigned int x0, y0, xn, yn;
+    tileBounds(tile, frame.tile_size, frame.size_x, frame.size_y, x0, y0, xn, yn);
+    size += static_cast<std::size_t>(xn - x0) * (yn - y0);
+  }
+  std::vector<unsigned char> costs(size);
+  if (!decodeRunLength(frame.runs, costs.size(), costs.data())) {
+    return false;
+  }
+
+  unsigned char * cells = costmap.getCharMap();
+  auto cost = costs.begin();
+  for (uint32_t tile : frame.tiles) {
+    unsigned int x0, y0, xn, yn;
+    tileBounds(tile, frame.tile_size, frame.size_x, frame.size_y, x0, y0, xn, yn);
+    for (unsigned int y = y0; y < yn; ++y) {
+      std::copy(cost, cost + (xn - x0), cells + static_cast<std::size_t>(y) * frame.size_x + x0);
+      cost += xn - x0;
+    }
+  }
+  costmap.markAllChanged();
+  return true;
+}
+
+}  // namespace nav2_costmap_2d
@@ -0,0 +1,78 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_costmap_2d/costmap_snapshot_registry.hpp"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace nav2_costmap_2d
+{
+
+namespace
+{
+
+std::mutex & registryMutex()
+{
+  static std::mutex mutex;
+  return mutex;
+}
+
+std::map<std::string, CostmapSnapshotRegistry::Source> & registrySources()
+{
+  static std::map<std::string, CostmapSnapshotRegistry::Source> sources;
+  return sources;
+}
+
+}  // namespace
+
+void CostmapSnapshotRegistry::add(const std::string & topic, Source source)
+{
+  std::lock_guard<std::mutex> lock(registryMutex());
+  registrySources()[topic] = source;
+}
+
+void CostmapSnapshotRegistry::remove(const std::string & topic)
+{
+  std::lock_guard<std::mutex> lock(registryMutex());
+  registrySources().erase(topic);
+}
+
+std::shared_ptr<const Costmap2D> CostmapSnapshotRegistry::get(const std::string & topic)
+{
+  // Sources are called with the lock held, so that they cannot be removed and
+  // destroyed while in use
+  std::lock_guard<std::mutex> lock(registryMutex());
+  auto it = registrySources().find(topic);
+  if (it == registrySources().end()) {
+    return nullptr;
+  }
+  return it->second();
+}
+
+std::string CostmapSnapshotRegistry::qualify(
+  const std::string & node_namespace, const std::string & topic)
+{
+  if (!topic.empty() && topic[0] == '/') {
+    return topic;
+  }
+  if (node_namespace.empty() || node_namespace.back() != '/') {
+    return node_namespace + "/" + topic;
+  }
+  return node_namespace + topic;
+}
+
+}  // namespace nav2_costmap_2d
@@ -12,10 +12,15 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
 #include <string>
 #include <memory>
+#include <vector>
 
 #include "nav2_costmap_2d/costmap_subscriber.hpp"
+#include "nav2_costmap_2d/costmap_encoding.hpp"
+#include "nav2_costmap_2d/costmap_snapshot_registry.hpp"
+#include "nav2_util/node_utils.hpp"
 
 namespace nav2_costmap_2d
 {
@@ -46,12 +51,20 @@ CostmapSubscriber::CostmapSubscriber(
 : node_base_(node_base),
   node_topics_(node_topics),
   node_logging_(node_logging),
-  topic_name_(topic_name)
+  topic_name_(topic_name),
+  qualified_topic_name_(
+    CostmapSnapshotRegistry::qualify(node_base->get_namespace(), topic_name))
 {
   costmap_sub_ = rclcpp::create_subscription<nav2_msgs::msg::Costmap>(
     node_topics_, topic_name_,
     rclcpp::QoS(rclcpp::KeepLast(1)).transient_local().reliable(),
-    std::bind(&CostmapSubscriber::costmapCallback, this, std::placeholders::_1));
+    std::bind(&CostmapSubscriber::costmapCallback, this, std::placeholders::_1),
+    nav2_util::get_inter_process_subscription_options());
+  // Only sent by publishers in delta mode, patches the last full costmap
+  costmap_update_sub_ = rclcpp::create_subscription<nav2_msgs::msg::CostmapUpdate>(
+    node_topics_, topic_name_ + "_updates",
+    rclcpp::QoS(rclcpp::KeepLast(10)).reliable(),
+    std::bind(&CostmapSubscriber::costmapUpdateCallback, this, std::placeholders::_1));
 }
 
 std::shared_ptr<Costmap2D> CostmapSubscriber::getCostmap()
@@ -63,8 +76,22 @@ std::shared_ptr<Costmap2D> CostmapSubscriber::getCostmap()
   return costmap_;
 }
 
+std::shared_ptr<const Costmap2D> CostmapSubscriber::getCostmapView()
+{
+  auto snapshot = CostmapSnapshotRegistry::get(qualified_topic_name_);
+  if (snapshot) {
+    return snapshot;
+  }
+  return getCostmap();
+}
+
 void CostmapSubscriber::toCostmap2D()
 {
+  std::lock_guard<std::mutex> lock(costmap_msg_mutex_);
+  if (costmap_ != nullptr && costmap_msg_ == converted_msg_ && !costmap_msg_patched_) {
+    return;
+  }
+
   if (costmap_ == nullptr) {
     costmap_ = std::make_shared<Costmap2D>(
       costmap_msg_->metadata.size_x, costmap_msg_->metadata.size_y,
@@ -84,22 +111,88 @@ void CostmapSubscriber::toCostmap2D()
       costmap_msg_->metadata.origin.position.y);
   }
 
-  unsigned char * master_array = costmap_->getCharMap();
-  unsigned int index = 0;
-  for (unsigned int i = 0; i < costmap_msg_->metadata.size_x; ++i) {
-    for (unsigned int j = 0; j < costmap_msg_->metadata.size_y; ++j) {
-      master_array[index] = costmap_msg_->data[index];
-      ++index;
-    }
-  }
+  std::copy(costmap_msg_->data.begin(), costmap_msg_->data.end(), costmap_->getCharMap());
+  converted_msg_ = costmap_msg_;
+  costmap_msg_patched_ = false;
 }
 
 void CostmapSubscriber::costmapCallback(const nav2_msgs::msg::Costmap::SharedPtr msg)
 {
+  if (msg->encoding == nav2_msgs::msg::Costmap::ENCODING_RLE) {
+    std::vector<uint8_t> decoded(msg->metadata.size_x * msg->metadata.size_y);
+    if (!decodeRunLength(msg->data, decoded.size(), decoded.data())) {
+      RCLCPP_WARN(node_logging_->get_logger(), "Dropping malformed run length encoded costmap");
+      return;
+    }
+    msg->data.swap(decoded);
+    msg->encoding = nav2_msgs::msg::Costmap::ENCODING_RAW;
+  }
+
+  std::lock_guard<std::mutex> lock(costmap_msg_mutex_);
   costmap_msg_ = msg;
+  update_sequence_ = 0;
   if (!costmap_received_) {
     costmap_received_ = true;
   }
+
+  // The costmap and its updates come on two topics, so updates may come first
+  for (const auto & update : early_updates_) {
+    applyUpdate(*update);
+  }
+  early_updates_.clear();
+}
+
+void CostmapSubscriber::costmapUpdateCallback(
+  const nav2_msgs::msg::CostmapUpdate::SharedPtr msg)
+{
+  if (msg->encoding == nav2_msgs::msg::CostmapUpdate::ENCODING_RLE) {
+    std::vector<uint8_t> decoded(msg->size_x * msg->size_y);
+    if (!decodeRunLength(msg->data, decoded.size(), decoded.data())) {
+      RCLCPP_WARN(
+        node_logging_->get_logger(), "Dropping malformed run length encoded costmap update");
+      return;
+    }
+    msg->data.swap(decoded);
+    msg->encoding = nav2_msgs::msg::CostmapUpdate::ENCODING_RAW;
+  }
+
+  std::lock_guard<std::mutex> lock(costmap_msg_mutex_);
+  // Keep updates to a newer costmap than the last one until it comes, as many as
+  // the update queue holds
+  if (!costmap_received_ ||
+    static_cast<int32_t>(msg->base_sequence - costmap_msg_->sequence) > 0)
+  {
+    if (early_updates_.size() < 10) {
+      early_updates_.push_back(msg);
+    }
+    return;
+  }
+  applyUpdate(*msg);
+}
+
+void CostmapSubscriber::applyUpdate(const nav2_msgs::msg::CostmapUpdate & msg)
+{
+  // Updates are relative to a full costmap and to the updates before them, drop the
+  // ones that do not follow the last one. The costmap stays as it is until the next
+  // full one, which the publisher sends to new subscribers.
+  if (msg.base_sequence != costmap_msg_->sequence || msg.sequence != update_sequence_ + 1 ||
+    msg.x + msg.size_x > costmap_msg_->metadata.size_x ||
+    msg.y + msg.size_y > costmap_msg_->metadata.size_y ||
+    msg.data.size() != msg.size_x * msg.size_y)
+  {
+    RCLCPP_DEBUG(
+      node_logging_->get_logger(), "Dropping costmap update not matching the costmap");
+    return;
+  }
+
+  auto in = msg.data.begin();
+  for (unsigned int y = 0; y < msg.size_y; ++y) {
+    auto out = costmap_msg_->data.begin() + (msg.y + y) * costmap_msg_->metadata.size_x + msg.x;
+    std::copy(in, in + msg.size_x, out);
+    in += msg.size_x;
+  }
+  update_sequence_ = msg.sequence;
+  costmap_msg_patched_ = true;
 }
 
 }  // namespace nav2_costmap_2d
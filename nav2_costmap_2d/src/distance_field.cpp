@@ -0,0 +1,132 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_costmap_2d/distance_field.hpp"
+
+#include <algorithm>
+#include <vector>
+
+#include "nav2_costmap_2d/cost_values.hpp"
+
+namespace nav2_costmap_2d
+{
+
+constexpr uint32_t DistanceField::NO_OBSTACLE;
+
+// Lines handed to a thread at a time, to keep the scheduling cost small
+static const unsigned int LINES_PER_TASK = 16;
+
+DistanceField::DistanceField(unsigned int num_threads)
+: size_x_(0), size_y_(0), resolution_(0.0)
+{
+  if (num_threads != 1) {
+    pool_ = std::make_unique<nav2_util::ThreadPool>(num_threads);
+  }
+}
+
+void DistanceField::update(const Costmap2D & costmap)
+{
+  size_x_ = costmap.getSizeInCellsX();
+  size_y_ = costmap.getSizeInCellsY();
+  resolution_ = costmap.getResolution();
+
+  const unsigned char * costs = costmap.getCharMap();
+  const unsigned int size = size_x_ * size_y_;
+  squared_distances_.resize(size);
+  for (unsigned int i = 0; i < size; ++i) {
+    squared_distances_[i] = costs[i] == LETHAL_OBSTACLE ? 0 : NO_OBSTACLE;
+  }
+
+  uint32_t * data = squared_distances_.data();
+  const unsigned int size_x = size_x_, size_y = size_y_;
+  auto columns = [data, size_x, size_y](std::size_t task) {
+      unsigned int end = std::min<unsigned int>((task + 1) * LINES_PER_TASK, size_x);
+      for (unsigned int x = task * LINES_PER_TASK; x < end; ++x) {
+        transform(data + x, size_y, size_x);
+      }
+    };
+  auto rows = [data, size_x, size_y](std::size_t task) {
+      unsigned int end = std::min<unsigned int>((task + 1) * LINES_PER_TASK, size_y);
+      for (unsigned int y = task * LINES_PER_TASK; y < end; ++y) {
+        transform(data + y * size_x, size_x, 1);
+      }
+    };
+
+  const std::size_t column_tasks = (size_x + LINES_PER_TASK - 1) / LINES_PER_TASK;
+  const std::size_t row_tasks = (size_y + LINES_PER_TASK - 1) / LINES_PER_TASK;
+  if (pool_) {
+    pool_->parallel_for(column_tasks, columns);
+    pool_->parallel_for(row_tasks, rows);
+  } else {
+    for (std::size_t task = 0; task < column_tasks; ++task) {
+      columns(task);
+    }
+    for (std::size_t task = 0; task < row_tasks; ++task) {
+      rows(task);
+    }
+  }
+}
+
+void DistanceField::transform(uint32_t * f, unsigned int n, unsigned int stride)
+{
+  thread_local std::vector<uint32_t> samples;
+  thread_local std::vector<unsigned int> v;
+  thread_local std::vector<double> z;
+  samples.resize(n);
+  v.resize(n);
+  z.resize(n + 1);
+
+  for (unsigned int q = 0; q < n; ++q) {
+    samples[q] = f[q * stride];
+  }
+
+  // Lower envelope of the parabolas rooted at the samples that have an
+  // obstacle, the others contribute nothing
+  int k = -1;
+  for (unsigned int q = 0; q < n; ++q) {
+    if (samples[q] == NO_OBSTACLE) {
+      continue;
+    }
+    const double fq = static_cast<double>(samples[q]) + static_cast<double>(q) * q;
+    double s = -std::numeric_limits<double>::infinity();
+    while (k >= 0) {
+      const unsigned int p = v[k];
+      s = (fq - (static_cast<double>(samples[p]) + static_cast<double>(p) * p)) /
+        (2.0 * q - 2.0 * p);
+      if (s > z[k]) {
+        break;
+      }
+      --k;
+    }
+    ++k;
+    v[k] = q;
+    z[k] = k == 0 ? -std::numeric_limits<double>::infinity() : s;
+    z[k + 1] = std::numeric_limits<double>::infinity();
+  }
+
+  if (k < 0) {
+    return;  // nothing to measure from, everything stays NO_OBSTACLE
+  }
+
+  int j = 0;
+  for (unsigned int q = 0; q < n; ++q) {
+    while (z[j + 1] < q) {
+      ++j;
+    }
+    const int64_t d = static_cast<int64_t>(q) - v[j];
+    f[q * stride] = static_cast<uint32_t>(d * d + samples[v[j]]);
+  }
+}
+
+}  // namespace nav2_costmap_2d
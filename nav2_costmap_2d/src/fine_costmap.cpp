@@ -0,0 +1,106 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_costmap_2d/fine_costmap.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "nav2_costmap_2d/cost_values.hpp"
+
+namespace nav2_costmap_2d
+{
+
+constexpr uint16_t FineCostmap::FINE_COST_SCALE;
+
+FineCostmap::FineCostmap()
+: dirty_(true), size_x_(0), size_y_(0), resolution_(0.0), origin_x_(0.0), origin_y_(0.0),
+  inscribed_radius_(0.0), cost_scaling_factor_(0.0), inflation_radius_(0.0)
+{
+}
+
+void FineCostmap::setInflation(
+  double inscribed_radius, double cost_scaling_factor, double inflation_radius)
+{
+  if (inscribed_radius != inscribed_radius_ || cost_scaling_factor != cost_scaling_factor_ ||
+    inflation_radius != inflation_radius_)
+  {
+    inscribed_radius_ = inscribed_radius;
+    cost_scaling_factor_ = cost_scaling_factor;
+    inflation_radius_ = inflation_radius;
+    dirty_ = true;
+  }
+}
+
+void FineCostmap::update(
+  const Costmap2D & costmap, const DistanceField * distances,
+  int x0, int y0, int xn, int yn)
+{
+  // the inflation layer inflates up to a whole number of cells
+  const int cell_inflation_radius =
+    static_cast<int>(std::max(0.0, std::ceil(inflation_radius_ / costmap.getResolution())));
+  if (dirty_ || costmap.getSizeInCellsX() != size_x_ ||
+    costmap.getSizeInCellsY() != size_y_ || costmap.getResolution() != resolution_ ||
+    costmap.getOriginX() != origin_x_ || costmap.getOriginY() != origin_y_)
+  {
+    size_x_ = costmap.getSizeInCellsX();
+    size_y_ = costmap.getSizeInCellsY();
+    resolution_ = costmap.getResolution();
+    origin_x_ = costmap.getOriginX();
+    origin_y_ = costmap.getOriginY();
+    costs_.assign(size_x_ * size_y_, toFineCost(NO_INFORMATION));
+    dirty_ = false;
+    x0 = 0;
+    y0 = 0;
+    xn = size_x_;
+    yn = size_y_;
+  } else {
+    // a lethal cell changed in the area moves the decay of the cells around it
+    const int margin = cell_inflation_radius;
+    x0 -= margin;
+    y0 -= margin;
+    xn += margin;
+    yn += margin;
+  }
+  x0 = std::max(x0, 0);
+  y0 = std::max(y0, 0);
+  xn = std::min(xn, static_cast<int>(size_x_));
+  yn = std::min(yn, static_cast<int>(size_y_));
+
+  const double max_distance = cell_inflation_radius * costmap.getResolution();
+  const bool inflate = distances != nullptr && cell_inflation_radius > 0 &&
+    distances->getSizeInCellsX() == size_x_ && distances->getSizeInCellsY() == size_y_;
+  const unsigned char * costs = costmap.getCharMap();
+  // the cost the 8 bit grid truncates to INSCRIBED_INFLATED_OBSTACLE - 1 at most
+  const double max_decay = static_cast<double>(INSCRIBED_INFLATED_OBSTACLE - 1) * FINE_COST_SCALE;
+  for (int y = y0; y < yn; ++y) {
+    const unsigned char * row = costs + y * size_x_;
+    uint16_t * out = costs_.data() + y * size_x_;
+    for (int x = x0; x < xn; ++x) {
+      const unsigned char cost = row[x];
+      uint16_t fine_cost = toFineCost(cost);
+      if (inflate && cost < INSCRIBED_INFLATED_OBSTACLE) {
+        const double distance = distances->getDistance(x, y);
+        if (distance > inscribed_radius_ && distance <= max_distance) {
+          const double decay =
+            max_decay * std::exp(-cost_scaling_factor_ * (distance - inscribed_radius_));
+          fine_cost = std::max(fine_cost, static_cast<uint16_t>(decay));
+        }
+      }
+      out[x] = fine_cost;
+    }
+  }
+}
+
+}  // namespace nav2_costmap_2d
@@ -29,13 +29,16 @@
 #include "nav2_costmap_2d/footprint.hpp"
 
 #include <algorithm>
+#include <cmath>
 #include <limits>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "geometry_msgs/msg/point32.hpp"
 #include "nav2_costmap_2d/array_parser.hpp"
 #include "nav2_costmap_2d/costmap_math.hpp"
+#include "nav2_util/line_iterator.hpp"
 
 namespace nav2_costmap_2d
 {
@@ -111,15 +114,15 @@ void transformFootprint(
   const std::vector<geometry_msgs::msg::Point> & footprint_spec,
   std::vector<geometry_msgs::msg::Point> & oriented_footprint)
 {
-  // build the oriented footprint at a given location
-  oriented_footprint.clear();
+  // build the oriented footprint at a given location, in place to keep the storage
+  oriented_footprint.resize(footprint_spec.size());
   double cos_th = cos(theta);
   double sin_th = sin(theta);
   for (unsigned int i = 0; i < footprint_spec.size(); ++i) {
-    geometry_msgs::msg::Point new_pt;
+    geometry_msgs::msg::Point & new_pt = oriented_footprint[i];
     new_pt.x = x + (footprint_spec[i].x * cos_th - footprint_spec[i].y * sin_th);
     new_pt.y = y + (footprint_spec[i].x * sin_th + footprint_spec[i].y * cos_th);
-    oriented_footprint.push_back(new_pt);
+    new_pt.z = 0.0;
   }
 }
 
@@ -128,15 +131,15 @@ void transformFootprint(
   const std::vector<geometry_msgs::msg::Point> & footprint_spec,
   geometry_msgs::msg::PolygonStamped & oriented_footprint)
 {
-  // build the oriented footprint at a given location
-  oriented_footprint.polygon.points.clear();
+  // build the oriented footprint at a given location, in place to keep the storage
+  oriented_footprint.polygon.points.resize(footprint_spec.size());
   double cos_th = cos(theta);
   double sin_th = sin(theta);
   for (unsigned int i = 0; i < footprint_spec.size(); ++i) {
-    geometry_msgs::msg::Point32 new_pt;
+    geometry_msgs::msg::Point32 & new_pt = oriented_footprint.polygon.points[i];
     new_pt.x = x + (footprint_spec[i].x * cos_th - footprint_spec[i].y * sin_th);
     new_pt.y = y + (footprint_spec[i].x * sin_th + footprint_spec[i].y * cos_th);
-    oriented_footprint.polygon.points.push_back(new_pt);
+    new_pt.z = 0.0;
   }
 }
 
@@ -216,4 +219,257 @@ bool makeFootprintFromString(
   return true;
 }
 
+FootprintMask::FootprintMask(unsigned int num_headings, unsigned int cached_footprints)
+: num_headings_(std::max(1u, num_headings)),
+  resolution_(0.0),
+  cached_footprints_(cached_footprints)
+{
+}
+
+void FootprintMask::setFootprint(
+  const std::vector<geometry_msgs::msg::Point> & footprint_spec,
+  double resolution)
+{
+  if (resolution == resolution_ && footprint_spec == footprint_spec_) {
+    return;
+  }
+
+  // keep the current outline for when the footprint switches back to it
+  if (!headings_.empty() && cached_footprints_ > 0) {
+    rasterizations_.push_front(
+      Rasterization{std::move(footprint_spec_), resolution_, std::move(headings_)});
+  }
+  footprint_spec_ = footprint_spec;
+  resolution_ = resolution;
+  headings_.clear();
+
+  for (auto it = rasterizations_.begin(); it != rasterizations_.end(); ++it) {
+    if (it->resolution == resolution && it->footprint_spec == footprint_spec) {
+      headings_ = std::move(it->headings);
+      rasterizations_.erase(it);
+      return;
+    }
+  }
+  while (rasterizations_.size() > cached_footprints_) {
+    rasterizations_.pop_back();
+  }
+  if (footprint_spec.empty() || resolution <= 0.0) {
+    return;
+  }
+
+  headings_.resize(num_headings_);
+  std::vector<std::pair<int, int>> cells;
+  std::vector<std::pair<int, int>> vertices(footprint_spec.size());
+  for (unsigned int h = 0; h < num_headings_; ++h) {
+    double theta = 2.0 * M_PI * h / num_headings_;
+    double cos_th = cos(theta);
+    double sin_th = sin(theta);
+    for (unsigned int i = 0; i < footprint_spec.size(); ++i) {
+      // offsets in cells of the vertex from a pose at the center of a cell
+      double x = footprint_spec[i].x * cos_th - footprint_spec[i].y * sin_th;
+      double y = footprint_spec[i].x * sin_th + footprint_spec[i].y * cos_th;
+      vertices[i].first = static_cast<int>(std::floor(x / resolution + 0.5));
+      vertices[i].second = static_cast<int>(std::floor(y / resolution + 0.5));
+    }
+
+    cells.clear();
+    for (unsigned int i = 0; i < vertices.size(); ++i) {
+      const std::pair<int, int> & start = vertices[i];
+      const std::pair<int, int> & end = vertices[(i + 1) % vertices.size()];
+      for (nav2_util::LineIterator line(start.first, start.second, end.first, end.second);
+        line.isValid(); line.advance())
+      {
+        cells.emplace_back(line.getY(), line.getX());
+      }
+    }
+
+    // merge the cells of each row into runs
+    std::sort(cells.begin(), cells.end());
+    cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+    Heading & heading = headings_[h];
+    heading.min_dx = heading.min_dy = std::numeric_limits<int>::max();
+    heading.max_dx = heading.max_dy = std::numeric_limits<int>::min();
+    for (const std::pair<int, int> & cell : cells) {
+      if (heading.spans.empty() || heading.spans.back().dy != cell.first ||
+        heading.spans.back().dx1 + 1 != cell.second)
+      {
+        heading.spans.push_back(Span{cell.first, cell.second, cell.second});
+      } else {
+        heading.spans.back().dx1 = cell.second;
+      }
+      heading.min_dx = std::min(heading.min_dx, cell.second);
+      heading.max_dx = std::max(heading.max_dx, cell.second);
+      heading.min_dy = std::min(heading.min_dy, cell.first);
+      heading.max_dy = std::max(heading.max_dy, cell.first);
+    }
+  }
+}
+
+const FootprintMask::Heading * FootprintMask::headingAtPose(
+  const Costmap2D & costmap, double x, double y, double theta, int & mx, int & my) const
+{
+  if (headings_.empty()) {
+    return nullptr;
+  }
+
+  unsigned int cell_x, cell_y;
+  if (!costmap.worldToMap(x, y, cell_x, cell_y)) {
+    return nullptr;
+  }
+  mx = cell_x;
+  my = cell_y;
+
+  double turns = theta / (2.0 * M_PI);
+  int h = static_cast<int>(std::floor((turns - std::floor(turns)) * num_headings_ + 0.5));
+  const Heading & heading = headings_[h % num_headings_];
+
+  // one bounds check for the whole footprint
+  if (mx + heading.min_dx < 0 || my + heading.min_dy < 0 ||
+    mx + heading.max_dx >= static_cast<int>(costmap.getSizeInCellsX()) ||
+    my + heading.max_dy >= static_cast<int>(costmap.getSizeInCellsY()))
+  {
+    return nullptr;
+  }
+  return &heading;
+}
+
+double FootprintMask::footprintCostAtPose(
+  const Costmap2D & costmap, double x, double y, double theta) const
+{
+  int mx, my;
+  const Heading * heading = headingAtPose(costmap, x, y, theta, mx, my);
+  if (heading == nullptr) {
+    return -1.0;
+  }
+
+  const unsigned char * grid = costmap.getCharMap();
+  const unsigned int size_x = costmap.getSizeInCellsX();
+  unsigned char cost = 0;
+  for (const Span & span : heading->spans) {
+    // a plain max reduction over the row, which the compiler vectorizes
+    const unsigned char * row = grid + (my + span.dy) * size_x + mx;
+    for (int dx = span.dx0; dx <= span.dx1; ++dx) {
+      cost = std::max(cost, row[dx]);
+    }
+  }
+  return cost;
+}
+
+double FootprintMask::trajectoryFootprintCost(
+  const Costmap2D & costmap,
+  const std::vector<geometry_msgs::msg::Pose2D> & poses,
+  unsigned char stop_cost) const
+{
+  const unsigned char * grid = costmap.getCharMap();
+  const unsigned int size_x = costmap.getSizeInCellsX();
+  unsigned char cost = 0;
+  const Heading * last_heading = nullptr;
+  int last_mx = 0, last_my = 0;
+  for (const geometry_msgs::msg::Pose2D & pose : poses) {
+    int mx, my;
+    const Heading * heading = headingAtPose(costmap, pose.x, pose.y, pose.theta, mx, my);
+    if (heading == nullptr) {
+      return -1.0;
+    }
+    // the same heading in the same cell lays down the same outline
+    if (heading == last_heading && mx == last_mx && my == last_my) {
+      continue;
+    }
+    last_heading = heading;
+    last_mx = mx;
+    last_my = my;
+
+    for (const Span & span : heading->spans) {
+      const unsigned char * row = grid + (my + span.dy) * size_x + mx;
+      for (int dx = span.dx0; dx <= span.dx1; ++dx) {
+        cost = std::max(cost, row[dx]);
+      }
+      if (cost >= stop_cost) {
+        return cost;
+      }
+    }
+  }
+  return cost;
+}
+
+double FootprintMask::sweptFootprintCost(
+  const Costmap2D & costmap, double x, double y, double theta, double angle,
+  unsigned char stop_cost) const
+{
+  if (headings_.empty()) {
+    return -1.0;
+  }
+
+  // the outline in polar coordinates, sampled twice a cell, sorted by radius
+  std::vector<std::pair<double, double>> samples;
+  double max_radius = 0.0;
+  for (unsigned int i = 0; i < footprint_spec_.size(); ++i) {
+    const geometry_msgs::msg::Point & start = footprint_spec_[i];
+    const geometry_msgs::msg::Point & end = footprint_spec_[(i + 1) % footprint_spec_.size()];
+    double length = std::hypot(end.x - start.x, end.y - start.y);
+    int steps = std::max(1, static_cast<int>(std::ceil(2.0 * length / resolution_)));
+    for (int step = 0; step < steps; ++step) {
+      double t = static_cast<double>(step) / steps;
+      double px = start.x + t * (end.x - start.x);
+      double py = start.y + t * (end.y - start.y);
+      samples.emplace_back(std::hypot(px, py), std::atan2(py, px));
+      max_radius = std::max(max_radius, samples.back().first);
+    }
+  }
+  std::sort(samples.begin(), samples.end());
+
+  // a cell is swept if a sample turns to within this of its center, which covers the
+  // rounding of the vertices and the lines of the rasterized outline
+  const double tolerance = 1.5 * resolution_;
+  const int reach = static_cast<int>(std::ceil((max_radius + tolerance) / resolution_));
+
+  unsigned int cell_x, cell_y;
+  if (!costmap.worldToMap(x, y, cell_x, cell_y)) {
+    return -1.0;
+  }
+  const int mx = cell_x;
+  const int my = cell_y;
+  if (mx - reach < 0 || my - reach < 0 ||
+    mx + reach >= static_cast<int>(costmap.getSizeInCellsX()) ||
+    my + reach >= static_cast<int>(costmap.getSizeInCellsY()))
+  {
+    return -1.0;
+  }
+
+  // turned counterclockwise from the start of the sector
+  const double sweep = std::min(std::abs(angle), 2.0 * M_PI);
+  const double sweep_start = angle < 0.0 ? theta + angle : theta;
+
+  const unsigned char * grid = costmap.getCharMap();
+  const unsigned int size_x = costmap.getSizeInCellsX();
+  unsigned char cost = 0;
+  for (int dy = -reach; dy <= reach; ++dy) {
+    const unsigned char * row = grid + (my + dy) * size_x + mx;
+    for (int dx = -reach; dx <= reach; ++dx) {
+      if (row[dx] <= cost) {
+        continue;
+      }
+
+      double radius = std::hypot(dx, dy) * resolution_;
+      double margin = radius > tolerance ? std::asin(tolerance / radius) : M_PI;
+      double bearing = std::atan2(dy, dx);
+      auto sample = std::lower_bound(
+        samples.begin(), samples.end(), std::make_pair(radius - tolerance, -M_PI));
+      for (; sample != samples.end() && sample->first <= radius + tolerance; ++sample) {
+        // the turn bringing the sample onto the cell, from the start of the padded sector
+        double turn = bearing - sample->second - sweep_start + margin;
+        turn -= 2.0 * M_PI * std::floor(turn / (2.0 * M_PI));
+        if (turn <= sweep + 2.0 * margin) {
+          cost = row[dx];
+          break;
+        }
+      }
+      if (cost >= stop_cost) {
+        return cost;
+      }
+    }
+  }
+  return cost;
+}
+
 }  // end namespace nav2_costmap_2d
@@ -17,6 +17,7 @@
 #include <memory>
 
 #include "nav2_costmap_2d/footprint_subscriber.hpp"
+#include "nav2_util/node_utils.hpp"
 
 namespace nav2_costmap_2d
 {
@@ -60,7 +61,8 @@ FootprintSubscriber::FootprintSubscriber(
   footprint_sub_ = rclcpp::create_subscription<geometry_msgs::msg::PolygonStamped>(
     node_topics_,
     topic_name, rclcpp::SystemDefaultsQoS(),
-    std::bind(&FootprintSubscriber::footprint_callback, this, std::placeholders::_1));
+    std::bind(&FootprintSubscriber::footprint_callback, this, std::placeholders::_1),
+    nav2_util::get_inter_process_subscription_options());
 }
 
 bool
@@ -100,6 +102,24 @@ FootprintSubscriber::getFootprint(
   return getFootprint(footprint, footprint_timeout_);
 }
 
+bool
+FootprintSubscriber::getFootprintMsg(
+  geometry_msgs::msg::PolygonStamped::ConstSharedPtr & footprint)
+{
+  if (!footprint_received_) {
+    return false;
+  }
+
+  geometry_msgs::msg::PolygonStamped::ConstSharedPtr msg = footprint_;
+  rclcpp::Time now = node_clock_->get_clock()->now();
+  if (now - msg->header.stamp > footprint_timeout_) {
+    return false;
+  }
+
+  footprint = msg;
+  return true;
+}
+
 void
 FootprintSubscriber::footprint_callback(const geometry_msgs::msg::PolygonStamped::SharedPtr msg)
 {
@@ -39,11 +39,14 @@
 
 #include <algorithm>
 #include <cstdio>
+#include <cstdlib>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "nav2_costmap_2d/footprint.hpp"
+#include "nav2_util/execution_timer.hpp"
 
 
 using std::vector;
@@ -66,8 +69,10 @@ LayeredCostmap::LayeredCostmap(std::string global_frame, bool rolling_window, bo
   byn_(0),
   initialized_(false),
   size_locked_(false),
+  window_valid_(false),
   circumscribed_radius_(1.0),
-  inscribed_radius_(0.1)
+  inscribed_radius_(0.1),
+  tile_size_(0)
 {
   if (track_unknown) {
     costmap_.setDefaultValue(255);
@@ -91,6 +96,7 @@ void LayeredCostmap::resizeMap(
 {
   std::unique_lock<Costmap2D::mutex_t> lock(*(costmap_.getMutex()));
   size_locked_ = size_locked;
+  window_valid_ = false;
   costmap_.resizeMap(size_x, size_y, resolution, origin_x, origin_y);
   for (vector<std::shared_ptr<Layer>>::iterator plugin = plugins_.begin();
     plugin != plugins_.end(); ++plugin)
@@ -99,6 +105,51 @@ void LayeredCostmap::resizeMap(
   }
 }
 
+std::shared_future<void> LayeredCostmap::requestClear(std::function<void()> clear)
+{
+  std::promise<void> done;
+  std::shared_future<void> applied = done.get_future().share();
+  {
+    std::lock_guard<std::mutex> lock(clear_requests_mutex_);
+    clear_requests_.emplace_back(std::move(clear), std::move(done));
+  }
+  requestUpdate();
+  if (clear_request_callback_) {
+    clear_request_callback_();
+  }
+  return applied;
+}
+
+void LayeredCostmap::requestUpdate()
+{
+  if (update_request_callback_) {
+    update_request_callback_();
+  }
+}
+
+void LayeredCostmap::setUpdateRequestCallback(std::function<void()> callback)
+{
+  update_request_callback_ = std::move(callback);
+}
+
+void LayeredCostmap::setClearRequestCallback(std::function<void()> callback)
+{
+  clear_request_callback_ = std::move(callback);
+}
+
+void LayeredCostmap::runClearRequests(std::vector<std::promise<void>> & done)
+{
+  std::vector<std::pair<std::function<void()>, std::promise<void>>> clears;
+  {
+    std::lock_guard<std::mutex> lock(clear_requests_mutex_);
+    clears.swap(clear_requests_);
+  }
+  for (auto & clear : clears) {
+    clear.first();
+    done.push_back(std::move(clear.second));
+  }
+}
+
 bool LayeredCostmap::isOutofBounds(double robot_x, double robot_y)
 {
   unsigned int mx, my;
@@ -107,16 +158,88 @@ bool LayeredCostmap::isOutofBounds(double robot_x, double robot_y)
 
 void LayeredCostmap::updateMap(double robot_x, double robot_y, double robot_yaw)
 {
+  nav2_util::ExecutionTimer timer;
+  timer.start();
+
   // Lock for the remainder of this function, some plugins (e.g. VoxelLayer)
   // implement thread unsafe updateBounds() functions.
   std::unique_lock<Costmap2D::mutex_t> lock(*(costmap_.getMutex()));
 
+  if (statistics_) {
+    timer.end();
+    if (statistics_->getLayerNames().size() != plugins_.size()) {
+      std::vector<std::string> names;
+      for (auto & plugin : plugins_) {
+        names.push_back(plugin->getName());
+      }
+      statistics_->setLayers(names);
+    }
+    statistics_->beginUpdate();
+    statistics_->addLockWait(timer.elapsed_time_in_seconds());
+  }
+
+  // The clears run now are done once the master grid has them, however this returns
+  struct ClearsDone
+  {
+    std::vector<std::promise<void>> promises;
+    ~ClearsDone()
+    {
+      for (auto & promise : promises) {
+        promise.set_value();
+      }
+    }
+  } clears_done;
+  runClearRequests(clears_done.promises);
+
   // if we're using a rolling buffer costmap...
   // we need to update the origin using the robot's position
+  int areas[3][4];
+  int num_areas = 0;
+  bool whole_window = false;
   if (rolling_window_) {
     double new_origin_x = robot_x - costmap_.getSizeInMetersX() / 2;
     double new_origin_y = robot_y - costmap_.getSizeInMetersY() / 2;
+
+    // The composite is shifted along with the window, so only the cells
+    // scrolling into it need to be recomputed besides the bounds the layers
+    // ask for. This is what lets layers with unchanged data, like the static
+    // map, skip reporting the whole window on every cycle.
+    int size_x = static_cast<int>(costmap_.getSizeInCellsX());
+    int size_y = static_cast<int>(costmap_.getSizeInCellsY());
+    int cell_ox = static_cast<int>(
+      (new_origin_x - costmap_.getOriginX()) / costmap_.getResolution());
+    int cell_oy = static_cast<int>(
+      (new_origin_y - costmap_.getOriginY()) / costmap_.getResolution());
     costmap_.updateOrigin(new_origin_x, new_origin_y);
+
+    whole_window = !window_valid_ || std::abs(cell_ox) >= size_x || std::abs(cell_oy) >= size_y;
+    if (whole_window) {
+      int * area = areas[num_areas++];
+      area[0] = 0;
+      area[1] = 0;
+      area[2] = size_x;
+      area[3] = size_y;
+    } else {
+      // the columns coming in first, then the rows coming in beside them
+      int x0 = 0, xn = size_x;
+      if (cell_ox != 0) {
+        int * area = areas[num_areas++];
+        area[0] = cell_ox > 0 ? size_x - cell_ox : 0;
+        area[1] = 0;
+        area[2] = cell_ox > 0 ? size_x : -cell_ox;
+        area[3] = size_y;
+        x0 = cell_ox > 0 ? 0 : -cell_ox;
+        xn = cell_ox > 0 ? size_x - cell_ox : size_x;
+      }
+      if (cell_oy != 0) {
+        int * area = areas[num_areas++];
+        area[0] = x0;
+        area[1] = cell_oy > 0 ? size_y - cell_oy : 0;
+        area[2] = xn;
+        area[3] = cell_oy > 0 ? size_y : -cell_oy;
+      }
+    }
+    window_valid_ = true;
   }
 
   if (isOutofBounds(robot_x, robot_y)) {
@@ -126,6 +249,9 @@ void LayeredCostmap::updateMap(double robot_x, double robot_y, double robot_yaw)
   }
 
   if (plugins_.size() == 0) {
+    if (statistics_) {
+      statistics_->endUpdate();
+    }
     return;
   }
 
@@ -139,7 +265,12 @@ void LayeredCostmap::updateMap(double robot_x, double robot_y, double robot_yaw)
     double prev_miny = miny_;
     double prev_maxx = maxx_;
     double prev_maxy = maxy_;
+    timer.start();
     (*plugin)->updateBounds(robot_x, robot_y, robot_yaw, &minx_, &miny_, &maxx_, &maxy_);
+    if (statistics_) {
+      timer.end();
+      statistics_->addBoundsTime(plugin - plugins_.begin(), timer.elapsed_time_in_seconds());
+    }
     if (minx_ > prev_minx || miny_ > prev_miny || maxx_ < prev_maxx || maxy_ < prev_maxy) {
       RCLCPP_WARN(
         rclcpp::get_logger(
@@ -164,15 +295,32 @@ void LayeredCostmap::updateMap(double robot_x, double robot_y, double robot_yaw)
     rclcpp::get_logger(
       "nav2_costmap_2d"), "Updating area x: [%d, %d] y: [%d, %d]", x0, xn, y0, yn);
 
-  if (xn < x0 || yn < y0) {
+  if (xn >= x0 && yn >= y0 && !whole_window) {
+    areas[num_areas][0] = x0;
+    areas[num_areas][1] = y0;
+    areas[num_areas][2] = xn;
+    areas[num_areas][3] = yn;
+    num_areas++;
+  }
+  if (num_areas == 0) {
+    if (statistics_) {
+      statistics_->endUpdate();
+    }
     return;
   }
 
-  costmap_.resetMap(x0, y0, xn, yn);
-  for (vector<std::shared_ptr<Layer>>::iterator plugin = plugins_.begin();
-    plugin != plugins_.end(); ++plugin)
-  {
-    (*plugin)->updateCosts(costmap_, x0, y0, xn, yn);
+  // The cells coming into a rolling window go first, so that the layer
+  // bounds, which hold this cycle's changes, are combined last
+  x0 = areas[0][0];
+  y0 = areas[0][1];
+  xn = areas[0][2];
+  yn = areas[0][3];
+  for (int i = 0; i < num_areas; ++i) {
+    updateArea(areas[i][0], areas[i][1], areas[i][2], areas[i][3]);
+    x0 = std::min(x0, areas[i][0]);
+    y0 = std::min(y0, areas[i][1]);
+    xn = std::max(xn, areas[i][2]);
+    yn = std::max(yn, areas[i][3]);
   }
 
   bx0_ = x0;
@@ -180,9 +328,157 @@ void LayeredCostmap::updateMap(double robot_x, double robot_y, double robot_yaw)
   by0_ = y0;
   byn_ = yn;
 
+  if (distance_field_) {
+    distance_field_->update(costmap_);
+  }
+  if (pyramid_) {
+    pyramid_->update(costmap_, x0, y0, xn, yn);
+  }
+  if (fine_costmap_) {
+    fine_costmap_->update(costmap_, distance_field_.get(), x0, y0, xn, yn);
+  }
+  if (statistics_) {
+    statistics_->endUpdate();
+  }
+
   initialized_ = true;
 }
 
+bool LayeredCostmap::getObstacleDistance(double wx, double wy, double & distance)
+{
+  std::unique_lock<Costmap2D::mutex_t> lock(*(costmap_.getMutex()));
+  unsigned int mx, my;
+  if (!distance_field_ || !costmap_.worldToMap(wx, wy, mx, my) ||
+    mx >= distance_field_->getSizeInCellsX() || my >= distance_field_->getSizeInCellsY())
+  {
+    return false;
+  }
+  distance = distance_field_->getDistance(mx, my);
+  return true;
+}
+
+void LayeredCostmap::updateArea(int x0, int y0, int xn, int yn)
+{
+  if (plugins_.empty() || !plugins_.front()->overwritesBounds()) {
+    costmap_.resetMap(x0, y0, xn, yn);
+  } else {
+    costmap_.markChanged(x0, y0, xn, yn);
+  }
+  if (statistics_) {
+    statistics_->addUpdatedCells(static_cast<double>(xn - x0) * (yn - y0));
+  }
+  if (tile_pool_) {
+    updateCostsTiled(x0, y0, xn, yn);
+  } else {
+    nav2_util::ExecutionTimer timer;
+    for (vector<std::shared_ptr<Layer>>::iterator plugin = plugins_.begin();
+      plugin != plugins_.end(); ++plugin)
+    {
+      timer.start();
+      (*plugin)->updateCosts(costmap_, x0, y0, xn, yn);
+      if (statistics_) {
+        timer.end();
+        statistics_->addCostsTime(plugin - plugins_.begin(), timer.elapsed_time_in_seconds());
+      }
+    }
+  }
+}
+
+void LayeredCostmap::setTiledUpdate(unsigned int tile_size, unsigned int num_threads)
+{
+  std::unique_lock<Costmap2D::mutex_t> lock(*(costmap_.getMutex()));
+  tile_size_ = tile_size;
+  if (tile_size_ == 0) {
+    tile_pool_.reset();
+  } else {
+    tile_pool_ = std::make_unique<nav2_util::ThreadPool>(num_threads);
+  }
+}
+
+void LayeredCostmap::enableStatistics(std::size_t window)
+{
+  std::unique_lock<Costmap2D::mutex_t> lock(*(costmap_.getMutex()));
+  if (window == 0) {
+    statistics_.reset();
+  } else {
+    statistics_ = std::make_unique<UpdateStatistics>(window);
+  }
+}
+
+void LayeredCostmap::setPyramidLevels(unsigned int num_levels)
+{
+  std::unique_lock<Costmap2D::mutex_t> lock(*(costmap_.getMutex()));
+  if (num_levels == 0) {
+    pyramid_.reset();
+  } else {
+    pyramid_ = std::make_unique<CostmapPyramid>(num_levels);
+    // build the levels from whatever the master grid holds already
+    pyramid_->update(costmap_, 0, 0, costmap_.getSizeInCellsX(), costmap_.getSizeInCellsY());
+  }
+}
+
+void LayeredCostmap::setFineCosts(bool enable)
+{
+  std::unique_lock<Costmap2D::mutex_t> lock(*(costmap_.getMutex()));
+  if (!enable) {
+    fine_costmap_.reset();
+    return;
+  }
+  if (!fine_costmap_) {
+    fine_costmap_ = std::make_unique<FineCostmap>();
+  }
+  if (!distance_field_) {
+    distance_field_ = std::make_shared<DistanceField>();
+    distance_field_->update(costmap_);
+  }
+  fine_costmap_->update(
+    costmap_, distance_field_.get(), 0, 0, costmap_.getSizeInCellsX(),
+    costmap_.getSizeInCellsY());
+}
+
+void LayeredCostmap::setFineCostInflation(
+  double inscribed_radius, double cost_scaling_factor, double inflation_radius)
+{
+  std::unique_lock<Costmap2D::mutex_t> lock(*(costmap_.getMutex()));
+  if (fine_costmap_) {
+    fine_costmap_->setInflation(inscribed_radius, cost_scaling_factor, inflation_radius);
+  }
+}
+
+void LayeredCostmap::updateCostsTiled(int x0, int y0, int xn, int yn)
+{
+  // Tiles only split the updateCosts() pass of a single layer. Layers still
+  // run one after another, since each one combines with the result of the last.
+  const int tile_size = static_cast<int>(tile_size_);
+  const int tiles_x = (xn - x0 + tile_size - 1) / tile_size;
+  const int tiles_y = (yn - y0 + tile_size - 1) / tile_size;
+  const std::size_t num_tiles = tiles_x * tiles_y;
+
+  nav2_util::ExecutionTimer timer;
+  for (vector<std::shared_ptr<Layer>>::iterator plugin = plugins_.begin();
+    plugin != plugins_.end(); ++plugin)
+  {
+    Layer * layer = plugin->get();
+    timer.start();
+    if (num_tiles <= 1 || !layer->supportsTiling()) {
+      layer->updateCosts(costmap_, x0, y0, xn, yn);
+    } else {
+      layer->prepareTiledUpdate(costmap_, x0, y0, xn, yn);
+      tile_pool_->parallel_for(
+        num_tiles, [&](std::size_t tile) {
+          int tx0 = x0 + static_cast<int>(tile % tiles_x) * tile_size;
+          int ty0 = y0 + static_cast<int>(tile / tiles_x) * tile_size;
+          layer->updateCostsTile(
+            costmap_, tx0, ty0, std::min(tx0 + tile_size, xn), std::min(ty0 + tile_size, yn));
+        });
+    }
+    if (statistics_) {
+      timer.end();
+      statistics_->addCostsTime(plugin - plugins_.begin(), timer.elapsed_time_in_seconds());
+    }
+  }
+}
+
 bool LayeredCostmap::isCurrent()
 {
   current_ = true;
@@ -196,6 +492,10 @@ bool LayeredCostmap::isCurrent()
 
 void LayeredCostmap::setFootprint(const std::vector<geometry_msgs::msg::Point> & footprint_spec)
 {
+  if (!footprint_spec.empty() && footprint_spec == footprint_) {
+    // republished unchanged, the layers have nothing to recompute
+    return;
+  }
   footprint_ = footprint_spec;
   nav2_costmap_2d::calculateMinAndMaxDistances(
     footprint_spec,
@@ -37,7 +37,11 @@
 #include "nav2_costmap_2d/observation_buffer.hpp"
 
 #include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <list>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -55,11 +59,38 @@ ObservationBuffer::ObservationBuffer(
 : tf2_buffer_(tf2_buffer),
   observation_keep_time_(rclcpp::Duration::from_seconds(observation_keep_time)),
   expected_update_rate_(rclcpp::Duration::from_seconds(expected_update_rate)), nh_(nh),
-  last_updated_(nh->now()), global_frame_(global_frame), sensor_frame_(sensor_frame),
+  last_updated_(nh->now()), last_updated_ns_(last_updated_.nanoseconds()),
+  global_frame_(global_frame), sensor_frame_(sensor_frame),
   topic_name_(topic_name),
   min_obstacle_height_(min_obstacle_height), max_obstacle_height_(max_obstacle_height),
   obstacle_range_(obstacle_range), raytrace_range_(raytrace_range), tf_tolerance_(tf_tolerance)
 {
+  publishView();
+}
+
+void ObservationBuffer::setDownsampling(
+  double resolution, double origin_x, double origin_y,
+  double z_resolution, double origin_z, double split_height)
+{
+  downsample_resolution_ = resolution;
+  downsample_origin_x_ = origin_x;
+  downsample_origin_y_ = origin_y;
+  downsample_z_resolution_ = z_resolution;
+  downsample_origin_z_ = origin_z;
+  downsample_split_height_ = split_height;
+}
+
+void ObservationBuffer::setRangeGating(bool marking, bool clearing)
+{
+  gate_obstacle_range_ = marking && !clearing;
+  gate_raytrace_range_ = clearing && !marking;
+}
+
+void ObservationBuffer::getReductionStatistics(
+  uint64_t & received_points, uint64_t & stored_points) const
+{
+  received_points = received_points_;
+  stored_points = stored_points_;
 }
 
 ObservationBuffer::~ObservationBuffer()
@@ -98,8 +129,11 @@ bool ObservationBuffer::setGlobalFrame(const std::string new_global_frame)
       tf2_buffer_.transform(origin, origin, new_global_frame);
       obs.origin_ = origin.point;
 
-      // we also need to transform the cloud of the observation to the new global frame
-      tf2_buffer_.transform(*(obs.cloud_), *(obs.cloud_), new_global_frame);
+      // we also need to transform the cloud of the observation to the new global frame,
+      // into a new one as views may still hold the old
+      auto cloud = std::make_shared<sensor_msgs::msg::PointCloud2>();
+      tf2_buffer_.transform(*(obs.cloud_), *cloud, new_global_frame);
+      obs.cloud_ = cloud;
     } catch (tf2::TransformException & ex) {
       RCLCPP_ERROR(
         rclcpp::get_logger(
@@ -112,29 +146,46 @@ bool ObservationBuffer::setGlobalFrame(const std::string new_global_frame)
 
   // now we need to update our global_frame member
   global_frame_ = new_global_frame;
+  publishView();
   return true;
 }
 
-void ObservationBuffer::bufferCloud(const sensor_msgs::msg::PointCloud2 & cloud)
+bool ObservationBuffer::beginObservation(
+  const std_msgs::msg::Header & header, tf2::Transform & transform,
+  const geometry_msgs::msg::Point * origin)
 {
   geometry_msgs::msg::PointStamped global_origin;
 
-  // create a new observation on the list to be populated
-  observation_list_.push_front(Observation());
+  // create a new observation on the list to be populated, reusing a purged one
+  // and the memory of its cloud when available
+  if (observation_pool_.empty()) {
+    observation_list_.push_front(Observation());
+  } else {
+    observation_list_.splice(
+      observation_list_.begin(), observation_pool_, observation_pool_.begin());
+    // a view still holding the cloud of a purged observation keeps it, and its memory
+    if (observation_list_.front().cloud_.use_count() > 1) {
+      observation_list_.front().cloud_ = std::make_shared<sensor_msgs::msg::PointCloud2>();
+    }
+  }
 
   // check whether the origin frame has been set explicitly
   // or whether we should get it from the cloud
-  std::string origin_frame = sensor_frame_ == "" ? cloud.header.frame_id : sensor_frame_;
+  std::string origin_frame = sensor_frame_ == "" ? header.frame_id : sensor_frame_;
 
   try {
     // given these observations come from sensors...
     // we'll need to store the origin pt of the sensor
     geometry_msgs::msg::PointStamped local_origin;
-    local_origin.header.stamp = cloud.header.stamp;
+    local_origin.header.stamp = header.stamp;
     local_origin.header.frame_id = origin_frame;
     local_origin.point.x = 0;
     local_origin.point.y = 0;
     local_origin.point.z = 0;
+    if (origin) {
+      local_origin.header.frame_id = header.frame_id;
+      local_origin.point = *origin;
+    }
     tf2_buffer_.transform(local_origin, global_origin, global_frame_);
     tf2::convert(global_origin.point, observation_list_.front().origin_);
 
@@ -143,79 +194,362 @@ void ObservationBuffer::bufferCloud(const sensor_msgs::msg::PointCloud2 & cloud)
     observation_list_.front().raytrace_range_ = raytrace_range_;
     observation_list_.front().obstacle_range_ = obstacle_range_;
 
-    sensor_msgs::msg::PointCloud2 global_frame_cloud;
-
-    // transform the point cloud
-    tf2_buffer_.transform(cloud, global_frame_cloud, global_frame_);
-    global_frame_cloud.header.stamp = cloud.header.stamp;
-
-    // now we need to remove observations from the cloud that are below
-    // or above our height thresholds
-    sensor_msgs::msg::PointCloud2 & observation_cloud = *(observation_list_.front().cloud_);
-    observation_cloud.height = global_frame_cloud.height;
-    observation_cloud.width = global_frame_cloud.width;
-    observation_cloud.fields = global_frame_cloud.fields;
-    observation_cloud.is_bigendian = global_frame_cloud.is_bigendian;
-    observation_cloud.point_step = global_frame_cloud.point_step;
-    observation_cloud.row_step = global_frame_cloud.row_step;
-    observation_cloud.is_dense = global_frame_cloud.is_dense;
-
-    unsigned int cloud_size = global_frame_cloud.height * global_frame_cloud.width;
-    sensor_msgs::PointCloud2Modifier modifier(observation_cloud);
-    modifier.resize(cloud_size);
-    unsigned int point_count = 0;
-
-    // copy over the points that are within our height bounds
-    sensor_msgs::PointCloud2Iterator<float> iter_z(global_frame_cloud, "z");
-    std::vector<unsigned char>::const_iterator iter_global = global_frame_cloud.data.begin(),
-      iter_global_end = global_frame_cloud.data.end();
-    std::vector<unsigned char>::iterator iter_obs = observation_cloud.data.begin();
-    for (; iter_global != iter_global_end; ++iter_z, iter_global +=
-      global_frame_cloud.point_step)
-    {
-      if ((*iter_z) <= max_obstacle_height_ &&
-        (*iter_z) >= min_obstacle_height_)
-      {
-        std::copy(iter_global, iter_global + global_frame_cloud.point_step, iter_obs);
-        iter_obs += global_frame_cloud.point_step;
-        ++point_count;
-      }
-    }
-
-    // resize the cloud for the number of legal points
-    modifier.resize(point_count);
-    observation_cloud.header.stamp = cloud.header.stamp;
-    observation_cloud.header.frame_id = global_frame_cloud.header.frame_id;
+    // look up the transform of the message once, and apply it while copying over
+    // the points that are within our height bounds, instead of transforming the
+    // whole message first
+    geometry_msgs::msg::TransformStamped transform_msg = tf2_buffer_.lookupTransform(
+      global_frame_, header.frame_id, tf2_ros::fromMsg(header.stamp));
+    tf2::fromMsg(transform_msg.transform, transform);
   } catch (tf2::TransformException & ex) {
     // if an exception occurs, we need to remove the empty observation from the list
-    observation_list_.pop_front();
+    discardObservation();
     RCLCPP_ERROR(
       rclcpp::get_logger(
         "nav2_costmap_2d"),
       "TF Exception that should never happen for sensor frame: %s, cloud frame: %s, %s",
       sensor_frame_.c_str(),
-      cloud.header.frame_id.c_str(), ex.what());
-    return;
+      header.frame_id.c_str(), ex.what());
+    return false;
   }
+  return true;
+}
+
+void ObservationBuffer::discardObservation()
+{
+  observation_pool_.splice(
+    observation_pool_.begin(), observation_list_, observation_list_.begin());
+}
+
+void ObservationBuffer::endObservation(
+  unsigned int received, unsigned int point_count,
+  int x_offset, int y_offset, int z_offset, const builtin_interfaces::msg::Time & stamp)
+{
+  Observation & observation = observation_list_.front();
+  sensor_msgs::msg::PointCloud2 & observation_cloud = *(observation.cloud_);
+  if (downsample_resolution_ > 0.0) {
+    point_count = downsample(
+      observation_cloud, point_count, observation.origin_.x, observation.origin_.y,
+      observation.origin_.z, x_offset, y_offset, z_offset);
+  }
+
+  received_points_ += received;
+  stored_points_ += point_count;
+  RCLCPP_DEBUG(
+    rclcpp::get_logger("nav2_costmap_2d"), "Stored %u of %u points from %s",
+    point_count, received, topic_name_.c_str());
+
+  // resize the cloud for the number of legal points
+  sensor_msgs::PointCloud2Modifier modifier(observation_cloud);
+  modifier.resize(point_count);
+  observation_cloud.header.stamp = stamp;
+  observation_cloud.header.frame_id = global_frame_;
 
   // if the update was successful, we want to update the last updated time
-  last_updated_ = nh_->now();
+  setLastUpdated(nh_->now());
 
   // we'll also remove any stale observations from the list
   purgeStaleObservations();
+  publishView();
+
+  for (const auto & listener : listeners_) {
+    listener.second(observation);
+  }
 }
 
-// returns a copy of the observations
-void ObservationBuffer::getObservations(std::vector<Observation> & observations)
+bool ObservationBuffer::filterPoint(
+  float & x, float & y, float & z, double ox, double oy, double oz) const
+{
+  if (z > max_obstacle_height_ || z < min_obstacle_height_) {
+    return false;
+  }
+  const double sq_planar_dist = (x - ox) * (x - ox) + (y - oy) * (y - oy);
+  if (gate_obstacle_range_ &&
+    sq_planar_dist + (z - oz) * (z - oz) >= obstacle_range_ * obstacle_range_)
+  {
+    // a marking only observation will never insert this point
+    return false;
+  }
+  if (gate_raytrace_range_ && sq_planar_dist > raytrace_range_ * raytrace_range_) {
+    // a clearing only observation traces no further than its raytrace range, so
+    // pull the endpoint in along its ray to let distant points get deduplicated
+    const double scale = raytrace_range_ / std::sqrt(sq_planar_dist);
+    x = static_cast<float>(ox + (x - ox) * scale);
+    y = static_cast<float>(oy + (y - oy) * scale);
+    z = static_cast<float>(oz + (z - oz) * scale);
+  }
+  return true;
+}
+
+void ObservationBuffer::bufferCloud(const sensor_msgs::msg::PointCloud2 & cloud)
+{
+  tf2::Transform transform;
+  if (beginObservation(cloud.header, transform)) {
+    storeCloud(cloud, transform);
+  }
+}
+
+void ObservationBuffer::bufferObservation(const Observation & observation)
 {
-  // first... let's make sure that we don't have any stale observations
+  const sensor_msgs::msg::PointCloud2 & cloud = *observation.cloud_;
+  if (cloud.header.frame_id != global_frame_ || downsample_resolution_ > 0.0) {
+    tf2::Transform transform;
+    if (beginObservation(cloud.header, transform, &observation.origin_)) {
+      storeCloud(cloud, transform);
+    }
+    return;
+  }
+
+  // neither buffer modifies a cloud once it's stored, and a purged observation whose cloud
+  // is still shared gets a new one when reused
+  if (observation_pool_.empty()) {
+    observation_list_.push_front(observation);
+  } else {
+    observation_list_.splice(
+      observation_list_.begin(), observation_pool_, observation_pool_.begin());
+    observation_list_.front() = observation;
+  }
+  observation_list_.front().obstacle_range_ = obstacle_range_;
+  observation_list_.front().raytrace_range_ = raytrace_range_;
+
+  const unsigned int point_count = cloud.height * cloud.width;
+  received_points_ += point_count;
+  stored_points_ += point_count;
+  setLastUpdated(nh_->now());
   purgeStaleObservations();
+  publishView();
 
-  // now we'll just copy the observations for the caller
-  std::list<Observation>::iterator obs_it;
-  for (obs_it = observation_list_.begin(); obs_it != observation_list_.end(); ++obs_it) {
-    observations.push_back(*obs_it);
+  for (const auto & listener : listeners_) {
+    listener.second(observation_list_.front());
+  }
+}
+
+int ObservationBuffer::addListener(Listener listener)
+{
+  std::lock_guard<std::recursive_mutex> lock(lock_);
+  listeners_[next_listener_] = listener;
+  return next_listener_++;
+}
+
+void ObservationBuffer::removeListener(int id)
+{
+  std::lock_guard<std::recursive_mutex> lock(lock_);
+  listeners_.erase(id);
+}
+
+void ObservationBuffer::storeCloud(
+  const sensor_msgs::msg::PointCloud2 & cloud, const tf2::Transform & transform)
+{
+  const tf2::Matrix3x3 & basis = transform.getBasis();
+  const tf2::Vector3 & translation = transform.getOrigin();
+
+  int x_offset = -1, y_offset = -1, z_offset = -1;
+  for (const auto & field : cloud.fields) {
+    if (field.datatype != sensor_msgs::msg::PointField::FLOAT32) {
+      continue;
+    }
+    if (field.name == "x") {
+      x_offset = field.offset;
+    } else if (field.name == "y") {
+      y_offset = field.offset;
+    } else if (field.name == "z") {
+      z_offset = field.offset;
+    }
+  }
+  if (x_offset < 0 || y_offset < 0 || z_offset < 0) {
+    discardObservation();
+    RCLCPP_ERROR(
+      rclcpp::get_logger("nav2_costmap_2d"),
+      "Cloud from %s has no float32 x, y and z fields, dropping it", topic_name_.c_str());
+    return;
+  }
+
+  const geometry_msgs::msg::Point & origin = observation_list_.front().origin_;
+  sensor_msgs::msg::PointCloud2 & observation_cloud = *(observation_list_.front().cloud_);
+  observation_cloud.height = cloud.height;
+  observation_cloud.width = cloud.width;
+  observation_cloud.fields = cloud.fields;
+  observation_cloud.is_bigendian = cloud.is_bigendian;
+  observation_cloud.point_step = cloud.point_step;
+  observation_cloud.row_step = cloud.row_step;
+  observation_cloud.is_dense = cloud.is_dense;
+
+  unsigned int cloud_size = cloud.height * cloud.width;
+  sensor_msgs::PointCloud2Modifier modifier(observation_cloud);
+  modifier.resize(cloud_size);
+  unsigned int point_count = 0;
+
+  const unsigned int point_step = cloud.point_step;
+  const unsigned char * in = cloud.data.data();
+  unsigned char * out = observation_cloud.data.data();
+  for (unsigned int i = 0; i < cloud_size; ++i, in += point_step) {
+    float point[3];
+    std::memcpy(&point[0], in + x_offset, sizeof(float));
+    std::memcpy(&point[1], in + y_offset, sizeof(float));
+    std::memcpy(&point[2], in + z_offset, sizeof(float));
+
+    float z = static_cast<float>(
+      basis[2][0] * point[0] + basis[2][1] * point[1] + basis[2][2] * point[2] +
+      translation.z());
+    if (z > max_obstacle_height_ || z < min_obstacle_height_) {
+      continue;
+    }
+    float x = static_cast<float>(
+      basis[0][0] * point[0] + basis[0][1] * point[1] + basis[0][2] * point[2] +
+      translation.x());
+    float y = static_cast<float>(
+      basis[1][0] * point[0] + basis[1][1] * point[1] + basis[1][2] * point[2] +
+      translation.y());
+    if (!filterPoint(x, y, z, origin.x, origin.y, origin.z)) {
+      continue;
+    }
+
+    std::memcpy(out, in, point_step);
+    std::memcpy(out + x_offset, &x, sizeof(float));
+    std::memcpy(out + y_offset, &y, sizeof(float));
+    std::memcpy(out + z_offset, &z, sizeof(float));
+    out += point_step;
+    ++point_count;
+  }
+
+  endObservation(cloud_size, point_count, x_offset, y_offset, z_offset, cloud.header.stamp);
+}
+
+void ObservationBuffer::bufferScan(const sensor_msgs::msg::LaserScan & scan, bool inf_is_valid)
+{
+  tf2::Transform transform;
+  if (!beginObservation(scan.header, transform)) {
+    return;
+  }
+
+  // the directions of the beams only change with the configuration of the scanner
+  const unsigned int beams = scan.ranges.size();
+  if (beams != beam_cos_.size() || scan.angle_min != beam_angle_min_ ||
+    scan.angle_increment != beam_angle_increment_)
+  {
+    beam_cos_.resize(beams);
+    beam_sin_.resize(beams);
+    for (unsigned int i = 0; i < beams; ++i) {
+      const double angle = scan.angle_min + i * static_cast<double>(scan.angle_increment);
+      beam_cos_[i] = std::cos(angle);
+      beam_sin_[i] = std::sin(angle);
+    }
+    beam_angle_min_ = scan.angle_min;
+    beam_angle_increment_ = scan.angle_increment;
+  }
+
+  // the beams in the global frame are their directions turned, from the scanner's position
+  const tf2::Matrix3x3 & basis = transform.getBasis();
+  const tf2::Vector3 & translation = transform.getOrigin();
+  const geometry_msgs::msg::Point & origin = observation_list_.front().origin_;
+
+  sensor_msgs::msg::PointCloud2 & observation_cloud = *(observation_list_.front().cloud_);
+  sensor_msgs::PointCloud2Modifier modifier(observation_cloud);
+  if (observation_cloud.point_step != 3 * sizeof(float) || observation_cloud.fields.size() != 3) {
+    modifier.setPointCloud2Fields(
+      3, "x", 1, sensor_msgs::msg::PointField::FLOAT32,
+      "y", 1, sensor_msgs::msg::PointField::FLOAT32,
+      "z", 1, sensor_msgs::msg::PointField::FLOAT32);
+  }
+  observation_cloud.is_dense = true;
+  modifier.resize(beams);
+  unsigned int point_count = 0;
+
+  // as laser_geometry::LaserProjection, which an infinite range reaches just short of
+  const float inf_range = scan.range_max - 0.0001f;
+  float * out = reinterpret_cast<float *>(observation_cloud.data.data());
+  for (unsigned int i = 0; i < beams; ++i) {
+    float range = scan.ranges[i];
+    if (inf_is_valid && !std::isfinite(range) && range > 0) {
+      range = inf_range;
+    }
+    if (!(range < scan.range_max && range >= scan.range_min)) {
+      continue;
+    }
+    const double px = range * beam_cos_[i];
+    const double py = range * beam_sin_[i];
+    float z = static_cast<float>(basis[2][0] * px + basis[2][1] * py + translation.z());
+    float x = static_cast<float>(basis[0][0] * px + basis[0][1] * py + translation.x());
+    float y = static_cast<float>(basis[1][0] * px + basis[1][1] * py + translation.y());
+    if (!filterPoint(x, y, z, origin.x, origin.y, origin.z)) {
+      continue;
+    }
+    out[0] = x;
+    out[1] = y;
+    out[2] = z;
+    out += 3;
+    ++point_count;
+  }
+
+  endObservation(beams, point_count, 0, sizeof(float), 2 * sizeof(float), scan.header.stamp);
+}
+
+unsigned int ObservationBuffer::downsample(
+  sensor_msgs::msg::PointCloud2 & cloud, unsigned int point_count,
+  double ox, double oy, double oz, int x_offset, int y_offset, int z_offset)
+{
+  // keep the point closest to the sensor of each cell, which marks the cell
+  // whenever any of its points would and ends the same ray
+  const unsigned int point_step = cloud.point_step;
+  unsigned char * data = cloud.data.data();
+  downsample_cells_.clear();
+  downsample_sq_dists_.clear();
+
+  unsigned int kept = 0;
+  for (unsigned int i = 0; i < point_count; ++i) {
+    const unsigned char * point = data + i * point_step;
+    float x, y, z;
+    std::memcpy(&x, point + x_offset, sizeof(float));
+    std::memcpy(&y, point + y_offset, sizeof(float));
+    std::memcpy(&z, point + z_offset, sizeof(float));
+
+    const int64_t cx = static_cast<int64_t>(
+      std::floor((x - downsample_origin_x_) / downsample_resolution_));
+    const int64_t cy = static_cast<int64_t>(
+      std::floor((y - downsample_origin_y_) / downsample_resolution_));
+    int64_t cz = 0;
+    if (downsample_z_resolution_ > 0.0) {
+      cz = static_cast<int64_t>(std::floor((z - downsample_origin_z_) / downsample_z_resolution_));
+    }
+    const uint64_t key = (static_cast<uint64_t>(z > downsample_split_height_) << 63) |
+      (static_cast<uint64_t>(cx & 0x1fffff) << 42) |
+      (static_cast<uint64_t>(cy & 0x1fffff) << 21) | static_cast<uint64_t>(cz & 0x1fffff);
+    const double sq_dist = (x - ox) * (x - ox) + (y - oy) * (y - oy) + (z - oz) * (z - oz);
+
+    auto inserted = downsample_cells_.emplace(key, kept);
+    if (inserted.second) {
+      if (kept != i) {
+        std::memcpy(data + kept * point_step, point, point_step);
+      }
+      downsample_sq_dists_.push_back(sq_dist);
+      ++kept;
+    } else if (sq_dist < downsample_sq_dists_[inserted.first->second]) {
+      std::memcpy(data + inserted.first->second * point_step, point, point_step);
+      downsample_sq_dists_[inserted.first->second] = sq_dist;
+    }
   }
+  return kept;
+}
+
+// returns a copy of the observations
+void ObservationBuffer::getObservations(std::vector<Observation> & observations)
+{
+  // the observations share their clouds with the buffer, only they are copied
+  std::shared_ptr<const std::vector<Observation>> view = getObservationView();
+  observations.insert(observations.end(), view->begin(), view->end());
+}
+
+void ObservationBuffer::publishView()
+{
+  std::shared_ptr<const std::vector<Observation>> view =
+    std::make_shared<const std::vector<Observation>>(
+    observation_list_.begin(), observation_list_.end());
+  std::atomic_store(&view_, view);
+}
+
+void ObservationBuffer::setLastUpdated(const rclcpp::Time & time)
+{
+  last_updated_ = time;
+  last_updated_ns_.store(time.nanoseconds(), std::memory_order_relaxed);
 }
 
 void ObservationBuffer::purgeStaleObservations()
@@ -224,7 +558,8 @@ void ObservationBuffer::purgeStaleObservations()
     std::list<Observation>::iterator obs_it = observation_list_.begin();
     // if we're keeping observations for no time... then we'll only keep one observation
     if (observation_keep_time_ == rclcpp::Duration(0.0)) {
-      observation_list_.erase(++obs_it, observation_list_.end());
+      observation_pool_.splice(
+        observation_pool_.end(), observation_list_, ++obs_it, observation_list_.end());
       return;
     }
 
@@ -234,7 +569,8 @@ void ObservationBuffer::purgeStaleObservations()
       // check if the observation is out of date... and if it is,
       // remove it and those that follow from the list
       if ((last_updated_ - obs.cloud_->header.stamp) > observation_keep_time_) {
-        observation_list_.erase(obs_it, observation_list_.end());
+        observation_pool_.splice(
+          observation_pool_.end(), observation_list_, obs_it, observation_list_.end());
         return;
       }
     }
@@ -247,20 +583,26 @@ bool ObservationBuffer::isCurrent() const
     return true;
   }
 
-  bool current = (nh_->now() - last_updated_) <= expected_update_rate_;
+  const rclcpp::Time now = nh_->now();
+  const rclcpp::Time last_updated(
+    last_updated_ns_.load(std::memory_order_relaxed), now.get_clock_type());
+  bool current = (now - last_updated) <= expected_update_rate_;
   if (!current) {
     RCLCPP_WARN(
       rclcpp::get_logger(
         "nav2_costmap_2d"),
       "The %s observation buffer has not been updated for %.2f seconds, and it should be updated every %.2f seconds.", //NOLINT
       topic_name_.c_str(),
-      (nh_->now() - last_updated_).seconds(), expected_update_rate_.seconds());
+      (now - last_updated).seconds(), expected_update_rate_.seconds());
   }
   return current;
 }
 
 void ObservationBuffer::resetLastUpdated()
 {
-  last_updated_ = nh_->now();
+  std::lock_guard<std::recursive_mutex> lock(lock_);
+  setLastUpdated(nh_->now());
+  purgeStaleObservations();
+  publishView();
 }
 }  // namespace nav2_costmap_2d
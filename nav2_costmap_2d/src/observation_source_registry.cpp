@@ -0,0 +1,63 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_costmap_2d/observation_source_registry.hpp"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace nav2_costmap_2d
+{
+
+namespace
+{
+
+std::mutex & registryMutex()
+{
+  static std::mutex mutex;
+  return mutex;
+}
+
+std::map<std::string, std::weak_ptr<ObservationBuffer>> & registryBuffers()
+{
+  static std::map<std::string, std::weak_ptr<ObservationBuffer>> buffers;
+  return buffers;
+}
+
+}  // namespace
+
+void ObservationSourceRegistry::add(
+  const std::string & key, const std::shared_ptr<ObservationBuffer> & buffer)
+{
+  std::lock_guard<std::mutex> lock(registryMutex());
+  registryBuffers()[key] = buffer;
+}
+
+std::shared_ptr<ObservationBuffer> ObservationSourceRegistry::get(const std::string & key)
+{
+  std::lock_guard<std::mutex> lock(registryMutex());
+  auto it = registryBuffers().find(key);
+  if (it == registryBuffers().end()) {
+    return nullptr;
+  }
+  std::shared_ptr<ObservationBuffer> buffer = it->second.lock();
+  if (!buffer) {
+    registryBuffers().erase(it);
+  }
+  return buffer;
+}
+
+}  // namespace nav2_costmap_2d
@@ -0,0 +1,107 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_costmap_2d/update_statistics.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <string>
+#include <vector>
+
+namespace nav2_costmap_2d
+{
+
+RollingStatistics::RollingStatistics(std::size_t window)
+: window_(std::max<std::size_t>(1, window)), next_(0)
+{
+  samples_.reserve(window_);
+}
+
+void RollingStatistics::add(double value)
+{
+  if (samples_.size() < window_) {
+    samples_.push_back(value);
+  } else {
+    samples_[next_] = value;
+  }
+  next_ = (next_ + 1) % window_;
+}
+
+void RollingStatistics::toMsg(
+  const std::string & name, nav2_msgs::msg::RollingStatistics & msg) const
+{
+  msg.name = name;
+  msg.count = static_cast<uint32_t>(samples_.size());
+  if (samples_.empty()) {
+    msg.mean = msg.median = msg.p95 = msg.max = 0.0;
+    return;
+  }
+
+  // only summarized at the rate the statistics are published, so sorting a copy is fine
+  std::vector<double> sorted(samples_);
+  std::sort(sorted.begin(), sorted.end());
+  msg.mean = std::accumulate(sorted.begin(), sorted.end(), 0.0) / sorted.size();
+  msg.median = sorted[sorted.size() / 2];
+  msg.p95 = sorted[std::min(sorted.size() - 1, sorted.size() * 95 / 100)];
+  msg.max = sorted.back();
+}
+
+UpdateStatistics::UpdateStatistics(std::size_t window)
+: window_(window),
+  update_time_(window),
+  lock_wait_(window),
+  updated_cells_(window),
+  pending_cells_(0.0),
+  missed_cycles_(0)
+{
+}
+
+void UpdateStatistics::setLayers(const std::vector<std::string> & layer_names)
+{
+  layer_names_ = layer_names;
+  layers_.assign(layer_names_.size(), LayerTimes(window_));
+}
+
+void UpdateStatistics::beginUpdate()
+{
+  pending_cells_ = 0.0;
+  for (auto & layer : layers_) {
+    layer.pending_bounds = 0.0;
+    layer.pending_costs = 0.0;
+  }
+}
+
+void UpdateStatistics::endUpdate()
+{
+  updated_cells_.add(pending_cells_);
+  for (auto & layer : layers_) {
+    layer.bounds.add(layer.pending_bounds);
+    layer.costs.add(layer.pending_costs);
+  }
+}
+
+void UpdateStatistics::toMsg(nav2_msgs::msg::CostmapUpdateStatistics & msg) const
+{
+  msg.missed_cycles = missed_cycles_;
+  msg.statistics.resize(3 + 2 * layers_.size());
+  update_time_.toMsg("update_map", msg.statistics[0]);
+  lock_wait_.toMsg("lock_wait", msg.statistics[1]);
+  updated_cells_.toMsg("updated_cells", msg.statistics[2]);
+  for (std::size_t i = 0; i < layers_.size(); ++i) {
+    layers_[i].bounds.toMsg(layer_names_[i] + "/update_bounds", msg.statistics[3 + 2 * i]);
+    layers_[i].costs.toMsg(layer_names_[i] + "/update_costs", msg.statistics[4 + 2 * i]);
+  }
+}
+
+}  // namespace nav2_costmap_2d
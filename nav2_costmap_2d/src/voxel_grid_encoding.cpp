@@ -0,0 +1,121 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_costmap_2d/voxel_grid_encoding.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace nav2_costmap_2d
+{
+
+using nav2_msgs::msg::VoxelGrid;
+
+VoxelGridEncoder::VoxelGridEncoder(unsigned int keyframe_interval)
+: keyframe_interval_(keyframe_interval), deltas_(0), sequence_(0), column_words_(0)
+{
+}
+
+void VoxelGridEncoder::encode(
+  const uint32_t * words, std::size_t num_columns, unsigned int column_words,
+  VoxelGrid & msg)
+{
+  const std::size_t size = num_columns * column_words;
+  msg.column_words = column_words;
+  msg.sequence = ++sequence_;
+  msg.data.clear();
+
+  bool keyframe = keyframe_interval_ == 0 || deltas_ >= keyframe_interval_ ||
+    column_words != column_words_ || previous_.size() != size;
+  if (!keyframe) {
+    for (std::size_t i = 0; i < num_columns; ++i) {
+      const uint32_t * column = words + i * column_words;
+      if (std::equal(column, column + column_words, previous_.begin() + i * column_words)) {
+        continue;
+      }
+      // a changed column takes a word more than it does in the whole grid
+      if (msg.data.size() + column_words + 1 >= size) {
+        keyframe = true;
+        break;
+      }
+      msg.data.push_back(static_cast<uint32_t>(i));
+      msg.data.insert(msg.data.end(), column, column + column_words);
+    }
+  }
+
+  if (keyframe) {
+    msg.encoding = VoxelGrid::ENCODING_RAW;
+    msg.data.assign(words, words + size);
+    deltas_ = 0;
+  } else {
+    msg.encoding = VoxelGrid::ENCODING_DELTA;
+    ++deltas_;
+  }
+  previous_.assign(words, words + size);
+  column_words_ = column_words;
+}
+
+VoxelGridDecoder::VoxelGridDecoder()
+: valid_(false), replaced_(false), sequence_(0), column_words_(0)
+{
+}
+
+bool VoxelGridDecoder::decode(const VoxelGrid & msg)
+{
+  const std::size_t num_columns = static_cast<std::size_t>(msg.size_x) * msg.size_y;
+  replaced_ = false;
+  changed_.clear();
+
+  if (msg.encoding == VoxelGrid::ENCODING_RAW) {
+    unsigned int column_words = msg.column_words;
+    if (column_words == 0 && num_columns > 0) {
+      // from a publisher that predates column_words
+      column_words = msg.data.size() / num_columns;
+    }
+    valid_ = column_words > 0 && msg.data.size() == num_columns * column_words;
+    if (valid_) {
+      words_ = msg.data;
+      column_words_ = column_words;
+      sequence_ = msg.sequence;
+      replaced_ = true;
+    }
+    return valid_;
+  }
+
+  if (!valid_ || msg.encoding != VoxelGrid::ENCODING_DELTA ||
+    msg.sequence != sequence_ + 1 || msg.column_words != column_words_ ||
+    words_.size() != num_columns * column_words_ ||
+    msg.data.size() % (column_words_ + 1) != 0)
+  {
+    valid_ = false;
+    return false;
+  }
+
+  for (std::size_t i = 0; i < msg.data.size(); i += column_words_ + 1) {
+    const uint32_t index = msg.data[i];
+    if (index >= num_columns) {
+      valid_ = false;
+      changed_.clear();
+      return false;
+    }
+    std::copy(
+      msg.data.begin() + i + 1, msg.data.begin() + i + 1 + column_words_,
+      words_.begin() + static_cast<std::size_t>(index) * column_words_);
+    changed_.push_back(index);
+  }
+  sequence_ = msg.sequence;
+  return true;
+}
+
+}  // namespace nav2_costmap_2d
@@ -0,0 +1,373 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Replays scans and clouds into the layers of a costmap offline: the observations go
+// straight into the layers' observation buffers and the costmap is updated at fixed poses,
+// without anything going through the middleware. Prints the time each layer took and a
+// checksum of the costmap after every update, so that a change to a layer can be both
+// benchmarked and checked for leaving the costmaps bit-exact.
+//
+// The costmap is configured like any other, from the parameters of the node
+// /costmap/costmap, by default with costmap_replay_params.yaml:
+//
+//   costmap_replay_benchmark --ros-args --params-file costmap_replay_params.yaml
+//
+// The observations are generated from a seed, so they are the same from run to run: a robot
+// drives around a circle among boxes, with a 360 degree scan and a depth camera cloud at
+// every step. They're buffered by the sources on the replay_scan_topic and
+// replay_cloud_topic parameters. The checksums of a run are written to the file named by
+// the replay_checksums parameter, and compared with the ones of the replay_reference file.
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "lifecycle_msgs/msg/state.hpp"
+#include "nav2_costmap_2d/costmap_2d_ros.hpp"
+#include "nav2_costmap_2d/obstacle_layer.hpp"
+#include "nav2_msgs/msg/costmap_update_statistics.hpp"
+#include "rcl/time.h"
+#include "rclcpp/rclcpp.hpp"
+#include "sensor_msgs/msg/laser_scan.hpp"
+#include "sensor_msgs/msg/point_cloud2.hpp"
+#include "sensor_msgs/point_cloud2_iterator.hpp"
+
+namespace
+{
+
+const char SENSOR_FRAME[] = "replay_sensor";
+const double SENSOR_HEIGHT = 0.2;
+const double START_TIME = 1000.0;  // Stamps of zero mean the latest transform to TF
+const double STEP_TIME = 0.1;
+const double PATH_RADIUS = 5.0;
+const double SCAN_RANGE_MAX = 3.5;
+const int SCAN_BEAMS = 360;
+const double CLOUD_FOV = M_PI / 3.0;
+const double CLOUD_Z_STEP = 0.1;
+
+struct Box
+{
+  double min_x, min_y, max_x, max_y, height;
+};
+
+// The draws of std::mt19937 are the same everywhere, unlike the standard distributions
+double uniform(std::mt19937 & generator, double min, double max)
+{
+  return min + (max - min) * (generator() / 4294967296.0);
+}
+
+// Boxes scattered over 20 by 20 meters, clear of the path around the circle
+std::vector<Box> makeWorld(unsigned int seed)
+{
+  std::mt19937 generator(seed);
+  std::vector<Box> boxes;
+  while (boxes.size() < 60) {
+    double x = uniform(generator, -10.0, 10.0);
+    double y = uniform(generator, -10.0, 10.0);
+    double size = uniform(generator, 0.2, 1.0);
+    double height = uniform(generator, 0.3, 2.0);
+    if (std::fabs(std::hypot(x, y) - PATH_RADIUS) < size + 0.5) {
+      continue;
+    }
+    boxes.push_back({x - size / 2, y - size / 2, x + size / 2, y + size / 2, height});
+  }
+  return boxes;
+}
+
+// The distance to the nearest box along a ray, and how tall it is
+double castRay(
+  const std::vector<Box> & boxes, double x, double y, double angle, double & height)
+{
+  double dx = std::cos(angle), dy = std::sin(angle);
+  double nearest = std::numeric_limits<double>::infinity();
+  for (const Box & box : boxes) {
+    double t_min = 0.0, t_max = SCAN_RANGE_MAX;
+    bool hit = true;
+    for (int axis = 0; axis < 2 && hit; ++axis) {
+      double origin = axis == 0 ? x : y;
+      double direction = axis == 0 ? dx : dy;
+      double low = axis == 0 ? box.min_x : box.min_y;
+      double high = axis == 0 ? box.max_x : box.max_y;
+      if (std::fabs(direction) < 1e-12) {
+        hit = origin >= low && origin <= high;
+        continue;
+      }
+      double t0 = (low - origin) / direction, t1 = (high - origin) / direction;
+      t_min = std::max(t_min, std::min(t0, t1));
+      t_max = std::min(t_max, std::max(t0, t1));
+      hit = t_min <= t_max;
+    }
+    if (hit && t_min < nearest) {
+      nearest = t_min;
+      height = box.height;
+    }
+  }
+  return nearest;
+}
+
+void poseAt(unsigned int step, unsigned int steps, double & x, double & y, double & yaw)
+{
+  double angle = 2.0 * M_PI * step / steps;
+  x = PATH_RADIUS * std::cos(angle);
+  y = PATH_RADIUS * std::sin(angle);
+  yaw = angle + M_PI / 2.0;
+}
+
+sensor_msgs::msg::LaserScan::SharedPtr makeScan(
+  const std::vector<Box> & boxes, double x, double y, double yaw,
+  const builtin_interfaces::msg::Time & stamp)
+{
+  auto scan = std::make_shared<sensor_msgs::msg::LaserScan>();
+  scan->header.frame_id = SENSOR_FRAME;
+  scan->header.stamp = stamp;
+  scan->angle_min = -M_PI;
+  scan->angle_increment = 2.0 * M_PI / SCAN_BEAMS;
+  scan->angle_max = scan->angle_min + scan->angle_increment * (SCAN_BEAMS - 1);
+  scan->range_min = 0.1;
+  scan->range_max = SCAN_RANGE_MAX;
+  scan->ranges.resize(SCAN_BEAMS);
+  for (int i = 0; i < SCAN_BEAMS; ++i) {
+    double height;
+    scan->ranges[i] = static_cast<float>(
+      castRay(boxes, x, y, yaw + scan->angle_min + i * scan->angle_increment, height));
+  }
+  return scan;
+}
+
+sensor_msgs::msg::PointCloud2::SharedPtr makeCloud(
+  const std::vector<Box> & boxes, double x, double y, double yaw,
+  const builtin_interfaces::msg::Time & stamp)
+{
+  struct Point
+  {
+    float x, y, z;
+  };
+  std::vector<Point> points;
+  const int columns = 61;
+  for (int i = 0; i < columns; ++i) {
+    double angle = -CLOUD_FOV / 2 + CLOUD_FOV * i / (columns - 1);
+    double height = 0.0;
+    double range = castRay(boxes, x, y, yaw + angle, height);
+    if (!std::isfinite(range)) {
+      continue;
+    }
+    for (double z = CLOUD_Z_STEP / 2; z < height; z += CLOUD_Z_STEP) {
+      points.push_back(
+        {static_cast<float>(range * std::cos(angle)),
+          static_cast<float>(range * std::sin(angle)),
+          static_cast<float>(z - SENSOR_HEIGHT)});
+    }
+  }
+
+  auto cloud = std::make_shared<sensor_msgs::msg::PointCloud2>();
+  cloud->header.frame_id = SENSOR_FRAME;
+  cloud->header.stamp = stamp;
+  sensor_msgs::PointCloud2Modifier modifier(*cloud);
+  modifier.setPointCloud2FieldsByString(1, "xyz");
+  modifier.resize(points.size());
+  sensor_msgs::PointCloud2Iterator<float> iter_x(*cloud, "x");
+  sensor_msgs::PointCloud2Iterator<float> iter_y(*cloud, "y");
+  sensor_msgs::PointCloud2Iterator<float> iter_z(*cloud, "z");
+  for (const Point & point : points) {
+    *iter_x = point.x;
+    *iter_y = point.y;
+    *iter_z = point.z;
+    ++iter_x;
+    ++iter_y;
+    ++iter_z;
+  }
+  return cloud;
+}
+
+geometry_msgs::msg::TransformStamped makeTransform(
+  const std::string & parent, const std::string & child, double x, double y, double z,
+  double yaw, const builtin_interfaces::msg::Time & stamp)
+{
+  geometry_msgs::msg::TransformStamped transform;
+  transform.header.frame_id = parent;
+  transform.header.stamp = stamp;
+  transform.child_frame_id = child;
+  transform.transform.translation.x = x;
+  transform.transform.translation.y = y;
+  transform.transform.translation.z = z;
+  transform.transform.rotation.z = std::sin(yaw / 2);
+  transform.transform.rotation.w = std::cos(yaw / 2);
+  return transform;
+}
+
+// FNV-1a over the costs and where the costmap is, in cells
+uint64_t checksum(nav2_costmap_2d::Costmap2D & costmap)
+{
+  uint64_t hash = 14695981039346656037ULL;
+  auto add = [&hash](const unsigned char * bytes, std::size_t size) {
+      for (std::size_t i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * 1099511628211ULL;
+      }
+    };
+  int64_t where[4] = {
+    costmap.getSizeInCellsX(), costmap.getSizeInCellsY(),
+    std::llround(costmap.getOriginX() / costmap.getResolution()),
+    std::llround(costmap.getOriginY() / costmap.getResolution())};
+  add(reinterpret_cast<const unsigned char *>(where), sizeof(where));
+  add(costmap.getCharMap(), costmap.getSizeInCellsX() * costmap.getSizeInCellsY());
+  return hash;
+}
+
+}  // namespace
+
+int main(int argc, char ** argv)
+{
+  rclcpp::init(argc, argv);
+  auto costmap = std::make_shared<nav2_costmap_2d::Costmap2DROS>("costmap");
+  auto logger = costmap->get_logger();
+
+  costmap->declare_parameter("replay_steps", rclcpp::ParameterValue(400));
+  costmap->declare_parameter("replay_seed", rclcpp::ParameterValue(42));
+  costmap->declare_parameter("replay_scan_topic", rclcpp::ParameterValue(std::string("/scan")));
+  costmap->declare_parameter(
+    "replay_cloud_topic", rclcpp::ParameterValue(std::string("/cloud")));
+  costmap->declare_parameter("replay_checksums", rclcpp::ParameterValue(std::string("")));
+  costmap->declare_parameter("replay_reference", rclcpp::ParameterValue(std::string("")));
+  int steps = std::max(1, static_cast<int>(costmap->get_parameter("replay_steps").as_int()));
+  int seed = costmap->get_parameter("replay_seed").as_int();
+  std::string scan_topic = costmap->get_parameter("replay_scan_topic").as_string();
+  std::string cloud_topic = costmap->get_parameter("replay_cloud_topic").as_string();
+  std::string checksums_file = costmap->get_parameter("replay_checksums").as_string();
+  std::string reference_file = costmap->get_parameter("replay_reference").as_string();
+
+  if (costmap->configure().id() != lifecycle_msgs::msg::State::PRIMARY_STATE_INACTIVE) {
+    RCLCPP_ERROR(logger, "Failed to configure the costmap");
+    return 1;
+  }
+  nav2_costmap_2d::LayeredCostmap * layered_costmap = costmap->getLayeredCostmap();
+  layered_costmap->enableStatistics(steps);
+  std::shared_ptr<tf2_ros::Buffer> tf = costmap->getTfBuffer();
+
+  std::vector<std::shared_ptr<nav2_costmap_2d::ObstacleLayer>> obstacle_layers;
+  for (auto & layer : *layered_costmap->getPlugins()) {
+    auto obstacle_layer = std::dynamic_pointer_cast<nav2_costmap_2d::ObstacleLayer>(layer);
+    if (obstacle_layer) {
+      obstacle_layers.push_back(obstacle_layer);
+    }
+  }
+
+  // The costmap's own clock, which the observation buffers age observations by, follows the
+  // stamps of the replay instead of the wall clock
+  rcl_clock_t * clock = costmap->get_clock()->get_clock_handle();
+  rcl_enable_ros_time_override(clock);
+
+  std::vector<uint64_t> reference;
+  if (!reference_file.empty()) {
+    std::ifstream file(reference_file);
+    unsigned int step;
+    std::string hash;
+    while (file >> step >> hash) {
+      reference.push_back(std::stoull(hash, nullptr, 16));
+    }
+  }
+  std::ofstream checksums;
+  if (!checksums_file.empty()) {
+    checksums.open(checksums_file);
+  }
+
+  std::vector<Box> boxes = makeWorld(static_cast<unsigned int>(seed));
+  bool buffered_scan = false, buffered_cloud = false;
+  int first_mismatch = -1;
+  uint64_t run_hash = 14695981039346656037ULL;
+  for (int step = 0; step < steps; ++step) {
+    rclcpp::Time now(static_cast<int64_t>((START_TIME + step * STEP_TIME) * 1e9));
+    builtin_interfaces::msg::Time stamp = now;
+    rcl_set_ros_time_override(clock, now.nanoseconds());
+
+    double x, y, yaw;
+    poseAt(step, steps, x, y, yaw);
+    tf->setTransform(
+      makeTransform(
+        costmap->getGlobalFrameID(), costmap->getBaseFrameID(), x, y, 0.0, yaw, stamp),
+      "replay", false);
+    tf->setTransform(
+      makeTransform(
+        costmap->getBaseFrameID(), SENSOR_FRAME, 0.0, 0.0, SENSOR_HEIGHT, 0.0, stamp),
+      "replay", true);
+
+    sensor_msgs::msg::LaserScan::ConstSharedPtr scan = makeScan(boxes, x, y, yaw, stamp);
+    sensor_msgs::msg::PointCloud2::ConstSharedPtr cloud = makeCloud(boxes, x, y, yaw, stamp);
+    for (auto & layer : obstacle_layers) {
+      buffered_scan |= layer->replayObservation(scan_topic, scan);
+      buffered_cloud |= layer->replayObservation(cloud_topic, cloud);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    layered_costmap->updateMap(x, y, yaw);
+    layered_costmap->getStatistics()->addUpdateTime(
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+
+    uint64_t hash = checksum(*layered_costmap->getCostmap());
+    run_hash = (run_hash ^ hash) * 1099511628211ULL;
+    if (checksums.is_open()) {
+      checksums << step << " " << std::hex << hash << std::dec << "\n";
+    }
+    if (first_mismatch < 0 && static_cast<std::size_t>(step) < reference.size() &&
+      reference[step] != hash)
+    {
+      first_mismatch = step;
+    }
+  }
+
+  if (!buffered_scan) {
+    RCLCPP_WARN(logger, "No observation source is on the scan topic %s", scan_topic.c_str());
+  }
+  if (!buffered_cloud) {
+    RCLCPP_WARN(logger, "No observation source is on the cloud topic %s", cloud_topic.c_str());
+  }
+
+  nav2_msgs::msg::CostmapUpdateStatistics statistics;
+  layered_costmap->getStatistics()->toMsg(statistics);
+  printf("%-40s %10s %10s %10s %10s\n", "", "mean [ms]", "median", "p95", "max");
+  for (const auto & measurement : statistics.statistics) {
+    // The updated area is in cells, the rest in seconds
+    double scale = measurement.name == "updated_cells" ? 1.0 : 1000.0;
+    printf(
+      "%-40s %10.3f %10.3f %10.3f %10.3f\n", measurement.name.c_str(),
+      measurement.mean * scale, measurement.median * scale, measurement.p95 * scale,
+      measurement.max * scale);
+  }
+  printf("checksum of the %d updates: %016" PRIx64 "\n", steps, run_hash);
+
+  int result = 0;
+  if (!reference.empty()) {
+    if (first_mismatch >= 0) {
+      printf("The costmap differs from the reference from update %d on\n", first_mismatch);
+      result = 1;
+    } else if (reference.size() != static_cast<std::size_t>(steps)) {
+      printf("The reference has %zu updates, not %d\n", reference.size(), steps);
+      result = 1;
+    } else {
+      printf("The costmap matches the reference\n");
+    }
+  }
+
+  costmap->cleanup();
+  rclcpp::shutdown();
+  return result;
+}
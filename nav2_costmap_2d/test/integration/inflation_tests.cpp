@@ -37,6 +37,7 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "nav2_costmap_2d/costmap_2d.hpp"
@@ -490,3 +491,230 @@ TEST_F(TestNode, testInflation3)
   ASSERT_EQ(countValues(*costmap, nav2_costmap_2d::LETHAL_OBSTACLE), 1u);
   ASSERT_EQ(countValues(*costmap, nav2_costmap_2d::INSCRIBED_INFLATED_OBSTACLE), 4u);
 }
+
+/**
+ * Test that the bucket inflation engine produces exactly the same costs
+ * as the original distance-keyed map engine
+ */
+TEST_F(TestNode, testBucketEngineMatchesMapEngine)
+{
+  const double inflation_radius = 4.1;
+  initNode(inflation_radius);
+  node_->declare_parameter(
+    "map_inflation.inflation_engine", rclcpp::ParameterValue(std::string("map")));
+  node_->declare_parameter(
+    "map_inflation.inflation_radius", rclcpp::ParameterValue(inflation_radius));
+  node_->declare_parameter("map_inflation.cost_scaling_factor", rclcpp::ParameterValue(1.0));
+  tf2_ros::Buffer tf(node_->get_clock());
+
+  nav2_costmap_2d::LayeredCostmap bucket_layers("frame", false, false);
+  bucket_layers.resizeMap(20, 20, 1, 0, 0);
+  std::vector<Point> polygon = setRadii(bucket_layers, 2.1, 2.3);
+  nav2_costmap_2d::ObstacleLayer * bucket_olayer = addObstacleLayer(bucket_layers, tf, node_);
+  addInflationLayer(bucket_layers, tf, node_);
+  bucket_layers.setFootprint(polygon);
+
+  nav2_costmap_2d::LayeredCostmap map_layers("frame", false, false);
+  map_layers.resizeMap(20, 20, 1, 0, 0);
+  setRadii(map_layers, 2.1, 2.3);
+  nav2_costmap_2d::ObstacleLayer * map_olayer = addObstacleLayer(map_layers, tf, node_);
+  nav2_costmap_2d::InflationLayer * map_ilayer = new nav2_costmap_2d::InflationLayer();
+  map_ilayer->initialize(&map_layers, "map_inflation", &tf, node_, nullptr, nullptr);
+  map_layers.addPlugin(std::shared_ptr<nav2_costmap_2d::Layer>(map_ilayer));
+  map_layers.setFootprint(polygon);
+
+  const std::vector<std::pair<double, double>> obstacles =
+  {{0, 0}, {4, 4}, {5, 5}, {12, 3}, {13, 3}, {9, 15}, {19, 19}};
+  for (const auto & obstacle : obstacles) {
+    addObservation(bucket_olayer, obstacle.first, obstacle.second, MAX_Z);
+    addObservation(map_olayer, obstacle.first, obstacle.second, MAX_Z);
+  }
+
+  bucket_layers.updateMap(0, 0, 0);
+  map_layers.updateMap(0, 0, 0);
+
+  nav2_costmap_2d::Costmap2D * bucket_costmap = bucket_layers.getCostmap();
+  nav2_costmap_2d::Costmap2D * map_costmap = map_layers.getCostmap();
+  for (unsigned int j = 0; j < 20; ++j) {
+    for (unsigned int i = 0; i < 20; ++i) {
+      ASSERT_EQ(bucket_costmap->getCost(i, j), map_costmap->getCost(i, j));
+    }
+  }
+}
+
+/**
+ * Test that the incremental inflation engine matches a full inflation
+ * while obstacles are added and removed over several cycles
+ */
+TEST_F(TestNode, testIncrementalEngineMatchesFullInflation)
+{
+  const double inflation_radius = 3;
+  initNode(inflation_radius);
+  node_->declare_parameter(
+    "incremental_inflation.inflation_engine", rclcpp::ParameterValue(std::string("incremental")));
+  node_->declare_parameter(
+    "incremental_inflation.inflation_radius", rclcpp::ParameterValue(inflation_radius));
+  node_->declare_parameter(
+    "incremental_inflation.cost_scaling_factor", rclcpp::ParameterValue(1.0));
+  tf2_ros::Buffer tf(node_->get_clock());
+
+  nav2_costmap_2d::LayeredCostmap full_layers("frame", false, false);
+  full_layers.resizeMap(20, 20, 1, 0, 0);
+  std::vector<Point> polygon = setRadii(full_layers, 1, 1.75);
+  nav2_costmap_2d::ObstacleLayer * full_olayer = addObstacleLayer(full_layers, tf, node_);
+  addInflationLayer(full_layers, tf, node_);
+  full_layers.setFootprint(polygon);
+
+  nav2_costmap_2d::LayeredCostmap incr_layers("frame", false, false);
+  incr_layers.resizeMap(20, 20, 1, 0, 0);
+  setRadii(incr_layers, 1, 1.75);
+  nav2_costmap_2d::ObstacleLayer * incr_olayer = addObstacleLayer(incr_layers, tf, node_);
+  nav2_costmap_2d::InflationLayer * incr_ilayer = new nav2_costmap_2d::InflationLayer();
+  incr_ilayer->initialize(&incr_layers, "incremental_inflation", &tf, node_, nullptr, nullptr);
+  incr_layers.addPlugin(std::shared_ptr<nav2_costmap_2d::Layer>(incr_ilayer));
+  incr_layers.setFootprint(polygon);
+
+  auto compare = [&]() {
+      full_layers.updateMap(0, 0, 0);
+      incr_layers.updateMap(0, 0, 0);
+      nav2_costmap_2d::Costmap2D * full_costmap = full_layers.getCostmap();
+      nav2_costmap_2d::Costmap2D * incr_costmap = incr_layers.getCostmap();
+      for (unsigned int j = 0; j < 20; ++j) {
+        for (unsigned int i = 0; i < 20; ++i) {
+          ASSERT_EQ(full_costmap->getCost(i, j), incr_costmap->getCost(i, j));
+        }
+      }
+    };
+
+  // Obstacles far enough apart that their inflation does not overlap
+  addObservation(full_olayer, 5, 5, MAX_Z);
+  addObservation(incr_olayer, 5, 5, MAX_Z);
+  addObservation(full_olayer, 15, 15, MAX_Z);
+  addObservation(incr_olayer, 15, 15, MAX_Z);
+  compare();
+  ASSERT_EQ(countValues(*incr_layers.getCostmap(), nav2_costmap_2d::LETHAL_OBSTACLE), 2u);
+
+  // Add an obstacle in a later cycle
+  addObservation(full_olayer, 15, 4, MAX_Z);
+  addObservation(incr_olayer, 15, 4, MAX_Z);
+  compare();
+  ASSERT_EQ(countValues(*incr_layers.getCostmap(), nav2_costmap_2d::LETHAL_OBSTACLE), 3u);
+
+  // Clear the obstacle at <5, 5> with a ray from <0, 5>, marking <8, 5> instead
+  full_olayer->clearStaticObservations(true, true);
+  incr_olayer->clearStaticObservations(true, true);
+  addObservation(full_olayer, 8, 5, 0.0, 0.0, 5.0);
+  addObservation(incr_olayer, 8, 5, 0.0, 0.0, 5.0);
+  compare();
+  ASSERT_NE(incr_layers.getCostmap()->getCost(5, 5), nav2_costmap_2d::LETHAL_OBSTACLE);
+  ASSERT_EQ(incr_layers.getCostmap()->getCost(8, 5), nav2_costmap_2d::LETHAL_OBSTACLE);
+}
+
+/**
+ * Test that the incremental inflation engine matches a full inflation when
+ * an obstacle whose inflation overlaps that of others is removed
+ */
+TEST_F(TestNode, testIncrementalEngineRemovesOverlappingObstacle)
+{
+  const double inflation_radius = 3;
+  initNode(inflation_radius);
+  node_->declare_parameter(
+    "incremental_inflation.inflation_engine", rclcpp::ParameterValue(std::string("incremental")));
+  node_->declare_parameter(
+    "incremental_inflation.inflation_radius", rclcpp::ParameterValue(inflation_radius));
+  node_->declare_parameter(
+    "incremental_inflation.cost_scaling_factor", rclcpp::ParameterValue(1.0));
+  tf2_ros::Buffer tf(node_->get_clock());
+
+  nav2_costmap_2d::LayeredCostmap full_layers("frame", false, false);
+  full_layers.resizeMap(20, 20, 1, 0, 0);
+  std::vector<Point> polygon = setRadii(full_layers, 1, 1.75);
+  nav2_costmap_2d::ObstacleLayer * full_olayer = addObstacleLayer(full_layers, tf, node_);
+  addInflationLayer(full_layers, tf, node_);
+  full_layers.setFootprint(polygon);
+
+  nav2_costmap_2d::LayeredCostmap incr_layers("frame", false, false);
+  incr_layers.resizeMap(20, 20, 1, 0, 0);
+  setRadii(incr_layers, 1, 1.75);
+  nav2_costmap_2d::ObstacleLayer * incr_olayer = addObstacleLayer(incr_layers, tf, node_);
+  nav2_costmap_2d::InflationLayer * incr_ilayer = new nav2_costmap_2d::InflationLayer();
+  incr_ilayer->initialize(&incr_layers, "incremental_inflation", &tf, node_, nullptr, nullptr);
+  incr_layers.addPlugin(std::shared_ptr<nav2_costmap_2d::Layer>(incr_ilayer));
+  incr_layers.setFootprint(polygon);
+
+  auto compare = [&]() {
+      full_layers.updateMap(0, 0, 0);
+      incr_layers.updateMap(0, 0, 0);
+      nav2_costmap_2d::Costmap2D * full_costmap = full_layers.getCostmap();
+      nav2_costmap_2d::Costmap2D * incr_costmap = incr_layers.getCostmap();
+      for (unsigned int j = 0; j < 20; ++j) {
+        for (unsigned int i = 0; i < 20; ++i) {
+          ASSERT_EQ(full_costmap->getCost(i, j), incr_costmap->getCost(i, j));
+        }
+      }
+    };
+
+  // Obstacles within the inflation radius of each other
+  std::vector<std::pair<int, int>> obstacles = {{4, 5}, {6, 6}, {4, 9}, {7, 9}};
+  for (auto & cell : obstacles) {
+    addObservation(full_olayer, cell.first, cell.second, MAX_Z);
+    addObservation(incr_olayer, cell.first, cell.second, MAX_Z);
+  }
+  compare();
+  ASSERT_EQ(countValues(*incr_layers.getCostmap(), nav2_costmap_2d::LETHAL_OBSTACLE), 4u);
+
+  // Clear the obstacle at <4, 9> with a ray from <0, 9>, marking <7, 9> again.
+  // The cells it was the nearest obstacle of fall back on the others, <4, 8>
+  // on <6, 6>, which is only reached past cells as close to <4, 5>
+  full_olayer->clearStaticObservations(true, true);
+  incr_olayer->clearStaticObservations(true, true);
+  addObservation(full_olayer, 7, 9, 0.0, 0.0, 9.0);
+  addObservation(incr_olayer, 7, 9, 0.0, 0.0, 9.0);
+  compare();
+  ASSERT_NE(incr_layers.getCostmap()->getCost(4, 9), nav2_costmap_2d::LETHAL_OBSTACLE);
+  ASSERT_EQ(countValues(*incr_layers.getCostmap(), nav2_costmap_2d::LETHAL_OBSTACLE), 3u);
+}
+
+/**
+ * Test that a tiled update of the obstacle and inflation layers produces
+ * the same costmap as the single-threaded update
+ */
+TEST_F(TestNode, testTiledUpdateMatchesSerialUpdate)
+{
+  initNode(4.1);
+  tf2_ros::Buffer tf(node_->get_clock());
+
+  nav2_costmap_2d::LayeredCostmap serial_layers("frame", false, false);
+  serial_layers.resizeMap(30, 30, 1, 0, 0);
+  std::vector<Point> polygon = setRadii(serial_layers, 2.1, 2.3);
+  nav2_costmap_2d::ObstacleLayer * serial_olayer = addObstacleLayer(serial_layers, tf, node_);
+  addInflationLayer(serial_layers, tf, node_);
+  serial_layers.setFootprint(polygon);
+
+  nav2_costmap_2d::LayeredCostmap tiled_layers("frame", false, false);
+  tiled_layers.resizeMap(30, 30, 1, 0, 0);
+  setRadii(tiled_layers, 2.1, 2.3);
+  nav2_costmap_2d::ObstacleLayer * tiled_olayer = addObstacleLayer(tiled_layers, tf, node_);
+  addInflationLayer(tiled_layers, tf, node_);
+  tiled_layers.setFootprint(polygon);
+  // Tiles smaller than the inflation radius, so every tile relies on its halo
+  tiled_layers.setTiledUpdate(3, 4);
+
+  const std::vector<std::pair<double, double>> obstacles =
+  {{0, 0}, {4, 4}, {5, 5}, {12, 3}, {13, 3}, {9, 15}, {17, 20}, {29, 29}};
+  for (const auto & obstacle : obstacles) {
+    addObservation(serial_olayer, obstacle.first, obstacle.second, MAX_Z);
+    addObservation(tiled_olayer, obstacle.first, obstacle.second, MAX_Z);
+  }
+
+  serial_layers.updateMap(0, 0, 0);
+  tiled_layers.updateMap(0, 0, 0);
+
+  nav2_costmap_2d::Costmap2D * serial_costmap = serial_layers.getCostmap();
+  nav2_costmap_2d::Costmap2D * tiled_costmap = tiled_layers.getCostmap();
+  for (unsigned int j = 0; j < 30; ++j) {
+    for (unsigned int i = 0; i < 30; ++i) {
+      ASSERT_EQ(serial_costmap->getCost(i, j), tiled_costmap->getCost(i, j));
+    }
+  }
+}
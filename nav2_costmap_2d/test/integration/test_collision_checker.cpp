@@ -184,6 +184,19 @@ public:
     return collision_checker_->isCollisionFree(pose);
   }
 
+  bool testPath(const std::vector<geometry_msgs::msg::Pose2D> & path)
+  {
+    // The robot is at the start of the path
+    const geometry_msgs::msg::Pose2D & start = path.front();
+    publishPose(start.x, start.y, start.theta);
+
+    setPose(start.x, start.y, start.theta);
+    publishFootprint();
+    publishCostmap();
+    rclcpp::sleep_for(std::chrono::milliseconds(50));
+    return collision_checker_->isPathCollisionFree(path);
+  }
+
   void setFootprint(double footprint_padding, double robot_radius)
   {
     std::vector<geometry_msgs::msg::Point> new_footprint;
@@ -336,3 +349,29 @@ TEST_F(TestNode, CollisionSpace)
   // Partially in obstacle
   ASSERT_EQ(collision_checker_->testPose(4.5, 4.5, 0), false);
 }
+
+TEST_F(TestNode, PathCollision)
+{
+  collision_checker_->setFootprint(0, 1);
+
+  auto pose = [](double x, double y, double theta) {
+      geometry_msgs::msg::Pose2D pose2d;
+      pose2d.x = x;
+      pose2d.y = y;
+      pose2d.theta = theta;
+      return pose2d;
+    };
+
+  // Spinning in place in free space
+  std::vector<geometry_msgs::msg::Pose2D> spin;
+  for (int i = 0; i <= 8; ++i) {
+    spin.push_back(pose(2, 8.5, i * M_PI / 8));
+  }
+  ASSERT_EQ(collision_checker_->testPath(spin), true);
+
+  // Ends in an obstacle
+  ASSERT_EQ(collision_checker_->testPath({pose(2, 8.5, 0), pose(8.5, 6.5, 0)}), false);
+
+  // Goes off the map
+  ASSERT_EQ(collision_checker_->testPath({pose(2, 8.5, 0), pose(5, 13, 0)}), false);
+}
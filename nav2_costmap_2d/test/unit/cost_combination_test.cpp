@@ -0,0 +1,81 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/cost_combination.hpp"
+
+// Every pair of costs, laid out at every alignment and with a partial tail
+static void pairs(std::vector<unsigned char> & master, std::vector<unsigned char> & layer)
+{
+  master.resize(256 * 256 + 7);
+  layer.resize(master.size());
+  for (unsigned int i = 0; i < master.size(); ++i) {
+    master[i] = static_cast<unsigned char>(i % 256);
+    layer[i] = static_cast<unsigned char>((i / 256) % 256);
+  }
+}
+
+TEST(cost_combination, max_matches_scalar)
+{
+  std::vector<unsigned char> master, layer;
+  pairs(master, layer);
+  std::vector<unsigned char> combined(master);
+  nav2_costmap_2d::combineMax(layer.data(), layer.size(), combined.data());
+
+  for (unsigned int i = 0; i < master.size(); ++i) {
+    EXPECT_EQ(combined[i], nav2_costmap_2d::combineMax(master[i], layer[i])) <<
+      "master " << +master[i] << " layer " << +layer[i];
+  }
+}
+
+TEST(cost_combination, overwrite_matches_scalar)
+{
+  std::vector<unsigned char> master, layer;
+  pairs(master, layer);
+  std::vector<unsigned char> combined(master);
+  nav2_costmap_2d::combineOverwrite(layer.data(), layer.size(), combined.data());
+
+  for (unsigned int i = 0; i < master.size(); ++i) {
+    EXPECT_EQ(combined[i], nav2_costmap_2d::combineOverwrite(master[i], layer[i])) <<
+      "master " << +master[i] << " layer " << +layer[i];
+  }
+}
+
+TEST(cost_combination, addition_matches_scalar)
+{
+  std::vector<unsigned char> master, layer;
+  pairs(master, layer);
+  std::vector<unsigned char> combined(master);
+  nav2_costmap_2d::combineAddition(layer.data(), layer.size(), combined.data());
+
+  for (unsigned int i = 0; i < master.size(); ++i) {
+    EXPECT_EQ(combined[i], nav2_costmap_2d::combineAddition(master[i], layer[i])) <<
+      "master " << +master[i] << " layer " << +layer[i];
+  }
+}
+
+TEST(cost_combination, unknown_costs)
+{
+  using nav2_costmap_2d::NO_INFORMATION;
+  EXPECT_EQ(nav2_costmap_2d::combineMax(NO_INFORMATION, 10), 10);
+  EXPECT_EQ(nav2_costmap_2d::combineMax(10, NO_INFORMATION), 10);
+  EXPECT_EQ(nav2_costmap_2d::combineMax(200, 10), 200);
+  EXPECT_EQ(nav2_costmap_2d::combineOverwrite(200, 10), 10);
+  EXPECT_EQ(nav2_costmap_2d::combineOverwrite(200, NO_INFORMATION), 200);
+  EXPECT_EQ(nav2_costmap_2d::combineAddition(NO_INFORMATION, 10), 10);
+  EXPECT_EQ(nav2_costmap_2d::combineAddition(200, 100), 252);
+  EXPECT_EQ(nav2_costmap_2d::combineAddition(100, 100), 200);
+}
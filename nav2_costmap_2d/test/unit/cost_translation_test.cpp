@@ -0,0 +1,43 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/cost_translation.hpp"
+
+TEST(cost_translation, matches_scalar_translation)
+{
+  // All values, at every alignment and with a partial tail
+  std::vector<unsigned char> costs(256 * 3 + 7);
+  for (unsigned int i = 0; i < costs.size(); ++i) {
+    costs[i] = static_cast<unsigned char>((i * 7) % 256);
+  }
+  std::vector<int8_t> occupancy(costs.size());
+  nav2_costmap_2d::translateCosts(costs.data(), costs.size(), occupancy.data());
+
+  for (unsigned int i = 0; i < costs.size(); ++i) {
+    EXPECT_EQ(occupancy[i], nav2_costmap_2d::translateCost(costs[i])) << "cost " << +costs[i];
+  }
+}
+
+TEST(cost_translation, special_values)
+{
+  EXPECT_EQ(nav2_costmap_2d::translateCost(0), 0);
+  EXPECT_EQ(nav2_costmap_2d::translateCost(1), 1);
+  EXPECT_EQ(nav2_costmap_2d::translateCost(252), 98);
+  EXPECT_EQ(nav2_costmap_2d::translateCost(253), 99);
+  EXPECT_EQ(nav2_costmap_2d::translateCost(254), 100);
+  EXPECT_EQ(nav2_costmap_2d::translateCost(255), -1);
+}
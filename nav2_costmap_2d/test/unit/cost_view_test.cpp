@@ -0,0 +1,68 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/costmap_2d.hpp"
+#include "nav2_costmap_2d/cost_values.hpp"
+#include "nav2_costmap_2d/cost_view.hpp"
+
+TEST(cost_view, reads_the_costs_of_the_costmap)
+{
+  nav2_costmap_2d::Costmap2D costmap(
+    23, 17, 0.05, -0.4, 1.3, nav2_costmap_2d::NO_INFORMATION);
+  for (unsigned int y = 0; y < costmap.getSizeInCellsY(); ++y) {
+    for (unsigned int x = 0; x < costmap.getSizeInCellsX(); ++x) {
+      costmap.setCost(x, y, static_cast<unsigned char>((x * 7 + y * 13) % 255));
+    }
+  }
+
+  nav2_costmap_2d::CostView view(costmap);
+  ASSERT_TRUE(view.valid());
+  ASSERT_EQ(view.getSizeInCellsX(), 23u);
+  ASSERT_EQ(view.getSizeInCellsY(), 17u);
+  for (unsigned int y = 0; y < 17; ++y) {
+    for (unsigned int x = 0; x < 23; ++x) {
+      ASSERT_EQ(view.getCost(x, y), costmap.getCost(x, y));
+      ASSERT_EQ(view.row(y)[x], costmap.getCost(x, y));
+    }
+  }
+}
+
+TEST(cost_view, finds_the_cells_the_costmap_does)
+{
+  nav2_costmap_2d::Costmap2D costmap(
+    23, 17, 0.05, -0.4, 1.3, nav2_costmap_2d::FREE_SPACE);
+  nav2_costmap_2d::CostView view(costmap);
+
+  // around and on the cell borders, off the grid on every side
+  for (double wx = -0.5; wx < 0.8; wx += 0.0125) {
+    for (double wy = 1.2; wy < 2.3; wy += 0.0125) {
+      unsigned int mx = 0, my = 0, view_mx = 0, view_my = 0;
+      bool on_grid = costmap.worldToMap(wx, wy, mx, my);
+      ASSERT_EQ(view.worldToMap(wx, wy, view_mx, view_my), on_grid);
+      if (on_grid) {
+        ASSERT_EQ(view_mx, mx);
+        ASSERT_EQ(view_my, my);
+      }
+    }
+  }
+}
+
+TEST(cost_view, is_invalid_until_taken_from_a_costmap)
+{
+  nav2_costmap_2d::CostView view;
+  EXPECT_FALSE(view.valid());
+  EXPECT_EQ(view.getSizeInCellsX(), 0u);
+  EXPECT_EQ(view.getSizeInCellsY(), 0u);
+}
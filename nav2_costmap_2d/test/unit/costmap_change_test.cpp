@@ -0,0 +1,138 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/costmap_2d.hpp"
+
+TEST(costmap_change, unions_the_regions_reset_since)
+{
+  nav2_costmap_2d::Costmap2D costmap(40, 30, 1.0, 0.0, 0.0);
+  uint64_t since = costmap.getChangeCount();
+
+  unsigned int x0, y0, xn, yn;
+  ASSERT_TRUE(costmap.getChangedBounds(since, x0, y0, xn, yn));
+  EXPECT_LE(xn, x0);  // nothing changed
+
+  costmap.resetMap(2, 3, 10, 8);
+  costmap.resetMapToValue(5, 1, 12, 4, 100);
+  costmap.markChanged(20, 20, 21, 21);
+  ASSERT_TRUE(costmap.getChangedBounds(since, x0, y0, xn, yn));
+  EXPECT_EQ(x0, 2u);
+  EXPECT_EQ(y0, 1u);
+  EXPECT_EQ(xn, 21u);
+  EXPECT_EQ(yn, 21u);
+
+  // only the changes after the given count are included
+  since = costmap.getChangeCount();
+  costmap.resetMap(30, 25, 35, 28);
+  ASSERT_TRUE(costmap.getChangedBounds(since, x0, y0, xn, yn));
+  EXPECT_EQ(x0, 30u);
+  EXPECT_EQ(y0, 25u);
+  EXPECT_EQ(xn, 35u);
+  EXPECT_EQ(yn, 28u);
+}
+
+TEST(costmap_change, whole_map_changes_need_a_full_refresh)
+{
+  nav2_costmap_2d::Costmap2D costmap(40, 30, 1.0, 0.0, 0.0);
+  unsigned int x0, y0, xn, yn;
+
+  uint64_t since = costmap.getChangeCount();
+  costmap.updateOrigin(0.0, 0.0);  // no shift, nothing moves
+  EXPECT_TRUE(costmap.getChangedBounds(since, x0, y0, xn, yn));
+  costmap.updateOrigin(3.0, 0.0);
+  EXPECT_FALSE(costmap.getChangedBounds(since, x0, y0, xn, yn));
+
+  since = costmap.getChangeCount();
+  costmap.resizeMap(20, 20, 1.0, 0.0, 0.0);
+  EXPECT_FALSE(costmap.getChangedBounds(since, x0, y0, xn, yn));
+
+  // more changes than the history holds
+  since = costmap.getChangeCount();
+  for (int i = 0; i < 100; ++i) {
+    costmap.resetMap(0, 0, 1, 1);
+  }
+  EXPECT_FALSE(costmap.getChangedBounds(since, x0, y0, xn, yn));
+}
+
+TEST(costmap_change, reset_outside_keeps_the_window)
+{
+  nav2_costmap_2d::Costmap2D costmap(40, 30, 1.0, 0.0, 0.0, 7);
+  uint64_t since = costmap.getChangeCount();
+
+  costmap.resetMapOutside(5, 10, 12, 20, 100);
+  for (unsigned int y = 0; y < 30; ++y) {
+    for (unsigned int x = 0; x < 40; ++x) {
+      bool kept = x >= 5 && x < 12 && y >= 10 && y < 20;
+      ASSERT_EQ(costmap.getCost(x, y), kept ? 7 : 100) << x << ", " << y;
+    }
+  }
+  unsigned int x0, y0, xn, yn;
+  ASSERT_TRUE(costmap.getChangedBounds(since, x0, y0, xn, yn));
+  EXPECT_EQ(x0, 0u);
+  EXPECT_EQ(y0, 0u);
+  EXPECT_EQ(xn, 40u);
+  EXPECT_EQ(yn, 30u);
+
+  // a window reaching past the map is clamped to it
+  costmap.resetMapOutside(-10, 25, 50, 60, 50);
+  EXPECT_EQ(costmap.getCost(39, 29), 100);
+  EXPECT_EQ(costmap.getCost(0, 24), 50);
+
+  // an empty window resets everything
+  costmap.resetMapOutside(20, 20, 20, 40, 1);
+  for (unsigned int y = 0; y < 30; ++y) {
+    for (unsigned int x = 0; x < 40; ++x) {
+      ASSERT_EQ(costmap.getCost(x, y), 1);
+    }
+  }
+}
+
+TEST(costmap_change, tiles_changed_since)
+{
+  // 3 x 2 tiles, the last column and row partial
+  nav2_costmap_2d::Costmap2D costmap(70, 40, 1.0, 0.0, 0.0);
+  ASSERT_EQ(costmap.getChangeTileSize(), 32u);
+  ASSERT_EQ(costmap.getNumChangeTilesX(), 3u);
+  ASSERT_EQ(costmap.getNumChangeTilesY(), 2u);
+
+  std::vector<unsigned int> tiles;
+  costmap.getChangedTiles(0, tiles);
+  EXPECT_EQ(tiles, std::vector<unsigned int>({0, 1, 2, 3, 4, 5}));
+
+  uint64_t since = costmap.getChangeCount();
+  costmap.getChangedTiles(since, tiles);
+  EXPECT_TRUE(tiles.empty());
+
+  costmap.resetMap(31, 10, 33, 11);
+  uint64_t between = costmap.getChangeCount();
+  costmap.resetMap(65, 35, 70, 40);
+  costmap.getChangedTiles(since, tiles);
+  EXPECT_EQ(tiles, std::vector<unsigned int>({0, 1, 5}));
+  costmap.getChangedTiles(between, tiles);
+  EXPECT_EQ(tiles, std::vector<unsigned int>({5}));
+
+  // far more changes than the bounds history holds
+  for (int i = 0; i < 100; ++i) {
+    costmap.resetMap(0, 39, 1, 40);
+  }
+  costmap.getChangedTiles(between, tiles);
+  EXPECT_EQ(tiles, std::vector<unsigned int>({3, 5}));
+
+  costmap.resizeMap(10, 10, 1.0, 0.0, 0.0);
+  costmap.getChangedTiles(between, tiles);
+  EXPECT_EQ(tiles, std::vector<unsigned int>({0}));
+}
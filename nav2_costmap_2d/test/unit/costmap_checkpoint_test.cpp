@@ -0,0 +1,125 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/costmap_checkpoint.hpp"
+#include "nav2_costmap_2d/cost_values.hpp"
+
+using nav2_costmap_2d::Costmap2D;
+using nav2_costmap_2d::CostmapCheckpoint;
+
+namespace
+{
+
+unsigned char cellValue(int x, int y)
+{
+  return static_cast<unsigned char>(x > 5 && y < 3 ? 254 : (x / 4 + y / 4) % 3);
+}
+
+void fill(Costmap2D & costmap)
+{
+  for (unsigned int y = 0; y < costmap.getSizeInCellsY(); ++y) {
+    for (unsigned int x = 0; x < costmap.getSizeInCellsX(); ++x) {
+      costmap.setCost(x, y, cellValue(x, y));
+    }
+  }
+}
+
+std::string checkpointFile()
+{
+  return ::testing::TempDir() + "costmap_checkpoint_test.bin";
+}
+
+}  // namespace
+
+TEST(costmap_checkpoint, restores_the_saved_costmaps)
+{
+  Costmap2D master(20, 12, 0.5, -1.0, 2.0, nav2_costmap_2d::NO_INFORMATION);
+  Costmap2D layer(20, 12, 0.5, -1.0, 2.0, nav2_costmap_2d::FREE_SPACE);
+  fill(master);
+  layer.setCost(3, 4, nav2_costmap_2d::LETHAL_OBSTACLE);
+
+  CostmapCheckpoint saved;
+  saved.add("", master);
+  saved.add("obstacle_layer", layer);
+  ASSERT_TRUE(saved.write(checkpointFile()));
+
+  CostmapCheckpoint loaded;
+  ASSERT_TRUE(loaded.read(checkpointFile()));
+  ASSERT_EQ(loaded.grids().size(), 2u);
+  EXPECT_EQ(loaded.grids()[1].name, "obstacle_layer");
+  EXPECT_EQ(loaded.find("static_layer"), nullptr);
+
+  Costmap2D restored(20, 12, 0.5, -1.0, 2.0, nav2_costmap_2d::NO_INFORMATION);
+  ASSERT_TRUE(loaded.restore("", restored));
+  for (unsigned int y = 0; y < 12; ++y) {
+    for (unsigned int x = 0; x < 20; ++x) {
+      ASSERT_EQ(restored.getCost(x, y), cellValue(x, y));
+    }
+  }
+  ASSERT_TRUE(loaded.restore("obstacle_layer", restored));
+  EXPECT_EQ(restored.getCost(3, 4), nav2_costmap_2d::LETHAL_OBSTACLE);
+  EXPECT_EQ(restored.getCost(4, 4), nav2_costmap_2d::FREE_SPACE);
+
+  // not a costmap of the same size and resolution
+  Costmap2D other(20, 13, 0.5, -1.0, 2.0, 0);
+  EXPECT_FALSE(loaded.restore("", other));
+  std::remove(checkpointFile().c_str());
+}
+
+TEST(costmap_checkpoint, moves_the_cells_to_the_origin_of_the_costmap)
+{
+  Costmap2D saved_map(10, 8, 0.5, 0.0, 0.0, 0);
+  fill(saved_map);
+  CostmapCheckpoint checkpoint;
+  checkpoint.add("", saved_map);
+
+  // moved by 3 cells in x and -2 in y, with a rounding error
+  Costmap2D costmap(10, 8, 0.5, 1.5 + 1e-9, -1.0, nav2_costmap_2d::NO_INFORMATION);
+  ASSERT_TRUE(checkpoint.restore("", costmap));
+  for (int y = 0; y < 8; ++y) {
+    for (int x = 0; x < 10; ++x) {
+      int saved_x = x + 3, saved_y = y - 2;
+      bool kept = saved_x < 10 && saved_y >= 0;
+      ASSERT_EQ(
+        costmap.getCost(x, y),
+        kept ? cellValue(saved_x, saved_y) : nav2_costmap_2d::NO_INFORMATION);
+    }
+  }
+}
+
+TEST(costmap_checkpoint, rejects_other_files)
+{
+  CostmapCheckpoint checkpoint;
+  EXPECT_FALSE(checkpoint.read(checkpointFile() + ".missing"));
+
+  Costmap2D costmap(6, 6, 1.0, 0.0, 0.0, 0);
+  checkpoint.add("", costmap);
+  ASSERT_TRUE(checkpoint.write(checkpointFile()));
+  {
+    // cut short in the middle of the costs
+    std::ifstream in(checkpointFile(), std::ios::binary);
+    std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    std::ofstream out(checkpointFile(), std::ios::binary | std::ios::trunc);
+    out.write(data.data(), data.size() - 1);
+  }
+  EXPECT_FALSE(checkpoint.read(checkpointFile()));
+  EXPECT_TRUE(checkpoint.grids().empty());
+  std::remove(checkpointFile().c_str());
+}
@@ -0,0 +1,51 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/costmap_encoding.hpp"
+
+TEST(costmap_encoding, round_trip)
+{
+  // Runs shorter and longer than what fits into a single varint byte
+  std::vector<unsigned char> costs;
+  costs.insert(costs.end(), 100000, 0);
+  costs.insert(costs.end(), 3, 254);
+  costs.push_back(7);
+  costs.insert(costs.end(), 200, 255);
+
+  std::vector<uint8_t> encoded;
+  nav2_costmap_2d::encodeRunLength(costs.data(), costs.size(), encoded);
+  EXPECT_EQ(encoded.size(), 4u + 2u + 2u + 3u);
+
+  std::vector<unsigned char> decoded(costs.size());
+  ASSERT_TRUE(nav2_costmap_2d::decodeRunLength(encoded, decoded.size(), decoded.data()));
+  EXPECT_EQ(decoded, costs);
+}
+
+TEST(costmap_encoding, rejects_malformed_runs)
+{
+  std::vector<unsigned char> costs(10, 0);
+  std::vector<uint8_t> encoded;
+  nav2_costmap_2d::encodeRunLength(costs.data(), costs.size(), encoded);
+
+  std::vector<unsigned char> decoded(11);
+  EXPECT_FALSE(nav2_costmap_2d::decodeRunLength(encoded, 9, decoded.data()));
+  EXPECT_FALSE(nav2_costmap_2d::decodeRunLength(encoded, 11, decoded.data()));
+
+  // Truncated run length
+  std::vector<uint8_t> truncated{0, 0x80};
+  EXPECT_FALSE(nav2_costmap_2d::decodeRunLength(truncated, 10, decoded.data()));
+}
@@ -0,0 +1,67 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "geometry_msgs/msg/transform_stamped.hpp"
+#include "lifecycle_msgs/msg/state.hpp"
+#include "nav2_costmap_2d/costmap_2d_ros.hpp"
+
+using namespace std::chrono_literals;
+
+class RclCppFixture
+{
+public:
+  RclCppFixture() {rclcpp::init(0, nullptr);}
+  ~RclCppFixture() {rclcpp::shutdown();}
+};
+RclCppFixture g_rclcppfixture;
+
+TEST(CostmapOnDemand, ClearWakesTheIdleLoop)
+{
+  auto costmap = std::make_shared<nav2_costmap_2d::Costmap2DROS>("on_demand_costmap");
+  costmap->set_parameter(rclcpp::Parameter("plugin_names", std::vector<std::string>()));
+  costmap->set_parameter(rclcpp::Parameter("plugin_types", std::vector<std::string>()));
+  costmap->set_parameter(rclcpp::Parameter("on_demand", true));
+  // no keepalive, so the loop idles until it is woken
+  costmap->set_parameter(rclcpp::Parameter("idle_update_frequency", 0.0));
+  costmap->set_parameter(rclcpp::Parameter("demand_timeout", 0.0));
+  ASSERT_EQ(costmap->configure().id(), lifecycle_msgs::msg::State::PRIMARY_STATE_INACTIVE);
+
+  geometry_msgs::msg::TransformStamped transform;
+  transform.header.frame_id = costmap->getGlobalFrameID();
+  transform.child_frame_id = costmap->getBaseFrameID();
+  transform.transform.rotation.w = 1.0;
+  costmap->getTfBuffer()->setTransform(transform, "test", true);
+  ASSERT_EQ(costmap->activate().id(), lifecycle_msgs::msg::State::PRIMARY_STATE_ACTIVE);
+
+  // let the loop run its first update and go idle
+  std::this_thread::sleep_for(500ms);
+
+  std::atomic<bool> cleared{false};
+  auto applied = costmap->getLayeredCostmap()->requestClear([&cleared]() {cleared = true;});
+  EXPECT_EQ(applied.wait_for(2s), std::future_status::ready);
+  EXPECT_TRUE(cleared);
+
+  costmap->deactivate();
+  costmap->cleanup();
+}
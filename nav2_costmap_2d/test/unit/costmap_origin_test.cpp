@@ -0,0 +1,97 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/costmap_2d.hpp"
+#include "nav2_costmap_2d/cost_values.hpp"
+
+namespace
+{
+
+unsigned char cellValue(int x, int y)
+{
+  return static_cast<unsigned char>((x * 7 + y * 13) % 250);
+}
+
+void fill(nav2_costmap_2d::Costmap2D & costmap, int origin_x, int origin_y)
+{
+  for (unsigned int y = 0; y < costmap.getSizeInCellsY(); ++y) {
+    for (unsigned int x = 0; x < costmap.getSizeInCellsX(); ++x) {
+      costmap.setCost(x, y, cellValue(origin_x + x, origin_y + y));
+    }
+  }
+}
+
+}  // namespace
+
+TEST(costmap_origin, keeps_the_overlap_and_resets_the_rest)
+{
+  unsigned int size_x = 23, size_y = 17;
+  int shifts[][2] = {{3, 2}, {-4, 1}, {0, -5}, {7, -3}, {0, 0}, {-22, 16}, {40, 0}};
+  for (auto & shift : shifts) {
+    nav2_costmap_2d::Costmap2D costmap(
+      size_x, size_y, 1.0, 0.0, 0.0, nav2_costmap_2d::NO_INFORMATION);
+    fill(costmap, 0, 0);
+
+    costmap.updateOrigin(shift[0], shift[1]);
+    EXPECT_DOUBLE_EQ(costmap.getOriginX(), shift[0]);
+    EXPECT_DOUBLE_EQ(costmap.getOriginY(), shift[1]);
+
+    for (unsigned int y = 0; y < size_y; ++y) {
+      for (unsigned int x = 0; x < size_x; ++x) {
+        int old_x = x + shift[0];
+        int old_y = y + shift[1];
+        bool kept = old_x >= 0 && old_y >= 0 &&
+          old_x < static_cast<int>(size_x) && old_y < static_cast<int>(size_y);
+        ASSERT_EQ(
+          costmap.getCost(x, y),
+          kept ? cellValue(old_x, old_y) : nav2_costmap_2d::NO_INFORMATION);
+      }
+    }
+  }
+}
+
+TEST(costmap_origin, copies_a_window_into_the_same_cells)
+{
+  nav2_costmap_2d::Costmap2D costmap(
+    20, 15, 0.5, 1.0, 2.0, nav2_costmap_2d::NO_INFORMATION);
+  fill(costmap, 0, 0);
+
+  nav2_costmap_2d::Costmap2D snapshot;
+  snapshot.copyWindowFrom(costmap, 4, 3, 12, 9);
+  ASSERT_EQ(snapshot.getSizeInCellsX(), 20u);
+  ASSERT_EQ(snapshot.getSizeInCellsY(), 15u);
+  EXPECT_DOUBLE_EQ(snapshot.getResolution(), 0.5);
+  EXPECT_DOUBLE_EQ(snapshot.getOriginX(), 1.0);
+  EXPECT_DOUBLE_EQ(snapshot.getOriginY(), 2.0);
+  for (unsigned int y = 0; y < 15; ++y) {
+    for (unsigned int x = 0; x < 20; ++x) {
+      bool in_window = x >= 4 && x < 12 && y >= 3 && y < 9;
+      ASSERT_EQ(
+        snapshot.getCost(x, y),
+        in_window ? cellValue(x, y) : nav2_costmap_2d::NO_INFORMATION);
+    }
+  }
+
+  // the grid is kept, and only the window is copied again, clipped to the costmap
+  const unsigned char * grid = snapshot.getCharMap();
+  costmap.updateOrigin(1.5, 2.0);
+  fill(costmap, 1, 0);
+  snapshot.copyWindowFrom(costmap, 15, 10, 30, 30);
+  EXPECT_EQ(snapshot.getCharMap(), grid);
+  EXPECT_DOUBLE_EQ(snapshot.getOriginX(), 1.5);
+  EXPECT_EQ(snapshot.getCost(19, 14), cellValue(20, 14));
+  EXPECT_EQ(snapshot.getCost(15, 10), cellValue(16, 10));
+  EXPECT_EQ(snapshot.getCost(4, 3), cellValue(4, 3));
+}
@@ -0,0 +1,137 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/costmap_2d.hpp"
+#include "nav2_costmap_2d/cost_values.hpp"
+#include "nav2_costmap_2d/costmap_pyramid.hpp"
+
+namespace
+{
+
+// Each cell of a level against the highest cost of the master cells it covers
+void expectPooled(
+  const nav2_costmap_2d::Costmap2D & costmap,
+  const nav2_costmap_2d::CostmapPyramid & pyramid)
+{
+  for (unsigned int level = 1; level <= pyramid.getNumLevels(); ++level) {
+    const nav2_costmap_2d::Costmap2D & coarse = pyramid.getLevel(level);
+    unsigned int factor = 1u << level;
+    ASSERT_EQ((costmap.getSizeInCellsX() + factor - 1) / factor, coarse.getSizeInCellsX());
+    ASSERT_EQ((costmap.getSizeInCellsY() + factor - 1) / factor, coarse.getSizeInCellsY());
+    EXPECT_DOUBLE_EQ(costmap.getResolution() * factor, coarse.getResolution());
+    EXPECT_DOUBLE_EQ(costmap.getOriginX(), coarse.getOriginX());
+    for (unsigned int y = 0; y < coarse.getSizeInCellsY(); ++y) {
+      for (unsigned int x = 0; x < coarse.getSizeInCellsX(); ++x) {
+        unsigned char expected = 0;
+        unsigned int end_y = std::min((y + 1) * factor, costmap.getSizeInCellsY());
+        unsigned int end_x = std::min((x + 1) * factor, costmap.getSizeInCellsX());
+        for (unsigned int fy = y * factor; fy < end_y; ++fy) {
+          for (unsigned int fx = x * factor; fx < end_x; ++fx) {
+            expected = std::max(expected, costmap.getCost(fx, fy));
+          }
+        }
+        ASSERT_EQ(expected, coarse.getCost(x, y)) << level << " " << x << " " << y;
+      }
+    }
+  }
+}
+
+}  // namespace
+
+TEST(costmap_pyramid, max_pools_every_level)
+{
+  nav2_costmap_2d::Costmap2D costmap(45, 30, 0.05, 1.0, -2.0, nav2_costmap_2d::FREE_SPACE);
+  srand(3);
+  for (unsigned int i = 0; i < 200; ++i) {
+    costmap.setCost(rand() % 45, rand() % 30, rand() % 256);
+  }
+
+  nav2_costmap_2d::CostmapPyramid pyramid(3);
+  pyramid.update(costmap, 0, 0, 0, 0);
+  expectPooled(costmap, pyramid);
+}
+
+TEST(costmap_pyramid, updates_only_the_changed_area)
+{
+  nav2_costmap_2d::Costmap2D costmap(64, 41, 0.1, 0.0, 0.0, nav2_costmap_2d::FREE_SPACE);
+  nav2_costmap_2d::CostmapPyramid pyramid(4);
+  pyramid.update(costmap, 0, 0, 64, 41);
+
+  srand(5);
+  for (unsigned int cycle = 0; cycle < 50; ++cycle) {
+    int x0 = rand() % 64, y0 = rand() % 41;
+    int xn = std::min(64, x0 + 1 + rand() % 10), yn = std::min(41, y0 + 1 + rand() % 10);
+    for (int y = y0; y < yn; ++y) {
+      for (int x = x0; x < xn; ++x) {
+        costmap.setCost(x, y, rand() % 3 ? nav2_costmap_2d::FREE_SPACE : rand() % 256);
+      }
+    }
+    pyramid.update(costmap, x0, y0, xn, yn);
+    expectPooled(costmap, pyramid);
+  }
+
+  // a moved or resized costmap is rebuilt from scratch
+  costmap.updateOrigin(1.0, 0.5);
+  costmap.setCost(63, 40, nav2_costmap_2d::LETHAL_OBSTACLE);
+  pyramid.update(costmap, 63, 40, 64, 41);
+  expectPooled(costmap, pyramid);
+
+  costmap.resizeMap(17, 9, 0.2, 0.0, 0.0);
+  costmap.setCost(16, 8, nav2_costmap_2d::NO_INFORMATION);
+  pyramid.update(costmap, 16, 8, 17, 9);
+  expectPooled(costmap, pyramid);
+}
+
+TEST(costmap_pyramid, pools_a_region)
+{
+  nav2_costmap_2d::Costmap2D costmap(50, 37, 0.1, 0.0, 0.0, nav2_costmap_2d::FREE_SPACE);
+  srand(7);
+  for (unsigned int i = 0; i < 300; ++i) {
+    costmap.setCost(rand() % 50, rand() % 37, rand() % 256);
+  }
+
+  const unsigned int x0 = 3, y0 = 5, xn = 47, yn = 36;
+  for (unsigned int factor = 1; factor <= 5; ++factor) {
+    std::vector<unsigned char> costs;
+    unsigned int size_x, size_y;
+    nav2_costmap_2d::poolRegion(costmap, x0, y0, xn, yn, factor, costs, size_x, size_y);
+    ASSERT_EQ((xn - x0 + factor - 1) / factor, size_x);
+    ASSERT_EQ((yn - y0 + factor - 1) / factor, size_y);
+    ASSERT_EQ(size_x * size_y, costs.size());
+
+    for (unsigned int y = 0; y < size_y; ++y) {
+      for (unsigned int x = 0; x < size_x; ++x) {
+        unsigned char expected = 0;
+        for (unsigned int fy = y0 + y * factor; fy < std::min(y0 + (y + 1) * factor, yn); ++fy) {
+          for (unsigned int fx = x0 + x * factor; fx < std::min(x0 + (x + 1) * factor, xn); ++fx) {
+            expected = std::max(expected, costmap.getCost(fx, fy));
+          }
+        }
+        ASSERT_EQ(expected, costs[y * size_x + x]) << factor << " " << x << " " << y;
+      }
+    }
+  }
+
+  // an empty area gives an empty copy
+  std::vector<unsigned char> costs;
+  unsigned int size_x, size_y;
+  nav2_costmap_2d::poolRegion(costmap, 10, 10, 10, 20, 2, costs, size_x, size_y);
+  EXPECT_EQ(0u, size_x);
+  EXPECT_TRUE(costs.empty());
+}
@@ -0,0 +1,124 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/costmap_recorder.hpp"
+#include "nav2_costmap_2d/cost_values.hpp"
+
+using nav2_costmap_2d::Costmap2D;
+using nav2_costmap_2d::CostmapRecorder;
+
+namespace
+{
+
+const int64_t SECOND = 1000000000;
+
+std::string recordingFile()
+{
+  return ::testing::TempDir() + "costmap_recorder_test.bin";
+}
+
+void setCost(Costmap2D & costmap, unsigned int x, unsigned int y, unsigned char cost)
+{
+  costmap.setCost(x, y, cost);
+  costmap.markChanged(x, y, x + 1, y + 1);
+}
+
+void expectSameCosts(const Costmap2D & expected, const Costmap2D & actual)
+{
+  ASSERT_EQ(expected.getSizeInCellsX(), actual.getSizeInCellsX());
+  ASSERT_EQ(expected.getSizeInCellsY(), actual.getSizeInCellsY());
+  EXPECT_EQ(expected.getOriginX(), actual.getOriginX());
+  EXPECT_EQ(expected.getOriginY(), actual.getOriginY());
+  for (unsigned int y = 0; y < expected.getSizeInCellsY(); ++y) {
+    for (unsigned int x = 0; x < expected.getSizeInCellsX(); ++x) {
+      ASSERT_EQ(expected.getCost(x, y), actual.getCost(x, y)) << x << ", " << y;
+    }
+  }
+}
+
+}  // namespace
+
+TEST(costmap_recorder, replays_the_recorded_costmap)
+{
+  Costmap2D costmap(70, 45, 0.1, 0.0, 0.0, nav2_costmap_2d::FREE_SPACE);
+  CostmapRecorder recorder(60.0, 4);
+  std::vector<Costmap2D> recorded;
+  for (int i = 0; i < 10; ++i) {
+    if (i == 6) {
+      costmap.resizeMap(40, 40, 0.1, 1.0, 1.0);
+    }
+    const unsigned int size_x = costmap.getSizeInCellsX();
+    const unsigned int size_y = costmap.getSizeInCellsY();
+    setCost(costmap, (i * 13) % size_x, (i * 7) % size_y, nav2_costmap_2d::LETHAL_OBSTACLE);
+    // in the last partial tile of the map
+    setCost(costmap, size_x - 1, size_y - 1, static_cast<unsigned char>(i + 1));
+    recorder.record(costmap, i * SECOND);
+    recorded.push_back(costmap);
+  }
+  // unchanged, nothing recorded
+  recorder.record(costmap, 10 * SECOND);
+
+  std::vector<CostmapRecorder::Frame> frames;
+  ASSERT_TRUE(recorder.write(recordingFile()));
+  ASSERT_TRUE(CostmapRecorder::read(recordingFile(), frames));
+  ASSERT_EQ(frames.size(), 10u);
+  EXPECT_TRUE(frames[0].keyframe);
+  EXPECT_FALSE(frames[1].keyframe);
+  EXPECT_EQ(frames[1].tiles.size(), 2u);
+  EXPECT_TRUE(frames[4].keyframe);
+  EXPECT_TRUE(frames[6].keyframe);
+
+  Costmap2D replayed;
+  for (std::size_t i = 0; i < frames.size(); ++i) {
+    ASSERT_TRUE(CostmapRecorder::apply(frames[i], replayed));
+    expectSameCosts(recorded[i], replayed);
+  }
+  std::remove(recordingFile().c_str());
+}
+
+TEST(costmap_recorder, keeps_a_keyframe_before_the_duration)
+{
+  Costmap2D costmap(10, 10, 1.0, 0.0, 0.0, 0);
+  CostmapRecorder recorder(2.0, 3);
+  for (int i = 0; i < 10; ++i) {
+    setCost(costmap, i, i, 1);
+    recorder.record(costmap, i * SECOND);
+  }
+  // 7 s is the start of the last 2 s, the keyframe at 6 s is needed to rebuild it
+  auto frames = recorder.frames();
+  ASSERT_EQ(frames.size(), 4u);
+  EXPECT_EQ(frames.front().stamp, 6 * SECOND);
+  EXPECT_TRUE(frames.front().keyframe);
+  EXPECT_GT(recorder.bytes(), 0u);
+}
+
+TEST(costmap_recorder, rejects_other_files)
+{
+  std::vector<CostmapRecorder::Frame> frames;
+  EXPECT_FALSE(CostmapRecorder::read(recordingFile() + ".missing", frames));
+
+  // a delta applied to a costmap of another size
+  Costmap2D costmap(10, 10, 1.0, 0.0, 0.0, 0);
+  CostmapRecorder recorder(10.0, 10);
+  recorder.record(costmap, 0);
+  setCost(costmap, 1, 1, 1);
+  recorder.record(costmap, 1);
+  Costmap2D other(5, 5, 1.0, 0.0, 0.0, 0);
+  EXPECT_FALSE(CostmapRecorder::apply(recorder.frames()[1], other));
+}
@@ -0,0 +1,97 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/costmap_2d.hpp"
+#include "nav2_costmap_2d/cost_values.hpp"
+#include "nav2_costmap_2d/distance_field.hpp"
+
+namespace
+{
+
+void expectBruteForceDistances(
+  const nav2_costmap_2d::Costmap2D & costmap,
+  const nav2_costmap_2d::DistanceField & field)
+{
+  std::vector<std::pair<int, int>> obstacles;
+  for (unsigned int y = 0; y < costmap.getSizeInCellsY(); ++y) {
+    for (unsigned int x = 0; x < costmap.getSizeInCellsX(); ++x) {
+      if (costmap.getCost(x, y) == nav2_costmap_2d::LETHAL_OBSTACLE) {
+        obstacles.emplace_back(x, y);
+      }
+    }
+  }
+
+  ASSERT_EQ(costmap.getSizeInCellsX(), field.getSizeInCellsX());
+  ASSERT_EQ(costmap.getSizeInCellsY(), field.getSizeInCellsY());
+  for (int y = 0; y < static_cast<int>(costmap.getSizeInCellsY()); ++y) {
+    for (int x = 0; x < static_cast<int>(costmap.getSizeInCellsX()); ++x) {
+      uint32_t nearest = nav2_costmap_2d::DistanceField::NO_OBSTACLE;
+      for (const auto & obstacle : obstacles) {
+        int dx = x - obstacle.first, dy = y - obstacle.second;
+        nearest = std::min(nearest, static_cast<uint32_t>(dx * dx + dy * dy));
+      }
+      ASSERT_EQ(nearest, field.getSquaredCellDistance(x, y)) << x << " " << y;
+    }
+  }
+}
+
+}  // namespace
+
+TEST(distance_field, matches_brute_force)
+{
+  nav2_costmap_2d::Costmap2D costmap(53, 37, 0.1, 0.0, 0.0, nav2_costmap_2d::FREE_SPACE);
+  srand(7);
+  for (int i = 0; i < 40; ++i) {
+    costmap.setCost(rand() % 53, rand() % 37, nav2_costmap_2d::LETHAL_OBSTACLE);
+  }
+  // costs other than lethal are not obstacles
+  costmap.setCost(3, 3, nav2_costmap_2d::INSCRIBED_INFLATED_OBSTACLE);
+  costmap.setCost(4, 3, nav2_costmap_2d::NO_INFORMATION);
+
+  nav2_costmap_2d::DistanceField field;
+  field.update(costmap);
+  expectBruteForceDistances(costmap, field);
+
+  nav2_costmap_2d::DistanceField threaded(4);
+  threaded.update(costmap);
+  expectBruteForceDistances(costmap, threaded);
+}
+
+TEST(distance_field, distances_in_meters)
+{
+  nav2_costmap_2d::Costmap2D costmap(20, 20, 0.05, 0.0, 0.0, nav2_costmap_2d::FREE_SPACE);
+  nav2_costmap_2d::DistanceField field;
+  field.update(costmap);
+  EXPECT_EQ(std::numeric_limits<double>::infinity(), field.getDistance(5, 5));
+
+  costmap.setCost(10, 10, nav2_costmap_2d::LETHAL_OBSTACLE);
+  field.update(costmap);
+  EXPECT_DOUBLE_EQ(0.0, field.getDistance(10, 10));
+  EXPECT_DOUBLE_EQ(0.25, field.getDistance(13, 14));
+  EXPECT_DOUBLE_EQ(0.5, field.getDistance(10, 0));
+
+  // follows the costmap when it is resized
+  costmap.resizeMap(30, 10, 0.1, 0.0, 0.0);
+  costmap.setCost(0, 0, nav2_costmap_2d::LETHAL_OBSTACLE);
+  field.update(costmap);
+  EXPECT_EQ(30u, field.getSizeInCellsX());
+  EXPECT_DOUBLE_EQ(2.9, field.getDistance(29, 0));
+}
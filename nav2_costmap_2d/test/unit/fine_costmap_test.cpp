@@ -0,0 +1,123 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/costmap_2d.hpp"
+#include "nav2_costmap_2d/cost_values.hpp"
+#include "nav2_costmap_2d/distance_field.hpp"
+#include "nav2_costmap_2d/fine_costmap.hpp"
+
+using nav2_costmap_2d::FineCostmap;
+
+TEST(fine_costmap, special_costs_are_kept)
+{
+  for (unsigned int cost = 0; cost <= 255; ++cost) {
+    EXPECT_EQ(FineCostmap::toCost(FineCostmap::toFineCost(cost)), cost);
+  }
+  EXPECT_EQ(FineCostmap::toFineCost(nav2_costmap_2d::NO_INFORMATION), 65535);
+
+  nav2_costmap_2d::Costmap2D costmap(10, 10, 0.1, 0.0, 0.0, nav2_costmap_2d::FREE_SPACE);
+  costmap.setCost(1, 1, nav2_costmap_2d::NO_INFORMATION);
+  costmap.setCost(2, 1, nav2_costmap_2d::INSCRIBED_INFLATED_OBSTACLE);
+  costmap.setCost(3, 1, 100);
+  FineCostmap fine;
+  fine.update(costmap, nullptr, 0, 0, 10, 10);
+  for (unsigned int y = 0; y < 10; ++y) {
+    for (unsigned int x = 0; x < 10; ++x) {
+      EXPECT_EQ(fine.getCost(x, y), FineCostmap::toFineCost(costmap.getCost(x, y)));
+    }
+  }
+}
+
+TEST(fine_costmap, exact_inflation_decay)
+{
+  const double resolution = 0.05, inscribed_radius = 0.2, cost_scaling_factor = 10.0;
+  nav2_costmap_2d::Costmap2D costmap(60, 60, resolution, 0.0, 0.0, nav2_costmap_2d::FREE_SPACE);
+  costmap.setCost(30, 30, nav2_costmap_2d::LETHAL_OBSTACLE);
+
+  // the costs the inflation layer would write, see InflationLayer::computeCost()
+  for (int y = 0; y < 60; ++y) {
+    for (int x = 0; x < 60; ++x) {
+      double distance = std::hypot(x - 30, y - 30) * resolution;
+      if (distance == 0.0 || distance > 1.0) {
+        continue;
+      } else if (distance <= inscribed_radius) {
+        costmap.setCost(x, y, nav2_costmap_2d::INSCRIBED_INFLATED_OBSTACLE);
+      } else {
+        double factor = exp(-cost_scaling_factor * (distance - inscribed_radius));
+        costmap.setCost(
+          x, y, static_cast<unsigned char>((nav2_costmap_2d::INSCRIBED_INFLATED_OBSTACLE - 1) *
+          factor));
+      }
+    }
+  }
+
+  nav2_costmap_2d::DistanceField distances;
+  distances.update(costmap);
+  FineCostmap fine;
+  fine.setInflation(inscribed_radius, cost_scaling_factor, 1.0);
+  fine.update(costmap, &distances, 0, 0, 60, 60);
+
+  // the 8 bit grid is the fine one quantized, and the fine one keeps falling off
+  // where the 8 bit one has dropped to nothing
+  unsigned int fine_steps = 0, steps = 0;
+  for (int x = 31; x < 59; ++x) {
+    EXPECT_EQ(FineCostmap::toCost(fine.getCost(x, 30)), costmap.getCost(x, 30)) << x;
+    if (x >= 35 && x < 50) {
+      EXPECT_LT(fine.getCost(x + 1, 30), fine.getCost(x, 30)) << x;
+    }
+    fine_steps += fine.getCost(x + 1, 30) != fine.getCost(x, 30);
+    steps += costmap.getCost(x + 1, 30) != costmap.getCost(x, 30);
+  }
+  EXPECT_GT(fine_steps, steps);
+}
+
+TEST(fine_costmap, updates_around_changed_areas)
+{
+  nav2_costmap_2d::Costmap2D costmap(50, 40, 0.1, 0.0, 0.0, nav2_costmap_2d::FREE_SPACE);
+  costmap.setCost(10, 10, nav2_costmap_2d::LETHAL_OBSTACLE);
+  nav2_costmap_2d::DistanceField distances;
+  distances.update(costmap);
+  FineCostmap fine;
+  fine.setInflation(0.1, 2.0, 0.5);
+  fine.update(costmap, &distances, 0, 0, 50, 40);
+
+  // only the cell of the new obstacle is in the area, its decay reaches further
+  costmap.setCost(30, 20, nav2_costmap_2d::LETHAL_OBSTACLE);
+  distances.update(costmap);
+  fine.update(costmap, &distances, 30, 20, 31, 21);
+
+  FineCostmap fresh;
+  fresh.setInflation(0.1, 2.0, 0.5);
+  fresh.update(costmap, &distances, 0, 0, 50, 40);
+  for (unsigned int y = 0; y < 40; ++y) {
+    for (unsigned int x = 0; x < 50; ++x) {
+      ASSERT_EQ(fine.getCost(x, y), fresh.getCost(x, y)) << x << " " << y;
+    }
+  }
+  EXPECT_GT(fine.getCost(33, 20), 0);
+
+  // a moved window is recomputed whole
+  costmap.updateOrigin(0.3, 0.0);
+  distances.update(costmap);
+  fine.update(costmap, &distances, 0, 0, 0, 0);
+  fresh.update(costmap, &distances, 0, 0, 50, 40);
+  for (unsigned int y = 0; y < 40; ++y) {
+    for (unsigned int x = 0; x < 50; ++x) {
+      ASSERT_EQ(fine.getCost(x, y), fresh.getCost(x, y)) << x << " " << y;
+    }
+  }
+}
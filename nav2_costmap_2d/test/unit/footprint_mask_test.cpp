@@ -0,0 +1,219 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/costmap_2d.hpp"
+#include "nav2_costmap_2d/cost_values.hpp"
+#include "nav2_costmap_2d/footprint.hpp"
+#include "nav2_util/line_iterator.hpp"
+
+namespace
+{
+
+std::vector<geometry_msgs::msg::Point> makeFootprint()
+{
+  std::vector<geometry_msgs::msg::Point> footprint(4);
+  footprint[0].x = 0.42;
+  footprint[0].y = 0.23;
+  footprint[1].x = -0.31;
+  footprint[1].y = 0.23;
+  footprint[2].x = -0.31;
+  footprint[2].y = -0.23;
+  footprint[3].x = 0.42;
+  footprint[3].y = -0.23;
+  return footprint;
+}
+
+// The highest cost on the outline, rasterized from the oriented footprint
+double rasterizedCost(
+  const nav2_costmap_2d::Costmap2D & costmap, double x, double y, double theta,
+  const std::vector<geometry_msgs::msg::Point> & footprint_spec)
+{
+  std::vector<geometry_msgs::msg::Point> footprint;
+  nav2_costmap_2d::transformFootprint(x, y, theta, footprint_spec, footprint);
+  double cost = 0.0;
+  for (unsigned int i = 0; i < footprint.size(); ++i) {
+    const geometry_msgs::msg::Point & start = footprint[i];
+    const geometry_msgs::msg::Point & end = footprint[(i + 1) % footprint.size()];
+    unsigned int x0, y0, x1, y1;
+    if (!costmap.worldToMap(start.x, start.y, x0, y0) ||
+      !costmap.worldToMap(end.x, end.y, x1, y1))
+    {
+      return -1.0;
+    }
+    for (nav2_util::LineIterator line(x0, y0, x1, y1); line.isValid(); line.advance()) {
+      cost = std::max(cost, static_cast<double>(costmap.getCost(line.getX(), line.getY())));
+    }
+  }
+  return cost;
+}
+
+}  // namespace
+
+TEST(footprint_mask, matches_rasterized_outline_at_cell_centers)
+{
+  nav2_costmap_2d::Costmap2D costmap(60, 60, 0.05, 0.0, 0.0, nav2_costmap_2d::FREE_SPACE);
+  std::vector<geometry_msgs::msg::Point> footprint = makeFootprint();
+
+  unsigned int num_headings = 16;
+  nav2_costmap_2d::FootprintMask mask(num_headings);
+  mask.setFootprint(footprint, costmap.getResolution());
+  ASSERT_FALSE(mask.empty());
+
+  double wx, wy;
+  costmap.mapToWorld(30, 30, wx, wy);
+  for (unsigned int h = 0; h < num_headings; ++h) {
+    double theta = 2.0 * M_PI * h / num_headings;
+    // one obstacle at a time, anywhere around the robot
+    for (unsigned int my = 15; my < 45; ++my) {
+      for (unsigned int mx = 15; mx < 45; ++mx) {
+        costmap.setCost(mx, my, nav2_costmap_2d::LETHAL_OBSTACLE);
+        EXPECT_EQ(
+          rasterizedCost(costmap, wx, wy, theta, footprint),
+          mask.footprintCostAtPose(costmap, wx, wy, theta)) << h << " " << mx << " " << my;
+        costmap.setCost(mx, my, nav2_costmap_2d::FREE_SPACE);
+      }
+    }
+  }
+}
+
+TEST(footprint_mask, snaps_to_the_nearest_heading)
+{
+  nav2_costmap_2d::Costmap2D costmap(60, 60, 0.05, 0.0, 0.0, nav2_costmap_2d::FREE_SPACE);
+  nav2_costmap_2d::FootprintMask mask(4);
+  mask.setFootprint(makeFootprint(), costmap.getResolution());
+
+  double wx, wy;
+  costmap.mapToWorld(30, 30, wx, wy);
+  // the front of the robot, turned a quarter turn, is behind the obstacle
+  costmap.setCost(30, 38, nav2_costmap_2d::LETHAL_OBSTACLE);
+  EXPECT_EQ(0.0, mask.footprintCostAtPose(costmap, wx, wy, 0.0));
+  EXPECT_EQ(
+    nav2_costmap_2d::LETHAL_OBSTACLE, mask.footprintCostAtPose(costmap, wx, wy, M_PI / 2 + 0.3));
+  EXPECT_EQ(
+    nav2_costmap_2d::LETHAL_OBSTACLE, mask.footprintCostAtPose(costmap, wx, wy, -3 * M_PI / 2));
+}
+
+TEST(footprint_mask, off_the_grid)
+{
+  nav2_costmap_2d::Costmap2D costmap(60, 60, 0.05, 0.0, 0.0, nav2_costmap_2d::FREE_SPACE);
+  nav2_costmap_2d::FootprintMask mask;
+  EXPECT_EQ(-1.0, mask.footprintCostAtPose(costmap, 1.5, 1.5, 0.0));
+
+  mask.setFootprint(makeFootprint(), costmap.getResolution());
+  EXPECT_EQ(0.0, mask.footprintCostAtPose(costmap, 1.5, 1.5, 0.0));
+  EXPECT_EQ(-1.0, mask.footprintCostAtPose(costmap, 0.1, 1.5, 0.0));
+  EXPECT_EQ(-1.0, mask.footprintCostAtPose(costmap, 1.5, 2.9, M_PI / 2));
+  EXPECT_EQ(-1.0, mask.footprintCostAtPose(costmap, -1.0, 1.5, 0.0));
+}
+
+TEST(footprint_mask, trajectory_is_the_highest_pose)
+{
+  nav2_costmap_2d::Costmap2D costmap(60, 60, 0.05, 0.0, 0.0, nav2_costmap_2d::FREE_SPACE);
+  nav2_costmap_2d::FootprintMask mask(16);
+  mask.setFootprint(makeFootprint(), costmap.getResolution());
+  costmap.setCost(40, 22, 100);
+  costmap.setCost(12, 45, 200);
+
+  // a slow arc, so that most poses share their cell and heading with the one before
+  std::vector<geometry_msgs::msg::Pose2D> poses;
+  double expected = 0.0;
+  for (unsigned int i = 0; i < 40; ++i) {
+    geometry_msgs::msg::Pose2D pose;
+    pose.x = 1.2 + 0.005 * i;
+    pose.y = 1.3 + 0.002 * i;
+    pose.theta = 0.02 * i;
+    poses.push_back(pose);
+    expected = std::max(expected, mask.footprintCostAtPose(costmap, pose.x, pose.y, pose.theta));
+  }
+  EXPECT_EQ(expected, mask.trajectoryFootprintCost(costmap, poses));
+
+  EXPECT_EQ(0.0, mask.trajectoryFootprintCost(costmap, {}));
+  poses.back().x = 0.1;
+  EXPECT_EQ(-1.0, mask.trajectoryFootprintCost(costmap, poses));
+}
+
+TEST(footprint_mask, switching_between_footprints)
+{
+  nav2_costmap_2d::Costmap2D costmap(60, 60, 0.05, 0.0, 0.0, nav2_costmap_2d::FREE_SPACE);
+  std::vector<geometry_msgs::msg::Point> small = makeFootprint();
+  std::vector<geometry_msgs::msg::Point> large = small;
+  for (geometry_msgs::msg::Point & point : large) {
+    point.x *= 1.5;
+    point.y *= 1.5;
+  }
+
+  double wx, wy;
+  costmap.mapToWorld(30, 30, wx, wy);
+  costmap.setCost(43, 30, nav2_costmap_2d::LETHAL_OBSTACLE);
+
+  // the cached outlines are the ones a fresh mask rasterizes
+  nav2_costmap_2d::FootprintMask mask(16, 1);
+  for (unsigned int i = 0; i < 3; ++i) {
+    mask.setFootprint(small, costmap.getResolution());
+    EXPECT_EQ(0.0, mask.footprintCostAtPose(costmap, wx, wy, 0.0));
+    mask.setFootprint(large, costmap.getResolution());
+    EXPECT_EQ(
+      nav2_costmap_2d::LETHAL_OBSTACLE, mask.footprintCostAtPose(costmap, wx, wy, 0.0));
+  }
+
+  nav2_costmap_2d::FootprintMask fresh(16);
+  for (double resolution : {0.05, 0.1, 0.05}) {
+    mask.setFootprint(small, resolution);
+    fresh.setFootprint(small, resolution);
+    for (unsigned int h = 0; h < 16; ++h) {
+      double theta = 2.0 * M_PI * h / 16;
+      EXPECT_EQ(
+        fresh.footprintCostAtPose(costmap, wx, wy, theta),
+        mask.footprintCostAtPose(costmap, wx, wy, theta));
+    }
+  }
+}
+
+TEST(footprint_mask, swept_turn_covers_every_heading)
+{
+  nav2_costmap_2d::Costmap2D costmap(60, 60, 0.05, 0.0, 0.0, nav2_costmap_2d::FREE_SPACE);
+  unsigned int num_headings = 16;
+  nav2_costmap_2d::FootprintMask mask(num_headings);
+  mask.setFootprint(makeFootprint(), costmap.getResolution());
+
+  double wx, wy;
+  costmap.mapToWorld(30, 30, wx, wy);
+  EXPECT_EQ(0.0, mask.sweptFootprintCost(costmap, wx, wy, 0.0, M_PI));
+
+  // a quarter turn clockwise from the first heading
+  const unsigned int turned = num_headings / 4;
+  for (unsigned int my = 3; my < 57; ++my) {
+    for (unsigned int mx = 3; mx < 57; ++mx) {
+      costmap.setCost(mx, my, nav2_costmap_2d::LETHAL_OBSTACLE);
+      double swept = mask.sweptFootprintCost(costmap, wx, wy, 0.0, -M_PI / 2);
+      for (unsigned int h = 0; h <= turned; ++h) {
+        double theta = -2.0 * M_PI * h / num_headings;
+        EXPECT_GE(swept, mask.footprintCostAtPose(costmap, wx, wy, theta)) << mx << " " << my;
+      }
+      costmap.setCost(mx, my, nav2_costmap_2d::FREE_SPACE);
+    }
+  }
+
+  // only the sector turned through is checked, not the whole circle
+  costmap.setCost(32, 40, nav2_costmap_2d::LETHAL_OBSTACLE);
+  EXPECT_EQ(0.0, mask.sweptFootprintCost(costmap, wx, wy, 0.0, -M_PI / 2));
+  EXPECT_EQ(
+    nav2_costmap_2d::LETHAL_OBSTACLE, mask.sweptFootprintCost(costmap, wx, wy, 0.0, M_PI / 2));
+  EXPECT_EQ(-1.0, mask.sweptFootprintCost(costmap, 0.4, 1.5, 0.0, M_PI / 2));
+}
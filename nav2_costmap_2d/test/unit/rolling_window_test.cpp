@@ -0,0 +1,170 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <random>
+#include <utility>
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/layer.hpp"
+#include "nav2_costmap_2d/layered_costmap.hpp"
+
+namespace
+{
+
+const unsigned int SIZE_X = 30;
+const unsigned int SIZE_Y = 20;
+
+// Costs fixed in the world, as a static map seen through a rolling window. The
+// layer reports the bounds of the cells changed since the previous cycle only,
+// or the whole window on every cycle, as StaticLayer did before the composite
+// was shifted with the window.
+class WorldLayer : public nav2_costmap_2d::Layer
+{
+public:
+  WorldLayer(nav2_costmap_2d::LayeredCostmap * parent, bool whole_window)
+  : parent_(parent), whole_window_(whole_window) {}
+
+  void reset() override {}
+
+  void setWorldCost(int gx, int gy, unsigned char cost)
+  {
+    changed_[{gx, gy}] = cost;
+    if (!has_change_) {
+      change_min_x_ = change_max_x_ = gx;
+      change_min_y_ = change_max_y_ = gy;
+      has_change_ = true;
+    }
+    change_min_x_ = std::min(change_min_x_, static_cast<double>(gx));
+    change_min_y_ = std::min(change_min_y_, static_cast<double>(gy));
+    change_max_x_ = std::max(change_max_x_, gx + 1.0);
+    change_max_y_ = std::max(change_max_y_, gy + 1.0);
+  }
+
+  void updateBounds(
+    double, double, double, double * min_x, double * min_y, double * max_x,
+    double * max_y) override
+  {
+    if (whole_window_) {
+      nav2_costmap_2d::Costmap2D * master = parent_->getCostmap();
+      *min_x = std::min(*min_x, master->getOriginX());
+      *min_y = std::min(*min_y, master->getOriginY());
+      *max_x = std::max(*max_x, master->getOriginX() + master->getSizeInMetersX());
+      *max_y = std::max(*max_y, master->getOriginY() + master->getSizeInMetersY());
+    } else if (has_change_) {
+      *min_x = std::min(*min_x, change_min_x_);
+      *min_y = std::min(*min_y, change_min_y_);
+      *max_x = std::max(*max_x, change_max_x_);
+      *max_y = std::max(*max_y, change_max_y_);
+    }
+    has_change_ = false;
+  }
+
+  void updateCosts(
+    nav2_costmap_2d::Costmap2D & master_grid, int min_i, int min_j, int max_i,
+    int max_j) override
+  {
+    for (int j = min_j; j < max_j; j++) {
+      for (int i = min_i; i < max_i; i++) {
+        double wx, wy;
+        master_grid.mapToWorld(i, j, wx, wy);
+        master_grid.setCost(i, j, worldCost(std::floor(wx), std::floor(wy)));
+      }
+    }
+    cells_written_ += (max_i - min_i) * (max_j - min_j);
+  }
+
+  unsigned char worldCost(int gx, int gy) const
+  {
+    auto changed = changed_.find({gx, gy});
+    if (changed != changed_.end()) {
+      return changed->second;
+    }
+    // never the default value of the master grid, so stale cells show
+    return 1 + ((gx * 7 + gy * 13) % 200 + 200) % 200;
+  }
+
+  int cells_written_{0};
+
+private:
+  nav2_costmap_2d::LayeredCostmap * parent_;
+  bool whole_window_;
+  std::map<std::pair<int, int>, unsigned char> changed_;
+  bool has_change_{false};
+  double change_min_x_, change_min_y_, change_max_x_, change_max_y_;
+};
+
+}  // namespace
+
+TEST(rolling_window, shifted_composite_matches_full_recompute)
+{
+  nav2_costmap_2d::LayeredCostmap shifted("map", true, false);
+  nav2_costmap_2d::LayeredCostmap full("map", true, false);
+  shifted.resizeMap(SIZE_X, SIZE_Y, 1.0, 0.0, 0.0);
+  full.resizeMap(SIZE_X, SIZE_Y, 1.0, 0.0, 0.0);
+  auto shifted_layer = std::make_shared<WorldLayer>(&shifted, false);
+  auto full_layer = std::make_shared<WorldLayer>(&full, true);
+  shifted.addPlugin(shifted_layer);
+  full.addPlugin(full_layer);
+
+  auto compare = [&](double robot_x, double robot_y) {
+      shifted.updateMap(robot_x, robot_y, 0.0);
+      full.updateMap(robot_x, robot_y, 0.0);
+      nav2_costmap_2d::Costmap2D * a = shifted.getCostmap();
+      nav2_costmap_2d::Costmap2D * b = full.getCostmap();
+      ASSERT_EQ(a->getOriginX(), b->getOriginX());
+      ASSERT_EQ(a->getOriginY(), b->getOriginY());
+      for (unsigned int j = 0; j < SIZE_Y; ++j) {
+        for (unsigned int i = 0; i < SIZE_X; ++i) {
+          ASSERT_EQ(a->getCost(i, j), b->getCost(i, j)) << "cell " << i << ", " << j;
+        }
+      }
+    };
+
+  // With nothing changed, a move along x only recomputes the incoming columns
+  compare(0.0, 0.0);
+  double origin_x = shifted.getCostmap()->getOriginX();
+  shifted_layer->cells_written_ = 0;
+  compare(2.0, 0.0);
+  int columns = static_cast<int>(shifted.getCostmap()->getOriginX() - origin_x);
+  EXPECT_GT(columns, 0);
+  EXPECT_EQ(shifted_layer->cells_written_, columns * static_cast<int>(SIZE_Y));
+
+  // Random moves of less than a cell to a few cells in either direction, jumps
+  // past the window and changes to costs inside and outside of the window
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<double> step(-3.7, 3.7);
+  std::uniform_int_distribution<int> near(-25, 25);
+  std::uniform_int_distribution<int> cost(1, 252);
+  double robot_x = 2.0, robot_y = 0.0;
+  for (int cycle = 0; cycle < 500; ++cycle) {
+    if (cycle % 50 == 49) {
+      robot_x += 40.0;
+    } else {
+      robot_x += step(rng);
+      robot_y += step(rng);
+    }
+    for (int n = cycle % 4; n > 0; --n) {
+      int gx = static_cast<int>(std::floor(robot_x)) + near(rng);
+      int gy = static_cast<int>(std::floor(robot_y)) + near(rng);
+      unsigned char c = cost(rng);
+      shifted_layer->setWorldCost(gx, gy, c);
+      full_layer->setWorldCost(gx, gy, c);
+    }
+    compare(robot_x, robot_y);
+  }
+}
@@ -0,0 +1,84 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/update_statistics.hpp"
+
+TEST(rolling_statistics, summarizes_the_last_samples)
+{
+  nav2_costmap_2d::RollingStatistics statistics(20);
+  nav2_msgs::msg::RollingStatistics msg;
+  statistics.toMsg("empty", msg);
+  EXPECT_EQ("empty", msg.name);
+  EXPECT_EQ(0u, msg.count);
+  EXPECT_EQ(0.0, msg.max);
+
+  for (int i = 1; i <= 30; ++i) {
+    statistics.add(i);
+  }
+  // only 11 to 30 are left
+  statistics.toMsg("samples", msg);
+  EXPECT_EQ(20u, msg.count);
+  EXPECT_DOUBLE_EQ(20.5, msg.mean);
+  EXPECT_DOUBLE_EQ(21.0, msg.median);
+  EXPECT_DOUBLE_EQ(30.0, msg.p95);
+  EXPECT_DOUBLE_EQ(30.0, msg.max);
+}
+
+TEST(update_statistics, sums_layer_times_over_an_update)
+{
+  nav2_costmap_2d::UpdateStatistics statistics(10);
+  statistics.setLayers({"static_layer", "inflation_layer"});
+
+  for (int update = 0; update < 3; ++update) {
+    statistics.beginUpdate();
+    statistics.addLockWait(0.001);
+    statistics.addBoundsTime(0, 0.002);
+    // two areas updated in one cycle
+    statistics.addUpdatedCells(100);
+    statistics.addCostsTime(0, 0.003);
+    statistics.addCostsTime(1, 0.004);
+    statistics.addUpdatedCells(50);
+    statistics.addCostsTime(0, 0.003);
+    statistics.addCostsTime(1, 0.004);
+    statistics.endUpdate();
+    statistics.addUpdateTime(0.02);
+  }
+  statistics.addMissedCycle();
+
+  nav2_msgs::msg::CostmapUpdateStatistics msg;
+  statistics.toMsg(msg);
+  EXPECT_EQ(1u, msg.missed_cycles);
+  ASSERT_EQ(7u, msg.statistics.size());
+
+  std::vector<std::string> names;
+  for (const auto & entry : msg.statistics) {
+    EXPECT_EQ(3u, entry.count) << entry.name;
+    names.push_back(entry.name);
+  }
+  EXPECT_EQ(
+    std::vector<std::string>(
+      {"update_map", "lock_wait", "updated_cells",
+        "static_layer/update_bounds", "static_layer/update_costs",
+        "inflation_layer/update_bounds", "inflation_layer/update_costs"}),
+    names);
+  EXPECT_DOUBLE_EQ(0.02, msg.statistics[0].mean);
+  EXPECT_DOUBLE_EQ(150.0, msg.statistics[2].max);
+  EXPECT_DOUBLE_EQ(0.006, msg.statistics[4].mean);
+  EXPECT_DOUBLE_EQ(0.0, msg.statistics[5].max);
+  EXPECT_DOUBLE_EQ(0.008, msg.statistics[6].median);
+}
@@ -0,0 +1,134 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "nav2_costmap_2d/voxel_grid_encoding.hpp"
+
+using nav2_msgs::msg::VoxelGrid;
+
+namespace
+{
+
+VoxelGrid gridMessage(unsigned int size_x, unsigned int size_y)
+{
+  VoxelGrid msg;
+  msg.size_x = size_x;
+  msg.size_y = size_y;
+  msg.size_z = 20;
+  return msg;
+}
+
+}  // namespace
+
+TEST(voxel_grid_encoding, deltas_between_keyframes)
+{
+  const unsigned int column_words = 2;
+  std::vector<uint32_t> words(10 * 8 * column_words, 0x0000ffff);
+  nav2_costmap_2d::VoxelGridEncoder encoder(3);
+  nav2_costmap_2d::VoxelGridDecoder decoder;
+  VoxelGrid msg = gridMessage(10, 8);
+
+  encoder.encode(words.data(), 80, column_words, msg);
+  EXPECT_EQ(msg.encoding, VoxelGrid::ENCODING_RAW);
+  ASSERT_TRUE(decoder.decode(msg));
+  EXPECT_TRUE(decoder.replacedGrid());
+
+  for (unsigned int i = 0; i < 3; ++i) {
+    words[(5 + i) * column_words] = 0x00010001;
+    words[(40 + i) * column_words + 1] = 0x7;
+    encoder.encode(words.data(), 80, column_words, msg);
+    EXPECT_EQ(msg.encoding, VoxelGrid::ENCODING_DELTA);
+    EXPECT_EQ(msg.data.size(), 2u * (column_words + 1));
+
+    ASSERT_TRUE(decoder.decode(msg));
+    EXPECT_FALSE(decoder.replacedGrid());
+    EXPECT_EQ(decoder.changedColumns(), std::vector<uint32_t>({5 + i, 40 + i}));
+    EXPECT_TRUE(std::equal(words.begin(), words.end(), decoder.words()));
+  }
+
+  // the keyframe interval is up
+  encoder.encode(words.data(), 80, column_words, msg);
+  EXPECT_EQ(msg.encoding, VoxelGrid::ENCODING_RAW);
+  ASSERT_TRUE(decoder.decode(msg));
+  EXPECT_TRUE(std::equal(words.begin(), words.end(), decoder.words()));
+
+  // more changes than columns left unchanged go out whole
+  for (unsigned int i = 0; i < 60; ++i) {
+    words[i * column_words] = i;
+  }
+  encoder.encode(words.data(), 80, column_words, msg);
+  EXPECT_EQ(msg.encoding, VoxelGrid::ENCODING_RAW);
+
+  // as do grids that changed size
+  words.resize(12 * 8 * column_words);
+  msg = gridMessage(12, 8);
+  encoder.encode(words.data(), 96, column_words, msg);
+  EXPECT_EQ(msg.encoding, VoxelGrid::ENCODING_RAW);
+}
+
+TEST(voxel_grid_encoding, missed_deltas_wait_for_a_keyframe)
+{
+  std::vector<uint32_t> words(16, 0);
+  nav2_costmap_2d::VoxelGridEncoder encoder(10);
+  nav2_costmap_2d::VoxelGridDecoder decoder;
+  VoxelGrid msg = gridMessage(4, 4);
+
+  // deltas mean nothing before the first whole grid
+  encoder.encode(words.data(), 16, 1, msg);
+  words[3] = 1;
+  encoder.encode(words.data(), 16, 1, msg);
+  ASSERT_EQ(msg.encoding, VoxelGrid::ENCODING_DELTA);
+  EXPECT_FALSE(decoder.decode(msg));
+
+  encoder.forceKeyframe();
+  encoder.encode(words.data(), 16, 1, msg);
+  ASSERT_EQ(msg.encoding, VoxelGrid::ENCODING_RAW);
+  EXPECT_TRUE(decoder.decode(msg));
+
+  // a delta skipped
+  words[4] = 1;
+  encoder.encode(words.data(), 16, 1, msg);
+  words[5] = 1;
+  encoder.encode(words.data(), 16, 1, msg);
+  EXPECT_FALSE(decoder.decode(msg));
+  words[6] = 1;
+  encoder.encode(words.data(), 16, 1, msg);
+  EXPECT_FALSE(decoder.decode(msg));
+
+  // malformed deltas
+  encoder.forceKeyframe();
+  encoder.encode(words.data(), 16, 1, msg);
+  ASSERT_TRUE(decoder.decode(msg));
+  msg.encoding = VoxelGrid::ENCODING_DELTA;
+  msg.sequence++;
+  msg.data = {16, 1};
+  EXPECT_FALSE(decoder.decode(msg));
+}
+
+TEST(voxel_grid_encoding, grids_without_column_words)
+{
+  // as published before column_words was added
+  nav2_costmap_2d::VoxelGridDecoder decoder;
+  VoxelGrid msg = gridMessage(3, 2);
+  msg.data.assign(3 * 2 * 4, 9);
+  ASSERT_TRUE(decoder.decode(msg));
+  EXPECT_EQ(decoder.columnWords(), 4u);
+  EXPECT_TRUE(decoder.replacedGrid());
+
+  msg.data.pop_back();
+  EXPECT_FALSE(decoder.decode(msg));
+}
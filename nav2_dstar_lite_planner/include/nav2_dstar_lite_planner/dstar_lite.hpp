@@ -0,0 +1,154 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Incremental search based on:
+// Koenig, S. and Likhachev, M. (2002). D* Lite. AAAI.
+
+#ifndef NAV2_DSTAR_LITE_PLANNER__DSTAR_LITE_HPP_
+#define NAV2_DSTAR_LITE_PLANNER__DSTAR_LITE_HPP_
+
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <vector>
+
+namespace nav2_dstar_lite_planner
+{
+
+/**
+ * @class DStarLite
+ * @brief D* Lite search over an 8-connected grid. The search runs from the goal
+ * to the start and is kept between calls, so changed cell costs and a moving
+ * start only repair the part of the search they affect.
+ */
+class DStarLite
+{
+public:
+  /** Cost of a cell that cannot be entered */
+  static constexpr float OBSTACLE = std::numeric_limits<float>::infinity();
+
+  struct Cell
+  {
+    unsigned int x;
+    unsigned int y;
+  };
+
+  DStarLite();
+
+  /**
+   * @brief  Resize the grid and drop the search. All cells are set to obstacles.
+   * @param size_x The x size of the grid in cells
+   * @param size_y The y size of the grid in cells
+   * @param min_cost The lowest cost a free cell can have, scales the heuristic
+   */
+  void resize(unsigned int size_x, unsigned int size_y, float min_cost);
+
+  /**
+   * @brief  Set the cost of entering a cell, per cell of distance traveled
+   * @param x The x coordinate of the cell
+   * @param y The y coordinate of the cell
+   * @param cost At least the min_cost given to resize(), or OBSTACLE
+   */
+  void setCellCost(unsigned int x, unsigned int y, float cost);
+
+  /**
+   * @brief  Compute the cheapest path from start to goal. If the goal is the same
+   * as the previous call, the previous search is repaired instead of redone.
+   * @param start The start cell
+   * @param goal The goal cell
+   * @param path Will be filled with the cells from start to goal
+   * @return True if a path was found
+   */
+  bool computePath(const Cell & start, const Cell & goal, std::vector<Cell> & path);
+
+  /**
+   * @brief  Drop the search, the next computePath() starts from scratch
+   */
+  void reset() {initialized_ = false;}
+
+  /**
+   * @brief  Get the cost of the path found by the last computePath()
+   */
+  float getPathCost() const {return path_cost_;}
+
+  /**
+   * @brief  Get the number of cells expanded by the last computePath()
+   */
+  size_t getExpansions() const {return expansions_;}
+
+  unsigned int getSizeX() const {return size_x_;}
+  unsigned int getSizeY() const {return size_y_;}
+
+protected:
+  struct Key
+  {
+    float k1;
+    float k2;
+    bool operator<(const Key & other) const
+    {
+      return k1 < other.k1 || (k1 == other.k1 && k2 < other.k2);
+    }
+    bool operator==(const Key & other) const
+    {
+      return k1 == other.k1 && k2 == other.k2;
+    }
+  };
+
+  struct Entry
+  {
+    Key key;
+    unsigned int index;
+    bool operator>(const Entry & other) const {return other.key < key;}
+  };
+
+  void initialize(unsigned int start, unsigned int goal);
+  void computeShortestPath();
+  void updateVertex(unsigned int index);
+  void insert(unsigned int index);
+  Key calculateKey(unsigned int index) const;
+  float heuristic(unsigned int a, unsigned int b) const;
+
+  /**
+   * @brief  Visit the cells reachable from index in one step, with the step's cost
+   */
+  template<class Visitor>
+  void forEachNeighbor(unsigned int index, Visitor visit) const;
+
+  unsigned int size_x_{0};
+  unsigned int size_y_{0};
+  float min_cost_{1.0f};
+
+  std::vector<float> cost_;  // cost of entering each cell
+  std::vector<float> g_;
+  std::vector<float> rhs_;
+  std::vector<Key> open_key_;  // key of the cell in the open list, if open
+  std::vector<char> open_;
+
+  std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open_list_;
+  std::vector<unsigned int> changed_;  // cells whose cost changed since the last search
+
+  bool initialized_{false};
+  unsigned int start_{0};
+  unsigned int goal_{0};
+  unsigned int last_start_{0};
+  float km_{0.0f};
+
+  float path_cost_{OBSTACLE};
+  size_t expansions_{0};
+};
+
+}  // namespace nav2_dstar_lite_planner
+
+#endif  // NAV2_DSTAR_LITE_PLANNER__DSTAR_LITE_HPP_
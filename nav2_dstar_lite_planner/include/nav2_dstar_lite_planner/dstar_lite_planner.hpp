@@ -0,0 +1,96 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_DSTAR_LITE_PLANNER__DSTAR_LITE_PLANNER_HPP_
+#define NAV2_DSTAR_LITE_PLANNER__DSTAR_LITE_PLANNER_HPP_
+
+#include <memory>
+#include <string>
+
+#include "geometry_msgs/msg/pose_stamped.hpp"
+#include "nav2_core/global_planner.hpp"
+#include "nav_msgs/msg/path.hpp"
+#include "nav2_dstar_lite_planner/dstar_lite.hpp"
+#include "nav2_util/lifecycle_node.hpp"
+#include "nav2_costmap_2d/costmap_2d_ros.hpp"
+
+namespace nav2_dstar_lite_planner
+{
+
+/**
+ * @class DStarLitePlanner
+ * @brief Global planner that keeps its D* Lite search between requests and only
+ * applies the costmap cells changed since the last one, repairing the path
+ * instead of planning from scratch.
+ */
+class DStarLitePlanner : public nav2_core::GlobalPlanner
+{
+public:
+  DStarLitePlanner();
+  ~DStarLitePlanner();
+
+  // plugin configure
+  void configure(
+    rclcpp_lifecycle::LifecycleNode::SharedPtr parent,
+    std::string name, std::shared_ptr<tf2_ros::Buffer> tf,
+    std::shared_ptr<nav2_costmap_2d::Costmap2DROS> costmap_ros) override;
+
+  // plugin cleanup
+  void cleanup() override;
+
+  // plugin activate
+  void activate() override;
+
+  // plugin deactivate
+  void deactivate() override;
+
+  // plugin create path
+  nav_msgs::msg::Path createPlan(
+    const geometry_msgs::msg::PoseStamped & start,
+    const geometry_msgs::msg::PoseStamped & goal) override;
+
+protected:
+  // Bring the search's cell costs up to date with the costmap, must hold the costmap lock
+  void updateCellCosts();
+
+  // Translate a costmap cost into the cost of entering the cell
+  float translateCost(unsigned char cost) const;
+
+  // The search, kept between requests
+  DStarLite search_;
+
+  // node ptr
+  nav2_util::LifecycleNode::SharedPtr node_;
+
+  // Global Costmap
+  nav2_costmap_2d::Costmap2D * costmap_;
+
+  // The global frame of the costmap
+  std::string global_frame_, name_;
+
+  // Whether or not the planner should be allowed to plan through unknown space
+  bool allow_unknown_;
+
+  // Cost of a free cell, and the factor costmap costs are scaled by on top of it
+  double neutral_cost_;
+  double cost_factor_;
+
+  // Change count of the costmap when the search's costs were last updated
+  uint64_t costmap_change_count_{0};
+  bool costs_valid_{false};
+};
+
+}  // namespace nav2_dstar_lite_planner
+
+#endif  // NAV2_DSTAR_LITE_PLANNER__DSTAR_LITE_PLANNER_HPP_
@@ -0,0 +1,234 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_dstar_lite_planner/dstar_lite.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+namespace nav2_dstar_lite_planner
+{
+
+constexpr float DStarLite::OBSTACLE;
+
+static const float SQRT2 = 1.41421356f;
+
+DStarLite::DStarLite()
+{
+}
+
+void DStarLite::resize(unsigned int size_x, unsigned int size_y, float min_cost)
+{
+  size_x_ = size_x;
+  size_y_ = size_y;
+  min_cost_ = min_cost;
+
+  size_t size = static_cast<size_t>(size_x) * size_y;
+  cost_.assign(size, OBSTACLE);
+  g_.resize(size);
+  rhs_.resize(size);
+  open_key_.resize(size);
+  open_.resize(size);
+  changed_.clear();
+  initialized_ = false;
+}
+
+void DStarLite::setCellCost(unsigned int x, unsigned int y, float cost)
+{
+  unsigned int index = y * size_x_ + x;
+  if (cost_[index] != cost) {
+    cost_[index] = cost;
+    if (initialized_) {
+      changed_.push_back(index);
+    }
+  }
+}
+
+template<class Visitor>
+void DStarLite::forEachNeighbor(unsigned int index, Visitor visit) const
+{
+  int x = index % size_x_;
+  int y = index / size_x_;
+  for (int dy = -1; dy <= 1; ++dy) {
+    for (int dx = -1; dx <= 1; ++dx) {
+      int nx = x + dx;
+      int ny = y + dy;
+      if ((dx == 0 && dy == 0) || nx < 0 || ny < 0 ||
+        nx >= static_cast<int>(size_x_) || ny >= static_cast<int>(size_y_))
+      {
+        continue;
+      }
+      unsigned int neighbor = ny * size_x_ + nx;
+      float cost = cost_[neighbor];
+      if (dx != 0 && dy != 0) {
+        // don't cut the corner of an obstacle on a diagonal step
+        if (cost_[y * size_x_ + nx] == OBSTACLE || cost_[ny * size_x_ + x] == OBSTACLE) {
+          cost = OBSTACLE;
+        }
+        cost *= SQRT2;
+      }
+      visit(neighbor, cost);
+    }
+  }
+}
+
+float DStarLite::heuristic(unsigned int a, unsigned int b) const
+{
+  // octile distance, the shortest 8-connected path over free cells
+  float dx = std::abs(static_cast<int>(a % size_x_) - static_cast<int>(b % size_x_));
+  float dy = std::abs(static_cast<int>(a / size_x_) - static_cast<int>(b / size_x_));
+  return min_cost_ * (std::max(dx, dy) + (SQRT2 - 1.0f) * std::min(dx, dy));
+}
+
+DStarLite::Key DStarLite::calculateKey(unsigned int index) const
+{
+  float g = std::min(g_[index], rhs_[index]);
+  return Key{g + heuristic(start_, index) + km_, g};
+}
+
+void DStarLite::insert(unsigned int index)
+{
+  // entries whose key no longer matches open_key_ are skipped when popped
+  Key key = calculateKey(index);
+  open_key_[index] = key;
+  open_[index] = true;
+  open_list_.push(Entry{key, index});
+}
+
+void DStarLite::updateVertex(unsigned int index)
+{
+  if (index != goal_) {
+    float rhs = OBSTACLE;
+    forEachNeighbor(
+      index, [&](unsigned int neighbor, float cost) {
+        rhs = std::min(rhs, cost + g_[neighbor]);
+      });
+    rhs_[index] = rhs;
+  }
+
+  if (g_[index] != rhs_[index]) {
+    insert(index);
+  } else {
+    open_[index] = false;
+  }
+}
+
+void DStarLite::initialize(unsigned int start, unsigned int goal)
+{
+  std::fill(g_.begin(), g_.end(), OBSTACLE);
+  std::fill(rhs_.begin(), rhs_.end(), OBSTACLE);
+  std::fill(open_.begin(), open_.end(), 0);
+  open_list_ = decltype(open_list_)();
+  changed_.clear();
+
+  start_ = last_start_ = start;
+  goal_ = goal;
+  km_ = 0.0f;
+  rhs_[goal_] = 0.0f;
+  insert(goal_);
+  initialized_ = true;
+}
+
+void DStarLite::computeShortestPath()
+{
+  while (!open_list_.empty()) {
+    Entry top = open_list_.top();
+    if (!open_[top.index] || !(open_key_[top.index] == top.key)) {
+      open_list_.pop();  // stale entry
+      continue;
+    }
+    if (!(top.key < calculateKey(start_)) && rhs_[start_] == g_[start_]) {
+      break;
+    }
+    open_list_.pop();
+    ++expansions_;
+
+    unsigned int u = top.index;
+    Key new_key = calculateKey(u);
+    if (top.key < new_key) {
+      insert(u);
+    } else if (g_[u] > rhs_[u]) {
+      g_[u] = rhs_[u];
+      open_[u] = false;
+      forEachNeighbor(u, [this](unsigned int neighbor, float) {updateVertex(neighbor);});
+    } else {
+      g_[u] = OBSTACLE;
+      updateVertex(u);
+      forEachNeighbor(u, [this](unsigned int neighbor, float) {updateVertex(neighbor);});
+    }
+  }
+}
+
+bool DStarLite::computePath(const Cell & start, const Cell & goal, std::vector<Cell> & path)
+{
+  path.clear();
+  expansions_ = 0;
+  path_cost_ = OBSTACLE;
+  if (start.x >= size_x_ || start.y >= size_y_ || goal.x >= size_x_ || goal.y >= size_y_) {
+    return false;
+  }
+
+  unsigned int start_index = start.y * size_x_ + start.x;
+  unsigned int goal_index = goal.y * size_x_ + goal.x;
+
+  if (!initialized_ || goal_index != goal_) {
+    initialize(start_index, goal_index);
+  } else {
+    // the keys already queued were computed from the previous start
+    start_ = start_index;
+    km_ += heuristic(last_start_, start_);
+    last_start_ = start_;
+
+    // a cell's cost is part of every step into it, so its neighbors are affected
+    for (unsigned int index : changed_) {
+      forEachNeighbor(index, [this](unsigned int neighbor, float) {updateVertex(neighbor);});
+    }
+    changed_.clear();
+  }
+
+  computeShortestPath();
+
+  if (g_[start_] == OBSTACLE) {
+    return false;
+  }
+  path_cost_ = g_[start_];
+
+  // descend the cost-to-goal from the start
+  unsigned int current = start_;
+  size_t max_steps = static_cast<size_t>(size_x_) * size_y_;
+  path.push_back(start);
+  while (current != goal_) {
+    unsigned int best = current;
+    float best_cost = OBSTACLE;
+    forEachNeighbor(
+      current, [&](unsigned int neighbor, float cost) {
+        if (cost + g_[neighbor] < best_cost) {
+          best_cost = cost + g_[neighbor];
+          best = neighbor;
+        }
+      });
+    if (best == current || path.size() > max_steps) {
+      path.clear();
+      path_cost_ = OBSTACLE;
+      return false;
+    }
+    current = best;
+    path.push_back(Cell{current % size_x_, current / size_x_});
+  }
+  return true;
+}
+
+}  // namespace nav2_dstar_lite_planner
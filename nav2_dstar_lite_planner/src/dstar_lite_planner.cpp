@@ -0,0 +1,193 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_dstar_lite_planner/dstar_lite_planner.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "nav2_costmap_2d/cost_values.hpp"
+#include "nav2_util/node_utils.hpp"
+
+using nav2_util::declare_parameter_if_not_declared;
+
+namespace nav2_dstar_lite_planner
+{
+
+DStarLitePlanner::DStarLitePlanner()
+: costmap_(nullptr)
+{
+}
+
+DStarLitePlanner::~DStarLitePlanner()
+{
+}
+
+void
+DStarLitePlanner::configure(
+  rclcpp_lifecycle::LifecycleNode::SharedPtr parent,
+  std::string name, std::shared_ptr<tf2_ros::Buffer>/*tf*/,
+  std::shared_ptr<nav2_costmap_2d::Costmap2DROS> costmap_ros)
+{
+  node_ = parent;
+  name_ = name;
+  costmap_ = costmap_ros->getCostmap();
+  global_frame_ = costmap_ros->getGlobalFrameID();
+
+  RCLCPP_INFO(
+    node_->get_logger(), "Configuring plugin %s of type DStarLitePlanner",
+    name_.c_str());
+
+  declare_parameter_if_not_declared(node_, name + ".allow_unknown", rclcpp::ParameterValue(true));
+  node_->get_parameter(name + ".allow_unknown", allow_unknown_);
+  declare_parameter_if_not_declared(node_, name + ".neutral_cost", rclcpp::ParameterValue(50.0));
+  node_->get_parameter(name + ".neutral_cost", neutral_cost_);
+  declare_parameter_if_not_declared(node_, name + ".cost_factor", rclcpp::ParameterValue(0.8));
+  node_->get_parameter(name + ".cost_factor", cost_factor_);
+
+  costs_valid_ = false;
+}
+
+void
+DStarLitePlanner::activate()
+{
+  RCLCPP_INFO(
+    node_->get_logger(), "Activating plugin %s of type DStarLitePlanner",
+    name_.c_str());
+}
+
+void
+DStarLitePlanner::deactivate()
+{
+  RCLCPP_INFO(
+    node_->get_logger(), "Deactivating plugin %s of type DStarLitePlanner",
+    name_.c_str());
+}
+
+void
+DStarLitePlanner::cleanup()
+{
+  RCLCPP_INFO(
+    node_->get_logger(), "Cleaning up plugin %s of type DStarLitePlanner",
+    name_.c_str());
+  search_.resize(0, 0, static_cast<float>(neutral_cost_));
+  costs_valid_ = false;
+}
+
+nav_msgs::msg::Path DStarLitePlanner::createPlan(
+  const geometry_msgs::msg::PoseStamped & start,
+  const geometry_msgs::msg::PoseStamped & goal)
+{
+  nav_msgs::msg::Path path;
+  path.header.stamp = node_->now();
+  path.header.frame_id = global_frame_;
+
+  std::unique_lock<nav2_costmap_2d::Costmap2D::mutex_t> lock(*(costmap_->getMutex()));
+
+  DStarLite::Cell start_cell, goal_cell;
+  if (!costmap_->worldToMap(
+      start.pose.position.x, start.pose.position.y, start_cell.x, start_cell.y))
+  {
+    RCLCPP_WARN(
+      node_->get_logger(),
+      "Cannot create a plan: the robot's start position is off the global"
+      " costmap. Planning will always fail, are you sure"
+      " the robot has been properly localized?");
+    return path;
+  }
+  if (!costmap_->worldToMap(
+      goal.pose.position.x, goal.pose.position.y, goal_cell.x, goal_cell.y))
+  {
+    RCLCPP_WARN(
+      node_->get_logger(),
+      "The goal sent to the planner is off the global costmap."
+      " Planning will always fail to this goal.");
+    return path;
+  }
+
+  updateCellCosts();
+
+  // the search has its own copy of the costs
+  lock.unlock();
+
+  std::vector<DStarLite::Cell> cells;
+  bool found = search_.computePath(start_cell, goal_cell, cells);
+  RCLCPP_DEBUG(
+    node_->get_logger(), "%s: expanded %zu cells", name_.c_str(), search_.getExpansions());
+  if (!found) {
+    RCLCPP_WARN(node_->get_logger(), "%s: failed to create plan", name_.c_str());
+    return path;
+  }
+
+  for (const auto & cell : cells) {
+    geometry_msgs::msg::PoseStamped pose;
+    pose.header = path.header;
+    costmap_->mapToWorld(cell.x, cell.y, pose.pose.position.x, pose.pose.position.y);
+    pose.pose.orientation.w = 1.0;
+    path.poses.push_back(pose);
+  }
+
+  // end on the goal itself rather than the center of its cell
+  path.poses.back().pose = goal.pose;
+  return path;
+}
+
+void
+DStarLitePlanner::updateCellCosts()
+{
+  unsigned int size_x = costmap_->getSizeInCellsX();
+  unsigned int size_y = costmap_->getSizeInCellsY();
+  unsigned int x0 = 0, y0 = 0, xn = size_x, yn = size_y;
+
+  if (!costs_valid_ || search_.getSizeX() != size_x || search_.getSizeY() != size_y ||
+    !costmap_->getChangedBounds(costmap_change_count_, x0, y0, xn, yn))
+  {
+    // resized or shifted, the search can't be repaired
+    search_.resize(size_x, size_y, static_cast<float>(neutral_cost_));
+    x0 = y0 = 0;
+    xn = size_x;
+    yn = size_y;
+  }
+
+  const unsigned char * charmap = costmap_->getCharMap();
+  for (unsigned int y = y0; y < yn; ++y) {
+    for (unsigned int x = x0; x < xn; ++x) {
+      search_.setCellCost(x, y, translateCost(charmap[y * size_x + x]));
+    }
+  }
+
+  costmap_change_count_ = costmap_->getChangeCount();
+  costs_valid_ = true;
+}
+
+float
+DStarLitePlanner::translateCost(unsigned char cost) const
+{
+  // the same translation NavFn makes, with obstacles impassable
+  if (cost == nav2_costmap_2d::NO_INFORMATION) {
+    if (!allow_unknown_) {
+      return DStarLite::OBSTACLE;
+    }
+    cost = nav2_costmap_2d::INSCRIBED_INFLATED_OBSTACLE - 1;
+  } else if (cost >= nav2_costmap_2d::INSCRIBED_INFLATED_OBSTACLE) {
+    return DStarLite::OBSTACLE;
+  }
+  return static_cast<float>(neutral_cost_ + cost_factor_ * cost);
+}
+
+}  // namespace nav2_dstar_lite_planner
+
+#include "pluginlib/class_list_macros.hpp"
+PLUGINLIB_EXPORT_CLASS(nav2_dstar_lite_planner::DStarLitePlanner, nav2_core::GlobalPlanner)
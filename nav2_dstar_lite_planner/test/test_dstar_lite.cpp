@@ -0,0 +1,106 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdlib>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "nav2_dstar_lite_planner/dstar_lite.hpp"
+
+using nav2_dstar_lite_planner::DStarLite;
+
+TEST(DStarLite, StraightLineOnFreeGrid)
+{
+  DStarLite search;
+  search.resize(20, 10, 1.0f);
+  for (unsigned int y = 0; y < 10; ++y) {
+    for (unsigned int x = 0; x < 20; ++x) {
+      search.setCellCost(x, y, 1.0f);
+    }
+  }
+
+  std::vector<DStarLite::Cell> path;
+  ASSERT_TRUE(search.computePath({2, 5}, {17, 5}, path));
+  EXPECT_FLOAT_EQ(search.getPathCost(), 15.0f);
+  ASSERT_EQ(path.size(), 16u);
+  EXPECT_EQ(path.front().x, 2u);
+  EXPECT_EQ(path.back().x, 17u);
+}
+
+TEST(DStarLite, NoPathThroughAWall)
+{
+  DStarLite search;
+  search.resize(20, 10, 1.0f);
+  for (unsigned int y = 0; y < 10; ++y) {
+    for (unsigned int x = 0; x < 20; ++x) {
+      search.setCellCost(x, y, x == 10 ? DStarLite::OBSTACLE : 1.0f);
+    }
+  }
+
+  std::vector<DStarLite::Cell> path;
+  EXPECT_FALSE(search.computePath({2, 5}, {17, 5}, path));
+  EXPECT_TRUE(path.empty());
+
+  // opening a gap is repaired into a path
+  search.setCellCost(10, 0, 1.0f);
+  EXPECT_TRUE(search.computePath({2, 5}, {17, 5}, path));
+}
+
+TEST(DStarLite, RepairMatchesSearchFromScratch)
+{
+  const unsigned int size_x = 60, size_y = 40;
+  std::vector<float> costs(size_x * size_y);
+  std::srand(7);
+  for (float & cost : costs) {
+    int r = std::rand() % 100;
+    cost = r < 15 ? DStarLite::OBSTACLE : 1.0f + (std::rand() % 50) / 10.0f;
+  }
+
+  DStarLite incremental;
+  incremental.resize(size_x, size_y, 1.0f);
+  for (unsigned int i = 0; i < costs.size(); ++i) {
+    incremental.setCellCost(i % size_x, i / size_x, costs[i]);
+  }
+
+  DStarLite::Cell goal{55, 35};
+  DStarLite::Cell start{2, 2};
+  std::vector<DStarLite::Cell> path;
+  incremental.computePath(start, goal, path);
+
+  for (int round = 0; round < 30; ++round) {
+    // move the start along the path and change a few cells
+    if (path.size() > 3) {
+      start = path[3];
+    }
+    for (int i = 0; i < 20; ++i) {
+      unsigned int index = std::rand() % costs.size();
+      costs[index] = std::rand() % 4 == 0 ? DStarLite::OBSTACLE : 1.0f + (std::rand() % 50) / 10.0f;
+      incremental.setCellCost(index % size_x, index / size_x, costs[index]);
+    }
+
+    DStarLite scratch;
+    scratch.resize(size_x, size_y, 1.0f);
+    for (unsigned int i = 0; i < costs.size(); ++i) {
+      scratch.setCellCost(i % size_x, i / size_x, costs[i]);
+    }
+    std::vector<DStarLite::Cell> scratch_path;
+    bool found = scratch.computePath(start, goal, scratch_path);
+
+    ASSERT_EQ(incremental.computePath(start, goal, path), found);
+    if (found) {
+      EXPECT_NEAR(incremental.getPathCost(), scratch.getPathCost(), 1e-3);
+      EXPECT_LT(incremental.getExpansions(), scratch.getExpansions());
+    }
+  }
+}
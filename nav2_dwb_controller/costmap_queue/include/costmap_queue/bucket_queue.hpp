@@ -0,0 +1,152 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Intel Corporation
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COSTMAP_QUEUE__BUCKET_QUEUE_HPP_
+#define COSTMAP_QUEUE__BUCKET_QUEUE_HPP_
+
+#include <stdexcept>
+#include <vector>
+
+namespace costmap_queue
+{
+/**
+ * @brief Templatized priority queue over a bounded range of integer priorities
+ *
+ * The same interface as MapBasedQueue, except that priorities are the indices of bins in a
+ * flat array instead of keys of a map, so enqueue and pop are constant time. Items of equal
+ * priority come out last in, first out, as they do from MapBasedQueue. The bins keep their
+ * storage over resets, so a queue that is filled the same way on every iteration stops
+ * allocating after the first one.
+ */
+template<class item_t>
+class BucketQueue
+{
+public:
+  /**
+   * @brief Default Constructor
+   */
+  BucketQueue()
+  : item_count_(0), front_bin_(0), last_bin_(0)
+  {
+  }
+
+  virtual ~BucketQueue() = default;
+
+  /**
+   * @brief Clear the queue
+   */
+  virtual void reset()
+  {
+    // popping empties the bins, so only those left with items need clearing
+    if (item_count_ > 0) {
+      for (unsigned int bin = front_bin_; bin <= last_bin_; bin++) {
+        item_bins_[bin].clear();
+      }
+      item_count_ = 0;
+    }
+    front_bin_ = last_bin_ = 0;
+  }
+
+  /**
+   * @brief Add a new item to the queue with a set priority
+   * @param priority Priority of the item, the index of its bin
+   * @param item Payload item
+   */
+  void enqueue(const unsigned int priority, item_t item)
+  {
+    if (priority >= item_bins_.size()) {
+      item_bins_.resize(priority + 1);
+    }
+    item_bins_[priority].push_back(item);
+
+    if (item_count_ == 0) {
+      front_bin_ = last_bin_ = priority;
+    } else if (priority < front_bin_) {
+      front_bin_ = priority;
+    } else if (priority > last_bin_) {
+      last_bin_ = priority;
+    }
+    item_count_++;
+  }
+
+  /**
+   * @brief Check to see if there is anything in the queue
+   * @return True if there is nothing in the queue
+   *
+   * Must be called prior to front/pop.
+   */
+  bool isEmpty()
+  {
+    return item_count_ == 0;
+  }
+
+  /**
+   * @brief Return the item at the front of the queue
+   * @return The item at the front of the queue
+   */
+  item_t & front()
+  {
+    if (item_count_ == 0) {
+      throw std::out_of_range("front() called on empty costmap_queue::BucketQueue!");
+    }
+
+    return item_bins_[front_bin_].back();
+  }
+
+  /**
+   * @brief Remove (and destroy) the item at the front of the queue
+   */
+  void pop()
+  {
+    if (item_count_ == 0) {
+      return;
+    }
+
+    item_bins_[front_bin_].pop_back();
+    item_count_--;
+    while (item_count_ > 0 && item_bins_[front_bin_].empty()) {
+      front_bin_++;
+    }
+  }
+
+protected:
+  std::vector<std::vector<item_t>> item_bins_;
+  unsigned int item_count_;
+  // the lowest and highest bins that may hold items
+  unsigned int front_bin_;
+  unsigned int last_bin_;
+};
+}  // namespace costmap_queue
+
+#endif  // COSTMAP_QUEUE__BUCKET_QUEUE_HPP_
@@ -40,7 +40,7 @@
 #include <limits>
 #include <memory>
 #include "nav2_costmap_2d/costmap_2d.hpp"
-#include "costmap_queue/map_based_queue.hpp"
+#include "costmap_queue/bucket_queue.hpp"
 
 namespace costmap_queue
 {
@@ -103,9 +103,13 @@ public:
  *
  * The validCellToQueue overridable-function allows for deriving classes to limit the queue traversal
  * to a subset of all costmap cells. LimitedCostmapQueue does this by ignoring distances above a limit.
+ * setWindow keeps the traversal inside a rectangle of cells, without going through validCellToQueue.
+ *
+ * Every distance comes from a table of the distances between cells, so the cells are queued in a
+ * BucketQueue, with the rank of each distance among all of those in the table as its priority.
  *
  */
-class CostmapQueue : public MapBasedQueue<CellData>
+class CostmapQueue : public BucketQueue<CellData>
 {
 public:
   /**
@@ -120,6 +124,20 @@ public:
    */
   void reset() override;
 
+  /**
+   * @brief Only expand into the cells of a rectangle, which is kept over resets
+   * @param min_x Lowest x coordinate of the cells to expand into
+   * @param min_y Lowest y coordinate of the cells to expand into
+   * @param max_x Highest x coordinate of the cells to expand into
+   * @param max_y Highest y coordinate of the cells to expand into
+   */
+  void setWindow(unsigned int min_x, unsigned int min_y, unsigned int max_x, unsigned int max_y);
+
+  /**
+   * @brief Expand into every cell of the costmap again
+   */
+  void clearWindow();
+
   /**
    * @brief Add a cell the queue
    * @param x X coordinate of the cell
@@ -160,7 +178,11 @@ protected:
   void computeCache();
 
   nav2_costmap_2d::Costmap2D & costmap_;
-  std::vector<bool> seen_;
+  // a cell was queued since the last reset iff seen_[index] == generation_,
+  // so a reset doesn't have to clear every cell
+  std::vector<unsigned int> seen_;
+  unsigned int generation_;
+  unsigned int window_min_x_, window_min_y_, window_max_x_, window_max_y_;
   int max_distance_;
   bool manhattan_;
 
@@ -181,7 +203,21 @@ protected:
     unsigned int dy = CellData::absolute_difference(cur_y, src_y);
     return cached_distances_[dx][dy];
   }
+
+  /**
+   * @brief  Lookup the rank of the pre-computed distance among all of them, the priority
+   *         of the cell in the queue
+   */
+  inline unsigned int rankLookup(
+    const unsigned int cur_x, const unsigned int cur_y,
+    const unsigned int src_x, const unsigned int src_y)
+  {
+    unsigned int dx = CellData::absolute_difference(cur_x, src_x);
+    unsigned int dy = CellData::absolute_difference(cur_y, src_y);
+    return cached_ranks_[dx][dy];
+  }
   std::vector<std::vector<double>> cached_distances_;
+  std::vector<std::vector<unsigned int>> cached_ranks_;
   int cached_max_distance_;
 };
 }  // namespace costmap_queue
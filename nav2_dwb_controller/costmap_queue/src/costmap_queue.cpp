@@ -34,6 +34,7 @@
 #include "costmap_queue/costmap_queue.hpp"
 #include <algorithm>
 #include <cmath>
+#include <limits>
 #include <vector>
 
 using std::hypot;
@@ -42,9 +43,10 @@ namespace costmap_queue
 {
 
 CostmapQueue::CostmapQueue(nav2_costmap_2d::Costmap2D & costmap, bool manhattan)
-: MapBasedQueue(), costmap_(costmap), max_distance_(-1), manhattan_(manhattan),
+: BucketQueue(), costmap_(costmap), generation_(0), max_distance_(-1), manhattan_(manhattan),
   cached_max_distance_(-1)
 {
+  clearWindow();
   reset();
 }
 
@@ -52,11 +54,31 @@ void CostmapQueue::reset()
 {
   unsigned int size_x = costmap_.getSizeInCellsX(), size_y = costmap_.getSizeInCellsY();
   if (seen_.size() != size_x * size_y) {
-    seen_.resize(size_x * size_y);
+    seen_.assign(size_x * size_y, 0);
+    generation_ = 0;
+  }
+  if (++generation_ == 0) {
+    std::fill(seen_.begin(), seen_.end(), 0);
+    generation_ = 1;
   }
-  std::fill(seen_.begin(), seen_.end(), false);
   computeCache();
-  MapBasedQueue::reset();
+  BucketQueue::reset();
+}
+
+void CostmapQueue::setWindow(
+  unsigned int min_x, unsigned int min_y, unsigned int max_x,
+  unsigned int max_y)
+{
+  window_min_x_ = min_x;
+  window_min_y_ = min_y;
+  window_max_x_ = max_x;
+  window_max_y_ = max_y;
+}
+
+void CostmapQueue::clearWindow()
+{
+  unsigned int everything = std::numeric_limits<unsigned int>::max();
+  setWindow(0, 0, everything, everything);
 }
 
 void CostmapQueue::enqueueCell(unsigned int x, unsigned int y)
@@ -69,15 +91,15 @@ void CostmapQueue::enqueueCell(
   unsigned int index, unsigned int cur_x, unsigned int cur_y,
   unsigned int src_x, unsigned int src_y)
 {
-  if (seen_[index]) {return;}
+  if (seen_[index] == generation_) {return;}
 
   // we compute our distance table one cell further than the inflation radius
   // dictates so we can make the check below
   double distance = distanceLookup(cur_x, cur_y, src_x, src_y);
   CellData data(distance, index, cur_x, cur_y, src_x, src_y);
   if (validCellToQueue(data)) {
-    seen_[index] = true;
-    enqueue(distance, data);
+    seen_[index] = generation_;
+    enqueue(rankLookup(cur_x, cur_y, src_x, src_y), data);
   }
 }
 
@@ -95,16 +117,18 @@ CellData CostmapQueue::getNextCell()
 
   // attempt to put the neighbors of the current cell onto the queue
   unsigned int size_x = costmap_.getSizeInCellsX();
-  if (mx > 0) {
+  unsigned int max_x = std::min(window_max_x_, size_x - 1);
+  unsigned int max_y = std::min(window_max_y_, costmap_.getSizeInCellsY() - 1);
+  if (mx > window_min_x_) {
     enqueueCell(index - 1, mx - 1, my, sx, sy);
   }
-  if (my > 0) {
+  if (my > window_min_y_) {
     enqueueCell(index - size_x, mx, my - 1, sx, sy);
   }
-  if (mx < size_x - 1) {
+  if (mx < max_x) {
     enqueueCell(index + 1, mx + 1, my, sx, sy);
   }
-  if (my < costmap_.getSizeInCellsY() - 1) {
+  if (my < max_y) {
     enqueueCell(index + size_x, mx, my + 1, sx, sy);
   }
 
@@ -131,6 +155,31 @@ void CostmapQueue::computeCache()
       }
     }
   }
+
+  // The distances are ordered like the squared (or Manhattan) distances, which are integers
+  // small enough to count, so the rank of each is the number of smaller ones that occur
+  auto key = [this](unsigned int i, unsigned int j) {return manhattan_ ? i + j : i * i + j * j;};
+  unsigned int size = cached_distances_.size();
+  std::vector<unsigned int> ranks(key(size - 1, size - 1) + 1, 0);
+  for (unsigned int i = 0; i < size; ++i) {
+    for (unsigned int j = 0; j < size; ++j) {
+      ranks[key(i, j)] = 1;
+    }
+  }
+  unsigned int rank = 0;
+  for (unsigned int & present : ranks) {
+    unsigned int next_rank = rank + present;
+    present = rank;
+    rank = next_rank;
+  }
+
+  cached_ranks_.resize(size);
+  for (unsigned int i = 0; i < size; ++i) {
+    cached_ranks_[i].resize(size);
+    for (unsigned int j = 0; j < size; ++j) {
+      cached_ranks_[i][j] = ranks[key(i, j)];
+    }
+  }
   cached_max_distance_ = max_distance_;
 }
 
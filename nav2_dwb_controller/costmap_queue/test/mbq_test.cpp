@@ -32,13 +32,17 @@
  *  POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <stdexcept>
 #include <string>
 #include "gtest/gtest.h"
+#include "costmap_queue/bucket_queue.hpp"
 #include "costmap_queue/map_based_queue.hpp"
 
+using costmap_queue::BucketQueue;
 using costmap_queue::MapBasedQueue;
 
-void letter_test(MapBasedQueue<char> & q, const char test_letter)
+template<class QueueT>
+void letter_test(QueueT & q, const char test_letter)
 {
   ASSERT_FALSE(q.isEmpty());
   char c = q.front();
@@ -110,6 +114,64 @@ TEST(MapBasedQueue, checkDynamicOrdering3)
   letter_test(q, 'D');
 }
 
+TEST(BucketQueue, emptyQueue)
+{
+  BucketQueue<char> q;
+  EXPECT_TRUE(q.isEmpty());
+  EXPECT_THROW(q.front(), std::out_of_range);
+  q.enqueue(1, 'A');
+  EXPECT_FALSE(q.isEmpty());
+}
+
+TEST(BucketQueue, checkOrdering)
+{
+  BucketQueue<char> q;
+  q.enqueue(1, 'A');
+  q.enqueue(3, 'B');
+  q.enqueue(2, 'C');
+  q.enqueue(5, 'D');
+  q.enqueue(0, 'E');
+  q.enqueue(2, 'F');
+
+  // last in, first out within a priority
+  std::string expected = "EAFCBD";
+  for (unsigned int i = 0; i < expected.size(); i++) {
+    letter_test(q, expected[i]);
+  }
+  EXPECT_TRUE(q.isEmpty());
+}
+
+TEST(BucketQueue, checkDynamicOrdering)
+{
+  BucketQueue<char> q;
+  q.enqueue(1, 'A');
+  q.enqueue(2, 'B');
+  q.enqueue(5, 'D');
+  letter_test(q, 'A');
+  letter_test(q, 'B');
+  q.enqueue(1, 'C');
+  letter_test(q, 'C');
+  letter_test(q, 'D');
+  EXPECT_TRUE(q.isEmpty());
+}
+
+TEST(BucketQueue, reset)
+{
+  BucketQueue<char> q;
+  q.enqueue(4, 'A');
+  q.enqueue(7, 'B');
+  q.enqueue(2, 'C');
+  letter_test(q, 'C');
+  q.reset();
+  EXPECT_TRUE(q.isEmpty());
+
+  q.enqueue(6, 'D');
+  q.enqueue(3, 'E');
+  letter_test(q, 'E');
+  letter_test(q, 'D');
+  EXPECT_TRUE(q.isEmpty());
+}
+
 int main(int argc, char ** argv)
 {
   testing::InitGoogleTest(&argc, argv);
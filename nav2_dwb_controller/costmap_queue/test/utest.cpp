@@ -33,6 +33,7 @@
  */
 
 #include <cmath>
+#include <cstdlib>
 #include <memory>
 #include <algorithm>
 #include "gtest/gtest.h"
@@ -135,6 +136,46 @@ TEST(CostmapQueue, limitedQueue)
   EXPECT_EQ(count, 11);
 }
 
+TEST(CostmapQueue, windowQueue)
+{
+  costmap_queue::CostmapQueue q(costmap, true);
+  q.setWindow(1, 1, 3, 2);
+  int count = 0;
+  q.enqueueCell(2, 2);
+  while (!q.isEmpty()) {
+    costmap_queue::CellData cell = q.getNextCell();
+    EXPECT_GE(cell.x_, 1u);
+    EXPECT_LE(cell.x_, 3u);
+    EXPECT_GE(cell.y_, 1u);
+    EXPECT_LE(cell.y_, 2u);
+    EXPECT_EQ(
+      cell.distance_,
+      std::abs(static_cast<int>(cell.x_) - 2) + std::abs(static_cast<int>(cell.y_) - 2));
+    count++;
+  }
+  EXPECT_EQ(count, 6);
+
+  // The window is kept, and the cells seen before are queued again after a reset
+  q.reset();
+  count = 0;
+  q.enqueueCell(2, 2);
+  while (!q.isEmpty()) {
+    q.getNextCell();
+    count++;
+  }
+  EXPECT_EQ(count, 6);
+
+  q.reset();
+  q.clearWindow();
+  count = 0;
+  q.enqueueCell(2, 2);
+  while (!q.isEmpty()) {
+    q.getNextCell();
+    count++;
+  }
+  EXPECT_EQ(count, 25);
+}
+
 int main(int argc, char ** argv)
 {
   testing::InitGoogleTest(&argc, argv);
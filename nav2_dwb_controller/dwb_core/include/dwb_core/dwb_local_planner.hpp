@@ -35,6 +35,8 @@
 #ifndef DWB_CORE__DWB_LOCAL_PLANNER_HPP_
 #define DWB_CORE__DWB_LOCAL_PLANNER_HPP_
 
+#include <chrono>
+#include <exception>
 #include <memory>
 #include <string>
 #include <vector>
@@ -42,10 +44,13 @@
 #include "nav2_core/controller.hpp"
 #include "nav2_core/goal_checker.hpp"
 #include "dwb_core/publisher.hpp"
+#include "dwb_core/shared_grids.hpp"
+#include "dwb_core/trajectory_cells.hpp"
 #include "dwb_core/trajectory_critic.hpp"
 #include "dwb_core/trajectory_generator.hpp"
 #include "nav_2d_msgs/msg/pose2_d_stamped.hpp"
 #include "nav_2d_msgs/msg/twist2_d_stamped.hpp"
+#include "nav2_util/thread_pool.hpp"
 #include "rclcpp/rclcpp.hpp"
 #include "rclcpp_lifecycle/lifecycle_node.hpp"
 #include "pluginlib/class_loader.hpp"
@@ -83,6 +88,15 @@ public:
    */
   void setPlan(const nav_msgs::msg::Path & path) override;
 
+  /**
+   * @brief nav2_core splicePlan - Replace the plan from a pose on, without resetting the critics
+   *
+   * Only the new poses are converted. It fails if the poses to replace were pruned already.
+   * @param path The new plan
+   * @param index The number of poses the new plan shares with the current one
+   */
+  bool splicePlan(const nav_msgs::msg::Path & path, size_t index) override;
+
   /**
    * @brief nav2_core computeVelocityCommands - calculates the best command given the current pose and velocity
    *
@@ -113,6 +127,16 @@ public:
     const geometry_msgs::msg::PoseStamped & pose,
     const geometry_msgs::msg::Twist & velocity) override;
 
+  /**
+   * @brief The total score of the trajectory last chosen by computeVelocityCommands
+   */
+  double getLastCommandCost() const override {return last_command_cost_;}
+
+  /**
+   * @brief Stop taking new twists once the budget is spent and at least one is legal
+   */
+  void setTimeBudget(double seconds) override {time_budget_ = seconds;}
+
   /**
    * @brief Score a given command. Can be used for testing.
    *
@@ -157,14 +181,145 @@ protected:
     const nav_2d_msgs::msg::Pose2DStamped & pose, nav_2d_msgs::msg::Path2D & transformed_plan,
     nav_2d_msgs::msg::Pose2DStamped & goal_pose, bool publish_plan = true);
 
+  /**
+   * @brief Prepare all the critics for the coming set of trajectories
+   *
+   * The critics that can be prepared in parallel are prepared on the prepare pool,
+   * if there is one, the others one after another in the order they were loaded.
+   */
+  void prepareCritics(
+    const geometry_msgs::msg::Pose2D & pose, const nav_2d_msgs::msg::Twist2D & velocity,
+    const geometry_msgs::msg::Pose2D & goal, const nav_2d_msgs::msg::Path2D & plan);
+
+  /**
+   * @brief Copy the cells the critics can read into costmap_snapshot_, under the costmap lock
+   *
+   * Those are the cells within reach of the robot, grown by the circumscribed radius for
+   * the footprints, and the cells under the plan, which the path and goal critics look at.
+   */
+  void snapshotCostmap(
+    const geometry_msgs::msg::Pose2D & pose, double reach,
+    const nav_2d_msgs::msg::Path2D & plan);
+
+  /**
+   * @brief The costmap the critics score against this cycle
+   */
+  nav2_costmap_2d::Costmap2D * scoringCostmap()
+  {
+    return costmap_snapshot_ ? costmap_snapshot_.get() : costmap_ros_->getCostmap();
+  }
+
+  /**
+   * @brief A trajectory of the current cycle with its scores
+   *
+   * The candidates are kept from one cycle to the next, so once their vectors have grown
+   * to fit, generating and scoring the trajectories doesn't allocate. They are only turned
+   * into TrajectoryScore messages for the best one, or for all when recording evaluations.
+   */
+  struct Candidate
+  {
+    dwb_msgs::msg::Trajectory2D traj;
+    std::vector<double> raw_scores;  ///< By the index of the critic in critics_
+    size_t critics_scored;  ///< The scores of the first critics in critic_order_ taken
+    double total;
+    IllegalReason illegal_reason;  ///< None for a legal trajectory
+    size_t illegal_critic;  ///< The index of the critic that found it illegal
+    TrajectoryCells cells;  ///< Looked up for the first critic using them
+  };
+
+  /**
+   * @brief Score the trajectory of a candidate, as scoreTrajectory does
+   *
+   * A critic reporting the trajectory illegal through tryScoreTrajectory is recorded in the
+   * candidate, while an IllegalTrajectoryException thrown by a critic is passed on.
+   *
+   * @param candidate The candidate, whose traj is scored
+   * @param best_score If positive, the threshold for early termination
+   * @param record_stats Whether to add to critic_stats_, only when scoring one at a time
+   */
+  void scoreCandidate(Candidate & candidate, double best_score, bool record_stats = false);
+
+  /**
+   * @brief Score the candidates [begin, end) on the scoring pool, one critic at a time
+   *
+   * Each critic gets the trajectories no critic before it found illegal, split into a batch
+   * per thread of the pool, so it goes over all of them while its grids are in cache, and
+   * the illegal ones aren't scored any further. The scores are the same as those of
+   * scoreCandidate without short circuiting. Exceptions thrown by a critic for a trajectory
+   * are stored in errors_, at the index of the candidate from begin.
+   */
+  void scoreCandidatesByCritic(size_t begin, size_t end);
+
+  /**
+   * @brief How long a critic took and how often it ended the scoring of a trajectory
+   *
+   * Decayed after every cycle profiled, so they follow what the critics cost lately.
+   */
+  struct CriticStats
+  {
+    double seconds = 0.0;
+    double calls = 0.0;
+    double illegal = 0.0;  ///< Found the trajectory illegal
+    double rejections = 0.0;  ///< Found the trajectory illegal or pushed it past the best
+  };
+
+  /**
+   * @brief Order critic_order_ by the time each critic takes per trajectory it rejects
+   *
+   * The pinned critics stay first, in the order they were configured.
+   */
+  void reorderCritics();
+
+  /**
+   * @brief Publish the CriticProfiles from critic_stats_, if anyone listens
+   */
+  void publishCriticProfiles(const std_msgs::msg::Header & header);
+
+  /**
+   * @brief The scores of a candidate as a message, with the critic names filled in
+   */
+  dwb_msgs::msg::TrajectoryScore toTrajectoryScore(const Candidate & candidate);
+
   /**
    * @brief Iterate through all the twists and find the best one
+   *
+   * With a scoring pool and critics that all can score in parallel, the trajectories are
+   * generated and scored on the pool, without short circuiting, and then gone through in
+   * the order of the twists, so the results are the same as when scoring them one at a time.
+   * With batch_scoring, they are scored critic by critic, see scoreCandidatesByCritic.
+   *
+   * Otherwise, with warm_start_twists, the twists closest to the best one of the last cycle
+   * are scored first, so short circuiting has a good score to compare against from the start.
+   * Ties are broken by the order of the twists, so this only changes how much is scored.
+   *
+   * With a time budget, no more twists are taken once the deadline has passed and one of
+   * them is legal, between rounds when scoring in parallel, else between twists.
    */
   virtual dwb_msgs::msg::TrajectoryScore coreScoringAlgorithm(
     const geometry_msgs::msg::Pose2D & pose,
     const nav_2d_msgs::msg::Twist2D velocity,
     std::shared_ptr<dwb_msgs::msg::LocalPlanEvaluation> & results);
 
+  /**
+   * @brief Search the slow twists of fallback_twists_ after coreScoringAlgorithm found no legal one
+   *
+   * The twists are scored one at a time with the critics as prepared for the cycle, until
+   * fallback_time_budget_ is spent, and recorded in the results as the others.
+   *
+   * @param best Set to the best legal trajectory found
+   * @return False if the fallback search is off, or none of its twists is legal
+   */
+  virtual bool fallbackScoringAlgorithm(
+    const geometry_msgs::msg::Pose2D & pose,
+    const nav_2d_msgs::msg::Twist2D & velocity,
+    std::shared_ptr<dwb_msgs::msg::LocalPlanEvaluation> & results,
+    dwb_msgs::msg::TrajectoryScore & best);
+
+  /**
+   * @brief Fill fallback_twists_ with a lattice of slow twists, the rotations in place included
+   */
+  void buildFallbackTwists();
+
   /**
    * @brief Transforms global plan into same frame as pose, clips far away poses and possibly prunes passed poses
    *
@@ -174,12 +329,21 @@ protected:
    * 3) If prune_plan_ is true, it will remove all points that we've already passed from both the transformed plan
    *     and the saved global_plan_. Technically, it iterates to a pose on the path that is within prune_distance_
    *     of the robot and erases all poses before that.
+   *
+   * When incremental_plan_ is set, the passed poses are not erased. The index of the first pose
+   * that hasn't been passed is kept instead, and the next search only looks forward from it over
+   * plan_search_window_ meters of the path, so the cost of a cycle doesn't grow with the plan.
+   * The index starts over when setPlan brings in a new plan.
    */
   virtual nav_2d_msgs::msg::Path2D transformGlobalPlan(
     const nav_2d_msgs::msg::Pose2DStamped & pose);
   nav_2d_msgs::msg::Path2D global_plan_;  ///< Saved Global Plan
   bool prune_plan_;
   double prune_distance_;
+  bool incremental_plan_;
+  double plan_search_window_;
+  size_t plan_start_index_;  ///< First pose of global_plan_ not passed yet, see incremental_plan_
+  size_t plan_pruned_poses_;  ///< Poses erased from the front of global_plan_ by prune_plan_
   bool debug_trajectory_details_;
   rclcpp::Duration transform_tolerance_{0, 0};
 
@@ -216,6 +380,46 @@ protected:
   pluginlib::ClassLoader<TrajectoryCritic> critic_loader_;
   std::vector<TrajectoryCritic::Ptr> critics_;
 
+  // Grids the critics compute while they are prepared, shared for one control cycle
+  std::shared_ptr<SharedGrids> shared_grids_;
+  std::unique_ptr<nav2_util::ThreadPool> prepare_pool_;
+  std::unique_ptr<nav2_util::ThreadPool> scoring_pool_;
+
+  // The cells of the costmap the critics read this cycle, null to read the costmap itself
+  std::unique_ptr<nav2_costmap_2d::Costmap2D> costmap_snapshot_;
+
+  // Storage for the trajectories of a cycle, reused from cycle to cycle
+  std::vector<nav_2d_msgs::msg::Twist2D> twists_;
+  std::vector<Candidate> candidates_;
+  std::vector<std::exception_ptr> errors_;
+  std::vector<size_t> scoring_order_;
+
+  // The candidates still legal while scoring by critic, with their trajectories and results
+  bool batch_scoring_;
+  std::vector<size_t> batch_candidates_;
+  std::vector<const dwb_msgs::msg::Trajectory2D *> batch_trajs_;
+  std::vector<double> batch_scores_;
+  std::vector<IllegalReason> batch_reasons_;
+
+  // The order the critics score in, by their index in critics_, see reorder_critics
+  std::vector<size_t> critic_order_;
+  std::vector<CriticStats> critic_stats_;
+  std::vector<bool> critic_pinned_;
+  bool reorder_critics_;
+
+  int warm_start_twists_;
+  bool has_last_best_;
+  double last_command_cost_ = -1.0;
+
+  // The time budget of computeVelocityCommands, none if not positive, and the current deadline
+  double time_budget_ = 0.0;
+  std::chrono::steady_clock::time_point deadline_;
+  nav_2d_msgs::msg::Twist2D last_best_twist_;
+
+  // The twists tried when none of those of the generator is legal, see fallback_search
+  std::vector<nav_2d_msgs::msg::Twist2D> fallback_twists_;
+  double fallback_time_budget_;
+
   std::string dwb_plugin_name_;
 
   bool short_circuit_trajectory_evaluation_;
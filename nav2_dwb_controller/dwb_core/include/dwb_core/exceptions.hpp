@@ -69,6 +69,53 @@ protected:
   std::string critic_name_;
 };
 
+/**
+ * @brief Why a critic found a trajectory illegal, for critics reporting it without throwing
+ */
+enum class IllegalReason
+{
+  None,  ///< The trajectory is legal
+  OffGrid,
+  FootprintOffGrid,
+  HitsObstacle,
+  HitsUnknown,
+  HitsUnreachable,
+  Oscillating,
+  NotSlowingDown,
+  NonRotationNearGoal,
+  EmptyTrajectory
+};
+
+/**
+ * @brief The description of a reason, as an IllegalTrajectoryException for it would carry
+ */
+inline const char * illegalReasonDescription(IllegalReason reason)
+{
+  switch (reason) {
+    case IllegalReason::None:
+      return "Trajectory is legal.";
+    case IllegalReason::OffGrid:
+      return "Trajectory Goes Off Grid.";
+    case IllegalReason::FootprintOffGrid:
+      return "Footprint Goes Off Grid.";
+    case IllegalReason::HitsObstacle:
+      return "Trajectory Hits Obstacle.";
+    case IllegalReason::HitsUnknown:
+      return "Trajectory Hits Unknown Region.";
+    case IllegalReason::HitsUnreachable:
+      return "Trajectory Hits Unreachable Area.";
+    case IllegalReason::Oscillating:
+      return "Trajectory is oscillating.";
+    case IllegalReason::NotSlowingDown:
+      return "Not slowing down near goal.";
+    case IllegalReason::NonRotationNearGoal:
+      return "Nonrotation command near goal.";
+    case IllegalReason::EmptyTrajectory:
+      return "Empty trajectory.";
+  }
+  return "Unknown reason.";
+}
+
 }  // namespace dwb_core
 
 #endif  // DWB_CORE__EXCEPTIONS_HPP_
@@ -38,6 +38,7 @@
 #include <map>
 #include <utility>
 #include <string>
+#include <vector>
 #include "dwb_core/exceptions.hpp"
 #include "nav2_core/exceptions.hpp"
 
@@ -50,6 +51,14 @@ public:
   : legal_count_(0), illegal_count_(0) {}
 
   void addIllegalTrajectory(const IllegalTrajectoryException & e);
+
+  /**
+   * @brief Count an illegal trajectory a critic reported by its reason
+   *
+   * Counted without building a key from the name and description, as that allocates
+   * for every illegal trajectory.
+   */
+  void addIllegalTrajectory(const std::string & critic_name, IllegalReason reason);
   void addLegalTrajectory();
 
   std::map<std::pair<std::string, std::string>, double> getPercentages() const;
@@ -57,7 +66,15 @@ public:
   std::string getMessage() const;
 
 protected:
+  struct ReasonCount
+  {
+    std::string critic_name;
+    IllegalReason reason;
+    unsigned int count;
+  };
+
   std::map<std::pair<std::string, std::string>, unsigned int> counts_;
+  std::vector<ReasonCount> reason_counts_;  ///< Only a few, one per critic and reason
   unsigned int legal_count_, illegal_count_;
 };
 
@@ -35,12 +35,18 @@
 #ifndef DWB_CORE__PUBLISHER_HPP_
 #define DWB_CORE__PUBLISHER_HPP_
 
+#include <chrono>
+#include <condition_variable>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "nav2_costmap_2d/costmap_2d_ros.hpp"
 #include "dwb_core/trajectory_critic.hpp"
+#include "dwb_msgs/msg/critic_profiles.hpp"
 #include "dwb_msgs/msg/local_plan_evaluation.hpp"
 #include "nav_msgs/msg/path.hpp"
 #include "rclcpp/rclcpp.hpp"
@@ -65,11 +71,19 @@ namespace dwb_core
  *   4) The Full LocalPlanEvaluation
  *   5) Markers representing the different trajectories evaluated
  *   6) The CostGrid (in the form of a complex PointCloud2)
+ *   7) The CriticProfiles, how long the critics take and how often they reject trajectories
+ *
+ * Only topics with subscribers are published. The evaluation, the trajectories and the cost grid
+ * can be limited to debug_publish_rate, and with publish_async they are converted and published
+ * on a thread of their own, from a snapshot taken by the planner, so that debugging output
+ * doesn't change the timing of the controller. When that thread falls behind, only the newest
+ * snapshot of each kind is published.
  */
 class DWBPublisher
 {
 public:
   explicit DWBPublisher(nav2_util::LifecycleNode::SharedPtr node, const std::string & plugin_name);
+  ~DWBPublisher();
 
   nav2_util::CallbackReturn on_configure();
   nav2_util::CallbackReturn on_activate();
@@ -78,9 +92,15 @@ public:
 
   /**
    * @brief Does the publisher require that the LocalPlanEvaluation be saved
-   * @return True if the Evaluation is needed to publish either directly or as trajectories
+   * @return True if the Evaluation is needed to publish either directly or as trajectories,
+   *         someone listens for it and it is due
+   */
+  bool shouldRecordEvaluation();
+
+  /**
+   * @brief Whether anyone listens for the CriticProfiles, so the critics need to be profiled
    */
-  bool shouldRecordEvaluation() {return publish_evaluation_ || publish_trajectories_;}
+  bool shouldPublishCriticProfiles();
 
   /**
    * @brief If the pointer is not null, publish the evaluation and trajectories as needed
@@ -92,13 +112,38 @@ public:
   void publishCostGrid(
     const std::shared_ptr<nav2_costmap_2d::Costmap2DROS> costmap_ros,
     const std::vector<TrajectoryCritic::Ptr> critics);
+  void publishCriticProfiles(const dwb_msgs::msg::CriticProfiles & profiles);
   void publishGlobalPlan(const nav_2d_msgs::msg::Path2D plan);
   void publishTransformedPlan(const nav_2d_msgs::msg::Path2D plan);
   void publishLocalPlan(const nav_2d_msgs::msg::Path2D plan);
 
 protected:
+  // The kinds of debugging output that are rate limited and may be published asynchronously
+  enum DebugOutput
+  {
+    EVALUATION = 0,
+    COST_GRID,
+    DEBUG_OUTPUT_COUNT
+  };
+
   void publishTrajectories(const dwb_msgs::msg::LocalPlanEvaluation & results);
 
+  /**
+   * @brief Whether the debug output is due again, given debug_publish_rate
+   */
+  bool isDue(DebugOutput output) const;
+
+  /**
+   * @brief Run the job that publishes the output, on the publishing thread when there is one
+   *
+   * Whichever job of the same kind was still waiting there is dropped.
+   */
+  void dispatch(DebugOutput output, std::function<void()> job);
+
+  void startPublishingThread();
+  void stopPublishingThread();
+  void publishingThread();
+
   // Helper function for publishing other plans
   void publishGenericPlan(
     const nav_2d_msgs::msg::Path2D plan,
@@ -111,7 +156,14 @@ protected:
   bool publish_local_plan_;
   bool publish_trajectories_;
   bool publish_cost_grid_pc_;
+  bool publish_critic_profiles_;
   bool publish_input_params_;
+  bool publish_async_;
+  int max_published_trajectories_;
+
+  // The shortest time between two publications of each kind of debug output
+  std::chrono::steady_clock::duration debug_publish_period_;
+  std::chrono::steady_clock::time_point next_debug_publish_[DEBUG_OUTPUT_COUNT];
 
   // Marker Lifetime
   builtin_interfaces::msg::Duration marker_lifetime_;
@@ -123,9 +175,17 @@ protected:
   std::shared_ptr<LifecyclePublisher<nav_msgs::msg::Path>> local_pub_;
   std::shared_ptr<LifecyclePublisher<visualization_msgs::msg::MarkerArray>> marker_pub_;
   std::shared_ptr<LifecyclePublisher<sensor_msgs::msg::PointCloud>> cost_grid_pc_pub_;
+  std::shared_ptr<LifecyclePublisher<dwb_msgs::msg::CriticProfiles>> critic_profiles_pub_;
 
   nav2_util::LifecycleNode::SharedPtr node_;
   std::string plugin_name_;
+
+  // The publishing thread and the newest job of each kind it has yet to run, guarded by mutex_
+  std::thread publishing_thread_;
+  std::mutex mutex_;
+  std::condition_variable jobs_cv_;
+  std::function<void()> pending_jobs_[DEBUG_OUTPUT_COUNT];
+  bool stop_publishing_{false};
 };
 
 }  // namespace dwb_core
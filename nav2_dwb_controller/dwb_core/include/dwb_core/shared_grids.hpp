@@ -0,0 +1,187 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Intel Corporation
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef DWB_CORE__SHARED_GRIDS_HPP_
+#define DWB_CORE__SHARED_GRIDS_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace dwb_core
+{
+
+/**
+ * @class StampedGrid
+ * @brief The values of a grid of cells, of which only those set since the last reset hold one
+ *
+ * Every cell is stamped with the generation it was set in, so a reset starts a new generation
+ * instead of clearing the cells. The grid also records the window of cells it was computed
+ * over, outside of which no cell is set.
+ */
+class StampedGrid
+{
+public:
+  /**
+   * @brief Leave every cell unset
+   * @param size The number of cells
+   */
+  void reset(size_t size)
+  {
+    if (stamps_.size() != size) {
+      values_.resize(size);
+      stamps_.assign(size, 0);
+      generation_ = 0;
+    }
+    if (++generation_ == 0) {
+      std::fill(stamps_.begin(), stamps_.end(), 0);
+      generation_ = 1;
+    }
+    setWindow(0, 0, 0, 0);
+  }
+
+  inline bool isSet(size_t index) const {return stamps_[index] == generation_;}
+
+  /**
+   * @brief The value of a cell, or unset if it was not set since the last reset
+   */
+  inline double get(size_t index, double unset) const
+  {
+    return isSet(index) ? values_[index] : unset;
+  }
+
+  inline void set(size_t index, double value)
+  {
+    values_[index] = value;
+    stamps_[index] = generation_;
+  }
+
+  size_t size() const {return stamps_.size();}
+
+  void setWindow(unsigned int min_x, unsigned int min_y, unsigned int max_x, unsigned int max_y)
+  {
+    min_x_ = min_x;
+    min_y_ = min_y;
+    max_x_ = max_x;
+    max_y_ = max_y;
+  }
+
+  /**
+   * @brief Whether the window the grid was computed over holds the given one
+   */
+  bool covers(unsigned int min_x, unsigned int min_y, unsigned int max_x, unsigned int max_y) const
+  {
+    return min_x_ <= min_x && min_y_ <= min_y && max_x_ >= max_x && max_y_ >= max_y;
+  }
+
+protected:
+  std::vector<double> values_;
+  std::vector<uint32_t> stamps_;
+  uint32_t generation_{0};
+  unsigned int min_x_{0}, min_y_{0}, max_x_{0}, max_y_{0};
+};
+
+/**
+ * @class SharedGrids
+ * @brief Grids of per-cell values that the critics of one planner compute while they
+ *        are prepared, kept for one control cycle so critics needing the same grid share it
+ *
+ * A critic asks for a grid by its kind and a key holding everything the grid depends on,
+ * such as the size of the costmap and the cells it was seeded from. The first critic to
+ * ask computes it, any other asking for the same grid in the same cycle gets that one,
+ * waiting for it if it is still being computed on another thread. The grids of past cycles are
+ * reused once no critic holds them any more, so computing a grid doesn't allocate.
+ *
+ * The grids of the last cycle are kept through one clear, so the first critic asking for a
+ * grid can take one of them over as it is, or derive the new grid from one, instead of
+ * computing it again when the plan and the robot barely moved.
+ */
+class SharedGrids
+{
+public:
+  using Grid = StampedGrid;
+  using Key = std::vector<unsigned int>;
+
+  /// What a grid of the last cycle is good for, see Reuse
+  enum class Reused {None, AsIs, Derived};
+
+  /**
+   * @brief Decides whether a grid of the last cycle, of the same kind and computed for
+   *        last_key, can stand in for the one asked for: as it is, or by filling in grid from it
+   */
+  using Reuse = std::function<Reused(const Key & last_key, const Grid & last, Grid & grid)>;
+
+  /**
+   * @brief Get a grid, computing it if no critic has asked for it since the last clear
+   * @param kind What the grid holds, so different kinds of grid never share a key
+   * @param key Everything the values of the grid depend on
+   * @param compute Fills in the grid when it has to be computed, starting with a reset
+   * @param reuse Tried on the grids of the last cycle of the same kind before computing
+   * @return The grid, which must not be changed as other critics may be reading it
+   */
+  std::shared_ptr<const Grid> get(
+    const std::string & kind, const Key & key,
+    const std::function<void(Grid &)> & compute,
+    const Reuse & reuse = Reuse());
+
+  /**
+   * @brief Start a new cycle, keeping the grids of the one ending for reuse
+   */
+  void clear();
+
+protected:
+  /**
+   * @brief A grid no critic holds, for computing a new one into
+   */
+  std::shared_ptr<Grid> spareGrid();
+
+  std::mutex mutex_;
+  std::map<std::pair<std::string, Key>, std::shared_future<std::shared_ptr<const Grid>>> grids_;
+  std::vector<std::shared_ptr<Grid>> all_grids_;
+
+  // The grids computed in the last cycle, by kind, and the keys they were computed for
+  std::multimap<std::string, std::pair<Key, std::shared_ptr<const Grid>>> last_grids_;
+};
+
+}  // namespace dwb_core
+
+#endif  // DWB_CORE__SHARED_GRIDS_HPP_
@@ -0,0 +1,93 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Intel Corporation
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef DWB_CORE__TRAJECTORY_CELLS_HPP_
+#define DWB_CORE__TRAJECTORY_CELLS_HPP_
+
+#include <vector>
+
+#include "dwb_msgs/msg/trajectory2_d.hpp"
+#include "nav2_costmap_2d/costmap_2d.hpp"
+
+namespace dwb_core
+{
+
+/**
+ * @class TrajectoryCells
+ * @brief The costmap cell of every pose of a trajectory and its cost, looked up once per
+ * trajectory by the planner and shared by the critics scoring the trajectory pose by pose
+ */
+class TrajectoryCells
+{
+public:
+  struct Cell
+  {
+    unsigned int x, y;
+    unsigned int index;  ///< The index of the cell in the costmap
+    unsigned char cost;
+    bool on_grid;  ///< False for a pose off the costmap, whose other fields are then unset
+  };
+
+  /**
+   * @brief Look up the cells of the poses of a trajectory
+   */
+  void compute(
+    const nav2_costmap_2d::Costmap2D & costmap,
+    const dwb_msgs::msg::Trajectory2D & traj)
+  {
+    const unsigned char * costs = costmap.getCharMap();
+    cells_.resize(traj.poses.size());
+    for (size_t i = 0; i < traj.poses.size(); i++) {
+      Cell & cell = cells_[i];
+      cell.on_grid = costmap.worldToMap(traj.poses[i].x, traj.poses[i].y, cell.x, cell.y);
+      if (cell.on_grid) {
+        cell.index = costmap.getIndex(cell.x, cell.y);
+        cell.cost = costs[cell.index];
+      }
+    }
+  }
+
+  /** @brief The cell of each pose of the trajectory, in order */
+  const std::vector<Cell> & cells() const {return cells_;}
+
+  size_t size() const {return cells_.size();}
+  const Cell & operator[](size_t i) const {return cells_[i];}
+
+private:
+  std::vector<Cell> cells_;
+};
+
+}  // namespace dwb_core
+
+#endif  // DWB_CORE__TRAJECTORY_CELLS_HPP_
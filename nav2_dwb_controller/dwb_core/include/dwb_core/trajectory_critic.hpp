@@ -47,6 +47,9 @@
 #include "dwb_msgs/msg/trajectory2_d.hpp"
 #include "sensor_msgs/msg/point_cloud.hpp"
 #include "nav2_util/lifecycle_node.hpp"
+#include "dwb_core/exceptions.hpp"
+#include "dwb_core/shared_grids.hpp"
+#include "dwb_core/trajectory_cells.hpp"
 
 namespace dwb_core
 {
@@ -137,6 +140,42 @@ public:
     return true;
   }
 
+  /**
+   * @brief Whether prepare can run at the same time as the prepare of other critics
+   *
+   * Critics whose prepare only reads the costmap and changes nothing but their own
+   * state may return true, letting the planner prepare them in parallel.
+   */
+  virtual bool canPrepareInParallel() const {return false;}
+
+  /**
+   * @brief Whether scoreTrajectory can be called for several trajectories at the same time
+   *
+   * Critics whose scoreTrajectory and getScale only read what prepare left behind may
+   * return true, letting the planner score the trajectories in parallel.
+   */
+  virtual bool canScoreInParallel() const {return false;}
+
+  /**
+   * @brief Set the grids that the critics of the planner share while they are prepared
+   */
+  void setSharedGrids(std::shared_ptr<SharedGrids> shared_grids) {shared_grids_ = shared_grids;}
+
+  /**
+   * @brief Set how far from the robot the trajectories scored after the next prepare can go
+   * @param reach Distance in meters, negative if there is no bound
+   */
+  void setReach(double reach) {reach_ = reach;}
+
+  /**
+   * @brief Read the costs from this costmap instead of the one of costmap_ros
+   *
+   * With snapshot_costmap, the planner copies the cells the critics can read into a
+   * costmap of the same size, resolution and origin at the start of every cycle, so the
+   * critics don't read the costmap while it is updated. Critics reading costs override this.
+   */
+  virtual void setCostmap(nav2_costmap_2d::Costmap2D * /*costmap*/) {}
+
   /**
    * @brief Return a raw score for the given trajectory.
    *
@@ -145,6 +184,69 @@ public:
    */
   virtual double scoreTrajectory(const dwb_msgs::msg::Trajectory2D & traj) = 0;
 
+  /**
+   * @brief Score a trajectory, reporting an illegal one by its reason instead of throwing
+   *
+   * Unwinding an exception for every illegal trajectory is costly when most of them are.
+   * The default calls scoreTrajectory, whose exceptions still reach the caller. Critics
+   * overriding this can implement scoreTrajectory with scoreTrajectoryOrThrow.
+   *
+   * @param traj The trajectory to score
+   * @param score Set to the raw score if the trajectory is legal
+   * @return IllegalReason::None if the trajectory is legal
+   */
+  virtual IllegalReason tryScoreTrajectory(
+    const dwb_msgs::msg::Trajectory2D & traj,
+    double & score)
+  {
+    score = scoreTrajectory(traj);
+    return IllegalReason::None;
+  }
+
+  /**
+   * @brief Whether the critic scores a trajectory from the costmap cells of its poses alone
+   *
+   * The planner then looks up the cells of a trajectory once, for all of the critics that
+   * return true, and scores it with tryScoreCells instead of tryScoreTrajectory.
+   */
+  virtual bool usesTrajectoryCells() const {return false;}
+
+  /**
+   * @brief Score a trajectory as tryScoreTrajectory does, from the cells of its poses
+   * @param traj The trajectory to score
+   * @param cells The cells of the poses of traj in the costmap of the critic
+   * @param score Set to the raw score if the trajectory is legal
+   * @return IllegalReason::None if the trajectory is legal
+   */
+  virtual IllegalReason tryScoreCells(
+    const dwb_msgs::msg::Trajectory2D & traj,
+    const TrajectoryCells & /*cells*/,
+    double & score)
+  {
+    return tryScoreTrajectory(traj, score);
+  }
+
+  /**
+   * @brief Score a batch of trajectories, as tryScoreTrajectory does for each of them
+   *
+   * With batch_scoring, the planner scores critic by critic, handing each critic the
+   * trajectories still legal in even batches, one per scoring thread. A critic can override
+   * this to score a batch together, e.g. on an accelerator. The default scores them one by one.
+   *
+   * @param trajs The trajectories to score
+   * @param count The number of trajectories
+   * @param scores Set to the raw score of each legal trajectory
+   * @param reasons Set to IllegalReason::None for each legal trajectory, else why it isn't
+   */
+  virtual void tryScoreTrajectories(
+    const dwb_msgs::msg::Trajectory2D * const * trajs, size_t count,
+    double * scores, IllegalReason * reasons)
+  {
+    for (size_t i = 0; i < count; i++) {
+      reasons[i] = tryScoreTrajectory(*trajs[i], scores[i]);
+    }
+  }
+
   /**
    * @brief debrief informs the critic what the chosen cmd_vel was (if it cares)
    */
@@ -177,11 +279,26 @@ public:
   void setScale(const double scale) {scale_ = scale;}
 
 protected:
+  /**
+   * @brief scoreTrajectory by way of tryScoreTrajectory, throwing for an illegal trajectory
+   */
+  double scoreTrajectoryOrThrow(const dwb_msgs::msg::Trajectory2D & traj)
+  {
+    double score = 0.0;
+    IllegalReason reason = tryScoreTrajectory(traj, score);
+    if (reason != IllegalReason::None) {
+      throw IllegalTrajectoryException(name_, illegalReasonDescription(reason));
+    }
+    return score;
+  }
+
   std::string name_;
   std::string dwb_plugin_name_;
   std::shared_ptr<nav2_costmap_2d::Costmap2DROS> costmap_ros_;
   double scale_;
   nav2_util::LifecycleNode::SharedPtr nh_;
+  std::shared_ptr<SharedGrids> shared_grids_;  ///< May be null, then nothing is shared
+  double reach_ = -1.0;  ///< Negative when the trajectories are not bounded
 };
 
 }  // namespace dwb_core
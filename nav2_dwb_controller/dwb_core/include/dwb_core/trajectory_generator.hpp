@@ -94,6 +94,17 @@ public:
    */
   virtual nav_2d_msgs::msg::Twist2D nextTwist() = 0;
 
+  /**
+   * @brief Tell the generator how a twist it returned scored
+   *
+   * Generators choosing their next twists by the scores of the earlier ones may have no more
+   * twists until those returned so far are reported.
+   *
+   * @param cmd_vel A twist returned by nextTwist
+   * @param score The total score of its trajectory, lower is better, or infinity if illegal
+   */
+  virtual void reportScore(const nav_2d_msgs::msg::Twist2D & /*cmd_vel*/, double /*score*/) {}
+
   /**
    * @brief Get all the twists for an iteration.
    *
@@ -113,6 +124,21 @@ public:
     return twists;
   }
 
+  /**
+   * @brief How far from its start pose any trajectory of the next iteration can end up
+   * @param current_velocity The velocity the iteration starts from
+   * @return The distance in meters, or a negative number if it is not bounded
+   */
+  virtual double getMaxReach(const nav_2d_msgs::msg::Twist2D & /*current_velocity*/)
+  {
+    return -1.0;
+  }
+
+  /**
+   * @brief Whether generateTrajectory can be called for several twists at the same time
+   */
+  virtual bool canGenerateInParallel() const {return false;}
+
   /**
    * @brief Given a cmd_vel in the robot's frame and initial conditions, generate a Trajectory2D
    * @param start_pose Current robot location
@@ -123,6 +149,22 @@ public:
     const geometry_msgs::msg::Pose2D & start_pose,
     const nav_2d_msgs::msg::Twist2D & start_vel,
     const nav_2d_msgs::msg::Twist2D & cmd_vel) = 0;
+
+  /**
+   * @brief Generate a Trajectory2D as generateTrajectory does, into an existing one
+   *
+   * Generators may override this to reuse the storage of traj rather than allocate anew.
+   *
+   * @param traj The trajectory to overwrite
+   */
+  virtual void generateTrajectoryInto(
+    const geometry_msgs::msg::Pose2D & start_pose,
+    const nav_2d_msgs::msg::Twist2D & start_vel,
+    const nav_2d_msgs::msg::Twist2D & cmd_vel,
+    dwb_msgs::msg::Trajectory2D & traj)
+  {
+    traj = generateTrajectory(start_pose, start_vel, cmd_vel);
+  }
 };
 
 }  // namespace dwb_core
@@ -0,0 +1,75 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Intel Corporation
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef DWB_CORE__TWIST_BATCH_HPP_
+#define DWB_CORE__TWIST_BATCH_HPP_
+
+#include <vector>
+
+#include "dwb_msgs/msg/trajectory2_d.hpp"
+
+namespace dwb_core
+{
+
+/**
+ * @class TwistBatch
+ * @brief The command velocities of a batch of trajectories, one array per field
+ *
+ * Critics that score on the twist alone can gather a batch passed to
+ * TrajectoryCritic::tryScoreTrajectories into one, and score it in loops over contiguous
+ * doubles that the compiler vectorizes.
+ */
+class TwistBatch
+{
+public:
+  void gather(const dwb_msgs::msg::Trajectory2D * const * trajs, size_t count)
+  {
+    x.resize(count);
+    y.resize(count);
+    theta.resize(count);
+    for (size_t i = 0; i < count; i++) {
+      x[i] = trajs[i]->velocity.x;
+      y[i] = trajs[i]->velocity.y;
+      theta[i] = trajs[i]->velocity.theta;
+    }
+  }
+
+  size_t size() const {return x.size();}
+
+  std::vector<double> x, y, theta;
+};
+
+}  // namespace dwb_core
+
+#endif  // DWB_CORE__TWIST_BATCH_HPP_
@@ -33,7 +33,14 @@
  */
 
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <functional>
+#include <limits>
 #include <memory>
+#include <numeric>
+#include <stdexcept>
 #include <string>
 #include <utility>
 #include <vector>
@@ -48,7 +55,9 @@
 #include "nav_2d_utils/tf_help.hpp"
 #include "nav2_util/lifecycle_node.hpp"
 #include "nav2_util/node_utils.hpp"
+#include "nav2_util/trace.hpp"
 #include "pluginlib/class_list_macros.hpp"
+#include "tf2/utils.h"
 #include "nav_msgs/msg/path.hpp"
 #include "geometry_msgs/msg/twist_stamped.hpp"
 
@@ -80,6 +89,12 @@ void DWBLocalPlanner::configure(
   declare_parameter_if_not_declared(
     node_, dwb_plugin_name_ + ".prune_distance",
     rclcpp::ParameterValue(1.0));
+  declare_parameter_if_not_declared(
+    node_, dwb_plugin_name_ + ".incremental_plan",
+    rclcpp::ParameterValue(false));
+  declare_parameter_if_not_declared(
+    node_, dwb_plugin_name_ + ".plan_search_window",
+    rclcpp::ParameterValue(5.0));
   declare_parameter_if_not_declared(
     node_, dwb_plugin_name_ + ".debug_trajectory_details",
     rclcpp::ParameterValue(false));
@@ -95,6 +110,48 @@ void DWBLocalPlanner::configure(
   declare_parameter_if_not_declared(
     node_, dwb_plugin_name_ + ".short_circuit_trajectory_evaluation",
     rclcpp::ParameterValue(true));
+  declare_parameter_if_not_declared(
+    node_, dwb_plugin_name_ + ".critic_configure_threads",
+    rclcpp::ParameterValue(1));
+  declare_parameter_if_not_declared(
+    node_, dwb_plugin_name_ + ".prepare_threads",
+    rclcpp::ParameterValue(1));
+  declare_parameter_if_not_declared(
+    node_, dwb_plugin_name_ + ".scoring_threads",
+    rclcpp::ParameterValue(1));
+  declare_parameter_if_not_declared(
+    node_, dwb_plugin_name_ + ".batch_scoring",
+    rclcpp::ParameterValue(false));
+  declare_parameter_if_not_declared(
+    node_, dwb_plugin_name_ + ".warm_start_twists",
+    rclcpp::ParameterValue(0));
+  declare_parameter_if_not_declared(
+    node_, dwb_plugin_name_ + ".reorder_critics",
+    rclcpp::ParameterValue(false));
+  declare_parameter_if_not_declared(
+    node_, dwb_plugin_name_ + ".snapshot_costmap",
+    rclcpp::ParameterValue(false));
+  declare_parameter_if_not_declared(
+    node_, dwb_plugin_name_ + ".fallback_search",
+    rclcpp::ParameterValue(false));
+  declare_parameter_if_not_declared(
+    node_, dwb_plugin_name_ + ".fallback_min_vel_x",
+    rclcpp::ParameterValue(0.0));
+  declare_parameter_if_not_declared(
+    node_, dwb_plugin_name_ + ".fallback_max_vel_x",
+    rclcpp::ParameterValue(0.1));
+  declare_parameter_if_not_declared(
+    node_, dwb_plugin_name_ + ".fallback_max_vel_theta",
+    rclcpp::ParameterValue(0.5));
+  declare_parameter_if_not_declared(
+    node_, dwb_plugin_name_ + ".fallback_vx_samples",
+    rclcpp::ParameterValue(10));
+  declare_parameter_if_not_declared(
+    node_, dwb_plugin_name_ + ".fallback_vtheta_samples",
+    rclcpp::ParameterValue(21));
+  declare_parameter_if_not_declared(
+    node_, dwb_plugin_name_ + ".fallback_time_budget",
+    rclcpp::ParameterValue(0.02));
 
   std::string traj_generator_name;
   std::string goal_checker_name;
@@ -106,12 +163,52 @@ void DWBLocalPlanner::configure(
 
   node_->get_parameter(dwb_plugin_name_ + ".prune_plan", prune_plan_);
   node_->get_parameter(dwb_plugin_name_ + ".prune_distance", prune_distance_);
+  node_->get_parameter(dwb_plugin_name_ + ".incremental_plan", incremental_plan_);
+  node_->get_parameter(dwb_plugin_name_ + ".plan_search_window", plan_search_window_);
+  plan_start_index_ = 0;
+  plan_pruned_poses_ = 0;
   node_->get_parameter(dwb_plugin_name_ + ".debug_trajectory_details", debug_trajectory_details_);
   node_->get_parameter(dwb_plugin_name_ + ".trajectory_generator_name", traj_generator_name);
   node_->get_parameter(dwb_plugin_name_ + ".goal_checker_name", goal_checker_name);
   node_->get_parameter(
     dwb_plugin_name_ + ".short_circuit_trajectory_evaluation",
     short_circuit_trajectory_evaluation_);
+  node_->get_parameter(dwb_plugin_name_ + ".warm_start_twists", warm_start_twists_);
+  node_->get_parameter(dwb_plugin_name_ + ".reorder_critics", reorder_critics_);
+  has_last_best_ = false;
+
+  // Critics that can be prepared alongside the others share a pool, 0 is one thread per core
+  int prepare_threads;
+  node_->get_parameter(dwb_plugin_name_ + ".prepare_threads", prepare_threads);
+  if (prepare_threads != 1) {
+    prepare_pool_ = std::make_unique<nav2_util::ThreadPool>(std::max(0, prepare_threads));
+  }
+  shared_grids_ = std::make_shared<SharedGrids>();
+
+  // The trajectories are scored on a pool of their own, if every critic allows it
+  int scoring_threads;
+  node_->get_parameter(dwb_plugin_name_ + ".scoring_threads", scoring_threads);
+  if (scoring_threads != 1) {
+    scoring_pool_ = std::make_unique<nav2_util::ThreadPool>(std::max(0, scoring_threads));
+  }
+  node_->get_parameter(dwb_plugin_name_ + ".batch_scoring", batch_scoring_);
+
+  // The critics read a copy of the cells they need, taken at the start of every cycle
+  bool snapshot_costmap;
+  node_->get_parameter(dwb_plugin_name_ + ".snapshot_costmap", snapshot_costmap);
+  costmap_snapshot_.reset();
+  if (snapshot_costmap) {
+    costmap_snapshot_ = std::make_unique<nav2_costmap_2d::Costmap2D>();
+  }
+
+  // Slow twists tried before giving up when none of those of the generator is legal
+  fallback_twists_.clear();
+  node_->get_parameter(dwb_plugin_name_ + ".fallback_time_budget", fallback_time_budget_);
+  bool fallback_search;
+  node_->get_parameter(dwb_plugin_name_ + ".fallback_search", fallback_search);
+  if (fallback_search) {
+    buildFallbackTwists();
+  }
 
   pub_ = std::make_unique<DWBPublisher>(node_, dwb_plugin_name_);
   pub_->on_configure();
@@ -128,12 +225,30 @@ void DWBLocalPlanner::configure(
     RCLCPP_ERROR(node_->get_logger(), "Couldn't load critics! Caught exception: %s", e.what());
     throw;
   }
+  critic_order_.resize(critics_.size());
+  std::iota(critic_order_.begin(), critic_order_.end(), 0);
+  critic_stats_.assign(critics_.size(), CriticStats());
+  if (reorder_critics_) {
+    reorderCritics();
+  }
+
+  if (scoring_pool_) {
+    for (TrajectoryCritic::Ptr critic : critics_) {
+      if (!critic->canScoreInParallel()) {
+        RCLCPP_WARN(
+          node_->get_logger(),
+          "Critic %s can't score trajectories in parallel, so they are scored one at a time",
+          critic->getName().c_str());
+      }
+    }
+  }
 }
 
 void
 DWBLocalPlanner::activate()
 {
   pub_->on_activate();
+  has_last_best_ = false;
 }
 
 void
@@ -183,6 +298,8 @@ DWBLocalPlanner::loadCritics()
   }
 
   node_->get_parameter(dwb_plugin_name_ + ".critics", critic_names);
+  std::vector<std::function<void()>> initializations;
+  std::vector<std::vector<std::size_t>> configure_after(critic_names.size());
   for (unsigned int i = 0; i < critic_names.size(); i++) {
     std::string critic_plugin_name = critic_names[i];
     std::string plugin_class;
@@ -199,13 +316,60 @@ DWBLocalPlanner::loadCritics()
       node_->get_logger(),
       "Using critic \"%s\" (%s)", critic_plugin_name.c_str(), plugin_class.c_str());
     critics_.push_back(plugin);
-    try {
-      plugin->initialize(node_, critic_plugin_name, dwb_plugin_name_, costmap_ros_);
-    } catch (const std::exception & e) {
-      RCLCPP_ERROR(node_->get_logger(), "Couldn't initialize critic plugin!");
-      throw;
+    // critics that other critics rely on, or that have to see every trajectory, are pinned
+    declare_parameter_if_not_declared(
+      node_, dwb_plugin_name_ + "." + critic_plugin_name + ".pinned",
+      rclcpp::ParameterValue(false));
+    bool pinned = false;
+    node_->get_parameter(dwb_plugin_name_ + "." + critic_plugin_name + ".pinned", pinned);
+    critic_pinned_.push_back(pinned);
+
+    // critics whose initialization relies on others' are initialized after them
+    std::vector<std::string> after_names;
+    declare_parameter_if_not_declared(
+      node_, dwb_plugin_name_ + "." + critic_plugin_name + ".configure_after",
+      rclcpp::ParameterValue(std::vector<std::string>()));
+    node_->get_parameter(
+      dwb_plugin_name_ + "." + critic_plugin_name + ".configure_after", after_names);
+    for (const std::string & name : after_names) {
+      auto previous = std::find(critic_names.begin(), critic_names.end(), name);
+      if (previous == critic_names.end()) {
+        std::string error = "Critic " + critic_plugin_name +
+          " is configured after an unknown critic " + name;
+        RCLCPP_ERROR(node_->get_logger(), "%s", error.c_str());
+        throw std::runtime_error(error);
+      }
+      configure_after[i].push_back(previous - critic_names.begin());
     }
-    RCLCPP_INFO(node_->get_logger(), "Critic plugin initialized");
+
+    plugin->setSharedGrids(shared_grids_);
+    initializations.push_back(
+      [this, plugin, critic_plugin_name]() {
+        plugin->initialize(node_, critic_plugin_name, dwb_plugin_name_, costmap_ros_);
+        if (costmap_snapshot_) {
+          plugin->setCostmap(costmap_snapshot_.get());
+        }
+      });
+  }
+
+  // The critics are initialized side by side if allowed, 0 is one thread per core
+  int configure_threads;
+  node_->get_parameter(dwb_plugin_name_ + ".critic_configure_threads", configure_threads);
+  std::unique_ptr<nav2_util::ThreadPool> configure_pool;
+  if (configure_threads != 1 && critic_names.size() > 1) {
+    configure_pool = std::make_unique<nav2_util::ThreadPool>(std::max(0, configure_threads));
+  }
+  std::vector<std::chrono::nanoseconds> durations;
+  try {
+    durations = nav2_util::run_staged_tasks(configure_pool.get(), initializations, configure_after);
+  } catch (const std::exception & e) {
+    RCLCPP_ERROR(node_->get_logger(), "Couldn't initialize critic plugin!");
+    throw;
+  }
+  for (unsigned int i = 0; i < critic_names.size(); i++) {
+    RCLCPP_INFO(
+      node_->get_logger(), "Critic plugin \"%s\" initialized in %.1f ms",
+      critic_names[i].c_str(), std::chrono::duration<double, std::milli>(durations[i]).count());
   }
 }
 
@@ -311,6 +475,35 @@ DWBLocalPlanner::setPlan(const nav_msgs::msg::Path & path)
 
   pub_->publishGlobalPlan(path2d);
   global_plan_ = path2d;
+  plan_start_index_ = 0;
+  plan_pruned_poses_ = 0;
+}
+
+bool
+DWBLocalPlanner::splicePlan(const nav_msgs::msg::Path & path, size_t index)
+{
+  if (index < plan_pruned_poses_ || index > plan_pruned_poses_ + global_plan_.poses.size() ||
+    index > path.poses.size() || path.header.frame_id != global_plan_.header.frame_id)
+  {
+    return false;
+  }
+
+  size_t kept = index - plan_pruned_poses_;
+  if (kept == 0 && index == path.poses.size()) {
+    return false;
+  }
+  global_plan_.header = path.header;
+  global_plan_.poses.resize(kept);
+  global_plan_.poses.reserve(kept + path.poses.size() - index);
+  for (size_t i = index; i < path.poses.size(); i++) {
+    global_plan_.poses.push_back(nav_2d_utils::poseToPose2D(path.poses[i].pose));
+  }
+  // the robot can't be further along than the poses kept
+  plan_start_index_ = std::min(plan_start_index_, kept);
+  if (index < path.poses.size()) {
+    pub_->publishGlobalPlan(global_plan_);
+  }
+  return true;
 }
 
 geometry_msgs::msg::TwistStamped
@@ -360,6 +553,11 @@ DWBLocalPlanner::computeVelocityCommands(
   const nav_2d_msgs::msg::Twist2D & velocity,
   std::shared_ptr<dwb_msgs::msg::LocalPlanEvaluation> & results)
 {
+  if (time_budget_ > 0.0) {
+    deadline_ = std::chrono::steady_clock::now() +
+      std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+      std::chrono::duration<double>(time_budget_));
+  }
   if (results) {
     results->header.frame_id = pose.header.frame_id;
     results->header.stamp = node_->now();
@@ -370,14 +568,19 @@ DWBLocalPlanner::computeVelocityCommands(
 
   prepareGlobalPlan(pose, transformed_plan, goal_pose);
 
-  for (TrajectoryCritic::Ptr critic : critics_) {
-    if (critic->prepare(pose.pose, velocity, goal_pose.pose, transformed_plan) == false) {
-      RCLCPP_WARN(rclcpp::get_logger("DWBLocalPlanner"), "A scoring function failed to prepare");
-    }
-  }
+  prepareCritics(pose.pose, velocity, goal_pose.pose, transformed_plan);
 
   try {
-    dwb_msgs::msg::TrajectoryScore best = coreScoringAlgorithm(pose.pose, velocity, results);
+    last_command_cost_ = -1.0;
+    dwb_msgs::msg::TrajectoryScore best;
+    try {
+      best = coreScoringAlgorithm(pose.pose, velocity, results);
+    } catch (const dwb_core::NoLegalTrajectoriesException &) {
+      if (!fallbackScoringAlgorithm(pose.pose, velocity, results, best)) {
+        throw;
+      }
+    }
+    last_command_cost_ = best.total;
 
     // Return Value
     nav_2d_msgs::msg::Twist2DStamped cmd_vel;
@@ -391,6 +594,7 @@ DWBLocalPlanner::computeVelocityCommands(
 
     pub_->publishLocalPlan(pose.header, best.traj);
     pub_->publishCostGrid(costmap_ros_, critics_);
+    publishCriticProfiles(pose.header);
 
     return cmd_vel;
   } catch (const dwb_core::NoLegalTrajectoriesException & e) {
@@ -402,64 +606,294 @@ DWBLocalPlanner::computeVelocityCommands(
     }
     pub_->publishLocalPlan(pose.header, empty_traj);
     pub_->publishCostGrid(costmap_ros_, critics_);
+    publishCriticProfiles(pose.header);
 
     throw;
   }
 }
 
+void
+DWBLocalPlanner::prepareCritics(
+  const geometry_msgs::msg::Pose2D & pose, const nav_2d_msgs::msg::Twist2D & velocity,
+  const geometry_msgs::msg::Pose2D & goal, const nav_2d_msgs::msg::Path2D & plan)
+{
+  // The grids of the last cycle were computed from the last plan and pose, they are
+  // only reused by critics that find them still good for this one
+  shared_grids_->clear();
+
+  double reach = traj_generator_->getMaxReach(velocity);
+  for (TrajectoryCritic::Ptr critic : critics_) {
+    critic->setReach(reach);
+  }
+  if (costmap_snapshot_) {
+    snapshotCostmap(pose, reach, plan);
+  }
+
+  std::vector<TrajectoryCritic::Ptr> parallel, serial;
+  for (TrajectoryCritic::Ptr critic : critics_) {
+    if (prepare_pool_ && critic->canPrepareInParallel()) {
+      parallel.push_back(critic);
+    } else {
+      serial.push_back(critic);
+    }
+  }
+
+  std::vector<char> prepared(parallel.size());
+  if (!parallel.empty()) {
+    prepare_pool_->parallel_for(
+      parallel.size(), [&](size_t i) {
+        prepared[i] = parallel[i]->prepare(pose, velocity, goal, plan);
+      });
+  }
+  for (TrajectoryCritic::Ptr critic : serial) {
+    prepared.push_back(critic->prepare(pose, velocity, goal, plan));
+  }
+
+  for (char critic_prepared : prepared) {
+    if (!critic_prepared) {
+      RCLCPP_WARN(rclcpp::get_logger("DWBLocalPlanner"), "A scoring function failed to prepare");
+    }
+  }
+}
+
+void
+DWBLocalPlanner::snapshotCostmap(
+  const geometry_msgs::msg::Pose2D & pose, double reach,
+  const nav_2d_msgs::msg::Path2D & plan)
+{
+  nav2_costmap_2d::Costmap2D * costmap = costmap_ros_->getCostmap();
+  std::unique_lock<nav2_costmap_2d::Costmap2D::mutex_t> lock(*(costmap->getMutex()));
+  int size_x = costmap->getSizeInCellsX();
+  int size_y = costmap->getSizeInCellsY();
+  int min_x = 0, min_y = 0, max_x = size_x - 1, max_y = size_y - 1;
+  if (reach >= 0.0) {
+    int cells = costmap->cellDistance(
+      reach + costmap_ros_->getLayeredCostmap()->getCircumscribedRadius()) + 1;
+    int robot_x, robot_y;
+    costmap->worldToMapNoBounds(pose.x, pose.y, robot_x, robot_y);
+    min_x = robot_x - cells;
+    min_y = robot_y - cells;
+    max_x = robot_x + cells;
+    max_y = robot_y + cells;
+    for (const auto & plan_pose : plan.poses) {
+      int x, y;
+      costmap->worldToMapNoBounds(plan_pose.x, plan_pose.y, x, y);
+      min_x = std::min(min_x, x);
+      min_y = std::min(min_y, y);
+      max_x = std::max(max_x, x);
+      max_y = std::max(max_y, y);
+    }
+    min_x = std::max(min_x, 0);
+    min_y = std::max(min_y, 0);
+  }
+  // copyWindowFrom clips the upper bounds to the costmap
+  costmap_snapshot_->copyWindowFrom(
+    *costmap, min_x, min_y, std::max(max_x + 1, min_x), std::max(max_y + 1, min_y));
+}
+
 dwb_msgs::msg::TrajectoryScore
 DWBLocalPlanner::coreScoringAlgorithm(
   const geometry_msgs::msg::Pose2D & pose,
   const nav_2d_msgs::msg::Twist2D velocity,
   std::shared_ptr<dwb_msgs::msg::LocalPlanEvaluation> & results)
 {
-  nav_2d_msgs::msg::Twist2D twist;
-  dwb_msgs::msg::Trajectory2D traj;
-  dwb_msgs::msg::TrajectoryScore best, worst;
-  best.total = -1;
-  worst.total = -1;
+  NAV2_TRACE_SCOPE("dwb_scoring");
+  int best = -1, worst = -1;
   IllegalTrajectoryTracker tracker;
 
-  traj_generator_->startNewIteration(velocity);
-  while (traj_generator_->hasMoreTwists()) {
-    twist = traj_generator_->nextTwist();
-    traj = traj_generator_->generateTrajectory(pose, velocity, twist);
-
-    try {
-      dwb_msgs::msg::TrajectoryScore score = scoreTrajectory(traj, best.total);
+  auto addScore = [&](size_t index) {
+      const Candidate & candidate = candidates_[index];
       tracker.addLegalTrajectory();
       if (results) {
-        results->twists.push_back(score);
+        results->twists.push_back(toTrajectoryScore(candidate));
       }
-      if (best.total < 0 || score.total < best.total) {
-        best = score;
+      // ties go to the first twist, whatever order the candidates are scored in
+      if (best < 0 || candidate.total < candidates_[best].total ||
+        (candidate.total == candidates_[best].total && static_cast<int>(index) < best))
+      {
+        best = static_cast<int>(index);
         if (results) {
           results->best_index = results->twists.size() - 1;
         }
       }
-      if (worst.total < 0 || score.total > worst.total) {
-        worst = score;
+      if (worst < 0 || candidate.total > candidates_[worst].total ||
+        (candidate.total == candidates_[worst].total && static_cast<int>(index) < worst))
+      {
+        worst = static_cast<int>(index);
         if (results) {
           results->worst_index = results->twists.size() - 1;
         }
       }
-    } catch (const dwb_core::IllegalTrajectoryException & e) {
+    };
+  auto addFailure = [&](size_t index, const std::string & critic_name) {
       if (results) {
         dwb_msgs::msg::TrajectoryScore failed_score;
-        failed_score.traj = traj;
+        failed_score.traj = candidates_[index].traj;
 
         dwb_msgs::msg::CriticScore cs;
-        cs.name = e.getCriticName();
+        cs.name = critic_name;
         cs.raw_score = -1.0;
         failed_score.scores.push_back(cs);
         failed_score.total = -1.0;
         results->twists.push_back(failed_score);
       }
+    };
+  auto addException = [&](size_t index, const dwb_core::IllegalTrajectoryException & e) {
+      addFailure(index, e.getCriticName());
       tracker.addIllegalTrajectory(e);
+      traj_generator_->reportScore(
+        candidates_[index].traj.velocity, std::numeric_limits<double>::infinity());
+    };
+  auto addCandidate = [&](size_t index) {
+      const Candidate & candidate = candidates_[index];
+      if (candidate.illegal_reason == IllegalReason::None) {
+        addScore(index);
+        traj_generator_->reportScore(candidate.traj.velocity, candidate.total);
+        return;
+      }
+      const std::string & critic_name = critics_[candidate.illegal_critic]->getName();
+      addFailure(index, critic_name);
+      tracker.addIllegalTrajectory(critic_name, candidate.illegal_reason);
+      traj_generator_->reportScore(
+        candidate.traj.velocity, std::numeric_limits<double>::infinity());
+    };
+
+  // whether to stop taking twists, as the budget is spent and there is a legal one to return
+  auto outOfTime = [&]() {
+      return time_budget_ > 0.0 && best >= 0 && std::chrono::steady_clock::now() > deadline_;
+    };
+
+  bool parallel = scoring_pool_ != nullptr;
+  for (TrajectoryCritic::Ptr critic : critics_) {
+    parallel = parallel && critic->canScoreInParallel();
+  }
+
+  if (parallel) {
+    // Every trajectory is scored in full, as the best score isn't known while scoring,
+    // then they are gone through in the order of the twists as below. The twists are taken
+    // in rounds, as a generator may only have more once the last ones are scored.
+    twists_.clear();
+    traj_generator_->startNewIteration(velocity);
+    bool generate_in_parallel = traj_generator_->canGenerateInParallel();
+    while (traj_generator_->hasMoreTwists()) {
+      size_t begin = twists_.size();
+      while (traj_generator_->hasMoreTwists()) {
+        twists_.push_back(traj_generator_->nextTwist());
+      }
+      size_t count = twists_.size() - begin;
+      if (candidates_.size() < twists_.size()) {
+        candidates_.resize(twists_.size());
+      }
+      errors_.assign(count, nullptr);
+
+      if (!generate_in_parallel) {
+        for (size_t i = begin; i < twists_.size(); i++) {
+          traj_generator_->generateTrajectoryInto(
+            pose, velocity, twists_[i], candidates_[i].traj);
+        }
+      }
+      if (batch_scoring_) {
+        if (generate_in_parallel) {
+          scoring_pool_->parallel_for(
+            count, [&](size_t i) {
+              traj_generator_->generateTrajectoryInto(
+                pose, velocity, twists_[begin + i], candidates_[begin + i].traj);
+            });
+        }
+        scoreCandidatesByCritic(begin, twists_.size());
+      } else {
+        scoring_pool_->parallel_for(
+          count, [&](size_t i) {
+            if (generate_in_parallel) {
+              traj_generator_->generateTrajectoryInto(
+                pose, velocity, twists_[begin + i], candidates_[begin + i].traj);
+            }
+            try {
+              scoreCandidate(candidates_[begin + i], -1.0);
+            } catch (...) {
+              errors_[i] = std::current_exception();
+            }
+          });
+      }
+
+      for (size_t i = 0; i < count; i++) {
+        if (!errors_[i]) {
+          addCandidate(begin + i);
+          continue;
+        }
+        try {
+          std::rethrow_exception(errors_[i]);
+        } catch (const dwb_core::IllegalTrajectoryException & e) {
+          addException(begin + i, e);
+        }
+      }
+      if (outOfTime()) {
+        break;
+      }
+    }
+  } else {
+    if (reorder_critics_) {
+      reorderCritics();
+    }
+    bool profile = reorder_critics_ || pub_->shouldPublishCriticProfiles();
+    if (profile) {
+      // the older cycles count for less, so the profile follows the situation
+      for (CriticStats & stats : critic_stats_) {
+        stats.seconds *= 0.9;
+        stats.calls *= 0.9;
+        stats.illegal *= 0.9;
+        stats.rejections *= 0.9;
+      }
+    }
+    // In rounds as above, each scored in the order of the twists but for the warm start
+    twists_.clear();
+    traj_generator_->startNewIteration(velocity);
+    while (traj_generator_->hasMoreTwists()) {
+      size_t begin = twists_.size();
+      while (traj_generator_->hasMoreTwists()) {
+        twists_.push_back(traj_generator_->nextTwist());
+      }
+      if (candidates_.size() < twists_.size()) {
+        candidates_.resize(twists_.size());
+      }
+      scoring_order_.resize(twists_.size() - begin);
+      std::iota(scoring_order_.begin(), scoring_order_.end(), begin);
+      if (warm_start_twists_ > 0 && has_last_best_) {
+        auto distance_sq = [&](size_t i) {
+            double dx = twists_[i].x - last_best_twist_.x;
+            double dy = twists_[i].y - last_best_twist_.y;
+            double dtheta = twists_[i].theta - last_best_twist_.theta;
+            return dx * dx + dy * dy + dtheta * dtheta;
+          };
+        size_t first = std::min(scoring_order_.size(), static_cast<size_t>(warm_start_twists_));
+        std::partial_sort(
+          scoring_order_.begin(), scoring_order_.begin() + first, scoring_order_.end(),
+          [&](size_t a, size_t b) {return distance_sq(a) < distance_sq(b);});
+      }
+
+      bool out_of_time = false;
+      for (size_t index : scoring_order_) {
+        if (outOfTime()) {
+          out_of_time = true;
+          break;
+        }
+        Candidate & candidate = candidates_[index];
+        traj_generator_->generateTrajectoryInto(pose, velocity, twists_[index], candidate.traj);
+
+        try {
+          scoreCandidate(candidate, best < 0 ? -1.0 : candidates_[best].total, profile);
+          addCandidate(index);
+        } catch (const dwb_core::IllegalTrajectoryException & e) {
+          addException(index, e);
+        }
+      }
+      if (out_of_time) {
+        break;
+      }
     }
   }
 
-  if (best.total < 0) {
+  if (best < 0) {
     if (debug_trajectory_details_) {
       RCLCPP_ERROR(rclcpp::get_logger("DWBLocalPlanner"), "%s", tracker.getMessage().c_str());
       for (auto const & x : tracker.getPercentages()) {
@@ -472,7 +906,103 @@ DWBLocalPlanner::coreScoringAlgorithm(
     throw NoLegalTrajectoriesException(tracker);
   }
 
-  return best;
+  last_best_twist_ = twists_[best];
+  has_last_best_ = true;
+  return toTrajectoryScore(candidates_[best]);
+}
+
+void
+DWBLocalPlanner::buildFallbackTwists()
+{
+  double min_vel_x, max_vel_x, max_vel_theta;
+  int vx_samples, vtheta_samples;
+  node_->get_parameter(dwb_plugin_name_ + ".fallback_min_vel_x", min_vel_x);
+  node_->get_parameter(dwb_plugin_name_ + ".fallback_max_vel_x", max_vel_x);
+  node_->get_parameter(dwb_plugin_name_ + ".fallback_max_vel_theta", max_vel_theta);
+  node_->get_parameter(dwb_plugin_name_ + ".fallback_vx_samples", vx_samples);
+  node_->get_parameter(dwb_plugin_name_ + ".fallback_vtheta_samples", vtheta_samples);
+  vx_samples = std::max(vx_samples, 1);
+  vtheta_samples = std::max(vtheta_samples, 1);
+
+  auto sample = [](double low, double high, int samples, int i) {
+      return samples == 1 ? high : low + (high - low) * i / (samples - 1);
+    };
+  std::vector<double> vxs;
+  for (int i = 0; i < vx_samples; i++) {
+    vxs.push_back(sample(min_vel_x, max_vel_x, vx_samples, i));
+  }
+  // the rotations in place, whether or not the linear samples come across zero
+  if (std::find(vxs.begin(), vxs.end(), 0.0) == vxs.end()) {
+    vxs.insert(vxs.begin(), 0.0);
+  }
+
+  fallback_twists_.clear();
+  for (double vx : vxs) {
+    for (int j = 0; j < vtheta_samples; j++) {
+      nav_2d_msgs::msg::Twist2D twist;
+      twist.x = vx;
+      twist.theta = sample(-max_vel_theta, max_vel_theta, vtheta_samples, j);
+      if (twist.x != 0.0 || twist.theta != 0.0) {
+        fallback_twists_.push_back(twist);
+      }
+    }
+  }
+}
+
+bool
+DWBLocalPlanner::fallbackScoringAlgorithm(
+  const geometry_msgs::msg::Pose2D & pose,
+  const nav_2d_msgs::msg::Twist2D & velocity,
+  std::shared_ptr<dwb_msgs::msg::LocalPlanEvaluation> & results,
+  dwb_msgs::msg::TrajectoryScore & best)
+{
+  if (fallback_twists_.empty()) {
+    return false;
+  }
+  NAV2_TRACE_SCOPE("dwb_fallback_scoring");
+  auto deadline = std::chrono::steady_clock::now() +
+    std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+    std::chrono::duration<double>(fallback_time_budget_));
+
+  Candidate candidate;
+  Candidate best_candidate;
+  bool found = false;
+  for (const nav_2d_msgs::msg::Twist2D & twist : fallback_twists_) {
+    if (fallback_time_budget_ > 0.0 && std::chrono::steady_clock::now() > deadline) {
+      break;
+    }
+    traj_generator_->generateTrajectoryInto(pose, velocity, twist, candidate.traj);
+    try {
+      scoreCandidate(candidate, found ? best_candidate.total : -1.0);
+    } catch (const dwb_core::IllegalTrajectoryException &) {
+      continue;
+    }
+    if (candidate.illegal_reason != IllegalReason::None) {
+      continue;
+    }
+    if (results) {
+      results->twists.push_back(toTrajectoryScore(candidate));
+    }
+    if (!found || candidate.total < best_candidate.total) {
+      std::swap(best_candidate, candidate);
+      found = true;
+      if (results) {
+        results->best_index = results->twists.size() - 1;
+      }
+    }
+  }
+
+  if (!found) {
+    return false;
+  }
+  RCLCPP_DEBUG(
+    rclcpp::get_logger("DWBLocalPlanner"),
+    "No legal trajectory, falling back to x %.2f theta %.2f",
+    best_candidate.traj.velocity.x, best_candidate.traj.velocity.theta);
+  last_best_twist_ = best_candidate.traj.velocity;
+  has_last_best_ = true;
+  best = toTrajectoryScore(best_candidate);
+  return true;
 }
 
 dwb_msgs::msg::TrajectoryScore
@@ -480,29 +1010,207 @@ DWBLocalPlanner::scoreTrajectory(
   const dwb_msgs::msg::Trajectory2D & traj,
   double best_score)
 {
-  dwb_msgs::msg::TrajectoryScore score;
-  score.traj = traj;
-
-  for (TrajectoryCritic::Ptr critic : critics_) {
-    dwb_msgs::msg::CriticScore cs;
-    cs.name = critic->getName();
-    cs.scale = critic->getScale();
+  Candidate candidate;
+  candidate.traj = traj;
+  scoreCandidate(candidate, best_score);
+  if (candidate.illegal_reason != IllegalReason::None) {
+    throw IllegalTrajectoryException(
+      critics_[candidate.illegal_critic]->getName(),
+      illegalReasonDescription(candidate.illegal_reason));
+  }
+  return toTrajectoryScore(candidate);
+}
 
-    if (cs.scale == 0.0) {
-      score.scores.push_back(cs);
+void
+DWBLocalPlanner::scoreCandidate(Candidate & candidate, double best_score, bool record_stats)
+{
+  candidate.raw_scores.resize(critics_.size());
+  candidate.critics_scored = 0;
+  candidate.total = 0.0;
+  candidate.illegal_reason = IllegalReason::None;
+  bool have_cells = false;
+
+  for (size_t k = 0; k < critic_order_.size(); k++) {
+    size_t i = critic_order_[k];
+    candidate.critics_scored = k + 1;
+    candidate.raw_scores[i] = 0.0;
+    double scale = critics_[i]->getScale();
+    if (scale == 0.0) {
       continue;
     }
 
-    double critic_score = critic->scoreTrajectory(traj);
-    cs.raw_score = critic_score;
-    score.scores.push_back(cs);
-    score.total += critic_score * cs.scale;
-    if (short_circuit_trajectory_evaluation_ && best_score > 0 && score.total > best_score) {
+    std::chrono::steady_clock::time_point start;
+    if (record_stats) {
+      start = std::chrono::steady_clock::now();
+    }
+    double critic_score = 0.0;
+    IllegalReason reason;
+    if (critics_[i]->usesTrajectoryCells()) {
+      // the cells are shared by every critic scoring the poses, looked up by the first one
+      if (!have_cells) {
+        candidate.cells.compute(*scoringCostmap(), candidate.traj);
+        have_cells = true;
+      }
+      reason = critics_[i]->tryScoreCells(candidate.traj, candidate.cells, critic_score);
+    } else {
+      reason = critics_[i]->tryScoreTrajectory(candidate.traj, critic_score);
+    }
+    if (record_stats) {
+      critic_stats_[i].seconds +=
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      critic_stats_[i].calls += 1.0;
+    }
+    if (reason != IllegalReason::None) {
+      if (record_stats) {
+        critic_stats_[i].illegal += 1.0;
+        critic_stats_[i].rejections += 1.0;
+      }
+      candidate.illegal_reason = reason;
+      candidate.illegal_critic = i;
+      return;
+    }
+    candidate.raw_scores[i] = critic_score;
+    candidate.total += critic_score * scale;
+    if (short_circuit_trajectory_evaluation_ && best_score > 0 && candidate.total > best_score) {
       // since we keep adding positives, once we are worse than the best, we will stay worse
+      if (record_stats) {
+        critic_stats_[i].rejections += 1.0;
+      }
       break;
     }
   }
+}
+
+void
+DWBLocalPlanner::scoreCandidatesByCritic(size_t begin, size_t end)
+{
+  batch_candidates_.clear();
+  batch_trajs_.clear();
+  for (size_t i = begin; i < end; i++) {
+    Candidate & candidate = candidates_[i];
+    candidate.raw_scores.assign(critics_.size(), 0.0);
+    candidate.critics_scored = critic_order_.size();
+    candidate.total = 0.0;
+    candidate.illegal_reason = IllegalReason::None;
+    batch_candidates_.push_back(i);
+    batch_trajs_.push_back(&candidate.traj);
+  }
+
+  for (size_t k = 0; k < critic_order_.size() && !batch_candidates_.empty(); k++) {
+    size_t c = critic_order_[k];
+    TrajectoryCritic & critic = *critics_[c];
+    double scale = critic.getScale();
+    if (scale == 0.0) {
+      continue;
+    }
+
+    size_t count = batch_candidates_.size();
+    batch_scores_.resize(count);
+    batch_reasons_.resize(count);
+    size_t batch_size = (count + scoring_pool_->size() - 1) / scoring_pool_->size();
+    scoring_pool_->parallel_for(
+      (count + batch_size - 1) / batch_size, [&](size_t b) {
+        size_t first = b * batch_size;
+        size_t last = std::min(count, first + batch_size);
+        try {
+          critic.tryScoreTrajectories(
+            &batch_trajs_[first], last - first, &batch_scores_[first], &batch_reasons_[first]);
+        } catch (...) {
+          // the critic threw for one of them, so the batch is scored again one at a time
+          for (size_t t = first; t < last; t++) {
+            try {
+              batch_reasons_[t] = critic.tryScoreTrajectory(*batch_trajs_[t], batch_scores_[t]);
+            } catch (...) {
+              errors_[batch_candidates_[t] - begin] = std::current_exception();
+            }
+          }
+        }
+      });
+
+    // only the candidates still legal go on to the next critic
+    size_t kept = 0;
+    for (size_t t = 0; t < count; t++) {
+      size_t index = batch_candidates_[t];
+      if (errors_[index - begin]) {
+        continue;
+      }
+      Candidate & candidate = candidates_[index];
+      if (batch_reasons_[t] != IllegalReason::None) {
+        candidate.critics_scored = k + 1;
+        candidate.illegal_reason = batch_reasons_[t];
+        candidate.illegal_critic = c;
+        continue;
+      }
+      candidate.raw_scores[c] = batch_scores_[t];
+      candidate.total += batch_scores_[t] * scale;
+      batch_candidates_[kept] = index;
+      batch_trajs_[kept] = batch_trajs_[t];
+      kept++;
+    }
+    batch_candidates_.resize(kept);
+    batch_trajs_.resize(kept);
+  }
+}
 
+void
+DWBLocalPlanner::reorderCritics()
+{
+  // Scoring a trajectory stops at the first critic rejecting it, so the cheapest critic per
+  // rejection goes first. Critics that weren't called lately go first too, to be measured.
+  std::vector<double> cost(critics_.size(), 0.0);
+  for (size_t i = 0; i < critics_.size(); i++) {
+    const CriticStats & stats = critic_stats_[i];
+    if (stats.calls > 0.0) {
+      cost[i] = stats.seconds / std::max(stats.rejections, 0.01 * stats.calls);
+    }
+  }
+  std::sort(
+    critic_order_.begin(), critic_order_.end(),
+    [&](size_t a, size_t b) {
+      if (critic_pinned_[a] || critic_pinned_[b]) {
+        return critic_pinned_[a] && (!critic_pinned_[b] || a < b);
+      }
+      return cost[a] < cost[b] || (cost[a] == cost[b] && a < b);
+    });
+}
+
+void
+DWBLocalPlanner::publishCriticProfiles(const std_msgs::msg::Header & header)
+{
+  if (!pub_->shouldPublishCriticProfiles()) {
+    return;
+  }
+
+  dwb_msgs::msg::CriticProfiles profiles;
+  profiles.header = header;
+  for (size_t i : critic_order_) {
+    const CriticStats & stats = critic_stats_[i];
+    dwb_msgs::msg::CriticProfile profile;
+    profile.name = critics_[i]->getName();
+    profile.pinned = critic_pinned_[i];
+    if (stats.calls > 0.0) {
+      profile.time_per_trajectory = stats.seconds / stats.calls;
+      profile.illegal_rate = stats.illegal / stats.calls;
+      profile.rejection_rate = stats.rejections / stats.calls;
+    }
+    profiles.critics.push_back(profile);
+  }
+  pub_->publishCriticProfiles(profiles);
+}
+
+dwb_msgs::msg::TrajectoryScore
+DWBLocalPlanner::toTrajectoryScore(const Candidate & candidate)
+{
+  dwb_msgs::msg::TrajectoryScore score;
+  score.traj = candidate.traj;
+  score.scores.resize(candidate.critics_scored);
+  for (size_t k = 0; k < candidate.critics_scored; k++) {
+    size_t i = critic_order_[k];
+    score.scores[k].name = critics_[i]->getName();
+    score.scores[k].scale = critics_[i]->getScale();
+    score.scores[k].raw_score = candidate.raw_scores[i];
+  }
+  score.total = candidate.total;
   return score;
 }
 
@@ -572,13 +1280,34 @@ DWBLocalPlanner::transformGlobalPlan(
     sq_transform_end_threshold = sq_dist_threshold;
   }
 
+  auto is_near_start = [&](const auto & global_plan_pose) {
+      return getSquareDistance(robot_pose.pose, global_plan_pose) < sq_transform_start_threshold;
+    };
+
   // Find the first pose in the plan that's less than sq_transform_start_threshold
   // from the robot.
-  auto transformation_begin = std::find_if(
-    begin(global_plan_.poses), end(global_plan_.poses),
-    [&](const auto & global_plan_pose) {
-      return getSquareDistance(robot_pose.pose, global_plan_pose) < sq_transform_start_threshold;
-    });
+  auto transformation_begin = end(global_plan_.poses);
+  if (incremental_plan_) {
+    // Search forward from where the robot was on the last cycle, over the next
+    // plan_search_window_ meters of the path
+    auto search_begin = begin(global_plan_.poses) +
+      std::min(plan_start_index_, global_plan_.poses.size() - 1);
+    auto search_end = search_begin + 1;
+    for (double length = 0.0;
+      search_end != end(global_plan_.poses) && length < plan_search_window_; ++search_end)
+    {
+      length += std::hypot(search_end->x - (search_end - 1)->x, search_end->y - (search_end - 1)->y);
+    }
+    transformation_begin = std::find_if(search_begin, search_end, is_near_start);
+
+    // The robot got further along than the window, look over the rest of the plan
+    if (transformation_begin == search_end) {
+      transformation_begin = std::find_if(search_end, end(global_plan_.poses), is_near_start);
+    }
+  } else {
+    transformation_begin = std::find_if(
+      begin(global_plan_.poses), end(global_plan_.poses), is_near_start);
+  }
 
   // Find the first pose in the end of the plan that's further than sq_transform_end_threshold
   // from the robot
@@ -593,26 +1322,66 @@ DWBLocalPlanner::transformGlobalPlan(
   transformed_plan.header.frame_id = costmap_ros_->getGlobalFrameID();
   transformed_plan.header.stamp = pose.header.stamp;
 
+  // Every pose of the plan is in the same frame, so they all share the latest
+  // transform into the local frame, which is only looked up once
+  double transform_x = 0.0, transform_y = 0.0, transform_yaw = 0.0;
+  bool transform_known = true;
+  if (transformation_begin != transformation_end &&
+    global_plan_.header.frame_id != transformed_plan.header.frame_id)
+  {
+    try {
+      geometry_msgs::msg::TransformStamped transform = tf_->lookupTransform(
+        transformed_plan.header.frame_id, global_plan_.header.frame_id, tf2::TimePointZero);
+      transform_x = transform.transform.translation.x;
+      transform_y = transform.transform.translation.y;
+      transform_yaw = tf2::getYaw(transform.transform.rotation);
+    } catch (tf2::TransformException & ex) {
+      if (incremental_plan_) {
+        RCLCPP_ERROR(node_->get_logger(), "Exception in transformGlobalPlan: %s", ex.what());
+        throw dwb_core::
+              PlannerTFException("Unable to transform global plan into the local frame");
+      }
+      // Without incremental_plan, transform each pose on its own as it always has been,
+      // a pose that can't be transformed coming out empty
+      transform_known = false;
+    }
+  }
+  double cos_yaw = cos(transform_yaw);
+  double sin_yaw = sin(transform_yaw);
+
   // Helper function for the transform below. Converts a pose2D from global
   // frame to local
   auto transformGlobalPoseToLocal = [&](const auto & global_plan_pose) {
-      nav_2d_msgs::msg::Pose2DStamped stamped_pose, transformed_pose;
-      stamped_pose.header.frame_id = global_plan_.header.frame_id;
-      stamped_pose.pose = global_plan_pose;
-      nav_2d_utils::transformPose(
-        tf_, transformed_plan.header.frame_id,
-        stamped_pose, transformed_pose, transform_tolerance_);
-      return transformed_pose.pose;
+      if (!transform_known) {
+        nav_2d_msgs::msg::Pose2DStamped stamped_pose, transformed_pose;
+        stamped_pose.header.frame_id = global_plan_.header.frame_id;
+        stamped_pose.pose = global_plan_pose;
+        nav_2d_utils::transformPose(
+          tf_, transformed_plan.header.frame_id,
+          stamped_pose, transformed_pose, transform_tolerance_);
+        return transformed_pose.pose;
+      }
+      geometry_msgs::msg::Pose2D transformed_pose;
+      transformed_pose.x = transform_x + cos_yaw * global_plan_pose.x -
+        sin_yaw * global_plan_pose.y;
+      transformed_pose.y = transform_y + sin_yaw * global_plan_pose.x +
+        cos_yaw * global_plan_pose.y;
+      transformed_pose.theta = std::remainder(global_plan_pose.theta + transform_yaw, 2 * M_PI);
+      return transformed_pose;
     };
 
+  transformed_plan.poses.reserve(transformation_end - transformation_begin);
   std::transform(
     transformation_begin, transformation_end,
     std::back_inserter(transformed_plan.poses),
     transformGlobalPoseToLocal);
 
   // Remove the portion of the global plan that we've already passed so we don't
-  // process it on the next iteration.
-  if (prune_plan_) {
+  // process it on the next iteration, or just remember where it ends.
+  if (incremental_plan_) {
+    plan_start_index_ = transformation_begin - begin(global_plan_.poses);
+  } else if (prune_plan_) {
+    plan_pruned_poses_ += transformation_begin - begin(global_plan_.poses);
     global_plan_.poses.erase(begin(global_plan_.poses), transformation_begin);
     pub_->publishGlobalPlan(global_plan_);
   }
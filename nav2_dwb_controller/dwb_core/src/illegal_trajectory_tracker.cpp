@@ -37,6 +37,7 @@
 #include <utility>
 #include <string>
 #include <sstream>
+#include <vector>
 
 namespace dwb_core
 {
@@ -47,6 +48,19 @@ void IllegalTrajectoryTracker::addIllegalTrajectory(
   illegal_count_++;
 }
 
+void IllegalTrajectoryTracker::addIllegalTrajectory(
+  const std::string & critic_name, IllegalReason reason)
+{
+  illegal_count_++;
+  for (ReasonCount & reason_count : reason_counts_) {
+    if (reason_count.reason == reason && reason_count.critic_name == critic_name) {
+      reason_count.count++;
+      return;
+    }
+  }
+  reason_counts_.push_back({critic_name, reason, 1});
+}
+
 void IllegalTrajectoryTracker::addLegalTrajectory()
 {
   legal_count_++;
@@ -60,6 +74,10 @@ std::map<std::pair<std::string, std::string>,
   for (auto const & x : counts_) {
     percents[x.first] = static_cast<double>(x.second) / denominator;
   }
+  for (const ReasonCount & x : reason_counts_) {
+    percents[std::make_pair(x.critic_name, std::string(illegalReasonDescription(x.reason)))] +=
+      static_cast<double>(x.count) / denominator;
+  }
   return percents;
 }
 
@@ -35,8 +35,11 @@
 #include "dwb_core/publisher.hpp"
 
 #include <algorithm>
+#include <chrono>
 #include <memory>
+#include <numeric>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "nav_2d_utils/conversions.hpp"
@@ -75,9 +78,26 @@ DWBPublisher::DWBPublisher(
   declare_parameter_if_not_declared(
     node_, plugin_name + ".publish_cost_grid_pc",
     rclcpp::ParameterValue(false));
+  declare_parameter_if_not_declared(
+    node_, plugin_name + ".publish_critic_profiles",
+    rclcpp::ParameterValue(false));
   declare_parameter_if_not_declared(
     node_, plugin_name + ".marker_lifetime",
     rclcpp::ParameterValue(0.1));
+  declare_parameter_if_not_declared(
+    node_, plugin_name + ".publish_async",
+    rclcpp::ParameterValue(false));
+  declare_parameter_if_not_declared(
+    node_, plugin_name + ".debug_publish_rate",
+    rclcpp::ParameterValue(0.0));
+  declare_parameter_if_not_declared(
+    node_, plugin_name + ".max_published_trajectories",
+    rclcpp::ParameterValue(0));
+}
+
+DWBPublisher::~DWBPublisher()
+{
+  stopPublishingThread();
 }
 
 nav2_util::CallbackReturn
@@ -89,6 +109,19 @@ DWBPublisher::on_configure()
   node_->get_parameter(plugin_name_ + ".publish_local_plan", publish_local_plan_);
   node_->get_parameter(plugin_name_ + ".publish_trajectories", publish_trajectories_);
   node_->get_parameter(plugin_name_ + ".publish_cost_grid_pc", publish_cost_grid_pc_);
+  node_->get_parameter(plugin_name_ + ".publish_critic_profiles", publish_critic_profiles_);
+  node_->get_parameter(plugin_name_ + ".publish_async", publish_async_);
+  node_->get_parameter(
+    plugin_name_ + ".max_published_trajectories", max_published_trajectories_);
+
+  // Zero or less publishes on every cycle
+  double debug_publish_rate;
+  node_->get_parameter(plugin_name_ + ".debug_publish_rate", debug_publish_rate);
+  debug_publish_period_ = std::chrono::steady_clock::duration::zero();
+  if (debug_publish_rate > 0.0) {
+    debug_publish_period_ = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+      std::chrono::duration<double>(1.0 / debug_publish_rate));
+  }
 
   eval_pub_ = node_->create_publisher<dwb_msgs::msg::LocalPlanEvaluation>("evaluation", 1);
   global_pub_ = node_->create_publisher<nav_msgs::msg::Path>("received_global_plan", 1);
@@ -96,6 +129,8 @@ DWBPublisher::on_configure()
   local_pub_ = node_->create_publisher<nav_msgs::msg::Path>("local_plan", 1);
   marker_pub_ = node_->create_publisher<visualization_msgs::msg::MarkerArray>("marker", 1);
   cost_grid_pc_pub_ = node_->create_publisher<sensor_msgs::msg::PointCloud>("cost_cloud", 1);
+  critic_profiles_pub_ =
+    node_->create_publisher<dwb_msgs::msg::CriticProfiles>("critic_profiles", 1);
 
   double marker_lifetime;
   node_->get_parameter(plugin_name_ + ".marker_lifetime", marker_lifetime);
@@ -113,6 +148,14 @@ DWBPublisher::on_activate()
   local_pub_->on_activate();
   marker_pub_->on_activate();
   cost_grid_pc_pub_->on_activate();
+  critic_profiles_pub_->on_activate();
+
+  std::fill(
+    next_debug_publish_, next_debug_publish_ + DEBUG_OUTPUT_COUNT,
+    std::chrono::steady_clock::time_point());
+  if (publish_async_) {
+    startPublishingThread();
+  }
 
   return nav2_util::CallbackReturn::SUCCESS;
 }
@@ -120,12 +163,15 @@ DWBPublisher::on_activate()
 nav2_util::CallbackReturn
 DWBPublisher::on_deactivate()
 {
+  stopPublishingThread();
+
   eval_pub_->on_deactivate();
   global_pub_->on_deactivate();
   transformed_pub_->on_deactivate();
   local_pub_->on_deactivate();
   marker_pub_->on_deactivate();
   cost_grid_pc_pub_->on_deactivate();
+  critic_profiles_pub_->on_deactivate();
 
   return nav2_util::CallbackReturn::SUCCESS;
 }
@@ -139,22 +185,37 @@ DWBPublisher::on_cleanup()
   local_pub_.reset();
   marker_pub_.reset();
   cost_grid_pc_pub_.reset();
+  critic_profiles_pub_.reset();
 
   return nav2_util::CallbackReturn::SUCCESS;
 }
 
+bool
+DWBPublisher::shouldRecordEvaluation()
+{
+  if (!isDue(EVALUATION)) {return false;}
+
+  return (publish_evaluation_ && node_->count_subscribers(eval_pub_->get_topic_name()) > 0) ||
+         (publish_trajectories_ && node_->count_subscribers(marker_pub_->get_topic_name()) > 0);
+}
+
 void
 DWBPublisher::publishEvaluation(std::shared_ptr<dwb_msgs::msg::LocalPlanEvaluation> results)
 {
-  if (node_->count_subscribers(eval_pub_->get_topic_name()) < 1) {return;}
-
   if (results == nullptr) {return;}
 
-  if (publish_evaluation_) {
-    eval_pub_->publish(*results);
-  }
+  next_debug_publish_[EVALUATION] = std::chrono::steady_clock::now() + debug_publish_period_;
 
-  publishTrajectories(*results);
+  // The planner is done with the results, so they can be published as they are
+  std::shared_ptr<const dwb_msgs::msg::LocalPlanEvaluation> snapshot = results;
+  dispatch(
+    EVALUATION, [this, snapshot]() {
+      if (publish_evaluation_ && node_->count_subscribers(eval_pub_->get_topic_name()) > 0) {
+        eval_pub_->publish(*snapshot);
+      }
+
+      publishTrajectories(*snapshot);
+    });
 }
 
 void
@@ -185,11 +246,36 @@ DWBPublisher::publishTrajectories(const dwb_msgs::msg::LocalPlanEvaluation & res
     denominator = 1.0;
   }
 
+  // With max_published_trajectories, only the best legal trajectories are shown,
+  // followed by the illegal ones (with negative totals) if there are too few
+  std::vector<unsigned int> shown(results.twists.size());
+  std::iota(shown.begin(), shown.end(), 0);
+  if (max_published_trajectories_ > 0 &&
+    shown.size() > static_cast<size_t>(max_published_trajectories_))
+  {
+    auto better = [&results](unsigned int a, unsigned int b) {
+        double total_a = results.twists[a].total;
+        double total_b = results.twists[b].total;
+        if ((total_a >= 0) != (total_b >= 0)) {
+          return total_a >= 0;
+        }
+        if (total_a != total_b) {
+          return total_a < total_b;
+        }
+        return a < b;
+      };
+    std::nth_element(
+      shown.begin(), shown.begin() + max_published_trajectories_, shown.end(), better);
+    shown.resize(max_published_trajectories_);
+    std::sort(shown.begin(), shown.end());
+  }
+  ma.markers.reserve(shown.size());
+
   unsigned currentValidId = 0;
   unsigned currentInvalidId = 0;
   string validNamespace("ValidTrajectories");
   string invalidNamespace("InvalidTrajectories");
-  for (unsigned int i = 0; i < results.twists.size(); i++) {
+  for (unsigned int i : shown) {
     const dwb_msgs::msg::TrajectoryScore & twist = results.twists[i];
     double displayLevel = (twist.total - best_cost) / denominator;
     if (twist.total >= 0) {
@@ -230,7 +316,7 @@ DWBPublisher::publishLocalPlan(
 
   nav_msgs::msg::Path path =
     nav_2d_utils::poses2DToPath(traj.poses, header.frame_id, header.stamp);
-  if (node_->count_subscribers(local_pub_->get_topic_name()) < 1) {
+  if (node_->count_subscribers(local_pub_->get_topic_name()) > 0) {
     local_pub_->publish(path);
   }
 }
@@ -244,47 +330,78 @@ DWBPublisher::publishCostGrid(
 
   if (!publish_cost_grid_pc_) {return;}
 
-  sensor_msgs::msg::PointCloud cost_grid_pc;
-  cost_grid_pc.header.frame_id = costmap_ros->getGlobalFrameID();
-  cost_grid_pc.header.stamp = node_->now();
+  if (!isDue(COST_GRID)) {return;}
+
+  next_debug_publish_[COST_GRID] = std::chrono::steady_clock::now() + debug_publish_period_;
+
+  auto cost_grid_pc = std::make_shared<sensor_msgs::msg::PointCloud>();
+  cost_grid_pc->header.frame_id = costmap_ros->getGlobalFrameID();
+  cost_grid_pc->header.stamp = node_->now();
 
   nav2_costmap_2d::Costmap2D * costmap = costmap_ros->getCostmap();
-  double x_coord, y_coord;
+  double origin_x, origin_y;
+  costmap->mapToWorld(0, 0, origin_x, origin_y);
+  double resolution = costmap->getResolution();
   unsigned int size_x = costmap->getSizeInCellsX();
   unsigned int size_y = costmap->getSizeInCellsY();
-  cost_grid_pc.points.resize(size_x * size_y);
-  unsigned int i = 0;
-  for (unsigned int cy = 0; cy < size_y; cy++) {
-    for (unsigned int cx = 0; cx < size_x; cx++) {
-      costmap->mapToWorld(cx, cy, x_coord, y_coord);
-      cost_grid_pc.points[i].x = x_coord;
-      cost_grid_pc.points[i].y = y_coord;
-      i++;
-    }
-  }
-
-  sensor_msgs::msg::ChannelFloat32 totals;
-  totals.name = "total_cost";
-  totals.values.resize(size_x * size_y, 0.0);
 
+  // The critics have to add their channels now, while they hold the state of
+  // this cycle, the points and the totals can be filled in afterwards
+  std::vector<std::pair<unsigned int, double>> scaled_channels;
   for (TrajectoryCritic::Ptr critic : critics) {
-    unsigned int channel_index = cost_grid_pc.channels.size();
-    critic->addCriticVisualization(cost_grid_pc);
-    if (channel_index == cost_grid_pc.channels.size()) {
+    unsigned int channel_index = cost_grid_pc->channels.size();
+    critic->addCriticVisualization(*cost_grid_pc);
+    if (channel_index == cost_grid_pc->channels.size()) {
       // No channels were added, so skip to next critic
       continue;
     }
-    double scale = critic->getScale();
-    for (i = 0; i < size_x * size_y; i++) {
-      totals.values[i] += cost_grid_pc.channels[channel_index].values[i] * scale;
-    }
+    scaled_channels.emplace_back(channel_index, critic->getScale());
   }
-  cost_grid_pc.channels.push_back(totals);
 
-  // TODO(crdelsey): convert pc to pc2
-  // sensor_msgs::msg::PointCloud2 cost_grid_pc2;
-  // convertPointCloudToPointCloud2(cost_grid_pc, cost_grid_pc2);
-  cost_grid_pc_pub_->publish(cost_grid_pc);
+  dispatch(
+    COST_GRID, [this, cost_grid_pc, scaled_channels, origin_x, origin_y, resolution, size_x,
+    size_y]() {
+      cost_grid_pc->points.resize(size_x * size_y);
+      unsigned int i = 0;
+      for (unsigned int cy = 0; cy < size_y; cy++) {
+        for (unsigned int cx = 0; cx < size_x; cx++) {
+          cost_grid_pc->points[i].x = origin_x + cx * resolution;
+          cost_grid_pc->points[i].y = origin_y + cy * resolution;
+          i++;
+        }
+      }
+
+      sensor_msgs::msg::ChannelFloat32 totals;
+      totals.name = "total_cost";
+      totals.values.resize(size_x * size_y, 0.0);
+      for (const auto & scaled_channel : scaled_channels) {
+        const auto & values = cost_grid_pc->channels[scaled_channel.first].values;
+        for (i = 0; i < size_x * size_y; i++) {
+          totals.values[i] += values[i] * scaled_channel.second;
+        }
+      }
+      cost_grid_pc->channels.push_back(totals);
+
+      // TODO(crdelsey): convert pc to pc2
+      // sensor_msgs::msg::PointCloud2 cost_grid_pc2;
+      // convertPointCloudToPointCloud2(cost_grid_pc, cost_grid_pc2);
+      cost_grid_pc_pub_->publish(*cost_grid_pc);
+    });
+}
+
+bool
+DWBPublisher::shouldPublishCriticProfiles()
+{
+  return publish_critic_profiles_ &&
+         node_->count_subscribers(critic_profiles_pub_->get_topic_name()) > 0;
+}
+
+void
+DWBPublisher::publishCriticProfiles(const dwb_msgs::msg::CriticProfiles & profiles)
+{
+  if (!shouldPublishCriticProfiles()) {return;}
+
+  critic_profiles_pub_->publish(profiles);
 }
 
 void
@@ -316,4 +433,81 @@ DWBPublisher::publishGenericPlan(
   pub.publish(path);
 }
 
+bool
+DWBPublisher::isDue(DebugOutput output) const
+{
+  return std::chrono::steady_clock::now() >= next_debug_publish_[output];
+}
+
+void
+DWBPublisher::dispatch(DebugOutput output, std::function<void()> job)
+{
+  if (!publishing_thread_.joinable()) {
+    job();
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_jobs_[output] = std::move(job);
+  }
+  jobs_cv_.notify_one();
+}
+
+void
+DWBPublisher::startPublishingThread()
+{
+  if (publishing_thread_.joinable()) {return;}
+
+  stop_publishing_ = false;
+  publishing_thread_ = std::thread(&DWBPublisher::publishingThread, this);
+}
+
+void
+DWBPublisher::stopPublishingThread()
+{
+  if (!publishing_thread_.joinable()) {return;}
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_publishing_ = true;
+  }
+  jobs_cv_.notify_one();
+  publishing_thread_.join();
+
+  // Whatever was still waiting is out of date by the time the thread starts again
+  for (auto & job : pending_jobs_) {
+    job = nullptr;
+  }
+}
+
+void
+DWBPublisher::publishingThread()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    jobs_cv_.wait(
+      lock, [this]() {
+        return stop_publishing_ || std::any_of(
+          pending_jobs_, pending_jobs_ + DEBUG_OUTPUT_COUNT,
+          [](const std::function<void()> & job) {return static_cast<bool>(job);});
+      });
+    if (stop_publishing_) {return;}
+
+    for (auto & pending_job : pending_jobs_) {
+      if (!pending_job) {continue;}
+      std::function<void()> job = std::move(pending_job);
+      pending_job = nullptr;
+
+      lock.unlock();
+      try {
+        job();
+      } catch (const std::exception & e) {
+        RCLCPP_ERROR(node_->get_logger(), "Unable to publish DWB debugging output: %s", e.what());
+      }
+      lock.lock();
+    }
+  }
+}
+
 }  // namespace dwb_core
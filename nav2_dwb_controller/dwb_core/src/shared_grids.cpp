@@ -0,0 +1,131 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Intel Corporation
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "dwb_core/shared_grids.hpp"
+
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace dwb_core
+{
+
+std::shared_ptr<const SharedGrids::Grid>
+SharedGrids::get(
+  const std::string & kind, const Key & key,
+  const std::function<void(Grid &)> & compute,
+  const Reuse & reuse)
+{
+  std::promise<std::shared_ptr<const Grid>> promise;
+  std::shared_future<std::shared_ptr<const Grid>> grid;
+  bool first = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto found = grids_.find(std::make_pair(kind, key));
+    if (found == grids_.end()) {
+      grid = promise.get_future().share();
+      grids_.emplace(std::make_pair(kind, key), grid);
+      first = true;
+    } else {
+      grid = found->second;
+    }
+  }
+
+  // Computed outside the lock, so critics asking for other grids aren't held up
+  if (first) {
+    try {
+      std::shared_ptr<Grid> values = spareGrid();
+      std::shared_ptr<const Grid> result;
+      if (reuse) {
+        // last_grids_ only changes in clear(), while no critic is being prepared
+        auto range = last_grids_.equal_range(kind);
+        for (auto last = range.first; last != range.second && !result; ++last) {
+          switch (reuse(last->second.first, *last->second.second, *values)) {
+            case Reused::AsIs:
+              result = last->second.second;
+              break;
+            case Reused::Derived:
+              result = values;
+              break;
+            default:
+              break;
+          }
+        }
+      }
+      if (!result) {
+        compute(*values);
+        result = values;
+      }
+      promise.set_value(result);
+    } catch (...) {
+      promise.set_exception(std::current_exception());
+    }
+  }
+  return grid.get();
+}
+
+std::shared_ptr<SharedGrids::Grid>
+SharedGrids::spareGrid()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto & grid : all_grids_) {
+    // Critics only get hold of a grid through here, so one held by nobody else stays free
+    if (grid.use_count() == 1) {
+      // See what the last critic holding it did before it let go
+      std::atomic_thread_fence(std::memory_order_acquire);
+      return grid;
+    }
+  }
+  all_grids_.push_back(std::make_shared<Grid>());
+  return all_grids_.back();
+}
+
+void
+SharedGrids::clear()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  last_grids_.clear();
+  for (auto & grid : grids_) {
+    // Every grid asked for was got, and so is ready, unless computing it failed
+    try {
+      last_grids_.emplace(grid.first.first, std::make_pair(grid.first.second, grid.second.get()));
+    } catch (...) {
+    }
+  }
+  grids_.clear();
+}
+
+}  // namespace dwb_core
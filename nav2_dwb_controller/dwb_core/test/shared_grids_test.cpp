@@ -0,0 +1,118 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Intel Corporation
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <memory>
+
+#include "gtest/gtest.h"
+#include "dwb_core/shared_grids.hpp"
+
+using dwb_core::SharedGrids;
+
+static void fill(SharedGrids::Grid & grid, double value, int & computed)
+{
+  grid.reset(16);
+  grid.setWindow(0, 0, 3, 3);
+  for (size_t i = 0; i < 16; i++) {
+    grid.set(i, value);
+  }
+  computed++;
+}
+
+TEST(SharedGrids, sharedWithinCycle)
+{
+  SharedGrids grids;
+  int computed = 0;
+  auto compute = [&computed](SharedGrids::Grid & grid) {fill(grid, 1.0, computed);};
+  auto first = grids.get("kind", {1, 2}, compute);
+  auto second = grids.get("kind", {1, 2}, compute);
+  EXPECT_EQ(first, second);
+  EXPECT_EQ(computed, 1);
+
+  grids.get("kind", {1, 3}, compute);
+  grids.get("other", {1, 2}, compute);
+  EXPECT_EQ(computed, 3);
+
+  // without a way to reuse them, the grids of the last cycle are computed again
+  grids.clear();
+  grids.get("kind", {1, 2}, compute);
+  EXPECT_EQ(computed, 4);
+}
+
+TEST(SharedGrids, reusedAcrossCycles)
+{
+  SharedGrids grids;
+  int computed = 0;
+  auto compute = [&computed](SharedGrids::Grid & grid) {fill(grid, 1.0, computed);};
+  auto first = grids.get("kind", {1, 2}, compute);
+  grids.clear();
+
+  // the same key is taken over as it is
+  auto same = [](const SharedGrids::Key & last_key, const SharedGrids::Grid &,
+      SharedGrids::Grid &) {
+      return last_key == SharedGrids::Key({1, 2}) ?
+             SharedGrids::Reused::AsIs : SharedGrids::Reused::None;
+    };
+  auto reused = grids.get("kind", {1, 2}, compute, same);
+  EXPECT_EQ(reused, first);
+  EXPECT_EQ(computed, 1);
+
+  // another is derived from it
+  auto derive = [](const SharedGrids::Key &, const SharedGrids::Grid & last,
+      SharedGrids::Grid & grid) {
+      grid.reset(last.size());
+      grid.set(0, last.get(0, 0.0) + 1.0);
+      return SharedGrids::Reused::Derived;
+    };
+  auto derived = grids.get("kind", {1, 3}, compute, derive);
+  EXPECT_NE(derived, first);
+  EXPECT_EQ(derived->get(0, 0.0), 2.0);
+  EXPECT_EQ(computed, 1);
+
+  // and it is shared with the critics asking for it later in the cycle
+  EXPECT_EQ(grids.get("kind", {1, 3}, compute), derived);
+
+  // only grids of the same kind are offered
+  auto refuse = [](const SharedGrids::Key &, const SharedGrids::Grid &, SharedGrids::Grid &) {
+      ADD_FAILURE() << "offered a grid of another kind";
+      return SharedGrids::Reused::None;
+    };
+  grids.get("other", {1, 2}, compute, refuse);
+  EXPECT_EQ(computed, 2);
+
+  // the grids of the last cycle are only kept through one clear
+  grids.clear();
+  grids.clear();
+  grids.get("kind", {1, 2}, compute, same);
+  EXPECT_EQ(computed, 3);
+}
@@ -36,6 +36,7 @@
 #define DWB_CRITICS__BASE_OBSTACLE_HPP_
 
 #include "dwb_core/trajectory_critic.hpp"
+#include "nav2_costmap_2d/cost_view.hpp"
 
 namespace dwb_critics
 {
@@ -49,19 +50,48 @@ namespace dwb_critics
  * on the sum_scores parameter.
  *
  * Other classes (like ObstacleFootprintCritic) can do more advanced checking for collisions.
+ *
+ * The costs are read through a CostView of the costmap taken in prepare, which with the
+ * planner's snapshot_costmap is a copy nobody writes while the trajectories are scored.
  */
 class BaseObstacleCritic : public dwb_core::TrajectoryCritic
 {
 public:
   void onInit() override;
+  void setCostmap(nav2_costmap_2d::Costmap2D * costmap) override {costmap_ = costmap;}
+  /**
+   * @brief Take the view of the costmap the trajectories of this cycle are scored with
+   */
+  bool prepare(
+    const geometry_msgs::msg::Pose2D & pose, const nav_2d_msgs::msg::Twist2D & vel,
+    const geometry_msgs::msg::Pose2D & goal, const nav_2d_msgs::msg::Path2D & global_plan) override;
   double scoreTrajectory(const dwb_msgs::msg::Trajectory2D & traj) override;
+  dwb_core::IllegalReason tryScoreTrajectory(
+    const dwb_msgs::msg::Trajectory2D & traj,
+    double & score) override;
+  bool canScoreInParallel() const override {return true;}
+  bool usesTrajectoryCells() const override {return true;}
+  dwb_core::IllegalReason tryScoreCells(
+    const dwb_msgs::msg::Trajectory2D & traj,
+    const dwb_core::TrajectoryCells & cells,
+    double & score) override;
   void addCriticVisualization(sensor_msgs::msg::PointCloud & pc) override;
 
   /**
    * @brief Return the obstacle score for a particular pose
    * @param pose Pose to check
    */
-  virtual double scorePose(const geometry_msgs::msg::Pose2D & pose);
+  double scorePose(const geometry_msgs::msg::Pose2D & pose);
+
+  /**
+   * @brief Score a pose, reporting an illegal one by its reason
+   * @param pose Pose to check
+   * @param score Set to the obstacle score if the pose is legal
+   * @return IllegalReason::None if the pose is legal
+   */
+  virtual dwb_core::IllegalReason tryScorePose(
+    const geometry_msgs::msg::Pose2D & pose,
+    double & score);
 
   /**
    * @brief Check to see whether a given cell cost is valid for driving through.
@@ -72,6 +102,8 @@ public:
 
 protected:
   nav2_costmap_2d::Costmap2D * costmap_;
+  // The costs of costmap_ as of the last prepare
+  nav2_costmap_2d::CostView costs_;
   bool sum_scores_;
 };
 }  // namespace dwb_critics
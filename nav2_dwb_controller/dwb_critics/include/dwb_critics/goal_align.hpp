@@ -58,7 +58,11 @@ public:
   bool prepare(
     const geometry_msgs::msg::Pose2D & pose, const nav_2d_msgs::msg::Twist2D & vel,
     const geometry_msgs::msg::Pose2D & goal, const nav_2d_msgs::msg::Path2D & global_plan) override;
-  double scorePose(const geometry_msgs::msg::Pose2D & pose) override;
+  dwb_core::IllegalReason tryScorePose(
+    const geometry_msgs::msg::Pose2D & pose,
+    double & score) override;
+  /** @brief The cell scored is the one ahead of the pose, not the one it is in */
+  bool usesTrajectoryCells() const override {return false;}
 
 protected:
   double forward_point_distance_;
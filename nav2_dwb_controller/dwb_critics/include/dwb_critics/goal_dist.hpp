@@ -58,6 +58,8 @@ protected:
   bool getLastPoseOnCostmap(
     const nav_2d_msgs::msg::Path2D & global_plan, unsigned int & x,
     unsigned int & y);
+
+  nav_2d_msgs::msg::Path2D adjusted_global_plan_;  ///< Kept to reuse its poses every cycle
 };
 
 }  // namespace dwb_critics
@@ -54,15 +54,35 @@ namespace dwb_critics
  *
  * This approach was chosen for computational efficiency, such that each trajectory
  * need not be compared to the list of source points.
+ *
+ * With alignment_scale set, the critic also scores how far a point forward_point_distance
+ * ahead of each pose is from the sources of an alignment grid, as PathAlignCritic and
+ * GoalAlignCritic do, in the same pass over the poses. The alignment scores are weighted by
+ * alignment_scale over scale, so the total is what the separate critics would give.
  */
 class MapGridCritic : public dwb_core::TrajectoryCritic
 {
 public:
   // Standard TrajectoryCritic Interface
   void onInit() override;
+  void setCostmap(nav2_costmap_2d::Costmap2D * costmap) override;
   double scoreTrajectory(const dwb_msgs::msg::Trajectory2D & traj) override;
+  dwb_core::IllegalReason tryScoreTrajectory(
+    const dwb_msgs::msg::Trajectory2D & traj,
+    double & score) override;
   void addCriticVisualization(sensor_msgs::msg::PointCloud & pc) override;
   double getScale() const override {return costmap_->getResolution() * 0.5 * scale_;}
+  bool canPrepareInParallel() const override {return true;}
+  bool canScoreInParallel() const override {return true;}
+  /**
+   * @brief Subclasses whose tryScorePose scores another cell than the one of the pose
+   * have to return false
+   */
+  bool usesTrajectoryCells() const override {return true;}
+  dwb_core::IllegalReason tryScoreCells(
+    const dwb_msgs::msg::Trajectory2D & traj,
+    const dwb_core::TrajectoryCells & cells,
+    double & score) override;
 
   // Helper Functions
   /**
@@ -70,7 +90,17 @@ public:
    * @param pose The pose to score, assumed to be in the same frame as the costmap
    * @return The score associated with the cell of the costmap where the pose lies
    */
-  virtual double scorePose(const geometry_msgs::msg::Pose2D & pose);
+  double scorePose(const geometry_msgs::msg::Pose2D & pose);
+
+  /**
+   * @brief Retrieve the score for a single pose, reporting a pose off the grid by its reason
+   * @param pose The pose to score, assumed to be in the same frame as the costmap
+   * @param score Set to the score associated with the cell where the pose lies
+   * @return IllegalReason::None if the pose is on the grid
+   */
+  virtual dwb_core::IllegalReason tryScorePose(
+    const geometry_msgs::msg::Pose2D & pose,
+    double & score);
 
   /**
    * @brief Retrieve the score for a particular cell of the costmap
@@ -80,11 +110,15 @@ public:
    */
   inline double getScore(unsigned int x, unsigned int y)
   {
-    return cell_values_[costmap_->getIndex(x, y)];
+    return cell_values_ ?
+           cell_values_->get(costmap_->getIndex(x, y), unreachable_score_) : unreachable_score_;
   }
 
   /**
    * @brief Sets the score of a particular cell to the obstacle cost
+   *
+   * The grid may be shared with other critics, so this works on a copy of it.
+   *
    * @param index Index of the cell to mark
    */
   void setAsObstacle(unsigned int index);
@@ -117,19 +151,90 @@ protected:
   };
 
   /**
-   * @brief Clear the queuDWB_CRITICS_MAP_GRID_He and set cell_values_ to the appropriate number of unreachableCellScore
+   * @brief Drop the scores of the cells, leaving every cell unreachable
    */
   void reset() override;
 
   /**
-   * @brief Go through the queue and set the cells to the Manhattan distance from their parents
+   * @brief Set every cell to its Manhattan distance from the closest of the source cells
+   *
+   * When the planner bounds how far the trajectories reach, only the cells within that
+   * distance of the robot, plus reach_margin_, and the cells around the sources get a
+   * distance, every other cell is left unreachable. The distances set are the same as
+   * without the bound. Critics propagating from the same source cells in one control
+   * cycle share one grid.
+   *
+   * @param pose The pose of the robot, in the frame of the costmap
+   * @param sources Indices of the source cells in the costmap
+   */
+  void propogateManhattanDistances(
+    const geometry_msgs::msg::Pose2D & pose,
+    std::vector<unsigned int> sources);
+
+  /**
+   * @brief The distances from the sources over the window the critic needs, from the
+   *        shared grids or else computed in own_values
+   */
+  std::shared_ptr<const dwb_core::StampedGrid> computeManhattanDistances(
+    const geometry_msgs::msg::Pose2D & pose,
+    std::vector<unsigned int> sources,
+    std::shared_ptr<dwb_core::StampedGrid> & own_values);
+
+  /**
+   * @brief Whether the Manhattan distances of the last cycle, computed for last_key, give
+   *        those of key over the window: as they are, or moved into values with the sources
+   */
+  dwb_core::SharedGrids::Reused reuseManhattanDistances(
+    const dwb_core::SharedGrids::Key & key,
+    unsigned int min_x, unsigned int min_y, unsigned int max_x, unsigned int max_y,
+    const dwb_core::SharedGrids::Key & last_key, const dwb_core::StampedGrid & last,
+    dwb_core::StampedGrid & values);
+
+  /**
+   * @brief Set the alignment grid to the Manhattan distances from other source cells, for
+   *        alignment scores that aren't relative to the same sources as the others
+   */
+  void propogateAlignmentDistances(
+    const geometry_msgs::msg::Pose2D & pose,
+    std::vector<unsigned int> sources);
+
+  /**
+   * @brief Whether the scores of this cycle include alignment scores
+   */
+  bool scoresAlignment() const
+  {
+    return alignment_active_ && align_values_ && alignment_scale_ > 0.0 && scale_ != 0.0;
+  }
+
+  /**
+   * @brief Aggregate the scores of the poses of a trajectory as aggregationType_ says
+   * @param num_poses The number of poses of the trajectory
+   * @param score_pose Sets the score of the pose of an index, as tryScorePose does, and the
+   *        alignment score of its forward point when scoresAlignment()
+   * @param score Set to the aggregated score if the trajectory is legal
+   */
+  template<typename PoseScore>
+  dwb_core::IllegalReason aggregateScores(
+    size_t num_poses, const PoseScore & score_pose, double & score);
+
+  /**
+   * @brief Retrieve the alignment score of the point alignment_distance_ ahead of a pose
    */
-  void propogateManhattanDistances();
+  dwb_core::IllegalReason tryScoreAlignment(
+    const geometry_msgs::msg::Pose2D & pose,
+    double & score) const;
 
   std::shared_ptr<MapGridQueue> queue_;
   nav2_costmap_2d::Costmap2D * costmap_;
-  std::vector<double> cell_values_;
+  std::shared_ptr<const dwb_core::StampedGrid> cell_values_;  ///< Null until propagated
+  std::shared_ptr<dwb_core::StampedGrid> own_values_;  ///< For grids that aren't shared
+  std::shared_ptr<const dwb_core::StampedGrid> align_values_;  ///< Null without alignment
+  std::shared_ptr<dwb_core::StampedGrid> own_align_values_;
+  double alignment_scale_;  ///< 0 without alignment
+  double alignment_distance_;  ///< How far ahead of the poses the alignment points are
+  bool alignment_active_;  ///< Cleared by subclasses for cycles to score without alignment
   double obstacle_score_, unreachable_score_;  ///< Special cell_values
+  double reach_margin_;  ///< How much further than the trajectories the scored poses can be
   bool stop_on_failure_;
   ScoreAggregationType aggregationType_;
 };
@@ -35,8 +35,10 @@
 #ifndef DWB_CRITICS__OBSTACLE_FOOTPRINT_HPP_
 #define DWB_CRITICS__OBSTACLE_FOOTPRINT_HPP_
 
+#include <memory>
 #include <vector>
 #include "dwb_critics/base_obstacle.hpp"
+#include "nav2_costmap_2d/footprint.hpp"
 
 namespace dwb_critics
 {
@@ -61,15 +63,39 @@ Footprint getOrientedFootprint(
  *
  * A more robust class could check every cell within the robot's footprint without inflating the obstacles,
  * at some computational cost. That is left as an excercise to the reader.
+ *
+ * With footprint_mask_headings set, the outline is rasterized once for that many headings and
+ * poses are checked against the nearest one, which is much cheaper when scoring many poses.
+ * With swept_footprint also set, a trajectory is scored in one pass over the cells its outlines
+ * cover and gets the highest cost among them, whatever sum_scores says.
  */
 class ObstacleFootprintCritic : public BaseObstacleCritic
 {
 public:
+  void onInit() override;
+  dwb_core::IllegalReason tryScoreTrajectory(
+    const dwb_msgs::msg::Trajectory2D & traj,
+    double & score) override;
+  /**
+   * @brief Only swept footprints are scored from the cells, checking the poses are on the grid
+   */
+  bool usesTrajectoryCells() const override {return swept_footprint_;}
+  dwb_core::IllegalReason tryScoreCells(
+    const dwb_msgs::msg::Trajectory2D & traj,
+    const dwb_core::TrajectoryCells & cells,
+    double & score) override;
   bool prepare(
     const geometry_msgs::msg::Pose2D & pose, const nav_2d_msgs::msg::Twist2D & vel,
     const geometry_msgs::msg::Pose2D & goal, const nav_2d_msgs::msg::Path2D & global_plan) override;
-  double scorePose(const geometry_msgs::msg::Pose2D & pose) override;
-  virtual double scorePose(
+  dwb_core::IllegalReason tryScorePose(
+    const geometry_msgs::msg::Pose2D & pose,
+    double & score) override;
+  virtual dwb_core::IllegalReason tryScorePose(
+    const geometry_msgs::msg::Pose2D & pose,
+    const Footprint & oriented_footprint,
+    double & score);
+  using BaseObstacleCritic::scorePose;
+  double scorePose(
     const geometry_msgs::msg::Pose2D & pose,
     const Footprint & oriented_footprint);
   double getScale() const override {return costmap_->getResolution() * scale_;}
@@ -81,19 +107,30 @@ protected:
    * @param y0 The y position of the first cell in grid coordinates
    * @param x1 The x position of the second cell in grid coordinates
    * @param y1 The y position of the second cell in grid coordinates
-   * @return A positive cost for a legal line... negative otherwise
+   * @param cost Set to the highest cost along the line if it is legal
+   * @return IllegalReason::None for a legal line
    */
-  double lineCost(int x0, int x1, int y0, int y1);
+  dwb_core::IllegalReason lineCost(int x0, int x1, int y0, int y1, double & cost);
 
   /**
    * @brief Checks the cost of a point in the costmap
    * @param x The x position of the point in cell coordinates
    * @param y The y position of the point in cell coordinates
-   * @return A positive cost for a legal point... negative otherwise
+   * @param cost Set to the cost of the point if it is legal
+   * @return IllegalReason::None for a legal point
+   */
+  dwb_core::IllegalReason pointCost(int x, int y, double & cost);
+
+  /**
+   * @brief Score the footprint swept along a trajectory whose poses are all on the grid
    */
-  double pointCost(int x, int y);
+  dwb_core::IllegalReason sweptFootprintCost(
+    const dwb_msgs::msg::Trajectory2D & traj,
+    double & score);
 
   Footprint footprint_spec_;
+  std::unique_ptr<nav2_costmap_2d::FootprintMask> footprint_mask_;
+  bool swept_footprint_;
 };
 }  // namespace dwb_critics
 
@@ -48,6 +48,9 @@ public:
   bool prepare(
     const geometry_msgs::msg::Pose2D & pose, const nav_2d_msgs::msg::Twist2D & vel,
     const geometry_msgs::msg::Pose2D & goal, const nav_2d_msgs::msg::Path2D & global_plan) override;
+
+protected:
+  nav_2d_msgs::msg::Path2D adjusted_global_plan_;  ///< Kept to reuse its poses every cycle
 };
 
 }  // namespace dwb_critics
@@ -76,6 +76,13 @@ public:
     const geometry_msgs::msg::Pose2D & pose, const nav_2d_msgs::msg::Twist2D & vel,
     const geometry_msgs::msg::Pose2D & goal, const nav_2d_msgs::msg::Path2D & global_plan) override;
   double scoreTrajectory(const dwb_msgs::msg::Trajectory2D & traj) override;
+  dwb_core::IllegalReason tryScoreTrajectory(
+    const dwb_msgs::msg::Trajectory2D & traj,
+    double & score) override;
+  void tryScoreTrajectories(
+    const dwb_msgs::msg::Trajectory2D * const * trajs, size_t count,
+    double * scores, dwb_core::IllegalReason * reasons) override;
+  bool canScoreInParallel() const override {return true;}
   /**
    * @brief Assuming that this is an actual rotation when near the goal, score the trajectory.
    *
@@ -53,6 +53,10 @@ class TwirlingCritic : public dwb_core::TrajectoryCritic
 public:
   void onInit() override;
   double scoreTrajectory(const dwb_msgs::msg::Trajectory2D & traj) override;
+  void tryScoreTrajectories(
+    const dwb_msgs::msg::Trajectory2D * const * trajs, size_t count,
+    double * scores, dwb_core::IllegalReason * reasons) override;
+  bool canScoreInParallel() const override {return true;}
 };
 }  // namespace dwb_critics
 
@@ -53,31 +53,81 @@ void BaseObstacleCritic::onInit()
   nh_->get_parameter(dwb_plugin_name_ + "." + name_ + ".sum_scores", sum_scores_);
 }
 
+bool BaseObstacleCritic::prepare(
+  const geometry_msgs::msg::Pose2D &, const nav_2d_msgs::msg::Twist2D &,
+  const geometry_msgs::msg::Pose2D &, const nav_2d_msgs::msg::Path2D &)
+{
+  costs_ = nav2_costmap_2d::CostView(*costmap_);
+  return true;
+}
+
 double BaseObstacleCritic::scoreTrajectory(const dwb_msgs::msg::Trajectory2D & traj)
 {
-  double score = 0.0;
+  return scoreTrajectoryOrThrow(traj);
+}
+
+dwb_core::IllegalReason BaseObstacleCritic::tryScoreTrajectory(
+  const dwb_msgs::msg::Trajectory2D & traj,
+  double & score)
+{
+  score = 0.0;
   for (unsigned int i = 0; i < traj.poses.size(); ++i) {
-    double pose_score = scorePose(traj.poses[i]);
+    double pose_score = 0.0;
+    dwb_core::IllegalReason reason = tryScorePose(traj.poses[i], pose_score);
+    if (reason != dwb_core::IllegalReason::None) {
+      return reason;
+    }
     // Optimized/branchless version of if (sum_scores_) score += pose_score,
     // else score = pose_score;
     score = static_cast<double>(sum_scores_) * score + pose_score;
   }
-  return score;
+  return dwb_core::IllegalReason::None;
+}
+
+dwb_core::IllegalReason BaseObstacleCritic::tryScoreCells(
+  const dwb_msgs::msg::Trajectory2D &,
+  const dwb_core::TrajectoryCells & cells,
+  double & score)
+{
+  score = 0.0;
+  for (size_t i = 0; i < cells.size(); ++i) {
+    const dwb_core::TrajectoryCells::Cell & cell = cells[i];
+    if (!cell.on_grid) {
+      return dwb_core::IllegalReason::OffGrid;
+    }
+    if (!isValidCost(cell.cost)) {
+      return dwb_core::IllegalReason::HitsObstacle;
+    }
+    score = static_cast<double>(sum_scores_) * score + cell.cost;
+  }
+  return dwb_core::IllegalReason::None;
 }
 
 double BaseObstacleCritic::scorePose(const geometry_msgs::msg::Pose2D & pose)
 {
-  unsigned int cell_x, cell_y;
-  if (!costmap_->worldToMap(pose.x, pose.y, cell_x, cell_y)) {
+  double score = 0.0;
+  dwb_core::IllegalReason reason = tryScorePose(pose, score);
+  if (reason != dwb_core::IllegalReason::None) {
     throw dwb_core::
-          IllegalTrajectoryException(name_, "Trajectory Goes Off Grid.");
+          IllegalTrajectoryException(name_, dwb_core::illegalReasonDescription(reason));
+  }
+  return score;
+}
+
+dwb_core::IllegalReason BaseObstacleCritic::tryScorePose(
+  const geometry_msgs::msg::Pose2D & pose,
+  double & score)
+{
+  unsigned int cell_x, cell_y;
+  if (!costs_.worldToMap(pose.x, pose.y, cell_x, cell_y)) {
+    return dwb_core::IllegalReason::OffGrid;
   }
-  unsigned char cost = costmap_->getCost(cell_x, cell_y);
+  unsigned char cost = costs_.getCost(cell_x, cell_y);
   if (!isValidCost(cost)) {
-    throw dwb_core::
-          IllegalTrajectoryException(name_, "Trajectory Hits Obstacle.");
+    return dwb_core::IllegalReason::HitsObstacle;
   }
-  return cost;
+  score = cost;
+  return dwb_core::IllegalReason::None;
 }
 
 bool BaseObstacleCritic::isValidCost(const unsigned char cost)
@@ -92,13 +142,14 @@ void BaseObstacleCritic::addCriticVisualization(sensor_msgs::msg::PointCloud & p
   sensor_msgs::msg::ChannelFloat32 grid_scores;
   grid_scores.name = name_;
 
-  unsigned int size_x = costmap_->getSizeInCellsX();
-  unsigned int size_y = costmap_->getSizeInCellsY();
+  unsigned int size_x = costs_.getSizeInCellsX();
+  unsigned int size_y = costs_.getSizeInCellsY();
   grid_scores.values.resize(size_x * size_y);
   unsigned int i = 0;
   for (unsigned int cy = 0; cy < size_y; cy++) {
+    const unsigned char * row = costs_.row(cy);
     for (unsigned int cx = 0; cx < size_x; cx++) {
-      grid_scores.values[i] = costmap_->getCost(cx, cy);
+      grid_scores.values[i] = row[cx];
       i++;
     }
   }
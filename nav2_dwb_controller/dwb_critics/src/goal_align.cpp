@@ -49,6 +49,8 @@ void GoalAlignCritic::onInit()
   forward_point_distance_ = nav_2d_utils::searchAndGetParam(
     nh_,
     dwb_plugin_name_ + "." + name_ + ".forward_point_distance", 0.325);
+  // the poses scored are this far ahead of the trajectory
+  reach_margin_ = forward_point_distance_;
 }
 
 bool GoalAlignCritic::prepare(
@@ -70,9 +72,11 @@ bool GoalAlignCritic::prepare(
   return GoalDistCritic::prepare(pose, vel, goal, target_poses);
 }
 
-double GoalAlignCritic::scorePose(const geometry_msgs::msg::Pose2D & pose)
+dwb_core::IllegalReason GoalAlignCritic::tryScorePose(
+  const geometry_msgs::msg::Pose2D & pose,
+  double & score)
 {
-  return GoalDistCritic::scorePose(getForwardPose(pose, forward_point_distance_));
+  return GoalDistCritic::tryScorePose(getForwardPose(pose, forward_point_distance_), score);
 }
 
 }  // namespace dwb_critics
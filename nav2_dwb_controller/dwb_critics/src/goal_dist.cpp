@@ -33,6 +33,7 @@
  */
 
 #include "dwb_critics/goal_dist.hpp"
+#include <cmath>
 #include <vector>
 #include "pluginlib/class_list_macros.hpp"
 #include "nav_2d_utils/path_ops.hpp"
@@ -41,8 +42,8 @@
 namespace dwb_critics
 {
 bool GoalDistCritic::prepare(
-  const geometry_msgs::msg::Pose2D &, const nav_2d_msgs::msg::Twist2D &,
-  const geometry_msgs::msg::Pose2D &,
+  const geometry_msgs::msg::Pose2D & pose, const nav_2d_msgs::msg::Twist2D &,
+  const geometry_msgs::msg::Pose2D & goal,
   const nav_2d_msgs::msg::Path2D & global_plan)
 {
   reset();
@@ -52,12 +53,20 @@ bool GoalDistCritic::prepare(
     return false;
   }
 
-  // Enqueue just the last pose
-  int index = costmap_->getIndex(local_goal_x, local_goal_y);
-  cell_values_[index] = 0.0;
-  queue_->enqueueCell(local_goal_x, local_goal_y);
+  // Propagate from just the last pose
+  propogateManhattanDistances(pose, {costmap_->getIndex(local_goal_x, local_goal_y)});
 
-  propogateManhattanDistances();
+  if (alignment_scale_ > 0.0) {
+    // the forward points are drawn to the goal moved forward, as GoalAlignCritic does
+    double angle_to_goal = atan2(goal.y - pose.y, goal.x - pose.x);
+    nav_2d_msgs::msg::Path2D target_poses = global_plan;
+    target_poses.poses.back().x += alignment_distance_ * cos(angle_to_goal);
+    target_poses.poses.back().y += alignment_distance_ * sin(angle_to_goal);
+    if (!getLastPoseOnCostmap(target_poses, local_goal_x, local_goal_y)) {
+      return false;
+    }
+    propogateAlignmentDistances(pose, {costmap_->getIndex(local_goal_x, local_goal_y)});
+  }
 
   return true;
 }
@@ -66,9 +75,9 @@ bool GoalDistCritic::getLastPoseOnCostmap(
   const nav_2d_msgs::msg::Path2D & global_plan,
   unsigned int & x, unsigned int & y)
 {
-  nav_2d_msgs::msg::Path2D adjusted_global_plan = nav_2d_utils::adjustPlanResolution(
-    global_plan,
-    costmap_->getResolution());
+  nav_2d_utils::adjustPlanResolution(
+    global_plan, costmap_->getResolution(), adjusted_global_plan_);
+  const nav_2d_msgs::msg::Path2D & adjusted_global_plan = adjusted_global_plan_;
   bool started_path = false;
 
   // skip global path points until we reach the border of the local map
@@ -40,6 +40,8 @@
 #include "dwb_core/exceptions.hpp"
 #include "nav2_costmap_2d/cost_values.hpp"
 #include "nav2_util/node_utils.hpp"
+#include "nav_2d_utils/parameters.hpp"
+#include "dwb_critics/alignment_util.hpp"
 
 using std::abs;
 using costmap_queue::CellData;
@@ -60,6 +62,7 @@ void MapGridCritic::onInit()
 
   // Always set to true, but can be overriden by subclasses
   stop_on_failure_ = true;
+  reach_margin_ = 0.0;
 
   nav2_util::declare_parameter_if_not_declared(
     nh_,
@@ -82,81 +85,317 @@ void MapGridCritic::onInit()
       aggro_str.c_str());
     aggregationType_ = ScoreAggregationType::Last;
   }
+
+  nav2_util::declare_parameter_if_not_declared(
+    nh_,
+    dwb_plugin_name_ + "." + name_ + ".alignment_scale", rclcpp::ParameterValue(0.0));
+  nh_->get_parameter(dwb_plugin_name_ + "." + name_ + ".alignment_scale", alignment_scale_);
+  alignment_distance_ = 0.0;
+  alignment_active_ = true;
+  if (alignment_scale_ > 0.0) {
+    alignment_distance_ = nav_2d_utils::searchAndGetParam(
+      nh_,
+      dwb_plugin_name_ + "." + name_ + ".forward_point_distance", 0.325);
+    reach_margin_ = alignment_distance_;
+  }
+
+  reset();
+}
+
+void MapGridCritic::setCostmap(nav2_costmap_2d::Costmap2D * costmap)
+{
+  costmap_ = costmap;
+  queue_ = std::make_shared<MapGridQueue>(*costmap_, *this);
 }
 
 void MapGridCritic::setAsObstacle(unsigned int index)
 {
-  cell_values_[index] = obstacle_score_;
+  auto values = cell_values_ ?
+    std::make_shared<dwb_core::StampedGrid>(*cell_values_) :
+    std::make_shared<dwb_core::StampedGrid>();
+  if (!cell_values_) {
+    values->reset(costmap_->getSizeInCellsX() * costmap_->getSizeInCellsY());
+  }
+  values->set(index, obstacle_score_);
+  cell_values_ = values;
 }
 
 void MapGridCritic::reset()
 {
-  queue_->reset();
-  cell_values_.resize(costmap_->getSizeInCellsX() * costmap_->getSizeInCellsY());
-  obstacle_score_ = static_cast<double>(cell_values_.size());
+  cell_values_.reset();
+  align_values_.reset();
+  obstacle_score_ =
+    static_cast<double>(costmap_->getSizeInCellsX() * costmap_->getSizeInCellsY());
   unreachable_score_ = obstacle_score_ + 1.0;
-  std::fill(cell_values_.begin(), cell_values_.end(), unreachable_score_);
 }
 
-void MapGridCritic::propogateManhattanDistances()
+void MapGridCritic::propogateManhattanDistances(
+  const geometry_msgs::msg::Pose2D & pose,
+  std::vector<unsigned int> sources)
+{
+  cell_values_.reset();
+  cell_values_ = computeManhattanDistances(pose, sources, own_values_);
+}
+
+void MapGridCritic::propogateAlignmentDistances(
+  const geometry_msgs::msg::Pose2D & pose,
+  std::vector<unsigned int> sources)
+{
+  align_values_.reset();
+  align_values_ = computeManhattanDistances(pose, sources, own_align_values_);
+}
+
+std::shared_ptr<const dwb_core::StampedGrid> MapGridCritic::computeManhattanDistances(
+  const geometry_msgs::msg::Pose2D & pose,
+  std::vector<unsigned int> sources,
+  std::shared_ptr<dwb_core::StampedGrid> & own_values)
+{
+  std::sort(sources.begin(), sources.end());
+  sources.erase(std::unique(sources.begin(), sources.end()), sources.end());
+
+  unsigned int size_x = costmap_->getSizeInCellsX();
+  unsigned int size_y = costmap_->getSizeInCellsY();
+  unsigned int min_x = 0, min_y = 0, max_x = size_x - 1, max_y = size_y - 1;
+  if (reach_ >= 0.0) {
+    // The cells the scored poses can be in. The window also spans the sources, as a
+    // rectangle holds a shortest Manhattan path between any two of its cells, so the
+    // distances in it come out the same as over the whole costmap.
+    int cells = static_cast<int>(ceil((reach_ + reach_margin_) / costmap_->getResolution())) + 1;
+    int robot_x, robot_y;
+    costmap_->worldToMapNoBounds(pose.x, pose.y, robot_x, robot_y);
+    min_x = std::max(0, std::min(robot_x - cells, static_cast<int>(size_x) - 1));
+    min_y = std::max(0, std::min(robot_y - cells, static_cast<int>(size_y) - 1));
+    max_x = std::min(static_cast<int>(size_x) - 1, std::max(robot_x + cells, 0));
+    max_y = std::min(static_cast<int>(size_y) - 1, std::max(robot_y + cells, 0));
+    for (unsigned int index : sources) {
+      min_x = std::min(min_x, index % size_x);
+      min_y = std::min(min_y, index / size_x);
+      max_x = std::max(max_x, index % size_x);
+      max_y = std::max(max_y, index / size_x);
+    }
+  }
+
+  auto propagate = [&](dwb_core::StampedGrid & values) {
+      queue_->reset();
+      queue_->setWindow(min_x, min_y, max_x, max_y);
+      values.reset(size_x * size_y);
+      values.setWindow(min_x, min_y, max_x, max_y);
+      for (unsigned int index : sources) {
+        values.set(index, 0.0);
+        queue_->enqueueCell(index % size_x, index / size_x);
+      }
+      while (!queue_->isEmpty()) {
+        costmap_queue::CellData cell = queue_->getNextCell();
+        values.set(
+          cell.index_, CellData::absolute_difference(cell.src_x_, cell.x_) +
+          CellData::absolute_difference(cell.src_y_, cell.y_));
+      }
+    };
+
+  if (shared_grids_) {
+    // The grid only depends on the size of the costmap and the sources, and the window it
+    // was computed over, any window holding the one of this critic will do
+    dwb_core::SharedGrids::Key key;
+    key.reserve(sources.size() + 2);
+    key.push_back(size_x);
+    key.push_back(size_y);
+    key.insert(key.end(), sources.begin(), sources.end());
+    auto shared = shared_grids_->get(
+      "manhattan_distance", key, propagate,
+      [&](const dwb_core::SharedGrids::Key & last_key, const dwb_core::StampedGrid & last,
+      dwb_core::StampedGrid & values) {
+        return reuseManhattanDistances(key, min_x, min_y, max_x, max_y, last_key, last, values);
+      });
+    if (shared->covers(min_x, min_y, max_x, max_y)) {
+      return shared;
+    }
+  }
+
+  if (!own_values) {
+    own_values = std::make_shared<dwb_core::StampedGrid>();
+  }
+  propagate(*own_values);
+  return own_values;
+}
+
+dwb_core::SharedGrids::Reused MapGridCritic::reuseManhattanDistances(
+  const dwb_core::SharedGrids::Key & key,
+  unsigned int min_x, unsigned int min_y, unsigned int max_x, unsigned int max_y,
+  const dwb_core::SharedGrids::Key & last_key, const dwb_core::StampedGrid & last,
+  dwb_core::StampedGrid & values)
 {
-  while (!queue_->isEmpty()) {
-    costmap_queue::CellData cell = queue_->getNextCell();
-    cell_values_[cell.index_] = CellData::absolute_difference(cell.src_x_, cell.x_) +
-      CellData::absolute_difference(cell.src_y_, cell.y_);
+  using Reused = dwb_core::SharedGrids::Reused;
+  if (last_key.size() != key.size() || key.size() < 3 ||
+    last_key[0] != key[0] || last_key[1] != key[1])
+  {
+    return Reused::None;
+  }
+
+  // The distance of a cell is its Manhattan distance to the nearest source, so when every
+  // source moved by the same number of cells, as when the robot didn't move along the plan
+  // but a rolling costmap moved under it, the distances moved with them
+  const unsigned int size_x = key[0];
+  const int dx = static_cast<int>(key[2] % size_x) - static_cast<int>(last_key[2] % size_x);
+  const int dy = static_cast<int>(key[2] / size_x) - static_cast<int>(last_key[2] / size_x);
+  for (size_t i = 3; i < key.size(); ++i) {
+    if (static_cast<int>(key[i] % size_x) - static_cast<int>(last_key[i] % size_x) != dx ||
+      static_cast<int>(key[i] / size_x) - static_cast<int>(last_key[i] / size_x) != dy)
+    {
+      return Reused::None;
+    }
+  }
+
+  if (dx == 0 && dy == 0) {
+    // the same sources, any grid computed over a window holding this one will do
+    return last.covers(min_x, min_y, max_x, max_y) ? Reused::AsIs : Reused::None;
+  }
+
+  // The window, where it was before the move, must be all in the last grid's window
+  if (static_cast<int>(min_x) - dx < 0 || static_cast<int>(min_y) - dy < 0 ||
+    !last.covers(min_x - dx, min_y - dy, max_x - dx, max_y - dy))
+  {
+    return Reused::None;
+  }
+  values.reset(last.size());
+  values.setWindow(min_x, min_y, max_x, max_y);
+  for (unsigned int y = min_y; y <= max_y; ++y) {
+    size_t index = static_cast<size_t>(y) * size_x + min_x;
+    size_t last_index = static_cast<size_t>(y - dy) * size_x + (min_x - dx);
+    for (unsigned int x = min_x; x <= max_x; ++x, ++index, ++last_index) {
+      values.set(index, last.get(last_index, unreachable_score_));
+    }
   }
+  return Reused::Derived;
 }
 
 double MapGridCritic::scoreTrajectory(const dwb_msgs::msg::Trajectory2D & traj)
 {
-  double score = 0.0;
-  unsigned int start_index = 0;
+  return scoreTrajectoryOrThrow(traj);
+}
+
+template<typename PoseScore>
+dwb_core::IllegalReason MapGridCritic::aggregateScores(
+  size_t num_poses, const PoseScore & score_pose, double & score)
+{
+  score = 0.0;
+  double align_score = 0.0;
+  size_t start_index = 0;
   if (aggregationType_ == ScoreAggregationType::Product) {
     score = 1.0;
+    align_score = 1.0;
   } else if (aggregationType_ == ScoreAggregationType::Last && !stop_on_failure_) {
-    start_index = traj.poses.size() - 1;
+    start_index = num_poses - 1;
   }
-  double grid_dist;
+  double grid_dist = 0.0, align_dist = 0.0;
 
-  for (unsigned int i = start_index; i < traj.poses.size(); ++i) {
-    grid_dist = scorePose(traj.poses[i]);
+  for (size_t i = start_index; i < num_poses; ++i) {
+    dwb_core::IllegalReason reason = score_pose(i, grid_dist, align_dist);
+    if (reason != dwb_core::IllegalReason::None) {
+      return reason;
+    }
     if (stop_on_failure_) {
       if (grid_dist == obstacle_score_) {
-        throw dwb_core::
-              IllegalTrajectoryException(name_, "Trajectory Hits Obstacle.");
+        return dwb_core::IllegalReason::HitsObstacle;
       } else if (grid_dist == unreachable_score_) {
-        throw dwb_core::
-              IllegalTrajectoryException(name_, "Trajectory Hits Unreachable Area.");
+        return dwb_core::IllegalReason::HitsUnreachable;
       }
     }
 
     switch (aggregationType_) {
       case ScoreAggregationType::Last:
         score = grid_dist;
+        align_score = align_dist;
         break;
       case ScoreAggregationType::Sum:
         score += grid_dist;
+        align_score += align_dist;
         break;
       case ScoreAggregationType::Product:
         if (score > 0) {
           score *= grid_dist;
         }
+        if (align_score > 0) {
+          align_score *= align_dist;
+        }
         break;
     }
   }
 
-  return score;
+  if (scoresAlignment()) {
+    score += align_score * alignment_scale_ / scale_;
+  }
+  return dwb_core::IllegalReason::None;
+}
+
+dwb_core::IllegalReason MapGridCritic::tryScoreAlignment(
+  const geometry_msgs::msg::Pose2D & pose,
+  double & score) const
+{
+  geometry_msgs::msg::Pose2D forward_pose = getForwardPose(pose, alignment_distance_);
+  unsigned int cell_x, cell_y;
+  if (!costmap_->worldToMap(forward_pose.x, forward_pose.y, cell_x, cell_y)) {
+    return dwb_core::IllegalReason::OffGrid;
+  }
+  score = align_values_->get(costmap_->getIndex(cell_x, cell_y), unreachable_score_);
+  return dwb_core::IllegalReason::None;
+}
+
+dwb_core::IllegalReason MapGridCritic::tryScoreTrajectory(
+  const dwb_msgs::msg::Trajectory2D & traj,
+  double & score)
+{
+  bool align = scoresAlignment();
+  return aggregateScores(
+    traj.poses.size(), [&](size_t i, double & grid_dist, double & align_dist) {
+      dwb_core::IllegalReason reason = tryScorePose(traj.poses[i], grid_dist);
+      if (reason == dwb_core::IllegalReason::None && align) {
+        reason = tryScoreAlignment(traj.poses[i], align_dist);
+      }
+      return reason;
+    }, score);
+}
+
+dwb_core::IllegalReason MapGridCritic::tryScoreCells(
+  const dwb_msgs::msg::Trajectory2D & traj,
+  const dwb_core::TrajectoryCells & cells,
+  double & score)
+{
+  bool align = scoresAlignment();
+  return aggregateScores(
+    cells.size(), [&](size_t i, double & grid_dist, double & align_dist) {
+      const dwb_core::TrajectoryCells::Cell & cell = cells[i];
+      if (!cell.on_grid) {
+        return dwb_core::IllegalReason::OffGrid;
+      }
+      grid_dist = cell_values_ ?
+      cell_values_->get(cell.index, unreachable_score_) : unreachable_score_;
+      return align ? tryScoreAlignment(traj.poses[i], align_dist) :
+             dwb_core::IllegalReason::None;
+    }, score);
 }
 
 double MapGridCritic::scorePose(const geometry_msgs::msg::Pose2D & pose)
+{
+  double score = 0.0;
+  dwb_core::IllegalReason reason = tryScorePose(pose, score);
+  if (reason != dwb_core::IllegalReason::None) {
+    throw dwb_core::
+          IllegalTrajectoryException(name_, dwb_core::illegalReasonDescription(reason));
+  }
+  return score;
+}
+
+dwb_core::IllegalReason MapGridCritic::tryScorePose(
+  const geometry_msgs::msg::Pose2D & pose,
+  double & score)
 {
   unsigned int cell_x, cell_y;
   // we won't allow trajectories that go off the map... shouldn't happen that often anyways
   if (!costmap_->worldToMap(pose.x, pose.y, cell_x, cell_y)) {
-    throw dwb_core::
-          IllegalTrajectoryException(name_, "Trajectory Goes Off Grid.");
+    return dwb_core::IllegalReason::OffGrid;
   }
-  return getScore(cell_x, cell_y);
+  score = getScore(cell_x, cell_y);
+  return dwb_core::IllegalReason::None;
 }
 
 void MapGridCritic::addCriticVisualization(sensor_msgs::msg::PointCloud & pc)
@@ -34,11 +34,13 @@
 
 #include "dwb_critics/obstacle_footprint.hpp"
 #include <algorithm>
+#include <utility>
 #include <vector>
-#include "dwb_critics/line_iterator.hpp"
 #include "dwb_core/exceptions.hpp"
 #include "pluginlib/class_list_macros.hpp"
 #include "nav2_costmap_2d/cost_values.hpp"
+#include "nav2_util/grid_geometry.hpp"
+#include "nav2_util/node_utils.hpp"
 
 PLUGINLIB_EXPORT_CLASS(dwb_critics::ObstacleFootprintCritic, dwb_core::TrajectoryCritic)
 
@@ -60,10 +62,86 @@ Footprint getOrientedFootprint(
   return oriented_footprint;
 }
 
+void ObstacleFootprintCritic::onInit()
+{
+  BaseObstacleCritic::onInit();
+
+  nav2_util::declare_parameter_if_not_declared(
+    nh_,
+    dwb_plugin_name_ + "." + name_ + ".footprint_mask_headings", rclcpp::ParameterValue(0));
+  int num_headings = 0;
+  nh_->get_parameter(dwb_plugin_name_ + "." + name_ + ".footprint_mask_headings", num_headings);
+  if (num_headings > 0) {
+    footprint_mask_ = std::make_unique<nav2_costmap_2d::FootprintMask>(num_headings);
+  }
+
+  nav2_util::declare_parameter_if_not_declared(
+    nh_,
+    dwb_plugin_name_ + "." + name_ + ".swept_footprint", rclcpp::ParameterValue(false));
+  nh_->get_parameter(dwb_plugin_name_ + "." + name_ + ".swept_footprint", swept_footprint_);
+  if (swept_footprint_ && !footprint_mask_) {
+    RCLCPP_WARN(
+      rclcpp::get_logger("ObstacleFootprintCritic"),
+      "swept_footprint needs footprint_mask_headings to be set, scoring pose by pose instead.");
+    swept_footprint_ = false;
+  }
+}
+
+dwb_core::IllegalReason ObstacleFootprintCritic::tryScoreTrajectory(
+  const dwb_msgs::msg::Trajectory2D & traj,
+  double & score)
+{
+  if (!swept_footprint_) {
+    return BaseObstacleCritic::tryScoreTrajectory(traj, score);
+  }
+
+  unsigned int cell_x, cell_y;
+  for (const geometry_msgs::msg::Pose2D & pose : traj.poses) {
+    if (!costs_.worldToMap(pose.x, pose.y, cell_x, cell_y)) {
+      return dwb_core::IllegalReason::OffGrid;
+    }
+  }
+  return sweptFootprintCost(traj, score);
+}
+
+dwb_core::IllegalReason ObstacleFootprintCritic::tryScoreCells(
+  const dwb_msgs::msg::Trajectory2D & traj,
+  const dwb_core::TrajectoryCells & cells,
+  double & score)
+{
+  if (!swept_footprint_) {
+    return tryScoreTrajectory(traj, score);
+  }
+  for (size_t i = 0; i < cells.size(); ++i) {
+    if (!cells[i].on_grid) {
+      return dwb_core::IllegalReason::OffGrid;
+    }
+  }
+  return sweptFootprintCost(traj, score);
+}
+
+dwb_core::IllegalReason ObstacleFootprintCritic::sweptFootprintCost(
+  const dwb_msgs::msg::Trajectory2D & traj,
+  double & score)
+{
+  double footprint_cost = footprint_mask_->trajectoryFootprintCost(*costmap_, traj.poses);
+  if (footprint_cost < 0.0) {
+    return dwb_core::IllegalReason::FootprintOffGrid;
+  }
+  if (footprint_cost == nav2_costmap_2d::LETHAL_OBSTACLE) {
+    return dwb_core::IllegalReason::HitsObstacle;
+  } else if (footprint_cost == nav2_costmap_2d::NO_INFORMATION) {
+    return dwb_core::IllegalReason::HitsUnknown;
+  }
+  score = footprint_cost;
+  return dwb_core::IllegalReason::None;
+}
+
 bool ObstacleFootprintCritic::prepare(
-  const geometry_msgs::msg::Pose2D &, const nav_2d_msgs::msg::Twist2D &,
-  const geometry_msgs::msg::Pose2D &, const nav_2d_msgs::msg::Path2D &)
+  const geometry_msgs::msg::Pose2D & pose, const nav_2d_msgs::msg::Twist2D & vel,
+  const geometry_msgs::msg::Pose2D & goal, const nav_2d_msgs::msg::Path2D & global_plan)
 {
+  BaseObstacleCritic::prepare(pose, vel, goal, global_plan);
   footprint_spec_ = costmap_ros_->getRobotFootprint();
   if (footprint_spec_.size() == 0) {
     RCLCPP_ERROR(
@@ -71,95 +149,128 @@ bool ObstacleFootprintCritic::prepare(
       "Footprint spec is empty, maybe missing call to setFootprint?");
     return false;
   }
+  if (footprint_mask_) {
+    // only rasterized again when the footprint or the resolution changed
+    footprint_mask_->setFootprint(footprint_spec_, costmap_->getResolution());
+  }
   return true;
 }
 
-double ObstacleFootprintCritic::scorePose(const geometry_msgs::msg::Pose2D & pose)
+dwb_core::IllegalReason ObstacleFootprintCritic::tryScorePose(
+  const geometry_msgs::msg::Pose2D & pose,
+  double & score)
 {
   unsigned int cell_x, cell_y;
-  if (!costmap_->worldToMap(pose.x, pose.y, cell_x, cell_y)) {
-    throw dwb_core::
-          IllegalTrajectoryException(name_, "Trajectory Goes Off Grid.");
+  if (!costs_.worldToMap(pose.x, pose.y, cell_x, cell_y)) {
+    return dwb_core::IllegalReason::OffGrid;
   }
-  return scorePose(pose, getOrientedFootprint(pose, footprint_spec_));
+  if (footprint_mask_) {
+    double footprint_cost = footprint_mask_->footprintCostAtPose(
+      *costmap_, pose.x, pose.y, pose.theta);
+    if (footprint_cost < 0.0) {
+      return dwb_core::IllegalReason::FootprintOffGrid;
+    }
+    if (footprint_cost == nav2_costmap_2d::LETHAL_OBSTACLE) {
+      return dwb_core::IllegalReason::HitsObstacle;
+    } else if (footprint_cost == nav2_costmap_2d::NO_INFORMATION) {
+      return dwb_core::IllegalReason::HitsUnknown;
+    }
+    score = footprint_cost;
+    return dwb_core::IllegalReason::None;
+  }
+  return tryScorePose(pose, getOrientedFootprint(pose, footprint_spec_), score);
 }
 
 double ObstacleFootprintCritic::scorePose(
-  const geometry_msgs::msg::Pose2D &,
+  const geometry_msgs::msg::Pose2D & pose,
   const Footprint & footprint)
 {
-  // now we really have to lay down the footprint in the costmap grid
-  unsigned int x0, x1, y0, y1;
-  double line_cost = 0.0;
-  double footprint_cost = 0.0;
-
-  // we need to rasterize each line in the footprint
-  for (unsigned int i = 0; i < footprint.size() - 1; ++i) {
-    // get the cell coord of the first point
-    if (!costmap_->worldToMap(footprint[i].x, footprint[i].y, x0, y0)) {
-      throw dwb_core::
-            IllegalTrajectoryException(name_, "Footprint Goes Off Grid.");
-    }
-
-    // get the cell coord of the second point
-    if (!costmap_->worldToMap(footprint[i + 1].x, footprint[i + 1].y, x1, y1)) {
-      throw dwb_core::
-            IllegalTrajectoryException(name_, "Footprint Goes Off Grid.");
-    }
-
-    line_cost = lineCost(x0, x1, y0, y1);
-    footprint_cost = std::max(line_cost, footprint_cost);
-  }
-
-  // we also need to connect the first point in the footprint to the last point
-  // get the cell coord of the last point
-  if (!costmap_->worldToMap(footprint.back().x, footprint.back().y, x0, y0)) {
+  double score = 0.0;
+  dwb_core::IllegalReason reason = tryScorePose(pose, footprint, score);
+  if (reason != dwb_core::IllegalReason::None) {
     throw dwb_core::
-          IllegalTrajectoryException(name_, "Footprint Goes Off Grid.");
+          IllegalTrajectoryException(name_, dwb_core::illegalReasonDescription(reason));
   }
+  return score;
+}
 
-  // get the cell coord of the first point
-  if (!costmap_->worldToMap(footprint.front().x, footprint.front().y, x1, y1)) {
-    throw dwb_core::
-          IllegalTrajectoryException(name_, "Footprint Goes Off Grid.");
+dwb_core::IllegalReason ObstacleFootprintCritic::tryScorePose(
+  const geometry_msgs::msg::Pose2D &,
+  const Footprint & footprint,
+  double & score)
+{
+  // now we really have to lay down the footprint in the costmap grid, finding the cells
+  // of all its points at once
+  std::vector<std::pair<int, int>> cells;
+  if (!costs_.worldToMap(footprint, cells)) {
+    return dwb_core::IllegalReason::FootprintOffGrid;
   }
 
-  line_cost = lineCost(x0, x1, y0, y1);
-  footprint_cost = std::max(line_cost, footprint_cost);
+  // we need to rasterize each line in the footprint, and connect the last point to the first
+  double line_cost = 0.0;
+  double footprint_cost = 0.0;
+  for (unsigned int i = 0; i < cells.size(); ++i) {
+    const std::pair<int, int> & start = cells[i];
+    const std::pair<int, int> & end = cells[(i + 1) % cells.size()];
+    dwb_core::IllegalReason reason =
+      lineCost(start.first, end.first, start.second, end.second, line_cost);
+    if (reason != dwb_core::IllegalReason::None) {
+      return reason;
+    }
+    footprint_cost = std::max(line_cost, footprint_cost);
+  }
 
   // if all line costs are legal... then we can return that the footprint is legal
-  return footprint_cost;
+  score = footprint_cost;
+  return dwb_core::IllegalReason::None;
 }
 
-double ObstacleFootprintCritic::lineCost(int x0, int x1, int y0, int y1)
+dwb_core::IllegalReason ObstacleFootprintCritic::lineCost(
+  int x0, int x1, int y0, int y1,
+  double & cost)
 {
-  double line_cost = 0.0;
-  double point_cost = -1.0;
-
-  for (LineIterator line(x0, y0, x1, y1); line.isValid(); line.advance()) {
-    point_cost = pointCost(line.getX(), line.getY());   // Score the current point
+  unsigned char line_cost = 0;
+  dwb_core::IllegalReason reason = dwb_core::IllegalReason::None;
 
-    if (line_cost < point_cost) {
-      line_cost = point_cost;
-    }
+  nav2_util::traceLineSpans(
+    x0, y0, x1, y1, [&](int y, int x_min, int x_max) {
+      // a plain max reduction over the run, which the compiler vectorizes
+      const unsigned char * row = costs_.row(y);
+      unsigned char span_cost = 0;
+      for (int x = x_min; x <= x_max; ++x) {
+        span_cost = std::max(span_cost, row[x]);
+      }
+      if (span_cost >= nav2_costmap_2d::LETHAL_OBSTACLE &&
+        reason == dwb_core::IllegalReason::None)
+      {
+        // find the cell that makes the line illegal
+        double point_cost;
+        for (int x = x_min; x <= x_max && reason == dwb_core::IllegalReason::None; ++x) {
+          reason = pointCost(x, y, point_cost);
+        }
+      }
+      line_cost = std::max(line_cost, span_cost);
+    });
+  if (reason != dwb_core::IllegalReason::None) {
+    return reason;
   }
 
-  return line_cost;
+  cost = line_cost;
+  return dwb_core::IllegalReason::None;
 }
 
-double ObstacleFootprintCritic::pointCost(int x, int y)
+dwb_core::IllegalReason ObstacleFootprintCritic::pointCost(int x, int y, double & cost)
 {
-  unsigned char cost = costmap_->getCost(x, y);
+  unsigned char cell_cost = costs_.getCost(x, y);
   // if the cell is in an obstacle the path is invalid or unknown
-  if (cost == nav2_costmap_2d::LETHAL_OBSTACLE) {
-    throw dwb_core::
-          IllegalTrajectoryException(name_, "Trajectory Hits Obstacle.");
-  } else if (cost == nav2_costmap_2d::NO_INFORMATION) {
-    throw dwb_core::
-          IllegalTrajectoryException(name_, "Trajectory Hits Unknown Region.");
+  if (cell_cost == nav2_costmap_2d::LETHAL_OBSTACLE) {
+    return dwb_core::IllegalReason::HitsObstacle;
+  } else if (cell_cost == nav2_costmap_2d::NO_INFORMATION) {
+    return dwb_core::IllegalReason::HitsUnknown;
   }
 
-  return cost;
+  cost = cell_cost;
+  return dwb_core::IllegalReason::None;
 }
 
 }  // namespace dwb_critics
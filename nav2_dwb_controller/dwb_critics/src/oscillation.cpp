@@ -33,6 +33,7 @@
  */
 
 #include "dwb_critics/oscillation.hpp"
+#include <algorithm>
 #include <chrono>
 #include <cmath>
 #include <string>
@@ -40,6 +41,7 @@
 #include "nav_2d_utils/parameters.hpp"
 #include "nav2_util/node_utils.hpp"
 #include "dwb_core/exceptions.hpp"
+#include "dwb_core/twist_batch.hpp"
 #include "pluginlib/class_list_macros.hpp"
 
 PLUGINLIB_EXPORT_CLASS(dwb_critics::OscillationCritic, dwb_core::TrajectoryCritic)
@@ -213,15 +215,46 @@ bool OscillationCritic::setOscillationFlags(const nav_2d_msgs::msg::Twist2D & cm
 }
 
 double OscillationCritic::scoreTrajectory(const dwb_msgs::msg::Trajectory2D & traj)
+{
+  return scoreTrajectoryOrThrow(traj);
+}
+
+dwb_core::IllegalReason OscillationCritic::tryScoreTrajectory(
+  const dwb_msgs::msg::Trajectory2D & traj,
+  double & score)
 {
   if (x_trend_.isOscillating(traj.velocity.x) ||
     y_trend_.isOscillating(traj.velocity.y) ||
     theta_trend_.isOscillating(traj.velocity.theta))
   {
-    throw dwb_core::
-          IllegalTrajectoryException(name_, "Trajectory is oscillating.");
+    return dwb_core::IllegalReason::Oscillating;
+  }
+  score = 0.0;
+  return dwb_core::IllegalReason::None;
+}
+
+void OscillationCritic::tryScoreTrajectories(
+  const dwb_msgs::msg::Trajectory2D * const * trajs, size_t count,
+  double * scores, dwb_core::IllegalReason * reasons)
+{
+  std::fill_n(scores, count, 0.0);
+  if (!x_trend_.hasSignFlipped() && !y_trend_.hasSignFlipped() &&
+    !theta_trend_.hasSignFlipped())
+  {
+    // no sign flip to hold on to, so nothing oscillates
+    std::fill_n(reasons, count, dwb_core::IllegalReason::None);
+    return;
+  }
+
+  dwb_core::TwistBatch twists;
+  twists.gather(trajs, count);
+  for (size_t i = 0; i < count; i++) {
+    bool oscillating = x_trend_.isOscillating(twists.x[i]) |
+      y_trend_.isOscillating(twists.y[i]) |
+      theta_trend_.isOscillating(twists.theta[i]);
+    reasons[i] = oscillating ?
+      dwb_core::IllegalReason::Oscillating : dwb_core::IllegalReason::None;
   }
-  return 0.0;
 }
 
 }  // namespace dwb_critics
@@ -49,6 +49,8 @@ void PathAlignCritic::onInit()
   forward_point_distance_ = nav_2d_utils::searchAndGetParam(
     nh_,
     dwb_plugin_name_ + "." + name_ + ".forward_point_distance", 0.325);
+  // the poses scored are this far ahead of the trajectory
+  reach_margin_ = forward_point_distance_;
 }
 
 bool PathAlignCritic::prepare(
@@ -79,9 +81,11 @@ double PathAlignCritic::getScale() const
   }
 }
 
-double PathAlignCritic::scorePose(const geometry_msgs::msg::Pose2D & pose)
+dwb_core::IllegalReason PathAlignCritic::tryScorePose(
+  const geometry_msgs::msg::Pose2D & pose,
+  double & score)
 {
-  return PathDistCritic::scorePose(getForwardPose(pose, forward_point_distance_));
+  return PathDistCritic::tryScorePose(getForwardPose(pose, forward_point_distance_), score);
 }
 
 }  // namespace dwb_critics
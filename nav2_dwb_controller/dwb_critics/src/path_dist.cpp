@@ -33,6 +33,7 @@
  */
 
 #include "dwb_critics/path_dist.hpp"
+#include <cmath>
 #include <vector>
 #include "pluginlib/class_list_macros.hpp"
 #include "nav_2d_utils/path_ops.hpp"
@@ -41,15 +42,17 @@
 namespace dwb_critics
 {
 bool PathDistCritic::prepare(
-  const geometry_msgs::msg::Pose2D &, const nav_2d_msgs::msg::Twist2D &,
-  const geometry_msgs::msg::Pose2D &,
+  const geometry_msgs::msg::Pose2D & pose, const nav_2d_msgs::msg::Twist2D &,
+  const geometry_msgs::msg::Pose2D & goal,
   const nav_2d_msgs::msg::Path2D & global_plan)
 {
   reset();
   bool started_path = false;
+  std::vector<unsigned int> sources;
 
-  nav_2d_msgs::msg::Path2D adjusted_global_plan =
-    nav_2d_utils::adjustPlanResolution(global_plan, costmap_->getResolution());
+  nav_2d_utils::adjustPlanResolution(
+    global_plan, costmap_->getResolution(), adjusted_global_plan_);
+  const nav_2d_msgs::msg::Path2D & adjusted_global_plan = adjusted_global_plan_;
 
   if (adjusted_global_plan.poses.size() != global_plan.poses.size()) {
     RCLCPP_DEBUG(
@@ -68,9 +71,7 @@ bool PathDistCritic::prepare(
         g_x, g_y, map_x,
         map_y) && costmap_->getCost(map_x, map_y) != nav2_costmap_2d::NO_INFORMATION)
     {
-      int index = costmap_->getIndex(map_x, map_y);
-      cell_values_[index] = 0.0;
-      queue_->enqueueCell(map_x, map_y);
+      sources.push_back(costmap_->getIndex(map_x, map_y));
       started_path = true;
     } else if (started_path) {
       break;
@@ -85,7 +86,14 @@ bool PathDistCritic::prepare(
     return false;
   }
 
-  propogateManhattanDistances();
+  propogateManhattanDistances(pose, sources);
+
+  if (alignment_scale_ > 0.0) {
+    // the forward points are scored against the same grid, but not once the forward point
+    // can be past the goal, as PathAlignCritic does
+    align_values_ = cell_values_;
+    alignment_active_ = hypot(pose.x - goal.x, pose.y - goal.y) > alignment_distance_;
+  }
 
   return true;
 }
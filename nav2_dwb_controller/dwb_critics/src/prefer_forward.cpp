@@ -34,6 +34,8 @@
 
 #include "dwb_critics/prefer_forward.hpp"
 #include <math.h>
+#include <algorithm>
+#include "dwb_core/twist_batch.hpp"
 #include "pluginlib/class_list_macros.hpp"
 #include "nav2_util/node_utils.hpp"
 
@@ -80,4 +82,20 @@ double PreferForwardCritic::scoreTrajectory(const dwb_msgs::msg::Trajectory2D &
   return fabs(traj.velocity.theta) * theta_scale_;
 }
 
+void PreferForwardCritic::tryScoreTrajectories(
+  const dwb_msgs::msg::Trajectory2D * const * trajs, size_t count,
+  double * scores, dwb_core::IllegalReason * reasons)
+{
+  // the same as scoreTrajectory, without branches
+  dwb_core::TwistBatch twists;
+  twists.gather(trajs, count);
+  for (size_t i = 0; i < count; i++) {
+    double x = twists.x[i];
+    double theta = fabs(twists.theta[i]);
+    bool penalized = (x < 0.0) | ((x < strafe_x_) & (theta < strafe_theta_));
+    scores[i] = penalized ? penalty_ : theta * theta_scale_;
+  }
+  std::fill_n(reasons, count, dwb_core::IllegalReason::None);
+}
+
 }  // namespace dwb_critics
@@ -33,6 +33,7 @@
  */
 
 #include "dwb_critics/rotate_to_goal.hpp"
+#include <algorithm>
 #include <string>
 #include <vector>
 #include "nav_2d_utils/parameters.hpp"
@@ -90,25 +91,53 @@ bool RotateToGoalCritic::prepare(
 }
 
 double RotateToGoalCritic::scoreTrajectory(const dwb_msgs::msg::Trajectory2D & traj)
+{
+  return scoreTrajectoryOrThrow(traj);
+}
+
+dwb_core::IllegalReason RotateToGoalCritic::tryScoreTrajectory(
+  const dwb_msgs::msg::Trajectory2D & traj,
+  double & score)
 {
   // If we're not sufficiently close to the goal, we don't care what the twist is
   if (!in_window_) {
-    return 0.0;
+    score = 0.0;
+    return dwb_core::IllegalReason::None;
   } else if (!rotating_) {
     double speed_sq = hypot_sq(traj.velocity.x, traj.velocity.y);
     if (speed_sq >= current_xy_speed_sq_) {
-      throw dwb_core::IllegalTrajectoryException(name_, "Not slowing down near goal.");
+      return dwb_core::IllegalReason::NotSlowingDown;
     }
-    return speed_sq * slowing_factor_ + scoreRotation(traj);
+    if (traj.poses.empty()) {
+      return dwb_core::IllegalReason::EmptyTrajectory;
+    }
+    score = speed_sq * slowing_factor_ + scoreRotation(traj);
+    return dwb_core::IllegalReason::None;
   }
 
   // If we're sufficiently close to the goal, any transforming velocity is invalid
   if (fabs(traj.velocity.x) > 0 || fabs(traj.velocity.y) > 0) {
-    throw dwb_core::
-          IllegalTrajectoryException(name_, "Nonrotation command near goal.");
+    return dwb_core::IllegalReason::NonRotationNearGoal;
   }
 
-  return scoreRotation(traj);
+  if (traj.poses.empty()) {
+    return dwb_core::IllegalReason::EmptyTrajectory;
+  }
+  score = scoreRotation(traj);
+  return dwb_core::IllegalReason::None;
+}
+
+void RotateToGoalCritic::tryScoreTrajectories(
+  const dwb_msgs::msg::Trajectory2D * const * trajs, size_t count,
+  double * scores, dwb_core::IllegalReason * reasons)
+{
+  // away from the goal, which is most of the time, every twist is scored the same
+  if (!in_window_) {
+    std::fill_n(scores, count, 0.0);
+    std::fill_n(reasons, count, dwb_core::IllegalReason::None);
+    return;
+  }
+  dwb_core::TrajectoryCritic::tryScoreTrajectories(trajs, count, scores, reasons);
 }
 
 double RotateToGoalCritic::scoreRotation(const dwb_msgs::msg::Trajectory2D & traj)
@@ -33,6 +33,9 @@
  */
 
 #include "dwb_critics/twirling.hpp"
+#include <algorithm>
+#include <cmath>
+#include "dwb_core/twist_batch.hpp"
 #include "pluginlib/class_list_macros.hpp"
 
 namespace dwb_critics
@@ -51,6 +54,18 @@ double TwirlingCritic::scoreTrajectory(const dwb_msgs::msg::Trajectory2D & traj)
 {
   return fabs(traj.velocity.theta);  // add cost for making the robot spin
 }
+
+void TwirlingCritic::tryScoreTrajectories(
+  const dwb_msgs::msg::Trajectory2D * const * trajs, size_t count,
+  double * scores, dwb_core::IllegalReason * reasons)
+{
+  dwb_core::TwistBatch twists;
+  twists.gather(trajs, count);
+  for (size_t i = 0; i < count; i++) {
+    scores[i] = fabs(twists.theta[i]);
+  }
+  std::fill_n(reasons, count, dwb_core::IllegalReason::None);
+}
 }  // namespace dwb_critics
 
 PLUGINLIB_EXPORT_CLASS(dwb_critics::TwirlingCritic, dwb_core::TrajectoryCritic)
@@ -0,0 +1,106 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Intel Corporation
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef DWB_PLUGINS__COARSE_TO_FINE_ITERATOR_HPP_
+#define DWB_PLUGINS__COARSE_TO_FINE_ITERATOR_HPP_
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "dwb_plugins/velocity_iterator.hpp"
+#include "nav2_util/lifecycle_node.hpp"
+
+namespace dwb_plugins
+{
+/**
+ * @class CoarseToFineIterator
+ * @brief Searches the dynamic window on a coarse grid first, then around the best twists found
+ *
+ * The first round is a grid of coarse_vx_samples x coarse_vy_samples x coarse_vtheta_samples
+ * over the same window XYThetaIterator samples. Each of the following refine_iterations rounds
+ * halves the spacing and tries the neighbours of the refine_best best twists scored so far,
+ * so far fewer trajectories are scored than for a dense grid of similar resolution.
+ *
+ * A round can only start once every twist of the last one has been scored, so hasMoreTwists
+ * is false until then.
+ */
+class CoarseToFineIterator : public VelocityIterator
+{
+public:
+  CoarseToFineIterator()
+  : kinematics_(nullptr) {}
+  void initialize(
+    const nav2_util::LifecycleNode::SharedPtr & nh,
+    KinematicParameters::Ptr kinematics,
+    const std::string & plugin_name) override;
+  void startNewIteration(const nav_2d_msgs::msg::Twist2D & current_velocity, double dt) override;
+  bool hasMoreTwists() override;
+  nav_2d_msgs::msg::Twist2D nextTwist() override;
+  void reportScore(const nav_2d_msgs::msg::Twist2D & twist, double score) override;
+  unsigned int getVersion() override {return version_;}
+
+protected:
+  /**
+   * @brief Queue the neighbours of the best twists at a spacing of the coarse one over 2^round
+   */
+  void startRefinement();
+
+  /**
+   * @brief Queue a twist, unless it is outside the window, invalid or already queued
+   */
+  void addTwist(double x, double y, double theta);
+
+  int vx_samples_, vy_samples_, vtheta_samples_;
+  int refine_best_, refine_iterations_;
+  KinematicParameters::Ptr kinematics_;
+
+  // The window and the spacing of the coarse grid, for x, y and theta
+  double min_[3], max_[3], step_[3];
+
+  std::vector<nav_2d_msgs::msg::Twist2D> twists_;
+  size_t next_twist_;
+  int round_;
+  std::vector<std::pair<double, nav_2d_msgs::msg::Twist2D>> scores_;
+
+  // Subscription for parameter change
+  std::string plugin_name_;
+  unsigned int version_{0};
+  rclcpp::AsyncParametersClient::SharedPtr parameters_client_;
+  rclcpp::Subscription<rcl_interfaces::msg::ParameterEvent>::SharedPtr parameter_event_sub_;
+  void on_parameter_event_callback(const rcl_interfaces::msg::ParameterEvent::SharedPtr event);
+};
+}  // namespace dwb_plugins
+
+#endif  // DWB_PLUGINS__COARSE_TO_FINE_ITERATOR_HPP_
@@ -90,6 +90,11 @@ public:
    */
   bool isValidSpeed(double x, double y, double theta);
 
+  /**
+   * @brief A count of the changes to the parameters, for anything computed from them to check
+   */
+  inline unsigned int getVersion() {return version_;}
+
   using Ptr = std::shared_ptr<KinematicParameters>;
 
 protected:
@@ -113,6 +118,8 @@ protected:
   double min_speed_xy_sq_{0};
   double max_speed_xy_sq_{0};
 
+  unsigned int version_{0};
+
   void reconfigureCB();
 
   // Subscription for parameter change
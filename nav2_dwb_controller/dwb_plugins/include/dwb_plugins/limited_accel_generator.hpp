@@ -37,6 +37,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "dwb_plugins/standard_traj_generator.hpp"
 #include "nav2_util/lifecycle_node.hpp"
@@ -53,9 +54,10 @@ public:
   void initialize(
     const nav2_util::LifecycleNode::SharedPtr & nh,
     const std::string & plugin_name) override;
-  void startNewIteration(const nav_2d_msgs::msg::Twist2D & current_velocity) override;
 
 protected:
+  void startIterator(const nav_2d_msgs::msg::Twist2D & current_velocity) override;
+
   /**
    * @brief Calculate the velocity after a set period of time, given the desired velocity and acceleration limits
    *
@@ -70,6 +72,7 @@ protected:
     const nav_2d_msgs::msg::Twist2D & cmd_vel,
     const nav_2d_msgs::msg::Twist2D & start_vel,
     const double dt) override;
+  std::vector<double> getLatticeParameters() override;
   double acceleration_time_;
   std::string plugin_name_;
 };
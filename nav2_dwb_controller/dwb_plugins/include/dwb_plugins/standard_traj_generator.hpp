@@ -35,9 +35,11 @@
 #ifndef DWB_PLUGINS__STANDARD_TRAJ_GENERATOR_HPP_
 #define DWB_PLUGINS__STANDARD_TRAJ_GENERATOR_HPP_
 
+#include <map>
 #include <vector>
 #include <memory>
 #include <string>
+#include <tuple>
 
 #include "rclcpp/rclcpp.hpp"
 #include "dwb_core/trajectory_generator.hpp"
@@ -62,11 +64,26 @@ public:
   void startNewIteration(const nav_2d_msgs::msg::Twist2D & current_velocity) override;
   bool hasMoreTwists() override;
   nav_2d_msgs::msg::Twist2D nextTwist() override;
+  void reportScore(const nav_2d_msgs::msg::Twist2D & cmd_vel, double score) override;
+  double getMaxReach(const nav_2d_msgs::msg::Twist2D & current_velocity) override;
+  bool canGenerateInParallel() const override {return true;}
 
   dwb_msgs::msg::Trajectory2D generateTrajectory(
     const geometry_msgs::msg::Pose2D & start_pose,
     const nav_2d_msgs::msg::Twist2D & start_vel,
     const nav_2d_msgs::msg::Twist2D & cmd_vel) override;
+  void generateTrajectoryInto(
+    const geometry_msgs::msg::Pose2D & start_pose,
+    const nav_2d_msgs::msg::Twist2D & start_vel,
+    const nav_2d_msgs::msg::Twist2D & cmd_vel,
+    dwb_msgs::msg::Trajectory2D & traj) override;
+
+  /**
+   * @brief Fill the velocity lattice with every bucket of current velocities within the
+   *        kinematic limits, and write it to a file that velocity_lattice_file can load
+   * @return False if the velocity lattice is disabled or the file can't be written
+   */
+  bool writeVelocityLattice(const std::string & filename);
 
 protected:
   /**
@@ -74,6 +91,20 @@ protected:
    */
   virtual void initializeIterator(const nav2_util::LifecycleNode::SharedPtr & nh);
 
+  /**
+   * @brief Start the velocity iterator on the window of velocities reachable from current_velocity
+   */
+  virtual void startIterator(const nav_2d_msgs::msg::Twist2D & current_velocity);
+
+  /**
+   * @brief Simulate the trajectory from start_pose, without looking in the velocity lattice
+   */
+  void rolloutInto(
+    const geometry_msgs::msg::Pose2D & start_pose,
+    const nav_2d_msgs::msg::Twist2D & start_vel,
+    const nav_2d_msgs::msg::Twist2D & cmd_vel,
+    dwb_msgs::msg::Trajectory2D & traj);
+
   /**
    * @brief Calculate the velocity after a set period of time, given the desired velocity and acceleration limits
    *
@@ -113,6 +144,26 @@ protected:
    */
   virtual std::vector<double> getTimeSteps(const nav_2d_msgs::msg::Twist2D & cmd_vel);
 
+  /**
+   * @brief The number of equal time steps getTimeSteps divides sim_time into
+   */
+  int getTimeStepCount(const nav_2d_msgs::msg::Twist2D & cmd_vel) const;
+
+  /**
+   * @brief generateTrajectoryInto for analytic_rollout
+   *
+   * Steps through computeNewVelocity and computeNewPosition only until the velocity reaches
+   * cmd_vel. The rest of the trajectory is an arc at constant twist, whose headings advance by
+   * the same angle every step, so the direction of each step is the last one rotated by that
+   * angle and no trig is evaluated per pose. This gives the same poses as the step by step
+   * integration, as long as the velocity stays at cmd_vel once reached.
+   */
+  void generateArcInto(
+    const geometry_msgs::msg::Pose2D & start_pose,
+    const nav_2d_msgs::msg::Twist2D & start_vel,
+    const nav_2d_msgs::msg::Twist2D & cmd_vel,
+    dwb_msgs::msg::Trajectory2D & traj);
+
   KinematicParameters::Ptr kinematics_;
   std::shared_ptr<VelocityIterator> velocity_iterator_;
 
@@ -130,6 +181,97 @@ protected:
   /// @brief If not discretizing by time, the amount of angular space between points
   double angular_granularity_;
 
+  /**
+   * @brief Whether poses at constant twist are computed in closed form, see generateArcInto
+   *
+   * Only for the default computeNewPosition kinematics and equal time steps, so subclasses
+   * overriding computeNewPosition or getTimeSteps should leave it off.
+   */
+  bool analytic_rollout_;
+
+  /**
+   * @brief The twists sampled from one bucket of current velocities, and their trajectories
+   *        from the origin, keyed on the twist
+   */
+  struct LatticeEntry
+  {
+    std::map<std::tuple<double, double, double>, dwb_msgs::msg::Trajectory2D> trajectories;
+    unsigned int last_used{0};
+    /// @brief Entries read from velocity_lattice_file are never evicted
+    bool from_file{false};
+  };
+  using LatticeKey = std::tuple<long, long, long>;
+
+  /**
+   * @brief The bucket of the velocity lattice that a current velocity falls in
+   */
+  LatticeKey getLatticeKey(const nav_2d_msgs::msg::Twist2D & velocity) const;
+
+  /**
+   * @brief The velocity in the middle of a bucket
+   */
+  nav_2d_msgs::msg::Twist2D getBucketVelocity(const LatticeKey & key) const;
+
+  /**
+   * @brief Add the entry for a bucket, with the trajectories of every twist the iterator
+   *        samples from the middle of it
+   */
+  LatticeEntry & buildLatticeEntry(const LatticeKey & key);
+
+  /**
+   * @brief The parameters the trajectories of the lattice depend on, which a lattice file has
+   *        to have been written with to be loaded
+   *
+   * Subclasses that change how trajectories are rolled out should append their own.
+   */
+  virtual std::vector<double> getLatticeParameters();
+
+  /**
+   * @brief Load the entries of a file written by writeVelocityLattice
+   * @return False if the file can't be read, or was written with other parameters
+   */
+  bool readVelocityLattice(const std::string & filename);
+
+  /**
+   * @brief Find or build the lattice entry for the bucket of current_velocity, and start the
+   *        iterator on the velocity in the middle of the bucket
+   *
+   * The entries are dropped whenever the kinematic parameters change, and the least recently
+   * used one not from velocity_lattice_file goes when there are more than velocity_lattice_size
+   * of those.
+   */
+  void startLatticeIteration(const nav_2d_msgs::msg::Twist2D & current_velocity);
+
+  /**
+   * @brief Copy the trajectory of the current lattice entry for cmd_vel over to start_pose
+   * @return False if the lattice holds no trajectory for this start velocity and cmd_vel
+   */
+  bool getLatticeTrajectory(
+    const geometry_msgs::msg::Pose2D & start_pose,
+    const nav_2d_msgs::msg::Twist2D & start_vel,
+    const nav_2d_msgs::msg::Twist2D & cmd_vel,
+    dwb_msgs::msg::Trajectory2D & traj) const;
+
+  /**
+   * @brief Bucket sizes of the velocity lattice, in m/s and rad/s. 0 disables the lattice
+   *
+   * With the lattice, the current velocity is rounded to the middle of its bucket, so
+   * the twists sampled and their trajectories can be reused whenever the robot is back in the
+   * same bucket: rolling out a trajectory is a lookup and a rigid transform of the poses.
+   */
+  double lattice_resolution_;
+  double lattice_angular_resolution_;
+  int lattice_size_;
+  /// @brief The lattice precomputed with writeVelocityLattice, if any, loaded on initialize
+  std::string lattice_file_;
+  std::map<LatticeKey, LatticeEntry> lattice_;
+  size_t lattice_file_entries_;
+  const LatticeEntry * current_entry_;
+  LatticeKey current_key_;
+  unsigned int lattice_cycle_;
+  unsigned int lattice_kinematics_version_;
+  unsigned int lattice_iterator_version_;
+
   /// @brief the name of the overlying plugin ID
   std::string plugin_name_;
 
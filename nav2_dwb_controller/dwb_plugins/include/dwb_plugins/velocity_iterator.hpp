@@ -56,6 +56,14 @@ public:
   virtual void startNewIteration(const nav_2d_msgs::msg::Twist2D & current_velocity, double dt) = 0;
   virtual bool hasMoreTwists() = 0;
   virtual nav_2d_msgs::msg::Twist2D nextTwist() = 0;
+  /**
+   * @brief How a twist returned by nextTwist scored, see TrajectoryGenerator::reportScore
+   */
+  virtual void reportScore(const nav_2d_msgs::msg::Twist2D & /*twist*/, double /*score*/) {}
+  /**
+   * @brief A count of the changes to the sampling, for anything computed from the twists to check
+   */
+  virtual unsigned int getVersion() {return 0;}
 };
 }  // namespace dwb_plugins
 
@@ -56,6 +56,7 @@ public:
   void startNewIteration(const nav_2d_msgs::msg::Twist2D & current_velocity, double dt) override;
   bool hasMoreTwists() override;
   nav_2d_msgs::msg::Twist2D nextTwist() override;
+  unsigned int getVersion() override {return version_;}
 
 protected:
   virtual bool isValidVelocity();
@@ -64,6 +65,13 @@ protected:
   KinematicParameters::Ptr kinematics_;
 
   std::shared_ptr<OneDVelocityIterator> x_it_, y_it_, th_it_;
+
+  // Subscription for parameter change
+  std::string plugin_name_;
+  unsigned int version_{0};
+  rclcpp::AsyncParametersClient::SharedPtr parameters_client_;
+  rclcpp::Subscription<rcl_interfaces::msg::ParameterEvent>::SharedPtr parameter_event_sub_;
+  void on_parameter_event_callback(const rcl_interfaces::msg::ParameterEvent::SharedPtr event);
 };
 }  // namespace dwb_plugins
 
@@ -0,0 +1,238 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2020, Intel Corporation
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the copyright holder nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "dwb_plugins/coarse_to_fine_iterator.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+#include "dwb_plugins/one_d_velocity_iterator.hpp"
+#include "nav2_util/node_utils.hpp"
+
+namespace dwb_plugins
+{
+void CoarseToFineIterator::initialize(
+  const nav2_util::LifecycleNode::SharedPtr & nh,
+  KinematicParameters::Ptr kinematics,
+  const std::string & plugin_name)
+{
+  kinematics_ = kinematics;
+
+  nav2_util::declare_parameter_if_not_declared(
+    nh,
+    plugin_name + ".coarse_vx_samples", rclcpp::ParameterValue(5));
+  nav2_util::declare_parameter_if_not_declared(
+    nh,
+    plugin_name + ".coarse_vy_samples", rclcpp::ParameterValue(3));
+  nav2_util::declare_parameter_if_not_declared(
+    nh,
+    plugin_name + ".coarse_vtheta_samples", rclcpp::ParameterValue(5));
+  nav2_util::declare_parameter_if_not_declared(
+    nh,
+    plugin_name + ".refine_best", rclcpp::ParameterValue(3));
+  nav2_util::declare_parameter_if_not_declared(
+    nh,
+    plugin_name + ".refine_iterations", rclcpp::ParameterValue(3));
+
+  nh->get_parameter(plugin_name + ".coarse_vx_samples", vx_samples_);
+  nh->get_parameter(plugin_name + ".coarse_vy_samples", vy_samples_);
+  nh->get_parameter(plugin_name + ".coarse_vtheta_samples", vtheta_samples_);
+  nh->get_parameter(plugin_name + ".refine_best", refine_best_);
+  nh->get_parameter(plugin_name + ".refine_iterations", refine_iterations_);
+
+  // Setup callback for changes to parameters.
+  plugin_name_ = plugin_name;
+  parameters_client_ = std::make_shared<rclcpp::AsyncParametersClient>(
+    nh->get_node_base_interface(),
+    nh->get_node_topics_interface(),
+    nh->get_node_graph_interface(),
+    nh->get_node_services_interface());
+
+  parameter_event_sub_ = parameters_client_->on_parameter_event(
+    std::bind(&CoarseToFineIterator::on_parameter_event_callback, this, std::placeholders::_1));
+}
+
+void
+CoarseToFineIterator::on_parameter_event_callback(
+  const rcl_interfaces::msg::ParameterEvent::SharedPtr event)
+{
+  // like the kinematic parameters, the new values are picked up by the next cycle
+  for (auto & changed_parameter : event->changed_parameters) {
+    const auto & type = changed_parameter.value.type;
+    const auto & name = changed_parameter.name;
+    const auto & value = changed_parameter.value;
+
+    if (type == rcl_interfaces::msg::ParameterType::PARAMETER_INTEGER) {
+      if (name == plugin_name_ + ".coarse_vx_samples") {
+        vx_samples_ = value.integer_value;
+      } else if (name == plugin_name_ + ".coarse_vy_samples") {
+        vy_samples_ = value.integer_value;
+      } else if (name == plugin_name_ + ".coarse_vtheta_samples") {
+        vtheta_samples_ = value.integer_value;
+      } else if (name == plugin_name_ + ".refine_best") {
+        refine_best_ = value.integer_value;
+      } else if (name == plugin_name_ + ".refine_iterations") {
+        refine_iterations_ = value.integer_value;
+      } else {
+        continue;
+      }
+      version_++;
+    }
+  }
+}
+
+void CoarseToFineIterator::startNewIteration(
+  const nav_2d_msgs::msg::Twist2D & current_velocity,
+  double dt)
+{
+  twists_.clear();
+  scores_.clear();
+  next_twist_ = 0;
+  round_ = 0;
+
+  OneDVelocityIterator x_it(
+    current_velocity.x,
+    kinematics_->getMinX(), kinematics_->getMaxX(),
+    kinematics_->getAccX(), kinematics_->getDecelX(), dt, vx_samples_);
+  OneDVelocityIterator y_it(
+    current_velocity.y,
+    kinematics_->getMinY(), kinematics_->getMaxY(),
+    kinematics_->getAccY(), kinematics_->getDecelY(), dt, vy_samples_);
+  OneDVelocityIterator th_it(
+    current_velocity.theta,
+    kinematics_->getMinTheta(), kinematics_->getMaxTheta(),
+    kinematics_->getAccTheta(), kinematics_->getDecelTheta(),
+    dt, vtheta_samples_);
+
+  // The coarse grid is what XYThetaIterator would give for the coarse sample counts
+  std::vector<double> values[3];
+  OneDVelocityIterator * its[3] = {&x_it, &y_it, &th_it};
+  int samples[3] = {vx_samples_, vy_samples_, vtheta_samples_};
+  for (int d = 0; d < 3; d++) {
+    for (; !its[d]->isFinished(); ++(*its[d])) {
+      values[d].push_back(its[d]->getVelocity());
+    }
+    min_[d] = values[d].front();
+    max_[d] = values[d].back();
+    step_[d] = (max_[d] - min_[d]) / std::max(1, std::max(2, samples[d]) - 1);
+  }
+
+  for (double x : values[0]) {
+    for (double y : values[1]) {
+      for (double theta : values[2]) {
+        addTwist(x, y, theta);
+      }
+    }
+  }
+}
+
+bool CoarseToFineIterator::hasMoreTwists()
+{
+  // The next round needs the scores of every twist before it
+  while (next_twist_ == twists_.size() && scores_.size() == twists_.size() &&
+    round_ < refine_iterations_)
+  {
+    round_++;
+    startRefinement();
+  }
+  return next_twist_ < twists_.size();
+}
+
+nav_2d_msgs::msg::Twist2D CoarseToFineIterator::nextTwist()
+{
+  return twists_[next_twist_++];
+}
+
+void CoarseToFineIterator::reportScore(const nav_2d_msgs::msg::Twist2D & twist, double score)
+{
+  scores_.emplace_back(score, twist);
+}
+
+void CoarseToFineIterator::startRefinement()
+{
+  std::vector<std::pair<double, nav_2d_msgs::msg::Twist2D>> best;
+  for (const auto & score : scores_) {
+    if (std::isfinite(score.first)) {
+      best.push_back(score);
+    }
+  }
+  auto by_score = [](
+    const std::pair<double, nav_2d_msgs::msg::Twist2D> & a,
+    const std::pair<double, nav_2d_msgs::msg::Twist2D> & b) {return a.first < b.first;};
+  size_t count = std::min(best.size(), static_cast<size_t>(std::max(0, refine_best_)));
+  std::partial_sort(best.begin(), best.begin() + count, best.end(), by_score);
+
+  double scale = 1.0 / (1 << round_);
+  for (size_t i = 0; i < count; i++) {
+    const nav_2d_msgs::msg::Twist2D & center = best[i].second;
+    for (int dx = -1; dx <= 1; dx++) {
+      for (int dy = -1; dy <= 1; dy++) {
+        for (int dtheta = -1; dtheta <= 1; dtheta++) {
+          addTwist(
+            center.x + dx * step_[0] * scale, center.y + dy * step_[1] * scale,
+            center.theta + dtheta * step_[2] * scale);
+        }
+      }
+    }
+  }
+}
+
+void CoarseToFineIterator::addTwist(double x, double y, double theta)
+{
+  double twist[3] = {x, y, theta};
+  for (int d = 0; d < 3; d++) {
+    if (twist[d] < min_[d] - EPSILON || twist[d] > max_[d] + EPSILON) {
+      return;
+    }
+  }
+  if (!kinematics_->isValidSpeed(x, y, theta)) {
+    return;
+  }
+  for (const nav_2d_msgs::msg::Twist2D & other : twists_) {
+    if (fabs(other.x - x) < EPSILON && fabs(other.y - y) < EPSILON &&
+      fabs(other.theta - theta) < EPSILON)
+    {
+      return;
+    }
+  }
+  nav_2d_msgs::msg::Twist2D velocity;
+  velocity.x = x;
+  velocity.y = y;
+  velocity.theta = theta;
+  twists_.push_back(velocity);
+}
+
+}  // namespace dwb_plugins
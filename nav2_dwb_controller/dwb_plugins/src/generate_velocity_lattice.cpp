@@ -0,0 +1,71 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Precomputes the velocity lattice of a controller's trajectory generator and writes it to
+// the file given, for its velocity_lattice_file parameter. Run it with the parameters of
+// the controller, under its node name:
+//
+//   ros2 run dwb_plugins generate_velocity_lattice lattice.bin --ros-args
+//     -r __node:=controller_server --params-file nav2_params.yaml -p plugin_name:=FollowPath
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "dwb_plugins/limited_accel_generator.hpp"
+#include "dwb_plugins/standard_traj_generator.hpp"
+#include "nav2_util/lifecycle_node.hpp"
+#include "nav2_util/node_utils.hpp"
+#include "rclcpp/rclcpp.hpp"
+
+int main(int argc, char ** argv)
+{
+  std::vector<std::string> args = rclcpp::init_and_remove_ros_arguments(argc, argv);
+  if (args.size() != 2) {
+    fprintf(stderr, "Usage: generate_velocity_lattice <file> [--ros-args ...]\n");
+    return 1;
+  }
+
+  auto node = std::make_shared<nav2_util::LifecycleNode>("controller_server");
+  nav2_util::declare_parameter_if_not_declared(
+    node, "plugin_name", rclcpp::ParameterValue("FollowPath"));
+  std::string plugin_name = node->get_parameter("plugin_name").as_string();
+  nav2_util::declare_parameter_if_not_declared(
+    node, plugin_name + ".trajectory_generator_name",
+    rclcpp::ParameterValue("dwb_plugins::StandardTrajectoryGenerator"));
+  std::string generator_name =
+    node->get_parameter(plugin_name + ".trajectory_generator_name").as_string();
+
+  std::shared_ptr<dwb_plugins::StandardTrajectoryGenerator> generator;
+  if (generator_name == "dwb_plugins::LimitedAccelGenerator") {
+    generator = std::make_shared<dwb_plugins::LimitedAccelGenerator>();
+  } else if (generator_name == "dwb_plugins::StandardTrajectoryGenerator") {
+    generator = std::make_shared<dwb_plugins::StandardTrajectoryGenerator>();
+  } else {
+    fprintf(stderr, "%s has no velocity lattice\n", generator_name.c_str());
+    return 1;
+  }
+  generator->initialize(node, plugin_name);
+
+  bool written = generator->writeVelocityLattice(args[1]);
+  if (!written) {
+    fprintf(
+      stderr, "Could not write %s, velocity_lattice_resolution and "
+      "velocity_lattice_angular_resolution of %s have to be set\n",
+      args[1].c_str(), plugin_name.c_str());
+  }
+  rclcpp::shutdown();
+  return written ? 0 : 1;
+}
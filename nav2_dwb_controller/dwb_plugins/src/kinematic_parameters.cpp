@@ -171,7 +171,12 @@ KinematicParameters::on_parameter_event_callback(
         decel_lim_y_ = value.double_value;
       } else if (name == plugin_name_ + ".decel_lim_theta") {
         decel_lim_theta_ = value.double_value;
+      } else {
+        continue;
       }
+      min_speed_xy_sq_ = min_speed_xy_ * min_speed_xy_;
+      max_speed_xy_sq_ = max_speed_xy_ * max_speed_xy_;
+      version_++;
     }
   }
 }
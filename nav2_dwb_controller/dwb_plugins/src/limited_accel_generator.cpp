@@ -69,7 +69,7 @@ void LimitedAccelGenerator::initialize(
   }
 }
 
-void LimitedAccelGenerator::startNewIteration(const nav_2d_msgs::msg::Twist2D & current_velocity)
+void LimitedAccelGenerator::startIterator(const nav_2d_msgs::msg::Twist2D & current_velocity)
 {
   // Limit our search space to just those within the limited acceleration_time
   velocity_iterator_->startNewIteration(current_velocity, acceleration_time_);
@@ -83,6 +83,14 @@ nav_2d_msgs::msg::Twist2D LimitedAccelGenerator::computeNewVelocity(
   return cmd_vel;
 }
 
+std::vector<double> LimitedAccelGenerator::getLatticeParameters()
+{
+  // trajectories are at cmd_vel throughout, unlike those of the StandardTrajectoryGenerator
+  std::vector<double> parameters = StandardTrajectoryGenerator::getLatticeParameters();
+  parameters.push_back(1.0);
+  return parameters;
+}
+
 }  // namespace dwb_plugins
 
 PLUGINLIB_EXPORT_CLASS(dwb_plugins::LimitedAccelGenerator, dwb_core::TrajectoryGenerator)
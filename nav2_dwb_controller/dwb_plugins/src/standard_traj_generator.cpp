@@ -36,8 +36,13 @@
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
 #include <memory>
 #include "dwb_plugins/xy_theta_iterator.hpp"
+#include "dwb_plugins/coarse_to_fine_iterator.hpp"
 #include "nav_2d_utils/parameters.hpp"
 #include "pluginlib/class_list_macros.hpp"
 #include "dwb_core/exceptions.hpp"
@@ -76,6 +81,21 @@ void StandardTrajectoryGenerator::initialize(
   nav2_util::declare_parameter_if_not_declared(
     nh,
     plugin_name + ".include_last_point", rclcpp::ParameterValue(true));
+  nav2_util::declare_parameter_if_not_declared(
+    nh,
+    plugin_name + ".analytic_rollout", rclcpp::ParameterValue(false));
+  nav2_util::declare_parameter_if_not_declared(
+    nh,
+    plugin_name + ".velocity_lattice_resolution", rclcpp::ParameterValue(0.0));
+  nav2_util::declare_parameter_if_not_declared(
+    nh,
+    plugin_name + ".velocity_lattice_angular_resolution", rclcpp::ParameterValue(0.0));
+  nav2_util::declare_parameter_if_not_declared(
+    nh,
+    plugin_name + ".velocity_lattice_size", rclcpp::ParameterValue(64));
+  nav2_util::declare_parameter_if_not_declared(
+    nh,
+    plugin_name + ".velocity_lattice_file", rclcpp::ParameterValue(""));
 
   /*
    * If discretize_by_time, then sim_granularity represents the amount of time that should be between
@@ -91,21 +111,365 @@ void StandardTrajectoryGenerator::initialize(
   nh->get_parameter(plugin_name + ".linear_granularity", linear_granularity_);
   nh->get_parameter(plugin_name + ".angular_granularity", angular_granularity_);
   nh->get_parameter(plugin_name + ".include_last_point", include_last_point_);
+  nh->get_parameter(plugin_name + ".analytic_rollout", analytic_rollout_);
+  nh->get_parameter(plugin_name + ".velocity_lattice_resolution", lattice_resolution_);
+  nh->get_parameter(
+    plugin_name + ".velocity_lattice_angular_resolution", lattice_angular_resolution_);
+  nh->get_parameter(plugin_name + ".velocity_lattice_size", lattice_size_);
+  nh->get_parameter(plugin_name + ".velocity_lattice_file", lattice_file_);
+
+  lattice_.clear();
+  lattice_file_entries_ = 0;
+  current_entry_ = nullptr;
+  lattice_cycle_ = 0;
+  lattice_kinematics_version_ = kinematics_->getVersion();
+  lattice_iterator_version_ = velocity_iterator_->getVersion();
+
+  if (!lattice_file_.empty() && lattice_resolution_ > 0.0 && lattice_angular_resolution_ > 0.0) {
+    if (readVelocityLattice(lattice_file_)) {
+      RCLCPP_INFO(
+        rclcpp::get_logger("StandardTrajectoryGenerator"),
+        "Loaded %zu buckets of the velocity lattice from %s",
+        lattice_file_entries_, lattice_file_.c_str());
+    } else {
+      RCLCPP_WARN(
+        rclcpp::get_logger("StandardTrajectoryGenerator"),
+        "Could not load the velocity lattice from %s, it was written with other parameters "
+        "or can't be read. Its buckets will be rolled out as they are used.",
+        lattice_file_.c_str());
+    }
+  }
 }
 
 void StandardTrajectoryGenerator::initializeIterator(
   const nav2_util::LifecycleNode::SharedPtr & nh)
 {
-  velocity_iterator_ = std::make_shared<XYThetaIterator>();
+  nav2_util::declare_parameter_if_not_declared(
+    nh,
+    plugin_name_ + ".velocity_iterator", rclcpp::ParameterValue("XYThetaIterator"));
+  std::string iterator_name;
+  nh->get_parameter(plugin_name_ + ".velocity_iterator", iterator_name);
+
+  if (iterator_name == "CoarseToFineIterator") {
+    velocity_iterator_ = std::make_shared<CoarseToFineIterator>();
+  } else {
+    if (iterator_name != "XYThetaIterator") {
+      RCLCPP_WARN(
+        rclcpp::get_logger("StandardTrajectoryGenerator"),
+        "Unknown velocity_iterator %s, using XYThetaIterator", iterator_name.c_str());
+    }
+    velocity_iterator_ = std::make_shared<XYThetaIterator>();
+  }
   velocity_iterator_->initialize(nh, kinematics_, plugin_name_);
 }
 
 void StandardTrajectoryGenerator::startNewIteration(
   const nav_2d_msgs::msg::Twist2D & current_velocity)
+{
+  if (lattice_resolution_ > 0.0 && lattice_angular_resolution_ > 0.0) {
+    startLatticeIteration(current_velocity);
+    return;
+  }
+  startIterator(current_velocity);
+}
+
+void StandardTrajectoryGenerator::startIterator(
+  const nav_2d_msgs::msg::Twist2D & current_velocity)
 {
   velocity_iterator_->startNewIteration(current_velocity, sim_time_);
 }
 
+StandardTrajectoryGenerator::LatticeKey StandardTrajectoryGenerator::getLatticeKey(
+  const nav_2d_msgs::msg::Twist2D & velocity) const
+{
+  return LatticeKey(
+    std::lround(velocity.x / lattice_resolution_),
+    std::lround(velocity.y / lattice_resolution_),
+    std::lround(velocity.theta / lattice_angular_resolution_));
+}
+
+nav_2d_msgs::msg::Twist2D StandardTrajectoryGenerator::getBucketVelocity(
+  const LatticeKey & key) const
+{
+  nav_2d_msgs::msg::Twist2D velocity;
+  velocity.x = std::get<0>(key) * lattice_resolution_;
+  velocity.y = std::get<1>(key) * lattice_resolution_;
+  velocity.theta = std::get<2>(key) * lattice_angular_resolution_;
+  return velocity;
+}
+
+StandardTrajectoryGenerator::LatticeEntry & StandardTrajectoryGenerator::buildLatticeEntry(
+  const LatticeKey & key)
+{
+  // Roll out everything the iterator samples without scores, the twists of a
+  // later round of the CoarseToFineIterator are rolled out as they come
+  LatticeEntry & entry = lattice_[key];
+  nav_2d_msgs::msg::Twist2D bucket_velocity = getBucketVelocity(key);
+  geometry_msgs::msg::Pose2D origin;
+  startIterator(bucket_velocity);
+  while (velocity_iterator_->hasMoreTwists()) {
+    nav_2d_msgs::msg::Twist2D twist = velocity_iterator_->nextTwist();
+    rolloutInto(
+      origin, bucket_velocity, twist,
+      entry.trajectories[std::make_tuple(twist.x, twist.y, twist.theta)]);
+  }
+  return entry;
+}
+
+void StandardTrajectoryGenerator::startLatticeIteration(
+  const nav_2d_msgs::msg::Twist2D & current_velocity)
+{
+  if (kinematics_->getVersion() != lattice_kinematics_version_ ||
+    velocity_iterator_->getVersion() != lattice_iterator_version_)
+  {
+    if (lattice_file_entries_ > 0) {
+      RCLCPP_WARN(
+        rclcpp::get_logger("StandardTrajectoryGenerator"),
+        "The sampling parameters changed, dropping the velocity lattice loaded from %s",
+        lattice_file_.c_str());
+    }
+    lattice_.clear();
+    lattice_file_entries_ = 0;
+    lattice_kinematics_version_ = kinematics_->getVersion();
+    lattice_iterator_version_ = velocity_iterator_->getVersion();
+  }
+
+  current_entry_ = nullptr;
+  current_key_ = getLatticeKey(current_velocity);
+
+  auto entry = lattice_.find(current_key_);
+  if (entry == lattice_.end()) {
+    if (lattice_.size() - lattice_file_entries_ >=
+      static_cast<size_t>(std::max(lattice_size_, 1)))
+    {
+      auto oldest = lattice_.end();
+      for (auto it = lattice_.begin(); it != lattice_.end(); ++it) {
+        if (!it->second.from_file &&
+          (oldest == lattice_.end() || it->second.last_used < oldest->second.last_used))
+        {
+          oldest = it;
+        }
+      }
+      lattice_.erase(oldest);
+    }
+    buildLatticeEntry(current_key_);
+    entry = lattice_.find(current_key_);
+  }
+  entry->second.last_used = lattice_cycle_++;
+  current_entry_ = &entry->second;
+
+  startIterator(getBucketVelocity(current_key_));
+}
+
+std::vector<double> StandardTrajectoryGenerator::getLatticeParameters()
+{
+  return {
+    lattice_resolution_, lattice_angular_resolution_,
+    sim_time_, static_cast<double>(discretize_by_time_), time_granularity_,
+    linear_granularity_, angular_granularity_, static_cast<double>(include_last_point_),
+    kinematics_->getAccX(), kinematics_->getDecelX(),
+    kinematics_->getAccY(), kinematics_->getDecelY(),
+    kinematics_->getAccTheta(), kinematics_->getDecelTheta()};
+}
+
+/*
+ * Lattice files are in the byte order of the machine that wrote them:
+ *   "DWBL", uint32 version, uint32 count and that many double parameters,
+ *   uint32 number of buckets, then for each bucket
+ *     int32 x, y and theta keys, uint32 number of trajectories, then for each trajectory
+ *       double twist x, y and theta,
+ *       uint32 number of poses and float x, y and theta of each, relative to the origin,
+ *       uint32 number of time offsets and float seconds of each
+ */
+namespace
+{
+const char LATTICE_MAGIC[4] = {'D', 'W', 'B', 'L'};
+const uint32_t LATTICE_VERSION = 1;
+
+template<typename T>
+void writeValue(std::ofstream & out, T value)
+{
+  out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template<typename T>
+bool readValue(std::ifstream & in, T & value)
+{
+  return static_cast<bool>(in.read(reinterpret_cast<char *>(&value), sizeof(T)));
+}
+}  // namespace
+
+bool StandardTrajectoryGenerator::writeVelocityLattice(const std::string & filename)
+{
+  if (lattice_resolution_ <= 0.0 || lattice_angular_resolution_ <= 0.0) {
+    return false;
+  }
+
+  // every bucket a current velocity within the limits can fall in
+  nav_2d_msgs::msg::Twist2D min_velocity, max_velocity;
+  min_velocity.x = kinematics_->getMinX();
+  min_velocity.y = kinematics_->getMinY();
+  min_velocity.theta = kinematics_->getMinTheta();
+  max_velocity.x = kinematics_->getMaxX();
+  max_velocity.y = kinematics_->getMaxY();
+  max_velocity.theta = kinematics_->getMaxTheta();
+  LatticeKey low = getLatticeKey(min_velocity);
+  LatticeKey high = getLatticeKey(max_velocity);
+  lattice_.clear();
+  lattice_file_entries_ = 0;
+  current_entry_ = nullptr;
+  for (long x = std::get<0>(low); x <= std::get<0>(high); x++) {
+    for (long y = std::get<1>(low); y <= std::get<1>(high); y++) {
+      for (long theta = std::get<2>(low); theta <= std::get<2>(high); theta++) {
+        buildLatticeEntry(LatticeKey(x, y, theta));
+      }
+    }
+  }
+
+  std::ofstream out(filename, std::ios::binary);
+  if (!out) {
+    return false;
+  }
+  std::vector<double> parameters = getLatticeParameters();
+  out.write(LATTICE_MAGIC, sizeof(LATTICE_MAGIC));
+  writeValue(out, LATTICE_VERSION);
+  writeValue(out, static_cast<uint32_t>(parameters.size()));
+  for (double parameter : parameters) {
+    writeValue(out, parameter);
+  }
+
+  writeValue(out, static_cast<uint32_t>(lattice_.size()));
+  for (const auto & entry : lattice_) {
+    writeValue(out, static_cast<int32_t>(std::get<0>(entry.first)));
+    writeValue(out, static_cast<int32_t>(std::get<1>(entry.first)));
+    writeValue(out, static_cast<int32_t>(std::get<2>(entry.first)));
+    writeValue(out, static_cast<uint32_t>(entry.second.trajectories.size()));
+    for (const auto & trajectory : entry.second.trajectories) {
+      writeValue(out, std::get<0>(trajectory.first));
+      writeValue(out, std::get<1>(trajectory.first));
+      writeValue(out, std::get<2>(trajectory.first));
+      const dwb_msgs::msg::Trajectory2D & traj = trajectory.second;
+      writeValue(out, static_cast<uint32_t>(traj.poses.size()));
+      for (const auto & pose : traj.poses) {
+        writeValue(out, static_cast<float>(pose.x));
+        writeValue(out, static_cast<float>(pose.y));
+        writeValue(out, static_cast<float>(pose.theta));
+      }
+      writeValue(out, static_cast<uint32_t>(traj.time_offsets.size()));
+      for (const auto & offset : traj.time_offsets) {
+        writeValue(out, static_cast<float>(rclcpp::Duration(offset).seconds()));
+      }
+    }
+  }
+  return static_cast<bool>(out);
+}
+
+bool StandardTrajectoryGenerator::readVelocityLattice(const std::string & filename)
+{
+  std::ifstream in(filename, std::ios::binary);
+  char magic[sizeof(LATTICE_MAGIC)];
+  uint32_t version, count;
+  if (!in.read(magic, sizeof(magic)) || memcmp(magic, LATTICE_MAGIC, sizeof(magic)) != 0 ||
+    !readValue(in, version) || version != LATTICE_VERSION || !readValue(in, count))
+  {
+    return false;
+  }
+  std::vector<double> parameters(count);
+  for (double & parameter : parameters) {
+    if (!readValue(in, parameter)) {
+      return false;
+    }
+  }
+  if (parameters != getLatticeParameters()) {
+    return false;
+  }
+
+  // read into a lattice of its own, so a truncated file leaves nothing behind
+  std::map<LatticeKey, LatticeEntry> lattice;
+  uint32_t num_entries;
+  if (!readValue(in, num_entries)) {
+    return false;
+  }
+  for (uint32_t i = 0; i < num_entries; i++) {
+    int32_t x, y, theta;
+    uint32_t num_trajectories;
+    if (!readValue(in, x) || !readValue(in, y) || !readValue(in, theta) ||
+      !readValue(in, num_trajectories))
+    {
+      return false;
+    }
+    LatticeEntry & entry = lattice[LatticeKey(x, y, theta)];
+    entry.from_file = true;
+    for (uint32_t j = 0; j < num_trajectories; j++) {
+      nav_2d_msgs::msg::Twist2D twist;
+      uint32_t num_poses, num_offsets;
+      if (!readValue(in, twist.x) || !readValue(in, twist.y) || !readValue(in, twist.theta) ||
+        !readValue(in, num_poses))
+      {
+        return false;
+      }
+      dwb_msgs::msg::Trajectory2D & traj =
+        entry.trajectories[std::make_tuple(twist.x, twist.y, twist.theta)];
+      traj.velocity = twist;
+      traj.poses.resize(num_poses);
+      for (auto & pose : traj.poses) {
+        float pose_x, pose_y, pose_theta;
+        if (!readValue(in, pose_x) || !readValue(in, pose_y) || !readValue(in, pose_theta)) {
+          return false;
+        }
+        pose.x = pose_x;
+        pose.y = pose_y;
+        pose.theta = pose_theta;
+      }
+      if (!readValue(in, num_offsets)) {
+        return false;
+      }
+      traj.time_offsets.reserve(num_offsets);
+      for (uint32_t k = 0; k < num_offsets; k++) {
+        float seconds;
+        if (!readValue(in, seconds)) {
+          return false;
+        }
+        traj.time_offsets.push_back(rclcpp::Duration::from_seconds(seconds));
+      }
+    }
+  }
+
+  lattice_ = std::move(lattice);
+  lattice_file_entries_ = lattice_.size();
+  current_entry_ = nullptr;
+  return true;
+}
+
+bool StandardTrajectoryGenerator::getLatticeTrajectory(
+  const geometry_msgs::msg::Pose2D & start_pose,
+  const nav_2d_msgs::msg::Twist2D & start_vel,
+  const nav_2d_msgs::msg::Twist2D & cmd_vel,
+  dwb_msgs::msg::Trajectory2D & traj) const
+{
+  if (current_entry_ == nullptr || getLatticeKey(start_vel) != current_key_) {
+    return false;
+  }
+  auto found = current_entry_->trajectories.find(
+    std::make_tuple(cmd_vel.x, cmd_vel.y, cmd_vel.theta));
+  if (found == current_entry_->trajectories.end()) {
+    return false;
+  }
+
+  const dwb_msgs::msg::Trajectory2D & lattice_traj = found->second;
+  double c = cos(start_pose.theta);
+  double s = sin(start_pose.theta);
+  traj.poses.resize(lattice_traj.poses.size());
+  for (size_t i = 0; i < lattice_traj.poses.size(); i++) {
+    const geometry_msgs::msg::Pose2D & pose = lattice_traj.poses[i];
+    traj.poses[i].x = start_pose.x + c * pose.x - s * pose.y;
+    traj.poses[i].y = start_pose.y + s * pose.x + c * pose.y;
+    traj.poses[i].theta = start_pose.theta + pose.theta;
+  }
+  traj.time_offsets = lattice_traj.time_offsets;
+  return true;
+}
+
 bool StandardTrajectoryGenerator::hasMoreTwists()
 {
   return velocity_iterator_->hasMoreTwists();
@@ -116,12 +480,42 @@ nav_2d_msgs::msg::Twist2D StandardTrajectoryGenerator::nextTwist()
   return velocity_iterator_->nextTwist();
 }
 
+void StandardTrajectoryGenerator::reportScore(
+  const nav_2d_msgs::msg::Twist2D & cmd_vel,
+  double score)
+{
+  velocity_iterator_->reportScore(cmd_vel, score);
+}
+
+double StandardTrajectoryGenerator::getMaxReach(
+  const nav_2d_msgs::msg::Twist2D & current_velocity)
+{
+  // Every velocity sampled lies within the limits, and the velocity of a trajectory only
+  // ever moves from the current one towards the sampled one, for sim_time in all
+  // The velocity lattice starts from the middle of the bucket, up to half a bucket faster
+  double rounding = lattice_resolution_ > 0.0 && lattice_angular_resolution_ > 0.0 ?
+    lattice_resolution_ / 2 : 0.0;
+  double max_x = std::max(
+    fabs(current_velocity.x) + rounding,
+    std::max(fabs(kinematics_->getMinX()), fabs(kinematics_->getMaxX())));
+  double max_y = std::max(
+    fabs(current_velocity.y) + rounding,
+    std::max(fabs(kinematics_->getMinY()), fabs(kinematics_->getMaxY())));
+  return hypot(max_x, max_y) * sim_time_;
+}
+
 std::vector<double> StandardTrajectoryGenerator::getTimeSteps(
   const nav_2d_msgs::msg::Twist2D & cmd_vel)
 {
-  std::vector<double> steps;
+  int num_steps = getTimeStepCount(cmd_vel);
+  return std::vector<double>(num_steps, sim_time_ / num_steps);
+}
+
+int StandardTrajectoryGenerator::getTimeStepCount(const nav_2d_msgs::msg::Twist2D & cmd_vel) const
+{
+  int num_steps;
   if (discretize_by_time_) {
-    steps.resize(ceil(sim_time_ / time_granularity_));
+    num_steps = ceil(sim_time_ / time_granularity_);
   } else {  // discretize by distance
     double vmag = hypot(cmd_vel.x, cmd_vel.y);
 
@@ -132,17 +526,12 @@ std::vector<double> StandardTrajectoryGenerator::getTimeSteps(
     double projected_angular_distance = fabs(cmd_vel.theta) * sim_time_;
 
     // Pick the maximum of the two
-    int num_steps = ceil(
+    num_steps = ceil(
       std::max(
         projected_linear_distance / linear_granularity_,
         projected_angular_distance / angular_granularity_));
-    steps.resize(num_steps);
   }
-  if (steps.size() == 0) {
-    steps.resize(1);
-  }
-  std::fill(steps.begin(), steps.end(), sim_time_ / steps.size());
-  return steps;
+  return std::max(num_steps, 1);
 }
 
 dwb_msgs::msg::Trajectory2D StandardTrajectoryGenerator::generateTrajectory(
@@ -151,7 +540,37 @@ dwb_msgs::msg::Trajectory2D StandardTrajectoryGenerator::generateTrajectory(
   const nav_2d_msgs::msg::Twist2D & cmd_vel)
 {
   dwb_msgs::msg::Trajectory2D traj;
+  generateTrajectoryInto(start_pose, start_vel, cmd_vel, traj);
+  return traj;
+}
+
+void StandardTrajectoryGenerator::generateTrajectoryInto(
+  const geometry_msgs::msg::Pose2D & start_pose,
+  const nav_2d_msgs::msg::Twist2D & start_vel,
+  const nav_2d_msgs::msg::Twist2D & cmd_vel,
+  dwb_msgs::msg::Trajectory2D & traj)
+{
   traj.velocity = cmd_vel;
+  if (getLatticeTrajectory(start_pose, start_vel, cmd_vel, traj)) {
+    return;
+  }
+  rolloutInto(start_pose, start_vel, cmd_vel, traj);
+}
+
+void StandardTrajectoryGenerator::rolloutInto(
+  const geometry_msgs::msg::Pose2D & start_pose,
+  const nav_2d_msgs::msg::Twist2D & start_vel,
+  const nav_2d_msgs::msg::Twist2D & cmd_vel,
+  dwb_msgs::msg::Trajectory2D & traj)
+{
+  // cleared rather than replaced, so the poses reuse the storage traj already has
+  traj.velocity = cmd_vel;
+  traj.poses.clear();
+  traj.time_offsets.clear();
+  if (analytic_rollout_) {
+    generateArcInto(start_pose, start_vel, cmd_vel, traj);
+    return;
+  }
   //  simulate the trajectory
   geometry_msgs::msg::Pose2D pose = start_pose;
   nav_2d_msgs::msg::Twist2D vel = start_vel;
@@ -174,8 +593,57 @@ dwb_msgs::msg::Trajectory2D StandardTrajectoryGenerator::generateTrajectory(
     traj.poses.push_back(pose);
     traj.time_offsets.push_back(rclcpp::Duration::from_seconds(running_time));
   }
+}
 
-  return traj;
+void StandardTrajectoryGenerator::generateArcInto(
+  const geometry_msgs::msg::Pose2D & start_pose,
+  const nav_2d_msgs::msg::Twist2D & start_vel,
+  const nav_2d_msgs::msg::Twist2D & cmd_vel,
+  dwb_msgs::msg::Trajectory2D & traj)
+{
+  int num_steps = getTimeStepCount(cmd_vel);
+  double dt = sim_time_ / num_steps;
+  traj.poses.reserve(num_steps + 2);
+  traj.time_offsets.reserve(num_steps + 1);
+
+  geometry_msgs::msg::Pose2D pose = start_pose;
+  nav_2d_msgs::msg::Twist2D vel = start_vel;
+  traj.poses.push_back(start_pose);
+  int step = 0;
+
+  // accelerate step by step until the velocity settles on cmd_vel
+  bool settled = false;
+  while (step < num_steps && !settled) {
+    vel = computeNewVelocity(cmd_vel, vel, dt);
+    pose = computeNewPosition(pose, vel, dt);
+    traj.poses.push_back(pose);
+    traj.time_offsets.push_back(rclcpp::Duration::from_seconds(step * dt));
+    step++;
+    settled = vel.x == cmd_vel.x && vel.y == cmd_vel.y && vel.theta == cmd_vel.theta;
+  }
+
+  // then follow the arc, rotating the direction of travel by the same angle every step
+  double step_angle = cmd_vel.theta * dt;
+  double rotate_cos = cos(step_angle);
+  double rotate_sin = sin(step_angle);
+  double heading_cos = cos(pose.theta);
+  double heading_sin = sin(pose.theta);
+  double arc_theta = pose.theta;
+  for (int arc_step = 1; step < num_steps; step++, arc_step++) {
+    pose.x += (cmd_vel.x * heading_cos - cmd_vel.y * heading_sin) * dt;
+    pose.y += (cmd_vel.x * heading_sin + cmd_vel.y * heading_cos) * dt;
+    pose.theta = arc_theta + arc_step * step_angle;
+    double next_cos = heading_cos * rotate_cos - heading_sin * rotate_sin;
+    heading_sin = heading_sin * rotate_cos + heading_cos * rotate_sin;
+    heading_cos = next_cos;
+    traj.poses.push_back(pose);
+    traj.time_offsets.push_back(rclcpp::Duration::from_seconds(step * dt));
+  }
+
+  if (include_last_point_) {
+    traj.poses.push_back(pose);
+    traj.time_offsets.push_back(rclcpp::Duration::from_seconds(num_steps * dt));
+  }
 }
 
 /**
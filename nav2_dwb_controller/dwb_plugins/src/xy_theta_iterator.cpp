@@ -60,6 +60,42 @@ void XYThetaIterator::initialize(
   nh->get_parameter(plugin_name + ".vx_samples", vx_samples_);
   nh->get_parameter(plugin_name + ".vy_samples", vy_samples_);
   nh->get_parameter(plugin_name + ".vtheta_samples", vtheta_samples_);
+
+  // Setup callback for changes to parameters.
+  plugin_name_ = plugin_name;
+  parameters_client_ = std::make_shared<rclcpp::AsyncParametersClient>(
+    nh->get_node_base_interface(),
+    nh->get_node_topics_interface(),
+    nh->get_node_graph_interface(),
+    nh->get_node_services_interface());
+
+  parameter_event_sub_ = parameters_client_->on_parameter_event(
+    std::bind(&XYThetaIterator::on_parameter_event_callback, this, std::placeholders::_1));
+}
+
+void
+XYThetaIterator::on_parameter_event_callback(
+  const rcl_interfaces::msg::ParameterEvent::SharedPtr event)
+{
+  // like the kinematic parameters, the new values are picked up by the next cycle
+  for (auto & changed_parameter : event->changed_parameters) {
+    const auto & type = changed_parameter.value.type;
+    const auto & name = changed_parameter.name;
+    const auto & value = changed_parameter.value;
+
+    if (type == rcl_interfaces::msg::ParameterType::PARAMETER_INTEGER) {
+      if (name == plugin_name_ + ".vx_samples") {
+        vx_samples_ = value.integer_value;
+      } else if (name == plugin_name_ + ".vy_samples") {
+        vy_samples_ = value.integer_value;
+      } else if (name == plugin_name_ + ".vtheta_samples") {
+        vtheta_samples_ = value.integer_value;
+      } else {
+        continue;
+      }
+      version_++;
+    }
+  }
 }
 
 void XYThetaIterator::startNewIteration(
@@ -33,6 +33,8 @@
  */
 
 #include <cmath>
+#include <cstdio>
+#include <limits>
 #include <vector>
 #include <algorithm>
 #include <string>
@@ -140,6 +142,39 @@ TEST(VelocityIterator, standard_gen)
   checkLimits(twists, 0.0, 0.55, -0.1, 0.1, -1.0, 1.0, 0.55, 0.1, 0.4);
 }
 
+TEST(VelocityIterator, coarse_to_fine)
+{
+  auto nh = makeTestNode("coarse_to_fine");
+  nh->set_parameters({rclcpp::Parameter("dwb.velocity_iterator", "CoarseToFineIterator")});
+  StandardTrajectoryGenerator gen;
+  gen.initialize(nh, "dwb");
+
+  // the coarse round covers the whole window, then waits for its scores
+  std::vector<nav_2d_msgs::msg::Twist2D> twists = gen.getTwists(zero);
+  checkLimits(twists, 0.0, 0.55, -0.1, 0.1, -1.0, 1.0, 0.55, 0.1, 0.4);
+  EXPECT_FALSE(gen.hasMoreTwists());
+
+  nav_2d_msgs::msg::Twist2D target;
+  target.x = 0.31;
+  target.y = 0.02;
+  target.theta = -0.37;
+  auto score = [&](const nav_2d_msgs::msg::Twist2D & twist) {
+      return hypot(twist.x - target.x, twist.y - target.y) + fabs(twist.theta - target.theta);
+    };
+  gen.startNewIteration(zero);
+  int count = 0;
+  double best = std::numeric_limits<double>::infinity();
+  while (gen.hasMoreTwists()) {
+    nav_2d_msgs::msg::Twist2D twist = gen.nextTwist();
+    gen.reportScore(twist, score(twist));
+    best = std::min(best, score(twist));
+    count++;
+  }
+  EXPECT_GT(count, static_cast<int>(twists.size()));
+  EXPECT_LT(count, 400);
+  EXPECT_LT(best, 0.05);
+}
+
 TEST(VelocityIterator, max_xy)
 {
   auto nh = makeTestNode("max_xy");
@@ -434,6 +469,160 @@ TEST(TrajectoryGenerator, dwa)
   matchPose(res.poses[5], 1.5, 0, 0);
 }
 
+TEST(TrajectoryGenerator, into_existing)
+{
+  auto nh = makeTestNode("into_existing");
+  StandardTrajectoryGenerator gen;
+  nh->set_parameters({rclcpp::Parameter("dwb.linear_granularity", 0.1)});
+  gen.initialize(nh, "dwb");
+  dwb_msgs::msg::Trajectory2D long_traj = gen.generateTrajectory(origin, forward, forward);
+
+  // a shorter trajectory overwrites all of a longer one
+  nav_2d_msgs::msg::Twist2D slow;
+  slow.x = 0.1;
+  dwb_msgs::msg::Trajectory2D res = long_traj;
+  gen.generateTrajectoryInto(origin, slow, slow, res);
+  dwb_msgs::msg::Trajectory2D expected = gen.generateTrajectory(origin, slow, slow);
+  matchTwist(res.velocity, slow);
+  ASSERT_EQ(res.poses.size(), expected.poses.size());
+  ASSERT_EQ(res.time_offsets.size(), expected.time_offsets.size());
+  EXPECT_LT(res.poses.size(), long_traj.poses.size());
+  for (unsigned int i = 0; i < res.poses.size(); i++) {
+    matchPose(res.poses[i], expected.poses[i]);
+    EXPECT_DOUBLE_EQ(durationToSec(res.time_offsets[i]), durationToSec(expected.time_offsets[i]));
+  }
+}
+
+TEST(TrajectoryGenerator, analytic_rollout)
+{
+  auto nh = makeTestNode("analytic_rollout");
+  nh->set_parameters({rclcpp::Parameter("dwb.sim_time", 3.0)});
+  nh->set_parameters({rclcpp::Parameter("dwb.linear_granularity", 0.05)});
+  nh->set_parameters({rclcpp::Parameter("dwb.acc_lim_x", 0.1)});
+  StandardTrajectoryGenerator stepped;
+  stepped.initialize(nh, "dwb");
+  nh->set_parameters({rclcpp::Parameter("dwb.analytic_rollout", true)});
+  StandardTrajectoryGenerator analytic;
+  analytic.initialize(nh, "dwb");
+
+  geometry_msgs::msg::Pose2D start;
+  start.x = 1.0;
+  start.y = 2.0;
+  start.theta = 0.7;
+  nav_2d_msgs::msg::Twist2D cmd;
+  cmd.x = 0.4;
+  cmd.y = -0.1;
+  cmd.theta = 0.5;
+  // both at constant twist and accelerating towards it first
+  for (const nav_2d_msgs::msg::Twist2D & start_vel : {cmd, forward}) {
+    dwb_msgs::msg::Trajectory2D expected = stepped.generateTrajectory(start, start_vel, cmd);
+    dwb_msgs::msg::Trajectory2D res = analytic.generateTrajectory(start, start_vel, cmd);
+    ASSERT_EQ(res.poses.size(), expected.poses.size());
+    ASSERT_EQ(res.time_offsets.size(), expected.time_offsets.size());
+    for (unsigned int i = 0; i < res.poses.size(); i++) {
+      EXPECT_NEAR(res.poses[i].x, expected.poses[i].x, 1e-9);
+      EXPECT_NEAR(res.poses[i].y, expected.poses[i].y, 1e-9);
+      EXPECT_NEAR(res.poses[i].theta, expected.poses[i].theta, 1e-9);
+    }
+    for (unsigned int i = 0; i < res.time_offsets.size(); i++) {
+      EXPECT_NEAR(
+        durationToSec(res.time_offsets[i]), durationToSec(expected.time_offsets[i]), 1e-6);
+    }
+  }
+}
+
+TEST(TrajectoryGenerator, velocity_lattice)
+{
+  auto nh = makeTestNode("velocity_lattice");
+  StandardTrajectoryGenerator plain;
+  plain.initialize(nh, "dwb");
+  nh->set_parameters({rclcpp::Parameter("dwb.velocity_lattice_resolution", 0.05)});
+  nh->set_parameters({rclcpp::Parameter("dwb.velocity_lattice_angular_resolution", 0.1)});
+  StandardTrajectoryGenerator lattice;
+  lattice.initialize(nh, "dwb");
+
+  geometry_msgs::msg::Pose2D start;
+  start.x = 1.0;
+  start.y = 2.0;
+  start.theta = 0.7;
+
+  // the lattice samples and rolls out from the middle of the bucket
+  nav_2d_msgs::msg::Twist2D current;
+  current.x = 0.31;
+  current.theta = 0.04;
+  nav_2d_msgs::msg::Twist2D bucket;
+  bucket.x = 6 * 0.05;
+
+  // twice, the second time from the entry built the first time
+  for (int cycle = 0; cycle < 2; cycle++) {
+    plain.startNewIteration(bucket);
+    lattice.startNewIteration(current);
+    while (plain.hasMoreTwists()) {
+      ASSERT_TRUE(lattice.hasMoreTwists());
+      nav_2d_msgs::msg::Twist2D twist = plain.nextTwist();
+      matchTwist(lattice.nextTwist(), twist);
+
+      dwb_msgs::msg::Trajectory2D expected = plain.generateTrajectory(start, bucket, twist);
+      dwb_msgs::msg::Trajectory2D res = lattice.generateTrajectory(start, current, twist);
+      ASSERT_EQ(res.poses.size(), expected.poses.size());
+      ASSERT_EQ(res.time_offsets.size(), expected.time_offsets.size());
+      for (unsigned int i = 0; i < res.poses.size(); i++) {
+        EXPECT_NEAR(res.poses[i].x, expected.poses[i].x, 1e-9);
+        EXPECT_NEAR(res.poses[i].y, expected.poses[i].y, 1e-9);
+        EXPECT_NEAR(res.poses[i].theta, expected.poses[i].theta, 1e-9);
+      }
+    }
+    EXPECT_FALSE(lattice.hasMoreTwists());
+  }
+}
+
+TEST(TrajectoryGenerator, velocity_lattice_file)
+{
+  auto nh = makeTestNode("velocity_lattice_file");
+  nh->set_parameters({rclcpp::Parameter("dwb.velocity_lattice_resolution", 0.05)});
+  nh->set_parameters({rclcpp::Parameter("dwb.velocity_lattice_angular_resolution", 0.1)});
+  StandardTrajectoryGenerator lattice;
+  lattice.initialize(nh, "dwb");
+  std::string filename = "/tmp/velocity_lattice_file_test.bin";
+  ASSERT_TRUE(lattice.writeVelocityLattice(filename));
+
+  nh->set_parameters({rclcpp::Parameter("dwb.velocity_lattice_file", filename)});
+  // a single bucket beyond those loaded, which are never evicted
+  nh->set_parameters({rclcpp::Parameter("dwb.velocity_lattice_size", 1)});
+  StandardTrajectoryGenerator loaded;
+  loaded.initialize(nh, "dwb");
+
+  geometry_msgs::msg::Pose2D start;
+  start.x = -1.0;
+  start.y = 0.5;
+  start.theta = -2.0;
+  for (double x : {0.0, 0.22, 0.55}) {
+    nav_2d_msgs::msg::Twist2D current;
+    current.x = x;
+    current.theta = -0.33;
+    lattice.startNewIteration(current);
+    loaded.startNewIteration(current);
+    while (lattice.hasMoreTwists()) {
+      ASSERT_TRUE(loaded.hasMoreTwists());
+      nav_2d_msgs::msg::Twist2D twist = lattice.nextTwist();
+      matchTwist(loaded.nextTwist(), twist);
+
+      dwb_msgs::msg::Trajectory2D expected = lattice.generateTrajectory(start, current, twist);
+      dwb_msgs::msg::Trajectory2D res = loaded.generateTrajectory(start, current, twist);
+      ASSERT_EQ(res.poses.size(), expected.poses.size());
+      ASSERT_EQ(res.time_offsets.size(), expected.time_offsets.size());
+      // poses are stored as floats
+      for (unsigned int i = 0; i < res.poses.size(); i++) {
+        EXPECT_NEAR(res.poses[i].x, expected.poses[i].x, 1e-5);
+        EXPECT_NEAR(res.poses[i].y, expected.poses[i].y, 1e-5);
+        EXPECT_NEAR(res.poses[i].theta, expected.poses[i].theta, 1e-5);
+      }
+    }
+    EXPECT_FALSE(loaded.hasMoreTwists());
+  }
+  remove(filename.c_str());
+}
+
 int main(int argc, char ** argv)
 {
   forward.x = 0.3;
@@ -35,13 +35,17 @@
 #ifndef NAV_2D_UTILS__ODOM_SUBSCRIBER_HPP_
 #define NAV_2D_UTILS__ODOM_SUBSCRIBER_HPP_
 
+#include <atomic>
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <mutex>
 #include <string>
 #include "nav_2d_msgs/msg/twist2_d_stamped.hpp"
 #include "nav_msgs/msg/odometry.hpp"
 #include "nav2_util/lifecycle_node.hpp"
+#include "nav2_util/seqlock.hpp"
 #include "rclcpp/rclcpp.hpp"
 #include "nav2_util/node_utils.hpp"
 
@@ -50,7 +54,8 @@ namespace nav_2d_utils
 
 /**
  * @class OdomSubscriber
- * Wrapper for some common odometry operations. Subscribes to the topic with a mutex.
+ * Wrapper for some common odometry operations. The latest twist can be read from any thread
+ * without a lock, and a short history of twists is kept when the odom_history_size param is set.
  */
 class OdomSubscriber
 {
@@ -64,33 +69,127 @@ public:
   explicit OdomSubscriber(
     nav2_util::LifecycleNode::SharedPtr nh,
     std::string default_topic = "odom")
+  : history_size_(0), history_count_(0)
   {
     std::string odom_topic;
     nh->get_parameter_or("odom_topic", odom_topic, default_topic);
+    int history_size;
+    nh->get_parameter_or("odom_history_size", history_size, 0);
+    if (history_size > 0) {
+      history_size_ = static_cast<size_t>(history_size);
+      history_.reset(new nav2_util::SeqLock<Sample>[history_size_]);
+    }
     odom_sub_ =
       nh->create_subscription<nav_msgs::msg::Odometry>(
       odom_topic,
       rclcpp::SystemDefaultsQoS(),
-      std::bind(&OdomSubscriber::odomCallback, this, std::placeholders::_1));
+      std::bind(&OdomSubscriber::odomCallback, this, std::placeholders::_1),
+      nav2_util::get_inter_process_subscription_options());
   }
 
-  inline nav_2d_msgs::msg::Twist2D getTwist() {return odom_vel_.velocity;}
-  inline nav_2d_msgs::msg::Twist2DStamped getTwistStamped() {return odom_vel_;}
+  inline nav_2d_msgs::msg::Twist2D getTwist() const {return latest_.load().twist();}
+
+  inline nav_2d_msgs::msg::Twist2DStamped getTwistStamped() const
+  {
+    const Sample sample = latest_.load();
+    nav_2d_msgs::msg::Twist2DStamped twist;
+    twist.header.stamp = rclcpp::Time(sample.stamp);
+    twist.velocity = sample.twist();
+    std::lock_guard<std::mutex> lock(frame_mutex_);
+    twist.header.frame_id = frame_id_;
+    return twist;
+  }
+
+  /**
+   * @brief The twist at a given time, interpolated between the odometry messages around it
+   *
+   * Times after the latest message get the latest twist.
+   * @return False if the time is older than the history, which spans the last
+   * odom_history_size - 1 messages, or no history is kept
+   */
+  bool getTwistAt(const rclcpp::Time & time, nav_2d_msgs::msg::Twist2D & twist) const
+  {
+    const uint64_t count = history_count_.load(std::memory_order_acquire);
+    if (count == 0) {
+      return false;
+    }
+    const int64_t stamp = time.nanoseconds();
+
+    // The oldest slot may be rewritten while walking back, so it is left out
+    const uint64_t oldest = count > history_size_ - 1 ? count - (history_size_ - 1) : 0;
+    Sample newer = history_[(count - 1) % history_size_].load();
+    if (stamp >= newer.stamp) {
+      twist = newer.twist();
+      return true;
+    }
+    for (uint64_t i = count - 1; i-- > oldest; ) {
+      const Sample older = history_[i % history_size_].load();
+      if (older.stamp > newer.stamp) {
+        // rewritten by newer messages meanwhile
+        break;
+      }
+      if (stamp >= older.stamp) {
+        const double span = static_cast<double>(newer.stamp - older.stamp);
+        const double ratio = span > 0.0 ? (stamp - older.stamp) / span : 1.0;
+        twist.x = older.x + (newer.x - older.x) * ratio;
+        twist.y = older.y + (newer.y - older.y) * ratio;
+        twist.theta = older.theta + (newer.theta - older.theta) * ratio;
+        return true;
+      }
+      newer = older;
+    }
+    return false;
+  }
 
 protected:
+  /// @brief The part of an odometry message kept, trivially copyable for the SeqLock
+  struct Sample
+  {
+    int64_t stamp;  ///< In nanoseconds
+    double x, y, theta;
+
+    nav_2d_msgs::msg::Twist2D twist() const
+    {
+      nav_2d_msgs::msg::Twist2D twist;
+      twist.x = x;
+      twist.y = y;
+      twist.theta = theta;
+      return twist;
+    }
+  };
+
   void odomCallback(const nav_msgs::msg::Odometry::SharedPtr msg)
   {
     // ROS_INFO_ONCE("odom received!");
-    std::lock_guard<std::mutex> lock(odom_mutex_);
-    odom_vel_.header = msg->header;
-    odom_vel_.velocity.x = msg->twist.twist.linear.x;
-    odom_vel_.velocity.y = msg->twist.twist.linear.y;
-    odom_vel_.velocity.theta = msg->twist.twist.angular.z;
+    Sample sample;
+    sample.stamp = rclcpp::Time(msg->header.stamp).nanoseconds();
+    sample.x = msg->twist.twist.linear.x;
+    sample.y = msg->twist.twist.linear.y;
+    sample.theta = msg->twist.twist.angular.z;
+    latest_.store(sample);
+
+    if (msg->header.frame_id != frame_id_) {
+      std::lock_guard<std::mutex> lock(frame_mutex_);
+      frame_id_ = msg->header.frame_id;
+    }
+
+    if (history_size_ > 0) {
+      const uint64_t count = history_count_.load(std::memory_order_relaxed);
+      history_[count % history_size_].store(sample);
+      history_count_.store(count + 1, std::memory_order_release);
+    }
   }
 
   rclcpp::Subscription<nav_msgs::msg::Odometry>::SharedPtr odom_sub_;
-  nav_2d_msgs::msg::Twist2DStamped odom_vel_;
-  std::mutex odom_mutex_;
+  nav2_util::SeqLock<Sample> latest_;
+  // Only changes with the odometry frame, so it stays under a lock
+  std::string frame_id_;
+  mutable std::mutex frame_mutex_;
+
+  // Ring of the latest messages, history_count_ of them written so far
+  std::unique_ptr<nav2_util::SeqLock<Sample>[]> history_;
+  size_t history_size_;
+  std::atomic<uint64_t> history_count_;
 };
 
 }  // namespace nav_2d_utils
@@ -35,10 +35,47 @@
 #ifndef NAV_2D_UTILS__PATH_OPS_HPP_
 #define NAV_2D_UTILS__PATH_OPS_HPP_
 
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
 #include "nav_2d_msgs/msg/path2_d.hpp"
 
 namespace nav_2d_utils
 {
+/**
+ * @class PathSegment
+ * @brief A view of consecutive poses of a plan, which doesn't copy them
+ *
+ * Only valid as long as the poses of the plan aren't added or removed.
+ */
+class PathSegment
+{
+public:
+  using const_iterator = std::vector<geometry_msgs::msg::Pose2D>::const_iterator;
+
+  PathSegment() = default;
+  PathSegment(const_iterator begin, const_iterator end)
+  : begin_(begin), end_(end) {}
+  /**
+   * @brief The poses [first, last) of a plan, clamped to its size
+   */
+  PathSegment(const nav_2d_msgs::msg::Path2D & plan, size_t first, size_t last)
+  : begin_(plan.poses.begin() + std::min(first, plan.poses.size())),
+    end_(plan.poses.begin() + std::min(std::max(first, last), plan.poses.size())) {}
+
+  const_iterator begin() const {return begin_;}
+  const_iterator end() const {return end_;}
+  size_t size() const {return end_ - begin_;}
+  bool empty() const {return begin_ == end_;}
+  const geometry_msgs::msg::Pose2D & operator[](size_t i) const {return begin_[i];}
+  const geometry_msgs::msg::Pose2D & front() const {return *begin_;}
+  const geometry_msgs::msg::Pose2D & back() const {return *(end_ - 1);}
+
+private:
+  const_iterator begin_, end_;
+};
+
 /**
  * @brief Increase plan resolution to match that of the costmap by adding points linearly between points
  *
@@ -49,6 +86,44 @@ namespace nav_2d_utils
 nav_2d_msgs::msg::Path2D adjustPlanResolution(
   const nav_2d_msgs::msg::Path2D & global_plan_in,
   double resolution);
+
+/**
+ * @brief adjustPlanResolution into a plan whose poses are reused, so a plan kept from one call
+ *        to the next doesn't allocate once it has grown to fit
+ */
+void adjustPlanResolution(
+  const nav_2d_msgs::msg::Path2D & global_plan_in,
+  double resolution, nav_2d_msgs::msg::Path2D & global_plan_out);
+
+/**
+ * @brief Remove the poses of the plan behind the robot, in place
+ *
+ * The poses before the one closest to the robot within the first search_distance meters of
+ * the plan are erased. Searching only so far keeps a plan that comes back by the robot from
+ * being cut short.
+ *
+ * @param plan The plan to prune
+ * @param pose The pose of the robot, in the frame of the plan
+ * @param search_distance How far along the plan to look for the closest pose, in meters
+ * @return The number of poses removed
+ */
+size_t prunePlanBehind(
+  nav_2d_msgs::msg::Path2D & plan, const geometry_msgs::msg::Pose2D & pose,
+  double search_distance);
+
+/**
+ * @brief Drop the poses of the plan that the poses around them make redundant, in place
+ *
+ * A pose is kept where the plan turns by more than max_turn radians since the last pose kept,
+ * or where the next pose is more than max_spacing meters from the last pose kept, so straight
+ * stretches are thinned out while the curves keep their poses. The first and last poses are
+ * always kept.
+ *
+ * @param plan The plan to downsample
+ * @param max_spacing The longest distance between poses kept
+ * @param max_turn The largest change of direction between poses kept
+ */
+void downsamplePlan(nav_2d_msgs::msg::Path2D & plan, double max_spacing, double max_turn);
 }  // namespace nav_2d_utils
 
 #endif  // NAV_2D_UTILS__PATH_OPS_HPP_
@@ -143,6 +143,7 @@ nav_2d_msgs::msg::Path2D pathToPath2D(const nav_msgs::msg::Path & path)
 {
   nav_2d_msgs::msg::Path2D path2d;
   path2d.header = path.header;
+  path2d.poses.reserve(path.poses.size());
   for (auto & pose : path.poses) {
     path2d.poses.push_back(poseToPose2D(pose.pose));
   }
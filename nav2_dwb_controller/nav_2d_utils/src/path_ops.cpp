@@ -34,6 +34,8 @@
 
 #include "nav_2d_utils/path_ops.hpp"
 #include <cmath>
+#include <limits>
+#include <vector>
 
 using std::sqrt;
 
@@ -44,8 +46,18 @@ nav_2d_msgs::msg::Path2D adjustPlanResolution(
   double resolution)
 {
   nav_2d_msgs::msg::Path2D global_plan_out;
+  adjustPlanResolution(global_plan_in, resolution, global_plan_out);
+  return global_plan_out;
+}
+
+void adjustPlanResolution(
+  const nav_2d_msgs::msg::Path2D & global_plan_in,
+  double resolution, nav_2d_msgs::msg::Path2D & global_plan_out)
+{
+  global_plan_out.header = global_plan_in.header;
+  global_plan_out.poses.clear();
   if (global_plan_in.poses.size() == 0) {
-    return global_plan_out;
+    return;
   }
 
   geometry_msgs::msg::Pose2D last = global_plan_in.poses[0];
@@ -79,6 +91,57 @@ nav_2d_msgs::msg::Path2D adjustPlanResolution(
     last.x = loop.x;
     last.y = loop.y;
   }
-  return global_plan_out;
+}
+
+size_t prunePlanBehind(
+  nav_2d_msgs::msg::Path2D & plan, const geometry_msgs::msg::Pose2D & pose,
+  double search_distance)
+{
+  if (plan.poses.empty()) {
+    return 0;
+  }
+
+  size_t closest = 0;
+  double closest_sq_dist = std::numeric_limits<double>::max();
+  double length = 0.0;
+  for (size_t i = 0; i < plan.poses.size() && length <= search_distance; ++i) {
+    const geometry_msgs::msg::Pose2D & plan_pose = plan.poses[i];
+    double sq_dist = (plan_pose.x - pose.x) * (plan_pose.x - pose.x) +
+      (plan_pose.y - pose.y) * (plan_pose.y - pose.y);
+    if (sq_dist < closest_sq_dist) {
+      closest_sq_dist = sq_dist;
+      closest = i;
+    }
+    if (i + 1 < plan.poses.size()) {
+      length += std::hypot(plan.poses[i + 1].x - plan_pose.x, plan.poses[i + 1].y - plan_pose.y);
+    }
+  }
+  plan.poses.erase(plan.poses.begin(), plan.poses.begin() + closest);
+  return closest;
+}
+
+void downsamplePlan(nav_2d_msgs::msg::Path2D & plan, double max_spacing, double max_turn)
+{
+  std::vector<geometry_msgs::msg::Pose2D> & poses = plan.poses;
+  if (poses.size() <= 2) {
+    return;
+  }
+
+  double sq_max_spacing = max_spacing * max_spacing;
+  size_t kept = 0;
+  double kept_heading = std::atan2(poses[1].y - poses[0].y, poses[1].x - poses[0].x);
+  for (size_t i = 1; i + 1 < poses.size(); ++i) {
+    const geometry_msgs::msg::Pose2D & next = poses[i + 1];
+    double dx = next.x - poses[kept].x;
+    double dy = next.y - poses[kept].y;
+    double heading = std::atan2(next.y - poses[i].y, next.x - poses[i].x);
+    double turn = std::fabs(std::remainder(heading - kept_heading, 2 * M_PI));
+    if (dx * dx + dy * dy > sq_max_spacing || turn > max_turn) {
+      poses[++kept] = poses[i];
+      kept_heading = heading;
+    }
+  }
+  poses[++kept] = poses.back();
+  poses.resize(kept + 1);
 }
 }  // namespace nav_2d_utils
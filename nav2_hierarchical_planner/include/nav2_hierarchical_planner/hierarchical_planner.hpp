@@ -0,0 +1,113 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_HIERARCHICAL_PLANNER__HIERARCHICAL_PLANNER_HPP_
+#define NAV2_HIERARCHICAL_PLANNER__HIERARCHICAL_PLANNER_HPP_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "geometry_msgs/msg/pose_stamped.hpp"
+#include "nav2_core/global_planner.hpp"
+#include "nav_msgs/msg/path.hpp"
+#include "nav2_hierarchical_planner/region_graph.hpp"
+#include "nav2_navfn_planner/navfn.hpp"
+#include "nav2_util/lifecycle_node.hpp"
+#include "nav2_costmap_2d/costmap_2d_ros.hpp"
+
+namespace nav2_hierarchical_planner
+{
+
+/**
+ * @class HierarchicalPlanner
+ * @brief Global planner that first finds the regions a path has to cross over a
+ * graph of the portals between them, then runs NavFn over those regions only,
+ * so the time taken depends on the route rather than the size of the map.
+ */
+class HierarchicalPlanner : public nav2_core::GlobalPlanner
+{
+public:
+  HierarchicalPlanner();
+  ~HierarchicalPlanner();
+
+  // plugin configure
+  void configure(
+    rclcpp_lifecycle::LifecycleNode::SharedPtr parent,
+    std::string name, std::shared_ptr<tf2_ros::Buffer> tf,
+    std::shared_ptr<nav2_costmap_2d::Costmap2DROS> costmap_ros) override;
+
+  // plugin cleanup
+  void cleanup() override;
+
+  // plugin activate
+  void activate() override;
+
+  // plugin deactivate
+  void deactivate() override;
+
+  // plugin create path
+  nav_msgs::msg::Path createPlan(
+    const geometry_msgs::msg::PoseStamped & start,
+    const geometry_msgs::msg::PoseStamped & goal) override;
+
+protected:
+  // Load the region graph, or build it from the costmap if there's none for
+  // its current size, must hold the costmap lock
+  void updateGraph();
+
+  // Run NavFn over the regions marked in the corridor, must hold the costmap lock
+  bool planInCorridor(
+    const std::vector<char> & corridor,
+    unsigned int start_x, unsigned int start_y,
+    unsigned int goal_x, unsigned int goal_y,
+    nav_msgs::msg::Path & path);
+
+  // Translate a costmap cost into the cost of entering the cell
+  float translateCost(unsigned char cost) const;
+
+  // The portal graph over the costmap's regions
+  RegionGraph graph_;
+
+  // NavFn, sized for the last corridor
+  std::unique_ptr<nav2_navfn_planner::NavFn> navfn_;
+
+  // The costs of the last corridor's bounding box
+  std::vector<unsigned char> window_;
+
+  // node ptr
+  nav2_util::LifecycleNode::SharedPtr node_;
+
+  // Global Costmap
+  nav2_costmap_2d::Costmap2D * costmap_;
+
+  // The global frame of the costmap
+  std::string global_frame_, name_;
+
+  // The side of a region, in cells
+  int region_size_;
+
+  // Where the graph is kept between runs, empty to always build it
+  std::string graph_file_;
+
+  // Whether or not the planner should be allowed to plan through unknown space
+  bool allow_unknown_;
+
+  // Whether to use the A* heuristic within the corridor
+  bool use_astar_;
+};
+
+}  // namespace nav2_hierarchical_planner
+
+#endif  // NAV2_HIERARCHICAL_PLANNER__HIERARCHICAL_PLANNER_HPP_
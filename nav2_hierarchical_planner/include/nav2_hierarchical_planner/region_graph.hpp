@@ -0,0 +1,166 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Abstraction based on:
+// Botea, A., Mueller, M. and Schaeffer, J. (2004). Near Optimal Hierarchical
+// Path-Finding. Journal of Game Development.
+
+#ifndef NAV2_HIERARCHICAL_PLANNER__REGION_GRAPH_HPP_
+#define NAV2_HIERARCHICAL_PLANNER__REGION_GRAPH_HPP_
+
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace nav2_hierarchical_planner
+{
+
+/**
+ * @class RegionGraph
+ * @brief Sparse graph over an 8-connected grid cut into square regions. Its nodes
+ * are portals, one pair of cells per free stretch of the border between two
+ * neighboring regions, joined by the cheapest path within each region. A search
+ * over it gives the regions a path between two cells has to cross, at a cost
+ * that depends on the number of portals rather than the area of the grid.
+ */
+class RegionGraph
+{
+public:
+  /** Cost of a cell that cannot be entered */
+  static constexpr float OBSTACLE = std::numeric_limits<float>::infinity();
+
+  /** Gives the cost of entering the cell at x, y, per cell of distance traveled */
+  typedef std::function<float(unsigned int, unsigned int)> CostFunction;
+
+  RegionGraph();
+
+  /**
+   * @brief  Build the graph, dropping the previous one
+   * @param size_x The x size of the grid in cells
+   * @param size_y The y size of the grid in cells
+   * @param region_size The side of a region in cells
+   * @param min_cost The lowest cost a free cell can have, scales the heuristic
+   * @param cost The cost of each cell, at least min_cost or OBSTACLE
+   */
+  void build(
+    unsigned int size_x, unsigned int size_y, unsigned int region_size,
+    float min_cost, const CostFunction & cost);
+
+  /**
+   * @brief  Write the graph to a file
+   * @return True if it was written
+   */
+  bool save(const std::string & filename) const;
+
+  /**
+   * @brief  Read a graph written by save(), leaving this one as it is on failure
+   * @return True if it was read
+   */
+  bool load(const std::string & filename);
+
+  /**
+   * @brief  Whether the graph was built for a grid of this size and region size
+   */
+  bool matches(unsigned int size_x, unsigned int size_y, unsigned int region_size) const;
+
+  /**
+   * @brief  Find the regions crossed by the cheapest route between two cells. The
+   * start and goal regions are searched with the current costs, the rest of the
+   * route uses the costs the graph was built with.
+   * @param start_x The x coordinate of the start cell
+   * @param start_y The y coordinate of the start cell
+   * @param goal_x The x coordinate of the goal cell
+   * @param goal_y The y coordinate of the goal cell
+   * @param cost The current cost of each cell
+   * @param regions Will be filled with the regions from start to goal
+   * @return True if a route was found
+   */
+  bool findRegions(
+    unsigned int start_x, unsigned int start_y,
+    unsigned int goal_x, unsigned int goal_y,
+    const CostFunction & cost, std::vector<unsigned int> & regions) const;
+
+  /**
+   * @brief  Get the region a cell is in
+   */
+  unsigned int getRegion(unsigned int x, unsigned int y) const
+  {
+    return (y / region_size_) * regions_x_ + x / region_size_;
+  }
+
+  /**
+   * @brief  Get the cells [x0, xn) x [y0, yn) of a region
+   */
+  void getRegionBounds(
+    unsigned int region, unsigned int & x0, unsigned int & y0,
+    unsigned int & xn, unsigned int & yn) const;
+
+  unsigned int getNumRegions() const {return regions_x_ * regions_y_;}
+  size_t getNumNodes() const {return nodes_.size();}
+
+  /**
+   * @brief  Get the number of graph nodes expanded by the last findRegions()
+   */
+  size_t getExpansions() const {return expansions_;}
+
+protected:
+  struct Node
+  {
+    unsigned int x;
+    unsigned int y;
+    unsigned int region;
+  };
+
+  struct Edge
+  {
+    unsigned int to;
+    float cost;
+  };
+
+  // Add a portal between two neighboring cells of different regions
+  void addPortal(
+    unsigned int ax, unsigned int ay, unsigned int bx, unsigned int by,
+    const CostFunction & cost);
+
+  // Get the costs of a region's cells, row by row
+  void getRegionCosts(
+    unsigned int region, const CostFunction & cost, std::vector<float> & costs) const;
+
+  // Cost of reaching every cell of a region from one of its cells, without leaving it
+  void searchRegion(
+    unsigned int region, const std::vector<float> & costs,
+    unsigned int x, unsigned int y, std::vector<float> & dist) const;
+
+  // Index of a cell within its region's arrays
+  unsigned int localIndex(unsigned int region, unsigned int x, unsigned int y) const;
+
+  unsigned int size_x_{0};
+  unsigned int size_y_{0};
+  unsigned int region_size_{1};
+  unsigned int regions_x_{0};
+  unsigned int regions_y_{0};
+  float min_cost_{1.0f};
+
+  std::vector<Node> nodes_;
+  std::vector<std::vector<Edge>> edges_;  // out edges of each node
+  std::vector<std::vector<unsigned int>> region_nodes_;  // nodes of each region
+
+  mutable size_t expansions_{0};
+};
+
+}  // namespace nav2_hierarchical_planner
+
+#endif  // NAV2_HIERARCHICAL_PLANNER__REGION_GRAPH_HPP_
@@ -0,0 +1,288 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_hierarchical_planner/hierarchical_planner.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "nav2_costmap_2d/cost_values.hpp"
+#include "nav2_util/node_utils.hpp"
+
+using nav2_util::declare_parameter_if_not_declared;
+
+namespace nav2_hierarchical_planner
+{
+
+HierarchicalPlanner::HierarchicalPlanner()
+: costmap_(nullptr)
+{
+}
+
+HierarchicalPlanner::~HierarchicalPlanner()
+{
+}
+
+void
+HierarchicalPlanner::configure(
+  rclcpp_lifecycle::LifecycleNode::SharedPtr parent,
+  std::string name, std::shared_ptr<tf2_ros::Buffer>/*tf*/,
+  std::shared_ptr<nav2_costmap_2d::Costmap2DROS> costmap_ros)
+{
+  node_ = parent;
+  name_ = name;
+  costmap_ = costmap_ros->getCostmap();
+  global_frame_ = costmap_ros->getGlobalFrameID();
+
+  RCLCPP_INFO(
+    node_->get_logger(), "Configuring plugin %s of type HierarchicalPlanner",
+    name_.c_str());
+
+  declare_parameter_if_not_declared(node_, name + ".region_size", rclcpp::ParameterValue(100));
+  node_->get_parameter(name + ".region_size", region_size_);
+  region_size_ = std::max(region_size_, 1);
+  declare_parameter_if_not_declared(node_, name + ".graph_file", rclcpp::ParameterValue(""));
+  node_->get_parameter(name + ".graph_file", graph_file_);
+  declare_parameter_if_not_declared(node_, name + ".allow_unknown", rclcpp::ParameterValue(true));
+  node_->get_parameter(name + ".allow_unknown", allow_unknown_);
+  declare_parameter_if_not_declared(node_, name + ".use_astar", rclcpp::ParameterValue(false));
+  node_->get_parameter(name + ".use_astar", use_astar_);
+}
+
+void
+HierarchicalPlanner::activate()
+{
+  RCLCPP_INFO(
+    node_->get_logger(), "Activating plugin %s of type HierarchicalPlanner",
+    name_.c_str());
+}
+
+void
+HierarchicalPlanner::deactivate()
+{
+  RCLCPP_INFO(
+    node_->get_logger(), "Deactivating plugin %s of type HierarchicalPlanner",
+    name_.c_str());
+}
+
+void
+HierarchicalPlanner::cleanup()
+{
+  RCLCPP_INFO(
+    node_->get_logger(), "Cleaning up plugin %s of type HierarchicalPlanner",
+    name_.c_str());
+  graph_ = RegionGraph();
+  navfn_.reset();
+  window_.clear();
+}
+
+nav_msgs::msg::Path HierarchicalPlanner::createPlan(
+  const geometry_msgs::msg::PoseStamped & start,
+  const geometry_msgs::msg::PoseStamped & goal)
+{
+  nav_msgs::msg::Path path;
+  path.header.stamp = node_->now();
+  path.header.frame_id = global_frame_;
+
+  std::unique_lock<nav2_costmap_2d::Costmap2D::mutex_t> lock(*(costmap_->getMutex()));
+
+  unsigned int start_x, start_y, goal_x, goal_y;
+  if (!costmap_->worldToMap(start.pose.position.x, start.pose.position.y, start_x, start_y)) {
+    RCLCPP_WARN(
+      node_->get_logger(),
+      "Cannot create a plan: the robot's start position is off the global"
+      " costmap. Planning will always fail, are you sure"
+      " the robot has been properly localized?");
+    return path;
+  }
+  if (!costmap_->worldToMap(goal.pose.position.x, goal.pose.position.y, goal_x, goal_y)) {
+    RCLCPP_WARN(
+      node_->get_logger(),
+      "The goal sent to the planner is off the global costmap."
+      " Planning will always fail to this goal.");
+    return path;
+  }
+
+  updateGraph();
+
+  unsigned int size_x = costmap_->getSizeInCellsX();
+  const unsigned char * charmap = costmap_->getCharMap();
+  auto cost = [this, size_x, charmap](unsigned int x, unsigned int y) {
+      return translateCost(charmap[y * size_x + x]);
+    };
+
+  std::vector<char> corridor(graph_.getNumRegions(), 0);
+  std::vector<unsigned int> regions;
+  bool found = false;
+  if (graph_.findRegions(start_x, start_y, goal_x, goal_y, cost, regions)) {
+    RCLCPP_DEBUG(
+      node_->get_logger(), "%s: route crosses %zu regions, %zu portals expanded",
+      name_.c_str(), regions.size(), graph_.getExpansions());
+    for (unsigned int region : regions) {
+      corridor[region] = 1;
+    }
+    found = planInCorridor(corridor, start_x, start_y, goal_x, goal_y, path);
+  }
+
+  if (!found) {
+    // the costmap has changed since the graph was built, around a new obstacle
+    // or through a new opening, so fall back to the whole map
+    RCLCPP_DEBUG(
+      node_->get_logger(), "%s: no path along the region graph, planning over the whole costmap",
+      name_.c_str());
+    std::fill(corridor.begin(), corridor.end(), 1);
+    found = planInCorridor(corridor, start_x, start_y, goal_x, goal_y, path);
+  }
+
+  if (!found) {
+    RCLCPP_WARN(node_->get_logger(), "%s: failed to create plan", name_.c_str());
+    return path;
+  }
+
+  // end on the goal itself rather than the center of its cell
+  path.poses.back().pose = goal.pose;
+  return path;
+}
+
+void
+HierarchicalPlanner::updateGraph()
+{
+  unsigned int size_x = costmap_->getSizeInCellsX();
+  unsigned int size_y = costmap_->getSizeInCellsY();
+  unsigned int region_size = static_cast<unsigned int>(region_size_);
+  if (graph_.matches(size_x, size_y, region_size)) {
+    return;
+  }
+
+  if (!graph_file_.empty() && graph_.load(graph_file_) &&
+    graph_.matches(size_x, size_y, region_size))
+  {
+    RCLCPP_INFO(
+      node_->get_logger(), "%s: loaded a region graph of %zu portal cells from %s",
+      name_.c_str(), graph_.getNumNodes(), graph_file_.c_str());
+    return;
+  }
+
+  const unsigned char * charmap = costmap_->getCharMap();
+  graph_.build(
+    size_x, size_y, region_size, static_cast<float>(COST_NEUTRAL),
+    [this, size_x, charmap](unsigned int x, unsigned int y) {
+      return translateCost(charmap[y * size_x + x]);
+    });
+  RCLCPP_INFO(
+    node_->get_logger(), "%s: built a region graph of %u regions and %zu portal cells",
+    name_.c_str(), graph_.getNumRegions(), graph_.getNumNodes());
+
+  if (!graph_file_.empty() && !graph_.save(graph_file_)) {
+    RCLCPP_WARN(
+      node_->get_logger(), "%s: failed to save the region graph to %s",
+      name_.c_str(), graph_file_.c_str());
+  }
+}
+
+bool
+HierarchicalPlanner::planInCorridor(
+  const std::vector<char> & corridor,
+  unsigned int start_x, unsigned int start_y,
+  unsigned int goal_x, unsigned int goal_y,
+  nav_msgs::msg::Path & path)
+{
+  unsigned int size_x = costmap_->getSizeInCellsX();
+  unsigned int size_y = costmap_->getSizeInCellsY();
+
+  // the bounding box of the corridor, with a cell to spare as NavFn never
+  // enters the cells on its border
+  unsigned int x0 = size_x, y0 = size_y, xn = 0, yn = 0;
+  for (unsigned int region = 0; region < corridor.size(); ++region) {
+    if (corridor[region]) {
+      unsigned int rx0, ry0, rxn, ryn;
+      graph_.getRegionBounds(region, rx0, ry0, rxn, ryn);
+      x0 = std::min(x0, rx0);
+      y0 = std::min(y0, ry0);
+      xn = std::max(xn, rxn);
+      yn = std::max(yn, ryn);
+    }
+  }
+  x0 = x0 > 0 ? x0 - 1 : 0;
+  y0 = y0 > 0 ? y0 - 1 : 0;
+  xn = std::min(xn + 1, size_x);
+  yn = std::min(yn + 1, size_y);
+  int width = static_cast<int>(xn - x0);
+  int height = static_cast<int>(yn - y0);
+
+  // cells outside the corridor are obstacles
+  const unsigned char * charmap = costmap_->getCharMap();
+  window_.resize(width * height);
+  auto it = window_.begin();
+  for (unsigned int y = y0; y < yn; ++y) {
+    for (unsigned int x = x0; x < xn; ++x) {
+      *it++ = corridor[graph_.getRegion(x, y)] ?
+        charmap[y * size_x + x] : nav2_costmap_2d::LETHAL_OBSTACLE;
+    }
+  }
+  window_[(start_y - y0) * width + (start_x - x0)] = nav2_costmap_2d::FREE_SPACE;
+
+  if (!navfn_) {
+    navfn_ = std::make_unique<nav2_navfn_planner::NavFn>(width, height);
+  } else {
+    navfn_->setNavArr(width, height);
+  }
+  navfn_->setCostmap(window_.data(), true, allow_unknown_);
+
+  // NavFn propagates from its goal and descends from its start, so the two are swapped
+  int map_start[2] = {static_cast<int>(start_x - x0), static_cast<int>(start_y - y0)};
+  int map_goal[2] = {static_cast<int>(goal_x - x0), static_cast<int>(goal_y - y0)};
+  navfn_->setStart(map_goal);
+  navfn_->setGoal(map_start);
+
+  bool result = use_astar_ ? navfn_->calcNavFnAstar() : navfn_->calcNavFnDijkstra(true);
+  if (!result || navfn_->calcPath((width + height) * 4) == 0) {
+    return false;
+  }
+
+  float * px = navfn_->getPathX();
+  float * py = navfn_->getPathY();
+  path.poses.clear();
+  for (int i = navfn_->getPathLen() - 1; i >= 0; --i) {
+    geometry_msgs::msg::PoseStamped pose;
+    pose.header = path.header;
+    pose.pose.position.x = costmap_->getOriginX() + (x0 + px[i]) * costmap_->getResolution();
+    pose.pose.position.y = costmap_->getOriginY() + (y0 + py[i]) * costmap_->getResolution();
+    pose.pose.orientation.w = 1.0;
+    path.poses.push_back(pose);
+  }
+  return !path.poses.empty();
+}
+
+float
+HierarchicalPlanner::translateCost(unsigned char cost) const
+{
+  // the same translation NavFn makes, with obstacles impassable
+  if (cost == nav2_costmap_2d::NO_INFORMATION) {
+    if (!allow_unknown_) {
+      return RegionGraph::OBSTACLE;
+    }
+    cost = nav2_costmap_2d::INSCRIBED_INFLATED_OBSTACLE - 1;
+  } else if (cost >= nav2_costmap_2d::INSCRIBED_INFLATED_OBSTACLE) {
+    return RegionGraph::OBSTACLE;
+  }
+  return static_cast<float>(COST_NEUTRAL + COST_FACTOR * cost);
+}
+
+}  // namespace nav2_hierarchical_planner
+
+#include "pluginlib/class_list_macros.hpp"
+PLUGINLIB_EXPORT_CLASS(nav2_hierarchical_planner::HierarchicalPlanner, nav2_core::GlobalPlanner)
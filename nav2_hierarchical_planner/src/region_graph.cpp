@@ -0,0 +1,417 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_hierarchical_planner/region_graph.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace nav2_hierarchical_planner
+{
+
+namespace
+{
+
+const char * const FILE_TAG = "nav2_region_graph";
+const int FILE_VERSION = 1;
+
+const float SQRT2 = 1.41421356f;
+
+typedef std::pair<float, unsigned int> QueueEntry;
+typedef std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>>
+  Queue;
+
+}  // namespace
+
+constexpr float RegionGraph::OBSTACLE;
+
+RegionGraph::RegionGraph()
+{
+}
+
+void
+RegionGraph::build(
+  unsigned int size_x, unsigned int size_y, unsigned int region_size,
+  float min_cost, const CostFunction & cost)
+{
+  size_x_ = size_x;
+  size_y_ = size_y;
+  region_size_ = std::max(region_size, 1u);
+  regions_x_ = (size_x_ + region_size_ - 1) / region_size_;
+  regions_y_ = (size_y_ + region_size_ - 1) / region_size_;
+  min_cost_ = min_cost;
+
+  nodes_.clear();
+  edges_.clear();
+  region_nodes_.assign(getNumRegions(), std::vector<unsigned int>());
+
+  // a portal in the middle of every free stretch of the border with the
+  // regions to the right and above
+  for (unsigned int region = 0; region < getNumRegions(); ++region) {
+    unsigned int x0, y0, xn, yn;
+    getRegionBounds(region, x0, y0, xn, yn);
+
+    if (xn < size_x_) {
+      unsigned int run = 0;
+      for (unsigned int y = y0; y <= yn; ++y) {
+        if (y < yn && cost(xn - 1, y) != OBSTACLE && cost(xn, y) != OBSTACLE) {
+          ++run;
+        } else if (run > 0) {
+          unsigned int middle = y - (run + 1) / 2;
+          addPortal(xn - 1, middle, xn, middle, cost);
+          run = 0;
+        }
+      }
+    }
+
+    if (yn < size_y_) {
+      unsigned int run = 0;
+      for (unsigned int x = x0; x <= xn; ++x) {
+        if (x < xn && cost(x, yn - 1) != OBSTACLE && cost(x, yn) != OBSTACLE) {
+          ++run;
+        } else if (run > 0) {
+          unsigned int middle = x - (run + 1) / 2;
+          addPortal(middle, yn - 1, middle, yn, cost);
+          run = 0;
+        }
+      }
+    }
+  }
+
+  // join the portals of each region through it
+  std::vector<float> costs, dist;
+  for (unsigned int region = 0; region < getNumRegions(); ++region) {
+    const auto & members = region_nodes_[region];
+    if (members.size() < 2) {
+      continue;
+    }
+    getRegionCosts(region, cost, costs);
+    for (unsigned int from : members) {
+      searchRegion(region, costs, nodes_[from].x, nodes_[from].y, dist);
+      for (unsigned int to : members) {
+        float d = dist[localIndex(region, nodes_[to].x, nodes_[to].y)];
+        if (to != from && d != OBSTACLE) {
+          edges_[from].push_back({to, d});
+        }
+      }
+    }
+  }
+}
+
+void
+RegionGraph::addPortal(
+  unsigned int ax, unsigned int ay, unsigned int bx, unsigned int by,
+  const CostFunction & cost)
+{
+  unsigned int a = static_cast<unsigned int>(nodes_.size());
+  unsigned int b = a + 1;
+  nodes_.push_back({ax, ay, getRegion(ax, ay)});
+  nodes_.push_back({bx, by, getRegion(bx, by)});
+  edges_.push_back({{b, cost(bx, by)}});
+  edges_.push_back({{a, cost(ax, ay)}});
+  region_nodes_[nodes_[a].region].push_back(a);
+  region_nodes_[nodes_[b].region].push_back(b);
+}
+
+bool
+RegionGraph::save(const std::string & filename) const
+{
+  std::ofstream out(filename);
+  if (!out) {
+    return false;
+  }
+
+  out.precision(9);
+  out << FILE_TAG << " " << FILE_VERSION << "\n";
+  out << size_x_ << " " << size_y_ << " " << region_size_ << " " << min_cost_ << "\n";
+  out << nodes_.size() << "\n";
+  for (const auto & node : nodes_) {
+    out << node.x << " " << node.y << "\n";
+  }
+  for (const auto & edges : edges_) {
+    out << edges.size();
+    for (const auto & edge : edges) {
+      out << " " << edge.to << " " << edge.cost;
+    }
+    out << "\n";
+  }
+  return static_cast<bool>(out);
+}
+
+bool
+RegionGraph::load(const std::string & filename)
+{
+  std::ifstream in(filename);
+  std::string tag;
+  int version;
+  if (!(in >> tag >> version) || tag != FILE_TAG || version != FILE_VERSION) {
+    return false;
+  }
+
+  RegionGraph graph;
+  size_t num_nodes;
+  if (!(in >> graph.size_x_ >> graph.size_y_ >> graph.region_size_ >> graph.min_cost_ >>
+    num_nodes) || graph.region_size_ == 0)
+  {
+    return false;
+  }
+  graph.regions_x_ = (graph.size_x_ + graph.region_size_ - 1) / graph.region_size_;
+  graph.regions_y_ = (graph.size_y_ + graph.region_size_ - 1) / graph.region_size_;
+  graph.region_nodes_.resize(graph.getNumRegions());
+
+  graph.nodes_.resize(num_nodes);
+  for (unsigned int i = 0; i < num_nodes; ++i) {
+    Node & node = graph.nodes_[i];
+    if (!(in >> node.x >> node.y) || node.x >= graph.size_x_ || node.y >= graph.size_y_) {
+      return false;
+    }
+    node.region = graph.getRegion(node.x, node.y);
+    graph.region_nodes_[node.region].push_back(i);
+  }
+
+  graph.edges_.resize(num_nodes);
+  for (auto & edges : graph.edges_) {
+    size_t num_edges;
+    if (!(in >> num_edges)) {
+      return false;
+    }
+    edges.resize(num_edges);
+    for (auto & edge : edges) {
+      if (!(in >> edge.to >> edge.cost) || edge.to >= num_nodes) {
+        return false;
+      }
+    }
+  }
+
+  *this = std::move(graph);
+  return true;
+}
+
+bool
+RegionGraph::matches(
+  unsigned int size_x, unsigned int size_y, unsigned int region_size) const
+{
+  return size_x_ == size_x && size_y_ == size_y && region_size_ == region_size &&
+         getNumRegions() > 0;
+}
+
+bool
+RegionGraph::findRegions(
+  unsigned int start_x, unsigned int start_y,
+  unsigned int goal_x, unsigned int goal_y,
+  const CostFunction & cost, std::vector<unsigned int> & regions) const
+{
+  regions.clear();
+  expansions_ = 0;
+  if (start_x >= size_x_ || start_y >= size_y_ || goal_x >= size_x_ || goal_y >= size_y_) {
+    return false;
+  }
+
+  unsigned int start_region = getRegion(start_x, start_y);
+  unsigned int goal_region = getRegion(goal_x, goal_y);
+
+  // connect the start and goal to the portals of their regions, with the
+  // current costs; the path to the goal is taken as costing the same as the
+  // path back from it
+  std::vector<float> costs, start_dist, goal_dist;
+  getRegionCosts(start_region, cost, costs);
+  searchRegion(start_region, costs, start_x, start_y, start_dist);
+  if (goal_region != start_region) {
+    getRegionCosts(goal_region, cost, costs);
+  }
+  searchRegion(goal_region, costs, goal_x, goal_y, goal_dist);
+
+  const unsigned int start = static_cast<unsigned int>(nodes_.size());
+  const unsigned int goal = start + 1;
+
+  std::vector<Edge> start_edges;
+  for (unsigned int node : region_nodes_[start_region]) {
+    float d = start_dist[localIndex(start_region, nodes_[node].x, nodes_[node].y)];
+    if (d != OBSTACLE) {
+      start_edges.push_back({node, d});
+    }
+  }
+  if (start_region == goal_region) {
+    float d = start_dist[localIndex(start_region, goal_x, goal_y)];
+    if (d != OBSTACLE) {
+      start_edges.push_back({goal, d});
+    }
+  }
+
+  auto heuristic = [&](unsigned int node) {
+      if (node >= start) {
+        return 0.0f;
+      }
+      float dx = std::fabs(static_cast<float>(nodes_[node].x) - goal_x);
+      float dy = std::fabs(static_cast<float>(nodes_[node].y) - goal_y);
+      return min_cost_ * (std::max(dx, dy) + (SQRT2 - 1.0f) * std::min(dx, dy));
+    };
+
+  // A* over the portals
+  std::vector<float> g(nodes_.size() + 2, OBSTACLE);
+  std::vector<unsigned int> parent(nodes_.size() + 2, start);
+  Queue open;
+  g[start] = 0.0f;
+  open.push({heuristic(start), start});
+
+  auto relax = [&](unsigned int from, unsigned int to, float edge_cost) {
+      float candidate = g[from] + edge_cost;
+      if (candidate < g[to]) {
+        g[to] = candidate;
+        parent[to] = from;
+        open.push({candidate + heuristic(to), to});
+      }
+    };
+
+  while (!open.empty()) {
+    QueueEntry top = open.top();
+    open.pop();
+    unsigned int node = top.second;
+    if (top.first > g[node] + heuristic(node)) {
+      continue;  // stale
+    }
+    if (node == goal) {
+      break;
+    }
+    ++expansions_;
+
+    if (node == start) {
+      for (const auto & edge : start_edges) {
+        relax(node, edge.to, edge.cost);
+      }
+      continue;
+    }
+    for (const auto & edge : edges_[node]) {
+      relax(node, edge.to, edge.cost);
+    }
+    if (nodes_[node].region == goal_region) {
+      float d = goal_dist[localIndex(goal_region, nodes_[node].x, nodes_[node].y)];
+      if (d != OBSTACLE) {
+        relax(node, goal, d);
+      }
+    }
+  }
+
+  if (g[goal] == OBSTACLE) {
+    return false;
+  }
+
+  regions.push_back(goal_region);
+  for (unsigned int node = parent[goal]; node != start; node = parent[node]) {
+    if (nodes_[node].region != regions.back()) {
+      regions.push_back(nodes_[node].region);
+    }
+  }
+  if (regions.back() != start_region) {
+    regions.push_back(start_region);
+  }
+  std::reverse(regions.begin(), regions.end());
+  return true;
+}
+
+void
+RegionGraph::getRegionBounds(
+  unsigned int region, unsigned int & x0, unsigned int & y0,
+  unsigned int & xn, unsigned int & yn) const
+{
+  x0 = (region % regions_x_) * region_size_;
+  y0 = (region / regions_x_) * region_size_;
+  xn = std::min(x0 + region_size_, size_x_);
+  yn = std::min(y0 + region_size_, size_y_);
+}
+
+void
+RegionGraph::getRegionCosts(
+  unsigned int region, const CostFunction & cost, std::vector<float> & costs) const
+{
+  unsigned int x0, y0, xn, yn;
+  getRegionBounds(region, x0, y0, xn, yn);
+  costs.resize((xn - x0) * (yn - y0));
+  auto it = costs.begin();
+  for (unsigned int y = y0; y < yn; ++y) {
+    for (unsigned int x = x0; x < xn; ++x) {
+      *it++ = cost(x, y);
+    }
+  }
+}
+
+void
+RegionGraph::searchRegion(
+  unsigned int region, const std::vector<float> & costs,
+  unsigned int x, unsigned int y, std::vector<float> & dist) const
+{
+  unsigned int x0, y0, xn, yn;
+  getRegionBounds(region, x0, y0, xn, yn);
+  const int width = static_cast<int>(xn - x0);
+  const int height = static_cast<int>(yn - y0);
+
+  dist.assign(costs.size(), OBSTACLE);
+  unsigned int origin = localIndex(region, x, y);
+  dist[origin] = 0.0f;
+
+  // Dijkstra, the cell searched from may be an obstacle itself
+  Queue open;
+  open.push({0.0f, origin});
+  while (!open.empty()) {
+    QueueEntry top = open.top();
+    open.pop();
+    unsigned int index = top.second;
+    if (top.first > dist[index]) {
+      continue;
+    }
+    int cx = static_cast<int>(index) % width;
+    int cy = static_cast<int>(index) / width;
+    for (int dy = -1; dy <= 1; ++dy) {
+      for (int dx = -1; dx <= 1; ++dx) {
+        int nx = cx + dx;
+        int ny = cy + dy;
+        if ((dx == 0 && dy == 0) || nx < 0 || ny < 0 || nx >= width || ny >= height) {
+          continue;
+        }
+        unsigned int next = ny * width + nx;
+        float step = costs[next];
+        if (step == OBSTACLE) {
+          continue;
+        }
+        if (dx != 0 && dy != 0) {
+          // don't cut the corners of obstacles
+          if (costs[cy * width + nx] == OBSTACLE || costs[ny * width + cx] == OBSTACLE) {
+            continue;
+          }
+          step *= SQRT2;
+        }
+        if (top.first + step < dist[next]) {
+          dist[next] = top.first + step;
+          open.push({dist[next], next});
+        }
+      }
+    }
+  }
+}
+
+unsigned int
+RegionGraph::localIndex(unsigned int region, unsigned int x, unsigned int y) const
+{
+  unsigned int x0, y0, xn, yn;
+  getRegionBounds(region, x0, y0, xn, yn);
+  return (y - y0) * (xn - x0) + (x - x0);
+}
+
+}  // namespace nav2_hierarchical_planner
@@ -0,0 +1,107 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "nav2_hierarchical_planner/region_graph.hpp"
+
+using nav2_hierarchical_planner::RegionGraph;
+
+// A 40 x 40 grid of 10 x 10 regions, with a wall along x = 20 open only at y = 35
+class RegionGraphTest : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    costs_.assign(40 * 40, 1.0f);
+    for (unsigned int y = 0; y < 40; ++y) {
+      if (y != 35) {
+        costs_[y * 40 + 20] = RegionGraph::OBSTACLE;
+      }
+    }
+    graph_.build(40, 40, 10, 1.0f, cost());
+  }
+
+  RegionGraph::CostFunction cost() const
+  {
+    return [this](unsigned int x, unsigned int y) {return costs_[y * 40 + x];};
+  }
+
+  std::vector<float> costs_;
+  RegionGraph graph_;
+};
+
+TEST_F(RegionGraphTest, StraightRouteOnFreeSide)
+{
+  std::vector<unsigned int> regions;
+  ASSERT_TRUE(graph_.findRegions(2, 5, 2, 35, cost(), regions));
+  std::vector<unsigned int> expected = {0, 4, 8, 12};
+  EXPECT_EQ(regions, expected);
+}
+
+TEST_F(RegionGraphTest, RouteGoesThroughTheDoorway)
+{
+  std::vector<unsigned int> regions;
+  ASSERT_TRUE(graph_.findRegions(15, 5, 25, 5, cost(), regions));
+  EXPECT_EQ(regions.front(), graph_.getRegion(15, 5));
+  EXPECT_EQ(regions.back(), graph_.getRegion(25, 5));
+
+  // the doorway is in the top row of regions
+  bool through_doorway = false;
+  for (unsigned int region : regions) {
+    through_doorway |= region == graph_.getRegion(19, 35) || region == graph_.getRegion(20, 35);
+  }
+  EXPECT_TRUE(through_doorway);
+}
+
+TEST_F(RegionGraphTest, SameRegion)
+{
+  std::vector<unsigned int> regions;
+  ASSERT_TRUE(graph_.findRegions(1, 1, 8, 8, cost(), regions));
+  ASSERT_EQ(regions.size(), 1u);
+  EXPECT_EQ(regions[0], 0u);
+}
+
+TEST_F(RegionGraphTest, NoRouteWithoutTheDoorway)
+{
+  costs_[35 * 40 + 20] = RegionGraph::OBSTACLE;
+  graph_.build(40, 40, 10, 1.0f, cost());
+  std::vector<unsigned int> regions;
+  EXPECT_FALSE(graph_.findRegions(15, 5, 25, 5, cost(), regions));
+  EXPECT_TRUE(regions.empty());
+}
+
+TEST_F(RegionGraphTest, SaveAndLoad)
+{
+  std::string filename = "test_region_graph.graph";
+  ASSERT_TRUE(graph_.save(filename));
+
+  RegionGraph loaded;
+  ASSERT_TRUE(loaded.load(filename));
+  std::remove(filename.c_str());
+  EXPECT_TRUE(loaded.matches(40, 40, 10));
+  EXPECT_FALSE(loaded.matches(40, 40, 20));
+  EXPECT_EQ(loaded.getNumNodes(), graph_.getNumNodes());
+
+  std::vector<unsigned int> expected, regions;
+  graph_.findRegions(15, 5, 25, 5, cost(), expected);
+  ASSERT_TRUE(loaded.findRegions(15, 5, 25, 5, cost(), regions));
+  EXPECT_EQ(regions, expected);
+
+  EXPECT_FALSE(loaded.load("does_not_exist.graph"));
+  EXPECT_TRUE(loaded.matches(40, 40, 10));
+}
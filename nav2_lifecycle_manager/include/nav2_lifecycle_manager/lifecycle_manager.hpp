@@ -131,6 +131,19 @@ protected:
    */
   bool changeStateForAllNodes(std::uint8_t transition);
 
+  /**
+   * @brief Transition the nodes concurrently, each one once its dependencies have
+   * (or, tearing down, its dependents have)
+   */
+  bool changeStateForAllNodesInParallel(std::uint8_t transition);
+
+  /**
+   * @brief Read the dependencies of the nodes, and check there's an order that
+   * satisfies them
+   * @return false if the dependencies are circular
+   */
+  bool loadDependencies();
+
   // Convenience function to highlight the output on the console
   /**
    * @brief Helper function to highlight the output on the console
@@ -151,6 +164,15 @@ protected:
   // Whether to automatically start up the system
   bool autostart_;
 
+  // Whether to transition the nodes that don't depend on each other concurrently
+  bool parallel_transitions_{false};
+
+  // The nodes each node has to be brought up after, and torn down before
+  std::map<std::string, std::vector<std::string>> dependencies_;
+
+  // The node names in an order in which every node follows its dependencies
+  std::vector<std::string> dependency_order_;
+
   bool system_active_{false};
 };
 
@@ -14,8 +14,11 @@
 
 #include "nav2_lifecycle_manager/lifecycle_manager.hpp"
 
+#include <algorithm>
 #include <chrono>
+#include <future>
 #include <memory>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -40,9 +43,17 @@ LifecycleManager::LifecycleManager()
   // of nodes
   declare_parameter("node_names");
   declare_parameter("autostart", rclcpp::ParameterValue(false));
+  declare_parameter("parallel_transitions", rclcpp::ParameterValue(false));
 
   node_names_ = get_parameter("node_names").as_string_array();
   get_parameter("autostart", autostart_);
+  get_parameter("parallel_transitions", parallel_transitions_);
+
+  if (parallel_transitions_ && !loadDependencies()) {
+    RCLCPP_ERROR(
+      get_logger(), "The node dependencies are circular, transitioning the nodes one by one");
+    parallel_transitions_ = false;
+  }
 
   manager_srv_ = create_service<ManageLifecycleNodes>(
     get_name() + std::string("/manage_nodes"),
@@ -121,9 +132,60 @@ LifecycleManager::createLifecycleServiceClients()
 {
   message("Creating and initializing lifecycle service clients");
   for (auto & node_name : node_names_) {
-    node_map_[node_name] =
-      std::make_shared<LifecycleServiceClient>(node_name, service_client_node_);
+    if (parallel_transitions_) {
+      // A node can only be spun by one thread at a time, so each client that may be
+      // called concurrently gets its own
+      node_map_[node_name] = std::make_shared<LifecycleServiceClient>(node_name);
+    } else {
+      node_map_[node_name] =
+        std::make_shared<LifecycleServiceClient>(node_name, service_client_node_);
+    }
+  }
+}
+
+bool
+LifecycleManager::loadDependencies()
+{
+  // The nodes a node depends on are given as dependencies.<node name>, for example
+  // dependencies.amcl: ["map_server"]. Nodes without dependencies are independent.
+  std::set<std::string> managed(node_names_.begin(), node_names_.end());
+  for (auto & node_name : node_names_) {
+    declare_parameter(
+      "dependencies." + node_name, rclcpp::ParameterValue(std::vector<std::string>()));
+    auto & dependencies = dependencies_[node_name];
+    for (auto & dependency : get_parameter("dependencies." + node_name).as_string_array()) {
+      if (managed.count(dependency) == 0 || dependency == node_name) {
+        RCLCPP_WARN(
+          get_logger(), "Ignoring the dependency of %s on %s, which isn't another managed node",
+          node_name.c_str(), dependency.c_str());
+        continue;
+      }
+      dependencies.push_back(dependency);
+    }
   }
+
+  // Order the nodes so each follows its dependencies, keeping to node_names where possible
+  dependency_order_.clear();
+  std::set<std::string> ordered;
+  while (dependency_order_.size() < node_names_.size()) {
+    bool progress = false;
+    for (auto & node_name : node_names_) {
+      auto & dependencies = dependencies_[node_name];
+      if (ordered.count(node_name) == 0 &&
+        std::all_of(
+          dependencies.begin(), dependencies.end(),
+          [&ordered](const std::string & dependency) {return ordered.count(dependency) > 0;}))
+      {
+        dependency_order_.push_back(node_name);
+        ordered.insert(node_name);
+        progress = true;
+      }
+    }
+    if (!progress) {
+      return false;
+    }
+  }
+  return true;
 }
 
 void
@@ -138,9 +200,10 @@ LifecycleManager::destroyLifecycleServiceClients()
 bool
 LifecycleManager::changeStateForNode(const std::string & node_name, std::uint8_t transition)
 {
-  message(transition_label_map_[transition] + node_name);
-  if (!node_map_[node_name]->change_state(transition) ||
-    !(node_map_[node_name]->get_state() == transition_state_map_[transition]))
+  message(transition_label_map_.at(transition) + node_name);
+  auto & client = node_map_.at(node_name);
+  if (!client->change_state(transition) ||
+    !(client->get_state() == transition_state_map_.at(transition)))
   {
     RCLCPP_ERROR(get_logger(), "Failed to change state for node: %s", node_name.c_str());
     return false;
@@ -152,6 +215,10 @@ LifecycleManager::changeStateForNode(const std::string & node_name, std::uint8_t
 bool
 LifecycleManager::changeStateForAllNodes(std::uint8_t transition)
 {
+  if (parallel_transitions_) {
+    return changeStateForAllNodesInParallel(transition);
+  }
+
   if (transition == Transition::TRANSITION_CONFIGURE ||
     transition == Transition::TRANSITION_ACTIVATE)
   {
@@ -171,6 +238,55 @@ LifecycleManager::changeStateForAllNodes(std::uint8_t transition)
   return true;
 }
 
+bool
+LifecycleManager::changeStateForAllNodesInParallel(std::uint8_t transition)
+{
+  // Bringing nodes up, a node waits for its dependencies; tearing them down, for the
+  // nodes that depend on it
+  bool bringing_up = transition == Transition::TRANSITION_CONFIGURE ||
+    transition == Transition::TRANSITION_ACTIVATE;
+  std::map<std::string, std::vector<std::string>> waits_for;
+  for (auto & node_name : node_names_) {
+    for (auto & dependency : dependencies_[node_name]) {
+      if (bringing_up) {
+        waits_for[node_name].push_back(dependency);
+      } else {
+        waits_for[dependency].push_back(node_name);
+      }
+    }
+  }
+
+  // Start the transitions in an order in which whatever a node waits for has started
+  std::vector<std::string> order(dependency_order_);
+  if (!bringing_up) {
+    std::reverse(order.begin(), order.end());
+  }
+
+  std::map<std::string, std::shared_future<bool>> results;
+  for (auto & node_name : order) {
+    std::vector<std::shared_future<bool>> prerequisites;
+    for (auto & other : waits_for[node_name]) {
+      prerequisites.push_back(results[other]);
+    }
+    results[node_name] = std::async(
+      std::launch::async, [this, node_name, transition, prerequisites]() {
+        for (auto & prerequisite : prerequisites) {
+          if (!prerequisite.get()) {
+            return false;
+          }
+        }
+        return changeStateForNode(node_name, transition);
+      }).share();
+  }
+
+  // Wait for all of them, so none is still running when the next transition starts
+  bool success = true;
+  for (auto & result : results) {
+    success = result.second.get() && success;
+  }
+  return success;
+}
+
 void
 LifecycleManager::shutdownAllNodes()
 {
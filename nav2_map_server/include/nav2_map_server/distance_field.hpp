@@ -0,0 +1,83 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_MAP_SERVER__DISTANCE_FIELD_HPP_
+#define NAV2_MAP_SERVER__DISTANCE_FIELD_HPP_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "nav2_util/thread_pool.hpp"
+#include "nav_msgs/msg/occupancy_grid.hpp"
+
+namespace nav2_map_server
+{
+
+/// @brief The value of the cells of a distance field at max_distance or further
+constexpr uint8_t DISTANCE_FIELD_MAX = 255;
+
+/**
+ * @brief Compute the distance of every cell of a map to the nearest occupied
+ * cell (of value 100), in steps of max_distance / DISTANCE_FIELD_MAX, row by row
+ * @param map The map
+ * @param max_distance The distance in meters from which cells are at DISTANCE_FIELD_MAX
+ * @param pool The threads to compute the distances on
+ * @param field The distances, resized to the number of cells of the map
+ */
+void computeDistanceField(
+  const nav_msgs::msg::OccupancyGrid & map, double max_distance, nav2_util::ThreadPool & pool,
+  std::vector<uint8_t> & field);
+
+/**
+ * @brief Update the distances of the cells that the cells in a rectangle of the
+ * map can be the nearest occupied one to, after the rectangle has changed
+ * @param map The map, already changed
+ * @param max_distance As given to computeDistanceField
+ * @param x The first column of the rectangle
+ * @param y The first row of the rectangle
+ * @param width The number of columns of the rectangle
+ * @param height The number of rows of the rectangle
+ * @param pool The threads to compute the distances on
+ * @param field The distances computed by computeDistanceField for the map
+ */
+void updateDistanceField(
+  const nav_msgs::msg::OccupancyGrid & map, double max_distance,
+  uint32_t x, uint32_t y, uint32_t width, uint32_t height,
+  nav2_util::ThreadPool & pool, std::vector<uint8_t> & field);
+
+/**
+ * @brief A hash of the cells and the geometry of a map and a parameter of
+ * something derived from it, to name the files it is cached in
+ */
+uint64_t hashMap(const nav_msgs::msg::OccupancyGrid & map, double parameter);
+
+/**
+ * @brief Read a cached field of a map's size from a file
+ * @return Whether the file was there and held a field of the right size
+ */
+bool readCachedField(
+  const std::string & filename, const nav_msgs::msg::OccupancyGrid & map,
+  std::vector<uint8_t> & field);
+
+/**
+ * @brief Write a field to a file, through a temporary file so that readers
+ * never see part of it
+ * @return Whether the field was written
+ */
+bool writeCachedField(const std::string & filename, const std::vector<uint8_t> & field);
+
+}  // namespace nav2_map_server
+
+#endif  // NAV2_MAP_SERVER__DISTANCE_FIELD_HPP_
@@ -0,0 +1,50 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_MAP_SERVER__MAP_REGION_HPP_
+#define NAV2_MAP_SERVER__MAP_REGION_HPP_
+
+#include <cstdint>
+
+#include "nav_msgs/msg/map_meta_data.hpp"
+
+namespace nav2_map_server
+{
+
+/**
+ * @brief Find the cells of a map covering a rectangle of the map frame
+ * @param info The metadata of the map
+ * @param min_x, min_y, max_x, max_y The corners of the rectangle
+ * @param x, y, width, height The first column and row, and the number of columns
+ * and rows, of the cells covering the rectangle, clipped to the map
+ * @return false if the rectangle is off the map
+ */
+bool getRegionCells(
+  const nav_msgs::msg::MapMetaData & info,
+  double min_x, double min_y, double max_x, double max_y,
+  uint32_t & x, uint32_t & y, uint32_t & width, uint32_t & height);
+
+/**
+ * @brief The metadata of a map made of some of the cells of another
+ * @param info The metadata of the whole map
+ * @param x, y, width, height The first column and row, and the number of columns
+ * and rows, of the cells
+ */
+nav_msgs::msg::MapMetaData getRegionInfo(
+  const nav_msgs::msg::MapMetaData & info,
+  uint32_t x, uint32_t y, uint32_t width, uint32_t height);
+
+}  // namespace nav2_map_server
+
+#endif  // NAV2_MAP_SERVER__MAP_REGION_HPP_
@@ -15,8 +15,14 @@
 #ifndef NAV2_MAP_SERVER__MAP_SAVER_HPP_
 #define NAV2_MAP_SERVER__MAP_SAVER_HPP_
 
+#include <atomic>
+#include <future>
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <thread>
 #include "map_mode.hpp"
+#include "nav2_util/thread_pool.hpp"
 #include "nav_msgs/srv/get_map.hpp"
 #include "rclcpp/rclcpp.hpp"
 
@@ -37,9 +43,15 @@ public:
    */
   explicit MapSaver(const rclcpp::NodeOptions & options);
 
+  /**
+   * @brief Waits for the map being saved, if any
+   */
+  ~MapSaver();
+
   /**
    * @brief A Map callback function calls try_write_map_to_file method to
-   * write map data to a file.
+   * write map data to a file, on a thread of its own. Maps received while
+   * one is being written are skipped.
    * @param map Occupancy Grid message data
    */
   void mapCallback(const nav_msgs::msg::OccupancyGrid::SharedPtr map);
@@ -59,12 +71,40 @@ protected:
    */
   void try_write_map_to_file(const nav_msgs::msg::OccupancyGrid & map);
 
+  // The gray level and opacity of the pixel of each cell value, indexed by the value as a byte
+  struct PixelTable
+  {
+    uint8_t gray[256];
+    uint8_t alpha[256];
+  };
+  PixelTable make_pixel_table() const;
+
+  // Convert rows of the map, counted from the top of the image, to gray or RGBA pixels
+  void convert_rows(
+    const nav_msgs::msg::OccupancyGrid & map, const PixelTable & table, size_t first_row,
+    size_t num_rows, bool rgba, uint8_t * pixels);
+
+  // Write a PGM image band by band, without holding a whole image
+  void write_pgm(const nav_msgs::msg::OccupancyGrid & map, const std::string & filename);
+
+  // Log each quarter of the rows converted
+  void report_progress(size_t rows_done, size_t num_rows, int & percent_reported);
+
   std::promise<void> save_next_map_promise;
 
+  // The thread the last map was saved on, and whether it is still at it
+  std::thread save_thread_;
+  std::atomic<bool> saving_{false};
+
+  // The threads rows are converted on
+  std::unique_ptr<nav2_util::ThreadPool> pool_;
+  static constexpr size_t ROWS_PER_TASK = 64;
+
   std::string image_format;
   std::string mapname_;
   int threshold_occupied_;
   int threshold_free_;
+  int tile_size_;
   nav2_map_server::MapMode map_mode;
 };
 
@@ -15,15 +15,20 @@
 #ifndef NAV2_MAP_SERVER__OCC_GRID_LOADER_HPP_
 #define NAV2_MAP_SERVER__OCC_GRID_LOADER_HPP_
 
+#include <map>
 #include <memory>
 #include <string>
 #include <vector>
 #include "nav2_map_server/occ_grid_loader.hpp"
 
 #include "map_mode.hpp"
+#include "map_msgs/msg/occupancy_grid_update.hpp"
+#include "nav2_msgs/msg/distance_field.hpp"
 #include "nav2_util/lifecycle_node.hpp"
+#include "nav2_util/thread_pool.hpp"
 #include "nav_msgs/msg/occupancy_grid.hpp"
 #include "nav_msgs/srv/get_map.hpp"
+#include "nav2_msgs/srv/get_map_region.hpp"
 #include "nav2_msgs/srv/load_map.hpp"
 #include "rclcpp/rclcpp.hpp"
 
@@ -109,17 +114,72 @@ protected:
     std::string yaml_file,
     std::shared_ptr<nav2_msgs::srv::LoadMap::Response> response = nullptr);
 
+  // Compute the products derived from the map that are served with it, or read
+  // them from the cache
+  void updateDerivedMaps();
+
+  // Publish the derived products, if there are any
+  void publishDerivedMaps();
+
+  // Load the maps of the map set and their derived products, ahead of being served
+  void preloadMapSet(const std::vector<std::string> & yaml_files);
+
+  // Serve a map of the map set in place of the current map, without reading any file.
+  // Returns false if the map isn't one of the set.
+  bool selectFloor(const std::string & yaml_file);
+
+  // Give the derived products of the current map back to its floor of the map set,
+  // before another map is served
+  void leaveFloor();
+
+  // Apply an edit of a region of the map and publish it as a map update
+  void editMap(const map_msgs::msg::OccupancyGridUpdate::SharedPtr edit);
+
   // A service to provide the occupancy grid (GetMap) and the message to return
   rclcpp::Service<nav_msgs::srv::GetMap>::SharedPtr occ_service_;
 
+  // A service to provide a region of the occupancy grid (GetMapRegion)
+  rclcpp::Service<nav2_msgs::srv::GetMapRegion>::SharedPtr region_service_;
+
   // A service to load the occupancy grid from file at run time (LoadMap)
   rclcpp::Service<nav2_msgs::srv::LoadMap>::SharedPtr load_map_service_;
 
   // A topic on which the occupancy grid will be published
   rclcpp_lifecycle::LifecyclePublisher<nav_msgs::msg::OccupancyGrid>::SharedPtr occ_pub_;
 
+  // A topic on which edits of regions of the map are received
+  rclcpp::Subscription<map_msgs::msg::OccupancyGridUpdate>::SharedPtr edit_sub_;
+
+  // A topic on which the edited regions of the map are published
+  rclcpp_lifecycle::LifecyclePublisher<map_msgs::msg::OccupancyGridUpdate>::SharedPtr
+    update_pub_;
+
   // The message to publish on the occupancy grid topic
-  std::unique_ptr<nav_msgs::msg::OccupancyGrid> msg_;
+  std::shared_ptr<nav_msgs::msg::OccupancyGrid> msg_;
+
+  // A map of the map set, kept with its derived products while another is served
+  struct Floor
+  {
+    std::shared_ptr<nav_msgs::msg::OccupancyGrid> map;
+    nav2_msgs::msg::DistanceField distance;
+  };
+
+  // The maps of the map set by the YAML file they're loaded from. The current one
+  // shares its map with msg_ and has its distance field swapped into distance_msg_.
+  std::map<std::string, Floor> map_set_;
+  std::string current_floor_;  // "" if the map served isn't one of the set
+
+  // The distance of every cell to the nearest occupied one, computed once for
+  // the nodes that would each compute it, if distance_field_max_dist is positive
+  double distance_field_max_dist_{0.0};
+  nav2_msgs::msg::DistanceField distance_msg_;
+  rclcpp_lifecycle::LifecyclePublisher<nav2_msgs::msg::DistanceField>::SharedPtr distance_pub_;
+
+  // The directory the derived products are cached in by the hash of the map, if any
+  std::string derived_cache_dir_;
+
+  // The threads the derived products are computed on
+  std::unique_ptr<nav2_util::ThreadPool> pool_;
 
   // The frame ID used in the returned OccupancyGrid message
   static constexpr const char * frame_id_{"map"};
@@ -127,9 +187,19 @@ protected:
   // The name for the topic on which the map will be published
   static constexpr const char * topic_name_{"map"};
 
+  // The names of the topics on which edits are received and updates published
+  static constexpr const char * edit_topic_name_{"map_edits"};
+  static constexpr const char * update_topic_name_{"map_updates"};
+
+  // The name of the topic on which the distance field is published
+  static constexpr const char * distance_topic_name_{"map_distance"};
+
   // The name of the service for getting a map
   static constexpr const char * service_name_{"map"};
 
+  // The name of the service for getting a region of the map
+  static constexpr const char * region_service_name_{"map_region"};
+
   // The name of the service for loading a map
   static constexpr const char * load_map_service_name_{"load_map"};
 
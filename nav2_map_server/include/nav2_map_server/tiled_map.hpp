@@ -0,0 +1,113 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_MAP_SERVER__TILED_MAP_HPP_
+#define NAV2_MAP_SERVER__TILED_MAP_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "nav_msgs/msg/occupancy_grid.hpp"
+
+namespace nav2_map_server
+{
+
+/**
+ * @class nav2_map_server::TiledMap
+ * @brief The cells of an occupancy grid stored in square tiles, in a file that is
+ * memory mapped so only the tiles that are read are loaded.
+ *
+ * The file holds a header (the "NAV2TILE" magic, then the version, the width and
+ * height of the map in cells and the side of the tiles, as 32 bit integers), a table
+ * with the offset (64 bits), size and encoding (32 bits each) of every tile, row by
+ * row of tiles, and the tiles. A tile holds its cells row by row, as the values of
+ * an OccupancyGrid, either raw or run length encoded as pairs of a count and a value.
+ * The integers are in the byte order of the machine that wrote the file.
+ */
+class TiledMap
+{
+public:
+  enum Encoding : uint32_t
+  {
+    RAW = 0,
+    RUN_LENGTH = 1
+  };
+
+  /**
+   * @brief Write the cells of a map to a tiled file. Each tile is run length
+   * encoded if that makes it smaller.
+   * @param filename The file to write
+   * @param map The map to write the cells of
+   * @param tile_size The side of the tiles, in cells
+   * @throw std::runtime_error If the file can't be written
+   */
+  static void write(
+    const std::string & filename, const nav_msgs::msg::OccupancyGrid & map,
+    uint32_t tile_size = 256);
+
+  /**
+   * @brief Map a tiled file in memory
+   * @param filename The file to map
+   * @throw std::runtime_error If the file can't be mapped or isn't a valid tiled map
+   */
+  explicit TiledMap(const std::string & filename);
+
+  TiledMap(const TiledMap &) = delete;
+  TiledMap & operator=(const TiledMap &) = delete;
+
+  ~TiledMap();
+
+  uint32_t getWidth() const {return width_;}
+  uint32_t getHeight() const {return height_;}
+  uint32_t getTileSize() const {return tile_size_;}
+
+  /**
+   * @brief Read the cells of a rectangle of the map, decoding only the tiles it covers
+   * @param x The first column of the rectangle
+   * @param y The first row of the rectangle
+   * @param width The number of columns of the rectangle
+   * @param height The number of rows of the rectangle
+   * @param cells Where to write the cells, row by row, width * height of them
+   * @throw std::runtime_error If the rectangle isn't on the map or a tile is corrupt
+   */
+  void read(uint32_t x, uint32_t y, uint32_t width, uint32_t height, int8_t * cells) const;
+
+protected:
+  struct Tile
+  {
+    uint64_t offset;
+    uint32_t size;
+    uint32_t encoding;
+  };
+
+  // The cells of a tile, decoded into the buffer if they aren't stored raw
+  const int8_t * tileCells(
+    uint32_t tile_x, uint32_t tile_y, size_t num_cells, std::vector<int8_t> & buffer) const;
+
+  uint32_t width_{0};
+  uint32_t height_{0};
+  uint32_t tile_size_{0};
+  uint32_t tiles_x_{0};
+  uint32_t tiles_y_{0};
+  std::vector<Tile> tiles_;
+
+  const uint8_t * data_{nullptr};
+  size_t size_{0};
+};
+
+}  // namespace nav2_map_server
+
+#endif  // NAV2_MAP_SERVER__TILED_MAP_HPP_
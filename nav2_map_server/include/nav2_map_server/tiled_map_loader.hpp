@@ -0,0 +1,126 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_MAP_SERVER__TILED_MAP_LOADER_HPP_
+#define NAV2_MAP_SERVER__TILED_MAP_LOADER_HPP_
+
+#include <memory>
+#include <string>
+
+#include "nav2_map_server/tiled_map.hpp"
+#include "nav2_util/lifecycle_node.hpp"
+#include "nav_msgs/msg/occupancy_grid.hpp"
+#include "nav_msgs/srv/get_map.hpp"
+#include "nav2_msgs/srv/get_map_region.hpp"
+#include "rclcpp/rclcpp.hpp"
+
+namespace nav2_map_server
+{
+/**
+ * @class nav2_map_server::TiledMapLoader
+ * @brief Maps a tiled map in memory and serves regions of it, only reading the
+ * tiles a request covers. The whole map is only put together for the map service
+ * and, unless the publish_full_map parameter is false, the latched map topic.
+ */
+class TiledMapLoader : public rclcpp_lifecycle::node_interfaces::LifecycleNodeInterface
+{
+public:
+  /**
+   * @brief Constructor for TiledMapLoader
+   * @param node
+   * @param yaml_filename File that contains the map metadata and names its tiles
+   */
+  TiledMapLoader(rclcpp_lifecycle::LifecycleNode::SharedPtr node, std::string & yaml_filename);
+  /**
+   * @brief Disabling the use of default or empty constructor
+   */
+  TiledMapLoader() = delete;
+  /**
+   * @brief Destructor for TiledMapLoader
+   */
+  ~TiledMapLoader();
+  /**
+   * @brief Map the tiles in memory and create the services
+   * @param state Lifecycle Node's state
+   * @return Success or Failure
+   */
+  nav2_util::CallbackReturn on_configure(const rclcpp_lifecycle::State & state) override;
+  /**
+   * @brief Publish the whole map on the latched topic, if asked to
+   * @param state Lifecycle Node's state
+   * @return Success or Failure
+   */
+  nav2_util::CallbackReturn on_activate(const rclcpp_lifecycle::State & state) override;
+  /**
+   * @brief Stops publishing the latched topic
+   * @param state Lifecycle Node's state
+   * @return Success or Failure
+   */
+  nav2_util::CallbackReturn on_deactivate(const rclcpp_lifecycle::State & state) override;
+  /**
+   * @brief Resets the member variables
+   * @param state Lifecycle Node's state
+   * @return Success or Failure
+   */
+  nav2_util::CallbackReturn on_cleanup(const rclcpp_lifecycle::State & state) override;
+
+protected:
+  /**
+   * @brief Load the metadata of the map and map its tiles in memory
+   * @throw YAML::Exception, std::runtime_error
+   */
+  void loadMapFromYaml(const std::string & yaml_filename);
+
+  // The cells of a region of the map, as a message
+  nav_msgs::msg::OccupancyGrid getRegion(
+    uint32_t x, uint32_t y, uint32_t width, uint32_t height) const;
+
+  // The ROS node to use for ROS-related operations such as creating a service
+  rclcpp_lifecycle::LifecycleNode::SharedPtr node_;
+
+  // The name of the YAML file from which to get the metadata and the tiles
+  std::string yaml_filename_;
+
+  // The tiles, and the metadata of the whole map
+  std::unique_ptr<TiledMap> tiled_map_;
+  nav_msgs::msg::MapMetaData info_;
+
+  // Whether to put the whole map together and publish it on the latched topic
+  bool publish_full_map_{true};
+
+  // A service to provide the whole occupancy grid (GetMap)
+  rclcpp::Service<nav_msgs::srv::GetMap>::SharedPtr occ_service_;
+
+  // A service to provide a region of the occupancy grid (GetMapRegion)
+  rclcpp::Service<nav2_msgs::srv::GetMapRegion>::SharedPtr region_service_;
+
+  // A topic on which the occupancy grid will be published
+  rclcpp_lifecycle::LifecyclePublisher<nav_msgs::msg::OccupancyGrid>::SharedPtr occ_pub_;
+
+  // The frame ID used in the returned OccupancyGrid message
+  static constexpr const char * frame_id_{"map"};
+
+  // The name for the topic on which the map will be published
+  static constexpr const char * topic_name_{"map"};
+
+  // The name of the service for getting a map
+  static constexpr const char * service_name_{"map"};
+
+  // The name of the service for getting a region of the map
+  static constexpr const char * region_service_name_{"map_region"};
+};
+
+}  // namespace nav2_map_server
+
+#endif  // NAV2_MAP_SERVER__TILED_MAP_LOADER_HPP_
@@ -0,0 +1,159 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_map_server/distance_field.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "nav2_util/distance_transform.hpp"
+
+namespace nav2_map_server
+{
+
+namespace
+{
+
+// Compute the distances of the cells in the window [min_x, max_x) x [min_y, max_y)
+// from the occupied cells in it, and store those of the cells in
+// [out_min_x, out_max_x) x [out_min_y, out_max_y)
+void fillField(
+  const nav_msgs::msg::OccupancyGrid & map, double max_distance, nav2_util::ThreadPool & pool,
+  int min_x, int min_y, int max_x, int max_y,
+  int out_min_x, int out_min_y, int out_max_x, int out_max_y, std::vector<uint8_t> & field)
+{
+  const size_t map_width = map.info.width;
+  const int size_x = max_x - min_x;
+  const int size_y = max_y - min_y;
+  std::vector<int64_t> distances(static_cast<size_t>(size_x) * size_y);
+  for (int j = 0; j < size_y; j++) {
+    const int8_t * cells = &map.data[(min_y + j) * map_width + min_x];
+    int64_t * row = &distances[static_cast<size_t>(j) * size_x];
+    for (int i = 0; i < size_x; i++) {
+      row[i] = cells[i] == 100 ? 0 : nav2_util::NO_SEED;
+    }
+  }
+
+  nav2_util::squaredDistanceTransform(distances.data(), size_x, size_y, pool);
+
+  // Squared distances in cells from which the cells are at the maximum
+  const double steps_per_cell = map.info.resolution * DISTANCE_FIELD_MAX / max_distance;
+  const double max_cells = max_distance / map.info.resolution;
+  const int64_t max_squared = static_cast<int64_t>(std::ceil(max_cells * max_cells));
+  for (int j = out_min_y; j < out_max_y; j++) {
+    const int64_t * row = &distances[static_cast<size_t>(j - min_y) * size_x];
+    uint8_t * out = &field[j * map_width];
+    for (int i = out_min_x; i < out_max_x; i++) {
+      int64_t squared = row[i - min_x];
+      if (squared >= max_squared) {
+        out[i] = DISTANCE_FIELD_MAX;
+      } else {
+        double steps = std::sqrt(static_cast<double>(squared)) * steps_per_cell + 0.5;
+        out[i] = static_cast<uint8_t>(std::min(steps, static_cast<double>(DISTANCE_FIELD_MAX)));
+      }
+    }
+  }
+}
+
+}  // namespace
+
+void computeDistanceField(
+  const nav_msgs::msg::OccupancyGrid & map, double max_distance, nav2_util::ThreadPool & pool,
+  std::vector<uint8_t> & field)
+{
+  const int width = map.info.width;
+  const int height = map.info.height;
+  field.resize(static_cast<size_t>(width) * height);
+  fillField(map, max_distance, pool, 0, 0, width, height, 0, 0, width, height, field);
+}
+
+// Only the cells within max_distance of the changed ones can have a new
+// distance, and only the occupied cells within max_distance of those can be
+// the nearest to them
+void updateDistanceField(
+  const nav_msgs::msg::OccupancyGrid & map, double max_distance,
+  uint32_t x, uint32_t y, uint32_t width, uint32_t height,
+  nav2_util::ThreadPool & pool, std::vector<uint8_t> & field)
+{
+  if (width == 0 || height == 0) {
+    return;
+  }
+  const int map_width = map.info.width;
+  const int map_height = map.info.height;
+  const int radius = static_cast<int>(std::ceil(max_distance / map.info.resolution)) + 1;
+  const int min_x = x;
+  const int min_y = y;
+  const int max_x = x + width;
+  const int max_y = y + height;
+  fillField(
+    map, max_distance, pool,
+    std::max(min_x - 2 * radius, 0), std::max(min_y - 2 * radius, 0),
+    std::min(max_x + 2 * radius, map_width), std::min(max_y + 2 * radius, map_height),
+    std::max(min_x - radius, 0), std::max(min_y - radius, 0),
+    std::min(max_x + radius, map_width), std::min(max_y + radius, map_height), field);
+}
+
+// FNV-1a
+uint64_t hashMap(const nav_msgs::msg::OccupancyGrid & map, double parameter)
+{
+  uint64_t hash = 14695981039346656037ULL;
+  auto add = [&hash](const void * data, size_t size) {
+      const unsigned char * bytes = static_cast<const unsigned char *>(data);
+      for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 1099511628211ULL;
+      }
+    };
+
+  add(&map.info.width, sizeof(map.info.width));
+  add(&map.info.height, sizeof(map.info.height));
+  add(&map.info.resolution, sizeof(map.info.resolution));
+  add(&parameter, sizeof(parameter));
+  add(map.data.data(), map.data.size());
+  return hash;
+}
+
+bool readCachedField(
+  const std::string & filename, const nav_msgs::msg::OccupancyGrid & map,
+  std::vector<uint8_t> & field)
+{
+  std::ifstream file(filename, std::ios::binary | std::ios::ate);
+  const size_t size = static_cast<size_t>(map.info.width) * map.info.height;
+  if (!file || static_cast<size_t>(file.tellg()) != size) {
+    return false;
+  }
+  field.resize(size);
+  file.seekg(0);
+  file.read(reinterpret_cast<char *>(field.data()), size);
+  return static_cast<bool>(file);
+}
+
+bool writeCachedField(const std::string & filename, const std::vector<uint8_t> & field)
+{
+  const std::string tmp_filename = filename + ".tmp";
+  {
+    std::ofstream file(tmp_filename, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char *>(field.data()), field.size());
+    if (!file) {
+      std::remove(tmp_filename.c_str());
+      return false;
+    }
+  }
+  return std::rename(tmp_filename.c_str(), filename.c_str()) == 0;
+}
+
+}  // namespace nav2_map_server
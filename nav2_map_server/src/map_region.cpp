@@ -0,0 +1,94 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_map_server/map_region.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace nav2_map_server
+{
+
+namespace
+{
+
+// The yaw of the map's grid in the map frame, maps only being rotated around z
+double getYaw(const nav_msgs::msg::MapMetaData & info)
+{
+  const auto & q = info.origin.orientation;
+  return std::atan2(2.0 * (q.w * q.z + q.x * q.y), 1.0 - 2.0 * (q.y * q.y + q.z * q.z));
+}
+
+}  // namespace
+
+bool getRegionCells(
+  const nav_msgs::msg::MapMetaData & info,
+  double min_x, double min_y, double max_x, double max_y,
+  uint32_t & x, uint32_t & y, uint32_t & width, uint32_t & height)
+{
+  if (min_x > max_x || min_y > max_y || info.resolution <= 0.0) {
+    return false;
+  }
+
+  // Bound the corners of the rectangle in the grid, which can be rotated
+  const double yaw = getYaw(info);
+  const double cos_yaw = std::cos(yaw);
+  const double sin_yaw = std::sin(yaw);
+  double min_column = HUGE_VAL, min_row = HUGE_VAL;
+  double max_column = -HUGE_VAL, max_row = -HUGE_VAL;
+  for (double corner_x : {min_x, max_x}) {
+    for (double corner_y : {min_y, max_y}) {
+      const double dx = corner_x - info.origin.position.x;
+      const double dy = corner_y - info.origin.position.y;
+      const double column = (cos_yaw * dx + sin_yaw * dy) / info.resolution;
+      const double row = (-sin_yaw * dx + cos_yaw * dy) / info.resolution;
+      min_column = std::min(min_column, column);
+      max_column = std::max(max_column, column);
+      min_row = std::min(min_row, row);
+      max_row = std::max(max_row, row);
+    }
+  }
+
+  const double first_column = std::max(std::floor(min_column), 0.0);
+  const double first_row = std::max(std::floor(min_row), 0.0);
+  const double end_column = std::min(std::ceil(max_column), static_cast<double>(info.width));
+  const double end_row = std::min(std::ceil(max_row), static_cast<double>(info.height));
+  if (first_column >= end_column || first_row >= end_row) {
+    return false;
+  }
+
+  x = static_cast<uint32_t>(first_column);
+  y = static_cast<uint32_t>(first_row);
+  width = static_cast<uint32_t>(end_column - first_column);
+  height = static_cast<uint32_t>(end_row - first_row);
+  return true;
+}
+
+nav_msgs::msg::MapMetaData getRegionInfo(
+  const nav_msgs::msg::MapMetaData & info,
+  uint32_t x, uint32_t y, uint32_t width, uint32_t height)
+{
+  const double yaw = getYaw(info);
+  const double dx = x * info.resolution;
+  const double dy = y * info.resolution;
+
+  nav_msgs::msg::MapMetaData region = info;
+  region.width = width;
+  region.height = height;
+  region.origin.position.x += std::cos(yaw) * dx - std::sin(yaw) * dy;
+  region.origin.position.y += std::sin(yaw) * dx + std::cos(yaw) * dy;
+  return region;
+}
+
+}  // namespace nav2_map_server
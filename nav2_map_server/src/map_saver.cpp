@@ -30,6 +30,8 @@
 
 #include "nav2_map_server/map_saver.hpp"
 
+#include <algorithm>
+#include <cmath>
 #include <cstdio>
 #include <fstream>
 #include <memory>
@@ -39,6 +41,7 @@
 
 #include "Magick++.h"
 #include "nav2_map_server/map_mode.hpp"
+#include "nav2_map_server/tiled_map.hpp"
 #include "nav_msgs/msg/occupancy_grid.h"
 #include "nav_msgs/srv/get_map.hpp"
 #include "rclcpp/rclcpp.hpp"
@@ -83,7 +86,7 @@ MapSaver::MapSaver(const rclcpp::NodeOptions & options)
     std::transform(
       image_format.begin(), image_format.end(), image_format.begin(),
       [](unsigned char c) {return std::tolower(c);});
-    const std::vector<std::string> BLESSED_FORMATS{"bmp", "pgm", "png"};
+    const std::vector<std::string> BLESSED_FORMATS{"bmp", "pgm", "png", "tiles"};
     if (
       std::find(BLESSED_FORMATS.begin(), BLESSED_FORMATS.end(), image_format) ==
       BLESSED_FORMATS.end())
@@ -103,19 +106,27 @@ MapSaver::MapSaver(const rclcpp::NodeOptions & options)
     }
     const std::string FALLBACK_FORMAT = "png";
 
-    try {
-      Magick::CoderInfo info(image_format);
-      if (!info.isWritable()) {
+    // The tiled format isn't written with GraphicsMagick, it holds the cells as they are
+    tile_size_ = declare_parameter("tile_size", 256);
+    if (tile_size_ <= 0) {
+      throw std::runtime_error("Tile size must be positive");
+    }
+
+    if (image_format != "tiles") {
+      try {
+        Magick::CoderInfo info(image_format);
+        if (!info.isWritable()) {
+          RCLCPP_WARN(
+            get_logger(), "Format '%s' is not writable. Using '%s' instead",
+            image_format.c_str(), FALLBACK_FORMAT.c_str());
+          image_format = FALLBACK_FORMAT;
+        }
+      } catch (Magick::ErrorOption & e) {
         RCLCPP_WARN(
-          get_logger(), "Format '%s' is not writable. Using '%s' instead",
-          image_format.c_str(), FALLBACK_FORMAT.c_str());
+          get_logger(), "Format '%s' is not usable. Using '%s' instead:\n%s",
+          image_format.c_str(), FALLBACK_FORMAT.c_str(), e.what());
         image_format = FALLBACK_FORMAT;
       }
-    } catch (Magick::ErrorOption & e) {
-      RCLCPP_WARN(
-        get_logger(), "Format '%s' is not usable. Using '%s' instead:\n%s",
-        image_format.c_str(), FALLBACK_FORMAT.c_str(), e.what());
-      image_format = FALLBACK_FORMAT;
     }
     if (
       map_mode == MapMode::Scale &&
@@ -128,6 +139,9 @@ MapSaver::MapSaver(const rclcpp::NodeOptions & options)
         image_format.c_str());
     }
 
+    int conversion_threads = declare_parameter("conversion_threads", 0);
+    pool_ = std::make_unique<nav2_util::ThreadPool>(std::max(conversion_threads, 0));
+
     RCLCPP_INFO(get_logger(), "Waiting for the map");
     map_sub_ = create_subscription<nav_msgs::msg::OccupancyGrid>(
       "map", rclcpp::SystemDefaultsQoS(),
@@ -135,69 +149,148 @@ MapSaver::MapSaver(const rclcpp::NodeOptions & options)
   }
 }
 
+MapSaver::~MapSaver()
+{
+  if (save_thread_.joinable()) {
+    save_thread_.join();
+  }
+}
+
+MapSaver::PixelTable MapSaver::make_pixel_table() const
+{
+  PixelTable table;
+  for (int value = -128; value < 128; value++) {
+    int8_t map_cell = static_cast<int8_t>(value);
+    uint8_t & gray = table.gray[static_cast<uint8_t>(map_cell)];
+    uint8_t & alpha = table.alpha[static_cast<uint8_t>(map_cell)];
+    alpha = 255;
+    switch (map_mode) {
+      case MapMode::Trinary:
+        if (map_cell < 0 || 100 < map_cell) {
+          gray = 205;
+        } else if (map_cell <= threshold_free_) {
+          gray = 254;
+        } else if (threshold_occupied_ <= map_cell) {
+          gray = 0;
+        } else {
+          gray = 205;
+        }
+        break;
+      case MapMode::Scale:
+        if (map_cell < 0 || 100 < map_cell) {
+          gray = 128;
+          alpha = 0;
+        } else {
+          gray = static_cast<uint8_t>(std::lround((100.0 - map_cell) / 100.0 * 255.0));
+        }
+        break;
+      case MapMode::Raw:
+        if (map_cell < 0 || 100 < map_cell) {
+          gray = 255;
+        } else {
+          gray = static_cast<uint8_t>(map_cell);
+        }
+        break;
+      default:
+        throw std::runtime_error("Invalid map mode");
+    }
+  }
+  return table;
+}
+
+void MapSaver::convert_rows(
+  const nav_msgs::msg::OccupancyGrid & map, const PixelTable & table, size_t first_row,
+  size_t num_rows, bool rgba, uint8_t * pixels)
+{
+  const size_t width = map.info.width;
+  const size_t channels = rgba ? 4 : 1;
+  size_t num_tasks = (num_rows + ROWS_PER_TASK - 1) / ROWS_PER_TASK;
+  pool_->parallel_for(
+    num_tasks, [&](size_t task) {
+      size_t end = std::min((task + 1) * ROWS_PER_TASK, num_rows);
+      for (size_t row = task * ROWS_PER_TASK; row < end; row++) {
+        // The image is written top down, the map is stored bottom up
+        const int8_t * cells = &map.data[width * (map.info.height - first_row - row - 1)];
+        uint8_t * pixel = pixels + row * width * channels;
+        for (size_t x = 0; x < width; x++) {
+          uint8_t index = static_cast<uint8_t>(cells[x]);
+          if (rgba) {
+            pixel[0] = pixel[1] = pixel[2] = table.gray[index];
+            pixel[3] = table.alpha[index];
+            pixel += 4;
+          } else {
+            *pixel++ = table.gray[index];
+          }
+        }
+      }
+    });
+}
+
+void MapSaver::report_progress(size_t rows_done, size_t num_rows, int & percent_reported)
+{
+  int percent = static_cast<int>(100 * rows_done / std::max<size_t>(num_rows, 1));
+  if (percent >= percent_reported + 25) {
+    percent_reported = percent - percent % 25;
+    RCLCPP_INFO(get_logger(), "Converted %d%% of the map", percent_reported);
+  }
+}
+
+void MapSaver::write_pgm(const nav_msgs::msg::OccupancyGrid & map, const std::string & filename)
+{
+  std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+  file << "P5\n" << map.info.width << " " << map.info.height << "\n255\n";
+
+  // Only a band of rows is held at a time, written out as soon as it is converted
+  const PixelTable table = make_pixel_table();
+  const size_t num_rows = map.info.height;
+  const size_t band_rows = ROWS_PER_TASK * pool_->size();
+  std::vector<uint8_t> band(band_rows * map.info.width);
+  int percent_reported = 0;
+  for (size_t row = 0; row < num_rows && file; row += band_rows) {
+    size_t rows = std::min(band_rows, num_rows - row);
+    convert_rows(map, table, row, rows, false, band.data());
+    file.write(reinterpret_cast<const char *>(band.data()), rows * map.info.width);
+    report_progress(row + rows, num_rows, percent_reported);
+  }
+  if (!file) {
+    throw std::runtime_error("Failed to write the map to " + filename);
+  }
+}
+
 void MapSaver::try_write_map_to_file(const nav_msgs::msg::OccupancyGrid & map)
 {
   auto logger = get_logger();
   RCLCPP_INFO(
     logger, "Received a %d X %d map @ %.3f m/pix", map.info.width, map.info.height,
     map.info.resolution);
+  if (map.data.size() != static_cast<size_t>(map.info.width) * map.info.height) {
+    throw std::runtime_error("The map doesn't have width * height cells");
+  }
 
   std::string mapdatafile = mapname_ + "." + image_format;
-  {
-    // should never see this color, so the initialization value is just for debugging
-    Magick::Image image({map.info.width, map.info.height}, "red");
-
+  RCLCPP_INFO(logger, "Writing map occupancy data to %s", mapdatafile.c_str());
+  if (image_format == "tiles") {
+    TiledMap::write(mapdatafile, map, tile_size_);
+  } else if (image_format == "pgm") {
+    // PGM is simple enough to be streamed out without GraphicsMagick
+    write_pgm(map, mapdatafile);
+  } else {
     // In scale mode, we need the alpha (matte) channel. Else, we don't.
     // NOTE: GraphicsMagick seems to have trouble loading the alpha channel when saved with
     // Magick::GreyscaleMatte, so we use TrueColorMatte instead.
-    image.type(map_mode == MapMode::Scale ? Magick::TrueColorMatteType : Magick::GrayscaleType);
+    bool rgba = map_mode == MapMode::Scale;
+    std::vector<uint8_t> pixels(
+      static_cast<size_t>(map.info.width) * map.info.height * (rgba ? 4 : 1));
+    convert_rows(map, make_pixel_table(), 0, map.info.height, rgba, pixels.data());
+    RCLCPP_INFO(logger, "Converted the map, encoding it");
+
+    Magick::Image image(
+      map.info.width, map.info.height, rgba ? "RGBA" : "I", Magick::CharPixel, pixels.data());
+    pixels = std::vector<uint8_t>();
+    image.type(rgba ? Magick::TrueColorMatteType : Magick::GrayscaleType);
 
     // Since we only need to support 100 different pixel levels, 8 bits is fine
     image.depth(8);
-
-    for (size_t y = 0; y < map.info.height; y++) {
-      for (size_t x = 0; x < map.info.width; x++) {
-        int8_t map_cell = map.data[map.info.width * (map.info.height - y - 1) + x];
-
-        Magick::Color pixel;
-
-        switch (map_mode) {
-          case MapMode::Trinary:
-            if (map_cell < 0 || 100 < map_cell) {
-              pixel = Magick::ColorGray(205 / 255.0);
-            } else if (map_cell <= threshold_free_) {
-              pixel = Magick::ColorGray(254 / 255.0);
-            } else if (threshold_occupied_ <= map_cell) {
-              pixel = Magick::ColorGray(0 / 255.0);
-            } else {
-              pixel = Magick::ColorGray(205 / 255.0);
-            }
-            break;
-          case MapMode::Scale:
-            if (map_cell < 0 || 100 < map_cell) {
-              pixel = Magick::ColorGray{0.5};
-              pixel.alphaQuantum(TransparentOpacity);
-            } else {
-              pixel = Magick::ColorGray{(100.0 - map_cell) / 100.0};
-            }
-            break;
-          case MapMode::Raw:
-            Magick::Quantum q;
-            if (map_cell < 0 || 100 < map_cell) {
-              q = MaxRGB;
-            } else {
-              q = map_cell / 255.0 * MaxRGB;
-            }
-            pixel = Magick::Color(q, q, q);
-            break;
-          default:
-            throw std::runtime_error("Invalid map mode");
-        }
-        image.pixelColor(x, y, pixel);
-      }
-    }
-
-    RCLCPP_INFO(logger, "Writing map occupancy data to %s", mapdatafile.c_str());
     image.write(mapdatafile);
   }
 
@@ -213,14 +306,21 @@ void MapSaver::try_write_map_to_file(const nav_msgs::msg::OccupancyGrid & map)
     YAML::Emitter e;
     e << YAML::Precision(3);
     e << YAML::BeginMap;
-    e << YAML::Key << "image" << YAML::Value << mapdatafile;
-    e << YAML::Key << "mode" << YAML::Value << map_mode_to_string(map_mode);
+    if (image_format == "tiles") {
+      e << YAML::Key << "map_type" << YAML::Value << "tiled";
+      e << YAML::Key << "tiles" << YAML::Value << mapdatafile;
+    } else {
+      e << YAML::Key << "image" << YAML::Value << mapdatafile;
+      e << YAML::Key << "mode" << YAML::Value << map_mode_to_string(map_mode);
+    }
     e << YAML::Key << "resolution" << YAML::Value << map.info.resolution;
     e << YAML::Key << "origin" << YAML::Flow << YAML::BeginSeq << map.info.origin.position.x <<
       map.info.origin.position.y << yaw << YAML::EndSeq;
-    e << YAML::Key << "negate" << YAML::Value << 0;
-    e << YAML::Key << "occupied_thresh" << YAML::Value << threshold_occupied_ / 100.0;
-    e << YAML::Key << "free_thresh" << YAML::Value << threshold_free_ / 100.0;
+    if (image_format != "tiles") {
+      e << YAML::Key << "negate" << YAML::Value << 0;
+      e << YAML::Key << "occupied_thresh" << YAML::Value << threshold_occupied_ / 100.0;
+      e << YAML::Key << "free_thresh" << YAML::Value << threshold_free_ / 100.0;
+    }
 
     if (!e.good()) {
       RCLCPP_WARN(
@@ -236,15 +336,30 @@ void MapSaver::try_write_map_to_file(const nav_msgs::msg::OccupancyGrid & map)
 
 void MapSaver::mapCallback(const nav_msgs::msg::OccupancyGrid::SharedPtr map)
 {
-  auto current_promise = std::move(save_next_map_promise);
+  // The map is saved on its own thread, so the node keeps spinning. Maps that arrive
+  // while one is being saved are skipped rather than queued up.
+  if (saving_) {
+    RCLCPP_WARN(get_logger(), "Still saving the previous map, skipping this one");
+    return;
+  }
+  if (save_thread_.joinable()) {
+    save_thread_.join();
+  }
+  saving_ = true;
+
+  auto current_promise = std::make_shared<std::promise<void>>(std::move(save_next_map_promise));
   save_next_map_promise = std::promise<void>();
 
-  try {
-    try_write_map_to_file(*map);
-    current_promise.set_value();
-  } catch (std::exception & e) {
-    RCLCPP_ERROR(get_logger(), "Failed to write map for reason: %s", e.what());
-    current_promise.set_exception(std::current_exception());
-  }
+  save_thread_ = std::thread(
+    [this, map, current_promise]() {
+      try {
+        try_write_map_to_file(*map);
+        current_promise->set_value();
+      } catch (std::exception & e) {
+        RCLCPP_ERROR(get_logger(), "Failed to write map for reason: %s", e.what());
+        current_promise->set_exception(std::current_exception());
+      }
+      saving_ = false;
+    });
 }
 }  // namespace nav2_map_server
@@ -24,7 +24,7 @@ const char * USAGE_STRING{
   "Usage: \n"
   "  map_saver -h/--help\n"
   "  map_saver [--occ <threshold_occupied>] [--free <threshold_free>] [--fmt <image_format>] "
-  "[--mode trinary/scale/raw] [-f <mapname>] [ROS remapping args]"};
+  "[--mode trinary/scale/raw] [--tile-size <cells>] [-f <mapname>] [ROS remapping args]"};
 
 typedef enum {TYPE_STR, TYPE_INT} VAR_TYPE;
 struct cmd_struct
@@ -42,6 +42,7 @@ int main(int argc, char ** argv)
     {"--free", "threshold_free", TYPE_INT},
     {"--mode", "map_mode", TYPE_STR},
     {"--fmt", "image_format", TYPE_STR},
+    {"--tile-size", "tile_size", TYPE_INT},
   };
 
   rclcpp::init(argc, argv);
@@ -18,8 +18,10 @@
 #include <memory>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 #include "nav2_map_server/occ_grid_loader.hpp"
+#include "nav2_map_server/tiled_map_loader.hpp"
 #include "nav2_util/node_utils.hpp"
 #include "yaml-cpp/yaml.h"
 
@@ -28,13 +30,20 @@ using namespace std::chrono_literals;
 namespace nav2_map_server
 {
 
-MapServer::MapServer()
-: nav2_util::LifecycleNode("map_server")
+MapServer::MapServer(const rclcpp::NodeOptions & options)
+: nav2_util::LifecycleNode("map_server", "", false, options)
 {
   RCLCPP_INFO(get_logger(), "Creating");
 
   // Declare the node parameters
   declare_parameter("yaml_filename");
+  // Only used by tiled maps, which can be served by region alone
+  declare_parameter("publish_full_map", rclcpp::ParameterValue(true));
+  // Products derived from image maps once, for the nodes that use them
+  declare_parameter("distance_field_max_dist", rclcpp::ParameterValue(0.0));
+  declare_parameter("derived_cache_dir", rclcpp::ParameterValue(std::string("")));
+  // Image maps preloaded for LoadMap to switch to at once, such as the floors of a building
+  declare_parameter("map_set", rclcpp::ParameterValue(std::vector<std::string>()));
 }
 
 MapServer::~MapServer()
@@ -71,6 +80,8 @@ MapServer::on_configure(const rclcpp_lifecycle::State & state)
   // Create the correct map loader for the specified map type
   if (map_type == "occupancy") {
     map_loader_ = std::make_unique<OccGridLoader>(shared_from_this(), yaml_filename);
+  } else if (map_type == "tiled") {
+    map_loader_ = std::make_unique<TiledMapLoader>(shared_from_this(), yaml_filename);
   } else {
     std::string msg = "Cannot load unknown map type: '" + map_type + "'";
     throw std::runtime_error(msg);
@@ -123,3 +134,10 @@ MapServer::on_shutdown(const rclcpp_lifecycle::State &)
 }
 
 }  // namespace nav2_map_server
+
+#include "rclcpp_components/register_node_macro.hpp"
+
+// Register the component with class_loader.
+// This acts as a sort of entry point, allowing the component to be discoverable when its library
+// is being loaded into a running process.
+RCLCPP_COMPONENTS_REGISTER_NODE(nav2_map_server::MapServer)
@@ -32,15 +32,22 @@
 #include "nav2_map_server/occ_grid_loader.hpp"
 
 #include <libgen.h>
+#include <algorithm>
+#include <cstdio>
+#include <limits>
 #include <memory>
 #include <stdexcept>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "Magick++.h"
 #include "tf2/LinearMath/Quaternion.h"
 #include "yaml-cpp/yaml.h"
+#include "nav2_map_server/distance_field.hpp"
+#include "nav2_map_server/map_region.hpp"
 #include "nav2_util/geometry_utils.hpp"
+#include "nav2_util/node_utils.hpp"
 #include "lifecycle_msgs/msg/state.hpp"
 
 using namespace std::chrono_literals;
@@ -171,10 +178,27 @@ nav2_util::CallbackReturn OccGridLoader::on_configure(const rclcpp_lifecycle::St
   RCLCPP_INFO(node_->get_logger(), "OccGridLoader: Configuring");
 
   // initialize Occupancy Grid msg - needed by loadMapFromYaml
-  msg_ = std::make_unique<nav_msgs::msg::OccupancyGrid>();
+  msg_ = std::make_shared<nav_msgs::msg::OccupancyGrid>();
+
+  node_->get_parameter("distance_field_max_dist", distance_field_max_dist_);
+  node_->get_parameter("derived_cache_dir", derived_cache_dir_);
+  if (distance_field_max_dist_ > 0.0) {
+    pool_ = std::make_unique<nav2_util::ThreadPool>();
+    distance_pub_ = node_->create_publisher<nav2_msgs::msg::DistanceField>(
+      distance_topic_name_,
+      rclcpp::QoS(rclcpp::KeepLast(1)).transient_local().reliable(),
+      nav2_util::get_inter_process_publisher_options());
+  }
+
+  std::vector<std::string> map_set;
+  node_->get_parameter("map_set", map_set);
+  preloadMapSet(map_set);
 
-  if (!loadMapFromYaml(yaml_filename_)) {
-    throw std::runtime_error("Failed to load map yaml file: " + yaml_filename_);
+  if (!selectFloor(yaml_filename_)) {
+    if (!loadMapFromYaml(yaml_filename_)) {
+      throw std::runtime_error("Failed to load map yaml file: " + yaml_filename_);
+    }
+    updateDerivedMaps();
   }
 
   // Create GetMap service callback handle
@@ -195,6 +219,39 @@ nav2_util::CallbackReturn OccGridLoader::on_configure(const rclcpp_lifecycle::St
   // Create a service that provides the occupancy grid
   occ_service_ = node_->create_service<nav_msgs::srv::GetMap>(service_name_, handle_occ_callback);
 
+  // Create GetMapRegion service callback handle
+  auto handle_region_callback = [this](
+    const std::shared_ptr<rmw_request_id_t>/*request_header*/,
+    const std::shared_ptr<nav2_msgs::srv::GetMapRegion::Request> request,
+    std::shared_ptr<nav2_msgs::srv::GetMapRegion::Response> response) -> void {
+      if (node_->get_current_state().id() != lifecycle_msgs::msg::State::PRIMARY_STATE_ACTIVE) {
+        RCLCPP_WARN(
+          node_->get_logger(),
+          "Received GetMapRegion request but not in ACTIVE state, ignoring!");
+        return;
+      }
+      response->map.header = msg_->header;
+      uint32_t x, y, width, height;
+      if (!getRegionCells(
+          msg_->info, request->min_x, request->min_y, request->max_x, request->max_y,
+          x, y, width, height))
+      {
+        RCLCPP_WARN(node_->get_logger(), "The requested map region is off the map");
+        response->map.info = getRegionInfo(msg_->info, 0, 0, 0, 0);
+        return;
+      }
+      response->map.info = getRegionInfo(msg_->info, x, y, width, height);
+      response->map.data.reserve(static_cast<size_t>(width) * height);
+      for (uint32_t row = y; row < y + height; row++) {
+        auto cell = msg_->data.begin() + static_cast<size_t>(row) * msg_->info.width + x;
+        response->map.data.insert(response->map.data.end(), cell, cell + width);
+      }
+    };
+
+  // Create a service that provides regions of the occupancy grid
+  region_service_ = node_->create_service<nav2_msgs::srv::GetMapRegion>(
+    region_service_name_, handle_region_callback);
+
   // Create the load_map service callback handle
   auto load_map_callback = [this](
     const std::shared_ptr<rmw_request_id_t>/*request_header*/,
@@ -208,27 +265,165 @@ nav2_util::CallbackReturn OccGridLoader::on_configure(const rclcpp_lifecycle::St
         return;
       }
       RCLCPP_INFO(node_->get_logger(), "OccGridLoader: Handling LoadMap request");
-      // Load from file
-      if (loadMapFromYaml(request->map_url, response)) {
-        response->map = *msg_;
-        response->result = nav2_msgs::srv::LoadMap::Response::RESULT_SUCCESS;
-        occ_pub_->publish(*msg_);  // publish new map
+      // The maps of the map set are switched to as they are, the others loaded from file
+      const bool switched = selectFloor(request->map_url);
+      if (!switched && !loadMapFromYaml(request->map_url, response)) {
+        return;
+      }
+      response->map = *msg_;
+      response->result = nav2_msgs::srv::LoadMap::Response::RESULT_SUCCESS;
+      occ_pub_->publish(*msg_);  // publish new map
+      if (!switched) {
+        leaveFloor();
+        updateDerivedMaps();
       }
+      publishDerivedMaps();
     };
 
   // Create a publisher using the QoS settings to emulate a ROS1 latched topic
   occ_pub_ = node_->create_publisher<nav_msgs::msg::OccupancyGrid>(
     topic_name_,
-    rclcpp::QoS(rclcpp::KeepLast(1)).transient_local().reliable());
+    rclcpp::QoS(rclcpp::KeepLast(1)).transient_local().reliable(),
+    nav2_util::get_inter_process_publisher_options());
 
   // Create a service that loads the occupancy grid from a file
   load_map_service_ = node_->create_service<nav2_msgs::srv::LoadMap>(
     load_map_service_name_,
     load_map_callback);
 
+  // Edits are passed on as updates of the regions they cover, so the map
+  // doesn't have to be sent and processed again as a whole
+  update_pub_ = node_->create_publisher<map_msgs::msg::OccupancyGridUpdate>(
+    update_topic_name_, rclcpp::QoS(rclcpp::KeepLast(10)).reliable());
+  edit_sub_ = node_->create_subscription<map_msgs::msg::OccupancyGridUpdate>(
+    edit_topic_name_, rclcpp::QoS(rclcpp::KeepLast(10)).reliable(),
+    std::bind(&OccGridLoader::editMap, this, std::placeholders::_1));
+
   return nav2_util::CallbackReturn::SUCCESS;
 }
 
+void OccGridLoader::editMap(const map_msgs::msg::OccupancyGridUpdate::SharedPtr edit)
+{
+  if (node_->get_current_state().id() != lifecycle_msgs::msg::State::PRIMARY_STATE_ACTIVE) {
+    RCLCPP_WARN(node_->get_logger(), "Received a map edit but not in ACTIVE state, ignoring!");
+    return;
+  }
+  if (edit->x < 0 || edit->y < 0 ||
+    edit->x + static_cast<int64_t>(edit->width) > msg_->info.width ||
+    edit->y + static_cast<int64_t>(edit->height) > msg_->info.height ||
+    edit->data.size() != static_cast<size_t>(edit->width) * edit->height)
+  {
+    RCLCPP_WARN(
+      node_->get_logger(), "Map edit of %d X %d cells at (%d, %d) isn't on the map, ignoring!",
+      edit->width, edit->height, edit->x, edit->y);
+    return;
+  }
+
+  for (uint32_t row = 0; row < edit->height; row++) {
+    auto cell = edit->data.begin() + static_cast<size_t>(row) * edit->width;
+    std::copy(
+      cell, cell + edit->width,
+      msg_->data.begin() + static_cast<size_t>(edit->y + row) * msg_->info.width + edit->x);
+  }
+
+  // The latched map isn't published again, the map and map_region services
+  // return the edited map to nodes that start later
+  edit->header.frame_id = frame_id_;
+  edit->header.stamp = node_->now();
+  update_pub_->publish(*edit);
+
+  // The derived products are, for nodes that start later, but only around the edit
+  if (distance_pub_) {
+    updateDistanceField(
+      *msg_, distance_field_max_dist_, edit->x, edit->y, edit->width, edit->height, *pool_,
+      distance_msg_.data);
+    distance_msg_.header.stamp = edit->header.stamp;
+    publishDerivedMaps();
+  }
+}
+
+void OccGridLoader::updateDerivedMaps()
+{
+  if (distance_field_max_dist_ <= 0.0) {
+    return;
+  }
+
+  std::string filename;
+  if (!derived_cache_dir_.empty()) {
+    char name[64];
+    snprintf(
+      name, sizeof(name), "/distance_field_%016llx.bin",
+      static_cast<unsigned long long>(hashMap(*msg_, distance_field_max_dist_)));
+    filename = derived_cache_dir_ + name;
+  }
+
+  if (!filename.empty() && readCachedField(filename, *msg_, distance_msg_.data)) {
+    RCLCPP_INFO(node_->get_logger(), "Read the distance field from %s", filename.c_str());
+  } else {
+    computeDistanceField(*msg_, distance_field_max_dist_, *pool_, distance_msg_.data);
+    RCLCPP_INFO(node_->get_logger(), "Computed the distance field");
+    if (!filename.empty() && !writeCachedField(filename, distance_msg_.data)) {
+      RCLCPP_WARN(
+        node_->get_logger(), "Failed to cache the distance field in %s", filename.c_str());
+    }
+  }
+
+  // The nodes using the field check that it was computed for the map they have
+  distance_msg_.header.frame_id = frame_id_;
+  distance_msg_.header.stamp = node_->now();
+  distance_msg_.info = msg_->info;
+  distance_msg_.max_distance = distance_field_max_dist_;
+}
+
+void OccGridLoader::preloadMapSet(const std::vector<std::string> & yaml_files)
+{
+  for (const std::string & yaml_file : yaml_files) {
+    msg_ = std::make_shared<nav_msgs::msg::OccupancyGrid>();
+    if (!loadMapFromYaml(yaml_file)) {
+      throw std::runtime_error("Failed to load map yaml file of the map set: " + yaml_file);
+    }
+    updateDerivedMaps();
+    Floor & floor = map_set_[yaml_file];
+    floor.map = msg_;
+    std::swap(floor.distance, distance_msg_);
+  }
+  if (!yaml_files.empty()) {
+    RCLCPP_INFO(node_->get_logger(), "Preloaded the %zu maps of the map set", map_set_.size());
+  }
+}
+
+bool OccGridLoader::selectFloor(const std::string & yaml_file)
+{
+  auto floor = map_set_.find(yaml_file);
+  if (floor == map_set_.end()) {
+    return false;
+  }
+  leaveFloor();
+  msg_ = floor->second.map;
+  std::swap(distance_msg_, floor->second.distance);
+  current_floor_ = yaml_file;
+
+  msg_->header.stamp = node_->now();
+  distance_msg_.header.stamp = msg_->header.stamp;
+  RCLCPP_INFO(node_->get_logger(), "Switched to %s of the map set", yaml_file.c_str());
+  return true;
+}
+
+void OccGridLoader::leaveFloor()
+{
+  if (!current_floor_.empty()) {
+    std::swap(distance_msg_, map_set_[current_floor_].distance);
+    current_floor_.clear();
+  }
+}
+
+void OccGridLoader::publishDerivedMaps()
+{
+  if (distance_pub_ && distance_pub_->is_activated()) {
+    distance_pub_->publish(distance_msg_);
+  }
+}
+
 nav2_util::CallbackReturn OccGridLoader::on_activate(const rclcpp_lifecycle::State & /*state*/)
 {
   RCLCPP_INFO(node_->get_logger(), "OccGridLoader: Activating");
@@ -236,6 +431,11 @@ nav2_util::CallbackReturn OccGridLoader::on_activate(const rclcpp_lifecycle::Sta
   // Publish the map using the latched topic
   occ_pub_->on_activate();
   occ_pub_->publish(*msg_);
+  update_pub_->on_activate();
+  if (distance_pub_) {
+    distance_pub_->on_activate();
+  }
+  publishDerivedMaps();
 
   return nav2_util::CallbackReturn::SUCCESS;
 }
@@ -245,6 +445,10 @@ nav2_util::CallbackReturn OccGridLoader::on_deactivate(const rclcpp_lifecycle::S
   RCLCPP_INFO(node_->get_logger(), "OccGridLoader: Deactivating");
 
   occ_pub_->on_deactivate();
+  update_pub_->on_deactivate();
+  if (distance_pub_) {
+    distance_pub_->on_deactivate();
+  }
   timer_.reset();
 
   return nav2_util::CallbackReturn::SUCCESS;
@@ -255,9 +459,17 @@ nav2_util::CallbackReturn OccGridLoader::on_cleanup(const rclcpp_lifecycle::Stat
   RCLCPP_INFO(node_->get_logger(), "OccGridLoader: Cleaning up");
 
   occ_pub_.reset();
+  update_pub_.reset();
+  edit_sub_.reset();
+  distance_pub_.reset();
+  distance_msg_ = nav2_msgs::msg::DistanceField();
+  pool_.reset();
   occ_service_.reset();
+  region_service_.reset();
   load_map_service_.reset();
   msg_.reset();
+  map_set_.clear();
+  current_floor_.clear();
 
   return nav2_util::CallbackReturn::SUCCESS;
 }
@@ -285,67 +497,85 @@ void OccGridLoader::loadMapFromFile(const LoadParameters & loadParameters)
   // Allocate space to hold the data
   msg.data.resize(msg.info.width * msg.info.height);
 
-  // Copy pixel data into the map structure
-  for (size_t y = 0; y < msg.info.height; y++) {
-    for (size_t x = 0; x < msg.info.width; x++) {
-      auto pixel = img.pixelColor(x, y);
-
-      std::vector<Magick::Quantum> channels = {pixel.redQuantum(), pixel.greenQuantum(),
-        pixel.blueQuantum()};
-      if (loadParameters.mode == MapMode::Trinary && img.matte()) {
-        // To preserve existing behavior, average in alpha with color channels in Trinary mode.
-        // CAREFUL. alpha is inverted from what you might expect. High = transparent, low = opaque
-        channels.push_back(MaxRGB - pixel.alphaQuantum());
-      }
-      double sum = 0;
-      for (auto c : channels) {
-        sum += c;
-      }
-      /// on a scale from 0.0 to 1.0 how bright is the pixel?
-      double shade = Magick::ColorGray::scaleQuantumToDouble(sum / channels.size());
-
-      // If negate is true, we consider blacker pixels free, and whiter
-      // pixels occupied. Otherwise, it's vice versa.
-      /// on a scale from 0.0 to 1.0, how occupied is the map cell (before thresholding)?
-      double occ = (loadParameters.negate ? shade : 1.0 - shade);
-
-      int8_t map_cell;
-      switch (loadParameters.mode) {
-        case MapMode::Trinary:
-          if (loadParameters.occupied_thresh < occ) {
-            map_cell = 100;
-          } else if (occ < loadParameters.free_thresh) {
-            map_cell = 0;
+  // Tells the cell of every possible sum of a pixel's channels, as 16 bit values. The image
+  // is exported as such, so the shade of a pixel is the same as when averaging its quanta.
+  // In Trinary mode the alpha of images that have one is averaged in with the colors.
+  const bool average_alpha = loadParameters.mode == MapMode::Trinary && img.matte();
+  const unsigned int num_channels = average_alpha ? 4 : 3;
+  const unsigned int max_channel = std::numeric_limits<uint16_t>::max();
+  std::vector<int8_t> cell_of_sum(num_channels * max_channel + 1);
+  for (size_t sum = 0; sum < cell_of_sum.size(); sum++) {
+    /// on a scale from 0.0 to 1.0 how bright is the pixel?
+    double shade = static_cast<double>(sum) / num_channels / max_channel;
+
+    // If negate is true, we consider blacker pixels free, and whiter
+    // pixels occupied. Otherwise, it's vice versa.
+    /// on a scale from 0.0 to 1.0, how occupied is the map cell (before thresholding)?
+    double occ = (loadParameters.negate ? shade : 1.0 - shade);
+
+    int8_t map_cell;
+    switch (loadParameters.mode) {
+      case MapMode::Trinary:
+        if (loadParameters.occupied_thresh < occ) {
+          map_cell = 100;
+        } else if (occ < loadParameters.free_thresh) {
+          map_cell = 0;
+        } else {
+          map_cell = -1;
+        }
+        break;
+      case MapMode::Scale:
+        // Pixels that aren't opaque are unknown, which is checked on each pixel
+        if (loadParameters.occupied_thresh < occ) {
+          map_cell = 100;
+        } else if (occ < loadParameters.free_thresh) {
+          map_cell = 0;
+        } else {
+          map_cell = std::rint(
+            (occ - loadParameters.free_thresh) /
+            (loadParameters.occupied_thresh - loadParameters.free_thresh) * 100.0);
+        }
+        break;
+      case MapMode::Raw: {
+          double occ_percent = std::round(shade * 255);
+          if (0 <= occ_percent && occ_percent <= 100) {
+            map_cell = static_cast<int8_t>(occ_percent);
           } else {
             map_cell = -1;
           }
           break;
-        case MapMode::Scale:
-          if (pixel.alphaQuantum() != OpaqueOpacity) {
-            map_cell = -1;
-          } else if (loadParameters.occupied_thresh < occ) {
-            map_cell = 100;
-          } else if (occ < loadParameters.free_thresh) {
-            map_cell = 0;
-          } else {
-            map_cell = std::rint(
-              (occ - loadParameters.free_thresh) /
-              (loadParameters.occupied_thresh - loadParameters.free_thresh) * 100.0);
-          }
-          break;
-        case MapMode::Raw: {
-            double occ_percent = std::round(shade * 255);
-            if (0 <= occ_percent && occ_percent <= 100) {
-              map_cell = static_cast<int8_t>(occ_percent);
-            } else {
-              map_cell = -1;
-            }
-            break;
-          }
-        default:
-          throw std::runtime_error("Invalid map mode");
+        }
+      default:
+        throw std::runtime_error("Invalid map mode");
+    }
+    cell_of_sum[sum] = map_cell;
+  }
+
+  // Export the pixels a band of rows at a time, as red, green, blue and alpha, the alpha
+  // being opaque for images without one. CAREFUL. alpha is exported as you might expect,
+  // high = opaque, which is inverted from the quanta of the image.
+  const size_t width = msg.info.width;
+  const size_t height = msg.info.height;
+  const size_t band_height = std::max<size_t>(1, (1 << 20) / std::max<size_t>(width, 1));
+  std::vector<uint16_t> band(width * std::min(band_height, height) * 4);
+  const bool check_opaque = loadParameters.mode == MapMode::Scale;
+
+  // Copy pixel data into the map structure
+  for (size_t band_y = 0; band_y < height; band_y += band_height) {
+    const size_t rows = std::min(band_height, height - band_y);
+    img.write(0, band_y, width, rows, "RGBA", Magick::ShortPixel, band.data());
+
+    for (size_t row = 0; row < rows; row++) {
+      const size_t y = band_y + row;
+      const uint16_t * pixel = band.data() + row * width * 4;
+      int8_t * cell = msg.data.data() + width * (height - y - 1);
+      for (size_t x = 0; x < width; x++, pixel += 4) {
+        unsigned int sum = pixel[0] + pixel[1] + pixel[2];
+        if (average_alpha) {
+          sum += pixel[3];
+        }
+        cell[x] = (check_opaque && pixel[3] != max_channel) ? -1 : cell_of_sum[sum];
       }
-      msg.data[msg.info.width * (msg.info.height - y - 1) + x] = map_cell;
     }
   }
 
@@ -357,7 +587,8 @@ void OccGridLoader::loadMapFromFile(const LoadParameters & loadParameters)
     node_->get_logger(), "Read map %s: %d X %d map @ %.3lf m/cell",
     loadParameters.image_file_name.c_str(), msg.info.width, msg.info.height, msg.info.resolution);
 
-  *msg_ = msg;
+  // A new message, the last one may still be a map of the map set
+  msg_ = std::make_shared<nav_msgs::msg::OccupancyGrid>(std::move(msg));
 }
 
 }  // namespace nav2_map_server
@@ -0,0 +1,271 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_map_server/tiled_map.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace nav2_map_server
+{
+
+namespace
+{
+
+const char MAGIC[8] = {'N', 'A', 'V', '2', 'T', 'I', 'L', 'E'};
+const uint32_t VERSION = 1;
+const size_t HEADER_SIZE = sizeof(MAGIC) + 4 * sizeof(uint32_t);
+const size_t TILE_ENTRY_SIZE = sizeof(uint64_t) + 2 * sizeof(uint32_t);
+
+template<typename T>
+void put(std::vector<uint8_t> & bytes, T value)
+{
+  const uint8_t * begin = reinterpret_cast<const uint8_t *>(&value);
+  bytes.insert(bytes.end(), begin, begin + sizeof(value));
+}
+
+// The file is only mapped byte aligned, so its integers are copied out
+template<typename T>
+T get(const uint8_t * bytes)
+{
+  T value;
+  std::memcpy(&value, bytes, sizeof(value));
+  return value;
+}
+
+}  // namespace
+
+void TiledMap::write(
+  const std::string & filename, const nav_msgs::msg::OccupancyGrid & map, uint32_t tile_size)
+{
+  const uint32_t width = map.info.width;
+  const uint32_t height = map.info.height;
+  if (tile_size == 0) {
+    throw std::runtime_error("The tile size must be positive");
+  }
+  if (map.data.size() != static_cast<size_t>(width) * height) {
+    throw std::runtime_error("The map has " + std::to_string(map.data.size()) + " cells, not " +
+            std::to_string(static_cast<size_t>(width) * height));
+  }
+  const uint32_t tiles_x = (width + tile_size - 1) / tile_size;
+  const uint32_t tiles_y = (height + tile_size - 1) / tile_size;
+
+  std::vector<Tile> tiles;
+  std::vector<uint8_t> tile_data;
+  std::vector<int8_t> cells;
+  std::vector<uint8_t> encoded;
+  uint64_t offset = HEADER_SIZE + static_cast<uint64_t>(tiles_x) * tiles_y * TILE_ENTRY_SIZE;
+  for (uint32_t tile_y = 0; tile_y < tiles_y; tile_y++) {
+    for (uint32_t tile_x = 0; tile_x < tiles_x; tile_x++) {
+      const uint32_t x0 = tile_x * tile_size;
+      const uint32_t y0 = tile_y * tile_size;
+      const uint32_t columns = std::min(tile_size, width - x0);
+      const uint32_t rows = std::min(tile_size, height - y0);
+      cells.clear();
+      for (uint32_t y = y0; y < y0 + rows; y++) {
+        auto row = map.data.begin() + static_cast<size_t>(y) * width + x0;
+        cells.insert(cells.end(), row, row + columns);
+      }
+
+      encoded.clear();
+      for (size_t i = 0; i < cells.size(); ) {
+        size_t run = 1;
+        while (i + run < cells.size() && run < 255 && cells[i + run] == cells[i]) {
+          run++;
+        }
+        encoded.push_back(static_cast<uint8_t>(run));
+        encoded.push_back(static_cast<uint8_t>(cells[i]));
+        i += run;
+      }
+
+      Tile tile;
+      tile.offset = offset;
+      if (encoded.size() < cells.size()) {
+        tile.size = encoded.size();
+        tile.encoding = RUN_LENGTH;
+        tile_data.insert(tile_data.end(), encoded.begin(), encoded.end());
+      } else {
+        tile.size = cells.size();
+        tile.encoding = RAW;
+        tile_data.insert(tile_data.end(), cells.begin(), cells.end());
+      }
+      offset += tile.size;
+      tiles.push_back(tile);
+    }
+  }
+
+  std::vector<uint8_t> header(MAGIC, MAGIC + sizeof(MAGIC));
+  put<uint32_t>(header, VERSION);
+  put<uint32_t>(header, width);
+  put<uint32_t>(header, height);
+  put<uint32_t>(header, tile_size);
+  for (const Tile & tile : tiles) {
+    put<uint64_t>(header, tile.offset);
+    put<uint32_t>(header, tile.size);
+    put<uint32_t>(header, tile.encoding);
+  }
+
+  std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<const char *>(header.data()), header.size());
+  file.write(reinterpret_cast<const char *>(tile_data.data()), tile_data.size());
+  if (!file) {
+    throw std::runtime_error("Failed to write the tiled map " + filename);
+  }
+}
+
+TiledMap::TiledMap(const std::string & filename)
+{
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("Failed to open the tiled map " + filename);
+  }
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0 || file_stat.st_size < static_cast<off_t>(HEADER_SIZE)) {
+    close(fd);
+    throw std::runtime_error("The tiled map " + filename + " is too small");
+  }
+  size_ = file_stat.st_size;
+  void * mapped = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    throw std::runtime_error("Failed to map the tiled map " + filename);
+  }
+  data_ = static_cast<const uint8_t *>(mapped);
+
+  try {
+    if (std::memcmp(data_, MAGIC, sizeof(MAGIC)) != 0) {
+      throw std::runtime_error("The file " + filename + " isn't a tiled map");
+    }
+    const uint8_t * field = data_ + sizeof(MAGIC);
+    uint32_t version = get<uint32_t>(field);
+    if (version != VERSION) {
+      throw std::runtime_error(
+              "The tiled map " + filename + " has the unsupported version " +
+              std::to_string(version));
+    }
+    width_ = get<uint32_t>(field + 4);
+    height_ = get<uint32_t>(field + 8);
+    tile_size_ = get<uint32_t>(field + 12);
+    if (tile_size_ == 0) {
+      throw std::runtime_error("The tiled map " + filename + " has empty tiles");
+    }
+    tiles_x_ = (width_ + tile_size_ - 1) / tile_size_;
+    tiles_y_ = (height_ + tile_size_ - 1) / tile_size_;
+
+    const size_t num_tiles = static_cast<size_t>(tiles_x_) * tiles_y_;
+    if (size_ < HEADER_SIZE + num_tiles * TILE_ENTRY_SIZE) {
+      throw std::runtime_error("The tile table of " + filename + " is truncated");
+    }
+    tiles_.resize(num_tiles);
+    const uint8_t * entry = data_ + HEADER_SIZE;
+    for (Tile & tile : tiles_) {
+      tile.offset = get<uint64_t>(entry);
+      tile.size = get<uint32_t>(entry + 8);
+      tile.encoding = get<uint32_t>(entry + 12);
+      entry += TILE_ENTRY_SIZE;
+      if (tile.offset > size_ || tile.size > size_ - tile.offset) {
+        throw std::runtime_error("A tile of " + filename + " is past the end of the file");
+      }
+    }
+  } catch (...) {
+    munmap(const_cast<uint8_t *>(data_), size_);
+    throw;
+  }
+}
+
+TiledMap::~TiledMap()
+{
+  munmap(const_cast<uint8_t *>(data_), size_);
+}
+
+const int8_t * TiledMap::tileCells(
+  uint32_t tile_x, uint32_t tile_y, size_t num_cells, std::vector<int8_t> & buffer) const
+{
+  const Tile & tile = tiles_[static_cast<size_t>(tile_y) * tiles_x_ + tile_x];
+  const uint8_t * bytes = data_ + tile.offset;
+
+  switch (tile.encoding) {
+    case RAW:
+      if (tile.size != num_cells) {
+        throw std::runtime_error("A raw tile has the wrong number of cells");
+      }
+      return reinterpret_cast<const int8_t *>(bytes);
+
+    case RUN_LENGTH: {
+        buffer.resize(num_cells);
+        size_t cell = 0;
+        for (size_t i = 0; i + 1 < tile.size; i += 2) {
+          size_t run = bytes[i];
+          if (run > num_cells - cell) {
+            throw std::runtime_error("A run length encoded tile has too many cells");
+          }
+          std::fill_n(buffer.begin() + cell, run, static_cast<int8_t>(bytes[i + 1]));
+          cell += run;
+        }
+        if (cell != num_cells) {
+          throw std::runtime_error("A run length encoded tile has too few cells");
+        }
+        return buffer.data();
+      }
+
+    default:
+      throw std::runtime_error("A tile has the unknown encoding " + std::to_string(tile.encoding));
+  }
+}
+
+void TiledMap::read(
+  uint32_t x, uint32_t y, uint32_t width, uint32_t height, int8_t * cells) const
+{
+  if (x > width_ || width > width_ - x || y > height_ || height > height_ - y) {
+    throw std::runtime_error("The region isn't on the map");
+  }
+  if (width == 0 || height == 0) {
+    return;
+  }
+
+  std::vector<int8_t> buffer;
+  for (uint32_t tile_y = y / tile_size_; tile_y <= (y + height - 1) / tile_size_; tile_y++) {
+    for (uint32_t tile_x = x / tile_size_; tile_x <= (x + width - 1) / tile_size_; tile_x++) {
+      // The tile and the part of it in the region
+      const uint32_t tile_x0 = tile_x * tile_size_;
+      const uint32_t tile_y0 = tile_y * tile_size_;
+      const uint32_t tile_columns = std::min(tile_size_, width_ - tile_x0);
+      const uint32_t tile_rows = std::min(tile_size_, height_ - tile_y0);
+      const uint32_t x0 = std::max(x, tile_x0);
+      const uint32_t x1 = std::min(x + width, tile_x0 + tile_columns);
+      const uint32_t y0 = std::max(y, tile_y0);
+      const uint32_t y1 = std::min(y + height, tile_y0 + tile_rows);
+
+      const int8_t * tile = tileCells(
+        tile_x, tile_y, static_cast<size_t>(tile_columns) * tile_rows, buffer);
+      for (uint32_t row = y0; row < y1; row++) {
+        std::copy(
+          tile + static_cast<size_t>(row - tile_y0) * tile_columns + (x0 - tile_x0),
+          tile + static_cast<size_t>(row - tile_y0) * tile_columns + (x1 - tile_x0),
+          cells + static_cast<size_t>(row - y) * width + (x0 - x));
+      }
+    }
+  }
+}
+
+}  // namespace nav2_map_server
@@ -0,0 +1,212 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_map_server/tiled_map_loader.hpp"
+
+#include <libgen.h>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "lifecycle_msgs/msg/state.hpp"
+#include "nav2_map_server/map_region.hpp"
+#include "nav2_util/geometry_utils.hpp"
+#include "nav2_util/node_utils.hpp"
+#include "yaml-cpp/yaml.h"
+
+namespace nav2_map_server
+{
+using nav2_util::geometry_utils::orientationAroundZAxis;
+
+TiledMapLoader::TiledMapLoader(
+  rclcpp_lifecycle::LifecycleNode::SharedPtr node, std::string & yaml_filename)
+: node_(node), yaml_filename_(yaml_filename)
+{
+  RCLCPP_INFO(node_->get_logger(), "TiledMapLoader: Creating");
+}
+
+TiledMapLoader::~TiledMapLoader()
+{
+  RCLCPP_INFO(node_->get_logger(), "TiledMapLoader: Destroying");
+}
+
+void TiledMapLoader::loadMapFromYaml(const std::string & yaml_filename)
+{
+  YAML::Node doc = YAML::LoadFile(yaml_filename);
+
+  auto tiles_file_name = doc["tiles"].as<std::string>();
+  if (tiles_file_name.empty()) {
+    throw YAML::Exception(doc["tiles"].Mark(), "The tiles tag was empty.");
+  }
+  if (tiles_file_name[0] != '/') {
+    // dirname takes a mutable char *, so we copy into a vector
+    std::vector<char> fname_copy(yaml_filename.begin(), yaml_filename.end());
+    fname_copy.push_back('\0');
+    tiles_file_name = std::string(dirname(fname_copy.data())) + '/' + tiles_file_name;
+  }
+
+  auto origin = doc["origin"].as<std::vector<double>>();
+  if (origin.size() != 3) {
+    throw YAML::Exception(
+            doc["origin"].Mark(), "value of the 'origin' tag should have 3 elements, not " +
+            std::to_string(origin.size()));
+  }
+
+  RCLCPP_INFO(node_->get_logger(), "Mapping tiles_file: %s", tiles_file_name.c_str());
+  tiled_map_ = std::make_unique<TiledMap>(tiles_file_name);
+
+  info_ = nav_msgs::msg::MapMetaData();
+  info_.map_load_time = node_->now();
+  info_.resolution = doc["resolution"].as<double>();
+  info_.width = tiled_map_->getWidth();
+  info_.height = tiled_map_->getHeight();
+  info_.origin.position.x = origin[0];
+  info_.origin.position.y = origin[1];
+  info_.origin.position.z = 0.0;
+  info_.origin.orientation = orientationAroundZAxis(origin[2]);
+
+  RCLCPP_DEBUG(
+    node_->get_logger(), "Mapped map %s: %d X %d map @ %.3lf m/cell in %d cell tiles",
+    tiles_file_name.c_str(), info_.width, info_.height, info_.resolution,
+    tiled_map_->getTileSize());
+}
+
+nav_msgs::msg::OccupancyGrid TiledMapLoader::getRegion(
+  uint32_t x, uint32_t y, uint32_t width, uint32_t height) const
+{
+  nav_msgs::msg::OccupancyGrid msg;
+  msg.header.frame_id = frame_id_;
+  msg.header.stamp = node_->now();
+  msg.info = getRegionInfo(info_, x, y, width, height);
+  msg.data.resize(static_cast<size_t>(width) * height);
+  tiled_map_->read(x, y, width, height, msg.data.data());
+  return msg;
+}
+
+nav2_util::CallbackReturn TiledMapLoader::on_configure(const rclcpp_lifecycle::State & /*state*/)
+{
+  RCLCPP_INFO(node_->get_logger(), "TiledMapLoader: Configuring");
+
+  try {
+    loadMapFromYaml(yaml_filename_);
+  } catch (YAML::Exception & e) {
+    throw std::runtime_error(
+            "Failed processing YAML file " + yaml_filename_ + " for reason: " + e.what());
+  }
+
+  node_->get_parameter("publish_full_map", publish_full_map_);
+
+  // Create GetMap service callback handle
+  auto handle_occ_callback = [this](
+    const std::shared_ptr<rmw_request_id_t>/*request_header*/,
+    const std::shared_ptr<nav_msgs::srv::GetMap::Request>/*request*/,
+    std::shared_ptr<nav_msgs::srv::GetMap::Response> response) -> void {
+      if (node_->get_current_state().id() != lifecycle_msgs::msg::State::PRIMARY_STATE_ACTIVE) {
+        RCLCPP_WARN(
+          node_->get_logger(),
+          "Received GetMap request but not in ACTIVE state, ignoring!");
+        return;
+      }
+      RCLCPP_INFO(node_->get_logger(), "TiledMapLoader: Handling GetMap request");
+      try {
+        response->map = getRegion(0, 0, info_.width, info_.height);
+      } catch (std::exception & e) {
+        RCLCPP_ERROR(node_->get_logger(), "Failed to read the map: %s", e.what());
+      }
+    };
+
+  // Create a service that provides the occupancy grid
+  occ_service_ = node_->create_service<nav_msgs::srv::GetMap>(service_name_, handle_occ_callback);
+
+  // Create GetMapRegion service callback handle
+  auto handle_region_callback = [this](
+    const std::shared_ptr<rmw_request_id_t>/*request_header*/,
+    const std::shared_ptr<nav2_msgs::srv::GetMapRegion::Request> request,
+    std::shared_ptr<nav2_msgs::srv::GetMapRegion::Response> response) -> void {
+      if (node_->get_current_state().id() != lifecycle_msgs::msg::State::PRIMARY_STATE_ACTIVE) {
+        RCLCPP_WARN(
+          node_->get_logger(),
+          "Received GetMapRegion request but not in ACTIVE state, ignoring!");
+        return;
+      }
+      uint32_t x, y, width, height;
+      if (!getRegionCells(
+          info_, request->min_x, request->min_y, request->max_x, request->max_y,
+          x, y, width, height))
+      {
+        RCLCPP_WARN(node_->get_logger(), "The requested map region is off the map");
+        response->map.header.frame_id = frame_id_;
+        response->map.header.stamp = node_->now();
+        response->map.info = getRegionInfo(info_, 0, 0, 0, 0);
+        return;
+      }
+      RCLCPP_DEBUG(
+        node_->get_logger(), "TiledMapLoader: Serving %d X %d cells at (%d, %d)",
+        width, height, x, y);
+      try {
+        response->map = getRegion(x, y, width, height);
+      } catch (std::exception & e) {
+        RCLCPP_ERROR(node_->get_logger(), "Failed to read the map region: %s", e.what());
+      }
+    };
+
+  // Create a service that provides regions of the occupancy grid
+  region_service_ = node_->create_service<nav2_msgs::srv::GetMapRegion>(
+    region_service_name_, handle_region_callback);
+
+  // Create a publisher using the QoS settings to emulate a ROS1 latched topic
+  occ_pub_ = node_->create_publisher<nav_msgs::msg::OccupancyGrid>(
+    topic_name_,
+    rclcpp::QoS(rclcpp::KeepLast(1)).transient_local().reliable(),
+    nav2_util::get_inter_process_publisher_options());
+
+  return nav2_util::CallbackReturn::SUCCESS;
+}
+
+nav2_util::CallbackReturn TiledMapLoader::on_activate(const rclcpp_lifecycle::State & /*state*/)
+{
+  RCLCPP_INFO(node_->get_logger(), "TiledMapLoader: Activating");
+
+  occ_pub_->on_activate();
+  if (publish_full_map_) {
+    // The only time the whole map is read, unless it's asked for on the map service
+    occ_pub_->publish(getRegion(0, 0, info_.width, info_.height));
+  }
+
+  return nav2_util::CallbackReturn::SUCCESS;
+}
+
+nav2_util::CallbackReturn TiledMapLoader::on_deactivate(const rclcpp_lifecycle::State & /*state*/)
+{
+  RCLCPP_INFO(node_->get_logger(), "TiledMapLoader: Deactivating");
+
+  occ_pub_->on_deactivate();
+
+  return nav2_util::CallbackReturn::SUCCESS;
+}
+
+nav2_util::CallbackReturn TiledMapLoader::on_cleanup(const rclcpp_lifecycle::State & /*state*/)
+{
+  RCLCPP_INFO(node_->get_logger(), "TiledMapLoader: Cleaning up");
+
+  occ_pub_.reset();
+  occ_service_.reset();
+  region_service_.reset();
+  tiled_map_.reset();
+
+  return nav2_util::CallbackReturn::SUCCESS;
+}
+
+}  // namespace nav2_map_server
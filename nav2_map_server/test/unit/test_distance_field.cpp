@@ -0,0 +1,102 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <experimental/filesystem>
+#include <cmath>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "nav2_map_server/distance_field.hpp"
+
+using std::experimental::filesystem::path;
+using std::experimental::filesystem::temp_directory_path;
+using nav2_map_server::DISTANCE_FIELD_MAX;
+
+nav_msgs::msg::OccupancyGrid makeMap(uint32_t width, uint32_t height)
+{
+  nav_msgs::msg::OccupancyGrid map;
+  map.info.width = width;
+  map.info.height = height;
+  map.info.resolution = 0.05;
+  map.data.resize(width * height);
+  std::srand(5);
+  for (auto & cell : map.data) {
+    cell = std::rand() % 150 == 0 ? 100 : std::rand() % 3 == 0 ? -1 : 0;
+  }
+  return map;
+}
+
+TEST(DistanceFieldTest, distances)
+{
+  auto map = makeMap(120, 80);
+  map.data.assign(map.data.size(), 0);
+  map.data[40 * 120 + 60] = 100;
+  nav2_util::ThreadPool pool(2);
+  std::vector<uint8_t> field;
+  nav2_map_server::computeDistanceField(map, 1.0, pool, field);
+
+  ASSERT_EQ(field.size(), map.data.size());
+  EXPECT_EQ(field[40 * 120 + 60], 0);
+  // 10 cells away is half a meter, half of the maximum
+  EXPECT_NEAR(field[40 * 120 + 70], 128, 1);
+  EXPECT_NEAR(field[50 * 120 + 60], 128, 1);
+  // Farther than a meter
+  EXPECT_EQ(field[40 * 120 + 81], DISTANCE_FIELD_MAX);
+  EXPECT_EQ(field[0], DISTANCE_FIELD_MAX);
+}
+
+TEST(DistanceFieldTest, updateMatchesCompute)
+{
+  auto map = makeMap(150, 110);
+  nav2_util::ThreadPool pool(3);
+  std::vector<uint8_t> field;
+  nav2_map_server::computeDistanceField(map, 0.5, pool, field);
+
+  std::vector<uint8_t> expected;
+  for (int edit = 0; edit < 20; edit++) {
+    uint32_t x = std::rand() % 140, y = std::rand() % 100;
+    uint32_t width = std::rand() % 10 + 1, height = std::rand() % 10 + 1;
+    for (uint32_t j = y; j < y + height; j++) {
+      for (uint32_t i = x; i < x + width; i++) {
+        map.data[j * 150 + i] = std::rand() % 4 == 0 ? 100 : 0;
+      }
+    }
+    nav2_map_server::updateDistanceField(map, 0.5, x, y, width, height, pool, field);
+    nav2_map_server::computeDistanceField(map, 0.5, pool, expected);
+    ASSERT_EQ(field, expected) << "after edit " << edit;
+  }
+}
+
+TEST(DistanceFieldTest, cache)
+{
+  auto map = makeMap(64, 32);
+  nav2_util::ThreadPool pool(1);
+  std::vector<uint8_t> field;
+  nav2_map_server::computeDistanceField(map, 1.0, pool, field);
+
+  EXPECT_EQ(nav2_map_server::hashMap(map, 1.0), nav2_map_server::hashMap(map, 1.0));
+  EXPECT_NE(nav2_map_server::hashMap(map, 1.0), nav2_map_server::hashMap(map, 2.0));
+
+  std::string filename = (temp_directory_path() / path("test_distance_field.bin")).string();
+  ASSERT_TRUE(nav2_map_server::writeCachedField(filename, field));
+  std::vector<uint8_t> cached;
+  ASSERT_TRUE(nav2_map_server::readCachedField(filename, map, cached));
+  EXPECT_EQ(cached, field);
+
+  // A field of another size isn't taken for this map's
+  map.info.width = 32;
+  EXPECT_FALSE(nav2_map_server::readCachedField(filename, map, cached));
+}
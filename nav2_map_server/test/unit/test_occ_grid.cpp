@@ -32,6 +32,7 @@
 /* Author: Brian Gerkey */
 
 #include <gtest/gtest.h>
+#include <cstdio>
 #include <experimental/filesystem>
 #include <stdexcept>
 #include <string>
@@ -64,6 +65,7 @@ class TestMapLoader : public nav2_map_server::OccGridLoader
   FRIEND_TEST(MapLoaderTest, loadValidPNG);
   FRIEND_TEST(MapLoaderTest, loadValidBMP);
   FRIEND_TEST(MapLoaderTest, loadInvalidFile);
+  FRIEND_TEST(MapLoaderTest, switchWithinMapSet);
 
 public:
   explicit TestMapLoader(nav2_util::LifecycleNode::SharedPtr node, std::string yaml_filename)
@@ -214,3 +216,36 @@ TEST_F(MapLoaderTest, loadInvalidFile)
 
   ASSERT_ANY_THROW(map_loader_->loadMapFromFile(loadParameters));
 }
+
+// Preload two maps as a map set and switch between them. Succeeds if each switch
+// serves the map of the set as it was loaded, with the edits made while it was served.
+
+TEST_F(MapLoaderTest, switchWithinMapSet)
+{
+  auto first_floor = (path(TEST_DIR) / path(g_valid_yaml_file)).string();
+  std::string second_floor("/tmp/map_set_unit_test.yaml");
+  std::ofstream yaml_file(second_floor, std::ofstream::out | std::ofstream::trunc);
+  yaml_file << "image: " << (path(TEST_DIR) / path(g_valid_bmp_file)).string() << std::endl;
+  yaml_file << "resolution: 0.5" << std::endl;
+  yaml_file << "origin: [0.0, 0.0, 0.0]" << std::endl;
+  yaml_file << "negate: 0" << std::endl;
+  yaml_file << "occupied_thresh: 0.65" << std::endl;
+  yaml_file << "free_thresh: 0.196" << std::endl;
+  yaml_file.close();
+
+  ASSERT_NO_THROW(map_loader_->preloadMapSet({first_floor, second_floor}));
+  EXPECT_FALSE(map_loader_->selectFloor("/tmp/not_in_the_set.yaml"));
+
+  ASSERT_TRUE(map_loader_->selectFloor(first_floor));
+  EXPECT_FLOAT_EQ(map_loader_->getOccupancyGrid().info.resolution, g_valid_image_res);
+  map_loader_->msg_->data[0] = 42;
+
+  ASSERT_TRUE(map_loader_->selectFloor(second_floor));
+  nav_msgs::msg::OccupancyGrid map_msg = map_loader_->getOccupancyGrid();
+  EXPECT_FLOAT_EQ(map_msg.info.resolution, 0.5);
+  EXPECT_EQ(map_msg.data[0], g_valid_image_content[0]);
+
+  ASSERT_TRUE(map_loader_->selectFloor(first_floor));
+  EXPECT_EQ(map_loader_->getOccupancyGrid().data[0], 42);
+  std::remove(second_floor.c_str());
+}
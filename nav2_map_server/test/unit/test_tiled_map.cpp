@@ -0,0 +1,106 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <gtest/gtest.h>
+#include <experimental/filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "nav2_map_server/map_region.hpp"
+#include "nav2_map_server/tiled_map.hpp"
+
+using std::experimental::filesystem::path;
+using std::experimental::filesystem::temp_directory_path;
+using nav2_map_server::TiledMap;
+
+// A map with runs of cells, which compress, and cells that don't
+nav_msgs::msg::OccupancyGrid makeMap(uint32_t width, uint32_t height)
+{
+  nav_msgs::msg::OccupancyGrid map;
+  map.info.width = width;
+  map.info.height = height;
+  map.info.resolution = 0.05;
+  map.data.resize(width * height);
+  for (uint32_t y = 0; y < height; y++) {
+    for (uint32_t x = 0; x < width; x++) {
+      map.data[y * width + x] = y < height / 2 ? (x / 7) % 2 * 100 : (x * 31 + y * 17) % 102 - 1;
+    }
+  }
+  return map;
+}
+
+TEST(TiledMapTest, readRegions)
+{
+  auto map = makeMap(130, 75);
+  std::string filename = (temp_directory_path() / path("test_tiled_map.tiles")).string();
+  TiledMap::write(filename, map, 32);
+
+  TiledMap tiled_map(filename);
+  ASSERT_EQ(tiled_map.getWidth(), 130u);
+  ASSERT_EQ(tiled_map.getHeight(), 75u);
+  ASSERT_EQ(tiled_map.getTileSize(), 32u);
+
+  // The whole map, a region within a tile and one across several, with edge tiles
+  const uint32_t regions[][4] = {{0, 0, 130, 75}, {33, 3, 10, 20}, {20, 30, 110, 45}};
+  for (const auto & region : regions) {
+    std::vector<int8_t> cells(region[2] * region[3]);
+    tiled_map.read(region[0], region[1], region[2], region[3], cells.data());
+    for (uint32_t y = 0; y < region[3]; y++) {
+      for (uint32_t x = 0; x < region[2]; x++) {
+        EXPECT_EQ(cells[y * region[2] + x], map.data[(region[1] + y) * 130 + region[0] + x]);
+      }
+    }
+  }
+
+  std::vector<int8_t> cells(10);
+  EXPECT_THROW(tiled_map.read(125, 0, 10, 1, cells.data()), std::runtime_error);
+}
+
+TEST(TiledMapTest, invalidFile)
+{
+  std::string filename = (temp_directory_path() / path("test_tiled_map_invalid.tiles")).string();
+  std::ofstream(filename) << "This is not a tiled map";
+  EXPECT_THROW(TiledMap tiled_map(filename), std::runtime_error);
+  EXPECT_THROW(TiledMap tiled_map("/nonexistent/map.tiles"), std::runtime_error);
+}
+
+TEST(TiledMapTest, regionCells)
+{
+  nav_msgs::msg::MapMetaData info;
+  info.width = 100;
+  info.height = 50;
+  info.resolution = 0.1;
+  info.origin.position.x = -2.0;
+  info.origin.position.y = 1.0;
+  info.origin.orientation.w = 1.0;
+
+  uint32_t x, y, width, height;
+  ASSERT_TRUE(nav2_map_server::getRegionCells(info, -1.0, 1.5, 0.0, 2.05, x, y, width, height));
+  EXPECT_EQ(x, 10u);
+  EXPECT_EQ(y, 5u);
+  EXPECT_EQ(width, 10u);
+  EXPECT_EQ(height, 6u);
+
+  auto region = nav2_map_server::getRegionInfo(info, x, y, width, height);
+  EXPECT_NEAR(region.origin.position.x, -1.0, 1e-9);
+  EXPECT_NEAR(region.origin.position.y, 1.5, 1e-9);
+
+  // Clipped to the map, or off it
+  ASSERT_TRUE(nav2_map_server::getRegionCells(info, -9.0, -9.0, 99.0, 99.0, x, y, width, height));
+  EXPECT_EQ(width, 100u);
+  EXPECT_EQ(height, 50u);
+  EXPECT_FALSE(nav2_map_server::getRegionCells(info, 20.0, 20.0, 21.0, 21.0, x, y, width, height));
+}
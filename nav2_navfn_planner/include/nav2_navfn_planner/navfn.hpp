@@ -44,6 +44,10 @@
 #include <string.h>
 #include <stdio.h>
 
+#include <memory>
+
+#include "nav2_util/thread_pool.hpp"
+
 namespace nav2_navfn_planner
 {
 
@@ -78,6 +82,14 @@ namespace nav2_navfn_planner
 // priority buffers
 #define PRIORITYBUFSIZE 10000
 
+// smallest priority block the Dijkstra propagation spreads over its threads
+#define PARALLELBLOCKSIZE 1024
+
+// scale on the Euclidean distance heuristic of the heap-based search, per cell
+// at COST_NEUTRAL; kept below the 0.704 of the cheapest planar-wave step, so
+// the heuristic stays consistent and cells aren't expanded over and over
+#define HEURISTIC_SCALE 0.7
+
 /**
   Navigation function call.
   \param costmap Cost map array, of type COSTTYPE; origin is upper left
@@ -113,12 +125,14 @@ public:
   ~NavFn();
 
   /**
-   * @brief  Sets or resets the size of the map
+   * @brief  Sets or resets the size of the map. The cell arrays are only reallocated
+   * when they grow, and left untouched, translated costs included, if the size is unchanged
    * @param nx The x size of the map
    * @param ny The y size of the map
    */
   void setNavArr(int nx, int ny);
   int nx, ny, ns;  /**< size of grid, in pixels */
+  int nsmax;  /**< number of cells the arrays are allocated for */
 
   /**
    * @brief  Set up the cost array for the planner, usually from ROS
@@ -129,6 +143,21 @@ public:
    */
   void setCostmap(const COSTTYPE * cmap, bool isROS = true, bool allow_unknown = true);
 
+  /**
+   * @brief  Translate only the cells in [x0, xn) x [y0, yn) of a ROS costmap the
+   * size of the planner's, leaving the rest of the cost array as it is
+   * @param cmap The costmap
+   * @param x0 The lower x bound, inclusive
+   * @param y0 The lower y bound, inclusive
+   * @param xn The upper x bound, exclusive
+   * @param yn The upper y bound, exclusive
+   * @param allow_unknown Whether or not the planner should be allowed to plan through
+   *   unknown space
+   */
+  void setCostmapRegion(
+    const COSTTYPE * cmap, int x0, int y0, int xn, int yn,
+    bool allow_unknown = true);
+
   /**
    * @brief  Calculates a plan using the A* heuristic, returns true if one is found
    * @return True if a plan is found, false otherwise
@@ -140,6 +169,59 @@ public:
    */
   bool calcNavFnDijkstra(bool atStart = false);
 
+  /**
+   * @brief Calculates the navigation function with an indexed binary heap
+   * instead of the priority blocks, so no cell is ever dropped on overflow
+   * @param astar Whether to order the expansion with the A* heuristic
+   * @param atStart Whether or not to stop when the start point is reached,
+   *   always true with the A* heuristic
+   * @return True if the start point is reached, or the propagation finished
+   */
+  bool calcNavFnHeap(bool astar, bool atStart = false);
+
+  /**
+   * @brief Calculates the navigation function with the priority blocks, as
+   * calcNavFnDijkstra(true) or calcNavFnAstar() would, but only over a window around the
+   * goal and the start: the box holding the goal and startRadius around the start, grown
+   * by margin cells on each side. Only the window is set up and propagated, so a short
+   * plan costs in the cells around it rather than in the map. If the start isn't reached,
+   * the margin is doubled and the search redone, up to the whole map. Potentials outside
+   * the window are left over from earlier calls, see inWindow().
+   * @param margin The cells to grow the box by at first
+   * @param astar Whether to order the expansion with the A* heuristic
+   * @return True if the start point is reached
+   */
+  bool calcNavFnBounded(int margin, bool astar);
+
+  /**
+   * @brief  Whether the last navigation function covers a cell, always true but after
+   * calcNavFnBounded()
+   */
+  bool inWindow(int x, int y) const
+  {
+    return x >= window[0] && y >= window[1] && x <= window[2] && y <= window[3];
+  }
+  int window[4];  /**< x0, y0, x1, y1 of the cells the potentials are current in */
+
+  /**
+   * @brief Calculates the full navigation function of each of several goals by fast
+   * sweeping: passes of the planar-wave update over the whole cost array, in the four
+   * diagonal orders, until no potential drops any more. The fields are computed on the
+   * thread pool if there is one, one goal per thread, and only read the cost array, which
+   * must be set. The map border is taken as obstacles, as by the other methods.
+   * @param goals The x and y of each goal cell, 2 * count values
+   * @param count The number of goals
+   * @param potentials For each goal, an array of ns potentials to fill
+   */
+  void calcNavFnSweepBatch(const int * goals, int count, float * const * potentials) const;
+
+  /**
+   * @brief Makes a potential field computed elsewhere, such as by calcNavFnSweepBatch(),
+   * the one calcPath() descends
+   * @param potential ns potentials
+   */
+  void setPotential(const float * potential);
+
   /**
    * @brief  Accessor for the x-coordinates of a path
    * @return The x-coordinates of a path
@@ -175,6 +257,22 @@ public:
   int * curP, * nextP, * overP;  /**< priority buffer block ptrs */
   int curPe, nextPe, overPe;  /**< end points of arrays */
 
+  /**
+   * @brief  Sets the threads the Dijkstra propagation updates large priority blocks on,
+   * see updateBlockParallel()
+   * @param pool The thread pool, or null to update every cell in turn
+   */
+  void setThreadPool(std::shared_ptr<nav2_util::ThreadPool> pool);
+  std::shared_ptr<nav2_util::ThreadPool> threadPool;  /**< null when updating serially */
+  float * blockpot;  /**< new potential of each cell of the current block */
+  unsigned char * blockpush;  /**< neighbors to queue for each cell of the current block */
+
+  /** indexed binary heap */
+  int * heap;  /**< cell indices, ordered as a binary min-heap */
+  int * heappos;  /**< position of each cell in the heap, -1 if not queued */
+  float * heapkey;  /**< priority of each queued cell */
+  int heapn;  /**< number of cells in the heap */
+
   /** block priority thresholds */
   float curT;  /**< current threshold */
   float priInc;  /**< priority threshold increment */
@@ -198,6 +296,25 @@ public:
 
   int goal[2];
   int start[2];
+
+  /**
+   * @brief  Sets how far around the start the propagation has to reach before it
+   * stops at the start, so that points within a goal tolerance get a potential too
+   * @param radius Half the side of the square around the start, in cells
+   */
+  void setStartRadius(int radius);
+  int startRadius;  /**< half the side of the square to settle around the start */
+  int settleCursor;  /**< cells of that square known to be settled */
+
+  /**
+   * @brief  Whether the start cell, and the free cells within startRadius of it,
+   * have a potential. Once the propagation front is far enough above the start's
+   * potential, what is still unreached can only be reached around obstacles and
+   * is not waited for.
+   * @param frontier The lowest potential still being propagated
+   * @return True if the propagation can stop
+   */
+  bool startSettled(float frontier);
   /**
    * @brief  Initialize cell k with cost v for propagation
    * @param k the cell to initialize
@@ -213,6 +330,22 @@ public:
    */
   void updateCell(int n);
 
+  /**
+   * @brief  Computes the update of cell curP[k] without applying it, into blockpot[k]
+   * and blockpush[k]
+   * @param k The position of the cell in the current priority block
+   */
+  void computeCellUpdate(int k);
+
+  /**
+   * @brief  Updates the cells of the current priority block on the thread pool: their new
+   * potentials are computed in parallel from the potentials before the block, then applied
+   * and their neighbors queued in block order, so the result doesn't depend on the number
+   * of threads. Unlike with updateCell(), a cell doesn't see the update of a cell before it
+   * in the same block; the neighbors it would have used are queued again instead.
+   */
+  void updateBlockParallel();
+
   /**
    * @brief  Updates the cell at index n using the A* heuristic
    * @param n The index to update
@@ -221,6 +354,19 @@ public:
 
   void setupNavFn(bool keepit = false);
 
+  /**
+   * @brief  Set up the propagation arrays in the window [x0, x1] x [y0, y1] only, which
+   * must be off the map border. A ring of two cells around it is set as pending, so the
+   * propagation never leaves the window, and as unreached, so the gradients at its edge
+   * don't see the stale potentials beyond
+   */
+  void setupNavFnWindow(int x0, int y0, int x1, int y1);
+
+  /**
+   * @brief  Empty the priority blocks and seed them from the goal
+   */
+  void seedPropagation();
+
   /**
    * @brief  Run propagation for <cycles> iterations, or until start is reached using
    * breadth-first Dijkstra method
@@ -238,6 +384,36 @@ public:
    */
   bool propNavFnAstar(int cycles);  /**< returns true if start point found */
 
+  /**
+   * @brief  Run propagation for <cycles> cell expansions, or until start is reached,
+   * taking cells from the heap in order of potential (plus the heuristic for A*)
+   * @param cycles The maximum number of cells to expand
+   * @param astar Whether to add the Euclidean distance heuristic to the priority
+   * @param atStart Whether or not to stop when the start point is reached
+   * @return true if the start point is reached, or the heap ran empty
+   */
+  bool propNavFnHeap(int cycles, bool astar, bool atStart);
+
+  /**
+   * @brief  Updates the cell at index n and queues its improvable neighbors on the heap
+   * @param n The index to update
+   * @param astar Whether to add the Euclidean distance heuristic to the priority
+   */
+  void updateCellHeap(int n, bool astar);
+
+  /**
+   * @brief  Queues cell n with priority key, or lowers its priority if already queued
+   * @param n The cell to queue
+   * @param key The priority of the cell
+   */
+  void heapPush(int n, float key);
+
+  /**
+   * @brief  Removes the cell with the lowest priority from the heap
+   * @return The index of the cell removed
+   */
+  int heapPop();
+
   /** gradient and paths */
   float * gradx, * grady;  /**< gradient arrays, size of potential array */
   float * pathx, * pathy;  /**< path points, as subpixel cell coordinates */
@@ -20,6 +20,7 @@
 #include <chrono>
 #include <string>
 #include <memory>
+#include <mutex>
 #include <vector>
 
 #include "geometry_msgs/msg/point.hpp"
@@ -61,6 +62,12 @@ public:
     const geometry_msgs::msg::PoseStamped & start,
     const geometry_msgs::msg::PoseStamped & goal) override;
 
+  // plugin create paths to several goals from a single propagation
+  std::vector<nav_msgs::msg::Path> createPlans(
+    const geometry_msgs::msg::PoseStamped & start,
+    const std::vector<geometry_msgs::msg::PoseStamped> & goals,
+    std::vector<double> & costs) override;
+
 protected:
   // Compute a plan given start and goal poses, provided in global world frame.
   bool makePlan(
@@ -68,6 +75,12 @@ protected:
     const geometry_msgs::msg::Pose & goal, double tolerance,
     nav_msgs::msg::Path & plan);
 
+  // Extract a plan to the point closest to goal, within tolerance, that has a potential
+  // - must compute the potential first. The cost is the potential at the end of the plan
+  bool getPlanNearGoal(
+    const geometry_msgs::msg::Pose & goal, double tolerance,
+    nav_msgs::msg::Path & plan, double & cost);
+
   // Compute the navigation function given a seed point in the world to start from
   bool computePotential(const geometry_msgs::msg::Point & world_point);
 
@@ -113,6 +126,23 @@ protected:
   // Determine if a new planner object should be made
   bool isPlannerOutOfDate();
 
+  // Bring the planner's cost array up to date, translating only what changed since last time
+  void updatePlannerCostmap();
+
+  // Whether the potential field last computed propagated from origin, on the current
+  // costmap, and reached every cell within radius of target or the whole map
+  bool isPotentialCached(int origin, int target, int radius) const;
+
+  // Record what the potential field just computed covers
+  void cachePotential(int origin, int target, int radius, bool complete, bool result);
+
+  // Store the changes to tolerance, use_astar and allow_unknown, for the next plan to apply
+  void on_parameter_event_callback(const rcl_interfaces::msg::ParameterEvent::SharedPtr event);
+
+  // Apply the parameters changed since the last plan, dropping only the cached
+  // potentials and cost translation they invalidate
+  void applyParameterChanges();
+
   // Planner based on ROS1 NavFn algorithm
   std::unique_ptr<NavFn> planner_;
 
@@ -137,6 +167,57 @@ protected:
 
   // Whether to use the astar planner or default dijkstras
   bool use_astar_;
+
+  // The values those three were last set to at runtime
+  std::mutex parameters_mutex_;
+  bool parameters_changed_{false};
+  bool new_allow_unknown_, new_use_astar_;
+  double new_tolerance_;
+  rclcpp::AsyncParametersClient::SharedPtr parameters_client_;
+  rclcpp::Subscription<rcl_interfaces::msg::ParameterEvent>::SharedPtr parameter_event_sub_;
+
+  // Change count of the costmap when it was last translated, valid if costmap_translated_
+  uint64_t costmap_change_count_{0};
+  bool costmap_translated_{false};
+
+  // What the potential field in planner_ was computed for, see isPotentialCached()
+  bool potential_valid_{false};
+  int potential_origin_{0};
+  int potential_target_{0};
+  int potential_radius_{0};
+  bool potential_complete_{false};
+  bool potential_result_{false};
+  uint64_t potential_change_count_{0};
+
+  // Whether to order the propagation with a binary heap instead of the priority blocks
+  bool use_heap_;
+
+  // When positive, plans are searched for within this many meters around the robot and the
+  // goal first, see NavFn::calcNavFnBounded()
+  double search_margin_;
+
+  // A frequent goal, from the station_goals parameter, and the potential field rooted at
+  // it, which is valid for the costmap as of change_count
+  struct Station
+  {
+    double x, y;
+    int cell;
+    std::vector<float> potential;
+    bool valid{false};
+    uint64_t change_count{0};
+    double origin_x, origin_y;
+  };
+  std::vector<Station> stations_;
+
+  // Recompute the fields of the stations the costmap changed under since, all in one batch
+  void updateStationFields();
+
+  // Plan to a station by descending its field from start, with no search. Returns false
+  // if goal is not on a station, or the field doesn't reach start
+  bool planFromStation(
+    const geometry_msgs::msg::Pose & start,
+    const geometry_msgs::msg::Pose & goal,
+    nav_msgs::msg::Path & plan);
 };
 
 }  // namespace nav2_navfn_planner
@@ -44,7 +44,11 @@
 #include "nav2_navfn_planner/navfn.hpp"
 
 #include <algorithm>
+#include <cmath>
+#include <type_traits>
 #include "rclcpp/rclcpp.hpp"
+#include "nav2_util/large_buffer.hpp"
+#include "nav2_util/trace.hpp"
 
 namespace nav2_navfn_planner
 {
@@ -75,7 +79,8 @@ create_nav_plan_astar(
   nav->setGoal(goal);
   nav->setStart(start);
 
-  nav->costarr = costmap;
+  // copied, costarr being the navigator's own buffer
+  memcpy(nav->costarr, costmap, nx * ny * sizeof(COSTTYPE));
   nav->setupNavFn(true);
 
   // calculate the nav fn and path
@@ -113,12 +118,18 @@ NavFn::NavFn(int xs, int ys)
   potarr = NULL;
   pending = NULL;
   gradx = grady = NULL;
+  heap = heappos = NULL;
+  heapkey = NULL;
+  heapn = 0;
+  nx = ny = ns = nsmax = 0;
   setNavArr(xs, ys);
 
   // priority buffers
   pb1 = new int[PRIORITYBUFSIZE];
   pb2 = new int[PRIORITYBUFSIZE];
   pb3 = new int[PRIORITYBUFSIZE];
+  blockpot = new float[PRIORITYBUFSIZE];
+  blockpush = new unsigned char[PRIORITYBUFSIZE];
 
   // for Dijkstra (breadth-first), set to COST_NEUTRAL
   // for A* (best-first), set to COST_NEUTRAL
@@ -127,6 +138,8 @@ NavFn::NavFn(int xs, int ys)
   // goal and start
   goal[0] = goal[1] = 0;
   start[0] = start[1] = 0;
+  startRadius = 0;
+  settleCursor = 0;
 
   // display function
   displayFn = NULL;
@@ -141,21 +154,11 @@ NavFn::NavFn(int xs, int ys)
 
 NavFn::~NavFn()
 {
-  if (costarr) {
-    delete[] costarr;
-  }
-  if (potarr) {
-    delete[] potarr;
-  }
-  if (pending) {
-    delete[] pending;
-  }
-  if (gradx) {
-    delete[] gradx;
-  }
-  if (grady) {
-    delete[] grady;
-  }
+  nav2_util::free_large_buffer(costarr);
+  nav2_util::free_large_buffer(potarr);
+  nav2_util::free_large_buffer(pending);
+  nav2_util::free_large_buffer(gradx);
+  nav2_util::free_large_buffer(grady);
   if (pathx) {
     delete[] pathx;
   }
@@ -171,6 +174,11 @@ NavFn::~NavFn()
   if (pb3) {
     delete[] pb3;
   }
+  delete[] blockpot;
+  delete[] blockpush;
+  nav2_util::free_large_buffer(heap);
+  nav2_util::free_large_buffer(heappos);
+  nav2_util::free_large_buffer(heapkey);
 }
 
 
@@ -196,6 +204,44 @@ NavFn::setStart(int * g)
     start[1]);
 }
 
+void
+NavFn::setStartRadius(int radius)
+{
+  startRadius = radius;
+}
+
+bool
+NavFn::startSettled(float frontier)
+{
+  int startCell = start[1] * nx + start[0];
+  if (potarr[startCell] >= POT_HIGH) {
+    return false;
+  }
+  if (startRadius <= 0) {
+    return true;
+  }
+
+  // a cell reached along a path through the square costs at most this much more
+  if (frontier > potarr[startCell] + 2.0f * startRadius * COST_OBS) {
+    return true;
+  }
+
+  // the outer border is an obstacle, so leave it out
+  int x0 = std::max(start[0] - startRadius, 1);
+  int x1 = std::min(start[0] + startRadius, nx - 2);
+  int y0 = std::max(start[1] - startRadius, 1);
+  int y1 = std::min(start[1] + startRadius, ny - 2);
+  int w = x1 - x0 + 1;
+  int n = w * (y1 - y0 + 1);
+  for (; settleCursor < n; settleCursor++) {
+    int k = (y0 + settleCursor / w) * nx + x0 + settleCursor % w;
+    if (costarr[k] < COST_OBS && potarr[k] >= POT_HIGH) {
+      return false;
+    }
+  }
+  return true;
+}
+
 //
 // Set/Reset map size
 //
@@ -205,34 +251,45 @@ NavFn::setNavArr(int xs, int ys)
 {
   RCLCPP_DEBUG(rclcpp::get_logger("rclcpp"), "[NavFn] Array is %d x %d\n", xs, ys);
 
+  if (xs == nx && ys == ny && costarr) {
+    return;  // same size, keep the arrays and the translated costs
+  }
+
   nx = xs;
   ny = ys;
   ns = nx * ny;
-
-  if (costarr) {
-    delete[] costarr;
-  }
-  if (potarr) {
-    delete[] potarr;
-  }
-  if (pending) {
-    delete[] pending;
+  window[0] = window[1] = 0;
+  window[2] = nx - 1;
+  window[3] = ny - 1;
+
+  // keep the buffers when they are large enough, they only ever grow
+  if (ns <= nsmax) {
+    memset(costarr, 0, ns * sizeof(COSTTYPE));
+    memset(pending, 0, ns * sizeof(bool));
+    heapn = 0;
+    return;
   }
+  nsmax = ns;
 
-  if (gradx) {
-    delete[] gradx;
-  }
-  if (grady) {
-    delete[] grady;
-  }
+  // backed by huge pages, as propagation reads and writes them all over the map
+  auto allocate = [this](auto & array) {
+      using T = typename std::remove_reference<decltype(*array)>::type;
+      nav2_util::free_large_buffer(array);
+      array = static_cast<T *>(nav2_util::allocate_large_buffer(ns * sizeof(T)));
+    };
 
-  costarr = new COSTTYPE[ns];  // cost array, 2d config space
+  allocate(costarr);  // cost array, 2d config space
   memset(costarr, 0, ns * sizeof(COSTTYPE));
-  potarr = new float[ns];  // navigation potential array
-  pending = new bool[ns];
+  allocate(potarr);  // navigation potential array
+  allocate(pending);
   memset(pending, 0, ns * sizeof(bool));
-  gradx = new float[ns];
-  grady = new float[ns];
+  allocate(gradx);
+  allocate(grady);
+
+  allocate(heap);  // every cell fits, so the heap can never overflow
+  allocate(heappos);
+  allocate(heapkey);
+  heapn = 0;
 }
 
 
@@ -243,30 +300,10 @@ NavFn::setNavArr(int xs, int ys)
 void
 NavFn::setCostmap(const COSTTYPE * cmap, bool isROS, bool allow_unknown)
 {
-  COSTTYPE * cm = costarr;
   if (isROS) {  // ROS-type cost array
-    for (int i = 0; i < ny; i++) {
-      int k = i * nx;
-      for (int j = 0; j < nx; j++, k++, cmap++, cm++) {
-        // This transforms the incoming cost values:
-        // COST_OBS                 -> COST_OBS (incoming "lethal obstacle")
-        // COST_OBS_ROS             -> COST_OBS (incoming "inscribed inflated obstacle")
-        // values in range 0 to 252 -> values from COST_NEUTRAL to COST_OBS_ROS.
-        *cm = COST_OBS;
-        int v = *cmap;
-        if (v < COST_OBS_ROS) {
-          v = COST_NEUTRAL + COST_FACTOR * v;
-          if (v >= COST_OBS) {
-            v = COST_OBS - 1;
-          }
-          *cm = v;
-        } else if (v == COST_UNKNOWN_ROS && allow_unknown) {
-          v = COST_OBS - 1;
-          *cm = v;
-        }
-      }
-    }
+    setCostmapRegion(cmap, 0, 0, nx, ny, allow_unknown);
   } else {  // not a ROS map, just a PGM
+    COSTTYPE * cm = costarr;
     for (int i = 0; i < ny; i++) {
       int k = i * nx;
       for (int j = 0; j < nx; j++, k++, cmap++, cm++) {
@@ -290,9 +327,39 @@ NavFn::setCostmap(const COSTTYPE * cmap, bool isROS, bool allow_unknown)
   }
 }
 
+void
+NavFn::setCostmapRegion(
+  const COSTTYPE * cmap, int x0, int y0, int xn, int yn,
+  bool allow_unknown)
+{
+  // 256 possible costs are cheaper to translate once than per cell
+  COSTTYPE table[256];
+  for (int v = 0; v < 256; v++) {
+    // This transforms the incoming cost values:
+    // COST_OBS                 -> COST_OBS (incoming "lethal obstacle")
+    // COST_OBS_ROS             -> COST_OBS (incoming "inscribed inflated obstacle")
+    // values in range 0 to 252 -> values from COST_NEUTRAL to COST_OBS_ROS.
+    table[v] = COST_OBS;
+    if (v < COST_OBS_ROS) {
+      table[v] = std::min(static_cast<int>(COST_NEUTRAL + COST_FACTOR * v), COST_OBS - 1);
+    } else if (v == COST_UNKNOWN_ROS && allow_unknown) {
+      table[v] = COST_OBS - 1;
+    }
+  }
+
+  for (int i = y0; i < yn; i++) {
+    const COSTTYPE * cmp = cmap + i * nx + x0;
+    COSTTYPE * cm = costarr + i * nx + x0;
+    for (int j = 0; j < xn - x0; j++) {
+      cm[j] = table[cmp[j]];
+    }
+  }
+}
+
 bool
 NavFn::calcNavFnDijkstra(bool atStart)
 {
+  NAV2_TRACE_SCOPE("navfn_dijkstra");
   setupNavFn(true);
 
   // calculate the nav fn and path
@@ -313,6 +380,160 @@ NavFn::calcNavFnAstar()
   return propNavFnAstar(std::max(nx * ny / 20, nx + ny));
 }
 
+
+//
+// calculate navigation function with the heap instead of the priority blocks
+//
+
+bool
+NavFn::calcNavFnHeap(bool astar, bool atStart)
+{
+  setupNavFn(true);
+
+  // the blocks were seeded by setupNavFn(); start the heap from the goal instead
+  for (int i = 0; i < ns; i++) {
+    heappos[i] = -1;
+  }
+  heapn = 0;
+  int k = goal[0] + goal[1] * nx;
+  int nbrs[4] = {k + 1, k - 1, k - nx, k + nx};
+  for (int m : nbrs) {
+    if (m >= 0 && m < ns && costarr[m] < COST_OBS) {
+      float key = static_cast<float>(costarr[m]);
+      if (astar) {
+        key += hypot(m % nx - start[0], m / nx - start[1]) *
+          static_cast<float>(COST_NEUTRAL * HEURISTIC_SCALE);
+      }
+      heapPush(m, key);
+    }
+  }
+
+  // a cell can be lowered once from each of its four neighbors
+  return propNavFnHeap(4 * ns, astar, astar || atStart);
+}
+
+//
+// calculate navigation function over a window around goal and start
+//
+
+bool
+NavFn::calcNavFnBounded(int margin, bool astar)
+{
+  int startCell = start[1] * nx + start[0];
+  int bx0 = std::min(goal[0], start[0] - startRadius);
+  int by0 = std::min(goal[1], start[1] - startRadius);
+  int bx1 = std::max(goal[0], start[0] + startRadius);
+  int by1 = std::max(goal[1], start[1] + startRadius);
+
+  for (margin = std::max(margin, 1);; margin *= 2) {
+    int x0 = std::max(bx0 - margin, 1);
+    int y0 = std::max(by0 - margin, 1);
+    int x1 = std::min(bx1 + margin, nx - 2);
+    int y1 = std::min(by1 + margin, ny - 2);
+    setupNavFnWindow(x0, y0, x1, y1);
+
+    int w = x1 - x0 + 1;
+    int h = y1 - y0 + 1;
+    if (astar) {
+      propNavFnAstar(std::max(w * h / 20, w + h));
+    } else {
+      propNavFnDijkstra(std::max(w * h / 20, w + h), true);
+    }
+
+    bool whole = x0 == 1 && y0 == 1 && x1 == nx - 2 && y1 == ny - 2;
+    if (potarr[startCell] < POT_HIGH || whole) {
+      break;
+    }
+  }
+  return potarr[startCell] < POT_HIGH;
+}
+
+//
+// calculate the navigation functions of several goals by fast sweeping
+//
+
+// The planar-wave potential of a cell of cost hf from its four neighbors, the
+// same update as updateCell()
+static inline float
+planarWave(float l, float r, float u, float d, float hf)
+{
+  float tc = l < r ? l : r;
+  float ta = u < d ? u : d;
+  float dc = tc - ta;
+  if (dc < 0) {
+    dc = -dc;
+    ta = tc;
+  }
+  if (dc >= hf) {
+    return ta + hf;
+  }
+  float dd = dc / hf;
+  return ta + hf * (-0.2301 * dd * dd + 0.5307 * dd + 0.7040);
+}
+
+// The field of one goal, see calcNavFnSweepBatch()
+static void
+sweepField(const COSTTYPE * costarr, int nx, int ny, int goal, float * pot)
+{
+  std::fill(pot, pot + nx * ny, static_cast<float>(POT_HIGH));
+  pot[goal] = 0.0;
+
+  // each sweep carries the front across the map in one diagonal direction,
+  // so open space settles in a few passes and only turns around obstacles
+  // take more
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (int dir = 0; dir < 4; dir++) {
+      int xs = (dir & 1) ? -1 : 1;
+      int ys = (dir & 2) ? -1 : 1;
+      int x0 = (dir & 1) ? nx - 2 : 1;
+      int y0 = (dir & 2) ? ny - 2 : 1;
+      for (int y = y0; y > 0 && y < ny - 1; y += ys) {
+        for (int x = x0; x > 0 && x < nx - 1; x += xs) {
+          int n = y * nx + x;
+          if (costarr[n] >= COST_OBS) {
+            continue;
+          }
+          float p = planarWave(
+            pot[n - 1], pot[n + 1], pot[n - nx], pot[n + nx], static_cast<float>(costarr[n]));
+          if (p < pot[n]) {
+            pot[n] = p;
+            changed = true;
+          }
+        }
+      }
+    }
+  }
+}
+
+void
+NavFn::calcNavFnSweepBatch(const int * goals, int count, float * const * potentials) const
+{
+  auto field = [&](size_t i) {
+      sweepField(costarr, nx, ny, goals[2 * i] + goals[2 * i + 1] * nx, potentials[i]);
+    };
+  if (threadPool && count > 1) {
+    threadPool->parallel_for(count, field);
+  } else {
+    for (int i = 0; i < count; i++) {
+      field(i);
+    }
+  }
+}
+
+void
+NavFn::setPotential(const float * potential)
+{
+  memcpy(potarr, potential, ns * sizeof(float));
+  window[0] = window[1] = 0;
+  window[2] = nx - 1;
+  window[3] = ny - 1;
+  // the gradients are cached per cell as they are needed
+  memset(gradx, 0, ns * sizeof(float));
+  memset(grady, 0, ns * sizeof(float));
+}
+
 //
 // returning values
 //
@@ -366,6 +587,52 @@ NavFn::setupNavFn(bool keepit)
     *pc = COST_OBS;
   }
 
+  memset(pending, 0, ns * sizeof(bool));
+  window[0] = window[1] = 0;
+  window[2] = nx - 1;
+  window[3] = ny - 1;
+  seedPropagation();
+
+  // find # of obstacle cells
+  pc = costarr;
+  int ntot = 0;
+  for (int i = 0; i < ns; i++, pc++) {
+    if (*pc >= COST_OBS) {
+      ntot++;  // number of cells that are obstacles
+    }
+  }
+  nobs = ntot;
+}
+
+void
+NavFn::setupNavFnWindow(int x0, int y0, int x1, int y1)
+{
+  int ntot = 0;
+  for (int y = std::max(y0 - 2, 0); y <= std::min(y1 + 2, ny - 1); y++) {
+    for (int x = std::max(x0 - 2, 0); x <= std::min(x1 + 2, nx - 1); x++) {
+      int k = y * nx + x;
+      bool ring = x < x0 || x > x1 || y < y0 || y > y1;
+      potarr[k] = POT_HIGH;
+      gradx[k] = grady[k] = 0.0;
+      pending[k] = ring;
+      if (!ring && costarr[k] >= COST_OBS) {
+        ntot++;
+      }
+    }
+  }
+  // the propagation statistics are over the window
+  nobs = ntot + ns - (x1 - x0 + 1) * (y1 - y0 + 1);
+
+  window[0] = x0;
+  window[1] = y0;
+  window[2] = x1;
+  window[3] = y1;
+  seedPropagation();
+}
+
+void
+NavFn::seedPropagation()
+{
   // priority buffers
   curT = COST_OBS;
   curP = pb1;
@@ -374,21 +641,11 @@ NavFn::setupNavFn(bool keepit)
   nextPe = 0;
   overP = pb3;
   overPe = 0;
-  memset(pending, 0, ns * sizeof(bool));
+  settleCursor = 0;
 
   // set goal
   int k = goal[0] + goal[1] * nx;
   initCost(k, 0);
-
-  // find # of obstacle cells
-  pc = costarr;
-  int ntot = 0;
-  for (int i = 0; i < ns; i++, pc++) {
-    if (*pc >= COST_OBS) {
-      ntot++;  // number of cells that are obstacles
-    }
-  }
-  nobs = ntot;
 }
 
 
@@ -479,6 +736,101 @@ NavFn::updateCell(int n)
   }
 }
 
+//
+// Same as updateCell(), but only reading the arrays: the new potential goes to
+// blockpot[k], and blockpush[k] gets which neighbors to queue. Bits 0 to 3 are
+// the left, right, up and down neighbors, BLOCK_OVER queues them in the
+// overflow block, and BLOCK_SET is set when the potential is lowered at all.
+//
+
+#define BLOCK_OVER 0x10
+#define BLOCK_SET 0x20
+
+inline void
+NavFn::computeCellUpdate(int k)
+{
+  int n = curP[k];
+  blockpush[k] = 0;
+  if (costarr[n] >= COST_OBS) {
+    return;
+  }
+
+  float l = potarr[n - 1];
+  float r = potarr[n + 1];
+  float u = potarr[n - nx];
+  float d = potarr[n + nx];
+  float ta, tc;
+  if (l < r) {tc = l;} else {tc = r;}
+  if (u < d) {ta = u;} else {ta = d;}
+
+  float hf = static_cast<float>(costarr[n]);
+  float dc = tc - ta;
+  if (dc < 0) {
+    dc = -dc;
+    ta = tc;
+  }
+  float pot;
+  if (dc >= hf) {
+    pot = ta + hf;
+  } else {
+    float dd = dc / hf;
+    float v = -0.2301 * dd * dd + 0.5307 * dd + 0.7040;
+    pot = ta + hf * v;
+  }
+  if (!(pot < potarr[n])) {
+    return;
+  }
+
+  unsigned char push = BLOCK_SET | (pot < curT ? 0 : BLOCK_OVER);
+  if (l > pot + INVSQRT2 * static_cast<float>(costarr[n - 1])) {push |= 1;}
+  if (r > pot + INVSQRT2 * static_cast<float>(costarr[n + 1])) {push |= 2;}
+  if (u > pot + INVSQRT2 * static_cast<float>(costarr[n - nx])) {push |= 4;}
+  if (d > pot + INVSQRT2 * static_cast<float>(costarr[n + nx])) {push |= 8;}
+  blockpot[k] = pot;
+  blockpush[k] = push;
+}
+
+void
+NavFn::updateBlockParallel()
+{
+  // chunks of consecutive cells, so neighbors are mostly read by the same thread
+  const int chunk = 256;
+  int chunks = (curPe + chunk - 1) / chunk;
+  threadPool->parallel_for(
+    chunks, [&](size_t c) {
+      int end = std::min(curPe, static_cast<int>(c + 1) * chunk);
+      for (int k = static_cast<int>(c) * chunk; k < end; k++) {
+        computeCellUpdate(k);
+      }
+    });
+
+  for (int k = 0; k < curPe; k++) {
+    unsigned char push = blockpush[k];
+    if (!(push & BLOCK_SET)) {
+      continue;
+    }
+    int n = curP[k];
+    potarr[n] = blockpot[k];
+    if (push & BLOCK_OVER) {
+      if (push & 1) {push_over(n - 1);}
+      if (push & 2) {push_over(n + 1);}
+      if (push & 4) {push_over(n - nx);}
+      if (push & 8) {push_over(n + nx);}
+    } else {
+      if (push & 1) {push_next(n - 1);}
+      if (push & 2) {push_next(n + 1);}
+      if (push & 4) {push_next(n - nx);}
+      if (push & 8) {push_next(n + nx);}
+    }
+  }
+}
+
+void
+NavFn::setThreadPool(std::shared_ptr<nav2_util::ThreadPool> pool)
+{
+  threadPool = pool;
+}
+
 //
 // Use A* method for setting priorities
 // Critical function: calculate updated potential value of a cell,
@@ -577,9 +929,6 @@ NavFn::propNavFnDijkstra(int cycles, bool atStart)
   int nc = 0;  // number of cells put into priority blocks
   int cycle = 0;  // which cycle we're on
 
-  // set up start cell
-  int startCell = start[1] * nx + start[0];
-
   for (; cycle < cycles; cycle++) {  // go for this many cycles, unless interrupted
     if (curPe == 0 && nextPe == 0) {  // priority blocks empty
       break;
@@ -599,10 +948,14 @@ NavFn::propNavFnDijkstra(int cycles, bool atStart)
     }
 
     // process current priority buffer
-    pb = curP;
-    i = curPe;
-    while (i-- > 0) {
-      updateCell(*pb++);
+    if (threadPool && threadPool->size() > 1 && curPe >= PARALLELBLOCKSIZE) {
+      updateBlockParallel();
+    } else {
+      pb = curP;
+      i = curPe;
+      while (i-- > 0) {
+        updateCell(*pb++);
+      }
     }
 
     if (displayInt > 0 && (cycle % displayInt) == 0) {
@@ -626,9 +979,9 @@ NavFn::propNavFnDijkstra(int cycles, bool atStart)
       overP = pb;
     }
 
-    // check if we've hit the Start cell
+    // check if we've hit the Start cell, and settled the cells around it
     if (atStart) {
-      if (potarr[startCell] < POT_HIGH) {
+      if (startSettled(curT)) {
         break;
       }
     }
@@ -733,6 +1086,185 @@ NavFn::propNavFnAstar(int cycles)
 }
 
 
+//
+// indexed binary min-heap over cell indices
+//
+
+void
+NavFn::heapPush(int n, float key)
+{
+  int i = heappos[n];
+  if (i < 0) {
+    i = heapn++;
+  } else if (key >= heapkey[n]) {
+    return;  // already queued with a lower priority
+  }
+  heapkey[n] = key;
+
+  // sift up
+  while (i > 0) {
+    int p = (i - 1) / 2;
+    if (heapkey[heap[p]] <= key) {
+      break;
+    }
+    heap[i] = heap[p];
+    heappos[heap[i]] = i;
+    i = p;
+  }
+  heap[i] = n;
+  heappos[n] = i;
+}
+
+int
+NavFn::heapPop()
+{
+  int top = heap[0];
+  heappos[top] = -1;
+  if (--heapn == 0) {
+    return top;
+  }
+
+  // sift the last cell down from the root
+  int last = heap[heapn];
+  float key = heapkey[last];
+  int i = 0;
+  for (;; ) {
+    int c = 2 * i + 1;
+    if (c >= heapn) {
+      break;
+    }
+    if (c + 1 < heapn && heapkey[heap[c + 1]] < heapkey[heap[c]]) {
+      c++;
+    }
+    if (key <= heapkey[heap[c]]) {
+      break;
+    }
+    heap[i] = heap[c];
+    heappos[heap[i]] = i;
+    i = c;
+  }
+  heap[i] = last;
+  heappos[last] = i;
+  return top;
+}
+
+
+//
+// Planar-wave update as in updateCell(), but the affected neighbors are
+//   queued on the heap, keyed by their estimated potential
+//
+
+inline void
+NavFn::updateCellHeap(int n, bool astar)
+{
+  // get neighbors
+  float u, d, l, r;
+  l = potarr[n - 1];
+  r = potarr[n + 1];
+  u = potarr[n - nx];
+  d = potarr[n + nx];
+
+  // find lowest, and its lowest neighbor
+  float ta, tc;
+  if (l < r) {tc = l;} else {tc = r;}
+  if (u < d) {ta = u;} else {ta = d;}
+
+  // do planar wave update
+  if (costarr[n] < COST_OBS) {  // don't propagate into obstacles
+    float hf = static_cast<float>(costarr[n]);  // traversability factor
+    float dc = tc - ta;  // relative cost between ta,tc
+    if (dc < 0) {  // ta is lowest
+      dc = -dc;
+      ta = tc;
+    }
+
+    // calculate new potential
+    float pot;
+    if (dc >= hf) {  // if too large, use ta-only update
+      pot = ta + hf;
+    } else {  // two-neighbor interpolation update
+      float d = dc / hf;
+      float v = -0.2301 * d * d + 0.5307 * d + 0.7040;
+      pot = ta + hf * v;
+    }
+
+    // now queue the affected neighbors
+    if (pot < potarr[n]) {
+      potarr[n] = pot;
+
+      int nbrs[4] = {n - 1, n + 1, n - nx, n + nx};
+      float nbrpot[4] = {l, r, u, d};
+      for (int i = 0; i < 4; i++) {
+        int m = nbrs[i];
+        float hm = static_cast<float>(costarr[m]);
+        if (hm >= COST_OBS || nbrpot[i] <= pot + INVSQRT2 * hm) {
+          continue;
+        }
+        float key = pot + hm;  // the neighbor's potential from a straight step
+        if (astar) {
+          key += hypot(m % nx - start[0], m / nx - start[1]) *
+            static_cast<float>(COST_NEUTRAL * HEURISTIC_SCALE);
+        }
+        heapPush(m, key);
+      }
+    }
+  }
+}
+
+
+//
+// main propagation function
+// heap-based, best-first (with the A* heuristic) or Dijkstra ordering
+// runs for a specified number of cell expansions,
+//   or until it runs out of cells to update,
+//   or until the Start cell is found (atStart = true)
+//
+
+bool
+NavFn::propNavFnHeap(int cycles, bool astar, bool atStart)
+{
+  int nwv = 0;  // max heap size
+  int cycle = 0;  // number of cells expanded
+  bool startFinal = false;  // whether the start cell came off the heap
+
+  // set up start cell
+  int startCell = start[1] * nx + start[0];
+
+  for (; cycle < cycles && heapn > 0; cycle++) {
+    if (heapn > nwv) {
+      nwv = heapn;
+    }
+
+    int n = heapPop();
+    updateCellHeap(n, astar);
+
+    if (displayInt > 0 && (cycle % displayInt) == 0) {
+      displayFn(this);
+    }
+
+    // the start cell is final once it comes off the heap
+    if (n == startCell) {
+      startFinal = true;
+    }
+    if (atStart && startFinal && startSettled(heapkey[n])) {
+      break;
+    }
+  }
+
+  last_path_cost_ = potarr[startCell];
+
+  RCLCPP_DEBUG(
+    rclcpp::get_logger("rclcpp"),
+    "[NavFn] Used %d cycles (%d%% of free cells), heap max %d\n",
+    cycle, (int)((cycle * 100.0) / (ns - nobs)), nwv);
+
+  if (atStart) {
+    return potarr[startCell] < POT_HIGH;
+  }
+  return cycle < cycles;
+}
+
+
 float NavFn::getLastPathCost()
 {
   return last_path_cost_;
@@ -756,13 +1288,13 @@ NavFn::calcPath(int n, int * st)
   // test write
   // savemap("test");
 
-  // check path arrays
+  // check path arrays, kept across calls and only ever grown
   if (npathbuf < n) {
     if (pathx) {delete[] pathx;}
     if (pathy) {delete[] pathy;}
-    pathx = new float[n];
-    pathy = new float[n];
-    npathbuf = n;
+    npathbuf = std::max(n, 2 * npathbuf);
+    pathx = new float[npathbuf];
+    pathy = new float[npathbuf];
   }
 
   // set up start position at cell
@@ -868,14 +1400,15 @@ NavFn::calcPath(int n, int * st)
       gradCell(stcnx);
       gradCell(stcnx + 1);
 
-
-      // get interpolated gradient
-      float x1 = (1.0 - dx) * gradx[stc] + dx * gradx[stc + 1];
-      float x2 = (1.0 - dx) * gradx[stcnx] + dx * gradx[stcnx + 1];
-      float x = (1.0 - dy) * x1 + dy * x2;  // interpolated x
-      float y1 = (1.0 - dx) * grady[stc] + dx * grady[stc + 1];
-      float y2 = (1.0 - dx) * grady[stcnx] + dx * grady[stcnx + 1];
-      float y = (1.0 - dy) * y1 + dy * y2;  // interpolated y
+      // get interpolated gradient, the same bilinear weights for x and y
+      float w00 = (1.0f - dx) * (1.0f - dy);
+      float w01 = dx * (1.0f - dy);
+      float w10 = (1.0f - dx) * dy;
+      float w11 = dx * dy;
+      float x = w00 * gradx[stc] + w01 * gradx[stc + 1] +
+        w10 * gradx[stcnx] + w11 * gradx[stcnx + 1];  // interpolated x
+      float y = w00 * grady[stc] + w01 * grady[stc + 1] +
+        w10 * grady[stcnx] + w11 * grady[stcnx + 1];  // interpolated y
 
 #if 0
       // show gradients
@@ -894,7 +1427,7 @@ NavFn::calcPath(int n, int * st)
       }
 
       // move in the right direction
-      float ss = pathStep / hypot(x, y);
+      float ss = pathStep / std::sqrt(x * x + y * y);
       dx += x * ss;
       dy += y * ss;
 
@@ -925,7 +1458,9 @@ NavFn::calcPath(int n, int * st)
 float
 NavFn::gradCell(int n)
 {
-  if (gradx[n] + grady[n] > 0.0) {  // check this cell
+  // gradients are normalized once computed, so any nonzero one is cached;
+  // their sum can be negative, so it can't tell a computed cell apart
+  if (gradx[n] != 0.0f || grady[n] != 0.0f) {  // check this cell
     return 1.0;
   }
 
@@ -968,7 +1503,7 @@ NavFn::gradCell(int n)
   }
 
   // normalize
-  float norm = hypot(dx, dy);
+  float norm = std::sqrt(dx * dx + dy * dy);
   if (norm > 0) {
     norm = 1.0 / norm;
     gradx[n] = norm * dx;
@@ -21,6 +21,7 @@
 
 #include "nav2_navfn_planner/navfn_planner.hpp"
 
+#include <algorithm>
 #include <chrono>
 #include <cmath>
 #include <iomanip>
@@ -38,6 +39,8 @@
 
 using namespace std::chrono_literals;
 using nav2_util::declare_parameter_if_not_declared;
+using rcl_interfaces::msg::ParameterType;
+using std::placeholders::_1;
 
 namespace nav2_navfn_planner
 {
@@ -76,13 +79,109 @@ NavfnPlanner::configure(
   node_->get_parameter(name + ".tolerance", tolerance_);
   declare_parameter_if_not_declared(node_, name + ".use_astar", rclcpp::ParameterValue(false));
   node_->get_parameter(name + ".use_astar", use_astar_);
+  declare_parameter_if_not_declared(node_, name + ".use_heap", rclcpp::ParameterValue(false));
+  node_->get_parameter(name + ".use_heap", use_heap_);
+  declare_parameter_if_not_declared(
+    node_, name + ".search_margin", rclcpp::ParameterValue(0.0));
+  node_->get_parameter(name + ".search_margin", search_margin_);
   declare_parameter_if_not_declared(node_, name + ".allow_unknown", rclcpp::ParameterValue(true));
   node_->get_parameter(name + ".allow_unknown", allow_unknown_);
+  declare_parameter_if_not_declared(
+    node_, name + ".propagation_threads", rclcpp::ParameterValue(1));
+  int propagation_threads;
+  node_->get_parameter(name + ".propagation_threads", propagation_threads);
+  declare_parameter_if_not_declared(
+    node_, name + ".station_goals", rclcpp::ParameterValue(std::vector<double>()));
+  std::vector<double> station_goals;
+  node_->get_parameter(name + ".station_goals", station_goals);
+
+  // x and y of each station, in the global frame
+  stations_.clear();
+  for (size_t i = 0; i + 1 < station_goals.size(); i += 2) {
+    Station station;
+    station.x = station_goals[i];
+    station.y = station_goals[i + 1];
+    stations_.push_back(station);
+  }
 
   // Create a planner based on the new costmap size
   planner_ = std::make_unique<NavFn>(
     costmap_->getSizeInCellsX(),
     costmap_->getSizeInCellsY());
+  if (propagation_threads != 1) {
+    // 0 uses one thread per core
+    planner_->setThreadPool(
+      std::make_shared<nav2_util::ThreadPool>(std::max(0, propagation_threads)));
+  }
+  costmap_translated_ = false;
+  potential_valid_ = false;
+
+  // Setup callback for changes to parameters.
+  new_tolerance_ = tolerance_;
+  new_use_astar_ = use_astar_;
+  new_allow_unknown_ = allow_unknown_;
+  parameters_changed_ = false;
+  parameters_client_ = std::make_shared<rclcpp::AsyncParametersClient>(
+    node_->get_node_base_interface(),
+    node_->get_node_topics_interface(),
+    node_->get_node_graph_interface(),
+    node_->get_node_services_interface());
+
+  parameter_event_sub_ = parameters_client_->on_parameter_event(
+    std::bind(&NavfnPlanner::on_parameter_event_callback, this, _1));
+}
+
+void
+NavfnPlanner::on_parameter_event_callback(
+  const rcl_interfaces::msg::ParameterEvent::SharedPtr event)
+{
+  if (event->node != node_->get_fully_qualified_name()) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(parameters_mutex_);
+  for (auto & changed_parameter : event->changed_parameters) {
+    const auto & type = changed_parameter.value.type;
+    const auto & name = changed_parameter.name;
+    const auto & value = changed_parameter.value;
+
+    if (type == ParameterType::PARAMETER_DOUBLE && name == name_ + ".tolerance") {
+      new_tolerance_ = value.double_value;
+    } else if (type == ParameterType::PARAMETER_BOOL && name == name_ + ".use_astar") {
+      new_use_astar_ = value.bool_value;
+    } else if (type == ParameterType::PARAMETER_BOOL && name == name_ + ".allow_unknown") {
+      new_allow_unknown_ = value.bool_value;
+    } else {
+      continue;
+    }
+    parameters_changed_ = true;
+  }
+}
+
+void
+NavfnPlanner::applyParameterChanges()
+{
+  std::lock_guard<std::mutex> lock(parameters_mutex_);
+  if (!parameters_changed_) {
+    return;
+  }
+  parameters_changed_ = false;
+
+  tolerance_ = new_tolerance_;
+  if (new_use_astar_ != use_astar_) {
+    // an A* field only covers the way to the goal it was computed for
+    use_astar_ = new_use_astar_;
+    potential_valid_ = false;
+  }
+  if (new_allow_unknown_ != allow_unknown_) {
+    // every unknown cell of the planner's costs changes
+    allow_unknown_ = new_allow_unknown_;
+    costmap_translated_ = false;
+    potential_valid_ = false;
+    for (auto & station : stations_) {
+      station.valid = false;
+    }
+  }
 }
 
 void
@@ -114,15 +213,22 @@ nav_msgs::msg::Path NavfnPlanner::createPlan(
   const geometry_msgs::msg::PoseStamped & start,
   const geometry_msgs::msg::PoseStamped & goal)
 {
+  applyParameterChanges();
+
   // Update planner based on the new costmap size
   if (isPlannerOutOfDate()) {
     planner_->setNavArr(
       costmap_->getSizeInCellsX(),
       costmap_->getSizeInCellsY());
+    costmap_translated_ = false;
   }
 
   nav_msgs::msg::Path path;
 
+  if (planFromStation(start.pose, goal.pose, path)) {
+    return path;
+  }
+
   if (!makePlan(start.pose, goal.pose, tolerance_, path)) {
     RCLCPP_WARN(
       node_->get_logger(), "%s: failed to create plan with "
@@ -131,6 +237,56 @@ nav_msgs::msg::Path NavfnPlanner::createPlan(
   return path;
 }
 
+std::vector<nav_msgs::msg::Path> NavfnPlanner::createPlans(
+  const geometry_msgs::msg::PoseStamped & start,
+  const std::vector<geometry_msgs::msg::PoseStamped> & goals,
+  std::vector<double> & costs)
+{
+  applyParameterChanges();
+
+  // A* potentials are only good towards one goal
+  if (use_astar_) {
+    return nav2_core::GlobalPlanner::createPlans(start, goals, costs);
+  }
+
+  if (isPlannerOutOfDate()) {
+    planner_->setNavArr(
+      costmap_->getSizeInCellsX(),
+      costmap_->getSizeInCellsY());
+    costmap_translated_ = false;
+  }
+
+  std::vector<nav_msgs::msg::Path> paths(goals.size());
+  costs.assign(goals.size(), -1.0);
+
+  unsigned int mx, my;
+  if (!worldToMap(start.pose.position.x, start.pose.position.y, mx, my)) {
+    RCLCPP_WARN(
+      node_->get_logger(),
+      "Cannot create a plan: the robot's start position is off the global"
+      " costmap. Planning will always fail, are you sure"
+      " the robot has been properly localized?");
+    return paths;
+  }
+
+  {
+    std::unique_lock<nav2_costmap_2d::Costmap2D::mutex_t> lock(*(costmap_->getMutex()));
+    clearRobotCell(mx, my);
+  }
+
+  // one propagation from the robot over the whole map serves every goal
+  computePotential(start.pose.position);
+
+  for (size_t i = 0; i < goals.size(); ++i) {
+    if (!getPlanNearGoal(goals[i].pose, tolerance_, paths[i], costs[i])) {
+      RCLCPP_DEBUG(
+        node_->get_logger(), "%s: no plan to goal %zu (%.2f, %.2f)", name_.c_str(), i,
+        goals[i].pose.position.x, goals[i].pose.position.y);
+    }
+  }
+  return paths;
+}
+
 bool
 NavfnPlanner::isPlannerOutOfDate()
 {
@@ -171,15 +327,14 @@ NavfnPlanner::makePlan(
     return false;
   }
 
+  std::unique_lock<nav2_costmap_2d::Costmap2D::mutex_t> lock(*(costmap_->getMutex()));
+
   // clear the starting cell within the costmap because we know it can't be an obstacle
   clearRobotCell(mx, my);
 
-  // make sure to resize the underlying array that Navfn uses
-  planner_->setNavArr(
-    costmap_->getSizeInCellsX(),
-    costmap_->getSizeInCellsY());
+  updatePlannerCostmap();
 
-  planner_->setCostmap(costmap_->getCharMap(), true, allow_unknown_);
+  lock.unlock();
 
   int map_start[2];
   map_start[0] = mx;
@@ -205,12 +360,41 @@ NavfnPlanner::makePlan(
 
   planner_->setStart(map_goal);
   planner_->setGoal(map_start);
-  if (use_astar_) {
-    planner_->calcNavFnAstar();
-  } else {
-    planner_->calcNavFnDijkstra(true);
+
+  // propagate until every point getPlanNearGoal() looks at is reached,
+  // unless the last propagation from here already covers them
+  double resolution = costmap_->getResolution();
+  int origin = map_start[1] * planner_->nx + map_start[0];
+  int target = map_goal[1] * planner_->nx + map_goal[0];
+  int radius = static_cast<int>(std::ceil(tolerance / resolution));
+  if (!isPotentialCached(origin, target, radius)) {
+    planner_->setStartRadius(radius);
+    bool result;
+    if (use_heap_) {
+      result = planner_->calcNavFnHeap(use_astar_, true);
+    } else if (search_margin_ > 0.0) {
+      result = planner_->calcNavFnBounded(
+        static_cast<int>(std::ceil(search_margin_ / resolution)), use_astar_);
+    } else if (use_astar_) {
+      result = planner_->calcNavFnAstar();
+    } else {
+      result = planner_->calcNavFnDijkstra(true);
+    }
+    cachePotential(origin, target, radius, false, result);
   }
 
+  double cost;
+  return getPlanNearGoal(goal, tolerance, plan, cost);
+}
+
+bool
+NavfnPlanner::getPlanNearGoal(
+  const geometry_msgs::msg::Pose & goal, double tolerance,
+  nav_msgs::msg::Path & plan, double & cost)
+{
+  plan.poses.clear();
+  cost = -1.0;
+
   double resolution = costmap_->getResolution();
   geometry_msgs::msg::Pose p, best_pose;
   p = goal;
@@ -239,6 +423,7 @@ NavfnPlanner::makePlan(
     // extract the plan
     if (getPlanFromPotential(best_pose, plan)) {
       smoothApproachToGoal(best_pose, plan);
+      cost = getPointPotential(best_pose.position);
     } else {
       RCLCPP_ERROR(
         node_->get_logger(),
@@ -275,12 +460,10 @@ NavfnPlanner::smoothApproachToGoal(
 bool
 NavfnPlanner::computePotential(const geometry_msgs::msg::Point & world_point)
 {
-  // make sure to resize the underlying array that Navfn uses
-  planner_->setNavArr(
-    costmap_->getSizeInCellsX(),
-    costmap_->getSizeInCellsY());
-
-  planner_->setCostmap(costmap_->getCharMap(), true, allow_unknown_);
+  {
+    std::unique_lock<nav2_costmap_2d::Costmap2D::mutex_t> lock(*(costmap_->getMutex()));
+    updatePlannerCostmap();
+  }
 
   unsigned int mx, my;
   if (!worldToMap(world_point.x, world_point.y, mx, my)) {
@@ -298,11 +481,140 @@ NavfnPlanner::computePotential(const geometry_msgs::msg::Point & world_point)
   planner_->setStart(map_start);
   planner_->setGoal(map_goal);
 
-  if (use_astar_) {
-    return planner_->calcNavFnAstar();
+  int origin = map_goal[1] * planner_->nx + map_goal[0];
+  if (isPotentialCached(origin, 0, 0)) {
+    return potential_result_;
   }
 
-  return planner_->calcNavFnDijkstra();
+  bool result;
+  if (use_heap_) {
+    result = planner_->calcNavFnHeap(use_astar_);
+  } else if (use_astar_) {
+    result = planner_->calcNavFnAstar();
+  } else {
+    result = planner_->calcNavFnDijkstra();
+  }
+
+  // without the heuristic the whole reachable map has been propagated
+  cachePotential(origin, 0, 0, !use_astar_ && result, result);
+  return result;
+}
+
+void
+NavfnPlanner::updateStationFields()
+{
+  std::vector<int> goals;
+  std::vector<float *> potentials;
+  for (auto & station : stations_) {
+    if (station.valid && station.change_count == costmap_change_count_ &&
+      station.potential.size() == static_cast<size_t>(planner_->ns) &&
+      station.origin_x == costmap_->getOriginX() && station.origin_y == costmap_->getOriginY())
+    {
+      continue;
+    }
+
+    station.valid = false;
+    unsigned int mx, my;
+    if (!worldToMap(station.x, station.y, mx, my)) {
+      continue;
+    }
+    station.cell = my * planner_->nx + mx;
+    station.potential.resize(planner_->ns);
+    station.valid = true;
+    station.change_count = costmap_change_count_;
+    station.origin_x = costmap_->getOriginX();
+    station.origin_y = costmap_->getOriginY();
+    goals.push_back(mx);
+    goals.push_back(my);
+    potentials.push_back(station.potential.data());
+  }
+
+  if (!potentials.empty()) {
+    planner_->calcNavFnSweepBatch(goals.data(), potentials.size(), potentials.data());
+  }
+}
+
+bool
+NavfnPlanner::planFromStation(
+  const geometry_msgs::msg::Pose & start,
+  const geometry_msgs::msg::Pose & goal,
+  nav_msgs::msg::Path & plan)
+{
+  if (stations_.empty()) {
+    return false;
+  }
+
+  unsigned int gx, gy, sx, sy;
+  if (!worldToMap(goal.position.x, goal.position.y, gx, gy) ||
+    !worldToMap(start.position.x, start.position.y, sx, sy))
+  {
+    return false;
+  }
+
+  {
+    std::unique_lock<nav2_costmap_2d::Costmap2D::mutex_t> lock(*(costmap_->getMutex()));
+    clearRobotCell(sx, sy);
+    updatePlannerCostmap();
+  }
+  updateStationFields();
+
+  int target = gy * planner_->nx + gx;
+  int origin = sy * planner_->nx + sx;
+  auto station = std::find_if(
+    stations_.begin(), stations_.end(),
+    [target](const Station & s) {return s.valid && s.cell == target;});
+  if (station == stations_.end() || station->potential[origin] >= POT_HIGH) {
+    return false;
+  }
+
+  // the field is rooted at the goal, so the path descends from the robot to it
+  planner_->setPotential(station->potential.data());
+  potential_valid_ = false;
+  int map_goal[2] = {static_cast<int>(gx), static_cast<int>(gy)};
+  int map_start[2] = {static_cast<int>(sx), static_cast<int>(sy)};
+  planner_->setGoal(map_goal);
+  planner_->setStart(map_start);
+  int len = planner_->calcPath(costmap_->getSizeInCellsX() * 4);
+  if (len == 0) {
+    return false;
+  }
+
+  plan.poses.clear();
+  plan.header.stamp = node_->now();
+  plan.header.frame_id = global_frame_;
+  float * x = planner_->getPathX();
+  float * y = planner_->getPathY();
+  for (int i = 0; i < len; ++i) {
+    geometry_msgs::msg::PoseStamped pose;
+    mapToWorld(x[i], y[i], pose.pose.position.x, pose.pose.position.y);
+    pose.pose.orientation.w = 1.0;
+    plan.poses.push_back(pose);
+  }
+  smoothApproachToGoal(goal, plan);
+  return true;
+}
+
+bool
+NavfnPlanner::isPotentialCached(int origin, int target, int radius) const
+{
+  if (!potential_valid_ || !costmap_translated_ || origin != potential_origin_ ||
+    potential_change_count_ != costmap_change_count_)
+  {
+    return false;
+  }
+  return potential_complete_ || (target == potential_target_ && radius <= potential_radius_);
+}
+
+void
+NavfnPlanner::cachePotential(int origin, int target, int radius, bool complete, bool result)
+{
+  potential_valid_ = true;
+  potential_origin_ = origin;
+  potential_target_ = target;
+  potential_radius_ = radius;
+  potential_complete_ = complete;
+  potential_result_ = result;
+  potential_change_count_ = costmap_change_count_;
 }
 
 bool
@@ -376,6 +688,11 @@ NavfnPlanner::getPointPotential(const geometry_msgs::msg::Point & world_point)
     return std::numeric_limits<double>::max();
   }
 
+  // a bounded search leaves the potentials outside its window stale
+  if (!planner_->inWindow(mx, my)) {
+    return std::numeric_limits<double>::max();
+  }
+
   unsigned int index = my * planner_->nx + mx;
   return planner_->potarr[index];
 }
@@ -449,7 +766,31 @@ NavfnPlanner::clearRobotCell(unsigned int mx, unsigned int my)
 {
   // TODO(orduno): check usage of this function, might instead be a request to
   //               world_model / map server
-  costmap_->setCost(mx, my, nav2_costmap_2d::FREE_SPACE);
+  if (costmap_->getCost(mx, my) != nav2_costmap_2d::FREE_SPACE) {
+    costmap_->setCost(mx, my, nav2_costmap_2d::FREE_SPACE);
+    costmap_->markChanged(mx, my, mx + 1, my + 1);
+  }
+}
+
+void
+NavfnPlanner::updatePlannerCostmap()
+{
+  unsigned int x0, y0, xn, yn;
+  if (!costmap_translated_ || isPlannerOutOfDate() ||
+    !costmap_->getChangedBounds(costmap_change_count_, x0, y0, xn, yn))
+  {
+    // make sure to resize the underlying array that Navfn uses
+    planner_->setNavArr(
+      costmap_->getSizeInCellsX(),
+      costmap_->getSizeInCellsY());
+
+    planner_->setCostmap(costmap_->getCharMap(), true, allow_unknown_);
+  } else if (xn > x0 && yn > y0) {
+    planner_->setCostmapRegion(costmap_->getCharMap(), x0, y0, xn, yn, allow_unknown_);
+  }
+
+  costmap_change_count_ = costmap_->getChangeCount();
+  costmap_translated_ = true;
 }
 
 }  // namespace nav2_navfn_planner
@@ -0,0 +1,375 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "nav2_navfn_planner/navfn.hpp"
+#include "nav2_util/thread_pool.hpp"
+#include "gtest/gtest.h"
+
+using nav2_navfn_planner::NavFn;
+
+namespace
+{
+
+const int NX = 120;
+const int NY = 90;
+
+// A ROS costmap of random costs, with walls and blobs of lethal cells; every
+// third one is open space, where a heuristic that overestimates makes the
+// search expand the cells around the goal again and again
+std::vector<COSTTYPE> randomCostmap(unsigned int seed)
+{
+  std::vector<COSTTYPE> map(NX * NY, 0);
+  if (seed % 3 == 0) {
+    return map;
+  }
+
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<int> cost(0, 200);
+  for (auto & c : map) {
+    c = static_cast<COSTTYPE>(cost(rng));
+  }
+
+  std::uniform_int_distribution<int> rx(0, NX - 1), ry(0, NY - 1), len(5, 60);
+  for (int i = 0; i < 12; i++) {
+    int x = rx(rng), y = ry(rng), l = len(rng);
+    bool horizontal = rng() % 2;
+    for (int j = 0; j < l; j++) {
+      int wx = horizontal ? x + j : x;
+      int wy = horizontal ? y : y + j;
+      if (wx < NX && wy < NY) {
+        map[wy * NX + wx] = COST_OBS_ROS;
+      }
+    }
+  }
+  for (int i = 0; i < 20; i++) {
+    int x = rx(rng), y = ry(rng), r = rng() % 5;
+    for (int wy = std::max(y - r, 0); wy <= std::min(y + r, NY - 1); wy++) {
+      for (int wx = std::max(x - r, 0); wx <= std::min(x + r, NX - 1); wx++) {
+        map[wy * NX + wx] = COST_OBS_ROS;
+      }
+    }
+  }
+  return map;
+}
+
+// A random free cell of the planner's cost array, off its border
+void randomFreeCell(const NavFn & navfn, std::mt19937 & rng, int * cell)
+{
+  std::uniform_int_distribution<int> rx(1, NX - 2), ry(1, NY - 2);
+  do {
+    cell[0] = rx(rng);
+    cell[1] = ry(rng);
+  } while (navfn.costarr[cell[1] * NX + cell[0]] >= COST_OBS);
+}
+
+// A fixed map, large enough for priority blocks of over PARALLELBLOCKSIZE cells: a
+// patchwork of costs, a wall to go around at a third of the width, and a closed room
+// at three quarters of it
+const int FX = 600;
+const int FY = 400;
+const int WALL_X = FX / 3;
+const int ROOM[4] = {FX * 3 / 4 - 10, 10, FX * 3 / 4 + 10, 30};
+
+std::vector<COSTTYPE> fixedCostmap()
+{
+  std::vector<COSTTYPE> map(FX * FY);
+  for (int y = 0; y < FY; y++) {
+    for (int x = 0; x < FX; x++) {
+      map[y * FX + x] = static_cast<COSTTYPE>((x / 16 + y / 16) % 4 * 10);
+    }
+  }
+  for (int y = 0; y < FY * 2 / 3; y++) {
+    map[y * FX + WALL_X] = COST_OBS_ROS;
+  }
+  for (int x = ROOM[0]; x <= ROOM[2]; x++) {
+    map[ROOM[1] * FX + x] = map[ROOM[3] * FX + x] = COST_OBS_ROS;
+  }
+  for (int y = ROOM[1]; y <= ROOM[3]; y++) {
+    map[y * FX + ROOM[0]] = map[y * FX + ROOM[2]] = COST_OBS_ROS;
+  }
+  return map;
+}
+
+class NavFnModes : public ::testing::Test
+{
+protected:
+  NavFnModes()
+  : navfn(FX, FY)
+  {
+    map = fixedCostmap();
+    navfn.setCostmap(map.data(), true, false);
+  }
+
+  // The full field of the default Dijkstra propagation from goal
+  std::vector<float> dijkstra(int * goal)
+  {
+    navfn.setThreadPool(nullptr);
+    navfn.setGoal(goal);
+    navfn.setStart(goal);
+    EXPECT_TRUE(navfn.calcNavFnDijkstra());
+    return std::vector<float>(navfn.potarr, navfn.potarr + navfn.ns);
+  }
+
+  // Whether two fields reach the same cells, within tol of each other's potentials
+  static void expectSameField(const float * a, const float * b, float tol)
+  {
+    int differ = 0;
+    for (int i = 0; i < FX * FY; i++) {
+      bool ra = a[i] < POT_HIGH;
+      bool rb = b[i] < POT_HIGH;
+      if (ra != rb || (ra && std::abs(a[i] - b[i]) > tol * std::max(a[i], b[i]) + 1.0f)) {
+        differ++;
+      }
+    }
+    EXPECT_EQ(differ, 0);
+  }
+
+  std::vector<COSTTYPE> map;
+  NavFn navfn;
+};
+
+int goalAt(int x, int y, int * goal)
+{
+  goal[0] = x;
+  goal[1] = y;
+  return y * FX + x;
+}
+
+// The length of the last path calcPath() found
+float pathLength(NavFn & navfn, int len)
+{
+  float length = 0.0f;
+  for (int i = 1; i < len; i++) {
+    length += hypot(
+      navfn.getPathX()[i] - navfn.getPathX()[i - 1],
+      navfn.getPathY()[i] - navfn.getPathY()[i - 1]);
+  }
+  return length;
+}
+
+}  // namespace
+
+TEST(NavFn, HeapAstarReachesWhatDijkstraReaches)
+{
+  NavFn navfn(NX, NY);
+  int reached = 0;
+  for (unsigned int seed = 0; seed < 200; seed++) {
+    auto map = randomCostmap(seed);
+    navfn.setCostmap(map.data(), true, false);
+
+    std::mt19937 rng(seed);
+    int goal[2], start[2];
+    randomFreeCell(navfn, rng, goal);
+    randomFreeCell(navfn, rng, start);
+    navfn.setGoal(goal);
+    navfn.setStart(start);
+
+    bool dijkstra = navfn.calcNavFnHeap(false, false);
+    ASSERT_TRUE(dijkstra) << "seed " << seed;
+    int startCell = start[1] * NX + start[0];
+    bool reachable = navfn.potarr[startCell] < POT_HIGH;
+    float optimum = navfn.potarr[startCell];
+
+    bool astar = navfn.calcNavFnHeap(true);
+    EXPECT_EQ(astar, reachable) << "seed " << seed;
+    if (reachable) {
+      reached++;
+      EXPECT_GT(navfn.calcPath(NX * 4), 0) << "seed " << seed;
+      // the heap keys are straight steps, the potentials interpolated ones
+      EXPECT_LT(navfn.potarr[startCell], optimum * 1.1f) << "seed " << seed;
+    }
+  }
+  // the maps aren't so cluttered that few of them have a path
+  EXPECT_GT(reached, 100);
+}
+
+TEST_F(NavFnModes, ThreadedDijkstraMatchesSerial)
+{
+  auto pool = std::make_shared<nav2_util::ThreadPool>(4);
+  int goal[2];
+
+  // in the open, at the map edge, and inside the closed room
+  int goals[3][2] = {{FX / 2, FY / 2}, {FX - 2, 1}, {ROOM[0] + 5, ROOM[1] + 5}};
+  for (auto g : goals) {
+    goalAt(g[0], g[1], goal);
+    auto serial = dijkstra(goal);
+    navfn.setThreadPool(pool);
+    EXPECT_TRUE(navfn.calcNavFnDijkstra());
+    expectSameField(serial.data(), navfn.potarr, 0.01f);
+  }
+
+  // the room is closed, so nothing outside it is reached
+  EXPECT_GE(navfn.potarr[FX / 2 + FY / 2 * FX], POT_HIGH);
+  int start[2] = {FX / 2, FY / 2};
+  navfn.setStart(start);
+  navfn.calcNavFnDijkstra(true);
+  EXPECT_GE(navfn.potarr[FX / 2 + FY / 2 * FX], POT_HIGH);
+
+  // start == goal is settled at once
+  int k = goalAt(FX / 2, FY / 2, goal);
+  navfn.setGoal(goal);
+  navfn.setStart(goal);
+  EXPECT_TRUE(navfn.calcNavFnDijkstra(true));
+  EXPECT_EQ(navfn.potarr[k], 0.0f);
+}
+
+TEST_F(NavFnModes, SweepBatchMatchesDijkstra)
+{
+  // in the open, at the map edge, and inside the closed room
+  int goals[6] = {FX / 2, FY / 2, 1, FY - 2, ROOM[0] + 5, ROOM[1] + 5};
+  std::vector<std::vector<float>> fields(3, std::vector<float>(FX * FY));
+  float * potentials[3] = {fields[0].data(), fields[1].data(), fields[2].data()};
+  navfn.setThreadPool(std::make_shared<nav2_util::ThreadPool>(3));
+  navfn.calcNavFnSweepBatch(goals, 3, potentials);
+
+  for (int i = 0; i < 3; i++) {
+    // the priority blocks settle cells to within a few percent, the heap closer
+    auto reference = dijkstra(goals + 2 * i);
+    expectSameField(reference.data(), potentials[i], 0.05f);
+    navfn.calcNavFnHeap(false);
+    expectSameField(navfn.potarr, potentials[i], 0.005f);
+    EXPECT_EQ(potentials[i][goals[2 * i] + goals[2 * i + 1] * FX], 0.0f);
+  }
+
+  // the room is closed, so nothing outside it is reached
+  EXPECT_GE(potentials[2][FX / 2 + FY / 2 * FX], POT_HIGH);
+
+  // a field loaded in is descended as a computed one, from the far side of the wall
+  int start[2] = {WALL_X - 20, 20};
+  navfn.setGoal(goals);
+  navfn.setStart(start);
+  navfn.setPotential(potentials[0]);
+  int len = navfn.calcPath(FX * 4);
+  ASSERT_GT(len, 0);
+  EXPECT_NEAR(navfn.getPathX()[len - 1], goals[0], 1.0f);
+  EXPECT_NEAR(navfn.getPathY()[len - 1], goals[1], 1.0f);
+
+  // and from the goal itself, the path is the goal
+  navfn.setStart(goals);
+  EXPECT_EQ(navfn.calcPath(FX * 4), 1);
+}
+
+TEST_F(NavFnModes, StationFieldsPlanAsDijkstra)
+{
+  // stations in the open, at the map edge, and inside the closed room, whose fields
+  // the planner computes in one batch and descends from the robot as it requests them
+  int stations[6] = {FX / 2, FY / 2, FX - 2, FY - 2, ROOM[0] + 5, ROOM[1] + 5};
+  std::vector<std::vector<float>> fields(3, std::vector<float>(FX * FY));
+  float * potentials[3] = {fields[0].data(), fields[1].data(), fields[2].data()};
+  navfn.setThreadPool(std::make_shared<nav2_util::ThreadPool>(3));
+  navfn.calcNavFnSweepBatch(stations, 3, potentials);
+
+  int starts[3][2] = {{WALL_X - 20, 20}, {1, 1}, {FX - 2, FY - 2}};
+  for (int i = 0; i < 2; i++) {
+    for (auto start : starts) {
+      int * goal = stations + 2 * i;
+      navfn.setGoal(goal);
+      navfn.setStart(start);
+      EXPECT_TRUE(navfn.calcNavFnDijkstra(true));
+      int len = navfn.calcPath(FX * 4);
+      ASSERT_GT(len, 0);
+      float searched = pathLength(navfn, len);
+
+      navfn.setPotential(potentials[i]);
+      len = navfn.calcPath(FX * 4);
+      ASSERT_GT(len, 0);
+      EXPECT_NEAR(navfn.getPathX()[len - 1], goal[0], 1.0f);
+      EXPECT_NEAR(navfn.getPathY()[len - 1], goal[1], 1.0f);
+      EXPECT_NEAR(pathLength(navfn, len), searched, 0.05f * searched + 2.0f);
+    }
+  }
+
+  // the robot on the station has the station for its path
+  navfn.setGoal(stations);
+  navfn.setStart(stations);
+  navfn.setPotential(potentials[0]);
+  EXPECT_EQ(navfn.calcPath(FX * 4), 1);
+
+  // the room's field doesn't reach the robot, so the planner falls back to a search,
+  // which doesn't reach it either
+  for (auto start : starts) {
+    EXPECT_GE(potentials[2][start[1] * FX + start[0]], POT_HIGH);
+    navfn.setGoal(stations + 4);
+    navfn.setStart(start);
+    navfn.calcNavFnDijkstra(true);
+    EXPECT_GE(navfn.potarr[start[1] * FX + start[0]], POT_HIGH);
+  }
+}
+
+TEST_F(NavFnModes, BoundedWindowMatchesDijkstra)
+{
+  // a short plan in the open, one at the map edge, and one across the wall, which
+  // leaves the first windows and has them doubled
+  int cases[4][4] = {
+    {FX / 2, FY / 2, FX / 2 + 30, FY / 2 + 10},
+    {1, 1, 20, 2},
+    {FX - 2, FY - 2, FX - 2, FY - 40},
+    {WALL_X - 5, 20, WALL_X + 5, 20}};
+  for (auto c : cases) {
+    for (bool astar : {false, true}) {
+      int * goal = c;
+      int * start = c + 2;
+      int startCell = start[1] * FX + start[0];
+      navfn.setGoal(goal);
+      navfn.setStart(start);
+      EXPECT_TRUE(navfn.calcNavFnDijkstra(true));
+      float full = navfn.potarr[startCell];
+      int len = navfn.calcPath(FX * 4);
+      ASSERT_GT(len, 0);
+      float searched = pathLength(navfn, len);
+
+      // the potentials left from a search to the other side of the map mustn't
+      // leak into the window, nor lead the path astray
+      int other[2] = {FX - 1 - goal[0], FY - 1 - goal[1]};
+      navfn.setGoal(other);
+      EXPECT_TRUE(navfn.calcNavFnDijkstra());
+      navfn.setGoal(goal);
+      EXPECT_TRUE(navfn.calcNavFnBounded(2, astar));
+      EXPECT_TRUE(navfn.inWindow(goal[0], goal[1]));
+      EXPECT_TRUE(navfn.inWindow(start[0], start[1]));
+      EXPECT_NEAR(navfn.potarr[startCell], full, 0.05f * full);
+      len = navfn.calcPath(FX * 4);
+      ASSERT_GT(len, 0);
+      EXPECT_NEAR(navfn.getPathX()[len - 1], goal[0], 1.0f);
+      EXPECT_NEAR(navfn.getPathY()[len - 1], goal[1], 1.0f);
+      EXPECT_NEAR(pathLength(navfn, len), searched, 0.05f * searched + 2.0f);
+    }
+  }
+  // the last plan goes through the gap under the wall
+  EXPECT_TRUE(navfn.inWindow(WALL_X, FY * 2 / 3));
+
+  // the window of a start on the goal is the goal and the margin around it
+  int goal[2];
+  int k = goalAt(FX / 2, FY / 2, goal);
+  navfn.setGoal(goal);
+  navfn.setStart(goal);
+  EXPECT_TRUE(navfn.calcNavFnBounded(2, false));
+  EXPECT_EQ(navfn.potarr[k], 0.0f);
+  EXPECT_FALSE(navfn.inWindow(FX / 2 + 3, FY / 2));
+
+  // an unreachable goal grows the window to the whole map, and fails
+  goalAt(ROOM[0] + 5, ROOM[1] + 5, goal);
+  int start[2] = {ROOM[2] + 5, ROOM[1] + 5};
+  navfn.setGoal(goal);
+  navfn.setStart(start);
+  EXPECT_FALSE(navfn.calcNavFnBounded(2, false));
+  EXPECT_TRUE(navfn.inWindow(1, 1));
+  EXPECT_TRUE(navfn.inWindow(FX - 2, FY - 2));
+}
@@ -0,0 +1,65 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_PLANNER__PATH_SHORTENER_HPP_
+#define NAV2_PLANNER__PATH_SHORTENER_HPP_
+
+#include "nav_msgs/msg/path.hpp"
+#include "nav2_costmap_2d/costmap_2d.hpp"
+
+namespace nav2_planner
+{
+
+/**
+ * @class nav2_planner::PathShortener
+ * @brief Post-processing of planned paths. Runs of poses are replaced by straight
+ * lines wherever the line doesn't cross a costmap cell costlier than the highest
+ * cost the replaced poses crossed, then the corners left are resampled at an even
+ * spacing. The path is rewritten in its own buffer, and the start and goal poses
+ * are kept as they are. Calls hold the costmap's lock, so it may be shared between
+ * threads.
+ */
+class PathShortener
+{
+public:
+  /**
+   * @brief A constructor for nav2_planner::PathShortener
+   * @param costmap The costmap the paths are checked against
+   * @param point_spacing The distance between the poses of a shortened path, in
+   * meters, or 0 to keep only its corners
+   */
+  PathShortener(nav2_costmap_2d::Costmap2D * costmap, double point_spacing);
+
+  /**
+   * @brief Shorten and resample a path in place
+   * @param path The path, left as it is if any of its poses is off the costmap
+   */
+  void shorten(nav_msgs::msg::Path & path) const;
+
+protected:
+  // Whether a straight line crosses no cell costlier than max_cost, must hold the costmap lock
+  bool isVisible(
+    unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1,
+    unsigned char max_cost) const;
+
+  // Replace the corners at the front of the path with poses spaced along them
+  void resample(nav_msgs::msg::Path & path, size_t corners) const;
+
+  nav2_costmap_2d::Costmap2D * costmap_;
+  double point_spacing_;
+};
+
+}  // namespace nav2_planner
+
+#endif  // NAV2_PLANNER__PATH_SHORTENER_HPP_
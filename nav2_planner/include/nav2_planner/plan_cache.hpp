@@ -0,0 +1,117 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_PLANNER__PLAN_CACHE_HPP_
+#define NAV2_PLANNER__PLAN_CACHE_HPP_
+
+#include <chrono>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "geometry_msgs/msg/pose_stamped.hpp"
+#include "nav_msgs/msg/path.hpp"
+#include "nav2_costmap_2d/costmap_2d.hpp"
+
+namespace nav2_planner
+{
+
+/**
+ * @class nav2_planner::PlanCache
+ * @brief Least recently used cache of plans, keyed on the planner and the costmap
+ * cells of the start and goal. A cached plan is returned as long as the costmap
+ * cells it crosses keep the costs they had when it was planned; changes elsewhere
+ * on the map don't invalidate it, so it may miss a shortcut opening up until it
+ * ages out. Calls hold the costmap's lock, so the cache may be shared between threads.
+ */
+class PlanCache
+{
+public:
+  /**
+   * @brief A constructor for nav2_planner::PlanCache
+   * @param costmap The costmap the plans are made on
+   * @param capacity The number of plans to keep
+   * @param max_age How long a plan may be reused for, in seconds
+   */
+  PlanCache(nav2_costmap_2d::Costmap2D * costmap, size_t capacity, double max_age);
+
+  /**
+   * @brief Look up a plan, checking it against the changes to the costmap since it was made
+   * @param planner_id The planner the plan is for
+   * @param start The start of the request
+   * @param goal The goal of the request
+   * @param path Set to the cached plan, ending at goal, if one is found
+   * @return True if a valid plan was found
+   */
+  bool lookup(
+    const std::string & planner_id,
+    const geometry_msgs::msg::PoseStamped & start,
+    const geometry_msgs::msg::PoseStamped & goal,
+    nav_msgs::msg::Path & path);
+
+  /**
+   * @brief Add a plan, evicting the least recently used one if full
+   * @param planner_id The planner the plan is from
+   * @param start The start of the request
+   * @param goal The goal of the request
+   * @param path The plan
+   */
+  void insert(
+    const std::string & planner_id,
+    const geometry_msgs::msg::PoseStamped & start,
+    const geometry_msgs::msg::PoseStamped & goal,
+    const nav_msgs::msg::Path & path);
+
+  /**
+   * @brief Drop every plan
+   */
+  void clear();
+
+  size_t size() const {return entries_.size();}
+
+protected:
+  struct Entry
+  {
+    std::string key;
+    nav_msgs::msg::Path path;
+    std::vector<unsigned int> cells;  // costmap cell of each pose
+    std::vector<unsigned char> costs;  // cost of each of those cells when planned
+    unsigned int x0, y0, xn, yn;  // bounds of the cells
+    uint64_t change_count;  // costmap change count the plan was last checked at
+    std::chrono::steady_clock::time_point created;
+  };
+
+  // Build the key of a request, false if the start or goal is off the costmap
+  bool makeKey(
+    const std::string & planner_id,
+    const geometry_msgs::msg::PoseStamped & start,
+    const geometry_msgs::msg::PoseStamped & goal,
+    std::string & key) const;
+
+  // Whether the plan's cells still have their costs, must hold the costmap lock
+  bool revalidate(Entry & entry) const;
+
+  nav2_costmap_2d::Costmap2D * costmap_;
+  size_t capacity_;
+  std::chrono::duration<double> max_age_;
+
+  // most recently used first
+  std::list<Entry> entries_;
+  std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+};
+
+}  // namespace nav2_planner
+
+#endif  // NAV2_PLANNER__PLAN_CACHE_HPP_
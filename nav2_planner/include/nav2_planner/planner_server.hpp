@@ -15,9 +15,11 @@
 #ifndef NAV2_PLANNER__PLANNER_SERVER_HPP_
 #define NAV2_PLANNER__PLANNER_SERVER_HPP_
 
+#include <atomic>
 #include <chrono>
 #include <string>
 #include <memory>
+#include <mutex>
 #include <vector>
 #include <unordered_map>
 
@@ -26,9 +28,11 @@
 #include "nav_msgs/msg/path.hpp"
 #include "nav2_util/lifecycle_node.hpp"
 #include "nav2_msgs/action/compute_path_to_pose.hpp"
+#include "nav2_msgs/action/compute_paths_to_poses.hpp"
 #include "nav2_msgs/msg/costmap.hpp"
 #include "nav2_util/robot_utils.hpp"
 #include "nav2_util/simple_action_server.hpp"
+#include "nav2_util/concurrent_action_server.hpp"
 #include "visualization_msgs/msg/marker.hpp"
 #include "tf2_ros/transform_listener.h"
 #include "tf2_ros/create_timer_ros.h"
@@ -36,6 +40,8 @@
 #include "pluginlib/class_loader.hpp"
 #include "pluginlib/class_list_macros.hpp"
 #include "nav2_core/global_planner.hpp"
+#include "nav2_planner/plan_cache.hpp"
+#include "nav2_planner/path_shortener.hpp"
 
 namespace nav2_planner
 {
@@ -49,8 +55,9 @@ class PlannerServer : public nav2_util::LifecycleNode
 public:
   /**
    * @brief A constructor for nav2_planner::PlannerServer
+   * @param options Additional options to control creation of the node.
    */
-  PlannerServer();
+  explicit PlannerServer(const rclcpp::NodeOptions & options = rclcpp::NodeOptions());
   /**
    * @brief A destructor for nav2_planner::PlannerServer
    */
@@ -101,19 +108,99 @@ protected:
   // Our action server implements the ComputePathToPose action
   std::unique_ptr<ActionServer> action_server_;
 
+  using ConcurrentActionServer =
+    nav2_util::ConcurrentActionServer<nav2_msgs::action::ComputePathToPose>;
+
+  // Implements it instead with planner_workers above one, planning for several clients at once
+  std::unique_ptr<ConcurrentActionServer> concurrent_action_server_;
+
+  using BatchActionServer = nav2_util::SimpleActionServer<nav2_msgs::action::ComputePathsToPoses>;
+
+  // Plans from the robot to many goals at once, e.g. to pick the cheapest
+  std::unique_ptr<BatchActionServer> batch_action_server_;
+
   /**
    * @brief The action server callback which calls planner to get the path
    */
   void computePlan();
 
+  /**
+   * @brief The concurrent action server callback which calls planner to get the path
+   * @param handle The goal to plan for
+   * @param worker The worker running the callback, which plans in its own workspace
+   */
+  void computePlanConcurrently(
+    const std::shared_ptr<ConcurrentActionServer::GoalHandle> & handle, unsigned int worker);
+
+  /**
+   * @brief The batch action server callback which calls planner to get a path to each goal
+   */
+  void computePlans();
+
+  // A set of planner instances, used by one thread at a time
+  struct PlannerWorkspace
+  {
+    PlannerMap planners;
+    std::mutex mutex;
+  };
+
+  /**
+   * @brief Get a plan from the cache or from a planner in a workspace, then shorten it
+   * @param planner_id The requested planner, may be empty if there is only one
+   * @param start The robot pose
+   * @param goal The goal pose
+   * @param workspace The index of the workspace to plan in
+   * @return The path, empty on failure
+   */
+  nav_msgs::msg::Path getPlan(
+    const std::string & planner_id,
+    const geometry_msgs::msg::PoseStamped & start,
+    const geometry_msgs::msg::PoseStamped & goal,
+    unsigned int workspace);
+
+  /**
+   * @brief Get a quick plan with the interim planner, if there is one, to follow while the
+   * requested planner computes the final plan. The plan is published
+   * @param planner_id The requested planner, may be empty if there is only one
+   * @param start The robot pose
+   * @param goal The goal pose
+   * @param workspace The index of the workspace to plan in
+   * @param path Set to the interim plan
+   * @return True if there is an interim plan: the interim planner is set, differs from the
+   * requested one, the final plan isn't cached, and a path is found
+   */
+  bool getInterimPlan(
+    const std::string & planner_id,
+    const geometry_msgs::msg::PoseStamped & start,
+    const geometry_msgs::msg::PoseStamped & goal,
+    unsigned int workspace,
+    nav_msgs::msg::Path & path);
+
+  /**
+   * @brief Find the planner to use for a request
+   * @param workspace The workspace to take the planner from, whose mutex must be held
+   * @param planner_id The requested planner, may be empty if there is only one
+   * @return The planner, or nullptr if there is no such planner
+   */
+  nav2_core::GlobalPlanner::Ptr getPlanner(
+    PlannerWorkspace & workspace, const std::string & planner_id);
+
+  /**
+   * @brief Keep the costmap updating at its full rate while plans are requested, waiting
+   * for it to catch up if it was idling, see Costmap2DROS::demandUpdates()
+   */
+  void waitForCostmap();
+
   /**
    * @brief Publish a path for visualization purposes
    * @param path Reference to Global Path
    */
   void publishPlan(const nav_msgs::msg::Path & path);
 
-  // Planner
-  PlannerMap planners_;
+  // Planners, one workspace per worker of the concurrent action server or a single one.
+  // The planners aren't reentrant, and each action server runs on its own thread, so
+  // they're used under their workspace's mutex. The batch action server uses the first.
+  std::vector<std::unique_ptr<PlannerWorkspace>> workspaces_;
   pluginlib::ClassLoader<nav2_core::GlobalPlanner> gp_loader_;
   std::vector<std::string> plugin_ids_, plugin_types_;
   std::string planner_ids_concat_;
@@ -129,8 +216,17 @@ protected:
   // Publishers for the path
   rclcpp_lifecycle::LifecyclePublisher<nav_msgs::msg::Path>::SharedPtr plan_publisher_;
 
+  // Plans reused for repeated requests, if enabled
+  std::unique_ptr<PlanCache> plan_cache_;
+
+  // Post-processing of the paths found, if enabled
+  std::unique_ptr<PathShortener> path_shortener_;
+
+  // The planner giving a path to follow while the requested one plans, empty for none
+  std::string interim_planner_id_;
+
   // Whether we've published the single planner warning yet
-  bool single_planner_warning_given_{false};
+  std::atomic<bool> single_planner_warning_given_{false};
 };
 
 }  // namespace nav2_planner
@@ -0,0 +1,143 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_planner/path_shortener.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "geometry_msgs/msg/point.hpp"
+#include "nav2_util/line_iterator.hpp"
+
+namespace nav2_planner
+{
+
+PathShortener::PathShortener(
+  nav2_costmap_2d::Costmap2D * costmap, double point_spacing)
+: costmap_(costmap), point_spacing_(point_spacing)
+{
+}
+
+void
+PathShortener::shorten(nav_msgs::msg::Path & path) const
+{
+  auto & poses = path.poses;
+  if (poses.size() < 3) {
+    return;
+  }
+
+  std::unique_lock<nav2_costmap_2d::Costmap2D::mutex_t> lock(*(costmap_->getMutex()));
+
+  std::vector<unsigned int> cells(poses.size());
+  for (size_t i = 0; i < poses.size(); ++i) {
+    unsigned int mx, my;
+    if (!costmap_->worldToMap(poses[i].pose.position.x, poses[i].pose.position.y, mx, my)) {
+      return;  // can't be checked against the costmap
+    }
+    cells[i] = costmap_->getIndex(mx, my);
+  }
+
+  const unsigned char * charmap = costmap_->getCharMap();
+  unsigned int size_x = costmap_->getSizeInCellsX();
+
+  // keep a pose only where the line from the last kept one to the next is blocked,
+  // moving the kept poses to the front of the buffer
+  size_t corners = 1;
+  size_t anchor = 0;
+  unsigned char max_cost = charmap[cells[0]];
+  for (size_t i = 1; i < poses.size(); ++i) {
+    max_cost = std::max(max_cost, charmap[cells[i]]);
+    if (cells[i] == cells[i - 1] || i - 1 == anchor ||
+      isVisible(
+        cells[anchor] % size_x, cells[anchor] / size_x,
+        cells[i] % size_x, cells[i] / size_x, max_cost))
+    {
+      continue;
+    }
+    anchor = i - 1;
+    max_cost = std::max(charmap[cells[anchor]], charmap[cells[i]]);
+    if (anchor != corners) {
+      poses[corners] = std::move(poses[anchor]);
+    }
+    ++corners;
+  }
+  if (poses.size() - 1 != corners) {
+    poses[corners] = std::move(poses.back());
+  }
+  ++corners;
+
+  resample(path, corners);
+}
+
+bool
+PathShortener::isVisible(
+  unsigned int x0, unsigned int y0, unsigned int x1, unsigned int y1,
+  unsigned char max_cost) const
+{
+  const unsigned char * charmap = costmap_->getCharMap();
+  unsigned int size_x = costmap_->getSizeInCellsX();
+  for (nav2_util::LineIterator line(x0, y0, x1, y1); line.isValid(); line.advance()) {
+    if (charmap[line.getY() * size_x + line.getX()] > max_cost) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void
+PathShortener::resample(nav_msgs::msg::Path & path, size_t corners) const
+{
+  auto & poses = path.poses;
+  if (point_spacing_ <= 0.0) {
+    poses.resize(corners);
+    return;
+  }
+
+  std::vector<geometry_msgs::msg::Point> points(corners);
+  std::vector<unsigned int> steps(corners, 0);
+  size_t count = 1;
+  for (size_t i = 0; i < corners; ++i) {
+    points[i] = poses[i].pose.position;
+    if (i > 0) {
+      double length = std::hypot(points[i].x - points[i - 1].x, points[i].y - points[i - 1].y);
+      steps[i] = std::max(1u, static_cast<unsigned int>(std::ceil(length / point_spacing_)));
+      count += steps[i];
+    }
+  }
+  auto goal = std::move(poses[corners - 1]);
+
+  // the start pose stays first, the rest is rewritten
+  poses.resize(count);
+  size_t index = 1;
+  for (size_t i = 1; i < corners; ++i) {
+    for (unsigned int step = 1; step <= steps[i]; ++step) {
+      auto & pose = poses[index++].pose;
+      double t = static_cast<double>(step) / steps[i];
+      pose.position.x = points[i - 1].x + t * (points[i].x - points[i - 1].x);
+      pose.position.y = points[i - 1].y + t * (points[i].y - points[i - 1].y);
+      pose.position.z = 0.0;
+      pose.orientation = geometry_msgs::msg::Quaternion();
+      pose.orientation.w = 1.0;
+    }
+  }
+  for (size_t i = 1; i < count; ++i) {
+    poses[i].header = poses[0].header;
+  }
+  poses.back() = std::move(goal);
+}
+
+}  // namespace nav2_planner
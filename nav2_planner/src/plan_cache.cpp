@@ -0,0 +1,176 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_planner/plan_cache.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <utility>
+
+namespace nav2_planner
+{
+
+PlanCache::PlanCache(
+  nav2_costmap_2d::Costmap2D * costmap, size_t capacity, double max_age)
+: costmap_(costmap), capacity_(capacity), max_age_(max_age)
+{
+}
+
+bool
+PlanCache::makeKey(
+  const std::string & planner_id,
+  const geometry_msgs::msg::PoseStamped & start,
+  const geometry_msgs::msg::PoseStamped & goal,
+  std::string & key) const
+{
+  unsigned int sx, sy, gx, gy;
+  if (!costmap_->worldToMap(start.pose.position.x, start.pose.position.y, sx, sy) ||
+    !costmap_->worldToMap(goal.pose.position.x, goal.pose.position.y, gx, gy))
+  {
+    return false;
+  }
+  key = planner_id + "/" + std::to_string(sx) + "," + std::to_string(sy) + "/" +
+    std::to_string(gx) + "," + std::to_string(gy);
+  return true;
+}
+
+bool
+PlanCache::lookup(
+  const std::string & planner_id,
+  const geometry_msgs::msg::PoseStamped & start,
+  const geometry_msgs::msg::PoseStamped & goal,
+  nav_msgs::msg::Path & path)
+{
+  std::unique_lock<nav2_costmap_2d::Costmap2D::mutex_t> lock(*(costmap_->getMutex()));
+
+  std::string key;
+  if (!makeKey(planner_id, start, goal, key)) {
+    return false;
+  }
+  auto it = index_.find(key);
+  if (it == index_.end()) {
+    return false;
+  }
+
+  auto entry = it->second;
+  if (std::chrono::steady_clock::now() - entry->created > max_age_ || !revalidate(*entry)) {
+    index_.erase(it);
+    entries_.erase(entry);
+    return false;
+  }
+
+  // move to the front as the most recently used
+  entries_.splice(entries_.begin(), entries_, entry);
+
+  path = entry->path;
+  path.poses.back().pose = goal.pose;
+  return true;
+}
+
+bool
+PlanCache::revalidate(Entry & entry) const
+{
+  unsigned int x0, y0, xn, yn;
+  if (!costmap_->getChangedBounds(entry.change_count, x0, y0, xn, yn)) {
+    return false;
+  }
+
+  // only the cells within the changed bounds need a look
+  if (xn > x0 && yn > y0 &&
+    x0 < entry.xn && entry.x0 < xn && y0 < entry.yn && entry.y0 < yn)
+  {
+    unsigned int size_x = costmap_->getSizeInCellsX();
+    const unsigned char * charmap = costmap_->getCharMap();
+    for (size_t i = 0; i < entry.cells.size(); ++i) {
+      unsigned int mx = entry.cells[i] % size_x;
+      unsigned int my = entry.cells[i] / size_x;
+      if (mx >= x0 && mx < xn && my >= y0 && my < yn &&
+        charmap[entry.cells[i]] != entry.costs[i])
+      {
+        return false;
+      }
+    }
+  }
+
+  entry.change_count = costmap_->getChangeCount();
+  return true;
+}
+
+void
+PlanCache::insert(
+  const std::string & planner_id,
+  const geometry_msgs::msg::PoseStamped & start,
+  const geometry_msgs::msg::PoseStamped & goal,
+  const nav_msgs::msg::Path & path)
+{
+  if (capacity_ == 0 || path.poses.empty()) {
+    return;
+  }
+
+  std::unique_lock<nav2_costmap_2d::Costmap2D::mutex_t> lock(*(costmap_->getMutex()));
+
+  Entry entry;
+  if (!makeKey(planner_id, start, goal, entry.key)) {
+    return;
+  }
+
+  unsigned int size_x = costmap_->getSizeInCellsX();
+  const unsigned char * charmap = costmap_->getCharMap();
+  entry.x0 = entry.y0 = std::numeric_limits<unsigned int>::max();
+  entry.xn = entry.yn = 0;
+  for (const auto & pose : path.poses) {
+    unsigned int mx, my;
+    if (!costmap_->worldToMap(pose.pose.position.x, pose.pose.position.y, mx, my)) {
+      return;  // can't be checked against the costmap
+    }
+    unsigned int index = my * size_x + mx;
+    if (!entry.cells.empty() && entry.cells.back() == index) {
+      continue;
+    }
+    entry.cells.push_back(index);
+    entry.costs.push_back(charmap[index]);
+    entry.x0 = std::min(entry.x0, mx);
+    entry.y0 = std::min(entry.y0, my);
+    entry.xn = std::max(entry.xn, mx + 1);
+    entry.yn = std::max(entry.yn, my + 1);
+  }
+  entry.path = path;
+  entry.change_count = costmap_->getChangeCount();
+  entry.created = std::chrono::steady_clock::now();
+
+  auto it = index_.find(entry.key);
+  if (it != index_.end()) {
+    entries_.erase(it->second);
+    index_.erase(it);
+  }
+  entries_.push_front(std::move(entry));
+  index_[entries_.front().key] = entries_.begin();
+
+  if (entries_.size() > capacity_) {
+    index_.erase(entries_.back().key);
+    entries_.pop_back();
+  }
+}
+
+void
+PlanCache::clear()
+{
+  std::unique_lock<nav2_costmap_2d::Costmap2D::mutex_t> lock(*(costmap_->getMutex()));
+  entries_.clear();
+  index_.clear();
+}
+
+}  // namespace nav2_planner
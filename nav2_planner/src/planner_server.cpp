@@ -13,6 +13,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
 #include <chrono>
 #include <cmath>
 #include <iomanip>
@@ -34,8 +35,8 @@ using namespace std::chrono_literals;
 namespace nav2_planner
 {
 
-PlannerServer::PlannerServer()
-: nav2_util::LifecycleNode("nav2_planner", "", true),
+PlannerServer::PlannerServer(const rclcpp::NodeOptions & options)
+: nav2_util::LifecycleNode("nav2_planner", "", true, options),
   gp_loader_("nav2_core", "nav2_core::GlobalPlanner"), costmap_(nullptr)
 {
   RCLCPP_INFO(get_logger(), "Creating");
@@ -46,6 +47,12 @@ PlannerServer::PlannerServer()
   default_type.push_back("nav2_navfn_planner/NavfnPlanner");
   declare_parameter("planner_plugin_ids", default_id);
   declare_parameter("planner_plugin_types", default_type);
+  declare_parameter("plan_cache_size", 0);
+  declare_parameter("plan_cache_max_age", 10.0);
+  declare_parameter("planner_workers", 1);
+  declare_parameter("shorten_paths", false);
+  declare_parameter("path_point_spacing", 0.1);
+  declare_parameter("interim_planner_id", std::string(""));
 
   // Setup the global costmap
   costmap_ros_ = std::make_shared<nav2_costmap_2d::Costmap2DROS>(
@@ -58,9 +65,11 @@ PlannerServer::PlannerServer()
 PlannerServer::~PlannerServer()
 {
   RCLCPP_INFO(get_logger(), "Destroying");
-  PlannerMap::iterator it;
-  for (it = planners_.begin(); it != planners_.end(); ++it) {
-    it->second.reset();
+  for (auto & workspace : workspaces_) {
+    PlannerMap::iterator it;
+    for (it = workspace->planners.begin(); it != workspace->planners.end(); ++it) {
+      it->second.reset();
+    }
   }
 }
 
@@ -89,35 +98,82 @@ PlannerServer::on_configure(const rclcpp_lifecycle::State & state)
     exit(-1);
   }
 
-  for (uint i = 0; i != plugin_types_.size(); i++) {
-    try {
-      nav2_core::GlobalPlanner::Ptr planner =
-        gp_loader_.createUniqueInstance(plugin_types_[i]);
-      RCLCPP_INFO(
-        get_logger(), "Created global planner plugin %s of type %s",
-        plugin_ids_[i].c_str(), plugin_types_[i].c_str());
-      planner->configure(node, plugin_ids_[i], tf_, costmap_ros_);
-      planners_.insert({plugin_ids_[i], planner});
-    } catch (const pluginlib::PluginlibException & ex) {
-      RCLCPP_FATAL(
-        get_logger(), "Failed to create global planner. Exception: %s",
-        ex.what());
-      exit(-1);
+  // Each worker plans with its own planner instances, which copy the costmap
+  // under its lock and then plan on their copy alongside each other
+  int planner_workers;
+  get_parameter("planner_workers", planner_workers);
+  planner_workers = std::max(planner_workers, 1);
+
+  for (int w = 0; w != planner_workers; w++) {
+    auto workspace = std::make_unique<PlannerWorkspace>();
+    for (uint i = 0; i != plugin_types_.size(); i++) {
+      try {
+        nav2_core::GlobalPlanner::Ptr planner =
+          gp_loader_.createUniqueInstance(plugin_types_[i]);
+        RCLCPP_INFO(
+          get_logger(), "Created global planner plugin %s of type %s",
+          plugin_ids_[i].c_str(), plugin_types_[i].c_str());
+        planner->configure(node, plugin_ids_[i], tf_, costmap_ros_);
+        workspace->planners.insert({plugin_ids_[i], planner});
+      } catch (const pluginlib::PluginlibException & ex) {
+        RCLCPP_FATAL(
+          get_logger(), "Failed to create global planner. Exception: %s",
+          ex.what());
+        exit(-1);
+      }
     }
+    workspaces_.push_back(std::move(workspace));
   }
 
   for (uint i = 0; i != plugin_types_.size(); i++) {
     planner_ids_concat_ += plugin_ids_[i] + std::string(" ");
   }
 
+  int plan_cache_size;
+  double plan_cache_max_age;
+  get_parameter("plan_cache_size", plan_cache_size);
+  get_parameter("plan_cache_max_age", plan_cache_max_age);
+  if (plan_cache_size > 0) {
+    plan_cache_ = std::make_unique<PlanCache>(
+      costmap_, static_cast<size_t>(plan_cache_size), plan_cache_max_age);
+  }
+
+  bool shorten_paths;
+  double path_point_spacing;
+  get_parameter("shorten_paths", shorten_paths);
+  get_parameter("path_point_spacing", path_point_spacing);
+  if (shorten_paths) {
+    path_shortener_ = std::make_unique<PathShortener>(costmap_, path_point_spacing);
+  }
+
+  get_parameter("interim_planner_id", interim_planner_id_);
+
   // Initialize pubs & subs
   plan_publisher_ = create_publisher<nav_msgs::msg::Path>("plan", 1);
 
   // Create the action server that we implement with our navigateToPose method
-  action_server_ = std::make_unique<ActionServer>(
+  if (planner_workers > 1) {
+    RCLCPP_INFO(get_logger(), "Planning for up to %d requests at once", planner_workers);
+    concurrent_action_server_ = std::make_unique<ConcurrentActionServer>(
+      rclcpp_node_,
+      "compute_path_to_pose",
+      std::bind(
+        &PlannerServer::computePlanConcurrently, this,
+        std::placeholders::_1, std::placeholders::_2),
+      planner_workers, false);
+  } else {
+    // Replanning sends many goals a second, run them all on one thread
+    action_server_ = std::make_unique<ActionServer>(
+      rclcpp_node_,
+      "compute_path_to_pose",
+      std::bind(&PlannerServer::computePlan, this),
+      true, std::chrono::milliseconds(500), true, true);
+  }
+
+  batch_action_server_ = std::make_unique<BatchActionServer>(
     rclcpp_node_,
-    "compute_path_to_pose",
-    std::bind(&PlannerServer::computePlan, this));
+    "compute_paths_to_poses",
+    std::bind(&PlannerServer::computePlans, this));
 
   return nav2_util::CallbackReturn::SUCCESS;
 }
@@ -128,12 +184,19 @@ PlannerServer::on_activate(const rclcpp_lifecycle::State & state)
   RCLCPP_INFO(get_logger(), "Activating");
 
   plan_publisher_->on_activate();
-  action_server_->activate();
+  if (action_server_) {
+    action_server_->activate();
+  } else {
+    concurrent_action_server_->activate();
+  }
+  batch_action_server_->activate();
   costmap_ros_->on_activate(state);
 
-  PlannerMap::iterator it;
-  for (it = planners_.begin(); it != planners_.end(); ++it) {
-    it->second->activate();
+  for (auto & workspace : workspaces_) {
+    PlannerMap::iterator it;
+    for (it = workspace->planners.begin(); it != workspace->planners.end(); ++it) {
+      it->second->activate();
+    }
   }
 
   return nav2_util::CallbackReturn::SUCCESS;
@@ -144,13 +207,20 @@ PlannerServer::on_deactivate(const rclcpp_lifecycle::State & state)
 {
   RCLCPP_INFO(get_logger(), "Deactivating");
 
-  action_server_->deactivate();
+  if (action_server_) {
+    action_server_->deactivate();
+  } else {
+    concurrent_action_server_->deactivate();
+  }
+  batch_action_server_->deactivate();
   plan_publisher_->on_deactivate();
   costmap_ros_->on_deactivate(state);
 
-  PlannerMap::iterator it;
-  for (it = planners_.begin(); it != planners_.end(); ++it) {
-    it->second->deactivate();
+  for (auto & workspace : workspaces_) {
+    PlannerMap::iterator it;
+    for (it = workspace->planners.begin(); it != workspace->planners.end(); ++it) {
+      it->second->deactivate();
+    }
   }
 
   return nav2_util::CallbackReturn::SUCCESS;
@@ -162,15 +232,21 @@ PlannerServer::on_cleanup(const rclcpp_lifecycle::State & state)
   RCLCPP_INFO(get_logger(), "Cleaning up");
 
   action_server_.reset();
+  concurrent_action_server_.reset();
+  batch_action_server_.reset();
   plan_publisher_.reset();
   tf_.reset();
   costmap_ros_->on_cleanup(state);
 
-  PlannerMap::iterator it;
-  for (it = planners_.begin(); it != planners_.end(); ++it) {
-    it->second->cleanup();
+  for (auto & workspace : workspaces_) {
+    PlannerMap::iterator it;
+    for (it = workspace->planners.begin(); it != workspace->planners.end(); ++it) {
+      it->second->cleanup();
+    }
   }
-  planners_.clear();
+  workspaces_.clear();
+  plan_cache_.reset();
+  path_shortener_.reset();
 
   return nav2_util::CallbackReturn::SUCCESS;
 }
@@ -213,6 +289,8 @@ PlannerServer::computePlan()
       return;
     }
 
+    waitForCostmap();
+
     geometry_msgs::msg::PoseStamped start;
     if (!costmap_ros_->getRobotPose(start)) {
       RCLCPP_ERROR(this->get_logger(), "Could not get robot pose");
@@ -229,31 +307,25 @@ PlannerServer::computePlan()
       "(%.2f, %.2f).", start.pose.position.x, start.pose.position.y,
       goal->pose.pose.position.x, goal->pose.pose.position.y);
 
-    if (planners_.find(goal->planner_id) != planners_.end()) {
-      result->path = planners_[goal->planner_id]->createPlan(start, goal->pose);
-    } else {
-      if (planners_.size() == 1 && goal->planner_id.empty()) {
-        if (!single_planner_warning_given_) {
-          single_planner_warning_given_ = true;
-          RCLCPP_WARN(
-            get_logger(), "No planners specified in action call. "
-            "Server will use only plugin %s in server."
-            " This warning will appear once.", planner_ids_concat_.c_str());
-        }
-        result->path = planners_[planners_.begin()->first]->createPlan(start, goal->pose);
-      } else {
-        RCLCPP_ERROR(
-          get_logger(), "planner %s is not a valid planner. "
-          "Planner names are: %s", goal->planner_id.c_str(),
-          planner_ids_concat_.c_str());
+    auto feedback = std::make_shared<nav2_msgs::action::ComputePathToPose::Feedback>();
+    if (getInterimPlan(goal->planner_id, start, goal->pose, 0, feedback->path)) {
+      action_server_->publish_feedback(feedback);
+
+      if (action_server_->is_cancel_requested()) {
+        RCLCPP_INFO(get_logger(), "Goal was canceled. Canceling planning action.");
+        action_server_->terminate_all();
+        return;
       }
     }
 
+    result->path = getPlan(goal->planner_id, start, goal->pose, 0);
+
     if (result->path.poses.size() == 0) {
       RCLCPP_WARN(
         get_logger(), "Planning algorithm %s failed to generate a valid"
         " path to (%.2f, %.2f)", goal->planner_id.c_str(),
         goal->pose.pose.position.x, goal->pose.pose.position.y);
+      costmap_ros_->saveFlightRecording();
       action_server_->terminate_current();
       return;
     }
@@ -291,6 +363,243 @@ PlannerServer::computePlan()
   }
 }
 
+void
+PlannerServer::computePlans()
+{
+  auto goal = batch_action_server_->get_current_goal();
+  auto result = std::make_shared<nav2_msgs::action::ComputePathsToPoses::Result>();
+
+  try {
+    if (!batch_action_server_->is_server_active()) {
+      RCLCPP_DEBUG(get_logger(), "Batch action server is inactive. Stopping.");
+      return;
+    }
+
+    if (batch_action_server_->is_cancel_requested()) {
+      RCLCPP_INFO(get_logger(), "Goal was canceled. Canceling batch planning action.");
+      batch_action_server_->terminate_all();
+      return;
+    }
+
+    if (batch_action_server_->is_preempt_requested()) {
+      RCLCPP_INFO(get_logger(), "Preempting the goal poses.");
+      goal = batch_action_server_->accept_pending_goal();
+    }
+
+    waitForCostmap();
+
+    geometry_msgs::msg::PoseStamped start;
+    if (goal->use_start) {
+      start = goal->start;
+    } else if (!costmap_ros_->getRobotPose(start)) {
+      RCLCPP_ERROR(this->get_logger(), "Could not get robot pose");
+      batch_action_server_->terminate_current();
+      return;
+    }
+
+    {
+      auto & workspace = *workspaces_.front();
+      std::lock_guard<std::mutex> lock(workspace.mutex);
+      auto planner = getPlanner(workspace, goal->planner_id);
+      if (!planner) {
+        batch_action_server_->terminate_current();
+        return;
+      }
+      result->paths = planner->createPlans(start, goal->poses, result->costs);
+    }
+
+    if (path_shortener_) {
+      for (auto & path : result->paths) {
+        path_shortener_->shorten(path);
+      }
+    }
+
+    RCLCPP_DEBUG(
+      get_logger(), "Planned to %zu goals with %s", goal->poses.size(),
+      goal->planner_id.c_str());
+
+    batch_action_server_->succeeded_current(result);
+  } catch (std::exception & ex) {
+    RCLCPP_WARN(
+      get_logger(), "%s plugin failed to plan to %zu goals: \"%s\"",
+      goal->planner_id.c_str(), goal->poses.size(), ex.what());
+    batch_action_server_->terminate_current();
+  }
+}
+
+void
+PlannerServer::computePlanConcurrently(
+  const std::shared_ptr<ConcurrentActionServer::GoalHandle> & handle, unsigned int worker)
+{
+  auto goal = handle->get_goal();
+  auto result = std::make_shared<nav2_msgs::action::ComputePathToPose::Result>();
+
+  // A goal left active on return is aborted by the action server
+  try {
+    if (!concurrent_action_server_->is_server_active()) {
+      RCLCPP_DEBUG(get_logger(), "Action server is inactive. Stopping.");
+      return;
+    }
+
+    if (handle->is_canceling()) {
+      RCLCPP_INFO(get_logger(), "Goal was canceled. Canceling planning action.");
+      handle->canceled(result);
+      return;
+    }
+
+    waitForCostmap();
+
+    geometry_msgs::msg::PoseStamped start;
+    if (!costmap_ros_->getRobotPose(start)) {
+      RCLCPP_ERROR(this->get_logger(), "Could not get robot pose");
+      return;
+    }
+
+    RCLCPP_DEBUG(
+      get_logger(), "Worker %u attempting to a find path from (%.2f, %.2f) to "
+      "(%.2f, %.2f).", worker, start.pose.position.x, start.pose.position.y,
+      goal->pose.pose.position.x, goal->pose.pose.position.y);
+
+    auto feedback = std::make_shared<nav2_msgs::action::ComputePathToPose::Feedback>();
+    if (getInterimPlan(goal->planner_id, start, goal->pose, worker, feedback->path)) {
+      handle->publish_feedback(feedback);
+
+      if (handle->is_canceling()) {
+        RCLCPP_INFO(get_logger(), "Goal was canceled. Canceling planning action.");
+        handle->canceled(result);
+        return;
+      }
+    }
+
+    result->path = getPlan(goal->planner_id, start, goal->pose, worker);
+
+    if (result->path.poses.size() == 0) {
+      RCLCPP_WARN(
+        get_logger(), "Planning algorithm %s failed to generate a valid"
+        " path to (%.2f, %.2f)", goal->planner_id.c_str(),
+        goal->pose.pose.position.x, goal->pose.pose.position.y);
+      costmap_ros_->saveFlightRecording();
+      return;
+    }
+
+    publishPlan(result->path);
+    handle->succeed(result);
+  } catch (std::exception & ex) {
+    RCLCPP_WARN(
+      get_logger(), "%s plugin failed to plan calculation to (%.2f, %.2f): \"%s\"",
+      goal->planner_id.c_str(), goal->pose.pose.position.x,
+      goal->pose.pose.position.y, ex.what());
+  }
+}
+
+nav_msgs::msg::Path
+PlannerServer::getPlan(
+  const std::string & planner_id,
+  const geometry_msgs::msg::PoseStamped & start,
+  const geometry_msgs::msg::PoseStamped & goal,
+  unsigned int workspace)
+{
+  nav_msgs::msg::Path path;
+
+  // The cache serializes its calls on the costmap's lock, so it's shared between workers
+  if (plan_cache_ && plan_cache_->lookup(planner_id, start, goal, path)) {
+    RCLCPP_DEBUG(get_logger(), "Reusing a cached path");
+    path.header.stamp = now();
+  } else {
+    auto & planner_workspace = *workspaces_[workspace];
+    std::lock_guard<std::mutex> lock(planner_workspace.mutex);
+    auto planner = getPlanner(planner_workspace, planner_id);
+    if (!planner) {
+      return path;
+    }
+    path = planner->createPlan(start, goal);
+    if (plan_cache_) {
+      plan_cache_->insert(planner_id, start, goal, path);
+    }
+  }
+
+  // The cache keeps the planner's path, whose every cell it can check
+  if (path_shortener_) {
+    path_shortener_->shorten(path);
+  }
+  return path;
+}
+
+bool
+PlannerServer::getInterimPlan(
+  const std::string & planner_id,
+  const geometry_msgs::msg::PoseStamped & start,
+  const geometry_msgs::msg::PoseStamped & goal,
+  unsigned int workspace,
+  nav_msgs::msg::Path & path)
+{
+  if (interim_planner_id_.empty() || interim_planner_id_ == planner_id) {
+    return false;
+  }
+
+  // a cached final plan comes as quickly
+  if (plan_cache_ && plan_cache_->lookup(planner_id, start, goal, path)) {
+    path.poses.clear();
+    return false;
+  }
+
+  {
+    auto & planner_workspace = *workspaces_[workspace];
+    std::lock_guard<std::mutex> lock(planner_workspace.mutex);
+    auto planner = getPlanner(planner_workspace, interim_planner_id_);
+    if (!planner) {
+      return false;
+    }
+    path = planner->createPlan(start, goal);
+  }
+  if (path.poses.empty()) {
+    return false;
+  }
+
+  if (path_shortener_) {
+    path_shortener_->shorten(path);
+  }
+  RCLCPP_DEBUG(
+    get_logger(), "Found an interim path of size %zu with %s", path.poses.size(),
+    interim_planner_id_.c_str());
+  publishPlan(path);
+  return true;
+}
+
+nav2_core::GlobalPlanner::Ptr
+PlannerServer::getPlanner(PlannerWorkspace & workspace, const std::string & planner_id)
+{
+  auto & planners = workspace.planners;
+  auto it = planners.find(planner_id);
+  if (it != planners.end()) {
+    return it->second;
+  }
+
+  if (planners.size() == 1 && planner_id.empty()) {
+    if (!single_planner_warning_given_.exchange(true)) {
+      RCLCPP_WARN(
+        get_logger(), "No planners specified in action call. "
+        "Server will use only plugin %s in server."
+        " This warning will appear once.", planner_ids_concat_.c_str());
+    }
+    return planners.begin()->second;
+  }
+
+  RCLCPP_ERROR(
+    get_logger(), "planner %s is not a valid planner. "
+    "Planner names are: %s", planner_id.c_str(),
+    planner_ids_concat_.c_str());
+  return nullptr;
+}
+
+void
+PlannerServer::waitForCostmap()
+{
+  if (!costmap_ros_->demandUpdates()) {
+    RCLCPP_WARN(get_logger(), "Costmap didn't catch up in time, planning on the last update");
+  }
+}
+
 void
 PlannerServer::publishPlan(const nav_msgs::msg::Path & path)
 {
@@ -298,3 +607,10 @@ PlannerServer::publishPlan(const nav_msgs::msg::Path & path)
 }
 
 }  // namespace nav2_planner
+
+#include "rclcpp_components/register_node_macro.hpp"
+
+// Register the component with class_loader.
+// This acts as a sort of entry point, allowing the component to be discoverable when its library
+// is being loaded into a running process.
+RCLCPP_COMPONENTS_REGISTER_NODE(nav2_planner::PlannerServer)
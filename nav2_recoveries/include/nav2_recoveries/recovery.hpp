@@ -96,10 +96,20 @@ public:
     tf_ = tf;
 
     node_->get_parameter("cycle_frequency", cycle_frequency_);
-
-    action_server_ = std::make_shared<ActionServer>(
-      node_, recovery_name_,
-      std::bind(&Recovery::execute, this));
+    node_->get_parameter("run_on_executor", run_on_executor_);
+
+    if (run_on_executor_) {
+      // The goals are started on the executor and run by a timer, without a thread
+      action_server_ = std::make_shared<ActionServer>(
+        node_, recovery_name_,
+        std::bind(&Recovery::start, this),
+        true, std::chrono::milliseconds(500), false);
+    } else {
+      action_server_ = std::make_shared<ActionServer>(
+        node_, recovery_name_,
+        std::bind(&Recovery::execute, this),
+        true, std::chrono::milliseconds(500), true, true);
+    }
 
     collision_checker_ = collision_checker;
 
@@ -110,6 +120,7 @@ public:
 
   void cleanup() override
   {
+    stopTimers();
     action_server_.reset();
     vel_pub_.reset();
     onCleanup();
@@ -125,6 +136,13 @@ public:
 
   void deactivate() override
   {
+    if (cycle_timer_) {
+      RCLCPP_WARN(node_->get_logger(), "Deactivating while running %s", recovery_name_.c_str());
+      stopTimers();
+      stopRobot();
+      action_server_->terminate_all();
+    }
+
     vel_pub_->on_deactivate();
     enabled_ = false;
   }
@@ -140,6 +158,12 @@ protected:
   double cycle_frequency_;
   double enabled_;
 
+  // Whether the goals are run by timers on the node's executor, all the recoveries of
+  // the node then sharing its thread, instead of each goal on a thread of its own
+  bool run_on_executor_{false};
+  rclcpp::TimerBase::SharedPtr cycle_timer_;
+  rclcpp::TimerBase::SharedPtr log_timer_;
+
   void execute()
   {
     RCLCPP_INFO(node_->get_logger(), "Attempting %s", recovery_name_.c_str());
@@ -201,6 +225,104 @@ protected:
     }
   }
 
+  // Start a goal on the executor, its cycles being run by a timer from then on
+  void start()
+  {
+    RCLCPP_INFO(node_->get_logger(), "Attempting %s", recovery_name_.c_str());
+
+    if (!enabled_) {
+      RCLCPP_WARN(node_->get_logger(), "Called while inactive, ignoring request.");
+      action_server_->terminate_current();
+      return;
+    }
+
+    if (onRun(action_server_->get_current_goal()) != Status::SUCCEEDED) {
+      RCLCPP_INFO(node_->get_logger(), "Initial checks failed for %s", recovery_name_.c_str());
+      action_server_->terminate_current();
+      startPending();
+      return;
+    }
+
+    // Log a message every second
+    log_timer_ = node_->create_wall_timer(
+      1s,
+      [this]() {RCLCPP_INFO(node_->get_logger(), "%s running...", recovery_name_.c_str());});
+
+    cycle_timer_ = node_->create_wall_timer(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::duration<double>(1.0 / cycle_frequency_)),
+      std::bind(&Recovery::cycle, this));
+  }
+
+  // One cycle of the goal run on the executor, the counterpart of an iteration of
+  // the loop in execute()
+  void cycle()
+  {
+    if (action_server_->is_cancel_requested()) {
+      RCLCPP_INFO(node_->get_logger(), "Canceling %s", recovery_name_.c_str());
+      stopTimers();
+      stopRobot();
+      action_server_->terminate_all();
+      return;
+    }
+
+    // TODO(orduno) #868 Enable preempting a Recovery on-the-fly without stopping
+    if (action_server_->is_preempt_requested()) {
+      RCLCPP_ERROR(
+        node_->get_logger(), "Received a preemption request for %s,"
+        " however feature is currently not implemented. Aborting and stopping.",
+        recovery_name_.c_str());
+      stopTimers();
+      stopRobot();
+      action_server_->terminate_current();
+      startPending();
+      return;
+    }
+
+    switch (onCycleUpdate()) {
+      case Status::SUCCEEDED:
+        RCLCPP_INFO(node_->get_logger(), "%s completed successfully", recovery_name_.c_str());
+        stopTimers();
+        action_server_->succeeded_current();
+        startPending();
+        return;
+
+      case Status::FAILED:
+        RCLCPP_WARN(node_->get_logger(), "%s failed", recovery_name_.c_str());
+        stopTimers();
+        action_server_->terminate_current();
+        startPending();
+        return;
+
+      case Status::RUNNING:
+
+      default:
+        break;
+    }
+  }
+
+  // Start the goal that came while the last one ran, as the action server's thread
+  // would after execute() returns
+  void startPending()
+  {
+    if (action_server_->is_preempt_requested()) {
+      action_server_->accept_pending_goal();
+      start();
+    }
+  }
+
+  void stopTimers()
+  {
+    if (cycle_timer_) {
+      cycle_timer_->cancel();
+      cycle_timer_.reset();
+    }
+    if (log_timer_) {
+      log_timer_->cancel();
+      log_timer_.reset();
+    }
+  }
+
   void stopRobot()
   {
     geometry_msgs::msg::Twist cmd_vel;
@@ -34,7 +34,7 @@ namespace recovery_server
 class RecoveryServer : public nav2_util::LifecycleNode
 {
 public:
-  RecoveryServer();
+  explicit RecoveryServer(const rclcpp::NodeOptions & options = rclcpp::NodeOptions());
   ~RecoveryServer();
 
   void loadRecoveryPlugins();
@@ -14,7 +14,9 @@
 
 #include <chrono>
 #include <ctime>
+#include <algorithm>
 #include <memory>
+#include <vector>
 
 #include "back_up.hpp"
 #include "nav2_util/node_utils.hpp"
@@ -109,6 +111,10 @@ bool BackUp::isCollisionFree(
   const double diff_dist = abs(command_x_) - distance;
   const int max_cycle_count = static_cast<int>(cycle_frequency_ * simulate_ahead_time_);
 
+  // Checked in one pass, stopping at the first pose in collision
+  std::vector<geometry_msgs::msg::Pose2D> simulated_poses;
+  simulated_poses.reserve(std::max(max_cycle_count, 0));
+
   while (cycle_count < max_cycle_count) {
     sim_position_change = cmd_vel.linear.x * (cycle_count / cycle_frequency_);
     pose2d.x += sim_position_change;
@@ -118,11 +124,9 @@ bool BackUp::isCollisionFree(
       break;
     }
 
-    if (!collision_checker_->isCollisionFree(pose2d)) {
-      return false;
-    }
+    simulated_poses.push_back(pose2d);
   }
-  return true;
+  return collision_checker_->isPathCollisionFree(simulated_poses);
 }
 
 }  // namespace nav2_recoveries
@@ -18,6 +18,7 @@
 #include <thread>
 #include <algorithm>
 #include <memory>
+#include <vector>
 
 #include "spin.hpp"
 #pragma GCC diagnostic push
@@ -80,6 +81,18 @@ Status Spin::onRun(const std::shared_ptr<const SpinAction::Goal> command)
   RCLCPP_INFO(
     node_->get_logger(), "Turning %0.2f for spin recovery.",
     cmd_yaw_);
+
+  // The whole turn in one check, so a spin that is clear is known to be before it starts
+  geometry_msgs::msg::Pose2D pose2d;
+  pose2d.x = current_pose.pose.position.x;
+  pose2d.y = current_pose.pose.position.y;
+  pose2d.theta = initial_yaw_;
+  if (collision_checker_->isSweepCollisionFree(pose2d, cmd_yaw_)) {
+    RCLCPP_DEBUG(node_->get_logger(), "The area swept by the spin is clear.");
+  } else {
+    RCLCPP_INFO(
+      node_->get_logger(), "Obstacles near the area swept by the spin, checking it as it turns.");
+  }
   return Status::SUCCEEDED;
 }
 
@@ -130,11 +143,23 @@ bool Spin::isCollisionFree(
   const geometry_msgs::msg::Twist & cmd_vel,
   geometry_msgs::msg::Pose2D & pose2d)
 {
+  // The turn left within the simulated time, checked at once. Only when obstacles are
+  // near it are the headings along it checked one by one, as the sweep is padded.
+  double sweep = std::min(
+    std::max(abs(cmd_yaw_) - relative_yaw, 0.0), abs(cmd_vel.angular.z) * simulate_ahead_time_);
+  if (collision_checker_->isSweepCollisionFree(pose2d, std::copysign(sweep, cmd_yaw_))) {
+    return true;
+  }
+
   // Simulate ahead by simulate_ahead_time_ in cycle_frequency_ increments
   int cycle_count = 0;
   double sim_position_change;
   const int max_cycle_count = static_cast<int>(cycle_frequency_ * simulate_ahead_time_);
 
+  // Checked in one pass, stopping at the first pose in collision
+  std::vector<geometry_msgs::msg::Pose2D> simulated_poses;
+  simulated_poses.reserve(std::max(max_cycle_count, 0));
+
   while (cycle_count < max_cycle_count) {
     sim_position_change = cmd_vel.angular.z * (cycle_count / cycle_frequency_);
     pose2d.theta += sim_position_change;
@@ -144,11 +169,9 @@ bool Spin::isCollisionFree(
       break;
     }
 
-    if (!collision_checker_->isCollisionFree(pose2d)) {
-      return false;
-    }
+    simulated_poses.push_back(pose2d);
   }
-  return true;
+  return collision_checker_->isPathCollisionFree(simulated_poses);
 }
 
 }  // namespace nav2_recoveries
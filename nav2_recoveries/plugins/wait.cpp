@@ -24,7 +24,6 @@ namespace nav2_recoveries
 Wait::Wait()
 : Recovery<WaitAction>()
 {
-  duration_.sec = 0.0;
 }
 
 Wait::~Wait()
@@ -33,14 +32,18 @@ Wait::~Wait()
 
 Status Wait::onRun(const std::shared_ptr<const WaitAction::Goal> command)
 {
-  duration_ = command->time;
+  wait_end_ = std::chrono::steady_clock::now() +
+    rclcpp::Duration(command->time).to_chrono<std::chrono::nanoseconds>();
   return Status::SUCCEEDED;
 }
 
 Status Wait::onCycleUpdate()
 {
-  rclcpp::sleep_for(
-    rclcpp::Duration(duration_).to_chrono<std::chrono::nanoseconds>());
+  // Checked every cycle rather than slept through, so a cancel is handled while
+  // waiting and the other recoveries sharing the executor keep running
+  if (std::chrono::steady_clock::now() < wait_end_) {
+    return Status::RUNNING;
+  }
   return Status::SUCCEEDED;
 }
 
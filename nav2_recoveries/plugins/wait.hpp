@@ -37,7 +37,7 @@ public:
   Status onCycleUpdate() override;
 
 protected:
-  builtin_interfaces::msg::Duration duration_;
+  std::chrono::steady_clock::time_point wait_end_;
 };
 
 }  // namespace nav2_recoveries
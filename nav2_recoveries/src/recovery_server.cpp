@@ -21,8 +21,8 @@
 namespace recovery_server
 {
 
-RecoveryServer::RecoveryServer()
-: nav2_util::LifecycleNode("nav2_recoveries", "", true),
+RecoveryServer::RecoveryServer(const rclcpp::NodeOptions & options)
+: nav2_util::LifecycleNode("nav2_recoveries", "", true, options),
   plugin_loader_("nav2_core", "nav2_core::Recovery")
 {
   declare_parameter(
@@ -32,6 +32,7 @@ RecoveryServer::RecoveryServer()
     "footprint_topic",
     rclcpp::ParameterValue(std::string("local_costmap/published_footprint")));
   declare_parameter("cycle_frequency", rclcpp::ParameterValue(10.0));
+  declare_parameter("run_on_executor", rclcpp::ParameterValue(false));
 
   std::vector<std::string> plugin_names{std::string("spin"),
     std::string("back_up"), std::string("wait")};
@@ -165,3 +166,10 @@ RecoveryServer::on_shutdown(const rclcpp_lifecycle::State &)
 }
 
 }  // end namespace recovery_server
+
+#include "rclcpp_components/register_node_macro.hpp"
+
+// Register the component with class_loader.
+// This acts as a sort of entry point, allowing the component to be discoverable when its library
+// is being loaded into a running process.
+RCLCPP_COMPONENTS_REGISTER_NODE(recovery_server::RecoveryServer)
@@ -232,6 +232,22 @@ TEST_F(RecoveryTest, testingSequentialFailures)
   SUCCEED();
 }
 
+TEST_F(RecoveryTest, testingOnExecutor)
+{
+  // Configure the recovery again, this time running its goals with timers
+  recovery_->deactivate();
+  recovery_->cleanup();
+  node_lifecycle_->declare_parameter("run_on_executor", rclcpp::ParameterValue(true));
+  recovery_->configure(node_lifecycle_, "Recovery", tf_buffer_, nullptr);
+  recovery_->activate();
+
+  ASSERT_TRUE(sendCommand("Testing success"));
+  EXPECT_EQ(getOutcome(), Status::SUCCEEDED);
+  ASSERT_TRUE(sendCommand("Testing failure on run"));
+  EXPECT_EQ(getOutcome(), Status::FAILED);
+  SUCCEED();
+}
+
 int main(int argc, char ** argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
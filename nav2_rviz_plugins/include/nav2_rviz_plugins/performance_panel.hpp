@@ -0,0 +1,99 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_RVIZ_PLUGINS__PERFORMANCE_PANEL_HPP_
+#define NAV2_RVIZ_PLUGINS__PERFORMANCE_PANEL_HPP_
+
+#include <QtWidgets>
+#include <QBasicTimer>
+
+#include <chrono>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "nav2_msgs/msg/behavior_tree_profile.hpp"
+#include "nav2_msgs/msg/control_loop_statistics.hpp"
+#include "nav2_msgs/msg/costmap_update_statistics.hpp"
+#include "nav2_msgs/msg/rolling_statistics.hpp"
+#include "rclcpp/rclcpp.hpp"
+#include "rviz_common/panel.hpp"
+
+namespace nav2_rviz_plugins
+{
+
+/// Panel showing the timings the nav2 servers publish: the update loops of the
+/// costmaps, the control loop and the ticks of the behavior tree
+class PerformancePanel : public rviz_common::Panel
+{
+  Q_OBJECT
+
+public:
+  explicit PerformancePanel(QWidget * parent = 0);
+  virtual ~PerformancePanel();
+
+  void onInitialize() override;
+
+private:
+  void timerEvent(QTimerEvent * event) override;
+
+  // A measurement of one of the servers, and its recent means
+  struct Row
+  {
+    QTreeWidgetItem * item{nullptr};
+    std::deque<double> history;
+  };
+
+  // A server publishing its timings, and when it last did
+  struct Source
+  {
+    QTreeWidgetItem * item{nullptr};
+    std::map<std::string, Row> rows;
+    std::chrono::steady_clock::time_point stamp;
+  };
+
+  // Show the statistics received from a server, with the cycles it overran
+  void updateStatistics(
+    const std::string & source, uint32_t missed_cycles,
+    const std::vector<nav2_msgs::msg::RollingStatistics> & statistics);
+
+  // Show the tick times of the behavior tree's nodes
+  void updateProfile(const nav2_msgs::msg::BehaviorTreeProfile & profile);
+
+  Source & getSource(const std::string & source);
+  Row & getRow(Source & source, const std::string & key, const std::string & name);
+
+  // Set a row's values, those below zero shown as not available, and add the
+  // mean to its history
+  void setRow(Row & row, double mean, double p95, double max, bool in_cells);
+
+  // The (non-spinning) node subscribing to the timings, spun by the timer
+  rclcpp::Node::SharedPtr client_node_;
+
+  rclcpp::Subscription<nav2_msgs::msg::ControlLoopStatistics>::SharedPtr control_sub_;
+  std::vector<rclcpp::Subscription<nav2_msgs::msg::CostmapUpdateStatistics>::SharedPtr>
+  costmap_subs_;
+  rclcpp::Subscription<nav2_msgs::msg::BehaviorTreeProfile>::SharedPtr profile_sub_;
+
+  // Spins the node and greys out the servers that stopped publishing
+  QBasicTimer timer_;
+
+  QTreeWidget * tree_{nullptr};
+  std::map<std::string, Source> sources_;
+};
+
+}  // namespace nav2_rviz_plugins
+
+#endif  //  NAV2_RVIZ_PLUGINS__PERFORMANCE_PANEL_HPP_
@@ -0,0 +1,209 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_rviz_plugins/performance_panel.hpp"
+
+#include <QVBoxLayout>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace nav2_rviz_plugins
+{
+
+// The means kept per measurement, one per message, drawn as a sparkline
+static const size_t kHistoryLength = 20;
+
+// A server that hasn't published for this long is shown greyed out
+static const auto kStaleAfter = 5s;
+
+enum Column { NAME, MEAN, P95, MAX, HISTORY, COLUMNS };
+
+static QString formatValue(double value, bool in_cells)
+{
+  if (value < 0.0) {
+    return "-";
+  }
+  // times are in seconds, shown in milliseconds
+  return in_cells ? QString::number(value, 'f', 0) : QString::number(value * 1e3, 'f', 2);
+}
+
+// The history as bars of eight heights, scaled to its largest value
+static QString sparkline(const std::deque<double> & history)
+{
+  double top = 0.0;
+  for (double value : history) {
+    top = std::max(top, value);
+  }
+
+  QString line;
+  for (double value : history) {
+    int level = top > 0.0 ? std::min(7, static_cast<int>(value / top * 8.0)) : 0;
+    line += QChar(0x2581 + level);
+  }
+  return line;
+}
+
+PerformancePanel::PerformancePanel(QWidget * parent)
+: Panel(parent)
+{
+  tree_ = new QTreeWidget;
+  tree_->setColumnCount(COLUMNS);
+  tree_->setHeaderLabels({"Measurement", "Mean (ms)", "p95 (ms)", "Max (ms)", "Recent means"});
+  tree_->setRootIsDecorated(true);
+  tree_->setUniformRowHeights(true);
+  tree_->header()->setSectionResizeMode(QHeaderView::ResizeToContents);
+
+  QVBoxLayout * main_layout = new QVBoxLayout;
+  main_layout->addWidget(tree_);
+  main_layout->setContentsMargins(10, 10, 10, 10);
+  setLayout(main_layout);
+
+  auto options = rclcpp::NodeOptions().arguments(
+    {"--ros-args --remap __node:=performance_panel"});
+  client_node_ = std::make_shared<rclcpp::Node>("_", options);
+
+  control_sub_ = client_node_->create_subscription<nav2_msgs::msg::ControlLoopStatistics>(
+    "control_loop_statistics", rclcpp::SystemDefaultsQoS(),
+    [this](const nav2_msgs::msg::ControlLoopStatistics::SharedPtr msg) {
+      updateStatistics("controller_server", msg->missed_cycles, msg->statistics);
+    });
+
+  for (const std::string costmap : {"global_costmap", "local_costmap"}) {
+    costmap_subs_.push_back(
+      client_node_->create_subscription<nav2_msgs::msg::CostmapUpdateStatistics>(
+        "/" + costmap + "/update_statistics", rclcpp::SystemDefaultsQoS(),
+        [this, costmap](const nav2_msgs::msg::CostmapUpdateStatistics::SharedPtr msg) {
+          updateStatistics(costmap, msg->missed_cycles, msg->statistics);
+        }));
+  }
+
+  profile_sub_ = client_node_->create_subscription<nav2_msgs::msg::BehaviorTreeProfile>(
+    "behavior_tree_profile", rclcpp::QoS(10),
+    [this](const nav2_msgs::msg::BehaviorTreeProfile::SharedPtr msg) {
+      updateProfile(*msg);
+    });
+
+  // The messages are handled on the GUI thread, as the timer spins the node
+  timer_.start(200, this);
+}
+
+PerformancePanel::~PerformancePanel()
+{
+}
+
+void
+PerformancePanel::onInitialize()
+{
+}
+
+void
+PerformancePanel::timerEvent(QTimerEvent * event)
+{
+  if (event->timerId() != timer_.timerId()) {
+    return;
+  }
+
+  rclcpp::spin_some(client_node_);
+
+  auto now = std::chrono::steady_clock::now();
+  for (auto & source : sources_) {
+    bool stale = now - source.second.stamp > kStaleAfter;
+    source.second.item->setDisabled(stale);
+  }
+}
+
+void
+PerformancePanel::updateStatistics(
+  const std::string & name, uint32_t missed_cycles,
+  const std::vector<nav2_msgs::msg::RollingStatistics> & statistics)
+{
+  Source & source = getSource(name);
+  source.item->setText(
+    NAME, QString("%1 (%2 overruns)").arg(QString::fromStdString(name)).arg(missed_cycles));
+
+  for (const auto & measurement : statistics) {
+    Row & row = getRow(source, measurement.name, measurement.name);
+    bool in_cells = measurement.name == "updated_cells";
+    setRow(row, measurement.mean, measurement.p95, measurement.max, in_cells);
+  }
+}
+
+void
+PerformancePanel::updateProfile(const nav2_msgs::msg::BehaviorTreeProfile & profile)
+{
+  Source & source = getSource("bt_navigator");
+  source.item->setText(
+    NAME, QString("bt_navigator (%1 ticks/s)").arg(profile.tick_rate, 0, 'f', 1));
+
+  for (size_t i = 0; i < profile.nodes.size(); ++i) {
+    const auto & node = profile.nodes[i];
+    if (node.ticks == 0) {
+      continue;
+    }
+    // node names needn't be unique in a tree
+    Row & row = getRow(source, std::to_string(i) + "/" + node.node_name, node.node_name);
+    setRow(row, node.total_tick_time / node.ticks, -1.0, node.max_tick_time, false);
+  }
+}
+
+PerformancePanel::Source &
+PerformancePanel::getSource(const std::string & name)
+{
+  Source & source = sources_[name];
+  if (!source.item) {
+    source.item = new QTreeWidgetItem(tree_);
+    source.item->setText(NAME, QString::fromStdString(name));
+    source.item->setExpanded(true);
+  }
+  source.stamp = std::chrono::steady_clock::now();
+  return source;
+}
+
+PerformancePanel::Row &
+PerformancePanel::getRow(Source & source, const std::string & key, const std::string & name)
+{
+  Row & row = source.rows[key];
+  if (!row.item) {
+    row.item = new QTreeWidgetItem(source.item);
+    row.item->setText(NAME, QString::fromStdString(name));
+    for (int column = MEAN; column <= MAX; ++column) {
+      row.item->setTextAlignment(column, Qt::AlignRight);
+    }
+  }
+  return row;
+}
+
+void
+PerformancePanel::setRow(Row & row, double mean, double p95, double max, bool in_cells)
+{
+  row.item->setText(MEAN, formatValue(mean, in_cells));
+  row.item->setText(P95, formatValue(p95, in_cells));
+  row.item->setText(MAX, formatValue(max, in_cells));
+
+  row.history.push_back(mean);
+  if (row.history.size() > kHistoryLength) {
+    row.history.pop_front();
+  }
+  row.item->setText(HISTORY, sparkline(row.history));
+}
+
+}  // namespace nav2_rviz_plugins
+
+#include <pluginlib/class_list_macros.hpp>  // NOLINT
+PLUGINLIB_EXPORT_CLASS(nav2_rviz_plugins::PerformancePanel, rviz_common::Panel)
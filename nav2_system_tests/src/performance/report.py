@@ -0,0 +1,159 @@
+#! /usr/bin/env python3
+# Copyright (c) 2020 Samsung Research America
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""
+Summarize a performance run and check it against the thresholds.
+
+Merges the tester's measurements with the traces the nav2 processes wrote when they exited
+(nav2_util/trace.hpp), and writes report.json: the statistics of every metric, each
+threshold with the value it was checked against, and whether all of them passed.
+"""
+
+import argparse
+import csv
+import glob
+import json
+import math
+import os
+import re
+import sys
+
+import yaml
+
+# The traced scopes reported, by the node whose process records them
+TRACED_METRICS = {
+    'local_costmap_update_ms': ('controller_server', 'costmap_update'),
+    'controller_compute_ms': ('controller_server', 'compute_velocity'),
+    'dwb_scoring_ms': ('controller_server', 'dwb_scoring'),
+    'local_costmap_lock_wait_ms': ('controller_server', 'costmap'),
+    'global_costmap_update_ms': ('planner_server', 'costmap_update'),
+    'planner_ms': ('planner_server', 'navfn_dijkstra'),
+    'global_costmap_lock_wait_ms': ('planner_server', 'costmap'),
+    'amcl_update_action_ms': ('amcl', 'amcl_update_action'),
+    'amcl_update_sensor_ms': ('amcl', 'amcl_update_sensor'),
+    'amcl_update_resample_ms': ('amcl', 'amcl_update_resample'),
+    'bt_tick_ms': ('bt_navigator', 'bt_tick'),
+}
+
+
+def percentile(values, fraction):
+    ordered = sorted(values)
+    index = min(len(ordered) - 1, int(math.ceil(fraction * len(ordered))) - 1)
+    return ordered[max(index, 0)]
+
+
+def statistics(values):
+    if not values:
+        return {'count': 0}
+    mean = sum(values) / len(values)
+    return {
+        'count': len(values),
+        'mean': mean,
+        'stddev': math.sqrt(sum((v - mean) ** 2 for v in values) / len(values)),
+        'p50': percentile(values, 0.5),
+        'p95': percentile(values, 0.95),
+        'p99': percentile(values, 0.99),
+        'max': max(values),
+    }
+
+
+def read_traces(output_dir, nodes):
+    # The durations of each traced name, by the node that recorded them
+    node_of_pid = {pid: name for name, samples in nodes.items() for pid in samples['pids']}
+    durations = {}
+    for filename in glob.glob(os.path.join(output_dir, 'trace_*.csv')):
+        match = re.search(r'trace_(\d+)\.csv$', filename)
+        node = node_of_pid.get(int(match.group(1))) if match else None
+        if node is None:
+            continue
+        with open(filename) as f:
+            for row in csv.DictReader(f):
+                durations.setdefault((node, row['name']), []).append(
+                    int(row['duration_ns']) / 1e6)
+    return durations
+
+
+def metrics(measurements, durations):
+    result = {
+        'scan_to_cmd_vel_ms': statistics(measurements['scan_to_cmd_vel_ms']),
+        'controller_period_ms': statistics(measurements['cmd_vel_period_ms']),
+        'navigation_time_s': {'value': measurements['navigation_time_s']},
+    }
+    for metric, key in TRACED_METRICS.items():
+        result[metric] = statistics(durations.get(key, []))
+    for node, samples in measurements['nodes'].items():
+        result['cpu_percent.' + node] = statistics(samples['cpu_percent'])
+        result['rss_mb.' + node] = statistics(samples['rss_mb'])
+    return result
+
+
+def check(result, thresholds):
+    # Each threshold is the most a statistic of a metric may be. The per node metrics
+    # fall back on the threshold for all of the nodes, under the metric's own name.
+    checks = []
+    for metric, stats in sorted(result.items()):
+        limits = thresholds.get(metric)
+        if limits is None and '.' in metric:
+            limits = thresholds.get(metric.split('.')[0])
+        for statistic, limit in (limits or {}).items():
+            value = stats.get(statistic)
+            checks.append({
+                'metric': metric,
+                'statistic': statistic,
+                'value': value,
+                'limit': limit,
+                # Not having been measured is a failure, or a broken pipeline would pass
+                'passed': value is not None and value <= limit,
+            })
+    for metric in thresholds:
+        if metric not in result and not any(m.startswith(metric + '.') for m in result):
+            checks.append({'metric': metric, 'statistic': None, 'value': None,
+                           'limit': None, 'passed': False})
+    return checks
+
+
+def main(argv=sys.argv[1:]):
+    parser = argparse.ArgumentParser(description='Nav2 performance report')
+    parser.add_argument('-o', '--output-dir', default=os.getenv('PERF_OUTPUT_DIR', '.'),
+                        help='The directory with the measurements and the traces')
+    parser.add_argument('-t', '--thresholds', default=os.getenv('PERF_THRESHOLDS'),
+                        help='The YAML file of the thresholds')
+    args = parser.parse_args(argv)
+
+    with open(os.path.join(args.output_dir, 'measurements.json')) as f:
+        measurements = json.load(f)
+    thresholds = {}
+    if args.thresholds:
+        with open(args.thresholds) as f:
+            thresholds = yaml.safe_load(f) or {}
+
+    result = metrics(measurements, read_traces(args.output_dir, measurements['nodes']))
+    checks = check(result, thresholds)
+    passed = measurements['navigation_succeeded'] and all(c['passed'] for c in checks)
+
+    output = os.path.join(args.output_dir, 'report.json')
+    with open(output, 'w') as f:
+        json.dump({'passed': passed, 'metrics': result, 'checks': checks}, f, indent=2)
+
+    for c in checks:
+        print('{0} {1}.{2}: {3} (limit {4})'.format(
+            'PASS' if c['passed'] else 'FAIL', c['metric'], c['statistic'], c['value'],
+            c['limit']))
+    print('Wrote the report to ' + output)
+    return 0 if passed else 1
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,408 @@
+#! /usr/bin/env python3
+# Copyright (c) 2020 Samsung Research America
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import json
+import math
+import os
+import struct
+import sys
+import time
+
+from action_msgs.msg import GoalStatus
+from geometry_msgs.msg import PoseStamped, PoseWithCovarianceStamped, TransformStamped, Twist
+from nav2_msgs.action import NavigateToPose
+from nav2_msgs.srv import ManageLifecycleNodes
+from nav_msgs.msg import OccupancyGrid, Odometry
+
+import rclpy
+from rclpy.action import ActionClient
+from rclpy.node import Node
+from rclpy.qos import QoSDurabilityPolicy, QoSHistoryPolicy, QoSReliabilityPolicy
+from rclpy.qos import QoSProfile
+
+from sensor_msgs.msg import LaserScan, PointCloud2, PointField
+from tf2_msgs.msg import TFMessage
+
+# The rates the sensors of a TurtleBot3 with a depth camera publish at
+ODOM_RATE = 50.0
+SCAN_RATE = 10.0
+CLOUD_RATE = 15.0
+
+SCAN_BEAMS = 360
+SCAN_RANGE_MIN = 0.12
+SCAN_RANGE_MAX = 3.5
+CLOUD_FOV = math.radians(60.0)
+CLOUD_HEIGHTS = [0.1, 0.3, 0.5]
+
+# The nodes whose CPU and memory are sampled, by their name or their executable's
+MONITORED_NODES = ['map_server', 'amcl', 'controller_server', 'planner_server',
+                   'recoveries_server', 'bt_navigator', 'waypoint_follower',
+                   'lifecycle_manager_localization', 'lifecycle_manager_navigation']
+RESOURCE_RATE = 1.0
+
+
+def yaw_to_quaternion(yaw):
+    return (0.0, 0.0, math.sin(yaw / 2.0), math.cos(yaw / 2.0))
+
+
+class SimulatedRobot:
+    """A robot driven perfectly by its velocity commands, sensing the map it's given."""
+
+    def __init__(self, x, y, yaw):
+        self.start = (x, y, yaw)
+        # The pose in the odom frame, which starts where the robot does
+        self.odom_x = 0.0
+        self.odom_y = 0.0
+        self.odom_yaw = 0.0
+        self.linear = 0.0
+        self.angular = 0.0
+        self.map = None
+
+    def move(self, dt):
+        self.odom_yaw += self.angular * dt
+        self.odom_x += self.linear * math.cos(self.odom_yaw) * dt
+        self.odom_y += self.linear * math.sin(self.odom_yaw) * dt
+
+    def pose(self):
+        # The pose in the map frame
+        x0, y0, yaw0 = self.start
+        x = x0 + self.odom_x * math.cos(yaw0) - self.odom_y * math.sin(yaw0)
+        y = y0 + self.odom_x * math.sin(yaw0) + self.odom_y * math.cos(yaw0)
+        return x, y, yaw0 + self.odom_yaw
+
+    def occupied(self, x, y):
+        info = self.map.info
+        mx = int((x - info.origin.position.x) / info.resolution)
+        my = int((y - info.origin.position.y) / info.resolution)
+        if mx < 0 or my < 0 or mx >= info.width or my >= info.height:
+            return False
+        return self.map.data[my * info.width + mx] > 50
+
+    def cast(self, angle):
+        # The range to the first occupied cell along a beam, or inf if there's none in range
+        if self.map is None:
+            return float('inf')
+        x, y, yaw = self.pose()
+        step = self.map.info.resolution
+        dx = math.cos(yaw + angle) * step
+        dy = math.sin(yaw + angle) * step
+        distance = SCAN_RANGE_MIN
+        x += math.cos(yaw + angle) * distance
+        y += math.sin(yaw + angle) * distance
+        while distance < SCAN_RANGE_MAX:
+            if self.occupied(x, y):
+                return distance
+            x += dx
+            y += dy
+            distance += step
+        return float('inf')
+
+
+class ResourceMonitor:
+    """Samples the CPU and the resident memory of the nav2 processes from /proc."""
+
+    def __init__(self):
+        self.clock_ticks = os.sysconf(os.sysconf_names['SC_CLK_TCK'])
+        self.last = {}
+        self.samples = {}
+
+    def node_name(self, cmdline):
+        for arg in cmdline:
+            if arg.startswith('__node:='):
+                return arg[len('__node:='):]
+        return os.path.basename(cmdline[0]) if cmdline else ''
+
+    def sample(self):
+        now = time.monotonic()
+        for pid in filter(str.isdigit, os.listdir('/proc')):
+            try:
+                with open('/proc/%s/cmdline' % pid, 'rb') as f:
+                    cmdline = [arg.decode() for arg in f.read().split(b'\0') if arg]
+                name = self.node_name(cmdline)
+                if name not in MONITORED_NODES:
+                    continue
+                with open('/proc/%s/stat' % pid) as f:
+                    # The fields after the command, which may have spaces in it
+                    stat = f.read().rsplit(')', 1)[1].split()
+                cpu_seconds = (int(stat[11]) + int(stat[12])) / self.clock_ticks
+                rss_mb = 0.0
+                with open('/proc/%s/status' % pid) as f:
+                    for line in f:
+                        if line.startswith('VmRSS:'):
+                            rss_mb = int(line.split()[1]) / 1024.0
+            except (OSError, IndexError, ValueError):
+                continue  # Exited meanwhile
+
+            samples = self.samples.setdefault(
+                name, {'pids': [], 'cpu_percent': [], 'rss_mb': []})
+            if int(pid) not in samples['pids']:
+                samples['pids'].append(int(pid))
+            samples['rss_mb'].append(rss_mb)
+            if pid in self.last:
+                last_time, last_cpu = self.last[pid]
+                samples['cpu_percent'].append(100.0 * (cpu_seconds - last_cpu) / (now - last_time))
+            self.last[pid] = (now, cpu_seconds)
+
+
+class PerformanceTester(Node):
+
+    def __init__(self, initial_pose, goal_pose):
+        super().__init__(node_name='nav2_performance_tester', namespace='')
+        self.robot = SimulatedRobot(*initial_pose)
+        self.initial_pose = initial_pose
+        self.goal_pose = goal_pose
+        self.initial_pose_received = False
+
+        self.pending_scans = []
+        self.scan_to_cmd_vel = []
+        self.last_cmd_vel = None
+        self.cmd_vel_periods = []
+        self.monitor = ResourceMonitor()
+
+        map_qos = QoSProfile(
+          durability=QoSDurabilityPolicy.RMW_QOS_POLICY_DURABILITY_TRANSIENT_LOCAL,
+          reliability=QoSReliabilityPolicy.RMW_QOS_POLICY_RELIABILITY_RELIABLE,
+          history=QoSHistoryPolicy.RMW_QOS_POLICY_HISTORY_KEEP_LAST,
+          depth=1)
+
+        self.tf_pub = self.create_publisher(TFMessage, '/tf', 10)
+        self.odom_pub = self.create_publisher(Odometry, 'odom', 10)
+        self.scan_pub = self.create_publisher(LaserScan, 'scan', 10)
+        self.cloud_pub = self.create_publisher(
+            PointCloud2, 'intel_realsense_r200_depth/points', 10)
+        self.initial_pose_pub = self.create_publisher(
+            PoseWithCovarianceStamped, 'initialpose', 10)
+        self.map_sub = self.create_subscription(OccupancyGrid, 'map', self.mapCallback, map_qos)
+        self.cmd_vel_sub = self.create_subscription(Twist, 'cmd_vel', self.cmdVelCallback, 10)
+        self.pose_sub = self.create_subscription(
+            PoseWithCovarianceStamped, 'amcl_pose', self.poseCallback, map_qos)
+        self.action_client = ActionClient(self, NavigateToPose, 'NavigateToPose')
+
+        self.create_timer(1.0 / ODOM_RATE, self.publishOdometry)
+        self.create_timer(1.0 / SCAN_RATE, self.publishScan)
+        self.create_timer(1.0 / CLOUD_RATE, self.publishCloud)
+        self.create_timer(1.0 / RESOURCE_RATE, self.monitor.sample)
+
+    def mapCallback(self, msg):
+        self.robot.map = msg
+
+    def poseCallback(self, msg):
+        self.initial_pose_received = True
+
+    def cmdVelCallback(self, msg):
+        now = time.monotonic()
+        self.robot.linear = msg.linear.x
+        self.robot.angular = msg.angular.z
+
+        # The first command after a scan is the earliest that could have reacted to it
+        for published in self.pending_scans:
+            self.scan_to_cmd_vel.append(1000.0 * (now - published))
+        self.pending_scans = []
+        if self.last_cmd_vel is not None:
+            self.cmd_vel_periods.append(1000.0 * (now - self.last_cmd_vel))
+        self.last_cmd_vel = now
+
+    def publishOdometry(self):
+        self.robot.move(1.0 / ODOM_RATE)
+        stamp = self.get_clock().now().to_msg()
+        orientation = yaw_to_quaternion(self.robot.odom_yaw)
+
+        transform = TransformStamped()
+        transform.header.stamp = stamp
+        transform.header.frame_id = 'odom'
+        transform.child_frame_id = 'base_footprint'
+        transform.transform.translation.x = self.robot.odom_x
+        transform.transform.translation.y = self.robot.odom_y
+        (transform.transform.rotation.x, transform.transform.rotation.y,
+         transform.transform.rotation.z, transform.transform.rotation.w) = orientation
+        self.tf_pub.publish(TFMessage(transforms=[transform]))
+
+        odom = Odometry()
+        odom.header.stamp = stamp
+        odom.header.frame_id = 'odom'
+        odom.child_frame_id = 'base_footprint'
+        odom.pose.pose.position.x = self.robot.odom_x
+        odom.pose.pose.position.y = self.robot.odom_y
+        (odom.pose.pose.orientation.x, odom.pose.pose.orientation.y,
+         odom.pose.pose.orientation.z, odom.pose.pose.orientation.w) = orientation
+        odom.twist.twist.linear.x = self.robot.linear
+        odom.twist.twist.angular.z = self.robot.angular
+        self.odom_pub.publish(odom)
+
+    def publishScan(self):
+        scan = LaserScan()
+        scan.header.stamp = self.get_clock().now().to_msg()
+        scan.header.frame_id = 'base_scan'
+        scan.angle_min = 0.0
+        scan.angle_increment = 2.0 * math.pi / SCAN_BEAMS
+        scan.angle_max = scan.angle_increment * (SCAN_BEAMS - 1)
+        scan.scan_time = 1.0 / SCAN_RATE
+        scan.range_min = SCAN_RANGE_MIN
+        scan.range_max = SCAN_RANGE_MAX
+        scan.ranges = [self.robot.cast(i * scan.angle_increment) for i in range(SCAN_BEAMS)]
+        self.scan_pub.publish(scan)
+        self.pending_scans.append(time.monotonic())
+
+    def publishCloud(self):
+        points = []
+        beams = int(CLOUD_FOV / (2.0 * math.pi / SCAN_BEAMS))
+        for i in range(-beams // 2, beams // 2):
+            angle = i * 2.0 * math.pi / SCAN_BEAMS
+            distance = self.robot.cast(angle)
+            if math.isinf(distance):
+                continue
+            for z in CLOUD_HEIGHTS:
+                points.append((distance * math.cos(angle), distance * math.sin(angle), z))
+
+        cloud = PointCloud2()
+        cloud.header.stamp = self.get_clock().now().to_msg()
+        cloud.header.frame_id = 'base_scan'
+        cloud.height = 1
+        cloud.width = len(points)
+        cloud.fields = [PointField(name=name, offset=4 * i, datatype=PointField.FLOAT32, count=1)
+                        for i, name in enumerate(['x', 'y', 'z'])]
+        cloud.point_step = 12
+        cloud.row_step = cloud.point_step * cloud.width
+        cloud.is_dense = True
+        cloud.data = b''.join(struct.pack('<fff', *point) for point in points)
+        self.cloud_pub.publish(cloud)
+
+    def stampedPose(self, pose):
+        msg = PoseStamped()
+        msg.header.frame_id = 'map'
+        msg.header.stamp = self.get_clock().now().to_msg()
+        msg.pose.position.x = pose[0]
+        msg.pose.position.y = pose[1]
+        (msg.pose.orientation.x, msg.pose.orientation.y,
+         msg.pose.orientation.z, msg.pose.orientation.w) = yaw_to_quaternion(pose[2])
+        return msg
+
+    def setInitialPose(self):
+        msg = PoseWithCovarianceStamped()
+        stamped = self.stampedPose(self.initial_pose)
+        msg.header = stamped.header
+        msg.pose.pose = stamped.pose
+        self.initial_pose_pub.publish(msg)
+
+    def spinFor(self, seconds):
+        end = time.monotonic() + seconds
+        while time.monotonic() < end:
+            rclpy.spin_once(self, timeout_sec=0.01)
+
+    def spinUntil(self, future, timeout):
+        end = time.monotonic() + timeout
+        while not future.done() and time.monotonic() < end:
+            rclpy.spin_once(self, timeout_sec=0.01)
+        return future.done()
+
+    def runNavigateAction(self, timeout):
+        self.info_msg("Waiting for 'NavigateToPose' action server")
+        while not self.action_client.wait_for_server(timeout_sec=1.0):
+            self.info_msg("'NavigateToPose' action server not available, waiting...")
+
+        goal_msg = NavigateToPose.Goal()
+        goal_msg.pose = self.stampedPose(self.goal_pose)
+        send_goal_future = self.action_client.send_goal_async(goal_msg)
+        if not self.spinUntil(send_goal_future, 10.0) or not send_goal_future.result().accepted:
+            self.error_msg('Goal rejected')
+            return False
+
+        # Only the commands while navigating are measured
+        self.info_msg('Goal accepted, measuring')
+        self.pending_scans = []
+        self.scan_to_cmd_vel = []
+        self.cmd_vel_periods = []
+        self.last_cmd_vel = None
+
+        get_result_future = send_goal_future.result().get_result_async()
+        if not self.spinUntil(get_result_future, timeout):
+            self.error_msg('Robot timed out reaching its goal!')
+            return False
+        status = get_result_future.result().status
+        if status != GoalStatus.STATUS_SUCCEEDED:
+            self.error_msg('Goal failed with status code: {0}'.format(status))
+            return False
+        self.info_msg('Goal succeeded!')
+        return True
+
+    def measurements(self, succeeded, navigation_time):
+        return {
+            'navigation_succeeded': succeeded,
+            'navigation_time_s': navigation_time,
+            'scan_to_cmd_vel_ms': self.scan_to_cmd_vel,
+            'cmd_vel_period_ms': self.cmd_vel_periods,
+            'nodes': self.monitor.samples,
+        }
+
+    def shutdown(self):
+        self.info_msg('Shutting down')
+        self.action_client.destroy()
+        for manager in ['lifecycle_manager_navigation', 'lifecycle_manager_localization']:
+            transition_service = manager + '/manage_nodes'
+            mgr_client = self.create_client(ManageLifecycleNodes, transition_service)
+            while not mgr_client.wait_for_service(timeout_sec=1.0):
+                self.info_msg(transition_service + ' service not available, waiting...')
+
+            req = ManageLifecycleNodes.Request()
+            req.command = ManageLifecycleNodes.Request().SHUTDOWN
+            future = mgr_client.call_async(req)
+            if not self.spinUntil(future, 30.0):
+                self.error_msg('Shutting down ' + manager + ' timed out')
+
+    def info_msg(self, msg: str):
+        self.get_logger().info('\033[1;37;44m' + msg + '\033[0m')
+
+    def error_msg(self, msg: str):
+        self.get_logger().error('\033[1;37;41m' + msg + '\033[0m')
+
+
+def main(argv=sys.argv[1:]):
+    rclpy.init()
+
+    test = PerformanceTester(initial_pose=(-2.0, -0.5, 0.0), goal_pose=(0.0, 2.0, 0.0))
+
+    # The sensors have to be running for the stack to come up
+    test.spinFor(10.0)
+
+    retry_count = 0
+    retries = 5
+    while not test.initial_pose_received and retry_count <= retries:
+        retry_count += 1
+        test.info_msg('Setting initial pose')
+        test.setInitialPose()
+        test.spinFor(2.0)
+
+    start = time.monotonic()
+    result = test.initial_pose_received and test.runNavigateAction(timeout=60.0)
+    navigation_time = time.monotonic() - start
+
+    output = os.path.join(os.getenv('PERF_OUTPUT_DIR', '.'), 'measurements.json')
+    with open(output, 'w') as f:
+        json.dump(test.measurements(result, navigation_time), f)
+    test.info_msg('Wrote the measurements to ' + output)
+
+    test.shutdown()
+    test.info_msg('Done Shutting Down.')
+
+    if not result:
+        test.info_msg('Exiting failed')
+        exit(1)
+    else:
+        test.info_msg('Exiting passed')
+        exit(0)
+
+
+if __name__ == '__main__':
+    main()
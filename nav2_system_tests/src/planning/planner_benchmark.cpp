@@ -0,0 +1,456 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License. Reserved.
+
+// Runs global planner plugins on a corpus of maps and writes their planning
+// times, path lengths and memory use to a CSV file, one row per planner and map.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ament_index_cpp/get_package_share_directory.hpp"
+#include "geometry_msgs/msg/pose_stamped.hpp"
+#include "geometry_msgs/msg/twist.hpp"
+#include "nav2_core/global_planner.hpp"
+#include "nav2_costmap_2d/cost_values.hpp"
+#include "nav2_costmap_2d/costmap_2d_ros.hpp"
+#include "nav2_util/lifecycle_node.hpp"
+#include "nav2_util/map_loader/map_loader.hpp"
+#include "nav_msgs/msg/path.hpp"
+#include "pluginlib/class_loader.hpp"
+#include "rclcpp/rclcpp.hpp"
+
+using nav2_costmap_2d::FREE_SPACE;
+using nav2_costmap_2d::INSCRIBED_INFLATED_OBSTACLE;
+using nav2_costmap_2d::LETHAL_OBSTACLE;
+using nav2_costmap_2d::NO_INFORMATION;
+
+namespace nav2_system_tests
+{
+
+// A costmap to benchmark the planners on
+struct BenchmarkMap
+{
+  std::string name;
+  unsigned int size_x;
+  unsigned int size_y;
+  std::vector<unsigned char> costs;
+};
+
+// Inflate the lethal cells of a map the way the inflation layer does, using a
+// chamfer distance transform in thirds of a cell so a 10k x 10k map stays cheap
+void inflate(BenchmarkMap & map, double resolution)
+{
+  const double inscribed_radius = 0.2;
+  const double inflation_radius = 0.55;
+  const double cost_scaling_factor = 3.0;
+
+  const unsigned int size_x = map.size_x;
+  const unsigned int size_y = map.size_y;
+  std::vector<uint8_t> dist(map.costs.size(), 255);
+  for (size_t i = 0; i < map.costs.size(); ++i) {
+    if (map.costs[i] == LETHAL_OBSTACLE) {
+      dist[i] = 0;
+    }
+  }
+
+  auto relax = [&](size_t i, size_t j, int step) {
+      dist[i] = static_cast<uint8_t>(std::min<int>(dist[i], dist[j] + step));
+    };
+  for (unsigned int y = 0; y < size_y; ++y) {
+    for (unsigned int x = 0; x < size_x; ++x) {
+      size_t i = static_cast<size_t>(y) * size_x + x;
+      if (x > 0) {relax(i, i - 1, 3);}
+      if (y > 0) {
+        relax(i, i - size_x, 3);
+        if (x > 0) {relax(i, i - size_x - 1, 4);}
+        if (x + 1 < size_x) {relax(i, i - size_x + 1, 4);}
+      }
+    }
+  }
+  for (unsigned int y = size_y; y-- > 0; ) {
+    for (unsigned int x = size_x; x-- > 0; ) {
+      size_t i = static_cast<size_t>(y) * size_x + x;
+      if (x + 1 < size_x) {relax(i, i + 1, 3);}
+      if (y + 1 < size_y) {
+        relax(i, i + size_x, 3);
+        if (x + 1 < size_x) {relax(i, i + size_x + 1, 4);}
+        if (x > 0) {relax(i, i + size_x - 1, 4);}
+      }
+    }
+  }
+
+  // the cost of each distance, in thirds of a cell
+  unsigned char cost_of[256];
+  for (int d = 0; d < 256; ++d) {
+    double distance = d / 3.0 * resolution;
+    if (d == 0) {
+      cost_of[d] = LETHAL_OBSTACLE;
+    } else if (distance <= inscribed_radius) {
+      cost_of[d] = INSCRIBED_INFLATED_OBSTACLE;
+    } else if (distance <= inflation_radius) {
+      double factor = exp(-1.0 * cost_scaling_factor * (distance - inscribed_radius));
+      cost_of[d] = static_cast<unsigned char>((INSCRIBED_INFLATED_OBSTACLE - 1) * factor);
+    } else {
+      cost_of[d] = FREE_SPACE;
+    }
+  }
+  for (size_t i = 0; i < map.costs.size(); ++i) {
+    if (map.costs[i] != NO_INFORMATION) {
+      map.costs[i] = cost_of[dist[i]];
+    }
+  }
+}
+
+// Load a map image, scaled up by an integer factor
+BenchmarkMap loadImageMap(const std::string & file, int scale, double resolution)
+{
+  geometry_msgs::msg::Twist origin;
+  nav_msgs::msg::OccupancyGrid grid = map_loader::loadMapFromFile(
+    file, resolution, false, 0.65, 0.196, origin, TRINARY);
+
+  BenchmarkMap map;
+  map.name = file.substr(file.find_last_of('/') + 1) + " x" + std::to_string(scale);
+  map.size_x = grid.info.width * scale;
+  map.size_y = grid.info.height * scale;
+  map.costs.resize(static_cast<size_t>(map.size_x) * map.size_y);
+  for (unsigned int y = 0; y < map.size_y; ++y) {
+    for (unsigned int x = 0; x < map.size_x; ++x) {
+      int8_t value = grid.data[(y / scale) * grid.info.width + x / scale];
+      unsigned char cost = FREE_SPACE;
+      if (value == 100) {
+        cost = LETHAL_OBSTACLE;
+      } else if (value < 0) {
+        cost = NO_INFORMATION;
+      }
+      map.costs[static_cast<size_t>(y) * map.size_x + x] = cost;
+    }
+  }
+  inflate(map, resolution);
+  return map;
+}
+
+// Generate a square maze of 1 m corridors, with a few walls knocked out so
+// there is more than one way between most places
+BenchmarkMap generateMaze(unsigned int size, double resolution, std::mt19937 & rng)
+{
+  const unsigned int corridor = std::max(1u, static_cast<unsigned int>(1.0 / resolution));
+  const unsigned int wall = std::max(1u, static_cast<unsigned int>(0.2 / resolution));
+  const unsigned int pitch = corridor + wall;
+  const unsigned int cells = std::max(1u, (size - wall) / pitch);
+
+  BenchmarkMap map;
+  map.name = "maze " + std::to_string(size);
+  map.size_x = map.size_y = size;
+  map.costs.assign(static_cast<size_t>(size) * size, LETHAL_OBSTACLE);
+
+  auto carve = [&](unsigned int x0, unsigned int y0, unsigned int w, unsigned int h) {
+      for (unsigned int y = y0; y < y0 + h; ++y) {
+        std::fill_n(&map.costs[static_cast<size_t>(y) * size + x0], w, FREE_SPACE);
+      }
+    };
+  // knock out the wall between maze cell c and its neighbor to the right or below
+  auto connect = [&](unsigned int c, bool right) {
+      unsigned int x0 = wall + (c % cells) * pitch;
+      unsigned int y0 = wall + (c / cells) * pitch;
+      if (right) {
+        carve(x0 + corridor, y0, wall, corridor);
+      } else {
+        carve(x0, y0 + corridor, corridor, wall);
+      }
+    };
+
+  for (unsigned int c = 0; c < cells * cells; ++c) {
+    carve(wall + (c % cells) * pitch, wall + (c / cells) * pitch, corridor, corridor);
+  }
+
+  // randomized depth-first search for a spanning tree of the maze cells
+  std::vector<bool> visited(cells * cells, false);
+  std::vector<unsigned int> stack{0};
+  visited[0] = true;
+  while (!stack.empty()) {
+    unsigned int c = stack.back();
+    unsigned int x = c % cells, y = c / cells;
+    unsigned int next[4];
+    int n = 0;
+    if (x > 0 && !visited[c - 1]) {next[n++] = c - 1;}
+    if (x + 1 < cells && !visited[c + 1]) {next[n++] = c + 1;}
+    if (y > 0 && !visited[c - cells]) {next[n++] = c - cells;}
+    if (y + 1 < cells && !visited[c + cells]) {next[n++] = c + cells;}
+    if (n == 0) {
+      stack.pop_back();
+      continue;
+    }
+    unsigned int m = next[rng() % n];
+    connect(std::min(c, m), m == c + 1 || m + 1 == c);
+    visited[m] = true;
+    stack.push_back(m);
+  }
+
+  // loops
+  std::uniform_int_distribution<unsigned int> cell(0, cells * cells - 1);
+  for (unsigned int i = 0; i < cells * cells / 10; ++i) {
+    unsigned int c = cell(rng);
+    bool right = rng() % 2;
+    if ((right && c % cells + 1 < cells) || (!right && c / cells + 1 < cells)) {
+      connect(c, right);
+    }
+  }
+
+  inflate(map, resolution);
+  return map;
+}
+
+// Reset the peak resident set size of the process to its current one (Linux only)
+void resetPeakMemory()
+{
+  std::ofstream("/proc/self/clear_refs") << "5";
+}
+
+// The peak resident set size of the process in MB, -1 if unknown
+double peakMemory()
+{
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.compare(0, 6, "VmHWM:") == 0) {
+      return std::stod(line.substr(6)) / 1024.0;
+    }
+  }
+  return -1.0;
+}
+
+class PlannerBenchmark : public nav2_util::LifecycleNode
+{
+public:
+  PlannerBenchmark()
+  : nav2_util::LifecycleNode("planner_benchmark", "", false),
+    gp_loader_("nav2_core", "nav2_core::GlobalPlanner")
+  {
+    std::string bringup_map;
+    try {
+      bringup_map = ament_index_cpp::get_package_share_directory("nav2_bringup") +
+        "/maps/turtlebot3_world.pgm";
+    } catch (...) {
+    }
+
+    declare_parameter("planner_plugin_ids", std::vector<std::string>{"GridBased"});
+    declare_parameter(
+      "planner_plugin_types", std::vector<std::string>{"nav2_navfn_planner/NavfnPlanner"});
+    declare_parameter("map_files", std::vector<std::string>{bringup_map});
+    declare_parameter("map_scales", std::vector<int64_t>{1, 4});
+    declare_parameter("maze_sizes", std::vector<int64_t>{1000, 4000});
+    declare_parameter("resolution", 0.05);
+    declare_parameter("trials", 20);
+    declare_parameter("seed", 1);
+    declare_parameter("output_file", std::string("planner_benchmark.csv"));
+  }
+
+  bool run()
+  {
+    std::vector<std::string> ids, types, map_files;
+    std::vector<int64_t> map_scales, maze_sizes;
+    std::string output_file;
+    int seed;
+    get_parameter("planner_plugin_ids", ids);
+    get_parameter("planner_plugin_types", types);
+    get_parameter("map_files", map_files);
+    get_parameter("map_scales", map_scales);
+    get_parameter("maze_sizes", maze_sizes);
+    get_parameter("resolution", resolution_);
+    get_parameter("trials", trials_);
+    get_parameter("seed", seed);
+    get_parameter("output_file", output_file);
+
+    if (ids.size() != types.size()) {
+      RCLCPP_ERROR(get_logger(), "Planner plugin ids and types sizes do not match!");
+      return false;
+    }
+
+    // A costmap without layers, filled in directly with each map
+    costmap_ros_ = std::make_shared<nav2_costmap_2d::Costmap2DROS>(
+      "benchmark_costmap", std::string{get_namespace()}, "benchmark_costmap");
+    costmap_ros_->set_parameter(rclcpp::Parameter("plugin_names", std::vector<std::string>{}));
+    costmap_ros_->set_parameter(rclcpp::Parameter("plugin_types", std::vector<std::string>{}));
+    costmap_ros_->on_configure(costmap_ros_->get_current_state());
+
+    std::ofstream out(output_file);
+    if (!out) {
+      RCLCPP_ERROR(get_logger(), "Cannot write to %s", output_file.c_str());
+      return false;
+    }
+    out << "planner,map,size_x,size_y,trials,successes,"
+      "time_p50_ms,time_p90_ms,time_p99_ms,time_max_ms,mean_path_length_m,peak_memory_mb\n";
+
+    rng_.seed(seed);
+    std::vector<std::pair<std::string, int>> maps;
+    for (const auto & file : map_files) {
+      for (auto scale : map_scales) {
+        maps.emplace_back(file, static_cast<int>(scale));
+      }
+    }
+    for (auto size : maze_sizes) {
+      maps.emplace_back("", static_cast<int>(size));
+    }
+
+    for (const auto & spec : maps) {
+      BenchmarkMap map;
+      try {
+        map = spec.first.empty() ?
+          generateMaze(spec.second, resolution_, rng_) :
+          loadImageMap(spec.first, spec.second, resolution_);
+      } catch (std::exception & ex) {
+        RCLCPP_ERROR(get_logger(), "Failed to load map %s: %s", spec.first.c_str(), ex.what());
+        continue;
+      }
+      setCostmap(map);
+      auto endpoints = sampleEndpoints(map);
+
+      for (size_t i = 0; i < ids.size(); ++i) {
+        benchmark(ids[i], types[i], map, endpoints, out);
+      }
+    }
+
+    costmap_ros_->on_cleanup(costmap_ros_->get_current_state());
+    return true;
+  }
+
+protected:
+  using Endpoints = std::vector<std::pair<geometry_msgs::msg::PoseStamped,
+      geometry_msgs::msg::PoseStamped>>;
+
+  void setCostmap(const BenchmarkMap & map)
+  {
+    auto costmap = costmap_ros_->getCostmap();
+    std::unique_lock<nav2_costmap_2d::Costmap2D::mutex_t> lock(*(costmap->getMutex()));
+    costmap->resizeMap(map.size_x, map.size_y, resolution_, 0.0, 0.0);
+    std::copy(map.costs.begin(), map.costs.end(), costmap->getCharMap());
+    costmap->markAllChanged();
+  }
+
+  // Random pairs of cells the robot fits in, the same for every planner
+  Endpoints sampleEndpoints(const BenchmarkMap & map)
+  {
+    std::uniform_int_distribution<size_t> cell(0, map.costs.size() - 1);
+    auto sample = [&]() {
+        geometry_msgs::msg::PoseStamped pose;
+        pose.header.frame_id = costmap_ros_->getGlobalFrameID();
+        pose.pose.orientation.w = 1.0;
+        for (int attempt = 0; attempt < 1000000; ++attempt) {
+          size_t i = cell(rng_);
+          if (map.costs[i] < INSCRIBED_INFLATED_OBSTACLE) {
+            costmap_ros_->getCostmap()->mapToWorld(
+              i % map.size_x, i / map.size_x, pose.pose.position.x, pose.pose.position.y);
+            break;
+          }
+        }
+        return pose;
+      };
+
+    Endpoints endpoints;
+    for (int i = 0; i < trials_; ++i) {
+      auto start = sample();
+      endpoints.emplace_back(start, sample());
+    }
+    return endpoints;
+  }
+
+  void benchmark(
+    const std::string & id, const std::string & type, const BenchmarkMap & map,
+    const Endpoints & endpoints, std::ofstream & out)
+  {
+    resetPeakMemory();
+
+    nav2_core::GlobalPlanner::Ptr planner;
+    try {
+      planner = gp_loader_.createUniqueInstance(type);
+      planner->configure(shared_from_this(), id, costmap_ros_->getTfBuffer(), costmap_ros_);
+      planner->activate();
+    } catch (const pluginlib::PluginlibException & ex) {
+      RCLCPP_ERROR(get_logger(), "Failed to create planner %s: %s", id.c_str(), ex.what());
+      return;
+    }
+
+    std::vector<double> times;
+    double length = 0.0;
+    int successes = 0;
+    for (const auto & endpoint : endpoints) {
+      auto begin = std::chrono::steady_clock::now();
+      nav_msgs::msg::Path path;
+      try {
+        path = planner->createPlan(endpoint.first, endpoint.second);
+      } catch (std::exception & ex) {
+        RCLCPP_WARN(get_logger(), "%s failed to plan: %s", id.c_str(), ex.what());
+      }
+      std::chrono::duration<double, std::milli> time = std::chrono::steady_clock::now() - begin;
+      times.push_back(time.count());
+
+      if (!path.poses.empty()) {
+        ++successes;
+        for (size_t i = 1; i < path.poses.size(); ++i) {
+          length += hypot(
+            path.poses[i].pose.position.x - path.poses[i - 1].pose.position.x,
+            path.poses[i].pose.position.y - path.poses[i - 1].pose.position.y);
+        }
+      }
+    }
+    double memory = peakMemory();
+
+    planner->deactivate();
+    planner->cleanup();
+
+    std::sort(times.begin(), times.end());
+    auto percentile = [&times](double q) {
+        return times.empty() ? 0.0 : times[static_cast<size_t>(q * (times.size() - 1) + 0.5)];
+      };
+
+    std::ostringstream row;
+    row << id << ",\"" << map.name << "\"," << map.size_x << "," << map.size_y << "," <<
+      times.size() << "," << successes << "," << percentile(0.5) << "," << percentile(0.9) <<
+      "," << percentile(0.99) << "," << percentile(1.0) << "," <<
+      (successes > 0 ? length / successes : 0.0) << "," << memory << "\n";
+    out << row.str();
+    out.flush();
+
+    RCLCPP_INFO(
+      get_logger(), "%s on %s: %d/%zu planned, p50 %.2f ms, p99 %.2f ms, peak memory %.0f MB",
+      id.c_str(), map.name.c_str(), successes, times.size(), percentile(0.5), percentile(0.99),
+      memory);
+  }
+
+  pluginlib::ClassLoader<nav2_core::GlobalPlanner> gp_loader_;
+  std::shared_ptr<nav2_costmap_2d::Costmap2DROS> costmap_ros_;
+  std::mt19937 rng_;
+  double resolution_;
+  int trials_;
+};
+
+}  // namespace nav2_system_tests
+
+int main(int argc, char ** argv)
+{
+  rclcpp::init(argc, argv);
+  auto benchmark = std::make_shared<nav2_system_tests::PlannerBenchmark>();
+  bool success = benchmark->run();
+  rclcpp::shutdown();
+  return success ? 0 : 1;
+}
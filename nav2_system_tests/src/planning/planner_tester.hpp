@@ -82,7 +82,7 @@ public:
       return false;
     }
     try {
-      path = planners_["GridBased"]->createPlan(start, goal);
+      path = workspaces_.front()->planners["GridBased"]->createPlan(start, goal);
     } catch (...) {
       return false;
     }
@@ -12,6 +12,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <chrono>
 #include <random>
 #include <string>
 #include <vector>
@@ -33,9 +34,18 @@ int main(int argc, char ** argv)
   // Wait for a few seconds to let all of the nodes come up
   std::this_thread::sleep_for(5s);
 
-  // Start the nav2 system, bringing it to the ACTIVE state
+  // Start the nav2 system, bringing it to the ACTIVE state, and time how long each
+  // part takes to be brought up
+  auto start = std::chrono::steady_clock::now();
   client_nav.startup();
+  auto nav_up = std::chrono::steady_clock::now();
   client_loc.startup();
+  auto loc_up = std::chrono::steady_clock::now();
+  RCLCPP_INFO(
+    rclcpp::get_logger("test_updown"),
+    "Bring-up time: navigation %.3f s, localization %.3f s",
+    std::chrono::duration<double>(nav_up - start).count(),
+    std::chrono::duration<double>(loc_up - nav_up).count());
 
   // Wait for a couple secs to make sure the nodes have processed all discovery
   // info before starting
@@ -24,7 +24,11 @@
 # tests were able to make it to the active state as well as the shutdown state.
 # It can frequently occur that the system makes all the lifecycle state transitions
 # but has an error during the final process termination.
+#
+# The time the lifecycle managers took to bring their nodes up is summarized too, as
+# a benchmark of the bring-up.
 
+import re
 import sys
 
 
@@ -34,6 +38,7 @@ def main():
     fail_count = 0
     successful_bringup_count = 0
     successful_shutdown_count = 0
+    bringup_times = {'navigation': [], 'localization': []}
     for line in log.readlines():
         if line.startswith('======= START OF RUN:'):
             test_successful = True
@@ -62,10 +67,20 @@ def main():
         if 'The system has been sucessfully shut down' in line:
             shutdown_successful = True
 
+        match = re.search(r'Bring-up time: navigation ([0-9.]+) s, localization ([0-9.]+) s', line)
+        if match:
+            bringup_times['navigation'].append(float(match.group(1)))
+            bringup_times['localization'].append(float(match.group(2)))
+
     print('Number of tests: ', test_count)
     print('Number of successes: ', test_count-fail_count)
     print('Number of successful bringups', successful_bringup_count)
     print('Number of successful shutdowns', successful_shutdown_count)
+    for part, times in bringup_times.items():
+        if times:
+            times.sort()
+            print('Bring-up time of %s: mean %.3f s, median %.3f s, max %.3f s' % (
+                part, sum(times) / len(times), times[len(times) // 2], times[-1]))
 
 
 if __name__ == '__main__':
@@ -0,0 +1,212 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_UTIL__ASYNC_SERVICE_CLIENT_HPP_
+#define NAV2_UTIL__ASYNC_SERVICE_CLIENT_HPP_
+
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "nav2_util/executor_pool.hpp"
+#include "nav2_util/node_utils.hpp"
+#include "rclcpp/rclcpp.hpp"
+
+namespace nav2_util
+{
+
+/// @brief A service client whose calls don't block: they return a future, and can call
+///        back, set as the response comes in
+///
+/// Unlike ServiceClient, the client's node isn't spun by the caller. Its own node is
+/// spun by the process-wide ExecutorPool, and a provided one must be spun elsewhere. A
+/// request made before the service is available is held and sent once the service
+/// appears, which a thread of the client waits for on the graph events of the node
+/// rather than by polling. The thread only runs while requests are held, so many calls,
+/// to one service or to many, can be in flight at once from a single thread.
+template<class ServiceT>
+class AsyncServiceClient
+{
+public:
+  using RequestType = typename ServiceT::Request;
+  using ResponseType = typename ServiceT::Response;
+  using ResponseFuture = std::shared_future<typename ResponseType::SharedPtr>;
+  using Callback = std::function<void (typename ResponseType::SharedPtr)>;
+
+  /// @brief Create the client
+  /// @param service_name The service to call
+  /// @param provided_node The node to create the client on, which the caller spins, or
+  ///        null for an internal node spun by the ExecutorPool
+  explicit AsyncServiceClient(
+    const std::string & service_name,
+    const rclcpp::Node::SharedPtr & provided_node = rclcpp::Node::SharedPtr())
+  : service_name_(service_name)
+  {
+    if (provided_node) {
+      node_ = provided_node;
+    } else {
+      node_ = generate_internal_node(service_name + "_Node");
+      ExecutorPool::get().add_node(node_->get_node_base_interface());
+      spun_ = true;
+    }
+    client_ = node_->create_client<ServiceT>(service_name);
+  }
+
+  /// @brief Stop waiting for the service. The futures of the requests still held are
+  ///        broken.
+  ~AsyncServiceClient()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    if (waiter_.joinable()) {
+      waiter_.join();
+    }
+    if (spun_) {
+      ExecutorPool::get().remove_node(node_->get_node_base_interface());
+    }
+  }
+
+  AsyncServiceClient(const AsyncServiceClient &) = delete;
+  AsyncServiceClient & operator=(const AsyncServiceClient &) = delete;
+
+  /// @brief Send a request, now or once the service is available
+  /// @param request The request
+  /// @param callback Called with the response, on the thread spinning the node
+  /// @return The future response
+  ResponseFuture async_invoke(
+    const typename RequestType::SharedPtr & request,
+    Callback callback = Callback())
+  {
+    auto call = std::make_shared<Call>();
+    call->request = request;
+    call->callback = std::move(callback);
+    ResponseFuture future = call->promise.get_future().share();
+
+    if (client_->service_is_ready()) {
+      send(call);
+      return future;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    held_.push_back(call);
+    if (!waiting_) {
+      // the last waiter is done, or about to be, as it cleared waiting_ under the lock
+      if (waiter_.joinable()) {
+        waiter_.join();
+      }
+      waiting_ = true;
+      waiter_ = std::thread(&AsyncServiceClient::waitForService, this);
+    }
+    return future;
+  }
+
+  /// @brief Whether the service is available right now
+  bool service_is_ready() const
+  {
+    return client_->service_is_ready();
+  }
+
+protected:
+  struct Call
+  {
+    typename RequestType::SharedPtr request;
+    std::promise<typename ResponseType::SharedPtr> promise;
+    Callback callback;
+  };
+
+  void send(const std::shared_ptr<Call> & call)
+  {
+    RCLCPP_DEBUG(
+      node_->get_logger(), "%s async service client: send request",
+      service_name_.c_str());
+    client_->async_send_request(
+      call->request,
+      [call](typename rclcpp::Client<ServiceT>::SharedFuture future) {
+        auto response = future.get();
+        call->promise.set_value(response);
+        if (call->callback) {
+          call->callback(response);
+        }
+      });
+  }
+
+  // Send the held requests once the service appears
+  void waitForService()
+  {
+    // wakes on the graph changes of the node, the timeout only bounds how long
+    // stopping takes
+    while (!client_->wait_for_service(std::chrono::milliseconds(100))) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (stopping_ || !rclcpp::ok()) {
+        waiting_ = false;
+        return;
+      }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto & call : held_) {
+      send(call);
+    }
+    held_.clear();
+    waiting_ = false;
+  }
+
+  std::string service_name_;
+  rclcpp::Node::SharedPtr node_;
+  bool spun_{false};
+  typename rclcpp::Client<ServiceT>::SharedPtr client_;
+
+  // The requests made before the service was available, and the thread waiting for it
+  std::mutex mutex_;
+  std::vector<std::shared_ptr<Call>> held_;
+  bool waiting_{false};
+  bool stopping_{false};
+  std::thread waiter_;
+};
+
+/// @brief Wait for several futures, such as those of requests made at once to many services
+/// @param futures The futures
+/// @param timeout How long to wait for all of them
+/// @return True if all of them are ready
+template<typename FutureT>
+bool wait_for_all(
+  const std::vector<FutureT> & futures,
+  const std::chrono::nanoseconds timeout = std::chrono::nanoseconds::max())
+{
+  if (timeout == std::chrono::nanoseconds::max()) {
+    for (const auto & future : futures) {
+      future.wait();
+    }
+    return true;
+  }
+
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+  for (const auto & future : futures) {
+    if (future.wait_until(deadline) != std::future_status::ready) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace nav2_util
+
+#endif  // NAV2_UTIL__ASYNC_SERVICE_CLIENT_HPP_
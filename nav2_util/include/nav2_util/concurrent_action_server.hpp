@@ -0,0 +1,300 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_UTIL__CONCURRENT_ACTION_SERVER_HPP_
+#define NAV2_UTIL__CONCURRENT_ACTION_SERVER_HPP_
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rclcpp/rclcpp.hpp"
+#include "rclcpp_action/rclcpp_action.hpp"
+
+namespace nav2_util
+{
+
+/// @brief An action server executing several goals at once on a fixed set of workers
+///
+/// Unlike SimpleActionServer, a new goal doesn't preempt the running one: goals
+/// are queued and each is handed to the first idle worker, so independent
+/// clients don't wait behind each other. The execute callback gets the goal
+/// handle and the index of the worker running it, which callers can use to
+/// give every worker its own workspace. A goal the callback leaves active is
+/// aborted.
+template<typename ActionT, typename nodeT = rclcpp::Node>
+class ConcurrentActionServer
+{
+public:
+  typedef rclcpp_action::ServerGoalHandle<ActionT> GoalHandle;
+  typedef std::function<void (const std::shared_ptr<GoalHandle> &, unsigned int)> ExecuteCallback;
+
+  explicit ConcurrentActionServer(
+    typename nodeT::SharedPtr node,
+    const std::string & action_name,
+    ExecuteCallback execute_callback,
+    unsigned int num_workers = 1,
+    bool autostart = true,
+    std::chrono::milliseconds server_timeout = std::chrono::milliseconds(500))
+  : ConcurrentActionServer(
+      node->get_node_base_interface(),
+      node->get_node_clock_interface(),
+      node->get_node_logging_interface(),
+      node->get_node_waitables_interface(),
+      action_name, execute_callback, num_workers, autostart, server_timeout)
+  {}
+
+  explicit ConcurrentActionServer(
+    rclcpp::node_interfaces::NodeBaseInterface::SharedPtr node_base_interface,
+    rclcpp::node_interfaces::NodeClockInterface::SharedPtr node_clock_interface,
+    rclcpp::node_interfaces::NodeLoggingInterface::SharedPtr node_logging_interface,
+    rclcpp::node_interfaces::NodeWaitablesInterface::SharedPtr node_waitables_interface,
+    const std::string & action_name,
+    ExecuteCallback execute_callback,
+    unsigned int num_workers = 1,
+    bool autostart = true,
+    std::chrono::milliseconds server_timeout = std::chrono::milliseconds(500))
+  : node_logging_interface_(node_logging_interface),
+    action_name_(action_name),
+    execute_callback_(execute_callback),
+    server_active_(autostart),
+    server_timeout_(server_timeout)
+  {
+    using namespace std::placeholders;  // NOLINT
+
+    if (num_workers == 0) {
+      num_workers = 1;
+    }
+    for (unsigned int i = 0; i < num_workers; ++i) {
+      workers_.emplace_back(&ConcurrentActionServer::work, this, i);
+    }
+
+    action_server_ = rclcpp_action::create_server<ActionT>(
+      node_base_interface,
+      node_clock_interface,
+      node_logging_interface,
+      node_waitables_interface,
+      action_name_,
+      std::bind(&ConcurrentActionServer::handle_goal, this, _1, _2),
+      std::bind(&ConcurrentActionServer::handle_cancel, this, _1),
+      std::bind(&ConcurrentActionServer::handle_accepted, this, _1));
+  }
+
+  ~ConcurrentActionServer()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      shutdown_ = true;
+      server_active_ = false;
+    }
+    queue_cv_.notify_all();
+    for (auto & worker : workers_) {
+      worker.join();
+    }
+    terminate_queued();
+  }
+
+  ConcurrentActionServer(const ConcurrentActionServer &) = delete;
+  ConcurrentActionServer & operator=(const ConcurrentActionServer &) = delete;
+
+  rclcpp_action::GoalResponse handle_goal(
+    const rclcpp_action::GoalUUID & /*uuid*/,
+    std::shared_ptr<const typename ActionT::Goal>/*goal*/)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (!server_active_) {
+      return rclcpp_action::GoalResponse::REJECT;
+    }
+
+    debug_msg("Received request for goal acceptance");
+    return rclcpp_action::GoalResponse::ACCEPT_AND_EXECUTE;
+  }
+
+  rclcpp_action::CancelResponse handle_cancel(const std::shared_ptr<GoalHandle>/*handle*/)
+  {
+    debug_msg("Received request for goal cancellation");
+    return rclcpp_action::CancelResponse::ACCEPT;
+  }
+
+  void handle_accepted(const std::shared_ptr<GoalHandle> handle)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!server_active_) {
+        // deactivated between accepting the goal and being handed it
+        terminate(handle);
+        return;
+      }
+      queue_.push_back(handle);
+    }
+    debug_msg("Queued a new goal");
+    queue_cv_.notify_one();
+  }
+
+  void activate()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    server_active_ = true;
+  }
+
+  void deactivate()
+  {
+    debug_msg("Deactivating...");
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      server_active_ = false;
+    }
+    terminate_queued();
+
+    // the callbacks should notice is_server_active() and return
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (busy_workers_ > 0) {
+      warn_msg(
+        "Requested to deactivate server but goals are still executing."
+        " Should check if action server is running before deactivating.");
+    }
+    if (!idle_cv_.wait_for(lock, server_timeout_, [this]() {return busy_workers_ == 0;})) {
+      throw std::runtime_error("Action callbacks are still running and missed deadline to stop");
+    }
+
+    debug_msg("Deactivation completed.");
+  }
+
+  bool is_running()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return busy_workers_ > 0;
+  }
+
+  bool is_server_active()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return server_active_;
+  }
+
+  /// @brief The number of goals executed at once
+  unsigned int num_workers() const {return static_cast<unsigned int>(workers_.size());}
+
+  /// @brief End a goal that didn't succeed, as canceled if the client asked for it
+  void terminate(
+    const std::shared_ptr<GoalHandle> & handle,
+    typename std::shared_ptr<typename ActionT::Result> result =
+    std::make_shared<typename ActionT::Result>())
+  {
+    if (handle != nullptr && handle->is_active()) {
+      if (handle->is_canceling()) {
+        warn_msg("Client requested to cancel the goal. Cancelling.");
+        handle->canceled(result);
+      } else {
+        warn_msg("Aborting handle.");
+        handle->abort(result);
+      }
+    }
+  }
+
+protected:
+  void work(unsigned int worker)
+  {
+    while (true) {
+      std::shared_ptr<GoalHandle> handle;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        queue_cv_.wait(lock, [this]() {return shutdown_ || !queue_.empty();});
+        if (shutdown_) {
+          return;
+        }
+        handle = queue_.front();
+        queue_.pop_front();
+        ++busy_workers_;
+      }
+
+      if (handle->is_canceling()) {
+        terminate(handle);
+      } else if (handle->is_active()) {
+        debug_msg("Executing a goal on worker " + std::to_string(worker));
+        try {
+          execute_callback_(handle, worker);
+        } catch (std::exception & ex) {
+          RCLCPP_ERROR(
+            node_logging_interface_->get_logger(),
+            "Action server failed while executing action callback: \"%s\"", ex.what());
+        }
+        if (handle->is_active()) {
+          warn_msg("Goal was not completed successfully.");
+          terminate(handle);
+        }
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        --busy_workers_;
+      }
+      idle_cv_.notify_all();
+    }
+  }
+
+  void terminate_queued()
+  {
+    std::deque<std::shared_ptr<GoalHandle>> queue;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      queue.swap(queue_);
+    }
+    for (auto & handle : queue) {
+      terminate(handle);
+    }
+  }
+
+  void debug_msg(const std::string & msg) const
+  {
+    RCLCPP_DEBUG(
+      node_logging_interface_->get_logger(),
+      "[%s] [ActionServer] %s", action_name_.c_str(), msg.c_str());
+  }
+
+  void warn_msg(const std::string & msg) const
+  {
+    RCLCPP_WARN(
+      node_logging_interface_->get_logger(),
+      "[%s] [ActionServer] %s", action_name_.c_str(), msg.c_str());
+  }
+
+  rclcpp::node_interfaces::NodeLoggingInterface::SharedPtr node_logging_interface_;
+  std::string action_name_;
+  ExecuteCallback execute_callback_;
+
+  std::mutex mutex_;
+  std::condition_variable queue_cv_;
+  std::condition_variable idle_cv_;
+  std::deque<std::shared_ptr<GoalHandle>> queue_;
+  unsigned int busy_workers_{0};
+  bool server_active_;
+  bool shutdown_{false};
+  std::chrono::milliseconds server_timeout_;
+
+  std::vector<std::thread> workers_;
+
+  typename rclcpp_action::Server<ActionT>::SharedPtr action_server_;
+};
+
+}  // namespace nav2_util
+
+#endif  // NAV2_UTIL__CONCURRENT_ACTION_SERVER_HPP_
@@ -0,0 +1,40 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_UTIL__DISTANCE_TRANSFORM_HPP_
+#define NAV2_UTIL__DISTANCE_TRANSFORM_HPP_
+
+#include <cstdint>
+#include <limits>
+
+#include "nav2_util/thread_pool.hpp"
+
+namespace nav2_util
+{
+
+/// @brief The squared distance of a cell with no seed in reach yet
+constexpr int64_t NO_SEED = std::numeric_limits<int64_t>::max();
+
+/// @brief Exact squared Euclidean distance transform of a grid, in cells
+///
+/// The Felzenszwalb and Huttenlocher transform, done as a pass down every
+/// column and then along every row, with the lines shared out over the pool.
+/// @param grid size_x * size_y cells, row by row, 0 at the seeds and NO_SEED
+///        elsewhere. Each cell is replaced by its squared distance to the
+///        nearest seed, or left at NO_SEED when there are none.
+void squaredDistanceTransform(int64_t * grid, int size_x, int size_y, ThreadPool & pool);
+
+}  // namespace nav2_util
+
+#endif  // NAV2_UTIL__DISTANCE_TRANSFORM_HPP_
@@ -0,0 +1,112 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_UTIL__EXECUTOR_POOL_HPP_
+#define NAV2_UTIL__EXECUTOR_POOL_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "rclcpp/rclcpp.hpp"
+
+namespace nav2_util
+{
+
+/// @brief A few threads that spin the helper nodes of a whole process
+///
+/// Each thread runs a single threaded executor, and a node is added to the one
+/// spinning the fewest nodes, so the mostly idle helper nodes share threads
+/// instead of each having its own. A node whose callbacks are latency-critical,
+/// or take long enough to hold up the others, can ask for a thread of its own.
+class ExecutorPool
+{
+public:
+  /// @brief The environment variable setting the number of shared threads of the
+  ///        process-wide pool
+  static constexpr const char * THREADS_ENV_VAR = "NAV2_EXECUTOR_THREADS";
+  static constexpr std::size_t DEFAULT_THREADS = 2;
+
+  /// @brief The pool shared by the whole process, with NAV2_EXECUTOR_THREADS shared
+  ///        threads, or DEFAULT_THREADS if it isn't set
+  static ExecutorPool & get();
+
+  /// @brief Create a pool. Its threads are only started as nodes are added.
+  /// @param num_threads The number of threads the nodes not spun on their own share
+  explicit ExecutorPool(std::size_t num_threads);
+
+  ~ExecutorPool();
+
+  ExecutorPool(const ExecutorPool &) = delete;
+  ExecutorPool & operator=(const ExecutorPool &) = delete;
+
+  /// @brief Start spinning a node
+  /// @param node_base The node to spin
+  /// @param dedicated Whether to spin the node on a thread of its own
+  void add_node(
+    rclcpp::node_interfaces::NodeBaseInterface::SharedPtr node_base, bool dedicated = false);
+
+  /// @brief Stop spinning a node. Returns once none of its callbacks is running.
+  void remove_node(rclcpp::node_interfaces::NodeBaseInterface::SharedPtr node_base);
+
+  /// @brief The number of threads the pool is running
+  std::size_t num_running_threads() const;
+
+protected:
+  // A thread with the executor spinning some of the nodes
+  class Lane
+  {
+public:
+    Lane();
+    ~Lane();
+
+    void add_node(rclcpp::node_interfaces::NodeBaseInterface::SharedPtr node_base);
+    void remove_node(rclcpp::node_interfaces::NodeBaseInterface::SharedPtr node_base);
+
+    // The number of nodes spun, guarded by the pool's mutex
+    std::size_t num_nodes{0};
+
+protected:
+    void spin();
+
+    // Run a change to the executor's nodes while it isn't executing anything
+    template<typename ChangeT>
+    void change(ChangeT change);
+
+    rclcpp::executors::SingleThreadedExecutor executor_;
+
+    // Held by the thread while it spins, and by whoever changes the nodes
+    std::mutex executor_mutex_;
+    std::condition_variable changed_cv_;
+    std::atomic<unsigned int> pending_changes_{0};
+    std::atomic<bool> running_{true};
+    std::thread thread_;
+  };
+
+  std::size_t num_threads_;
+
+  mutable std::mutex mutex_;
+  std::vector<std::unique_ptr<Lane>> shared_lanes_;
+  std::map<rclcpp::node_interfaces::NodeBaseInterface *, std::unique_ptr<Lane>> dedicated_lanes_;
+  std::map<rclcpp::node_interfaces::NodeBaseInterface *, Lane *> node_lanes_;
+};
+
+}  // namespace nav2_util
+
+#endif  // NAV2_UTIL__EXECUTOR_POOL_HPP_
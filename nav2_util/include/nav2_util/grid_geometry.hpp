@@ -0,0 +1,123 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_UTIL__GRID_GEOMETRY_HPP_
+#define NAV2_UTIL__GRID_GEOMETRY_HPP_
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "nav2_util/line_iterator.hpp"
+
+namespace nav2_util
+{
+
+/**
+ * @brief Convert many world points to the cells of a grid at once
+ *
+ * The cells are those Costmap2D::worldToMap() finds, but the loop has no early exit or
+ * branch per point, so the compiler vectorizes the conversion and the bounds check.
+ *
+ * @param points The points, anything with x and y members
+ * @param origin_x The world x of the grid's origin
+ * @param origin_y The world y of the grid's origin
+ * @param resolution The size of a cell
+ * @param size_x The width of the grid in cells
+ * @param size_y The height of the grid in cells
+ * @param cells The cell of each point, only meaningful when all are on the grid
+ * @return Whether every point is on the grid
+ */
+template<class PointsT>
+inline bool worldToMap(
+  const PointsT & points, double origin_x, double origin_y, double resolution,
+  unsigned int size_x, unsigned int size_y, std::vector<std::pair<int, int>> & cells)
+{
+  const std::size_t count = points.size();
+  cells.resize(count);
+  const double max_x = size_x;
+  const double max_y = size_y;
+  bool inside = true;
+  for (std::size_t i = 0; i < count; ++i) {
+    double fx = (points[i].x - origin_x) / resolution;
+    double fy = (points[i].y - origin_y) / resolution;
+    inside &= fx >= 0.0 && fy >= 0.0 && fx < max_x && fy < max_y;
+    cells[i].first = static_cast<int>(fx);
+    cells[i].second = static_cast<int>(fy);
+  }
+  return inside;
+}
+
+/**
+ * @brief Trace the cells of a LineIterator line as runs along rows
+ *
+ * The action is called as at(y, x_min, x_max) for each run of cells of the line in row y,
+ * in the order the line goes, so the cells of a run can be read as one contiguous block.
+ * A line closer to horizontal than vertical comes in few long runs.
+ */
+template<class SpanAction>
+inline void traceLineSpans(int x0, int y0, int x1, int y1, SpanAction at)
+{
+  LineIterator line(x0, y0, x1, y1);
+  int y = line.getY();
+  int x_min = line.getX();
+  int x_max = x_min;
+  for (line.advance(); line.isValid(); line.advance()) {
+    if (line.getY() != y) {
+      at(y, x_min, x_max);
+      y = line.getY();
+      x_min = x_max = line.getX();
+    } else {
+      x_min = std::min(x_min, line.getX());
+      x_max = std::max(x_max, line.getX());
+    }
+  }
+  at(y, x_min, x_max);
+}
+
+/**
+ * @brief Bresenham's line over the cells of a row-major grid, as offsets into it,
+ * applying an action at each of them
+ * @param at The action, called with the offset of each cell
+ * @param abs_da The length of the line along its dominant axis, in cells
+ * @param abs_db The length of the line along the other axis, in cells
+ * @param error_b The starting error along the other axis
+ * @param offset_a The offset of a step along the dominant axis
+ * @param offset_b The offset of a step along the other axis
+ * @param offset The offset of the first cell
+ * @param max_length The most steps to take along the dominant axis
+ */
+template<class ActionType>
+inline void bresenham2D(
+  ActionType at, unsigned int abs_da, unsigned int abs_db, int error_b,
+  int offset_a, int offset_b, unsigned int offset, unsigned int max_length)
+{
+  unsigned int end = std::min(max_length, abs_da);
+  for (unsigned int i = 0; i < end; ++i) {
+    at(offset);
+    offset += offset_a;
+    error_b += abs_db;
+    if ((unsigned int)error_b >= abs_da) {
+      offset += offset_b;
+      error_b -= abs_da;
+    }
+  }
+  at(offset);
+}
+
+}  // namespace nav2_util
+
+#endif  // NAV2_UTIL__GRID_GEOMETRY_HPP_
@@ -0,0 +1,53 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_UTIL__LARGE_BUFFER_HPP_
+#define NAV2_UTIL__LARGE_BUFFER_HPP_
+
+#include <cstddef>
+
+namespace nav2_util
+{
+
+/// The alignment of every large buffer, a cache line and the widest SIMD register
+constexpr std::size_t kLargeBufferAlignment = 64;
+
+/// @brief Allocate a buffer for a grid that's read at random, such as a costmap
+///
+/// A buffer of 2 MB or more is mapped on its own and backed by huge pages, so that
+/// random reads over it miss the TLB far less: from the reserved huge pages if there
+/// are any, otherwise aligned to a huge page and advised to use transparent ones.
+/// Smaller buffers come from the heap. The contents are left uninitialized.
+/// @param bytes The size of the buffer
+/// @return The buffer, aligned to kLargeBufferAlignment
+/// @throw std::bad_alloc if the memory can't be had
+void * allocate_large_buffer(std::size_t bytes);
+
+/// @brief Free a buffer from allocate_large_buffer(), or do nothing for null
+void free_large_buffer(void * buffer);
+
+/// @brief Get a buffer of at least bytes in place of another, keeping the old one if
+///        it's large enough and less than twice as large, so resizing a grid back and
+///        forth doesn't map and unmap it each time. The contents are not kept.
+/// @param buffer A buffer from allocate_large_buffer(), or null
+/// @param bytes The size needed
+/// @return The buffer to use, buffer itself or a new one, buffer being freed then
+void * reallocate_large_buffer(void * buffer, std::size_t bytes);
+
+/// @brief The usable size of a buffer from allocate_large_buffer(), at least what was asked for
+std::size_t large_buffer_capacity(const void * buffer);
+
+}  // namespace nav2_util
+
+#endif  // NAV2_UTIL__LARGE_BUFFER_HPP_
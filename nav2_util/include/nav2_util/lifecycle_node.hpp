@@ -40,7 +40,8 @@ public:
     const std::string & node_name,
     const std::string & namespace_ = "",
     bool use_rclcpp_node = false,
-    const rclcpp::NodeOptions & options = rclcpp::NodeOptions());
+    const rclcpp::NodeOptions & options = rclcpp::NodeOptions(),
+    bool dedicated_rclcpp_thread = false);
   virtual ~LifecycleNode();
 
   typedef struct
@@ -131,7 +132,8 @@ protected:
   // The local node
   rclcpp::Node::SharedPtr rclcpp_node_;
 
-  // When creating a local node, this class will launch a separate thread created to spin the node
+  // When creating a local node, this class spins it on the process' executor pool, on a thread
+  // of its own if dedicated_rclcpp_thread is set, for nodes whose callbacks would hold up others
   std::unique_ptr<NodeThread> rclcpp_thread_;
 };
 
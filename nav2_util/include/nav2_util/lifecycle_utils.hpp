@@ -18,6 +18,7 @@
 #include <vector>
 #include <string>
 #include <chrono>
+#include <cstdint>
 #include "nav2_util/string_utils.hpp"
 
 namespace nav2_util
@@ -77,6 +78,20 @@ void reset_lifecycle_nodes(
   reset_lifecycle_nodes(split(nodes, ':'), service_call_timeout, retries);
 }
 
+/// Make the given lifecycle nodes all take a transition at once
+/** The requests are sent to every node before waiting for any response, and a
+ *  request to a node whose service isn't up yet is sent once it is, so the nodes
+ *  transition concurrently rather than in order.
+ * \param[in] node_names A vector of the fully qualified node names to transition.
+ * \param[in] transition The id of the transition, a lifecycle_msgs::msg::Transition
+ * \param[in] timeout The maximum amount of time to wait for all the nodes.
+ * \return True if every node took the transition within the timeout
+ */
+bool change_lifecycle_states(
+  const std::vector<std::string> & node_names,
+  const std::uint8_t transition,
+  const std::chrono::nanoseconds timeout = std::chrono::nanoseconds::max());
+
 }  // namespace nav2_util
 
 #endif  // NAV2_UTIL__LIFECYCLE_UTILS_HPP_
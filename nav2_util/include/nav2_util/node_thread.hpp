@@ -17,27 +17,30 @@
 
 #include <memory>
 
+#include "nav2_util/executor_pool.hpp"
 #include "rclcpp/rclcpp.hpp"
 
 namespace nav2_util
 {
 
+// Spins a node on the process-wide ExecutorPool for as long as it exists. The node shares
+// the pool's threads unless it's dedicated one of its own.
 class NodeThread
 {
 public:
-  explicit NodeThread(rclcpp::node_interfaces::NodeBaseInterface::SharedPtr node_base);
+  explicit NodeThread(
+    rclcpp::node_interfaces::NodeBaseInterface::SharedPtr node_base, bool dedicated = false);
 
   template<typename NodeT>
-  explicit NodeThread(NodeT node)
-  : NodeThread(node->get_node_base_interface())
+  explicit NodeThread(NodeT node, bool dedicated = false)
+  : NodeThread(node->get_node_base_interface(), dedicated)
   {}
 
+  // Returns once none of the node's callbacks is running
   ~NodeThread();
 
 protected:
   rclcpp::node_interfaces::NodeBaseInterface::SharedPtr node_;
-  std::unique_ptr<std::thread> thread_;
-  rclcpp::executors::SingleThreadedExecutor executor_;
 };
 
 }  // namespace nav2_util
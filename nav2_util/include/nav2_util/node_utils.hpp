@@ -80,6 +80,24 @@ std::string time_to_string(size_t len);
 rclcpp::NodeOptions
 get_node_options_default(bool allow_undeclared = true, bool declare_initial_params = true);
 
+/// Get options for a publisher that always goes through the middleware
+/**
+ * Intra-process communication only supports volatile topics with a keep last history of
+ * a set depth, so the publishers of latched (transient local) topics, or with the system
+ * default QoS, opt out of it in nodes that are composed with it enabled.
+ *
+ * \return The publisher options
+ */
+rclcpp::PublisherOptions get_inter_process_publisher_options();
+
+/// Get options for a subscription that always goes through the middleware
+/**
+ * The subscription counterpart of get_inter_process_publisher_options().
+ *
+ * \return The subscription options
+ */
+rclcpp::SubscriptionOptions get_inter_process_subscription_options();
+
 template<typename NodeT>
 void declare_parameter_if_not_declared(
   NodeT node,
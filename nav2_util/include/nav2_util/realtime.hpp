@@ -0,0 +1,48 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#ifndef NAV2_UTIL__REALTIME_HPP_
+#define NAV2_UTIL__REALTIME_HPP_
+
+#include <string>
+#include <vector>
+
+namespace nav2_util
+{
+
+/// @brief How to schedule a thread that has to keep its rate while other work loads the cores
+struct RealtimeSettings
+{
+  /// SCHED_FIFO priority, from 1 to 99, or 0 to keep the default scheduling
+  int priority{0};
+  /// The CPUs the thread may run on, all of them when empty
+  std::vector<int> cpu_affinity;
+  /// Lock the current and future memory of the whole process into RAM
+  bool lock_memory{false};
+
+  /// @brief Whether the settings change nothing
+  bool empty() const {return priority == 0 && cpu_affinity.empty() && !lock_memory;}
+};
+
+/// @brief Apply the settings to the calling thread
+///
+/// Real-time priorities and locking memory usually need the CAP_SYS_NICE and
+/// CAP_IPC_LOCK capabilities, or matching limits for the user.
+/// @param settings The settings to apply
+/// @param error Set to what couldn't be applied, if anything
+/// @return Whether all the settings were applied, the others are still applied
+bool apply_realtime_settings(const RealtimeSettings & settings, std::string & error);
+
+}  // namespace nav2_util
+
+#endif  // NAV2_UTIL__REALTIME_HPP_
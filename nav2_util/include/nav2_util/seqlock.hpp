@@ -0,0 +1,100 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_UTIL__SEQLOCK_HPP_
+#define NAV2_UTIL__SEQLOCK_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace nav2_util
+{
+
+/// @brief A value written by one thread and read by any number of others without a lock
+///
+/// The writer never waits. A reader copies the value and retries if a write happened
+/// meanwhile, so reads are cheap as long as writes are rare next to them, such as sensor
+/// samples read from control loops. Writes must not overlap each other.
+template<typename T>
+class SeqLock
+{
+  static_assert(std::is_trivially_copyable<T>::value, "SeqLock needs a trivially copyable type");
+
+public:
+  SeqLock()
+  : SeqLock(T{})
+  {
+  }
+
+  explicit SeqLock(const T & value)
+  {
+    store(value);
+  }
+
+  SeqLock(const SeqLock &) = delete;
+  SeqLock & operator=(const SeqLock &) = delete;
+
+  /// @brief Replace the value, from the single writer
+  void store(const T & value)
+  {
+    uint64_t words[kWords] = {};
+    std::memcpy(words, &value, sizeof(T));
+
+    const uint32_t sequence = sequence_.load(std::memory_order_relaxed);
+    sequence_.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (std::size_t i = 0; i < kWords; ++i) {
+      words_[i].store(words[i], std::memory_order_relaxed);
+    }
+    sequence_.store(sequence + 2, std::memory_order_release);
+  }
+
+  /// @brief A copy of the value, never torn by a concurrent store()
+  T load() const
+  {
+    uint64_t words[kWords];
+    uint32_t before, after;
+    do {
+      before = sequence_.load(std::memory_order_acquire);
+      for (std::size_t i = 0; i < kWords; ++i) {
+        words[i] = words_[i].load(std::memory_order_relaxed);
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+      after = sequence_.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+
+    T value;
+    std::memcpy(&value, words, sizeof(T));
+    return value;
+  }
+
+  /// @brief The number of store() calls since construction, to tell whether the value changed
+  uint32_t version() const
+  {
+    return (sequence_.load(std::memory_order_acquire) >> 1) - 1;
+  }
+
+private:
+  static constexpr std::size_t kWords = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+  std::atomic<uint32_t> sequence_{0};
+  std::atomic<uint64_t> words_[kWords];
+};
+
+}  // namespace nav2_util
+
+#endif  // NAV2_UTIL__SEQLOCK_HPP_
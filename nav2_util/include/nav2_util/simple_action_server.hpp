@@ -15,6 +15,8 @@
 #ifndef NAV2_UTIL__SIMPLE_ACTION_SERVER_HPP_
 #define NAV2_UTIL__SIMPLE_ACTION_SERVER_HPP_
 
+#include <atomic>
+#include <condition_variable>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -39,13 +41,16 @@ public:
     const std::string & action_name,
     ExecuteCallback execute_callback,
     bool autostart = true,
-    std::chrono::milliseconds server_timeout = std::chrono::milliseconds(500))
+    std::chrono::milliseconds server_timeout = std::chrono::milliseconds(500),
+    bool execute_in_thread = true,
+    bool persistent_worker = false)
   : SimpleActionServer(
       node->get_node_base_interface(),
       node->get_node_clock_interface(),
       node->get_node_logging_interface(),
       node->get_node_waitables_interface(),
-      action_name, execute_callback, autostart, server_timeout)
+      action_name, execute_callback, autostart, server_timeout, execute_in_thread,
+      persistent_worker)
   {}
 
   explicit SimpleActionServer(
@@ -56,19 +61,28 @@ public:
     const std::string & action_name,
     ExecuteCallback execute_callback,
     bool autostart = true,
-    std::chrono::milliseconds server_timeout = std::chrono::milliseconds(500))
+    std::chrono::milliseconds server_timeout = std::chrono::milliseconds(500),
+    bool execute_in_thread = true,
+    bool persistent_worker = false)
   : node_base_interface_(node_base_interface),
     node_clock_interface_(node_clock_interface),
     node_logging_interface_(node_logging_interface),
     node_waitables_interface_(node_waitables_interface),
     action_name_(action_name),
     execute_callback_(execute_callback),
-    server_timeout_(server_timeout)
+    server_timeout_(server_timeout),
+    execute_in_thread_(execute_in_thread),
+    persistent_worker_(persistent_worker && execute_in_thread)
   {
     if (autostart) {
       server_active_ = true;
     }
 
+    if (persistent_worker_) {
+      // Started once here, rather than a thread per goal
+      worker_ = std::thread(&SimpleActionServer::worker_loop, this);
+    }
+
     using namespace std::placeholders;  // NOLINT
 
     action_server_ = rclcpp_action::create_server<ActionT>(
@@ -82,6 +96,18 @@ public:
       std::bind(&SimpleActionServer::handle_accepted, this, _1));
   }
 
+  ~SimpleActionServer()
+  {
+    if (worker_.joinable()) {
+      {
+        std::lock_guard<std::mutex> lock(worker_mutex_);
+        stop_worker_ = true;
+      }
+      worker_cv_.notify_all();
+      worker_.join();
+    }
+  }
+
   rclcpp_action::GoalResponse handle_goal(
     const rclcpp_action::GoalUUID & /*uuid*/,
     std::shared_ptr<const typename ActionT::Goal>/*goal*/)
@@ -130,6 +156,28 @@ public:
 
       current_handle_ = handle;
 
+      if (!execute_in_thread_) {
+        // The callback only starts the goal, and the user completes it later from
+        // the executor, e.g. in a timer. A goal arriving meanwhile waits in the
+        // pending slot until the user accepts it.
+        debug_msg("Starting goal on the executor.");
+        start_on_executor();
+        return;
+      }
+
+      if (persistent_worker_) {
+        // Marked running here, under the lock, so that a goal arriving before the
+        // worker wakes up goes to the pending slot
+        debug_msg("Handing the goal to the worker thread.");
+        worker_busy_ = true;
+        {
+          std::lock_guard<std::mutex> lock(worker_mutex_);
+          goal_ready_ = true;
+        }
+        worker_cv_.notify_all();
+        return;
+      }
+
       // Return quickly to avoid blocking the executor, so spin up a new thread
       debug_msg("Executing goal asynchronously.");
       execution_future_ = std::async(std::launch::async, [this]() {work();});
@@ -192,7 +240,7 @@ public:
       stop_execution_ = true;
     }
 
-    if (!execution_future_.valid()) {
+    if (!persistent_worker_ && !execution_future_.valid()) {
       return;
     }
 
@@ -204,7 +252,7 @@ public:
 
     using namespace std::chrono;  //NOLINT
     auto start_time = steady_clock::now();
-    while (execution_future_.wait_for(milliseconds(100)) != std::future_status::ready) {
+    while (!wait_for_execution(milliseconds(100))) {
       info_msg("Waiting for async process to finish.");
       if (steady_clock::now() - start_time >= server_timeout_) {
         terminate_all();
@@ -217,6 +265,9 @@ public:
 
   bool is_running()
   {
+    if (persistent_worker_) {
+      return worker_busy_;
+    }
     return execution_future_.valid() &&
            (execution_future_.wait_for(std::chrono::milliseconds(0)) ==
            std::future_status::timeout);
@@ -230,7 +281,7 @@ public:
 
   bool is_preempt_requested() const
   {
-    std::lock_guard<std::recursive_mutex> lock(update_mutex_);
+    // Polled by the execute callback on every loop, so read without the lock
     return preempt_requested_;
   }
 
@@ -341,14 +392,78 @@ protected:
 
   mutable std::recursive_mutex update_mutex_;
   bool server_active_{false};
-  bool preempt_requested_{false};
+  // Set with the pending goal, under the lock, and read without it
+  std::atomic<bool> preempt_requested_{false};
   std::chrono::milliseconds server_timeout_;
+  // When false, the execute callback is called on the executor and must not block
+  bool execute_in_thread_;
+
+  // When set, goals are executed by one thread kept for the life of the server,
+  // woken through goal_ready_, and worker_busy_ takes the place of the future
+  bool persistent_worker_;
+  std::thread worker_;
+  std::mutex worker_mutex_;
+  std::condition_variable worker_cv_;
+  bool goal_ready_{false};
+  bool stop_worker_{false};
+  std::atomic<bool> worker_busy_{false};
 
   std::shared_ptr<rclcpp_action::ServerGoalHandle<ActionT>> current_handle_;
   std::shared_ptr<rclcpp_action::ServerGoalHandle<ActionT>> pending_handle_;
 
   typename rclcpp_action::Server<ActionT>::SharedPtr action_server_;
 
+  void worker_loop()
+  {
+    std::unique_lock<std::mutex> lock(worker_mutex_);
+    while (true) {
+      worker_cv_.wait(lock, [this]() {return goal_ready_ || stop_worker_;});
+      if (stop_worker_) {
+        return;
+      }
+      goal_ready_ = false;
+      lock.unlock();
+
+      // A goal left pending as work() finished is taken up here, and the worker
+      // is only marked idle, under the lock, once there's none
+      while (true) {
+        work();
+        std::lock_guard<std::recursive_mutex> update_lock(update_mutex_);
+        if (stop_execution_ || !is_active(pending_handle_)) {
+          worker_busy_ = false;
+          break;
+        }
+        accept_pending_goal();
+      }
+
+      lock.lock();
+      // for deactivate(), waiting on the worker
+      worker_cv_.notify_all();
+    }
+  }
+
+  // Wait for the goal being executed, if any, to finish
+  bool wait_for_execution(std::chrono::milliseconds timeout)
+  {
+    if (persistent_worker_) {
+      std::unique_lock<std::mutex> lock(worker_mutex_);
+      return worker_cv_.wait_for(lock, timeout, [this]() {return !worker_busy_;});
+    }
+    return execution_future_.wait_for(timeout) == std::future_status::ready;
+  }
+
+  void start_on_executor()
+  {
+    try {
+      execute_callback_();
+    } catch (std::exception & ex) {
+      RCLCPP_ERROR(
+        node_logging_interface_->get_logger(),
+        "Action server failed while executing action callback: \"%s\"", ex.what());
+      terminate_all();
+    }
+  }
+
   constexpr auto empty_result() const
   {
     return std::make_shared<typename ActionT::Result>();
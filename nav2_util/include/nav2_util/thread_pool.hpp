@@ -0,0 +1,98 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_UTIL__THREAD_POOL_HPP_
+#define NAV2_UTIL__THREAD_POOL_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace nav2_util
+{
+
+/// @brief A fixed set of worker threads for data-parallel loops
+///
+/// The workers sleep until parallel_for() hands them a range of work items,
+/// which they share with the calling thread. Only one parallel_for() runs at
+/// a time; concurrent callers are serialized.
+class ThreadPool
+{
+public:
+  /// @brief Start the workers
+  /// @param num_threads The total number of threads working on a loop, including
+  ///        the calling one. 0 uses std::thread::hardware_concurrency()
+  explicit ThreadPool(unsigned int num_threads = 0);
+
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool & operator=(const ThreadPool &) = delete;
+
+  /// @brief The total number of threads working on a loop, including the calling one
+  unsigned int size() const {return static_cast<unsigned int>(workers_.size()) + 1;}
+
+  /// @brief Call task(i) for every i in [0, count) and wait for all of them to finish
+  ///
+  /// The first exception thrown by a task is rethrown here once every
+  /// started task has returned.
+  void parallel_for(std::size_t count, const std::function<void(std::size_t)> & task);
+
+protected:
+  void worker();
+  void run_tasks();
+
+  std::vector<std::thread> workers_;
+
+  std::mutex caller_mutex_;
+  std::mutex mutex_;
+  std::condition_variable work_cv_;
+  std::condition_variable done_cv_;
+
+  // The loop currently being executed, guarded by mutex_
+  const std::function<void(std::size_t)> * task_{nullptr};
+  std::size_t count_{0};
+  std::atomic<std::size_t> next_{0};
+  unsigned int generation_{0};
+  unsigned int busy_workers_{0};
+  std::exception_ptr error_;
+  bool shutdown_{false};
+};
+
+/// @brief Run tasks side by side, each once the tasks it has to follow have finished
+///
+/// The tasks are run in stages: first those following no other, then those following
+/// only tasks of the first stage, and so on. The tasks of a stage are run in parallel
+/// on the pool, or one by one in the order given without one. The first exception
+/// thrown by a task is rethrown once the rest of its stage has finished.
+/// @param pool The threads to run the tasks on, or null to run them on this one
+/// @param tasks The tasks
+/// @param after For each task, the indices of the tasks it has to follow. May be empty
+///        when no task has to follow another.
+/// @return How long each task took
+/// @throw std::invalid_argument if an index is out of range or tasks follow each other
+///        in a cycle
+std::vector<std::chrono::nanoseconds> run_staged_tasks(
+  ThreadPool * pool, const std::vector<std::function<void()>> & tasks,
+  const std::vector<std::vector<std::size_t>> & after = {});
+
+}  // namespace nav2_util
+
+#endif  // NAV2_UTIL__THREAD_POOL_HPP_
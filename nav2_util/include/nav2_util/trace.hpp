@@ -0,0 +1,183 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_UTIL__TRACE_HPP_
+#define NAV2_UTIL__TRACE_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace nav2_util
+{
+namespace trace
+{
+
+/// @brief The environment variable naming the file the trace is written to when the
+///        process exits, with any %p replaced by the process id. Setting it turns
+///        tracing on.
+static constexpr const char * FILE_ENV_VAR = "NAV2_TRACE_FILE";
+
+/// @brief The environment variable setting how many of the latest events are kept
+static constexpr const char * CAPACITY_ENV_VAR = "NAV2_TRACE_CAPACITY";
+static constexpr std::size_t DEFAULT_CAPACITY = 1 << 16;
+
+enum class EventType : uint8_t
+{
+  SCOPE = 0,  // The time spent in a scope
+  LOCK_WAIT = 1  // The time spent waiting for a lock another thread held
+};
+
+struct Event
+{
+  const char * name;  // A string literal naming the scope or the lock
+  uint64_t start_ns;  // On the steady clock
+  uint64_t duration_ns;
+  uint32_t thread;  // A small number for the thread, in the order the threads first traced
+  EventType type;
+};
+
+/// @brief Whether events are being recorded, off unless NAV2_TRACE_FILE is set
+bool enabled();
+
+/// @brief Turn recording events on or off
+void set_enabled(bool enabled);
+
+/// @brief The time on the steady clock, in nanoseconds
+uint64_t now_ns();
+
+/// @brief The number of the calling thread in the trace
+uint32_t thread_index();
+
+/// @brief A fixed number of the latest events, recorded without locks by any thread
+///
+/// Each slot carries a sequence number that is odd while the slot is written, so a
+/// snapshot skips the events being overwritten instead of reading them torn.
+class TraceBuffer
+{
+public:
+  /// @brief The buffer of the process, with NAV2_TRACE_CAPACITY events (DEFAULT_CAPACITY
+  ///        if it isn't set). It's written to NAV2_TRACE_FILE, if set, when the process exits.
+  static TraceBuffer & get();
+
+  explicit TraceBuffer(std::size_t capacity);
+  ~TraceBuffer();
+
+  TraceBuffer(const TraceBuffer &) = delete;
+  TraceBuffer & operator=(const TraceBuffer &) = delete;
+
+  std::size_t capacity() const {return capacity_;}
+
+  /// @brief Record an event, overwriting the oldest one if the buffer is full
+  void record(const Event & event);
+
+  /// @brief The events in the buffer, oldest first
+  std::vector<Event> snapshot() const;
+
+  /// @brief Write the events as CSV: name, type, thread, start and duration in nanoseconds
+  /// @return false if the file couldn't be written
+  bool write_csv(const std::string & filename) const;
+
+protected:
+  struct Slot
+  {
+    std::atomic<uint64_t> sequence{0};
+    Event event;
+  };
+
+  std::size_t capacity_;
+  std::unique_ptr<Slot[]> slots_;
+  std::atomic<uint64_t> next_{0};
+};
+
+/// @brief Records the time spent in a scope, if tracing is enabled when it's entered
+class ScopedTrace
+{
+public:
+  explicit ScopedTrace(const char * name)
+  : name_(enabled() ? name : nullptr), start_ns_(name_ ? now_ns() : 0)
+  {
+  }
+
+  ~ScopedTrace()
+  {
+    if (name_) {
+      TraceBuffer::get().record(
+        {name_, start_ns_, now_ns() - start_ns_, thread_index(), EventType::SCOPE});
+    }
+  }
+
+  ScopedTrace(const ScopedTrace &) = delete;
+  ScopedTrace & operator=(const ScopedTrace &) = delete;
+
+protected:
+  const char * name_;
+  uint64_t start_ns_;
+};
+
+/// @brief A mutex that records how long its lock is waited for, when another thread holds it
+///
+/// Taking it uncontended costs a try_lock, as the wait is only timed when that fails.
+template<typename MutexT>
+class TracedMutex
+{
+public:
+  explicit TracedMutex(const char * name = "mutex")
+  : name_(name)
+  {
+  }
+
+  void lock()
+  {
+    if (!enabled()) {
+      mutex_.lock();
+      return;
+    }
+    if (mutex_.try_lock()) {
+      return;
+    }
+    uint64_t start_ns = now_ns();
+    mutex_.lock();
+    TraceBuffer::get().record(
+      {name_, start_ns, now_ns() - start_ns, thread_index(), EventType::LOCK_WAIT});
+  }
+
+  bool try_lock() {return mutex_.try_lock();}
+
+  void unlock() {mutex_.unlock();}
+
+protected:
+  MutexT mutex_;
+  const char * name_;
+};
+
+}  // namespace trace
+}  // namespace nav2_util
+
+#define NAV2_TRACE_CONCAT_INNER(a, b) a ## b
+#define NAV2_TRACE_CONCAT(a, b) NAV2_TRACE_CONCAT_INNER(a, b)
+
+/// Record the time spent in the rest of the enclosing scope under a string literal name.
+/// Defining NAV2_UTIL_DISABLE_TRACING compiles the scopes out.
+#ifdef NAV2_UTIL_DISABLE_TRACING
+#define NAV2_TRACE_SCOPE(name)
+#else
+#define NAV2_TRACE_SCOPE(name) \
+  nav2_util::trace::ScopedTrace NAV2_TRACE_CONCAT(nav2_trace_scope_, __LINE__)(name)
+#endif
+
+#endif  // NAV2_UTIL__TRACE_HPP_
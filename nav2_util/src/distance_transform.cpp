@@ -0,0 +1,104 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_util/distance_transform.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+namespace nav2_util
+{
+
+namespace
+{
+
+// Lines handed to a thread at a time, to keep the scheduling cost small
+const int LINES_PER_TASK = 16;
+
+// One pass: replaces the squared distances f of n cells stride apart by the
+// lowest f[p] + (q - p)^2
+void transformLine(int64_t * f, int n, int stride)
+{
+  thread_local std::vector<int64_t> samples;
+  thread_local std::vector<int> v;
+  thread_local std::vector<double> z;
+  samples.resize(n);
+  v.resize(n);
+  z.resize(n + 1);
+
+  for (int q = 0; q < n; q++) {
+    samples[q] = f[q * stride];
+  }
+
+  // Lower envelope of the parabolas rooted at the cells that have a distance,
+  // the others contribute nothing
+  int k = -1;
+  for (int q = 0; q < n; q++) {
+    if (samples[q] == NO_SEED) {
+      continue;
+    }
+    double fq = static_cast<double>(samples[q]) + static_cast<double>(q) * q;
+    double s = -std::numeric_limits<double>::infinity();
+    while (k >= 0) {
+      int p = v[k];
+      s = (fq - (static_cast<double>(samples[p]) + static_cast<double>(p) * p)) /
+        (2.0 * q - 2.0 * p);
+      if (s > z[k]) {
+        break;
+      }
+      k--;
+    }
+    k++;
+    v[k] = q;
+    z[k] = k == 0 ? -std::numeric_limits<double>::infinity() : s;
+    z[k + 1] = std::numeric_limits<double>::infinity();
+  }
+
+  if (k < 0) {
+    return;
+  }
+
+  int j = 0;
+  for (int q = 0; q < n; q++) {
+    while (z[j + 1] < q) {
+      j++;
+    }
+    int64_t d = q - v[j];
+    f[q * stride] = d * d + samples[v[j]];
+  }
+}
+
+}  // namespace
+
+void squaredDistanceTransform(int64_t * grid, int size_x, int size_y, ThreadPool & pool)
+{
+  auto columns = [grid, size_x, size_y](size_t task) {
+      int end = std::min(static_cast<int>(task + 1) * LINES_PER_TASK, size_x);
+      for (int i = static_cast<int>(task) * LINES_PER_TASK; i < end; i++) {
+        transformLine(grid + i, size_y, size_x);
+      }
+    };
+  auto rows = [grid, size_x, size_y](size_t task) {
+      int end = std::min(static_cast<int>(task + 1) * LINES_PER_TASK, size_y);
+      for (int j = static_cast<int>(task) * LINES_PER_TASK; j < end; j++) {
+        transformLine(grid + static_cast<size_t>(j) * size_x, size_x, 1);
+      }
+    };
+
+  pool.parallel_for((size_x + LINES_PER_TASK - 1) / LINES_PER_TASK, columns);
+  pool.parallel_for((size_y + LINES_PER_TASK - 1) / LINES_PER_TASK, rows);
+}
+
+}  // namespace nav2_util
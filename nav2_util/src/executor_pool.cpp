@@ -0,0 +1,207 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_util/executor_pool.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace nav2_util
+{
+
+namespace
+{
+
+std::size_t threads_from_environment()
+{
+  const char * value = std::getenv(ExecutorPool::THREADS_ENV_VAR);
+  if (value == nullptr) {
+    return ExecutorPool::DEFAULT_THREADS;
+  }
+  try {
+    unsigned long threads = std::stoul(value);  // NOLINT(runtime/int)
+    if (threads > 0) {
+      return threads;
+    }
+  } catch (const std::exception &) {
+  }
+  RCLCPP_WARN(
+    rclcpp::get_logger("executor_pool"), "Ignoring %s=%s, which isn't a positive number",
+    ExecutorPool::THREADS_ENV_VAR, value);
+  return ExecutorPool::DEFAULT_THREADS;
+}
+
+}  // namespace
+
+ExecutorPool::Lane::Lane()
+: thread_(&ExecutorPool::Lane::spin, this)
+{
+}
+
+ExecutorPool::Lane::~Lane()
+{
+  pending_changes_++;
+  executor_.cancel();
+  {
+    std::lock_guard<std::mutex> lock(executor_mutex_);
+    running_ = false;
+  }
+  changed_cv_.notify_all();
+  thread_.join();
+}
+
+void ExecutorPool::Lane::spin()
+{
+  std::unique_lock<std::mutex> lock(executor_mutex_);
+  while (true) {
+    // Let the changes waiting for the executor through first
+    changed_cv_.wait(lock, [this]() {return pending_changes_ == 0 || !running_;});
+    if (!running_ || !rclcpp::ok()) {
+      return;
+    }
+    try {
+      // Returns after executing some work, or when a change cancels it
+      executor_.spin_once();
+    } catch (const std::exception &) {
+      // Waiting fails once the context is shut down
+      if (!rclcpp::ok()) {
+        return;
+      }
+      throw;
+    }
+  }
+}
+
+template<typename ChangeT>
+void ExecutorPool::Lane::change(ChangeT change)
+{
+  if (std::this_thread::get_id() == thread_.get_id()) {
+    // From one of the callbacks of this lane, so the executor is already ours
+    change();
+    return;
+  }
+
+  pending_changes_++;
+  executor_.cancel();
+  {
+    // Once the lock is ours none of the lane's callbacks is running
+    std::lock_guard<std::mutex> lock(executor_mutex_);
+    change();
+    pending_changes_--;
+  }
+  changed_cv_.notify_all();
+}
+
+void ExecutorPool::Lane::add_node(
+  rclcpp::node_interfaces::NodeBaseInterface::SharedPtr node_base)
+{
+  change([this, &node_base]() {executor_.add_node(node_base, false);});
+}
+
+void ExecutorPool::Lane::remove_node(
+  rclcpp::node_interfaces::NodeBaseInterface::SharedPtr node_base)
+{
+  change([this, &node_base]() {executor_.remove_node(node_base, false);});
+}
+
+ExecutorPool & ExecutorPool::get()
+{
+  static ExecutorPool pool(threads_from_environment());
+  return pool;
+}
+
+ExecutorPool::ExecutorPool(std::size_t num_threads)
+: num_threads_(std::max<std::size_t>(num_threads, 1))
+{
+}
+
+ExecutorPool::~ExecutorPool()
+{
+}
+
+void ExecutorPool::add_node(
+  rclcpp::node_interfaces::NodeBaseInterface::SharedPtr node_base, bool dedicated)
+{
+  Lane * lane = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (node_lanes_.count(node_base.get()) != 0) {
+      throw std::runtime_error(
+              std::string("The executor pool already spins the node ") + node_base->get_name());
+    }
+
+    if (dedicated) {
+      auto & owned = dedicated_lanes_[node_base.get()];
+      owned = std::make_unique<Lane>();
+      lane = owned.get();
+    } else {
+      // The least busy thread, starting another while there are fewer than asked for
+      for (auto & shared : shared_lanes_) {
+        if (lane == nullptr || shared->num_nodes < lane->num_nodes) {
+          lane = shared.get();
+        }
+      }
+      if ((lane == nullptr || lane->num_nodes > 0) && shared_lanes_.size() < num_threads_) {
+        shared_lanes_.push_back(std::make_unique<Lane>());
+        lane = shared_lanes_.back().get();
+      }
+    }
+    lane->num_nodes++;
+    node_lanes_[node_base.get()] = lane;
+  }
+
+  // Outside the pool's lock, so callbacks of other lanes can add nodes meanwhile
+  lane->add_node(node_base);
+}
+
+void ExecutorPool::remove_node(rclcpp::node_interfaces::NodeBaseInterface::SharedPtr node_base)
+{
+  Lane * lane = nullptr;
+  std::unique_ptr<Lane> dedicated_lane;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = node_lanes_.find(node_base.get());
+    if (it == node_lanes_.end()) {
+      return;
+    }
+    lane = it->second;
+    node_lanes_.erase(it);
+    lane->num_nodes--;
+
+    auto dedicated = dedicated_lanes_.find(node_base.get());
+    if (dedicated != dedicated_lanes_.end()) {
+      dedicated_lane = std::move(dedicated->second);
+      dedicated_lanes_.erase(dedicated);
+    }
+  }
+
+  // A thread of the node's own just stops, the shared ones carry on without it
+  if (dedicated_lane) {
+    dedicated_lane.reset();
+  } else {
+    lane->remove_node(node_base);
+  }
+}
+
+std::size_t ExecutorPool::num_running_threads() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return shared_lanes_.size() + dedicated_lanes_.size();
+}
+
+}  // namespace nav2_util
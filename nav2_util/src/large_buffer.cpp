@@ -0,0 +1,142 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdlib.h>
+#include <sys/mman.h>
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include "nav2_util/large_buffer.hpp"
+
+namespace nav2_util
+{
+
+namespace
+{
+
+constexpr std::size_t kHugePageSize = 2 * 1024 * 1024;
+
+// Kept in front of each buffer, a whole alignment unit so the buffer stays aligned
+struct Header
+{
+  void * base;  // what was mapped or allocated
+  std::size_t length;  // the length mapped, 0 for the heap
+  std::size_t capacity;  // the usable size of the buffer
+};
+constexpr std::size_t kHeaderSize = kLargeBufferAlignment;
+static_assert(sizeof(Header) <= kHeaderSize, "The header must fit in front of the buffer");
+
+std::size_t roundUp(std::size_t value, std::size_t multiple)
+{
+  return (value + multiple - 1) / multiple * multiple;
+}
+
+// Map length bytes, rounded up to huge pages, backed by huge pages where possible
+void * mapHugePages(std::size_t & length)
+{
+  length = roundUp(length, kHugePageSize);
+
+#ifdef MAP_HUGETLB
+  void * reserved = mmap(
+    nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  if (reserved != MAP_FAILED) {
+    return reserved;
+  }
+#endif
+
+  // No reserved huge pages: map a huge page more than needed, unmap the ends so the
+  // rest starts on a huge page boundary, and ask for transparent huge pages
+  std::size_t padded = length + kHugePageSize;
+  void * mapped = mmap(
+    nullptr, padded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mapped == MAP_FAILED) {
+    return nullptr;
+  }
+  char * raw = static_cast<char *>(mapped);
+  char * aligned = reinterpret_cast<char *>(
+    roundUp(reinterpret_cast<std::uintptr_t>(raw), kHugePageSize));
+  if (aligned > raw) {
+    munmap(raw, aligned - raw);
+  }
+  std::size_t tail = (raw + padded) - (aligned + length);
+  if (tail > 0) {
+    munmap(aligned + length, tail);
+  }
+#ifdef MADV_HUGEPAGE
+  madvise(aligned, length, MADV_HUGEPAGE);
+#endif
+  return aligned;
+}
+
+const Header & headerOf(const void * buffer)
+{
+  return *reinterpret_cast<const Header *>(static_cast<const char *>(buffer) - kHeaderSize);
+}
+
+}  // namespace
+
+void * allocate_large_buffer(std::size_t bytes)
+{
+  Header header{};
+  std::size_t total = roundUp(bytes + kHeaderSize, kLargeBufferAlignment);
+  if (total >= kHugePageSize) {
+    header.length = total;
+    header.base = mapHugePages(header.length);
+    total = header.length;
+  } else if (posix_memalign(&header.base, kLargeBufferAlignment, total) != 0) {
+    header.base = nullptr;
+  }
+  if (header.base == nullptr) {
+    throw std::bad_alloc();
+  }
+  header.capacity = total - kHeaderSize;
+
+  std::memcpy(header.base, &header, sizeof(header));
+  return static_cast<char *>(header.base) + kHeaderSize;
+}
+
+void free_large_buffer(void * buffer)
+{
+  if (buffer == nullptr) {
+    return;
+  }
+  Header header = headerOf(buffer);
+  if (header.length > 0) {
+    munmap(header.base, header.length);
+  } else {
+    std::free(header.base);
+  }
+}
+
+void * reallocate_large_buffer(void * buffer, std::size_t bytes)
+{
+  if (buffer != nullptr) {
+    std::size_t capacity = large_buffer_capacity(buffer);
+    if (capacity >= bytes && capacity / 2 < bytes) {
+      return buffer;
+    }
+    free_large_buffer(buffer);
+  }
+  return allocate_large_buffer(bytes);
+}
+
+std::size_t large_buffer_capacity(const void * buffer)
+{
+  return buffer == nullptr ? 0 : headerOf(buffer).capacity;
+}
+
+}  // namespace nav2_util
@@ -43,19 +43,22 @@ namespace nav2_util
 LifecycleNode::LifecycleNode(
   const std::string & node_name,
   const std::string & namespace_, bool use_rclcpp_node,
-  const rclcpp::NodeOptions & options)
+  const rclcpp::NodeOptions & options, bool dedicated_rclcpp_thread)
 : rclcpp_lifecycle::LifecycleNode(node_name, namespace_, options),
   use_rclcpp_node_(use_rclcpp_node)
 {
   if (use_rclcpp_node_) {
-    std::vector<std::string> new_args = options.arguments();
-    new_args.push_back("--ros-args");
-    new_args.push_back("-r");
-    new_args.push_back(std::string("__node:=") + this->get_name() + "_rclcpp_node");
-    new_args.push_back("--");
+    // The first matching remap rule wins, so the node's own name goes before the arguments
+    // a component container passes, which rename the lifecycle node
+    std::vector<std::string> new_args = {
+      "--ros-args", "-r", std::string("__node:=") + this->get_name() + "_rclcpp_node", "--"};
+    new_args.insert(new_args.end(), options.arguments().begin(), options.arguments().end());
+    // The local node carries TF, whose static topic is latched, which intra-process
+    // communication doesn't support
     rclcpp_node_ = std::make_shared<rclcpp::Node>(
-      "_", namespace_, rclcpp::NodeOptions(options).arguments(new_args));
-    rclcpp_thread_ = std::make_unique<NodeThread>(rclcpp_node_);
+      "_", namespace_,
+      rclcpp::NodeOptions(options).arguments(new_args).use_intra_process_comms(false));
+    rclcpp_thread_ = std::make_unique<NodeThread>(rclcpp_node_, dedicated_rclcpp_thread);
   }
   print_lifecycle_node_notification();
 }
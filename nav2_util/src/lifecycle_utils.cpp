@@ -13,13 +13,18 @@
 // limitations under the License.
 
 #include <chrono>
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <thread>
 #include <vector>
 
 #include "lifecycle_msgs/srv/change_state.hpp"
 #include "lifecycle_msgs/srv/get_state.hpp"
+#include "nav2_util/async_service_client.hpp"
+#include "nav2_util/executor_pool.hpp"
 #include "nav2_util/lifecycle_service_client.hpp"
+#include "nav2_util/node_utils.hpp"
 
 using std::string;
 using lifecycle_msgs::msg::Transition;
@@ -98,4 +103,38 @@ void reset_lifecycle_nodes(
   }
 }
 
+bool change_lifecycle_states(
+  const std::vector<std::string> & node_names,
+  const std::uint8_t transition,
+  const std::chrono::nanoseconds timeout)
+{
+  using ChangeState = lifecycle_msgs::srv::ChangeState;
+
+  // one node serves all the clients
+  auto node = generate_internal_node("lifecycle_batch_client");
+  ExecutorPool::get().add_node(node->get_node_base_interface());
+
+  bool result;
+  {
+    std::vector<std::unique_ptr<AsyncServiceClient<ChangeState>>> clients;
+    std::vector<AsyncServiceClient<ChangeState>::ResponseFuture> futures;
+    for (const auto & node_name : node_names) {
+      clients.push_back(
+        std::make_unique<AsyncServiceClient<ChangeState>>(node_name + "/change_state", node));
+      auto request = std::make_shared<ChangeState::Request>();
+      request->transition.id = transition;
+      futures.push_back(clients.back()->async_invoke(request));
+    }
+
+    // the responses that did come are dropped with the clients
+    result = wait_for_all(futures, timeout);
+    for (size_t i = 0; result && i < futures.size(); i++) {
+      result = futures[i].get()->success;
+    }
+  }
+
+  ExecutorPool::get().remove_node(node->get_node_base_interface());
+  return result;
+}
+
 }  // namespace nav2_util
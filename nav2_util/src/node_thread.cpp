@@ -19,23 +19,16 @@
 namespace nav2_util
 {
 
-NodeThread::NodeThread(rclcpp::node_interfaces::NodeBaseInterface::SharedPtr node_base)
+NodeThread::NodeThread(
+  rclcpp::node_interfaces::NodeBaseInterface::SharedPtr node_base, bool dedicated)
 : node_(node_base)
 {
-  thread_ = std::make_unique<std::thread>(
-    [&]()
-    {
-      executor_.add_node(node_);
-      executor_.spin();
-      executor_.remove_node(node_);
-    });
+  ExecutorPool::get().add_node(node_, dedicated);
 }
 
-
 NodeThread::~NodeThread()
 {
-  executor_.cancel();
-  thread_->join();
+  ExecutorPool::get().remove_node(node_);
 }
 
 }  // namespace nav2_util
@@ -98,4 +98,18 @@ get_node_options_default(bool allow_undeclared, bool declare_initial_params)
   return options;
 }
 
+rclcpp::PublisherOptions get_inter_process_publisher_options()
+{
+  rclcpp::PublisherOptions options;
+  options.use_intra_process_comm = rclcpp::IntraProcessSetting::Disable;
+  return options;
+}
+
+rclcpp::SubscriptionOptions get_inter_process_subscription_options()
+{
+  rclcpp::SubscriptionOptions options;
+  options.use_intra_process_comm = rclcpp::IntraProcessSetting::Disable;
+  return options;
+}
+
 }  // namespace nav2_util
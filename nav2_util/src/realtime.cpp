@@ -0,0 +1,73 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+
+#include "nav2_util/realtime.hpp"
+
+namespace nav2_util
+{
+
+bool apply_realtime_settings(const RealtimeSettings & settings, std::string & error)
+{
+  error.clear();
+  auto fail = [&](const std::string & what, int err) {
+      if (!error.empty()) {
+        error += "; ";
+      }
+      error += what + ": " + std::strerror(err);
+    };
+
+  if (settings.priority != 0) {
+    sched_param param{};
+    param.sched_priority = settings.priority;
+    int ret = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (ret != 0) {
+      fail("SCHED_FIFO priority " + std::to_string(settings.priority), ret);
+    }
+  }
+
+  if (!settings.cpu_affinity.empty()) {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    bool valid = true;
+    for (int cpu : settings.cpu_affinity) {
+      if (cpu < 0 || cpu >= CPU_SETSIZE) {
+        fail("CPU " + std::to_string(cpu), EINVAL);
+        valid = false;
+        break;
+      }
+      CPU_SET(cpu, &cpus);
+    }
+    if (valid) {
+      int ret = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+      if (ret != 0) {
+        fail("CPU affinity", ret);
+      }
+    }
+  }
+
+  if (settings.lock_memory && mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+    fail("Locking memory", errno);
+  }
+
+  return error.empty();
+}
+
+}  // namespace nav2_util
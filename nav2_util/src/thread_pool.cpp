@@ -0,0 +1,193 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_util/thread_pool.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <vector>
+
+namespace nav2_util
+{
+
+ThreadPool::ThreadPool(unsigned int num_threads)
+{
+  if (num_threads == 0) {
+    num_threads = std::thread::hardware_concurrency();
+  }
+
+  // The calling thread of parallel_for() is one of the workers
+  for (unsigned int i = 1; i < num_threads; ++i) {
+    workers_.emplace_back(&ThreadPool::worker, this);
+  }
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shutdown_ = true;
+  }
+  work_cv_.notify_all();
+  for (auto & thread : workers_) {
+    thread.join();
+  }
+}
+
+void
+ThreadPool::parallel_for(std::size_t count, const std::function<void(std::size_t)> & task)
+{
+  if (count == 0) {
+    return;
+  }
+
+  // Not worth waking anyone up
+  if (workers_.empty() || count == 1) {
+    for (std::size_t i = 0; i < count; ++i) {
+      task(i);
+    }
+    return;
+  }
+
+  std::lock_guard<std::mutex> caller_lock(caller_mutex_);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    task_ = &task;
+    count_ = count;
+    next_ = 0;
+    error_ = nullptr;
+    busy_workers_ = static_cast<unsigned int>(workers_.size());
+    ++generation_;
+  }
+  work_cv_.notify_all();
+
+  run_tasks();
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_cv_.wait(lock, [this] {return busy_workers_ == 0;});
+  task_ = nullptr;
+
+  if (error_) {
+    std::exception_ptr error = error_;
+    error_ = nullptr;
+    std::rethrow_exception(error);
+  }
+}
+
+void
+ThreadPool::worker()
+{
+  unsigned int seen_generation = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      work_cv_.wait(lock, [&] {return shutdown_ || generation_ != seen_generation;});
+      if (shutdown_) {
+        return;
+      }
+      seen_generation = generation_;
+    }
+
+    run_tasks();
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      --busy_workers_;
+    }
+    done_cv_.notify_one();
+  }
+}
+
+void
+ThreadPool::run_tasks()
+{
+  // task_ and count_ are only written while no worker is busy
+  for (std::size_t i = next_++; i < count_; i = next_++) {
+    try {
+      (*task_)(i);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!error_) {
+        error_ = std::current_exception();
+      }
+    }
+  }
+}
+
+std::vector<std::chrono::nanoseconds>
+run_staged_tasks(
+  ThreadPool * pool, const std::vector<std::function<void()>> & tasks,
+  const std::vector<std::vector<std::size_t>> & after)
+{
+  if (!after.empty() && after.size() != tasks.size()) {
+    throw std::invalid_argument("run_staged_tasks: a list of tasks to follow per task needed");
+  }
+
+  // the stage of a task is one past the latest stage of those it follows
+  const std::size_t unstaged = tasks.size();
+  std::vector<std::size_t> stages(tasks.size(), after.empty() ? 0 : unstaged);
+  std::size_t num_stages = tasks.empty() ? 0 : 1;
+  for (bool progress = true; progress; ) {
+    progress = false;
+    for (std::size_t i = 0; i < stages.size(); ++i) {
+      if (stages[i] != unstaged) {
+        continue;
+      }
+      std::size_t stage = 0;
+      for (std::size_t previous : after[i]) {
+        if (previous >= tasks.size()) {
+          throw std::invalid_argument("run_staged_tasks: no task to follow at that index");
+        }
+        if (stages[previous] == unstaged) {
+          stage = unstaged;
+          break;
+        }
+        stage = std::max(stage, stages[previous] + 1);
+      }
+      if (stage != unstaged) {
+        stages[i] = stage;
+        num_stages = std::max(num_stages, stage + 1);
+        progress = true;
+      }
+    }
+  }
+
+  std::vector<std::vector<std::size_t>> staged(num_stages);
+  for (std::size_t i = 0; i < stages.size(); ++i) {
+    if (stages[i] == unstaged) {
+      throw std::invalid_argument("run_staged_tasks: tasks follow each other in a cycle");
+    }
+    staged[stages[i]].push_back(i);
+  }
+
+  std::vector<std::chrono::nanoseconds> durations(tasks.size());
+  for (const std::vector<std::size_t> & stage : staged) {
+    auto run = [&](std::size_t i) {
+        auto start = std::chrono::steady_clock::now();
+        tasks[stage[i]]();
+        durations[stage[i]] = std::chrono::steady_clock::now() - start;
+      };
+    if (pool) {
+      pool->parallel_for(stage.size(), run);
+    } else {
+      for (std::size_t i = 0; i < stage.size(); ++i) {
+        run(i);
+      }
+    }
+  }
+  return durations;
+}
+
+}  // namespace nav2_util
@@ -0,0 +1,196 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_util/trace.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+namespace nav2_util
+{
+namespace trace
+{
+
+namespace
+{
+
+std::atomic<bool> & enabled_flag()
+{
+  static std::atomic<bool> flag{std::getenv(FILE_ENV_VAR) != nullptr};
+  return flag;
+}
+
+std::size_t capacity_from_environment()
+{
+  const char * value = std::getenv(CAPACITY_ENV_VAR);
+  if (value != nullptr) {
+    try {
+      unsigned long capacity = std::stoul(value);  // NOLINT(runtime/int)
+      if (capacity > 0) {
+        return capacity;
+      }
+    } catch (const std::exception &) {
+    }
+  }
+  return DEFAULT_CAPACITY;
+}
+
+// The file the trace of this process is written to, with any %p replaced by its id
+std::string filename_from_environment()
+{
+  const char * value = std::getenv(FILE_ENV_VAR);
+  if (value == nullptr) {
+    return "";
+  }
+  std::string filename(value);
+  std::size_t pid = filename.find("%p");
+  if (pid != std::string::npos) {
+    filename.replace(pid, 2, std::to_string(getpid()));
+  }
+  return filename;
+}
+
+const char * type_name(EventType type)
+{
+  switch (type) {
+    case EventType::SCOPE:
+      return "scope";
+    case EventType::LOCK_WAIT:
+      return "lock_wait";
+  }
+  return "unknown";
+}
+
+}  // namespace
+
+bool enabled()
+{
+  return enabled_flag().load(std::memory_order_relaxed);
+}
+
+void set_enabled(bool enabled)
+{
+  enabled_flag().store(enabled, std::memory_order_relaxed);
+}
+
+uint64_t now_ns()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint32_t thread_index()
+{
+  static std::atomic<uint32_t> next_index{0};
+  thread_local uint32_t index = next_index++;
+  return index;
+}
+
+TraceBuffer & TraceBuffer::get()
+{
+  // Written out when the process exits, after everything that could record has stopped
+  struct ProcessBuffer
+  {
+    ProcessBuffer()
+    : buffer(capacity_from_environment())
+    {
+    }
+
+    ~ProcessBuffer()
+    {
+      std::string filename = filename_from_environment();
+      if (!filename.empty()) {
+        buffer.write_csv(filename);
+      }
+    }
+
+    TraceBuffer buffer;
+  };
+
+  static ProcessBuffer process;
+  return process.buffer;
+}
+
+TraceBuffer::TraceBuffer(std::size_t capacity)
+: capacity_(std::max<std::size_t>(capacity, 1)),
+  slots_(new Slot[capacity_])
+{
+}
+
+TraceBuffer::~TraceBuffer()
+{
+}
+
+void TraceBuffer::record(const Event & event)
+{
+  uint64_t index = next_.fetch_add(1, std::memory_order_relaxed);
+  Slot & slot = slots_[index % capacity_];
+  slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.event = event;
+  slot.sequence.store(2 * index + 2, std::memory_order_release);
+}
+
+std::vector<Event> TraceBuffer::snapshot() const
+{
+  std::vector<std::pair<uint64_t, Event>> events;
+  events.reserve(capacity_);
+  for (std::size_t i = 0; i < capacity_; ++i) {
+    const Slot & slot = slots_[i];
+    uint64_t before = slot.sequence.load(std::memory_order_acquire);
+    if (before == 0 || before % 2 == 1) {
+      continue;  // Never written, or being written
+    }
+    Event event = slot.event;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.sequence.load(std::memory_order_relaxed) != before) {
+      continue;  // Overwritten while it was copied
+    }
+    events.emplace_back(before, event);
+  }
+
+  std::sort(
+    events.begin(), events.end(),
+    [](const std::pair<uint64_t, Event> & a, const std::pair<uint64_t, Event> & b) {
+      return a.first < b.first;
+    });
+  std::vector<Event> ordered;
+  ordered.reserve(events.size());
+  for (auto & event : events) {
+    ordered.push_back(event.second);
+  }
+  return ordered;
+}
+
+bool TraceBuffer::write_csv(const std::string & filename) const
+{
+  std::ofstream file(filename);
+  file << "name,type,thread,start_ns,duration_ns\n";
+  for (const Event & event : snapshot()) {
+    file << event.name << ',' << type_name(event.type) << ',' << event.thread << ',' <<
+      event.start_ns << ',' << event.duration_ns << '\n';
+  }
+  return static_cast<bool>(file);
+}
+
+}  // namespace trace
+}  // namespace nav2_util
@@ -45,7 +45,14 @@ public:
     action_server_ = std::make_shared<nav2_util::SimpleActionServer<Fibonacci>>(
       shared_from_this(),
       "fibonacci",
-      std::bind(&FibonacciServerNode::execute, this));
+      std::bind(&FibonacciServerNode::execute, this, std::ref(action_server_)));
+
+    // The same, run on a worker thread kept between goals
+    persistent_action_server_ = std::make_shared<nav2_util::SimpleActionServer<Fibonacci>>(
+      shared_from_this(),
+      "fibonacci_persistent",
+      std::bind(&FibonacciServerNode::execute, this, std::ref(persistent_action_server_)),
+      true, std::chrono::milliseconds(500), true, true);
 
     deactivate_subs_ = create_subscription<std_msgs::msg::Empty>(
       "deactivate_server",
@@ -53,6 +60,7 @@ public:
       [this](std_msgs::msg::Empty::UniquePtr /*msg*/) {
         RCLCPP_INFO(this->get_logger(), "Deactivating");
         action_server_->deactivate();
+        persistent_action_server_->deactivate();
       });
 
     activate_subs_ = create_subscription<std_msgs::msg::Empty>(
@@ -61,6 +69,7 @@ public:
       [this](std_msgs::msg::Empty::UniquePtr /*msg*/) {
         RCLCPP_INFO(this->get_logger(), "Activating");
         action_server_->activate();
+        persistent_action_server_->activate();
       });
 
     omit_preempt_subs_ = create_subscription<std_msgs::msg::Empty>(
@@ -75,15 +84,16 @@ public:
   void on_term()
   {
     action_server_.reset();
+    persistent_action_server_.reset();
   }
 
-  void execute()
+  void execute(std::shared_ptr<nav2_util::SimpleActionServer<Fibonacci>> & action_server)
   {
     rclcpp::Rate loop_rate(10);
 
 preempted:
     // Initialize the goal, feedback, and result
-    auto goal = action_server_->get_current_goal();
+    auto goal = action_server->get_current_goal();
     auto feedback = std::make_shared<Fibonacci::Feedback>();
     auto result = std::make_shared<Fibonacci::Result>();
 
@@ -95,14 +105,14 @@ preempted:
     for (int i = 1; (i < goal->order) && rclcpp::ok(); ++i) {
       // Should be check periodically if this action has been canceled
       // or if the server has been deactivated.
-      if (action_server_->is_cancel_requested() || !action_server_->is_server_active()) {
+      if (action_server->is_cancel_requested() || !action_server->is_server_active()) {
         result->sequence = sequence;
         return;
       }
 
       // Check if we've gotten an new goal, pre-empting the current one
-      if (do_premptions_ && action_server_->is_preempt_requested()) {
-        action_server_->accept_pending_goal();
+      if (do_premptions_ && action_server->is_preempt_requested()) {
+        action_server->accept_pending_goal();
         goto preempted;
       }
 
@@ -110,19 +120,20 @@ preempted:
       sequence.push_back(sequence[i] + sequence[i - 1]);
 
       // Publish feedback
-      action_server_->publish_feedback(feedback);
+      action_server->publish_feedback(feedback);
       loop_rate.sleep();
     }
 
     // Check if goal is done
     if (rclcpp::ok()) {
       result->sequence = sequence;
-      action_server_->succeeded_current(result);
+      action_server->succeeded_current(result);
     }
   }
 
 private:
   std::shared_ptr<nav2_util::SimpleActionServer<Fibonacci>> action_server_;
+  std::shared_ptr<nav2_util::SimpleActionServer<Fibonacci>> persistent_action_server_;
   rclcpp::Subscription<std_msgs::msg::Empty>::SharedPtr deactivate_subs_;
   rclcpp::Subscription<std_msgs::msg::Empty>::SharedPtr activate_subs_;
   rclcpp::Subscription<std_msgs::msg::Empty>::SharedPtr omit_preempt_subs_;
@@ -174,6 +185,9 @@ public:
   {
     action_client_ = rclcpp_action::create_client<Fibonacci>(shared_from_this(), "fibonacci");
     action_client_->wait_for_action_server();
+    persistent_action_client_ =
+      rclcpp_action::create_client<Fibonacci>(shared_from_this(), "fibonacci_persistent");
+    persistent_action_client_->wait_for_action_server();
 
     deactivate_pub_ = this->create_publisher<std_msgs::msg::Empty>("deactivate_server", 1);
     activate_pub_ = this->create_publisher<std_msgs::msg::Empty>("activate_server", 1);
@@ -183,6 +197,7 @@ public:
   void on_term()
   {
     action_client_.reset();
+    persistent_action_client_.reset();
   }
 
   void deactivate_server()
@@ -201,6 +216,7 @@ public:
   }
 
   rclcpp_action::Client<Fibonacci>::SharedPtr action_client_;
+  rclcpp_action::Client<Fibonacci>::SharedPtr persistent_action_client_;
   rclcpp::Publisher<std_msgs::msg::Empty>::SharedPtr deactivate_pub_;
   rclcpp::Publisher<std_msgs::msg::Empty>::SharedPtr activate_pub_;
   rclcpp::Publisher<std_msgs::msg::Empty>::SharedPtr omit_prempt_pub_;
@@ -421,6 +437,56 @@ TEST_F(ActionTest, test_simple_action_preemption)
   SUCCEED();
 }
 
+TEST_F(ActionTest, test_persistent_worker)
+{
+  auto & client = node_->persistent_action_client_;
+
+  // A long goal, preempted by a short one
+  auto goal = Fibonacci::Goal();
+  goal.order = 12'000'000;
+  auto future_goal_handle = client->async_send_goal(goal);
+  EXPECT_EQ(
+    rclcpp::spin_until_future_complete(node_, future_goal_handle),
+    rclcpp::executor::FutureReturnCode::SUCCESS);
+
+  auto preemption_goal = Fibonacci::Goal();
+  preemption_goal.order = 1;
+  future_goal_handle = client->async_send_goal(preemption_goal);
+  EXPECT_EQ(
+    rclcpp::spin_until_future_complete(node_, future_goal_handle),
+    rclcpp::executor::FutureReturnCode::SUCCESS);
+
+  auto future_result = client->async_get_result(future_goal_handle.get());
+  EXPECT_EQ(
+    rclcpp::spin_until_future_complete(node_, future_result),
+    rclcpp::executor::FutureReturnCode::SUCCESS);
+  auto result = future_result.get();
+  EXPECT_EQ(result.code, rclcpp_action::ResultCode::SUCCEEDED);
+  EXPECT_EQ(result.result->sequence.size(), 2u);
+
+  // Goals one after the other, all run by the same worker
+  for (int i = 0; i < 3; ++i) {
+    goal.order = 12;
+    future_goal_handle = client->async_send_goal(goal);
+    EXPECT_EQ(
+      rclcpp::spin_until_future_complete(node_, future_goal_handle),
+      rclcpp::executor::FutureReturnCode::SUCCESS);
+
+    future_result = client->async_get_result(future_goal_handle.get());
+    EXPECT_EQ(
+      rclcpp::spin_until_future_complete(node_, future_result),
+      rclcpp::executor::FutureReturnCode::SUCCESS);
+    result = future_result.get();
+    EXPECT_EQ(result.code, rclcpp_action::ResultCode::SUCCEEDED);
+
+    int sum = 0;
+    for (auto number : result.result->sequence) {
+      sum += number;
+    }
+    EXPECT_EQ(sum, 376);
+  }
+}
+
 TEST_F(ActionTest, test_simple_action_preemption_after_succeeded)
 {
   // Test race condition between successfully completing an action and receiving a preemption.
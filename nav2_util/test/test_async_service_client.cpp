@@ -0,0 +1,109 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "nav2_util/async_service_client.hpp"
+#include "nav2_util/executor_pool.hpp"
+#include "rclcpp/rclcpp.hpp"
+#include "std_srvs/srv/empty.hpp"
+#include "gtest/gtest.h"
+
+using nav2_util::AsyncServiceClient;
+using nav2_util::ExecutorPool;
+using std_srvs::srv::Empty;
+using namespace std::chrono_literals;
+
+class RclCppFixture
+{
+public:
+  RclCppFixture() {rclcpp::init(0, nullptr);}
+  ~RclCppFixture() {rclcpp::shutdown();}
+};
+RclCppFixture g_rclcppfixture;
+
+// A server for the Empty service, spun by the pool
+class EmptyServer
+{
+public:
+  explicit EmptyServer(const std::string & service_name)
+  : node_(rclcpp::Node::make_shared("empty_server"))
+  {
+    service_ = node_->create_service<Empty>(
+      service_name,
+      [this](const std::shared_ptr<Empty::Request>, std::shared_ptr<Empty::Response>) {
+        ++calls;
+      });
+    ExecutorPool::get().add_node(node_->get_node_base_interface());
+  }
+
+  ~EmptyServer()
+  {
+    ExecutorPool::get().remove_node(node_->get_node_base_interface());
+  }
+
+  std::atomic<int> calls{0};
+
+protected:
+  rclcpp::Node::SharedPtr node_;
+  rclcpp::Service<Empty>::SharedPtr service_;
+};
+
+TEST(AsyncServiceClient, responds_when_service_is_up)
+{
+  EmptyServer server("async_empty");
+  AsyncServiceClient<Empty> client("async_empty");
+
+  std::atomic<int> callbacks{0};
+  std::vector<AsyncServiceClient<Empty>::ResponseFuture> futures;
+  for (int i = 0; i < 3; ++i) {
+    futures.push_back(
+      client.async_invoke(
+        std::make_shared<Empty::Request>(), [&callbacks](Empty::Response::SharedPtr) {
+          ++callbacks;
+        }));
+  }
+
+  ASSERT_TRUE(nav2_util::wait_for_all(futures, 10s));
+  EXPECT_EQ(server.calls, 3);
+  // the callback may still be returning as the future is set
+  for (int i = 0; i < 100 && callbacks < 3; ++i) {
+    std::this_thread::sleep_for(10ms);
+  }
+  EXPECT_EQ(callbacks, 3);
+}
+
+TEST(AsyncServiceClient, holds_requests_until_service_appears)
+{
+  AsyncServiceClient<Empty> client("async_late");
+  auto future = client.async_invoke(std::make_shared<Empty::Request>());
+  EXPECT_EQ(future.wait_for(200ms), std::future_status::timeout);
+
+  EmptyServer server("async_late");
+  EXPECT_EQ(future.wait_for(10s), std::future_status::ready);
+  EXPECT_EQ(server.calls, 1);
+}
+
+TEST(AsyncServiceClient, times_out_without_service)
+{
+  AsyncServiceClient<Empty> client("async_missing");
+  std::vector<AsyncServiceClient<Empty>::ResponseFuture> futures;
+  futures.push_back(client.async_invoke(std::make_shared<Empty::Request>()));
+  EXPECT_FALSE(nav2_util::wait_for_all(futures, 100ms));
+}
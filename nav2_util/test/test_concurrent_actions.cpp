@@ -0,0 +1,194 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "nav2_util/node_utils.hpp"
+#include "nav2_util/concurrent_action_server.hpp"
+#include "test_msgs/action/fibonacci.hpp"
+
+using Fibonacci = test_msgs::action::Fibonacci;
+using GoalHandle = rclcpp_action::ServerGoalHandle<Fibonacci>;
+
+using namespace std::chrono_literals;
+
+class FibonacciServerNode : public rclcpp::Node
+{
+public:
+  FibonacciServerNode()
+  : rclcpp::Node("concurrent_fibonacci_server_node")
+  {
+  }
+
+  void on_init()
+  {
+    action_server_ = std::make_shared<nav2_util::ConcurrentActionServer<Fibonacci>>(
+      shared_from_this(),
+      "concurrent_fibonacci",
+      [this](const std::shared_ptr<GoalHandle> & handle, unsigned int) {execute(handle);},
+      2);
+  }
+
+  void on_term()
+  {
+    action_server_.reset();
+  }
+
+  // Goals of order 0 wait to run alongside another one, and fail if they don't
+  void execute(const std::shared_ptr<GoalHandle> & handle)
+  {
+    auto goal = handle->get_goal();
+    auto result = std::make_shared<Fibonacci::Result>();
+
+    if (goal->order == 0) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      ++waiting_;
+      cv_.notify_all();
+      if (cv_.wait_for(lock, 5s, [this]() {return waiting_ >= 2;})) {
+        handle->succeed(result);
+      }
+      return;
+    }
+
+    auto & sequence = result->sequence;
+    sequence.push_back(0);
+    sequence.push_back(1);
+    rclcpp::Rate loop_rate(10);
+    for (int i = 1; (i < goal->order) && rclcpp::ok(); ++i) {
+      if (handle->is_canceling()) {
+        handle->canceled(result);
+        return;
+      }
+      sequence.push_back(sequence[i] + sequence[i - 1]);
+      loop_rate.sleep();
+    }
+    handle->succeed(result);
+  }
+
+private:
+  std::shared_ptr<nav2_util::ConcurrentActionServer<Fibonacci>> action_server_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  int waiting_{0};
+};
+
+class RclCppFixture
+{
+public:
+  void Setup()
+  {
+    server_thread_ =
+      std::make_shared<std::thread>(std::bind(&RclCppFixture::server_thread_func, this));
+  }
+
+  ~RclCppFixture()
+  {
+    server_thread_->join();
+  }
+
+  void server_thread_func()
+  {
+    auto node = std::make_shared<FibonacciServerNode>();
+    node->on_init();
+    rclcpp::spin(node->get_node_base_interface());
+    node->on_term();
+    node.reset();
+  }
+
+  std::shared_ptr<std::thread> server_thread_;
+};
+
+RclCppFixture g_rclcppfixture;
+
+class ConcurrentActionTest : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    node_ = std::make_shared<rclcpp::Node>(
+      nav2_util::generate_internal_node_name("concurrent_action_test_node"));
+    action_client_ = rclcpp_action::create_client<Fibonacci>(node_, "concurrent_fibonacci");
+    action_client_->wait_for_action_server();
+  }
+
+  void TearDown() override
+  {
+    action_client_.reset();
+    node_.reset();
+  }
+
+  rclcpp_action::ClientGoalHandle<Fibonacci>::SharedPtr sendGoal(int order)
+  {
+    auto goal = Fibonacci::Goal();
+    goal.order = order;
+    auto future_goal_handle = action_client_->async_send_goal(goal);
+    EXPECT_EQ(
+      rclcpp::spin_until_future_complete(node_, future_goal_handle),
+      rclcpp::executor::FutureReturnCode::SUCCESS);
+    return future_goal_handle.get();
+  }
+
+  rclcpp_action::ResultCode getResultCode(
+    rclcpp_action::ClientGoalHandle<Fibonacci>::SharedPtr goal_handle)
+  {
+    auto future_result = action_client_->async_get_result(goal_handle);
+    EXPECT_EQ(
+      rclcpp::spin_until_future_complete(node_, future_result),
+      rclcpp::executor::FutureReturnCode::SUCCESS);
+    return future_result.get().code;
+  }
+
+  rclcpp::Node::SharedPtr node_;
+  rclcpp_action::Client<Fibonacci>::SharedPtr action_client_;
+};
+
+TEST_F(ConcurrentActionTest, test_goals_run_concurrently)
+{
+  // Each of these only succeeds once the other one is executing too
+  auto first = sendGoal(0);
+  auto second = sendGoal(0);
+
+  EXPECT_EQ(getResultCode(first), rclcpp_action::ResultCode::SUCCEEDED);
+  EXPECT_EQ(getResultCode(second), rclcpp_action::ResultCode::SUCCEEDED);
+}
+
+TEST_F(ConcurrentActionTest, test_cancel_one_goal)
+{
+  auto canceled = sendGoal(30);
+  auto finished = sendGoal(5);
+
+  auto future_cancel = action_client_->async_cancel_goal(canceled);
+  EXPECT_EQ(
+    rclcpp::spin_until_future_complete(node_, future_cancel),
+    rclcpp::executor::FutureReturnCode::SUCCESS);
+
+  EXPECT_EQ(getResultCode(canceled), rclcpp_action::ResultCode::CANCELED);
+  EXPECT_EQ(getResultCode(finished), rclcpp_action::ResultCode::SUCCEEDED);
+}
+
+int main(int argc, char ** argv)
+{
+  rclcpp::init(argc, argv);
+  g_rclcppfixture.Setup();
+  ::testing::InitGoogleTest(&argc, argv);
+  auto result = RUN_ALL_TESTS();
+  rclcpp::shutdown();
+  rclcpp::Rate(1).sleep();
+  return result;
+}
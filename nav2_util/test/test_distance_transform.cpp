@@ -0,0 +1,68 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+#include "nav2_util/distance_transform.hpp"
+#include "gtest/gtest.h"
+
+using nav2_util::NO_SEED;
+
+TEST(DistanceTransform, MatchesBruteForce)
+{
+  const int size_x = 97;
+  const int size_y = 61;
+  nav2_util::ThreadPool pool(3);
+  std::srand(7);
+
+  std::vector<int64_t> grid(size_x * size_y);
+  std::vector<std::pair<int, int>> seeds;
+  for (int j = 0; j < size_y; j++) {
+    for (int i = 0; i < size_x; i++) {
+      bool seed = std::rand() % 211 == 0;
+      grid[j * size_x + i] = seed ? 0 : NO_SEED;
+      if (seed) {
+        seeds.emplace_back(i, j);
+      }
+    }
+  }
+  ASSERT_FALSE(seeds.empty());
+
+  nav2_util::squaredDistanceTransform(grid.data(), size_x, size_y, pool);
+
+  for (int j = 0; j < size_y; j++) {
+    for (int i = 0; i < size_x; i++) {
+      int64_t best = NO_SEED;
+      for (const auto & seed : seeds) {
+        int64_t dx = i - seed.first;
+        int64_t dy = j - seed.second;
+        best = std::min(best, dx * dx + dy * dy);
+      }
+      ASSERT_EQ(grid[j * size_x + i], best) << "at " << i << ", " << j;
+    }
+  }
+}
+
+TEST(DistanceTransform, NoSeeds)
+{
+  nav2_util::ThreadPool pool(2);
+  std::vector<int64_t> grid(20 * 10, NO_SEED);
+  nav2_util::squaredDistanceTransform(grid.data(), 20, 10, pool);
+  for (auto distance : grid) {
+    EXPECT_EQ(distance, NO_SEED);
+  }
+}
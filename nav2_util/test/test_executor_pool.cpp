@@ -0,0 +1,150 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "nav2_util/executor_pool.hpp"
+#include "nav2_util/node_thread.hpp"
+#include "rclcpp/rclcpp.hpp"
+
+using namespace std::chrono_literals;
+
+class RclCppFixture
+{
+public:
+  RclCppFixture() {rclcpp::init(0, nullptr);}
+  ~RclCppFixture() {rclcpp::shutdown();}
+};
+RclCppFixture g_rclcppfixture;
+
+// A node with a timer counting its calls, which can be made to take a while
+class CountingNode
+{
+public:
+  explicit CountingNode(const std::string & name, std::chrono::milliseconds work = 0ms)
+  : node(std::make_shared<rclcpp::Node>(name))
+  {
+    timer = node->create_wall_timer(
+      5ms, [this, work]() {
+        running = true;
+        std::this_thread::sleep_for(work);
+        calls++;
+        running = false;
+      });
+  }
+
+  rclcpp::Node::SharedPtr node;
+  rclcpp::TimerBase::SharedPtr timer;
+  std::atomic<int> calls{0};
+  std::atomic<bool> running{false};
+};
+
+TEST(ExecutorPool, NodesShareThreads)
+{
+  nav2_util::ExecutorPool pool(1);
+  CountingNode first("first"), second("second"), third("third");
+  pool.add_node(first.node->get_node_base_interface());
+  pool.add_node(second.node->get_node_base_interface());
+  pool.add_node(third.node->get_node_base_interface());
+  EXPECT_EQ(pool.num_running_threads(), 1u);
+
+  std::this_thread::sleep_for(200ms);
+  EXPECT_GT(first.calls.load(), 0);
+  EXPECT_GT(second.calls.load(), 0);
+  EXPECT_GT(third.calls.load(), 0);
+
+  pool.remove_node(first.node->get_node_base_interface());
+  pool.remove_node(second.node->get_node_base_interface());
+  pool.remove_node(third.node->get_node_base_interface());
+}
+
+TEST(ExecutorPool, ThreadsStartAsNeeded)
+{
+  nav2_util::ExecutorPool pool(2);
+  EXPECT_EQ(pool.num_running_threads(), 0u);
+
+  CountingNode first("first"), second("second"), third("third");
+  pool.add_node(first.node->get_node_base_interface());
+  EXPECT_EQ(pool.num_running_threads(), 1u);
+  pool.add_node(second.node->get_node_base_interface());
+  EXPECT_EQ(pool.num_running_threads(), 2u);
+  pool.add_node(third.node->get_node_base_interface());
+  EXPECT_EQ(pool.num_running_threads(), 2u);
+
+  EXPECT_THROW(pool.add_node(first.node->get_node_base_interface()), std::runtime_error);
+
+  pool.remove_node(first.node->get_node_base_interface());
+  pool.remove_node(second.node->get_node_base_interface());
+  pool.remove_node(third.node->get_node_base_interface());
+}
+
+TEST(ExecutorPool, DedicatedThreads)
+{
+  nav2_util::ExecutorPool pool(1);
+  CountingNode shared("shared"), slow("slow", 100ms);
+  pool.add_node(shared.node->get_node_base_interface());
+  pool.add_node(slow.node->get_node_base_interface(), true);
+  EXPECT_EQ(pool.num_running_threads(), 2u);
+
+  // The slow node's callbacks don't hold up the shared thread
+  std::this_thread::sleep_for(300ms);
+  EXPECT_GT(shared.calls.load(), 20);
+  EXPECT_GT(slow.calls.load(), 0);
+
+  pool.remove_node(slow.node->get_node_base_interface());
+  EXPECT_EQ(pool.num_running_threads(), 1u);
+  pool.remove_node(shared.node->get_node_base_interface());
+}
+
+TEST(ExecutorPool, RemovingWaitsForCallbacks)
+{
+  nav2_util::ExecutorPool pool(1);
+  CountingNode slow("slow", 50ms), other("other");
+  pool.add_node(slow.node->get_node_base_interface());
+  pool.add_node(other.node->get_node_base_interface());
+
+  while (!slow.running) {
+    std::this_thread::sleep_for(1ms);
+  }
+  pool.remove_node(slow.node->get_node_base_interface());
+  EXPECT_FALSE(slow.running.load());
+
+  // The node isn't spun anymore, while the one left is
+  int calls = slow.calls;
+  int other_calls = other.calls;
+  std::this_thread::sleep_for(100ms);
+  EXPECT_EQ(slow.calls.load(), calls);
+  EXPECT_GT(other.calls.load(), other_calls);
+
+  pool.remove_node(other.node->get_node_base_interface());
+}
+
+TEST(ExecutorPool, NodeThreadUsesTheProcessPool)
+{
+  CountingNode counting("counting");
+  {
+    nav2_util::NodeThread thread(counting.node);
+    std::this_thread::sleep_for(100ms);
+  }
+  int calls = counting.calls;
+  EXPECT_GT(calls, 0);
+  std::this_thread::sleep_for(50ms);
+  EXPECT_EQ(counting.calls.load(), calls);
+}
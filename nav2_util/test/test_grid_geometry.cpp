@@ -0,0 +1,72 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "nav2_util/grid_geometry.hpp"
+#include "nav2_util/line_iterator.hpp"
+#include "gtest/gtest.h"
+
+struct Point
+{
+  double x, y;
+};
+
+TEST(GridGeometry, SpansCoverTheLineCells)
+{
+  const int ends[][4] = {{0, 0, 9, 3}, {9, 3, 0, 0}, {2, 1, 4, 12}, {5, 5, 5, 5}, {7, 0, -6, -2}};
+  for (const auto & end : ends) {
+    std::vector<std::pair<int, int>> cells;
+    for (nav2_util::LineIterator line(end[0], end[1], end[2], end[3]); line.isValid();
+      line.advance())
+    {
+      cells.emplace_back(line.getY(), line.getX());
+    }
+
+    std::vector<std::pair<int, int>> spans;
+    nav2_util::traceLineSpans(
+      end[0], end[1], end[2], end[3], [&](int y, int x_min, int x_max) {
+        EXPECT_LE(x_min, x_max);
+        for (int x = x_min; x <= x_max; ++x) {
+          spans.emplace_back(y, x);
+        }
+      });
+
+    std::sort(cells.begin(), cells.end());
+    std::sort(spans.begin(), spans.end());
+    EXPECT_EQ(cells, spans);
+  }
+}
+
+TEST(GridGeometry, WorldToMapFindsEveryCell)
+{
+  const double origin_x = -1.0, origin_y = 2.0, resolution = 0.05;
+  std::vector<Point> points = {{-1.0, 2.0}, {-0.97, 2.49}, {0.4999, 2.1}, {0.0, 2.0}};
+  std::vector<std::pair<int, int>> cells;
+  EXPECT_TRUE(nav2_util::worldToMap(points, origin_x, origin_y, resolution, 30, 20, cells));
+  ASSERT_EQ(cells.size(), points.size());
+  for (std::size_t i = 0; i < points.size(); ++i) {
+    EXPECT_EQ(cells[i].first, static_cast<int>((points[i].x - origin_x) / resolution));
+    EXPECT_EQ(cells[i].second, static_cast<int>((points[i].y - origin_y) / resolution));
+  }
+
+  // off each side of the grid
+  for (const Point & off : std::vector<Point>{{-1.01, 2.1}, {0.5, 2.1}, {0.0, 1.99}, {0.0, 3.0}}) {
+    points.push_back(off);
+    EXPECT_FALSE(nav2_util::worldToMap(points, origin_x, origin_y, resolution, 30, 20, cells));
+    points.pop_back();
+  }
+}
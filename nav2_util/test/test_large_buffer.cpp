@@ -0,0 +1,61 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdint>
+#include <cstring>
+
+#include "nav2_util/large_buffer.hpp"
+#include "gtest/gtest.h"
+
+using nav2_util::allocate_large_buffer;
+using nav2_util::free_large_buffer;
+using nav2_util::large_buffer_capacity;
+using nav2_util::reallocate_large_buffer;
+
+TEST(LargeBuffer, AlignedAndWritable)
+{
+  // from the heap, and mapped on their own
+  for (std::size_t bytes : {1ul, 1000ul, 2ul << 20, 9ul << 20}) {
+    auto buffer = static_cast<unsigned char *>(allocate_large_buffer(bytes));
+    ASSERT_NE(buffer, nullptr);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(buffer) % nav2_util::kLargeBufferAlignment, 0u);
+    EXPECT_GE(large_buffer_capacity(buffer), bytes);
+    std::memset(buffer, 0xab, bytes);
+    EXPECT_EQ(buffer[bytes - 1], 0xab);
+    free_large_buffer(buffer);
+  }
+  free_large_buffer(nullptr);
+}
+
+TEST(LargeBuffer, ReusedWhenLargeEnough)
+{
+  void * buffer = allocate_large_buffer(8ul << 20);
+
+  // a little smaller or larger within the capacity keeps the buffer
+  EXPECT_EQ(reallocate_large_buffer(buffer, 7ul << 20), buffer);
+  EXPECT_EQ(reallocate_large_buffer(buffer, large_buffer_capacity(buffer)), buffer);
+
+  // much smaller or larger replaces it
+  void * smaller = reallocate_large_buffer(buffer, 1ul << 20);
+  EXPECT_GE(large_buffer_capacity(smaller), 1ul << 20);
+  EXPECT_LT(large_buffer_capacity(smaller), 2ul << 20);
+  void * larger = reallocate_large_buffer(smaller, 20ul << 20);
+  EXPECT_GE(large_buffer_capacity(larger), 20ul << 20);
+  std::memset(larger, 0, 20ul << 20);
+  free_large_buffer(larger);
+
+  buffer = reallocate_large_buffer(nullptr, 10);
+  EXPECT_GE(large_buffer_capacity(buffer), 10u);
+  free_large_buffer(buffer);
+}
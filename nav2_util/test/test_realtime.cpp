@@ -0,0 +1,61 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <sched.h>
+
+#include <string>
+#include <thread>
+
+#include "nav2_util/realtime.hpp"
+#include "gtest/gtest.h"
+
+using nav2_util::RealtimeSettings;
+using nav2_util::apply_realtime_settings;
+
+// Each test changes the scheduling of a thread of its own, not of the test runner
+
+TEST(Realtime, EmptySettingsChangeNothing)
+{
+  RealtimeSettings settings;
+  EXPECT_TRUE(settings.empty());
+  std::thread([&]() {
+      std::string error = "stale";
+      EXPECT_TRUE(apply_realtime_settings(settings, error));
+      EXPECT_TRUE(error.empty());
+    }).join();
+}
+
+TEST(Realtime, PinsToCpu)
+{
+  RealtimeSettings settings;
+  settings.cpu_affinity = {0};
+  EXPECT_FALSE(settings.empty());
+  std::thread([&]() {
+      std::string error;
+      EXPECT_TRUE(apply_realtime_settings(settings, error)) << error;
+      EXPECT_EQ(sched_getcpu(), 0);
+    }).join();
+}
+
+TEST(Realtime, ReportsWhatFailed)
+{
+  RealtimeSettings settings;
+  settings.priority = 100;
+  settings.cpu_affinity = {-1};
+  std::thread([&]() {
+      std::string error;
+      EXPECT_FALSE(apply_realtime_settings(settings, error));
+      EXPECT_NE(error.find("SCHED_FIFO priority 100"), std::string::npos) << error;
+      EXPECT_NE(error.find("CPU -1"), std::string::npos) << error;
+    }).join();
+}
@@ -0,0 +1,83 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "nav2_util/seqlock.hpp"
+#include "gtest/gtest.h"
+
+using nav2_util::SeqLock;
+
+namespace
+{
+
+struct Sample
+{
+  double stamp;
+  double x, y, theta;
+  int32_t count;
+};
+
+}  // namespace
+
+TEST(SeqLock, StoresAndLoads)
+{
+  SeqLock<Sample> lock;
+  EXPECT_EQ(lock.version(), 0u);
+  EXPECT_EQ(lock.load().count, 0);
+
+  lock.store({1.0, 2.0, 3.0, 4.0, 5});
+  Sample sample = lock.load();
+  EXPECT_EQ(lock.version(), 1u);
+  EXPECT_EQ(sample.stamp, 1.0);
+  EXPECT_EQ(sample.theta, 4.0);
+  EXPECT_EQ(sample.count, 5);
+}
+
+TEST(SeqLock, ReadersNeverSeeTornValues)
+{
+  SeqLock<Sample> lock;
+  std::atomic<bool> done{false};
+
+  std::vector<std::thread> readers;
+  std::atomic<int> torn{0};
+  for (int i = 0; i < 3; ++i) {
+    readers.emplace_back(
+      [&]() {
+        while (!done) {
+          Sample sample = lock.load();
+          double value = sample.count;
+          if (sample.stamp != value || sample.x != value || sample.y != value ||
+          sample.theta != value)
+          {
+            torn++;
+          }
+        }
+      });
+  }
+
+  for (int i = 1; i <= 200000; ++i) {
+    double value = i;
+    lock.store({value, value, value, value, i});
+  }
+  done = true;
+  for (auto & reader : readers) {
+    reader.join();
+  }
+  EXPECT_EQ(torn, 0);
+  EXPECT_EQ(lock.version(), 200000u);
+}
@@ -0,0 +1,114 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#include "nav2_util/thread_pool.hpp"
+#include "gtest/gtest.h"
+
+using nav2_util::ThreadPool;
+
+TEST(ThreadPool, RunsEveryTaskOnce)
+{
+  ThreadPool pool(4);
+  ASSERT_EQ(pool.size(), 4u);
+
+  for (int round = 0; round < 100; ++round) {
+    std::vector<int> hits(1000, 0);
+    pool.parallel_for(hits.size(), [&](std::size_t i) {hits[i]++;});
+    for (auto hit : hits) {
+      ASSERT_EQ(hit, 1);
+    }
+  }
+}
+
+TEST(ThreadPool, SingleThread)
+{
+  ThreadPool pool(1);
+  ASSERT_EQ(pool.size(), 1u);
+
+  std::atomic<int> sum{0};
+  pool.parallel_for(10, [&](std::size_t i) {sum += static_cast<int>(i);});
+  ASSERT_EQ(sum, 45);
+  pool.parallel_for(0, [&](std::size_t) {sum = -1;});
+  ASSERT_EQ(sum, 45);
+}
+
+TEST(ThreadPool, RethrowsTaskException)
+{
+  ThreadPool pool(3);
+  std::atomic<int> done{0};
+  EXPECT_THROW(
+    pool.parallel_for(
+      100, [&](std::size_t i) {
+        if (i == 42) {
+          throw std::runtime_error("task failed");
+        }
+        done++;
+      }),
+    std::runtime_error);
+  EXPECT_EQ(done, 99);
+
+  // The pool is still usable afterwards
+  pool.parallel_for(10, [&](std::size_t) {done++;});
+  EXPECT_EQ(done, 109);
+}
+
+TEST(ThreadPool, StagedTasksFollowTheirDependencies)
+{
+  ThreadPool pool(4);
+  for (ThreadPool * runner : {&pool, static_cast<ThreadPool *>(nullptr)}) {
+    std::mutex mutex;
+    std::vector<std::size_t> order;
+    std::vector<std::function<void()>> tasks;
+    for (std::size_t i = 0; i < 5; ++i) {
+      tasks.push_back(
+        [&, i]() {
+          std::lock_guard<std::mutex> lock(mutex);
+          order.push_back(i);
+        });
+    }
+
+    // 3 after 0 and 4, 1 after 3, the others free
+    auto durations = nav2_util::run_staged_tasks(runner, tasks, {{}, {3}, {}, {0, 4}, {}});
+    ASSERT_EQ(durations.size(), 5u);
+    ASSERT_EQ(order.size(), 5u);
+    auto position = [&](std::size_t task) {
+        return std::find(order.begin(), order.end(), task) - order.begin();
+      };
+    EXPECT_GT(position(3), position(0));
+    EXPECT_GT(position(3), position(4));
+    EXPECT_GT(position(1), position(3));
+
+    // without dependencies, and without a pool, the tasks are run in order
+    order.clear();
+    nav2_util::run_staged_tasks(nullptr, tasks);
+    EXPECT_EQ(order, (std::vector<std::size_t>{0, 1, 2, 3, 4}));
+  }
+}
+
+TEST(ThreadPool, StagedTasksRejectCycles)
+{
+  std::vector<std::function<void()>> tasks(3, []() {});
+  EXPECT_THROW(
+    nav2_util::run_staged_tasks(nullptr, tasks, {{}, {2}, {1}}), std::invalid_argument);
+  EXPECT_THROW(
+    nav2_util::run_staged_tasks(nullptr, tasks, {{}, {3}, {}}), std::invalid_argument);
+  EXPECT_THROW(nav2_util::run_staged_tasks(nullptr, tasks, {{}}), std::invalid_argument);
+}
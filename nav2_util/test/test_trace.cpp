@@ -0,0 +1,125 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "nav2_util/trace.hpp"
+
+using nav2_util::trace::Event;
+using nav2_util::trace::EventType;
+using nav2_util::trace::TraceBuffer;
+
+namespace
+{
+
+std::vector<Event> named(const std::vector<Event> & events, const char * name)
+{
+  std::vector<Event> matching;
+  for (const Event & event : events) {
+    if (std::strcmp(event.name, name) == 0) {
+      matching.push_back(event);
+    }
+  }
+  return matching;
+}
+
+}  // namespace
+
+TEST(TraceBuffer, KeepsTheLatestEventsInOrder)
+{
+  TraceBuffer buffer(4);
+  EXPECT_TRUE(buffer.snapshot().empty());
+
+  for (uint64_t i = 0; i < 10; ++i) {
+    buffer.record({"event", i, 0, 0, EventType::SCOPE});
+  }
+  auto events = buffer.snapshot();
+  ASSERT_EQ(events.size(), 4u);
+  for (uint64_t i = 0; i < 4; ++i) {
+    EXPECT_EQ(events[i].start_ns, 6 + i);
+  }
+}
+
+TEST(TraceBuffer, RecordsFromManyThreads)
+{
+  TraceBuffer buffer(1000);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back(
+      [&buffer]() {
+        for (int i = 0; i < 100; ++i) {
+          buffer.record(
+            {"event", nav2_util::trace::now_ns(), 1, nav2_util::trace::thread_index(),
+              EventType::SCOPE});
+        }
+      });
+  }
+  for (auto & thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(buffer.snapshot().size(), 400u);
+}
+
+TEST(Trace, ScopesAreOnlyRecordedWhenEnabled)
+{
+  nav2_util::trace::set_enabled(false);
+  {
+    NAV2_TRACE_SCOPE("test_disabled_scope");
+  }
+  EXPECT_TRUE(named(TraceBuffer::get().snapshot(), "test_disabled_scope").empty());
+
+  nav2_util::trace::set_enabled(true);
+  {
+    NAV2_TRACE_SCOPE("test_enabled_scope");
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  nav2_util::trace::set_enabled(false);
+  auto events = named(TraceBuffer::get().snapshot(), "test_enabled_scope");
+  ASSERT_EQ(events.size(), 1u);
+  EXPECT_EQ(events[0].type, EventType::SCOPE);
+  EXPECT_GE(events[0].duration_ns, 5000000u);
+}
+
+TEST(Trace, TracedMutexRecordsWaits)
+{
+  nav2_util::trace::set_enabled(true);
+  nav2_util::trace::TracedMutex<std::recursive_mutex> mutex("test_mutex");
+
+  // Uncontended, and recursively, the lock isn't waited for
+  {
+    std::lock_guard<nav2_util::trace::TracedMutex<std::recursive_mutex>> outer(mutex);
+    std::lock_guard<nav2_util::trace::TracedMutex<std::recursive_mutex>> inner(mutex);
+  }
+  EXPECT_TRUE(named(TraceBuffer::get().snapshot(), "test_mutex").empty());
+
+  std::unique_lock<nav2_util::trace::TracedMutex<std::recursive_mutex>> held(mutex);
+  std::thread waiter([&mutex]() {
+      std::lock_guard<nav2_util::trace::TracedMutex<std::recursive_mutex>> lock(mutex);
+    });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  held.unlock();
+  waiter.join();
+  nav2_util::trace::set_enabled(false);
+
+  auto events = named(TraceBuffer::get().snapshot(), "test_mutex");
+  ASSERT_EQ(events.size(), 1u);
+  EXPECT_EQ(events[0].type, EventType::LOCK_WAIT);
+  EXPECT_GE(events[0].duration_ns, 10000000u);
+}
@@ -0,0 +1,278 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_VOXEL_GRID__SPARSE_VOXEL_GRID_HPP_
+#define NAV2_VOXEL_GRID__SPARSE_VOXEL_GRID_HPP_
+
+#include <stdint.h>
+#include <limits.h>
+#include <cassert>
+#include <unordered_map>
+#include <vector>
+#include "rclcpp/rclcpp.hpp"
+#include "nav2_voxel_grid/voxel_column.hpp"
+#include "nav2_voxel_grid/voxel_grid.hpp"
+
+namespace nav2_voxel_grid
+{
+
+/**
+ * @class SparseVoxelGrid
+ * @brief A voxel grid with the same columns as BasicVoxelGrid, stored in
+ *        8x8 column chunks in a hash map. Chunks are only allocated once a
+ *        column in them is marked or cleared, everything else reads as
+ *        unknown, so memory grows with the observed area rather than the
+ *        size of the grid. The chunks are keyed on cells that don't move
+ *        with the grid, so shifting a rolling window only drops the chunks
+ *        that leave it.
+ */
+template<typename ColumnT>
+class SparseVoxelGrid
+{
+public:
+  typedef ColumnT Column;
+  static const unsigned int max_size_z = VoxelColumn<ColumnT>::levels;
+  static const int chunk_size = 8;
+
+  /**
+   * @brief  Constructor for a sparse voxel grid
+   * @param size_x The x size of the grid
+   * @param size_y The y size of the grid
+   * @param size_z The z size of the grid, only sizes <= max_size_z are supported
+   */
+  SparseVoxelGrid(unsigned int size_x, unsigned int size_y, unsigned int size_z);
+
+  /**
+   * @brief  Resizes a voxel grid to the desired size, leaving it all unknown
+   */
+  void resize(unsigned int size_x, unsigned int size_y, unsigned int size_z);
+
+  void reset();
+
+  /**
+   * @brief  ANDs every column in [x0, xn) x [y0, yn) with mask, like
+   *         BasicVoxelGrid::maskColumns. Only the allocated chunks are visited,
+   *         so masks that keep unknown voxels unknown don't allocate any.
+   */
+  void maskColumns(
+    unsigned int x0, unsigned int y0, unsigned int xn, unsigned int yn, const ColumnT & mask);
+
+  /**
+   * @brief  Moves the grid so that cell (x, y) holds what was in (x + dx, y + dy),
+   *         the columns coming into the grid are unknown
+   */
+  void shift(int dx, int dy);
+
+  /**
+   * @brief  Writes the grid out as the size_x * size_y columns of a dense grid
+   */
+  void copyData(ColumnT * data) const;
+
+  // The number of 8x8 column chunks allocated
+  size_t chunkCount() const {return chunks_.size();}
+
+  inline void markVoxel(unsigned int x, unsigned int y, unsigned int z)
+  {
+    if (x >= size_x_ || y >= size_y_ || z >= size_z_) {
+      RCLCPP_DEBUG(logger, "Error, voxel out of bounds.\n");
+      return;
+    }
+    *column(x, y) |= VoxelColumn<ColumnT>::mask(z);  // clear unknown and mark cell
+  }
+
+  inline bool markVoxelInMap(
+    unsigned int x, unsigned int y, unsigned int z,
+    unsigned int marked_threshold)
+  {
+    if (x >= size_x_ || y >= size_y_ || z >= size_z_) {
+      RCLCPP_DEBUG(logger, "Error, voxel out of bounds.\n");
+      return false;
+    }
+
+    ColumnT * col = column(x, y);
+    *col |= VoxelColumn<ColumnT>::mask(z);  // clear unknown and mark cell
+
+    // make sure the number of bits in each is below our thesholds
+    return VoxelColumn<ColumnT>::markedBits(*col) > marked_threshold;
+  }
+
+  inline void clearVoxel(unsigned int x, unsigned int y, unsigned int z)
+  {
+    if (x >= size_x_ || y >= size_y_ || z >= size_z_) {
+      RCLCPP_DEBUG(logger, "Error, voxel out of bounds.\n");
+      return;
+    }
+    *column(x, y) &= ~VoxelColumn<ColumnT>::mask(z);  // clear unknown and clear cell
+  }
+
+  inline void clearVoxelColumn(unsigned int index)
+  {
+    assert(index < size_x_ * size_y_);
+    *column(index % size_x_, index / size_x_) = ColumnT();
+  }
+
+  void markVoxelLine(
+    double x0, double y0, double z0, double x1, double y1, double z1,
+    unsigned int max_length = UINT_MAX);
+  void clearVoxelLine(
+    double x0, double y0, double z0, double x1, double y1, double z1,
+    unsigned int max_length = UINT_MAX);
+  void clearVoxelLineInMap(
+    double x0, double y0, double z0, double x1, double y1, double z1, unsigned char * map_2d,
+    unsigned int unknown_threshold, unsigned int mark_threshold,
+    unsigned char free_cost = 0, unsigned char unknown_cost = 255,
+    unsigned int max_length = UINT_MAX, std::vector<unsigned int> * changed = NULL);
+  void clearVoxelLinesInMap(
+    double x0, double y0, double z0, const double * ends, unsigned int count,
+    unsigned char * map_2d, unsigned int unknown_threshold, unsigned int mark_threshold,
+    unsigned char free_cost = 0, unsigned char unknown_cost = 255,
+    unsigned int max_length = UINT_MAX, std::vector<unsigned int> * changed = NULL);
+
+  VoxelStatus getVoxel(unsigned int x, unsigned int y, unsigned int z) const;
+
+  // Are there any obstacles at that (x, y) location in the grid?
+  VoxelStatus getVoxelColumn(
+    unsigned int x, unsigned int y,
+    unsigned int unknown_threshold = 0, unsigned int marked_threshold = 0) const;
+
+  unsigned int sizeX() const {return size_x_;}
+  unsigned int sizeY() const {return size_y_;}
+  unsigned int sizeZ() const {return size_z_;}
+
+private:
+  struct Chunk
+  {
+    ColumnT columns[chunk_size * chunk_size];
+  };
+
+  // floor division, so that chunks left of and below the start line up too
+  static inline int chunkIndex(int cell)
+  {
+    return cell >= 0 ? cell / chunk_size : (cell + 1) / chunk_size - 1;
+  }
+
+  static inline uint64_t chunkKey(int chunk_x, int chunk_y)
+  {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(chunk_x)) << 32) |
+           static_cast<uint32_t>(chunk_y);
+  }
+
+  // the column at (x, y), allocating its chunk if needed
+  inline ColumnT * column(unsigned int x, unsigned int y)
+  {
+    int cell_x = origin_x_ + static_cast<int>(x);
+    int cell_y = origin_y_ + static_cast<int>(y);
+    int chunk_x = chunkIndex(cell_x);
+    int chunk_y = chunkIndex(cell_y);
+    uint64_t key = chunkKey(chunk_x, chunk_y);
+    if (cached_chunk_ == NULL || key != cached_key_) {
+      auto it = chunks_.find(key);
+      if (it == chunks_.end()) {
+        it = chunks_.emplace(key, unknownChunk()).first;
+      }
+      cached_key_ = key;
+      cached_chunk_ = &it->second;
+    }
+    return &cached_chunk_->columns[
+      (cell_y - chunk_y * chunk_size) * chunk_size + (cell_x - chunk_x * chunk_size)];
+  }
+
+  // the column at (x, y), or NULL when it was never touched and so is unknown
+  const ColumnT * findColumn(unsigned int x, unsigned int y) const;
+
+  static Chunk unknownChunk();
+
+  // Gathers the voxels a line passes through in each column, like
+  // BasicVoxelGrid::ClearVoxelColumnInMap, so the chunk lookup and the
+  // costmap update happen once per column instead of once per voxel
+  enum ColumnAction
+  {
+    MARK,
+    CLEAR,
+    CLEAR_IN_MAP
+  };
+
+  struct PendingColumn
+  {
+    unsigned int offset;
+    ColumnT mask;
+  };
+
+  class UpdateColumn
+  {
+public:
+    UpdateColumn(
+      SparseVoxelGrid & grid, PendingColumn & pending, ColumnAction action,
+      unsigned char * costmap = NULL,
+      unsigned int unknown_clear_threshold = 0, unsigned int marked_clear_threshold = 0,
+      unsigned char free_cost = 0, unsigned char unknown_cost = 255,
+      std::vector<unsigned int> * changed = NULL)
+    : grid_(grid), pending_(pending), action_(action), costmap_(costmap),
+      unknown_clear_threshold_(unknown_clear_threshold),
+      marked_clear_threshold_(marked_clear_threshold),
+      free_cost_(free_cost), unknown_cost_(unknown_cost), changed_(changed)
+    {
+    }
+
+    inline void operator()(unsigned int offset, const ColumnT & z_mask)
+    {
+      if (offset != pending_.offset) {
+        flush();
+        pending_.offset = offset;
+      }
+      pending_.mask |= z_mask;
+    }
+
+    void flush();
+
+private:
+    SparseVoxelGrid & grid_;
+    PendingColumn & pending_;
+    ColumnAction action_;
+    unsigned char * costmap_;
+    unsigned int unknown_clear_threshold_, marked_clear_threshold_;
+    unsigned char free_cost_, unknown_cost_;
+    std::vector<unsigned int> * changed_;
+  };
+
+  void traceLines(
+    UpdateColumn & update, double x0, double y0, double z0, const double * ends,
+    unsigned int count, unsigned int max_length);
+
+  unsigned int size_x_, size_y_, size_z_;
+  // the fixed cell that (0, 0) of the grid currently falls in
+  int origin_x_, origin_y_;
+  std::unordered_map<uint64_t, Chunk> chunks_;
+  uint64_t cached_key_;
+  Chunk * cached_chunk_;
+  rclcpp::Logger logger;
+};
+
+template<typename ColumnT>
+const unsigned int SparseVoxelGrid<ColumnT>::max_size_z;
+
+template<typename ColumnT>
+const int SparseVoxelGrid<ColumnT>::chunk_size;
+
+typedef SparseVoxelGrid<uint32_t> SparseVoxelGrid32;
+typedef SparseVoxelGrid<uint64_t> SparseVoxelGrid64;
+typedef SparseVoxelGrid<Column128> SparseVoxelGrid128;
+
+extern template class SparseVoxelGrid<uint32_t>;
+extern template class SparseVoxelGrid<uint64_t>;
+extern template class SparseVoxelGrid<Column128>;
+
+}  // namespace nav2_voxel_grid
+
+#endif  // NAV2_VOXEL_GRID__SPARSE_VOXEL_GRID_HPP_
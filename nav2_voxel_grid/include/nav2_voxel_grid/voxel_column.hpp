@@ -0,0 +1,185 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_VOXEL_GRID__VOXEL_COLUMN_HPP_
+#define NAV2_VOXEL_GRID__VOXEL_COLUMN_HPP_
+
+#include <stdint.h>
+
+namespace nav2_voxel_grid
+{
+
+inline unsigned int countBits(uint32_t n)
+{
+#if defined(__GNUC__)
+  return __builtin_popcount(n);
+#else
+  unsigned int bit_count;
+  for (bit_count = 0; n; ++bit_count) {
+    n &= n - 1;  // clear the least significant bit set
+  }
+  return bit_count;
+#endif
+}
+
+inline unsigned int countBits(uint64_t n)
+{
+#if defined(__GNUC__)
+  return __builtin_popcountll(n);
+#else
+  return countBits(static_cast<uint32_t>(n)) + countBits(static_cast<uint32_t>(n >> 32));
+#endif
+}
+
+/**
+ * @struct Column128
+ * @brief A two word voxel column for grids taller than 32 cells. The low
+ *        word plays the role of the low half of the integer columns and the
+ *        high word the role of the high half, so in memory on a little endian
+ *        host it is laid out as a 128 bit integer would be.
+ */
+struct Column128
+{
+  uint64_t low;
+  uint64_t high;
+};
+
+inline Column128 operator|(const Column128 & a, const Column128 & b)
+{
+  return Column128{a.low | b.low, a.high | b.high};
+}
+
+inline Column128 operator&(const Column128 & a, const Column128 & b)
+{
+  return Column128{a.low & b.low, a.high & b.high};
+}
+
+inline Column128 operator~(const Column128 & a)
+{
+  return Column128{~a.low, ~a.high};
+}
+
+inline Column128 & operator|=(Column128 & a, const Column128 & b)
+{
+  a.low |= b.low;
+  a.high |= b.high;
+  return a;
+}
+
+inline Column128 & operator&=(Column128 & a, const Column128 & b)
+{
+  a.low &= b.low;
+  a.high &= b.high;
+  return a;
+}
+
+inline bool operator==(const Column128 & a, const Column128 & b)
+{
+  return a.low == b.low && a.high == b.high;
+}
+
+inline bool operator!=(const Column128 & a, const Column128 & b)
+{
+  return !(a == b);
+}
+
+/**
+ * @struct VoxelColumn
+ * @brief Bit layout of a voxel column. The high half of the column holds the
+ *        marked bits and the low half the marked or unknown bits, so a known
+ *        marked voxel is 11, an unknown one 01 and a known free one 00.
+ */
+template<typename ColumnT>
+struct VoxelColumn
+{
+  static const unsigned int levels = sizeof(ColumnT) * 4;
+
+  // every voxel unknown
+  static ColumnT unknown()
+  {
+    return ~ColumnT(0) >> levels;
+  }
+
+  // both bits of voxel z
+  static ColumnT mask(unsigned int z)
+  {
+    return (ColumnT(1) << z << levels) | (ColumnT(1) << z);
+  }
+
+  static unsigned int markedBits(ColumnT col)
+  {
+    return countBits(col >> levels);
+  }
+
+  static unsigned int unknownBits(ColumnT col)
+  {
+    return countBits((col >> levels) ^ (col & unknown()));
+  }
+
+  // moves a mask built by mask() one voxel up or down the column
+  static void up(ColumnT & z_mask)
+  {
+    z_mask <<= 1;
+  }
+
+  static void down(ColumnT & z_mask)
+  {
+    z_mask >>= 1;
+  }
+};
+
+template<typename ColumnT>
+const unsigned int VoxelColumn<ColumnT>::levels;
+
+template<>
+struct VoxelColumn<Column128>
+{
+  static const unsigned int levels = 64;
+
+  static Column128 unknown()
+  {
+    return Column128{~uint64_t(0), 0};
+  }
+
+  static Column128 mask(unsigned int z)
+  {
+    return Column128{uint64_t(1) << z, uint64_t(1) << z};
+  }
+
+  static unsigned int markedBits(const Column128 & col)
+  {
+    return countBits(col.high);
+  }
+
+  static unsigned int unknownBits(const Column128 & col)
+  {
+    return countBits(col.high ^ col.low);
+  }
+
+  static void up(Column128 & z_mask)
+  {
+    z_mask.low <<= 1;
+    z_mask.high <<= 1;
+  }
+
+  static void down(Column128 & z_mask)
+  {
+    z_mask.low >>= 1;
+    z_mask.high >>= 1;
+  }
+};
+
+}  // namespace nav2_voxel_grid
+
+#endif  // NAV2_VOXEL_GRID__VOXEL_COLUMN_HPP_
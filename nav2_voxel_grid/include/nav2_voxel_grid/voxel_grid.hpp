@@ -44,13 +44,16 @@
 #include <math.h>
 #include <limits.h>
 #include <algorithm>
+#include <vector>
 #include "rclcpp/rclcpp.hpp"
+#include "nav2_voxel_grid/voxel_column.hpp"
 
 /**
- * @class VoxelGrid
+ * @class BasicVoxelGrid
  * @brief A 3D grid structure that stores points as an integer array.
  *        X and Y index the array and Z selects which bit of the integer
- *        is used giving a limit of 16 vertical cells.
+ *        is used, so the column type sets the number of vertical cells:
+ *        16 for uint32_t, 32 for uint64_t and 64 for Column128.
  */
 namespace nav2_voxel_grid
 {
@@ -62,29 +65,41 @@ enum VoxelStatus
   MARKED = 2,
 };
 
-class VoxelGrid
+template<typename ColumnT>
+class BasicVoxelGrid
 {
 public:
+  typedef ColumnT Column;
+  static const unsigned int max_size_z = VoxelColumn<ColumnT>::levels;
+
   /**
    * @brief  Constructor for a voxel grid
    * @param size_x The x size of the grid
    * @param size_y The y size of the grid
-   * @param size_z The z size of the grid, only sizes <= 16 are supported
+   * @param size_z The z size of the grid, only sizes <= max_size_z are supported
    */
-  VoxelGrid(unsigned int size_x, unsigned int size_y, unsigned int size_z);
+  BasicVoxelGrid(unsigned int size_x, unsigned int size_y, unsigned int size_z);
 
-  ~VoxelGrid();
+  ~BasicVoxelGrid();
 
   /**
    * @brief  Resizes a voxel grid to the desired size
    * @param size_x The x size of the grid
    * @param size_y The y size of the grid
-   * @param size_z The z size of the grid, only sizes <= 16 are supported
+   * @param size_z The z size of the grid, only sizes <= max_size_z are supported
    */
   void resize(unsigned int size_x, unsigned int size_y, unsigned int size_z);
 
   void reset();
-  uint32_t * getData() {return data_;}
+  ColumnT * getData() {return data_;}
+
+  /**
+   * @brief  ANDs every column in [x0, xn) x [y0, yn) with mask, a row at a time.
+   *         Masking with VoxelColumn<ColumnT>::unknown() forgets the marks and
+   *         leaves the free and unknown voxels as they are.
+   */
+  void maskColumns(
+    unsigned int x0, unsigned int y0, unsigned int xn, unsigned int yn, const ColumnT & mask);
 
   inline void markVoxel(unsigned int x, unsigned int y, unsigned int z)
   {
@@ -92,8 +107,7 @@ public:
       RCLCPP_DEBUG(logger, "Error, voxel out of bounds.\n");
       return;
     }
-    uint32_t full_mask = ((uint32_t)1 << z << 16) | (1 << z);
-    data_[y * size_x_ + x] |= full_mask;  // clear unknown and mark cell
+    data_[y * size_x_ + x] |= VoxelColumn<ColumnT>::mask(z);  // clear unknown and mark cell
   }
 
   inline bool markVoxelInMap(
@@ -106,14 +120,11 @@ public:
     }
 
     int index = y * size_x_ + x;
-    uint32_t * col = &data_[index];
-    uint32_t full_mask = ((uint32_t)1 << z << 16) | (1 << z);
-    *col |= full_mask;  // clear unknown and mark cell
-
-    unsigned int marked_bits = *col >> 16;
+    ColumnT * col = &data_[index];
+    *col |= VoxelColumn<ColumnT>::mask(z);  // clear unknown and mark cell
 
     // make sure the number of bits in each is below our thesholds
-    return !bitsBelowThreshold(marked_bits, marked_threshold);
+    return VoxelColumn<ColumnT>::markedBits(*col) > marked_threshold;
   }
 
   inline void clearVoxel(unsigned int x, unsigned int y, unsigned int z)
@@ -122,14 +133,13 @@ public:
       RCLCPP_DEBUG(logger, "Error, voxel out of bounds.\n");
       return;
     }
-    uint32_t full_mask = ((uint32_t)1 << z << 16) | (1 << z);
-    data_[y * size_x_ + x] &= ~(full_mask);  // clear unknown and clear cell
+    data_[y * size_x_ + x] &= ~VoxelColumn<ColumnT>::mask(z);  // clear unknown and clear cell
   }
 
   inline void clearVoxelColumn(unsigned int index)
   {
     assert(index < size_x_ * size_y_);
-    data_[index] = 0;
+    data_[index] = ColumnT();
   }
 
   inline void clearVoxelInMap(unsigned int x, unsigned int y, unsigned int z)
@@ -139,51 +149,63 @@ public:
       return;
     }
     int index = y * size_x_ + x;
-    uint32_t * col = &data_[index];
-    uint32_t full_mask = ((uint32_t)1 << z << 16) | (1 << z);
-    *col &= ~(full_mask);  // clear unknown and clear cell
-
-    unsigned int unknown_bits = uint16_t(*col >> 16) ^ uint16_t(*col);
-    unsigned int marked_bits = *col >> 16;
+    ColumnT * col = &data_[index];
+    *col &= ~VoxelColumn<ColumnT>::mask(z);  // clear unknown and clear cell
 
     // make sure the number of bits in each is below our thesholds
-    if (bitsBelowThreshold(unknown_bits, 1) && bitsBelowThreshold(marked_bits, 1)) {
+    if (VoxelColumn<ColumnT>::unknownBits(*col) <= 1 &&
+      VoxelColumn<ColumnT>::markedBits(*col) <= 1)
+    {
       costmap[index] = 0;
     }
   }
 
   inline bool bitsBelowThreshold(unsigned int n, unsigned int bit_threshold)
   {
-    unsigned int bit_count;
-    for (bit_count = 0; n; ) {
-      ++bit_count;
-      if (bit_count > bit_threshold) {
-        return false;
-      }
-      n &= n - 1;  // clear the least significant bit set
-    }
-    return true;
+    return numBits(n) <= bit_threshold;
   }
 
   static inline unsigned int numBits(unsigned int n)
   {
-    unsigned int bit_count;
-    for (bit_count = 0; n; ++bit_count) {
-      n &= n - 1;  // clear the least significant bit set
+    return countBits(static_cast<uint32_t>(n));
+  }
+
+  /**
+   * @brief  Sets the cell of a column that's been cleared to free_cost, or unknown_cost with
+   *         more than unknown_clear_threshold unknown voxels, unless it has more than
+   *         marked_clear_threshold marked voxels
+   * @param changed If set, the offset is added to it when the cost of the cell changes
+   */
+  static inline void setClearedCost(
+    unsigned int offset, const ColumnT & col, unsigned char * costmap,
+    unsigned int unknown_clear_threshold, unsigned int marked_clear_threshold,
+    unsigned char free_cost, unsigned char unknown_cost, std::vector<unsigned int> * changed)
+  {
+    // make sure the number of bits in each is below our thesholds
+    if (VoxelColumn<ColumnT>::markedBits(col) > marked_clear_threshold) {
+      return;
+    }
+    unsigned char cost = VoxelColumn<ColumnT>::unknownBits(col) <= unknown_clear_threshold ?
+      free_cost : unknown_cost;
+    if (costmap[offset] != cost) {
+      costmap[offset] = cost;
+      if (changed) {
+        changed->push_back(offset);
+      }
     }
-    return bit_count;
   }
 
   static VoxelStatus getVoxel(
     unsigned int x, unsigned int y, unsigned int z,
-    unsigned int size_x, unsigned int size_y, unsigned int size_z, const uint32_t * data)
+    unsigned int size_x, unsigned int size_y, unsigned int size_z, const ColumnT * data)
   {
     if (x >= size_x || y >= size_y || z >= size_z) {
       return UNKNOWN;
     }
-    uint32_t full_mask = ((uint32_t)1 << z << 16) | (1 << z);
-    uint32_t result = data[y * size_x + x] & full_mask;
-    unsigned int bits = numBits(result);
+    ColumnT full_mask = VoxelColumn<ColumnT>::mask(z);
+    ColumnT result = data[y * size_x + x] & full_mask;
+    unsigned int bits = 2 * VoxelColumn<ColumnT>::markedBits(result) +
+      VoxelColumn<ColumnT>::unknownBits(result);
 
     // known marked: 11 = 2 bits, unknown: 01 = 1 bit, known free: 00 = 0 bits
     if (bits < 2) {
@@ -201,11 +223,28 @@ public:
   void clearVoxelLine(
     double x0, double y0, double z0, double x1, double y1, double z1,
     unsigned int max_length = UINT_MAX);
+  /**
+   * @brief  Clears the voxels along a line, and sets the cells of map_2d whose columns drop
+   *         to the thresholds to free_cost, or unknown_cost with too many unknown voxels left
+   * @param changed If set, the offsets of the cells of map_2d whose cost changed are added
+   *        to it. Cells already at their cost aren't written
+   */
   void clearVoxelLineInMap(
     double x0, double y0, double z0, double x1, double y1, double z1, unsigned char * map_2d,
     unsigned int unknown_threshold, unsigned int mark_threshold,
     unsigned char free_cost = 0, unsigned char unknown_cost = 255,
-    unsigned int max_length = UINT_MAX);
+    unsigned int max_length = UINT_MAX, std::vector<unsigned int> * changed = NULL);
+
+  /**
+   * @brief  Same as clearVoxelLineInMap for many lines from a common origin
+   * @param ends The x, y, z coordinates of the end of each line, one after the other
+   * @param count The number of lines
+   */
+  void clearVoxelLinesInMap(
+    double x0, double y0, double z0, const double * ends, unsigned int count,
+    unsigned char * map_2d, unsigned int unknown_threshold, unsigned int mark_threshold,
+    unsigned char free_cost = 0, unsigned char unknown_cost = 255,
+    unsigned int max_length = UINT_MAX, std::vector<unsigned int> * changed = NULL);
 
   VoxelStatus getVoxel(unsigned int x, unsigned int y, unsigned int z);
 
@@ -224,6 +263,18 @@ public:
   inline void raytraceLine(
     ActionType at, double x0, double y0, double z0,
     double x1, double y1, double z1, unsigned int max_length = UINT_MAX)
+  {
+    traceLine(size_x_, at, x0, y0, z0, x1, y1, z1, max_length);
+  }
+
+  /**
+   * @brief  Walks the line over any grid with rows of size_x columns, calling
+   *         at(offset, z_mask) for each voxel it passes through
+   */
+  template<class ActionType>
+  static inline void traceLine(
+    unsigned int size_x, ActionType at, double x0, double y0, double z0,
+    double x1, double y1, double z1, unsigned int max_length = UINT_MAX)
   {
     int dx = int(x1) - int(x0);  // NOLINT
     int dy = int(y1) - int(y0);  // NOLINT
@@ -234,11 +285,11 @@ public:
     unsigned int abs_dz = abs(dz);
 
     int offset_dx = sign(dx);
-    int offset_dy = sign(dy) * size_x_;
+    int offset_dy = sign(dy) * size_x;
     int offset_dz = sign(dz);
 
-    unsigned int z_mask = ((1 << 16) | 1) << (unsigned int)z0;
-    unsigned int offset = (unsigned int)y0 * size_x_ + (unsigned int)x0;
+    ColumnT z_mask = VoxelColumn<ColumnT>::mask((unsigned int)z0);
+    unsigned int offset = (unsigned int)y0 * size_x + (unsigned int)x0;
 
     GridOffset grid_off(offset);
     ZOffset z_off(z_mask);
@@ -282,11 +333,11 @@ public:
 private:
   // the real work is done here... 3D bresenham implementation
   template<class ActionType, class OffA, class OffB, class OffC>
-  inline void bresenham3D(
+  static inline void bresenham3D(
     ActionType at, OffA off_a, OffB off_b, OffC off_c,
     unsigned int abs_da, unsigned int abs_db, unsigned int abs_dc,
     int error_b, int error_c, int offset_a, int offset_b, int offset_c, unsigned int & offset,
-    unsigned int & z_mask, unsigned int max_length = UINT_MAX)
+    ColumnT & z_mask, unsigned int max_length = UINT_MAX)
   {
     unsigned int end = std::min(max_length, abs_da);
     for (unsigned int i = 0; i < end; ++i) {
@@ -306,18 +357,18 @@ private:
     at(offset, z_mask);
   }
 
-  inline int sign(int i)
+  static inline int sign(int i)
   {
     return i > 0 ? 1 : -1;
   }
 
-  inline unsigned int max(unsigned int x, unsigned int y)
+  static inline unsigned int max(unsigned int x, unsigned int y)
   {
     return x > y ? x : y;
   }
 
   unsigned int size_x_, size_y_, size_z_;
-  uint32_t * data_;
+  ColumnT * data_;
   unsigned char * costmap;
   rclcpp::Logger logger;
 
@@ -326,81 +377,98 @@ private:
   class MarkVoxel
   {
 public:
-    explicit MarkVoxel(uint32_t * data)
+    explicit MarkVoxel(ColumnT * data)
     : data_(data) {}
-    inline void operator()(unsigned int offset, unsigned int z_mask)
+    inline void operator()(unsigned int offset, const ColumnT & z_mask)
     {
       data_[offset] |= z_mask;  // clear unknown and mark cell
     }
 
 private:
-    uint32_t * data_;
+    ColumnT * data_;
   };
 
   class ClearVoxel
   {
 public:
-    explicit ClearVoxel(uint32_t * data)
+    explicit ClearVoxel(ColumnT * data)
     : data_(data) {}
-    inline void operator()(unsigned int offset, unsigned int z_mask)
+    inline void operator()(unsigned int offset, const ColumnT & z_mask)
     {
       data_[offset] &= ~(z_mask);  // clear unknown and clear cell
     }
 
 private:
-    uint32_t * data_;
+    ColumnT * data_;
   };
 
   class ClearVoxelInMap
   {
 public:
     ClearVoxelInMap(
-      uint32_t * data, unsigned char * costmap,
+      ColumnT * data, unsigned char * costmap,
       unsigned int unknown_clear_threshold, unsigned int marked_clear_threshold,
-      unsigned char free_cost = 0, unsigned char unknown_cost = 255)
+      unsigned char free_cost = 0, unsigned char unknown_cost = 255,
+      std::vector<unsigned int> * changed = NULL)
     : data_(data), costmap_(costmap),
       unknown_clear_threshold_(unknown_clear_threshold), marked_clear_threshold_(
         marked_clear_threshold),
-      free_cost_(free_cost), unknown_cost_(unknown_cost)
+      free_cost_(free_cost), unknown_cost_(unknown_cost), changed_(changed)
     {
     }
 
-    inline void operator()(unsigned int offset, unsigned int z_mask)
+    inline void operator()(unsigned int offset, const ColumnT & z_mask)
     {
-      uint32_t * col = &data_[offset];
+      ColumnT * col = &data_[offset];
       *col &= ~(z_mask);  // clear unknown and clear cell
+      setClearedCost(
+        offset, *col, costmap_, unknown_clear_threshold_, marked_clear_threshold_,
+        free_cost_, unknown_cost_, changed_);
+    }
+
+private:
 
-      unsigned int unknown_bits = uint16_t(*col >> 16) ^ uint16_t(*col);
-      unsigned int marked_bits = *col >> 16;
+    ColumnT * data_;
+    unsigned char * costmap_;
+    unsigned int unknown_clear_threshold_, marked_clear_threshold_;
+    unsigned char free_cost_, unknown_cost_;
+    std::vector<unsigned int> * changed_;
+  };
 
-      // make sure the number of bits in each is below our thesholds
-      if (bitsBelowThreshold(marked_bits, marked_clear_threshold_)) {
-        if (bitsBelowThreshold(unknown_bits, unknown_clear_threshold_)) {
-          costmap_[offset] = free_cost_;
-        } else {
-          costmap_[offset] = unknown_cost_;
-        }
+  // Gathers the voxels a line clears in each column, so that a column is
+  // cleared with a single mask and its thresholds checked once. Clearing only
+  // lowers the bit counts, so this updates the costmap as the voxel by voxel
+  // clearing would, and a 3D Bresenham line never comes back to a column.
+  class ClearVoxelColumnInMap
+  {
+public:
+    ClearVoxelColumnInMap(
+      ClearVoxelInMap & clear, unsigned int & column, ColumnT & column_mask)
+    : clear_(clear), column_(column), column_mask_(column_mask)
+    {
+    }
+
+    inline void operator()(unsigned int offset, const ColumnT & z_mask)
+    {
+      if (offset != column_) {
+        flush();
+        column_ = offset;
       }
+      column_mask_ |= z_mask;
     }
 
-private:
-    inline bool bitsBelowThreshold(unsigned int n, unsigned int bit_threshold)
+    inline void flush()
     {
-      unsigned int bit_count;
-      for (bit_count = 0; n; ) {
-        ++bit_count;
-        if (bit_count > bit_threshold) {
-          return false;
-        }
-        n &= n - 1;  // clear the least significant bit set
+      if (column_mask_ != ColumnT()) {
+        clear_(column_, column_mask_);
+        column_mask_ = ColumnT();
       }
-      return true;
     }
 
-    uint32_t * data_;
-    unsigned char * costmap_;
-    unsigned int unknown_clear_threshold_, marked_clear_threshold_;
-    unsigned char free_cost_, unknown_cost_;
+private:
+    ClearVoxelInMap & clear_;
+    unsigned int & column_;
+    ColumnT & column_mask_;
   };
 
   class GridOffset
@@ -420,18 +488,61 @@ private:
   class ZOffset
   {
 public:
-    explicit ZOffset(unsigned int & z_mask)
+    explicit ZOffset(ColumnT & z_mask)
     : z_mask_(z_mask) {}
     inline void operator()(int offset_val)
     {
-      offset_val > 0 ? z_mask_ <<= 1 : z_mask_ >>= 1;
+      if (offset_val > 0) {
+        VoxelColumn<ColumnT>::up(z_mask_);
+      } else {
+        VoxelColumn<ColumnT>::down(z_mask_);
+      }
     }
 
 private:
-    unsigned int & z_mask_;
+    ColumnT & z_mask_;
   };
 };
 
+template<typename ColumnT>
+const unsigned int BasicVoxelGrid<ColumnT>::max_size_z;
+
+// the compact 16 level grid, and the taller variants used when more z cells are needed
+typedef BasicVoxelGrid<uint32_t> VoxelGrid;
+typedef BasicVoxelGrid<uint64_t> VoxelGrid64;
+typedef BasicVoxelGrid<Column128> VoxelGrid128;
+
+extern template class BasicVoxelGrid<uint32_t>;
+extern template class BasicVoxelGrid<uint64_t>;
+extern template class BasicVoxelGrid<Column128>;
+
+/**
+ * @brief  Looks up a voxel in grid data sent as 32 bit words, such as a
+ *         nav2_msgs/VoxelGrid, where each column takes column_words words
+ * @param column_words 1 for VoxelGrid, 2 for VoxelGrid64 and 4 for VoxelGrid128
+ */
+inline VoxelStatus getPackedVoxel(
+  unsigned int x, unsigned int y, unsigned int z,
+  unsigned int size_x, unsigned int size_y, unsigned int size_z,
+  const uint32_t * data, unsigned int column_words)
+{
+  if (x >= size_x || y >= size_y || z >= size_z) {
+    return UNKNOWN;
+  }
+  const uint32_t * words = data + (y * size_x + x) * column_words;
+  if (column_words == 2) {
+    uint64_t col;
+    memcpy(&col, words, sizeof(col));
+    return VoxelGrid64::getVoxel(0, 0, z, 1, 1, size_z, &col);
+  }
+  if (column_words == 4) {
+    Column128 col;
+    memcpy(&col, words, sizeof(col));
+    return VoxelGrid128::getVoxel(0, 0, z, 1, 1, size_z, &col);
+  }
+  return VoxelGrid::getVoxel(0, 0, z, 1, 1, size_z, words);
+}
+
 }  // namespace nav2_voxel_grid
 
 #endif  // NAV2_VOXEL_GRID__VOXEL_GRID_HPP_
@@ -0,0 +1,316 @@
+// Copyright (c) 2020 Intel Corporation
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <nav2_voxel_grid/sparse_voxel_grid.hpp>
+
+#include <algorithm>
+
+namespace nav2_voxel_grid
+{
+
+template<typename ColumnT>
+SparseVoxelGrid<ColumnT>::SparseVoxelGrid(
+  unsigned int size_x, unsigned int size_y,
+  unsigned int size_z)
+: origin_x_(0), origin_y_(0), cached_key_(0), cached_chunk_(NULL),
+  logger(rclcpp::get_logger("voxel_grid"))
+{
+  resize(size_x, size_y, size_z);
+}
+
+template<typename ColumnT>
+void SparseVoxelGrid<ColumnT>::resize(
+  unsigned int size_x, unsigned int size_y,
+  unsigned int size_z)
+{
+  size_x_ = size_x;
+  size_y_ = size_y;
+  size_z_ = size_z;
+
+  if (size_z_ > max_size_z) {
+    RCLCPP_INFO(
+      logger, "Error, this implementation can only support up to %u z values (%d)",
+      max_size_z, size_z);
+    size_z_ = max_size_z;
+  }
+
+  reset();
+}
+
+template<typename ColumnT>
+void SparseVoxelGrid<ColumnT>::reset()
+{
+  chunks_.clear();
+  cached_chunk_ = NULL;
+}
+
+template<typename ColumnT>
+typename SparseVoxelGrid<ColumnT>::Chunk SparseVoxelGrid<ColumnT>::unknownChunk()
+{
+  Chunk chunk;
+  std::fill(
+    chunk.columns, chunk.columns + chunk_size * chunk_size,
+    VoxelColumn<ColumnT>::unknown());
+  return chunk;
+}
+
+template<typename ColumnT>
+void SparseVoxelGrid<ColumnT>::maskColumns(
+  unsigned int x0, unsigned int y0, unsigned int xn, unsigned int yn, const ColumnT & mask)
+{
+  int begin_x = origin_x_ + static_cast<int>(x0);
+  int begin_y = origin_y_ + static_cast<int>(y0);
+  int end_x = origin_x_ + static_cast<int>(std::min(xn, size_x_));
+  int end_y = origin_y_ + static_cast<int>(std::min(yn, size_y_));
+
+  for (auto & chunk : chunks_) {
+    int chunk_x = static_cast<int32_t>(chunk.first >> 32) * chunk_size;
+    int chunk_y = static_cast<int32_t>(chunk.first & 0xffffffff) * chunk_size;
+    int start_x = std::max(chunk_x, begin_x);
+    int stop_x = std::min(chunk_x + chunk_size, end_x);
+    int start_y = std::max(chunk_y, begin_y);
+    int stop_y = std::min(chunk_y + chunk_size, end_y);
+    for (int y = start_y; y < stop_y; ++y) {
+      ColumnT * row = chunk.second.columns + (y - chunk_y) * chunk_size - chunk_x;
+      for (int x = start_x; x < stop_x; ++x) {
+        row[x] &= mask;
+      }
+    }
+  }
+}
+
+template<typename ColumnT>
+void SparseVoxelGrid<ColumnT>::shift(int dx, int dy)
+{
+  origin_x_ += dx;
+  origin_y_ += dy;
+  cached_chunk_ = NULL;
+
+  int end_x = origin_x_ + static_cast<int>(size_x_);
+  int end_y = origin_y_ + static_cast<int>(size_y_);
+  const ColumnT unknown = VoxelColumn<ColumnT>::unknown();
+
+  // drop the chunks that left the grid, and forget the columns of those that
+  // only partly left it, so they come back as unknown
+  for (auto it = chunks_.begin(); it != chunks_.end(); ) {
+    int chunk_x = static_cast<int32_t>(it->first >> 32) * chunk_size;
+    int chunk_y = static_cast<int32_t>(it->first & 0xffffffff) * chunk_size;
+
+    if (chunk_x + chunk_size <= origin_x_ || chunk_x >= end_x ||
+      chunk_y + chunk_size <= origin_y_ || chunk_y >= end_y)
+    {
+      it = chunks_.erase(it);
+      continue;
+    }
+
+    if (chunk_x < origin_x_ || chunk_x + chunk_size > end_x ||
+      chunk_y < origin_y_ || chunk_y + chunk_size > end_y)
+    {
+      ColumnT * col = it->second.columns;
+      for (int y = chunk_y; y < chunk_y + chunk_size; ++y) {
+        for (int x = chunk_x; x < chunk_x + chunk_size; ++x, ++col) {
+          if (x < origin_x_ || x >= end_x || y < origin_y_ || y >= end_y) {
+            *col = unknown;
+          }
+        }
+      }
+    }
+    ++it;
+  }
+}
+
+template<typename ColumnT>
+void SparseVoxelGrid<ColumnT>::copyData(ColumnT * data) const
+{
+  std::fill(data, data + size_x_ * size_y_, VoxelColumn<ColumnT>::unknown());
+
+  int end_x = origin_x_ + static_cast<int>(size_x_);
+  int end_y = origin_y_ + static_cast<int>(size_y_);
+  for (const auto & chunk : chunks_) {
+    int chunk_x = static_cast<int32_t>(chunk.first >> 32) * chunk_size;
+    int chunk_y = static_cast<int32_t>(chunk.first & 0xffffffff) * chunk_size;
+    int start_x = std::max(chunk_x, origin_x_);
+    int stop_x = std::min(chunk_x + chunk_size, end_x);
+    int start_y = std::max(chunk_y, origin_y_);
+    int stop_y = std::min(chunk_y + chunk_size, end_y);
+    for (int y = start_y; y < stop_y; ++y) {
+      std::copy(
+        chunk.second.columns + (y - chunk_y) * chunk_size + (start_x - chunk_x),
+        chunk.second.columns + (y - chunk_y) * chunk_size + (stop_x - chunk_x),
+        data + (y - origin_y_) * size_x_ + (start_x - origin_x_));
+    }
+  }
+}
+
+template<typename ColumnT>
+const ColumnT * SparseVoxelGrid<ColumnT>::findColumn(unsigned int x, unsigned int y) const
+{
+  int cell_x = origin_x_ + static_cast<int>(x);
+  int cell_y = origin_y_ + static_cast<int>(y);
+  int chunk_x = chunkIndex(cell_x);
+  int chunk_y = chunkIndex(cell_y);
+  auto it = chunks_.find(chunkKey(chunk_x, chunk_y));
+  if (it == chunks_.end()) {
+    return NULL;
+  }
+  return &it->second.columns[
+    (cell_y - chunk_y * chunk_size) * chunk_size + (cell_x - chunk_x * chunk_size)];
+}
+
+template<typename ColumnT>
+void SparseVoxelGrid<ColumnT>::UpdateColumn::flush()
+{
+  if (pending_.mask == ColumnT()) {
+    return;
+  }
+
+  unsigned int offset = pending_.offset;
+  ColumnT * col = grid_.column(offset % grid_.size_x_, offset / grid_.size_x_);
+  if (action_ == MARK) {
+    *col |= pending_.mask;  // clear unknown and mark cell
+  } else {
+    *col &= ~pending_.mask;  // clear unknown and clear cell
+  }
+
+  if (action_ == CLEAR_IN_MAP) {
+    BasicVoxelGrid<ColumnT>::setClearedCost(
+      offset, *col, costmap_, unknown_clear_threshold_, marked_clear_threshold_,
+      free_cost_, unknown_cost_, changed_);
+  }
+  pending_.mask = ColumnT();
+}
+
+template<typename ColumnT>
+void SparseVoxelGrid<ColumnT>::traceLines(
+  UpdateColumn & update, double x0, double y0, double z0, const double * ends,
+  unsigned int count, unsigned int max_length)
+{
+  if (x0 >= size_x_ || y0 >= size_y_ || z0 >= size_z_) {
+    RCLCPP_DEBUG(
+      logger, "Error, line origin out of bounds. (%.2f, %.2f, %.2f),  size: (%d, %d, %d)",
+      x0, y0, z0, size_x_, size_y_, size_z_);
+    return;
+  }
+
+  for (unsigned int i = 0; i < count; ++i) {
+    const double * end = ends + 3 * i;
+    if (end[0] >= size_x_ || end[1] >= size_y_ || end[2] >= size_z_) {
+      RCLCPP_DEBUG(
+        logger, "Error, line endpoint out of bounds. (%.2f, %.2f, %.2f),  size: (%d, %d, %d)",
+        end[0], end[1], end[2], size_x_, size_y_, size_z_);
+      continue;
+    }
+    BasicVoxelGrid<ColumnT>::traceLine(
+      size_x_, update, x0, y0, z0, end[0], end[1], end[2], max_length);
+    // lines cross at the origin, so each one is applied before the next is traced
+    update.flush();
+  }
+}
+
+template<typename ColumnT>
+void SparseVoxelGrid<ColumnT>::markVoxelLine(
+  double x0, double y0, double z0, double x1, double y1, double z1,
+  unsigned int max_length)
+{
+  PendingColumn pending{0, ColumnT()};
+  UpdateColumn update(*this, pending, MARK);
+  double end[3] = {x1, y1, z1};
+  traceLines(update, x0, y0, z0, end, 1, max_length);
+}
+
+template<typename ColumnT>
+void SparseVoxelGrid<ColumnT>::clearVoxelLine(
+  double x0, double y0, double z0, double x1, double y1, double z1,
+  unsigned int max_length)
+{
+  PendingColumn pending{0, ColumnT()};
+  UpdateColumn update(*this, pending, CLEAR);
+  double end[3] = {x1, y1, z1};
+  traceLines(update, x0, y0, z0, end, 1, max_length);
+}
+
+template<typename ColumnT>
+void SparseVoxelGrid<ColumnT>::clearVoxelLineInMap(
+  double x0, double y0, double z0, double x1, double y1, double z1, unsigned char * map_2d,
+  unsigned int unknown_threshold, unsigned int mark_threshold, unsigned char free_cost,
+  unsigned char unknown_cost, unsigned int max_length, std::vector<unsigned int> * changed)
+{
+  double end[3] = {x1, y1, z1};
+  clearVoxelLinesInMap(
+    x0, y0, z0, end, 1, map_2d, unknown_threshold, mark_threshold,
+    free_cost, unknown_cost, max_length, changed);
+}
+
+template<typename ColumnT>
+void SparseVoxelGrid<ColumnT>::clearVoxelLinesInMap(
+  double x0, double y0, double z0, const double * ends, unsigned int count,
+  unsigned char * map_2d, unsigned int unknown_threshold, unsigned int mark_threshold,
+  unsigned char free_cost, unsigned char unknown_cost, unsigned int max_length,
+  std::vector<unsigned int> * changed)
+{
+  PendingColumn pending{0, ColumnT()};
+  UpdateColumn update(
+    *this, pending, map_2d == NULL ? CLEAR : CLEAR_IN_MAP, map_2d,
+    unknown_threshold, mark_threshold, free_cost, unknown_cost, changed);
+  traceLines(update, x0, y0, z0, ends, count, max_length);
+}
+
+template<typename ColumnT>
+VoxelStatus SparseVoxelGrid<ColumnT>::getVoxel(
+  unsigned int x, unsigned int y,
+  unsigned int z) const
+{
+  if (x >= size_x_ || y >= size_y_ || z >= size_z_) {
+    RCLCPP_DEBUG(logger, "Error, voxel out of bounds. (%d, %d, %d)\n", x, y, z);
+    return UNKNOWN;
+  }
+
+  const ColumnT * col = findColumn(x, y);
+  if (col == NULL) {
+    return UNKNOWN;
+  }
+  return BasicVoxelGrid<ColumnT>::getVoxel(0, 0, z, 1, 1, size_z_, col);
+}
+
+template<typename ColumnT>
+VoxelStatus SparseVoxelGrid<ColumnT>::getVoxelColumn(
+  unsigned int x, unsigned int y,
+  unsigned int unknown_threshold, unsigned int marked_threshold) const
+{
+  if (x >= size_x_ || y >= size_y_) {
+    RCLCPP_DEBUG(logger, "Error, voxel out of bounds. (%d, %d)\n", x, y);
+    return UNKNOWN;
+  }
+
+  const ColumnT * found = findColumn(x, y);
+  const ColumnT col = found ? *found : VoxelColumn<ColumnT>::unknown();
+
+  // check if the number of marked bits qualifies the col as marked
+  if (VoxelColumn<ColumnT>::markedBits(col) > marked_threshold) {
+    return MARKED;
+  }
+
+  // check if the number of unkown bits qualifies the col as unknown
+  if (VoxelColumn<ColumnT>::unknownBits(col) > unknown_threshold) {
+    return UNKNOWN;
+  }
+
+  return FREE;
+}
+
+template class SparseVoxelGrid<uint32_t>;
+template class SparseVoxelGrid<uint64_t>;
+template class SparseVoxelGrid<Column128>;
+
+}  // namespace nav2_voxel_grid
@@ -39,30 +39,34 @@
 
 namespace nav2_voxel_grid
 {
-VoxelGrid::VoxelGrid(unsigned int size_x, unsigned int size_y, unsigned int size_z)
+template<typename ColumnT>
+BasicVoxelGrid<ColumnT>::BasicVoxelGrid(
+  unsigned int size_x, unsigned int size_y,
+  unsigned int size_z)
 : logger(rclcpp::get_logger("voxel_grid"))
 {
   size_x_ = size_x;
   size_y_ = size_y;
   size_z_ = size_z;
 
-  if (size_z_ > 16) {
+  if (size_z_ > max_size_z) {
     RCLCPP_INFO(
-      logger, "Error, this implementation can only support up to 16 z values (%d)",
-      size_z_);
-    size_z_ = 16;
+      logger, "Error, this implementation can only support up to %u z values (%d)",
+      max_size_z, size_z_);
+    size_z_ = max_size_z;
   }
 
-  data_ = new uint32_t[size_x_ * size_y_];
-  uint32_t unknown_col = ~((uint32_t)0) >> 16;
-  uint32_t * col = data_;
+  data_ = new ColumnT[size_x_ * size_y_];
+  ColumnT unknown_col = VoxelColumn<ColumnT>::unknown();
+  ColumnT * col = data_;
   for (unsigned int i = 0; i < size_x_ * size_y_; ++i) {
     *col = unknown_col;
     ++col;
   }
 }
 
-void VoxelGrid::resize(unsigned int size_x, unsigned int size_y, unsigned int size_z)
+template<typename ColumnT>
+void BasicVoxelGrid<ColumnT>::resize(unsigned int size_x, unsigned int size_y, unsigned int size_z)
 {
   // if we're not actually changing the size, we can just reset things
   if (size_x == size_x_ && size_y == size_y_ && size_z == size_z_) {
@@ -75,38 +79,55 @@ void VoxelGrid::resize(unsigned int size_x, unsigned int size_y, unsigned int si
   size_y_ = size_y;
   size_z_ = size_z;
 
-  if (size_z_ > 16) {
+  if (size_z_ > max_size_z) {
     RCLCPP_INFO(
-      logger, "Error, this implementation can only support up to 16 z values (%d)",
-      size_z);
-    size_z_ = 16;
+      logger, "Error, this implementation can only support up to %u z values (%d)",
+      max_size_z, size_z);
+    size_z_ = max_size_z;
   }
 
-  data_ = new uint32_t[size_x_ * size_y_];
-  uint32_t unknown_col = ~((uint32_t)0) >> 16;
-  uint32_t * col = data_;
+  data_ = new ColumnT[size_x_ * size_y_];
+  ColumnT unknown_col = VoxelColumn<ColumnT>::unknown();
+  ColumnT * col = data_;
   for (unsigned int i = 0; i < size_x_ * size_y_; ++i) {
     *col = unknown_col;
     ++col;
   }
 }
 
-VoxelGrid::~VoxelGrid()
+template<typename ColumnT>
+BasicVoxelGrid<ColumnT>::~BasicVoxelGrid()
 {
   delete[] data_;
 }
 
-void VoxelGrid::reset()
+template<typename ColumnT>
+void BasicVoxelGrid<ColumnT>::reset()
 {
-  uint32_t unknown_col = ~((uint32_t)0) >> 16;
-  uint32_t * col = data_;
+  ColumnT unknown_col = VoxelColumn<ColumnT>::unknown();
+  ColumnT * col = data_;
   for (unsigned int i = 0; i < size_x_ * size_y_; ++i) {
     *col = unknown_col;
     ++col;
   }
 }
 
-void VoxelGrid::markVoxelLine(
+template<typename ColumnT>
+void BasicVoxelGrid<ColumnT>::maskColumns(
+  unsigned int x0, unsigned int y0, unsigned int xn, unsigned int yn, const ColumnT & mask)
+{
+  xn = std::min(xn, size_x_);
+  yn = std::min(yn, size_y_);
+  for (unsigned int y = y0; y < yn; ++y) {
+    ColumnT * row = data_ + y * size_x_;
+    for (unsigned int x = x0; x < xn; ++x) {
+      row[x] &= mask;
+    }
+  }
+}
+
+template<typename ColumnT>
+void BasicVoxelGrid<ColumnT>::markVoxelLine(
   double x0, double y0, double z0, double x1, double y1, double z1,
   unsigned int max_length)
 {
@@ -125,7 +146,8 @@ void VoxelGrid::markVoxelLine(
   raytraceLine(mv, x0, y0, z0, x1, y1, z1, max_length);
 }
 
-void VoxelGrid::clearVoxelLine(
+template<typename ColumnT>
+void BasicVoxelGrid<ColumnT>::clearVoxelLine(
   double x0, double y0, double z0, double x1, double y1, double z1,
   unsigned int max_length)
 {
@@ -144,10 +166,11 @@ void VoxelGrid::clearVoxelLine(
   raytraceLine(cv, x0, y0, z0, x1, y1, z1, max_length);
 }
 
-void VoxelGrid::clearVoxelLineInMap(
+template<typename ColumnT>
+void BasicVoxelGrid<ColumnT>::clearVoxelLineInMap(
   double x0, double y0, double z0, double x1, double y1, double z1, unsigned char * map_2d,
   unsigned int unknown_threshold, unsigned int mark_threshold, unsigned char free_cost,
-  unsigned char unknown_cost, unsigned int max_length)
+  unsigned char unknown_cost, unsigned int max_length, std::vector<unsigned int> * changed)
 {
   costmap = map_2d;
   if (map_2d == NULL) {
@@ -166,19 +189,67 @@ void VoxelGrid::clearVoxelLineInMap(
     return;
   }
 
-  ClearVoxelInMap cvm(data_, costmap, unknown_threshold, mark_threshold, free_cost, unknown_cost);
-  raytraceLine(cvm, x0, y0, z0, x1, y1, z1, max_length);
+  ClearVoxelInMap cvm(
+    data_, costmap, unknown_threshold, mark_threshold, free_cost, unknown_cost, changed);
+  unsigned int column = 0;
+  ColumnT column_mask = ColumnT();
+  ClearVoxelColumnInMap ccm(cvm, column, column_mask);
+  raytraceLine(ccm, x0, y0, z0, x1, y1, z1, max_length);
+  ccm.flush();
 }
 
-VoxelStatus VoxelGrid::getVoxel(unsigned int x, unsigned int y, unsigned int z)
+template<typename ColumnT>
+void BasicVoxelGrid<ColumnT>::clearVoxelLinesInMap(
+  double x0, double y0, double z0, const double * ends, unsigned int count,
+  unsigned char * map_2d, unsigned int unknown_threshold, unsigned int mark_threshold,
+  unsigned char free_cost, unsigned char unknown_cost, unsigned int max_length,
+  std::vector<unsigned int> * changed)
+{
+  if (map_2d == NULL) {
+    for (unsigned int i = 0; i < count; ++i) {
+      const double * end = ends + 3 * i;
+      clearVoxelLine(x0, y0, z0, end[0], end[1], end[2], max_length);
+    }
+    return;
+  }
+
+  if (x0 >= size_x_ || y0 >= size_y_ || z0 >= size_z_) {
+    RCLCPP_DEBUG(
+      logger, "Error, line origin out of bounds. (%.2f, %.2f, %.2f),  size: (%d, %d, %d)",
+      x0, y0, z0, size_x_, size_y_, size_z_);
+    return;
+  }
+
+  costmap = map_2d;
+  ClearVoxelInMap cvm(
+    data_, costmap, unknown_threshold, mark_threshold, free_cost, unknown_cost, changed);
+  unsigned int column = 0;
+  ColumnT column_mask = ColumnT();
+  ClearVoxelColumnInMap ccm(cvm, column, column_mask);
+  for (unsigned int i = 0; i < count; ++i) {
+    const double * end = ends + 3 * i;
+    if (end[0] >= size_x_ || end[1] >= size_y_ || end[2] >= size_z_) {
+      RCLCPP_DEBUG(
+        logger, "Error, line endpoint out of bounds. (%.2f, %.2f, %.2f),  size: (%d, %d, %d)",
+        end[0], end[1], end[2], size_x_, size_y_, size_z_);
+      continue;
+    }
+    raytraceLine(ccm, x0, y0, z0, end[0], end[1], end[2], max_length);
+    // lines cross at the origin, so each one is applied before the next is traced
+    ccm.flush();
+  }
+}
+
+template<typename ColumnT>
+VoxelStatus BasicVoxelGrid<ColumnT>::getVoxel(unsigned int x, unsigned int y, unsigned int z)
 {
   if (x >= size_x_ || y >= size_y_ || z >= size_z_) {
     RCLCPP_DEBUG(logger, "Error, voxel out of bounds. (%d, %d, %d)\n", x, y, z);
     return UNKNOWN;
   }
-  uint32_t full_mask = ((uint32_t)1 << z << 16) | (1 << z);
-  uint32_t result = data_[y * size_x_ + x] & full_mask;
-  unsigned int bits = numBits(result);
+  ColumnT result = data_[y * size_x_ + x] & VoxelColumn<ColumnT>::mask(z);
+  unsigned int bits = 2 * VoxelColumn<ColumnT>::markedBits(result) +
+    VoxelColumn<ColumnT>::unknownBits(result);
 
   // known marked: 11 = 2 bits, unknown: 01 = 1 bit, known free: 00 = 0 bits
   if (bits < 2) {
@@ -192,7 +263,8 @@ VoxelStatus VoxelGrid::getVoxel(unsigned int x, unsigned int y, unsigned int z)
   return MARKED;
 }
 
-VoxelStatus VoxelGrid::getVoxelColumn(
+template<typename ColumnT>
+VoxelStatus BasicVoxelGrid<ColumnT>::getVoxelColumn(
   unsigned int x, unsigned int y,
   unsigned int unknown_threshold, unsigned int marked_threshold)
 {
@@ -201,40 +273,41 @@ VoxelStatus VoxelGrid::getVoxelColumn(
     return UNKNOWN;
   }
 
-  uint32_t * col = &data_[y * size_x_ + x];
-
-  unsigned int unknown_bits = uint16_t(*col >> 16) ^ uint16_t(*col);
-  unsigned int marked_bits = *col >> 16;
+  ColumnT * col = &data_[y * size_x_ + x];
 
   // check if the number of marked bits qualifies the col as marked
-  if (!bitsBelowThreshold(marked_bits, marked_threshold)) {
+  if (VoxelColumn<ColumnT>::markedBits(*col) > marked_threshold) {
     return MARKED;
   }
 
   // check if the number of unkown bits qualifies the col as unknown
-  if (!bitsBelowThreshold(unknown_bits, unknown_threshold)) {
+  if (VoxelColumn<ColumnT>::unknownBits(*col) > unknown_threshold) {
     return UNKNOWN;
   }
 
   return FREE;
 }
 
-unsigned int VoxelGrid::sizeX()
+template<typename ColumnT>
+unsigned int BasicVoxelGrid<ColumnT>::sizeX()
 {
   return size_x_;
 }
 
-unsigned int VoxelGrid::sizeY()
+template<typename ColumnT>
+unsigned int BasicVoxelGrid<ColumnT>::sizeY()
 {
   return size_y_;
 }
 
-unsigned int VoxelGrid::sizeZ()
+template<typename ColumnT>
+unsigned int BasicVoxelGrid<ColumnT>::sizeZ()
 {
   return size_z_;
 }
 
-void VoxelGrid::printVoxelGrid()
+template<typename ColumnT>
+void BasicVoxelGrid<ColumnT>::printVoxelGrid()
 {
   for (unsigned int z = 0; z < size_z_; z++) {
     printf("Layer z = %u:\n", z);
@@ -247,14 +320,20 @@ void VoxelGrid::printVoxelGrid()
   }
 }
 
-void VoxelGrid::printColumnGrid()
+template<typename ColumnT>
+void BasicVoxelGrid<ColumnT>::printColumnGrid()
 {
   printf("Column view:\n");
   for (unsigned int y = 0; y < size_y_; y++) {
     for (unsigned int x = 0; x < size_x_; x++) {
-      printf((getVoxelColumn(x, y, 16, 0) == nav2_voxel_grid::MARKED) ? "#" : " ");
+      printf((getVoxelColumn(x, y, max_size_z, 0) == nav2_voxel_grid::MARKED) ? "#" : " ");
     }
     printf("|\n");
   }
 }
+
+template class BasicVoxelGrid<uint32_t>;
+template class BasicVoxelGrid<uint64_t>;
+template class BasicVoxelGrid<Column128>;
+
 }  // namespace nav2_voxel_grid
@@ -34,7 +34,10 @@
 *
 * Author: Eitan Marder-Eppstein
 *********************************************************************/
+#include <algorithm>
+#include <vector>
 #include <nav2_voxel_grid/voxel_grid.hpp>
+#include <nav2_voxel_grid/sparse_voxel_grid.hpp>
 #include <gtest/gtest.h>
 
 TEST(voxel_grid, basicMarkingAndClearing) {
@@ -147,6 +150,241 @@ TEST(voxel_grid, InvalidSize) {
   EXPECT_TRUE(vg.getVoxelColumn(50, 11, 0, 0) == nav2_voxel_grid::VoxelStatus::UNKNOWN);
 }
 
+TEST(voxel_grid, batchedLineClearing) {
+  unsigned int size_x = 40, size_y = 30, size_z = 12;
+  nav2_voxel_grid::VoxelGrid single(size_x, size_y, size_z);
+  nav2_voxel_grid::VoxelGrid batched(size_x, size_y, size_z);
+  for (unsigned int x = 0; x < size_x; x += 3) {
+    for (unsigned int y = 0; y < size_y; y += 2) {
+      single.markVoxel(x, y, (x + y) % size_z);
+      batched.markVoxel(x, y, (x + y) % size_z);
+    }
+  }
+
+  std::vector<unsigned char> single_map(size_x * size_y, 254);
+  std::vector<unsigned char> batched_map(size_x * size_y, 254);
+  std::vector<double> ends;
+  for (unsigned int i = 0; i < 60; ++i) {
+    ends.push_back((i * 7 % size_x) + 0.5);
+    ends.push_back((i * 11 % size_y) + 0.25);
+    ends.push_back((i * 5 % size_z) + 0.75);
+  }
+  // one endpoint outside the grid should be skipped rather than clearing anything
+  ends.push_back(size_x + 5.0);
+  ends.push_back(1.0);
+  ends.push_back(1.0);
+
+  unsigned int count = ends.size() / 3;
+  for (unsigned int i = 0; i < count; ++i) {
+    single.clearVoxelLineInMap(
+      20.5, 15.5, 6.5, ends[3 * i], ends[3 * i + 1], ends[3 * i + 2],
+      single_map.data(), 1, 0, 0, 255, 25);
+  }
+  batched.clearVoxelLinesInMap(
+    20.5, 15.5, 6.5, ends.data(), count, batched_map.data(), 1, 0, 0, 255, 25);
+
+  EXPECT_EQ(single_map, batched_map);
+  for (unsigned int i = 0; i < size_x * size_y; ++i) {
+    ASSERT_EQ(single.getData()[i], batched.getData()[i]);
+  }
+}
+
+template<typename Grid>
+void checkChangedCells()
+{
+  unsigned int size_x = 40, size_y = 30, size_z = 10;
+  Grid vg(size_x, size_y, size_z);
+  for (unsigned int x = 5; x < 35; x += 4) {
+    vg.markVoxelInMap(x, 12, 3, 0);
+  }
+
+  std::vector<double> ends;
+  for (unsigned int i = 0; i < 30; ++i) {
+    ends.push_back(i + 5.5);
+    ends.push_back(25.5 - i % 20);
+    ends.push_back((i % size_z) + 0.5);
+  }
+
+  // the first clearing changes cells from the initial cost, the same one changes nothing
+  std::vector<unsigned char> map(size_x * size_y, 254);
+  for (unsigned int pass = 0; pass < 2; ++pass) {
+    std::vector<unsigned char> before = map;
+    std::vector<unsigned int> changed;
+    vg.clearVoxelLinesInMap(
+      20.5, 2.5, 4.5, ends.data(), ends.size() / 3, map.data(), 9, 0, 0, 255, 40, &changed);
+
+    std::vector<unsigned int> expected;
+    for (unsigned int i = 0; i < size_x * size_y; ++i) {
+      if (map[i] != before[i]) {
+        expected.push_back(i);
+      }
+    }
+    std::sort(changed.begin(), changed.end());
+    EXPECT_EQ(changed, expected);
+    if (pass == 0) {
+      EXPECT_FALSE(changed.empty());
+    } else {
+      EXPECT_TRUE(changed.empty());
+    }
+  }
+}
+
+TEST(voxel_grid, changedCells) {
+  checkChangedCells<nav2_voxel_grid::VoxelGrid>();
+  checkChangedCells<nav2_voxel_grid::SparseVoxelGrid32>();
+}
+
+template<typename Grid>
+void checkTallColumns(unsigned int size_z)
+{
+  unsigned int size_x = 10, size_y = 10;
+  Grid vg(size_x, size_y, size_z);
+  ASSERT_EQ(vg.sizeZ(), size_z);
+
+  // every level of the column can be marked and read back on its own
+  for (unsigned int z = 0; z < size_z; ++z) {
+    ASSERT_EQ(vg.getVoxel(2, 3, z), nav2_voxel_grid::UNKNOWN);
+    vg.markVoxel(2, 3, z);
+    ASSERT_EQ(vg.getVoxel(2, 3, z), nav2_voxel_grid::MARKED);
+    if (z + 1 < size_z) {
+      ASSERT_EQ(vg.getVoxel(2, 3, z + 1), nav2_voxel_grid::UNKNOWN);
+    }
+  }
+  EXPECT_EQ(vg.getVoxelColumn(2, 3, 0, size_z - 1), nav2_voxel_grid::MARKED);
+  EXPECT_EQ(vg.getVoxelColumn(2, 3, 0, size_z), nav2_voxel_grid::FREE);
+
+  // a vertical line clears the whole column, top cell included
+  vg.clearVoxelLine(2.5, 3.5, 0.5, 2.5, 3.5, size_z - 0.5);
+  for (unsigned int z = 0; z < size_z; ++z) {
+    ASSERT_EQ(vg.getVoxel(2, 3, z), nav2_voxel_grid::FREE);
+  }
+
+  // and a diagonal one marks across the levels
+  vg.markVoxelLine(0.5, 0.5, 0.5, 9.5, 9.5, size_z - 0.5);
+  EXPECT_EQ(vg.getVoxel(0, 0, 0), nav2_voxel_grid::MARKED);
+  EXPECT_EQ(vg.getVoxel(9, 9, size_z - 1), nav2_voxel_grid::MARKED);
+
+  // the grid reads back the same once packed into 32 bit words for a message
+  unsigned int column_words = sizeof(typename Grid::Column) / sizeof(uint32_t);
+  std::vector<uint32_t> words(size_x * size_y * column_words);
+  memcpy(words.data(), vg.getData(), words.size() * sizeof(uint32_t));
+  for (unsigned int z = 0; z < size_z; ++z) {
+    ASSERT_EQ(
+      nav2_voxel_grid::getPackedVoxel(5, 5, z, size_x, size_y, size_z, words.data(), column_words),
+      vg.getVoxel(5, 5, z));
+    ASSERT_EQ(
+      nav2_voxel_grid::getPackedVoxel(2, 3, z, size_x, size_y, size_z, words.data(), column_words),
+      nav2_voxel_grid::FREE);
+  }
+
+  vg.resize(size_x, size_y, Grid::max_size_z + 1);
+  EXPECT_EQ(vg.sizeZ(), Grid::max_size_z);
+}
+
+TEST(voxel_grid, tallColumns) {
+  checkTallColumns<nav2_voxel_grid::VoxelGrid>(16);
+  checkTallColumns<nav2_voxel_grid::VoxelGrid64>(32);
+  checkTallColumns<nav2_voxel_grid::VoxelGrid128>(64);
+}
+
+TEST(voxel_grid, sparseMatchesDense) {
+  unsigned int size_x = 45, size_y = 38, size_z = 10;
+  nav2_voxel_grid::VoxelGrid dense(size_x, size_y, size_z);
+  nav2_voxel_grid::SparseVoxelGrid32 sparse(size_x, size_y, size_z);
+  EXPECT_EQ(sparse.chunkCount(), 0u);
+  EXPECT_EQ(sparse.getVoxel(3, 4, 5), nav2_voxel_grid::UNKNOWN);
+
+  std::vector<unsigned char> dense_map(size_x * size_y, 254);
+  std::vector<unsigned char> sparse_map(size_x * size_y, 254);
+  int shifts[][2] = {{3, -2}, {-9, 4}, {0, 7}, {-1, -1}};
+  for (auto & shift : shifts) {
+    for (unsigned int x = 10; x < 30; x += 3) {
+      EXPECT_EQ(
+        dense.markVoxelInMap(x, x - 4, x % size_z, 0),
+        sparse.markVoxelInMap(x, x - 4, x % size_z, 0));
+    }
+    std::vector<double> ends;
+    for (unsigned int i = 0; i < 20; ++i) {
+      ends.push_back(12.5 + i);
+      ends.push_back(30.5 - i);
+      ends.push_back((i % size_z) + 0.5);
+    }
+    dense.clearVoxelLinesInMap(
+      20.5, 18.5, 4.5, ends.data(), 20, dense_map.data(), 15, 0, 0, 255, 40);
+    sparse.clearVoxelLinesInMap(
+      20.5, 18.5, 4.5, ends.data(), 20, sparse_map.data(), 15, 0, 0, 255, 40);
+    EXPECT_EQ(dense_map, sparse_map);
+
+    // move the dense grid the way VoxelLayer::updateOrigin does
+    std::vector<uint32_t> old_data(dense.getData(), dense.getData() + size_x * size_y);
+    dense.reset();
+    for (int y = 0; y < static_cast<int>(size_y); ++y) {
+      for (int x = 0; x < static_cast<int>(size_x); ++x) {
+        int old_x = x + shift[0], old_y = y + shift[1];
+        if (old_x >= 0 && old_y >= 0 && old_x < static_cast<int>(size_x) &&
+          old_y < static_cast<int>(size_y))
+        {
+          dense.getData()[y * size_x + x] = old_data[old_y * size_x + old_x];
+        }
+      }
+    }
+    sparse.shift(shift[0], shift[1]);
+
+    std::vector<uint32_t> sparse_data(size_x * size_y);
+    sparse.copyData(sparse_data.data());
+    for (unsigned int i = 0; i < size_x * size_y; ++i) {
+      ASSERT_EQ(sparse_data[i], dense.getData()[i]);
+    }
+    for (unsigned int y = 0; y < size_y; ++y) {
+      for (unsigned int x = 0; x < size_x; ++x) {
+        ASSERT_EQ(sparse.getVoxelColumn(x, y, 5, 0), dense.getVoxelColumn(x, y, 5, 0));
+      }
+    }
+  }
+
+  // only the chunks the lines went through are allocated
+  EXPECT_LT(sparse.chunkCount(), ((size_x + 7) / 8) * ((size_y + 7) / 8));
+  sparse.reset();
+  EXPECT_EQ(sparse.chunkCount(), 0u);
+}
+
+TEST(voxel_grid, maskColumns) {
+  unsigned int size_x = 30, size_y = 25, size_z = 10;
+  nav2_voxel_grid::VoxelGrid dense(size_x, size_y, size_z);
+  nav2_voxel_grid::SparseVoxelGrid32 sparse(size_x, size_y, size_z);
+  sparse.shift(-5, 3);
+  for (unsigned int x = 0; x < size_x; x += 2) {
+    dense.markVoxel(x, x % size_y, 3);
+    sparse.markVoxel(x, x % size_y, 3);
+    dense.clearVoxel(x, (x + 1) % size_y, 6);
+    sparse.clearVoxel(x, (x + 1) % size_y, 6);
+  }
+  size_t chunks = sparse.chunkCount();
+
+  // forgetting the marks keeps the free and unknown voxels
+  const uint32_t forget = nav2_voxel_grid::VoxelColumn<uint32_t>::unknown();
+  dense.maskColumns(4, 2, 100, 20, forget);
+  sparse.maskColumns(4, 2, 100, 20, forget);
+  EXPECT_EQ(sparse.chunkCount(), chunks);
+
+  std::vector<uint32_t> sparse_data(size_x * size_y);
+  sparse.copyData(sparse_data.data());
+  for (unsigned int y = 0; y < size_y; ++y) {
+    for (unsigned int x = 0; x < size_x; ++x) {
+      ASSERT_EQ(sparse_data[y * size_x + x], dense.getData()[y * size_x + x]);
+      bool masked = x >= 4 && y >= 2 && y < 20;
+      if (x % 2 == 0 && y == x % size_y) {
+        EXPECT_EQ(
+          dense.getVoxel(x, y, 3),
+          masked ? nav2_voxel_grid::UNKNOWN : nav2_voxel_grid::MARKED);
+      }
+      if (x % 2 == 0 && y == (x + 1) % size_y) {
+        EXPECT_EQ(dense.getVoxel(x, y, 6), nav2_voxel_grid::FREE);
+      }
+    }
+  }
+}
+
 int main(int argc, char ** argv)
 {
   testing::InitGoogleTest(&argc, argv);
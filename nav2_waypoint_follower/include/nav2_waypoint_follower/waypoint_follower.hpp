@@ -22,9 +22,12 @@
 #include "nav2_util/lifecycle_node.hpp"
 #include "nav2_msgs/action/navigate_to_pose.hpp"
 #include "nav2_msgs/action/follow_waypoints.hpp"
+#include "nav2_msgs/action/compute_paths_to_poses.hpp"
 #include "nav_msgs/msg/path.hpp"
 #include "nav2_util/simple_action_server.hpp"
 #include "rclcpp_action/rclcpp_action.hpp"
+#include "tf2_ros/buffer.h"
+#include "tf2_ros/transform_listener.h"
 
 namespace nav2_waypoint_follower
 {
@@ -49,11 +52,13 @@ public:
   using ClientT = nav2_msgs::action::NavigateToPose;
   using ActionServer = nav2_util::SimpleActionServer<ActionT>;
   using ActionClient = rclcpp_action::Client<ClientT>;
+  using PathsT = nav2_msgs::action::ComputePathsToPoses;
 
   /**
    * @brief A constructor for nav2_waypoint_follower::WaypointFollower class
+   * @param options Additional options to control creation of the node.
    */
-  WaypointFollower();
+  explicit WaypointFollower(const rclcpp::NodeOptions & options = rclcpp::NodeOptions());
   /**
    * @brief A destructor for nav2_waypoint_follower::WaypointFollower class
    */
@@ -103,6 +108,31 @@ protected:
    */
   void followWaypoints();
 
+  /**
+   * @brief The order to follow waypoints in, the one given unless
+   * optimize_waypoint_order is set
+   * @param poses The waypoints
+   * @return The indices of the waypoints in the order to follow them
+   */
+  std::vector<unsigned int> getWaypointOrder(
+    const std::vector<geometry_msgs::msg::PoseStamped> & poses);
+
+  /**
+   * @brief Get the cost of the paths from a pose to each waypoint from the planner server
+   * @param paths_goal The request to send
+   * @param costs Set to the cost of the path to each waypoint, negative if there's none
+   * @return True if the planner server answered
+   */
+  bool getPathCosts(const PathsT::Goal & paths_goal, std::vector<double> & costs);
+
+  /**
+   * @brief Whether the robot is close enough to a waypoint to move on to the
+   * next one without stopping
+   * @param waypoint The waypoint being navigated to
+   * @return True if pass_through_radius is set and the robot is within it
+   */
+  bool isPassingThrough(const geometry_msgs::msg::PoseStamped & waypoint);
+
   /**
    * @brief Action client result callback
    * @param result Result of action server updated asynchronously
@@ -124,6 +154,22 @@ protected:
   ActionStatus current_goal_status_;
   int loop_rate_;
   std::vector<int> failed_ids_;
+
+  // Reorders the waypoints from the costs of the paths between them
+  rclcpp_action::Client<PathsT>::SharedPtr compute_paths_client_;
+  bool optimize_waypoint_order_;
+  bool keep_last_waypoint_;
+  std::string planner_id_;
+
+  // Counts the goals sent, the responses of earlier ones are dropped
+  unsigned int goal_sequence_{0};
+
+  // Distance to an intermediate waypoint at which the robot moves on to the
+  // next one, zero to stop at every waypoint
+  double pass_through_radius_;
+  std::string robot_base_frame_;
+  std::shared_ptr<tf2_ros::Buffer> tf_;
+  std::shared_ptr<tf2_ros::TransformListener> tf_listener_;
 };
 
 }  // namespace nav2_waypoint_follower
@@ -0,0 +1,38 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NAV2_WAYPOINT_FOLLOWER__WAYPOINT_ORDER_HPP_
+#define NAV2_WAYPOINT_FOLLOWER__WAYPOINT_ORDER_HPP_
+
+#include <vector>
+
+namespace nav2_waypoint_follower
+{
+
+/**
+ * @brief Find a short order to visit waypoints in, starting from the robot.
+ * The order is built nearest waypoint first, then improved with 2-opt and
+ * Or-opt moves until neither shortens it.
+ * @param costs The cost of going from one place to another, costs[i][j], with
+ * the robot as place 0 and the waypoints as 1 to n. A negative cost means there's
+ * no way between the two.
+ * @param keep_last Whether the last waypoint has to stay the last one visited
+ * @return The waypoints, numbered from 0, in the order to visit them
+ */
+std::vector<unsigned int> orderWaypoints(
+  const std::vector<std::vector<double>> & costs, bool keep_last);
+
+}  // namespace nav2_waypoint_follower
+
+#endif  // NAV2_WAYPOINT_FOLLOWER__WAYPOINT_ORDER_HPP_
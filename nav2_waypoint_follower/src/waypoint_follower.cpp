@@ -19,19 +19,29 @@
 #include <streambuf>
 #include <string>
 #include <utility>
+#include <vector>
+
+#include "nav2_util/robot_utils.hpp"
+#include "nav2_waypoint_follower/waypoint_order.hpp"
+#include "tf2_ros/create_timer_ros.h"
 
 // TODO(stevemacenski): Add capability for reading in yaml file and executing
 
 namespace nav2_waypoint_follower
 {
 
-WaypointFollower::WaypointFollower()
-: nav2_util::LifecycleNode("WaypointFollower", "", true)
+WaypointFollower::WaypointFollower(const rclcpp::NodeOptions & options)
+: nav2_util::LifecycleNode("WaypointFollower", "", true, options)
 {
   RCLCPP_INFO(get_logger(), "Creating");
 
   declare_parameter("stop_on_failure", true);
   declare_parameter("loop_rate", 20);
+  declare_parameter("pass_through_radius", 0.0);
+  declare_parameter("robot_base_frame", std::string("base_link"));
+  declare_parameter("optimize_waypoint_order", false);
+  declare_parameter("keep_last_waypoint", true);
+  declare_parameter("planner_id", std::string(""));
 }
 
 WaypointFollower::~WaypointFollower()
@@ -46,6 +56,21 @@ WaypointFollower::on_configure(const rclcpp_lifecycle::State & /*state*/)
 
   stop_on_failure_ = get_parameter("stop_on_failure").as_bool();
   loop_rate_ = get_parameter("loop_rate").as_int();
+  pass_through_radius_ = get_parameter("pass_through_radius").as_double();
+  robot_base_frame_ = get_parameter("robot_base_frame").as_string();
+  optimize_waypoint_order_ = get_parameter("optimize_waypoint_order").as_bool();
+  keep_last_waypoint_ = get_parameter("keep_last_waypoint").as_bool();
+  planner_id_ = get_parameter("planner_id").as_string();
+
+  // The robot's pose is only needed to pass through waypoints
+  if (pass_through_radius_ > 0.0) {
+    tf_ = std::make_shared<tf2_ros::Buffer>(get_clock());
+    auto timer_interface = std::make_shared<tf2_ros::CreateTimerROS>(
+      get_node_base_interface(), get_node_timers_interface());
+    tf_->setCreateTimerInterface(timer_interface);
+    tf_->setUsingDedicatedThread(true);
+    tf_listener_ = std::make_shared<tf2_ros::TransformListener>(*tf_, this, false);
+  }
 
   client_node_ = std::make_shared<rclcpp::Node>(
     std::string(get_name()) + std::string("_client_node"));
@@ -53,6 +78,11 @@ WaypointFollower::on_configure(const rclcpp_lifecycle::State & /*state*/)
   nav_to_pose_client_ = rclcpp_action::create_client<ClientT>(
     client_node_, "navigate_to_pose");
 
+  if (optimize_waypoint_order_) {
+    compute_paths_client_ = rclcpp_action::create_client<PathsT>(
+      client_node_, "compute_paths_to_poses");
+  }
+
   action_server_ = std::make_unique<ActionServer>(
     get_node_base_interface(),
     get_node_clock_interface(),
@@ -90,6 +120,11 @@ WaypointFollower::on_cleanup(const rclcpp_lifecycle::State & /*state*/)
 
   action_server_.reset();
   nav_to_pose_client_.reset();
+  compute_paths_client_.reset();
+
+  // Reset the listener before the buffer
+  tf_listener_.reset();
+  tf_.reset();
 
   return nav2_util::CallbackReturn::SUCCESS;
 }
@@ -128,6 +163,7 @@ WaypointFollower::followWaypoints()
   rclcpp::Rate r(loop_rate_);
   uint goal_index = 0;
   bool new_goal = true;
+  std::vector<unsigned int> order = getWaypointOrder(goal->poses);
 
   while (rclcpp::ok()) {
     // Check if asked to stop processing action
@@ -143,35 +179,50 @@ WaypointFollower::followWaypoints()
       goal = action_server_->accept_pending_goal();
       goal_index = 0;
       new_goal = true;
+      order = getWaypointOrder(goal->poses);
     }
 
     // Check if we need to send a new goal
     if (new_goal) {
       new_goal = false;
       ClientT::Goal client_goal;
-      client_goal.pose = goal->poses[goal_index];
+      client_goal.pose = goal->poses[order[goal_index]];
+
+      // A goal sent while the last one is still running preempts it, and the
+      // navigator aborts the last one, so its responses are dropped
+      unsigned int goal_sequence = ++goal_sequence_;
 
       auto send_goal_options = rclcpp_action::Client<ClientT>::SendGoalOptions();
       send_goal_options.result_callback =
-        std::bind(&WaypointFollower::resultCallback, this, std::placeholders::_1);
+        [this, goal_sequence](
+        const rclcpp_action::ClientGoalHandle<ClientT>::WrappedResult & result) {
+          if (goal_sequence == goal_sequence_) {
+            resultCallback(result);
+          }
+        };
       send_goal_options.goal_response_callback =
-        std::bind(&WaypointFollower::goalResponseCallback, this, std::placeholders::_1);
+        [this, goal_sequence](
+        std::shared_future<rclcpp_action::ClientGoalHandle<ClientT>::SharedPtr> future) {
+          if (goal_sequence == goal_sequence_) {
+            goalResponseCallback(future);
+          }
+        };
       auto future_goal_handle =
         nav_to_pose_client_->async_send_goal(client_goal, send_goal_options);
       current_goal_status_ = ActionStatus::PROCESSING;
     }
 
-    feedback->current_waypoint = goal_index;
+    feedback->current_waypoint = order[goal_index];
     action_server_->publish_feedback(feedback);
 
     if (current_goal_status_ == ActionStatus::FAILED) {
-      failed_ids_.push_back(goal_index);
+      failed_ids_.push_back(order[goal_index]);
 
       if (stop_on_failure_) {
         RCLCPP_WARN(
           get_logger(), "Failed to process waypoint %i in waypoint "
           "list and stop on failure is enabled."
-          " Terminating action.", goal_index);
+          " Terminating action.", order[goal_index]);
         result->missed_waypoints = failed_ids_;
         action_server_->terminate_current(result);
         failed_ids_.clear();
@@ -179,12 +230,12 @@ WaypointFollower::followWaypoints()
       } else {
         RCLCPP_INFO(
           get_logger(), "Failed to process waypoint %i,"
-          " moving to next.", goal_index);
+          " moving to next.", order[goal_index]);
       }
     } else if (current_goal_status_ == ActionStatus::SUCCEEDED) {
       RCLCPP_INFO(
         get_logger(), "Succeeded processing waypoint %i, "
-        "moving to next.", goal_index);
+        "moving to next.", order[goal_index]);
     }
 
     if (current_goal_status_ != ActionStatus::PROCESSING &&
@@ -202,11 +253,21 @@ WaypointFollower::followWaypoints()
         failed_ids_.clear();
         return;
       }
+    } else if (goal_index + 1 < goal->poses.size() &&
+      isPassingThrough(goal->poses[order[goal_index]]))
+    {
+      // Head for the next waypoint without stopping at this one, the navigator
+      // takes the new goal over from the current one
+      RCLCPP_INFO(
+        get_logger(), "Passing through waypoint %i, "
+        "moving to next.", order[goal_index]);
+      goal_index++;
+      new_goal = true;
     } else {
       RCLCPP_INFO_EXPRESSION(
         get_logger(),
         (static_cast<int>(now().seconds()) % 30 == 0),
-        "Processing waypoint %i...", goal_index);
+        "Processing waypoint %i...", order[goal_index]);
     }
 
     rclcpp::spin_some(client_node_);
@@ -214,6 +275,104 @@ WaypointFollower::followWaypoints()
   }
 }
 
+std::vector<unsigned int>
+WaypointFollower::getWaypointOrder(const std::vector<geometry_msgs::msg::PoseStamped> & poses)
+{
+  std::vector<unsigned int> order(poses.size());
+  for (unsigned int i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+
+  if (!optimize_waypoint_order_ || poses.size() < (keep_last_waypoint_ ? 3u : 2u)) {
+    return order;
+  }
+
+  if (!compute_paths_client_->wait_for_action_server(std::chrono::seconds(1))) {
+    RCLCPP_WARN(
+      get_logger(), "compute_paths_to_poses action server is not available,"
+      " following the waypoints in the order given.");
+    return order;
+  }
+
+  // The cost from the robot, then from each waypoint, to every waypoint, one
+  // batch request each
+  std::vector<std::vector<double>> costs(poses.size() + 1);
+  for (unsigned int i = 0; i <= poses.size(); ++i) {
+    PathsT::Goal paths_goal;
+    paths_goal.poses = poses;
+    paths_goal.planner_id = planner_id_;
+    if (i > 0) {
+      paths_goal.start = poses[i - 1];
+      paths_goal.use_start = true;
+    }
+
+    if (!getPathCosts(paths_goal, costs[i])) {
+      RCLCPP_WARN(
+        get_logger(), "Failed to get the costs between the waypoints,"
+        " following them in the order given.");
+      return order;
+    }
+    costs[i].insert(costs[i].begin(), 0.0);
+  }
+
+  order = orderWaypoints(costs, keep_last_waypoint_);
+  RCLCPP_INFO(get_logger(), "Reordered %zu waypoints.", poses.size());
+  return order;
+}
+
+bool
+WaypointFollower::getPathCosts(const PathsT::Goal & paths_goal, std::vector<double> & costs)
+{
+  // Long enough to plan over the whole costmap from each pose
+  const std::chrono::seconds timeout(5);
+
+  auto future_goal_handle = compute_paths_client_->async_send_goal(paths_goal);
+  if (rclcpp::spin_until_future_complete(client_node_, future_goal_handle, timeout) !=
+    rclcpp::executor::FutureReturnCode::SUCCESS)
+  {
+    return false;
+  }
+  auto goal_handle = future_goal_handle.get();
+  if (!goal_handle) {
+    return false;
+  }
+
+  auto future_result = compute_paths_client_->async_get_result(goal_handle);
+  if (rclcpp::spin_until_future_complete(client_node_, future_result, timeout) !=
+    rclcpp::executor::FutureReturnCode::SUCCESS)
+  {
+    return false;
+  }
+  auto result = future_result.get();
+  if (result.code != rclcpp_action::ResultCode::SUCCEEDED ||
+    result.result->costs.size() != paths_goal.poses.size())
+  {
+    return false;
+  }
+
+  costs = result.result->costs;
+  return true;
+}
+
+bool
+WaypointFollower::isPassingThrough(const geometry_msgs::msg::PoseStamped & waypoint)
+{
+  if (pass_through_radius_ <= 0.0) {
+    return false;
+  }
+
+  geometry_msgs::msg::PoseStamped current_pose;
+  if (!nav2_util::getCurrentPose(
+      current_pose, *tf_, waypoint.header.frame_id, robot_base_frame_, 0.0))
+  {
+    return false;
+  }
+
+  double dx = waypoint.pose.position.x - current_pose.pose.position.x;
+  double dy = waypoint.pose.position.y - current_pose.pose.position.y;
+  return dx * dx + dy * dy <= pass_through_radius_ * pass_through_radius_;
+}
+
 void
 WaypointFollower::resultCallback(
   const rclcpp_action::ClientGoalHandle<ClientT>::WrappedResult & result)
@@ -248,3 +407,10 @@ WaypointFollower::goalResponseCallback(
 }
 
 }  // namespace nav2_waypoint_follower
+
+#include "rclcpp_components/register_node_macro.hpp"
+
+// Register the component with class_loader.
+// This acts as a sort of entry point, allowing the component to be discoverable when its library
+// is being loaded into a running process.
+RCLCPP_COMPONENTS_REGISTER_NODE(nav2_waypoint_follower::WaypointFollower)
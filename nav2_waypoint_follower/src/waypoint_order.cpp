@@ -0,0 +1,156 @@
+// Copyright (c) 2020 Samsung Research America
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nav2_waypoint_follower/waypoint_order.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace nav2_waypoint_follower
+{
+
+namespace
+{
+
+// Cost of a leg there's no way along, high enough for any order that avoids
+// one to be preferred
+const double UNREACHABLE_COST = 1e9;
+
+// Improvements smaller than this are rounding, and would never stop
+const double MIN_IMPROVEMENT = 1e-9;
+
+// The most rounds of improvement made, each one trying every move
+const int MAX_ROUNDS = 100;
+
+class Route
+{
+public:
+  explicit Route(const std::vector<std::vector<double>> & costs)
+  : costs_(costs)
+  {
+  }
+
+  double leg(unsigned int from, unsigned int to) const
+  {
+    double cost = costs_[from][to];
+    return cost < 0.0 ? UNREACHABLE_COST : cost;
+  }
+
+  // Cost of visiting the places in order, from the robot at place 0
+  double cost(const std::vector<unsigned int> & order) const
+  {
+    double total = 0.0;
+    unsigned int from = 0;
+    for (unsigned int to : order) {
+      total += leg(from, to);
+      from = to;
+    }
+    return total;
+  }
+
+private:
+  const std::vector<std::vector<double>> & costs_;
+};
+
+}  // namespace
+
+std::vector<unsigned int> orderWaypoints(
+  const std::vector<std::vector<double>> & costs, bool keep_last)
+{
+  unsigned int num_places = static_cast<unsigned int>(costs.size());
+  if (num_places < 2) {
+    return {};
+  }
+  unsigned int last = num_places - 1;
+  Route route(costs);
+
+  // Start from the nearest waypoint each time
+  std::vector<unsigned int> order;
+  std::vector<bool> visited(num_places, false);
+  visited[0] = true;
+  if (keep_last) {
+    visited[last] = true;
+  }
+  unsigned int from = 0;
+  for (unsigned int i = keep_last ? 2 : 1; i < num_places; ++i) {
+    unsigned int next = 0;
+    for (unsigned int to = 1; to < num_places; ++to) {
+      if (!visited[to] && (next == 0 || route.leg(from, to) < route.leg(from, next))) {
+        next = to;
+      }
+    }
+    visited[next] = true;
+    order.push_back(next);
+    from = next;
+  }
+  if (keep_last) {
+    order.push_back(last);
+  }
+
+  // The waypoints that can be moved, the kept last one excluded
+  size_t movable = order.size() - (keep_last ? 1 : 0);
+  double best = route.cost(order);
+
+  for (int round = 0; round < MAX_ROUNDS; ++round) {
+    bool improved = false;
+
+    // 2-opt: reverse a stretch of the route
+    for (size_t i = 0; i + 1 < movable; ++i) {
+      for (size_t j = i + 1; j < movable; ++j) {
+        std::reverse(order.begin() + i, order.begin() + j + 1);
+        double cost = route.cost(order);
+        if (cost < best - MIN_IMPROVEMENT) {
+          best = cost;
+          improved = true;
+        } else {
+          std::reverse(order.begin() + i, order.begin() + j + 1);
+        }
+      }
+    }
+
+    // Or-opt: move a stretch of up to three waypoints elsewhere in the route
+    for (size_t length = 1; length <= 3 && length < movable; ++length) {
+      for (size_t i = 0; i + length <= movable; ++i) {
+        for (size_t j = 0; j + length <= movable; ++j) {
+          if (j == i) {
+            continue;
+          }
+          std::vector<unsigned int> candidate(order);
+          std::vector<unsigned int> stretch(
+            candidate.begin() + i, candidate.begin() + i + length);
+          candidate.erase(candidate.begin() + i, candidate.begin() + i + length);
+          candidate.insert(candidate.begin() + j, stretch.begin(), stretch.end());
+          double cost = route.cost(candidate);
+          if (cost < best - MIN_IMPROVEMENT) {
+            best = cost;
+            order.swap(candidate);
+            improved = true;
+          }
+        }
+      }
+    }
+
+    if (!improved) {
+      break;
+    }
+  }
+
+  // Number the waypoints from 0
+  for (auto & place : order) {
+    --place;
+  }
+  return order;
+}
+
+}  // namespace nav2_waypoint_follower